@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/cloud_init_iso.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+void write_cloud_init_iso(benchmark::State& state)
+{
+    QTemporaryDir dir;
+    const auto iso_path = QDir{dir.path()}.filePath("cloud-init-config.iso");
+
+    mp::CloudInitIso iso;
+    iso.add_file("meta-data", "#cloud-config\ninstance-id: bench\nlocal-hostname: bench\ncloud-name: multipass\n");
+    iso.add_file("vendor-data", "#cloud-config\n" + std::string(static_cast<std::size_t>(state.range(0)), '#'));
+    iso.add_file("user-data", "#cloud-config\n{}\n");
+    iso.add_file("network-config", "#cloud-config\nversion: 2\n");
+
+    for (auto _ : state)
+        iso.write_to(iso_path);
+}
+
+BENCHMARK(write_cloud_init_iso)->Arg(1 << 10)->Arg(64 << 10);
+} // namespace
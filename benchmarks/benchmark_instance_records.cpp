@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/json_writer.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+namespace mp = multipass;
+
+namespace
+{
+// Shaped like what the daemon keeps for each instance
+QJsonObject instance_record(int index)
+{
+    const QJsonArray mounts{QJsonObject{{"source_path", QString{"/home/ubuntu/project%1"}.arg(index)},
+                                        {"target_path", "/home/ubuntu/project"},
+                                        {"uid_mappings", QJsonArray{QJsonObject{{"host_uid", 1000},
+                                                                                {"instance_uid", -1}}}},
+                                        {"gid_mappings", QJsonArray{QJsonObject{{"host_gid", 1000},
+                                                                                {"instance_gid", -1}}}},
+                                        {"mount_type", 0},
+                                        {"profile", ""}}};
+
+    return {{"num_cores", 2},
+            {"mem_size", "1073741824"},
+            {"disk_space", "5368709120"},
+            {"ssh_username", "ubuntu"},
+            {"state", 2},
+            {"deleted", false},
+            {"metadata", QJsonObject{}},
+            {"mac_addr", QString{"52:54:00:00:%1:%2"}.arg(index / 256, 2, 16, QChar{'0'}).arg(index % 256, 2, 16,
+                                                                                               QChar{'0'})},
+            {"extra_interfaces", QJsonArray{}},
+            {"mounts", mounts}};
+}
+
+// What persisting the instances amounts to: serializing every record and replacing the file with them
+void persist_instance_records(benchmark::State& state)
+{
+    QTemporaryDir dir;
+    const auto file_name = QDir{dir.path()}.filePath("multipassd-vm-instances.json");
+
+    QJsonObject records;
+    for (auto i = 0; i < state.range(0); ++i)
+        records.insert(QString{"instance-%1"}.arg(i), instance_record(i));
+
+    for (auto _ : state)
+        mp::write_json(records, file_name);
+}
+
+BENCHMARK(persist_instance_records)->Arg(1)->Arg(50)->Arg(500)->Unit(benchmark::kMicrosecond);
+} // namespace
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/memory_size.h>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+void parse_memory_size(benchmark::State& state, const std::string& size)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mp::MemorySize{size}.in_bytes());
+}
+
+BENCHMARK_CAPTURE(parse_memory_size, bytes, std::string{"1073741824"});
+BENCHMARK_CAPTURE(parse_memory_size, suffixed, std::string{"5G"});
+BENCHMARK_CAPTURE(parse_memory_size, binary_suffixed, std::string{"2048MiB"});
+} // namespace
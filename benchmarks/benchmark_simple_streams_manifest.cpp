@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/constants.h>
+#include <multipass/settings/settings.h>
+#include <multipass/settings/settings_handler.h>
+#include <multipass/simple_streams_manifest.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+
+#include <memory>
+
+namespace mp = multipass;
+
+namespace
+{
+class DriverSettingsHandler : public mp::SettingsHandler
+{
+public:
+    std::set<QString> keys() const override
+    {
+        return {mp::driver_key};
+    }
+
+    QString get(const QString& /*key*/) const override
+    {
+        return "qemu";
+    }
+
+    void set(const QString& /*key*/, const QString& /*val*/) override
+    {
+    }
+};
+
+QJsonObject item(const QString& ftype, const QString& path, int size)
+{
+    return {{"ftype", ftype},
+            {"md5", "7388b8e7e0e114b941a04aca591e2d64"},
+            {"path", path},
+            {"sha256", "1797c5c82016c1e65f4008fcf89deae3a044ef76087a9ec5b907c6d64a3609ac"},
+            {"size", size}};
+}
+
+// Shaped like the release stream: each release for each architecture, with a couple dozen dated versions each. Only
+// the host's architecture is taken in, which is assumed to be amd64 or arm64.
+QByteArray make_manifest(int releases)
+{
+    const auto host_arch = QSysInfo::currentCpuArchitecture() == "arm64" ? "arm64" : "amd64";
+    const auto arches = {QString{host_arch}, QString{"armhf"}, QString{"ppc64el"}, QString{"s390x"}};
+
+    QJsonObject products;
+    for (auto release = 0; release < releases; ++release)
+    {
+        const auto codename = QString{"release%1"}.arg(release);
+        for (const auto& arch : arches)
+        {
+            QJsonObject versions;
+            for (auto day = 1; day <= 24; ++day)
+            {
+                const auto version = QString{"202206%1"}.arg(day, 2, 10, QChar{'0'});
+                const auto prefix =
+                    QString{"server/releases/%1/release-%2/ubuntu-%1-server-cloudimg-%3"}.arg(codename, version, arch);
+
+                const QJsonObject items{{"disk1.img", item("disk1.img", prefix + ".img", 287440896)},
+                                        {"lxd.tar.xz", item("lxd.tar.xz", prefix + "-lxd.tar.xz", 876)},
+                                        {"root.tar.xz", item("root.tar.xz", prefix + "-root.tar.xz", 175874476)},
+                                        {"squashfs", item("squashfs", prefix + ".squashfs", 205615104)}};
+                versions.insert(version, QJsonObject{{"items", items}});
+            }
+
+            products.insert(QString{"com.ubuntu.cloud:server:%1:%2"}.arg(codename, arch),
+                            QJsonObject{{"aliases", codename},
+                                        {"arch", arch},
+                                        {"os", "ubuntu"},
+                                        {"release", codename},
+                                        {"release_title", codename},
+                                        {"supported", true},
+                                        {"version", codename},
+                                        {"versions", versions}});
+        }
+    }
+
+    return QJsonDocument{QJsonObject{{"content_id", "com.ubuntu.cloud:released:download"},
+                                     {"datatype", "image-downloads"},
+                                     {"format", "products:1.0"},
+                                     {"updated", "Wed, 20 May 2022 16:47:50 +0000"},
+                                     {"products", products}}}
+        .toJson();
+}
+
+void parse_simple_streams_manifest(benchmark::State& state)
+{
+    auto handler = MP_SETTINGS.register_handler(std::make_unique<DriverSettingsHandler>());
+    const auto json = make_manifest(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mp::SimpleStreamsManifest::fromJson(json, "https://cloud-images.ubuntu.com/"));
+
+    state.SetBytesProcessed(state.iterations() * json.size());
+    MP_SETTINGS.unregister_handler(handler);
+}
+
+BENCHMARK(parse_simple_streams_manifest)->Arg(4)->Arg(32)->Unit(benchmark::kMillisecond);
+} // namespace
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/utils.h>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+// A line of dnsmasq's leases file, as scanned for every address lookup
+const std::string lease{"1700000000 52:54:00:12:34:56 10.75.12.34 instance-name 01:52:54:00:12:34:56"};
+
+void split_with_regex(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mp::utils::split(lease, " "));
+}
+
+void split_lazily(benchmark::State& state)
+{
+    for (auto _ : state)
+        for (auto token : mp::utils::split_view(lease, " "))
+            benchmark::DoNotOptimize(token);
+}
+
+BENCHMARK(split_with_regex);
+BENCHMARK(split_lazily);
+} // namespace
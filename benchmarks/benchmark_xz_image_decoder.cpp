@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/xz_image_decoder.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace mp = multipass;
+
+namespace
+{
+// 16MiB of image-like pages, most of them zeroes
+void decode_xz_image(benchmark::State& state)
+{
+    QTemporaryDir dir;
+    const auto decoded_path = QDir{dir.path()}.filePath("image.img");
+    const auto ignore_progress = [](int, int) { return true; };
+
+    for (auto _ : state)
+    {
+        mp::XzImageDecoder decoder{BENCHMARK_DATA_DIR "/image.img.xz"};
+        decoder.decode_to(decoded_path, ignore_progress);
+    }
+
+    state.SetBytesProcessed(state.iterations() * QFileInfo{decoded_path}.size());
+}
+
+BENCHMARK(decode_xz_image)->Unit(benchmark::kMillisecond);
+} // namespace
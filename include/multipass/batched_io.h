@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_BATCHED_IO_H
+#define MULTIPASS_BATCHED_IO_H
+
+#include <cstddef>
+#include <vector>
+
+namespace multipass
+{
+namespace utils
+{
+struct IoRequest
+{
+    int fd;
+    char* data;
+    std::size_t size;
+    long long pos;
+    bool write;
+    long long result{-1}; // what pread or pwrite would have returned, or -errno
+};
+
+/**
+ * Run all @p requests through the calling thread's own io_uring, submitting as many at a time as it holds and waiting
+ * for them with the same system calls, for the kernel to have them all underway at once. Returns false, having run
+ * none, where the host has no io_uring to offer, be it an older kernel or a seccomp filter that blocks it.
+ */
+bool run_batched_io(std::vector<IoRequest>& requests);
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_BATCHED_IO_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_CGROUPS_H
+#define MULTIPASS_CGROUPS_H
+
+#include "optional.h"
+#include "vm_resource_limits.h"
+
+#include <QDir>
+#include <QString>
+
+namespace multipass
+{
+namespace utils
+{
+// Where Linux mounts the unified (v2) cgroup hierarchy, and where a process finds its place in it
+constexpr auto cgroup_fs_dir = "/sys/fs/cgroup";
+constexpr auto proc_self_cgroup = "/proc/self/cgroup";
+
+// The cgroups that the daemon makes under the one it was started in
+constexpr auto daemon_cgroup = "daemon";       // for the daemon itself and the helpers it runs
+constexpr auto instances_cgroup = "instances"; // for one cgroup per instance
+
+// The cgroup this process is in; nullopt on hosts that do not use the unified hierarchy
+optional<QDir> own_cgroup(const QDir& cgroup_fs = QDir{cgroup_fs_dir}, const QString& proc_file = proc_self_cgroup);
+
+/**
+ * Split @p own, the cgroup the daemon was started in, in two: one where all of its processes move to, which keeps
+ * the daemon and its helpers responsive when instances contend for the host, and a parent for those of instances,
+ * with the CPU, I/O and memory controllers enabled. Returns the latter, or nullopt when @p own was not delegated to
+ * us, leaving it as it was. The cgroups that instances of a previous run left behind go, unless processes remain in
+ * them.
+ */
+optional<QDir> set_up_cgroups(const QDir& own);
+
+// Create the cgroup at @p dir, if it is not there, and have it enforce @p limits; false if it cannot be written
+bool apply_resource_limits(const QDir& dir, const VMResourceLimits& limits);
+
+// Remove the cgroup at @p dir, which the kernel only lets go once no process is left in it; false if it stays
+bool remove_cgroup(const QDir& dir);
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_CGROUPS_H
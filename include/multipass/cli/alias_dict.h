@@ -44,35 +44,44 @@ public:
     optional<AliasDefinition> get_alias(const std::string& alias) const;
     DictType::iterator begin()
     {
+        load_dict_once();
         return aliases.begin();
     }
     DictType::iterator end()
     {
+        load_dict_once();
         return aliases.end();
     }
     DictType::const_iterator cbegin() const
     {
+        load_dict_once();
         return aliases.cbegin();
     }
     DictType::const_iterator cend() const
     {
+        load_dict_once();
         return aliases.cend();
     }
     bool empty() const
     {
+        load_dict_once();
         return aliases.empty();
     }
     size_type size() const
     {
+        load_dict_once();
         return aliases.size();
     }
 
 private:
-    void load_dict();
+    void load_dict_once() const;
+    void load_dict() const;
     void save_dict();
 
+    // The file is only read when the aliases are first looked at, so commands that never touch them skip it
+    mutable bool loaded = false;
     bool modified = false;
-    DictType aliases;
+    mutable DictType aliases;
     std::string aliases_file;
     std::ostream& cout;
     std::ostream& cerr;
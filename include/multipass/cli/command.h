@@ -76,6 +76,9 @@ protected:
         auto rpc_method = std::bind(rpc_func, stub, std::placeholders::_1, std::placeholders::_2);
 
         grpc::ClientContext context;
+        if (auto traceparent = qgetenv("TRACEPARENT"); !traceparent.isEmpty()) // to trace the call as part of another
+            context.AddMetadata("traceparent", traceparent.toStdString());
+
         std::unique_ptr<grpc::ClientReaderInterface<ReplyType>> reader = rpc_method(&context, request);
 
         while (reader->Read(&reply))
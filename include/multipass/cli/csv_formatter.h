@@ -31,6 +31,8 @@ public:
     std::string format(const FindReply& list) const override;
     std::string format(const VersionReply& list, const std::string& client_version) const override;
     std::string format(const AliasDict& aliases) const override;
+    bool streams_lists() const override;
+    std::string format_list_part(const ListReply& reply, bool first_part) const override;
 };
 }
 #endif // MULTIPASS_CSV_FORMATTER
@@ -41,6 +41,17 @@ public:
     virtual std::string format(const VersionReply& reply, const std::string& client_version) const = 0;
     virtual std::string format(const AliasDict& aliases) const = 0;
 
+    // Formatters whose list output needs no view of the whole reply can print it part by part, as it arrives
+    virtual bool streams_lists() const
+    {
+        return false;
+    }
+
+    virtual std::string format_list_part(const ListReply& reply, bool /*first_part*/) const
+    {
+        return format(reply);
+    }
+
 protected:
     Formatter() = default;
 
@@ -25,12 +25,25 @@ namespace multipass
 class JsonFormatter final : public Formatter
 {
 public:
+    enum class Layout
+    {
+        document, // one pretty-printed document
+        lines     // one compact object per entry and line (NDJSON)
+    };
+
+    explicit JsonFormatter(Layout layout = Layout::document);
+
     std::string format(const InfoReply& info) const override;
     std::string format(const ListReply& list) const override;
     std::string format(const NetworksReply& list) const override;
     std::string format(const FindReply& list) const override;
     std::string format(const VersionReply& list, const std::string& client_version) const override;
     std::string format(const AliasDict& aliases) const override;
+    bool streams_lists() const override;
+    std::string format_list_part(const ListReply& reply, bool first_part) const override;
+
+private:
+    Layout layout;
 };
 }
 #endif // MULTIPASS_JSON_FORMATTER
@@ -22,8 +22,13 @@
 #include <multipass/path.h>
 
 #include <QList>
+#include <QSet>
 #include <QSslCertificate>
 
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
 namespace multipass
 {
 class ClientCertStore : public CertStore
@@ -36,10 +41,15 @@ public:
     bool empty() override;
 
 private:
-    bool verify_cert(const QSslCertificate& cert);
+    bool verify_cert(const QSslCertificate& cert); // with the mutex held
 
     Path cert_dir;
     QList<QSslCertificate> authenticated_client_certs;
+    QSet<QByteArray> authenticated_digests; // SHA-256 of each cert, to find them without a scan
+    // The PEMs of trusted certs, as clients present them, so that every request does not have to parse them again.
+    // Only trusted ones go in, and certs are never taken out of the store, so nothing here goes stale.
+    std::unordered_set<std::string> verified_pems;
+    std::mutex mutex; // requests are verified on the RPC threads
 };
 } // namespace multipass
 #endif // MULTIPASS_CLIENT_CERT_STORE_H
@@ -22,6 +22,8 @@
 
 #include <multipass/path.h>
 
+#include <QByteArray>
+
 #include <string>
 #include <vector>
 
@@ -31,7 +33,8 @@ class CloudInitIso
 {
 public:
     void add_file(const std::string& name, const std::string& data);
-    void write_to(const Path& path);
+    QByteArray to_bytes() const;
+    void write_to(const Path& path) const;
 
 private:
     struct FileEntry
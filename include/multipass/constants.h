@@ -56,6 +56,28 @@ constexpr auto driver_key = "local.driver";            // idem
 constexpr auto passphrase_key = "local.passphrase";    // idem
 constexpr auto bridged_interface_key = "local.bridged-network"; // idem
 constexpr auto mounts_key = "local.privileged-mounts"; // idem
+constexpr auto prefetch_images_key = "local.prefetch-images"; // idem
+constexpr auto mount_cache_key = "local.mount-attribute-cache"; // idem
+constexpr auto metrics_interval_key = "local.metrics-interval"; // idem
+constexpr auto warm_pool_size_key = "local.warm-pool-size";     // idem
+constexpr auto reclaim_memory_key = "local.reclaim-idle-memory"; // idem
+constexpr auto memory_merging_key = "local.memory-merging";      // idem
+constexpr auto idle_suspend_key = "local.idle-suspend-after";     // idem
+constexpr auto cpu_limit_key = "local.cpu-reservation-limit";       // idem
+constexpr auto memory_limit_key = "local.memory-reservation-limit"; // idem
+constexpr auto parallel_boots_key = "local.max-parallel-boots";     // idem
+constexpr auto image_mirror_key = "local.image-mirror";           // idem
+constexpr auto image_mirror_port_key = "local.image-mirror-port"; // idem
+constexpr auto image_mirror_address_key = "local.image-mirror-address"; // idem
+constexpr auto cloud_image_mirrors_key = "local.cloud-image-mirrors"; // idem
+constexpr auto compress_images_key = "local.compress-images";     // idem
+constexpr auto storage_pools_key = "local.storage-pools";         // idem
+constexpr auto image_pool_key = "local.image-pool";               // idem
+constexpr auto libvirt_pool_key = "local.libvirt-storage-pool";   // idem
+constexpr auto federation_key = "local.federation";               // idem
+constexpr auto download_limit_key = "local.download-limit";       // idem
+constexpr auto package_cache_port_key = "local.package-cache-port"; // idem
+constexpr auto cloud_init_datasource_port_key = "local.cloud-init-datasource-port"; // idem
 constexpr auto autostart_key = "client.gui.autostart"; // idem
 constexpr auto winterm_key = "client.apps.windows-terminal.profiles"; // idem
 constexpr auto hotkey_key = "client.gui.hotkey";                      // idem
@@ -64,6 +86,21 @@ constexpr auto hotkey_key = "client.gui.hotkey";                      // idem
 constexpr auto key_examples = {autostart_key, driver_key, mounts_key};
 
 constexpr auto petenv_default = "primary";
+constexpr auto mount_cache_default = "0"; // cached attributes per mount; 0 disables the cache
+constexpr auto metrics_interval_default = "30"; // seconds between instance metrics refreshes; 0 collects on demand
+constexpr auto warm_pool_size_default = "0";    // suspended instances kept ready per launch profile; 0 disables
+constexpr auto reclaim_memory_default = "false"; // whether to balloon away the memory that instances leave unused
+constexpr auto memory_merging_default = "false"; // whether to have the host merge identical pages across instances
+constexpr auto idle_suspend_default = "0";        // minutes instances may sit idle before being suspended; 0 never
+constexpr auto cpu_limit_default = "0";      // percent of the host's CPUs that running instances may take; 0 no limit
+constexpr auto memory_limit_default = "0";   // percent of the host's memory that running instances may take; idem
+constexpr auto parallel_boots_default = "0"; // instances that may boot at once, host-wide; idem
+constexpr auto download_limit_default = "0"; // KiB per second that downloads of images may take together; idem
+constexpr auto image_mirror_port_default = "0";  // port to serve images to peer daemons on; 0 serves none
+constexpr auto image_mirror_address_default = "127.0.0.1"; // address to serve images on; loopback serves this host only
+constexpr auto package_cache_port_default = "0"; // port to serve packages to instances on; idem
+constexpr auto cloud_init_datasource_port_default = "0"; // port to serve instances' cloud-init data on; 0 uses ISOs
+constexpr auto compress_images_default = "false"; // whether to keep cached images compressed, where backends can
 constexpr auto hotkey_default = "Ctrl+Alt+U";                         // idem; translates to Cmd+Opt+U on macOS
 
 constexpr auto timeout_exit_code = 5;
@@ -23,6 +23,9 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <Poco/Zip/ZipLocalFileHeader.h>
+
+#include <QByteArray>
 #include <QDir>
 #include <QString>
 #include <QSysInfo>
@@ -56,13 +59,16 @@ public:
 private:
     void fetch_blueprints();
     void update_blueprints();
+    YAML::Node& blueprint_config_for(const std::string& blueprint_name); // throws std::out_of_range if unknown
 
     const QUrl blueprints_url;
     URLDownloader* const url_downloader;
     const QString archive_file_path;
     const std::chrono::milliseconds blueprints_ttl;
     std::chrono::steady_clock::time_point last_update;
-    std::map<std::string, YAML::Node> blueprint_map;
+    QByteArray archive_hash; // of what blueprint_index was built from, for unchanged downloads to keep it
+    std::map<std::string, Poco::Zip::ZipLocalFileHeader> blueprint_index;
+    std::map<std::string, YAML::Node> blueprint_map; // parsed on first use
     bool needs_update{true};
     const QString arch;
 };
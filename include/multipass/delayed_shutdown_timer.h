@@ -35,8 +35,12 @@ class DelayedShutdownTimer : public QObject
 
 public:
     using StopMounts = std::function<void(const std::string&)>;
+    using Notify = std::function<void(const std::string& message)>; // for the users of the instance
+    using Shutdown = std::function<void(VirtualMachine&)>;
     DelayedShutdownTimer(VirtualMachine* virtual_machine, optional<SSHSession>&& session,
                          const StopMounts& stop_mounts);
+    // Leaves the messages and the shutdown itself to the caller, which may do them elsewhere and together with others
+    DelayedShutdownTimer(VirtualMachine* virtual_machine, const Notify& notify, const Shutdown& shutdown);
     ~DelayedShutdownTimer();
 
     void start(const std::chrono::milliseconds delay);
@@ -47,11 +51,13 @@ signals:
 
 private:
     void shutdown_instance();
+    void tell_users(const std::chrono::minutes& time_left);
 
     QTimer shutdown_timer;
     VirtualMachine* virtual_machine;
     optional<SSHSession> ssh_session;
-    const StopMounts stop_mounts;
+    const Notify notify; // when there is no session of its own
+    const Shutdown shutdown;
     std::chrono::milliseconds delay;
     std::chrono::milliseconds time_remaining;
 };
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_DOWNLOAD_SCHEDULER_H
+#define MULTIPASS_DOWNLOAD_SCHEDULER_H
+
+#include "disabled_copy_move.h"
+
+#include <QString>
+#include <QtGlobal>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class QUrl;
+
+namespace multipass
+{
+enum class DownloadPriority
+{
+    interactive,
+    background
+};
+
+/**
+ * Shares out what downloads may take of the network. Transfers from the same host are bounded, and wait their turn
+ * past that, interactive ones ahead of background ones. With a rate limit, transfers are paced by a token bucket that
+ * holds a second's worth of bytes. While interactive transfers run, background ones only draw from the bucket when it
+ * is more than half full, so that they get what the interactive ones leave, and no more.
+ */
+class DownloadScheduler : private DisabledCopyMove
+{
+public:
+    // Downloads started on this thread while the scope lasts go at its priority, and at interactive priority otherwise
+    class PriorityScope : private DisabledCopyMove
+    {
+    public:
+        explicit PriorityScope(DownloadPriority priority);
+        ~PriorityScope();
+
+    private:
+        const DownloadPriority previous;
+    };
+
+    // A transfer under way, which makes room for the next one from its host when it goes away
+    class Transfer : private DisabledCopyMove
+    {
+    public:
+        ~Transfer();
+
+        void pace(qint64 bytes); // blocks for as long as the rate limit calls for, after reading that many bytes
+
+    private:
+        friend class DownloadScheduler;
+        Transfer(DownloadScheduler& scheduler, const QString& host, DownloadPriority priority);
+
+        DownloadScheduler& scheduler;
+        const QString host;
+        const DownloadPriority priority;
+    };
+
+    static constexpr int default_max_transfers_per_host = 4;
+
+    explicit DownloadScheduler(int max_transfers_per_host = default_max_transfers_per_host);
+
+    static DownloadPriority current_priority();
+
+    void set_rate_limit(qint64 bytes_per_second); // 0 for no limit
+    std::unique_ptr<Transfer> start(const QUrl& url); // blocks until the host has room, at the current priority
+
+private:
+    void pace(qint64 bytes, DownloadPriority priority);
+    void refill(); // under the mutex
+
+    const int max_transfers_per_host;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<QString, int> transfers; // by host
+    std::map<QString, int> interactive_waiting; // idem
+    int interactive_transfers{0};
+    qint64 rate{0};
+    double tokens{0};
+    std::chrono::steady_clock::time_point refilled_at{std::chrono::steady_clock::now()};
+};
+} // namespace multipass
+
+#endif // MULTIPASS_DOWNLOAD_SCHEDULER_H
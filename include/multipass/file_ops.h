@@ -28,6 +28,7 @@
 #include <QTextStream>
 
 #include <fstream>
+#include <vector>
 
 #define MP_FILEOPS multipass::FileOps::instance()
 
@@ -38,17 +39,50 @@ class FileOps : public Singleton<FileOps>
 public:
     FileOps(const Singleton<FileOps>::PrivatePass&) noexcept;
 
+    // How a range of a file is going to be read, for the kernel to read ahead or drop its pages accordingly
+    enum class Access
+    {
+        normal,
+        sequential,
+        random,
+        will_need,
+        dont_need
+    };
+
+    // A positional read or write, to go to the disk along with others
+    struct Transfer
+    {
+        QFile* file;
+        char* data;
+        qint64 size;
+        qint64 pos;
+        qint64 result{-1}; // as from read_at or write_at
+    };
+
     // QDir operations
     virtual bool isReadable(const QDir& dir) const;
     virtual bool mkpath(const QDir& dir, const QString& dirName) const;
     virtual bool rmdir(QDir& dir, const QString& dirName) const;
 
     // QFile operations
+    virtual bool advise(QFile& file, qint64 pos, qint64 len, Access access) const;
+    virtual bool allocate(QFile& file, qint64 pos, qint64 len) const;
+    virtual bool clone(QFile& source, QFile& destination) const;
     virtual bool exists(const QFile& file) const;
     virtual bool is_open(const QFile& file) const;
+    virtual bool copy(const QString& source, const QString& destination) const;
+    virtual qint64 copy_range(QFile& source, qint64 source_pos, QFile& destination, qint64 destination_pos,
+                              qint64 len) const;
+    virtual bool hard_link(const QString& target, const QString& link_name) const;
+    virtual uchar* map(QFile& file, qint64 pos, qint64 len) const;
+    virtual qint64 next_data(QFile& file, qint64 pos) const;
+    virtual qint64 next_hole(QFile& file, qint64 pos) const;
     virtual bool open(QFileDevice& file, QIODevice::OpenMode mode) const;
     virtual QFileDevice::Permissions permissions(const QFile& file) const;
+    virtual bool punch_hole(QFile& file, qint64 pos, qint64 len) const;
     virtual qint64 read(QFile& file, char* data, qint64 maxSize) const;
+    virtual qint64 read_at(QFile& file, char* data, qint64 maxSize, qint64 pos) const;
+    virtual void read_batch(std::vector<Transfer>& reads) const;
     virtual QByteArray read_all(QFile& file) const;
     virtual QString read_line(QTextStream& text_stream) const;
     virtual bool remove(QFile& file) const;
@@ -57,7 +91,11 @@ public:
     virtual bool seek(QFile& file, qint64 pos) const;
     virtual bool setPermissions(QFile& file, QFileDevice::Permissions permissions) const;
     virtual qint64 size(QFile& file) const;
+    virtual bool sync(QFile& file) const;
+    virtual bool unmap(QFile& file, uchar* address) const;
     virtual qint64 write(QFile& file, const char* data, qint64 maxSize) const;
+    virtual qint64 write_at(QFile& file, const char* data, qint64 maxSize, qint64 pos) const;
+    virtual void write_batch(std::vector<Transfer>& writes) const;
     virtual qint64 write(QFileDevice& file, const QByteArray& data) const;
 
     // QSaveFile operations
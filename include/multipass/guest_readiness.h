@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_GUEST_READINESS_H
+#define MULTIPASS_GUEST_READINESS_H
+
+#include "disabled_copy_move.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace multipass
+{
+/**
+ * Milestones the guest announces itself, through hooks that Multipass installs with its cloud-init vendor data, on
+ * backends that can carry them. Waiting on these replaces most of the probing while an instance comes up.
+ */
+class GuestReadiness : private DisabledCopyMove
+{
+public:
+    enum class Milestone
+    {
+        booting,    // the hooks are in place in this boot, so the guest will announce the other milestones
+        ssh_up,     // sshd has started
+        initialized // cloud-init has run its final stage
+    };
+    static constexpr std::array<Milestone, 3> all_milestones{Milestone::booting, Milestone::ssh_up,
+                                                             Milestone::initialized};
+
+    // The name of the virtio-serial port that the guest opens to announce a milestone
+    static std::string port_for(Milestone milestone);
+
+    void set_offered(bool offered); // for backends that can carry the announcements
+    bool is_offered() const;
+
+    void reach(Milestone milestone);
+    void reset(); // for when the guest (re)boots or goes away; wakes up whoever is waiting
+    bool reached(Milestone milestone) const;
+
+    // Returns whether the milestone was reached, stopping early if the guest resets in the meantime
+    bool wait_for(Milestone milestone, std::chrono::milliseconds timeout) const;
+
+private:
+    mutable std::mutex mutex;
+    mutable std::condition_variable cv;
+    bool offered{false};
+    unsigned boots{0};
+    std::set<Milestone> milestones;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_GUEST_READINESS_H
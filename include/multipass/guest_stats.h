@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_GUEST_STATS_H
+#define MULTIPASS_GUEST_STATS_H
+
+#include "optional.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace multipass
+{
+struct BlockDeviceStats
+{
+    std::string device;
+    long long read_bytes{0};
+    long long written_bytes{0};
+    long long read_operations{0};
+    long long write_operations{0};
+};
+
+// What the hypervisor itself can tell of a running guest, without going into it
+struct GuestStats
+{
+    optional<long long> balloon_bytes; // the memory the guest is left with, when it has a balloon
+    std::vector<BlockDeviceStats> block_devices;
+    optional<long long> cpu_time_ms;            // of the hypervisor's process on the host, since it started
+    optional<long long> resident_bytes;         // likewise
+    optional<long long> network_received_bytes; // by the guest, over the link the host gave it
+    optional<long long> network_sent_bytes;
+};
+
+// What a guest agent reports from inside a running guest; whatever the agent cannot tell is left out
+struct GuestMetrics
+{
+    optional<std::array<double, 3>> load; // averaged over 1, 5 and 15 minutes
+    optional<long long> memory_usage;     // bytes, like the rest
+    optional<long long> memory_total;
+    optional<long long> disk_usage; // of the root filesystem
+    optional<long long> disk_total;
+    std::string current_release;
+    std::vector<std::string> ipv4; // of global scope
+};
+} // namespace multipass
+
+#endif // MULTIPASS_GUEST_STATS_H
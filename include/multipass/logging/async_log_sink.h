@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_ASYNC_LOG_SINK_H
+#define MULTIPASS_ASYNC_LOG_SINK_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace multipass
+{
+namespace logging
+{
+/**
+ * Hands log lines over to a thread of its own that writes them out, so that those logging never wait on where the
+ * lines go (e.g. a client's slow connection).
+ *
+ * The thread only starts with the first line. Once max_queued lines are waiting, further lines are either dropped
+ * (their number is written once the writing catches up) or the caller waits for room, as the overflow policy says.
+ */
+class AsyncLogSink : private DisabledCopyMove
+{
+public:
+    enum class Overflow
+    {
+        drop,
+        block
+    };
+    using WriteLine = std::function<void(const std::string& line)>;
+
+    static constexpr std::size_t default_max_queued = 1000;
+
+    // The destination only identifies the sink for close_all_for
+    AsyncLogSink(const void* destination, WriteLine write_line, Overflow overflow = Overflow::drop,
+                 std::size_t max_queued = default_max_queued);
+    ~AsyncLogSink();
+
+    void push(std::string line);
+
+    // Writes out what is queued and drops anything pushed later; nothing is written once this returns
+    void close();
+
+    // Closes every sink writing to the destination, before it goes away
+    static void close_all_for(const void* destination);
+
+    struct Queue; // shared with the writing thread and with close_all_for, which may outlive the sink
+
+private:
+    const void* const destination;
+    const std::shared_ptr<Queue> queue;
+};
+} // namespace logging
+} // namespace multipass
+
+#endif // MULTIPASS_ASYNC_LOG_SINK_H
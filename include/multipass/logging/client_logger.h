@@ -18,6 +18,7 @@
 #ifndef MULTIPASS_CLIENT_LOGGER_H
 #define MULTIPASS_CLIENT_LOGGER_H
 
+#include <multipass/logging/async_log_sink.h>
 #include <multipass/logging/logger.h>
 #include <multipass/logging/multiplexing_logger.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
@@ -34,9 +35,23 @@ class ClientLogger : public Logger
 {
 public:
     ClientLogger(Level level, MultiplexingLogger& mpx, grpc::ServerWriterInterface<T>* server)
-        : logging_level{level}, server{server}, mpx_logger{mpx}
+        : ClientLogger{level, mpx, server, {}}
     {
-        mpx_logger.add_logger(this);
+    }
+
+    // Scoped to the categories of the request, such as the instances it is about; see MultiplexingLogger::add_logger
+    ClientLogger(Level level, MultiplexingLogger& mpx, grpc::ServerWriterInterface<T>* server,
+                 const std::vector<std::string>& categories)
+        : logging_level{level},
+          server{server},
+          mpx_logger{mpx},
+          sink{server, [server](const std::string& line) {
+                   T reply;
+                   reply.set_log_line(line);
+                   server->Write(reply);
+               }}
+    {
+        mpx_logger.add_logger(this, categories);
     }
 
     ~ClientLogger()
@@ -46,19 +61,22 @@ public:
 
     void log(Level level, CString category, CString message) const override
     {
+        // Written on the sink's thread, so that those logging never wait on the client's connection
         if (level <= logging_level && server != nullptr)
-        {
-            T reply;
-            reply.set_log_line(fmt::format("[{}] [{}] [{}] {}\n", timestamp(), as_string(level).c_str(),
-                                           category.c_str(), message.c_str()));
-            server->Write(reply);
-        }
+            sink.push(fmt::format("[{}] [{}] [{}] {}\n", timestamp(), as_string(level).c_str(), category.c_str(),
+                                  message.c_str()));
+    }
+
+    Level max_logging_level() const override
+    {
+        return logging_level;
     }
 
 private:
     Level logging_level;
     grpc::ServerWriterInterface<T>* server;
     MultiplexingLogger& mpx_logger;
+    mutable AsyncLogSink sink;
 };
 } // namespace logging
 } // namespace multipass
@@ -22,6 +22,10 @@
 #include <multipass/logging/level.h>
 #include <multipass/logging/logger.h>
 
+#include <multipass/format.h>
+
+#include <utility>
+
 namespace multipass
 {
 namespace logging
@@ -30,6 +34,18 @@ void log(Level level, CString category, CString message);
 void set_logger(std::shared_ptr<Logger> logger);
 Level get_logging_level();
 Logger* get_logger(); // for tests, don't rely on it lasting
+
+// Whether any logger would take messages at this level; a lock-free check
+bool enabled(Level level);
+void refresh_enabled_level(); // for loggers whose accepted levels change after they are set
+
+// Formats the message only when some logger wants it, so that disabled levels cost no more than the check
+template <typename FormatString, typename Arg, typename... Args>
+void log(Level level, CString category, const FormatString& format, Arg&& arg, Args&&... args)
+{
+    if (enabled(level))
+        log(level, category, fmt::format(format, std::forward<Arg>(arg), std::forward<Args>(args)...));
+}
 } // namespace logging
 } // namespace multipass
 #endif // MULTIPASS_LOG_H
@@ -42,6 +42,10 @@ public:
     {
         return logging_level;
     };
+    virtual Level max_logging_level() const // the most verbose level this logger takes
+    {
+        return logging_level;
+    }
     static std::string timestamp()
     {
         auto time = QDateTime::currentDateTime();
@@ -22,6 +22,8 @@
 
 #include <memory>
 #include <shared_mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace multipass
@@ -33,13 +35,20 @@ class MultiplexingLogger : public Logger
 public:
     explicit MultiplexingLogger(UPtr system_logger);
     void log(Level level, CString category, CString message) const override;
+    Level max_logging_level() const override;
     void add_logger(const Logger* logger);
+    // A logger that hears about these categories (instances, usually), and about those that no such logger asks for,
+    // but not about the categories that other loggers ask for. Without categories, it hears about everything.
+    void add_logger(const Logger* logger, const std::vector<std::string>& categories);
     void remove_logger(const Logger* logger);
 
 private:
     UPtr system_logger;
     mutable std::shared_timed_mutex mutex;
-    std::vector<const Logger*> loggers;
+    std::vector<const Logger*> loggers;          // all of them
+    std::vector<const Logger*> unscoped_loggers; // the ones that hear about everything
+    // The others, by the categories they asked for
+    std::unordered_map<std::string, std::vector<const Logger*>> scoped_loggers;
 };
 } // namespace logging
 } // namespace multipass
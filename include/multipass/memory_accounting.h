@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_MEMORY_ACCOUNTING_H
+#define MULTIPASS_MEMORY_ACCOUNTING_H
+
+#include "optional.h"
+
+#include <QJsonObject>
+#include <QString>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+class VMImageInfo;
+
+namespace utils
+{
+// Where Linux tells how much memory this process has, in pages
+constexpr auto self_statm_file = "/proc/self/statm";
+
+struct ProcessMemory
+{
+    long long resident_pages;
+    long long page_size;
+
+    long long resident_bytes() const
+    {
+        return resident_pages * page_size;
+    }
+};
+
+// Empty where the kernel does not tell
+optional<ProcessMemory> process_memory(const QString& statm_file = self_statm_file);
+
+// Rough figures of what these hold on the heap: contents and containers, but not what the allocator adds on top
+std::size_t estimated_size(const QString& string);
+std::size_t estimated_size(const VMImageInfo& info);
+std::size_t estimated_size(const QJsonObject& object);
+
+/**
+ * What the daemon holds in memory, as much as it can tell: the resident set of the whole process, next to estimates of
+ * what its larger caches take. Whatever the estimates do not cover (gRPC buffers, allocator overhead, the libraries
+ * themselves) is what is left of the resident set.
+ */
+struct MemoryAccount
+{
+    optional<ProcessMemory> process;
+    std::vector<std::pair<std::string, std::size_t>> estimates; // in bytes, by component
+
+    std::string summary() const; // on a single line, for logs
+};
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_MEMORY_ACCOUNTING_H
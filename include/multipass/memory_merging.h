@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_MEMORY_MERGING_H
+#define MULTIPASS_MEMORY_MERGING_H
+
+#include "optional.h"
+
+#include <QDir>
+
+namespace multipass
+{
+namespace utils
+{
+// Where Linux exposes kernel samepage merging (KSM), which merges identical pages that processes mark as mergeable
+constexpr auto ksm_sysfs_dir = "/sys/kernel/mm/ksm";
+
+struct MemoryMergingStats
+{
+    bool running;
+    long long pages_shared;   // the pages that merged ones now point at
+    long long pages_sharing;  // the pages merged into those, i.e. the ones saved
+    long long pages_unshared; // mergeable pages that are unique so far
+    long long page_size;
+
+    long long saved_bytes() const
+    {
+        return pages_sharing * page_size;
+    }
+};
+
+/**
+ * Start KSM and have it scan fast enough to keep up with hosts packed with instances from the same images, whose guest
+ * memory QEMU marks mergeable. Returns false when the host has no KSM or does not let us tune it, leaving it as it was.
+ */
+bool enable_memory_merging(const QDir& ksm_dir = QDir{ksm_sysfs_dir});
+
+// Empty on hosts without KSM
+optional<MemoryMergingStats> memory_merging_stats(const QDir& ksm_dir = QDir{ksm_sysfs_dir});
+
+// The host's physical memory, for how much instances overcommit it; 0 where that cannot be told
+long long host_memory_bytes();
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_MEMORY_MERGING_H
@@ -34,6 +34,7 @@ public:
 
     MemorySize();
     explicit MemorySize(const std::string& val);
+    static MemorySize from_bytes(long long value) noexcept;
     long long in_bytes() const noexcept;
     long long in_kilobytes() const noexcept;
     long long in_megabytes() const noexcept;
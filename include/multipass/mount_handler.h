@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_MOUNT_HANDLER_H
+#define MULTIPASS_MOUNT_HANDLER_H
+
+#include "disabled_copy_move.h"
+#include "id_mappings.h"
+
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace multipass
+{
+class VirtualMachine;
+
+/*
+ * A way of making host directories available inside instances. SSHFS mounts work everywhere, while backends may offer
+ * their own, faster file sharing.
+ */
+class MountHandler : private DisabledCopyMove
+{
+public:
+    using UPtr = std::unique_ptr<MountHandler>;
+
+    struct Mount
+    {
+        std::string source_path;
+        std::string target_path;
+        id_mappings gid_mappings;
+        id_mappings uid_mappings;
+        std::string profile;
+    };
+    using Failures = std::map<std::string, std::exception_ptr>; // by target path
+
+    virtual ~MountHandler() = default;
+
+    virtual void start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
+                             const id_mappings& gid_mappings, const id_mappings& uid_mappings,
+                             const std::string& profile) = 0;
+
+    // One after the other by default, handlers that can overlap the work of several mounts do so
+    virtual Failures start_mounts(VirtualMachine* vm, const std::vector<Mount>& mounts)
+    {
+        Failures failures;
+        for (const auto& mount : mounts)
+        {
+            try
+            {
+                start_mount(vm, mount.source_path, mount.target_path, mount.gid_mappings, mount.uid_mappings,
+                            mount.profile);
+            }
+            catch (...)
+            {
+                failures.emplace(mount.target_path, std::current_exception());
+            }
+        }
+
+        return failures;
+    }
+
+    virtual bool stop_mount(const std::string& instance, const std::string& path) = 0;
+    virtual void stop_all_mounts_for_instance(const std::string& instance) = 0;
+    virtual bool has_instance_already_mounted(const std::string& instance, const std::string& path) const = 0;
+
+protected:
+    MountHandler() = default;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_MOUNT_HANDLER_H
@@ -18,10 +18,18 @@
 #ifndef MULTIPASS_NETWORK_ACCESS_MANAGER_H
 #define MULTIPASS_NETWORK_ACCESS_MANAGER_H
 
+#include <QLocalSocket>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class QThread;
 
 namespace multipass
 {
@@ -33,10 +41,27 @@ public:
     using UPtr = std::unique_ptr<NetworkAccessManager>;
 
     NetworkAccessManager(QObject* parent = nullptr);
+    ~NetworkAccessManager() override;
 
 protected:
     QNetworkReply* createRequest(Operation op, const QNetworkRequest& orig_request,
                                  QIODevice* outgoingData = nullptr) override;
+
+private:
+    struct IdleSocket
+    {
+        std::unique_ptr<QLocalSocket> socket;
+        std::chrono::steady_clock::time_point since;
+    };
+    // Sockets deliver their signals to the thread they live in, so each thread reuses only the connections it opened
+    using PoolKey = std::pair<QThread*, QString>;
+
+    std::unique_ptr<QLocalSocket> take_idle_socket(const QString& socket_path);
+    void keep_idle_socket(const QString& socket_path, std::unique_ptr<QLocalSocket> socket);
+    void drop_idle_sockets(QThread* thread);
+
+    std::mutex idle_mutex;
+    std::map<PoolKey, std::vector<IdleSocket>> idle_sockets;
 };
 } // namespace multipass
 
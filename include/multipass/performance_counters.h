@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_PERFORMANCE_COUNTERS_H
+#define MULTIPASS_PERFORMANCE_COUNTERS_H
+
+#include "singleton.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#define MP_PERF_COUNTERS multipass::PerformanceCounters::instance()
+
+namespace multipass
+{
+/**
+ * Counters, gauges and latency histograms about how the daemon performs, for the `metrics` RPC to report in the
+ * OpenMetrics text format. Families are named without the `_total` suffix that counter samples get.
+ */
+class PerformanceCounters : public Singleton<PerformanceCounters>
+{
+public:
+    using Labels = std::map<std::string, std::string>;
+    using Counter = std::atomic<std::uint64_t>;
+
+    PerformanceCounters(const Singleton<PerformanceCounters>::PrivatePass&) noexcept;
+
+    // The counter stays put for as long as the process runs, so hot paths can look it up once and keep adding to it
+    Counter& counter(const std::string& family, const Labels& labels);
+    void observe(const std::string& family, const Labels& labels, std::chrono::duration<double> duration);
+    void set(const std::string& gauge_family, const Labels& labels, double value);
+
+    std::string openmetrics() const;
+
+private:
+    static constexpr std::array<double, 12> bucket_bounds{0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300};
+
+    struct Histogram
+    {
+        std::array<std::uint64_t, bucket_bounds.size()> buckets{}; // each counts what falls within its own bound
+        double sum{0};
+        std::uint64_t count{0};
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::map<std::string, Counter>> counters; // by family, then by rendered labels
+    std::map<std::string, std::map<std::string, double>> gauges;
+    std::map<std::string, std::map<std::string, Histogram>> histograms;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_PERFORMANCE_COUNTERS_H
@@ -88,7 +88,9 @@ logging::Logger::UPtr make_logger(logging::Level level);
 UpdatePrompt::UPtr make_update_prompt();
 std::unique_ptr<Process> make_sshfs_server_process(const SSHFSServerConfig& config);
 std::unique_ptr<Process> make_process(std::unique_ptr<ProcessSpec>&& process_spec);
+void update_resource_limits(const QString& cgroup, const VMResourceLimits& limits); // of those made above, in @p cgroup
 int symlink_attr_from(const char* path, sftp_attributes_struct* attr);
+int symlink_attr_from(int dir_fd, const char* name, sftp_attributes_struct* attr); // name relative to dir_fd
 bool is_image_url_supported();
 
 std::function<int()> make_quit_watchdog(); // call while single-threaded; call result later, in dedicated thread
@@ -21,6 +21,7 @@
 #include <multipass/process/process.h>
 #include <multipass/process/process_spec.h>
 
+#include <chrono>
 #include <memory>
 
 namespace multipass
@@ -84,6 +85,7 @@ private:
     void handle_started();
     void run_and_wait_until_finished(const int timeout);
     qint64 pid = 0;
+    std::chrono::steady_clock::time_point start_time;
 };
 
 } // namespace multipass
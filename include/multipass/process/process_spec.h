@@ -22,6 +22,7 @@
 #include <QString>
 
 #include <multipass/logging/level.h>
+#include <multipass/vm_resource_limits.h>
 
 namespace multipass
 {
@@ -42,6 +43,9 @@ public:
     virtual QString apparmor_profile() const = 0;
     const QString apparmor_profile_name() const;
     virtual QString identifier() const;
+
+    virtual QString cgroup() const;
+    virtual VMResourceLimits resource_limits() const;
 };
 
 } // namespace multipass
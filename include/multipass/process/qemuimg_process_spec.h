@@ -29,7 +29,9 @@ namespace multipass
 class QemuImgProcessSpec : public ProcessSpec
 {
 public:
-    explicit QemuImgProcessSpec(const QStringList& args, const QString& source_image, const QString& target_image = {});
+    // backing_images are the ones source_image reads through, which qemu-img may then read too
+    explicit QemuImgProcessSpec(const QStringList& args, const QString& source_image, const QString& target_image = {},
+                                const QStringList& backing_images = {});
 
     QString program() const override;
     QStringList arguments() const override;
@@ -40,6 +42,7 @@ private:
     const QStringList args;
     const QString source_image;
     const QString target_image;
+    const QStringList backing_images;
 };
 
 } // namespace multipass
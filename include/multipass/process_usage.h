@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef MULTIPASS_PROCESS_USAGE_H
+#define MULTIPASS_PROCESS_USAGE_H
+
+#include "optional.h"
+
+#include <QDir>
+#include <QtGlobal>
+
+namespace multipass
+{
+namespace utils
+{
+constexpr auto procfs_dir = "/proc";
+
+// What a host process has used so far, as the kernel accounts for it
+struct ProcessUsage
+{
+    long long cpu_ticks; // in user and system mode, over all its threads
+    long long ticks_per_second;
+    long long resident_pages;
+    long long page_size;
+
+    long long cpu_time_ms() const
+    {
+        return cpu_ticks * 1000 / ticks_per_second;
+    }
+
+    long long resident_bytes() const
+    {
+        return resident_pages * page_size;
+    }
+};
+
+// Empty where there is no procfs, or once the process is gone
+optional<ProcessUsage> process_usage(qint64 pid, const QDir& proc_dir = QDir{procfs_dir});
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_PROCESS_USAGE_H
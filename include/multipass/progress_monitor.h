@@ -20,10 +20,28 @@
 #ifndef MULTIPASS_PROGRESS_MONITOR_H
 #define MULTIPASS_PROGRESS_MONITOR_H
 
+#include <chrono>
 #include <functional>
+#include <vector>
 
 namespace multipass
 {
 using ProgressMonitor = std::function<bool(int download_type, int progress)>;
-}
+
+/**
+ * Wraps @p monitor so that it hears of a type of progress when it starts and of the last percent, and otherwise of a
+ * changed percentage no more than once every @p interval. Unknown progress (negative) is passed on once every interval
+ * too, to show that something is happening. Calls that are not passed on return what the last one passed on did, so
+ * that aborts are still seen. Copies share what was passed on, for all the sources of an operation to share one.
+ */
+ProgressMonitor coalesced(ProgressMonitor monitor, std::chrono::milliseconds interval);
+
+/**
+ * For sources that make progress side by side to report as one, through @p monitor, as @p type. Returns a monitor for
+ * each of @p weights, which passes on the weighted average of what each source reported last, whatever the type they
+ * report as, when that changes. Unknown progress (negative) counts as no change. Once @p monitor returns false, all of
+ * them do, for every source to stop. They may be called from different threads.
+ */
+std::vector<ProgressMonitor> combined(ProgressMonitor monitor, int type, const std::vector<int>& weights);
+} // namespace multipass
 #endif // MULTIPASS_PROGRESS_MONITOR_H
@@ -38,6 +38,7 @@ public:
     std::string remote_name;
     Type query_type;
     bool allow_unsupported{false};
+    std::string storage_location; // directory of the storage pool to keep an instance image in; the vault's when empty
 };
 }
 #endif // MULTIPASS_QUERY_H
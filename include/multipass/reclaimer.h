@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_RECLAIMER_H
+#define MULTIPASS_RECLAIMER_H
+
+#include <QDir>
+#include <QString>
+
+namespace multipass
+{
+namespace utils
+{
+/**
+ * Remove the directory at @p path without waiting on the filesystem to free what it holds. The directory is renamed to
+ * a hidden sibling right away, so that its name can be reused as soon as this returns, and then removed on a single
+ * background thread with idle I/O priority, where the platform has one. Should the rename fail, the directory is
+ * removed before returning, as it would not be safe to remove it by name later.
+ */
+void reclaim_in_background(const QString& path);
+
+// Queue what a previous run renamed in @p dir but did not get to remove
+void reclaim_leftovers(const QDir& dir);
+
+// Block until all that was queued so far is removed
+void wait_for_reclaimed();
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_RECLAIMER_H
@@ -21,6 +21,8 @@
 #include "setting_spec.h"
 #include "settings_handler.h"
 
+#include <QDateTime>
+
 #include <map>
 #include <mutex>
 
@@ -45,6 +47,11 @@ private:
     QString filename;
     SettingMap settings;
     mutable std::mutex mutex;
+
+    // What was read, for as long as the file stays as it was then, by its modification time and size
+    mutable std::map<QString, QString> cache;
+    mutable QDateTime cached_modified;
+    mutable qint64 cached_size = -1;
 };
 } // namespace multipass
 
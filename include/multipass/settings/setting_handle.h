@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SETTING_HANDLE_H
+#define MULTIPASS_SETTING_HANDLE_H
+
+#include "settings.h"
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/exceptions/settings_exceptions.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * A setting, read once and kept in memory as a @p T, for hot paths to do without looking it up by key, going through
+ * the handlers and converting it each time. It keeps up with what Settings::set changes, so it suits settings that
+ * only change through there while the process runs.
+ *
+ * Handles must outlive whatever sets their settings concurrently.
+ */
+template <typename T>
+class SettingHandle : private DisabledCopyMove
+{
+public:
+    using Callback = std::function<void(const T&)>;
+
+    SettingHandle(QString key, T fallback); // the fallback stands in while the setting cannot be read
+    ~SettingHandle();
+
+    T get() const;
+    void on_change(Callback callback); // called with the new value, from the thread that set it
+
+private:
+    void refresh();
+    T read(T fallback) const;
+
+    const QString key;
+    mutable std::mutex mutex;
+    T value;
+    std::vector<Callback> callbacks;
+    const Settings::Subscription subscription;
+};
+} // namespace multipass
+
+template <typename T>
+multipass::SettingHandle<T>::SettingHandle(QString key, T fallback)
+    : key{std::move(key)},
+      value{read(std::move(fallback))},
+      subscription{MP_SETTINGS.subscribe(this->key, [this] { refresh(); })}
+{
+}
+
+template <typename T>
+multipass::SettingHandle<T>::~SettingHandle()
+{
+    MP_SETTINGS.unsubscribe(subscription);
+}
+
+template <typename T>
+T multipass::SettingHandle<T>::get() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return value;
+}
+
+template <typename T>
+void multipass::SettingHandle<T>::on_change(Callback callback)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    callbacks.push_back(std::move(callback));
+}
+
+template <typename T>
+void multipass::SettingHandle<T>::refresh()
+{
+    auto fresh = read(get()); // as the handler interprets what was set
+    std::vector<Callback> to_call;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        value = fresh;
+        to_call = callbacks;
+    }
+
+    for (const auto& callback : to_call)
+        callback(fresh);
+}
+
+template <typename T>
+T multipass::SettingHandle<T>::read(T fallback) const
+{
+    try
+    {
+        return MP_SETTINGS.get_as<T>(key);
+    }
+    catch (const SettingsException&)
+    {
+        return fallback;
+    }
+}
+
+#endif // MULTIPASS_SETTING_HANDLE_H
@@ -26,6 +26,9 @@
 #include <QString>
 #include <QVariant>
 
+#include <functional>
+#include <map>
+#include <mutex>
 #include <set>
 
 #define MP_SETTINGS multipass::Settings::instance()
@@ -85,8 +88,22 @@ public:
     template <typename T>
     T get_as(const QString& key) const;
 
+    using Subscription = std::size_t;
+
+    /**
+     * Have @p callback called each time that @c set succeeds for @p key, from the thread that set it.
+     * @return What to unsubscribe with.
+     * @note SettingHandle builds typed values that keep up to date on this.
+     */
+    Subscription subscribe(const QString& key, std::function<void()> callback);
+    void unsubscribe(Subscription subscription); // no-op if not subscribed
+
 private:
     std::vector<std::unique_ptr<SettingsHandler>> handlers;
+
+    std::mutex subscriptions_mutex;
+    std::map<Subscription, std::pair<QString, std::function<void()>>> subscriptions;
+    Subscription next_subscription = 0;
 };
 } // namespace multipass
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SHA256_H
+#define MULTIPASS_SHA256_H
+
+#include "disabled_copy_move.h"
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include <memory>
+
+struct evp_md_ctx_st;
+
+namespace multipass
+{
+/**
+ * SHA-256 through OpenSSL, which uses the CPU's own instructions for it (SHA-NI, ARMv8 crypto extensions) where it has
+ * them, rather than the portable implementation of QCryptographicHash. Hashing an image goes as fast as it is read.
+ */
+class Sha256 : private DisabledCopyMove
+{
+public:
+    Sha256();
+
+    void add_data(const char* data, qint64 size);
+    void add_data(const QByteArray& data);
+
+    // Reads @p device to its end in large buffers, the next read going on while the last is hashed; false on errors
+    bool add_data(QIODevice& device);
+
+    void reset();
+    QByteArray result() const; // the raw digest of all that was added so far, to which more can still be added
+
+private:
+    std::unique_ptr<evp_md_ctx_st, void (*)(evp_md_ctx_st*)> context;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_SHA256_H
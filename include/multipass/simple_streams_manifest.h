@@ -37,9 +37,14 @@ struct SimpleStreamsManifest
 {
     static std::unique_ptr<SimpleStreamsManifest> fromJson(const QByteArray& json, const QString& host_url);
 
+    // Looked up in products_by_id; the first product with that id when there are several, or null when there is none
+    const VMImageInfo* product_with_id(const QString& id) const;
+    std::vector<const VMImageInfo*> products_with_id_prefix(const QString& prefix) const;
+
     const QString updated_at;
     const std::vector<VMImageInfo> products;
     const QMap<QString, const VMImageInfo*> image_records;
+    const std::vector<const VMImageInfo*> products_by_id; // sorted by id, so that ids alike are next to each other
 };
 }
 #endif // MULTIPASS_SIMPLE_STREAMS_MANIFEST_H
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SPARSE_FILE_H
+#define MULTIPASS_SPARSE_FILE_H
+
+#include <QFile>
+
+#include <cstddef>
+
+namespace multipass
+{
+namespace sparse
+{
+constexpr qint64 block_size = 4096;
+
+// Checks a vector register's worth of bytes at a time where the CPU has them
+bool is_all_zero(const char* data, std::size_t size);
+
+/**
+ * Writes a stream of bytes to @p file from its current position on, skipping over the blocks that are all zeros
+ * instead of writing them, so that they become holes on filesystems that have them. Only meant for where the file
+ * holds nothing yet: a new or truncated file, or one that was just resized to what it is going to hold.
+ */
+class Writer
+{
+public:
+    explicit Writer(QFile& file);
+
+    bool write(const char* data, qint64 size); // false on errors, which the file describes
+    bool finish();                             // extends the file over what was skipped at its end
+
+private:
+    QFile& file;
+    qint64 position;
+};
+} // namespace sparse
+} // namespace multipass
+
+#endif // MULTIPASS_SPARSE_FILE_H
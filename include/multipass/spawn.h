@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SPAWN_H
+#define MULTIPASS_SPAWN_H
+
+#include <multipass/process/process.h>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace multipass
+{
+namespace utils
+{
+struct SpawnOptions
+{
+    int timeout = 30000;         // in ms, after which the process is killed
+    QByteArray standard_input;   // written to the process, whose input is then closed
+    bool merge_channels = false; // standard error goes to standard output
+};
+
+struct SpawnResult
+{
+    ProcessState state;
+    QByteArray standard_output;
+    QByteArray standard_error;
+};
+
+/**
+ * Run @p program to completion, without the event loop and signal plumbing of QProcess. Meant for short-lived,
+ * unconfined helpers: on POSIX systems, it goes through posix_spawn, which does not copy the page tables of a large
+ * daemon like fork does. The process is found in PATH, with the environment of the caller, and its spawn is accounted
+ * for like that of a BasicProcess.
+ */
+SpawnResult spawn_and_wait(const QString& program, const QStringList& arguments, const SpawnOptions& options = {});
+} // namespace utils
+} // namespace multipass
+
+#endif // MULTIPASS_SPAWN_H
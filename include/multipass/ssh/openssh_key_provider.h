@@ -23,6 +23,7 @@
 
 #include <QDir>
 #include <memory>
+#include <string>
 
 namespace multipass
 {
@@ -43,6 +44,7 @@ public:
 private:
     QDir ssh_key_dir;
     KeyUPtr priv_key;
+    std::string priv_key_base64; // read once, every ssh_info request hands it out
 };
 }
 #endif // MULTIPASS_OPENSSH_KEY_PROVIDER_H
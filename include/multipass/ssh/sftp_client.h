@@ -22,9 +22,14 @@
 
 #include <libssh/sftp.h>
 
+#include <QFileInfo>
+
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace multipass
 {
@@ -34,17 +39,32 @@ using SFTPSessionUPtr = std::unique_ptr<sftp_session_struct, void (*)(sftp_sessi
 class SFTPClient
 {
 public:
-    SFTPClient(const std::string& host, int port, const std::string& username, const std::string& priv_key_blob);
+    SFTPClient(const std::string& host, int port, const std::string& username, const std::string& priv_key_blob,
+               bool compression = false);
     SFTPClient(SSHSessionUPtr ssh_session);
 
     void push_file(const std::string& source_path, const std::string& destination_path);
     void pull_file(const std::string& source_path, const std::string& destination_path);
     void stream_file(const std::string& destination_path, std::istream& cin);
     void stream_file(const std::string& source_path, std::ostream& cout);
+    void push_dir(const std::string& source_path, const std::string& destination_path);
+    void pull_dir(const std::string& source_path, const std::string& destination_path);
+    bool is_dir(const std::string& path);
+
+    // Leaves out files whose destination has the same contents, and gives destinations the source's time
+    void set_sync(bool sync);
 
 private:
+    void push_file_to(const std::string& source_path, const std::string& full_destination_path);
+    void pull_file_to(const std::string& source_path, const std::string& full_destination_path);
+    void send_file(const std::string& source_path, const std::string& full_destination_path);
+    void receive_file(const std::string& source_path, const std::string& full_destination_path);
+    bool same_contents(const QFileInfo& local, const sftp_attributes_struct& remote, const std::string& remote_path);
+    std::vector<std::pair<std::string, uint8_t>> list_dir(const std::string& path);
+
     SSHSessionUPtr ssh_session;
     SFTPSessionUPtr sftp;
+    bool sync{false};
 };
 } // namespace multipass
 #endif // MULTIPASS_SFTP_CLIENT_H
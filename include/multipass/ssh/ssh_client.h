@@ -23,6 +23,7 @@
 
 #include <libssh/libssh.h>
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -37,22 +38,35 @@ class SSHClient
 public:
     using ChannelUPtr = std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)>;
     using ConsoleCreator = std::function<Console::UPtr(ssh_channel_struct*)>;
+    using OutputHandler = std::function<void(const char* data, std::size_t size, bool is_stderr)>;
 
     SSHClient(const std::string& host, int port, const std::string& username, const std::string& priv_key_blob,
               ConsoleCreator console_creator);
     SSHClient(SSHSessionUPtr ssh_session, ConsoleCreator console_creator);
 
+    // Interactive output goes out as soon as it arrives, bulk output is gathered into large writes
+    enum class OutputMode
+    {
+        interactive,
+        bulk
+    };
+    void set_output_mode(OutputMode mode);
+
     int exec(const std::vector<std::string>& args);
     int exec(const std::vector<std::vector<std::string>>& args_list);
+    // Hands the output over as it comes instead of wiring it to the terminal, for many clients to run side by side
+    int exec(const std::vector<std::vector<std::string>>& args_list, const OutputHandler& handler);
     void connect();
 
 private:
     void handle_ssh_events();
+    void request_exec(const std::string& cmd_line);
     int exec_string(const std::string& cmd_line);
 
     SSHSessionUPtr ssh_session;
     ChannelUPtr channel;
     Console::UPtr console;
+    OutputMode output_mode{OutputMode::interactive};
 };
 } // namespace multipass
 #endif // MULTIPASS_SSH_CLIENT_H
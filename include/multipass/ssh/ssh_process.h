@@ -23,8 +23,11 @@
 #include <libssh/libssh.h>
 
 #include <chrono>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace multipass
 {
@@ -32,12 +35,16 @@ class SSHProcess
 {
 public:
     using ChannelUPtr = std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)>;
+    // Gets each chunk as it is read, the data is only valid for the duration of the call
+    using ChunkHandler = std::function<void(const char* data, std::size_t size)>;
 
     SSHProcess(ssh_session ssh_session, const std::string& cmd);
 
     int exit_code(std::chrono::milliseconds timeout = std::chrono::seconds(5));
     std::string read_std_output();
     std::string read_std_error();
+    void read_std_output(const ChunkHandler& handler);
+    void read_std_error(const ChunkHandler& handler);
 
 private:
     enum class StreamType
@@ -46,13 +53,14 @@ private:
         err
     };
 
-    std::string read_stream(StreamType type, int timeout = -1);
+    void read_stream(StreamType type, const ChunkHandler& handler, int timeout = -1);
     ssh_channel release_channel();
 
     ssh_session session;
     const std::string cmd;
     ChannelUPtr channel;
     optional<int> exit_status;
+    std::vector<char> read_buffer; // allocated on the first read, then reused by every other
 
     friend class SftpServer;
 };
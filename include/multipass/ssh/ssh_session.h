@@ -25,6 +25,7 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace multipass
 {
@@ -32,19 +33,37 @@ class SSHKeyProvider;
 class SSHSession
 {
 public:
+    struct CommandResult
+    {
+        int exit_code;
+        std::string std_output;
+        std::string std_error;
+    };
+
     SSHSession(const std::string& host, int port, const std::chrono::milliseconds timeout = std::chrono::seconds(1));
     SSHSession(const std::string& host, int port, const std::string& ssh_username, const SSHKeyProvider& key_provider,
-               const std::chrono::milliseconds timeout = std::chrono::seconds(20));
+               const std::chrono::milliseconds timeout = std::chrono::seconds(20), bool compression = false);
 
     SSHProcess exec(const std::string& cmd);
 
+    /**
+     * Run @p cmds one after the other through a single channel, each in its own subshell, for a single round trip
+     * rather than one per command. A failing command does not stop the ones after it. Throws an SSHException when
+     * the batch itself cannot run or its output cannot be made sense of.
+     */
+    std::vector<CommandResult> exec_batch(const std::vector<std::string>& cmds,
+                                          std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+    // What the handshake settled on, out of MULTIPASS_SSH_CIPHERS or of the defaults for this host's CPU
+    std::string negotiated_cipher() const;
+
     void force_shutdown();
     operator ssh_session() const;
 
 private:
     SSHSession(const std::string& host, int port, const std::string& ssh_username, const SSHKeyProvider* key_provider);
     SSHSession(const std::string& host, int port, const std::string& ssh_username, const SSHKeyProvider* key_provider,
-               const std::chrono::milliseconds timeout = std::chrono::seconds(20));
+               const std::chrono::milliseconds timeout = std::chrono::seconds(20), bool compression = false);
     void set_option(ssh_options_e type, const void* value);
     std::unique_ptr<ssh_session_struct, void (*)(ssh_session)> session;
 };
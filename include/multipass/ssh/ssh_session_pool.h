@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SSH_SESSION_POOL_H
+#define MULTIPASS_SSH_SESSION_POOL_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/ssh/ssh_session.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+class SSHKeyProvider;
+
+/**
+ * Keeps authenticated sessions to the instances around, so that talking to an instance does not cost a handshake
+ * every time.
+ *
+ * A libssh session must not be used from two threads at once, so sessions are leased out exclusively. A lease puts its
+ * session back when it goes away, unless the session lost its connection or was taken out of the pool.
+ */
+class SSHSessionPool : private DisabledCopyMove
+{
+public:
+    class Lease
+    {
+    public:
+        Lease(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        SSHSession& operator*() const;
+        SSHSession* operator->() const;
+
+        SSHSession take(); // for sessions that are about to die with their instance, or that go to another owner
+
+    private:
+        friend class SSHSessionPool;
+        Lease(SSHSessionPool* pool, std::string instance, std::string endpoint, unsigned generation,
+              std::unique_ptr<SSHSession> session);
+
+        SSHSessionPool* pool;
+        std::string instance;
+        std::string endpoint;
+        unsigned generation;
+        std::unique_ptr<SSHSession> session;
+    };
+
+    explicit SSHSessionPool(const SSHKeyProvider& key_provider,
+                            std::chrono::seconds max_idle_time = std::chrono::seconds(60),
+                            std::size_t max_idle_per_instance = 2);
+
+    // Reuses an idle session that is still connected to the same endpoint, or opens a new one; throws if that fails
+    Lease acquire(const std::string& instance, const std::string& host, int port, const std::string& username);
+    void evict(const std::string& instance); // for when the instance changes state; leased sessions are not returned
+
+private:
+    struct IdleSession
+    {
+        std::string endpoint;
+        std::unique_ptr<SSHSession> session;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    void put_back(const std::string& instance, std::string endpoint, unsigned generation,
+                  std::unique_ptr<SSHSession> session);
+
+    const SSHKeyProvider& key_provider;
+    const std::chrono::seconds max_idle_time;
+    const std::size_t max_idle_per_instance;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<IdleSession>> idle_sessions;
+    std::unordered_map<std::string, unsigned> generations; // bumped on eviction, so that stale leases are dropped
+};
+} // namespace multipass
+
+#endif // MULTIPASS_SSH_SESSION_POOL_H
@@ -23,11 +23,16 @@
 
 #include <libssh/sftp.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <QFile>
 #include <QFileInfo>
+#include <QThreadPool>
 
 namespace multipass
 {
@@ -39,7 +44,8 @@ class SftpServer
 public:
     SftpServer(SSHSession&& ssh_session, const std::string& source, const std::string& target,
                const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid, int default_gid,
-               const std::string& sshfs_exec_line);
+               const std::string& sshfs_exec_line, int max_workers = 1, int attribute_cache_size = 0,
+               int max_read_size = 64 * 1024, int max_write_buffer_size = 256 * 1024, bool forward_changes = false);
     SftpServer(SftpServer&& other);
     ~SftpServer();
 
@@ -48,10 +54,21 @@ public:
 
     using SSHSessionUptr = std::unique_ptr<ssh_session_struct, decltype(ssh_free)*>;
     using SftpSessionUptr = std::unique_ptr<sftp_session_struct, decltype(sftp_free)*>;
+    using MessageUptr = std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
     using SSHFSProcUptr = std::unique_ptr<SSHProcess>;
 
 private:
+    class AttributeCache;
+    class ChangeForwarder;
+    class DirectoryStream;
+
     void process_message(sftp_client_message msg);
+    sftp_client_message next_message();
+    bool message_waiting();
+    std::unique_lock<std::mutex> lock_session();
+    bool concurrent() const;
+    void start_change_agent();
+    void send_changes();
     sftp_attributes_struct attr_from(const QFileInfo& file_info);
     int mapped_uid_for(const int uid);
     int mapped_gid_for(const int gid);
@@ -65,6 +82,7 @@ private:
     int handle_open(sftp_client_message msg);
     int handle_opendir(sftp_client_message msg);
     int handle_read(sftp_client_message msg);
+    int handle_reads(const std::vector<sftp_client_message>& msgs);
     int handle_readdir(sftp_client_message msg);
     int handle_readlink(sftp_client_message msg);
     int handle_realpath(sftp_client_message msg);
@@ -75,20 +93,57 @@ private:
     int handle_symlink(sftp_client_message msg);
     int handle_write(sftp_client_message msg);
     int handle_extended(sftp_client_message msg);
+    int handle_copy_data(sftp_client_message msg);
+    int handle_statvfs(sftp_client_message msg);
+    int handle_limits(sftp_client_message msg);
+
+    struct WriteBuffer
+    {
+        qint64 offset{0};
+        QByteArray data;
+        bool failed{false}; // a deferred write failed and the client was not told yet
+    };
+    struct ReadPattern
+    {
+        qint64 next{-1};   // where a sequential read would start
+        int sequential{0}; // reads in a row that started where the previous one ended
+        qint64 prefetched_until{0};
+    };
+    void track_read(void* id, QFile& file, qint64 offset, qint64 len);
+
+    bool flush_pending_write(QFile& file, WriteBuffer& buffer);
+    void flush_pending_writes();
+    void flush_pending_reads();
 
     SSHSession ssh_session;
     SSHFSProcUptr sshfs_process;
     SftpSessionUptr sftp_server_session;
     const std::string source_path;
     const std::string target_path;
-    std::unordered_map<void*, std::unique_ptr<QFileInfoList>> open_dir_handles;
+    std::unordered_map<void*, std::unique_ptr<DirectoryStream>> open_dir_handles;
     std::unordered_map<void*, std::unique_ptr<QFile>> open_file_handles;
-    const id_mappings gid_mappings;
-    const id_mappings uid_mappings;
+    std::vector<std::vector<char>> read_buffers;           // one for each read in a batch
+    std::vector<MessageUptr> pending_reads;                // held back, to go to the disk together
+    std::unordered_map<void*, WriteBuffer> pending_writes; // sequential writes coalesced per file handle
+    std::unordered_map<void*, ReadPattern> read_patterns;  // per file handle, to read ahead of sequential readers
+    std::unique_ptr<AttributeCache> attribute_cache;       // only when the host can report changes to the tree
+    std::unique_ptr<ChangeForwarder> change_forwarder;     // likewise, and only when asked to forward them
+    SSHFSProcUptr change_agent;                            // replays forwarded changes in the instance
+    const std::unordered_map<int, int> gid_map; // host to instance ids, built once from the mappings
+    const std::unordered_map<int, int> reverse_gid_map;
+    const std::unordered_map<int, int> uid_map;
+    const std::unordered_map<int, int> reverse_uid_map;
     const int default_uid;
     const int default_gid;
     const std::string sshfs_exec_line;
+    const int max_read_size;
+    const int max_write_buffer_size;
     bool stop_invoked{false};
+    std::mutex session_mutex; // serializes libssh calls when requests are handled concurrently
+    std::condition_variable session_released; // for when workers' replies went out, or their requests are done
+    std::atomic_int replies_waiting{0};
+    std::atomic_int requests_in_flight{0};
+    QThreadPool workers; // keep last, so that running requests finish before anything else goes away
 };
 } // namespace multipass
 #endif // MULTIPASS_SFTP_SERVER_H
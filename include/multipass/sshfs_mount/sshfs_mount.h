@@ -19,8 +19,11 @@
 #define MULTIPASS_SSHFS_MOUNT
 
 #include <multipass/id_mappings.h>
+#include <multipass/optional.h>
+#include <multipass/sshfs_mount/sshfs_mount_profile.h>
 
 #include <memory>
+#include <string>
 #include <thread>
 #include <unordered_map>
 
@@ -28,17 +31,36 @@ namespace multipass
 {
 class SSHSession;
 class SftpServer;
+
+// What mounting finds out about an instance, which holds for further mounts in it as long as it keeps running
+struct SshfsInstanceInfo
+{
+    std::string sshfs_exec;   // without options
+    std::string fuse_version; // empty if unknown
+    int uid{-1};              // of the default user
+    int gid{-1};
+
+    std::string serialise() const;
+    static optional<SshfsInstanceInfo> deserialise(const std::string& text);
+
+    // How sshfs_server reports it, on a line of its own before connecting
+    static constexpr auto output_prefix = "Instance: ";
+};
+
 class SshfsMount
 {
 public:
     SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-               const id_mappings& gid_mappings, const id_mappings& uid_mappings);
+               const id_mappings& gid_mappings, const id_mappings& uid_mappings, int attribute_cache_size = 0,
+               const std::string& profile = default_sshfs_mount_profile,
+               const optional<SshfsInstanceInfo>& known_info = nullopt);
     SshfsMount(SshfsMount&& other);
     ~SshfsMount();
 
     void stop();
 
 private:
+    SshfsInstanceInfo info;
     // sftp_server Doesn't need to be a pointer, but done for now to avoid bringing sftp.h
     // which has an error with -pedantic.
     std::unique_ptr<SftpServer> sftp_server;
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SSHFS_MOUNT_PROFILE_H
+#define MULTIPASS_SSHFS_MOUNT_PROFILE_H
+
+#include <string>
+
+namespace multipass
+{
+constexpr auto default_sshfs_mount_profile = "default";
+
+/*
+ * Tunings for the guest's sshfs and the host's SFTP server that only make sense together, e.g. the server answers
+ * reads as large as the guest asks for.
+ */
+struct SSHFSMountProfile
+{
+    int max_read;          // largest read the guest asks for, 0 to keep sshfs' own default
+    int max_write;         // largest write the guest sends, 0 to keep sshfs' own default
+    int write_buffer_size; // sequential writes the server coalesces before writing them out, in bytes
+    int cache_timeout;     // seconds the guest keeps attributes and directory entries
+    int sftp_workers;      // server threads answering path queries
+    bool forward_changes;  // whether changes made on the host raise file events in the instance
+};
+
+// Throws std::invalid_argument for names other than "default", "bulk" and "metadata-heavy"
+const SSHFSMountProfile& sshfs_mount_profile(const std::string& name);
+} // namespace multipass
+
+#endif // MULTIPASS_SSHFS_MOUNT_PROFILE_H
@@ -18,11 +18,13 @@
 #ifndef MULTIPASS_SSHFSMOUNTS_H
 #define MULTIPASS_SSHFSMOUNTS_H
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <unordered_map>
 
 #include <multipass/id_mappings.h>
+#include <multipass/mount_handler.h>
 #include <multipass/process/process.h>
 #include <multipass/qt_delete_later_unique_ptr.h>
 #include <multipass/ssh/ssh_key_provider.h>
@@ -31,24 +33,34 @@ namespace multipass
 {
 class VirtualMachine;
 
-class SSHFSMounts : public QObject
+class SSHFSMounts : public QObject, public MountHandler
 {
     Q_OBJECT
 public:
-    explicit SSHFSMounts(const SSHKeyProvider& ssh_key_provider);
+    // Servers that do not stop within @p stop_deadline of being asked to are killed
+    explicit SSHFSMounts(const SSHKeyProvider& ssh_key_provider,
+                         std::chrono::milliseconds stop_deadline = std::chrono::seconds{5});
 
     void start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
-                     const id_mappings& gid_mappings, const id_mappings& uid_mappings);
+                     const id_mappings& gid_mappings, const id_mappings& uid_mappings,
+                     const std::string& profile) override;
+    Failures start_mounts(VirtualMachine* vm, const std::vector<Mount>& mounts) override;
 
-    bool stop_mount(const std::string& instance, const std::string& path);
-    void stop_all_mounts_for_instance(const std::string& instance);
+    bool stop_mount(const std::string& instance, const std::string& path) override;
+    void stop_all_mounts_for_instance(const std::string& instance) override;
 
-    bool has_instance_already_mounted(const std::string& instance, const std::string& path) const;
+    bool has_instance_already_mounted(const std::string& instance, const std::string& path) const override;
 
 private:
+    qt_delete_later_unique_ptr<Process> make_server_process(VirtualMachine* vm, const Mount& mount);
+    void stop_in_background(qt_delete_later_unique_ptr<Process> sshfs_server_process);
+
     const std::string key;
+    const std::chrono::milliseconds stop_deadline;
     std::unordered_map<std::string, std::unordered_map<std::string, qt_delete_later_unique_ptr<Process>>>
         mount_processes;
+    std::unordered_map<std::string, std::string> instance_infos; // as sshfs_server reported them, by instance
+    std::unordered_map<Process*, qt_delete_later_unique_ptr<Process>> stopping_processes; // until they finish
 };
 
 } // namespace multipass
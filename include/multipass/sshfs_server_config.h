@@ -37,6 +37,9 @@ struct SSHFSServerConfig
     std::string target_path;
     id_mappings gid_mappings;
     id_mappings uid_mappings;
+    int attribute_cache_size{0};
+    std::string profile;       // empty for the default one
+    std::string instance_info; // serialised SshfsInstanceInfo from an earlier mount, empty if none
 };
 
 } // namespace multipass
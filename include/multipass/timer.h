@@ -25,7 +25,6 @@
 #include <condition_variable>
 #include <functional>
 #include <mutex>
-#include <thread>
 
 namespace multipass::utils
 {
@@ -37,26 +36,35 @@ enum class TimerState : int
     Paused
 };
 
+class TimerService;
+
+/**
+ * All timers share a single thread, which sleeps until the earliest deadline among them, so that each timer costs
+ * no more than its entry in a queue.
+ *
+ * That thread also runs every callback, one at a time, so a callback holds up all other timers until it returns. It
+ * must not block on something another timer's callback would do, and should hand longer work off to another thread.
+ */
 class Timer : private DisabledCopyMove
 {
 public:
-    Timer(std::chrono::milliseconds, std::function<void()>); /* NB: callback runs on the timeout thread. */
+    Timer(std::chrono::milliseconds, std::function<void()>); /* NB: callback runs on the shared timers' thread. */
     ~Timer();
 
 public:
     void start();
     void pause();
     void resume();
-    void stop();
+    void stop(); // waits for the callback, unless called from it
 
 private:
-    void main();
+    friend class TimerService;
+
     const std::chrono::milliseconds timeout;
     const std::function<void()> callback;
-    TimerState current_state;
-    std::thread t;
-    std::condition_variable cv;
-    std::mutex cv_m;
+    TimerState current_state; // this and the rest, under the lock of the service
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::milliseconds remaining_time;
 };
 
 #define MP_TIMER_SYNC_FUNCS multipass::utils::TimerSyncFuncs::instance()
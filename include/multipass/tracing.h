@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_TRACING_H
+#define MULTIPASS_TRACING_H
+
+#include "disabled_copy_move.h"
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Spans that say where the time of a request went, from the client, through the daemon's handlers and into the
+ * vault, the backends and SSH. Trace and span IDs follow W3C Trace Context, which OpenTelemetry uses too, so the
+ * client can hand its own `traceparent` over in the call's metadata. Spans go to a file in the Chrome trace event
+ * format, which chrome://tracing and Perfetto open.
+ *
+ * Tracing is off unless enabled, and then spans do no more than check an atomic flag.
+ */
+namespace multipass::tracing
+{
+struct Context
+{
+    std::string trace_id; // 32 lowercase hex digits
+    std::string span_id;  // 16 lowercase hex digits
+
+    bool valid() const;
+};
+
+// Empty when the header is not of the version-00 form, e.g. "00-<trace_id>-<span_id>-01"
+Context from_traceparent(const std::string& traceparent);
+std::string to_traceparent(const Context& context);
+
+namespace detail
+{
+extern std::atomic<bool> tracing_enabled;
+}
+
+inline bool enabled() noexcept
+{
+    return detail::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts writing spans to the given file, or stops when it is empty
+void enable(const QString& chrome_trace_file);
+
+// The span that new spans on this thread fall under
+Context current();
+
+// Makes spans on this thread fall under the given context, while it lives, e.g. in work handed to another thread
+class ContextScope : private DisabledCopyMove
+{
+public:
+    explicit ContextScope(Context context);
+    ~ContextScope();
+
+private:
+    Context previous;
+};
+
+// Times the scope it lives in, under the current context, and becomes the current context in the meantime
+class Span : private DisabledCopyMove
+{
+public:
+    Span(const char* category, std::string name);
+    Span(const char* category, std::string name, const Context& parent);
+    ~Span();
+
+    const Context& context() const;
+
+private:
+    bool active{false};
+    const char* category;
+    std::string name;
+    Context parent;
+    Context own;
+    Context previous;
+    std::chrono::system_clock::time_point start;
+};
+
+// Handlers run on other threads than the one that took the call, so what the call carried is kept by its stream
+void attach(const void* call, const Context& context);
+void detach(const void* call);
+Context context_of(const void* call);
+} // namespace multipass::tracing
+
+#endif // MULTIPASS_TRACING_H
@@ -19,6 +19,8 @@
 #define MULTIPASS_URL_DOWNLOADER_H
 
 #include "disabled_copy_move.h"
+#include "download_scheduler.h"
+#include "optional.h"
 #include "path.h"
 #include "progress_monitor.h"
 #include "singleton.h"
@@ -26,16 +28,27 @@
 #include <QByteArray>
 #include <QDateTime>
 #include <QNetworkAccessManager>
+#include <QStringList>
+#include <QUrl>
 
 #include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #define MP_NETMGRFACTORY multipass::NetworkManagerFactory::instance()
 
-class QUrl;
+class QNetworkReply;
+class QThread;
 class QString;
 namespace multipass
 {
+class Sha256;
+
 class NetworkManagerFactory : public Singleton<NetworkManagerFactory>
 {
 public:
@@ -44,24 +57,75 @@ public:
     virtual std::unique_ptr<QNetworkAccessManager> make_network_manager(const Path& cache_dir_path) const;
 };
 
+// What a server said identifies the version of a resource it sent, so that later requests can ask whether it changed
+struct DownloadValidators
+{
+    QByteArray etag;
+    QByteArray last_modified;
+};
+
 class URLDownloader : private DisabledCopyMove
 {
 public:
+    // Receives downloaded data as it arrives; returning false aborts the download
+    using DataSink = std::function<bool(const QByteArray&)>;
+
     URLDownloader(std::chrono::milliseconds timeout);
     URLDownloader(const Path& cache_dir, std::chrono::milliseconds timeout);
     virtual ~URLDownloader() = default;
     virtual void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
                              const ProgressMonitor& monitor);
+    // Same as download_to(), but also returns the hex-encoded SHA-256 of the received bytes, computed as they arrive
+    virtual QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size,
+                                         const int download_type, const ProgressMonitor& monitor);
+    // Hands the received bytes to sink instead of writing them to a file, returning their hex-encoded SHA-256
+    virtual QString stream_and_hash(const QUrl& url, int64_t size, const int download_type,
+                                    const ProgressMonitor& monitor, const DataSink& sink);
     virtual QByteArray download(const QUrl& url);
+    // Returns nullopt when the server says url has not changed since the download that validators came from, and
+    // otherwise what it sent, updating validators to match
+    virtual optional<QByteArray> download_if_changed(const QUrl& url, DownloadValidators& validators);
     virtual QDateTime last_modified(const QUrl& url);
     virtual void abort_all_downloads();
+    void set_rate_limit(qint64 bytes_per_second); // for all the transfers of files together; 0 for no limit
+    // Base URLs that serve the same files, best first. Files from one of them that cannot be had there are fetched
+    // from the others in turn.
+    void set_mirrors(const QStringList& ranked_base_urls);
+
+    // Where the information needed to resume an interrupted download into file_name is kept
+    static QString resume_info_path_for(const QString& file_name);
 
 protected:
     std::atomic_bool abort_downloads{false};
 
 private:
+    void download_to_file(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                          const ProgressMonitor& monitor, Sha256* hash);
+    void download_to_file_from(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                               const ProgressMonitor& monitor, Sha256* hash);
+    std::vector<QUrl> with_mirrors(const QUrl& url); // url first, then the same file on the other mirrors
+    bool download_in_segments(QNetworkAccessManager* manager, const QUrl& url, const QString& file_name, int64_t size,
+                              const int download_type, const ProgressMonitor& monitor, Sha256* hash);
+    using RawHeaders = std::vector<std::pair<QByteArray, QByteArray>>;
+    // Called with each reply that starts delivering data, returning how much of the file was already there
+    using ResponseAction = std::function<qint64(QNetworkReply*)>;
+
+    void download_chunks(QNetworkAccessManager* manager, const QUrl& url, int64_t size, const int download_type,
+                         const ProgressMonitor& monitor, const RawHeaders& raw_headers,
+                         const ResponseAction& on_response, const DataSink& on_data,
+                         const std::function<void()>& on_error);
+
+    // One manager per thread that downloads, since managers can only be used on their own thread. They keep their
+    // connections to the servers they reach open for the next downloads to reuse.
+    QNetworkAccessManager* network_manager();
+
     const Path cache_dir_path;
     std::chrono::milliseconds timeout;
+    std::mutex managers_mutex;
+    std::unordered_map<QThread*, std::unique_ptr<QNetworkAccessManager>> managers;
+    DownloadScheduler scheduler; // for files; metadata is small enough to go straight through
+    std::mutex mirrors_mutex;
+    std::vector<QStringList> mirror_groups;
 };
 }
 #endif // MULTIPASS_URL_DOWNLOADER_H
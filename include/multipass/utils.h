@@ -28,8 +28,10 @@
 
 #include <chrono>
 #include <functional>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -64,6 +66,53 @@ enum class TimeoutAction
     done
 };
 
+// Tokens between occurrences of a literal delimiter, as views into the string, found one at a time as the range is
+// walked rather than all at once. As with split, a trailing empty token is left out.
+class SplitView
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+        iterator(std::string_view string, std::string_view delimiter);
+
+        reference operator*() const
+        {
+            return token;
+        }
+        pointer operator->() const
+        {
+            return &token;
+        }
+        iterator& operator++();
+        iterator operator++(int);
+        bool operator==(const iterator& other) const;
+        bool operator!=(const iterator& other) const;
+
+    private:
+        std::string_view rest;
+        std::string_view delimiter;
+        std::string_view token;
+        bool done{true};
+    };
+
+    SplitView(std::string_view string, std::string_view delimiter);
+
+    iterator begin() const;
+    iterator end() const;
+
+private:
+    std::string_view string;
+    std::string_view delimiter;
+};
+
 // filesystem and path helpers
 QDir base_dir(const QString& path);
 Path make_dir(const QDir& a_dir, const QString& name, const QFileDevice::Permissions permissions = 0);
@@ -90,6 +139,8 @@ bool process_log_on_error(const QString& program, const QStringList& arguments,
 
 // networking helpers
 void validate_server_address(const std::string& value);
+// The socket that goes with a unix server address, for clients that run as the daemon's user; empty for TCP ones
+std::string local_server_address(const std::string& server_address);
 bool valid_hostname(const std::string& name_string);
 std::string generate_mac_address();
 bool valid_mac_address(const std::string& mac);
@@ -101,6 +152,7 @@ std::string& trim_newline(std::string& s);
 std::string escape_char(const std::string& s, char c);
 std::string escape_for_shell(const std::string& s);
 std::vector<std::string> split(const std::string& string, const std::string& delimiter);
+SplitView split_view(std::string_view string, std::string_view delimiter); // delimiter taken literally, not as regex
 std::string match_line_for(const std::string& output, const std::string& matcher);
 
 // virtual machine helpers
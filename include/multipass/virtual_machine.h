@@ -19,8 +19,14 @@
 #define MULTIPASS_VIRTUAL_MACHINE_H
 
 #include "disabled_copy_move.h"
+#include "guest_readiness.h"
+#include "guest_stats.h"
 #include "ip_address.h"
 #include "optional.h"
+#include "vm_disk_options.h"
+#include "vm_network_options.h"
+#include "vm_resource_limits.h"
+#include "vm_placement.h"
 
 #include <chrono>
 #include <condition_variable>
@@ -68,6 +74,8 @@ public:
     virtual std::string ssh_username() = 0;
     virtual std::string management_ipv4() = 0;
     virtual std::vector<std::string> get_all_ipv4(const SSHKeyProvider& key_provider) = 0;
+    // The addresses the host can find without going into the instance: leases, neighbour tables, the guest agent
+    virtual std::vector<std::string> known_ipv4() = 0;
     virtual std::string ipv6() = 0;
     virtual void wait_until_ssh_up(std::chrono::milliseconds timeout) = 0;
     virtual void ensure_vm_is_running() = 0;
@@ -75,6 +83,26 @@ public:
     virtual void update_cpus(int num_cores) = 0;
     virtual void resize_memory(const MemorySize& new_size) = 0;
     virtual void resize_disk(const MemorySize& new_size) = 0;
+    // Whether the three above also apply to the running instance, rather than only to a stopped one
+    virtual bool resizes_while_running() = 0;
+    // How much of its memory the running guest keeps, through its balloon; the rest goes back to the host
+    virtual void set_balloon_target(const MemorySize& guest_memory) = 0;
+    // Asks the hypervisor rather than the guest; not to be called from the thread that runs the instance
+    virtual GuestStats guest_stats(std::chrono::milliseconds timeout) = 0;
+    // Asks the guest agent, when the backend has a channel to one; nullopt when there is none or it does not answer
+    virtual optional<GuestMetrics> guest_metrics(std::chrono::milliseconds timeout) = 0;
+    virtual void update_placement(const VMPlacement& placement) = 0; // for the next boot
+    virtual void update_disk_options(const VMDiskOptions& disk_options) = 0; // for the next boot
+    virtual void update_network_options(const VMNetworkOptions& network_options) = 0; // for the next boot
+    virtual void update_resource_limits(const VMResourceLimits& limits) = 0; // also for the running instance
+    // Named checkpoints of the instance's disk, which are taken, restored and deleted while it is stopped
+    virtual void take_snapshot(const std::string& name) = 0;
+    virtual void restore_snapshot(const std::string& name) = 0;
+    virtual void delete_snapshot(const std::string& name) = 0;
+    // Suspends or stops the instance the way the backend leaves it when the daemon exits, ahead of destruction
+    virtual void prepare_for_exit() = 0;
+    // Ends the instance without the guest knowing; may be called while another thread waits on it to suspend or stop
+    virtual void kill() = 0;
 
     VirtualMachine::State state;
     const std::string vm_name;
@@ -82,6 +110,7 @@ public:
     std::mutex state_mutex;
     optional<IPAddress> management_ip;
     bool shutdown_while_starting{false};
+    GuestReadiness readiness;
 
 protected:
     VirtualMachine(VirtualMachine::State state, const std::string& vm_name) : state{state}, vm_name{vm_name} {};
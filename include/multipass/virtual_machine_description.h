@@ -20,7 +20,11 @@
 
 #include <multipass/memory_size.h>
 #include <multipass/network_interface.h>
+#include <multipass/vm_disk_options.h>
 #include <multipass/vm_image.h>
+#include <multipass/vm_network_options.h>
+#include <multipass/vm_placement.h>
+#include <multipass/vm_resource_limits.h>
 
 #include <yaml-cpp/yaml.h>
 
@@ -50,6 +54,11 @@ public:
     YAML::Node user_data_config;
     YAML::Node vendor_data_config;
     YAML::Node network_data_config;
+    VMPlacement placement{};
+    VMDiskOptions disk_options{};
+    VMNetworkOptions network_options{};
+    VMResourceLimits resource_limits{};
+    std::string cloud_init_seed_url{}; // where the instance fetches its cloud-init data from, instead of the ISO
 };
 } // namespace multipass
 
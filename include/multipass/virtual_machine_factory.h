@@ -21,6 +21,8 @@
 #include "days.h"
 #include "disabled_copy_move.h"
 #include "fetch_type.h"
+#include "mount_handler.h"
+#include "optional.h"
 #include "path.h"
 #include "virtual_machine.h"
 #include "vm_image.h"
@@ -33,6 +35,7 @@ class Node;
 
 namespace multipass
 {
+class SSHKeyProvider;
 class URLDownloader;
 class VirtualMachineDescription;
 class VMImageHost;
@@ -56,7 +59,8 @@ public:
 
     virtual FetchType fetch_type() = 0;
     virtual void prepare_networking(std::vector<NetworkInterface>& extra_interfaces) = 0; // note the arg may be updated
-    virtual VMImage prepare_source_image(const VMImage& source_image) = 0;
+    // Reports the progress of lengthy preparations, e.g. format conversions, to the monitor
+    virtual VMImage prepare_source_image(const VMImage& source_image, const ProgressMonitor& monitor) = 0;
     virtual void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) = 0;
     virtual void hypervisor_health_check() = 0;
     virtual QString get_backend_directory_name() = 0;
@@ -69,6 +73,21 @@ public:
     // List all the network interfaces seen by the backend.
     virtual std::vector<NetworkInterfaceInfo> networks() const = 0;
 
+    // Mounts that use the backend's own file sharing rather than SSHFS.
+    virtual MountHandler::UPtr create_native_mount_handler(const SSHKeyProvider& ssh_key_provider) = 0;
+
+    // Query the state of all instances in one go, for the calls that follow to go by. Backends that ask each instance
+    // cheaply need not do anything.
+    virtual void prefetch_instance_states() = 0;
+
+    // Start creating the instances of a launch all at once, for create_virtual_machine() to only wait for each of them.
+    // Backends that create instances quickly need not do anything.
+    virtual void start_creating_instances(const std::vector<VirtualMachineDescription>& descs) = 0;
+
+    // The address that instances reach the host at, for them to fetch their cloud-init data from the daemon instead of
+    // from an ISO; nullopt where instances can only be given the ISO.
+    virtual optional<std::string> cloud_init_seed_host() const = 0;
+
 protected:
     VirtualMachineFactory() = default;
 
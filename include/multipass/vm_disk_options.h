@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_VM_DISK_OPTIONS_H
+#define MULTIPASS_VM_DISK_OPTIONS_H
+
+#include <string>
+#include <tuple>
+
+namespace multipass
+{
+// How the hypervisor drives an instance's disk; the defaults are what instances always had
+struct VMDiskOptions
+{
+    std::string cache{"writeback"}; // none, writeback, writethrough or unsafe (never flushed, for throwaway disks)
+    std::string aio{"threads"};     // threads, native (only with no cache) or io_uring
+    bool iothread{false};           // a dedicated I/O thread for the disk, rather than the main loop
+    int queues{1};                  // request queues, handled in parallel by the guest
+    bool detect_zeroes{false};      // turn writes of zeroes into discards
+};
+
+inline bool operator==(const VMDiskOptions& a, const VMDiskOptions& b)
+{
+    return std::tie(a.cache, a.aio, a.iothread, a.queues, a.detect_zeroes) ==
+           std::tie(b.cache, b.aio, b.iothread, b.queues, b.detect_zeroes);
+}
+
+inline bool operator!=(const VMDiskOptions& a, const VMDiskOptions& b)
+{
+    return !(a == b);
+}
+} // namespace multipass
+
+#endif // MULTIPASS_VM_DISK_OPTIONS_H
@@ -22,6 +22,7 @@
 #include "optional.h"
 #include "vm_image_info.h"
 
+#include <cstddef>
 #include <functional>
 #include <string>
 #include <utility>
@@ -44,6 +45,18 @@ public:
     virtual void for_each_entry_do(const Action& action) = 0;
     virtual std::vector<std::string> supported_remotes() = 0;
 
+    // Changes whenever the manifests do. Hosts that cannot tell give nothing, so that what they serve is not cached.
+    virtual optional<std::size_t> manifest_generation()
+    {
+        return nullopt;
+    }
+
+    // Roughly what the manifests take in memory, for the daemon to account for it; zero for hosts that keep little
+    virtual std::size_t manifests_memory_estimate()
+    {
+        return 0;
+    }
+
 protected:
     VMImageHost() = default;
 };
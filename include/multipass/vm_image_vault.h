@@ -47,6 +47,7 @@ QString copy(const QString& file_name, const QDir& output_dir);
 void delete_file(const Path& path);
 QString compute_image_hash(const Path& image_path);
 void verify_image_download(const Path& image_path, const QString& image_hash);
+void verify_image_hash(const QString& computed_hash, const QString& image_hash);
 QString extract_image(const Path& image_path, const ProgressMonitor& monitor, const bool delete_file = false);
 std::unordered_map<std::string, VMImageHost*> configure_image_host_map(const std::vector<VMImageHost*>& image_hosts);
 
@@ -56,9 +57,13 @@ public:
     explicit DeleteOnException(const Path& path) : file(path)
     {
     }
+    // The file is kept if keep_marker exists by then, e.g. to resume an interrupted download later
+    DeleteOnException(const Path& path, const Path& keep_marker) : file(path), keep_marker(keep_marker)
+    {
+    }
     ~DeleteOnException()
     {
-        if (std::uncaught_exceptions() > initial_exc_count)
+        if (std::uncaught_exceptions() > initial_exc_count && (keep_marker.isEmpty() || !QFile::exists(keep_marker)))
         {
             file.remove();
         }
@@ -66,6 +71,7 @@ public:
 
 private:
     QFile file;
+    const Path keep_marker;
     const int initial_exc_count = std::uncaught_exceptions();
 };
 } // namespace vault
@@ -82,10 +88,26 @@ public:
     virtual VMImage fetch_image(const FetchType& fetch_type, const Query& query, const PrepareAction& prepare,
                                 const ProgressMonitor& monitor) = 0;
     virtual void remove(const std::string& name) = 0;
+    // Removes the images of all of these instances, recording that they are gone at once where the vault can
+    virtual void remove_all(const std::vector<std::string>& names)
+    {
+        for (const auto& name : names)
+            remove(name);
+    }
+    // Gives destination_name an instance image of its own, with what source_name's holds at the time
+    virtual VMImage clone_instance_image(const std::string& source_name, const std::string& destination_name) = 0;
+    // Makes an image of what instance_name's holds, which stands on its own and is served under image_name
+    virtual VMImageInfo bake_instance_image(const std::string& instance_name, const std::string& image_name) = 0;
     virtual bool has_record_for(const std::string& name) = 0;
     virtual void prune_expired_images() = 0;
+    // Upkeep of the cached images that takes a while, for the background maintenance to get to, never startup
+    virtual void maintain_images()
+    {
+    }
     virtual void update_images(const FetchType& fetch_type, const PrepareAction& prepare,
                                const ProgressMonitor& monitor) = 0;
+    virtual void prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries,
+                                 const PrepareAction& prepare, const ProgressMonitor& monitor) = 0;
     virtual MemorySize minimum_image_size_for(const std::string& id) = 0;
     virtual VMImageHost* image_host_for(const std::string& remote_name) const = 0;
     virtual std::vector<std::pair<std::string, VMImageInfo>> all_info_for(const Query& query) const = 0;
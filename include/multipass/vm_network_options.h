@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_VM_NETWORK_OPTIONS_H
+#define MULTIPASS_VM_NETWORK_OPTIONS_H
+
+#include <tuple>
+
+namespace multipass
+{
+// How the hypervisor drives an instance's default network interface; the defaults are what instances always had
+struct VMNetworkOptions
+{
+    bool vhost{false}; // process packets in the host kernel, rather than in the hypervisor
+    int queues{1};     // queue pairs, each with its own vCPU in the guest; 0 for one per vCPU
+    int ring_size{0};  // descriptors in each queue; 0 for the hypervisor's default
+
+    int queues_for(int num_cores) const
+    {
+        return queues ? queues : num_cores;
+    }
+};
+
+inline bool operator==(const VMNetworkOptions& a, const VMNetworkOptions& b)
+{
+    return std::tie(a.vhost, a.queues, a.ring_size) == std::tie(b.vhost, b.queues, b.ring_size);
+}
+
+inline bool operator!=(const VMNetworkOptions& a, const VMNetworkOptions& b)
+{
+    return !(a == b);
+}
+} // namespace multipass
+
+#endif // MULTIPASS_VM_NETWORK_OPTIONS_H
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_VM_PLACEMENT_H
+#define MULTIPASS_VM_PLACEMENT_H
+
+#include <multipass/optional.h>
+
+#include <tuple>
+#include <vector>
+
+namespace multipass
+{
+// Where an instance runs on the host, for guests that suffer from being moved around; empty means anywhere
+struct VMPlacement
+{
+    bool hugepages{false};        // back the guest memory with huge pages
+    optional<int> numa_node{};    // the host node to take the guest memory from
+    std::vector<int> vcpu_cpus{}; // host CPUs for the vCPUs, one each in order, cycling when there are fewer
+    std::vector<int> io_cpus{};   // host CPUs for the hypervisor's other threads, that do the I/O
+};
+
+inline bool operator==(const VMPlacement& a, const VMPlacement& b)
+{
+    return std::tie(a.hugepages, a.numa_node, a.vcpu_cpus, a.io_cpus) ==
+           std::tie(b.hugepages, b.numa_node, b.vcpu_cpus, b.io_cpus);
+}
+
+inline bool operator!=(const VMPlacement& a, const VMPlacement& b)
+{
+    return !(a == b);
+}
+} // namespace multipass
+
+#endif // MULTIPASS_VM_PLACEMENT_H
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_VM_RESOURCE_LIMITS_H
+#define MULTIPASS_VM_RESOURCE_LIMITS_H
+
+#include <tuple>
+
+namespace multipass
+{
+// How much of the host an instance's processes may take, through the cgroup they run in; the defaults set no limits
+struct VMResourceLimits
+{
+    int cpu_weight{100};      // share of the CPUs under contention, from 1 to 10000, relative to other instances
+    int io_weight{100};       // share of disk bandwidth under contention, idem
+    long long memory_high{0}; // bytes past which the host throttles the instance and reclaims from it; 0 for none
+    int cpu_max{0};           // percent of one host CPU that the instance may use at most; 0 for no cap
+};
+
+inline bool operator==(const VMResourceLimits& a, const VMResourceLimits& b)
+{
+    return std::tie(a.cpu_weight, a.io_weight, a.memory_high, a.cpu_max) ==
+           std::tie(b.cpu_weight, b.io_weight, b.memory_high, b.cpu_max);
+}
+
+inline bool operator!=(const VMResourceLimits& a, const VMResourceLimits& b)
+{
+    return !(a == b);
+}
+} // namespace multipass
+
+#endif // MULTIPASS_VM_RESOURCE_LIMITS_H
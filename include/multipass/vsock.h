@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_VSOCK_H
+#define MULTIPASS_VSOCK_H
+
+#include "disabled_copy_move.h"
+#include "optional.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace multipass
+{
+namespace vsock
+{
+// Hosts of the form "vsock:<cid>" name an instance by its context ID, for SSH to reach it over AF_VSOCK rather than IP
+std::string host_for(unsigned cid);
+optional<unsigned> cid_in(const std::string& host);
+
+// Whether this host can give its instances a vsock device
+bool available();
+
+// Returns a connected socket, for the caller to own; throws std::runtime_error when nothing answers on @p port in time
+int connect(unsigned cid, unsigned port, std::chrono::milliseconds timeout);
+
+/**
+ * The vsock side of an instance: its context ID, when it has a vsock device, and whether its SSH server was found
+ * listening there since the guest last booted. The guest is only probed until it answers, as every connection costs
+ * it an SSH server process.
+ */
+class Endpoint : private DisabledCopyMove
+{
+public:
+    void set_cid(optional<unsigned> cid); // as the instance's process or domain comes up
+    optional<unsigned> cid() const;
+
+    // The host for SSH to reach the instance at, when it listens on @p port over vsock
+    optional<std::string> ssh_host(unsigned port, std::chrono::milliseconds timeout);
+
+    void reset(); // for when the guest (re)boots or goes away
+
+private:
+    mutable std::mutex mutex;
+    optional<unsigned> context_id;
+    bool listening{false};
+};
+} // namespace vsock
+} // namespace multipass
+
+#endif // MULTIPASS_VSOCK_H
@@ -21,8 +21,14 @@
 #include <multipass/path.h>
 #include <multipass/progress_monitor.h>
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 
+#include <QByteArray>
 #include <QFile>
 
 #include <xz.h>
@@ -42,5 +48,32 @@ private:
     QFile xz_file;
     XzDecoderUPtr xz_decoder;
 };
+
+// Decodes xz data as it is fed in (e.g. while it is still being downloaded) on a worker thread
+class XzStreamDecoder
+{
+public:
+    explicit XzStreamDecoder(const Path& decoded_file_path);
+    ~XzStreamDecoder();
+
+    // Queues data for decoding, blocking while too much is pending; returns false once decoding has failed
+    bool feed(const QByteArray& data);
+    // Waits for all queued data to be decoded, throwing if the stream was invalid or incomplete
+    void finish();
+
+private:
+    void decode();
+
+    QFile decoded_file;
+    XzImageDecoder::XzDecoderUPtr xz_decoder;
+    std::deque<QByteArray> pending;
+    bool input_done{false};
+    bool decoding_done{false};
+    bool failed{false};
+    std::exception_ptr decode_error;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+};
 } // namespace multipass
 #endif // MULTIPASS_XZ_IMAGE_DECODER_H
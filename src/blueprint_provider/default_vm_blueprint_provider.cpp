@@ -26,6 +26,7 @@
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
 #include <QFile>
 #include <QFileInfo>
 
@@ -44,9 +45,10 @@ const QString github_blueprints_archive_name{"multipass-blueprints.zip"};
 const QString blueprint_dir_version{"v1"};
 constexpr auto category = "blueprint provider";
 
-auto blueprints_map_for(const std::string& archive_file_path, bool& needs_update)
+// Only the central directory is read here, each blueprint is extracted and parsed when first needed
+auto blueprint_index_for(const std::string& archive_file_path, bool& needs_update)
 {
-    std::map<std::string, YAML::Node> blueprints_map;
+    std::map<std::string, Poco::Zip::ZipLocalFileHeader> blueprint_index;
     std::ifstream zip_stream{archive_file_path, std::ios::binary};
     auto zip_archive = MP_POCOZIPUTILS.zip_archive_for(zip_stream);
 
@@ -70,15 +72,22 @@ auto blueprints_map_for(const std::string& archive_file_path, bool& needs_update
                     continue;
                 }
 
-                Poco::Zip::ZipInputStream zip_input_stream{zip_stream, it->second};
-                std::ostringstream out(std::ios::binary);
-                Poco::StreamCopier::copyStream(zip_input_stream, out);
-                blueprints_map[file_info.baseName().toStdString()] = YAML::Load(out.str());
+                blueprint_index.emplace(file_info.baseName().toStdString(), it->second);
             }
         }
     }
 
-    return blueprints_map;
+    return blueprint_index;
+}
+
+QByteArray hash_of(const QString& file_path)
+{
+    QFile file{file_path};
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    if (file.open(QIODevice::ReadOnly))
+        hash.addData(&file);
+
+    return hash.result();
 }
 } // namespace
 
@@ -108,7 +117,7 @@ mp::Query mp::DefaultVMBlueprintProvider::fetch_blueprint_for(const std::string&
     update_blueprints();
 
     Query query{"", "default", false, "", Query::Type::Alias};
-    auto& blueprint_config = blueprint_map.at(blueprint_name);
+    auto& blueprint_config = blueprint_config_for(blueprint_name);
 
     auto blueprint_instance = blueprint_config["instances"][blueprint_name];
 
@@ -237,7 +246,7 @@ mp::VMImageInfo mp::DefaultVMBlueprintProvider::info_for(const std::string& blue
 
     static constexpr auto missing_key_template{"The \'{}\' key is required for the {} Blueprint"};
     static constexpr auto bad_conversion_template{"Cannot convert \'{}\' key for the {} Blueprint"};
-    auto& blueprint_config = blueprint_map.at(blueprint_name);
+    auto& blueprint_config = blueprint_config_for(blueprint_name);
 
     VMImageInfo image_info;
     image_info.aliases.append(QString::fromStdString(blueprint_name));
@@ -304,8 +313,9 @@ std::vector<mp::VMImageInfo> mp::DefaultVMBlueprintProvider::all_blueprints()
     bool will_need_update{false};
     std::vector<VMImageInfo> blueprint_info;
 
-    for (const auto& [key, config] : blueprint_map)
+    for (const auto& entry : blueprint_index)
     {
+        const auto& key = entry.first;
         try
         {
             blueprint_info.push_back(info_for(key));
@@ -332,7 +342,7 @@ std::vector<mp::VMImageInfo> mp::DefaultVMBlueprintProvider::all_blueprints()
 
 std::string mp::DefaultVMBlueprintProvider::name_from_blueprint(const std::string& blueprint_name)
 {
-    if (blueprint_map.count(blueprint_name) == 1)
+    if (blueprint_index.count(blueprint_name) == 1)
         return blueprint_name;
 
     return {};
@@ -344,9 +354,7 @@ int mp::DefaultVMBlueprintProvider::blueprint_timeout(const std::string& bluepri
 
     try
     {
-        blueprint_map.at(blueprint_name);
-
-        auto& blueprint_config = blueprint_map.at(blueprint_name);
+        auto& blueprint_config = blueprint_config_for(blueprint_name);
 
         auto blueprint_instance = blueprint_config["instances"][blueprint_name];
 
@@ -375,7 +383,37 @@ void mp::DefaultVMBlueprintProvider::fetch_blueprints()
 {
     url_downloader->download_to(blueprints_url, archive_file_path, -1, -1, [](auto...) { return true; });
 
-    blueprint_map = blueprints_map_for(archive_file_path.toStdString(), needs_update);
+    // The same archive holds the same blueprints, which keep whatever was parsed of them
+    auto hash = hash_of(archive_file_path);
+    if (hash == archive_hash)
+        return;
+
+    blueprint_index = blueprint_index_for(archive_file_path.toStdString(), needs_update);
+    blueprint_map.clear();
+    archive_hash = hash;
+}
+
+YAML::Node& mp::DefaultVMBlueprintProvider::blueprint_config_for(const std::string& blueprint_name)
+{
+    if (auto parsed = blueprint_map.find(blueprint_name); parsed != blueprint_map.end())
+        return parsed->second;
+
+    const auto& header = blueprint_index.at(blueprint_name);
+    try
+    {
+        std::ifstream zip_stream{archive_file_path.toStdString(), std::ios::binary};
+        Poco::Zip::ZipInputStream zip_input_stream{zip_stream, header};
+        std::ostringstream out(std::ios::binary);
+        Poco::StreamCopier::copyStream(zip_input_stream, out);
+
+        return blueprint_map[blueprint_name] = YAML::Load(out.str());
+    }
+    catch (const Poco::Exception& e)
+    {
+        needs_update = true;
+        throw InvalidBlueprintException(
+            fmt::format("Cannot extract the {} Blueprint: {}", blueprint_name, e.displayText()));
+    }
 }
 
 void mp::DefaultVMBlueprintProvider::update_blueprints()
@@ -20,8 +20,10 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QSaveFile>
@@ -35,6 +37,12 @@ namespace
 {
 constexpr auto chain_name = "multipass_client_certs.pem";
 constexpr auto category = "client cert store";
+constexpr auto max_verified_pems = 64; // one per client, there are hardly ever more than a few
+
+QByteArray digest_of(const QSslCertificate& cert)
+{
+    return cert.digest(QCryptographicHash::Sha256);
+}
 
 auto load_certs_from_file(const multipass::Path& cert_dir)
 {
@@ -57,6 +65,9 @@ mp::ClientCertStore::ClientCertStore(const multipass::Path& data_dir)
     : cert_dir{QDir(data_dir).filePath(mp::authenticated_certs_dir)},
       authenticated_client_certs{load_certs_from_file(cert_dir)}
 {
+    for (const auto& cert : authenticated_client_certs)
+        authenticated_digests.insert(digest_of(cert));
+
     mpl::log(mpl::Level::trace, category, fmt::format("Loading client certs from {}", cert_dir));
 }
 
@@ -69,6 +80,7 @@ void mp::ClientCertStore::add_cert(const std::string& pem_cert)
     if (cert.isNull())
         throw std::runtime_error("invalid certificate data");
 
+    std::lock_guard<std::mutex> lock{mutex};
     if (verify_cert(cert))
         return;
 
@@ -92,6 +104,7 @@ void mp::ClientCertStore::add_cert(const std::string& pem_cert)
         throw std::runtime_error("failed to write certificate");
 
     authenticated_client_certs.push_back(cert);
+    authenticated_digests.insert(digest_of(cert));
 }
 
 std::string mp::ClientCertStore::PEM_cert_chain() const
@@ -107,15 +120,30 @@ bool mp::ClientCertStore::verify_cert(const std::string& pem_cert)
 {
     mpl::log(mpl::Level::trace, category, fmt::format("Verifying cert:\n{}", pem_cert));
 
-    return verify_cert(QSslCertificate(QByteArray::fromStdString(pem_cert)));
+    std::lock_guard<std::mutex> lock{mutex};
+    const auto hit = verified_pems.count(pem_cert) > 0;
+    ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests",
+                               {{"query", "client_cert"}, {"result", hit ? "hit" : "miss"}});
+    if (hit)
+        return true;
+
+    if (!verify_cert(QSslCertificate(QByteArray::fromStdString(pem_cert))))
+        return false;
+
+    if (verified_pems.size() >= max_verified_pems)
+        verified_pems.clear();
+    verified_pems.insert(pem_cert);
+
+    return true;
 }
 
 bool mp::ClientCertStore::verify_cert(const QSslCertificate& cert)
 {
-    return authenticated_client_certs.contains(cert);
+    return !cert.isNull() && authenticated_digests.contains(digest_of(cert));
 }
 
 bool mp::ClientCertStore::empty()
 {
+    std::lock_guard<std::mutex> lock{mutex};
     return authenticated_client_certs.empty();
 }
@@ -19,6 +19,8 @@
 #include "cmd/alias.h"
 #include "cmd/aliases.h"
 #include "cmd/authenticate.h"
+#include "cmd/bake.h"
+#include "cmd/clone.h"
 #include "cmd/delete.h"
 #include "cmd/exec.h"
 #include "cmd/find.h"
@@ -35,9 +37,11 @@
 #include "cmd/restart.h"
 #include "cmd/set.h"
 #include "cmd/shell.h"
+#include "cmd/snapshot.h"
 #include "cmd/start.h"
 #include "cmd/stop.h"
 #include "cmd/suspend.h"
+#include "cmd/top.h"
 #include "cmd/transfer.h"
 #include "cmd/umount.h"
 #include "cmd/unalias.h"
@@ -79,6 +83,8 @@ mp::Client::Client(ClientConfig& config)
     add_command<cmd::Alias>(aliases);
     add_command<cmd::Aliases>(aliases);
     add_command<cmd::Authenticate>();
+    add_command<cmd::Clone>();
+    add_command<cmd::Bake>();
     add_command<cmd::Launch>();
     add_command<cmd::Purge>(aliases);
     add_command<cmd::Exec>(aliases);
@@ -92,9 +98,11 @@ mp::Client::Client(ClientConfig& config)
     add_command<cmd::Recover>();
     add_command<cmd::Set>();
     add_command<cmd::Shell>();
+    add_command<cmd::Snapshot>();
     add_command<cmd::Start>();
     add_command<cmd::Stop>();
     add_command<cmd::Suspend>();
+    add_command<cmd::Top>();
     add_command<cmd::Transfer>();
     add_command<cmd::Unalias>(aliases);
     add_command<cmd::Restart>();
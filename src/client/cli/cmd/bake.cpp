@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bake.h"
+#include "animated_spinner.h"
+#include "common_cli.h"
+
+#include <multipass/cli/argparser.h>
+#include <multipass/format.h>
+
+namespace mp = multipass;
+namespace cmd = multipass::cmd;
+
+mp::ReturnCode cmd::Bake::run(mp::ArgParser* parser)
+{
+    auto ret = parse_args(parser);
+    if (ret != ParseCode::Ok)
+    {
+        return parser->returnCodeFrom(ret);
+    }
+
+    AnimatedSpinner spinner{cout};
+
+    auto on_success = [&spinner](mp::BakeReply& reply) {
+        spinner.stop();
+        return mp::ReturnCode::Ok;
+    };
+
+    auto on_failure = [this, &spinner](grpc::Status& status) {
+        spinner.stop();
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    auto streaming_callback = [this, &spinner](mp::BakeReply& reply) {
+        if (!reply.log_line().empty())
+            spinner.print(cerr, reply.log_line());
+
+        spinner.stop();
+        if (!reply.reply_message().empty())
+            cout << reply.reply_message() << "\n";
+    };
+
+    request.set_verbosity_level(parser->verbosityLevel());
+    spinner.start(fmt::format("Baking {}", request.instance_name()));
+    return dispatch(&RpcMethod::bake, request, on_success, on_failure, streaming_callback);
+}
+
+std::string cmd::Bake::name() const { return "bake"; }
+
+QString cmd::Bake::short_help() const
+{
+    return QStringLiteral("Make an image out of a running instance");
+}
+
+QString cmd::Bake::description() const
+{
+    return QStringLiteral("Make an image out of a running instance, with everything that was installed and\n"
+                          "configured in it, for new instances to start from. The instance's cloud-init state\n"
+                          "is cleaned, so that cloud-init sets new instances up as such, and the instance is\n"
+                          "left stopped. The image is then listed by `find`, and launched by its name.");
+}
+
+mp::ParseCode cmd::Bake::parse_args(mp::ArgParser* parser)
+{
+    parser->addPositionalArgument("instance", "Name of the instance to bake", "<instance>");
+    parser->addPositionalArgument("image", "Name to give the image", "<image>");
+
+    auto status = parser->commandParse(this);
+    if (status != ParseCode::Ok)
+        return status;
+
+    const auto args = parser->positionalArguments();
+    if (args.count() != 2)
+    {
+        cerr << "Name of the instance to bake and of the image to make are required\n";
+        return ParseCode::CommandLineError;
+    }
+
+    request.set_instance_name(args.at(0).toStdString());
+    request.set_image_name(args.at(1).toStdString());
+
+    return status;
+}
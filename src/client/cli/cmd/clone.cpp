@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "clone.h"
+#include "animated_spinner.h"
+#include "common_cli.h"
+
+#include <multipass/cli/argparser.h>
+#include <multipass/format.h>
+
+namespace mp = multipass;
+namespace cmd = multipass::cmd;
+
+mp::ReturnCode cmd::Clone::run(mp::ArgParser* parser)
+{
+    auto ret = parse_args(parser);
+    if (ret != ParseCode::Ok)
+    {
+        return parser->returnCodeFrom(ret);
+    }
+
+    AnimatedSpinner spinner{cout};
+
+    auto on_success = [&spinner](mp::CloneReply& reply) {
+        spinner.stop();
+        return mp::ReturnCode::Ok;
+    };
+
+    auto on_failure = [this, &spinner](grpc::Status& status) {
+        spinner.stop();
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    auto streaming_callback = [this, &spinner](mp::CloneReply& reply) {
+        if (!reply.log_line().empty())
+            spinner.print(cerr, reply.log_line());
+
+        spinner.stop();
+        if (!reply.reply_message().empty())
+            cout << reply.reply_message() << "\n";
+    };
+
+    request.set_verbosity_level(parser->verbosityLevel());
+    spinner.start(fmt::format("Cloning {}", request.source_name()));
+    return dispatch(&RpcMethod::clone, request, on_success, on_failure, streaming_callback);
+}
+
+std::string cmd::Clone::name() const { return "clone"; }
+
+QString cmd::Clone::short_help() const
+{
+    return QStringLiteral("Make copies of a stopped instance");
+}
+
+QString cmd::Clone::description() const
+{
+    return QStringLiteral("Make copies of a stopped instance, with everything that was installed and configured in\n"
+                          "it. Each copy gets its own name, hostname and MAC addresses, and is left stopped.\n"
+                          "Mounts are not copied.");
+}
+
+mp::ParseCode cmd::Clone::parse_args(mp::ArgParser* parser)
+{
+    parser->addPositionalArgument("source", "Name of the instance to clone", "<source>");
+    parser->addPositionalArgument("name", "Names of the copies to make", "<name> [<name> ...]");
+
+    auto status = parser->commandParse(this);
+    if (status != ParseCode::Ok)
+        return status;
+
+    const auto args = parser->positionalArguments();
+    if (args.count() < 2)
+    {
+        cerr << "Name of the instance to clone and of at least one copy are required\n";
+        return ParseCode::CommandLineError;
+    }
+
+    request.set_source_name(args.first().toStdString());
+    for (auto i = 1; i < args.count(); ++i)
+        request.add_destination_names(args.at(i).toStdString());
+
+    return status;
+}
@@ -19,8 +19,13 @@
 #include "common_cli.h"
 
 #include <multipass/cli/argparser.h>
+#include <multipass/format.h>
 #include <multipass/ssh/ssh_client.h>
 
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
 namespace mp = multipass;
 namespace cmd = multipass::cmd;
 
@@ -28,6 +33,8 @@ namespace
 {
 const QString work_dir_option_name{"working-directory"};
 const QString no_dir_mapping_option{"no-map-working-directory"};
+const QString instances_option_name{"instances"};
+const QString all_option_name{"all"};
 
 auto is_dir_mounted(const QStringList& split_current_dir, const QStringList& split_source_dir)
 {
@@ -42,6 +49,72 @@ auto is_dir_mounted(const QStringList& split_current_dir, const QStringList& spl
 
     return true;
 }
+
+mp::optional<std::string> mounted_work_dir(const mp::MountInfo& mount_info)
+{
+    // The host directory on which the user is executing the command.
+    QString clean_exec_dir = QDir::cleanPath(QDir::current().canonicalPath());
+    QStringList split_exec_dir = clean_exec_dir.split('/');
+
+    mp::optional<std::string> work_dir;
+    for (const auto& mount : mount_info.mount_paths())
+    {
+        auto source_dir = QDir(QString::fromStdString(mount.source_path()));
+        auto clean_source_dir = QDir::cleanPath(source_dir.absolutePath());
+        QStringList split_source_dir = clean_source_dir.split('/');
+
+        // If the directory is mounted, we need to `cd` to it in the instance before executing the command.
+        if (is_dir_mounted(split_exec_dir, split_source_dir))
+        {
+            for (int i = 0; i < split_source_dir.size(); ++i)
+                split_exec_dir.removeFirst();
+            work_dir = mount.target_path() + '/' + split_exec_dir.join('/').toStdString();
+        }
+    }
+
+    return work_dir;
+}
+
+// Keeps the lines of instances running side by side whole, each behind the name of the instance it came from
+class PrefixedOutput
+{
+public:
+    PrefixedOutput(std::string prefix, std::mutex& mutex, std::ostream& out, std::ostream& err)
+        : prefix{std::move(prefix)}, mutex{mutex}, out{out}, err{err}
+    {
+    }
+
+    void operator()(const char* data, std::size_t size, bool is_stderr)
+    {
+        auto& pending = is_stderr ? pending_err : pending_out;
+        pending.append(data, size);
+
+        std::string::size_type start = 0, end;
+        std::lock_guard<std::mutex> lock{mutex};
+        while ((end = pending.find('\n', start)) != std::string::npos)
+        {
+            (is_stderr ? err : out) << prefix << pending.substr(start, end + 1 - start);
+            start = end + 1;
+        }
+        pending.erase(0, start);
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!pending_out.empty())
+            out << prefix << pending_out << "\n";
+        if (!pending_err.empty())
+            err << prefix << pending_err << "\n";
+    }
+
+private:
+    const std::string prefix;
+    std::mutex& mutex;
+    std::ostream& out;
+    std::ostream& err;
+    std::string pending_out, pending_err;
+};
 } // namespace
 
 mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
@@ -52,10 +125,11 @@ mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
         return parser->returnCodeFrom(ret);
     }
 
-    auto instance_name = ssh_info_request.instance_name(0);
+    // With many instances, every positional argument belongs to the command
+    const auto fan_out = parser->isSet(instances_option_name) || parser->isSet(all_option_name);
 
     std::vector<std::string> args;
-    for (int i = 1; i < parser->positionalArguments().size(); ++i)
+    for (int i = fan_out ? 0 : 1; i < parser->positionalArguments().size(); ++i)
         args.push_back(parser->positionalArguments().at(i).toStdString());
 
     mp::optional<std::string> work_dir;
@@ -64,53 +138,27 @@ mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
         // If the user asked for a working directory, prepend the appropriate `cd`.
         work_dir = parser->value(work_dir_option_name).toStdString();
     }
-    else
-    {
-        // If the current working directory is mounted in the instance, then prepend the appropriate `cd` to the
-        // command to be ran (unless the user specified the non-mapping option).
-        if (!parser->isSet(no_dir_mapping_option))
+
+    // If the current working directory is mounted in the instance, then prepend the appropriate `cd` to the
+    // command to be ran (unless the user specified the non-mapping option).
+    const auto map_work_dir = !work_dir && !parser->isSet(no_dir_mapping_option);
+
+    if (fan_out)
+        return run_on_many(parser, work_dir, map_work_dir, args);
+
+    auto instance_name = ssh_info_request.instance_name(0);
+
+    auto on_success = [this, &args, &work_dir, &instance_name, map_work_dir, parser](mp::SSHInfoReply& reply) {
+        if (map_work_dir)
         {
-            // The host directory on which the user is executing the command.
-            QString clean_exec_dir = QDir::cleanPath(QDir::current().canonicalPath());
-            QStringList split_exec_dir = clean_exec_dir.split('/');
-
-            auto on_info_success = [&work_dir, &split_exec_dir](mp::InfoReply& reply) {
-                for (const auto& mount : reply.info(0).mount_info().mount_paths())
-                {
-                    auto source_dir = QDir(QString::fromStdString(mount.source_path()));
-                    auto clean_source_dir = QDir::cleanPath(source_dir.absolutePath());
-                    QStringList split_source_dir = clean_source_dir.split('/');
-
-                    // If the directory is mounted, we need to `cd` to it in the instance before executing the command.
-                    if (is_dir_mounted(split_exec_dir, split_source_dir))
-                    {
-                        for (int i = 0; i < split_source_dir.size(); ++i)
-                            split_exec_dir.removeFirst();
-                        work_dir = mount.target_path() + '/' + split_exec_dir.join('/').toStdString();
-                    }
-                }
-
-                return ReturnCode::Ok;
-            };
-
-            auto on_info_failure = [this](grpc::Status& status) {
-                return standard_failure_handler_for(name(), cerr, status);
-            };
-
-            info_request.set_verbosity_level(parser->verbosityLevel());
-
-            InstanceNames instance_names;
-            auto info_instance_name = instance_names.add_instance_name();
-            info_instance_name->append(instance_name);
-            info_request.mutable_instance_names()->CopyFrom(instance_names);
-            info_request.set_no_runtime_information(true);
-
-            dispatch(&RpcMethod::info, info_request, on_info_success, on_info_failure);
-            // TODO: what to do with the returned value?
+            // The mounts come along with the credentials, daemons that do not send them are asked separately
+            auto it = reply.ssh_info().find(instance_name);
+            if (it != reply.ssh_info().end() && it->second.has_mount_info())
+                work_dir = mounted_work_dir(it->second.mount_info());
+            else
+                work_dir = query_mounted_work_dir(instance_name, parser);
         }
-    }
 
-    auto on_success = [this, &args, &work_dir](mp::SSHInfoReply& reply) {
         return exec_success(reply, work_dir, args, term);
     };
 
@@ -162,6 +210,8 @@ mp::ReturnCode cmd::Exec::exec_success(const mp::SSHInfoReply& reply, const mp::
     {
         auto console_creator = [&term](auto channel) { return Console::make_console(channel, term); };
         mp::SSHClient ssh_client{host, port, username, priv_key_blob, console_creator};
+        if (!term->cout_is_live()) // e.g. redirected to a file, where throughput matters more than latency
+            ssh_client.set_output_mode(mp::SSHClient::OutputMode::bulk);
 
         std::vector<std::vector<std::string>> all_args;
         if (dir)
@@ -180,6 +230,119 @@ mp::ReturnCode cmd::Exec::exec_success(const mp::SSHInfoReply& reply, const mp::
     }
 }
 
+mp::ReturnCode cmd::Exec::exec_on_many(const mp::SSHInfoReply& reply, const mp::optional<std::string>& dir,
+                                       bool map_work_dir, const std::vector<std::string>& args, mp::Terminal* term)
+{
+    std::string::size_type width = 0;
+    for (const auto& entry : reply.ssh_info())
+        width = std::max(width, entry.first.size());
+
+    struct Outcome
+    {
+        std::string name;
+        int exit_code = 0;
+        std::string error;
+    };
+
+    std::mutex output_mutex;
+    std::vector<Outcome> outcomes(reply.ssh_info().size());
+    std::vector<std::thread> threads;
+
+    auto next = outcomes.begin();
+    for (const auto& entry : reply.ssh_info())
+    {
+        const auto& ssh_info = entry.second;
+        next->name = entry.first;
+
+        auto work_dir = dir;
+        if (map_work_dir && ssh_info.has_mount_info())
+            work_dir = mounted_work_dir(ssh_info.mount_info());
+
+        threads.emplace_back([&ssh_info, &args, &output_mutex, term, width, work_dir, &outcome = *next] {
+            PrefixedOutput output{fmt::format("{:<{}} | ", outcome.name, width), output_mutex, term->cout(),
+                                  term->cerr()};
+            try
+            {
+                mp::SSHClient ssh_client{ssh_info.host(), ssh_info.port(), ssh_info.username(),
+                                         ssh_info.priv_key_base64(), [](auto) { return mp::Console::UPtr{}; }};
+
+                std::vector<std::vector<std::string>> all_args{args};
+                if (work_dir)
+                    all_args.insert(all_args.begin(), std::vector<std::string>{"cd", *work_dir});
+
+                outcome.exit_code = ssh_client.exec(all_args, std::ref(output));
+            }
+            catch (const std::exception& e)
+            {
+                outcome.error = e.what();
+            }
+            output.flush();
+        });
+        ++next;
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    auto ret = ReturnCode::Ok;
+    for (const auto& [name, exit_code, error] : outcomes)
+    {
+        if (!error.empty())
+            term->cerr() << fmt::format("{}: exec failed: {}\n", name, error);
+        else if (exit_code != 0)
+            term->cerr() << fmt::format("{}: exited with code {}\n", name, exit_code);
+        else
+            continue;
+
+        ret = ReturnCode::CommandFail;
+    }
+
+    return ret;
+}
+
+mp::ReturnCode cmd::Exec::run_on_many(mp::ArgParser* parser, const mp::optional<std::string>& work_dir,
+                                      bool map_work_dir, const std::vector<std::string>& args)
+{
+    auto on_success = [this, &work_dir, map_work_dir, &args](mp::SSHInfoReply& reply) {
+        if (reply.ssh_info().empty())
+        {
+            cerr << "There are no running instances to run the command on\n";
+            return ReturnCode::CommandFail;
+        }
+
+        return exec_on_many(reply, work_dir, map_work_dir, args, term);
+    };
+
+    auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+
+    ssh_info_request.set_verbosity_level(parser->verbosityLevel());
+    return dispatch(&RpcMethod::ssh_info, ssh_info_request, on_success, on_failure);
+}
+
+mp::optional<std::string> cmd::Exec::query_mounted_work_dir(const std::string& instance_name, mp::ArgParser* parser)
+{
+    mp::optional<std::string> work_dir;
+    auto on_info_success = [&work_dir](mp::InfoReply& reply) {
+        work_dir = mounted_work_dir(reply.info(0).mount_info());
+        return ReturnCode::Ok;
+    };
+
+    auto on_info_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+
+    info_request.set_verbosity_level(parser->verbosityLevel());
+
+    InstanceNames instance_names;
+    auto info_instance_name = instance_names.add_instance_name();
+    info_instance_name->append(instance_name);
+    info_request.mutable_instance_names()->CopyFrom(instance_names);
+    info_request.set_no_runtime_information(true);
+
+    dispatch(&RpcMethod::info, info_request, on_info_success, on_info_failure);
+    // TODO: what to do with the returned value?
+
+    return work_dir;
+}
+
 mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
 {
     parser->addPositionalArgument("name", "Name of instance to execute the command on", "<name>");
@@ -188,9 +351,15 @@ mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
     QCommandLineOption workDirOption({"d", work_dir_option_name}, "Change to <dir> before execution", "dir");
     QCommandLineOption noDirMappingOption({"n", no_dir_mapping_option},
                                           "Do not map the host execution path to a mounted path");
+    QCommandLineOption instancesOption(instances_option_name,
+                                       "Run the command on each of these comma-separated instances at once, with "
+                                       "their output line by line behind their names. No <name> is given then",
+                                       "names");
+    QCommandLineOption allOption(all_option_name, "Run the command on all running instances at once, like --instances");
 
     parser->addOptions({workDirOption});
     parser->addOptions({noDirMappingOption});
+    parser->addOptions({instancesOption, allOption});
 
     auto status = parser->commandParse(this);
 
@@ -206,11 +375,31 @@ mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
         return status;
     }
 
+    const auto fan_out = parser->isSet(instances_option_name) || parser->isSet(all_option_name);
+
     if (parser->isSet(work_dir_option_name) && parser->isSet(no_dir_mapping_option))
     {
         cerr << fmt::format("Options --{} and --{} clash\n", work_dir_option_name, no_dir_mapping_option);
         status = ParseCode::CommandLineError;
     }
+    else if (parser->isSet(instances_option_name) && parser->isSet(all_option_name))
+    {
+        cerr << fmt::format("Options --{} and --{} clash\n", instances_option_name, all_option_name);
+        status = ParseCode::CommandLineError;
+    }
+    else if (fan_out)
+    {
+        if (parser->positionalArguments().isEmpty())
+        {
+            cerr << "Wrong number of arguments\n";
+            status = ParseCode::CommandLineError;
+        }
+
+        // No names at all asks the daemon for every running instance
+        if (parser->isSet(instances_option_name))
+            for (const auto& instance : parser->value(instances_option_name).split(',', QString::SkipEmptyParts))
+                ssh_info_request.add_instance_name(instance.toStdString());
+    }
     else if (parser->positionalArguments().count() < 2)
     {
         cerr << "Wrong number of arguments\n";
@@ -44,12 +44,17 @@ public:
 
     static ReturnCode exec_success(const SSHInfoReply& reply, const multipass::optional<std::string>& dir,
                                    const std::vector<std::string>& args, Terminal* term);
+    static ReturnCode exec_on_many(const SSHInfoReply& reply, const multipass::optional<std::string>& dir,
+                                   bool map_work_dir, const std::vector<std::string>& args, Terminal* term);
 
 private:
     SSHInfoRequest ssh_info_request;
     InfoRequest info_request;
     AliasDict aliases;
 
+    ReturnCode run_on_many(ArgParser* parser, const optional<std::string>& work_dir, bool map_work_dir,
+                           const std::vector<std::string>& args);
+    optional<std::string> query_mounted_work_dir(const std::string& instance_name, ArgParser* parser);
     ParseCode parse_args(ArgParser* parser);
 };
 } // namespace cmd
@@ -73,7 +73,7 @@ mp::ParseCode cmd::Find::parse_args(mp::ArgParser* parser)
     parser->addOptions({unsupportedOption});
 
     QCommandLineOption formatOption(
-        "format", "Output list in the requested format.\nValid formats are: table (default), json, csv and yaml",
+        "format", "Output list in the requested format.\nValid formats are: table (default), json, ndjson, csv and yaml",
         "format", "table");
 
     parser->addOption(formatOption);
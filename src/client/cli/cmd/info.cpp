@@ -70,7 +70,7 @@ mp::ParseCode cmd::Info::parse_args(mp::ArgParser* parser)
     parser->addOption(noRuntimeInfoOption);
 
     QCommandLineOption formatOption(
-        "format", "Output info in the requested format.\nValid formats are: table (default), json, csv and yaml",
+        "format", "Output info in the requested format.\nValid formats are: table (default), json, ndjson, csv and yaml",
         "format", "table");
     parser->addOption(formatOption);
 
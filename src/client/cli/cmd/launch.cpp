@@ -149,12 +149,15 @@ mp::ReturnCode cmd::Launch::run(mp::ArgParser* parser)
             }
         }
 
-        for (const auto& [source, target] : mount_routes)
+        for (const auto& instance_name : launched_names)
         {
-            auto mount_ret = mount(parser, source, target);
-            if (ret == ReturnCode::Ok)
+            for (const auto& [source, target] : mount_routes)
             {
-                ret = mount_ret;
+                auto mount_ret = mount(parser, instance_name, source, target);
+                if (ret == ReturnCode::Ok)
+                {
+                    ret = mount_ret;
+                }
             }
         }
     }
@@ -232,13 +235,32 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
                                      "You can also use a shortcut of \"<name>\" to mean \"name=<name>\".",
                                      "spec");
     QCommandLineOption bridgedOption("bridged", "Adds one `--network bridged` network.");
+    QCommandLineOption countOption("count", "Number of instances to launch at once, named after --name-prefix "
+                                            "when given. Default: 1.",
+                                   "count");
+    QCommandLineOption namePrefixOption("name-prefix",
+                                        "Name the launched instances with this prefix followed by a number.",
+                                        "prefix");
+    QCommandLineOption parallelOption("parallel", "Boot at most this many of the instances at a time. Default: all.",
+                                      "boots");
     QCommandLineOption mountOption("mount",
                                    "Mount a local directory inside the instance. If <instance-path> is omitted, the "
                                    "mount point will be the same as the absolute path of <local-path>",
                                    "local-path>:<instance-path");
-
-    parser->addOptions(
-        {cpusOption, diskOption, memOption, nameOption, cloudInitOption, networkOption, bridgedOption, mountOption});
+    QCommandLineOption storagePoolOption("storage-pool",
+                                         "Keep the instance's disk in this pool, out of those defined with "
+                                         "`multipass set local.storage-pools`. Default: the daemon's data directory.",
+                                         "pool");
+    QCommandLineOption fastBootOption("fast-boot", "Boot the kernel of the image directly, skipping the firmware. "
+                                                   "For throwaway instances, where time to SSH matters most.");
+    QCommandLineOption ephemeralOption("ephemeral",
+                                       "Delete the instance as soon as it stops, and never flush its disk to the "
+                                       "host's storage, which is then lost if the host crashes. For CI jobs.");
+    QCommandLineOption timingsOption("timings", "Show how long each phase of the launch took. Also shown with -vv.");
+
+    parser->addOptions({cpusOption, diskOption, memOption, nameOption, countOption, namePrefixOption, parallelOption,
+                        cloudInitOption, networkOption, bridgedOption, mountOption, storagePoolOption, fastBootOption,
+                        ephemeralOption, timingsOption});
 
     mp::cmd::add_timeout(parser);
 
@@ -290,6 +312,41 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
         request.set_instance_name(parser->value(nameOption).toStdString());
     }
 
+    for (const auto& [option, setter] : {std::make_pair(countOption, &LaunchRequest::set_count),
+                                         std::make_pair(parallelOption, &LaunchRequest::set_max_parallel_boots)})
+    {
+        if (parser->isSet(option))
+        {
+            bool conversion_pass;
+            const auto& text = parser->value(option);
+            const int value = text.toInt(&conversion_pass);
+
+            if (!conversion_pass || value < 1)
+            {
+                fmt::print(cerr, "error: Invalid --{} value '{}', need a positive integer value.\n",
+                           option.names().first(), text);
+                return ParseCode::CommandLineError;
+            }
+
+            (request.*setter)(value);
+        }
+    }
+
+    if (parser->isSet(namePrefixOption))
+        request.set_name_prefix(parser->value(namePrefixOption).toStdString());
+
+    if (parser->isSet(storagePoolOption))
+        request.set_storage_pool(parser->value(storagePoolOption).toStdString());
+
+    request.set_fast_boot(parser->isSet(fastBootOption));
+    request.set_ephemeral(parser->isSet(ephemeralOption));
+
+    if (parser->isSet(nameOption) && (request.count() > 1 || !request.name_prefix().empty()))
+    {
+        cerr << "error: --name cannot be combined with --count or --name-prefix\n";
+        return ParseCode::CommandLineError;
+    }
+
     if (parser->isSet(cpusOption))
     {
         bool conversion_pass;
@@ -394,6 +451,7 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
 
     request.set_time_zone(QTimeZone::systemTimeZoneId().toStdString());
     request.set_verbosity_level(parser->verbosityLevel());
+    show_timings = parser->isSet(timingsOption) || parser->verbosityLevel() >= 2;
 
     return status;
 }
@@ -418,9 +476,13 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
         if (timer)
             timer->pause();
 
-        cout << "Launched: " << reply.vm_instance_name() << "\n";
-        instance_name = QString::fromStdString(request.instance_name().empty() ? reply.vm_instance_name()
-                                                                               : request.instance_name());
+        if (!batch())
+        {
+            cout << "Launched: " << reply.vm_instance_name() << "\n";
+            print_timings(reply);
+            launched_names = {QString::fromStdString(request.instance_name().empty() ? reply.vm_instance_name()
+                                                                                     : request.instance_name())};
+        }
 
         if (term->is_live() && update_available(reply.update_info()))
         {
@@ -479,7 +541,8 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
             {LaunchProgress_ProgressTypes_INITRD, "Retrieving initrd image: "},
             {LaunchProgress_ProgressTypes_EXTRACT, "Extracting image: "},
             {LaunchProgress_ProgressTypes_VERIFY, "Verifying image: "},
-            {LaunchProgress_ProgressTypes_WAITING, "Preparing image: "}};
+            {LaunchProgress_ProgressTypes_WAITING, "Preparing image: "},
+            {LaunchProgress_ProgressTypes_PREPARE, "Converting image: "}};
 
         if (!reply.log_line().empty())
         {
@@ -509,15 +572,25 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
         else if (!reply.reply_message().empty())
         {
             spinner->stop();
-            spinner->start(reply.reply_message());
+            if (reply.queue_position() > 0)
+                spinner->start(fmt::format("{} ({} in line)", reply.reply_message(), reply.queue_position()));
+            else
+                spinner->start(reply.reply_message());
+        }
+        else if (batch() && reply.create_oneof_case() == mp::LaunchReply::CreateOneofCase::kVmInstanceName)
+        {
+            spinner->stop();
+            cout << "Launched: " << reply.vm_instance_name() << "\n";
+            print_timings(reply);
+            launched_names.push_back(QString::fromStdString(reply.vm_instance_name()));
         }
     };
 
     return dispatch(&RpcMethod::launch, request, on_success, on_failure, streaming_callback);
 }
 
-auto cmd::Launch::mount(const mp::ArgParser* parser, const QString& mount_source, const QString& mount_target)
-    -> ReturnCode
+auto cmd::Launch::mount(const mp::ArgParser* parser, const QString& instance_name, const QString& mount_source,
+                        const QString& mount_target) -> ReturnCode
 {
     const auto full_mount_target = QString{"%1:%2"}.arg(instance_name, mount_target);
     auto ret = run_cmd({"multipass", "mount", mount_source, full_mount_target}, parser, cout, cerr);
@@ -527,6 +600,20 @@ auto cmd::Launch::mount(const mp::ArgParser* parser, const QString& mount_source
     return ret;
 }
 
+bool cmd::Launch::batch() const
+{
+    return request.count() > 1 || !request.name_prefix().empty();
+}
+
+void cmd::Launch::print_timings(const LaunchReply& reply)
+{
+    if (!show_timings)
+        return;
+
+    for (const auto& phase : reply.launch_phases())
+        fmt::print(cout, "  {:<18} {:>8.2f}s\n", phase.name(), phase.seconds());
+}
+
 bool cmd::Launch::ask_bridge_permission(multipass::LaunchReply& reply)
 {
     static constexpr auto plural = "Multipass needs to create {} to connect to {}.\nThis will temporarily disrupt "
@@ -46,16 +46,20 @@ public:
 private:
     ParseCode parse_args(ArgParser* parser);
     ReturnCode request_launch(const ArgParser* parser);
-    ReturnCode mount(const ArgParser* parser, const QString& mount_source, const QString& mount_target);
+    ReturnCode mount(const ArgParser* parser, const QString& instance_name, const QString& mount_source,
+                     const QString& mount_target);
+    bool batch() const; // launching several instances from the one request
     bool ask_bridge_permission(multipass::LaunchReply& reply);
+    void print_timings(const LaunchReply& reply); // when asked to, after each launched instance
 
     LaunchRequest request;
     QString petenv_name;
     std::unique_ptr<multipass::AnimatedSpinner> spinner;
     std::unique_ptr<multipass::utils::Timer> timer;
+    bool show_timings{false};
 
     std::vector<std::pair<QString, QString>> mount_routes;
-    QString instance_name;
+    std::vector<QString> launched_names;
 };
 } // namespace cmd
 } // namespace multipass
@@ -32,8 +32,24 @@ mp::ReturnCode cmd::List::run(mp::ArgParser* parser)
         return parser->returnCodeFrom(ret);
     }
 
-    auto on_success = [this](ListReply& reply) {
-        cout << chosen_formatter->format(reply);
+    // Formatters that can print parts of the list have the daemon send what it knows without waiting for the rest
+    auto first_part = true;
+    auto on_part = [this, &first_part](ListReply& reply) {
+        if (!reply.log_line().empty())
+            cerr << reply.log_line();
+
+        if (request.incremental() && reply.instances_size())
+        {
+            cout << chosen_formatter->format_list_part(reply, first_part) << std::flush;
+            first_part = false;
+        }
+    };
+
+    auto on_success = [this, &first_part](ListReply& reply) {
+        if (!request.incremental())
+            cout << chosen_formatter->format(reply);
+        else if (first_part)
+            cout << chosen_formatter->format_list_part(reply, first_part);
 
         if (term->is_live() && update_available(reply.update_info()))
             cout << update_notice(reply.update_info());
@@ -44,7 +60,8 @@ mp::ReturnCode cmd::List::run(mp::ArgParser* parser)
     auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
 
     request.set_verbosity_level(parser->verbosityLevel());
-    return dispatch(&RpcMethod::list, request, on_success, on_failure);
+    request.set_incremental(chosen_formatter->streams_lists());
+    return dispatch(&RpcMethod::list, request, on_success, on_failure, on_part);
 }
 
 std::string cmd::List::name() const
@@ -70,7 +87,7 @@ QString cmd::List::description() const
 mp::ParseCode cmd::List::parse_args(mp::ArgParser* parser)
 {
     QCommandLineOption formatOption(
-        "format", "Output list in the requested format.\nValid formats are: table (default), json, csv and yaml",
+        "format", "Output list in the requested format.\nValid formats are: table (default), json, ndjson, csv and yaml",
         "format", "table");
 
     QCommandLineOption noIpv4Option("no-ipv4", "Do not query the instances for the IPv4's they are using");
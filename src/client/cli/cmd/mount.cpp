@@ -119,7 +119,17 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
                                     "<host> to <instance> inside the instance. Can be "
                                     "used multiple times.",
                                     "host>:<instance");
-    parser->addOptions({gid_mappings, uid_mappings});
+    QCommandLineOption mount_type_option({"t", "type"},
+                                         "Type of mount to use: 'classic' (the default) goes "
+                                         "through SSHFS, while 'native' uses the backend's own "
+                                         "file sharing, where supported.",
+                                         "type", "classic");
+    QCommandLineOption profile_option("profile",
+                                      "Tuning for classic mounts: 'default', 'bulk' for large "
+                                      "sequential copies, or 'metadata-heavy' for many small files "
+                                      "watched for changes.",
+                                      "profile", "default");
+    parser->addOptions({gid_mappings, uid_mappings, mount_type_option, profile_option});
 
     auto status = parser->commandParse(this);
     if (status != ParseCode::Ok)
@@ -176,6 +186,19 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
         }
     }
 
+    const auto mount_type = parser->value(mount_type_option);
+    if (mount_type == "classic")
+        request.set_mount_type(mp::MountRequest_MountType_CLASSIC);
+    else if (mount_type == "native")
+        request.set_mount_type(mp::MountRequest_MountType_NATIVE);
+    else
+    {
+        cerr << "Bad mount type '" << mount_type.toStdString() << "' specified, please use 'classic' or 'native'\n";
+        return ParseCode::CommandLineError;
+    }
+
+    request.set_profile(parser->value(profile_option).toStdString());
+
     QRegExp map_matcher("^([0-9]+[:][0-9]+)$");
 
     request.clear_mount_maps();
@@ -72,7 +72,7 @@ QString cmd::Networks::description() const
 mp::ParseCode cmd::Networks::parse_args(mp::ArgParser* parser)
 {
     QCommandLineOption formatOption(
-        "format", "Output list in the requested format.\nValid formats are: table (default), json, csv and yaml",
+        "format", "Output list in the requested format.\nValid formats are: table (default), json, ndjson, csv and yaml",
         "format", "table");
 
     parser->addOption(formatOption);
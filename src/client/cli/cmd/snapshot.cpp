@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "snapshot.h"
+#include "animated_spinner.h"
+#include "common_cli.h"
+
+#include <multipass/cli/argparser.h>
+#include <multipass/format.h>
+
+#include <algorithm>
+#include <map>
+
+namespace mp = multipass;
+namespace cmd = multipass::cmd;
+
+namespace
+{
+const std::map<QString, mp::SnapshotRequest::Action> actions{{"take", mp::SnapshotRequest::TAKE},
+                                                            {"restore", mp::SnapshotRequest::RESTORE},
+                                                            {"delete", mp::SnapshotRequest::DELETE},
+                                                            {"list", mp::SnapshotRequest::LIST}};
+
+std::string format_snapshots(const mp::SnapshotReply& reply)
+{
+    fmt::memory_buffer buf;
+    std::size_t name_width = 4; // as wide as the header
+    for (const auto& snapshot : reply.snapshots())
+        name_width = std::max(name_width, snapshot.name().size());
+
+    fmt::format_to(buf, "{:<{}}  {}\n", "Name", name_width, "Created");
+    for (const auto& snapshot : reply.snapshots())
+        fmt::format_to(buf, "{:<{}}  {}\n", snapshot.name(), name_width, snapshot.created());
+
+    return fmt::to_string(buf);
+}
+} // namespace
+
+mp::ReturnCode cmd::Snapshot::run(mp::ArgParser* parser)
+{
+    auto ret = parse_args(parser);
+    if (ret != ParseCode::Ok)
+    {
+        return parser->returnCodeFrom(ret);
+    }
+
+    AnimatedSpinner spinner{cout};
+
+    auto on_success = [this, &spinner](mp::SnapshotReply& reply) {
+        spinner.stop();
+        if (request.action() == SnapshotRequest::LIST)
+        {
+            if (reply.snapshots().empty())
+                cerr << fmt::format("No snapshots of {}.\n", request.instance_name());
+            else
+                cout << format_snapshots(reply);
+        }
+
+        return mp::ReturnCode::Ok;
+    };
+
+    auto on_failure = [this, &spinner](grpc::Status& status) {
+        spinner.stop();
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    auto streaming_callback = [this, &spinner](mp::SnapshotReply& reply) {
+        if (!reply.log_line().empty())
+            spinner.print(cerr, reply.log_line());
+
+        if (!reply.reply_message().empty())
+        {
+            spinner.stop();
+            cout << reply.reply_message() << "\n";
+        }
+    };
+
+    request.set_verbosity_level(parser->verbosityLevel());
+    if (request.action() != SnapshotRequest::LIST)
+        spinner.start(fmt::format("Working with snapshot {} of {}", request.snapshot_name(), request.instance_name()));
+
+    return dispatch(&RpcMethod::snapshot, request, on_success, on_failure, streaming_callback);
+}
+
+std::string cmd::Snapshot::name() const { return "snapshot"; }
+
+QString cmd::Snapshot::short_help() const
+{
+    return QStringLiteral("Take, restore, delete or list snapshots of an instance");
+}
+
+QString cmd::Snapshot::description() const
+{
+    return QStringLiteral("Take named snapshots of a stopped instance's disk, and bring the disk back to any of\n"
+                          "them later on, which is much quicker than launching a new instance. Snapshots are\n"
+                          "only taken, restored and deleted while the instance is stopped, and restoring one\n"
+                          "keeps those taken after it.");
+}
+
+mp::ParseCode cmd::Snapshot::parse_args(mp::ArgParser* parser)
+{
+    parser->addPositionalArgument("action", "One of take, restore, delete or list", "<action>");
+    parser->addPositionalArgument("instance", "Name of the instance", "<instance>");
+    parser->addPositionalArgument("snapshot", "Name of the snapshot, unless listing them", "[<snapshot>]");
+
+    auto status = parser->commandParse(this);
+    if (status != ParseCode::Ok)
+        return status;
+
+    const auto args = parser->positionalArguments();
+    auto action = args.isEmpty() ? actions.end() : actions.find(args.at(0));
+    if (action == actions.end())
+    {
+        cerr << "One of take, restore, delete or list is required\n";
+        return ParseCode::CommandLineError;
+    }
+
+    const auto expected = action->second == SnapshotRequest::LIST ? 2 : 3;
+    if (args.count() != expected)
+    {
+        cerr << (expected == 2 ? "Name of the instance is required\n"
+                               : "Name of the instance and of the snapshot are required\n");
+        return ParseCode::CommandLineError;
+    }
+
+    request.set_action(action->second);
+    request.set_instance_name(args.at(1).toStdString());
+    if (expected == 3)
+        request.set_snapshot_name(args.at(2).toStdString());
+
+    return status;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "top.h"
+#include "common_cli.h"
+
+#include <multipass/cli/argparser.h>
+#include <multipass/format.h>
+#include <multipass/memory_size.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+namespace cmd = multipass::cmd;
+
+namespace
+{
+constexpr auto clear_screen = "\x1b[H\x1b[2J";
+
+std::string human_readable(long long bytes)
+{
+    return mp::MemorySize::from_bytes(bytes).human_readable();
+}
+
+std::string format_usage(const mp::TopReply& reply)
+{
+    fmt::memory_buffer buf;
+    std::size_t name_width = 4; // as wide as the header
+    for (const auto& instance : reply.instances())
+        name_width = std::max(name_width, instance.name().size());
+
+    const auto row = "{:<{}}  {:>7}  {:>9}  {:>9}  {:>11}  {:>11}  {:>11}  {:>11}\n";
+    fmt::format_to(buf, row, "Name", name_width, "CPU", "Memory", "Balloon", "Disk read", "Disk write", "Net in",
+                   "Net out");
+
+    for (const auto& instance : reply.instances())
+        fmt::format_to(buf, row, instance.name(), name_width, fmt::format("{:.1f}%", instance.cpu_percent()),
+                       human_readable(instance.resident_bytes()),
+                       instance.balloon_bytes() ? human_readable(instance.balloon_bytes()) : "--",
+                       human_readable(instance.disk_read_bytes_per_second()) + "/s",
+                       human_readable(instance.disk_written_bytes_per_second()) + "/s",
+                       human_readable(instance.network_received_bytes_per_second()) + "/s",
+                       human_readable(instance.network_sent_bytes_per_second()) + "/s");
+
+    if (reply.instances().empty())
+        fmt::format_to(buf, "No running instances.\n");
+
+    return fmt::to_string(buf);
+}
+} // namespace
+
+mp::ReturnCode cmd::Top::run(mp::ArgParser* parser)
+{
+    auto ret = parse_args(parser);
+    if (ret != ParseCode::Ok)
+    {
+        return parser->returnCodeFrom(ret);
+    }
+
+    auto on_success = [](mp::TopReply& reply) { return mp::ReturnCode::Ok; };
+
+    auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+
+    // Each update takes the place of the last one, on a terminal
+    auto streaming_callback = [this](mp::TopReply& reply) {
+        if (!reply.log_line().empty())
+        {
+            cerr << reply.log_line();
+            return;
+        }
+
+        if (term->cout_is_live())
+            cout << clear_screen;
+        cout << format_usage(reply) << std::flush;
+    };
+
+    request.set_verbosity_level(parser->verbosityLevel());
+    return dispatch(&RpcMethod::top, request, on_success, on_failure, streaming_callback);
+}
+
+std::string cmd::Top::name() const { return "top"; }
+
+QString cmd::Top::short_help() const
+{
+    return QStringLiteral("Show what running instances use, as it happens");
+}
+
+QString cmd::Top::description() const
+{
+    return QStringLiteral("Show what running instances use of the host's CPU, memory, disk and network, updated\n"
+                          "every second or as often as asked. The numbers come from the host, without going\n"
+                          "into the instances, and rates are over the time since the previous update.");
+}
+
+mp::ParseCode cmd::Top::parse_args(mp::ArgParser* parser)
+{
+    parser->addPositionalArgument("name", "Names of instances to show. Default: all running ones", "[<name> ...]");
+
+    QCommandLineOption interval_option("interval", "Seconds between updates. Default: 1", "seconds");
+    QCommandLineOption once_option("once", "Show a single update, over one interval, and exit");
+    parser->addOptions({interval_option, once_option});
+
+    auto status = parser->commandParse(this);
+    if (status != ParseCode::Ok)
+        return status;
+
+    if (parser->isSet(interval_option))
+    {
+        bool ok = false;
+        const auto seconds = parser->value(interval_option).toInt(&ok);
+        if (!ok || seconds < 1)
+        {
+            cerr << "error: the interval must be a positive number of seconds\n";
+            return ParseCode::CommandLineError;
+        }
+
+        request.set_interval_ms(seconds * 1000);
+    }
+
+    if (parser->isSet(once_option))
+        request.set_updates(1);
+
+    for (const auto& arg : parser->positionalArguments())
+        request.add_instance_names(arg.toStdString());
+
+    return status;
+}
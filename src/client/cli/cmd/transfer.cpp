@@ -23,6 +23,10 @@
 #include <multipass/ssh/sftp_client.h>
 
 #include <QFileInfo>
+#include <QHostAddress>
+
+#include <map>
+#include <memory>
 
 namespace mp = multipass;
 namespace cmd = multipass::cmd;
@@ -31,6 +35,19 @@ namespace mcp = multipass::cli::platform;
 namespace
 {
 const char streaming_symbol{'-'};
+
+// Compression costs more than it saves on the host's own network, but pays off once the daemon is a hop away
+bool daemon_is_remote()
+{
+    const auto address = QString::fromStdString(mp::client::get_server_address());
+    if (address.startsWith("unix:"))
+        return false;
+
+    auto host = address.left(address.lastIndexOf(':'));
+    host.remove('[').remove(']');
+
+    return host != "localhost" && !QHostAddress{host}.isLoopback();
+}
 } // namespace
 
 mp::ReturnCode cmd::Transfer::run(mp::ArgParser* parser)
@@ -47,27 +64,25 @@ mp::ReturnCode cmd::Transfer::run(mp::ArgParser* parser)
         if (reply.ssh_info().empty())
             return ReturnCode::Ok;
 
+        // One connection per instance serves every path involving it, rather than one per path
+        std::map<std::string, std::unique_ptr<mp::SFTPClient>> sftp_clients;
         for (const auto& source : sources)
         {
-            mp::SSHInfo ssh_info;
-            if (!source.first.empty())
-            {
-                ssh_info = reply.ssh_info().find(source.first)->second;
-            }
-            else if (!destination.first.empty())
-            {
-                ssh_info = reply.ssh_info().find(destination.first)->second;
-            }
-
-            auto host = ssh_info.host();
-            auto port = ssh_info.port();
-            auto username = ssh_info.username();
-            auto priv_key_blob = ssh_info.priv_key_base64();
+            const auto& instance_name = source.first.empty() ? destination.first : source.first;
 
             try
             {
-                mp::SFTPClient sftp_client{host, port, username, priv_key_blob};
+                auto& sftp_client_ptr = sftp_clients[instance_name];
+                if (!sftp_client_ptr)
+                {
+                    const auto& ssh_info = reply.ssh_info().find(instance_name)->second;
+                    sftp_client_ptr = std::make_unique<mp::SFTPClient>(ssh_info.host(), ssh_info.port(),
+                                                                       ssh_info.username(),
+                                                                       ssh_info.priv_key_base64(), compression);
+                    sftp_client_ptr->set_sync(sync);
+                }
 
+                auto& sftp_client = *sftp_client_ptr;
                 if (streaming_enabled)
                 {
                     if (destination.first.empty())
@@ -75,10 +90,17 @@ mp::ReturnCode cmd::Transfer::run(mp::ArgParser* parser)
                     else
                         sftp_client.stream_file(destination.second, term->cin());
                 }
-                else
+                else if (!destination.first.empty())
                 {
-                    if (!destination.first.empty())
+                    if (recursive && QFileInfo{QString::fromStdString(source.second)}.isDir())
+                        sftp_client.push_dir(source.second, destination.second);
+                    else
                         sftp_client.push_file(source.second, destination.second);
+                }
+                else
+                {
+                    if (recursive && sftp_client.is_dir(source.second))
+                        sftp_client.pull_dir(source.second, destination.second);
                     else
                         sftp_client.pull_file(source.second, destination.second);
                 }
@@ -115,9 +137,8 @@ QString cmd::Transfer::short_help() const
 
 QString cmd::Transfer::description() const
 {
-    // TODO: Don't mention directories until we support that
-    // return QStringLiteral("Copy files and directories between the host and instances.");
-    return QStringLiteral("Copy files between the host and instances.");
+    return QStringLiteral("Copy files and directories between the host and instances.\n"
+                          "Directories are only copied with --recursive.");
 }
 
 mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
@@ -131,6 +152,15 @@ mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
                                   "a path inside the instance, or '-' for stdout",
                                   "<destination>");
 
+    QCommandLineOption recursive_option({"r", "recursive"}, "Copy directories and their contents");
+    QCommandLineOption sync_option("sync", "Only copy files whose destination differs in size, modification "
+                                           "time and contents, and give copies their source's modification time");
+    QCommandLineOption compression_option("compression",
+                                          "Compress the traffic: 'yes', 'no' or 'auto' (the default), which "
+                                          "compresses when the daemon is on another machine",
+                                          "mode", "auto");
+    parser->addOptions({recursive_option, sync_option, compression_option});
+
     auto status = parser->commandParse(this);
     if (status != ParseCode::Ok)
         return status;
@@ -141,6 +171,18 @@ mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
         return ParseCode::CommandLineError;
     }
 
+    recursive = parser->isSet(recursive_option);
+    sync = parser->isSet(sync_option);
+
+    const auto compression_mode = parser->value(compression_option);
+    if (compression_mode != "yes" && compression_mode != "no" && compression_mode != "auto")
+    {
+        cerr << fmt::format("Invalid compression mode \"{}\", must be 'yes', 'no' or 'auto'\n", compression_mode);
+        return ParseCode::CommandLineError;
+    }
+
+    compression = compression_mode == "auto" ? daemon_is_remote() : compression_mode == "yes";
+
     const auto& args = parser->positionalArguments();
     const auto num_streaming_symbols = std::count(std::begin(args), std::end(args), streaming_symbol);
     const bool allow_streaming = (args.count() == 2);
@@ -157,6 +199,12 @@ mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
         return ParseCode::CommandLineError;
     }
 
+    if (num_streaming_symbols && (recursive || sync))
+    {
+        cerr << fmt::format("Cannot use '{}' with --recursive or --sync\n", streaming_symbol);
+        return ParseCode::CommandLineError;
+    }
+
     const auto source_code = parse_sources(parser);
     if (ParseCode::Ok != source_code)
         return source_code;
@@ -205,9 +253,15 @@ mp::ParseCode cmd::Transfer::parse_sources(mp::ArgParser* parser)
                 return ParseCode::CommandLineError;
             }
 
-            if (!source.isFile())
+            if (source.isDir() && !recursive)
+            {
+                cerr << fmt::format("Source path \"{}\" is a directory, use --recursive to copy it\n", source_path);
+                return ParseCode::CommandLineError;
+            }
+
+            if (!source.isFile() && !source.isDir())
             {
-                cerr << "Source path must be a file\n";
+                cerr << "Source path must be a file or a directory\n";
                 return ParseCode::CommandLineError;
             }
 
@@ -43,6 +43,9 @@ private:
     std::vector<std::pair<std::string, std::string>> sources;
     std::pair<std::string, std::string> destination;
     bool streaming_enabled;
+    bool recursive;
+    bool sync;
+    bool compression;
 
     ParseCode parse_args(ArgParser* parser);
     ParseCode parse_sources(ArgParser* parser);
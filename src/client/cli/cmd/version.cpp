@@ -72,7 +72,7 @@ mp::ParseCode cmd::Version::parse_args(mp::ArgParser* parser)
 {
     QCommandLineOption formatOption("format",
                                     "Output version information in the requested format.\n"
-                                    "Valid formats are: table (default), json, csv and yaml",
+                                    "Valid formats are: table (default), json, ndjson, csv and yaml",
                                     "format", "table");
 
     parser->addOption(formatOption);
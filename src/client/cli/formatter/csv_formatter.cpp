@@ -49,10 +49,21 @@ std::string mp::CSVFormatter::format(const InfoReply& reply) const
 }
 
 std::string mp::CSVFormatter::format(const ListReply& reply) const
+{
+    return format_list_part(reply, true);
+}
+
+bool mp::CSVFormatter::streams_lists() const
+{
+    return true;
+}
+
+std::string mp::CSVFormatter::format_list_part(const ListReply& reply, bool first_part) const
 {
     fmt::memory_buffer buf;
 
-    fmt::format_to(buf, "Name,State,IPv4,IPv6,Release,AllIPv4\n");
+    if (first_part)
+        fmt::format_to(buf, "Name,State,IPv4,IPv6,Release,AllIPv4\n");
 
     for (const auto& instance : format::sorted(reply.instances()))
     {
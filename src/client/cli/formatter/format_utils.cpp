@@ -38,6 +38,7 @@ auto make_map()
     std::map<std::string, std::unique_ptr<mp::Formatter>> map;
     map.emplace("table", make_entry<mp::TableFormatter>());
     map.emplace("json", make_entry<mp::JsonFormatter>());
+    map.emplace("ndjson", std::make_unique<mp::JsonFormatter>(mp::JsonFormatter::Layout::lines));
     map.emplace("csv", make_entry<mp::CSVFormatter>());
     map.emplace("yaml", make_entry<mp::YamlFormatter>());
     return map;
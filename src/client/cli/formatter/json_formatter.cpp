@@ -27,6 +27,51 @@
 
 namespace mp = multipass;
 
+namespace
+{
+std::string compact_line(const QJsonObject& object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact).toStdString() + '\n';
+}
+
+std::string lines_from(const QJsonArray& entries)
+{
+    std::string lines;
+    for (const auto& entry : entries)
+        lines += compact_line(entry.toObject());
+
+    return lines;
+}
+
+// Entries keyed by name in documents carry their name inside each line instead
+std::string lines_from(const QJsonObject& entries, const QString& key_name)
+{
+    std::string lines;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+    {
+        auto entry = it.value().toObject();
+        entry.insert(key_name, it.key());
+        lines += compact_line(entry);
+    }
+
+    return lines;
+}
+} // namespace
+
+mp::JsonFormatter::JsonFormatter(Layout layout) : layout{layout}
+{
+}
+
+bool mp::JsonFormatter::streams_lists() const
+{
+    return layout == Layout::lines;
+}
+
+std::string mp::JsonFormatter::format_list_part(const ListReply& reply, bool /*first_part*/) const
+{
+    return format(reply);
+}
+
 std::string mp::JsonFormatter::format(const InfoReply& reply) const
 {
     QJsonObject info_json;
@@ -74,6 +119,9 @@ std::string mp::JsonFormatter::format(const InfoReply& reply) const
             ipv4_addrs.append(QString::fromStdString(ip));
         instance_info.insert("ipv4", ipv4_addrs);
 
+        if (!info.runtime_info_timestamp().empty())
+            instance_info.insert("runtime_info_timestamp", QString::fromStdString(info.runtime_info_timestamp()));
+
         QJsonObject mounts;
         for (const auto& mount : info.mount_info().mount_paths())
         {
@@ -117,6 +165,9 @@ std::string mp::JsonFormatter::format(const InfoReply& reply) const
     }
     info_json.insert("info", info_obj);
 
+    if (layout == Layout::lines)
+        return lines_from(info_obj, "name");
+
     return QString(QJsonDocument(info_json).toJson()).toStdString();
 }
 
@@ -143,6 +194,9 @@ std::string mp::JsonFormatter::format(const ListReply& reply) const
 
     list_json.insert("list", instances);
 
+    if (layout == Layout::lines)
+        return lines_from(instances);
+
     return QString(QJsonDocument(list_json).toJson()).toStdString();
 }
 
@@ -163,6 +217,9 @@ std::string mp::JsonFormatter::format(const NetworksReply& reply) const
 
     list_json.insert("list", interfaces);
 
+    if (layout == Layout::lines)
+        return lines_from(interfaces);
+
     return QString(QJsonDocument(list_json).toJson()).toStdString();
 }
 
@@ -197,6 +254,9 @@ std::string mp::JsonFormatter::format(const FindReply& reply) const
 
     find_json.insert("images", images);
 
+    if (layout == Layout::lines)
+        return lines_from(images, "image");
+
     return QString(QJsonDocument(find_json).toJson()).toStdString();
 }
 
@@ -220,6 +280,10 @@ std::string mp::JsonFormatter::format(const VersionReply& reply, const std::stri
             version_json.insert("update", update);
         }
     }
+
+    if (layout == Layout::lines)
+        return compact_line(version_json);
+
     return QString(QJsonDocument(version_json).toJson()).toStdString();
 }
 
@@ -244,5 +308,8 @@ std::string mp::JsonFormatter::format(const mp::AliasDict& aliases) const
 
     aliases_json.insert("aliases", aliases_array);
 
+    if (layout == Layout::lines)
+        return lines_from(aliases_array);
+
     return QString(QJsonDocument(aliases_json).toJson()).toStdString();
 }
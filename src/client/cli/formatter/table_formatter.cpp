@@ -85,6 +85,8 @@ std::string mp::TableFormatter::format(const InfoReply& reply) const
         fmt::format_to(buf, "{:<16}{}\n", "Load:", info.load().empty() ? "--" : info.load());
         fmt::format_to(buf, "{:<16}{}\n", "Disk usage:", to_usage(info.disk_usage(), info.disk_total()));
         fmt::format_to(buf, "{:<16}{}\n", "Memory usage:", to_usage(info.memory_usage(), info.memory_total()));
+        if (!info.runtime_info_timestamp().empty())
+            fmt::format_to(buf, "{:<16}{}\n", "Metrics as of:", info.runtime_info_timestamp());
 
         auto mount_paths = info.mount_info().mount_paths();
         fmt::format_to(buf, "{:<16}{}", "Mounts:", mount_paths.empty() ? "--\n" : "");
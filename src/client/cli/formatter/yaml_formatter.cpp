@@ -87,6 +87,9 @@ std::string mp::YamlFormatter::format(const InfoReply& reply) const
         for (const auto& ip : info.ipv4())
             instance_node["ipv4"].push_back(ip);
 
+        if (!info.runtime_info_timestamp().empty())
+            instance_node["runtime_info_timestamp"] = info.runtime_info_timestamp();
+
         YAML::Node mounts;
         for (const auto& mount : info.mount_info().mount_paths())
         {
@@ -50,8 +50,6 @@ mp::AliasDict::AliasDict(mp::Terminal* term) : cout(term->cout()), cerr(term->ce
     const auto cli_client_dir_path = QDir{user_config_path.absoluteFilePath(mp::client_name)};
 
     aliases_file = cli_client_dir_path.absoluteFilePath(file_name).toStdString();
-
-    load_dict();
 }
 
 mp::AliasDict::~AliasDict()
@@ -71,6 +69,8 @@ mp::AliasDict::~AliasDict()
 
 void mp::AliasDict::add_alias(const std::string& alias, const mp::AliasDefinition& command)
 {
+    load_dict_once();
+
     if (aliases.try_emplace(alias, command).second)
     {
         modified = true;
@@ -79,6 +79,8 @@ void mp::AliasDict::add_alias(const std::string& alias, const mp::AliasDefinitio
 
 bool mp::AliasDict::remove_alias(const std::string& alias)
 {
+    load_dict_once();
+
     if (aliases.erase(alias) > 0)
     {
         modified = true;
@@ -90,6 +92,8 @@ bool mp::AliasDict::remove_alias(const std::string& alias)
 
 std::vector<std::string> mp::AliasDict::remove_aliases_for_instance(const std::string& instance)
 {
+    load_dict_once();
+
     std::vector<std::string> removed_aliases;
 
     for (auto it = aliases.begin(); it != aliases.end();)
@@ -109,6 +113,8 @@ std::vector<std::string> mp::AliasDict::remove_aliases_for_instance(const std::s
 
 mp::optional<mp::AliasDefinition> mp::AliasDict::get_alias(const std::string& alias) const
 {
+    load_dict_once();
+
     try
     {
         return aliases.at(alias);
@@ -119,7 +125,16 @@ mp::optional<mp::AliasDefinition> mp::AliasDict::get_alias(const std::string& al
     }
 }
 
-void mp::AliasDict::load_dict()
+void mp::AliasDict::load_dict_once() const
+{
+    if (!loaded)
+    {
+        load_dict();
+        loaded = true;
+    }
+}
+
+void mp::AliasDict::load_dict() const
 {
     QFile db_file{QString::fromStdString(aliases_file)};
 
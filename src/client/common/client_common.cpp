@@ -35,6 +35,15 @@
 
 #include <QKeySequence>
 
+#include <grpc/grpc_security_constants.h>
+#include <grpcpp/security/credentials.h>
+
+#include <cstring>
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+#include <unistd.h>
+#endif
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -124,6 +133,24 @@ std::shared_ptr<grpc::Channel> create_channel_and_validate(const std::string& se
     }
 }
 
+// Clients running as the daemon's user can opt into the socket that only that user can reach, and skip TLS
+std::shared_ptr<grpc::Channel> create_local_channel(const std::string& server_address)
+{
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    return nullptr;
+#else
+    if (qgetenv("MULTIPASS_LOCAL_TRANSPORT") != "1")
+        return nullptr;
+
+    // Being able to connect is what authenticates the client, so check that first, and fall back to TLS otherwise
+    const auto local_address = mp::utils::local_server_address(server_address);
+    if (local_address.empty() || ::access(local_address.substr(std::strlen("unix:")).c_str(), R_OK | W_OK) != 0)
+        return nullptr;
+
+    return grpc::CreateChannel(local_address, grpc::experimental::LocalCredentials(UDS));
+#endif
+}
+
 bool client_certs_exist(const QString& cert_dir_path)
 {
     QDir cert_dir{cert_dir_path};
@@ -195,6 +222,9 @@ void mp::client::register_global_settings_handlers()
 std::shared_ptr<grpc::Channel> mp::client::make_channel(const std::string& server_address,
                                                         mp::CertProvider* cert_provider)
 {
+    if (auto local_channel = create_local_channel(server_address))
+        return local_channel;
+
     // No common client certificates exist yet.
     // TODO: Remove the following logic when we are comfortable all installed clients are using the common cert
     if (!cert_provider)
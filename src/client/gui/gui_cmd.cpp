@@ -38,6 +38,8 @@ using namespace std::chrono_literals;
 
 namespace
 {
+constexpr auto watch_retry_interval = 5s;
+
 auto set_title_string_for(const std::string& text, const mp::InstanceStatus& state)
 {
     return QString::fromStdString(fmt::format("{}{}", text,
@@ -148,6 +150,10 @@ void cmd::GuiCmd::create_actions()
         update_hotkey();
         autostart_option.setChecked(MP_SETTINGS.get_as<bool>(autostart_key));
 
+        // The primary instance may have changed, which no instance event would tell
+        if (!menu_update_timer.isActive())
+            update_menu(watched_instances);
+
         // Needed since the original watched file may be removed and opened as a new file
         if (!config_watcher.files().contains(path) && QFile::exists(path))
         {
@@ -172,12 +178,10 @@ void cmd::GuiCmd::create_actions()
     });
 }
 
-void cmd::GuiCmd::update_menu()
+void cmd::GuiCmd::update_menu(const ListReply& reply)
 {
     std::vector<std::string> instances_to_remove;
 
-    auto reply = list_future.result();
-
     handle_petenv_instance(reply.instances());
 
     for (auto it = instances_entries.cbegin(); it != instances_entries.cend(); ++it)
@@ -279,12 +283,15 @@ void cmd::GuiCmd::create_menu()
 
     tray_icon.setIcon(QIcon{":images/multipass-icon.png"});
 
-    QObject::connect(&list_watcher, &QFutureWatcher<ListReply>::finished, this, &GuiCmd::update_menu);
+    QObject::connect(&list_watcher, &QFutureWatcher<ListReply>::finished, this,
+                     [this] { update_menu(list_future.result()); });
+    QObject::connect(&watch_watcher, &QFutureWatcher<grpc::Status>::finished, this, &GuiCmd::on_watch_ended);
 
     QObject::connect(&menu_update_timer, &QTimer::timeout, this, [this] { initiate_menu_layout(); });
 
     // Use a singleShot here to make sure the event loop is running before the quit() runs
     QObject::connect(quit_action, &QAction::triggered, [this] {
+        stop_watching();
         future_synchronizer.waitForFinished();
         QTimer::singleShot(0, [] { QCoreApplication::quit(); });
     });
@@ -310,10 +317,9 @@ void cmd::GuiCmd::create_menu()
 
     tray_icon_menu.insertMenu(quit_action, &about_menu);
 
-    initiate_menu_layout();
+    start_watching();
     initiate_about_menu_layout();
 
-    menu_update_timer.start(1s);
     about_update_timer.start(24h);
 }
 
@@ -364,6 +370,95 @@ mp::ListReply cmd::GuiCmd::retrieve_all_instances()
     return list_reply;
 }
 
+void cmd::GuiCmd::start_watching()
+{
+    if (failure_action.isVisible())
+    {
+        tray_icon_menu.removeAction(&failure_action);
+    }
+
+    watched_instances.Clear(); // the stream starts over with every instance's current state
+
+    watch_future = QtConcurrent::run(this, &GuiCmd::watch_instances);
+    future_synchronizer.addFuture(watch_future);
+    watch_watcher.setFuture(watch_future);
+}
+
+void cmd::GuiCmd::stop_watching()
+{
+    std::lock_guard<std::mutex> lock{watch_mutex};
+
+    quitting = true;
+    if (watch_context)
+        watch_context->TryCancel();
+}
+
+grpc::Status cmd::GuiCmd::watch_instances()
+{
+    grpc::ClientContext context;
+    {
+        std::lock_guard<std::mutex> lock{watch_mutex};
+        if (quitting)
+            return grpc::Status::CANCELLED;
+
+        watch_context = &context;
+    }
+
+    WatchReply reply;
+    auto reader = stub->watch(&context, WatchRequest{});
+
+    // The menu belongs to the GUI thread, so events are handed over to it rather than applied here
+    while (reader->Read(&reply))
+        QMetaObject::invokeMethod(this, [this, reply] { apply_watch_event(reply); }, Qt::QueuedConnection);
+
+    auto status = reader->Finish();
+
+    std::lock_guard<std::mutex> lock{watch_mutex};
+    watch_context = nullptr;
+
+    return status;
+}
+
+void cmd::GuiCmd::apply_watch_event(const WatchReply& event)
+{
+    if (!event.has_instance_status())
+        return; // the menu shows neither mounts nor addresses
+
+    auto instances = watched_instances.mutable_instances();
+    auto it = std::find_if(instances->begin(), instances->end(),
+                           [&event](const ListVMInstance& instance) { return instance.name() == event.instance_name(); });
+
+    auto instance = it != instances->end() ? &*it : watched_instances.add_instances();
+    instance->set_name(event.instance_name());
+    *instance->mutable_instance_status() = event.instance_status();
+
+    update_menu(watched_instances);
+}
+
+void cmd::GuiCmd::on_watch_ended()
+{
+    const auto status = watch_future.result();
+
+    if (quitting)
+        return;
+
+    if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED)
+    {
+        // Older daemons only tell about instances when asked
+        initiate_menu_layout();
+        menu_update_timer.start(1s);
+        return;
+    }
+
+    if (!status.ok())
+    {
+        standard_failure_handler_for(name(), cerr, status);
+        tray_icon_menu.insertAction(about_separator, &failure_action);
+    }
+
+    QTimer::singleShot(watch_retry_interval, this, [this] { start_watching(); });
+}
+
 void cmd::GuiCmd::create_menu_actions_for(const std::string& instance_name, const mp::InstanceStatus& state)
 {
     auto& instance_menu = instances_entries[instance_name].menu =
@@ -31,6 +31,7 @@
 #include <QHotkey>
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -65,11 +66,16 @@ public:
 private:
     void create_actions();
     void create_menu();
-    void update_menu();
+    void update_menu(const ListReply& reply);
     void update_about_menu();
     void initiate_menu_layout();
     void initiate_about_menu_layout();
     ListReply retrieve_all_instances();
+    void start_watching();
+    void stop_watching();
+    grpc::Status watch_instances();
+    void apply_watch_event(const WatchReply& event);
+    void on_watch_ended();
     void create_menu_actions_for(const std::string& instance_name, const InstanceStatus& state);
     void handle_petenv_instance(const google::protobuf::RepeatedPtrField<ListVMInstance>&);
     void start_instance_for(const std::string& instance_name);
@@ -109,6 +115,14 @@ private:
     QFuture<ListReply> list_future;
     QFutureWatcher<ListReply> list_watcher;
 
+    // The menu follows the daemon's instance events; it falls back to polling list when the daemon cannot stream them
+    ListReply watched_instances;
+    QFuture<grpc::Status> watch_future;
+    QFutureWatcher<grpc::Status> watch_watcher;
+    std::mutex watch_mutex;
+    grpc::ClientContext* watch_context{nullptr};
+    bool quitting{false};
+
     QFuture<VersionReply> version_future;
     QFutureWatcher<VersionReply> version_watcher;
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "admission_control.h"
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+namespace
+{
+bool within(long long limit, long long amount)
+{
+    return limit <= 0 || amount <= limit;
+}
+} // namespace
+
+mp::AdmissionControl::Ticket::Ticket(AdmissionControl& admission, std::uint64_t id)
+    : admission{admission}, id{id}, queued_at{std::chrono::steady_clock::now()}
+{
+}
+
+mp::AdmissionControl::Ticket::~Ticket()
+{
+    auto& queue = admission.queue;
+    queue.erase(std::remove(queue.begin(), queue.end(), id), queue.end());
+}
+
+std::size_t mp::AdmissionControl::Ticket::position() const
+{
+    const auto& queue = admission.queue;
+    return std::find(queue.begin(), queue.end(), id) - queue.begin() + 1;
+}
+
+std::chrono::steady_clock::duration mp::AdmissionControl::Ticket::waited() const
+{
+    return std::chrono::steady_clock::now() - queued_at;
+}
+
+mp::AdmissionControl::AdmissionControl(const Limits& limits) : limits{limits}
+{
+}
+
+bool mp::AdmissionControl::enabled() const
+{
+    return limits.cores > 0 || limits.memory_bytes > 0 || limits.boots > 0;
+}
+
+bool mp::AdmissionControl::ever_fits(const Reservation& demand) const
+{
+    return fits(demand, {});
+}
+
+bool mp::AdmissionControl::fits(const Reservation& demand, const Reservation& reserved) const
+{
+    return within(limits.cores, reserved.cores + demand.cores) &&
+           within(limits.memory_bytes, reserved.memory_bytes + demand.memory_bytes) &&
+           within(limits.boots, reserved.boots + demand.boots);
+}
+
+bool mp::AdmissionControl::is_turn_of(const Ticket* ticket) const
+{
+    return queue.empty() || (ticket && queue.front() == ticket->id);
+}
+
+auto mp::AdmissionControl::enqueue() -> std::shared_ptr<Ticket>
+{
+    queue.push_back(next_id);
+    return std::shared_ptr<Ticket>{new Ticket{*this, next_id++}};
+}
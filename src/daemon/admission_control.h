@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_ADMISSION_CONTROL_H
+#define MULTIPASS_ADMISSION_CONTROL_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace multipass
+{
+// What instances take of the host while they run, and boot
+struct Reservation
+{
+    int cores{0};
+    long long memory_bytes{0};
+    int boots{0}; // a stand-in for disk I/O, which booting is the heaviest on
+
+    Reservation& operator+=(const Reservation& other)
+    {
+        cores += other.cores;
+        memory_bytes += other.memory_bytes;
+        boots += other.boots;
+        return *this;
+    }
+};
+
+/**
+ * Keeps the instances that boot from taking more of the host than it is configured to give them, so that a burst of
+ * launches queues up instead of pushing the host into swap. Launches wait their turn first come, first served, and
+ * nothing ever fits that would not fit on an otherwise idle host.
+ */
+class AdmissionControl : private DisabledCopyMove
+{
+public:
+    using Limits = Reservation; // 0 for no limit
+
+    // A place in the queue, which it leaves when it goes away
+    class Ticket : private DisabledCopyMove
+    {
+    public:
+        ~Ticket();
+
+        std::size_t position() const; // from 1
+        std::chrono::steady_clock::duration waited() const;
+
+    private:
+        friend class AdmissionControl;
+        Ticket(AdmissionControl& admission, std::uint64_t id);
+
+        AdmissionControl& admission;
+        const std::uint64_t id;
+        const std::chrono::steady_clock::time_point queued_at;
+    };
+
+    explicit AdmissionControl(const Limits& limits);
+
+    bool enabled() const;
+    bool ever_fits(const Reservation& demand) const;
+    bool fits(const Reservation& demand, const Reservation& reserved) const;
+    bool is_turn_of(const Ticket* ticket) const; // no ticket is only the turn of launches when nobody is queued
+
+    std::shared_ptr<Ticket> enqueue();
+
+private:
+    const Limits limits;
+    std::deque<std::uint64_t> queue;
+    std::uint64_t next_id{0};
+};
+} // namespace multipass
+
+#endif // MULTIPASS_ADMISSION_CONTROL_H
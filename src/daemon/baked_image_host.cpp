@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "baked_image_host.h"
+
+#include <multipass/format.h>
+#include <multipass/query.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto info_file_name = "info.json";
+
+mp::optional<mp::VMImageInfo> read_info(const QDir& image_dir)
+{
+    QFile file{image_dir.filePath(info_file_name)};
+    if (!file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    const auto json = QJsonDocument::fromJson(file.readAll()).object();
+    const auto id = json["id"].toString();
+    if (id.isEmpty())
+        return mp::nullopt;
+
+    const auto name = image_dir.dirName();
+    return mp::VMImageInfo{{name},
+                           json["os"].toString(),
+                           name,
+                           json["release_title"].toString(),
+                           true,
+                           json["image_location"].toString(),
+                           json["kernel_location"].toString(),
+                           json["initrd_location"].toString(),
+                           id,
+                           {},
+                           json["version"].toString(),
+                           json["size"].toVariant().toLongLong(),
+                           false};
+}
+
+bool matches(const mp::Query& query, const mp::VMImageInfo& info)
+{
+    return query.release == info.release.toStdString() || query.release == info.id.toStdString();
+}
+} // namespace
+
+mp::BakedVMImageHost::BakedVMImageHost(const QDir& baked_dir) : baked_dir{baked_dir}
+{
+}
+
+mp::optional<mp::VMImageInfo> mp::BakedVMImageHost::info_for(const Query& query)
+{
+    auto images = all_info_for(query);
+    if (images.empty())
+        return nullopt;
+
+    return images.front().second;
+}
+
+std::vector<std::pair<std::string, mp::VMImageInfo>> mp::BakedVMImageHost::all_info_for(const Query& query)
+{
+    std::vector<std::pair<std::string, VMImageInfo>> images;
+    if (!query.remote_name.empty() && query.remote_name != remote_name)
+        return images;
+
+    for (auto& info : baked_images())
+        if (matches(query, info))
+            images.emplace_back(remote_name, std::move(info));
+
+    return images;
+}
+
+mp::VMImageInfo mp::BakedVMImageHost::info_for_full_hash(const std::string& full_hash)
+{
+    const auto images = baked_images();
+    auto it = std::find_if(images.cbegin(), images.cend(),
+                           [&full_hash](const auto& info) { return info.id.toStdString() == full_hash; });
+    if (it == images.cend())
+        throw std::runtime_error(fmt::format("Cannot find a baked image with hash {}", full_hash));
+
+    return *it;
+}
+
+std::vector<mp::VMImageInfo> mp::BakedVMImageHost::all_images_for(const std::string& remote_name,
+                                                                  const bool allow_unsupported)
+{
+    return baked_images();
+}
+
+void mp::BakedVMImageHost::for_each_entry_do(const Action& action)
+{
+    for (const auto& info : baked_images())
+        action(remote_name, info);
+}
+
+std::vector<std::string> mp::BakedVMImageHost::supported_remotes()
+{
+    return {remote_name};
+}
+
+mp::optional<std::size_t> mp::BakedVMImageHost::manifest_generation()
+{
+    // What there is to serve is what the directory holds, so that goes for a manifest
+    uint generation = 0;
+    for (const auto& entry : baked_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+    {
+        const QFileInfo info_file{QDir{entry.absoluteFilePath()}.filePath(info_file_name)};
+        generation = qHash(entry.fileName(), generation);
+        generation = qHash(info_file.lastModified().toMSecsSinceEpoch(), generation);
+    }
+
+    return generation;
+}
+
+void mp::BakedVMImageHost::describe(const QDir& image_dir, const VMImageInfo& info)
+{
+    QJsonObject json;
+    json.insert("id", info.id);
+    json.insert("os", info.os);
+    json.insert("release_title", info.release_title);
+    json.insert("image_location", info.image_location);
+    json.insert("kernel_location", info.kernel_location);
+    json.insert("initrd_location", info.initrd_location);
+    json.insert("version", info.version);
+    json.insert("size", QString::number(info.size));
+
+    // Written last and whole, for a half-baked image never to be served
+    QSaveFile file{image_dir.filePath(info_file_name)};
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument{json}.toJson()) == -1 || !file.commit())
+        throw std::runtime_error(fmt::format("Cannot write {}: {}", file.fileName(), file.errorString()));
+}
+
+std::vector<mp::VMImageInfo> mp::BakedVMImageHost::baked_images() const
+{
+    std::vector<VMImageInfo> images;
+    for (const auto& entry : baked_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+        if (auto info = read_info(QDir{entry.absoluteFilePath()}))
+            images.push_back(std::move(*info));
+
+    return images;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_BAKED_IMAGE_HOST_H
+#define MULTIPASS_BAKED_IMAGE_HOST_H
+
+#include <multipass/vm_image_host.h>
+
+#include <QDir>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+// Serves the images that `multipass bake` made out of instances. The vault keeps each in a directory of its own, named
+// after the image, along with the info.json that describes it.
+class BakedVMImageHost final : public VMImageHost
+{
+public:
+    static constexpr auto remote_name = "baked";
+
+    explicit BakedVMImageHost(const QDir& baked_dir);
+
+    optional<VMImageInfo> info_for(const Query& query) override;
+    std::vector<std::pair<std::string, VMImageInfo>> all_info_for(const Query& query) override;
+    VMImageInfo info_for_full_hash(const std::string& full_hash) override;
+    std::vector<VMImageInfo> all_images_for(const std::string& remote_name, const bool allow_unsupported) override;
+    void for_each_entry_do(const Action& action) override;
+    std::vector<std::string> supported_remotes() override;
+    optional<std::size_t> manifest_generation() override; // changes whenever an image is baked
+
+    // Writes what describes the image baked in image_dir, which is then served under the name of that directory
+    static void describe(const QDir& image_dir, const VMImageInfo& info);
+
+private:
+    std::vector<VMImageInfo> baked_images() const;
+
+    const QDir baked_dir;
+};
+} // namespace multipass
+#endif // MULTIPASS_BAKED_IMAGE_HOST_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cloud_init_datasource.h"
+#include "http_cache.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/utils.h>
+
+#include <QFile>
+#include <QTcpSocket>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+
+namespace
+{
+constexpr auto category = "cloud-init datasource";
+} // namespace
+
+std::string mp::CloudInitDatasource::neighbour_mac_from_arp_table(const QHostAddress& peer)
+{
+    QFile arp_table{"/proc/net/arp"};
+    if (!arp_table.open(QIODevice::ReadOnly | QIODevice::Text))
+        return {};
+
+    arp_table.readLine(); // IP address, HW type, Flags, HW address, Mask, Device
+    while (!arp_table.atEnd())
+    {
+        const auto fields = QString{arp_table.readLine()}.split(' ', QString::SkipEmptyParts);
+        if (fields.size() >= 4 && QHostAddress{fields[0]}.isEqual(peer, QHostAddress::ConvertV4MappedToIPv4) &&
+            fields[2] != "0x0") // incomplete entries have no address yet
+            return fields[3].toLower().toStdString();
+    }
+
+    return {};
+}
+
+mp::CloudInitDatasource::CloudInitDatasource(NeighbourMac mac_of) : mac_of{std::move(mac_of)}
+{
+    http::serve_requests(server, [this](auto socket, const auto& method, const auto& target) {
+        on_request(socket, method, target);
+    });
+}
+
+void mp::CloudInitDatasource::listen(const QHostAddress& address, quint16 port)
+{
+    if (!server.listen(address, port))
+        throw std::runtime_error(fmt::format("Cannot serve cloud-init data on {} port {}: {}", address.toString(),
+                                             port, server.errorString()));
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Serving cloud-init data on {} port {}", address.toString(), server.serverPort()));
+}
+
+quint16 mp::CloudInitDatasource::port() const
+{
+    return server.serverPort();
+}
+
+void mp::CloudInitDatasource::publish(const VirtualMachineDescription& desc)
+{
+    // The same files that would go on the ISO, network-config included only when there is one
+    Instance instance{QString::fromStdString(desc.default_mac_address).toLower().toStdString(),
+                      {{"meta-data", mpu::emit_cloud_config(desc.meta_data_config)},
+                       {"vendor-data", mpu::emit_cloud_config(desc.vendor_data_config)},
+                       {"user-data", mpu::emit_cloud_config(desc.user_data_config)}}};
+    if (!desc.network_data_config.IsNull())
+        instance.documents.emplace("network-config", mpu::emit_cloud_config(desc.network_data_config));
+
+    std::lock_guard<std::mutex> lock{instances_mutex};
+    instances[desc.vm_name] = std::move(instance);
+}
+
+void mp::CloudInitDatasource::withdraw(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{instances_mutex};
+    instances.erase(name);
+}
+
+auto mp::CloudInitDatasource::document_for(const QString& target, const std::string& peer_mac) const
+    -> optional<std::string>
+{
+    const auto parts = target.split('/', QString::SkipEmptyParts);
+    if (parts.size() != 2 || peer_mac.empty())
+        return nullopt;
+
+    std::lock_guard<std::mutex> lock{instances_mutex};
+    const auto instance = instances.find(parts[0].toStdString());
+    if (instance == instances.end() || instance->second.mac_address != peer_mac)
+        return nullopt;
+
+    const auto document = instance->second.documents.find(parts[1].toStdString());
+    if (document == instance->second.documents.end())
+        return nullopt;
+
+    return document->second;
+}
+
+void mp::CloudInitDatasource::on_request(QTcpSocket* socket, const QByteArray& method, const QString& target)
+{
+    if (method != "GET")
+        return http::respond(socket, 405, "Method Not Allowed");
+
+    const auto peer = socket->peerAddress();
+    const auto document = document_for(target, mac_of(peer));
+    if (!document) // whether it is someone else's is not given away
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("Not serving {} to {}", target, peer.toString()));
+        return http::respond(socket, 404, "Not Found");
+    }
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Serving {} to {}", target, peer.toString()));
+    http::respond(socket, 200, "OK", QByteArray::fromStdString(*document));
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_CLOUD_INIT_DATASOURCE_H
+#define MULTIPASS_CLOUD_INIT_DATASOURCE_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+#include <multipass/virtual_machine_description.h>
+
+#include <QHostAddress>
+#include <QString>
+#include <QTcpServer>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace multipass
+{
+/**
+ * A NoCloud-net datasource: an HTTP server that instances fetch their cloud-init meta-data, user-data, vendor-data and
+ * network-config from, at /<instance name>/, instead of reading them off an ISO that the daemon writes for each. What
+ * is served is kept in memory, as the daemon produced it, until the instance is withdrawn. User-data carries secrets,
+ * so each instance is only answered with its own: requests are told apart by the MAC address behind their peer.
+ */
+class CloudInitDatasource : private DisabledCopyMove
+{
+public:
+    using NeighbourMac = std::function<std::string(const QHostAddress& peer)>; // empty when the peer is unknown
+
+    // The MAC address that the kernel's ARP table has for @p peer
+    static std::string neighbour_mac_from_arp_table(const QHostAddress& peer);
+
+    explicit CloudInitDatasource(NeighbourMac mac_of = neighbour_mac_from_arp_table);
+
+    // Throws std::runtime_error when the port cannot be had at @p address; 0 picks any free port
+    void listen(const QHostAddress& address, quint16 port);
+    quint16 port() const;
+
+    // Serve the cloud-init configuration in @p desc to the instance it describes, in place of what it served before
+    void publish(const VirtualMachineDescription& desc);
+    void withdraw(const std::string& name);
+
+    // What the target of a request from @p peer_mac is answered with; nullopt for what is not served to it
+    optional<std::string> document_for(const QString& target, const std::string& peer_mac) const;
+
+private:
+    struct Instance
+    {
+        std::string mac_address; // of its default interface, which it fetches through
+        std::unordered_map<std::string, std::string> documents; // emitted YAML, by file name
+    };
+
+    void on_request(QTcpSocket* socket, const QByteArray& method, const QString& target);
+
+    const NeighbourMac mac_of;
+    QTcpServer server;
+    mutable std::mutex instances_mutex; // instances are published from the threads that prepare them
+    std::unordered_map<std::string, Instance> instances;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_CLOUD_INIT_DATASOURCE_H
@@ -25,6 +25,8 @@
 #include <multipass/exceptions/unsupported_alias_exception.h>
 #include <multipass/exceptions/unsupported_remote_exception.h>
 
+#include <QtConcurrent/QtConcurrent>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -38,15 +40,11 @@ mp::CommonVMImageHost::CommonVMImageHost(std::chrono::seconds manifest_time_to_l
 {
     // careful: the functor below relies on polymorphic behavior, which is not available in constructors
     // fine here as the call is deferred to after the constructor is done (independently of connection type)
+    // The initial fetch goes to the background too, for the event loop to keep serving what needs no manifests
     QObject::connect(&manifest_single_shot, &QTimer::timeout, [this]() {
-        try
-        {
-            update_manifests();
-        }
-        catch (const std::exception& e)
-        {
-            mpl::log(mpl::Level::error, category, e.what());
-        }
+        std::lock_guard<std::mutex> lock{update_mutex};
+        if (!background_refresh.isRunning())
+            start_background_refresh();
     });
 
     manifest_single_shot.setSingleShot(true);
@@ -67,18 +65,74 @@ auto mp::CommonVMImageHost::info_for_full_hash(const std::string& full_hash) ->
     return info_for_full_hash_impl(full_hash);
 }
 
+auto mp::CommonVMImageHost::manifest_generation() -> optional<std::size_t>
+{
+    update_manifests();
+
+    return generation.load();
+}
+
+void mp::CommonVMImageHost::wait_for_refresh()
+{
+    std::unique_lock<std::mutex> lock{update_mutex};
+    auto refresh = background_refresh;
+    lock.unlock();
+
+    refresh.waitForFinished();
+}
+
 void mp::CommonVMImageHost::update_manifests()
 {
-    const auto now = std::chrono::steady_clock::now();
-    if ((now - last_update) > manifest_time_to_live || need_extra_update)
+    std::unique_lock<std::mutex> lock{update_mutex};
+    if (!all_manifests_available)
     {
-        need_extra_update = false;
+        // nothing to serve in the meantime for some remote, so this needs the outcome of an ongoing fetch, such as the
+        // initial one, and fetches inline only if that did not bring every manifest either
+        auto refresh = background_refresh;
+        lock.unlock();
+        refresh.waitForFinished();
+
+        lock.lock();
+        if (!all_manifests_available)
+        {
+            lock.unlock();
+            refresh_manifests();
+        }
+        return;
+    }
 
-        clear();
-        fetch_manifests();
+    const auto now = std::chrono::steady_clock::now();
+    if (((now - last_update) > manifest_time_to_live || need_extra_update) && !background_refresh.isRunning())
+        start_background_refresh();
+}
 
-        last_update = now;
-    }
+void mp::CommonVMImageHost::start_background_refresh()
+{
+    background_refresh = QtConcurrent::run([this] {
+        try
+        {
+            refresh_manifests();
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::error, category, fmt::format("Could not refresh manifests: {}", e.what()));
+        }
+    });
+}
+
+void mp::CommonVMImageHost::refresh_manifests()
+{
+    std::lock_guard<std::mutex> fetch_lock{fetch_mutex};
+    const auto now = std::chrono::steady_clock::now();
+
+    needs_refresh = false;
+    const auto available = fetch_manifests();
+    ++generation;
+
+    std::lock_guard<std::mutex> lock{update_mutex};
+    need_extra_update = needs_refresh;
+    all_manifests_available = available;
+    last_update = now;
 }
 
 void mp::CommonVMImageHost::on_manifest_empty(const std::string& details)
@@ -86,9 +140,15 @@ void mp::CommonVMImageHost::on_manifest_empty(const std::string& details)
     mpl::log(mpl::Level::info, category, details);
 }
 
+void mp::CommonVMImageHost::on_manifest_stale(const std::string& details)
+{
+    needs_refresh = true;
+    mpl::log(mpl::Level::debug, category, details);
+}
+
 void mp::CommonVMImageHost::on_manifest_update_failure(const std::string& details)
 {
-    need_extra_update = true;
+    needs_refresh = true;
     mpl::log(mpl::Level::warning, category, fmt::format("Could not update manifest: {}", details));
 }
 
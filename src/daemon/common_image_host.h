@@ -20,10 +20,13 @@
 
 #include "multipass/vm_image_host.h"
 
+#include <QFuture>
 #include <QStringList>
 #include <QTimer>
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
 
 namespace multipass
 {
@@ -34,25 +37,45 @@ public:
     CommonVMImageHost(std::chrono::seconds manifest_time_to_live);
     void for_each_entry_do(const Action& action) final;
     VMImageInfo info_for_full_hash(const std::string& full_hash) final;
+    optional<std::size_t> manifest_generation() final; // brings the manifests up to date first, as lookups do
+
+    // Blocks until an ongoing background refresh of the manifests is done
+    void wait_for_refresh();
 
 protected:
+    // Fetches manifests inline only when some remote has none to serve; otherwise stale manifests keep being served
+    // while a background refresh replaces them
     void update_manifests();
     void on_manifest_update_failure(const std::string& details);
     void on_manifest_empty(const std::string& details);
+    void on_manifest_stale(const std::string& details); // has the next update happen without waiting for the TTL
     void check_remote_is_supported(const std::string& remote_name) const;
     void check_alias_is_supported(const std::string& alias, const std::string& remote_name) const;
     bool check_all_aliases_are_supported(const QStringList& aliases, const std::string& remote_name) const;
 
     virtual void for_each_entry_do_impl(const Action& action) = 0;
     virtual VMImageInfo info_for_full_hash_impl(const std::string& full_hash) = 0;
-    virtual void clear() = 0;
-    virtual void fetch_manifests() = 0;
+
+    // Builds a new set of manifests and swaps it in as a whole, carrying over the previous manifest of any remote that
+    // fails to update. Returns false when some remote failed with no previous manifest to fall back on. This may run in
+    // the background, so implementations need to guard their manifests against concurrent readers and to
+    // wait_for_refresh() when they are destroyed.
+    virtual bool fetch_manifests() = 0;
 
 private:
+    void refresh_manifests();
+    void start_background_refresh(); // requires the update mutex
+
     std::chrono::seconds manifest_time_to_live;
+    std::mutex update_mutex; // guards what follows, up to the fetch mutex
     std::chrono::steady_clock::time_point last_update;
     bool need_extra_update = true;
+    bool all_manifests_available = false;
+    QFuture<void> background_refresh;
+    std::mutex fetch_mutex; // one fetch at a time; guards needs_refresh
+    bool needs_refresh = false;
     QTimer manifest_single_shot;
+    std::atomic<std::size_t> generation{0};
 };
 
 }
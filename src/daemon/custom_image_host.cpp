@@ -28,7 +28,10 @@
 
 #include <QMap>
 #include <QUrl>
+#include <QtConcurrent/QtConcurrent>
 
+#include <exception>
+#include <functional>
 #include <utility>
 
 namespace mp = multipass;
@@ -117,23 +120,34 @@ const QMap<QString, QMap<QString, CustomImageInfo>> snapcraft_image_info{
         "https://cloud-images.ubuntu.com/buildd/daily/kinetic/current/unpacked/"
         "kinetic-server-cloudimg-amd64-initrd-generic"}}}}};
 
+using ChecksumLookup = std::function<QString(const QString& hash_url, const QString& image_file)>;
+
 auto base_image_info_for(mp::URLDownloader* url_downloader, const QString& image_url, const QString& hash_url,
-                         const QString& image_file)
+                         const QString& image_file, const ChecksumLookup& checksum_for)
 {
     const auto last_modified = url_downloader->last_modified({image_url}).toString("yyyyMMdd");
-    const auto sha256_sums = url_downloader->download({hash_url}).split('\n');
-    QString hash;
 
-    for (const QString line : sha256_sums) // intentional copy
+    return BaseImageInfo{last_modified, checksum_for(hash_url, image_file)};
+}
+
+auto parse_sha256_sums(const QByteArray& sha256_sums)
+{
+    // Each line holds a hash and a file name, the latter prefixed with '*' for files checked in binary mode
+    QMap<QString, QString> hashes;
+    for (const auto& line : sha256_sums.split('\n'))
     {
-        if (line.trimmed().endsWith(image_file))
-        {
-            hash = line.split(' ').first();
-            break;
-        }
+        const auto fields = QString{line}.trimmed().split(' ', QString::SkipEmptyParts);
+        if (fields.size() < 2)
+            continue;
+
+        auto file_name = fields.last();
+        if (file_name.startsWith('*'))
+            file_name.remove(0, 1);
+
+        hashes.insert(file_name, fields.first());
     }
 
-    return BaseImageInfo{last_modified, hash};
+    return hashes;
 }
 
 auto map_aliases_to_vm_info_for(const std::vector<mp::VMImageInfo>& images)
@@ -151,7 +165,8 @@ auto map_aliases_to_vm_info_for(const std::vector<mp::VMImageInfo>& images)
     return map;
 }
 
-auto full_image_info_for(const QMap<QString, CustomImageInfo>& custom_image_info, mp::URLDownloader* url_downloader)
+auto full_image_info_for(const QMap<QString, CustomImageInfo>& custom_image_info, mp::URLDownloader* url_downloader,
+                         const ChecksumLookup& checksum_for)
 {
     std::vector<mp::VMImageInfo> default_images;
 
@@ -161,7 +176,7 @@ auto full_image_info_for(const QMap<QString, CustomImageInfo>& custom_image_info
         QString image_url{image_info.second.url_prefix + image_info.first};
         QString hash_url{image_info.second.url_prefix + QStringLiteral("SHA256SUMS")};
 
-        auto base_image_info = base_image_info_for(url_downloader, image_url, hash_url, image_file);
+        auto base_image_info = base_image_info_for(url_downloader, image_url, hash_url, image_file, checksum_for);
         mp::VMImageInfo full_image_info{image_info.second.aliases,
                                         image_info.second.os,
                                         image_info.second.release,
@@ -196,6 +211,11 @@ mp::CustomVMImageHost::CustomVMImageHost(const QString& arch, URLDownloader* dow
 {
 }
 
+mp::CustomVMImageHost::~CustomVMImageHost()
+{
+    wait_for_refresh();
+}
+
 mp::optional<mp::VMImageInfo> mp::CustomVMImageHost::info_for(const Query& query)
 {
     check_alias_is_supported(query.release, query.remote_name);
@@ -243,7 +263,7 @@ std::vector<mp::VMImageInfo> mp::CustomVMImageHost::all_images_for(const std::st
 
 void mp::CustomVMImageHost::for_each_entry_do_impl(const Action& action)
 {
-    for (const auto& manifest : custom_image_info)
+    for (const auto& manifest : current_manifests())
     {
         for (const auto& info : manifest.second->products)
         {
@@ -258,42 +278,111 @@ std::vector<std::string> mp::CustomVMImageHost::supported_remotes()
     return remotes;
 }
 
-void mp::CustomVMImageHost::fetch_manifests()
+bool mp::CustomVMImageHost::fetch_manifests()
 {
+    using Fetched = std::pair<std::shared_ptr<const CustomManifest>, std::exception_ptr>;
+
+    // The remotes are fetched at once, so that a slow one holds back none of the others
+    std::vector<std::pair<std::string, QFuture<Fetched>>> fetches;
     for (const auto& spec : {std::make_pair(no_remote, multipass_image_info[arch]),
                              std::make_pair(snapcraft_remote, snapcraft_image_info[arch])})
     {
+        fetches.emplace_back(spec.first, QtConcurrent::run([this, spec]() -> Fetched {
+            try
+            {
+                check_remote_is_supported(spec.first);
+
+                return {full_image_info_for(spec.second, url_downloader,
+                                            [this](const QString& hash_url, const QString& image_file) {
+                                                return checksum_for(hash_url, image_file);
+                                            }),
+                        nullptr};
+            }
+            catch (...)
+            {
+                return {nullptr, std::current_exception()};
+            }
+        }));
+    }
+
+    for (auto& fetch : fetches)
+        fetch.second.waitForFinished();
+
+    const auto previous_manifests = current_manifests();
+    Manifests new_manifests;
+    auto all_available = true;
+
+    for (auto& fetch : fetches)
+    {
+        const auto& remote_name = fetch.first;
+        const auto fetched = fetch.second.result();
+
         try
         {
-            check_remote_is_supported(spec.first);
+            if (fetched.second)
+                std::rethrow_exception(fetched.second);
 
-            custom_image_info.emplace(spec.first, full_image_info_for(spec.second, url_downloader));
+            new_manifests.emplace(remote_name, fetched.first);
         }
         catch (mp::DownloadException& e)
         {
             on_manifest_update_failure(e.what());
+
+            auto it = previous_manifests.find(remote_name);
+            if (it != previous_manifests.end())
+                new_manifests.insert(*it);
+            else
+                all_available = false;
         }
         catch (const mp::UnsupportedRemoteException&)
         {
             continue;
         }
     }
+
+    std::lock_guard<std::mutex> lock{manifests_mutex};
+    custom_image_info = std::move(new_manifests);
+
+    return all_available;
+}
+
+QString mp::CustomVMImageHost::checksum_for(const QString& hash_url, const QString& image_file)
+{
+    // Checksum files are only downloaded and parsed again once the server says they changed
+    const auto last_modified = url_downloader->last_modified({hash_url});
+    const auto key = hash_url.toStdString();
+    {
+        std::lock_guard<std::mutex> lock{checksums_mutex};
+        auto it = checksum_files.find(key);
+        if (it != checksum_files.end() && last_modified.isValid() && it->second.last_modified == last_modified)
+            return it->second.hashes.value(image_file);
+    }
+
+    ChecksumFile checksum_file{last_modified, parse_sha256_sums(url_downloader->download({hash_url}))};
+    const auto hash = checksum_file.hashes.value(image_file);
+
+    std::lock_guard<std::mutex> lock{checksums_mutex};
+    checksum_files[key] = std::move(checksum_file);
+
+    return hash;
 }
 
-void mp::CustomVMImageHost::clear()
+auto mp::CustomVMImageHost::current_manifests() const -> Manifests
 {
-    custom_image_info.clear();
+    std::lock_guard<std::mutex> lock{manifests_mutex};
+    return custom_image_info;
 }
 
-mp::CustomManifest* mp::CustomVMImageHost::manifest_from(const std::string& remote_name)
+std::shared_ptr<const mp::CustomManifest> mp::CustomVMImageHost::manifest_from(const std::string& remote_name)
 {
     check_remote_is_supported(remote_name);
 
     update_manifests();
 
-    auto it = custom_image_info.find(remote_name);
-    if (it == custom_image_info.end())
+    const auto current = current_manifests();
+    auto it = current.find(remote_name);
+    if (it == current.end())
         throw std::runtime_error(fmt::format("Remote \"{}\" is unknown or unreachable.", remote_name));
 
-    return it->second.get();
+    return it->second;
 }
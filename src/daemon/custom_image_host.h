@@ -20,9 +20,12 @@
 
 #include "common_image_host.h"
 
+#include <QDateTime>
+#include <QMap>
 #include <QString>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -38,10 +41,18 @@ struct CustomManifest
     const std::unordered_map<std::string, const VMImageInfo*> image_records;
 };
 
+// A parsed SHA256SUMS file, mapping image file names to their hashes
+struct ChecksumFile
+{
+    QDateTime last_modified;
+    QMap<QString, QString> hashes;
+};
+
 class CustomVMImageHost final : public CommonVMImageHost
 {
 public:
     CustomVMImageHost(const QString& arch, URLDownloader* downloader, std::chrono::seconds manifest_time_to_live);
+    ~CustomVMImageHost() override;
 
     optional<VMImageInfo> info_for(const Query& query) override;
     std::vector<std::pair<std::string, VMImageInfo>> all_info_for(const Query& query) override;
@@ -51,15 +62,21 @@ public:
 protected:
     void for_each_entry_do_impl(const Action& action) override;
     VMImageInfo info_for_full_hash_impl(const std::string& full_hash) override;
-    void fetch_manifests() override;
-    void clear() override;
+    bool fetch_manifests() override;
 
 private:
-    CustomManifest* manifest_from(const std::string& remote_name);
+    using Manifests = std::unordered_map<std::string, std::shared_ptr<const CustomManifest>>;
+
+    QString checksum_for(const QString& hash_url, const QString& image_file);
+    Manifests current_manifests() const;
+    std::shared_ptr<const CustomManifest> manifest_from(const std::string& remote_name);
 
     const QString arch;
     URLDownloader* const url_downloader;
-    std::unordered_map<std::string, std::unique_ptr<CustomManifest>> custom_image_info;
+    mutable std::mutex manifests_mutex;
+    Manifests custom_image_info;
+    std::mutex checksums_mutex;
+    std::unordered_map<std::string, ChecksumFile> checksum_files;
     std::vector<std::string> remotes;
 };
 } // namespace multipass
@@ -18,26 +18,33 @@
 #include "daemon.h"
 #include "base_cloud_init_config.h"
 #include "instance_settings_handler.h"
+#include "storage_pools.h"
 
 #include <multipass/constants.h>
+#include <multipass/download_scheduler.h>
 #include <multipass/exceptions/blueprint_exceptions.h>
 #include <multipass/exceptions/create_image_exception.h>
 #include <multipass/exceptions/exitless_sshprocess_exception.h>
+#include <multipass/exceptions/image_vault_exceptions.h>
 #include <multipass/exceptions/invalid_memory_size_exception.h>
 #include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/exceptions/start_exception.h>
-#include <multipass/ip_address.h>
-#include <multipass/json_writer.h>
+#include <multipass/file_ops.h>
+#include <multipass/guest_readiness.h>
 #include <multipass/logging/client_logger.h>
 #include <multipass/logging/log.h>
+#include <multipass/memory_merging.h>
 #include <multipass/name_generator.h>
 #include <multipass/network_interface.h>
+#include <multipass/performance_counters.h>
 #include <multipass/platform.h>
 #include <multipass/query.h>
 #include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_session.h>
+#include <multipass/sshfs_mount/sshfs_mount_profile.h>
 #include <multipass/top_catch_all.h>
+#include <multipass/tracing.h>
 #include <multipass/utils.h>
 #include <multipass/version.h>
 #include <multipass/virtual_machine.h>
@@ -47,30 +54,42 @@
 #include <multipass/vm_image_host.h>
 #include <multipass/vm_image_vault.h>
 
+#include <google/protobuf/arena.h>
 #include <multipass/format.h>
+#include <scope_guard.hpp>
 #include <yaml-cpp/yaml.h>
 
+#include <QCborMap>
+#include <QCborValue>
+#include <QDateTime>
 #include <QDir>
 #include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
 #include <QFutureSynchronizer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QString>
 #include <QSysInfo>
+#include <QThread>
 #include <QtConcurrent/QtConcurrent>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
+namespace mpt = multipass::tracing;
 namespace mpu = multipass::utils;
 
 namespace
@@ -81,9 +100,30 @@ using namespace std::chrono_literals;
 using error_string = std::string;
 
 constexpr auto category = "daemon";
-constexpr auto instance_db_name = "multipassd-vm-instances.json";
+constexpr auto instance_db_name = "multipassd-vm-instances.json";        // for tools, downgrades and edits
+constexpr auto instance_snapshot_name = "multipassd-vm-instances.cbor"; // what the daemon reads back
+constexpr auto completions_name = "multipass_completions";               // next to the socket, for any user to read
+constexpr auto instances_persistence_delay = 100ms;
+constexpr auto prefetch_startup_delay = 5min;   // leave the daemon's startup alone before prefetching images
+constexpr auto max_instance_workers = 32;       // operations on instances mostly wait on the backend or the network
+constexpr auto max_readiness_waiters = 32;      // waiting for instances to come up takes minutes, but little else
+constexpr auto max_async_operations = 16;       // each operation mostly waits on its instance workers and waiters
+constexpr auto max_image_preparers = 8;         // downloads and conversions, which share the disk and the network
+constexpr auto watch_poll_interval = 1s;        // how soon watches notice that their client went away
+constexpr auto top_default_interval = 1s;       // between updates of `top`, when the client does not say
+constexpr auto top_stats_timeout = 500ms;       // for each instance to report, before its row is left out
+constexpr auto ephemeral_purge_retry = 1s;      // while whatever stopped an ephemeral instance still holds it
+constexpr auto addresses_refresh_interval = 5s; // leases and neighbour tables are cheap to read
+constexpr auto admission_retry_interval = 2s;   // how often queued launches look for room on the host
+constexpr auto exit_deadline = 4min;            // under the snap's stop timeout, leaving time to kill what is late
+constexpr auto due_shutdowns_window = 1s;       // for delayed shutdowns that share a deadline to be done together
+constexpr auto progress_interval = 100ms;       // between updates to clients on a progress, short of its end
+constexpr auto memory_summary_interval = 30min; // slow growth is what these are for, so there is no point in more
 constexpr auto reboot_cmd = "sudo reboot";
 constexpr auto stop_ssh_cmd = "sudo systemctl stop ssh";
+// Down to the machine-id, which DHCP clients go by. Older cloud-init cannot reset it, so it is emptied for it.
+constexpr auto cloud_init_clean_cmd = "sudo cloud-init clean --logs --machine-id || "
+                                      "{ sudo cloud-init clean --logs && sudo truncate -s 0 /etc/machine-id; }";
 const std::string sshfs_error_template = "Error enabling mount support in '{}'"
                                          "\n\nPlease install the 'multipass-sshfs' snap manually inside the instance.";
 
@@ -113,8 +153,387 @@ mp::Query query_from(const mp::LaunchRequest* request, const std::string& name)
     return {name, image, false, request->remote_name(), query_type, true};
 }
 
+QString prefetch_setting()
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::prefetch_images_key);
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read images to prefetch: {}", e.what()));
+        return {};
+    }
+}
+
+std::chrono::seconds metrics_interval_setting()
+{
+    try
+    {
+        return std::chrono::seconds{MP_SETTINGS.get(mp::metrics_interval_key).toInt()};
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read metrics interval: {}", e.what()));
+        return std::chrono::seconds{QString{mp::metrics_interval_default}.toInt()};
+    }
+}
+
+std::size_t warm_pool_size_setting()
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::warm_pool_size_key).toUInt();
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read warm pool size: {}", e.what()));
+        return QString{mp::warm_pool_size_default}.toUInt();
+    }
+}
+
+bool reclaim_memory_setting()
+{
+    try
+    {
+        return MP_SETTINGS.get_as<bool>(mp::reclaim_memory_key);
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read whether to reclaim memory: {}", e.what()));
+        return false;
+    }
+}
+
+bool memory_merging_setting()
+{
+    try
+    {
+        return MP_SETTINGS.get_as<bool>(mp::memory_merging_key);
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read whether to merge memory: {}", e.what()));
+        return false;
+    }
+}
+
+std::chrono::minutes idle_suspend_setting()
+{
+    try
+    {
+        return std::chrono::minutes{MP_SETTINGS.get(mp::idle_suspend_key).toInt()};
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read the idle suspend period: {}", e.what()));
+        return std::chrono::minutes::zero();
+    }
+}
+
+qint64 download_limit_setting() // in bytes per second
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::download_limit_key).toLongLong() * 1024;
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read the download limit: {}", e.what()));
+        return 0;
+    }
+}
+
+quint16 package_cache_port_setting() // 0 when there is no package cache
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::package_cache_port_key).toUShort();
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read the package cache port: {}", e.what()));
+        return 0;
+    }
+}
+
+// What the client of a request about these instances hears, besides what is about no instance in particular; empty
+// names stand for all instances, and so do no names
+template <typename Names>
+std::vector<std::string> log_scope_of(const Names& names)
+{
+    std::vector<std::string> scope{names.begin(), names.end()};
+    if (std::find(scope.begin(), scope.end(), std::string{}) != scope.end())
+        scope.clear();
+
+    return scope;
+}
+
+// Null, for instances to get their cloud-init data on ISOs, unless there is a port to serve it on that they can reach
+std::unique_ptr<mp::CloudInitDatasource> make_cloud_init_datasource(const mp::VirtualMachineFactory& factory)
+{
+    quint16 port = 0;
+    try
+    {
+        port = MP_SETTINGS.get(mp::cloud_init_datasource_port_key).toUShort();
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot read the cloud-init datasource port: {}", e.what()));
+    }
+
+    if (!port)
+        return nullptr;
+
+    const auto host = factory.cloud_init_seed_host();
+    if (!host)
+    {
+        mpl::log(mpl::Level::info, category, "This backend's instances cannot fetch cloud-init data; using ISOs");
+        return nullptr;
+    }
+
+    auto datasource = std::make_unique<mp::CloudInitDatasource>();
+    try
+    {
+        // Only where instances reach the host: what is served is meant for them alone
+        datasource->listen(QHostAddress{QString::fromStdString(*host)}, port);
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("{}; using ISOs", e.what()));
+        return nullptr;
+    }
+
+    return datasource;
+}
+
+mp::AdmissionControl::Limits admission_limits()
+{
+    auto limit = [](const char* key) {
+        try
+        {
+            return MP_SETTINGS.get(key).toInt();
+        }
+        catch (const mp::SettingsException& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot read {}: {}", key, e.what()));
+            return 0;
+        }
+    };
+
+    // Percentages of what the host has, where it can tell
+    const auto host_cores = static_cast<long long>(std::thread::hardware_concurrency());
+    const auto host_memory = mp::utils::host_memory_bytes();
+
+    return {static_cast<int>(host_cores * limit(mp::cpu_limit_key) / 100),
+            host_memory / 100 * limit(mp::memory_limit_key), limit(mp::parallel_boots_key)};
+}
+
+std::map<std::string, std::string> federation_members()
+{
+    try
+    {
+        return mp::parse_federation_members(MP_SETTINGS.get(mp::federation_key));
+    }
+    catch (const std::exception& e) // settings or parsing
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read the federation members: {}", e.what()));
+        return {};
+    }
+}
+
+// Member instances go after the local ones, under their qualified names
+template <typename Entries>
+void add_member_entries(Entries& entries, const std::string& label, Entries& member_entries)
+{
+    for (auto& entry : member_entries)
+    {
+        entry.set_name(mp::Federation::qualified(entry.name(), label));
+        entries.Add()->Swap(&entry);
+    }
+}
+
+// Members mostly find the same images, so only those that this daemon does not are added
+void add_member_images(mp::FindReply& response, mp::Federation::Answers<mp::FindReply> answers)
+{
+    auto key = [](const mp::FindReply::ImageInfo& image) {
+        return fmt::format("{}\n{}\n{}", image.os(), image.release(), image.version());
+    };
+
+    std::unordered_set<std::string> known;
+    for (const auto& image : response.images_info())
+        known.insert(key(image));
+
+    for (auto& answer : answers)
+        for (auto& image : *answer.second.reply.mutable_images_info())
+            if (known.insert(key(image)).second)
+                response.add_images_info()->Swap(&image);
+}
+
+// For the operations that the daemon starts of its own accord, which have nobody to reply to
+template <typename Reply>
+class DiscardingServerWriter : public grpc::ServerWriterInterface<Reply>
+{
+public:
+    void SendInitialMetadata() override
+    {
+    }
+
+    bool Write(const Reply&, grpc::WriteOptions) override
+    {
+        return true;
+    }
+};
+
+// Entries are comma-separated blueprint names or "[<remote>:]<image>" aliases
+std::vector<mp::Query> prefetch_queries_from(const QString& setting, mp::VMBlueprintProvider& blueprint_provider)
+{
+    std::vector<mp::Query> queries;
+    for (const auto& entry : setting.split(',', QString::SkipEmptyParts))
+    {
+        const auto image = entry.trimmed().toStdString();
+        try
+        {
+            mp::VirtualMachineDescription unused_desc{0, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}};
+            auto query = blueprint_provider.fetch_blueprint_for(image, unused_desc);
+            query.name = "";
+            queries.push_back(query);
+        }
+        catch (const std::out_of_range&)
+        {
+            const auto separator = image.find(':');
+            if (separator == std::string::npos)
+                queries.push_back({"", image, false, "", mp::Query::Type::Alias});
+            else
+                queries.push_back(
+                    {"", image.substr(separator + 1), false, image.substr(0, separator), mp::Query::Type::Alias});
+        }
+        catch (const std::exception& e) // the blueprint is there, but unusable; the other entries still count
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Not prefetching the image for blueprint \"{}\": {}", image, e.what()));
+        }
+    }
+
+    return queries;
+}
+
+YAML::Node make_write_files_entry(const std::string& path, const std::string& content,
+                                  const std::string& permissions = "0644")
+{
+    YAML::Node entry;
+    entry["path"] = path;
+    entry["content"] = content;
+    entry["permissions"] = permissions;
+
+    return entry;
+}
+
+// Have the guest open the readiness ports as it comes up, on backends that provide them. Units installed during the
+// first boot only take effect from the next one, so the first boot only announces the end of cloud-init.
+void add_readiness_hooks(YAML::Node& config)
+{
+    auto port_path = [](auto milestone) {
+        return fmt::format("/dev/virtio-ports/{}", mp::GuestReadiness::port_for(milestone));
+    };
+    auto announcing_unit = [&port_path](auto milestone, const std::string& description, const std::string& after) {
+        return fmt::format("# written by Multipass\n"
+                           "[Unit]\n"
+                           "Description={}\n"
+                           "{}"
+                           "ConditionPathExists={}\n"
+                           "\n"
+                           "[Service]\n"
+                           "Type=oneshot\n"
+                           "ExecStart=/bin/sh -c ': > {}'\n"
+                           "\n"
+                           "[Install]\n"
+                           "WantedBy=multi-user.target\n",
+                           description, after.empty() ? "" : fmt::format("After={}\n", after), port_path(milestone),
+                           port_path(milestone));
+    };
+
+    config["write_files"].push_back(make_write_files_entry(
+        "/etc/systemd/system/multipass-booting.service",
+        announcing_unit(mp::GuestReadiness::Milestone::booting, "Tell Multipass the instance is booting", "")));
+    config["write_files"].push_back(make_write_files_entry(
+        "/etc/systemd/system/multipass-ssh-up.service",
+        announcing_unit(mp::GuestReadiness::Milestone::ssh_up, "Tell Multipass SSH is up", "ssh.service")));
+
+    const auto initialized_port = port_path(mp::GuestReadiness::Milestone::initialized);
+    config["write_files"].push_back(
+        make_write_files_entry("/var/lib/cloud/scripts/per-boot/multipass-readiness",
+                               fmt::format("#!/bin/sh\n"
+                                           "# written by Multipass\n"
+                                           "systemctl enable multipass-booting.service multipass-ssh-up.service\n"
+                                           "if [ -e {0} ]; then : > {0}; fi\n",
+                                           initialized_port),
+                               "0755"));
+}
+
+// Have sshd answer over vsock too, on backends that give the instance a vsock device, for the daemon to reach it before
+// its network is up. Each connection gets an sshd of its own, as inetd would have it.
+void add_vsock_ssh_hooks(YAML::Node& config)
+{
+    config["write_files"].push_back(make_write_files_entry("/etc/systemd/system/multipass-vsock-ssh.socket",
+                                                           "# written by Multipass\n"
+                                                           "[Unit]\n"
+                                                           "Description=SSH over vsock for Multipass\n"
+                                                           "ConditionPathExists=/dev/vsock\n"
+                                                           "\n"
+                                                           "[Socket]\n"
+                                                           "ListenStream=vsock::22\n"
+                                                           "Accept=yes\n"
+                                                           "\n"
+                                                           "[Install]\n"
+                                                           "WantedBy=sockets.target\n"));
+    config["write_files"].push_back(make_write_files_entry("/etc/systemd/system/multipass-vsock-ssh@.service",
+                                                           "# written by Multipass\n"
+                                                           "[Unit]\n"
+                                                           "Description=SSH over vsock for Multipass\n"
+                                                           "\n"
+                                                           "[Service]\n"
+                                                           "ExecStart=-/usr/sbin/sshd -i\n"
+                                                           "StandardInput=socket\n"
+                                                           "RuntimeDirectory=sshd\n"
+                                                           "RuntimeDirectoryPreserve=yes\n"));
+    config["write_files"].push_back(
+        make_write_files_entry("/var/lib/cloud/scripts/per-boot/multipass-vsock-ssh",
+                               "#!/bin/sh\n"
+                               "# written by Multipass\n"
+                               "systemctl enable --now multipass-vsock-ssh.socket\n",
+                               "0755"));
+}
+
+// Have apt go through the daemon's package cache, found at the instance's gateway, whenever it answers there. The
+// check is made as apt starts fetching, so that instances carry on straight to the archive when the cache is gone.
+void add_package_cache_hooks(YAML::Node& config, quint16 port)
+{
+    constexpr auto detect_script = "/usr/local/lib/multipass/apt-proxy";
+
+    config["write_files"].push_back(make_write_files_entry(
+        detect_script,
+        fmt::format("#!/bin/bash\n"
+                    "# written by Multipass\n"
+                    "gateway=$(ip -4 route show default | awk '{{print $3; exit}}')\n"
+                    "if [ -n \"$gateway\" ] && timeout 1 bash -c \"exec 3<>/dev/tcp/$gateway/{0}\" 2>/dev/null\n"
+                    "then\n"
+                    "    echo \"http://$gateway:{0}\"\n"
+                    "else\n"
+                    "    echo DIRECT\n"
+                    "fi\n",
+                    port),
+        "0755"));
+    config["write_files"].push_back(
+        make_write_files_entry("/etc/apt/apt.conf.d/90multipass-package-cache",
+                               fmt::format("// written by Multipass\nAcquire::http::Proxy-Auto-Detect \"{}\";\n",
+                                           detect_script)));
+}
+
 auto make_cloud_init_vendor_config(const mp::SSHKeyProvider& key_provider, const std::string& time_zone,
-                                   const std::string& username, const std::string& backend_version_string)
+                                   const std::string& username, const std::string& backend_version_string,
+                                   quint16 package_cache_port)
 {
     auto ssh_key_line = fmt::format("ssh-rsa {} {}@localhost", key_provider.public_key_as_base64(), username);
 
@@ -134,6 +553,11 @@ auto make_cloud_init_vendor_config(const mp::SSHKeyProvider& key_provider, const
     pollinate_user_agent_node["content"] = pollinate_user_agent_string;
 
     config["write_files"].push_back(pollinate_user_agent_node);
+    add_readiness_hooks(config);
+    add_vsock_ssh_hooks(config);
+
+    if (package_cache_port)
+        add_package_cache_hooks(config, package_cache_port);
 
     return config;
 }
@@ -193,9 +617,31 @@ void prepare_user_data(YAML::Node& user_data_config, YAML::Node& vendor_config)
         keys.push_back(vendor_config["ssh_authorized_keys"][0]);
 }
 
-template <typename T>
-auto name_from(const std::string& requested_name, const std::string& blueprint_name, mp::NameGenerator& name_gen,
-               const T& currently_used_names)
+// The user data of a launch, parsed once for all of its instances
+struct LaunchUserData
+{
+    std::mutex mutex;
+    mp::optional<YAML::Node> parsed;
+};
+
+YAML::Node user_data_from(LaunchUserData& user_data, const std::string& raw_user_data)
+{
+    std::lock_guard<std::mutex> lock{user_data.mutex};
+    if (!user_data.parsed)
+        user_data.parsed = YAML::Load(raw_user_data);
+
+    return YAML::Clone(*user_data.parsed); // each instance adds to its own copy
+}
+
+template <typename... Ts>
+bool name_in_use(const std::string& name, const Ts&... currently_used_names)
+{
+    return ((currently_used_names.find(name) != currently_used_names.end()) || ...);
+}
+
+template <typename... Ts>
+std::string name_from(const std::string& requested_name, const std::string& blueprint_name,
+                      mp::NameGenerator& name_gen, const Ts&... currently_used_names)
 {
     if (!requested_name.empty())
     {
@@ -207,18 +653,133 @@ auto name_from(const std::string& requested_name, const std::string& blueprint_n
     }
     else
     {
-        auto name = name_gen.make_name();
         constexpr int num_retries = 100;
         for (int i = 0; i < num_retries; i++)
         {
-            if (currently_used_names.find(name) != currently_used_names.end())
-                continue;
-            return name;
+            auto name = name_gen.make_name();
+            if (!name_in_use(name, currently_used_names...))
+                return name;
         }
         throw std::runtime_error("unable to generate a unique name");
     }
 }
 
+bool is_batch(const mp::LaunchRequest& request)
+{
+    return request.count() > 1 || !request.name_prefix().empty();
+}
+
+// Names for the instances of a batch launch: the prefix followed by the lowest free indices, or generated names
+template <typename... Ts>
+std::vector<std::string> batch_names_from(const mp::LaunchRequest& request, mp::NameGenerator& name_gen,
+                                          const Ts&... currently_used_names)
+{
+    if (!request.instance_name().empty())
+        throw std::runtime_error("Cannot give several instances the same name, use a name prefix instead");
+
+    const auto& prefix = request.name_prefix();
+    const auto count = std::max(request.count(), 1);
+
+    std::vector<std::string> names;
+    std::unordered_set<std::string> picked; // for large batches not to go through all the names picked so far
+    names.reserve(count);
+    for (auto index = 1; static_cast<int>(names.size()) < count; ++index)
+    {
+        auto name = prefix.empty() ? name_gen.make_name() : fmt::format("{}{}", prefix, index);
+        if (name_in_use(name, currently_used_names..., picked))
+        {
+            constexpr int max_attempts = 10000;
+            if (index >= max_attempts)
+                throw std::runtime_error("unable to generate unique names");
+
+            continue;
+        }
+
+        if (!mp::utils::valid_hostname(name))
+            throw std::runtime_error(fmt::format("Invalid instance name prefix \"{}\"", prefix));
+
+        picked.insert(name);
+        names.push_back(std::move(name));
+    }
+
+    return names;
+}
+
+// The outcome of preparing one of the instances of a launch
+struct PreparedInstance
+{
+    std::string name;
+    mp::optional<mp::VirtualMachineDescription> description;
+    std::string error; // when there is no description
+};
+
+mp::VMPlacement read_placement(const QJsonObject& record)
+{
+    const auto placement = record["placement"].toObject();
+    auto read_cpus = [&placement](const char* key) {
+        std::vector<int> cpus;
+        for (const auto& cpu : placement[key].toArray())
+            cpus.push_back(cpu.toInt());
+
+        return cpus;
+    };
+
+    return {placement["hugepages"].toBool(),
+            placement.contains("numa_node") ? mp::make_optional(placement["numa_node"].toInt()) : mp::nullopt,
+            read_cpus("vcpu_cpus"), read_cpus("io_cpus")};
+}
+
+mp::VMDiskOptions read_disk_options(const QJsonObject& record)
+{
+    mp::VMDiskOptions disk_options;
+    const auto json = record["disk_options"].toObject();
+
+    disk_options.cache = json["cache"].toString(QString::fromStdString(disk_options.cache)).toStdString();
+    disk_options.aio = json["aio"].toString(QString::fromStdString(disk_options.aio)).toStdString();
+    disk_options.iothread = json["iothread"].toBool(disk_options.iothread);
+    disk_options.queues = json["queues"].toInt(disk_options.queues);
+    disk_options.detect_zeroes = json["detect_zeroes"].toBool(disk_options.detect_zeroes);
+
+    return disk_options;
+}
+
+std::vector<mp::VMSnapshot> read_snapshots(const QJsonObject& record)
+{
+    std::vector<mp::VMSnapshot> snapshots;
+    for (const auto& entry : record["snapshots"].toArray())
+    {
+        const auto json = entry.toObject();
+        snapshots.push_back({json["name"].toString().toStdString(), json["created"].toString().toStdString()});
+    }
+
+    return snapshots;
+}
+
+mp::VMNetworkOptions read_network_options(const QJsonObject& record)
+{
+    mp::VMNetworkOptions network_options;
+    const auto json = record["network_options"].toObject();
+
+    network_options.vhost = json["vhost"].toBool(network_options.vhost);
+    network_options.queues = json["queues"].toInt(network_options.queues);
+    network_options.ring_size = json["ring_size"].toInt(network_options.ring_size);
+
+    return network_options;
+}
+
+mp::VMResourceLimits read_resource_limits(const QJsonObject& record)
+{
+    mp::VMResourceLimits limits;
+    const auto json = record["resource_limits"].toObject();
+
+    limits.cpu_weight = json["cpu_weight"].toInt(limits.cpu_weight);
+    limits.io_weight = json["io_weight"].toInt(limits.io_weight);
+    limits.memory_high = json["memory_high"].toString().toLongLong(); // a string, as JSON numbers are doubles
+    limits.cpu_max = json["cpu_max"].toInt(limits.cpu_max);
+
+    return limits;
+}
+
 std::vector<mp::NetworkInterface> read_extra_interfaces(const QJsonObject& record)
 {
     // Read the extra networks interfaces, if any.
@@ -242,10 +803,148 @@ std::vector<mp::NetworkInterface> read_extra_interfaces(const QJsonObject& recor
     return extra_interfaces;
 }
 
+// Nothing for ghost records, which are left over from failed launches
+mp::optional<mp::VMSpecs> read_vm_specs(const std::string& key, const QJsonObject& record)
+{
+    auto num_cores = record["num_cores"].toInt();
+    auto mem_size = record["mem_size"].toString().toStdString();
+    auto disk_space = record["disk_space"].toString().toStdString();
+    auto ssh_username = record["ssh_username"].toString().toStdString();
+    auto state = record["state"].toInt();
+    auto deleted = record["deleted"].toBool();
+    auto metadata = record["metadata"].toObject();
+    auto pool_profile = record["pool_profile"].toString().toStdString();
+
+    if (!num_cores && !deleted && ssh_username.empty() && metadata.isEmpty() &&
+        !mp::MemorySize{mem_size}.in_bytes() && !mp::MemorySize{disk_space}.in_bytes())
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Ignoring ghost instance in database: {}", key));
+        return mp::nullopt;
+    }
+
+    if (ssh_username.empty())
+        ssh_username = "ubuntu";
+
+    // Read the default network interface, constructed from the "mac_addr" field.
+    auto default_mac_address = record["mac_addr"].toString().toStdString();
+    if (!mpu::valid_mac_address(default_mac_address))
+    {
+        throw std::runtime_error(fmt::format("Invalid MAC address {}", default_mac_address));
+    }
+
+    std::unordered_map<std::string, mp::VMMount> mounts;
+    mp::id_mappings uid_mappings;
+    mp::id_mappings gid_mappings;
+
+    for (QJsonValueRef entry : record["mounts"].toArray())
+    {
+        auto target_path = entry.toObject()["target_path"].toString().toStdString();
+        auto source_path = entry.toObject()["source_path"].toString().toStdString();
+
+        for (QJsonValueRef uid_entry : entry.toObject()["uid_mappings"].toArray())
+        {
+            uid_mappings.push_back(
+                {uid_entry.toObject()["host_uid"].toInt(), uid_entry.toObject()["instance_uid"].toInt()});
+        }
+
+        for (QJsonValueRef gid_entry : entry.toObject()["gid_mappings"].toArray())
+        {
+            gid_mappings.push_back(
+                {gid_entry.toObject()["host_gid"].toInt(), gid_entry.toObject()["instance_gid"].toInt()});
+        }
+
+        auto mount_type = mp::VMMount::MountType(entry.toObject()["mount_type"].toInt());
+        auto profile = entry.toObject()["profile"].toString().toStdString();
+
+        mp::VMMount mount{source_path, gid_mappings, uid_mappings, mount_type, profile};
+        mounts[target_path] = mount;
+    }
+
+    return mp::VMSpecs{num_cores,
+                       mp::MemorySize{mem_size.empty() ? mp::default_memory_size : mem_size},
+                       mp::MemorySize{disk_space.empty() ? mp::default_disk_size : disk_space},
+                       default_mac_address,
+                       read_extra_interfaces(record),
+                       ssh_username,
+                       static_cast<mp::VirtualMachine::State>(state),
+                       mounts,
+                       deleted,
+                       metadata,
+                       pool_profile,
+                       read_placement(record),
+                       read_disk_options(record),
+                       read_network_options(record),
+                       read_snapshots(record),
+                       record["ephemeral"].toBool(),
+                       read_resource_limits(record)};
+}
+
+// The daemon reads the snapshot unless the JSON was written after it, as when it was edited or another version of
+// the daemon wrote it
+bool snapshot_is_current(const QFileInfo& snapshot, const QFileInfo& json)
+{
+    return snapshot.exists() && (!json.exists() || json.lastModified() <= snapshot.lastModified());
+}
+
+/*
+ * The snapshot maps instance names to CBOR byte strings, each holding the record of one instance. The whole outer map
+ * is parsed up front, which only copies each record's bytes; the records themselves are decoded afterwards, one by
+ * one, and reading stops at the first one that does not decode.
+ */
+bool read_snapshot(const QString& file_name,
+                   const std::function<bool(const std::string&, const QJsonObject&)>& read_record)
+{
+    QFile file{file_name};
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto size = file.size();
+    const auto mapped = file.map(0, size);
+    const auto raw = mapped ? QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), size) : file.readAll();
+
+    QCborParserError parse_error;
+    const auto records = QCborValue::fromCbor(raw, &parse_error).toMap();
+    if (parse_error.error != QCborError::NoError)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot read the instance snapshot {}: {}", file_name, parse_error.errorString()));
+        return false;
+    }
+
+    for (auto it = records.constBegin(); it != records.constEnd(); ++it)
+    {
+        const auto record = QCborValue::fromCbor(it.value().toByteArray(), &parse_error).toMap().toJsonObject();
+        if (parse_error.error != QCborError::NoError || !read_record(it.key().toString().toStdString(), record))
+            return false;
+    }
+
+    return true;
+}
+
 std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path, const mp::Path& cache_path)
 {
+    std::unordered_map<std::string, mp::VMSpecs> reconstructed_records;
+    auto read_record = [&reconstructed_records](const std::string& key, const QJsonObject& record) {
+        if (record.isEmpty())
+            return false;
+
+        if (auto specs = read_vm_specs(key, record))
+            reconstructed_records[key] = std::move(*specs);
+        return true;
+    };
+
     QDir data_dir{data_path};
     QDir cache_dir{cache_path};
+    const auto snapshot_file_name = data_dir.filePath(instance_snapshot_name);
+    if (snapshot_is_current(QFileInfo{snapshot_file_name}, QFileInfo{data_dir.filePath(instance_db_name)}))
+    {
+        if (read_snapshot(snapshot_file_name, read_record))
+            return reconstructed_records;
+
+        mpl::log(mpl::Level::warning, category, "Falling back to the JSON instance database");
+        reconstructed_records.clear();
+    }
+
     QFile db_file{data_dir.filePath(instance_db_name)};
     if (!db_file.open(QIODevice::ReadOnly))
     {
@@ -264,75 +963,10 @@ std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
     if (records.isEmpty())
         return {};
 
-    std::unordered_map<std::string, mp::VMSpecs> reconstructed_records;
     for (auto it = records.constBegin(); it != records.constEnd(); ++it)
-    {
-        auto key = it.key().toStdString();
-        auto record = it.value().toObject();
-        if (record.isEmpty())
+        if (!read_record(it.key().toStdString(), it.value().toObject()))
             return {};
 
-        auto num_cores = record["num_cores"].toInt();
-        auto mem_size = record["mem_size"].toString().toStdString();
-        auto disk_space = record["disk_space"].toString().toStdString();
-        auto ssh_username = record["ssh_username"].toString().toStdString();
-        auto state = record["state"].toInt();
-        auto deleted = record["deleted"].toBool();
-        auto metadata = record["metadata"].toObject();
-
-        if (!num_cores && !deleted && ssh_username.empty() && metadata.isEmpty() &&
-            !mp::MemorySize{mem_size}.in_bytes() && !mp::MemorySize{disk_space}.in_bytes())
-        {
-            mpl::log(mpl::Level::warning, category, fmt::format("Ignoring ghost instance in database: {}", key));
-            continue;
-        }
-
-        if (ssh_username.empty())
-            ssh_username = "ubuntu";
-
-        // Read the default network interface, constructed from the "mac_addr" field.
-        auto default_mac_address = record["mac_addr"].toString().toStdString();
-        if (!mpu::valid_mac_address(default_mac_address))
-        {
-            throw std::runtime_error(fmt::format("Invalid MAC address {}", default_mac_address));
-        }
-
-        std::unordered_map<std::string, mp::VMMount> mounts;
-        mp::id_mappings uid_mappings;
-        mp::id_mappings gid_mappings;
-
-        for (QJsonValueRef entry : record["mounts"].toArray())
-        {
-            auto target_path = entry.toObject()["target_path"].toString().toStdString();
-            auto source_path = entry.toObject()["source_path"].toString().toStdString();
-
-            for (QJsonValueRef uid_entry : entry.toObject()["uid_mappings"].toArray())
-            {
-                uid_mappings.push_back(
-                    {uid_entry.toObject()["host_uid"].toInt(), uid_entry.toObject()["instance_uid"].toInt()});
-            }
-
-            for (QJsonValueRef gid_entry : entry.toObject()["gid_mappings"].toArray())
-            {
-                gid_mappings.push_back(
-                    {gid_entry.toObject()["host_gid"].toInt(), gid_entry.toObject()["instance_gid"].toInt()});
-            }
-
-            mp::VMMount mount{source_path, gid_mappings, uid_mappings};
-            mounts[target_path] = mount;
-        }
-
-        reconstructed_records[key] = {num_cores,
-                                      mp::MemorySize{mem_size.empty() ? mp::default_memory_size : mem_size},
-                                      mp::MemorySize{disk_space.empty() ? mp::default_disk_size : disk_space},
-                                      default_mac_address,
-                                      read_extra_interfaces(record),
-                                      ssh_username,
-                                      static_cast<mp::VirtualMachine::State>(state),
-                                      mounts,
-                                      deleted,
-                                      metadata};
-    }
     return reconstructed_records;
 }
 
@@ -521,6 +1155,10 @@ auto validate_create_arguments(const mp::LaunchRequest* request, const mp::Daemo
     std::vector<std::string> nets_need_bridging;
     auto extra_interfaces = validate_extra_interfaces(request, *config->factory, nets_need_bridging, option_errors);
 
+    std::string storage_location;
+    if (!request->storage_pool().empty())
+        storage_location = mp::storage_pool_path(request->storage_pool()).toStdString();
+
     struct CheckedArguments
     {
         mp::MemorySize mem_size;
@@ -529,8 +1167,10 @@ auto validate_create_arguments(const mp::LaunchRequest* request, const mp::Daemo
         std::vector<mp::NetworkInterface> extra_interfaces;
         std::vector<std::string> nets_need_bridging;
         mp::LaunchError option_errors;
-    } ret{std::move(mem_size),         std::move(disk_space),         std::move(instance_name),
-          std::move(extra_interfaces), std::move(nets_need_bridging), std::move(option_errors)};
+        std::string storage_location;
+    } ret{std::move(mem_size),           std::move(disk_space),         std::move(instance_name),
+          std::move(extra_interfaces),   std::move(nets_need_bridging), std::move(option_errors),
+          std::move(storage_location)};
     return ret;
 }
 
@@ -553,17 +1193,50 @@ auto grpc_status_for(fmt::memory_buffer& errors)
                         fmt::format("The following errors occurred:\n{}", error_string), "");
 }
 
+// The instance that a setting like local.<instance>.<property> is about
+mp::optional<std::string> instance_in_setting(const std::string& key)
+{
+    const auto parts = mp::utils::split(key, ".");
+    if (parts.size() == 3 && parts[0] == "local")
+        return parts[1];
+
+    return mp::nullopt;
+}
+
+template <typename TargetPaths>
+std::vector<std::string> instances_in(const TargetPaths& target_paths)
+{
+    std::vector<std::string> instances;
+    for (const auto& target_path : target_paths)
+        instances.push_back(target_path.instance_name());
+
+    return instances;
+}
+
 auto connect_rpc(mp::DaemonRpc& rpc, mp::Daemon& daemon)
 {
+    // Queries run right away on the gRPC thread that received them, so that they need not wait for the main thread to
+    // be done with slower operations. They only read the instance maps, under Daemon::instances_mutex.
+    QObject::connect(&rpc, &mp::DaemonRpc::on_info, &daemon, &mp::Daemon::info, Qt::DirectConnection);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_list, &daemon, &mp::Daemon::list, Qt::DirectConnection);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_version, &daemon, &mp::Daemon::version, Qt::DirectConnection);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_get, &daemon, &mp::Daemon::get, Qt::DirectConnection);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_metrics, &daemon, &mp::Daemon::metrics, Qt::DirectConnection);
+    // Watches hold on to their gRPC thread for as long as the client keeps watching
+    QObject::connect(&rpc, &mp::DaemonRpc::on_watch, &daemon, &mp::Daemon::watch, Qt::DirectConnection);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_top, &daemon, &mp::Daemon::top, Qt::DirectConnection);
+
+    // Find reads the image hosts and the blueprint provider, which the main thread updates without that lock
+    QObject::connect(&rpc, &mp::DaemonRpc::on_find, &daemon, &mp::Daemon::find);
     QObject::connect(&rpc, &mp::DaemonRpc::on_create, &daemon, &mp::Daemon::create);
     QObject::connect(&rpc, &mp::DaemonRpc::on_launch, &daemon, &mp::Daemon::launch);
     QObject::connect(&rpc, &mp::DaemonRpc::on_purge, &daemon, &mp::Daemon::purge);
-    QObject::connect(&rpc, &mp::DaemonRpc::on_find, &daemon, &mp::Daemon::find);
-    QObject::connect(&rpc, &mp::DaemonRpc::on_info, &daemon, &mp::Daemon::info);
-    QObject::connect(&rpc, &mp::DaemonRpc::on_list, &daemon, &mp::Daemon::list);
     QObject::connect(&rpc, &mp::DaemonRpc::on_networks, &daemon, &mp::Daemon::networks);
     QObject::connect(&rpc, &mp::DaemonRpc::on_mount, &daemon, &mp::Daemon::mount);
     QObject::connect(&rpc, &mp::DaemonRpc::on_recover, &daemon, &mp::Daemon::recover);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_clone, &daemon, &mp::Daemon::clone);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_bake, &daemon, &mp::Daemon::bake);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_snapshot, &daemon, &mp::Daemon::snapshot);
     QObject::connect(&rpc, &mp::DaemonRpc::on_ssh_info, &daemon, &mp::Daemon::ssh_info);
     QObject::connect(&rpc, &mp::DaemonRpc::on_start, &daemon, &mp::Daemon::start);
     QObject::connect(&rpc, &mp::DaemonRpc::on_stop, &daemon, &mp::Daemon::stop);
@@ -571,8 +1244,6 @@ auto connect_rpc(mp::DaemonRpc& rpc, mp::Daemon& daemon)
     QObject::connect(&rpc, &mp::DaemonRpc::on_restart, &daemon, &mp::Daemon::restart);
     QObject::connect(&rpc, &mp::DaemonRpc::on_delete, &daemon, &mp::Daemon::delet);
     QObject::connect(&rpc, &mp::DaemonRpc::on_umount, &daemon, &mp::Daemon::umount);
-    QObject::connect(&rpc, &mp::DaemonRpc::on_version, &daemon, &mp::Daemon::version);
-    QObject::connect(&rpc, &mp::DaemonRpc::on_get, &daemon, &mp::Daemon::get);
     QObject::connect(&rpc, &mp::DaemonRpc::on_set, &daemon, &mp::Daemon::set);
     QObject::connect(&rpc, &mp::DaemonRpc::on_keys, &daemon, &mp::Daemon::keys);
     QObject::connect(&rpc, &mp::DaemonRpc::on_authenticate, &daemon, &mp::Daemon::authenticate);
@@ -644,29 +1315,63 @@ auto instances_running(const Instances& instances)
 {
     for (const auto& instance : instances)
     {
-        if (mp::utils::is_running(instance.second->current_state()))
-            return true;
+        if (mp::utils::is_running(instance.second->current_state()))
+            return true;
+    }
+
+    return false;
+}
+
+grpc::Status stop_accepting_ssh_connections(mp::SSHSession& session)
+{
+    auto proc = session.exec(stop_ssh_cmd);
+    auto ecode = proc.exit_code();
+
+    return ecode == 0 ? grpc::Status::OK
+                      : grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
+                                     fmt::format("Could not stop sshd. '{}' exited with code {}", stop_ssh_cmd, ecode),
+                                     proc.read_std_error()};
+}
+
+bool needs_stopping(mp::VirtualMachine& vm)
+{
+    using St = mp::VirtualMachine::State;
+    const auto skip_states = {St::off, St::stopped, St::suspended};
+    const auto state = vm.current_state();
+
+    return std::none_of(cbegin(skip_states), cend(skip_states), [&state](const auto& st) { return state == st; });
+}
+
+mp::optional<mp::SSHSession> shutdown_session_for(mp::VirtualMachine& vm, mp::SSHSessionPool& ssh_sessions)
+{
+    try
+    {
+        // Out of the pool for good: it goes down with the instance
+        return ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username()).take();
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Cannot open ssh session on \"{}\" shutdown: {}", vm.vm_name, e.what()));
+        return mp::nullopt;
     }
-
-    return false;
 }
 
-grpc::Status stop_accepting_ssh_connections(mp::SSHSession& session)
+bool image_exists(const mp::VMImageVault& vault, const std::string& name)
 {
-    auto proc = session.exec(stop_ssh_cmd);
-    auto ecode = proc.exit_code();
-
-    return ecode == 0 ? grpc::Status::OK
-                      : grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
-                                     fmt::format("Could not stop sshd. '{}' exited with code {}", stop_ssh_cmd, ecode),
-                                     proc.read_std_error()};
+    try
+    {
+        vault.all_info_for({"", name, false, "", mp::Query::Type::Alias, true});
+        return true;
+    }
+    catch (const mp::ImageNotFoundException&)
+    {
+        return false;
+    }
 }
 
-grpc::Status ssh_reboot(const std::string& hostname, int port, const std::string& username,
-                        const mp::SSHKeyProvider& key_provider)
+grpc::Status ssh_reboot(mp::SSHSession session)
 {
-    mp::SSHSession session{hostname, port, username, key_provider};
-
     // This allows us to later detect when the machine has finished restarting by waiting for SSH to be back up.
     // Otherwise, there would be a race condition, and we would be unable to distinguish whether it had ever been down.
     stop_accepting_ssh_connections(session);
@@ -688,6 +1393,39 @@ grpc::Status ssh_reboot(const std::string& hostname, int port, const std::string
     return grpc::Status::OK;
 }
 
+void populate_mount_info(mp::MountInfo& mount_info, const mp::VMSpecs& vm_specs, bool mounts_enabled)
+{
+    mount_info.set_longest_path_len(0);
+
+    if (mounts_enabled)
+    {
+        for (const auto& mount : vm_specs.mounts)
+        {
+            if (mount.second.source_path.size() > mount_info.longest_path_len())
+            {
+                mount_info.set_longest_path_len(mount.second.source_path.size());
+            }
+
+            auto entry = mount_info.add_mount_paths();
+            entry->set_source_path(mount.second.source_path);
+            entry->set_target_path(mount.first);
+
+            for (const auto& uid_mapping : mount.second.uid_mappings)
+            {
+                auto uid_pair = entry->mutable_mount_maps()->add_uid_mappings();
+                uid_pair->set_host_id(uid_mapping.first);
+                uid_pair->set_instance_id(uid_mapping.second);
+            }
+            for (const auto& gid_mapping : mount.second.gid_mappings)
+            {
+                auto gid_pair = entry->mutable_mount_maps()->add_gid_mappings();
+                gid_pair->set_host_id(gid_mapping.first);
+                gid_pair->set_instance_id(gid_mapping.second);
+            }
+        }
+    }
+}
+
 mp::InstanceStatus::Status grpc_instance_status_for(const mp::VirtualMachine::State& state)
 {
     switch (state)
@@ -713,6 +1451,97 @@ mp::InstanceStatus::Status grpc_instance_status_for(const mp::VirtualMachine::St
     }
 }
 
+mp::WatchReply state_event(const std::string& name, mp::InstanceStatus::Status status)
+{
+    mp::WatchReply event;
+    event.set_instance_name(name);
+    event.mutable_instance_status()->set_status(status);
+
+    return event;
+}
+
+mp::WatchReply mounts_event(const std::string& name, const mp::VMSpecs& vm_specs, bool mounts_enabled)
+{
+    mp::WatchReply event;
+    event.set_instance_name(name);
+    populate_mount_info(*event.mutable_mount_info(), vm_specs, mounts_enabled);
+
+    return event;
+}
+
+mp::WatchReply addresses_event(const std::string& name, const std::vector<std::string>& ipv4)
+{
+    mp::WatchReply event;
+    event.set_instance_name(name);
+    for (const auto& address : ipv4)
+        event.mutable_addresses()->add_ipv4(address);
+
+    return event;
+}
+
+long long block_bytes(const mp::GuestStats& stats, long long mp::BlockDeviceStats::*counter)
+{
+    long long total = 0;
+    for (const auto& device : stats.block_devices)
+        total += device.*counter;
+
+    return total;
+}
+
+// What an instance used between two of its samples; whatever either sample lacks is left at zero
+void set_usage_between(const mp::GuestStats& before, const mp::GuestStats& after, double seconds,
+                       mp::TopReply::InstanceUsage& usage)
+{
+    auto per_second = [seconds](const mp::optional<long long>& from, const mp::optional<long long>& to) {
+        return from && to && *to >= *from ? static_cast<long long>((*to - *from) / seconds) : 0LL;
+    };
+
+    if (before.cpu_time_ms && after.cpu_time_ms)
+        usage.set_cpu_percent((*after.cpu_time_ms - *before.cpu_time_ms) / (seconds * 10)); // of 1000ms per second
+    usage.set_resident_bytes(after.resident_bytes.value_or(0));
+    usage.set_balloon_bytes(after.balloon_bytes.value_or(0));
+    usage.set_disk_read_bytes_per_second(per_second(block_bytes(before, &mp::BlockDeviceStats::read_bytes),
+                                                    block_bytes(after, &mp::BlockDeviceStats::read_bytes)));
+    usage.set_disk_written_bytes_per_second(per_second(block_bytes(before, &mp::BlockDeviceStats::written_bytes),
+                                                       block_bytes(after, &mp::BlockDeviceStats::written_bytes)));
+    usage.set_network_received_bytes_per_second(
+        per_second(before.network_received_bytes, after.network_received_bytes));
+    usage.set_network_sent_bytes_per_second(per_second(before.network_sent_bytes, after.network_sent_bytes));
+}
+
+void add_launch_phases(const std::string& name, const mp::LaunchTimings::Phases& phases, mp::LaunchReply& reply)
+{
+    std::vector<std::string> described;
+    for (const auto& [phase, duration] : phases)
+    {
+        auto entry = reply.add_launch_phases();
+        entry->set_name(phase);
+        entry->set_seconds(duration.count());
+        described.push_back(fmt::format("{} {:.2f}s", phase, duration.count()));
+    }
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Launch phases of {}: {}", name, fmt::join(described, ", ")));
+}
+
+// Best effort: instances on backends without a balloon keep all their memory
+void reclaim_memory_of(mp::VirtualMachine& vm, const mp::MemorySize& target)
+{
+    try
+    {
+        vm.set_balloon_target(target);
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("Ballooned \"{}\" to {}", vm.vm_name, target.human_readable()));
+    }
+    catch (const mp::NotImplementedOnThisBackendException&)
+    {
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot reclaim memory of \"{}\": {}", vm.vm_name, e.what()));
+    }
+}
+
 // Computes the final size of an image, but also checks if the value given by the user is bigger than or equal than
 // the size of the image.
 mp::MemorySize compute_final_image_size(const mp::MemorySize image_size,
@@ -760,55 +1589,30 @@ mp::MemorySize compute_final_image_size(const mp::MemorySize image_size,
     return disk_space;
 }
 
-std::unordered_set<std::string> mac_set_from(const mp::VMSpecs& spec)
+std::vector<std::string> macs_of(const mp::VMSpecs& spec)
 {
-    std::unordered_set<std::string> macs{};
-
-    macs.insert(spec.default_mac_address);
-
+    std::vector<std::string> macs{spec.default_mac_address};
     for (const auto& extra_iface : spec.extra_interfaces)
-        macs.insert(extra_iface.mac_address);
+        macs.push_back(extra_iface.mac_address);
 
     return macs;
 }
 
-// Merge the contents of t into s, iff the sets are disjoint (i.e. make s = sUt). Return whether s and t were disjoint.
-bool merge_if_disjoint(std::unordered_set<std::string>& s, const std::unordered_set<std::string>& t)
-{
-    if (any_of(cbegin(s), cend(s), [&t](const auto& mac) { return t.find(mac) != cend(t); }))
-        return false;
-
-    s.insert(cbegin(t), cend(t));
-    return true;
-}
 
-// Generate a MAC address which does not exist in the set s. Then add the address to s.
-std::string generate_unused_mac_address(std::unordered_set<std::string>& s)
+void set_runtime_info(mp::InfoReply::Info& info, const mp::InstanceMetrics& metrics,
+                      const std::string& original_release)
 {
-    // TODO: Checking in our list of MAC addresses does not suffice to conclude the generated MAC is unique. We
-    // should also check in the ARP table.
-    static constexpr auto max_tries = 5;
-    for (auto i = 0; i < max_tries; ++i)
-        if (auto [it, success] = s.insert(mp::utils::generate_mac_address()); success)
-            return *it;
+    info.set_load(metrics.load);
+    info.set_memory_usage(metrics.memory_usage);
+    info.set_memory_total(metrics.memory_total);
+    info.set_disk_usage(metrics.disk_usage);
+    info.set_disk_total(metrics.disk_total);
 
-    throw std::runtime_error{
-        fmt::format("Failed to generate an unique mac address after {} attempts. Number of mac addresses in use: {}",
-                    max_tries, s.size())};
-}
-
-bool is_ipv4_valid(const std::string& ipv4)
-{
-    try
-    {
-        (mp::IPAddress(ipv4));
-    }
-    catch (std::invalid_argument&)
-    {
-        return false;
-    }
+    for (const auto& ipv4 : metrics.ipv4)
+        info.add_ipv4(ipv4);
 
-    return true;
+    info.set_current_release(!metrics.current_release.empty() ? metrics.current_release : original_release);
+    info.set_runtime_info_timestamp(metrics.collected_at.toString(Qt::ISODate).toStdString());
 }
 
 void add_aliases(mp::FindReply& response, const std::string& remote_name, const mp::VMImageInfo& info,
@@ -833,6 +1637,26 @@ void add_aliases(mp::FindReply& response, const std::string& remote_name, const
     }
 }
 
+void list_all_images(mp::FindReply& response, const std::vector<std::unique_ptr<mp::VMImageHost>>& image_hosts,
+                     bool allow_unsupported, const std::string& default_remote)
+{
+    for (const auto& image_host : image_hosts)
+    {
+        std::unordered_set<std::string> images_found;
+        auto action = [&images_found, &default_remote, allow_unsupported, &response](const std::string& remote,
+                                                                                    const mp::VMImageInfo& info) {
+            if ((info.supported || allow_unsupported) && !info.aliases.empty() &&
+                images_found.find(info.release_title.toStdString()) == images_found.end())
+            {
+                add_aliases(response, remote, info, default_remote);
+                images_found.insert(info.release_title.toStdString());
+            }
+        };
+
+        image_host->for_each_entry_do(action);
+    }
+}
+
 auto timeout_for(const int requested_timeout, const int blueprint_timeout)
 {
     if (requested_timeout > 0)
@@ -855,6 +1679,28 @@ register_instance_mod(std::unordered_map<std::string, mp::VMSpecs>& vm_instance_
         vm_instance_specs, vm_instances, deleted_instances, preparing_instances, std::move(instance_persister)));
 }
 
+// Lets the backend answer for all instances at once; should that fail, each instance is asked on its own
+void prefetch_instance_states(mp::VirtualMachineFactory& factory)
+{
+    try
+    {
+        factory.prefetch_instance_states();
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot prefetch instance states: {}", e.what()));
+    }
+}
+
+// Only where clients reach the daemon through a socket file, whose directory all of them can read
+QString completions_file_for(const std::string& server_address)
+{
+    const auto address = QString::fromStdString(server_address);
+    if (!address.startsWith("unix:"))
+        return {};
+
+    return QFileInfo{address.mid(5)}.dir().filePath(completions_name);
+}
 } // namespace
 
 mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
@@ -865,10 +1711,32 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
       daemon_rpc{config->server_address, *config->cert_provider, config->client_cert_store.get()},
       instance_mounts{*config->ssh_key_provider},
       instance_mod_handler{register_instance_mod(vm_instance_specs, vm_instances, deleted_instances,
-                                                 preparing_instances, [this] { persist_instances(); })}
+                                                 preparing_instances, [this] { queue_instances_persistence(); })},
+      ssh_sessions{*config->ssh_key_provider},
+      instance_metrics{*config->ssh_key_provider, ssh_sessions},
+      metrics_interval{metrics_interval_setting()},
+      warm_pool{warm_pool_size_setting()},
+      reclaim_idle_memory{reclaim_memory_setting()},
+      idle_policy{idle_suspend_setting()},
+      admission{admission_limits()},
+      federation{federation_members(), *config->cert_provider},
+      cloud_init_datasource{make_cloud_init_datasource(*config->factory)},
+      mounts_enabled{mp::mounts_key, false},
+      profiler{QDir{config->data_directory}.filePath("profiles")},
+      instance_workers{"instance workers", max_instance_workers},
+      readiness_waiters{"readiness waiters", max_readiness_waiters},
+      image_preparers{"image preparers", max_image_preparers},
+      async_operations{"async operations", max_async_operations}
 {
+    // Batch the bursts of state changes that come with operating on several instances at once into a single write
+    instances_persistence_timer.setSingleShot(true);
+    instances_persistence_timer.setInterval(instances_persistence_delay);
+    connect(&instances_persistence_timer, &QTimer::timeout, this,
+            [this] { write_instances(serialize_dirty_instances()); });
+
     connect_rpc(daemon_rpc, *this);
-    std::vector<std::string> invalid_specs;
+    config->url_downloader->set_rate_limit(download_limit_setting());
+    std::vector<std::string> invalid_specs, leftover_ephemeral;
 
     try
     {
@@ -884,6 +1752,13 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
         const auto& name = entry.first;
         auto& spec = entry.second;
 
+        // Only a daemon that did not stop cleanly leaves any behind, with their images on disk
+        if (spec.ephemeral)
+        {
+            leftover_ephemeral.push_back(name);
+            continue;
+        }
+
         if (!config->vault->has_record_for(name))
         {
             invalid_specs.push_back(name);
@@ -891,13 +1766,12 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
         }
 
         // Check that all the interfaces in the instance have different MAC address, and that they were not used in
-        // the other instances. String validity was already checked in load_db(). Add these MAC's to the daemon's set
-        // only if this instance is not invalid.
-        auto new_macs = mac_set_from(spec);
-
-        if (new_macs.size() <= spec.extra_interfaces.size() || !merge_if_disjoint(new_macs, allocated_mac_addrs))
+        // the other instances. String validity was already checked in load_db(). These MAC's stay claimed only if
+        // this instance is not invalid.
+        auto instance_macs = macs_of(spec);
+        if (allocated_macs.claim(instance_macs))
         {
-            // There is at least one repeated address in new_macs.
+            // There is at least one repeated address in instance_macs.
             mpl::log(mpl::Level::warning, category, fmt::format("{} has repeated MAC addresses", name));
             invalid_specs.push_back(name);
             continue;
@@ -908,6 +1782,7 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
         {
             mpl::log(mpl::Level::warning, category,
                      fmt::format("Could not find image for '{}'. Expected location: {}", name, vm_image.image_path));
+            allocated_macs.release(instance_macs);
             invalid_specs.push_back(name);
             continue;
         }
@@ -926,12 +1801,28 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
                                               {},
                                               {},
                                               {},
-                                              {}};
-
-        auto& instance_record = spec.deleted ? deleted_instances : vm_instances;
-        instance_record[name] = config->factory->create_virtual_machine(vm_desc, *this);
+                                              {},
+                                              spec.placement,
+                                              spec.disk_options,
+                                              spec.network_options,
+                                              spec.resource_limits};
+
+        // Instances without an ISO were launched to fetch their cloud-init data, which they look for on every boot.
+        // Their instance-id is what keeps them from being set up again, so the rest need not be what they first got.
+        if (cloud_init_datasource && !QFile::exists(cloud_init_iso))
+        {
+            vm_desc.meta_data_config = make_cloud_init_meta_config(name);
+            vm_desc.vendor_data_config = vendor_config_for("");
+            vm_desc.network_data_config =
+                make_cloud_init_network_config(spec.default_mac_address, spec.extra_interfaces);
+            seed_cloud_init(vm_desc);
+            vm_desc.cloud_init_iso.clear();
+        }
 
-        allocated_mac_addrs = std::move(new_macs); // Add the new macs to the daemon's list only if we got this far
+        {
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+            pending_instances.emplace(name, std::move(vm_desc));
+        }
 
         // FIXME: somehow we're writing contradictory state to disk.
         if (spec.deleted && spec.state != VirtualMachine::State::stopped)
@@ -939,37 +1830,37 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
             mpl::log(mpl::Level::warning, category,
                      fmt::format("{} is deleted but has incompatible state {}, resetting state to 0 (stopped)", name,
                                  static_cast<int>(spec.state)));
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
             spec.state = VirtualMachine::State::stopped;
         }
-
-        if (spec.state == VirtualMachine::State::running && vm_instances[name]->state != VirtualMachine::State::running)
-        {
-            assert(!spec.deleted);
-            mpl::log(mpl::Level::info, category, fmt::format("{} needs starting. Starting now...", name));
-
-            QTimer::singleShot(0, [this, &name] {
-                multipass::top_catch_all(name, [this, &name]() {
-                    vm_instances[name]->start();
-                    on_restart(name);
-                });
-            });
-        }
     }
 
     for (const auto& bad_spec : invalid_specs)
     {
         mpl::log(mpl::Level::warning, category, fmt::format("Removing invalid instance: {}", bad_spec));
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
         vm_instance_specs.erase(bad_spec);
     }
 
-    if (!invalid_specs.empty())
+    if (!leftover_ephemeral.empty())
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Purging ephemeral instances left over: {}", fmt::join(leftover_ephemeral, ", ")));
+        release_resources(leftover_ephemeral);
+    }
+
+    if (!invalid_specs.empty() || !leftover_ephemeral.empty())
         persist_instances();
 
+    // Backends can take a while with each instance, so leave them to the event loop, interleaved with requests
+    if (!pending_instances.empty())
+        QTimer::singleShot(0, this, [this] { reconstruct_pending_instances(); });
+
     config->vault->prune_expired_images();
 
     // Fire timer every six hours to perform maintenance on source images such as
-    // pruning expired images and updating to newly released images.
-    connect(&source_images_maintenance_task, &QTimer::timeout, [this]() {
+    // pruning expired images, updating to newly released images and prefetching configured images.
+    auto maintain_source_images = [this]() {
         if (image_update_future.isRunning())
         {
             mpl::log(mpl::Level::info, category, "Image updater already running. Skipping…");
@@ -977,10 +1868,13 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
         else
         {
             image_update_future = QtConcurrent::run([this] {
+                // Nobody waits on these, so they give way to the downloads of launches
+                DownloadScheduler::PriorityScope background{DownloadPriority::background};
                 config->vault->prune_expired_images();
+                config->vault->maintain_images();
 
                 auto prepare_action = [this](const VMImage& source_image) -> VMImage {
-                    return config->factory->prepare_source_image(source_image);
+                    return config->factory->prepare_source_image(source_image, ProgressMonitor{});
                 };
 
                 auto download_monitor = [](int download_type, int percentage) {
@@ -1005,15 +1899,71 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
                 {
                     mpl::log(mpl::Level::error, category, fmt::format("Error updating images: {}", e.what()));
                 }
+
+                try
+                {
+                    const auto queries = prefetch_queries_from(prefetch_setting(), *config->blueprint_provider);
+                    if (!queries.empty())
+                        config->vault->prefetch_images(config->factory->fetch_type(), queries, prepare_action,
+                                                       download_monitor);
+                }
+                catch (const std::exception& e)
+                {
+                    mpl::log(mpl::Level::error, category, fmt::format("Error prefetching images: {}", e.what()));
+                }
             });
         }
-    });
+    };
+    connect(&source_images_maintenance_task, &QTimer::timeout, maintain_source_images);
     source_images_maintenance_task.start(config->image_refresh_timer);
+
+    // Don't wait for the first refresh to get images that should be kept ready
+    if (!prefetch_setting().isEmpty())
+        QTimer::singleShot(prefetch_startup_delay, this, maintain_source_images);
+
+    // Left as it is otherwise, for it may be there for others
+    if (memory_merging_setting())
+        mp::utils::enable_memory_merging();
+
+    if (metrics_interval > std::chrono::seconds::zero())
+    {
+        connect(&metrics_refresh_timer, &QTimer::timeout, this, [this] { refresh_metrics(); });
+        metrics_refresh_timer.start(metrics_interval);
+    }
+    else if (idle_policy.enabled())
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Idle instances are not suspended without metrics; set {}", mp::metrics_interval_key));
+
+    connect(&addresses_refresh_timer, &QTimer::timeout, this, [this] { refresh_addresses(); });
+    addresses_refresh_timer.start(addresses_refresh_interval);
+
+    connect(&memory_summary_timer, &QTimer::timeout, this,
+            [this] { mpl::log(mpl::Level::info, category, fmt::format("Memory: {}", memory_account().summary())); });
+    memory_summary_timer.start(memory_summary_interval);
 }
 
 mp::Daemon::~Daemon()
 {
+    instance_events.close(); // for watchers to let go of their gRPC threads
     mp::top_catch_all(category, [this] { MP_SETTINGS.unregister_handler(instance_mod_handler); });
+
+    take_down_instances();
+
+    // Ephemeral instances do not outlive the daemon
+    std::vector<std::string> ephemeral;
+    for (const auto& [name, spec] : vm_instance_specs)
+        if (spec.ephemeral)
+            ephemeral.push_back(name);
+    mp::top_catch_all(category, [this, &ephemeral] { release_resources(ephemeral); });
+
+    mp::top_catch_all(category, [this] { persist_instances(); }); // once, for all that the instances went through
+    instances_writer.waitForFinished();
+
+    // Completions are not to offer the names of a daemon that is gone
+    if (const auto completions_file = completions_file_for(config->server_address); !completions_file.isEmpty())
+        QFile::remove(completions_file);
+    metrics_refresh.waitForFinished();
+    addresses_refresh.waitForFinished();
 }
 
 void mp::Daemon::create(const CreateRequest* request, grpc::ServerWriterInterface<CreateReply>* server,
@@ -1021,6 +1971,8 @@ void mp::Daemon::create(const CreateRequest* request, grpc::ServerWriterInterfac
 try // clang-format on
 {
     mpl::ClientLogger<CreateReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    mpt::ContextScope trace_scope{mpt::context_of(server)};
+    wait_for_instances({}); // new names must not clash with those already taken
     return create_vm(request, server, status_promise, /*start=*/false);
 }
 catch (const std::exception& e)
@@ -1033,6 +1985,11 @@ void mp::Daemon::launch(const LaunchRequest* request, grpc::ServerWriterInterfac
 try // clang-format on
 {
     mpl::ClientLogger<LaunchReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    mpt::ContextScope trace_scope{mpt::context_of(server)};
+    wait_for_instances({}); // new names must not clash with those already taken
+
+    if (launch_on_member(request, server, status_promise) || launch_from_warm_pool(request, server, status_promise))
+        return;
 
     return create_vm(request, server, status_promise, /*start=*/true);
 }
@@ -1041,8 +1998,11 @@ catch (const mp::StartException& e)
     auto name = e.name();
 
     release_resources(name);
-    vm_instances.erase(name);
-    persist_instances();
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        vm_instances.erase(name);
+    }
+    queue_instances_persistence();
 
     status_promise->set_value(grpc::Status(grpc::StatusCode::ABORTED, e.what(), ""));
 }
@@ -1051,19 +2011,52 @@ catch (const std::exception& e)
     status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
 }
 
+bool mp::Daemon::launch_on_member(const LaunchRequest* request, grpc::ServerWriterInterface<LaunchReply>* server,
+                                  std::promise<grpc::Status>* status_promise)
+{
+    const auto host_memory = mp::utils::host_memory_bytes();
+    if (federation.empty() || Federation::is_relayed(server) || host_memory <= 0)
+        return false;
+
+    // Placed by the same overcommit ratio that the metrics give, so that members can be compared with one another
+    const auto label = federation.less_loaded_than(static_cast<double>(running_instance_memory()) / host_memory);
+    if (!label)
+        return false;
+
+    mpl::log(mpl::Level::info, category, fmt::format("Launching on {}, the least loaded member", *label));
+    instance_workers.run_task([this, request, server, status_promise, label = *label] {
+        auto relay = [server, &label](LaunchReply& reply) {
+            if (!reply.vm_instance_name().empty())
+                reply.set_vm_instance_name(Federation::qualified(reply.vm_instance_name(), label));
+
+            return server->Write(reply);
+        };
+
+        status_promise->set_value(federation.launch(label, *request, relay));
+    });
+
+    return true;
+}
+
 void mp::Daemon::purge(const PurgeRequest* request, grpc::ServerWriterInterface<PurgeReply>* server,
                        std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
+    wait_for_instances({});
     PurgeReply response;
 
+    std::vector<std::string> purged;
     for (const auto& del : deleted_instances)
     {
-        release_resources(del.first);
+        purged.push_back(del.first);
         response.add_purged_instances(del.first);
     }
+    release_resources(purged);
 
-    deleted_instances.clear();
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        deleted_instances.clear();
+    }
     persist_instances();
 
     server->Write(response);
@@ -1079,7 +2072,8 @@ void mp::Daemon::find(const FindRequest* request, grpc::ServerWriterInterface<Fi
 try // clang-format on
 {
     mpl::ClientLogger<FindReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
-    FindReply response;
+    google::protobuf::Arena arena; // for the whole reply to go in a few blocks, and away at once
+    auto& response = *google::protobuf::Arena::CreateMessage<FindReply>(&arena);
     const auto default_remote{"release"};
 
     if (!request->search_string().empty())
@@ -1133,21 +2127,7 @@ try // clang-format on
     }
     else if (request->remote_name().empty())
     {
-        for (const auto& image_host : config->image_hosts)
-        {
-            std::unordered_set<std::string> images_found;
-            auto action = [&images_found, &default_remote, request, &response](const std::string& remote,
-                                                                               const mp::VMImageInfo& info) {
-                if ((info.supported || request->allow_unsupported()) && !info.aliases.empty() &&
-                    images_found.find(info.release_title.toStdString()) == images_found.end())
-                {
-                    add_aliases(response, remote, info, default_remote);
-                    images_found.insert(info.release_title.toStdString());
-                }
-            };
-
-            image_host->for_each_entry_do(action);
-        }
+        add_all_images(response, request->allow_unsupported(), default_remote);
 
         auto vm_blueprints_info = config->blueprint_provider->all_blueprints();
 
@@ -1167,6 +2147,10 @@ try // clang-format on
             add_aliases(response, remote, info, "");
         }
     }
+
+    if (!federation.empty() && !Federation::is_relayed(server))
+        add_member_images(response, federation.find(*request));
+
     server->Write(response);
     status_promise->set_value(grpc::Status::OK);
 }
@@ -1175,48 +2159,137 @@ catch (const std::exception& e)
     status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
 }
 
+// Listing every image of every remote takes going over all the manifests, which only change when they are refreshed
+void mp::Daemon::add_all_images(FindReply& response, bool allow_unsupported, const std::string& default_remote)
+{
+    std::vector<std::size_t> generations;
+    for (const auto& image_host : config->image_hosts)
+    {
+        if (auto generation = image_host->manifest_generation())
+            generations.push_back(*generation);
+        else
+            return list_all_images(response, config->image_hosts, allow_unsupported, default_remote);
+    }
+
+    std::lock_guard<std::mutex> lock{listed_images_mutex};
+    auto& listed = listed_images[allow_unsupported];
+    if (!listed || listed->generations != generations)
+    {
+        listed.emplace();
+        listed->generations = std::move(generations);
+        list_all_images(listed->images, config->image_hosts, allow_unsupported, default_remote);
+    }
+
+    response.MergeFrom(listed->images);
+}
+
 void mp::Daemon::info(const InfoRequest* request, grpc::ServerWriterInterface<InfoReply>* server,
                       std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
     mpl::ClientLogger<InfoReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
-    InfoReply response;
+    wait_for_instances(request->instance_names().instance_name());
+    google::protobuf::Arena arena;
+    auto& response = *google::protobuf::Arena::CreateMessage<InfoReply>(&arena);
 
     fmt::memory_buffer errors;
     bool have_mounts = false;
-    std::vector<decltype(vm_instances)::key_type> instances_for_info;
+    const auto mounts_are_enabled = mounts_enabled.get();
 
-    if (request->instance_names().instance_name().empty())
+    struct PendingMetrics
     {
-        for (auto& pair : vm_instances)
-            instances_for_info.push_back(pair.first);
-    }
-    else
+        InfoReply::Info* info;
+        std::string original_release;
+        std::future<InstanceMetrics> metrics;
+    };
+    std::vector<PendingMetrics> pending_metrics;
+
+    struct Requested
     {
-        for (const auto& name : request->instance_names().instance_name())
-            instances_for_info.push_back(name);
-    }
+        InfoReply::Info* info;
+        VirtualMachine::ShPtr vm;
+        bool deleted;
+        std::string ssh_username;
+    };
+    std::vector<Requested> requested;
+
+    // Names of member instances go to their members without the label; asking for all asks every member for all
+    std::map<std::string, InfoRequest> member_requests;
+    auto add_member_request = [request, &member_requests](const std::string& label, const std::string& name) {
+        auto [it, added] = member_requests.try_emplace(label, *request);
+        if (added)
+            it->second.mutable_instance_names()->clear_instance_name();
+        if (!name.empty())
+            it->second.mutable_instance_names()->add_instance_name(name);
+    };
+
+    if (request->instance_names().instance_name().empty() && !Federation::is_relayed(server))
+        for (const auto& label : federation.labels())
+            add_member_request(label, "");
 
-    for (const auto& name : instances_for_info)
+    // The records are read in place rather than copied out, so that instances with many mounts cost no more than the
+    // entries they add to the reply. The main thread can go on changing instances once we have their pointers.
     {
-        auto it = vm_instances.find(name);
-        bool deleted{false};
-        if (it == vm_instances.end())
-        {
-            it = deleted_instances.find(name);
-            if (it == deleted_instances.end())
+        std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+        auto add_entry = [this, &response, &errors, &have_mounts, &requested,
+                          mounts_are_enabled](const std::string& name) {
+            auto it = vm_instances.find(name);
+            bool deleted{false};
+            if (it == vm_instances.end())
             {
-                fmt::format_to(errors, "instance \"{}\" does not exist\n", name);
-                continue;
+                it = deleted_instances.find(name);
+                if (it == deleted_instances.end())
+                {
+                    fmt::format_to(errors, "instance \"{}\" does not exist\n", name);
+                    return;
+                }
+                deleted = true;
             }
-            deleted = true;
+
+            static const VMSpecs no_specs{};
+            auto specs_it = vm_instance_specs.find(name);
+            const auto& vm_specs = specs_it != vm_instance_specs.end() ? specs_it->second : no_specs;
+
+            auto info = response.add_info();
+            info->set_name(name);
+            if (!vm_specs.mounts.empty())
+                have_mounts = true;
+
+            populate_mount_info(*info->mutable_mount_info(), vm_specs, mounts_are_enabled);
+            requested.push_back({info, it->second, deleted, vm_specs.ssh_username});
+        };
+
+        if (request->instance_names().instance_name().empty())
+        {
+            for (const auto& instance : vm_instances)
+                add_entry(instance.first);
+        }
+        else
+        {
+            for (const auto& name : request->instance_names().instance_name())
+                if (auto member = federation.split(name))
+                    add_member_request(member->second, member->first);
+                else
+                    add_entry(name);
         }
+    }
 
-        auto info = response.add_info();
-        auto& vm = it->second;
-        auto present_state = vm->current_state();
-        info->set_name(name);
-        if (deleted)
+    // Members work on their part while this daemon does its own
+    std::future<Federation::Answers<InfoReply>> member_answers;
+    if (!member_requests.empty())
+    {
+        auto ask_members = [this, requests = std::move(member_requests)] { return federation.info(requests); };
+        member_answers = instance_workers.run_task(std::move(ask_members));
+    }
+
+    prefetch_instance_states(*config->factory);
+
+    for (const auto& entry : requested)
+    {
+        auto info = entry.info;
+        const auto& name = info->name();
+        auto present_state = entry.vm->current_state();
+        if (entry.deleted)
         {
             info->mutable_instance_status()->set_status(mp::InstanceStatus::DELETED);
         }
@@ -1242,76 +2315,43 @@ try // clang-format on
         }
 
         info->set_image_release(original_release);
-        info->set_id(vm_image.id);
-
-        auto vm_specs = vm_instance_specs[name];
-
-        auto mount_info = info->mutable_mount_info();
-
-        mount_info->set_longest_path_len(0);
-
-        if (!vm_specs.mounts.empty())
-            have_mounts = true;
-
-        if (MP_SETTINGS.get_as<bool>(mp::mounts_key))
-        {
-            for (const auto& mount : vm_specs.mounts)
-            {
-                if (mount.second.source_path.size() > mount_info->longest_path_len())
-                {
-                    mount_info->set_longest_path_len(mount.second.source_path.size());
-                }
-
-                auto entry = mount_info->add_mount_paths();
-                entry->set_source_path(mount.second.source_path);
-                entry->set_target_path(mount.first);
-
-                for (const auto& uid_mapping : mount.second.uid_mappings)
-                {
-                    auto uid_pair = entry->mutable_mount_maps()->add_uid_mappings();
-                    uid_pair->set_host_id(uid_mapping.first);
-                    uid_pair->set_instance_id(uid_mapping.second);
-                }
-                for (const auto& gid_mapping : mount.second.gid_mappings)
-                {
-                    auto gid_pair = entry->mutable_mount_maps()->add_gid_mappings();
-                    gid_pair->set_host_id(gid_mapping.first);
-                    gid_pair->set_instance_id(gid_mapping.second);
-                }
-            }
-        }
+        info->set_id(std::move(vm_image.id));
 
         if (!request->no_runtime_information() && mp::utils::is_running(present_state))
         {
-            mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                   *config->ssh_key_provider};
-
-            info->set_load(mpu::run_in_ssh_session(session, "cat /proc/loadavg | cut -d ' ' -f1-3"));
-            info->set_memory_usage(mpu::run_in_ssh_session(session, "free -b | grep 'Mem:' | awk '{printf $3}'"));
-            info->set_memory_total(mpu::run_in_ssh_session(session, "free -b | grep 'Mem:' | awk '{printf $2}'"));
-            info->set_disk_usage(mpu::run_in_ssh_session(
-                session, "df --output=used `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d"));
-            info->set_disk_total(mpu::run_in_ssh_session(
-                session, "df --output=size `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d"));
-
-            std::string management_ip = vm->management_ipv4();
-            auto all_ipv4 = vm->get_all_ipv4(*config->ssh_key_provider);
+            // Served from the background refreshes while they keep up; instances new to them are asked right away
+            mp::optional<InstanceMetrics> metrics;
+            if (metrics_interval > std::chrono::seconds::zero())
+                metrics = instance_metrics.cached(name, 2 * metrics_interval);
 
-            if (is_ipv4_valid(management_ip))
-                info->add_ipv4(management_ip);
-            else if (all_ipv4.empty())
-                info->add_ipv4("N/A");
+            if (metrics)
+            {
+                set_runtime_info(*info, *metrics, original_release);
+            }
+            else
+            {
+                auto collect = [this, vm = entry.vm, username = entry.ssh_username] {
+                    return instance_metrics.collect(*vm, username);
+                };
+                pending_metrics.push_back({info, original_release, instance_workers.run_task(std::move(collect))});
+            }
+        }
+    }
 
-            for (const auto& extra_ipv4 : all_ipv4)
-                if (extra_ipv4 != management_ip)
-                    info->add_ipv4(extra_ipv4);
+    // All the instances are asked at once, so the slowest one sets the pace; the reply keeps the requested order
+    for (auto& pending : pending_metrics)
+        set_runtime_info(*pending.info, pending.metrics.get(), pending.original_release);
 
-            auto current_release = mpu::run_in_ssh_session(session, "lsb_release -ds");
-            info->set_current_release(!current_release.empty() ? current_release : original_release);
+    if (member_answers.valid())
+        for (auto& [label, answer] : member_answers.get())
+        {
+            if (answer.status.ok())
+                add_member_entries(*response.mutable_info(), label, *answer.reply.mutable_info());
+            else
+                fmt::format_to(errors, "member \"{}\": {}\n", label, answer.status.error_message());
         }
-    }
 
-    if (have_mounts && !MP_SETTINGS.get_as<bool>(mp::mounts_key))
+    if (have_mounts && !mounts_are_enabled)
         mpl::log(mpl::Level::error, category, "Mounts have been disabled on this instance of Multipass");
 
     auto status = grpc_status_for(errors);
@@ -1330,62 +2370,70 @@ void mp::Daemon::list(const ListRequest* request, grpc::ServerWriterInterface<Li
 try // clang-format on
 {
     mpl::ClientLogger<ListReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
-    ListReply response;
-    config->update_prompt->populate_if_time_to_show(response.mutable_update_info());
+    wait_for_instances({});
+    google::protobuf::Arena arena;
+    auto& response = *google::protobuf::Arena::CreateMessage<ListReply>(&arena);
+    auto& pending_response = *google::protobuf::Arena::CreateMessage<ListReply>(&arena);
+
+    // Work on a snapshot, so that the main thread can go on changing instances while we query them
+    decltype(vm_instances) instances;
+    decltype(deleted_instances) deleted;
+    {
+        std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+        instances = vm_instances;
+        deleted = deleted_instances;
+    }
 
-    for (const auto& instance : vm_instances)
+    prefetch_instance_states(*config->factory);
+
+    std::vector<std::pair<ListVMInstance*, std::future<std::vector<std::string>>>> pending_ipv4;
+    for (const auto& instance : instances)
     {
         const auto& name = instance.first;
         const auto& vm = instance.second;
         auto present_state = vm->current_state();
-        auto entry = response.add_instances();
+        auto wants_ipv4 = request->request_ipv4() && mp::utils::is_running(present_state);
+        auto ipv4 = wants_ipv4 ? instance_addresses.known(name) : mp::nullopt;
+
+        // Incremental clients get what is known straight away, and entries waiting on addresses once they come
+        auto pending = wants_ipv4 && !ipv4;
+        auto entry = (pending && request->incremental() ? pending_response : response).add_instances();
         entry->set_name(name);
         entry->mutable_instance_status()->set_status(grpc_instance_status_for(present_state));
 
         // FIXME: Set the release to the cached current version when supported
-        auto vm_image = fetch_image_for(name, config->factory->fetch_type(), *config->vault);
-        auto current_release = vm_image.original_release;
-
-        if (!vm_image.id.empty() && current_release.empty())
-        {
-            try
-            {
-                auto vm_image_info = config->image_hosts.back()->info_for_full_hash(vm_image.id);
-                current_release = vm_image_info.release_title.toStdString();
-            }
-            catch (const std::exception& e)
-            {
-                mpl::log(mpl::Level::warning, category, fmt::format("Cannot fetch image information: {}", e.what()));
-            }
-        }
-
-        entry->set_current_release(current_release);
+        entry->set_current_release(release_title_of(name));
 
-        if (request->request_ipv4() && mp::utils::is_running(present_state))
-        {
-            std::string management_ip = vm->management_ipv4();
-            auto all_ipv4 = vm->get_all_ipv4(*config->ssh_key_provider);
+        if (ipv4)
+            for (const auto& ip : *ipv4)
+                entry->add_ipv4(ip);
+        else if (pending) // not found since it started; the host still knows without asking the instance
+            pending_ipv4.emplace_back(entry, instance_workers.run_task([vm] { return known_ipv4_for(*vm); }));
+    }
 
-            if (is_ipv4_valid(management_ip))
-                entry->add_ipv4(management_ip);
-            else if (all_ipv4.empty())
-                entry->add_ipv4("N/A");
+    if (request->incremental())
+        server->Write(response);
+    auto& last_response = request->incremental() ? pending_response : response;
 
-            for (const auto& extra_ipv4 : all_ipv4)
-                if (extra_ipv4 != management_ip)
-                    entry->add_ipv4(extra_ipv4);
-        }
-    }
+    // All the instances are asked at once, so the slowest one sets the pace; entries stay where they were added
+    for (auto& [entry, ipv4] : pending_ipv4)
+        for (const auto& ip : ipv4.get())
+            entry->add_ipv4(ip);
 
-    for (const auto& instance : deleted_instances)
+    for (const auto& instance : deleted)
     {
         const auto& name = instance.first;
-        auto entry = response.add_instances();
+        auto entry = last_response.add_instances();
         entry->set_name(name);
         entry->mutable_instance_status()->set_status(mp::InstanceStatus::DELETED);
     }
 
-    server->Write(response);
+    if (!federation.empty() && !Federation::is_relayed(server))
+        for (auto& [label, answer] : federation.list(*request))
+            add_member_entries(*last_response.mutable_instances(), label, *answer.reply.mutable_instances());
+
+    config->update_prompt->populate_if_time_to_show(last_response.mutable_update_info());
+    server->Write(last_response);
     status_promise->set_value(grpc::Status::OK);
 }
 catch (const std::exception& e)
@@ -1414,6 +2462,16 @@ try // clang-format on
         entry->set_description(iface.description);
     }
 
+    std::vector<std::string> names;
+    for (const auto& iface : iface_list)
+        names.push_back(iface.id);
+
+    if (names != network_names)
+    {
+        network_names = std::move(names);
+        queue_instances_persistence(); // which rewrites the completions too
+    }
+
     server->Write(response);
     status_promise->set_value(grpc::Status::OK);
 }
@@ -1426,9 +2484,11 @@ void mp::Daemon::mount(const MountRequest* request, grpc::ServerWriterInterface<
                        std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
+    wait_for_instances(instances_in(request->target_paths()));
+
     mpl::ClientLogger<MountReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
 
-    if (!MP_SETTINGS.get_as<bool>(mp::mounts_key))
+    if (!mounts_enabled.get())
     {
         return status_promise->set_value(
             grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
@@ -1475,6 +2535,26 @@ try // clang-format on
         gid_mappings.push_back({map_pair.host_id(), map_pair.instance_id()});
     }
 
+    const auto mount_type = request->mount_type() == MountRequest::NATIVE ? VMMount::MountType::Native
+                                                                          : VMMount::MountType::Classic;
+    try
+    {
+        mount_handler_for(mount_type);
+    }
+    catch (const mp::NotImplementedOnThisBackendException& e)
+    {
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+    }
+
+    try
+    {
+        mp::sshfs_mount_profile(request->profile());
+    }
+    catch (const std::invalid_argument& e)
+    {
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what(), ""));
+    }
+
     fmt::memory_buffer errors;
     for (const auto& path_entry : request->target_paths())
     {
@@ -1493,7 +2573,7 @@ try // clang-format on
             continue;
         }
 
-        if (instance_mounts.has_instance_already_mounted(name, target_path))
+        if (is_mounted(name, target_path))
         {
             fmt::format_to(errors, "\"{}:{}\" is already mounted\n", name, target_path);
             continue;
@@ -1506,7 +2586,9 @@ try // clang-format on
         {
             try
             {
-                instance_mounts.start_mount(vm.get(), request->source_path(), target_path, gid_mappings, uid_mappings);
+                mount_handler_for(mount_type)
+                    .start_mount(vm.get(), request->source_path(), target_path, gid_mappings, uid_mappings,
+                                 request->profile());
             }
             catch (const mp::SSHFSMissingError&)
             {
@@ -1520,11 +2602,11 @@ try // clang-format on
                     mount_reply.set_mount_message("Enabling support for mounting");
                     server->Write(mount_reply);
 
-                    mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                           *config->ssh_key_provider};
-                    mp::utils::install_sshfs_for(name, session);
+                    auto session =
+                        ssh_sessions.acquire(name, vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username);
+                    mp::utils::install_sshfs_for(name, *session);
                     instance_mounts.start_mount(vm.get(), request->source_path(), target_path, gid_mappings,
-                                                uid_mappings);
+                                                uid_mappings, request->profile());
                 }
                 catch (const mp::SSHFSMissingError&)
                 {
@@ -1544,11 +2626,15 @@ try // clang-format on
             continue;
         }
 
-        VMMount mount{request->source_path(), gid_mappings, uid_mappings};
-        vm_specs.mounts[target_path] = mount;
+        VMMount mount{request->source_path(), gid_mappings, uid_mappings, mount_type, request->profile()};
+        {
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+            vm_specs.mounts[target_path] = mount;
+        }
+        instance_events.publish(mounts_event(name, vm_specs, mounts_enabled.get()));
     }
 
-    persist_instances();
+    queue_instances_persistence();
 
     status_promise->set_value(grpc_status_for(errors));
 }
@@ -1562,6 +2648,7 @@ void mp::Daemon::recover(const RecoverRequest* request, grpc::ServerWriterInterf
 try // clang-format on
 {
     mpl::ClientLogger<RecoverReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    wait_for_instances(request->instance_names().instance_name());
 
     const auto [instances, status] =
         find_requested_instances(request->instance_names().instance_name(), deleted_instances,
@@ -1569,27 +2656,267 @@ try // clang-format on
 
     if (status.ok())
     {
-        for (const auto& name : instances)
+        // All of them change under one lock, and only their records are written again, together
+        std::vector<std::string> recovered;
         {
-            auto it = deleted_instances.find(name);
-            if (it != std::end(deleted_instances))
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+            for (const auto& name : instances)
             {
-                assert(vm_instance_specs[name].deleted);
-                vm_instance_specs[name].deleted = false;
-                vm_instances[name] = std::move(it->second);
-                deleted_instances.erase(it);
+                auto it = deleted_instances.find(name);
+                if (it != std::end(deleted_instances))
+                {
+                    assert(vm_instance_specs[name].deleted);
+                    vm_instance_specs[name].deleted = false;
+                    vm_instances[name] = std::move(it->second);
+                    deleted_instances.erase(it);
+                    recovered.push_back(name);
+                }
+                else
+                {
+                    mpl::log(mpl::Level::debug, category,
+                             fmt::format("instance \"{}\" does not need to be recovered", name));
+                }
             }
-            else
+        }
+
+        for (const auto& name : recovered)
+            queue_instances_persistence(name);
+    }
+
+    status_promise->set_value(status);
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+void mp::Daemon::clone(const CloneRequest* request, grpc::ServerWriterInterface<CloneReply>* server,
+                       std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    mpl::ClientLogger<CloneReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    const auto& source_name = request->source_name();
+    wait_for_instances(std::vector<std::string>{source_name});
+
+    if (auto error = check_instance_operational(source_name); !error.empty())
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error, ""));
+
+    const auto source_state = vm_instances.at(source_name)->current_state();
+    if (source_state != VirtualMachine::State::stopped && source_state != VirtualMachine::State::off)
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                         fmt::format("instance \"{}\" must be stopped to be cloned", source_name), ""));
+
+    std::vector<std::string> names{source_name};
+    for (const auto& name : request->destination_names())
+    {
+        if (!mp::utils::valid_hostname(name))
+            return status_promise->set_value(grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT, fmt::format("invalid instance name \"{}\"", name), ""));
+
+        if (std::find(names.cbegin(), names.cend(), name) != names.cend() ||
+            name_in_use(name, vm_instances, deleted_instances, preparing_instances) || warm_pool.contains(name))
+            return status_promise->set_value(grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT, fmt::format("instance \"{}\" already exists", name), ""));
+
+        names.push_back(name);
+    }
+
+    auto guard = instance_locks.claim(names);
+    const auto source_spec = vm_instance_specs.at(source_name);
+
+    std::vector<std::string> errors;
+    for (auto it = std::next(names.cbegin()); it != names.cend(); ++it)
+    {
+        const auto& name = *it;
+        try
+        {
+            // A copy of the source, apart from what has to be its own: what it is called and how it is reached
+            auto spec = source_spec;
+            spec.default_mac_address = allocated_macs.claim_new();
+            for (auto& iface : spec.extra_interfaces)
+                iface.mac_address = allocated_macs.claim_new();
+            spec.state = VirtualMachine::State::off;
+            spec.mounts.clear();
+            spec.metadata = QJsonObject{};
+            {
+                std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                vm_instance_specs[name] = spec; // from now on, release_resources gives the MACs back on failure
+            }
+
+            // A new instance-id makes cloud-init set the copy up as a new instance, with the hostname and network
+            // configuration that go with its name and MACs, without running the source's user data again
+            VirtualMachineDescription vm_desc{spec.num_cores,
+                                              spec.mem_size,
+                                              spec.disk_space,
+                                              name,
+                                              spec.default_mac_address,
+                                              spec.extra_interfaces,
+                                              spec.ssh_username,
+                                              config->vault->clone_instance_image(source_name, name),
+                                              "",
+                                              make_cloud_init_meta_config(name),
+                                              YAML::Node{},
+                                              vendor_config_for(""),
+                                              make_cloud_init_network_config(spec.default_mac_address,
+                                                                             spec.extra_interfaces),
+                                              spec.placement,
+                                              spec.disk_options,
+                                              spec.network_options,
+                                              spec.resource_limits};
+            prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
+            seed_cloud_init(vm_desc);
+            config->factory->configure(vm_desc);
+
+            auto new_vm = config->factory->create_virtual_machine(vm_desc, *this);
+            {
+                std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                vm_instances[name] = std::move(new_vm);
+            }
+
+            CloneReply reply;
+            reply.set_reply_message(fmt::format("Cloned {} to {}", source_name, name));
+            server->Write(reply);
+        }
+        catch (const std::exception& e)
+        {
+            release_resources(name);
             {
-                mpl::log(mpl::Level::debug, category,
-                         fmt::format("instance \"{}\" does not need to be recovered", name));
+                std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                vm_instances.erase(name);
             }
+            errors.push_back(fmt::format("cannot clone {} to {}: {}", source_name, name, e.what()));
         }
+    }
 
-        persist_instances();
+    queue_instances_persistence();
+
+    if (errors.empty())
+        status_promise->set_value(grpc::Status::OK);
+    else
+        status_promise->set_value(
+            grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, fmt::format("{}", fmt::join(errors, "\n")), ""));
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+void mp::Daemon::bake(const BakeRequest* request, grpc::ServerWriterInterface<BakeReply>* server,
+                      std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    auto logger = std::make_shared<mpl::ClientLogger<BakeReply>>(mpl::level_from(request->verbosity_level()),
+                                                                 *config->logger, server);
+    const auto& instance_name = request->instance_name();
+    const auto& image_name = request->image_name();
+    wait_for_instances(std::vector<std::string>{instance_name});
+
+    if (auto error = check_instance_operational(instance_name); !error.empty())
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error, ""));
+
+    if (!mp::utils::valid_hostname(image_name))
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                      fmt::format("invalid image name \"{}\"", image_name), ""));
+
+    // Launches that name no remote would get one image or the other
+    if (image_exists(*config->vault, image_name))
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                         fmt::format("there is already an image called \"{}\"", image_name), ""));
+
+    // Its cloud-init state is cleaned from within, else instances launched from the image would share its machine-id
+    auto vm = vm_instances.at(instance_name);
+    if (vm->current_state() != VirtualMachine::State::running)
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                         fmt::format("instance \"{}\" must be running to be baked", instance_name), ""));
+
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(std::vector<std::string>{instance_name}));
+    delayed_shutdown_instances.erase(instance_name);
+    stop_all_mounts_for_instance(instance_name);
+
+    auto future_watcher = create_future_watcher([guard]() mutable { guard.reset(); });
+    future_watcher->setFuture(async_operations.run([this, vm, image_name, server, logger, status_promise]() mutable {
+        auto status = bake_vm(*vm, image_name, server);
+        logger.reset(); // done with the client
+        return AsyncOperationStatus{status, status_promise};
+    }));
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+void mp::Daemon::snapshot(const SnapshotRequest* request, grpc::ServerWriterInterface<SnapshotReply>* server,
+                          std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    auto logger = std::make_shared<mpl::ClientLogger<SnapshotReply>>(mpl::level_from(request->verbosity_level()),
+                                                                     *config->logger, server);
+    const auto& instance_name = request->instance_name();
+    const auto& snapshot_name = request->snapshot_name();
+    const auto action = request->action();
+    wait_for_instances(std::vector<std::string>{instance_name});
+
+    if (auto error = check_instance_operational(instance_name); !error.empty())
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error, ""));
+
+    std::vector<VMSnapshot> snapshots;
+    {
+        std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+        snapshots = vm_instance_specs[instance_name].snapshots;
     }
 
-    status_promise->set_value(status);
+    if (action == SnapshotRequest::LIST)
+    {
+        SnapshotReply reply;
+        for (const auto& snapshot : snapshots)
+        {
+            auto entry = reply.add_snapshots();
+            entry->set_name(snapshot.name);
+            entry->set_created(snapshot.created);
+        }
+
+        server->Write(reply);
+        return status_promise->set_value(grpc::Status::OK);
+    }
+
+    const auto known = std::any_of(snapshots.cbegin(), snapshots.cend(),
+                                   [&snapshot_name](const auto& snapshot) { return snapshot.name == snapshot_name; });
+    if (action == SnapshotRequest::TAKE)
+    {
+        if (!mp::utils::valid_hostname(snapshot_name))
+            return status_promise->set_value(grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT, fmt::format("invalid snapshot name \"{}\"", snapshot_name), ""));
+
+        if (known)
+            return status_promise->set_value(grpc::Status(
+                grpc::StatusCode::INVALID_ARGUMENT,
+                fmt::format("instance \"{}\" already has a snapshot called \"{}\"", instance_name, snapshot_name),
+                ""));
+    }
+    else if (!known)
+        return status_promise->set_value(grpc::Status(
+            grpc::StatusCode::INVALID_ARGUMENT,
+            fmt::format("instance \"{}\" has no snapshot called \"{}\"", instance_name, snapshot_name), ""));
+
+    // Only a disk that nothing writes to is consistent, and only then can its image be changed under the instance
+    auto vm = vm_instances.at(instance_name);
+    const auto state = vm->current_state();
+    if (state != VirtualMachine::State::stopped && state != VirtualMachine::State::off)
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                         fmt::format("instance \"{}\" must be stopped to work with its snapshots", instance_name), ""));
+
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(std::vector<std::string>{instance_name}));
+    auto future_watcher = create_future_watcher([guard]() mutable { guard.reset(); });
+    future_watcher->setFuture(
+        async_operations.run([this, vm, action, snapshot_name, server, logger, status_promise]() mutable {
+            auto status = snapshot_vm(*vm, action, snapshot_name, server);
+            logger.reset(); // done with the client
+            return AsyncOperationStatus{status, status_promise};
+        }));
 }
 catch (const std::exception& e)
 {
@@ -1601,9 +2928,42 @@ void mp::Daemon::ssh_info(const SSHInfoRequest* request, grpc::ServerWriterInter
 try // clang-format on
 {
     mpl::ClientLogger<SSHInfoReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    wait_for_instances(request->instance_name());
     SSHInfoReply response;
 
-    for (const auto& name : request->instance_name())
+    // No names asks for every running instance, for the client to reach them all in one go
+    std::vector<std::string> names{request->instance_name().begin(), request->instance_name().end()};
+    if (names.empty())
+        for (const auto& [name, vm] : vm_instances)
+            if (mp::utils::is_running(vm->current_state()))
+                names.push_back(name);
+
+    // Instances that were suspended for being idle come back as they are reached for, before answering
+    std::vector<std::string> resuming;
+    for (const auto& name : names)
+        if (auto it = vm_instances.find(name); it != vm_instances.end() &&
+                                               it->second->current_state() == VirtualMachine::State::suspended &&
+                                               !instance_locks.is_claimed(name) && idle_policy.take_suspended(name))
+            resuming.push_back(name);
+
+    if (!resuming.empty())
+    {
+        mpl::log(mpl::Level::info, category, fmt::format("Resuming idle {}", fmt::join(resuming, ", ")));
+
+        auto guard = instance_locks.claim(resuming);
+        for (const auto& name : resuming)
+            vm_instances[name]->start();
+
+        auto future_watcher = create_future_watcher([this, request, server, status_promise] {
+            ssh_info(request, server, status_promise); // the instances that failed to come back answer for themselves
+        });
+        future_watcher->setFuture(async_operations.run([this, resuming] {
+            return async_wait_for_ready_all<StartReply>(nullptr, resuming, mp::default_timeout, nullptr);
+        }));
+        return;
+    }
+
+    for (const auto& name : names)
     {
         auto it = vm_instances.find(name);
         if (it == vm_instances.end())
@@ -1640,10 +3000,24 @@ try // clang-format on
         }
 
         mp::SSHInfo ssh_info;
-        ssh_info.set_host(vm->ssh_hostname());
-        ssh_info.set_port(vm->ssh_port());
+        {
+            std::unique_lock<std::mutex> lock{ssh_infos_mutex};
+            if (auto cached = ssh_infos.find(name); cached != ssh_infos.end())
+                ssh_info = cached->second;
+            else
+            {
+                lock.unlock(); // finding the address may take a while
+                ssh_info.set_host(vm->ssh_hostname());
+                ssh_info.set_port(vm->ssh_port());
+                ssh_info.set_username(vm->ssh_username());
+
+                lock.lock();
+                ssh_infos[name] = ssh_info;
+            }
+        }
+
         ssh_info.set_priv_key_base64(config->ssh_key_provider->private_key_as_base64());
-        ssh_info.set_username(vm->ssh_username());
+        populate_mount_info(*ssh_info.mutable_mount_info(), vm_instance_specs[name], mounts_enabled.get());
         (*response.mutable_ssh_info())[name] = ssh_info;
     }
 
@@ -1659,7 +3033,10 @@ void mp::Daemon::start(const StartRequest* request, grpc::ServerWriterInterface<
                        std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<StartReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    mpl::ClientLogger<StartReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server,
+                                         log_scope_of(request->instance_names().instance_name())};
+    mpt::ContextScope trace_scope{mpt::context_of(server)};
+    wait_for_instances(request->instance_names().instance_name());
 
     auto timeout = request->timeout() > 0 ? std::chrono::seconds(request->timeout()) : mp::default_timeout;
 
@@ -1693,7 +3070,7 @@ try // clang-format on
         return status_promise->set_value(
             grpc::Status(grpc::StatusCode::ABORTED, "instance(s) missing", start_error.SerializeAsString()));
 
-    if (have_mounts && !MP_SETTINGS.get_as<bool>(mp::mounts_key))
+    if (have_mounts && !mounts_enabled.get())
         mpl::log(mpl::Level::error, category, "Mounts have been disabled on this instance of Multipass");
 
     if (request->instance_names().instance_name().empty())
@@ -1706,8 +3083,30 @@ try // clang-format on
         }
     }
 
+    // Unlike launches, starts do not queue: they either fit on the host now, or are refused
+    if (admission.enabled())
+    {
+        auto reserved = reserved_resources();
+        for (const auto& name : vms)
+        {
+            const auto state = vm_instances[name]->current_state(); // counted in already
+            if (state == VirtualMachine::State::starting || state == VirtualMachine::State::restarting)
+                continue;
+
+            const auto demand = demand_of(name);
+            if (!admission.is_turn_of(nullptr) || !admission.fits(demand, reserved))
+                return status_promise->set_value(grpc::Status(
+                    grpc::StatusCode::RESOURCE_EXHAUSTED, fmt::format("no room on the host to start \"{}\"", name)));
+
+            reserved += demand;
+        }
+    }
+
+    // Only held while starting; waiting for the instances to come up does not keep them from being stopped
+    auto guard = instance_locks.claim(vms);
     for (const auto& name : vms)
     {
+        idle_policy.take_suspended(name); // started on request, no longer the policy's to resume
         auto it = vm_instances.find(name);
         auto state = it->second->current_state();
         if (state != VirtualMachine::State::starting && state != VirtualMachine::State::restarting)
@@ -1715,8 +3114,9 @@ try // clang-format on
     }
 
     auto future_watcher = create_future_watcher();
-    future_watcher->setFuture(
-        QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<StartReply>, server, vms, timeout, status_promise));
+    future_watcher->setFuture(async_operations.run([this, server, vms, timeout, status_promise] {
+        return async_wait_for_ready_all<StartReply>(server, vms, timeout, status_promise);
+    }));
 }
 catch (const std::exception& e)
 {
@@ -1727,13 +3127,21 @@ void mp::Daemon::stop(const StopRequest* request, grpc::ServerWriterInterface<St
                       std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<StopReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    wait_for_instances(request->instance_names().instance_name());
+
+    // Shared with the workers, so that the client hears about each instance as it is done
+    auto logger = std::make_shared<mpl::ClientLogger<StopReply>>(
+        mpl::level_from(request->verbosity_level()), *config->logger, server,
+        log_scope_of(request->instance_names().instance_name()));
 
     auto [instances, status] =
         find_requested_instances(request->instance_names().instance_name(), vm_instances,
                                  std::bind(&Daemon::check_instance_operational, this, std::placeholders::_1));
 
-    if (status.ok())
+    if (!status.ok())
+        return status_promise->set_value(status);
+
+    if (request->cancel_shutdown() || request->time_minutes() > 0) // the timers live on the main thread
     {
         std::function<grpc::Status(VirtualMachine&)> operation;
         if (request->cancel_shutdown())
@@ -1742,10 +3150,23 @@ try // clang-format on
             operation = std::bind(&Daemon::shutdown_vm, this, std::placeholders::_1,
                                   std::chrono::minutes(request->time_minutes()));
 
-        status = cmd_vms(instances, operation);
+        return status_promise->set_value(cmd_vms(instances, operation));
     }
 
-    status_promise->set_value(status);
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(instances));
+    for (const auto& name : instances)
+    {
+        delayed_shutdown_instances.erase(name);
+        stop_all_mounts_for_instance(name);
+    }
+
+    auto future_watcher = create_future_watcher([guard]() mutable { guard.reset(); });
+    future_watcher->setFuture(async_operations.run(
+        [this, instances = instances, logger, status_promise]() mutable {
+            auto status = cmd_vms_in_parallel(instances, [this](auto& vm) { return shutdown_vm_now(vm); });
+            logger.reset(); // done with the client
+            return AsyncOperationStatus{status, status_promise};
+        }));
 }
 catch (const std::exception& e)
 {
@@ -1756,7 +3177,11 @@ void mp::Daemon::suspend(const SuspendRequest* request, grpc::ServerWriterInterf
                          std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<SuspendReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    wait_for_instances(request->instance_names().instance_name());
+
+    auto logger = std::make_shared<mpl::ClientLogger<SuspendReply>>(
+        mpl::level_from(request->verbosity_level()), *config->logger, server,
+        log_scope_of(request->instance_names().instance_name()));
 
     fmt::memory_buffer errors;
     std::vector<decltype(vm_instances)::key_type> instances_to_suspend;
@@ -1776,22 +3201,36 @@ try // clang-format on
     }
 
     auto status = grpc_status_for(errors);
-    if (status.ok())
+    if (!status.ok())
+        return status_promise->set_value(status);
+
+    if (instances_to_suspend.empty())
     {
-        if (instances_to_suspend.empty())
+        for (auto& pair : vm_instances)
+            instances_to_suspend.push_back(pair.first);
+    }
+
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(instances_to_suspend));
+    auto future_watcher = create_future_watcher([this, instances_to_suspend, guard]() mutable {
+        for (const auto& name : instances_to_suspend)
         {
-            for (auto& pair : vm_instances)
-                instances_to_suspend.push_back(pair.first);
+            auto it = vm_instances.find(name);
+            if (it != vm_instances.end() && !mp::utils::is_running(it->second->current_state()))
+                stop_all_mounts_for_instance(name);
         }
 
-        status = cmd_vms(instances_to_suspend, [this](auto& vm) {
-            vm.suspend();
-            instance_mounts.stop_all_mounts_for_instance(vm.vm_name);
-            return grpc::Status::OK;
-        });
-    }
-
-    status_promise->set_value(status);
+        guard.reset();
+    });
+    future_watcher->setFuture(async_operations.run(
+        [this, instances_to_suspend, logger, status_promise]() mutable {
+            auto status = cmd_vms_in_parallel(instances_to_suspend, [](auto& vm) {
+                vm.suspend();
+                mpl::log(mpl::Level::info, vm.vm_name, "Suspended");
+                return grpc::Status::OK;
+            });
+            logger.reset(); // done with the client
+            return AsyncOperationStatus{status, status_promise};
+        }));
 }
 catch (const std::exception& e)
 {
@@ -1802,7 +3241,11 @@ void mp::Daemon::restart(const RestartRequest* request, grpc::ServerWriterInterf
                          std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<RestartReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    wait_for_instances(request->instance_names().instance_name());
+
+    auto logger = std::make_shared<mpl::ClientLogger<RestartReply>>(
+        mpl::level_from(request->verbosity_level()), *config->logger, server,
+        log_scope_of(request->instance_names().instance_name()));
 
     auto timeout = request->timeout() > 0 ? std::chrono::seconds(request->timeout()) : mp::default_timeout;
 
@@ -1815,17 +3258,23 @@ try // clang-format on
         return status_promise->set_value(status);
     }
 
-    status = cmd_vms(instances,
-                     std::bind(&Daemon::reboot_vm, this, std::placeholders::_1)); // 1st pass to reboot all targets
-
-    if (!status.ok())
-    {
-        return status_promise->set_value(status);
-    }
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(instances));
+    for (const auto& name : instances)
+        if (vm_instances.at(name)->state == VirtualMachine::State::delayed_shutdown)
+            delayed_shutdown_instances.erase(name);
 
     auto future_watcher = create_future_watcher();
-    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<RestartReply>, server,
-                                                instances, timeout, status_promise));
+    future_watcher->setFuture(async_operations.run(
+        [this, instances = instances, timeout, logger, server, status_promise, guard]() mutable {
+            auto status = cmd_vms_in_parallel(instances, [this](auto& vm) { return reboot_vm(vm); });
+
+            logger.reset(); // what follows writes to the client directly
+            guard.reset(); // like with start, waiting for the instances to come up does not keep them from stopping
+            if (!status.ok())
+                return AsyncOperationStatus{status, status_promise};
+
+            return async_wait_for_ready_all<RestartReply>(server, instances, timeout, status_promise);
+        }));
 }
 catch (const std::exception& e)
 {
@@ -1836,58 +3285,100 @@ void mp::Daemon::delet(const DeleteRequest* request, grpc::ServerWriterInterface
                        std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<DeleteReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
-    DeleteReply response;
+    wait_for_instances(request->instance_names().instance_name());
+
+    auto logger = std::make_shared<mpl::ClientLogger<DeleteReply>>(
+        mpl::level_from(request->verbosity_level()), *config->logger, server,
+        log_scope_of(request->instance_names().instance_name()));
 
     const auto [operational_instances_to_delete, trashed_instances_to_delete, status] =
         find_instances_to_delete(request->instance_names().instance_name(), vm_instances, deleted_instances);
 
-    if (status.ok())
+    if (!status.ok())
+    {
+        server->Write(DeleteReply{});
+        return status_promise->set_value(status);
+    }
+
+    auto instances_to_claim = operational_instances_to_delete;
+    instances_to_claim.insert(instances_to_claim.end(), trashed_instances_to_delete.cbegin(),
+                              trashed_instances_to_delete.cend());
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(instances_to_claim));
+
+    for (const auto& name : operational_instances_to_delete)
     {
-        const bool purge = request->purge();
+        assert(!vm_instance_specs[name].deleted);
+
+        if (vm_instances[name]->current_state() == VirtualMachine::State::delayed_shutdown)
+            delayed_shutdown_instances.erase(name);
+
+        stop_all_mounts_for_instance(name);
+    }
 
-        for (const auto& name : operational_instances_to_delete)
+    // Nothing is deleted unless every instance shut down; the ones that did are left stopped
+    auto shutdown_status = std::make_shared<grpc::Status>();
+    auto future_watcher = create_future_watcher([this, server, purge = request->purge(),
+                                                 operational = operational_instances_to_delete,
+                                                 trashed = trashed_instances_to_delete, shutdown_status,
+                                                 guard]() mutable {
+        DeleteReply response;
+        if (shutdown_status->ok())
         {
-            assert(!vm_instance_specs[name].deleted);
+            mp::top_catch_all(category, [this, &response, purge, &operational, &trashed] {
+                if (purge)
+                {
+                    for (const auto& name : trashed)
+                        assert(vm_instance_specs[name].deleted);
 
-            auto& instance = vm_instances[name];
+                    auto purged = operational;
+                    purged.insert(purged.end(), trashed.cbegin(), trashed.cend());
+                    release_resources(purged);
+                }
 
-            if (instance->current_state() == VirtualMachine::State::delayed_shutdown)
-                delayed_shutdown_instances.erase(name);
+                for (const auto& name : operational)
+                {
+                    if (purge)
+                        response.add_purged_instances(name);
 
-            instance_mounts.stop_all_mounts_for_instance(name);
-            instance->shutdown();
+                    std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                    if (!purge)
+                    {
+                        deleted_instances[name] = std::move(vm_instances[name]);
+                        vm_instance_specs[name].deleted = true;
+                    }
 
-            if (purge)
-            {
-                release_resources(name);
-                response.add_purged_instances(name);
-            }
-            else
-            {
-                deleted_instances[name] = std::move(instance);
-                vm_instance_specs[name].deleted = true;
-            }
+                    vm_instances.erase(name);
+                    instance_events.publish(state_event(name, mp::InstanceStatus::DELETED));
+                }
 
-            vm_instances.erase(name);
-        }
+                if (purge)
+                {
+                    std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                    for (const auto& name : trashed)
+                    {
+                        deleted_instances.erase(name);
+                        response.add_purged_instances(name);
+                    }
+                }
 
-        if (purge)
-        {
-            for (const auto& name : trashed_instances_to_delete)
-            {
-                assert(vm_instance_specs[name].deleted);
-                release_resources(name);
-                deleted_instances.erase(name);
-                response.add_purged_instances(name);
-            }
+                persist_instances();
+            });
         }
 
-        persist_instances();
-    }
+        server->Write(response);
+        guard.reset();
+    });
+    future_watcher->setFuture(async_operations.run(
+        [this, operational = operational_instances_to_delete, logger, status_promise, shutdown_status]() mutable {
+            *shutdown_status = cmd_vms_in_parallel(operational, [](auto& vm) {
+                vm.shutdown();
+                mpl::log(mpl::Level::info, vm.vm_name, "Stopped for deletion");
+                return grpc::Status::OK;
+            });
 
-    server->Write(response);
-    status_promise->set_value(status);
+            logger.reset(); // the reply is written from the main thread, once the instances are gone
+            return AsyncOperationStatus{*shutdown_status, status_promise};
+        }));
 }
 catch (const std::exception& e)
 {
@@ -1898,6 +3389,8 @@ void mp::Daemon::umount(const UmountRequest* request, grpc::ServerWriterInterfac
                         std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
+    wait_for_instances(instances_in(request->target_paths()));
+
     mpl::ClientLogger<UmountReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
 
     fmt::memory_buffer errors;
@@ -1918,28 +3411,34 @@ try // clang-format on
         // Empty target path indicates removing all mounts for the VM instance
         if (target_path.empty())
         {
-            instance_mounts.stop_all_mounts_for_instance(name);
+            stop_all_mounts_for_instance(name);
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
             mounts.clear();
         }
         else
         {
             if (vm->current_state() == mp::VirtualMachine::State::running)
             {
-                if (!instance_mounts.stop_mount(name, target_path))
+                if (!stop_mount(name, target_path))
                 {
                     fmt::format_to(errors, "\"{}\" is not mounted\n", target_path);
                 }
             }
 
-            auto erased = mounts.erase(target_path);
+            auto erased = [this, &mounts, &target_path] {
+                std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                return mounts.erase(target_path);
+            }();
             if (!erased)
             {
                 fmt::format_to(errors, "\"{}\" not found in database\n", target_path);
             }
         }
+
+        instance_events.publish(mounts_event(name, vm_instance_specs[name], mounts_enabled.get()));
     }
 
-    persist_instances();
+    queue_instances_persistence();
 
     status_promise->set_value(grpc_status_for(errors));
 }
@@ -1969,7 +3468,12 @@ try
     GetReply reply;
 
     auto key = request->key();
+    if (auto instance = instance_in_setting(key))
+        wait_for_instances({*instance});
+
+    std::shared_lock<decltype(instances_mutex)> lock{instances_mutex}; // instance settings come from the specs
     auto val = MP_SETTINGS.get(QString::fromStdString(key)).toStdString();
+    lock.unlock();
     mpl::log(mpl::Level::debug, category, fmt::format("Returning setting {}={}", key, val));
 
     reply.set_value(val);
@@ -1993,9 +3497,14 @@ try
 
     auto key = request->key();
     auto val = request->val();
+    if (auto instance = instance_in_setting(key))
+        wait_for_instances({*instance});
 
     mpl::log(mpl::Level::trace, category, fmt::format("Trying to set {}={}", key, val));
-    MP_SETTINGS.set(QString::fromStdString(key), QString::fromStdString(val));
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex}; // instance settings go to the specs
+        MP_SETTINGS.set(QString::fromStdString(key), QString::fromStdString(val));
+    }
     mpl::log(mpl::Level::debug, category, fmt::format("Succeeded setting {}={}", key, val));
 
     status_promise->set_value(grpc::Status::OK);
@@ -2065,6 +3574,236 @@ catch (const std::exception& e)
     status_promise->set_value(grpc::Status(grpc::StatusCode::INTERNAL, e.what(), ""));
 }
 
+void mp::Daemon::watch(const WatchRequest* request, grpc::ServerWriterInterface<WatchReply>* server,
+                       std::function<bool()> cancelled, std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    std::vector<std::string> names{request->instance_names().begin(), request->instance_names().end()};
+
+    // Subscribed before taking the snapshot, so that nothing falls in between
+    auto subscription = instance_events.subscribe(names);
+    wait_for_instances(names);
+
+    std::vector<WatchReply> snapshot;
+    {
+        std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+        const auto watched = [&names](const std::string& name) {
+            return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+        };
+
+        for (const auto& [name, vm] : vm_instances)
+        {
+            if (!watched(name))
+                continue;
+
+            snapshot.push_back(state_event(name, grpc_instance_status_for(vm->current_state())));
+            snapshot.push_back(mounts_event(name, vm_instance_specs[name], mounts_enabled.get()));
+            if (auto ipv4 = instance_addresses.known(name))
+                snapshot.push_back(addresses_event(name, *ipv4));
+        }
+
+        for (const auto& deleted : deleted_instances)
+            if (watched(deleted.first))
+                snapshot.push_back(state_event(deleted.first, mp::InstanceStatus::DELETED));
+    }
+
+    for (const auto& event : snapshot)
+        if (!server->Write(event))
+            return status_promise->set_value(grpc::Status::OK);
+
+    while (!cancelled())
+    {
+        auto events = subscription->next(watch_poll_interval);
+        if (!events)
+            break;
+
+        for (const auto& event : *events)
+            if (!server->Write(event)) // the client went away
+                return status_promise->set_value(grpc::Status::OK);
+    }
+
+    if (subscription->overflowed())
+        return status_promise->set_value(
+            grpc::Status{grpc::StatusCode::ABORTED, "The watch fell too far behind the instances' events"});
+
+    status_promise->set_value(grpc::Status::OK);
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+void mp::Daemon::top(const TopRequest* request, grpc::ServerWriterInterface<TopReply>* server,
+                     std::function<bool()> cancelled, std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    struct Sample
+    {
+        GuestStats stats;
+        std::chrono::steady_clock::time_point taken_at;
+    };
+
+    const std::vector<std::string> names{request->instance_names().begin(), request->instance_names().end()};
+    const auto interval =
+        request->interval_ms() > 0 ? std::chrono::milliseconds{request->interval_ms()} : top_default_interval;
+    wait_for_instances(names);
+
+    // Every update is the difference from the previous samples, so the first samples only set the baseline
+    std::unordered_map<std::string, Sample> previous;
+    for (auto updates = -1; !cancelled();)
+    {
+        std::vector<VirtualMachine::ShPtr> targets;
+        {
+            std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+            for (const auto& [name, vm] : vm_instances)
+                if ((names.empty() || std::find(names.begin(), names.end(), name) != names.end()) &&
+                    mp::utils::is_running(vm->current_state()))
+                    targets.push_back(vm);
+        }
+
+        TopReply reply;
+        std::unordered_map<std::string, Sample> current;
+        for (const auto& vm : targets)
+        {
+            try
+            {
+                Sample sample{vm->guest_stats(top_stats_timeout), std::chrono::steady_clock::now()};
+                if (auto it = previous.find(vm->vm_name); it != previous.end())
+                {
+                    const auto seconds = std::chrono::duration<double>(sample.taken_at - it->second.taken_at).count();
+                    auto usage = reply.add_instances();
+                    usage->set_name(vm->vm_name);
+                    set_usage_between(it->second.stats, sample.stats, seconds, *usage);
+                }
+
+                current.emplace(vm->vm_name, std::move(sample));
+            }
+            catch (const NotImplementedOnThisBackendException&)
+            {
+                throw;
+            }
+            catch (const std::exception& e) // stopped in the meantime, or too busy to answer: left out this time
+            {
+                mpl::log(mpl::Level::debug, vm->vm_name, fmt::format("Cannot sample its usage: {}", e.what()));
+            }
+        }
+
+        previous = std::move(current);
+        if (updates++ >= 0 && !server->Write(reply)) // the client went away
+            break;
+
+        if (request->updates() > 0 && updates >= request->updates())
+            break;
+
+        for (auto deadline = std::chrono::steady_clock::now() + interval;
+             std::chrono::steady_clock::now() < deadline && !cancelled();)
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                deadline - std::chrono::steady_clock::now(), watch_poll_interval));
+    }
+
+    status_promise->set_value(grpc::Status::OK);
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+long long mp::Daemon::running_instance_memory()
+{
+    long long instance_memory = 0;
+    std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+    for (const auto& [name, vm] : vm_instances)
+        if (auto spec_it = vm_instance_specs.find(name);
+            spec_it != vm_instance_specs.end() && mp::utils::is_running(vm->current_state()))
+            instance_memory += spec_it->second.mem_size.in_bytes();
+
+    return instance_memory;
+}
+
+mp::utils::MemoryAccount mp::Daemon::memory_account() const
+{
+    std::size_t specs = 0;
+    for (const auto& [name, spec] : vm_instance_specs)
+        specs += sizeof(VMSpecs) + name.capacity() + mp::utils::estimated_size(spec.metadata);
+
+    std::size_t records = 0;
+    for (const auto& [name, record] : serialized_records)
+        records += name.capacity() + mp::utils::estimated_size(record.json) + record.cbor.capacity();
+
+    std::size_t manifests = 0;
+    for (const auto& image_host : config->image_hosts)
+        manifests += image_host->manifests_memory_estimate();
+
+    return {mp::utils::process_memory(),
+            {{"image_manifests", manifests}, {"instance_specs", specs}, {"instance_records", records}}};
+}
+
+void mp::Daemon::metrics(const MetricsRequest* request, grpc::ServerWriterInterface<MetricsReply>* server,
+                         std::promise<grpc::Status>* status_promise)
+{
+    mpl::ClientLogger<MetricsReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+
+    for (const auto* executor : {&instance_workers, &readiness_waiters, &image_preparers, &async_operations})
+    {
+        const auto load = executor->load();
+        const PerformanceCounters::Labels labels{{"executor", executor->name()}};
+
+        MP_PERF_COUNTERS.set("multipass_executor_running", labels, load.running);
+        MP_PERF_COUNTERS.set("multipass_executor_queued", labels, load.queued);
+    }
+
+    // How densely instances pack the host's memory, and what merging their identical pages gives back
+    const auto instance_memory = running_instance_memory();
+    MP_PERF_COUNTERS.set("multipass_host_instance_memory_bytes", {}, instance_memory);
+    if (const auto host_memory = mp::utils::host_memory_bytes(); host_memory > 0)
+    {
+        MP_PERF_COUNTERS.set("multipass_host_memory_bytes", {}, host_memory);
+        MP_PERF_COUNTERS.set("multipass_host_memory_overcommit_ratio", {},
+                             static_cast<double>(instance_memory) / host_memory);
+    }
+
+    if (const auto merging = mp::utils::memory_merging_stats())
+    {
+        MP_PERF_COUNTERS.set("multipass_host_memory_merging_running", {}, merging->running);
+        MP_PERF_COUNTERS.set("multipass_host_memory_merging_saved_bytes", {}, merging->saved_bytes());
+        MP_PERF_COUNTERS.set("multipass_host_memory_merging_shared_pages", {}, merging->pages_shared);
+        MP_PERF_COUNTERS.set("multipass_host_memory_merging_unshared_pages", {}, merging->pages_unshared);
+    }
+
+    // What the daemon itself holds, and roughly what its larger caches take out of that
+    const auto memory = memory_account();
+    if (memory.process)
+        MP_PERF_COUNTERS.set("multipass_daemon_resident_memory_bytes", {}, memory.process->resident_bytes());
+    for (const auto& [component, bytes] : memory.estimates)
+        MP_PERF_COUNTERS.set("multipass_daemon_memory_estimate_bytes", {{"component", component}}, bytes);
+
+    MetricsReply reply;
+    reply.set_openmetrics(MP_PERF_COUNTERS.openmetrics());
+    server->Write(reply);
+    status_promise->set_value(grpc::Status::OK);
+}
+
+void mp::Daemon::capture_profile(std::chrono::seconds duration)
+{
+    fmt::memory_buffer state;
+    for (const auto* executor : {&instance_workers, &readiness_waiters, &image_preparers, &async_operations})
+    {
+        const auto load = executor->load();
+        fmt::format_to(state, "executor \"{}\": {} running, {} queued, {} threads at most\n", executor->name(),
+                       load.running, load.queued, load.max_threads);
+    }
+
+    fmt::format_to(state, "instances: {} operational, {} deleted, {} pending reconstruction, {} failed, {} preparing\n",
+                   vm_instances.size(), deleted_instances.size(), pending_instances.size(), failed_instances.size(),
+                   preparing_instances.size()); // the main thread is the one to change these
+    fmt::format_to(state, "async operations: {} watched, {} waiting on instances\n",
+                   async_future_watchers.size(), async_running_futures.size());
+    fmt::format_to(state, "memory: {}\n", memory_account().summary());
+    fmt::format_to(state, "\n{}", MP_PERF_COUNTERS.openmetrics());
+
+    profiler.capture(duration, fmt::to_string(state));
+}
+
 void mp::Daemon::on_shutdown()
 {
 }
@@ -2084,120 +3823,542 @@ void mp::Daemon::on_suspend()
 void mp::Daemon::on_restart(const std::string& name)
 {
     auto future_watcher = create_future_watcher();
-    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<StartReply>, nullptr,
-                                                std::vector<std::string>{name}, mp::default_timeout, nullptr));
+    future_watcher->setFuture(async_operations.run([this, name] {
+        return async_wait_for_ready_all<StartReply>(nullptr, {name}, mp::default_timeout, nullptr);
+    }));
+}
+
+void mp::Daemon::persist_state_for(const std::string& name, const VirtualMachine::State& state)
+{
+    bool changed, pooled, ephemeral;
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        auto& spec = vm_instance_specs[name];
+        changed = spec.state != state;
+        pooled = !spec.pool_profile.empty();
+        ephemeral = spec.ephemeral;
+        spec.state = state;
+    }
+
+    if (changed)
+    {
+        ssh_sessions.evict(name); // whatever sessions we had are unlikely to survive the transition
+        forget_ssh_info(name);
+        if (!pooled) // nobody knows of it yet
+            instance_events.publish(state_event(name, grpc_instance_status_for(state)));
+
+        if (ephemeral && (state == VirtualMachine::State::stopped || state == VirtualMachine::State::off))
+            QMetaObject::invokeMethod(this, [this, name] { purge_ephemeral_instance(name); });
+    }
+
+    queue_instances_persistence(name);
+}
+
+void mp::Daemon::update_metadata_for(const std::string& name, const QJsonObject& metadata)
+{
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        vm_instance_specs[name].metadata = metadata;
+    }
+
+    queue_instances_persistence(name);
+}
+
+QJsonObject mp::Daemon::retrieve_metadata_for(const std::string& name)
+{
+    return vm_instance_specs[name].metadata;
+}
+
+QJsonObject to_json(const mp::VMPlacement& placement)
+{
+    auto cpus_to_json = [](const std::vector<int>& cpus) {
+        QJsonArray json;
+        for (auto cpu : cpus)
+            json.append(cpu);
+
+        return json;
+    };
+
+    QJsonObject json;
+    json.insert("hugepages", placement.hugepages);
+    if (placement.numa_node)
+        json.insert("numa_node", *placement.numa_node);
+    json.insert("vcpu_cpus", cpus_to_json(placement.vcpu_cpus));
+    json.insert("io_cpus", cpus_to_json(placement.io_cpus));
+
+    return json;
+}
+
+QJsonObject to_json(const mp::VMDiskOptions& disk_options)
+{
+    QJsonObject json;
+    json.insert("cache", QString::fromStdString(disk_options.cache));
+    json.insert("aio", QString::fromStdString(disk_options.aio));
+    json.insert("iothread", disk_options.iothread);
+    json.insert("queues", disk_options.queues);
+    json.insert("detect_zeroes", disk_options.detect_zeroes);
+
+    return json;
+}
+
+QJsonObject to_json(const mp::VMNetworkOptions& network_options)
+{
+    QJsonObject json;
+    json.insert("vhost", network_options.vhost);
+    json.insert("queues", network_options.queues);
+    json.insert("ring_size", network_options.ring_size);
+
+    return json;
+}
+
+QJsonObject to_json(const mp::VMResourceLimits& limits)
+{
+    QJsonObject json;
+    json.insert("cpu_weight", limits.cpu_weight);
+    json.insert("io_weight", limits.io_weight);
+    json.insert("memory_high", QString::number(limits.memory_high));
+    json.insert("cpu_max", limits.cpu_max);
+
+    return json;
+}
+
+QJsonArray to_json_array(const std::vector<mp::VMSnapshot>& snapshots)
+{
+    QJsonArray json;
+
+    for (const auto& snapshot : snapshots)
+    {
+        QJsonObject entry;
+        entry.insert("name", QString::fromStdString(snapshot.name));
+        entry.insert("created", QString::fromStdString(snapshot.created));
+        json.append(entry);
+    }
+
+    return json;
+}
+
+QJsonArray to_json_array(const std::vector<mp::NetworkInterface>& extra_interfaces)
+{
+    QJsonArray json;
+
+    for (const auto& interface : extra_interfaces)
+    {
+        QJsonObject entry;
+        entry.insert("id", QString::fromStdString(interface.id));
+        entry.insert("mac_address", QString::fromStdString(interface.mac_address));
+        entry.insert("auto_mode", interface.auto_mode);
+        json.append(entry);
+    }
+
+    return json;
+}
+
+namespace
+{
+QJsonObject vm_spec_to_json(const mp::VMSpecs& specs)
+{
+    QJsonObject json;
+    json.insert("num_cores", specs.num_cores);
+    json.insert("mem_size", QString::number(specs.mem_size.in_bytes()));
+    json.insert("disk_space", QString::number(specs.disk_space.in_bytes()));
+    json.insert("ssh_username", QString::fromStdString(specs.ssh_username));
+    json.insert("state", static_cast<int>(specs.state));
+    json.insert("deleted", specs.deleted);
+    json.insert("metadata", specs.metadata);
+    if (!specs.pool_profile.empty())
+        json.insert("pool_profile", QString::fromStdString(specs.pool_profile));
+    if (specs.ephemeral)
+        json.insert("ephemeral", true);
+    if (specs.placement != mp::VMPlacement{})
+        json.insert("placement", to_json(specs.placement));
+    if (specs.disk_options != mp::VMDiskOptions{})
+        json.insert("disk_options", to_json(specs.disk_options));
+    if (specs.network_options != mp::VMNetworkOptions{})
+        json.insert("network_options", to_json(specs.network_options));
+    if (specs.resource_limits != mp::VMResourceLimits{})
+        json.insert("resource_limits", to_json(specs.resource_limits));
+    if (!specs.snapshots.empty())
+        json.insert("snapshots", to_json_array(specs.snapshots));
+
+    // Write the networking information. Write first a field "mac_addr" containing the MAC address of the
+    // default network interface. Then, write all the information about the rest of the interfaces.
+    json.insert("mac_addr", QString::fromStdString(specs.default_mac_address));
+    json.insert("extra_interfaces", to_json_array(specs.extra_interfaces));
+
+    QJsonArray mounts;
+    for (const auto& mount : specs.mounts)
+    {
+        QJsonObject entry;
+        entry.insert("source_path", QString::fromStdString(mount.second.source_path));
+        entry.insert("target_path", QString::fromStdString(mount.first));
+
+        QJsonArray uid_mappings;
+        for (const auto& map : mount.second.uid_mappings)
+        {
+            QJsonObject map_entry;
+            map_entry.insert("host_uid", map.first);
+            map_entry.insert("instance_uid", map.second);
+
+            uid_mappings.append(map_entry);
+        }
+
+        entry.insert("uid_mappings", uid_mappings);
+
+        QJsonArray gid_mappings;
+        for (const auto& map : mount.second.gid_mappings)
+        {
+            QJsonObject map_entry;
+            map_entry.insert("host_gid", map.first);
+            map_entry.insert("instance_gid", map.second);
+
+            gid_mappings.append(map_entry);
+        }
+
+        entry.insert("gid_mappings", gid_mappings);
+        entry.insert("mount_type", static_cast<int>(mount.second.mount_type));
+        entry.insert("profile", QString::fromStdString(mount.second.profile));
+        mounts.append(entry);
+    }
+
+    json.insert("mounts", mounts);
+    return json;
+}
+
+void write_instance_records(const QByteArray& raw_records, const QString& file_name)
+{
+    // QSaveFile writes to a temporary file and renames it over the target on commit, so a crash mid-write never
+    // leaves a truncated database behind
+    QSaveFile db_file{file_name};
+    if (!MP_FILEOPS.open(db_file, QIODevice::WriteOnly) ||
+        MP_FILEOPS.write(db_file, raw_records) != raw_records.size() || !MP_FILEOPS.commit(db_file))
+        throw std::runtime_error(
+            fmt::format("Could not write instance records to {}: {}", file_name, db_file.errorString()));
+}
+
+void write_completions(const QByteArray& completions, const QString& file_name)
+{
+    write_instance_records(completions, file_name);
+    QFile::setPermissions(file_name, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadGroup |
+                                         QFileDevice::ReadOther);
+}
+} // namespace
+
+void mp::Daemon::persist_instances()
+{
+    instances_persistence_timer.stop();
+
+    mark_instances_dirty();
+    write_instances(serialize_dirty_instances());
+    instances_writer.waitForFinished();
+}
+
+void mp::Daemon::refresh_metrics()
+{
+    if (metrics_refresh.isRunning())
+    {
+        mpl::log(mpl::Level::debug, category, "Metrics refresh still running. Skipping…");
+        return;
+    }
+
+    struct Target
+    {
+        VirtualMachine::ShPtr vm;
+        std::string ssh_username;
+        MemorySize mem_size;
+    };
+    std::vector<Target> targets;
+    for (const auto& [name, vm] : vm_instances)
+    {
+        auto spec_it = vm_instance_specs.find(name);
+        if (spec_it != vm_instance_specs.end() && mp::utils::is_running(vm->current_state()))
+            targets.push_back({vm, spec_it->second.ssh_username, spec_it->second.mem_size});
+        else
+        {
+            instance_metrics.forget(name);
+            idle_policy.forget(name);
+        }
+    }
+
+    for (const auto& trashed : deleted_instances)
+        instance_metrics.forget(trashed.first);
+
+    metrics_refresh = async_operations.run([this, targets] {
+        std::vector<std::future<void>> collections;
+        for (const auto& target : targets)
+            collections.push_back(instance_workers.run_task([this, target] {
+                const auto& name = target.vm->vm_name;
+                try
+                {
+                    auto metrics = instance_metrics.collect(*target.vm, target.ssh_username, idle_policy.enabled());
+
+                    auto balloon_target = balloon_target_for(metrics, target.mem_size);
+                    if (reclaim_idle_memory && balloon_target)
+                        reclaim_memory_of(*target.vm, *balloon_target);
+
+                    if (idle_policy.enabled() && idle_policy.observe(name, metrics))
+                        QMetaObject::invokeMethod(this, [this, name] { suspend_idle_instance(name); });
+                }
+                catch (const std::exception& e)
+                {
+                    instance_metrics.forget(name); // let info tell for itself
+                    mpl::log(mpl::Level::debug, category,
+                             fmt::format("Cannot collect metrics of \"{}\": {}", name, e.what()));
+                }
+            }));
+
+        for (auto& collection : collections)
+            collection.wait();
+    });
+}
+
+void mp::Daemon::suspend_idle_instance(const std::string& name)
+{
+    static DiscardingServerWriter<SuspendReply> discarding_writer;
+
+    // Things may have moved on since the metrics were in
+    auto it = vm_instances.find(name);
+    if (it == vm_instances.end() || it->second->current_state() != VirtualMachine::State::running ||
+        instance_locks.is_claimed(name))
+        return;
+
+    mpl::log(mpl::Level::info, category, fmt::format("Suspending \"{}\", which has been idle", name));
+
+    SuspendRequest request;
+    request.mutable_instance_names()->add_instance_name(name);
+
+    idle_policy.mark_suspended(name);
+    auto& outcome = idle_suspensions[name] = std::promise<grpc::Status>{};
+    suspend(&request, &discarding_writer, &outcome);
 }
 
-void mp::Daemon::persist_state_for(const std::string& name, const VirtualMachine::State& state)
-{
-    vm_instance_specs[name].state = state;
-    persist_instances();
+void mp::Daemon::refresh_addresses()
+{
+    if (addresses_refresh.isRunning())
+        return;
+
+    std::vector<VirtualMachine::ShPtr> targets;
+    for (const auto& [name, vm] : vm_instances)
+    {
+        if (mp::utils::is_running(vm->current_state()))
+            targets.push_back(vm);
+        else
+        {
+            instance_addresses.forget(name);
+            forget_ssh_info(name);
+        }
+    }
+
+    for (const auto& trashed : deleted_instances)
+        instance_addresses.forget(trashed.first);
+
+    addresses_refresh = async_operations.run([this, targets] {
+        std::vector<std::future<void>> discoveries;
+        for (const auto& vm : targets)
+            discoveries.push_back(instance_workers.run_task([this, vm] {
+                try
+                {
+                    auto ipv4 = known_ipv4_for(*vm);
+                    if (instance_addresses.update(vm->vm_name, ipv4))
+                    {
+                        forget_ssh_info(vm->vm_name);
+                        instance_events.publish(addresses_event(vm->vm_name, ipv4));
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    mpl::log(mpl::Level::debug, category,
+                             fmt::format("Cannot find the addresses of \"{}\": {}", vm->vm_name, e.what()));
+                }
+            }));
+
+        for (auto& discovery : discoveries)
+            discovery.wait();
+    });
 }
 
-void mp::Daemon::update_metadata_for(const std::string& name, const QJsonObject& metadata)
+void mp::Daemon::queue_instances_persistence(const std::string& name)
 {
-    vm_instance_specs[name].metadata = metadata;
+    mark_instances_dirty(name);
 
-    persist_instances();
+    // State changes may be reported from worker threads, but the timer belongs to the daemon's thread
+    QMetaObject::invokeMethod(this, [this] {
+        if (!instances_persistence_timer.isActive())
+            instances_persistence_timer.start();
+    });
 }
 
-QJsonObject mp::Daemon::retrieve_metadata_for(const std::string& name)
+void mp::Daemon::mark_instances_dirty(const std::string& name)
 {
-    return vm_instance_specs[name].metadata;
+    std::lock_guard<std::mutex> lock{dirty_instances_mutex};
+
+    if (name.empty())
+        all_instances_dirty = true;
+    else
+        dirty_instances.insert(name);
 }
 
-QJsonArray to_json_array(const std::vector<mp::NetworkInterface>& extra_interfaces)
+auto mp::Daemon::serialize_dirty_instances() -> SerializedInstances
 {
-    QJsonArray json;
+    std::unordered_set<std::string> dirty;
+    bool all_dirty;
+    {
+        std::lock_guard<std::mutex> lock{dirty_instances_mutex};
+        dirty.swap(dirty_instances);
+        all_dirty = std::exchange(all_instances_dirty, false);
+    }
 
-    for (const auto& interface : extra_interfaces)
+    for (auto it = serialized_records.begin(); it != serialized_records.end();)
     {
-        QJsonObject entry;
-        entry.insert("id", QString::fromStdString(interface.id));
-        entry.insert("mac_address", QString::fromStdString(interface.mac_address));
-        entry.insert("auto_mode", interface.auto_mode);
-        json.append(entry);
+        if (all_dirty || vm_instance_specs.find(it->first) == vm_instance_specs.end())
+            it = serialized_records.erase(it);
+        else
+            ++it;
     }
 
-    return json;
+    QJsonObject instance_records;
+    QCborMap snapshot;
+    std::string completions;
+    for (const auto& record : vm_instance_specs)
+    {
+        if (record.second.pool_profile.empty()) // pooled instances are not the user's yet
+        {
+            const auto status =
+                record.second.deleted ? InstanceStatus::DELETED : grpc_instance_status_for(record.second.state);
+            completions += fmt::format("instance,{},{}\n", record.first, InstanceStatus::Status_Name(status));
+        }
+
+        auto cached = serialized_records.find(record.first);
+        if (cached == serialized_records.end() || dirty.count(record.first))
+        {
+            auto json = vm_spec_to_json(record.second);
+            auto cbor = QCborValue::fromJsonValue(json).toCbor();
+            cached = serialized_records.insert_or_assign(record.first, SerializedRecord{json, cbor}).first;
+        }
+
+        const auto key = QString::fromStdString(record.first);
+        instance_records.insert(key, cached->second.json);
+        snapshot.insert(key, cached->second.cbor);
+    }
+
+    for (const auto& network : network_names)
+        completions += fmt::format("network,{}\n", network);
+
+    return {QJsonDocument{instance_records}.toJson(), snapshot.toCborValue().toCbor(),
+            QByteArray::fromStdString(completions)};
 }
 
-void mp::Daemon::persist_instances()
+void mp::Daemon::write_instances(SerializedInstances serialized)
 {
-    auto vm_spec_to_json = [](const mp::VMSpecs& specs) -> QJsonObject {
-        QJsonObject json;
-        json.insert("num_cores", specs.num_cores);
-        json.insert("mem_size", QString::number(specs.mem_size.in_bytes()));
-        json.insert("disk_space", QString::number(specs.disk_space.in_bytes()));
-        json.insert("ssh_username", QString::fromStdString(specs.ssh_username));
-        json.insert("state", static_cast<int>(specs.state));
-        json.insert("deleted", specs.deleted);
-        json.insert("metadata", specs.metadata);
-
-        // Write the networking information. Write first a field "mac_addr" containing the MAC address of the
-        // default network interface. Then, write all the information about the rest of the interfaces.
-        json.insert("mac_addr", QString::fromStdString(specs.default_mac_address));
-        json.insert("extra_interfaces", to_json_array(specs.extra_interfaces));
-
-        QJsonArray mounts;
-        for (const auto& mount : specs.mounts)
-        {
-            QJsonObject entry;
-            entry.insert("source_path", QString::fromStdString(mount.second.source_path));
-            entry.insert("target_path", QString::fromStdString(mount.first));
-
-            QJsonArray uid_mappings;
-            for (const auto& map : mount.second.uid_mappings)
-            {
-                QJsonObject map_entry;
-                map_entry.insert("host_uid", map.first);
-                map_entry.insert("instance_uid", map.second);
+    std::lock_guard<std::mutex> lock{instances_writer_mutex};
+    pending_instances = std::move(serialized);
 
-                uid_mappings.append(map_entry);
-            }
+    if (instances_writer_running)
+        return; // the running writer picks up the latest snapshot before it finishes
 
-            entry.insert("uid_mappings", uid_mappings);
+    instances_writer_running = true;
+    QDir data_dir{
+        mp::utils::backend_directory_path(config->data_directory, config->factory->get_backend_directory_name())};
 
-            QJsonArray gid_mappings;
-            for (const auto& map : mount.second.gid_mappings)
+    instances_writer = QtConcurrent::run([this, json_file_name = data_dir.filePath(instance_db_name),
+                                          snapshot_file_name = data_dir.filePath(instance_snapshot_name),
+                                          completions_file_name = completions_file_for(config->server_address)] {
+        for (;;)
+        {
+            SerializedInstances serialized;
             {
-                QJsonObject map_entry;
-                map_entry.insert("host_gid", map.first);
-                map_entry.insert("instance_gid", map.second);
+                std::lock_guard<std::mutex> lock{instances_writer_mutex};
+                if (!pending_instances)
+                {
+                    instances_writer_running = false;
+                    return;
+                }
 
-                gid_mappings.append(map_entry);
+                serialized = std::move(*pending_instances);
+                pending_instances.reset();
             }
 
-            entry.insert("gid_mappings", gid_mappings);
-            mounts.append(entry);
+            try
+            {
+                // The snapshot goes last, so that it is never older than the JSON it was written with
+                write_instance_records(serialized.json, json_file_name);
+                write_instance_records(serialized.snapshot, snapshot_file_name);
+                if (!completions_file_name.isEmpty())
+                    write_completions(serialized.completions, completions_file_name);
+            }
+            catch (const std::exception& e)
+            {
+                mpl::log(mpl::Level::error, category, e.what());
+            }
         }
+    });
+}
 
-        json.insert("mounts", mounts);
-        return json;
-    };
-    QJsonObject instance_records_json;
-    for (const auto& record : vm_instance_specs)
+void mp::Daemon::forget_ssh_info(const std::string& instance)
+{
+    std::lock_guard<std::mutex> lock{ssh_infos_mutex};
+    ssh_infos.erase(instance);
+}
+
+void mp::Daemon::purge_ephemeral_instance(const std::string& name)
+{
+    // Whatever stopped it may still hold it, and then it comes back to this once that is done
+    if (instance_locks.is_claimed(name))
+        return QTimer::singleShot(ephemeral_purge_retry, this, [this, name] { purge_ephemeral_instance(name); });
+
+    auto it = vm_instances.find(name);
+    if (it == vm_instances.end())
+        return;
+
+    const auto state = it->second->current_state();
+    if (state != VirtualMachine::State::stopped && state != VirtualMachine::State::off)
+        return; // started again in the meantime
+
+    mpl::log(mpl::Level::info, category, fmt::format("Purging ephemeral instance {}", name));
+    delayed_shutdown_instances.erase(name);
+    stop_all_mounts_for_instance(name);
+    release_resources(name);
     {
-        auto key = QString::fromStdString(record.first);
-        instance_records_json.insert(key, vm_spec_to_json(record.second));
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        vm_instances.erase(name);
     }
-    QDir data_dir{
-        mp::utils::backend_directory_path(config->data_directory, config->factory->get_backend_directory_name())};
-    mp::write_json(instance_records_json, data_dir.filePath(instance_db_name));
+    instance_events.publish(state_event(name, mp::InstanceStatus::DELETED));
 }
 
 void mp::Daemon::release_resources(const std::string& instance)
 {
-    config->factory->remove_resources_for(instance);
-    config->vault->remove(instance);
+    release_resources(std::vector<std::string>{instance});
+}
+
+void mp::Daemon::release_resources(const std::vector<std::string>& instances)
+{
+    for (const auto& instance : instances)
+    {
+        {
+            std::lock_guard<std::mutex> lock{release_titles_mutex};
+            release_titles.erase(instance);
+        }
+        instance_metrics.forget(instance);
+        instance_addresses.forget(instance);
+        if (cloud_init_datasource)
+            cloud_init_datasource->withdraw(instance);
+        forget_ssh_info(instance);
+        ssh_sessions.evict(instance);
+        config->factory->remove_resources_for(instance);
+    }
+
+    // Their directories go in the background, and their records in a single write
+    config->vault->remove_all(instances);
 
-    auto spec_it = vm_instance_specs.find(instance);
-    if (spec_it != cend(vm_instance_specs))
+    for (const auto& instance : instances)
     {
-        for (const auto& mac : mac_set_from(spec_it->second))
-            allocated_mac_addrs.erase(mac);
+        auto spec_it = vm_instance_specs.find(instance);
+        if (spec_it != cend(vm_instance_specs))
+        {
+            allocated_macs.release(macs_of(spec_it->second));
 
-        vm_instance_specs.erase(spec_it);
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+            vm_instance_specs.erase(spec_it);
+        }
     }
 }
 
@@ -2224,7 +4385,7 @@ std::string mp::Daemon::check_instance_exists(const std::string& instance_name)
 }
 
 void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriterInterface<CreateReply>* server,
-                           std::promise<grpc::Status>* status_promise, bool start)
+                           std::promise<grpc::Status>* status_promise, bool start, const std::string& pool_profile)
 {
     auto checked_args = validate_create_arguments(request, config.get());
 
@@ -2248,29 +4409,43 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriterInter
             grpc::Status{grpc::StatusCode::FAILED_PRECONDITION, "Missing bridges", create_error.SerializeAsString()});
     }
 
-    // TODO: We should only need to query the Blueprint Provider once for all info, so this (and timeout below) will
-    //       need a refactoring to do so.
-    auto name = name_from(checked_args.instance_name, config->blueprint_provider->name_from_blueprint(request->image()),
-                          *config->name_generator, vm_instances);
-
-    if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end())
+    std::vector<std::string> names;
+    if (is_batch(*request))
     {
-        CreateError create_error;
-        create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
-
-        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                                                      fmt::format("instance \"{}\" already exists", name),
-                                                      create_error.SerializeAsString()));
+        names = batch_names_from(*request, *config->name_generator, vm_instances, deleted_instances,
+                                 preparing_instances);
+    }
+    else
+    {
+        // TODO: We should only need to query the Blueprint Provider once for all info, so this (and timeout below)
+        //       will need a refactoring to do so.
+        names.push_back(name_from(checked_args.instance_name,
+                                  config->blueprint_provider->name_from_blueprint(request->image()),
+                                  *config->name_generator, vm_instances, deleted_instances, preparing_instances));
     }
 
-    if (preparing_instances.find(name) != preparing_instances.end())
+    for (const auto& name : names)
     {
-        CreateError create_error;
-        create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
+        if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end() ||
+            (pool_profile.empty() && warm_pool.contains(name)))
+        {
+            CreateError create_error;
+            create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
 
-        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                                                      fmt::format("instance \"{}\" is being prepared", name),
-                                                      create_error.SerializeAsString()));
+            return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                          fmt::format("instance \"{}\" already exists", name),
+                                                          create_error.SerializeAsString()));
+        }
+
+        if (preparing_instances.find(name) != preparing_instances.end())
+        {
+            CreateError create_error;
+            create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
+
+            return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                          fmt::format("instance \"{}\" is being prepared", name),
+                                                          create_error.SerializeAsString()));
+        }
     }
 
     if (!instances_running(vm_instances))
@@ -2278,82 +4453,146 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriterInter
 
     // TODO: We should only need to query the Blueprint Provider once for all info, so this (and name above) will
     //       need a refactoring to do so.
-    auto timeout = timeout_for(request->timeout(), config->blueprint_provider->blueprint_timeout(name));
+    auto timeout = timeout_for(request->timeout(), config->blueprint_provider->blueprint_timeout(names.front()));
+    auto max_parallel_boots =
+        request->max_parallel_boots() > 0 ? static_cast<std::size_t>(request->max_parallel_boots()) : names.size();
 
-    preparing_instances.insert(name);
+    preparing_instances.insert(names.begin(), names.end());
 
-    auto prepare_future_watcher = new QFutureWatcher<VirtualMachineDescription>();
+    auto prepare_future_watcher = new QFutureWatcher<std::vector<PreparedInstance>>();
     auto log_level = mpl::level_from(request->verbosity_level());
 
     QObject::connect(
-        prepare_future_watcher, &QFutureWatcher<VirtualMachineDescription>::finished,
-        [this, server, status_promise, name, timeout, start, prepare_future_watcher, log_level] {
-            mpl::ClientLogger<CreateReply> logger{log_level, *config->logger, server};
+        prepare_future_watcher, &QFutureWatcher<std::vector<PreparedInstance>>::finished,
+        [this, server, status_promise, timeout, max_parallel_boots, start, pool_profile, prepare_future_watcher,
+         log_level, names, ephemeral = request->ephemeral()] {
+            mpl::ClientLogger<CreateReply> logger{log_level, *config->logger, server, log_scope_of(names)};
+
+            auto errors = std::make_shared<std::vector<std::string>>();
+            std::vector<std::string> created;
+            auto prepared_instances = prepare_future_watcher->future().result();
+
+            std::vector<VirtualMachineDescription> descriptions;
+            for (const auto& prepared : prepared_instances)
+                if (prepared.description)
+                    descriptions.push_back(*prepared.description);
 
             try
             {
-                auto vm_desc = prepare_future_watcher->future().result();
-
-                vm_instance_specs[name] = {vm_desc.num_cores,
-                                           vm_desc.mem_size,
-                                           vm_desc.disk_space,
-                                           vm_desc.default_mac_address,
-                                           vm_desc.extra_interfaces,
-                                           config->ssh_username,
-                                           VirtualMachine::State::off,
-                                           {},
-                                           false,
-                                           QJsonObject()};
-                vm_instances[name] = config->factory->create_virtual_machine(vm_desc, *this);
-                preparing_instances.erase(name);
+                config->factory->start_creating_instances(descriptions);
+            }
+            catch (const std::exception& e)
+            {
+                mpl::log(mpl::Level::warning, category, fmt::format("Cannot start creating instances: {}", e.what()));
+            }
 
-                persist_instances();
+            for (auto& prepared : prepared_instances)
+            {
+                const auto& name = prepared.name;
+                preparing_instances.erase(name);
 
-                if (start)
+                try
                 {
-                    LaunchReply reply;
-                    reply.set_create_message("Starting " + name);
-                    server->Write(reply);
-
-                    auto& vm = vm_instances[name];
-                    vm->start();
-
-                    auto future_watcher = create_future_watcher([this, server, name] {
-                        LaunchReply reply;
-                        reply.set_vm_instance_name(name);
-                        config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
-                        server->Write(reply);
-                    });
-                    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<LaunchReply>,
-                                                                server, std::vector<std::string>{name}, timeout,
-                                                                status_promise));
+                    if (!prepared.description)
+                        throw std::runtime_error(prepared.error);
+
+                    const auto& vm_desc = *prepared.description;
+                    {
+                        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                        vm_instance_specs[name] = {vm_desc.num_cores,
+                                                   vm_desc.mem_size,
+                                                   vm_desc.disk_space,
+                                                   vm_desc.default_mac_address,
+                                                   vm_desc.extra_interfaces,
+                                                   config->ssh_username,
+                                                   VirtualMachine::State::off,
+                                                   {},
+                                                   false,
+                                                   QJsonObject(),
+                                                   pool_profile};
+                        vm_instance_specs[name].disk_options = vm_desc.disk_options;
+                        vm_instance_specs[name].ephemeral = ephemeral;
+                    }
+
+                    // Not under the lock: the new instance may report its state right away
+                    auto new_vm = [this, &vm_desc, &name] {
+                        LaunchTimings::Phase phase{launch_timings, name, "create"};
+                        return config->factory->create_virtual_machine(vm_desc, *this);
+                    }();
+                    if (!pool_profile.empty())
+                        warm_pool.set_instance(name, std::move(new_vm)); // kept out of the instances until claimed
+                    else
+                    {
+                        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                        vm_instances[name] = std::move(new_vm);
+                    }
+                    created.push_back(name);
+
+                    if (!vm_desc.image.original_release.empty())
+                    {
+                        std::lock_guard<std::mutex> lock{release_titles_mutex};
+                        release_titles[name] = vm_desc.image.original_release;
+                    }
                 }
-                else
+                catch (const std::exception& e)
                 {
-                    status_promise->set_value(grpc::Status::OK);
+                    release_resources(name);
+                    {
+                        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                        vm_instances.erase(name);
+                    }
+                    errors->push_back(e.what());
                 }
+
+                if (!start || !prepared.description)
+                    launch_timings.take(name); // nothing to report them to
             }
-            catch (const std::exception& e)
+
+            queue_instances_persistence();
+
+            if (start && !created.empty())
+                boot_in_waves(std::move(created), max_parallel_boots, timeout, std::move(errors), server,
+                              status_promise);
+            else if (errors->empty())
+                status_promise->set_value(grpc::Status::OK);
+            else
+                status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                                                       fmt::format("{}", fmt::join(*errors, "\n")), ""));
+
+            // Only now, since the pool entry holds the status promise
+            if (!pool_profile.empty())
             {
-                preparing_instances.erase(name);
-                release_resources(name);
-                vm_instances.erase(name);
-                persist_instances();
-                status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+                for (const auto& error : *errors)
+                    mpl::log(mpl::Level::warning, category, fmt::format("Cannot add to the warm pool: {}", error));
+
+                for (const auto& prepared : prepare_future_watcher->future().result())
+                {
+                    if (std::find(created.begin(), created.end(), prepared.name) == created.end())
+                        warm_pool.remove(prepared.name);
+                    else
+                        warm_up(prepared.name, timeout);
+                }
             }
 
             delete prepare_future_watcher;
         });
 
-    auto make_vm_description = [this, server, request, name, checked_args,
-                                log_level]() mutable -> VirtualMachineDescription {
-        mpl::ClientLogger<CreateReply> logger{log_level, *config->logger, server};
+    // Instances of the same launch prepare their own descriptions side by side, so they share a lock for the reply
+    // stream (MAC addresses are claimed atomically by allocated_macs)
+    auto write_mutex = std::make_shared<std::mutex>();
+    auto write = [server, write_mutex](const CreateReply& reply) {
+        std::lock_guard<std::mutex> lock{*write_mutex};
+        return server->Write(reply);
+    };
 
+    auto user_data = std::make_shared<LaunchUserData>();
+    auto make_vm_description = [this, write, request, checked_args,
+                                user_data](const std::string& name) -> VirtualMachineDescription {
         try
         {
             CreateReply reply;
             reply.set_create_message("Creating " + name);
-            server->Write(reply);
+            write(reply);
 
             Query query;
             VirtualMachineDescription vm_desc{
@@ -2368,10 +4607,13 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriterInter
                 "",
                 YAML::Node{},
                 YAML::Node{},
-                make_cloud_init_vendor_config(*config->ssh_key_provider, request->time_zone(), config->ssh_username,
-                                              config->factory->get_backend_version_string().toStdString()),
+                vendor_config_for(request->time_zone()),
                 YAML::Node{}};
 
+            // Throwaway instances give up on their disk's durability, for the host never to wait on flushing it
+            if (request->ephemeral())
+                vm_desc.disk_options.cache = "unsafe";
+
             try
             {
                 query = config->blueprint_provider->fetch_blueprint_for(request->image(), vm_desc);
@@ -2383,118 +4625,462 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriterInter
                 query = query_from(request, name);
                 vm_desc.mem_size = checked_args.mem_size;
             }
-
-            auto progress_monitor = [server](int progress_type, int percentage) {
-                CreateReply create_reply;
-                create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
-                create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
-                return server->Write(create_reply);
+            query.storage_location = checked_args.storage_location;
+
+            // Should anything else fail first, the fetch is abandoned, and still waited for, as it uses what is here
+            auto abandoned = std::make_shared<std::atomic_bool>(false);
+            auto report_progress = mp::coalesced(
+                [write](int progress_type, int percentage) {
+                    CreateReply create_reply;
+                    create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
+                    create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
+                    return write(create_reply);
+                },
+                progress_interval);
+            auto progress_monitor = [abandoned, report_progress](int progress_type, int percentage) {
+                return !*abandoned && report_progress(progress_type, percentage);
             };
 
-            auto prepare_action = [this, server, &name](const VMImage& source_image) -> VMImage {
+            auto prepare_action = [this, write, &name, progress_monitor](const VMImage& source_image) -> VMImage {
                 CreateReply reply;
                 reply.set_create_message("Preparing image for " + name);
-                server->Write(reply);
+                write(reply);
 
-                return config->factory->prepare_source_image(source_image);
+                LaunchTimings::Phase phase{launch_timings, name, "image_prepare"};
+                return config->factory->prepare_source_image(source_image, progress_monitor);
             };
 
+            // Only images from remotes have a kernel to go with them, that a fast boot can load directly
             auto fetch_type = config->factory->fetch_type();
+            if (request->fast_boot() && query.query_type == mp::Query::Type::Alias)
+                fetch_type = mp::FetchType::ImageKernelAndInitrd;
+
+            // The image is fetched and prepared on its own, while the network and cloud-init of the instance are set up
+            auto image_fetch =
+                image_preparers.run_task([this, name, fetch_type, query, prepare_action, progress_monitor] {
+                    LaunchTimings::Phase phase{launch_timings, name, "image_fetch"}; // including any preparation
+                    return config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
+                });
+            auto abandon_image_fetch = sg::make_scope_guard([&image_fetch, abandoned]() noexcept {
+                if (image_fetch.valid())
+                {
+                    *abandoned = true;
+                    image_fetch.wait();
+                }
+            });
 
-            auto vm_image = config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
+            reply.set_create_message("Configuring " + name);
+            write(reply);
 
-            const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
-            vm_desc.disk_space = compute_final_image_size(
-                image_size, vm_desc.disk_space.in_bytes() > 0 ? vm_desc.disk_space : checked_args.disk_space,
-                config->data_directory);
+            auto extra_interfaces = checked_args.extra_interfaces;
+            {
+                LaunchTimings::Phase phase{launch_timings, name, "networking"};
+                config->factory->prepare_networking(extra_interfaces);
+            }
 
-            reply.set_create_message("Configuring " + name);
+            // Claimed right away, for the other instances of this launch not to take them, and given back on failure
+            std::vector<std::string> instance_macs;
+            for (const auto& iface : extra_interfaces)
+                if (!iface.mac_address.empty())
+                    instance_macs.push_back(iface.mac_address);
+
+            if (auto repeated = allocated_macs.claim(instance_macs))
+                throw std::runtime_error(fmt::format("Repeated MAC address {}", *repeated));
+
+            try
+            {
+                // Generate missing macs after claiming the requested ones, to avoid repeating them
+                for (auto& iface : extra_interfaces)
+                    if (iface.mac_address.empty())
+                        instance_macs.push_back(iface.mac_address = allocated_macs.claim_new());
+
+                vm_desc.default_mac_address = allocated_macs.claim_new();
+                instance_macs.push_back(vm_desc.default_mac_address);
+                vm_desc.extra_interfaces = extra_interfaces;
+
+                {
+                    LaunchTimings::Phase phase{launch_timings, name, "cloud_init_config"};
+                    vm_desc.meta_data_config = make_cloud_init_meta_config(name);
+                    vm_desc.user_data_config = user_data_from(*user_data, request->cloud_init_user_data());
+                    prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
+                }
+
+                if (vm_desc.num_cores < std::stoi(mp::min_cpu_cores))
+                    vm_desc.num_cores = std::stoi(mp::default_cpu_cores);
+
+                vm_desc.network_data_config =
+                    make_cloud_init_network_config(vm_desc.default_mac_address, extra_interfaces);
+
+                const auto vm_image = image_fetch.get();
+                LaunchTimings::Phase phase{launch_timings, name, "instance_image"}; // sized and configured
+                const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
+                vm_desc.disk_space = compute_final_image_size(
+                    image_size, vm_desc.disk_space.in_bytes() > 0 ? vm_desc.disk_space : checked_args.disk_space,
+                    config->data_directory);
+
+                vm_desc.image = vm_image;
+                seed_cloud_init(vm_desc);
+                config->factory->configure(vm_desc);
+                config->factory->prepare_instance_image(vm_image, vm_desc);
+            }
+            catch (...)
+            {
+                allocated_macs.release(instance_macs);
+                throw;
+            }
+
+            return vm_desc;
+        }
+        catch (const std::exception& e)
+        {
+            throw CreateImageException(e.what());
+        }
+    };
+
+    prepare_future_watcher->setFuture(
+        async_operations.run([this, server, names, make_vm_description, log_level]() -> std::vector<PreparedInstance> {
+            mpl::ClientLogger<CreateReply> logger{log_level, *config->logger, server, log_scope_of(names)};
+
+            auto prepare = [&make_vm_description](const std::string& name) {
+                PreparedInstance prepared{name, {}, {}};
+                try
+                {
+                    prepared.description = make_vm_description(name);
+                }
+                catch (const std::exception& e)
+                {
+                    prepared.error = e.what();
+                }
+
+                return prepared;
+            };
+
+            // The first instance resolves and prepares the image, along with any bridges; the others only clone it
+            std::vector<PreparedInstance> prepared_instances{prepare(names.front())};
+            if (!prepared_instances.front().description)
+            {
+                for (auto it = std::next(names.cbegin()); it != names.cend(); ++it)
+                    prepared_instances.push_back({*it, {}, prepared_instances.front().error});
+
+                return prepared_instances;
+            }
+
+            std::vector<std::future<PreparedInstance>> others;
+            for (auto it = std::next(names.cbegin()); it != names.cend(); ++it)
+                others.push_back(instance_workers.run_task([&prepare, name = *it] { return prepare(name); }));
+
+            for (auto& other : others)
+                prepared_instances.push_back(other.get());
+
+            return prepared_instances;
+        }));
+}
+
+void mp::Daemon::boot_in_waves(std::vector<std::string> names, std::size_t max_parallel_boots,
+                               std::chrono::seconds timeout, std::shared_ptr<std::vector<std::string>> errors,
+                               grpc::ServerWriterInterface<LaunchReply>* server,
+                               std::promise<grpc::Status>* status_promise,
+                               std::shared_ptr<AdmissionControl::Ticket> ticket)
+{
+    mpt::ContextScope trace_scope{mpt::context_of(server)}; // later waves start from the event loop
+    auto reserved = reserved_resources();
+    std::vector<std::string> wave;
+    while (!names.empty() && wave.size() < max_parallel_boots)
+    {
+        const auto name = names.front();
+        if (vm_instances.find(name) == vm_instances.end()) // deleted in the meantime
+        {
+            launch_timings.take(name);
+            errors->push_back(fmt::format("instance \"{}\" does not exist", name));
+            names.erase(names.begin());
+            continue;
+        }
+
+        const auto demand = demand_of(name);
+        if (!admission.ever_fits(demand))
+        {
+            launch_timings.take(name);
+            errors->push_back(
+                fmt::format("instance \"{}\" needs more than the host is set to give, so it stays stopped", name));
+            names.erase(names.begin());
+            continue;
+        }
+
+        if (!admission.is_turn_of(ticket.get()) || !admission.fits(demand, reserved))
+        {
+            if (!ticket)
+                ticket = admission.enqueue();
+            break;
+        }
+
+        names.erase(names.begin());
+        try
+        {
+            LaunchReply reply;
+            reply.set_create_message("Starting " + name);
+            server->Write(reply);
+
+            {
+                LaunchTimings::Phase phase{launch_timings, name, "start"};
+                vm_instances[name]->start();
+            }
+            wave.push_back(name);
+            reserved += demand;
+        }
+        catch (const std::exception& e)
+        {
+            launch_timings.take(name);
+            release_resources(name);
+            {
+                std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+                vm_instances.erase(name);
+            }
+            queue_instances_persistence();
+            errors->push_back(e.what());
+        }
+    }
+
+    // The rest wait for room on the host, in turn with other launches, for as long as they would wait to boot
+    if (wave.empty() && !names.empty())
+    {
+        if (ticket->waited() < timeout)
+        {
+            LaunchReply reply;
+            reply.set_reply_message("Waiting for room on the host");
+            reply.set_queue_position(ticket->position());
             server->Write(reply);
 
-            config->factory->prepare_networking(checked_args.extra_interfaces);
+            QTimer::singleShot(admission_retry_interval, this,
+                               [this, names = std::move(names), max_parallel_boots, timeout, errors, server,
+                                status_promise, ticket] {
+                                   boot_in_waves(names, max_parallel_boots, timeout, errors, server, status_promise,
+                                                 ticket);
+                               });
+            return;
+        }
+
+        for (const auto& name : names)
+        {
+            launch_timings.take(name);
+            errors->push_back(fmt::format("timed out waiting for room on the host to start \"{}\"", name));
+        }
+        names.clear();
+    }
+
+    if (names.empty())
+        ticket.reset(); // out of the queue, for the next launch to go
+
+    const auto last_wave = names.empty();
+    auto future_watcher = create_future_watcher(
+        [this, server, wave, names = std::move(names), max_parallel_boots, timeout, errors, status_promise, ticket] {
+            for (const auto& name : wave)
+            {
+                LaunchReply reply;
+                reply.set_vm_instance_name(name);
+                add_launch_phases(name, launch_timings.take(name), reply);
+                config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
+                server->Write(reply);
+            }
+
+            if (!names.empty())
+                boot_in_waves(names, max_parallel_boots, timeout, errors, server, status_promise, ticket);
+        });
+    future_watcher->setFuture(async_operations.run([this, server, wave, timeout, errors, last_wave, status_promise] {
+        auto result = async_wait_for_ready_all<LaunchReply>(server, wave, timeout, nullptr);
+
+        // A lone failure keeps its own status, as when launching a single instance
+        if (!result.status.ok())
+            errors->push_back(result.status.error_message());
+
+        if (!last_wave)
+            return AsyncOperationStatus{grpc::Status::OK, nullptr};
+        else if (errors->size() <= 1 && !result.status.ok())
+            return AsyncOperationStatus{result.status, status_promise};
+        else if (errors->empty())
+            return AsyncOperationStatus{grpc::Status::OK, status_promise};
+        else
+            return AsyncOperationStatus{grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
+                                                     fmt::format("{}", fmt::join(*errors, "\n")), ""},
+                                        status_promise};
+    }));
+}
+
+mp::Reservation mp::Daemon::reserved_resources()
+{
+    Reservation reserved;
+    for (const auto& [name, vm] : vm_instances)
+    {
+        const auto state = vm->current_state();
+        if (state != VirtualMachine::State::off && state != VirtualMachine::State::stopped &&
+            state != VirtualMachine::State::suspended)
+        {
+            const auto demand = demand_of(name);
+            reserved.cores += demand.cores;
+            reserved.memory_bytes += demand.memory_bytes;
+        }
+    }
+
+    {
+        std::lock_guard<decltype(start_mutex)> lock{start_mutex};
+        reserved.boots = static_cast<int>(async_running_futures.size()); // waiting to come up
+    }
+
+    return reserved;
+}
+
+mp::Reservation mp::Daemon::demand_of(const std::string& name)
+{
+    const auto& spec = vm_instance_specs[name];
+    return {spec.num_cores, spec.mem_size.in_bytes(), 1};
+}
+
+bool mp::Daemon::launch_from_warm_pool(const LaunchRequest* request, grpc::ServerWriterInterface<LaunchReply>* server,
+                                       std::promise<grpc::Status>* status_promise)
+{
+    // Pooled instances have durable disks
+    const auto profile = warm_pool_profile_for(*request);
+    if (request->ephemeral() || !warm_pool.size() || !profile ||
+        !config->blueprint_provider->name_from_blueprint(request->image()).empty())
+        return false;
+
+    auto vm = warm_pool.claim(*profile);
+    QTimer::singleShot(0, this, [this, profile = *profile, request = *request] { refill_warm_pool(profile, request); });
+
+    if (!vm)
+        return false;
+
+    const auto& name = vm->vm_name;
+    mpl::log(mpl::Level::info, category, fmt::format("Launching {} from the warm pool", name));
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        vm_instance_specs[name].pool_profile.clear();
+        vm_instances[name] = vm;
+    }
+    instance_events.publish(state_event(name, grpc_instance_status_for(vm->current_state())));
+    queue_instances_persistence(name);
+
+    boot_in_waves({name}, 1, timeout_for(request->timeout(), 0), std::make_shared<std::vector<std::string>>(),
+                  server, status_promise);
+
+    return true;
+}
 
-            // This set stores the MAC's which need to be in the allocated_mac_addrs if everything goes well.
-            auto new_macs = allocated_mac_addrs;
+void mp::Daemon::refill_warm_pool(const std::string& profile, const LaunchRequest& request)
+{
+    static DiscardingServerWriter<CreateReply> discarding_writer;
 
-            // check for repetition of requested macs
-            for (auto& iface : checked_args.extra_interfaces)
-                if (!iface.mac_address.empty() && !new_macs.insert(iface.mac_address).second)
-                    throw std::runtime_error(fmt::format("Repeated MAC address {}", iface.mac_address));
+    for (auto missing = warm_pool.missing(profile); missing > 0; --missing)
+    {
+        auto name = config->name_generator->make_name();
+        if (vm_instances.count(name) || deleted_instances.count(name) || preparing_instances.count(name) ||
+            warm_pool.contains(name))
+            continue; // the next launch of the profile tries again
 
-            // generate missing macs in a second pass, to avoid repeating macs that the user requested
-            for (auto& iface : checked_args.extra_interfaces)
-                if (iface.mac_address.empty())
-                    iface.mac_address = generate_unused_mac_address(new_macs);
+        mpl::log(mpl::Level::info, category, fmt::format("Adding {} to the warm pool", name));
+        auto& entry = warm_pool.add(name, profile, request);
+        try
+        {
+            create_vm(&entry.request, &discarding_writer, &entry.created, /*start=*/false, profile);
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot add {} to the warm pool: {}", name, e.what()));
+        }
 
-            vm_desc.default_mac_address = generate_unused_mac_address(new_macs);
-            vm_desc.extra_interfaces = checked_args.extra_interfaces;
+        if (!preparing_instances.count(name)) // failed before it got going
+            warm_pool.remove(name);
+    }
+}
 
-            vm_desc.meta_data_config = make_cloud_init_meta_config(name);
-            vm_desc.user_data_config = YAML::Load(request->cloud_init_user_data());
-            prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
+void mp::Daemon::warm_up(const std::string& name, std::chrono::seconds timeout)
+{
+    auto vm = warm_pool.instance(name);
+    try
+    {
+        vm->start();
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot warm up {}: {}", name, e.what()));
+        return discard_pooled_instance(name);
+    }
 
-            if (vm_desc.num_cores < std::stoi(mp::min_cpu_cores))
-                vm_desc.num_cores = std::stoi(mp::default_cpu_cores);
+    auto future_watcher = new QFutureWatcher<std::string>();
+    QObject::connect(future_watcher, &QFutureWatcher<std::string>::finished, [this, name, future_watcher] {
+        const auto error = future_watcher->future().result();
+        if (error.empty())
+            warm_pool.mark_ready(name);
+        else
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot warm up {}: {}", name, error));
+            discard_pooled_instance(name);
+        }
 
-            vm_desc.network_data_config =
-                make_cloud_init_network_config(vm_desc.default_mac_address, checked_args.extra_interfaces);
+        delete future_watcher;
+    });
 
-            vm_desc.image = vm_image;
-            config->factory->configure(vm_desc);
-            config->factory->prepare_instance_image(vm_image, vm_desc);
+    future_watcher->setFuture(readiness_waiters.run([this, vm, timeout]() -> std::string {
+        try
+        {
+            vm->wait_until_ssh_up(timeout);
+            MP_UTILS.wait_for_cloud_init(vm.get(), timeout, *config->ssh_key_provider);
+            vm->suspend();
 
-            // Everything went well, add the MAC addresses used in this instance.
-            allocated_mac_addrs = std::move(new_macs);
-            return vm_desc;
+            return {};
         }
         catch (const std::exception& e)
         {
-            throw CreateImageException(e.what());
+            return e.what();
         }
-    };
+    }));
+}
+
+void mp::Daemon::discard_pooled_instance(const std::string& name)
+{
+    {
+        auto vm = warm_pool.instance(name);
+        warm_pool.remove(name);
 
-    prepare_future_watcher->setFuture(QtConcurrent::run(make_vm_description));
+        if (vm)
+            mp::top_catch_all(name, [&vm] { vm->shutdown(); });
+    } // the instance goes away before its resources do
+
+    release_resources(name);
+    queue_instances_persistence();
 }
 
 grpc::Status mp::Daemon::reboot_vm(VirtualMachine& vm)
 {
-    if (vm.state == VirtualMachine::State::delayed_shutdown)
-        delayed_shutdown_instances.erase(vm.vm_name);
-
     if (!mp::utils::is_running(vm.current_state()))
         return grpc::Status{grpc::StatusCode::INVALID_ARGUMENT,
                             fmt::format("instance \"{}\" is not running", vm.vm_name), ""};
 
     mpl::log(mpl::Level::debug, category, fmt::format("Rebooting {}", vm.vm_name));
-    return ssh_reboot(vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), *config->ssh_key_provider);
+    // The reboot takes this session down, as well as any others in the pool
+    auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username());
+    auto status = ssh_reboot(session.take());
+    ssh_sessions.evict(vm.vm_name);
+
+    return status;
 }
 
 grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::milliseconds delay)
 {
     const auto& name = vm.vm_name;
-    const auto& state = vm.current_state();
-
-    using St = VirtualMachine::State;
-    const auto skip_states = {St::off, St::stopped, St::suspended};
 
-    if (std::none_of(cbegin(skip_states), cend(skip_states), [&state](const auto& st) { return state == st; }))
+    if (needs_stopping(vm))
     {
         delayed_shutdown_instances.erase(name);
 
-        mp::optional<mp::SSHSession> session;
-        try
-        {
-            session = mp::SSHSession{vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), *config->ssh_key_provider};
-        }
-        catch (const std::exception& e)
-        {
-            mpl::log(mpl::Level::info, category,
-                     fmt::format("Cannot open ssh session on \"{}\" shutdown: {}", name, e.what()));
-        }
+        auto notify = [this, name](const std::string& message) { notify_users_of(name, message); };
+        auto shutdown = [this](VirtualMachine& instance) {
+            if (due_shutdowns.empty())
+                QTimer::singleShot(due_shutdowns_window, this, [this] { shut_down_due_instances(); });
+            due_shutdowns.push_back(instance.vm_name);
+        };
 
-        auto& shutdown_timer = delayed_shutdown_instances[name] = std::make_unique<DelayedShutdownTimer>(
-            &vm, std::move(session),
-            std::bind(&SSHFSMounts::stop_all_mounts_for_instance, &instance_mounts, std::placeholders::_1));
+        auto& shutdown_timer = delayed_shutdown_instances[name] =
+            std::make_unique<DelayedShutdownTimer>(&vm, notify, shutdown);
 
         QObject::connect(shutdown_timer.get(), &DelayedShutdownTimer::finished,
                          [this, name]() { delayed_shutdown_instances.erase(name); });
@@ -2507,6 +5093,163 @@ grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::mill
     return grpc::Status::OK;
 }
 
+grpc::Status mp::Daemon::shutdown_vm_now(VirtualMachine& vm)
+{
+    if (needs_stopping(vm))
+    {
+        DelayedShutdownTimer{&vm, shutdown_session_for(vm, ssh_sessions), [](const std::string&) {}}
+            .start(std::chrono::milliseconds::zero());
+        mpl::log(mpl::Level::info, vm.vm_name, "Stopped");
+    }
+    else
+        mpl::log(mpl::Level::debug, category, fmt::format("instance \"{}\" does not need stopping", vm.vm_name));
+
+    return grpc::Status::OK;
+}
+
+grpc::Status mp::Daemon::bake_vm(VirtualMachine& vm, const std::string& image_name,
+                                 grpc::ServerWriterInterface<BakeReply>* server)
+try
+{
+    {
+        auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username());
+        auto proc = session->exec(cloud_init_clean_cmd);
+        if (auto ecode = proc.exit_code(); ecode != 0)
+            return grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
+                                fmt::format("Cannot clean the cloud-init state of \"{}\": exited with code {}",
+                                            vm.vm_name, ecode),
+                                proc.read_std_error()};
+    }
+
+    if (auto status = shutdown_vm_now(vm); !status.ok())
+        return status;
+
+    // Flattening the disk takes a while, the instance stays locked and stopped until it is done
+    config->vault->bake_instance_image(vm.vm_name, image_name);
+
+    BakeReply reply;
+    reply.set_reply_message(fmt::format("Baked {} into image {}", vm.vm_name, image_name));
+    server->Write(reply);
+
+    return grpc::Status::OK;
+}
+catch (const std::exception& e)
+{
+    return grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
+                        fmt::format("cannot bake {} into {}: {}", vm.vm_name, image_name, e.what()), ""};
+}
+
+grpc::Status mp::Daemon::snapshot_vm(VirtualMachine& vm, SnapshotRequest::Action action,
+                                     const std::string& snapshot_name,
+                                     grpc::ServerWriterInterface<SnapshotReply>* server)
+try
+{
+    std::string done;
+    switch (action)
+    {
+    case SnapshotRequest::TAKE:
+        vm.take_snapshot(snapshot_name);
+        done = "Took";
+        break;
+    case SnapshotRequest::RESTORE:
+        vm.restore_snapshot(snapshot_name); // those taken after it stay, to go back and forth between them
+        done = "Restored";
+        break;
+    case SnapshotRequest::DELETE:
+        vm.delete_snapshot(snapshot_name);
+        done = "Deleted";
+        break;
+    default:
+        return grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, "unknown snapshot action", ""};
+    }
+
+    if (action != SnapshotRequest::RESTORE)
+    {
+        {
+            std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+            auto& snapshots = vm_instance_specs[vm.vm_name].snapshots;
+            if (action == SnapshotRequest::TAKE)
+                snapshots.push_back(
+                    {snapshot_name, QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toStdString()});
+            else
+                snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(),
+                                               [&snapshot_name](const auto& s) { return s.name == snapshot_name; }),
+                                snapshots.end());
+        }
+
+        queue_instances_persistence(vm.vm_name);
+    }
+
+    SnapshotReply reply;
+    reply.set_reply_message(fmt::format("{} snapshot {} of {}", done, snapshot_name, vm.vm_name));
+    server->Write(reply);
+
+    return grpc::Status::OK;
+}
+catch (const std::exception& e)
+{
+    return grpc::Status{grpc::StatusCode::FAILED_PRECONDITION,
+                        fmt::format("cannot work with snapshot {} of {}: {}", snapshot_name, vm.vm_name, e.what()), ""};
+}
+
+void mp::Daemon::notify_users_of(const std::string& name, const std::string& message)
+{
+    auto it = vm_instances.find(name);
+    if (it == vm_instances.end())
+        return;
+
+    // On a pooled session, so that instances counting down do not hold one each for the whole delay
+    instance_workers.run([this, vm = it->second, message] {
+        try
+        {
+            auto session = ssh_sessions.acquire(vm->vm_name, vm->ssh_hostname(), vm->ssh_port(), vm->ssh_username());
+            session->exec(fmt::format("wall \"{}\"", message)).exit_code();
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::info, vm->vm_name, fmt::format("Cannot tell users about the shutdown: {}", e.what()));
+        }
+    });
+}
+
+void mp::Daemon::shut_down_due_instances()
+{
+    std::vector<std::string> names;
+    for (auto& name : std::exchange(due_shutdowns, {}))
+    {
+        if (vm_instances.find(name) == vm_instances.end())
+            continue;
+
+        if (instance_locks.is_claimed(name))
+        {
+            mpl::log(mpl::Level::warning, name, "Busy with another operation, skipping the delayed shutdown");
+            continue;
+        }
+
+        names.push_back(std::move(name));
+    }
+
+    if (names.empty())
+        return;
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Stopping {} instance(s) at the end of their delay", names.size()));
+
+    auto guard = std::make_shared<InstanceLocks::Guard>(instance_locks.claim(names));
+    for (const auto& name : names)
+        stop_all_mounts_for_instance(name);
+
+    auto future_watcher = create_future_watcher([guard]() mutable { guard.reset(); });
+    future_watcher->setFuture(async_operations.run([this, names] {
+        auto status = cmd_vms_in_parallel(names, [](auto& vm) {
+            vm.shutdown();
+            mpl::log(mpl::Level::info, vm.vm_name, "Stopped");
+            return grpc::Status::OK;
+        });
+        return AsyncOperationStatus{status, nullptr};
+    }));
+}
+
 grpc::Status mp::Daemon::cancel_vm_shutdown(const VirtualMachine& vm)
 {
     auto it = delayed_shutdown_instances.find(vm.vm_name);
@@ -2533,6 +5276,110 @@ grpc::Status mp::Daemon::cmd_vms(const std::vector<std::string>& tgts, std::func
     return grpc::Status::OK;
 }
 
+void mp::Daemon::take_down_instances()
+{
+    if (vm_instances.empty())
+        return;
+
+    mpl::log(mpl::Level::info, category, fmt::format("Taking down {} instance(s)", vm_instances.size()));
+
+    // Work that only starts once the deadline is gone kills its instance rather than wait on it
+    auto late = std::make_shared<std::atomic<bool>>(false);
+    std::vector<std::pair<VirtualMachine::ShPtr, std::future<void>>> pending;
+    for (const auto& [name, vm] : vm_instances)
+        pending.emplace_back(vm, instance_workers.run_task([vm = vm, late] {
+            if (*late)
+                vm->kill();
+            else
+                vm->prepare_for_exit();
+        }));
+
+    const auto deadline = std::chrono::steady_clock::now() + exit_deadline;
+    for (auto& [vm, done] : pending)
+        if (done.wait_until(deadline) == std::future_status::timeout)
+        {
+            *late = true;
+            mpl::log(mpl::Level::warning, vm->vm_name, "Did not suspend or stop in time");
+            mp::top_catch_all(vm->vm_name, [&vm = vm] { vm->kill(); });
+        }
+
+    for (auto& [vm, done] : pending)
+        mp::top_catch_all(vm->vm_name, [&done = done] { done.get(); });
+}
+
+grpc::Status mp::Daemon::cmd_vms_in_parallel(const std::vector<std::string>& tgts,
+                                             std::function<grpc::Status(VirtualMachine&)> cmd)
+{ // Every target gets the command, each on its own worker; the first failure, in the order of the targets, is returned
+    std::vector<QFuture<grpc::Status>> results;
+    {
+        std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+        for (const auto& tgt : tgts)
+            results.push_back(instance_workers.run([vm = vm_instances.at(tgt), cmd]() {
+                try
+                {
+                    return cmd(*vm);
+                }
+                catch (const std::exception& e)
+                {
+                    mpl::log(mpl::Level::warning, vm->vm_name, e.what());
+                    return grpc::Status{grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""};
+                }
+            }));
+    }
+
+    auto status = grpc::Status::OK;
+    for (auto& result : results)
+    {
+        auto st = result.result();
+        if (status.ok() && !st.ok())
+            status = st;
+    }
+
+    return status;
+}
+
+mp::MountHandler& mp::Daemon::mount_handler_for(VMMount::MountType mount_type)
+{
+    if (mount_type == VMMount::MountType::Classic)
+        return instance_mounts;
+
+    std::lock_guard<std::mutex> lock{native_mounts_mutex};
+    if (!native_mounts)
+        native_mounts = config->factory->create_native_mount_handler(*config->ssh_key_provider);
+
+    if (!native_mounts)
+        throw NotImplementedOnThisBackendException{"native mounts"};
+
+    return *native_mounts;
+}
+
+bool mp::Daemon::is_mounted(const std::string& name, const std::string& target_path) const
+{
+    if (instance_mounts.has_instance_already_mounted(name, target_path))
+        return true;
+
+    std::lock_guard<std::mutex> lock{native_mounts_mutex};
+    return native_mounts && native_mounts->has_instance_already_mounted(name, target_path);
+}
+
+bool mp::Daemon::stop_mount(const std::string& name, const std::string& target_path)
+{
+    if (instance_mounts.stop_mount(name, target_path))
+        return true;
+
+    std::lock_guard<std::mutex> lock{native_mounts_mutex};
+    return native_mounts && native_mounts->stop_mount(name, target_path);
+}
+
+void mp::Daemon::stop_all_mounts_for_instance(const std::string& name)
+{
+    instance_mounts.stop_all_mounts_for_instance(name);
+
+    std::lock_guard<std::mutex> lock{native_mounts_mutex};
+    if (native_mounts)
+        native_mounts->stop_all_mounts_for_instance(name);
+}
+
 QFutureWatcher<mp::Daemon::AsyncOperationStatus>*
 mp::Daemon::create_future_watcher(std::function<void()> const& finished_op)
 {
@@ -2558,10 +5405,16 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::stri
     {
         auto it = vm_instances.find(name);
         auto vm = it->second;
+        const auto launching = std::is_same<Reply, LaunchReply>::value;
+        const auto waiting_since = std::chrono::steady_clock::now();
         vm->wait_until_ssh_up(timeout);
 
-        if (std::is_same<Reply, LaunchReply>::value)
+        const auto waited = std::chrono::steady_clock::now() - waiting_since;
+        MP_PERF_COUNTERS.observe("multipass_boot_to_ssh_seconds", {}, waited);
+
+        if (launching)
         {
+            launch_timings.record(name, "ssh_up", waited);
             if (server)
             {
                 Reply reply;
@@ -2569,54 +5422,85 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::stri
                 server->Write(reply);
             }
 
+            LaunchTimings::Phase phase{launch_timings, name, "cloud_init"};
             MP_UTILS.wait_for_cloud_init(vm.get(), timeout, *config->ssh_key_provider);
         }
 
-        if (MP_SETTINGS.get_as<bool>(mp::mounts_key))
+        if (mounts_enabled.get())
         {
             std::vector<std::string> invalid_mounts;
-            auto& mounts = vm_instance_specs[name].mounts;
             auto& vm_specs = vm_instance_specs[name];
-            for (const auto& mount_entry : mounts)
-            {
-                auto& target_path = mount_entry.first;
-                auto& source_path = mount_entry.second.source_path;
-                auto& uid_mappings = mount_entry.second.uid_mappings;
-                auto& gid_mappings = mount_entry.second.gid_mappings;
 
+            // Each handler gets all of its mounts at once, for it to start them together if it can
+            std::map<MountHandler*, std::vector<MountHandler::Mount>> mounts_by_handler;
+            for (const auto& [target_path, mount] : vm_specs.mounts)
+            {
                 try
                 {
-                    instance_mounts.start_mount(vm.get(), source_path, target_path, gid_mappings, uid_mappings);
+                    mounts_by_handler[&mount_handler_for(mount.mount_type)].push_back(
+                        {mount.source_path, target_path, mount.gid_mappings, mount.uid_mappings, mount.profile});
                 }
-                catch (const mp::SSHFSMissingError&)
+                catch (const std::exception& e)
+                {
+                    fmt::format_to(errors, "Removing \"{}\": {}\n", target_path, e.what());
+                    invalid_mounts.push_back(target_path);
+                }
+            }
+
+            auto sshfs_installed = false, sshfs_missing = false;
+            for (const auto& [handler, mounts] : mounts_by_handler)
+            {
+                auto failures = handler->start_mounts(vm.get(), mounts);
+                for (const auto& mount : mounts)
                 {
+                    auto failure = failures.find(mount.target_path);
+                    if (failure == failures.end())
+                        continue;
+
                     try
                     {
-                        if (server)
+                        std::rethrow_exception(failure->second);
+                    }
+                    catch (const mp::SSHFSMissingError&)
+                    {
+                        if (sshfs_missing) // already failed to install it
+                            continue;
+
+                        try
                         {
-                            Reply reply;
-                            reply.set_reply_message("Enabling support for mounting");
-                            server->Write(reply);
+                            if (!sshfs_installed)
+                            {
+                                if (server)
+                                {
+                                    Reply reply;
+                                    reply.set_reply_message("Enabling support for mounting");
+                                    server->Write(reply);
+                                }
+
+                                auto session = ssh_sessions.acquire(name, vm->ssh_hostname(), vm->ssh_port(),
+                                                                    vm_specs.ssh_username);
+                                mp::utils::install_sshfs_for(name, *session);
+                                sshfs_installed = true;
+                            }
+
+                            instance_mounts.start_mount(vm.get(), mount.source_path, mount.target_path,
+                                                        mount.gid_mappings, mount.uid_mappings, mount.profile);
+                        }
+                        catch (const mp::SSHFSMissingError&)
+                        {
+                            fmt::format_to(errors, sshfs_error_template + "\n", name);
+                            sshfs_missing = true;
                         }
-
-                        mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                               *config->ssh_key_provider};
-                        mp::utils::install_sshfs_for(name, session);
-                        instance_mounts.start_mount(vm.get(), source_path, target_path, gid_mappings, uid_mappings);
                     }
-                    catch (const mp::SSHFSMissingError&)
+                    catch (const std::exception& e)
                     {
-                        fmt::format_to(errors, sshfs_error_template + "\n", name);
-                        break;
+                        fmt::format_to(errors, "Removing \"{}\": {}\n", mount.target_path, e.what());
+                        invalid_mounts.push_back(mount.target_path);
                     }
                 }
-                catch (const std::exception& e)
-                {
-                    fmt::format_to(errors, "Removing \"{}\": {}\n", target_path, e.what());
-                    invalid_mounts.push_back(target_path);
-                }
-                persist_instances();
             }
+
+            queue_instances_persistence(name);
         }
     }
     catch (const std::exception& e)
@@ -2643,8 +5527,9 @@ mp::Daemon::async_wait_for_ready_all(grpc::ServerWriterInterface<Reply>* server,
             }
             else
             {
-                auto future = QtConcurrent::run(this, &Daemon::async_wait_for_ssh_and_start_mounts_for<Reply>, name,
-                                                timeout, server);
+                auto future = readiness_waiters.run([this, name, timeout, server] {
+                    return async_wait_for_ssh_and_start_mounts_for<Reply>(name, timeout, server);
+                });
                 async_running_futures[name] = future;
                 start_synchronizer.addFuture(future);
             }
@@ -2684,6 +5569,168 @@ mp::Daemon::async_wait_for_ready_all(grpc::ServerWriterInterface<Reply>* server,
     return {grpc_status_for(errors), status_promise};
 }
 
+void mp::Daemon::seed_cloud_init(VirtualMachineDescription& vm_desc)
+{
+    if (!cloud_init_datasource)
+        return;
+
+    cloud_init_datasource->publish(vm_desc);
+    vm_desc.cloud_init_seed_url = fmt::format("http://{}:{}/{}/", *config->factory->cloud_init_seed_host(),
+                                              cloud_init_datasource->port(), vm_desc.vm_name);
+}
+
+YAML::Node mp::Daemon::vendor_config_for(const std::string& time_zone)
+{
+    std::lock_guard<std::mutex> lock{vendor_configs_mutex};
+    auto it = vendor_configs.find(time_zone);
+    if (it == vendor_configs.end())
+        it = vendor_configs
+                 .emplace(time_zone, make_cloud_init_vendor_config(
+                                         *config->ssh_key_provider, time_zone, config->ssh_username,
+                                         config->factory->get_backend_version_string().toStdString(),
+                                         package_cache_port_setting()))
+                 .first;
+
+    return YAML::Clone(it->second); // blueprints change their copy
+}
+
+std::string mp::Daemon::release_title_of(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock{release_titles_mutex};
+        if (auto it = release_titles.find(name); it != release_titles.end())
+            return it->second;
+    }
+
+    auto vm_image = fetch_image_for(name, config->factory->fetch_type(), *config->vault);
+    auto release_title = vm_image.original_release;
+
+    if (!vm_image.id.empty() && release_title.empty())
+    {
+        try
+        {
+            auto vm_image_info = config->image_hosts.back()->info_for_full_hash(vm_image.id);
+            release_title = vm_image_info.release_title.toStdString();
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot fetch image information: {}", e.what()));
+            return release_title; // for the next request to try again
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{release_titles_mutex};
+    return release_titles[name] = release_title;
+}
+
+void mp::Daemon::reconstruct_instance(const std::string& name)
+{
+    auto it = pending_instances.find(name);
+    if (it == pending_instances.end())
+        return;
+
+    VirtualMachine::ShPtr vm;
+    std::string error;
+    try
+    {
+        vm = config->factory->create_virtual_machine(it->second, *this);
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+        mpl::log(mpl::Level::error, category, fmt::format("Cannot load instance \"{}\": {}", name, error));
+    }
+
+    bool needs_starting = false;
+    optional<std::string> pool_profile;
+    bool pool_ready = false;
+    {
+        std::lock_guard<decltype(instances_mutex)> lock{instances_mutex};
+        pending_instances.erase(it);
+
+        auto spec_it = vm_instance_specs.find(name);
+        if (!vm || spec_it == vm_instance_specs.end())
+            failed_instances[name] = error;
+        else if (!spec_it->second.pool_profile.empty())
+        {
+            pool_profile = spec_it->second.pool_profile;
+            pool_ready = spec_it->second.state == VirtualMachine::State::suspended;
+        }
+        else
+        {
+            const auto& spec = spec_it->second;
+            auto& instance_record = spec.deleted ? deleted_instances : vm_instances;
+            instance_record[name] = vm;
+
+            needs_starting =
+                spec.state == VirtualMachine::State::running && vm->state != VirtualMachine::State::running;
+            assert(!needs_starting || !spec.deleted);
+        }
+    }
+    instances_reconstructed.notify_all();
+
+    // Pooled instances that were not done warming up, or that the pool no longer wants, are not worth keeping
+    if (pool_profile)
+    {
+        const auto wanted = pool_ready && warm_pool.missing(*pool_profile) > 0;
+        warm_pool.add(name, *pool_profile, LaunchRequest{});
+        warm_pool.set_instance(name, std::move(vm));
+
+        if (wanted)
+            warm_pool.mark_ready(name);
+        else
+            discard_pooled_instance(name);
+    }
+
+    if (needs_starting)
+    {
+        mpl::log(mpl::Level::info, category, fmt::format("{} needs starting. Starting now...", name));
+
+        QTimer::singleShot(0, this, [this, name] {
+            multipass::top_catch_all(name, [this, &name]() {
+                vm_instances[name]->start();
+                on_restart(name);
+            });
+        });
+    }
+}
+
+void mp::Daemon::reconstruct_pending_instances()
+{
+    if (pending_instances.empty())
+        return;
+
+    reconstruct_instance(pending_instances.begin()->first);
+    QTimer::singleShot(0, this, [this] { reconstruct_pending_instances(); });
+}
+
+void mp::Daemon::wait_for_instances(const std::vector<std::string>& names)
+{
+    if (QThread::currentThread() == thread())
+    { // nobody else would reconstruct them in the meantime
+        if (names.empty())
+            while (!pending_instances.empty())
+                reconstruct_instance(pending_instances.begin()->first);
+
+        for (const auto& name : names)
+            reconstruct_instance(name);
+    }
+
+    std::shared_lock<decltype(instances_mutex)> lock{instances_mutex};
+    instances_reconstructed.wait(lock, [this, &names] {
+        return names.empty() ? pending_instances.empty()
+                             : std::none_of(names.cbegin(), names.cend(),
+                                            [this](const auto& name) { return pending_instances.count(name); });
+    });
+
+    for (const auto& name : names)
+    {
+        auto it = failed_instances.find(name);
+        if (it != failed_instances.end())
+            throw std::runtime_error(fmt::format("cannot load instance \"{}\": {}", name, it->second));
+    }
+}
+
 void mp::Daemon::finish_async_operation(QFuture<AsyncOperationStatus> async_future)
 {
     auto it = std::find_if(async_future_watchers.begin(), async_future_watchers.end(),
@@ -2699,7 +5746,7 @@ void mp::Daemon::finish_async_operation(QFuture<AsyncOperationStatus> async_futu
     auto async_op_result = async_future.result();
 
     if (!async_op_result.status.ok())
-        persist_instances();
+        queue_instances_persistence();
 
     if (async_op_result.status_promise)
         async_op_result.status_promise->set_value(async_op_result.status);
@@ -18,24 +18,47 @@
 #ifndef MULTIPASS_DAEMON_H
 #define MULTIPASS_DAEMON_H
 
+#include "admission_control.h"
+#include "cloud_init_datasource.h"
 #include "daemon_config.h"
 #include "daemon_rpc.h"
+#include "executor.h"
+#include "federation.h"
+#include "idle_policy.h"
+#include "instance_addresses.h"
+#include "instance_events.h"
+#include "instance_locks.h"
+#include "instance_metrics.h"
+#include "launch_timings.h"
+#include "mac_addresses.h"
+#include "profiler.h"
 #include "vm_specs.h"
+#include "warm_pool.h"
 
 #include <multipass/delayed_shutdown_timer.h>
+#include <multipass/memory_accounting.h>
+#include <multipass/optional.h>
+#include <multipass/settings/setting_handle.h>
+#include <multipass/ssh/ssh_session_pool.h>
 #include <multipass/sshfs_mount/sshfs_mounts.h>
 #include <multipass/virtual_machine.h>
+#include <multipass/virtual_machine_description.h>
 #include <multipass/vm_status_monitor.h>
 
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include <QFutureWatcher>
+#include <QJsonObject>
 
 namespace multipass
 {
@@ -48,7 +71,9 @@ public:
     explicit Daemon(std::unique_ptr<const DaemonConfig> config);
     ~Daemon();
 
-    void persist_instances();
+    void persist_instances(); // writes every instance record right away and waits until they are on disk
+    // Profiles the daemon for the given time, for evidence of slowdowns, along with the state of its queues and pools
+    void capture_profile(std::chrono::seconds duration);
 
 protected:
     void on_resume() override;
@@ -88,6 +113,15 @@ public slots:
     virtual void recover(const RecoverRequest* request, grpc::ServerWriterInterface<RecoverReply>* response,
                          std::promise<grpc::Status>* status_promise);
 
+    virtual void clone(const CloneRequest* request, grpc::ServerWriterInterface<CloneReply>* response,
+                       std::promise<grpc::Status>* status_promise);
+
+    virtual void bake(const BakeRequest* request, grpc::ServerWriterInterface<BakeReply>* response,
+                      std::promise<grpc::Status>* status_promise);
+
+    virtual void snapshot(const SnapshotRequest* request, grpc::ServerWriterInterface<SnapshotReply>* response,
+                          std::promise<grpc::Status>* status_promise);
+
     virtual void ssh_info(const SSHInfoRequest* request, grpc::ServerWriterInterface<SSHInfoReply>* response,
                           std::promise<grpc::Status>* status_promise);
 
@@ -125,17 +159,84 @@ public slots:
                               grpc::ServerWriterInterface<AuthenticateReply>* response,
                               std::promise<grpc::Status>* status_promise);
 
+    virtual void metrics(const MetricsRequest* request, grpc::ServerWriterInterface<MetricsReply>* response,
+                         std::promise<grpc::Status>* status_promise);
+
+    // Streams what happens to the instances, from the thread of the request, until the client is done watching
+    virtual void watch(const WatchRequest* request, grpc::ServerWriterInterface<WatchReply>* response,
+                       std::function<bool()> cancelled, std::promise<grpc::Status>* status_promise);
+
+    // Streams what the running instances use, from the thread of the request as well
+    virtual void top(const TopRequest* request, grpc::ServerWriterInterface<TopReply>* response,
+                     std::function<bool()> cancelled, std::promise<grpc::Status>* status_promise);
+
 private:
     void release_resources(const std::string& instance);
+    void release_resources(const std::vector<std::string>& instances); // recording the images gone in one go
+    void forget_ssh_info(const std::string& instance);
+    void purge_ephemeral_instance(const std::string& name); // once whatever stopped it is done with it
     std::string check_instance_operational(const std::string& instance_name) const;
     std::string check_instance_exists(const std::string& instance_name) const;
     void create_vm(const CreateRequest* request, grpc::ServerWriterInterface<CreateReply>* server,
-                   std::promise<grpc::Status>* status_promise, bool start);
+                   std::promise<grpc::Status>* status_promise, bool start, const std::string& pool_profile = {});
+    // Starts the instances of a launch, at most max_parallel_boots at a time, reporting each wave once it is up
+    // and as the admission limits let them, waiting their turn with the ticket once they have to
+    void boot_in_waves(std::vector<std::string> names, std::size_t max_parallel_boots, std::chrono::seconds timeout,
+                       std::shared_ptr<std::vector<std::string>> errors,
+                       grpc::ServerWriterInterface<LaunchReply>* server, std::promise<grpc::Status>* status_promise,
+                       std::shared_ptr<AdmissionControl::Ticket> ticket = nullptr);
+    Reservation reserved_resources(); // by the instances that run or boot
+    Reservation demand_of(const std::string& name); // to run and boot the instance
+    // Launches that the warm pool can serve take a pooled instance, and have the pool make up for it
+    bool launch_from_warm_pool(const LaunchRequest* request, grpc::ServerWriterInterface<LaunchReply>* server,
+                               std::promise<grpc::Status>* status_promise);
+    void refill_warm_pool(const std::string& profile, const LaunchRequest& request);
+    void warm_up(const std::string& name, std::chrono::seconds timeout); // boots the pooled instance, then suspends it
+    void discard_pooled_instance(const std::string& name);
+    long long running_instance_memory(); // in bytes, as the specs give it
+    utils::MemoryAccount memory_account() const; // main thread only
+    // Launches on a less loaded member of the federation, if there is one
+    bool launch_on_member(const LaunchRequest* request, grpc::ServerWriterInterface<LaunchReply>* server,
+                          std::promise<grpc::Status>* status_promise);
     grpc::Status reboot_vm(VirtualMachine& vm);
     grpc::Status shutdown_vm(VirtualMachine& vm, const std::chrono::milliseconds delay);
+    // Leaves timers and mounts alone, so it can run off the main thread
+    grpc::Status shutdown_vm_now(VirtualMachine& vm);
+    grpc::Status bake_vm(VirtualMachine& vm, const std::string& image_name,
+                         grpc::ServerWriterInterface<BakeReply>* server); // off the main thread too
+    grpc::Status snapshot_vm(VirtualMachine& vm, SnapshotRequest::Action action, const std::string& snapshot_name,
+                             grpc::ServerWriterInterface<SnapshotReply>* server); // off the main thread as well
+    void notify_users_of(const std::string& name, const std::string& message); // off the main thread, fire and forget
+    void shut_down_due_instances(); // all at once, in parallel
     grpc::Status cancel_vm_shutdown(const VirtualMachine& vm);
     grpc::Status cmd_vms(const std::vector<std::string>& tgts, std::function<grpc::Status(VirtualMachine&)> cmd);
+    grpc::Status cmd_vms_in_parallel(const std::vector<std::string>& tgts,
+                                     std::function<grpc::Status(VirtualMachine&)> cmd);
+    void take_down_instances(); // all at once, on the way out, killing those that miss the deadline
     void install_sshfs(VirtualMachine* vm, const std::string& name);
+    MountHandler& mount_handler_for(VMMount::MountType mount_type); // throws when the backend cannot do the type
+    bool is_mounted(const std::string& name, const std::string& target_path) const;
+    bool stop_mount(const std::string& name, const std::string& target_path);
+    void stop_all_mounts_for_instance(const std::string& name);
+    void queue_instances_persistence(const std::string& name = {}); // empty name means any instance may have changed
+    void refresh_metrics();
+    void suspend_idle_instance(const std::string& name); // through suspend, once the idle policy calls for it
+    void refresh_addresses(); // publishes what changed
+    void add_all_images(FindReply& response, bool allow_unsupported, const std::string& default_remote);
+    void mark_instances_dirty(const std::string& name = {});
+    struct SerializedRecord
+    {
+        QJsonObject json;
+        QByteArray cbor;
+    };
+    struct SerializedInstances
+    {
+        QByteArray json;     // the database as tools and older daemons know it
+        QByteArray snapshot; // CBOR, for this daemon to read back without parsing it whole
+        QByteArray completions; // the names that shell completions offer, which they read without asking the daemon
+    };
+    SerializedInstances serialize_dirty_instances();
+    void write_instances(SerializedInstances serialized);
 
     struct AsyncOperationStatus
     {
@@ -151,23 +252,98 @@ private:
     async_wait_for_ready_all(grpc::ServerWriterInterface<Reply>* server, const std::vector<std::string>& vms,
                              const std::chrono::seconds& timeout, std::promise<grpc::Status>* status_promise);
     void finish_async_operation(QFuture<AsyncOperationStatus> async_future);
+
+    // What list shows as the release of an instance; it only changes with the instance's image, so it is kept around
+    std::string release_title_of(const std::string& name);
+    // The vendor data launches start from; it only depends on the time zone, so it is built once for each
+    YAML::Node vendor_config_for(const std::string& time_zone);
+    // Serve the cloud-init data in @p vm_desc over the network and point the instance there, when the daemon does so
+    void seed_cloud_init(VirtualMachineDescription& vm_desc);
+    void reconstruct_instance(const std::string& name); // main thread only
+    void reconstruct_pending_instances();
+    // Until the instances are reconstructed (all of them, if none are named); throws for named ones that failed
+    void wait_for_instances(const std::vector<std::string>& names);
+    template <typename Names>
+    void wait_for_instances(const Names& names)
+    {
+        wait_for_instances(std::vector<std::string>{names.begin(), names.end()});
+    }
     QFutureWatcher<AsyncOperationStatus>* create_future_watcher(std::function<void()> const& finished_op = []() {});
 
     std::unique_ptr<const DaemonConfig> config;
     std::unordered_map<std::string, VMSpecs> vm_instance_specs;
     std::unordered_map<std::string, VirtualMachine::ShPtr> vm_instances;
     std::unordered_map<std::string, VirtualMachine::ShPtr> deleted_instances;
+    // Held exclusively while the maps above change, shared by the queries that run off the main thread
+    mutable std::shared_timed_mutex instances_mutex;
+    // Instances are reconstructed after the daemon comes up, a few at a time or as soon as a request needs them
+    std::unordered_map<std::string, VirtualMachineDescription> pending_instances;
+    std::unordered_map<std::string, std::string> failed_instances; // and why
+    std::condition_variable_any instances_reconstructed;
     std::unordered_map<std::string, std::unique_ptr<DelayedShutdownTimer>> delayed_shutdown_instances;
-    std::unordered_set<std::string> allocated_mac_addrs;
+    std::vector<std::string> due_shutdowns; // delayed shutdowns that came due, to be done together
+    MacAddresses allocated_macs;
+    InstanceEvents instance_events; // outlives the RPC server, which waits for the watches to end
     DaemonRpc daemon_rpc;
     QTimer source_images_maintenance_task;
     SSHFSMounts instance_mounts;
+    MountHandler::UPtr native_mounts; // created on first use, not every backend has them
+    mutable std::mutex native_mounts_mutex;
     std::vector<std::unique_ptr<QFutureWatcher<AsyncOperationStatus>>> async_future_watchers;
     std::unordered_map<std::string, QFuture<std::string>> async_running_futures;
     std::mutex start_mutex;
     std::unordered_set<std::string> preparing_instances;
     QFuture<void> image_update_future;
     SettingsHandler* instance_mod_handler;
+    QTimer instances_persistence_timer;
+    std::mutex dirty_instances_mutex;
+    std::unordered_set<std::string> dirty_instances;
+    bool all_instances_dirty{false};
+    std::unordered_map<std::string, SerializedRecord> serialized_records; // reused while clean
+    std::mutex instances_writer_mutex;
+    optional<SerializedInstances> pending_instances;
+    bool instances_writer_running{false};
+    QFuture<void> instances_writer;
+    std::vector<std::string> network_names; // as last listed, for shell completions
+    InstanceLocks instance_locks; // claimed by the operations that change an instance, for as long as they run
+    SSHSessionPool ssh_sessions; // sessions outlive the requests, so that each does not cost a handshake
+    InstanceMetricsCollector instance_metrics;
+    struct ListedImages
+    {
+        std::vector<std::size_t> generations; // of the hosts' manifests when they were listed
+        FindReply images;
+    };
+    std::mutex listed_images_mutex;
+    std::array<optional<ListedImages>, 2> listed_images; // by whether unsupported images are in
+    std::unordered_map<std::string, std::string> release_titles; // by instance
+    std::mutex release_titles_mutex;
+    std::unordered_map<std::string, YAML::Node> vendor_configs; // by time zone
+    std::mutex vendor_configs_mutex;
+    std::chrono::seconds metrics_interval;
+    WarmPool warm_pool; // main thread only
+    bool reclaim_idle_memory; // balloons instances down to what they use, as metrics come in
+    IdlePolicy idle_policy;   // suspends instances that nobody uses, as metrics come in
+    AdmissionControl admission; // main thread only
+    Federation federation;
+    std::unique_ptr<CloudInitDatasource> cloud_init_datasource; // null when instances get their cloud-init data on ISOs
+    std::unordered_map<std::string, std::promise<grpc::Status>> idle_suspensions; // outcomes nobody waits on
+    SettingHandle<bool> mounts_enabled; // asked for each instance of info, list and launch
+    QTimer metrics_refresh_timer;
+    QFuture<void> metrics_refresh;
+    InstanceAddresses instance_addresses;
+    std::unordered_map<std::string, SSHInfo> ssh_infos; // without key or mounts, until the state or addresses change
+    std::mutex ssh_infos_mutex;
+    QTimer addresses_refresh_timer;
+    QTimer memory_summary_timer;
+    QFuture<void> addresses_refresh;
+    LaunchTimings launch_timings;
+    Profiler profiler; // main thread only
+    // Last, so that they are done before anything their work uses goes away. Work on async_operations waits on the
+    // others, so that one goes first.
+    Executor instance_workers;  // backend operations and queries on instances
+    Executor readiness_waiters; // waits for instances to come up
+    Executor image_preparers;   // fetches and prepares the images of launches
+    Executor async_operations;  // the operations that reply once the above are done
 };
 } // namespace multipass
 #endif // MULTIPASS_DAEMON_H
@@ -17,16 +17,21 @@
 
 #include "daemon_config.h"
 
+#include "baked_image_host.h"
 #include "custom_image_host.h"
+#include "image_mirror.h"
+#include "storage_pools.h"
 #include "ubuntu_image_host.h"
 
 #include <multipass/client_cert_store.h>
 #include <multipass/constants.h>
 #include <multipass/default_vm_blueprint_provider.h>
+#include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/logging/standard_logger.h>
 #include <multipass/name_generator.h>
 #include <multipass/platform.h>
+#include <multipass/settings/settings.h>
 #include <multipass/ssh/openssh_key_provider.h>
 #include <multipass/ssl_cert_provider.h>
 #include <multipass/standard_paths.h>
@@ -44,8 +49,25 @@ namespace mpl = multipass::logging;
 
 namespace
 {
+constexpr auto category = "daemon config";
 constexpr auto manifest_ttl = std::chrono::minutes{5};
 
+// Where the storage pool chosen for the image cache is, or nothing to keep it where it always was
+QString image_pool_path()
+{
+    try
+    {
+        const auto pool = MP_SETTINGS.get(mp::image_pool_key);
+        return pool.isEmpty() ? QString{} : mp::storage_pool_path(pool.toStdString());
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Keeping the image cache in its default place: {}", e.what()));
+        return {};
+    }
+}
+
 std::string server_name_from(const std::string& server_address)
 {
     auto tokens = mp::utils::split(server_address, ":");
@@ -111,7 +133,9 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
 
     if (cache_directory.isEmpty())
     {
-        if (!storage_path.isEmpty())
+        if (auto pool_path = image_pool_path(); !pool_path.isEmpty())
+            cache_directory = mp::utils::make_dir(pool_path, "cache");
+        else if (!storage_path.isEmpty())
             cache_directory = mp::utils::make_dir(storage_path, "cache");
         else
             cache_directory = MP_STDPATHS.writableLocation(StandardPaths::CacheLocation);
@@ -131,14 +155,31 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
         update_prompt = platform::make_update_prompt();
     if (image_hosts.empty())
     {
+        // First, for the names of baked images to be looked up without going to the network. They are in the vault's
+        // directory, where it bakes them.
+        const QDir backend_data_dir{
+            mp::utils::backend_directory_path(data_directory, factory->get_backend_directory_name())};
+        image_hosts.push_back(std::make_unique<mp::BakedVMImageHost>(
+            backend_data_dir.filePath(QString{"vault/%1"}.arg(mp::BakedVMImageHost::remote_name))));
+
         image_hosts.push_back(std::make_unique<mp::CustomVMImageHost>(QSysInfo::currentCpuArchitecture(),
                                                                       url_downloader.get(), manifest_ttl));
-        image_hosts.push_back(std::make_unique<mp::UbuntuVMImageHost>(
-            std::vector<std::pair<std::string, std::string>>{
-                {mp::release_remote, "https://cloud-images.ubuntu.com/releases/"},
-                {mp::daily_remote, "https://cloud-images.ubuntu.com/daily/"},
-                {mp::appliance_remote, "https://cdimage.ubuntu.com/ubuntu-core/appliances/"}},
-            url_downloader.get(), manifest_ttl));
+
+        // With a mirror on the LAN, manifests and images all come from there, filling the mirror as they are asked for
+        // Without one, public mirrors of the remotes can stand in for them, whichever answers first
+        const auto image_mirror = MP_SETTINGS.get(mp::image_mirror_key);
+        auto remotes = mp::default_ubuntu_remotes();
+        mp::UbuntuVMImageHost::Mirrors mirrors;
+        if (!image_mirror.isEmpty())
+            remotes = mp::remotes_mirrored_at(image_mirror, remotes);
+        else
+            mirrors = mp::cloud_image_mirrors(
+                MP_SETTINGS.get(mp::cloud_image_mirrors_key).split(',', QString::SkipEmptyParts), remotes);
+
+        image_hosts.push_back(std::make_unique<mp::UbuntuVMImageHost>(std::move(remotes), url_downloader.get(),
+                                                                      manifest_ttl,
+                                                                      mp::utils::make_dir(cache_directory, "manifests"),
+                                                                      std::move(mirrors)));
     }
     if (vault == nullptr)
     {
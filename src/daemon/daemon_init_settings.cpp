@@ -16,6 +16,8 @@
  */
 
 #include "daemon_init_settings.h"
+#include "federation.h"
+#include "storage_pools.h"
 
 #include <multipass/constants.h>
 #include <multipass/platform.h>
@@ -28,7 +30,11 @@
 
 #include <QCoreApplication>
 #include <QFileSystemWatcher>
+#include <QHostAddress>
 #include <QObject>
+#include <QUrl>
+
+#include <functional>
 
 namespace mp = multipass;
 
@@ -59,6 +65,131 @@ QString driver_interpreter(QString val)
     return val;
 }
 
+QString mount_cache_interpreter(QString val)
+{
+    bool ok;
+    if (auto entries = val.toInt(&ok); !ok || entries < 0)
+        throw mp::InvalidSettingException(mp::mount_cache_key, val, "Need a non-negative number of entries");
+
+    return val;
+}
+
+QString metrics_interval_interpreter(QString val)
+{
+    bool ok;
+    if (auto seconds = val.toInt(&ok); !ok || seconds < 0)
+        throw mp::InvalidSettingException(mp::metrics_interval_key, val, "Need a non-negative number of seconds");
+
+    return val;
+}
+
+QString idle_suspend_interpreter(QString val)
+{
+    bool ok;
+    if (auto minutes = val.toInt(&ok); !ok || minutes < 0)
+        throw mp::InvalidSettingException(mp::idle_suspend_key, val, "Need a non-negative number of minutes");
+
+    return val;
+}
+
+// For the admission limits, which take a count of something
+std::function<QString(QString)> limit_interpreter(const char* key, const char* unit)
+{
+    return [key, unit](QString val) {
+        bool ok;
+        if (auto limit = val.toInt(&ok); !ok || limit < 0)
+            throw mp::InvalidSettingException(key, val, QString{"Need a non-negative number of %1"}.arg(unit));
+
+        return val;
+    };
+}
+
+QString warm_pool_size_interpreter(QString val)
+{
+    bool ok;
+    if (auto size = val.toInt(&ok); !ok || size < 0)
+        throw mp::InvalidSettingException(mp::warm_pool_size_key, val, "Need a non-negative number of instances");
+
+    return val;
+}
+
+QString image_mirror_interpreter(QString val)
+{
+    const QUrl url{val};
+    const auto is_http = url.scheme() == "http" || url.scheme() == "https";
+    if (!val.isEmpty() && (!url.isValid() || !is_http || url.host().isEmpty()))
+        throw mp::InvalidSettingException(mp::image_mirror_key, val, "Need an http(s) URL");
+
+    return val.isEmpty() || val.endsWith('/') ? val : val + '/';
+}
+
+QString cloud_image_mirrors_interpreter(QString val)
+{
+    for (const auto& mirror : val.split(',', QString::SkipEmptyParts))
+    {
+        const QUrl url{mirror.trimmed()};
+        if (!url.isValid() || (url.scheme() != "http" && url.scheme() != "https") || url.host().isEmpty())
+            throw mp::InvalidSettingException(mp::cloud_image_mirrors_key, val, "Need a list of http(s) URLs");
+    }
+
+    return val;
+}
+
+// For the ports that the daemon serves something on
+std::function<QString(QString)> port_interpreter(const char* key)
+{
+    return [key](QString val) {
+        bool ok;
+        if (auto port = val.toInt(&ok); !ok || port < 0 || port > 65535)
+            throw mp::InvalidSettingException(key, val, "Need a port number, or 0 to serve none");
+
+        return val;
+    };
+}
+
+QString image_mirror_address_interpreter(QString val)
+{
+    if (QHostAddress{val}.isNull())
+        throw mp::InvalidSettingException(mp::image_mirror_address_key, val, "Need an IP address");
+
+    return val;
+}
+
+QString storage_pools_interpreter(QString val)
+{
+    try
+    {
+        mp::parse_storage_pools(val);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        throw mp::InvalidSettingException(mp::storage_pools_key, val, e.what());
+    }
+
+    return val;
+}
+
+QString federation_interpreter(QString val)
+{
+    try
+    {
+        mp::parse_federation_members(val);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        throw mp::InvalidSettingException(mp::federation_key, val, e.what());
+    }
+
+    return val;
+}
+
+QString image_pool_interpreter(QString val)
+{
+    if (!val.isEmpty() && !mp::utils::valid_hostname(val.toStdString()))
+        throw mp::InvalidSettingException(mp::image_pool_key, val, "Need the name of a storage pool");
+
+    return val;
+}
 } // namespace
 
 void mp::daemon::monitor_and_quit_on_settings_change() // temporary
@@ -75,6 +206,40 @@ void mp::daemon::register_global_settings_handlers()
     auto settings = MP_PLATFORM.extra_daemon_settings(); // platform settings override inserts with the same key below
     settings.insert(std::make_unique<BasicSettingSpec>(bridged_interface_key, ""));
     settings.insert(std::make_unique<BoolSettingSpec>(mounts_key, MP_PLATFORM.default_privileged_mounts()));
+    settings.insert(std::make_unique<BasicSettingSpec>(prefetch_images_key, ""));
+    settings.insert(std::make_unique<CustomSettingSpec>(mount_cache_key, mount_cache_default, mount_cache_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(metrics_interval_key, metrics_interval_default,
+                                                        metrics_interval_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(warm_pool_size_key, warm_pool_size_default,
+                                                        warm_pool_size_interpreter));
+    settings.insert(std::make_unique<BoolSettingSpec>(reclaim_memory_key, reclaim_memory_default));
+    settings.insert(std::make_unique<BoolSettingSpec>(memory_merging_key, memory_merging_default));
+    settings.insert(
+        std::make_unique<CustomSettingSpec>(idle_suspend_key, idle_suspend_default, idle_suspend_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(cpu_limit_key, cpu_limit_default,
+                                                        limit_interpreter(cpu_limit_key, "percent")));
+    settings.insert(std::make_unique<CustomSettingSpec>(memory_limit_key, memory_limit_default,
+                                                        limit_interpreter(memory_limit_key, "percent")));
+    settings.insert(std::make_unique<CustomSettingSpec>(parallel_boots_key, parallel_boots_default,
+                                                        limit_interpreter(parallel_boots_key, "instances")));
+    settings.insert(std::make_unique<CustomSettingSpec>(download_limit_key, download_limit_default,
+                                                        limit_interpreter(download_limit_key, "KiB per second")));
+    settings.insert(std::make_unique<BoolSettingSpec>(compress_images_key, compress_images_default));
+    settings.insert(std::make_unique<CustomSettingSpec>(storage_pools_key, "", storage_pools_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(image_pool_key, "", image_pool_interpreter));
+    settings.insert(std::make_unique<BasicSettingSpec>(libvirt_pool_key, ""));
+    settings.insert(std::make_unique<CustomSettingSpec>(federation_key, "", federation_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(image_mirror_key, "", image_mirror_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(image_mirror_port_key, image_mirror_port_default,
+                                                        port_interpreter(image_mirror_port_key)));
+    settings.insert(std::make_unique<CustomSettingSpec>(image_mirror_address_key, image_mirror_address_default,
+                                                        image_mirror_address_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(cloud_image_mirrors_key, "", cloud_image_mirrors_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(package_cache_port_key, package_cache_port_default,
+                                                        port_interpreter(package_cache_port_key)));
+    settings.insert(std::make_unique<CustomSettingSpec>(cloud_init_datasource_port_key,
+                                                        cloud_init_datasource_port_default,
+                                                        port_interpreter(cloud_init_datasource_port_key)));
     settings.insert(std::make_unique<CustomSettingSpec>(driver_key, MP_PLATFORM.default_driver(), driver_interpreter));
     settings.insert(std::make_unique<CustomSettingSpec>(mp::passphrase_key, "", [](QString val) {
         return val.isEmpty() ? val : MP_UTILS.generate_scrypt_hash_for(val);
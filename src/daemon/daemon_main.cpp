@@ -18,6 +18,9 @@
 #include "daemon.h"
 #include "daemon_config.h"
 #include "daemon_init_settings.h"
+#include "image_mirror.h"
+#include "package_cache.h"
+#include "ubuntu_image_host.h"
 
 #include "cli.h"
 
@@ -25,15 +28,20 @@
 #include <multipass/constants.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform_unix.h>
+#include <multipass/settings/settings.h>
 #include <multipass/top_catch_all.h>
+#include <multipass/tracing.h>
 #include <multipass/utils.h>
 #include <multipass/version.h>
 
 #include <multipass/format.h>
 
 #include <QCoreApplication>
+#include <QHostAddress>
 
 #include <csignal>
+#include <functional>
+#include <mutex>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -41,12 +49,19 @@ namespace mpp = multipass::platform;
 
 namespace
 {
+constexpr auto mirrored_metadata_ttl = std::chrono::minutes{5};
+constexpr auto cached_package_index_ttl = std::chrono::minutes{10};
+constexpr qint64 mirrored_images_max_size = 20LL * 1024 * 1024 * 1024; // bytes
+constexpr qint64 cached_packages_max_size = 2LL * 1024 * 1024 * 1024;  // idem
+constexpr auto default_profile_duration = std::chrono::seconds{30};
+
 class UnixSignalHandler
 {
 public:
     UnixSignalHandler()
-        : signal_handling_thread{
-              [this, sigs = mpp::make_and_block_signals({SIGTERM, SIGINT, SIGUSR1})] { monitor_signals(sigs); }}
+        : signal_handling_thread{[this, sigs = mpp::make_and_block_signals({SIGTERM, SIGINT, SIGUSR1, SIGUSR2})] {
+              monitor_signals(sigs);
+          }}
     {
     }
 
@@ -55,17 +70,32 @@ public:
         pthread_kill(signal_handling_thread.thread.native_handle(), SIGUSR1);
     }
 
+    // SIGUSR2 asks for a profile, from the thread of the signals, until the handler is reset
+    void on_profile_request(std::function<void()> handler)
+    {
+        std::lock_guard<std::mutex> lock{profile_request_mutex};
+        profile_request_handler = std::move(handler);
+    }
+
     void monitor_signals(sigset_t sigset)
     {
         int sig = -1;
-        sigwait(&sigset, &sig);
+        while (sigwait(&sigset, &sig) == 0 && sig == SIGUSR2)
+        {
+            std::lock_guard<std::mutex> lock{profile_request_mutex};
+            if (profile_request_handler)
+                profile_request_handler();
+        }
+
         if (sig != SIGUSR1)
             mpl::log(mpl::Level::info, "daemon", fmt::format("Received signal {} ({})", sig, strsignal(sig)));
         QCoreApplication::quit();
     }
 
 private:
-    mp::AutoJoinThread signal_handling_thread;
+    std::mutex profile_request_mutex;
+    std::function<void()> profile_request_handler;
+    mp::AutoJoinThread signal_handling_thread; // last, for the rest to be there for it
 };
 
 int main_impl(int argc, char* argv[])
@@ -78,16 +108,59 @@ int main_impl(int argc, char* argv[])
 
     mp::daemon::register_global_settings_handlers();
 
+    if (auto trace_file = qEnvironmentVariable("MULTIPASS_TRACE_FILE"); !trace_file.isEmpty())
+    {
+        mp::tracing::enable(trace_file);
+        mpl::log(mpl::Level::info, "daemon", fmt::format("Tracing to {}", trace_file));
+    }
+
     auto builder = mp::cli::parse(app);
     auto config = builder.build();
     auto server_address = config->server_address;
+    auto url_downloader = config->url_downloader.get();
+    auto cache_directory = config->cache_directory;
+    auto instance_bridge_host = config->factory->cloud_init_seed_host();
 
     mp::daemon::monitor_and_quit_on_settings_change(); // TODO replace with async restart in relevant settings handlers
     mp::Daemon daemon(std::move(config));
 
+    // Declared after the daemon, which owns the downloader that the mirror uses
+    std::unique_ptr<mp::ImageMirror> image_mirror;
+    if (auto mirror_port = MP_SETTINGS.get(mp::image_mirror_port_key).toUShort())
+    {
+        image_mirror = std::make_unique<mp::ImageMirror>(mp::default_ubuntu_remotes(), url_downloader,
+                                                         mp::utils::make_dir(cache_directory, "mirror"),
+                                                         mirrored_metadata_ttl, mirrored_images_max_size);
+        image_mirror->listen(QHostAddress{MP_SETTINGS.get(mp::image_mirror_address_key)}, mirror_port);
+    }
+
+    std::unique_ptr<mp::PackageCache> package_cache;
+    auto package_cache_port = MP_SETTINGS.get(mp::package_cache_port_key).toUShort();
+    if (package_cache_port && !instance_bridge_host)
+    {
+        mpl::log(mpl::Level::warning, "package cache", "This backend's instances cannot reach the host; not serving");
+    }
+    else if (package_cache_port)
+    {
+        // Only where instances reach the host: the cache is meant for them alone
+        package_cache = std::make_unique<mp::PackageCache>(url_downloader,
+                                                           mp::utils::make_dir(cache_directory, "packages"),
+                                                           cached_package_index_ttl, cached_packages_max_size);
+        package_cache->listen(QHostAddress{QString::fromStdString(*instance_bridge_host)}, package_cache_port);
+    }
+
     mpl::log(mpl::Level::info, "daemon", fmt::format("Starting Multipass {}", mp::version_string));
     mpl::log(mpl::Level::info, "daemon", fmt::format("Daemon arguments: {}", app.arguments().join(" ")));
+
+    auto profile_duration = qEnvironmentVariableIntValue("MULTIPASS_PROFILE_SECONDS");
+    handler.on_profile_request([&daemon, duration = profile_duration > 0 ? std::chrono::seconds{profile_duration}
+                                                                         : default_profile_duration] {
+        QMetaObject::invokeMethod(
+            &daemon, [&daemon, duration] { daemon.capture_profile(duration); }, Qt::QueuedConnection);
+    });
+
     auto ret = QCoreApplication::exec();
+    handler.on_profile_request(nullptr); // before the daemon goes
 
     mpl::log(mpl::Level::info, "daemon", "Goodbye!");
     return ret;
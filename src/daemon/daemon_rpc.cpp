@@ -17,21 +17,44 @@
 
 #include "daemon_rpc.h"
 #include "daemon_config.h"
+#include "federation.h"
 
 #include <multipass/format.h>
+#include <multipass/logging/async_log_sink.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
 #include <multipass/platform.h>
+#include <multipass/tracing.h>
 #include <multipass/utils.h>
 
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include <grpc/grpc_security_constants.h>
+#include <grpcpp/resource_quota.h>
+#include <grpcpp/security/server_credentials.h>
+
+#include <scope_guard.hpp>
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+#include <sys/stat.h>
+#endif
+
 #include <chrono>
+#include <cstring>
+#include <optional>
 #include <stdexcept>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
+namespace mpt = multipass::tracing;
 
 namespace
 {
 constexpr auto category = "rpc";
+constexpr auto default_max_interactive_calls = 32;
+constexpr auto default_max_bulk_calls = 8; // mostly waiting on downloads and disks, which a few at a time keep busy
 
 bool check_is_server_running(const std::string& address)
 {
@@ -47,9 +70,36 @@ bool check_is_server_running(const std::string& address)
     return stub->ping(&context, request, &reply).ok();
 }
 
-auto make_server(const std::string& server_address, const mp::CertProvider& cert_provider, mp::Rpc::Service* service)
+// Unset or zero leaves gRPC's own defaults in place
+void apply_thread_limits(grpc::ServerBuilder& builder)
+{
+    if (auto pollers = qEnvironmentVariableIntValue("MULTIPASS_RPC_POLLERS"); pollers > 0)
+    {
+        builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, 1);
+        builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, pollers);
+    }
+
+    // Calls that would take the server past this many threads are turned away, but for pings, which have their own
+    if (auto max_threads = qEnvironmentVariableIntValue("MULTIPASS_RPC_MAX_THREADS"); max_threads > 0)
+    {
+        grpc::ResourceQuota quota{"multipassd"};
+        quota.SetMaxThreads(max_threads);
+        builder.SetResourceQuota(quota);
+    }
+}
+
+// Unset or zero leaves the default in place
+int max_calls(const char* variable, int default_max)
+{
+    auto max = qEnvironmentVariableIntValue(variable);
+    return max > 0 ? max : default_max;
+}
+
+auto make_server(const std::string& server_address, const mp::CertProvider& cert_provider, grpc::Service* service,
+                 std::unique_ptr<grpc::ServerCompletionQueue>& ping_queue)
 {
     grpc::ServerBuilder builder;
+    apply_thread_limits(builder);
 
     std::shared_ptr<grpc::ServerCredentials> creds;
     grpc::SslServerCredentialsOptions opts(GRPC_SSL_REQUEST_CLIENT_CERTIFICATE_BUT_DONT_VERIFY);
@@ -57,9 +107,29 @@ auto make_server(const std::string& server_address, const mp::CertProvider& cert
     creds = grpc::SslServerCredentials(opts);
 
     builder.AddListeningPort(server_address, creds);
+
+    // Next to a unix socket, another one that only the daemon's own user can connect to, which clients running as
+    // that user can opt into to skip the TLS handshake: the kernel vouches for them when they connect
+    const auto local_address = mp::utils::local_server_address(server_address);
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    if (!local_address.empty())
+        builder.AddListeningPort(local_address, grpc::experimental::LocalServerCredentials(UDS));
+#endif
+
     builder.RegisterService(service);
+    ping_queue = builder.AddCompletionQueue();
+
+    std::unique_ptr<grpc::Server> server;
+    {
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+        // The sockets are created closed to everyone else, leaving no window before their permissions are set; the
+        // public one gets opened up afterwards, with set_server_socket_restrictions
+        const auto previous_umask = ::umask(S_IRWXG | S_IRWXO);
+        auto restore_umask = sg::make_scope_guard([previous_umask]() noexcept { ::umask(previous_umask); });
+#endif
+        server = builder.BuildAndStart();
+    }
 
-    std::unique_ptr<grpc::Server> server{builder.BuildAndStart()};
     if (server == nullptr)
     {
         auto detail = check_is_server_running(server_address) ? " A multipass daemon is already running there." : "";
@@ -67,6 +137,14 @@ auto make_server(const std::string& server_address, const mp::CertProvider& cert
             fmt::format("Failed to start multipass gRPC service at {}.{}", server_address, detail));
     }
 
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    // Should another thread have changed the (process-wide) umask meanwhile, still only the daemon's own user
+    if (!local_address.empty() &&
+        !QFile::setPermissions(QString::fromStdString(local_address.substr(std::strlen("unix:"))),
+                               QFile::ReadOwner | QFile::WriteOwner))
+        throw std::runtime_error(fmt::format("Could not set permissions for {}", local_address));
+#endif
+
     return server;
 }
 
@@ -80,14 +158,62 @@ auto server_socket_type_for(const std::string& server_address)
     return mp::ServerSocketType::tcp;
 }
 
-template <typename OperationSignal>
-grpc::Status emit_signal_and_wait_for_result(OperationSignal operation_signal)
+template <typename Reply>
+std::string method_name()
 {
+    auto name = QString::fromStdString(Reply::descriptor()->name()); // e.g. LaunchReply
+    name.chop(static_cast<int>(std::strlen("Reply")));
+
+    return name.toLower().toStdString();
+}
+
+std::string traceparent_from(grpc::ServerContext* context)
+{
+    const auto& metadata = context->client_metadata();
+    auto it = metadata.find("traceparent");
+
+    return it != metadata.end() ? std::string(it->second.data(), it->second.size()) : std::string{};
+}
+
+template <typename OperationSignal, typename Reply>
+grpc::Status emit_signal_and_wait_for_result(OperationSignal operation_signal,
+                                             grpc::ServerWriterInterface<Reply>* server, grpc::ServerContext* context,
+                                             mp::RpcLanes& lanes)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto pass = lanes.enter(method_name<Reply>()); // held until the operation is done
+    std::optional<mpt::Span> span;
+    if (mpt::enabled())
+    {
+        span.emplace("rpc", method_name<Reply>(), mpt::from_traceparent(traceparent_from(context)));
+        mpt::attach(server, span->context()); // for the handler to pick up, on whichever thread it runs
+    }
+
+    const auto relayed = mp::Federation::asked_by_member(context);
+    if (relayed)
+        mp::Federation::mark_relayed(server, true);
+
     std::promise<grpc::Status> status_promise;
     auto status_future = status_promise.get_future();
     emit operation_signal(&status_promise);
 
-    return status_future.get();
+    auto status = status_future.get();
+    mpl::AsyncLogSink::close_all_for(server); // the client's stream cannot take log lines once the call returns
+    mpt::detach(server);
+    if (relayed)
+        mp::Federation::mark_relayed(server, false);
+
+    MP_PERF_COUNTERS.observe("multipass_rpc_duration_seconds", {{"method", method_name<Reply>()}},
+                             std::chrono::steady_clock::now() - start);
+
+    return status;
+}
+
+// Whether the request came through the socket that only the daemon's own user can reach
+bool is_local_client(grpc::ServerContext* context)
+{
+    auto types = context->auth_context()->FindPropertyValues(GRPC_TRANSPORT_SECURITY_TYPE_PROPERTY_NAME);
+    return !types.empty() && types.front() == "local"; // as gRPC's local credentials have it
 }
 
 std::string client_cert_from(grpc::ServerContext* context)
@@ -128,136 +254,217 @@ void accept_cert(mp::CertStore* client_cert_store, const std::string& client_cer
 mp::DaemonRpc::DaemonRpc(const std::string& server_address, const CertProvider& cert_provider,
                          CertStore* client_cert_store)
     : server_address{server_address},
-      server{make_server(server_address, cert_provider, this)},
+      server{make_server(server_address, cert_provider, this, ping_queue)},
       server_socket_type{server_socket_type_for(server_address)},
-      client_cert_store{client_cert_store}
+      client_cert_store{client_cert_store},
+      lanes{max_calls("MULTIPASS_RPC_INTERACTIVE_CALLS", default_max_interactive_calls),
+            max_calls("MULTIPASS_RPC_BULK_CALLS", default_max_bulk_calls)}
 {
     handle_socket_restrictions(server_address, client_cert_store->empty());
 
+    new PingCall{this}; // owns itself, like every call after it
+    ping_thread = std::thread{&DaemonRpc::serve_pings, this};
+
     mpl::log(mpl::Level::info, category, fmt::format("gRPC listening on {}", server_address));
 }
 
+mp::DaemonRpc::~DaemonRpc()
+{
+    server->Shutdown();
+    ping_queue->Shutdown();
+    ping_thread.join();
+}
+
+/*
+ * Pings are served on a completion queue of their own, so that they are answered right away however many streams hold
+ * on to the threads of the synchronous server. Each call waits for the next one before it is answered, and goes away
+ * once its answer is through. Nothing in ping() blocks, so a single thread does for all of them.
+ */
+struct mp::DaemonRpc::PingCall
+{
+    explicit PingCall(DaemonRpc* rpc) : rpc{rpc}
+    {
+        rpc->Requestping(&context, &request, &responder, rpc->ping_queue.get(), rpc->ping_queue.get(), this);
+    }
+
+    // Whether the call is done with
+    bool proceed(bool ok)
+    {
+        if (!ok || answered)
+            return true; // shutting down or answered
+
+        new PingCall{rpc};
+
+        answered = true;
+        responder.Finish(reply, rpc->ping(&context, &request, &reply), this);
+        return false;
+    }
+
+    DaemonRpc* const rpc;
+    grpc::ServerContext context;
+    PingRequest request;
+    PingReply reply;
+    grpc::ServerAsyncResponseWriter<PingReply> responder{&context};
+    bool answered{false};
+};
+
+void mp::DaemonRpc::serve_pings()
+{
+    void* tag;
+    bool ok;
+    while (ping_queue->Next(&tag, &ok))
+    {
+        auto call = static_cast<PingCall*>(tag);
+        if (call->proceed(ok))
+            delete call;
+    }
+}
+
 grpc::Status mp::DaemonRpc::create(grpc::ServerContext* context, const CreateRequest* request,
                                    grpc::ServerWriter<CreateReply>* reply)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_create, this, request, reply, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_create, this, request, reply, std::placeholders::_1), reply, context);
 }
 
 grpc::Status mp::DaemonRpc::launch(grpc::ServerContext* context, const LaunchRequest* request,
                                    grpc::ServerWriter<LaunchReply>* reply)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_launch, this, request, reply, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_launch, this, request, reply, std::placeholders::_1), reply, context);
 }
 
 grpc::Status mp::DaemonRpc::purge(grpc::ServerContext* context, const PurgeRequest* request,
                                   grpc::ServerWriter<PurgeReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_purge, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_purge, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::find(grpc::ServerContext* context, const FindRequest* request,
                                  grpc::ServerWriter<FindReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_find, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_find, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::info(grpc::ServerContext* context, const InfoRequest* request,
                                  grpc::ServerWriter<InfoReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_info, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_info, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::list(grpc::ServerContext* context, const ListRequest* request,
                                  grpc::ServerWriter<ListReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_list, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_list, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::networks(grpc::ServerContext* context, const NetworksRequest* request,
                                      grpc::ServerWriter<NetworksReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_networks, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_networks, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::mount(grpc::ServerContext* context, const MountRequest* request,
                                   grpc::ServerWriter<MountReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_mount, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_mount, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::recover(grpc::ServerContext* context, const RecoverRequest* request,
                                     grpc::ServerWriter<RecoverReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_recover, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_recover, this, request, response, std::placeholders::_1), response, context);
+}
+
+grpc::Status mp::DaemonRpc::clone(grpc::ServerContext* context, const CloneRequest* request,
+                                  grpc::ServerWriter<CloneReply>* response)
+{
+    return verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_clone, this, request, response, std::placeholders::_1), response, context);
+}
+
+grpc::Status mp::DaemonRpc::bake(grpc::ServerContext* context, const BakeRequest* request,
+                                 grpc::ServerWriter<BakeReply>* response)
+{
+    return verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_bake, this, request, response, std::placeholders::_1), response, context);
+}
+
+grpc::Status mp::DaemonRpc::snapshot(grpc::ServerContext* context, const SnapshotRequest* request,
+                                     grpc::ServerWriter<SnapshotReply>* response)
+{
+    return verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_snapshot, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::ssh_info(grpc::ServerContext* context, const SSHInfoRequest* request,
                                      grpc::ServerWriter<SSHInfoReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_ssh_info, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_ssh_info, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::start(grpc::ServerContext* context, const StartRequest* request,
                                   grpc::ServerWriter<StartReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_start, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_start, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::stop(grpc::ServerContext* context, const StopRequest* request,
                                  grpc::ServerWriter<StopReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_stop, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_stop, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::suspend(grpc::ServerContext* context, const SuspendRequest* request,
                                     grpc::ServerWriter<SuspendReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_suspend, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_suspend, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::restart(grpc::ServerContext* context, const RestartRequest* request,
                                     grpc::ServerWriter<RestartReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_restart, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_restart, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::delet(grpc::ServerContext* context, const DeleteRequest* request,
                                   grpc::ServerWriter<DeleteReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_delete, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_delete, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::umount(grpc::ServerContext* context, const UmountRequest* request,
                                    grpc::ServerWriter<UmountReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_umount, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_umount, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::version(grpc::ServerContext* context, const VersionRequest* request,
                                     grpc::ServerWriter<VersionReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_version, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_version, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::ping(grpc::ServerContext* context, const PingRequest* request, PingReply* response)
 {
+    if (is_local_client(context))
+        return grpc::Status::OK;
+
     auto client_cert = client_cert_from(context);
 
     if (!client_cert.empty() && client_cert_store->verify_cert(client_cert))
@@ -272,16 +479,17 @@ grpc::Status mp::DaemonRpc::get(grpc::ServerContext* context, const GetRequest*
                                 grpc::ServerWriter<GetReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_get, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_get, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::authenticate(grpc::ServerContext* context, const AuthenticateRequest* request,
                                          grpc::ServerWriter<AuthenticateReply>* response)
 {
     auto status = emit_signal_and_wait_for_result(
-        std::bind(&DaemonRpc::on_authenticate, this, request, response, std::placeholders::_1));
+        std::bind(&DaemonRpc::on_authenticate, this, request, response, std::placeholders::_1), response, context,
+        lanes);
 
-    if (status.ok())
+    if (status.ok() && !is_local_client(context)) // local clients have no cert to accept, nor need one
     {
         try
         {
@@ -296,9 +504,40 @@ grpc::Status mp::DaemonRpc::authenticate(grpc::ServerContext* context, const Aut
     return status;
 }
 
-template <typename OperationSignal>
-grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(OperationSignal signal, const std::string& client_cert)
+grpc::Status mp::DaemonRpc::metrics(grpc::ServerContext* context, const MetricsRequest* request,
+                                    grpc::ServerWriter<MetricsReply>* response)
 {
+    return verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_metrics, this, request, response, std::placeholders::_1), response, context);
+}
+
+grpc::Status mp::DaemonRpc::watch(grpc::ServerContext* context, const WatchRequest* request,
+                                  grpc::ServerWriter<WatchReply>* response)
+{
+    return verify_client_and_dispatch_operation(std::bind(&DaemonRpc::on_watch, this, request, response,
+                                                          [context] { return context->IsCancelled(); },
+                                                          std::placeholders::_1),
+                                                response, context);
+}
+
+grpc::Status mp::DaemonRpc::top(grpc::ServerContext* context, const TopRequest* request,
+                                grpc::ServerWriter<TopReply>* response)
+{
+    return verify_client_and_dispatch_operation(std::bind(&DaemonRpc::on_top, this, request, response,
+                                                          [context] { return context->IsCancelled(); },
+                                                          std::placeholders::_1),
+                                                response, context);
+}
+
+template <typename OperationSignal, typename Reply>
+grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(OperationSignal signal,
+                                                                 grpc::ServerWriterInterface<Reply>* server,
+                                                                 grpc::ServerContext* context)
+{
+    if (is_local_client(context))
+        return emit_signal_and_wait_for_result(signal, server, context, lanes);
+
+    const auto client_cert = client_cert_from(context);
     if (server_socket_type == mp::ServerSocketType::unix && client_cert_store->empty())
     {
         try
@@ -317,19 +556,19 @@ grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(OperationSignal
                             "Please use 'multipass authenticate' before proceeding."};
     }
 
-    return emit_signal_and_wait_for_result(signal);
+    return emit_signal_and_wait_for_result(signal, server, context, lanes);
 }
 
 grpc::Status mp::DaemonRpc::set(grpc::ServerContext* context, const SetRequest* request,
                                 grpc::ServerWriter<SetReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_set, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_set, this, request, response, std::placeholders::_1), response, context);
 }
 
 grpc::Status mp::DaemonRpc::keys(grpc::ServerContext* context, const KeysRequest* request,
                                  grpc::ServerWriter<KeysReply>* response)
 {
     return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_keys, this, request, response, std::placeholders::_1), client_cert_from(context));
+        std::bind(&DaemonRpc::on_keys, this, request, response, std::placeholders::_1), response, context);
 }
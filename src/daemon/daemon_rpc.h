@@ -19,6 +19,7 @@
 #define MULTIPASS_DAEMON_RPC_H
 
 #include "daemon_config.h"
+#include "rpc_lanes.h"
 
 #include <multipass/cert_provider.h>
 #include <multipass/disabled_copy_move.h>
@@ -28,8 +29,10 @@
 
 #include <QObject>
 
+#include <functional>
 #include <future>
 #include <memory>
+#include <thread>
 
 namespace multipass
 {
@@ -48,11 +51,12 @@ enum class ServerSocketType
 #endif
 
 struct DaemonConfig;
-class DaemonRpc : public QObject, public multipass::Rpc::Service, private DisabledCopyMove
+class DaemonRpc : public QObject, public multipass::Rpc::WithAsyncMethod_ping<Rpc::Service>, private DisabledCopyMove
 {
     Q_OBJECT
 public:
     DaemonRpc(const std::string& server_address, const CertProvider& cert_provider, CertStore* client_cert_store);
+    ~DaemonRpc() override;
 
 signals:
     void on_create(const CreateRequest* request, grpc::ServerWriter<CreateReply>* reply,
@@ -73,6 +77,12 @@ signals:
                   std::promise<grpc::Status>* status_promise);
     void on_recover(const RecoverRequest* request, grpc::ServerWriter<RecoverReply>* response,
                     std::promise<grpc::Status>* status_promise);
+    void on_clone(const CloneRequest* request, grpc::ServerWriter<CloneReply>* response,
+                  std::promise<grpc::Status>* status_promise);
+    void on_bake(const BakeRequest* request, grpc::ServerWriter<BakeReply>* response,
+                 std::promise<grpc::Status>* status_promise);
+    void on_snapshot(const SnapshotRequest* request, grpc::ServerWriter<SnapshotReply>* response,
+                     std::promise<grpc::Status>* status_promise);
     void on_ssh_info(const SSHInfoRequest* request, grpc::ServerWriter<SSHInfoReply>* response,
                      std::promise<grpc::Status>* status_promise);
     void on_start(const StartRequest* request, grpc::ServerWriter<StartReply>* response,
@@ -97,15 +107,29 @@ signals:
                  std::promise<grpc::Status>* status_promise);
     void on_authenticate(const AuthenticateRequest* request, grpc::ServerWriter<AuthenticateReply>* response,
                          std::promise<grpc::Status>* status_promise);
+    void on_metrics(const MetricsRequest* request, grpc::ServerWriter<MetricsReply>* response,
+                    std::promise<grpc::Status>* status_promise);
+    void on_watch(const WatchRequest* request, grpc::ServerWriter<WatchReply>* response,
+                  std::function<bool()> cancelled, std::promise<grpc::Status>* status_promise);
+    void on_top(const TopRequest* request, grpc::ServerWriter<TopReply>* response, std::function<bool()> cancelled,
+                std::promise<grpc::Status>* status_promise);
 
 private:
-    template <typename OperationSignal>
-    grpc::Status verify_client_and_dispatch_operation(OperationSignal signal, const std::string& client_cert);
+    template <typename OperationSignal, typename Reply>
+    grpc::Status verify_client_and_dispatch_operation(OperationSignal signal,
+                                                      grpc::ServerWriterInterface<Reply>* server,
+                                                      grpc::ServerContext* context);
+
+    struct PingCall;
+    void serve_pings();
 
     const std::string server_address;
+    std::unique_ptr<grpc::ServerCompletionQueue> ping_queue; // set up along with the server
     const std::unique_ptr<grpc::Server> server;
     const ServerSocketType server_socket_type;
     CertStore* client_cert_store;
+    RpcLanes lanes;
+    std::thread ping_thread;
 
 protected:
     grpc::Status create(grpc::ServerContext* context, const CreateRequest* request,
@@ -126,6 +150,12 @@ protected:
                        grpc::ServerWriter<MountReply>* response) override;
     grpc::Status recover(grpc::ServerContext* context, const RecoverRequest* request,
                          grpc::ServerWriter<RecoverReply>* response) override;
+    grpc::Status clone(grpc::ServerContext* context, const CloneRequest* request,
+                       grpc::ServerWriter<CloneReply>* response) override;
+    grpc::Status bake(grpc::ServerContext* context, const BakeRequest* request,
+                      grpc::ServerWriter<BakeReply>* response) override;
+    grpc::Status snapshot(grpc::ServerContext* context, const SnapshotRequest* request,
+                          grpc::ServerWriter<SnapshotReply>* response) override;
     grpc::Status ssh_info(grpc::ServerContext* context, const SSHInfoRequest* request,
                           grpc::ServerWriter<SSHInfoReply>* response) override;
     grpc::Status start(grpc::ServerContext* context, const StartRequest* request,
@@ -151,6 +181,12 @@ protected:
                       grpc::ServerWriter<KeysReply>* response) override;
     grpc::Status authenticate(grpc::ServerContext* context, const AuthenticateRequest* request,
                               grpc::ServerWriter<AuthenticateReply>* response) override;
+    grpc::Status metrics(grpc::ServerContext* context, const MetricsRequest* request,
+                         grpc::ServerWriter<MetricsReply>* response) override;
+    grpc::Status watch(grpc::ServerContext* context, const WatchRequest* request,
+                       grpc::ServerWriter<WatchReply>* response) override;
+    grpc::Status top(grpc::ServerContext* context, const TopRequest* request,
+                     grpc::ServerWriter<TopReply>* response) override;
 };
 } // namespace multipass
 #endif // MULTIPASS_DAEMON_RPC_H
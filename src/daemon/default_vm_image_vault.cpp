@@ -16,16 +16,21 @@
  */
 
 #include "default_vm_image_vault.h"
+#include "baked_image_host.h"
 
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/create_image_exception.h>
 #include <multipass/exceptions/unsupported_image_exception.h>
+#include <multipass/file_ops.h>
 #include <multipass/json_writer.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
 #include <multipass/query.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/reclaimer.h>
+#include <multipass/tracing.h>
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 #include <multipass/vm_image.h>
@@ -33,22 +38,36 @@
 
 #include <multipass/format.h>
 
+#include <QDateTime>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSaveFile>
 #include <QUrl>
 #include <QtConcurrent/QtConcurrent>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <exception>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+namespace mpt = multipass::tracing;
 
 namespace
 {
 constexpr auto category = "image vault";
 constexpr auto instance_db_name = "multipassd-instance-image-records.json";
+constexpr auto min_journal_entries_to_compact = 64;
 constexpr auto image_db_name = "multipassd-image-records.json";
+constexpr auto image_digests_db_name = "multipassd-image-digests.json";
+constexpr auto image_progress_weight = 18; // the kernel and initrd of a cloud image are about a tenth of its size
 
 auto query_to_json(const mp::Query& query)
 {
@@ -80,6 +99,9 @@ auto image_to_json(const mp::VMImage& image)
     }
     json.insert("aliases", aliases);
 
+    if (!image.backing_image_path.isEmpty())
+        json.insert("backing_path", image.backing_image_path);
+
     return json;
 }
 
@@ -89,10 +111,89 @@ auto record_to_json(const mp::VaultRecord& record)
     json.insert("image", image_to_json(record.image));
     json.insert("query", query_to_json(record.query));
     json.insert("last_accessed", static_cast<qint64>(record.last_accessed.time_since_epoch().count()));
+    if (!record.content_hash.isEmpty())
+        json.insert("content_hash", record.content_hash);
+    if (record.image_facts)
+        json.insert("image_facts", QJsonObject{{"format", record.image_facts->format},
+                                               {"virtual_size", record.image_facts->virtual_size},
+                                               {"cluster_size", record.image_facts->cluster_size}});
+    if (record.compressed)
+        json.insert("compressed", true);
     return json;
 }
 
-std::unordered_map<std::string, mp::VaultRecord> load_db(const QString& db_name)
+mp::optional<mp::ImageFacts> image_facts_from_json(const QJsonObject& json)
+{
+    const auto virtual_size = static_cast<qint64>(json["virtual_size"].toDouble());
+    if (virtual_size <= 0)
+        return mp::nullopt;
+
+    const auto cluster_size = static_cast<qint64>(json["cluster_size"].toDouble());
+    return mp::ImageFacts{json["format"].toString(), virtual_size, cluster_size};
+}
+
+mp::optional<mp::VaultRecord> record_from_json(const QJsonObject& record)
+{
+    if (record.isEmpty())
+        return mp::nullopt;
+
+    auto image = record["image"].toObject();
+    if (image.isEmpty())
+        return mp::nullopt;
+
+    auto image_path = image["path"].toString();
+    if (image_path.isNull())
+        return mp::nullopt;
+
+    auto kernel_path = image["kernel_path"].toString();
+    auto initrd_path = image["initrd_path"].toString();
+    auto image_id = image["id"].toString().toStdString();
+    auto original_release = image["original_release"].toString().toStdString();
+    auto current_release = image["current_release"].toString().toStdString();
+    auto release_date = image["release_date"].toString().toStdString();
+    auto backing_image_path = image["backing_path"].toString();
+
+    std::vector<std::string> aliases;
+    for (QJsonValueRef entry : image["aliases"].toArray())
+    {
+        auto alias = entry.toObject()["alias"].toString().toStdString();
+        aliases.push_back(alias);
+    }
+
+    auto query = record["query"].toObject();
+    if (query.isEmpty())
+        return mp::nullopt;
+
+    auto release = query["release"].toString();
+    auto persistent = query["persistent"];
+    if (!persistent.isBool())
+        return mp::nullopt;
+    auto remote_name = query["remote_name"].toString();
+    auto query_type = static_cast<mp::Query::Type>(query["type"].toInt());
+
+    std::chrono::system_clock::time_point last_accessed;
+    auto last_accessed_count = static_cast<qint64>(record["last_accessed"].toDouble());
+    if (last_accessed_count == 0)
+    {
+        last_accessed = std::chrono::system_clock::now();
+    }
+    else
+    {
+        auto duration = std::chrono::system_clock::duration(last_accessed_count);
+        last_accessed = std::chrono::system_clock::time_point(duration);
+    }
+
+    return mp::VaultRecord{
+        {image_path, kernel_path, initrd_path, image_id, original_release, current_release, release_date, aliases,
+         backing_image_path},
+        {"", release.toStdString(), persistent.toBool(), remote_name.toStdString(), query_type},
+        last_accessed,
+        record["content_hash"].toString(),
+        image_facts_from_json(record["image_facts"].toObject()),
+        record["compressed"].toBool()};
+}
+
+std::unordered_map<std::string, mp::VaultRecord> load_records(const QString& db_name)
 {
     QFile db_file{db_name};
     auto opened = db_file.open(QIODevice::ReadOnly);
@@ -111,62 +212,89 @@ std::unordered_map<std::string, mp::VaultRecord> load_db(const QString& db_name)
     std::unordered_map<std::string, mp::VaultRecord> reconstructed_records;
     for (auto it = records.constBegin(); it != records.constEnd(); ++it)
     {
-        auto key = it.key().toStdString();
-        auto record = it.value().toObject();
-        if (record.isEmpty())
+        auto record = record_from_json(it.value().toObject());
+        if (!record)
             return {};
 
-        auto image = record["image"].toObject();
-        if (image.isEmpty())
-            return {};
-
-        auto image_path = image["path"].toString();
-        if (image_path.isNull())
-            return {};
+        reconstructed_records[it.key().toStdString()] = *record;
+    }
+    return reconstructed_records;
+}
 
-        auto kernel_path = image["kernel_path"].toString();
-        auto initrd_path = image["initrd_path"].toString();
-        auto image_id = image["id"].toString().toStdString();
-        auto original_release = image["original_release"].toString().toStdString();
-        auto current_release = image["current_release"].toString().toStdString();
-        auto release_date = image["release_date"].toString().toStdString();
+QString journal_path_for(const QString& db_name)
+{
+    return db_name + ".journal";
+}
 
-        std::vector<std::string> aliases;
-        for (QJsonValueRef entry : image["aliases"].toArray())
-        {
-            auto alias = entry.toObject()["alias"].toString().toStdString();
-            aliases.push_back(alias);
-        }
+// Changes since the last compaction are appended to a journal, one JSON object per line: {"key": ..., "record": ...}
+// for records that were added or updated, and {"key": ...} for records that were removed
+std::unordered_map<std::string, mp::VaultRecord> load_db(const QString& db_name, int& journal_entries)
+{
+    auto records = load_records(db_name);
+    journal_entries = 0;
 
-        auto query = record["query"].toObject();
-        if (query.isEmpty())
-            return {};
+    QFile journal_file{journal_path_for(db_name)};
+    if (!journal_file.open(QIODevice::ReadOnly))
+        return records;
 
-        auto release = query["release"].toString();
-        auto persistent = query["persistent"];
-        if (!persistent.isBool())
-            return {};
-        auto remote_name = query["remote_name"].toString();
-        auto query_type = static_cast<mp::Query::Type>(query["type"].toInt());
+    while (!journal_file.atEnd())
+    {
+        const auto entry = QJsonDocument::fromJson(journal_file.readLine()).object();
+        const auto key = entry["key"].toString().toStdString();
+        if (key.empty())
+            continue; // e.g. a line cut short by a crash
 
-        std::chrono::system_clock::time_point last_accessed;
-        auto last_accessed_count = static_cast<qint64>(record["last_accessed"].toDouble());
-        if (last_accessed_count == 0)
+        ++journal_entries;
+        if (!entry.contains("record"))
         {
-            last_accessed = std::chrono::system_clock::now();
+            records.erase(key);
         }
-        else
+        else if (auto record = record_from_json(entry["record"].toObject()))
         {
-            auto duration = std::chrono::system_clock::duration(last_accessed_count);
-            last_accessed = std::chrono::system_clock::time_point(duration);
+            records[key] = *record;
         }
+    }
+
+    return records;
+}
+
+std::unordered_map<std::string, mp::ImageDigest> load_image_digests(const QString& db_name)
+{
+    QFile db_file{db_name};
+    if (!db_file.open(QIODevice::ReadOnly))
+        return {};
+
+    const auto digests = QJsonDocument::fromJson(db_file.readAll()).object();
+
+    std::unordered_map<std::string, mp::ImageDigest> image_digests;
+    for (auto it = digests.constBegin(); it != digests.constEnd(); ++it)
+    {
+        const auto digest = it.value().toObject();
+        const auto sha256 = digest["sha256"].toString();
+        if (sha256.isEmpty())
+            continue;
 
-        reconstructed_records[key] = {
-            {image_path, kernel_path, initrd_path, image_id, original_release, current_release, release_date, aliases},
-            {"", release.toStdString(), persistent.toBool(), remote_name.toStdString(), query_type},
-            last_accessed};
+        image_digests[it.key().toStdString()] = {static_cast<qint64>(digest["size"].toDouble()),
+                                                 static_cast<qint64>(digest["last_modified"].toDouble()), sha256};
     }
-    return reconstructed_records;
+
+    return image_digests;
+}
+
+void persist_image_digests(const std::unordered_map<std::string, mp::ImageDigest>& image_digests,
+                           const QString& db_name)
+{
+    QJsonObject digests;
+    for (const auto& [path, digest] : image_digests)
+    {
+        QJsonObject json;
+        json.insert("size", digest.size);
+        json.insert("last_modified", digest.last_modified_msecs);
+        json.insert("sha256", digest.sha256);
+        digests.insert(QString::fromStdString(path), json);
+    }
+
+    mp::write_json(digests, db_name);
 }
 
 void remove_source_images(const mp::VMImage& source_image, const mp::VMImage& prepared_image)
@@ -180,19 +308,20 @@ void remove_source_images(const mp::VMImage& source_image, const mp::VMImage& pr
         mp::vault::delete_file(source_image.initrd_path);
 }
 
+// Images take long to free, and the records no longer point at them by the time this is called
 void delete_image_dir(const mp::Path& image_path)
 {
     QFileInfo image_file{image_path};
     if (image_file.exists())
     {
         if (image_file.isDir())
-            QDir(image_path).removeRecursively();
+            mpu::reclaim_in_background(image_path);
         else
-            image_file.dir().removeRecursively();
+            mpu::reclaim_in_background(image_file.absolutePath());
     }
 }
 
-mp::MemorySize get_image_size(const mp::Path& image_path)
+mp::ImageFacts query_image_facts(const mp::Path& image_path)
 {
     QStringList qemuimg_parameters{{"info", image_path}};
     auto qemuimg_process =
@@ -207,38 +336,148 @@ mp::MemorySize get_image_size(const mp::Path& image_path)
     }
 
     const auto img_info = QString{qemuimg_process->read_all_standard_output()};
-    const auto pattern = QStringLiteral("^virtual size: .+ \\((?<size>\\d+) bytes\\)\r?$");
-    const auto re = QRegularExpression{pattern, QRegularExpression::MultilineOption};
+    const auto line = [&img_info](const QString& pattern) {
+        return QRegularExpression{pattern, QRegularExpression::MultilineOption}.match(img_info);
+    };
 
-    mp::MemorySize image_size{};
+    const auto size_match = line(QStringLiteral("^virtual size: .+ \\((?<size>\\d+) bytes\\)\r?$"));
+    if (!size_match.hasMatch())
+        throw std::runtime_error{"Could not obtain image's virtual size"};
 
-    const auto match = re.match(img_info);
+    return {line(QStringLiteral("^file format: (?<format>\\S+)\r?$")).captured("format"),
+            size_match.captured("size").toLongLong(),
+            line(QStringLiteral("^cluster_size: (?<size>\\d+)\r?$")).captured("size").toLongLong()};
+}
 
-    if (match.hasMatch())
+// Images are asked about on every launch, and qemu-img says the same for as long as the file stays the same
+mp::MemorySize get_image_size(const mp::Path& image_path)
+{
+    struct Known
     {
-        image_size = mp::MemorySize(match.captured("size").toStdString());
-    }
-    else
+        QDateTime modified;
+        qint64 file_size;
+        mp::MemorySize image_size;
+    };
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, Known> known;
+
+    const QFileInfo file{image_path};
+    const auto modified = file.lastModified();
+    const auto file_size = file.size();
+    const auto key = image_path.toStdString();
     {
-        throw std::runtime_error{"Could not obtain image's virtual size"};
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = known.find(key);
+        const auto hit = it != known.end() && it->second.modified == modified && it->second.file_size == file_size;
+        ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests",
+                                   {{"query", "qemu-img_info"}, {"result", hit ? "hit" : "miss"}});
+        if (hit)
+            return it->second.image_size;
     }
 
+    const auto image_size = mp::MemorySize::from_bytes(query_image_facts(image_path).virtual_size);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    known[key] = {modified, file_size, image_size};
+
     return image_size;
 }
+
+// The directory that delete_image_dir would remove for @p image_path, as spelled on disk, for exact comparisons
+QString image_dir_of(const mp::Path& image_path)
+{
+    const QFileInfo image_file{image_path};
+    const QFileInfo image_dir{image_file.isDir() ? image_file.absoluteFilePath() : image_file.absolutePath()};
+    const auto canonical_path = image_dir.canonicalFilePath();
+
+    return canonical_path.isEmpty() ? image_dir.absoluteFilePath() : canonical_path;
+}
+
+// Whether removing the directory of @p image_path would pull an image from under an instance
+bool backs_an_instance(const std::unordered_map<std::string, mp::VaultRecord>& instance_records,
+                       const mp::Path& image_path)
+{
+    const auto image_dir = image_dir_of(image_path);
+    return std::any_of(instance_records.cbegin(), instance_records.cend(),
+                       [&image_dir](const std::pair<std::string, mp::VaultRecord>& record) {
+                           const auto& backing_image_path = record.second.image.backing_image_path;
+                           return !backing_image_path.isEmpty() && image_dir_of(backing_image_path) == image_dir;
+                       });
+}
+
+bool holds_resumable_download(const QFileInfo& entry, const mp::days& days_to_expire)
+{
+    if (!entry.isDir())
+        return false;
+
+    const auto resume_infos = QDir{entry.absoluteFilePath()}.entryInfoList({"*.partial"}, QDir::Files);
+    return std::any_of(resume_infos.cbegin(), resume_infos.cend(), [&days_to_expire](const QFileInfo& info) {
+        const auto last_modified = std::chrono::system_clock::from_time_t(info.lastModified().toSecsSinceEpoch());
+        return last_modified + days_to_expire > std::chrono::system_clock::now();
+    });
+}
+
+void count_fetch(const std::string& result) // hit, joined (an ongoing download) or miss
+{
+    ++MP_PERF_COUNTERS.counter("multipass_image_vault_requests", {{"result", result}});
+}
 } // namespace
 
+// Lets every launch waiting on the same fetch follow its progress. The fetch goes on while anyone is still interested.
+class mp::DefaultVMImageVault::ProgressFanOut
+{
+public:
+    explicit ProgressFanOut(const ProgressMonitor& monitor) : monitors{monitor}
+    {
+    }
+
+    void add(const ProgressMonitor& monitor)
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+        monitors.push_back(monitor);
+    }
+
+    bool operator()(int progress_type, int percentage)
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+        monitors.erase(std::remove_if(monitors.begin(), monitors.end(),
+                                      [progress_type, percentage](const ProgressMonitor& monitor) {
+                                          return !monitor(progress_type, percentage);
+                                      }),
+                       monitors.end());
+
+        return !monitors.empty();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<ProgressMonitor> monitors;
+};
+
 mp::DefaultVMImageVault::DefaultVMImageVault(std::vector<VMImageHost*> image_hosts, URLDownloader* downloader,
-                                             mp::Path cache_dir_path, mp::Path data_dir_path, mp::days days_to_expire)
+                                             mp::Path cache_dir_path, mp::Path data_dir_path, mp::days days_to_expire,
+                                             OverlayAction make_overlay_image, CompressAction compress_image,
+                                             FlattenAction flatten_image)
     : BaseVMImageVault{image_hosts},
       url_downloader{downloader},
       cache_dir{QDir(cache_dir_path).filePath("vault")},
       data_dir{QDir(data_dir_path).filePath("vault")},
       instances_dir(data_dir.filePath("instances")),
+      pool_instances_subdir{QString{"%1/instances"}.arg(QDir{data_dir_path}.dirName())},
       images_dir(cache_dir.filePath("images")),
+      store_dir(cache_dir.filePath("store")),
+      baked_dir(data_dir.filePath(BakedVMImageHost::remote_name)),
       days_to_expire{days_to_expire},
-      prepared_image_records{load_db(cache_dir.filePath(image_db_name))},
-      instance_image_records{load_db(data_dir.filePath(instance_db_name))}
+      make_overlay_image{std::move(make_overlay_image)},
+      compress_image{std::move(compress_image)},
+      flatten_image{std::move(flatten_image)},
+      prepared_image_records{load_db(cache_dir.filePath(image_db_name), image_journal_entries)},
+      instance_image_records{load_db(data_dir.filePath(instance_db_name), instance_journal_entries)},
+      image_digests{load_image_digests(cache_dir.filePath(image_digests_db_name))}
 {
+    mpu::reclaim_leftovers(images_dir);
+    mpu::reclaim_leftovers(instances_dir);
 }
 
 mp::DefaultVMImageVault::~DefaultVMImageVault()
@@ -249,6 +488,7 @@ mp::DefaultVMImageVault::~DefaultVMImageVault()
 mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, const Query& query,
                                                  const PrepareAction& prepare, const ProgressMonitor& monitor)
 {
+    mpt::Span span{"vault", "fetch_image"};
     {
         std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
         auto name_entry = instance_image_records.find(query.name);
@@ -275,30 +515,34 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
         if (source_image.image_path.endsWith(".xz"))
         {
-            source_image.image_path = extract_image_from(query.name, source_image, monitor);
+            source_image.image_path = extract_image_from(query, source_image, monitor);
         }
         else
         {
-            source_image = image_instance_from(query.name, source_image);
+            source_image = image_instance_from(query, source_image);
         }
 
         if (fetch_type == FetchType::ImageKernelAndInitrd)
         {
             auto info = get_kernel_query_info(query.name);
 
-            source_image =
-                fetch_kernel_and_initrd(info, source_image, QFileInfo(source_image.image_path).absoluteDir(), monitor);
+            fetch_kernel_and_initrd(info, source_image, QFileInfo(source_image.image_path).absoluteDir(), monitor);
         }
 
         vm_image = prepare(source_image);
-        vm_image.id = mp::vault::compute_image_hash(vm_image.image_path).toStdString();
+
+        // An image that needed no preparation is a copy of the given file, whose hash may already be known
+        const auto hashed_path = vm_image.image_path == source_image.image_path && !image_url.path().endsWith(".xz")
+                                      ? image_url.path()
+                                      : vm_image.image_path;
+        vm_image.id = image_hash_for(hashed_path).toStdString();
 
         remove_source_images(source_image, vm_image);
 
         {
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
-            persist_instance_records();
+            persist_instance_record(query.name);
         }
 
         return vm_image;
@@ -325,6 +569,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
                 if (last_modified.isValid() && (last_modified.toString().toStdString() == record.image.release_date))
                 {
+                    count_fetch("hit");
                     return finalize_image_records(query, record.image, id);
                 }
             }
@@ -332,8 +577,10 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
             auto running_future = get_image_future(id);
             if (running_future)
             {
-                monitor(LaunchProgress::WAITING, -1);
+                count_fetch("joined");
                 future = *running_future;
+                in_progress_monitors[id]->add(monitor); // before WAITING, so that no progress goes unreported
+                monitor(LaunchProgress::WAITING, -1);
             }
             else
             {
@@ -362,10 +609,16 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
                 // Had to use std::bind here to workaround the 5 allowable function arguments constraint of
                 // QtConcurrent::run()
+                auto progress = std::make_shared<ProgressFanOut>(monitor);
                 future = QtConcurrent::run(std::bind(&DefaultVMImageVault::download_and_prepare_source_image, this,
-                                                     info, source_image, image_dir, fetch_type, prepare, monitor));
+                                                     info, source_image, image_dir, fetch_type, prepare,
+                                                     [progress](int type, int percentage) {
+                                                         return (*progress)(type, percentage);
+                                                     }));
 
                 in_progress_image_fetches[id] = future;
+                in_progress_monitors[id] = progress;
+                count_fetch("miss");
             }
         }
         else
@@ -374,7 +627,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
             id = info.id.toStdString();
 
-            std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+            std::unique_lock<decltype(fetch_mutex)> lock{fetch_mutex};
             if (!query.name.empty())
             {
                 for (auto& record : prepared_image_records)
@@ -386,10 +639,17 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
                     if (id == record.first ||
                         std::find(aliases.cbegin(), aliases.cend(), query.release) != aliases.cend())
                     {
-                        const auto prepared_image = record.second.image;
+                        const auto record_id = record.first; // the lock may be let go of, and the records change
+                        auto prepared_image = record.second.image;
                         try
                         {
-                            return finalize_image_records(query, prepared_image, record.first);
+                            if (fetch_type == FetchType::ImageKernelAndInitrd && prepared_image.kernel_path.isEmpty())
+                                prepared_image = add_kernel_and_initrd(record_id, info, lock, monitor);
+
+                            auto vm_image = finalize_image_records(query, prepared_image, record_id);
+                            count_fetch("hit");
+
+                            return vm_image;
                         }
                         catch (const std::exception& e)
                         {
@@ -405,8 +665,10 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
             auto running_future = get_image_future(id);
             if (running_future)
             {
-                monitor(LaunchProgress::WAITING, -1);
+                count_fetch("joined");
                 future = *running_future;
+                in_progress_monitors[id]->add(monitor); // before WAITING, so that no progress goes unreported
+                monitor(LaunchProgress::WAITING, -1);
             }
             else
             {
@@ -415,10 +677,16 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
                 // Had to use std::bind here to workaround the 5 allowable function arguments constraint of
                 // QtConcurrent::run()
+                auto progress = std::make_shared<ProgressFanOut>(monitor);
                 future = QtConcurrent::run(std::bind(&DefaultVMImageVault::download_and_prepare_source_image, this,
-                                                     info, source_image, image_dir, fetch_type, prepare, monitor));
+                                                     info, source_image, image_dir, fetch_type, prepare,
+                                                     [progress](int type, int percentage) {
+                                                         return (*progress)(type, percentage);
+                                                     }));
 
                 in_progress_image_fetches[id] = future;
+                in_progress_monitors[id] = progress;
+                count_fetch("miss");
             }
         }
 
@@ -427,12 +695,14 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
             auto prepared_image = future.result();
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             in_progress_image_fetches.erase(id);
+            in_progress_monitors.erase(id);
             return finalize_image_records(query, prepared_image, id);
         }
         catch (const std::exception&)
         {
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             in_progress_image_fetches.erase(id);
+            in_progress_monitors.erase(id);
             throw;
         }
     }
@@ -440,16 +710,152 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
 void mp::DefaultVMImageVault::remove(const std::string& name)
 {
-    const auto& name_entry = instance_image_records.find(name);
-    if (name_entry == instance_image_records.end())
-        return;
+    remove_all({name});
+}
+
+void mp::DefaultVMImageVault::remove_all(const std::vector<std::string>& names)
+{
+    std::vector<std::string> removed;
+    for (const auto& name : names)
+    {
+        const auto& name_entry = instance_image_records.find(name);
+        if (name_entry == instance_image_records.end())
+            continue;
+
+        // Instances in a storage pool have their directory there, named after them like in the vault
+        const QFileInfo image_file{name_entry->second.image.image_path};
+        const auto instance_dir = image_file.dir().dirName() == QString::fromStdString(name)
+                                      ? image_file.absolutePath()
+                                      : instances_dir.filePath(QString::fromStdString(name));
+        mpu::reclaim_in_background(instance_dir);
+
+        instance_image_records.erase(name_entry);
+        removed.push_back(name);
+    }
+
+    if (!removed.empty())
+        persist_instance_records(removed);
+}
+
+mp::VMImage mp::DefaultVMImageVault::clone_instance_image(const std::string& source_name,
+                                                          const std::string& destination_name)
+{
+    VaultRecord record;
+    {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        auto it = instance_image_records.find(source_name);
+        if (it == instance_image_records.end())
+            throw std::runtime_error(fmt::format("Cannot find the image of instance \"{}\"", source_name));
+
+        if (instance_image_records.find(destination_name) != instance_image_records.end())
+            throw std::runtime_error(fmt::format("Instance \"{}\" already has an image", destination_name));
+
+        record = it->second;
+    }
+
+    // The copy goes in the same storage pool. An overlay is copied as it is, so the copy shares the prepared image
+    // that backs it, and only what the source instance wrote is copied.
+    record.query.name = destination_name;
+    const QDir output_dir{instance_dir_for(record.query)};
+    try
+    {
+        record.image.image_path = mp::vault::copy(record.image.image_path, output_dir);
+        record.image.kernel_path = mp::vault::copy(record.image.kernel_path, output_dir);
+        record.image.initrd_path = mp::vault::copy(record.image.initrd_path, output_dir);
+    }
+    catch (...)
+    {
+        mpu::reclaim_in_background(output_dir.absolutePath());
+        throw;
+    }
+
+    record.last_accessed = std::chrono::system_clock::now();
+    {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        instance_image_records[destination_name] = record;
+        persist_instance_record(destination_name);
+    }
+
+    return record.image;
+}
+
+mp::VMImageInfo mp::DefaultVMImageVault::bake_instance_image(const std::string& instance_name,
+                                                             const std::string& image_name)
+{
+    VaultRecord record;
+    {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        auto it = instance_image_records.find(instance_name);
+        if (it == instance_image_records.end())
+            throw std::runtime_error(fmt::format("Cannot find the image of instance \"{}\"", instance_name));
 
-    QDir instance_dir{instances_dir};
-    if (instance_dir.cd(QString::fromStdString(name)))
-        instance_dir.removeRecursively();
+        record = it->second;
+    }
+
+    const auto name = QString::fromStdString(image_name);
+    if (baked_dir.exists(name))
+        throw std::runtime_error(fmt::format("There is already an image called \"{}\"", image_name));
+
+    const QDir image_dir{mp::utils::make_dir(baked_dir, name)};
+    VMImage image{record.image};
+    const auto flatten = flatten_image && !image.backing_image_path.isEmpty();
+    try
+    {
+        // An overlay is flattened, for the baked image not to depend on the prepared image behind the instance
+        if (flatten)
+        {
+            image.image_path = image_dir.filePath(QFileInfo{image.image_path}.fileName());
+            flatten_image(record.image.image_path, record.image.backing_image_path, image.image_path);
+        }
+        else
+        {
+            image.image_path = mp::vault::copy(image.image_path, image_dir);
+        }
+        image.kernel_path = mp::vault::copy(image.kernel_path, image_dir);
+        image.initrd_path = mp::vault::copy(image.initrd_path, image_dir);
+    }
+    catch (...)
+    {
+        mpu::reclaim_in_background(image_dir.absolutePath());
+        throw;
+    }
 
-    instance_image_records.erase(name);
-    persist_instance_records();
+    const auto baked_at = QDateTime::currentDateTimeUtc();
+    const auto baked_as = QString{"%1@%2"}.arg(name, baked_at.toString(Qt::ISODateWithMs));
+    const QString id = QCryptographicHash::hash(baked_as.toUtf8(), QCryptographicHash::Sha256).toHex();
+    const auto to_url = [](const QString& path) {
+        return path.isEmpty() ? QString{} : QUrl::fromLocalFile(path).toString();
+    };
+    const VMImageInfo info{{name},
+                           {},
+                           name,
+                           QString::fromStdString(fmt::format("Baked from {}", instance_name)),
+                           true,
+                           to_url(image.image_path),
+                           to_url(image.kernel_path),
+                           to_url(image.initrd_path),
+                           id,
+                           {},
+                           baked_at.toString("yyyyMMdd.hhmm"),
+                           QFileInfo{image.image_path}.size(),
+                           false};
+    image.id = id.toStdString();
+    image.aliases = {image_name};
+    image.backing_image_path.clear();
+    BakedVMImageHost::describe(image_dir, info);
+
+    // Launches find the image among the prepared ones, so that instances are layered on top of it where it is, and a
+    // persistent alias query keeps it from ever expiring. The query names no remote, as launches of the image do.
+    std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+    prepared_image_records[image.id] = {image,
+                                        {"", image_name, true, "", Query::Type::Alias},
+                                        std::chrono::system_clock::now(),
+                                        {},
+                                        nullopt,
+                                        flatten};
+    persist_image_record(image.id);
+
+    return info;
 }
 
 bool mp::DefaultVMImageVault::has_record_for(const std::string& name)
@@ -460,7 +866,7 @@ bool mp::DefaultVMImageVault::has_record_for(const std::string& name)
 void mp::DefaultVMImageVault::prune_expired_images()
 {
     std::vector<decltype(prepared_image_records)::key_type> expired_keys;
-    std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+    std::unique_lock<decltype(fetch_mutex)> lock{fetch_mutex};
 
     for (const auto& record : prepared_image_records)
     {
@@ -468,6 +874,14 @@ void mp::DefaultVMImageVault::prune_expired_images()
         if (record.second.query.query_type == Query::Type::Alias && !record.second.query.persistent &&
             record.second.last_accessed + days_to_expire <= std::chrono::system_clock::now())
         {
+            if (backs_an_instance(instance_image_records, record.second.image.image_path))
+            {
+                mpl::log(mpl::Level::debug, category,
+                         fmt::format("Source image {} is expired but still backs instances. Keeping it.",
+                                     record.second.query.release));
+                continue;
+            }
+
             mpl::log(
                 mpl::Level::info, category,
                 fmt::format("Source image {} is expired. Removing it from the cache.", record.second.query.release));
@@ -476,12 +890,17 @@ void mp::DefaultVMImageVault::prune_expired_images()
         }
     }
 
-    // Remove any image directories that have no corresponding database entry
+    // Remove any image directories that have no corresponding database entry, except for recent partial downloads
     for (const auto& entry : images_dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
     {
+        if (holds_resumable_download(entry, days_to_expire) ||
+            backs_an_instance(instance_image_records, entry.absoluteFilePath()))
+            continue;
+
+        const auto entry_dir = image_dir_of(entry.absoluteFilePath());
         if (std::find_if(prepared_image_records.cbegin(), prepared_image_records.cend(),
-                         [&entry](const std::pair<std::string, VaultRecord>& record) {
-                             return record.second.image.image_path.contains(entry.absoluteFilePath());
+                         [&entry_dir](const std::pair<std::string, VaultRecord>& record) {
+                             return image_dir_of(record.second.image.image_path) == entry_dir;
                          }) == prepared_image_records.cend())
         {
             mpl::log(mpl::Level::info, category,
@@ -492,9 +911,16 @@ void mp::DefaultVMImageVault::prune_expired_images()
     }
 
     for (const auto& key : expired_keys)
+    {
         prepared_image_records.erase(key);
+        persist_image_record(key);
+    }
+}
 
-    persist_image_records();
+void mp::DefaultVMImageVault::maintain_images()
+{
+    compress_prepared_images();
+    deduplicate_prepared_images(); // what was just compressed included
 }
 
 void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type, const PrepareAction& prepare,
@@ -531,11 +957,12 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type, const P
         {
             fetch_image(fetch_type, record.query, prepare, monitor);
 
-            // Remove old image
+            // Remove old image, unless instances are still layered on top of it
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
-            delete_image_dir(record.image.image_path);
+            if (!backs_an_instance(instance_image_records, record.image.image_path))
+                delete_image_dir(record.image.image_path);
             prepared_image_records.erase(key);
-            persist_image_records();
+            persist_image_record(key);
         }
         catch (const CreateImageException& e)
         {
@@ -545,33 +972,233 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type, const P
     }
 }
 
-mp::MemorySize mp::DefaultVMImageVault::minimum_image_size_for(const std::string& id)
+void mp::DefaultVMImageVault::deduplicate_prepared_images()
 {
-    auto prepared_image_entry = prepared_image_records.find(id);
-    if (prepared_image_entry != prepared_image_records.end())
+    // Identical images reached through different aliases, remotes or URLs end up in different image directories.
+    // Each prepared image is hard linked into a store keyed by its SHA-256, so that all its copies share one inode,
+    // and store entries are dropped once no prepared image refers to them anymore.
+    std::vector<std::pair<std::string, mp::Path>> unhashed_images;
     {
-        const auto& record = prepared_image_entry->second;
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        for (const auto& record : prepared_image_records)
+            if (record.second.content_hash.isEmpty())
+                unhashed_images.emplace_back(record.first, record.second.image.image_path);
+    }
 
-        return get_image_size(record.image.image_path);
+    // Hash without holding the lock, it may take a while for big images that were not hashed before as they are
+    std::vector<std::pair<std::string, QString>> computed_hashes;
+    for (const auto& [key, image_path] : unhashed_images)
+    {
+        try
+        {
+            computed_hashes.emplace_back(key, image_hash_for(image_path));
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot hash {}: {}", image_path, e.what()));
+        }
     }
 
-    for (const auto& instance_image_entry : instance_image_records)
+    std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+    if (!store_dir.exists() && !QDir{}.mkpath(store_dir.absolutePath()))
+        return;
+
+    for (const auto& [key, content_hash] : computed_hashes)
     {
-        const auto& record = instance_image_entry.second;
+        auto entry = prepared_image_records.find(key);
+        if (entry == prepared_image_records.end())
+            continue;
+
+        const auto& image_path = entry->second.image.image_path;
+        const auto stored_path = store_dir.filePath(content_hash);
+        if (QFile::exists(stored_path))
+        {
+            // Replace this copy with a link to the stored one, the data stays alive for anything that has it open
+            QFile::remove(image_path);
+            if (!MP_FILEOPS.hard_link(stored_path, image_path))
+            {
+                mpl::log(mpl::Level::warning, category, fmt::format("Cannot deduplicate {}", image_path));
+                MP_FILEOPS.copy(stored_path, image_path);
+                continue;
+            }
 
-        if (record.image.id == id)
+            mpl::log(mpl::Level::debug, category, fmt::format("Deduplicated {}", image_path));
+        }
+        else if (!MP_FILEOPS.hard_link(image_path, stored_path))
         {
-            return get_image_size(record.image.image_path);
+            continue;
         }
+
+        entry->second.content_hash = content_hash;
+        persist_image_record(key);
     }
 
-    throw std::runtime_error(fmt::format("Cannot determine minimum image size for id \'{}\'", id));
+    for (const auto& stored : store_dir.entryInfoList(QDir::Files))
+    {
+        if (std::none_of(prepared_image_records.cbegin(), prepared_image_records.cend(),
+                         [&stored](const std::pair<std::string, VaultRecord>& record) {
+                             return record.second.content_hash == stored.fileName();
+                         }))
+            QFile::remove(stored.absoluteFilePath());
+    }
+}
+
+void mp::DefaultVMImageVault::compress_prepared_images()
+{
+    if (!compress_image)
+        return;
+
+    std::vector<std::pair<std::string, mp::Path>> uncompressed_images;
+    {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        for (const auto& record : prepared_image_records)
+            if (!record.second.compressed && !in_progress_image_fetches.count(record.first))
+                uncompressed_images.emplace_back(record.first, record.second.image.image_path);
+    }
+
+    // Compress without holding the lock, it takes a while. The compressed image replaces the original under the same
+    // name, so overlays keep finding their backing image, and running instances keep reading the one they have open.
+    for (const auto& [key, image_path] : uncompressed_images)
+    {
+        const auto compressed_path = image_path + ".compressed";
+        try
+        {
+            compress_image(image_path, compressed_path);
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Cannot compress {}: {}", image_path, e.what()));
+            QFile::remove(compressed_path);
+            continue;
+        }
+
+        const auto original_size = QFileInfo{image_path}.size();
+        const auto compressed_size = QFileInfo{compressed_path}.size();
+
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        auto entry = prepared_image_records.find(key);
+        if (entry == prepared_image_records.end() || entry->second.image.image_path != image_path ||
+            std::rename(QFile::encodeName(compressed_path).constData(), QFile::encodeName(image_path).constData()))
+        {
+            QFile::remove(compressed_path);
+            continue;
+        }
+
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Compressed {} from {} to {} bytes", image_path, original_size, compressed_size));
+
+        // The file is a different one now, to be hashed and inspected anew
+        entry->second.compressed = true;
+        entry->second.content_hash.clear();
+        entry->second.image_facts = nullopt;
+        persist_image_record(key);
+    }
+}
+
+void mp::DefaultVMImageVault::prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries,
+                                              const PrepareAction& prepare, const ProgressMonitor& monitor)
+{
+    for (const auto& query : queries)
+    {
+        try
+        {
+            const auto id = info_for(query).id.toStdString();
+            {
+                std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+
+                // Stay out of the way of launches, the remaining images are picked up on the next run
+                if (!in_progress_image_fetches.empty())
+                {
+                    mpl::log(mpl::Level::debug, category, "Other images are being fetched, deferring prefetch");
+                    return;
+                }
+
+                auto entry = prepared_image_records.find(id);
+                if (entry != prepared_image_records.end())
+                {
+                    // Keep prefetched images from expiring
+                    entry->second.last_accessed = std::chrono::system_clock::now();
+                    persist_image_record(id);
+                    continue;
+                }
+            }
+
+            mpl::log(mpl::Level::info, category, fmt::format("Prefetching {} source image", query.release));
+
+            Query prefetch_query{query};
+            prefetch_query.name = "";
+            fetch_image(fetch_type, prefetch_query, prepare, monitor);
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Cannot prefetch source image {}: {}", query.release, e.what()));
+        }
+    }
+}
+
+mp::MemorySize mp::DefaultVMImageVault::minimum_image_size_for(const std::string& id)
+{
+    Path prepared_image_path, instance_image_path;
+    {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+
+        auto prepared_image_entry = prepared_image_records.find(id);
+        if (prepared_image_entry != prepared_image_records.end())
+        {
+            const auto& record = prepared_image_entry->second;
+
+            if (record.image_facts)
+            {
+                ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests",
+                                           {{"query", "qemu-img_info"}, {"result", "hit"}});
+                return MemorySize::from_bytes(record.image_facts->virtual_size);
+            }
+
+            prepared_image_path = record.image.image_path;
+        }
+        else
+        {
+            for (const auto& instance_image_entry : instance_image_records)
+            {
+                const auto& record = instance_image_entry.second;
+
+                if (record.image.id == id)
+                {
+                    instance_image_path = record.image.image_path;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Instance images can be resized, so only what prepared images say is kept
+    if (!instance_image_path.isEmpty())
+        return get_image_size(instance_image_path);
+
+    if (prepared_image_path.isEmpty())
+        throw std::runtime_error(fmt::format("Cannot determine minimum image size for id \'{}\'", id));
+
+    ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests", {{"query", "qemu-img_info"}, {"result", "miss"}});
+    const auto image_facts = query_image_facts(prepared_image_path);
+
+    std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+    auto prepared_image_entry = prepared_image_records.find(id);
+    if (prepared_image_entry != prepared_image_records.end() &&
+        prepared_image_entry->second.image.image_path == prepared_image_path)
+    {
+        prepared_image_entry->second.image_facts = image_facts;
+        persist_image_record(id);
+    }
+
+    return MemorySize::from_bytes(image_facts.virtual_size);
 }
 
 mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
     const VMImageInfo& info, mp::optional<VMImage>& existing_source_image, const QDir& image_dir,
     const FetchType& fetch_type, const PrepareAction& prepare, const ProgressMonitor& monitor)
 {
+    mpt::Span span{"vault", "download_and_prepare"};
     VMImage source_image;
     auto id = info.id;
 
@@ -592,28 +1219,25 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
         }
     }
 
-    mp::vault::DeleteOnException image_file{source_image.image_path};
+    // Interrupted downloads are kept, for the next fetch to resume them
+    mp::vault::DeleteOnException image_file{source_image.image_path,
+                                            URLDownloader::resume_info_path_for(source_image.image_path)};
 
     try
     {
-        url_downloader->download_to(info.image_location, source_image.image_path, info.size, LaunchProgress::IMAGE,
-                                    monitor);
-
-        if (info.verify)
-        {
-            monitor(LaunchProgress::VERIFY, -1);
-            mp::vault::verify_image_download(source_image.image_path, id);
-        }
+        // The kernel and initrd download alongside the image, rather than after it
+        auto image_download = [this, &info, &source_image, &monitor](const ProgressMonitor& image_monitor) {
+            auto stage_monitor = [&image_monitor, &monitor](int download_type, int progress) {
+                return download_type == LaunchProgress::IMAGE ? image_monitor(download_type, progress)
+                                                              : monitor(download_type, progress);
+            };
+            source_image.image_path = download_image(info, source_image.image_path, stage_monitor);
+        };
 
         if (fetch_type == FetchType::ImageKernelAndInitrd)
-        {
-            source_image = fetch_kernel_and_initrd(info, source_image, image_dir, monitor);
-        }
-
-        if (source_image.image_path.endsWith(".xz"))
-        {
-            source_image.image_path = mp::vault::extract_image(source_image.image_path, monitor, true);
-        }
+            fetch_kernel_and_initrd(info, source_image, image_dir, monitor, image_download);
+        else
+            image_download(monitor);
 
         auto prepared_image = prepare(source_image);
         remove_source_images(source_image, prepared_image);
@@ -630,11 +1254,71 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
     }
 }
 
-QString mp::DefaultVMImageVault::extract_image_from(const std::string& instance_name, const VMImage& source_image,
+QString mp::DefaultVMImageVault::download_image(const VMImageInfo& info, const QString& image_path,
+                                                const ProgressMonitor& monitor)
+{
+    if (image_path.endsWith(".xz"))
+        return download_and_extract_image(info, image_path, monitor);
+
+    if (info.verify)
+    {
+        const auto image_hash = url_downloader->download_and_hash_to(info.image_location, image_path, info.size,
+                                                                     LaunchProgress::IMAGE, monitor);
+
+        monitor(LaunchProgress::VERIFY, -1);
+        mp::vault::verify_image_hash(image_hash, info.id);
+        remember_image_hash(image_path, image_hash);
+    }
+    else
+    {
+        url_downloader->download_to(info.image_location, image_path, info.size, LaunchProgress::IMAGE, monitor);
+    }
+
+    return image_path;
+}
+
+QString mp::DefaultVMImageVault::download_and_extract_image(const VMImageInfo& info, const QString& image_path,
+                                                            const ProgressMonitor& monitor)
+{
+    // Decode while downloading, so the compressed image never needs to be stored
+    QString decoded_image_path{image_path};
+    decoded_image_path.remove(".xz");
+
+    mp::vault::DeleteOnException decoded_image_file{decoded_image_path};
+    mp::XzStreamDecoder xz_decoder{decoded_image_path};
+
+    const auto image_hash =
+        url_downloader->stream_and_hash(info.image_location, info.size, LaunchProgress::IMAGE, monitor,
+                                        [&xz_decoder](const QByteArray& data) { return xz_decoder.feed(data); });
+
+    monitor(LaunchProgress::EXTRACT, -1);
+    xz_decoder.finish();
+
+    if (info.verify)
+    {
+        monitor(LaunchProgress::VERIFY, -1);
+        mp::vault::verify_image_hash(image_hash, info.id);
+    }
+
+    return decoded_image_path;
+}
+
+QString mp::DefaultVMImageVault::instance_dir_for(const Query& query)
+{
+    const auto name = QString::fromStdString(query.name);
+    if (query.storage_location.empty())
+        return mp::utils::make_dir(instances_dir, name);
+
+    const QDir pool_dir{QDir{QString::fromStdString(query.storage_location)}.filePath(pool_instances_subdir)};
+    mpu::reclaim_leftovers(pool_dir);
+
+    return mp::utils::make_dir(pool_dir, name);
+}
+
+QString mp::DefaultVMImageVault::extract_image_from(const Query& query, const VMImage& source_image,
                                                     const ProgressMonitor& monitor)
 {
-    const auto name = QString::fromStdString(instance_name);
-    const QDir output_dir{mp::utils::make_dir(instances_dir, name)};
+    const QDir output_dir{instance_dir_for(query)};
     QFileInfo file_info{source_image.image_path};
     const auto image_name = file_info.fileName().remove(".xz");
     const auto image_path = output_dir.filePath(image_name);
@@ -642,11 +1326,9 @@ QString mp::DefaultVMImageVault::extract_image_from(const std::string& instance_
     return mp::vault::extract_image(image_path, monitor);
 }
 
-mp::VMImage mp::DefaultVMImageVault::image_instance_from(const std::string& instance_name,
-                                                         const VMImage& prepared_image)
+mp::VMImage mp::DefaultVMImageVault::image_instance_from(const Query& query, const VMImage& prepared_image)
 {
-    auto name = QString::fromStdString(instance_name);
-    auto output_dir = mp::utils::make_dir(instances_dir, name);
+    auto output_dir = instance_dir_for(query);
 
     return {mp::vault::copy(prepared_image.image_path, output_dir),
             mp::vault::copy(prepared_image.kernel_path, output_dir),
@@ -658,19 +1340,110 @@ mp::VMImage mp::DefaultVMImageVault::image_instance_from(const std::string& inst
             {}};
 }
 
-mp::VMImage mp::DefaultVMImageVault::fetch_kernel_and_initrd(const VMImageInfo& info, const VMImage& source_image,
-                                                             const QDir& image_dir, const ProgressMonitor& monitor)
+mp::VMImage mp::DefaultVMImageVault::overlay_instance_from(const Query& query, const VMImage& prepared_image)
+{
+    auto output_dir = instance_dir_for(query);
+
+    return {make_overlay_image(prepared_image.image_path, output_dir),
+            mp::vault::copy(prepared_image.kernel_path, output_dir),
+            mp::vault::copy(prepared_image.initrd_path, output_dir),
+            prepared_image.id,
+            prepared_image.original_release,
+            prepared_image.current_release,
+            prepared_image.release_date,
+            {},
+            prepared_image.image_path};
+}
+
+// The kernel and initrd download side by side, and with the image too when @p image_download is given, all of them
+// reporting as one; their sizes are not known up front, so the kernel and initrd count once they are done
+void mp::DefaultVMImageVault::fetch_kernel_and_initrd(
+    const VMImageInfo& info, VMImage& image, const QDir& image_dir, const ProgressMonitor& monitor,
+    const std::function<void(const ProgressMonitor&)>& image_download)
 {
-    auto image{source_image};
+    const auto kernel_path = image_dir.filePath(mp::vault::filename_for(info.kernel_location));
+    const auto initrd_path = image_dir.filePath(mp::vault::filename_for(info.initrd_location));
+    mp::vault::DeleteOnException kernel_file{kernel_path};
+    mp::vault::DeleteOnException initrd_file{initrd_path};
+
+    const auto sources = mp::combined(monitor, image_download ? LaunchProgress::IMAGE : LaunchProgress::KERNEL,
+                                      {image_download ? image_progress_weight : 0, 1, 1});
+
+    // Once one download fails, the others stop at their next progress, rather than run to the end for nothing
+    std::atomic_bool failed{false};
+    auto download = [this, &failed](const QUrl& url, const QString& path, int download_type,
+                                    const ProgressMonitor& source) {
+        try
+        {
+            url_downloader->download_to(url, path, -1, download_type, [&failed, &source](int type, int progress) {
+                return !failed && source(type, progress);
+            });
+            source(download_type, 100);
+        }
+        catch (...)
+        {
+            failed = true;
+            throw;
+        }
+    };
 
-    image.kernel_path = image_dir.filePath(mp::vault::filename_for(info.kernel_location));
-    image.initrd_path = image_dir.filePath(mp::vault::filename_for(info.initrd_location));
-    mp::vault::DeleteOnException kernel_file{image.kernel_path};
-    mp::vault::DeleteOnException initrd_file{image.initrd_path};
-    url_downloader->download_to(info.kernel_location, image.kernel_path, -1, LaunchProgress::KERNEL, monitor);
-    url_downloader->download_to(info.initrd_location, image.initrd_path, -1, LaunchProgress::INITRD, monitor);
+    auto kernel = std::async(std::launch::async, download, info.kernel_location, kernel_path, LaunchProgress::KERNEL,
+                             sources[1]);
+    auto initrd = std::async(std::launch::async, download, info.initrd_location, initrd_path, LaunchProgress::INITRD,
+                             sources[2]);
 
-    return image;
+    if (image_download)
+    {
+        try
+        {
+            image_download(sources[0]);
+        }
+        catch (...)
+        {
+            failed = true;
+            throw; // the downloads above are waited for as their futures go
+        }
+    }
+
+    kernel.get();
+    initrd.get();
+
+    image.kernel_path = kernel_path;
+    image.initrd_path = initrd_path;
+}
+
+// Images that were cached for booting through the firmware get the kernel and initrd they lack, into their directory,
+// without holding up other fetches meanwhile
+mp::VMImage mp::DefaultVMImageVault::add_kernel_and_initrd(const std::string& id, const VMImageInfo& info,
+                                                           std::unique_lock<std::mutex>& lock,
+                                                           const ProgressMonitor& monitor)
+{
+    const auto image = prepared_image_records.at(id).image;
+    if (info.kernel_location.isEmpty() || info.initrd_location.isEmpty())
+        return image;
+
+    auto with_kernel{image};
+    lock.unlock();
+    try
+    {
+        fetch_kernel_and_initrd(info, with_kernel, QFileInfo{image.image_path}.absoluteDir(), monitor);
+    }
+    catch (...)
+    {
+        lock.lock();
+        throw;
+    }
+    lock.lock();
+
+    auto entry = prepared_image_records.find(id);
+    if (entry == prepared_image_records.end() || entry->second.image.image_path != image.image_path)
+        throw std::runtime_error("the image changed while fetching its kernel");
+
+    entry->second.image.kernel_path = with_kernel.kernel_path;
+    entry->second.image.initrd_path = with_kernel.initrd_path;
+    persist_image_record(id);
+
+    return entry->second.image;
 }
 
 mp::optional<QFuture<mp::VMImage>> mp::DefaultVMImageVault::get_image_future(const std::string& id)
@@ -691,17 +1464,25 @@ mp::VMImage mp::DefaultVMImageVault::finalize_image_records(const Query& query,
 
     if (!query.name.empty())
     {
-        vm_image = image_instance_from(query.name, prepared_image);
+        vm_image = make_overlay_image ? overlay_instance_from(query, prepared_image)
+                                      : image_instance_from(query, prepared_image);
         instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
+        persist_instance_record(query.name);
     }
 
     // Do not save the instance name for prepared images
     Query prepared_query{query};
     prepared_query.name = "";
-    prepared_image_records[id] = {prepared_image, prepared_query, std::chrono::system_clock::now()};
 
-    persist_instance_records();
-    persist_image_records();
+    // The image is only hashed again if it changed
+    auto& prepared_record = prepared_image_records[id];
+    const auto same_image = prepared_record.image.image_path == prepared_image.image_path;
+    const auto content_hash = same_image ? prepared_record.content_hash : QString{};
+    const auto image_facts = same_image ? prepared_record.image_facts : nullopt;
+    const auto compressed = same_image && prepared_record.compressed;
+    prepared_record = {prepared_image, prepared_query, std::chrono::system_clock::now(),
+                       content_hash,   image_facts,    compressed};
+    persist_image_record(id);
 
     return vm_image;
 }
@@ -723,16 +1504,102 @@ void persist_records(const T& records, const QString& path)
         auto key = QString::fromStdString(record.first);
         json_records.insert(key, record_to_json(record.second));
     }
-    mp::write_json(json_records, path);
+
+    // Replaced whole or not at all, for a crash never to leave records half written
+    const auto raw_json = QJsonDocument{json_records}.toJson();
+    QSaveFile db_file{path};
+    if (!MP_FILEOPS.open(db_file, QIODevice::WriteOnly) || MP_FILEOPS.write(db_file, raw_json) != raw_json.size() ||
+        !MP_FILEOPS.commit(db_file))
+        throw std::runtime_error(fmt::format("Cannot write {}: {}", path, db_file.errorString()));
+}
+
+// Every change is journaled before any compaction, so that a journal that outlives one (a crash between rewriting
+// the db and removing the journal) holds nothing the db does not: replaying it over the db leaves that as it is
+template <typename T>
+void persist_record(const T& records, const std::vector<std::string>& keys, const QString& path, int& journal_entries)
+{
+    QByteArray entries; // appended in one write, however many changed together
+    for (const auto& key : keys)
+    {
+        QJsonObject entry;
+        entry.insert("key", QString::fromStdString(key));
+
+        auto it = records.find(key);
+        if (it != records.end())
+            entry.insert("record", record_to_json(it->second));
+
+        entries += QJsonDocument{entry}.toJson(QJsonDocument::Compact) + '\n';
+    }
+
+    QFile journal_file{journal_path_for(path)};
+    const auto journaled = MP_FILEOPS.open(journal_file, QIODevice::WriteOnly | QIODevice::Append) &&
+                           MP_FILEOPS.write(journal_file, entries) == entries.size();
+    if (!journaled)
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot append to {}, rewriting {} instead: {}", journal_file.fileName(), path,
+                             journal_file.errorString()));
+    journal_file.close();
+
+    // Rewriting everything once per as many changes as there are records keeps the cost per change flat
+    journal_entries += static_cast<int>(keys.size());
+    if (journaled && journal_entries <= std::max(min_journal_entries_to_compact, static_cast<int>(records.size())))
+        return;
+
+    persist_records(records, path);
+    if (QFile::remove(journal_path_for(path)) || !QFile::exists(journal_path_for(path)))
+        journal_entries = 0;
 }
 } // namespace
 
-void mp::DefaultVMImageVault::persist_instance_records()
+void mp::DefaultVMImageVault::persist_instance_record(const std::string& name)
+{
+    persist_instance_records({name});
+}
+
+void mp::DefaultVMImageVault::persist_instance_records(const std::vector<std::string>& names)
 {
-    persist_records(instance_image_records, data_dir.filePath(instance_db_name));
+    persist_record(instance_image_records, names, data_dir.filePath(instance_db_name), instance_journal_entries);
 }
 
-void mp::DefaultVMImageVault::persist_image_records()
+void mp::DefaultVMImageVault::persist_image_record(const std::string& id)
 {
-    persist_records(prepared_image_records, cache_dir.filePath(image_db_name));
+    persist_record(prepared_image_records, {id}, cache_dir.filePath(image_db_name), image_journal_entries);
+}
+
+QString mp::DefaultVMImageVault::image_hash_for(const Path& image_path)
+{
+    const QFileInfo image_info{image_path};
+    {
+        std::lock_guard<decltype(digests_mutex)> lock{digests_mutex};
+        auto it = image_digests.find(image_info.absoluteFilePath().toStdString());
+        if (it != image_digests.end() && it->second.size == image_info.size() &&
+            it->second.last_modified_msecs == image_info.lastModified().toMSecsSinceEpoch())
+            return it->second.sha256;
+    }
+
+    const auto image_hash = mp::vault::compute_image_hash(image_path);
+    remember_image_hash(image_path, image_hash);
+
+    return image_hash;
+}
+
+void mp::DefaultVMImageVault::remember_image_hash(const Path& image_path, const QString& image_hash)
+{
+    const QFileInfo image_info{image_path};
+
+    std::lock_guard<decltype(digests_mutex)> lock{digests_mutex};
+    image_digests[image_info.absoluteFilePath().toStdString()] = {
+        image_info.size(), image_info.lastModified().toMSecsSinceEpoch(), image_hash};
+
+    // Digests of files that are gone are dropped along the way
+    for (auto it = image_digests.begin(); it != image_digests.end();)
+    {
+        if (QFileInfo::exists(QString::fromStdString(it->first)))
+            ++it;
+        else
+            it = image_digests.erase(it);
+    }
+
+    if (cache_dir.exists() || QDir{}.mkpath(cache_dir.absolutePath()))
+        persist_image_digests(image_digests, cache_dir.filePath(image_digests_db_name));
 }
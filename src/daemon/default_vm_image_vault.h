@@ -28,6 +28,8 @@
 #include <QDir>
 #include <QFuture>
 
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -35,55 +37,113 @@ namespace multipass
 {
 class URLDownloader;
 class VMImageHost;
+// What qemu-img says of a prepared image, which holds for as long as the vault keeps that image
+struct ImageFacts
+{
+    QString format;
+    qint64 virtual_size;
+    qint64 cluster_size; // 0 for formats without clusters
+};
 class VaultRecord
 {
 public:
     multipass::VMImage image;
     multipass::Query query;
     std::chrono::system_clock::time_point last_accessed;
+    QString content_hash{};             // set once the image is stored in the content-addressed store
+    optional<ImageFacts> image_facts{}; // set the first time the image's size is asked for
+    bool compressed{false};
+};
+// The SHA-256 of an image file, valid for as long as the file keeps its size and modification time
+struct ImageDigest
+{
+    qint64 size;
+    qint64 last_modified_msecs;
+    QString sha256;
 };
 class DefaultVMImageVault final : public BaseVMImageVault
 {
 public:
+    // Creates an instance image in output_dir that is backed by the given prepared image and returns its path
+    using OverlayAction = std::function<Path(const Path& backing_image_path, const QDir& output_dir)>;
+    // Writes a compressed copy of a prepared image, which instances then use just like the original
+    using CompressAction = std::function<void(const Path& image_path, const Path& compressed_path)>;
+    // Writes a compressed copy of an instance image that holds what its backing image does, and needs it no more
+    using FlattenAction =
+        std::function<void(const Path& image_path, const Path& backing_image_path, const Path& flat_path)>;
+
     DefaultVMImageVault(std::vector<VMImageHost*> image_host, URLDownloader* downloader, multipass::Path cache_dir_path,
-                        multipass::Path data_dir_path, multipass::days days_to_expire);
+                        multipass::Path data_dir_path, multipass::days days_to_expire,
+                        OverlayAction make_overlay_image = nullptr, CompressAction compress_image = nullptr,
+                        FlattenAction flatten_image = nullptr);
     ~DefaultVMImageVault();
 
     VMImage fetch_image(const FetchType& fetch_type, const Query& query, const PrepareAction& prepare,
                         const ProgressMonitor& monitor) override;
     void remove(const std::string& name) override;
+    void remove_all(const std::vector<std::string>& names) override;
+    VMImage clone_instance_image(const std::string& source_name, const std::string& destination_name) override;
+    VMImageInfo bake_instance_image(const std::string& instance_name, const std::string& image_name) override;
     bool has_record_for(const std::string& name) override;
     void prune_expired_images() override;
+    void maintain_images() override;
     void update_images(const FetchType& fetch_type, const PrepareAction& prepare,
                        const ProgressMonitor& monitor) override;
+    void prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries, const PrepareAction& prepare,
+                         const ProgressMonitor& monitor) override;
     MemorySize minimum_image_size_for(const std::string& id) override;
 
 private:
-    VMImage image_instance_from(const std::string& name, const VMImage& prepared_image);
+    class ProgressFanOut;
+
+    QString instance_dir_for(const Query& query);
+    VMImage image_instance_from(const Query& query, const VMImage& prepared_image);
+    VMImage overlay_instance_from(const Query& query, const VMImage& prepared_image);
     VMImage download_and_prepare_source_image(const VMImageInfo& info, optional<VMImage>& existing_source_image,
                                               const QDir& image_dir, const FetchType& fetch_type,
                                               const PrepareAction& prepare, const ProgressMonitor& monitor);
-    QString extract_image_from(const std::string& instance_name, const VMImage& source_image,
-                               const ProgressMonitor& monitor);
-    VMImage fetch_kernel_and_initrd(const VMImageInfo& info, const VMImage& source_image, const QDir& image_dir,
-                                    const ProgressMonitor& monitor);
+    QString download_and_extract_image(const VMImageInfo& info, const QString& image_path,
+                                       const ProgressMonitor& monitor);
+    QString extract_image_from(const Query& query, const VMImage& source_image, const ProgressMonitor& monitor);
+    QString download_image(const VMImageInfo& info, const QString& image_path, const ProgressMonitor& monitor);
+    void fetch_kernel_and_initrd(const VMImageInfo& info, VMImage& image, const QDir& image_dir,
+                                 const ProgressMonitor& monitor,
+                                 const std::function<void(const ProgressMonitor&)>& image_download = nullptr);
+    VMImage add_kernel_and_initrd(const std::string& id, const VMImageInfo& info, std::unique_lock<std::mutex>& lock,
+                                  const ProgressMonitor& monitor);
     optional<QFuture<VMImage>> get_image_future(const std::string& id);
     VMImage finalize_image_records(const Query& query, const VMImage& prepared_image, const std::string& id);
     VMImageInfo get_kernel_query_info(const std::string& name);
-    void persist_image_records();
-    void persist_instance_records();
+    void deduplicate_prepared_images();
+    void compress_prepared_images();
+    void persist_image_record(const std::string& id);
+    void persist_instance_record(const std::string& name);
+    void persist_instance_records(const std::vector<std::string>& names);
+    QString image_hash_for(const Path& image_path);
+    void remember_image_hash(const Path& image_path, const QString& image_hash);
 
     URLDownloader* const url_downloader;
     const QDir cache_dir;
     const QDir data_dir;
     const QDir instances_dir;
+    const QString pool_instances_subdir; // where instances go within a storage pool, apart from other backends'
     const QDir images_dir;
+    const QDir store_dir;
+    const QDir baked_dir;
     const days days_to_expire;
+    const OverlayAction make_overlay_image;
+    const CompressAction compress_image;
+    const FlattenAction flatten_image;
     std::mutex fetch_mutex;
 
+    int image_journal_entries;
+    int instance_journal_entries;
     std::unordered_map<std::string, VaultRecord> prepared_image_records;
     std::unordered_map<std::string, VaultRecord> instance_image_records;
     std::unordered_map<std::string, QFuture<VMImage>> in_progress_image_fetches;
+    std::unordered_map<std::string, std::shared_ptr<ProgressFanOut>> in_progress_monitors;
+    std::mutex digests_mutex;
+    std::unordered_map<std::string, ImageDigest> image_digests;
 };
 }
 #endif // MULTIPASS_DEFAULT_VM_IMAGE_VAULT_H
@@ -25,29 +25,38 @@ namespace mpl = multipass::logging;
 
 namespace
 {
-void write_shutdown_message(mp::optional<mp::SSHSession>& ssh_session, const std::chrono::minutes& time_left,
-                            const std::string& name)
+constexpr auto cancelled_message = "The system shutdown has been cancelled";
+
+std::string shutdown_message(const std::chrono::minutes& time_left, const std::string& name)
 {
-    if (ssh_session)
-    {
-        if (time_left > std::chrono::milliseconds::zero())
-        {
-            ssh_session->exec(
-                fmt::format("wall \"The system is going down for poweroff in {} minute{}, use 'multipass stop "
-                            "--cancel {}' to cancel the shutdown.\"",
-                            time_left.count(), time_left > std::chrono::minutes(1) ? "s" : "", name));
-        }
-        else
-        {
-            ssh_session->exec(fmt::format("wall The system is going down for poweroff now"));
-        }
-    }
+    if (time_left > std::chrono::milliseconds::zero())
+        return fmt::format("The system is going down for poweroff in {} minute{}, use 'multipass stop --cancel {}' to "
+                           "cancel the shutdown.",
+                           time_left.count(), time_left > std::chrono::minutes(1) ? "s" : "", name);
+
+    return "The system is going down for poweroff now";
+}
+
+std::string wall_command(const std::string& message)
+{
+    return fmt::format("wall \"{}\"", message);
 }
 } // namespace
 
 mp::DelayedShutdownTimer::DelayedShutdownTimer(VirtualMachine* virtual_machine, mp::optional<SSHSession>&& session,
                                                const StopMounts& stop_mounts)
-    : virtual_machine{virtual_machine}, ssh_session{std::move(session)}, stop_mounts{stop_mounts}
+    : virtual_machine{virtual_machine},
+      ssh_session{std::move(session)},
+      shutdown{[stop_mounts](VirtualMachine& vm) {
+          stop_mounts(vm.vm_name);
+          vm.shutdown();
+      }}
+{
+}
+
+mp::DelayedShutdownTimer::DelayedShutdownTimer(VirtualMachine* virtual_machine, const Notify& notify,
+                                               const Shutdown& shutdown)
+    : virtual_machine{virtual_machine}, notify{notify}, shutdown{shutdown}
 {
 }
 
@@ -60,7 +69,11 @@ mp::DelayedShutdownTimer::~DelayedShutdownTimer()
             if (ssh_session)
             {
                 // exit_code() is here to make sure the command finishes before continuing in the dtor
-                ssh_session->exec("wall The system shutdown has been cancelled").exit_code();
+                ssh_session->exec(wall_command(cancelled_message)).exit_code();
+            }
+            else if (notify)
+            {
+                notify(cancelled_message);
             }
             mpl::log(mpl::Level::info, virtual_machine->vm_name, fmt::format("Cancelling delayed shutdown"));
             virtual_machine->state = VirtualMachine::State::running;
@@ -86,8 +99,7 @@ void mp::DelayedShutdownTimer::start(const std::chrono::milliseconds delay)
                  fmt::format("Shutdown request delayed for {} minute{}",
                              std::chrono::duration_cast<std::chrono::minutes>(delay).count(),
                              delay > std::chrono::minutes(1) ? "s" : ""));
-        write_shutdown_message(ssh_session, std::chrono::duration_cast<std::chrono::minutes>(delay),
-                               virtual_machine->vm_name);
+        tell_users(std::chrono::duration_cast<std::chrono::minutes>(delay));
 
         time_remaining = delay;
         std::chrono::minutes time_elapsed{1};
@@ -97,8 +109,7 @@ void mp::DelayedShutdownTimer::start(const std::chrono::milliseconds delay)
             if (time_remaining <= std::chrono::minutes(5) ||
                 time_remaining % std::chrono::minutes(5) == std::chrono::minutes::zero())
             {
-                write_shutdown_message(ssh_session, std::chrono::duration_cast<std::chrono::minutes>(time_remaining),
-                                       virtual_machine->vm_name);
+                tell_users(std::chrono::duration_cast<std::chrono::minutes>(time_remaining));
             }
 
             if (time_elapsed >= delay)
@@ -118,7 +129,7 @@ void mp::DelayedShutdownTimer::start(const std::chrono::milliseconds delay)
     }
     else
     {
-        write_shutdown_message(ssh_session, std::chrono::minutes::zero(), virtual_machine->vm_name);
+        tell_users(std::chrono::minutes::zero());
         shutdown_instance();
     }
 }
@@ -130,7 +141,15 @@ std::chrono::seconds mp::DelayedShutdownTimer::get_time_remaining()
 
 void mp::DelayedShutdownTimer::shutdown_instance()
 {
-    stop_mounts(virtual_machine->vm_name);
-    virtual_machine->shutdown();
+    shutdown(*virtual_machine);
     emit finished();
 }
+
+void mp::DelayedShutdownTimer::tell_users(const std::chrono::minutes& time_left)
+{
+    const auto message = shutdown_message(time_left, virtual_machine->vm_name);
+    if (ssh_session)
+        ssh_session->exec(wall_command(message));
+    else if (notify)
+        notify(message);
+}
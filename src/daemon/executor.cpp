@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "executor.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "executor";
+} // namespace
+
+mp::Executor::Executor(std::string name, int max_threads) : executor_name{std::move(name)}
+{
+    pool.setMaxThreadCount(max_threads);
+}
+
+mp::Executor::~Executor()
+{
+    pool.waitForDone();
+}
+
+mp::Executor::Load mp::Executor::load() const
+{
+    return {running.load(), queued.load(), pool.maxThreadCount()};
+}
+
+const std::string& mp::Executor::name() const
+{
+    return executor_name;
+}
+
+void mp::Executor::enqueue()
+{
+    const auto waiting = ++queued;
+    const auto busy = running.load();
+    if (busy + waiting > pool.maxThreadCount())
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("{}: all {} threads busy, {} task(s) queued", executor_name, pool.maxThreadCount(),
+                             busy + waiting - pool.maxThreadCount()));
+}
+
+mp::Executor::Running::Running(Executor& executor) : executor{executor}
+{
+    --executor.queued;
+    ++executor.running;
+}
+
+mp::Executor::Running::~Running()
+{
+    --executor.running;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_EXECUTOR_H
+#define MULTIPASS_EXECUTOR_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/tracing.h>
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace multipass
+{
+/**
+ * A thread pool of its own for one kind of work, so that work which blocks on instances for minutes cannot starve
+ * other kinds of work, and which keeps count of what it runs and what waits for a thread.
+ *
+ * Work handed to an executor must not wait on other work in the same executor, or a full pool deadlocks.
+ */
+class Executor : private DisabledCopyMove
+{
+public:
+    struct Load
+    {
+        int running;
+        int queued;
+        int max_threads;
+    };
+
+    Executor(std::string name, int max_threads);
+    ~Executor(); // waits for whatever was handed over already
+
+    // Like QtConcurrent::run, on this executor and under the current tracing context
+    template <typename Callable>
+    auto run(Callable callable) -> QFuture<decltype(callable())>;
+
+    // Like run, but the future hands any exception over to whoever waits on it
+    template <typename Callable>
+    auto run_task(Callable callable) -> std::future<decltype(callable())>;
+
+    Load load() const;
+    const std::string& name() const;
+
+private:
+    class Running
+    {
+    public:
+        explicit Running(Executor& executor);
+        ~Running();
+
+    private:
+        Executor& executor;
+    };
+
+    void enqueue();
+
+    const std::string executor_name;
+    std::atomic<int> running{0};
+    std::atomic<int> queued{0};
+    QThreadPool pool; // last, so that it is done with the work before the counters go
+};
+} // namespace multipass
+
+template <typename Callable>
+auto multipass::Executor::run(Callable callable) -> QFuture<decltype(callable())>
+{
+    enqueue();
+    return QtConcurrent::run(&pool, [this, callable, context = tracing::current()]() mutable {
+        Running running{*this};
+        tracing::ContextScope scope{context}; // spans in the work fall under whatever handed it over
+        return callable();
+    });
+}
+
+template <typename Callable>
+auto multipass::Executor::run_task(Callable callable) -> std::future<decltype(callable())>
+{
+    auto task = std::make_shared<std::packaged_task<decltype(callable())()>>(std::move(callable));
+    auto future = task->get_future();
+    run([task] { (*task)(); });
+
+    return future;
+}
+
+#endif // MULTIPASS_EXECUTOR_H
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "federation.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/utils.h>
+
+#include <grpc/grpc_security_constants.h>
+
+#include <QtConcurrent/QtConcurrent>
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "federation";
+constexpr auto relayed_key = "multipass-federation-relay";
+constexpr auto query_timeout = std::chrono::seconds{10};
+constexpr auto load_family = "multipass_host_memory_overcommit_ratio"; // as the metrics of each member have it
+
+std::mutex relayed_mutex;
+std::unordered_set<const void*> relayed_calls;
+
+std::shared_ptr<grpc::Channel> channel_to(const std::string& address, const mp::CertProvider& cert_provider)
+{
+    grpc::SslCredentialsOptions opts;
+    opts.server_certificate_request = GRPC_SSL_REQUEST_SERVER_CERTIFICATE_BUT_DONT_VERIFY;
+    opts.pem_cert_chain = cert_provider.PEM_certificate();
+    opts.pem_private_key = cert_provider.PEM_signing_key();
+
+    return grpc::CreateChannel(address, grpc::SslCredentials(opts));
+}
+
+template <typename Reply>
+grpc::Status read_all(grpc::ClientReader<Reply>& reader, Reply& merged)
+{
+    Reply reply;
+    while (reader.Read(&reply))
+        merged.MergeFrom(reply);
+
+    return reader.Finish();
+}
+
+mp::optional<double> load_from(const std::string& openmetrics)
+{
+    const auto prefix = fmt::format("{} ", load_family);
+
+    std::istringstream lines{openmetrics};
+    for (std::string line; std::getline(lines, line);)
+    {
+        if (line.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        bool ok = false;
+        auto load = QString::fromStdString(line.substr(prefix.size())).toDouble(&ok);
+        return ok ? mp::make_optional(load) : mp::nullopt;
+    }
+
+    return mp::nullopt;
+}
+} // namespace
+
+std::map<std::string, std::string> mp::parse_federation_members(const QString& definitions)
+{
+    std::map<std::string, std::string> members;
+    for (const auto& definition : definitions.split(',', QString::SkipEmptyParts))
+    {
+        const auto separator = definition.indexOf('=');
+        const auto label = definition.left(separator).trimmed().toStdString();
+        const auto address = definition.mid(separator + 1).trimmed();
+
+        if (separator < 0 || !mp::utils::valid_hostname(label) || address.isEmpty() || address.contains(' '))
+            throw std::invalid_argument{fmt::format("Bad federation member \"{}\", need label=address", definition)};
+        if (!members.emplace(label, address.toStdString()).second)
+            throw std::invalid_argument{fmt::format("Federation member \"{}\" is defined twice", label)};
+    }
+
+    return members;
+}
+
+mp::Federation::Federation(std::map<std::string, std::string> members, const CertProvider& cert_provider)
+{
+    for (const auto& [label, address] : members)
+    {
+        stubs.emplace(label, Rpc::NewStub(channel_to(address, cert_provider)));
+        mpl::log(mpl::Level::info, category, fmt::format("Speaking for {} at {}", label, address));
+    }
+}
+
+bool mp::Federation::empty() const
+{
+    return stubs.empty();
+}
+
+std::vector<std::string> mp::Federation::labels() const
+{
+    std::vector<std::string> ret;
+    for (const auto& stub : stubs)
+        ret.push_back(stub.first);
+
+    return ret;
+}
+
+auto mp::Federation::split(const std::string& name) const -> optional<std::pair<std::string, std::string>>
+{
+    const auto separator = name.rfind('@');
+    if (separator == std::string::npos || !stubs.count(name.substr(separator + 1)))
+        return nullopt;
+
+    return std::make_pair(name.substr(0, separator), name.substr(separator + 1));
+}
+
+std::string mp::Federation::qualified(const std::string& name, const std::string& label)
+{
+    return fmt::format("{}@{}", name, label);
+}
+
+template <typename Request, typename Reply>
+auto mp::Federation::call(Method<Request, Reply> method, const std::map<std::string, Request>& requests)
+    -> Answers<Reply>
+{
+    std::vector<std::pair<std::string, QFuture<Answer<Reply>>>> pending;
+    for (auto it = requests.cbegin(); it != requests.cend(); ++it)
+    {
+        auto stub = stubs.find(it->first);
+        if (stub == stubs.end())
+            continue;
+
+        pending.emplace_back(it->first, QtConcurrent::run([stub = stub->second.get(), method, request = it->second] {
+                                 grpc::ClientContext context;
+                                 context.AddMetadata(relayed_key, "1");
+                                 context.set_deadline(std::chrono::system_clock::now() + query_timeout);
+
+                                 Answer<Reply> answer;
+                                 auto reader = (stub->*method)(&context, request);
+                                 answer.status = read_all(*reader, answer.reply);
+                                 return answer;
+                             }));
+    }
+
+    Answers<Reply> answers;
+    for (auto& [label, future] : pending)
+    {
+        auto answer = future.result();
+        if (!answer.status.ok())
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("{} did not answer: {}", label, answer.status.error_message()));
+
+        answers.emplace(label, std::move(answer));
+    }
+
+    return answers;
+}
+
+auto mp::Federation::list(const ListRequest& request) -> Answers<ListReply>
+{
+    std::map<std::string, ListRequest> requests;
+    for (const auto& stub : stubs)
+        requests.emplace(stub.first, request);
+
+    return call(&Rpc::Stub::list, requests);
+}
+
+auto mp::Federation::find(const FindRequest& request) -> Answers<FindReply>
+{
+    std::map<std::string, FindRequest> requests;
+    for (const auto& stub : stubs)
+        requests.emplace(stub.first, request);
+
+    return call(&Rpc::Stub::find, requests);
+}
+
+auto mp::Federation::info(const std::map<std::string, InfoRequest>& requests) -> Answers<InfoReply>
+{
+    return call(&Rpc::Stub::info, requests);
+}
+
+auto mp::Federation::less_loaded_than(double local_load) -> optional<std::string>
+{
+    std::map<std::string, MetricsRequest> requests;
+    for (const auto& stub : stubs)
+        requests.emplace(stub.first, MetricsRequest{});
+
+    optional<std::string> least_loaded;
+    auto least_load = local_load;
+    for (const auto& [label, answer] : call(&Rpc::Stub::metrics, requests))
+    {
+        if (!answer.status.ok())
+            continue;
+
+        if (auto load = load_from(answer.reply.openmetrics()); load && *load < least_load)
+        {
+            least_loaded = label;
+            least_load = *load;
+        }
+    }
+
+    return least_loaded;
+}
+
+grpc::Status mp::Federation::launch(const std::string& label, const LaunchRequest& request, const Relay& relay)
+{
+    auto stub = stubs.find(label);
+    if (stub == stubs.end())
+        return grpc::Status{grpc::StatusCode::NOT_FOUND, fmt::format("There is no federation member \"{}\"", label)};
+
+    // No deadline: launches take as long as the image takes to download and the instance to boot
+    grpc::ClientContext context;
+    context.AddMetadata(relayed_key, "1");
+
+    auto reader = stub->second->launch(&context, request);
+    LaunchReply reply;
+    while (reader->Read(&reply))
+        if (!relay(reply))
+            context.TryCancel(); // the client went away
+
+    return reader->Finish();
+}
+
+bool mp::Federation::asked_by_member(const grpc::ServerContext* context)
+{
+    return context->client_metadata().count(relayed_key) > 0;
+}
+
+void mp::Federation::mark_relayed(const void* call, bool relayed)
+{
+    std::lock_guard<std::mutex> lock{relayed_mutex};
+    if (relayed)
+        relayed_calls.insert(call);
+    else
+        relayed_calls.erase(call);
+}
+
+bool mp::Federation::is_relayed(const void* call)
+{
+    std::lock_guard<std::mutex> lock{relayed_mutex};
+    return relayed_calls.count(call) > 0;
+}
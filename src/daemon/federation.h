@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_FEDERATION_H
+#define MULTIPASS_FEDERATION_H
+
+#include <multipass/cert_provider.h>
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <QString>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Members are other daemons that this one speaks for, defined in the local.federation setting as in
+ * "ws2=ws2.lan:50051,ws3=10.0.0.3:50051". Throws std::invalid_argument when @p definitions is not a list of unique
+ * labels with addresses.
+ */
+std::map<std::string, std::string> parse_federation_members(const QString& definitions);
+
+/**
+ * Fans list, find, info and launch out to the members of a federation, as a client of theirs, so that a client of this
+ * daemon sees the instances of all of them. Their instances are named "<name>@<label>" here. Members need to trust the
+ * certificate of this daemon, as they would that of any client.
+ */
+class Federation : private DisabledCopyMove
+{
+public:
+    template <typename Reply>
+    struct Answer
+    {
+        grpc::Status status;
+        Reply reply; // all that came, merged
+    };
+    template <typename Reply>
+    using Answers = std::map<std::string, Answer<Reply>>; // by label
+    using Relay = std::function<bool(LaunchReply&)>;
+
+    Federation(std::map<std::string, std::string> members, const CertProvider& cert_provider);
+
+    bool empty() const;
+    std::vector<std::string> labels() const;
+
+    // The instance name and member label in "<name>@<label>", or nothing when the name is not of a member's instance
+    optional<std::pair<std::string, std::string>> split(const std::string& name) const;
+    static std::string qualified(const std::string& name, const std::string& label);
+
+    // All members are asked at once, and given a few seconds to answer
+    Answers<ListReply> list(const ListRequest& request);
+    Answers<FindReply> find(const FindRequest& request);
+    Answers<InfoReply> info(const std::map<std::string, InfoRequest>& requests); // by label
+
+    // The member with the least memory taken by running instances, relative to what it has, if it has less than
+    // @p local_load. Members that cannot tell are passed over.
+    optional<std::string> less_loaded_than(double local_load);
+
+    // Launches on the member labelled @p label, handing its replies over to @p relay as they come
+    grpc::Status launch(const std::string& label, const LaunchRequest& request, const Relay& relay);
+
+    // Calls that come from another daemon of a federation are answered for this daemon alone, so that members that
+    // speak for each other do not keep passing the same question around. DaemonRpc marks them by their writer.
+    static bool asked_by_member(const grpc::ServerContext* context);
+    static void mark_relayed(const void* call, bool relayed);
+    static bool is_relayed(const void* call);
+
+private:
+    template <typename Request, typename Reply>
+    using Method = std::unique_ptr<grpc::ClientReader<Reply>> (Rpc::Stub::*)(grpc::ClientContext*, const Request&);
+
+    template <typename Request, typename Reply>
+    Answers<Reply> call(Method<Request, Reply> method, const std::map<std::string, Request>& requests);
+
+    std::map<std::string, std::unique_ptr<Rpc::Stub>> stubs; // by label
+};
+} // namespace multipass
+
+#endif // MULTIPASS_FEDERATION_H
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "http_cache.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/url_downloader.h>
+
+#include <scope_guard.hpp>
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QSaveFile>
+#include <QTcpSocket>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto max_request_size = 8 * 1024;
+constexpr auto chunk_size = 1024 * 1024;
+
+void serve_file(QTcpSocket* socket, const QByteArray& method, const QString& file_name)
+{
+    auto file = new QFile{file_name, socket};
+    if (!file->open(QIODevice::ReadOnly))
+        return mp::http::respond(socket, 404, "Not Found");
+
+    socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " +
+                  QByteArray::number(file->size()) + "\r\nConnection: close\r\n\r\n");
+    if (method == "HEAD")
+        return socket->disconnectFromHost();
+
+    // The file goes out a chunk at a time as the socket drains, so that large files are never read into memory
+    auto pump = [socket, file] {
+        if (!file->isOpen())
+            return;
+
+        while (socket->bytesToWrite() < chunk_size && !file->atEnd())
+            socket->write(file->read(chunk_size));
+
+        if (file->atEnd())
+        {
+            file->close();
+            socket->disconnectFromHost(); // after what is pending has been written
+        }
+    };
+
+    QObject::connect(socket, &QTcpSocket::bytesWritten, socket, pump);
+    pump();
+}
+} // namespace
+
+void mp::http::serve_requests(QTcpServer& server, RequestHandler handler)
+{
+    QObject::connect(&server, &QTcpServer::newConnection, &server, [&server, handler = std::move(handler)] {
+        while (auto socket = server.nextPendingConnection())
+        {
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+
+            auto request = std::make_shared<QByteArray>();
+            auto answering = std::make_shared<bool>(false);
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, request, answering, handler] {
+                if (*answering) // one request per connection is all that fetches need
+                {
+                    socket->readAll();
+                    return;
+                }
+
+                request->append(socket->readAll());
+                if (!request->contains("\r\n\r\n"))
+                {
+                    if (request->size() > max_request_size)
+                    {
+                        *answering = true;
+                        respond(socket, 431, "Request Header Fields Too Large");
+                    }
+                    return;
+                }
+
+                *answering = true;
+                const auto request_line = request->left(request->indexOf("\r\n")).split(' ');
+
+                if (request_line.size() != 3 || (request_line[0] != "GET" && request_line[0] != "HEAD"))
+                    return respond(socket, 400, "Bad Request");
+
+                handler(socket, request_line[0], QUrl::fromPercentEncoding(request_line[1]));
+            });
+        }
+    });
+}
+
+void mp::http::respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& body)
+{
+    socket->write("HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n" +
+                  (body.isEmpty() ? QByteArray{} : QByteArray{"Content-Type: text/plain\r\n"}) +
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+mp::HttpCache::HttpCache(URLDownloader* downloader, const Path& cache_dir, std::chrono::seconds time_to_live,
+                         qint64 max_size, const char* category, const char* served)
+    : url_downloader{downloader},
+      cache_dir{cache_dir},
+      time_to_live{time_to_live},
+      max_size{max_size},
+      category{category},
+      served{served}
+{
+    http::serve_requests(server, [this](auto socket, const auto& method, const auto& target) {
+        on_request(socket, method, target);
+    });
+}
+
+void mp::HttpCache::listen(const QHostAddress& address, quint16 port)
+{
+    if (!server.listen(address, port))
+        throw std::runtime_error(fmt::format("Cannot serve the {} on {}:{}: {}", category, address.toString(), port,
+                                             server.errorString()));
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Serving {} on {}:{}", served, address.toString(), server.serverPort()));
+}
+
+quint16 mp::HttpCache::port() const
+{
+    return server.serverPort();
+}
+
+void mp::HttpCache::on_request(QTcpSocket* socket, const QByteArray& method, const QString& target)
+{
+    auto source = source_of(target);
+    if (source)
+        source->path = QDir::cleanPath(source->path);
+
+    if (!source || source->path.isEmpty() || source->path.startsWith("..") || source->path.startsWith('/'))
+        return http::respond(socket, 404, "Not Found");
+
+    auto watcher = new QFutureWatcher<QString>{socket};
+    QObject::connect(watcher, &QFutureWatcher<QString>::finished, socket, [socket, watcher, method] {
+        const auto file_name = watcher->result();
+        if (file_name.isEmpty())
+            http::respond(socket, 502, "Bad Gateway");
+        else
+            serve_file(socket, method, file_name);
+    });
+
+    watcher->setFuture(QtConcurrent::run([this, source = *source] {
+        try
+        {
+            return fill(source);
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Cannot fetch {}: {}", source.url.toString(), e.what()));
+            return QString{};
+        }
+    }));
+}
+
+QString mp::HttpCache::fill(const Source& source)
+{
+    const auto file_name = cache_dir.filePath(source.path);
+    auto fill_mutex = fill_mutex_for(file_name);
+    auto release = sg::make_scope_guard([this, &file_name, &fill_mutex]() noexcept {
+        release_fill_mutex(file_name, fill_mutex);
+    });
+    std::lock_guard<std::mutex> lock{*fill_mutex};
+
+    const QFileInfo info{file_name};
+    const auto age = std::chrono::seconds{info.lastModified().secsTo(QDateTime::currentDateTime())};
+    if (info.exists() && (!source.changes || age < time_to_live))
+        return file_name;
+
+    QDir{}.mkpath(info.absolutePath());
+
+    try
+    {
+        if (source.changes) // small, as what changes goes: indexes, metadata...
+        {
+            const auto data = url_downloader->download(source.url);
+
+            QSaveFile file{file_name};
+            if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+                throw std::runtime_error(fmt::format("cannot write {}", file_name));
+        }
+        else
+        {
+            const auto part_name = file_name + ".part";
+            url_downloader->download_to(source.url, part_name, -1, LaunchProgress::IMAGE,
+                                        [](int, int) { return true; });
+
+            QFile::remove(file_name);
+            if (!QFile::rename(part_name, file_name))
+                throw std::runtime_error(fmt::format("cannot move {} into place", part_name));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        if (!info.exists())
+            throw;
+
+        // Stale beats none
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot refresh {}, serving what was there: {}", source.url.toString(), e.what()));
+        return file_name;
+    }
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Fetched {}", source.url.toString()));
+    evict_beyond_max_size(file_name);
+
+    return file_name;
+}
+
+std::shared_ptr<std::mutex> mp::HttpCache::fill_mutex_for(const QString& file_name)
+{
+    std::lock_guard<std::mutex> lock{fills_mutex};
+
+    auto& mutex = fills[file_name.toStdString()];
+    if (!mutex)
+        mutex = std::make_shared<std::mutex>();
+
+    return mutex;
+}
+
+// Files that nobody else is filling need no mutex kept for them, or the map would grow with every file ever served
+void mp::HttpCache::release_fill_mutex(const QString& file_name, std::shared_ptr<std::mutex>& mutex)
+{
+    std::lock_guard<std::mutex> lock{fills_mutex};
+
+    mutex.reset();
+    auto it = fills.find(file_name.toStdString());
+    if (it != fills.end() && it->second.use_count() == 1)
+        fills.erase(it);
+}
+
+void mp::HttpCache::evict_beyond_max_size(const QString& keep)
+{
+    std::lock_guard<std::mutex> lock{eviction_mutex};
+
+    std::vector<QFileInfo> files;
+    qint64 size = 0;
+    QDirIterator it{cache_dir.path(), QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext())
+    {
+        it.next();
+        if (it.fileName().endsWith(".part")) // still being fetched
+            continue;
+
+        files.push_back(it.fileInfo());
+        size += it.fileInfo().size();
+    }
+
+    std::sort(files.begin(), files.end(),
+              [](const auto& a, const auto& b) { return a.lastRead() < b.lastRead(); });
+
+    const auto kept = QFileInfo{keep}.absoluteFilePath();
+    for (auto file = files.cbegin(); size > max_size && file != files.cend(); ++file)
+    {
+        if (file->absoluteFilePath() == kept || !QFile::remove(file->filePath()))
+            continue;
+
+        size -= file->size();
+        mpl::log(mpl::Level::debug, category, fmt::format("Evicted {}", file->filePath()));
+    }
+}
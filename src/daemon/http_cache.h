@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_HTTP_CACHE_H
+#define MULTIPASS_HTTP_CACHE_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+#include <multipass/path.h>
+
+#include <QDir>
+#include <QHostAddress>
+#include <QString>
+#include <QTcpServer>
+#include <QUrl>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class QTcpSocket;
+
+namespace multipass
+{
+class URLDownloader;
+
+namespace http
+{
+using RequestHandler = std::function<void(QTcpSocket* socket, const QByteArray& method, const QString& target)>;
+
+// Reads the one GET or HEAD request off each connection that @p server accepts and hands it to @p handler, with the
+// target percent-decoded; what does not parse as one is answered here
+void serve_requests(QTcpServer& server, RequestHandler handler);
+
+// Answers with @p status and, when there is one, a plain-text @p body, then closes the connection
+void respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& body = {});
+} // namespace http
+
+/**
+ * An HTTP server that hands over its copies of files from elsewhere, fetching each the first time it is asked for.
+ * What a request stands for is up to subclasses; files that do not change are kept for good, the others are fetched
+ * again once they are older than their time to live. Once the cache directory grows beyond its maximum size, the files
+ * read least recently go first.
+ */
+class HttpCache : private DisabledCopyMove
+{
+public:
+    virtual ~HttpCache() = default;
+
+    // Throws std::runtime_error when the address and port cannot be had; port 0 picks any free port
+    void listen(const QHostAddress& address, quint16 port);
+    quint16 port() const;
+
+protected:
+    struct Source
+    {
+        QUrl url;     // where the file comes from
+        QString path; // where it is kept, relative to the cache directory
+        bool changes; // whether it can change at that url
+    };
+
+    HttpCache(URLDownloader* downloader, const Path& cache_dir, std::chrono::seconds time_to_live, qint64 max_size,
+              const char* category, const char* served);
+
+    // What the target of a request stands for; nullopt for what is not served
+    virtual optional<Source> source_of(const QString& target) const = 0;
+
+private:
+    void on_request(QTcpSocket* socket, const QByteArray& method, const QString& target);
+    QString fill(const Source& source); // returns the cached file, after fetching it if need be; throws on failure
+    std::shared_ptr<std::mutex> fill_mutex_for(const QString& file_name);
+    void release_fill_mutex(const QString& file_name, std::shared_ptr<std::mutex>& mutex);
+    void evict_beyond_max_size(const QString& keep);
+
+    URLDownloader* const url_downloader;
+    const QDir cache_dir;
+    const std::chrono::seconds time_to_live;
+    const qint64 max_size;
+    const char* const category;
+    const char* const served;
+    QTcpServer server;
+    std::mutex fills_mutex;
+    std::unordered_map<std::string, std::shared_ptr<std::mutex>> fills; // one fill of each file at a time
+    std::mutex eviction_mutex;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_HTTP_CACHE_H
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "idle_policy.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto max_idle_load = 0.1;           // over the last minute; what background services add up to at most
+constexpr auto max_idle_network_rate = 1024ll; // bytes per second, enough for DHCP, NTP and the like
+
+struct Reading
+{
+    double load;
+    long long network_bytes;
+    int sessions;
+};
+
+// Nullopt when the metrics leave out any of it, which does not tell an instance is idle
+mp::optional<Reading> read(const mp::InstanceMetrics& metrics)
+{
+    try
+    {
+        return Reading{std::stod(metrics.load), std::stoll(metrics.network_bytes), std::stoi(metrics.sessions)};
+    }
+    catch (const std::logic_error&) // missing or garbled
+    {
+        return mp::nullopt;
+    }
+}
+} // namespace
+
+mp::IdlePolicy::IdlePolicy(std::chrono::minutes idle_period) : idle_period{idle_period}
+{
+}
+
+bool mp::IdlePolicy::enabled() const
+{
+    return idle_period > std::chrono::minutes::zero();
+}
+
+bool mp::IdlePolicy::observe(const std::string& name, const InstanceMetrics& metrics, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    const auto reading = read(metrics);
+    if (!reading)
+    {
+        activity.erase(name);
+        return false;
+    }
+
+    auto it = activity.find(name);
+    if (it == activity.end()) // traffic needs two readings to tell
+    {
+        activity.emplace(name, Activity{now, now, reading->network_bytes});
+        return false;
+    }
+
+    auto& seen = it->second;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - seen.observed_at).count();
+    const auto traffic = reading->network_bytes - seen.network_bytes; // negative across reboots, which are not idle
+
+    const auto idle = reading->load < max_idle_load && reading->sessions == 0 && traffic >= 0 &&
+                      traffic <= max_idle_network_rate * std::max<long long>(elapsed, 1);
+    if (!idle)
+        seen.idle_since = now;
+
+    seen.observed_at = now;
+    seen.network_bytes = reading->network_bytes;
+
+    return now - seen.idle_since >= idle_period;
+}
+
+void mp::IdlePolicy::forget(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    activity.erase(name);
+}
+
+void mp::IdlePolicy::mark_suspended(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    activity.erase(name);
+    suspended.insert(name);
+}
+
+bool mp::IdlePolicy::take_suspended(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return suspended.erase(name) > 0;
+}
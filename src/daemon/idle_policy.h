@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_IDLE_POLICY_H
+#define MULTIPASS_IDLE_POLICY_H
+
+#include "instance_metrics.h"
+
+#include <multipass/disabled_copy_move.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace multipass
+{
+/**
+ * Tells which running instances have sat idle for long enough to be suspended: next to no load or network traffic,
+ * and nobody logged in, in every round of metrics over the idle period. It remembers the instances that were
+ * suspended on its account, for reaching for them to resume them.
+ */
+class IdlePolicy : private DisabledCopyMove
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit IdlePolicy(std::chrono::minutes idle_period); // 0 disables the policy
+
+    bool enabled() const;
+
+    // Takes in fresh metrics of a running instance; true when it has now been idle for the whole period
+    bool observe(const std::string& name, const InstanceMetrics& metrics, Clock::time_point now = Clock::now());
+    void forget(const std::string& name); // starts over the next time it runs
+
+    void mark_suspended(const std::string& name);
+    bool take_suspended(const std::string& name); // whether the policy suspended it, which it then forgets
+
+private:
+    struct Activity
+    {
+        Clock::time_point idle_since;
+        Clock::time_point observed_at;
+        long long network_bytes;
+    };
+
+    const std::chrono::minutes idle_period;
+    std::mutex mutex;
+    std::unordered_map<std::string, Activity> activity;
+    std::unordered_set<std::string> suspended;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_IDLE_POLICY_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "image_mirror.h"
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+namespace
+{
+// Metadata says what the current images are, so it gets stale; images live at versioned paths and do not
+bool is_metadata(const QString& path)
+{
+    return path.startsWith("streams/");
+}
+} // namespace
+
+mp::ImageMirror::ImageMirror(Remotes remotes, URLDownloader* downloader, const Path& cache_dir,
+                             std::chrono::seconds metadata_time_to_live, qint64 max_size)
+    : HttpCache{downloader, cache_dir, metadata_time_to_live, max_size, "image mirror", "images to peers"},
+      remotes{std::move(remotes)}
+{
+}
+
+auto mp::ImageMirror::source_of(const QString& target) const -> optional<Source>
+{
+    const auto path = QDir::cleanPath(target).mid(1); // drop the leading slash
+    const auto remote_name = path.section('/', 0, 0).toStdString();
+    const auto file_path = path.section('/', 1);
+
+    auto remote = std::find_if(remotes.cbegin(), remotes.cend(),
+                               [&remote_name](const auto& element) { return element.first == remote_name; });
+    if (!target.startsWith('/') || path.startsWith("..") || file_path.isEmpty() || remote == remotes.cend())
+        return nullopt;
+
+    return Source{QUrl{QString::fromStdString(remote->second) + file_path}, path, is_metadata(file_path)};
+}
+
+mp::ImageMirror::Remotes mp::remotes_mirrored_at(const QString& mirror_url, const ImageMirror::Remotes& remotes)
+{
+    const auto base_url = mirror_url.endsWith('/') ? mirror_url : mirror_url + '/';
+
+    ImageMirror::Remotes mirrored;
+    for (const auto& remote : remotes)
+        mirrored.emplace_back(remote.first, (base_url + QString::fromStdString(remote.first) + '/').toStdString());
+
+    return mirrored;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_IMAGE_MIRROR_H
+#define MULTIPASS_IMAGE_MIRROR_H
+
+#include "http_cache.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Serves simplestreams remotes to peer daemons over HTTP, so that a fleet on a LAN downloads each image from the
+ * internet once. A peer asks for `<remote name>/<path>` and the mirror hands over its copy of `<remote url><path>`,
+ * fetching it the first time it is asked for. Images live at versioned paths, so they are kept for good; the streams
+ * metadata is fetched again once it is older than its time to live.
+ */
+class ImageMirror : public HttpCache
+{
+public:
+    using Remotes = std::vector<std::pair<std::string, std::string>>;
+
+    ImageMirror(Remotes remotes, URLDownloader* downloader, const Path& cache_dir,
+                std::chrono::seconds metadata_time_to_live, qint64 max_size);
+
+protected:
+    optional<Source> source_of(const QString& target) const override;
+
+private:
+    const Remotes remotes;
+};
+
+// The remotes as served by the mirror at mirror_url, under the same names
+ImageMirror::Remotes remotes_mirrored_at(const QString& mirror_url, const ImageMirror::Remotes& remotes);
+} // namespace multipass
+
+#endif // MULTIPASS_IMAGE_MIRROR_H
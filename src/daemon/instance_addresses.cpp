@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_addresses.h"
+
+#include <multipass/ip_address.h>
+#include <multipass/virtual_machine.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+namespace
+{
+bool is_ipv4_valid(const std::string& ipv4)
+{
+    try
+    {
+        (mp::IPAddress(ipv4));
+    }
+    catch (std::invalid_argument&)
+    {
+        return false;
+    }
+
+    return true;
+}
+} // namespace
+
+std::vector<std::string> mp::ordered_ipv4(const std::string& management_ip, const std::vector<std::string>& all_ipv4)
+{
+    std::vector<std::string> ret;
+
+    if (is_ipv4_valid(management_ip))
+        ret.push_back(management_ip);
+    else if (all_ipv4.empty())
+        ret.push_back("N/A");
+
+    for (const auto& extra_ipv4 : all_ipv4)
+        if (extra_ipv4 != management_ip)
+            ret.push_back(extra_ipv4);
+
+    return ret;
+}
+
+std::vector<std::string> mp::known_ipv4_for(VirtualMachine& vm)
+{
+    return ordered_ipv4(vm.management_ipv4(), vm.known_ipv4());
+}
+
+bool mp::InstanceAddresses::update(const std::string& name, const std::vector<std::string>& ipv4)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto [it, inserted] = addresses.emplace(name, ipv4);
+    if (inserted)
+        return true;
+
+    if (it->second == ipv4)
+        return false;
+
+    it->second = ipv4;
+    return true;
+}
+
+auto mp::InstanceAddresses::known(const std::string& name) const -> optional<std::vector<std::string>>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto it = addresses.find(name);
+    if (it == addresses.end())
+        return nullopt;
+
+    return it->second;
+}
+
+void mp::InstanceAddresses::forget(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    addresses.erase(name);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_ADDRESSES_H
+#define MULTIPASS_INSTANCE_ADDRESSES_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+class VirtualMachine;
+
+// The management address first, then the others, or "N/A" when there are none
+std::vector<std::string> ordered_ipv4(const std::string& management_ip, const std::vector<std::string>& all_ipv4);
+
+// The same, from what the host can tell without going into the instance
+std::vector<std::string> known_ipv4_for(VirtualMachine& vm);
+
+/**
+ * The addresses last found for each instance, which the daemon keeps current from leases, neighbour tables and guest
+ * agents, so that listing instances need not wait on them.
+ */
+class InstanceAddresses : private DisabledCopyMove
+{
+public:
+    bool update(const std::string& name, const std::vector<std::string>& ipv4); // returns whether they changed
+    optional<std::vector<std::string>> known(const std::string& name) const;
+    void forget(const std::string& name);
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::string>> addresses;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_INSTANCE_ADDRESSES_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_events.h"
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+mp::InstanceEvents::Subscription::Subscription(InstanceEvents& events, std::vector<std::string> instances)
+    : events{events}, instances{std::make_move_iterator(instances.begin()), std::make_move_iterator(instances.end())}
+{
+}
+
+mp::InstanceEvents::Subscription::~Subscription()
+{
+    std::lock_guard<std::mutex> lock{events.mutex};
+    auto& subscriptions = events.subscriptions;
+    subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), this), subscriptions.end());
+}
+
+auto mp::InstanceEvents::Subscription::next(std::chrono::milliseconds timeout) -> optional<std::vector<WatchReply>>
+{
+    std::unique_lock<std::mutex> lock{events.mutex};
+    cv.wait_for(lock, timeout, [this] { return ended || !queue.empty(); });
+
+    if (ended)
+        return nullopt;
+
+    std::vector<WatchReply> ret{std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end())};
+    queue.clear();
+
+    return ret;
+}
+
+bool mp::InstanceEvents::Subscription::overflowed() const
+{
+    std::lock_guard<std::mutex> lock{events.mutex};
+    return dropped_events;
+}
+
+bool mp::InstanceEvents::Subscription::wants(const std::string& instance) const
+{
+    return instances.empty() || instances.count(instance);
+}
+
+auto mp::InstanceEvents::subscribe(std::vector<std::string> instances) -> std::unique_ptr<Subscription>
+{
+    std::unique_ptr<Subscription> subscription{new Subscription{*this, std::move(instances)}};
+
+    std::lock_guard<std::mutex> lock{mutex};
+    subscription->ended = closed;
+    subscriptions.push_back(subscription.get());
+
+    return subscription;
+}
+
+void mp::InstanceEvents::publish(const WatchReply& event)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto subscription : subscriptions)
+    {
+        if (subscription->ended || !subscription->wants(event.instance_name()))
+            continue;
+
+        if (subscription->queue.size() < max_queued_events)
+            subscription->queue.push_back(event);
+        else
+            subscription->ended = subscription->dropped_events = true;
+
+        subscription->cv.notify_all();
+    }
+}
+
+void mp::InstanceEvents::close()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    closed = true;
+    for (auto subscription : subscriptions)
+    {
+        subscription->ended = true;
+        subscription->cv.notify_all();
+    }
+}
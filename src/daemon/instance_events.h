@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_EVENTS_H
+#define MULTIPASS_INSTANCE_EVENTS_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Hands what happens to instances (state transitions, mount changes, new addresses) over to whoever watches them.
+ *
+ * Publishing only queues the event, so that those reporting them, like instances changing state on their own threads,
+ * never wait on a watcher's connection. Each watcher drains its own queue.
+ */
+class InstanceEvents : private DisabledCopyMove
+{
+public:
+    class Subscription : private DisabledCopyMove
+    {
+    public:
+        ~Subscription();
+
+        // The events so far, waiting up to the timeout for one; nullopt once the subscription has ended
+        optional<std::vector<WatchReply>> next(std::chrono::milliseconds timeout);
+        bool overflowed() const;
+
+    private:
+        friend class InstanceEvents;
+        Subscription(InstanceEvents& events, std::vector<std::string> instances);
+
+        bool wants(const std::string& instance) const;
+
+        InstanceEvents& events;
+        const std::unordered_set<std::string> instances; // any when empty
+        std::deque<WatchReply> queue;
+        bool ended{false};
+        bool dropped_events{false};
+        std::condition_variable cv;
+    };
+
+    static constexpr std::size_t max_queued_events = 1000; // per subscription, beyond which the watcher is dropped
+
+    // Events about the named instances, or about any instance when none are named
+    std::unique_ptr<Subscription> subscribe(std::vector<std::string> instances);
+    void publish(const WatchReply& event);
+    void close(); // ends every subscription, as the daemon goes away
+
+private:
+    std::mutex mutex;
+    std::vector<Subscription*> subscriptions;
+    bool closed{false};
+};
+} // namespace multipass
+
+#endif // MULTIPASS_INSTANCE_EVENTS_H
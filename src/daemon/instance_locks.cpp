@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_locks.h"
+
+#include <multipass/format.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+mp::InstanceLocks::Guard::Guard(InstanceLocks* locks, std::vector<std::string> names)
+    : locks{locks}, names{std::move(names)}
+{
+}
+
+mp::InstanceLocks::Guard::Guard(Guard&& other) noexcept : locks{other.locks}, names{std::move(other.names)}
+{
+    other.locks = nullptr;
+}
+
+mp::InstanceLocks::Guard::~Guard()
+{
+    if (locks)
+        locks->release(names);
+}
+
+mp::InstanceLocks::Guard mp::InstanceLocks::claim(const std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (const auto& name : names)
+        if (claimed.count(name))
+            throw std::runtime_error(fmt::format("instance \"{}\" is busy with another operation", name));
+
+    std::vector<std::string> newly_claimed;
+    for (const auto& name : names)
+        if (claimed.insert(name).second) // the same name may be requested twice
+            newly_claimed.push_back(name);
+
+    return Guard{this, std::move(newly_claimed)};
+}
+
+bool mp::InstanceLocks::is_claimed(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return claimed.count(name) != 0;
+}
+
+void mp::InstanceLocks::release(const std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& name : names)
+        claimed.erase(name);
+}
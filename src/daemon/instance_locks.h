@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_LOCKS_H
+#define MULTIPASS_INSTANCE_LOCKS_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Keeps track of the instances that have an operation under way, so that operations on different instances can run
+ * side by side while those on the same instance are refused.
+ *
+ * Unlike a std::mutex, a claim may be released from a thread other than the one that took it, which lets the main
+ * thread claim instances for work that finishes on a worker.
+ */
+class InstanceLocks : private DisabledCopyMove
+{
+public:
+    class Guard
+    {
+    public:
+        Guard(Guard&& other) noexcept;
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+    private:
+        friend class InstanceLocks;
+        Guard(InstanceLocks* locks, std::vector<std::string> names);
+
+        InstanceLocks* locks;
+        std::vector<std::string> names;
+    };
+
+    InstanceLocks() = default;
+
+    // Claims all the named instances or none of them; throws std::runtime_error when one is already claimed
+    Guard claim(const std::vector<std::string>& names);
+    bool is_claimed(const std::string& name) const;
+
+private:
+    void release(const std::vector<std::string>& names);
+
+    mutable std::mutex mutex;
+    std::unordered_set<std::string> claimed;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_INSTANCE_LOCKS_H
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_metrics.h"
+#include "instance_addresses.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/ssh/ssh_session_pool.h>
+#include <multipass/utils.h>
+#include <multipass/virtual_machine.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "metrics";
+
+// One "<key> <value>" line per metric, so that a failing part leaves the others in place
+constexpr auto metrics_cmd =
+    "echo \"load $(cut -d ' ' -f1-3 /proc/loadavg)\"; "
+    "free -b | awk '$1 == \"Mem:\" { print \"memory_total \" $2; print \"memory_usage \" $3 }'; "
+    "df --output=used,size -B1 \"$(awk '$2 == \"/\" { print $1; exit }' /proc/mounts)\" | "
+    "awk 'NR == 2 { print \"disk_usage \" $1; print \"disk_total \" $2 }'; "
+    "echo \"release $(lsb_release -ds 2>/dev/null)\"; "
+    "echo \"network_bytes $(awk -F '[: ]+' 'NR > 2 && $2 != \"lo\" { sum += $3 + $11 } END { print sum + 0 }' "
+    "/proc/net/dev)\"; "
+    "echo \"sessions $(pgrep -c -f '^sshd: [^ ]+@pts')\"";
+
+constexpr auto min_balloon_target = 512ll << 20; // bytes; below this, guests struggle to even boot
+constexpr auto balloon_hysteresis = 10;           // percent of the allocation worth moving the balloon for
+
+constexpr auto guest_agent_timeout = std::chrono::seconds(2);
+
+mp::InstanceMetrics metrics_from(const mp::GuestMetrics& guest_metrics)
+{
+    auto to_string = [](const mp::optional<long long>& bytes) { return bytes ? std::to_string(*bytes) : ""; };
+
+    mp::InstanceMetrics ret;
+    if (const auto& load = guest_metrics.load)
+        ret.load = fmt::format("{:.2f} {:.2f} {:.2f}", (*load)[0], (*load)[1], (*load)[2]);
+    ret.memory_usage = to_string(guest_metrics.memory_usage);
+    ret.memory_total = to_string(guest_metrics.memory_total);
+    ret.disk_usage = to_string(guest_metrics.disk_usage);
+    ret.disk_total = to_string(guest_metrics.disk_total);
+    ret.current_release = guest_metrics.current_release;
+
+    return ret;
+}
+
+// The string-valued metrics that the remote command reports
+constexpr std::string mp::InstanceMetrics::*reported[] = {
+    &mp::InstanceMetrics::load,       &mp::InstanceMetrics::memory_usage, &mp::InstanceMetrics::memory_total,
+    &mp::InstanceMetrics::disk_usage, &mp::InstanceMetrics::disk_total,   &mp::InstanceMetrics::current_release};
+
+// What tells whether anyone uses the instance, which only the remote command reports
+constexpr std::string mp::InstanceMetrics::*activity[] = {&mp::InstanceMetrics::network_bytes,
+                                                          &mp::InstanceMetrics::sessions};
+
+bool is_complete(const mp::InstanceMetrics& metrics, bool with_activity)
+{
+    auto missing = [&metrics](auto field) { return (metrics.*field).empty(); };
+    return std::none_of(std::begin(reported), std::end(reported), missing) &&
+           (!with_activity || std::none_of(std::begin(activity), std::end(activity), missing));
+}
+
+void fill_in(mp::InstanceMetrics& metrics, const mp::InstanceMetrics& more)
+{
+    for (const auto field : reported)
+        if ((metrics.*field).empty())
+            metrics.*field = more.*field;
+    for (const auto field : activity)
+        if ((metrics.*field).empty())
+            metrics.*field = more.*field;
+}
+} // namespace
+
+mp::InstanceMetrics mp::parse_instance_metrics(const std::string& output)
+{
+    static constexpr std::pair<std::string_view, std::string InstanceMetrics::*> fields[] = {
+        {"load", &InstanceMetrics::load},
+        {"memory_usage", &InstanceMetrics::memory_usage},
+        {"memory_total", &InstanceMetrics::memory_total},
+        {"disk_usage", &InstanceMetrics::disk_usage},
+        {"disk_total", &InstanceMetrics::disk_total},
+        {"release", &InstanceMetrics::current_release},
+        {"network_bytes", &InstanceMetrics::network_bytes},
+        {"sessions", &InstanceMetrics::sessions}};
+
+    // Only the values that are kept get copied out of the output
+    InstanceMetrics ret;
+    for (auto line : mp::utils::split_view(output, "\n"))
+    {
+        auto separator = line.find(' ');
+        if (separator == std::string_view::npos)
+            continue;
+
+        auto name = line.substr(0, separator);
+        auto it = std::find_if(std::begin(fields), std::end(fields), [name](const auto& f) { return f.first == name; });
+        if (it != std::end(fields))
+        {
+            std::string value{line.substr(separator + 1)};
+            ret.*(it->second) = mp::utils::trim_end(value);
+        }
+    }
+
+    return ret;
+}
+
+mp::optional<mp::MemorySize> mp::balloon_target_for(const InstanceMetrics& metrics, const MemorySize& allocated)
+{
+    long long used, total;
+    try
+    {
+        used = std::stoll(metrics.memory_usage);
+        total = std::stoll(metrics.memory_total); // what the guest currently has, balloon aside
+    }
+    catch (const std::logic_error&) // missing or garbled
+    {
+        return nullopt;
+    }
+
+    const auto wanted = std::min(std::max(2 * used, min_balloon_target), allocated.in_bytes());
+    if (std::abs(wanted - total) * 100 < allocated.in_bytes() * balloon_hysteresis)
+        return nullopt;
+
+    return MemorySize{fmt::format("{}b", wanted)};
+}
+
+std::vector<std::string> mp::ipv4_for(VirtualMachine& vm, const SSHKeyProvider& key_provider)
+{
+    return ordered_ipv4(vm.management_ipv4(), vm.get_all_ipv4(key_provider));
+}
+
+mp::InstanceMetricsCollector::InstanceMetricsCollector(const SSHKeyProvider& key_provider,
+                                                       SSHSessionPool& ssh_sessions)
+    : key_provider{key_provider}, ssh_sessions{ssh_sessions}
+{
+}
+
+mp::InstanceMetrics mp::InstanceMetricsCollector::collect(VirtualMachine& vm, const std::string& username,
+                                                          bool with_activity)
+{
+    // The guest agent, where there is one, answers without a shell in the guest, or even sshd
+    const auto from_agent = vm.guest_metrics(guest_agent_timeout);
+    auto ret = from_agent ? metrics_from(*from_agent) : InstanceMetrics{};
+
+    if (!is_complete(ret, with_activity))
+    {
+        try
+        {
+            fill_in(ret, collect_over_ssh(vm, username));
+        }
+        catch (const std::exception& e)
+        {
+            if (!from_agent)
+                throw;
+
+            mpl::log(mpl::Level::debug, category,
+                     fmt::format("cannot complete the metrics of \"{}\": {}", vm.vm_name, e.what()));
+        }
+    }
+
+    // The backends have their own way of finding addresses, which may or may not involve the instance
+    ret.ipv4 = from_agent && !from_agent->ipv4.empty() ? ordered_ipv4(vm.management_ipv4(), from_agent->ipv4)
+                                                        : ipv4_for(vm, key_provider);
+    ret.collected_at = QDateTime::currentDateTimeUtc();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    return metrics[vm.vm_name] = ret;
+}
+
+mp::InstanceMetrics mp::InstanceMetricsCollector::collect_over_ssh(VirtualMachine& vm, const std::string& username)
+{
+    auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(), username);
+
+    mpl::log(mpl::Level::debug, category, fmt::format("collecting metrics of \"{}\"", vm.vm_name));
+    auto proc = session->exec(metrics_cmd);
+    if (auto exit_code = proc.exit_code(); exit_code != 0) // what made it out is still good
+    {
+        auto error_msg = proc.read_std_error();
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("metrics command of \"{}\" exited with code {}: {}", vm.vm_name, exit_code,
+                             mp::utils::trim_end(error_msg)));
+    }
+
+    return parse_instance_metrics(proc.read_std_output());
+}
+
+mp::optional<mp::InstanceMetrics> mp::InstanceMetricsCollector::cached(const std::string& name,
+                                                                        std::chrono::seconds max_age) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto it = metrics.find(name);
+    if (it == metrics.end() || it->second.collected_at.secsTo(QDateTime::currentDateTimeUtc()) > max_age.count())
+        return nullopt;
+
+    return it->second;
+}
+
+void mp::InstanceMetricsCollector::forget(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    metrics.erase(name);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_METRICS_H
+#define MULTIPASS_INSTANCE_METRICS_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/memory_size.h>
+#include <multipass/optional.h>
+
+#include <QDateTime>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+class SSHKeyProvider;
+class SSHSessionPool;
+class VirtualMachine;
+
+struct InstanceMetrics
+{
+    std::string load;
+    std::string memory_usage;
+    std::string memory_total;
+    std::string disk_usage;
+    std::string disk_total;
+    std::string current_release;
+    std::string network_bytes; // received and sent since boot, over all but the loopback interface
+    std::string sessions;      // interactive logins over SSH
+    std::vector<std::string> ipv4;
+    QDateTime collected_at; // UTC
+};
+
+// Reads the output of the remote metrics command; missing entries are left empty
+InstanceMetrics parse_instance_metrics(const std::string& output);
+
+// How much memory to leave an instance with, given what it uses out of what it has been allocated: twice what it uses,
+// within the allocation. Nullopt when its balloon is not worth moving, or when the metrics do not tell.
+optional<MemorySize> balloon_target_for(const InstanceMetrics& metrics, const MemorySize& allocated);
+
+// The management address first, then the others the backend knows of, or "N/A" when there are none
+std::vector<std::string> ipv4_for(VirtualMachine& vm, const SSHKeyProvider& key_provider);
+
+/**
+ * Gathers the runtime metrics that `info` shows, from the guest agent when the backend has one to ask, and otherwise
+ * (or for what the agent cannot tell) in a single remote command per instance. It keeps the last result of each
+ * instance around so that queries need not wait on the instances.
+ */
+class InstanceMetricsCollector : private DisabledCopyMove
+{
+public:
+    InstanceMetricsCollector(const SSHKeyProvider& key_provider, SSHSessionPool& ssh_sessions);
+
+    // Throws when the instance is unreachable. Activity (network and sessions) is only gathered when asked for, as
+    // the guest agent cannot tell it and it would otherwise take a remote command on every refresh.
+    InstanceMetrics collect(VirtualMachine& vm, const std::string& username, bool with_activity = false);
+    optional<InstanceMetrics> cached(const std::string& name, std::chrono::seconds max_age) const;
+    void forget(const std::string& name);
+
+private:
+    InstanceMetrics collect_over_ssh(VirtualMachine& vm, const std::string& username);
+
+    const SSHKeyProvider& key_provider;
+    SSHSessionPool& ssh_sessions;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, InstanceMetrics> metrics;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_INSTANCE_METRICS_H
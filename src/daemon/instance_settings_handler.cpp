@@ -23,6 +23,8 @@
 #include <QRegularExpression>
 #include <QStringList>
 
+#include <array>
+
 namespace mp = multipass;
 
 namespace
@@ -30,6 +32,41 @@ namespace
 constexpr auto cpus_suffix = "cpus";
 constexpr auto mem_suffix = "memory";
 constexpr auto disk_suffix = "disk";
+constexpr auto hugepages_suffix = "hugepages";
+constexpr auto numa_node_suffix = "numa-node";
+constexpr auto cpu_pinning_suffix = "cpu-pinning";
+constexpr auto io_pinning_suffix = "io-pinning";
+constexpr auto disk_cache_suffix = "disk-cache";
+constexpr auto disk_aio_suffix = "disk-aio";
+constexpr auto disk_iothread_suffix = "disk-iothread";
+constexpr auto disk_queues_suffix = "disk-queues";
+constexpr auto disk_detect_zeroes_suffix = "disk-detect-zeroes";
+constexpr auto net_vhost_suffix = "net-vhost";
+constexpr auto net_queues_suffix = "net-queues";
+constexpr auto net_ring_size_suffix = "net-ring-size";
+constexpr auto cpu_weight_suffix = "cpu-weight";
+constexpr auto io_weight_suffix = "io-weight";
+constexpr auto memory_high_suffix = "memory-high";
+constexpr auto cpu_max_suffix = "cpu-max";
+constexpr auto all_suffixes = std::array{cpus_suffix,
+                                         mem_suffix,
+                                         disk_suffix,
+                                         hugepages_suffix,
+                                         numa_node_suffix,
+                                         cpu_pinning_suffix,
+                                         io_pinning_suffix,
+                                         disk_cache_suffix,
+                                         disk_aio_suffix,
+                                         disk_iothread_suffix,
+                                         disk_queues_suffix,
+                                         disk_detect_zeroes_suffix,
+                                         net_vhost_suffix,
+                                         net_queues_suffix,
+                                         net_ring_size_suffix,
+                                         cpu_weight_suffix,
+                                         io_weight_suffix,
+                                         memory_high_suffix,
+                                         cpu_max_suffix};
 
 enum class Operation
 {
@@ -46,7 +83,11 @@ QRegularExpression make_key_regex()
 {
     const auto instance_pattern = QStringLiteral("(?<instance>.+)");
     const auto prop_template = QStringLiteral("(?<property>%1)");
-    const auto either_prop = QStringList{cpus_suffix, mem_suffix, disk_suffix}.join("|");
+    QStringList props;
+    for (const auto& suffix : all_suffixes)
+        props << suffix;
+
+    const auto either_prop = props.join("|");
     const auto prop_pattern = prop_template.arg(either_prop);
 
     const auto key_template = QStringLiteral(R"(%1\.%2\.%3)");
@@ -91,9 +132,23 @@ pick_instance(InstanceMap& instances, const std::string& instance_name, Operatio
     }
 }
 
-void check_state_for_update(mp::VirtualMachine& instance)
+bool is_resize_property(const QString& property)
+{
+    return property == cpus_suffix || property == mem_suffix || property == disk_suffix;
+}
+
+bool is_resource_limit_property(const std::string& property)
+{
+    return property == cpu_weight_suffix || property == io_weight_suffix || property == memory_high_suffix ||
+           property == cpu_max_suffix;
+}
+
+void check_state_for_update(mp::VirtualMachine& instance, bool resizing, bool limiting)
 {
     auto st = instance.current_state();
+    if (st == mp::VirtualMachine::State::running && (limiting || (resizing && instance.resizes_while_running())))
+        return;
+
     if (st != mp::VirtualMachine::State::stopped && st != mp::VirtualMachine::State::off)
         throw mp::InstanceSettingsException{operation_msg(Operation::Modify), instance.vm_name,
                                             "Instance must be stopped for modification"};
@@ -153,6 +208,264 @@ void update_disk(const QString& key, const QString& val, mp::VirtualMachine& ins
     }
 }
 
+bool parse_bool(const QString& key, const QString& val)
+{
+    const auto lower_val = val.toLower();
+    if (lower_val != "true" && lower_val != "false")
+        throw mp::InvalidSettingException{key, val, "Invalid value, try \"true\" or \"false\""};
+
+    return lower_val == "true";
+}
+
+QString bool_string(bool val)
+{
+    return val ? "true" : "false";
+}
+
+bool is_placement_property(const std::string& property)
+{
+    return property == hugepages_suffix || property == numa_node_suffix || property == cpu_pinning_suffix ||
+           property == io_pinning_suffix;
+}
+
+// Lists of host CPUs, like "2-5,8"
+std::vector<int> parse_cpu_list(const QString& key, const QString& val)
+{
+    std::vector<int> cpus;
+    for (const auto& item : val.split(',', QString::SkipEmptyParts))
+    {
+        const auto bounds = item.trimmed().split('-');
+        bool first_ok = false, last_ok = false;
+        const auto first = bounds.first().toInt(&first_ok);
+        const auto last = bounds.last().toInt(&last_ok);
+
+        if (bounds.size() > 2 || !first_ok || !last_ok || first < 0 || last < first)
+            throw mp::InvalidSettingException{key, val, "Need a list of host CPUs, like \"2-5,8\""};
+
+        for (auto cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+QString cpu_list_string(const std::vector<int>& cpus)
+{
+    QStringList ret;
+    for (auto cpu : cpus)
+        ret << QString::number(cpu);
+
+    return ret.join(',');
+}
+
+QString get_placement(const std::string& property, const mp::VMPlacement& placement)
+{
+    if (property == hugepages_suffix)
+        return bool_string(placement.hugepages);
+    if (property == numa_node_suffix)
+        return placement.numa_node ? QString::number(*placement.numa_node) : QString{};
+    if (property == cpu_pinning_suffix)
+        return cpu_list_string(placement.vcpu_cpus);
+
+    assert(property == io_pinning_suffix);
+    return cpu_list_string(placement.io_cpus);
+}
+
+void update_placement(const QString& key, const QString& val, const std::string& property,
+                      mp::VirtualMachine& instance, mp::VMSpecs& spec)
+{
+    auto placement = spec.placement;
+    if (property == hugepages_suffix)
+        placement.hugepages = parse_bool(key, val);
+    else if (property == numa_node_suffix)
+    {
+        bool converted_ok = false;
+        if (val.isEmpty())
+            placement.numa_node = mp::nullopt;
+        else if (auto node = val.toInt(&converted_ok); converted_ok && node >= 0)
+            placement.numa_node = node;
+        else
+            throw mp::InvalidSettingException{key, val, "Need a host NUMA node number, or nothing for any"};
+    }
+    else if (property == cpu_pinning_suffix)
+        placement.vcpu_cpus = parse_cpu_list(key, val);
+    else
+    {
+        assert(property == io_pinning_suffix);
+        placement.io_cpus = parse_cpu_list(key, val);
+    }
+
+    if (placement != spec.placement) // NOOP if equal
+    {
+        instance.update_placement(placement);
+        spec.placement = placement;
+    }
+}
+
+bool is_disk_option_property(const std::string& property)
+{
+    return property == disk_cache_suffix || property == disk_aio_suffix || property == disk_iothread_suffix ||
+           property == disk_queues_suffix || property == disk_detect_zeroes_suffix;
+}
+
+QString get_disk_option(const std::string& property, const mp::VMDiskOptions& disk_options)
+{
+    if (property == disk_cache_suffix)
+        return QString::fromStdString(disk_options.cache);
+    if (property == disk_aio_suffix)
+        return QString::fromStdString(disk_options.aio);
+    if (property == disk_iothread_suffix)
+        return bool_string(disk_options.iothread);
+    if (property == disk_queues_suffix)
+        return QString::number(disk_options.queues);
+
+    assert(property == disk_detect_zeroes_suffix);
+    return bool_string(disk_options.detect_zeroes);
+}
+
+std::string parse_choice(const QString& key, const QString& val, const QStringList& choices)
+{
+    if (!choices.contains(val))
+        throw mp::InvalidSettingException{key, val, QString("Need one of: %1").arg(choices.join(", "))};
+
+    return val.toStdString();
+}
+
+void update_disk_options(const QString& key, const QString& val, const std::string& property,
+                         mp::VirtualMachine& instance, mp::VMSpecs& spec)
+{
+    auto disk_options = spec.disk_options;
+    if (property == disk_cache_suffix)
+        disk_options.cache = parse_choice(key, val, {"none", "writeback", "writethrough"});
+    else if (property == disk_aio_suffix)
+        disk_options.aio = parse_choice(key, val, {"threads", "native", "io_uring"});
+    else if (property == disk_iothread_suffix)
+        disk_options.iothread = parse_bool(key, val);
+    else if (property == disk_queues_suffix)
+    {
+        bool converted_ok = false;
+        if (auto queues = val.toInt(&converted_ok); converted_ok && queues > 0)
+            disk_options.queues = queues;
+        else
+            throw mp::InvalidSettingException{key, val, "Need a positive number of queues"};
+    }
+    else
+    {
+        assert(property == disk_detect_zeroes_suffix);
+        disk_options.detect_zeroes = parse_bool(key, val);
+    }
+
+    if (disk_options.aio == "native" && disk_options.cache != "none") // QEMU only does native AIO on direct I/O
+        throw mp::InvalidSettingException{key, val, "Native AIO needs the disk cache to be \"none\""};
+
+    if (disk_options != spec.disk_options) // NOOP if equal
+    {
+        instance.update_disk_options(disk_options);
+        spec.disk_options = disk_options;
+    }
+}
+
+bool is_network_option_property(const std::string& property)
+{
+    return property == net_vhost_suffix || property == net_queues_suffix || property == net_ring_size_suffix;
+}
+
+QString get_network_option(const std::string& property, const mp::VMNetworkOptions& network_options)
+{
+    if (property == net_vhost_suffix)
+        return bool_string(network_options.vhost);
+    if (property == net_queues_suffix)
+        return network_options.queues ? QString::number(network_options.queues) : QStringLiteral("auto");
+
+    assert(property == net_ring_size_suffix);
+    return network_options.ring_size ? QString::number(network_options.ring_size) : QString{};
+}
+
+void update_network_options(const QString& key, const QString& val, const std::string& property,
+                            mp::VirtualMachine& instance, mp::VMSpecs& spec)
+{
+    auto network_options = spec.network_options;
+    bool converted_ok = false;
+    if (property == net_vhost_suffix)
+        network_options.vhost = parse_bool(key, val);
+    else if (property == net_queues_suffix)
+    {
+        if (val == "auto")
+            network_options.queues = 0;
+        else if (auto queues = val.toInt(&converted_ok); converted_ok && queues > 0)
+            network_options.queues = queues;
+        else
+            throw mp::InvalidSettingException{key, val,
+                                              "Need a positive number of queues, or \"auto\" for one per CPU"};
+    }
+    else
+    {
+        assert(property == net_ring_size_suffix);
+        auto ring_size = val.toInt(&converted_ok);
+        if (val.isEmpty())
+            network_options.ring_size = 0;
+        else if (converted_ok && ring_size >= 256 && ring_size <= 1024 && !(ring_size & (ring_size - 1)))
+            network_options.ring_size = ring_size;
+        else
+            throw mp::InvalidSettingException{key, val, "Need 256, 512 or 1024, or nothing for the default"};
+    }
+
+    if (network_options != spec.network_options) // NOOP if equal
+    {
+        instance.update_network_options(network_options);
+        spec.network_options = network_options;
+    }
+}
+
+QString get_resource_limit(const std::string& property, const mp::VMResourceLimits& limits)
+{
+    if (property == cpu_weight_suffix)
+        return QString::number(limits.cpu_weight);
+    if (property == io_weight_suffix)
+        return QString::number(limits.io_weight);
+    if (property == memory_high_suffix)
+        return limits.memory_high
+                   ? QString::fromStdString(mp::MemorySize{std::to_string(limits.memory_high)}.human_readable())
+                   : QString{};
+
+    assert(property == cpu_max_suffix);
+    return limits.cpu_max ? QString::number(limits.cpu_max) : QString{};
+}
+
+void update_resource_limits(const QString& key, const QString& val, const std::string& property,
+                            mp::VirtualMachine& instance, mp::VMSpecs& spec)
+{
+    auto limits = spec.resource_limits;
+    bool converted_ok = false;
+    if (property == cpu_weight_suffix || property == io_weight_suffix)
+    {
+        auto weight = val.toInt(&converted_ok);
+        if (!converted_ok || weight < 1 || weight > 10000)
+            throw mp::InvalidSettingException{key, val, "Need a weight from 1 to 10000"};
+
+        (property == cpu_weight_suffix ? limits.cpu_weight : limits.io_weight) = weight;
+    }
+    else if (property == memory_high_suffix)
+        limits.memory_high = val.isEmpty() ? 0 : get_memory_size(key, val).in_bytes();
+    else
+    {
+        assert(property == cpu_max_suffix);
+        auto percent = val.toInt(&converted_ok);
+        if (val.isEmpty())
+            limits.cpu_max = 0;
+        else if (converted_ok && percent > 0)
+            limits.cpu_max = percent;
+        else
+            throw mp::InvalidSettingException{key, val,
+                                              "Need a positive percent of one host CPU, or nothing for no cap"};
+    }
+
+    if (limits != spec.resource_limits) // NOOP if equal
+    {
+        instance.update_resource_limits(limits);
+        spec.resource_limits = limits;
+    }
+}
 } // namespace
 
 mp::InstanceSettingsException::InstanceSettingsException(const std::string& reason, const std::string& instance,
@@ -180,8 +493,9 @@ std::set<QString> mp::InstanceSettingsHandler::keys() const
 
     std::set<QString> ret;
     for (const auto& item : vm_instance_specs)
-        for (const auto& suffix : {cpus_suffix, mem_suffix, disk_suffix})
-            ret.insert(key_template.arg(item.first.c_str()).arg(suffix));
+        if (item.second.pool_profile.empty()) // pooled instances are not the user's yet
+            for (const auto& suffix : all_suffixes)
+                ret.insert(key_template.arg(item.first.c_str()).arg(suffix));
 
     return ret;
 }
@@ -196,6 +510,14 @@ QString mp::InstanceSettingsHandler::get(const QString& key) const
     if (property == mem_suffix)
         return QString::fromStdString(spec.mem_size.human_readable()); /* TODO return in bytes when --raw
                                                                           (need unmarshall capability, w/ flag) */
+    if (is_placement_property(property))
+        return get_placement(property, spec.placement);
+    if (is_disk_option_property(property))
+        return get_disk_option(property, spec.disk_options);
+    if (is_network_option_property(property))
+        return get_network_option(property, spec.network_options);
+    if (is_resource_limit_property(property))
+        return get_resource_limit(property, spec.resource_limits);
 
     assert(property == disk_suffix);
     return QString::fromStdString(spec.disk_space.human_readable()); // TODO idem
@@ -210,10 +532,18 @@ void mp::InstanceSettingsHandler::set(const QString& key, const QString& val)
 
     auto& instance = modify_instance(instance_name); // we need this first, to refuse updating deleted instances
     auto& spec = modify_spec(instance_name);
-    check_state_for_update(instance);
+    check_state_for_update(instance, is_resize_property(property), is_resource_limit_property(property));
 
     if (property == cpus_suffix)
         update_cpus(key, val, instance, spec);
+    else if (is_placement_property(property))
+        update_placement(key, val, property, instance, spec);
+    else if (is_disk_option_property(property))
+        update_disk_options(key, val, property, instance, spec);
+    else if (is_network_option_property(property))
+        update_network_options(key, val, property, instance, spec);
+    else if (is_resource_limit_property(property))
+        update_resource_limits(key, val, property, instance, spec);
     else
     {
         auto size = get_memory_size(key, val);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "launch_timings.h"
+
+#include <multipass/performance_counters.h>
+
+namespace mp = multipass;
+
+mp::LaunchTimings::Phase::Phase(LaunchTimings& timings, std::string instance, std::string phase)
+    : timings{timings},
+      instance{std::move(instance)},
+      phase{std::move(phase)},
+      start{std::chrono::steady_clock::now()},
+      span{"launch", this->phase}
+{
+}
+
+mp::LaunchTimings::Phase::~Phase()
+{
+    timings.record(instance, phase, std::chrono::steady_clock::now() - start);
+}
+
+void mp::LaunchTimings::record(const std::string& instance, const std::string& phase,
+                               std::chrono::duration<double> duration)
+{
+    MP_PERF_COUNTERS.observe("multipass_launch_phase_seconds", {{"phase", phase}}, duration);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    phases[instance].emplace_back(phase, duration);
+}
+
+auto mp::LaunchTimings::take(const std::string& instance) -> Phases
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto it = phases.find(instance);
+    if (it == phases.end())
+        return {};
+
+    auto ret = std::move(it->second);
+    phases.erase(it);
+
+    return ret;
+}
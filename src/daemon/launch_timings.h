@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_LAUNCH_TIMINGS_H
+#define MULTIPASS_LAUNCH_TIMINGS_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/tracing.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * How long each phase of launching an instance took, kept from when the phases happen until the launch replies with
+ * them. The phases of one instance may overlap, since its image is fetched while the rest of it is configured.
+ */
+class LaunchTimings : private DisabledCopyMove
+{
+public:
+    using Phases = std::vector<std::pair<std::string, std::chrono::duration<double>>>; // in the order they ended
+
+    // Times the rest of the scope it is declared in, as a phase of the instance, and traces it as a span
+    class Phase : private DisabledCopyMove
+    {
+    public:
+        Phase(LaunchTimings& timings, std::string instance, std::string phase);
+        ~Phase();
+
+    private:
+        LaunchTimings& timings;
+        const std::string instance;
+        const std::string phase;
+        const std::chrono::steady_clock::time_point start;
+        const tracing::Span span;
+    };
+
+    void record(const std::string& instance, const std::string& phase, std::chrono::duration<double> duration);
+    Phases take(const std::string& instance); // and forget them
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, Phases> phases;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_LAUNCH_TIMINGS_H
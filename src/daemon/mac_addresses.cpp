@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "mac_addresses.h"
+
+#include <multipass/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr std::uint64_t generated_prefix = 0x525400ull << 24;
+constexpr std::uint64_t nic_specific_part = 0xffffffull;
+} // namespace
+
+mp::MacAddresses::MacAddresses() : engine{std::random_device{}()}
+{
+}
+
+auto mp::MacAddresses::claim(const std::vector<std::string>& macs) -> optional<std::string>
+{
+    std::vector<std::uint64_t> numbers;
+    numbers.reserve(macs.size());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& mac : macs)
+    {
+        auto number = to_number(mac);
+        if (!number || claimed.count(*number) || std::find(numbers.begin(), numbers.end(), *number) != numbers.end())
+            return mac;
+
+        numbers.push_back(*number);
+    }
+
+    claimed.insert(numbers.begin(), numbers.end());
+    return nullopt;
+}
+
+std::string mp::MacAddresses::claim_new()
+{
+    std::uniform_int_distribution<std::uint64_t> distribution{0, nic_specific_part};
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    // Random, for addresses not to be handed out again soon after they are released, as ARP caches may remember them
+    static constexpr auto max_tries = 64;
+    for (auto i = 0; i < max_tries; ++i)
+    {
+        auto number = generated_prefix | distribution(engine);
+        if (claimed.insert(number).second)
+            return fmt::format("52:54:00:{:02x}:{:02x}:{:02x}", (number >> 16) & 0xff, (number >> 8) & 0xff,
+                               number & 0xff);
+    }
+
+    throw std::runtime_error{
+        fmt::format("Failed to generate an unique mac address after {} attempts. Number of mac addresses in use: {}",
+                    max_tries, claimed.size())};
+}
+
+void mp::MacAddresses::release(const std::vector<std::string>& macs)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& mac : macs)
+        if (auto number = to_number(mac))
+            claimed.erase(*number);
+}
+
+bool mp::MacAddresses::in_use(const std::string& mac) const
+{
+    auto number = to_number(mac);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    return number && claimed.count(*number);
+}
+
+std::size_t mp::MacAddresses::size() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return claimed.size();
+}
+
+auto mp::MacAddresses::to_number(const std::string& mac) -> optional<std::uint64_t>
+{
+    // Six pairs of colon-separated hexadecimal digits, in either case
+    if (mac.size() != 17)
+        return nullopt;
+
+    std::uint64_t number = 0;
+    for (std::size_t i = 0; i < mac.size(); ++i)
+    {
+        const auto c = mac[i];
+        if (i % 3 == 2)
+        {
+            if (c != ':')
+                return nullopt;
+
+            continue;
+        }
+
+        std::uint64_t digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return nullopt;
+
+        number = number << 4 | digit;
+    }
+
+    return number;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_MAC_ADDRESSES_H
+#define MULTIPASS_MAC_ADDRESSES_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Keeps track of the MAC addresses that instances use, as 48-bit integers rather than strings, so that checking and
+ * allocating them costs the same with thousands of instances as with a few. Those it generates are in the 52:54:00
+ * range that QEMU uses, while requested ones may be anything.
+ */
+class MacAddresses : private DisabledCopyMove
+{
+public:
+    MacAddresses();
+
+    // Claims all the addresses or none of them. Returns nullopt when it claimed them, or else the first address that
+    // was invalid, taken already or repeated.
+    optional<std::string> claim(const std::vector<std::string>& macs);
+    // Claims an address that is not in use, in the 52:54:00 range. Throws std::runtime_error when it cannot find one.
+    std::string claim_new();
+    void release(const std::vector<std::string>& macs);
+
+    bool in_use(const std::string& mac) const;
+    std::size_t size() const;
+
+    static optional<std::uint64_t> to_number(const std::string& mac);
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_set<std::uint64_t> claimed;
+    std::mt19937 engine;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_MAC_ADDRESSES_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "package_cache.h"
+
+#include <array>
+
+namespace mp = multipass;
+
+namespace
+{
+bool is_archive(const QString& host)
+{
+    static const std::array archives{QStringLiteral("archive.ubuntu.com"), QStringLiteral("security.ubuntu.com"),
+                                     QStringLiteral("ports.ubuntu.com")};
+
+    for (const auto& archive : archives)
+        if (host == archive || host.endsWith('.' + archive)) // country mirrors, like us.archive.ubuntu.com
+            return true;
+
+    return false;
+}
+
+bool changes(const QString& path)
+{
+    static const std::array packages{QStringLiteral(".deb"), QStringLiteral(".udeb"), QStringLiteral(".ddeb")};
+
+    for (const auto& extension : packages)
+        if (path.endsWith(extension))
+            return false;
+
+    return !path.contains("/by-hash/");
+}
+} // namespace
+
+mp::PackageCache::PackageCache(URLDownloader* downloader, const Path& cache_dir,
+                               std::chrono::seconds index_time_to_live, qint64 max_size)
+    : HttpCache{downloader, cache_dir, index_time_to_live, max_size, "package cache", "packages to instances"}
+{
+}
+
+// Proxies are asked for whole URLs, as in `GET http://archive.ubuntu.com/ubuntu/pool/... HTTP/1.1`
+auto mp::PackageCache::source_of(const QString& target) const -> optional<Source>
+{
+    QUrl url{target};
+    url.setQuery(QString{});
+    url.setFragment(QString{});
+
+    const auto host = url.host().toLower();
+    const auto path = QDir::cleanPath(url.path());
+    if (url.scheme() != "http" || !is_archive(host) || !path.startsWith('/') || path == "/")
+        return nullopt;
+
+    return Source{url, host + path, changes(path)};
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_PACKAGE_CACHE_H
+#define MULTIPASS_PACKAGE_CACHE_H
+
+#include "http_cache.h"
+
+namespace multipass
+{
+/**
+ * A caching HTTP proxy for the Ubuntu archive, for instances to install packages from the host's copies after the
+ * first one fetched them. Packages live at versioned paths, so they are kept for good, along with the indexes that
+ * apt fetches by hash; the rest of the indexes are fetched again once they are older than their time to live. Requests
+ * for anything but the archive are refused, so that this is no open proxy.
+ */
+class PackageCache : public HttpCache
+{
+public:
+    PackageCache(URLDownloader* downloader, const Path& cache_dir, std::chrono::seconds index_time_to_live,
+                 qint64 max_size);
+
+protected:
+    optional<Source> source_of(const QString& target) const override;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_PACKAGE_CACHE_H
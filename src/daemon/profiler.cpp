@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "profiler.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/platform.h>
+#include <multipass/process/process.h>
+#include <multipass/process/simple_process_spec.h>
+#include <multipass/utils.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+#include <cstdio>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "profiler";
+
+void write_heap_statistics(const QString& path)
+{
+#ifdef __GLIBC__
+    if (auto file = std::fopen(qUtf8Printable(path), "w"))
+    {
+        malloc_info(0, file); // per arena, in XML
+        std::fclose(file);
+    }
+#else
+    Q_UNUSED(path);
+#endif
+}
+} // namespace
+
+mp::Profiler::Profiler(const Path& profiles_dir) : profiles_dir{profiles_dir}
+{
+}
+
+mp::Profiler::~Profiler()
+{
+    if (perf && perf->running())
+    {
+        perf->terminate(); // perf writes what it has so far
+        perf->wait_for_finished();
+    }
+}
+
+auto mp::Profiler::capture(std::chrono::seconds duration, const std::string& state_snapshot) -> Path
+{
+    if (perf)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Still capturing to {}", capture_dir));
+        return {};
+    }
+
+    capture_dir = mp::utils::make_dir(QDir{profiles_dir}, QDateTime::currentDateTimeUtc().toString("yyyyMMdd-hhmmss"));
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Capturing a profile of {}s to {}", duration.count(), capture_dir));
+
+    QFile state_file{QDir{capture_dir}.filePath("state.txt")};
+    if (state_file.open(QIODevice::WriteOnly))
+        state_file.write(state_snapshot.data(), state_snapshot.size());
+
+    write_heap_statistics(QDir{capture_dir}.filePath("heap-before.xml"));
+
+    // perf stops sampling when the command it runs is done, which only waits for the duration
+    perf = mp::platform::make_process(mp::simple_process_spec(
+        "perf", {"record", "-F", "99", "-g", "-p", QString::number(QCoreApplication::applicationPid()), "-o",
+                 QDir{capture_dir}.filePath("cpu.perf.data"), "--", "sleep", QString::number(duration.count())}));
+
+    QObject::connect(perf.get(), &Process::finished, [this](const ProcessState& state) {
+        if (!state.completed_successfully())
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("No CPU profile: perf failed ({})", state.failure_message()));
+
+        finish();
+    });
+    QObject::connect(perf.get(), &Process::error_occurred, [this](QProcess::ProcessError error, QString message) {
+        if (error == QProcess::FailedToStart) // it does not finish then
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("No CPU profile: {}", message));
+            finish();
+        }
+    });
+
+    perf->start();
+    return capture_dir;
+}
+
+void mp::Profiler::finish()
+{
+    write_heap_statistics(QDir{capture_dir}.filePath("heap-after.xml"));
+    mpl::log(mpl::Level::info, category, fmt::format("Captured a profile to {}", capture_dir));
+
+    perf.release()->deleteLater(); // from within its own signal
+}
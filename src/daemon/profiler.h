@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_PROFILER_H
+#define MULTIPASS_PROFILER_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/path.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace multipass
+{
+class Process;
+
+/**
+ * Collects evidence of how a running daemon performs, without restarting it. Each capture gets a directory of its own,
+ * with a sampling CPU profile that perf takes for the given duration, glibc's heap statistics from before and after
+ * it, and the snapshot of the daemon's state that it is handed. One capture runs at a time; main thread only.
+ */
+class Profiler : private DisabledCopyMove
+{
+public:
+    explicit Profiler(const Path& profiles_dir);
+    ~Profiler();
+
+    // Returns the directory the capture goes to, or nothing when another capture is still running
+    Path capture(std::chrono::seconds duration, const std::string& state_snapshot);
+
+private:
+    void finish();
+
+    const Path profiles_dir;
+    Path capture_dir;
+    std::unique_ptr<Process> perf;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_PROFILER_H
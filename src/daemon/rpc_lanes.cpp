@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rpc_lanes.h"
+
+#include <multipass/performance_counters.h>
+
+#include <unordered_set>
+
+namespace mp = multipass;
+
+namespace
+{
+const std::unordered_set<std::string> bulk_methods{"launch", "create", "clone", "find", "purge"};
+
+const char* name_of(mp::RpcLanes::Priority priority)
+{
+    return priority == mp::RpcLanes::Priority::bulk ? "bulk" : "interactive";
+}
+} // namespace
+
+mp::RpcLanes::Pass::Pass(RpcLanes& lanes, Priority priority) : lanes{lanes}, priority{priority}
+{
+}
+
+mp::RpcLanes::Pass::~Pass()
+{
+    {
+        std::lock_guard<std::mutex> lock{lanes.mutex};
+        --lanes.lanes[static_cast<int>(priority)].running;
+        lanes.publish(priority);
+    }
+    lanes.left.notify_all();
+}
+
+mp::RpcLanes::RpcLanes(int max_interactive_calls, int max_bulk_calls)
+    : lanes{{Lane{max_interactive_calls}, Lane{max_bulk_calls}}}
+{
+}
+
+bool mp::RpcLanes::has_lane(const std::string& method)
+{
+    return method != "watch";
+}
+
+auto mp::RpcLanes::priority_of(const std::string& method) -> Priority
+{
+    return bulk_methods.count(method) ? Priority::bulk : Priority::interactive;
+}
+
+auto mp::RpcLanes::enter(const std::string& method) -> std::unique_ptr<Pass>
+{
+    if (!has_lane(method))
+        return nullptr;
+
+    const auto priority = priority_of(method);
+    auto& lane = lanes[static_cast<int>(priority)];
+
+    std::unique_lock<std::mutex> lock{mutex};
+    ++lane.waiting;
+    publish(priority);
+    left.wait(lock, [&lane] { return lane.limit <= 0 || lane.running < lane.limit; });
+    --lane.waiting;
+    ++lane.running;
+    publish(priority);
+
+    return std::unique_ptr<Pass>{new Pass{*this, priority}};
+}
+
+int mp::RpcLanes::running(Priority priority) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return lanes[static_cast<int>(priority)].running;
+}
+
+int mp::RpcLanes::waiting(Priority priority) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return lanes[static_cast<int>(priority)].waiting;
+}
+
+void mp::RpcLanes::publish(Priority priority) const
+{
+    const auto& lane = lanes[static_cast<int>(priority)];
+    const PerformanceCounters::Labels labels{{"lane", name_of(priority)}};
+
+    MP_PERF_COUNTERS.set("multipass_rpc_lane_running", labels, lane.running);
+    MP_PERF_COUNTERS.set("multipass_rpc_lane_waiting", labels, lane.waiting);
+}
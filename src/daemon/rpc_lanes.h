@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_RPC_LANES_H
+#define MULTIPASS_RPC_LANES_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace multipass
+{
+/**
+ * Bounds how many calls of each priority class the daemon works on at once. Bulk calls, which download images or go
+ * over manifests, wait for one another past their bound, so that a batch of them can neither take all the threads of
+ * the server nor fill the main thread's queue ahead of interactive calls, which have a lane of their own.
+ */
+class RpcLanes : private DisabledCopyMove
+{
+public:
+    enum class Priority
+    {
+        interactive,
+        bulk
+    };
+
+    // A place in a lane, which it leaves when it goes away
+    class Pass : private DisabledCopyMove
+    {
+    public:
+        ~Pass();
+
+    private:
+        friend class RpcLanes;
+        Pass(RpcLanes& lanes, Priority priority);
+
+        RpcLanes& lanes;
+        const Priority priority;
+    };
+
+    RpcLanes(int max_interactive_calls, int max_bulk_calls); // 0 for no limit
+
+    // Watches, which hold on to their call for as long as the client keeps watching, take no lane
+    static bool has_lane(const std::string& method);
+    static Priority priority_of(const std::string& method);
+
+    std::unique_ptr<Pass> enter(const std::string& method); // blocks until the lane has room; null without a lane
+    int running(Priority priority) const;
+    int waiting(Priority priority) const;
+
+private:
+    struct Lane
+    {
+        int limit;
+        int running{0};
+        int waiting{0};
+    };
+
+    void publish(Priority priority) const; // under the mutex
+
+    mutable std::mutex mutex;
+    std::condition_variable left;
+    std::array<Lane, 2> lanes;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_RPC_LANES_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "storage_pools.h"
+
+#include <multipass/constants.h>
+#include <multipass/format.h>
+#include <multipass/settings/settings.h>
+#include <multipass/utils.h>
+
+#include <QDir>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+std::map<std::string, QString> mp::parse_storage_pools(const QString& definitions)
+{
+    std::map<std::string, QString> pools;
+    for (const auto& definition : definitions.split(',', QString::SkipEmptyParts))
+    {
+        const auto separator = definition.indexOf('=');
+        const auto name = definition.left(separator).trimmed().toStdString();
+        const auto path = definition.mid(separator + 1).trimmed();
+
+        if (separator < 0 || !mp::utils::valid_hostname(name) || !QDir::isAbsolutePath(path))
+            throw std::invalid_argument{fmt::format("Bad storage pool \"{}\", need name=/absolute/path", definition)};
+        if (!pools.emplace(name, QDir::cleanPath(path)).second)
+            throw std::invalid_argument{fmt::format("Storage pool \"{}\" is defined twice", name)};
+    }
+
+    return pools;
+}
+
+QString mp::storage_pool_path(const std::string& name)
+{
+    const auto pools = parse_storage_pools(MP_SETTINGS.get(storage_pools_key));
+    const auto pool = pools.find(name);
+    if (pool == pools.end())
+        throw std::runtime_error{fmt::format("There is no storage pool named \"{}\"", name)};
+
+    return pool->second;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_STORAGE_POOLS_H
+#define MULTIPASS_STORAGE_POOLS_H
+
+#include <QString>
+
+#include <map>
+#include <string>
+
+namespace multipass
+{
+/**
+ * Storage pools are named directories that instance disks and the image cache can be placed in, each on whatever disk
+ * suits it. They are defined in the local.storage-pools setting, as in "fast=/mnt/nvme/multipass,bulk=/srv/multipass".
+ * Throws std::invalid_argument when @p definitions is not a list of unique names with absolute paths.
+ */
+std::map<std::string, QString> parse_storage_pools(const QString& definitions);
+
+// The directory of the pool named @p name in the current settings. Throws std::runtime_error when there is none.
+QString storage_pool_path(const std::string& name);
+} // namespace multipass
+
+#endif // MULTIPASS_STORAGE_POOLS_H
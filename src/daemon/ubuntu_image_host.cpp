@@ -17,34 +17,62 @@
 
 #include "ubuntu_image_host.h"
 
+#include <multipass/format.h>
+#include <multipass/memory_accounting.h>
 #include <multipass/platform.h>
 #include <multipass/query.h>
 #include <multipass/simple_streams_index.h>
+#include <multipass/tracing.h>
 #include <multipass/url_downloader.h>
 
 #include <multipass/exceptions/download_exception.h>
 #include <multipass/exceptions/manifest_exceptions.h>
 #include <multipass/exceptions/unsupported_image_exception.h>
 #include <multipass/exceptions/unsupported_remote_exception.h>
+#include <multipass/logging/log.h>
 
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
 #include <QUrl>
+#include <QtConcurrent/QtConcurrent>
 
 #include <algorithm>
 #include <unordered_set>
 
 namespace mp = multipass;
+namespace mpl = multipass::logging;
 
 namespace
 {
+constexpr auto category = "VMImageHost";
 constexpr auto index_path = "streams/v1/index.json";
 
-auto download_manifest(const QString& host_url, mp::URLDownloader* url_downloader)
+QJsonObject to_json(const mp::DownloadValidators& validators)
 {
-    auto json_index = url_downloader->download({host_url + index_path});
-    auto index = mp::SimpleStreamsIndex::fromJson(json_index);
+    return {{"etag", QString::fromUtf8(validators.etag)},
+            {"last_modified", QString::fromUtf8(validators.last_modified)}};
+}
+
+mp::DownloadValidators validators_from(const QJsonObject& json)
+{
+    return {json["etag"].toString().toUtf8(), json["last_modified"].toString().toUtf8()};
+}
+
+// The cached manifest itself, and what it was fetched from
+auto cache_paths_for(const QString& cache_dir, const std::string& remote_name)
+{
+    const QDir dir{cache_dir};
+    const auto name = QString::fromStdString(remote_name);
+    return std::make_pair(dir.filePath(name + ".json"), dir.filePath(name + ".source.json"));
+}
 
-    auto json_manifest = url_downloader->download({host_url + index.manifest_path});
-    return mp::SimpleStreamsManifest::fromJson(json_manifest, host_url);
+bool save(const QString& path, const QByteArray& data)
+{
+    QSaveFile file{path};
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
 }
 
 mp::VMImageInfo with_location_fully_resolved(const QString& host_url, const mp::VMImageInfo& info)
@@ -73,14 +101,57 @@ auto key_from(const std::string& search_string)
 }
 } // namespace
 
+std::vector<std::pair<std::string, std::string>> mp::default_ubuntu_remotes()
+{
+    return {{release_remote, "https://cloud-images.ubuntu.com/releases/"},
+            {daily_remote, "https://cloud-images.ubuntu.com/daily/"},
+            {appliance_remote, "https://cdimage.ubuntu.com/ubuntu-core/appliances/"}};
+}
+
+auto mp::cloud_image_mirrors(const QStringList& base_urls,
+                             const std::vector<std::pair<std::string, std::string>>& remotes)
+    -> UbuntuVMImageHost::Mirrors
+{
+    const QString cloud_images_url{"https://cloud-images.ubuntu.com/"};
+
+    UbuntuVMImageHost::Mirrors mirrors;
+    for (const auto& remote : remotes)
+    {
+        const auto url = QString::fromStdString(remote.second);
+        if (!url.startsWith(cloud_images_url))
+            continue;
+
+        for (const auto& mirror : base_urls)
+        {
+            auto base_url = mirror.trimmed();
+            if (!base_url.endsWith('/'))
+                base_url += '/';
+            mirrors[remote.first].push_back((base_url + url.mid(cloud_images_url.size())).toStdString());
+        }
+    }
+
+    return mirrors;
+}
+
 mp::UbuntuVMImageHost::UbuntuVMImageHost(std::vector<std::pair<std::string, std::string>> remotes,
-                                         URLDownloader* downloader, std::chrono::seconds manifest_time_to_live)
-    : CommonVMImageHost{manifest_time_to_live}, url_downloader{downloader}, remotes{std::move(remotes)}
+                                         URLDownloader* downloader, std::chrono::seconds manifest_time_to_live,
+                                         const QString& manifest_cache_dir, Mirrors mirrors)
+    : CommonVMImageHost{manifest_time_to_live},
+      url_downloader{downloader},
+      remotes{std::move(remotes)},
+      manifest_cache_dir{manifest_cache_dir},
+      mirrors{std::move(mirrors)}
 {
 }
 
+mp::UbuntuVMImageHost::~UbuntuVMImageHost()
+{
+    wait_for_refresh();
+}
+
 mp::optional<mp::VMImageInfo> mp::UbuntuVMImageHost::info_for(const Query& query)
 {
+    mp::tracing::Span span{"image host", "info_for"};
     auto images = all_info_for(query);
 
     if (images.size() == 0)
@@ -115,7 +186,7 @@ std::vector<std::pair<std::string, mp::VMImageInfo>> mp::UbuntuVMImageHost::all_
 
     std::vector<std::pair<std::string, mp::VMImageInfo>> images;
 
-    mp::SimpleStreamsManifest* manifest;
+    std::shared_ptr<const mp::SimpleStreamsManifest> manifest;
 
     for (const auto& remote_name : remotes_to_search)
     {
@@ -146,15 +217,14 @@ std::vector<std::pair<std::string, mp::VMImageInfo>> mp::UbuntuVMImageHost::all_
         {
             std::unordered_set<std::string> found_hashes;
 
-            for (const auto& entry : manifest->products)
+            for (const auto* entry : manifest->products_with_id_prefix(key))
             {
-                if (entry.id.startsWith(key) && (entry.supported || query.allow_unsupported) &&
-                    found_hashes.find(entry.id.toStdString()) == found_hashes.end())
+                if ((entry->supported || query.allow_unsupported) &&
+                    found_hashes.insert(entry->id.toStdString()).second)
                 {
                     images.push_back(std::make_pair(
                         remote_name,
-                        with_location_fully_resolved(QString::fromStdString(remote_url_from(remote_name)), entry)));
-                    found_hashes.insert(entry.id.toStdString());
+                        with_location_fully_resolved(QString::fromStdString(remote_url_from(remote_name)), *entry)));
                 }
             }
         }
@@ -165,15 +235,11 @@ std::vector<std::pair<std::string, mp::VMImageInfo>> mp::UbuntuVMImageHost::all_
 
 mp::VMImageInfo mp::UbuntuVMImageHost::info_for_full_hash_impl(const std::string& full_hash)
 {
-    for (const auto& manifest : manifests)
+    const auto id = QString::fromStdString(full_hash);
+    for (const auto& manifest : current_manifests())
     {
-        for (const auto& product : manifest.second->products)
-        {
-            if (product.id.toStdString() == full_hash)
-            {
-                return with_location_fully_resolved(QString::fromStdString(remote_url_from(manifest.first)), product);
-            }
-        }
+        if (const auto* product = manifest.second->product_with_id(id))
+            return with_location_fully_resolved(QString::fromStdString(remote_url_from(manifest.first)), *product);
     }
 
     // TODO: Throw a specific exception type here so callers can be more specific about what to catch
@@ -203,7 +269,7 @@ std::vector<mp::VMImageInfo> mp::UbuntuVMImageHost::all_images_for(const std::st
 
 void mp::UbuntuVMImageHost::for_each_entry_do_impl(const Action& action)
 {
-    for (const auto& manifest : manifests)
+    for (const auto& manifest : current_manifests())
     {
         for (const auto& product : manifest.second->products)
         {
@@ -228,56 +294,306 @@ std::vector<std::string> mp::UbuntuVMImageHost::supported_remotes()
     return supported_remotes;
 }
 
-void mp::UbuntuVMImageHost::fetch_manifests()
+bool mp::UbuntuVMImageHost::fetch_manifests()
 {
+    const auto previous_manifests = current_manifests();
+    auto previous_of = [&previous_manifests](const std::string& remote_name) {
+        auto it = std::find_if(previous_manifests.cbegin(), previous_manifests.cend(),
+                               [&remote_name](const auto& element) { return element.first == remote_name; });
+
+        return it != previous_manifests.cend() ? it->second : nullptr;
+    };
+
+    // All remotes are fetched at once, so that a slow one holds back none of the others (each request times out on
+    // its own in the downloader)
+    std::vector<std::pair<std::string, QFuture<FetchedManifest>>> fetches;
     for (const auto& remote : remotes)
     {
+        auto previous = previous_of(remote.first);
+        auto source = manifest_sources[remote.first];
+
+        fetches.emplace_back(remote.first, QtConcurrent::run([this, remote, previous, source] {
+            try
+            {
+                check_remote_is_supported(remote.first);
+
+                if (!previous)
+                {
+                    auto cached = load_cached_manifest(remote.first, QString::fromStdString(remote.second));
+                    if (cached.manifest)
+                        return cached;
+                }
+
+                // Mirrors are tried from the fastest to answer, until one of them has the manifest
+                auto ranked_urls = ranked_urls_for(remote);
+                for (std::size_t i = 0;; ++i)
+                {
+                    try
+                    {
+                        const auto host_url = QString::fromStdString(ranked_urls[i]);
+                        auto fetched = fetch_manifest(remote.first, host_url, previous, source);
+                        if (ranked_urls.size() > 1)
+                        {
+                            std::rotate(ranked_urls.begin(), ranked_urls.begin() + i, ranked_urls.begin() + i + 1);
+                            fetched.ranked_urls = std::move(ranked_urls);
+                        }
+
+                        return fetched;
+                    }
+                    catch (const mp::DownloadException& e)
+                    {
+                        if (i + 1 == ranked_urls.size())
+                            throw;
+
+                        mpl::log(mpl::Level::warning, category,
+                                 fmt::format("{} - trying {}", e.what(), ranked_urls[i + 1]));
+                    }
+                }
+            }
+            catch (...)
+            {
+                FetchedManifest failed;
+                failed.error = std::current_exception();
+                return failed;
+            }
+        }));
+    }
+
+    for (auto& fetch : fetches)
+        fetch.second.waitForFinished();
+
+    Manifests new_manifests;
+    decltype(chosen_urls) new_chosen_urls;
+    auto all_available = true;
+
+    auto keep_previous = [&previous_of, &new_manifests, &all_available](const std::string& remote_name) {
+        if (auto previous = previous_of(remote_name))
+            new_manifests.emplace_back(remote_name, std::move(previous));
+        else
+            all_available = false;
+    };
+
+    for (auto& fetch : fetches)
+    {
+        const auto& remote_name = fetch.first;
+        const auto fetched = fetch.second.result();
+
         try
         {
-            check_remote_is_supported(remote.first);
+            if (fetched.error)
+                std::rethrow_exception(fetched.error);
+
+            if (fetched.from_cache)
+                on_manifest_stale(fmt::format("Serving cached manifest of \"{}\" until it is refreshed", remote_name));
+
+            manifest_sources[remote_name] = fetched.source;
+            new_manifests.emplace_back(remote_name, fetched.manifest);
+
+            if (!fetched.ranked_urls.empty())
+            {
+                QStringList ranked_urls;
+                for (const auto& url : fetched.ranked_urls)
+                    ranked_urls.push_back(QString::fromStdString(url));
 
-            manifests.emplace_back(
-                std::make_pair(remote.first, download_manifest(QString::fromStdString(remote.second), url_downloader)));
+                url_downloader->set_mirrors(ranked_urls);
+                new_chosen_urls[remote_name] = fetched.ranked_urls.front();
+            }
         }
         catch (mp::EmptyManifestException& /* e */)
         {
-            on_manifest_empty(fmt::format("Did not find any supported products in \"{}\"", remote.first));
+            on_manifest_empty(fmt::format("Did not find any supported products in \"{}\"", remote_name));
         }
         catch (mp::GenericManifestException& e)
         {
             on_manifest_update_failure(e.what());
+            keep_previous(remote_name);
         }
         catch (mp::DownloadException& e)
         {
             on_manifest_update_failure(e.what());
+            keep_previous(remote_name);
         }
         catch (const mp::UnsupportedRemoteException&)
         {
             continue;
         }
     }
+
+    std::lock_guard<std::mutex> lock{manifests_mutex};
+    manifests = std::move(new_manifests);
+    for (auto& chosen : new_chosen_urls)
+        chosen_urls[chosen.first] = std::move(chosen.second);
+
+    return all_available;
+}
+
+std::vector<std::string> mp::UbuntuVMImageHost::ranked_urls_for(const std::pair<std::string, std::string>& remote) const
+{
+    std::vector<std::string> urls{remote.second};
+    if (auto it = mirrors.find(remote.first); it != mirrors.end())
+        urls.insert(urls.end(), it->second.cbegin(), it->second.cend());
+
+    if (urls.size() == 1)
+        return urls;
+
+    // All are asked for the headers of their index at once; those that cannot answer go last, in their order
+    std::vector<QFuture<std::chrono::steady_clock::duration>> probes;
+    for (const auto& url : urls)
+        probes.push_back(QtConcurrent::run([this, url] {
+            const auto start = std::chrono::steady_clock::now();
+            try
+            {
+                url_downloader->last_modified({QString::fromStdString(url) + index_path});
+                return std::chrono::steady_clock::now() - start;
+            }
+            catch (const std::exception&)
+            {
+                return std::chrono::steady_clock::duration::max();
+            }
+        }));
+
+    std::vector<std::pair<std::chrono::steady_clock::duration, std::string>> latencies;
+    for (std::size_t i = 0; i < urls.size(); ++i)
+        latencies.emplace_back(probes[i].result(), urls[i]);
+
+    std::stable_sort(latencies.begin(), latencies.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (std::size_t i = 0; i < urls.size(); ++i)
+        urls[i] = latencies[i].second;
+
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("Ranked mirrors of \"{}\": {}", remote.first, fmt::join(urls, ", ")));
+    return urls;
 }
 
-void mp::UbuntuVMImageHost::clear()
+auto mp::UbuntuVMImageHost::fetch_manifest(const std::string& remote_name, const QString& host_url,
+                                           const std::shared_ptr<const SimpleStreamsManifest>& previous,
+                                           ManifestSource source) const -> FetchedManifest
 {
-    manifests.clear();
+    // Validators only mean anything next to the manifest that they came with, and they are only kept once the whole
+    // fetch goes through, so that a failure halfway does not have later refreshes take the rest for unchanged
+    if (!previous)
+        source = {};
+
+    auto json_index = url_downloader->download_if_changed({host_url + index_path}, source.index_validators);
+    if (!json_index)
+    {
+        if (!previous)
+            throw GenericManifestException{fmt::format("Got no index for \"{}\"", remote_name)};
+
+        return {previous, source};
+    }
+
+    auto index = SimpleStreamsIndex::fromJson(*json_index);
+    if (index.manifest_path != source.manifest_path)
+    {
+        source.manifest_path = index.manifest_path;
+        source.manifest_validators = {};
+    }
+
+    std::shared_ptr<const SimpleStreamsManifest> manifest = previous;
+    auto json_manifest =
+        url_downloader->download_if_changed({host_url + index.manifest_path}, source.manifest_validators);
+    if (json_manifest)
+    {
+        manifest = SimpleStreamsManifest::fromJson(*json_manifest, host_url);
+        cache_manifest(remote_name, source, *json_manifest);
+    }
+    else if (!manifest)
+    {
+        throw GenericManifestException{fmt::format("Got no manifest for \"{}\"", remote_name)};
+    }
+
+    return {manifest, source};
 }
 
-mp::SimpleStreamsManifest* mp::UbuntuVMImageHost::manifest_from(const std::string& remote)
+auto mp::UbuntuVMImageHost::load_cached_manifest(const std::string& remote_name, const QString& host_url) const
+    -> FetchedManifest
+{
+    if (manifest_cache_dir.isEmpty())
+        return {};
+
+    const auto [manifest_path, source_path] = cache_paths_for(manifest_cache_dir, remote_name);
+    QFile manifest_file{manifest_path}, source_file{source_path};
+    if (!manifest_file.open(QIODevice::ReadOnly) || !source_file.open(QIODevice::ReadOnly))
+        return {};
+
+    try
+    {
+        FetchedManifest cached;
+        cached.manifest = SimpleStreamsManifest::fromJson(manifest_file.readAll(), host_url);
+        cached.from_cache = true;
+
+        const auto json = QJsonDocument::fromJson(source_file.readAll()).object();
+        cached.source = {json["manifest_path"].toString(), validators_from(json["index"].toObject()),
+                         validators_from(json["manifest"].toObject())};
+
+        return cached;
+    }
+    catch (const GenericManifestException& e)
+    {
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("Ignoring cached manifest of \"{}\": {}", remote_name, e.what()));
+        return {};
+    }
+}
+
+void mp::UbuntuVMImageHost::cache_manifest(const std::string& remote_name, const ManifestSource& source,
+                                           const QByteArray& json) const
+{
+    if (manifest_cache_dir.isEmpty())
+        return;
+
+    // The source goes last, so that it never describes a manifest other than the one next to it
+    const auto [manifest_path, source_path] = cache_paths_for(manifest_cache_dir, remote_name);
+    QFile::remove(source_path);
+
+    const QJsonObject source_json{{"manifest_path", source.manifest_path},
+                                  {"index", to_json(source.index_validators)},
+                                  {"manifest", to_json(source.manifest_validators)}};
+    if (!save(manifest_path, json) || !save(source_path, QJsonDocument{source_json}.toJson()))
+        mpl::log(mpl::Level::warning, category, fmt::format("Could not cache manifest of \"{}\"", remote_name));
+}
+
+std::size_t mp::UbuntuVMImageHost::manifests_memory_estimate()
+{
+    std::size_t size = 0;
+    for (const auto& manifest : current_manifests())
+    {
+        size += sizeof(SimpleStreamsManifest) + mp::utils::estimated_size(manifest.second->updated_at);
+        for (const auto& product : manifest.second->products)
+            size += mp::utils::estimated_size(product);
+
+        // Each lookup entry is a pointer, next to its key in image_records
+        for (auto it = manifest.second->image_records.cbegin(); it != manifest.second->image_records.cend(); ++it)
+            size += mp::utils::estimated_size(it.key()) + sizeof(void*);
+        size += manifest.second->products_by_id.size() * sizeof(void*);
+    }
+
+    return size;
+}
+
+auto mp::UbuntuVMImageHost::current_manifests() const -> Manifests
+{
+    std::lock_guard<std::mutex> lock{manifests_mutex};
+    return manifests;
+}
+
+std::shared_ptr<const mp::SimpleStreamsManifest> mp::UbuntuVMImageHost::manifest_from(const std::string& remote)
 {
     check_remote_is_supported(remote);
 
     update_manifests();
 
-    auto it = std::find_if(manifests.begin(), manifests.end(),
-                           [&remote](const std::pair<std::string, std::unique_ptr<SimpleStreamsManifest>>& element) {
-                               return element.first == remote;
-                           });
+    const auto current = current_manifests();
+    auto it = std::find_if(current.cbegin(), current.cend(),
+                           [&remote](const auto& element) { return element.first == remote; });
 
-    if (it == manifests.cend())
+    if (it == current.cend())
         throw std::runtime_error(fmt::format("Remote \"{}\" is unknown or unreachable.", remote));
 
-    return it->second.get();
+    return it->second;
 }
 
 const mp::VMImageInfo* mp::UbuntuVMImageHost::match_alias(const QString& key,
@@ -294,6 +610,12 @@ const mp::VMImageInfo* mp::UbuntuVMImageHost::match_alias(const QString& key,
 
 std::string mp::UbuntuVMImageHost::remote_url_from(const std::string& remote_name)
 {
+    {
+        std::lock_guard<std::mutex> lock{manifests_mutex};
+        if (auto it = chosen_urls.find(remote_name); it != chosen_urls.end())
+            return it->second;
+    }
+
     std::string url;
 
     auto it = std::find_if(
@@ -20,10 +20,16 @@
 
 #include "common_image_host.h"
 #include "multipass/simple_streams_manifest.h"
+#include "multipass/url_downloader.h"
 
 #include <QString>
+#include <QStringList>
 
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -33,32 +39,76 @@ constexpr auto release_remote = "release";
 constexpr auto daily_remote = "daily";
 constexpr auto appliance_remote = "appliance";
 
-class URLDownloader;
+// The remotes above, with where they are published
+std::vector<std::pair<std::string, std::string>> default_ubuntu_remotes();
+
 class UbuntuVMImageHost final : public CommonVMImageHost
 {
 public:
+    using Mirrors = std::unordered_map<std::string, std::vector<std::string>>; // other URLs of remotes, by name
+
+    // Manifests are kept in manifest_cache_dir, when there is one, to be served across restarts. Remotes with mirrors
+    // are served from whichever of their URLs answers first, as of the last refresh, and fail over to the others.
     UbuntuVMImageHost(std::vector<std::pair<std::string, std::string>> remotes, URLDownloader* downloader,
-                      std::chrono::seconds manifest_time_to_live);
+                      std::chrono::seconds manifest_time_to_live, const QString& manifest_cache_dir = QString{},
+                      Mirrors mirrors = {});
+    ~UbuntuVMImageHost() override;
 
     optional<VMImageInfo> info_for(const Query& query) override;
     std::vector<std::pair<std::string, VMImageInfo>> all_info_for(const Query& query) override;
     std::vector<VMImageInfo> all_images_for(const std::string& remote_name, const bool allow_unsupported) override;
     std::vector<std::string> supported_remotes() override;
+    std::size_t manifests_memory_estimate() override;
 
 protected:
     void for_each_entry_do_impl(const Action& action) override;
     VMImageInfo info_for_full_hash_impl(const std::string& full_hash) override;
-    void fetch_manifests() override;
-    void clear() override;
+    bool fetch_manifests() override;
 
 private:
-    SimpleStreamsManifest* manifest_from(const std::string& remote);
+    using Manifests = std::vector<std::pair<std::string, std::shared_ptr<const SimpleStreamsManifest>>>;
+
+    // What a remote's manifest was fetched from, so that refreshes can ask whether it changed
+    struct ManifestSource
+    {
+        QString manifest_path;
+        DownloadValidators index_validators;
+        DownloadValidators manifest_validators;
+    };
+
+    struct FetchedManifest
+    {
+        std::shared_ptr<const SimpleStreamsManifest> manifest; // null when there was nothing in the cache
+        ManifestSource source;
+        bool from_cache = false;
+        std::exception_ptr error{};
+        std::vector<std::string> ranked_urls{}; // of remotes with mirrors, the one it came from first
+    };
+
+    FetchedManifest fetch_manifest(const std::string& remote_name, const QString& host_url,
+                                   const std::shared_ptr<const SimpleStreamsManifest>& previous,
+                                   ManifestSource source) const;
+    FetchedManifest load_cached_manifest(const std::string& remote_name, const QString& host_url) const;
+    void cache_manifest(const std::string& remote_name, const ManifestSource& source, const QByteArray& json) const;
+    std::vector<std::string> ranked_urls_for(const std::pair<std::string, std::string>& remote) const; // by latency
+
+    Manifests current_manifests() const;
+    std::shared_ptr<const SimpleStreamsManifest> manifest_from(const std::string& remote);
     const VMImageInfo* match_alias(const QString& key, const SimpleStreamsManifest& manifest) const;
-    std::vector<std::pair<std::string, std::unique_ptr<SimpleStreamsManifest>>> manifests;
+    mutable std::mutex manifests_mutex;
+    Manifests manifests;
     URLDownloader* const url_downloader;
     std::vector<std::pair<std::string, std::string>> remotes;
     std::string remote_url_from(const std::string& remote_name);
     QString index_path;
+    const QString manifest_cache_dir;
+    std::unordered_map<std::string, ManifestSource> manifest_sources; // only touched by fetch_manifests()
+    const Mirrors mirrors;
+    std::unordered_map<std::string, std::string> chosen_urls; // of remotes with mirrors, under manifests_mutex
 };
+
+// Where the mirrors of cloud-images.ubuntu.com at base_urls publish those of remotes that come from there
+UbuntuVMImageHost::Mirrors cloud_image_mirrors(const QStringList& base_urls,
+                                               const std::vector<std::pair<std::string, std::string>>& remotes);
 }
 #endif // MULTIPASS_UBUNTU_IMAGE_HOST_H
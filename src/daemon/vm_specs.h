@@ -22,6 +22,10 @@
 #include <multipass/memory_size.h>
 #include <multipass/network_interface.h>
 #include <multipass/virtual_machine.h>
+#include <multipass/vm_disk_options.h>
+#include <multipass/vm_network_options.h>
+#include <multipass/vm_placement.h>
+#include <multipass/vm_resource_limits.h>
 
 #include <string>
 #include <tuple>
@@ -34,9 +38,23 @@ namespace multipass
 {
 struct VMMount
 {
+    enum class MountType : int
+    {
+        Classic = 0,
+        Native = 1
+    };
+
     std::string source_path;
     id_mappings gid_mappings;
     id_mappings uid_mappings;
+    MountType mount_type = MountType::Classic;
+    std::string profile; // SSHFS tuning, empty for the default one
+};
+
+struct VMSnapshot
+{
+    std::string name;
+    std::string created; // ISO 8601, in UTC
 };
 
 struct VMSpecs
@@ -51,20 +69,34 @@ struct VMSpecs
     std::unordered_map<std::string, VMMount> mounts;
     bool deleted;
     QJsonObject metadata;
+    std::string pool_profile{}; // set while the instance waits in the warm pool, for a launch to take it
+    VMPlacement placement{};
+    VMDiskOptions disk_options{};
+    VMNetworkOptions network_options{};
+    std::vector<VMSnapshot> snapshots{}; // in the order they were taken
+    bool ephemeral{false};               // purged once stopped, or else when the daemon next starts
+    VMResourceLimits resource_limits{};
 };
 
 inline bool operator==(const VMMount& a, const VMMount& b)
 {
-    return std::tie(a.source_path, a.gid_mappings, a.uid_mappings) ==
-           std::tie(b.source_path, b.gid_mappings, b.uid_mappings);
+    return std::tie(a.source_path, a.gid_mappings, a.uid_mappings, a.mount_type, a.profile) ==
+           std::tie(b.source_path, b.gid_mappings, b.uid_mappings, b.mount_type, b.profile);
+}
+
+inline bool operator==(const VMSnapshot& a, const VMSnapshot& b)
+{
+    return std::tie(a.name, a.created) == std::tie(b.name, b.created);
 }
 
 inline bool operator==(const VMSpecs& a, const VMSpecs& b)
 {
     return std::tie(a.num_cores, a.mem_size, a.disk_space, a.default_mac_address, a.extra_interfaces, a.ssh_username,
-                    a.state, a.mounts, a.deleted, a.metadata) ==
+                    a.state, a.mounts, a.deleted, a.metadata, a.pool_profile, a.placement, a.disk_options,
+                    a.network_options, a.snapshots, a.ephemeral, a.resource_limits) ==
            std::tie(b.num_cores, b.mem_size, b.disk_space, b.default_mac_address, b.extra_interfaces, b.ssh_username,
-                    b.state, b.mounts, b.deleted, b.metadata);
+                    b.state, b.mounts, b.deleted, b.metadata, b.pool_profile, b.placement, b.disk_options,
+                    b.network_options, b.snapshots, b.ephemeral, b.resource_limits);
 }
 } // namespace multipass
 
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "warm_pool.h"
+
+#include <multipass/format.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+mp::optional<std::string> mp::warm_pool_profile_for(const LaunchRequest& request)
+{
+    if (!request.instance_name().empty() || !request.cloud_init_user_data().empty() ||
+        request.network_options_size() || request.count() > 1 || !request.name_prefix().empty())
+        return nullopt;
+
+    return fmt::format("{}:{}/{}/{}/{}/{}/{}{}", request.remote_name(), request.image(), request.num_cores(),
+                       request.mem_size(), request.disk_space(), request.time_zone(), request.storage_pool(),
+                       request.fast_boot() ? "/fast" : "");
+}
+
+mp::WarmPool::WarmPool(std::size_t size) : pool_size{size}
+{
+}
+
+std::size_t mp::WarmPool::size() const
+{
+    return pool_size;
+}
+
+std::size_t mp::WarmPool::missing(const std::string& profile) const
+{
+    auto pooled = static_cast<std::size_t>(std::count_if(
+        entries.begin(), entries.end(), [&profile](const auto& entry) { return entry.second.profile == profile; }));
+
+    return pooled < pool_size ? pool_size - pooled : 0;
+}
+
+mp::WarmPool::Entry& mp::WarmPool::add(const std::string& name, const std::string& profile,
+                                       const LaunchRequest& request)
+{
+    auto& entry = entries[name];
+    entry.profile = profile;
+    entry.request = request;
+    entry.request.set_instance_name(name);
+
+    return entry;
+}
+
+void mp::WarmPool::set_instance(const std::string& name, VirtualMachine::ShPtr vm)
+{
+    entries.at(name).vm = std::move(vm);
+}
+
+void mp::WarmPool::mark_ready(const std::string& name)
+{
+    entries.at(name).ready = true;
+}
+
+bool mp::WarmPool::contains(const std::string& name) const
+{
+    return entries.count(name);
+}
+
+mp::optional<std::string> mp::WarmPool::profile_of(const std::string& name) const
+{
+    auto it = entries.find(name);
+    if (it == entries.end())
+        return nullopt;
+
+    return it->second.profile;
+}
+
+mp::VirtualMachine::ShPtr mp::WarmPool::instance(const std::string& name) const
+{
+    auto it = entries.find(name);
+    return it == entries.end() ? nullptr : it->second.vm;
+}
+
+std::vector<std::string> mp::WarmPool::names() const
+{
+    std::vector<std::string> ret;
+    for (const auto& entry : entries)
+        ret.push_back(entry.first);
+
+    return ret;
+}
+
+mp::VirtualMachine::ShPtr mp::WarmPool::claim(const std::string& profile)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [&profile](const auto& entry) {
+        return entry.second.profile == profile && entry.second.ready && entry.second.vm;
+    });
+
+    if (it == entries.end())
+        return nullptr;
+
+    auto vm = std::move(it->second.vm);
+    entries.erase(it);
+
+    return vm;
+}
+
+void mp::WarmPool::remove(const std::string& name)
+{
+    entries.erase(name);
+}
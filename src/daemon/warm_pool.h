@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_WARM_POOL_H
+#define MULTIPASS_WARM_POOL_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/virtual_machine.h>
+
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+// The profile that pooled instances are prepared for, or nullopt for launches that need an instance of their own
+// (named, configured with their own cloud-init data or networks, or several at once)
+optional<std::string> warm_pool_profile_for(const LaunchRequest& request);
+
+/**
+ * Instances that were booted ahead of the launches that will take them, and then suspended, so that those launches
+ * only need to resume them. They are kept per launch profile, up to a number for each, out of the daemon's instances.
+ */
+class WarmPool : private DisabledCopyMove
+{
+public:
+    struct Entry
+    {
+        std::string profile;
+        LaunchRequest request;              // what the instance is created from, named after it
+        std::promise<grpc::Status> created; // the outcome of the creation, which nobody waits on
+        VirtualMachine::ShPtr vm;
+        bool ready{false};
+    };
+
+    explicit WarmPool(std::size_t size); // per profile; 0 disables the pool
+
+    std::size_t size() const;
+    std::size_t missing(const std::string& profile) const; // how many more instances the profile should have
+
+    // Instances join the pool before they are created, and stay as long as it succeeds; entries do not move around
+    Entry& add(const std::string& name, const std::string& profile, const LaunchRequest& request);
+    void set_instance(const std::string& name, VirtualMachine::ShPtr vm);
+    void mark_ready(const std::string& name);
+
+    bool contains(const std::string& name) const;
+    optional<std::string> profile_of(const std::string& name) const;
+    VirtualMachine::ShPtr instance(const std::string& name) const;
+    std::vector<std::string> names() const;
+
+    VirtualMachine::ShPtr claim(const std::string& profile); // a ready instance, which leaves the pool; null if none
+    void remove(const std::string& name);
+
+private:
+    const std::size_t pool_size;
+    std::unordered_map<std::string, Entry> entries;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_WARM_POOL_H
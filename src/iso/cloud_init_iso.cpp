@@ -23,6 +23,8 @@
 
 #include <array>
 #include <cctype>
+#include <cstring>
+#include <stdexcept>
 
 namespace mp = multipass;
 
@@ -96,12 +98,6 @@ void set_at(T& t, SizeType offset, const V& value)
     std::copy(std::begin(value), std::end(value), t.begin() + offset);
 }
 
-template <typename T>
-void write(const T& t, QFile& f)
-{
-    f.write(reinterpret_cast<const char*>(t.data.data()), t.data.size());
-}
-
 template <size_t size>
 struct PaddedString
 {
@@ -365,19 +361,48 @@ Size num_blocks(Size num_bytes)
     return ((num_bytes + logical_block_size - 1) / logical_block_size);
 }
 
-void seek_to_next_block(QFile& f)
+// The whole image, laid out in memory so that it can be written out at once
+class ImageLayout
 {
-    const auto next_block_pos = num_blocks(f.pos()) * logical_block_size;
-    f.seek(next_block_pos);
-}
+public:
+    explicit ImageLayout(uint32_t num_blocks) : bytes(static_cast<int>(num_blocks * logical_block_size), '\0')
+    {
+    }
 
-void pad_to_end(QFile& f)
-{
-    seek_to_next_block(f);
-    f.seek(f.pos() - 1);
-    char end = 0;
-    f.write(&end, 1);
-}
+    void seek(uint32_t position)
+    {
+        pos = position;
+    }
+
+    void seek_to_next_block()
+    {
+        pos = num_blocks(pos) * logical_block_size;
+    }
+
+    template <typename T>
+    void write(const T& t)
+    {
+        write(t.data.data(), t.data.size());
+    }
+
+    void write(const void* data, size_t size)
+    {
+        if (pos + size > static_cast<size_t>(bytes.size()))
+            throw std::runtime_error{"cloud-init data does not fit in its ISO image"};
+
+        std::memcpy(bytes.data() + pos, data, size);
+        pos += static_cast<uint32_t>(size);
+    }
+
+    const QByteArray& data() const
+    {
+        return bytes;
+    }
+
+private:
+    QByteArray bytes;
+    uint32_t pos{0};
+};
 } // namespace
 
 void mp::CloudInitIso::add_file(const std::string& name, const std::string& data)
@@ -385,15 +410,10 @@ void mp::CloudInitIso::add_file(const std::string& name, const std::string& data
     files.push_back(FileEntry{name, data});
 }
 
-void mp::CloudInitIso::write_to(const Path& path)
+QByteArray mp::CloudInitIso::to_bytes() const
 {
-    QFile f{path};
-    if (!f.open(QIODevice::WriteOnly))
-        throw std::runtime_error{"failed to open file for writing during cloud-init generation"};
-
     const uint32_t num_reserved_bytes = 32768u;
     const uint32_t num_reserved_blocks = num_blocks(num_reserved_bytes);
-    f.seek(num_reserved_bytes);
 
     PrimaryVolumeDescriptor prim_desc;
     JolietVolumeDescriptor joliet_desc;
@@ -443,35 +463,52 @@ void mp::CloudInitIso::write_to(const Path& path)
         current_block_index += num_blocks(entry.data.size());
     }
 
-    write(prim_desc, f);
-    write(joliet_desc, f);
-    write(VolumeDescriptorSetTerminator(), f);
+    ImageLayout image{volume_size};
+    image.seek(num_reserved_bytes);
+
+    image.write(prim_desc);
+    image.write(joliet_desc);
+    image.write(VolumeDescriptorSetTerminator());
 
-    write(root_path, f);
-    seek_to_next_block(f);
-    write(joliet_root_path, f);
-    seek_to_next_block(f);
+    image.write(root_path);
+    image.seek_to_next_block();
+    image.write(joliet_root_path);
+    image.seek_to_next_block();
 
-    write(root_record, f);
-    write(root_parent_record, f);
+    image.write(root_record);
+    image.write(root_parent_record);
     for (const auto& iso_record : iso_file_records)
     {
-        write(iso_record, f);
+        image.write(iso_record);
     }
-    seek_to_next_block(f);
+    image.seek_to_next_block();
 
-    write(joliet_root_record, f);
-    write(joliet_root_parent_record, f);
+    image.write(joliet_root_record);
+    image.write(joliet_root_parent_record);
     for (const auto& joliet_record : joliet_file_records)
     {
-        write(joliet_record, f);
+        image.write(joliet_record);
     }
-    seek_to_next_block(f);
+    image.seek_to_next_block();
 
     for (const auto& entry : files)
     {
-        f.write(entry.data.data(), entry.data.size());
-        seek_to_next_block(f);
+        image.write(entry.data.data(), entry.data.size());
+        image.seek_to_next_block();
     }
-    pad_to_end(f);
+
+    return image.data();
+}
+
+void mp::CloudInitIso::write_to(const Path& path) const
+{
+    const auto image = to_bytes();
+
+    QFile f{path};
+    if (!f.open(QIODevice::WriteOnly))
+        throw std::runtime_error{"failed to open file for writing during cloud-init generation"};
+
+    // Written with a single call, the image is assembled in memory beforehand
+    if (f.write(image) != image.size())
+        throw std::runtime_error{"failed to write file during cloud-init generation"};
 }
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/logging/async_log_sink.h>
+#include <multipass/logging/logger.h>
+
+#include <multipass/format.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mpl = multipass::logging;
+
+struct mpl::AsyncLogSink::Queue : public std::enable_shared_from_this<Queue>
+{
+    Queue(WriteLine write_line, Overflow overflow, std::size_t max_queued)
+        : write_line{std::move(write_line)}, overflow{overflow}, max_queued{max_queued}
+    {
+    }
+
+    void push(std::string line)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        if (overflow == Overflow::block)
+            cv.wait(lock, [this] { return closed || lines.size() < max_queued; });
+
+        if (closed)
+            return;
+
+        if (lines.size() >= max_queued)
+        {
+            ++dropped;
+            return;
+        }
+
+        lines.push_back(std::move(line));
+        if (!writer.joinable() && !writing)
+        {
+            writing = true;
+            writer = std::thread{&Queue::write_queued, shared_from_this()};
+        }
+
+        cv.notify_all();
+    }
+
+    void close()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        closed = true;
+        auto finishing_writer = std::move(writer);
+        cv.notify_all();
+
+        if (finishing_writer.joinable())
+        {
+            lock.unlock();
+            finishing_writer.join();
+            lock.lock();
+        }
+
+        cv.wait(lock, [this] { return !writing; }); // when someone else is joining the writer
+    }
+
+    void write_queued()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (true)
+        {
+            cv.wait(lock, [this] { return closed || !lines.empty(); });
+            if (lines.empty())
+                break; // closed, with everything written
+
+            std::deque<std::string> batch;
+            batch.swap(lines);
+            auto dropped_lines = std::exchange(dropped, 0);
+
+            lock.unlock();
+            cv.notify_all(); // there is room again for those waiting
+
+            for (const auto& line : batch)
+                write_line(line);
+
+            if (dropped_lines)
+                write_line(fmt::format("[{}] [warning] [logging] {} log lines were dropped, as they came faster than "
+                                       "they could be written\n",
+                                       Logger::timestamp(), dropped_lines));
+
+            lock.lock();
+        }
+
+        writing = false;
+        cv.notify_all();
+    }
+
+    const WriteLine write_line;
+    const Overflow overflow;
+    const std::size_t max_queued;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> lines;
+    std::size_t dropped{0};
+    bool closed{false};
+    bool writing{false};
+    std::thread writer;
+};
+
+namespace
+{
+std::mutex queues_mutex;
+std::unordered_multimap<const void*, std::shared_ptr<mpl::AsyncLogSink::Queue>> queues; // by destination
+} // namespace
+
+mpl::AsyncLogSink::AsyncLogSink(const void* destination, WriteLine write_line, Overflow overflow,
+                                std::size_t max_queued)
+    : destination{destination}, queue{std::make_shared<Queue>(std::move(write_line), overflow, max_queued)}
+{
+    std::lock_guard<std::mutex> lock{queues_mutex};
+    queues.emplace(destination, queue);
+}
+
+mpl::AsyncLogSink::~AsyncLogSink()
+{
+    {
+        std::lock_guard<std::mutex> lock{queues_mutex};
+        auto [begin, end] = queues.equal_range(destination);
+        auto it = std::find_if(begin, end, [this](const auto& entry) { return entry.second == queue; });
+        if (it != end)
+            queues.erase(it);
+    }
+
+    queue->close();
+}
+
+void mpl::AsyncLogSink::push(std::string line)
+{
+    queue->push(std::move(line));
+}
+
+void mpl::AsyncLogSink::close()
+{
+    queue->close();
+}
+
+void mpl::AsyncLogSink::close_all_for(const void* destination)
+{
+    std::vector<std::shared_ptr<Queue>> closing;
+    {
+        std::lock_guard<std::mutex> lock{queues_mutex};
+        auto [begin, end] = queues.equal_range(destination);
+        for (auto it = begin; it != end; ++it)
+            closing.push_back(it->second);
+    }
+
+    for (const auto& queue : closing)
+        queue->close();
+}
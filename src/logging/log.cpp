@@ -22,6 +22,7 @@
 #include <QString>
 #include <QtGlobal>
 
+#include <atomic>
 #include <shared_mutex>
 #include <stdexcept>
 
@@ -31,6 +32,13 @@ namespace
 {
 std::shared_timed_mutex mutex;
 std::shared_ptr<multipass::logging::Logger> global_logger;
+std::atomic<mpl::Level> enabled_level{mpl::Level::trace}; // without a logger, everything goes to stderr
+
+void set_enabled_level() // requires the mutex
+{
+    enabled_level.store(global_logger ? global_logger->max_logging_level() : mpl::Level::trace,
+                        std::memory_order_relaxed);
+}
 
 mpl::Level to_level(QtMsgType type)
 {
@@ -79,9 +87,21 @@ void mpl::set_logger(std::shared_ptr<Logger> logger)
 {
     std::lock_guard<decltype(mutex)> lock{mutex};
     global_logger = std::move(logger);
+    set_enabled_level();
     qInstallMessageHandler(qt_message_handler);
 }
 
+bool mpl::enabled(Level level)
+{
+    return level <= enabled_level.load(std::memory_order_relaxed);
+}
+
+void mpl::refresh_enabled_level()
+{
+    std::lock_guard<decltype(mutex)> lock{mutex};
+    set_enabled_level();
+}
+
 auto mpl::get_logger() -> Logger* // for tests, don't rely on it lasting
 {
     return global_logger.get();
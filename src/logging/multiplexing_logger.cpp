@@ -15,6 +15,7 @@
  *
  */
 
+#include <multipass/logging/log.h>
 #include <multipass/logging/multiplexing_logger.h>
 
 #include <algorithm>
@@ -30,18 +31,71 @@ void mpl::MultiplexingLogger::log(mpl::Level level, CString category, CString me
 {
     std::shared_lock<decltype(mutex)> lock{mutex};
     system_logger->log(level, category, message);
-    for (auto logger : loggers)
+    if (loggers.empty())
+        return;
+
+    // Lines about an instance go to the requests about it alone, rather than to every client that is connected
+    const auto scoped = scoped_loggers.find(category.c_str());
+    if (scoped == scoped_loggers.end())
+    {
+        for (auto logger : loggers)
+            logger->log(level, category, message);
+        return;
+    }
+
+    for (auto logger : unscoped_loggers)
         logger->log(level, category, message);
+    for (auto logger : scoped->second)
+        logger->log(level, category, message);
+}
+
+mpl::Level mpl::MultiplexingLogger::max_logging_level() const
+{
+    std::shared_lock<decltype(mutex)> lock{mutex};
+    auto level = system_logger->max_logging_level();
+    for (auto logger : loggers)
+        level = std::max(level, logger->max_logging_level());
+
+    return level;
 }
 
 void mpl::MultiplexingLogger::add_logger(const Logger* logger)
 {
-    std::lock_guard<decltype(mutex)> lock{mutex};
-    loggers.push_back(logger);
+    add_logger(logger, {});
+}
+
+void mpl::MultiplexingLogger::add_logger(const Logger* logger, const std::vector<std::string>& categories)
+{
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+        loggers.push_back(logger);
+        if (categories.empty())
+            unscoped_loggers.push_back(logger);
+
+        for (const auto& category : categories)
+            scoped_loggers[category].push_back(logger);
+    }
+
+    refresh_enabled_level();
 }
 
 void mpl::MultiplexingLogger::remove_logger(const Logger* logger)
 {
-    std::lock_guard<decltype(mutex)> lock{mutex};
-    loggers.erase(std::remove(loggers.begin(), loggers.end(), logger), loggers.end());
+    auto erase_from = [logger](std::vector<const Logger*>& from) {
+        from.erase(std::remove(from.begin(), from.end(), logger), from.end());
+    };
+
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+        erase_from(loggers);
+        erase_from(unscoped_loggers);
+
+        for (auto it = scoped_loggers.begin(); it != scoped_loggers.end();)
+        {
+            erase_from(it->second);
+            it = it->second.empty() ? scoped_loggers.erase(it) : std::next(it);
+        }
+    }
+
+    refresh_enabled_level();
 }
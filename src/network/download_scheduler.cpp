@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/download_scheduler.h>
+
+#include <QUrl>
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+namespace
+{
+// Background transfers look again this often whether interactive ones are still around
+constexpr std::chrono::duration<double> max_pause{0.1};
+
+thread_local auto thread_priority = mp::DownloadPriority::interactive;
+} // namespace
+
+mp::DownloadScheduler::PriorityScope::PriorityScope(DownloadPriority priority) : previous{thread_priority}
+{
+    thread_priority = priority;
+}
+
+mp::DownloadScheduler::PriorityScope::~PriorityScope()
+{
+    thread_priority = previous;
+}
+
+mp::DownloadScheduler::Transfer::Transfer(DownloadScheduler& scheduler, const QString& host,
+                                          DownloadPriority priority)
+    : scheduler{scheduler}, host{host}, priority{priority}
+{
+}
+
+mp::DownloadScheduler::Transfer::~Transfer()
+{
+    {
+        std::lock_guard<std::mutex> lock{scheduler.mutex};
+        if (--scheduler.transfers[host] == 0)
+            scheduler.transfers.erase(host);
+        if (priority == DownloadPriority::interactive)
+            --scheduler.interactive_transfers;
+    }
+    scheduler.changed.notify_all();
+}
+
+void mp::DownloadScheduler::Transfer::pace(qint64 bytes)
+{
+    scheduler.pace(bytes, priority);
+}
+
+mp::DownloadScheduler::DownloadScheduler(int max_transfers_per_host) : max_transfers_per_host{max_transfers_per_host}
+{
+}
+
+mp::DownloadPriority mp::DownloadScheduler::current_priority()
+{
+    return thread_priority;
+}
+
+void mp::DownloadScheduler::set_rate_limit(qint64 bytes_per_second)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        rate = std::max<qint64>(bytes_per_second, 0);
+        tokens = static_cast<double>(rate);
+        refilled_at = std::chrono::steady_clock::now();
+    }
+    changed.notify_all();
+}
+
+auto mp::DownloadScheduler::start(const QUrl& url) -> std::unique_ptr<Transfer>
+{
+    const auto host = url.host();
+    const auto priority = current_priority();
+    const auto interactive = priority == DownloadPriority::interactive;
+
+    std::unique_lock<std::mutex> lock{mutex};
+    if (interactive)
+        ++interactive_waiting[host];
+
+    changed.wait(lock, [this, &host, interactive] {
+        auto waiting = interactive_waiting.find(host);
+        return transfers[host] < max_transfers_per_host &&
+               (interactive || waiting == interactive_waiting.end() || waiting->second == 0);
+    });
+
+    if (interactive)
+    {
+        if (--interactive_waiting[host] == 0)
+            interactive_waiting.erase(host);
+        ++interactive_transfers;
+    }
+    ++transfers[host];
+
+    return std::unique_ptr<Transfer>{new Transfer{*this, host, priority}};
+}
+
+void mp::DownloadScheduler::pace(qint64 bytes, DownloadPriority priority)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    while (rate > 0)
+    {
+        refill();
+
+        // What background transfers must leave in the bucket for interactive ones
+        const auto floor = priority == DownloadPriority::background && interactive_transfers > 0 ? rate / 2.0 : 0.0;
+        if (tokens >= floor)
+        {
+            tokens -= bytes; // into debt, if need be, which the next read waits out
+            return;
+        }
+
+        changed.wait_for(lock, std::min(std::chrono::duration<double>{(floor - tokens) / rate}, max_pause));
+    }
+}
+
+void mp::DownloadScheduler::refill()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration<double>{now - refilled_at}.count();
+
+    tokens = std::min(tokens + elapsed * rate, static_cast<double>(rate));
+    refilled_at = now;
+}
@@ -28,9 +28,11 @@ namespace mp = multipass;
 
 namespace
 {
-constexpr int len = 65536;
 constexpr int max_bytes = 32768;
 
+const QByteArray line_end{"\r\n"};
+const QByteArray headers_end{"\r\n\r\n"};
+
 // Status code mapping based on
 // https://github.com/qt/qtbase/blob/dev/src/network/access/qhttpthreaddelegate.cpp
 QNetworkReply::NetworkError statusCodeFromHttp(int httpStatusCode)
@@ -83,8 +85,8 @@ QNetworkReply::NetworkError statusCodeFromHttp(int httpStatusCode)
 } // namespace
 
 mp::LocalSocketReply::LocalSocketReply(LocalSocketUPtr local_socket, const QNetworkRequest& request,
-                                       QIODevice* outgoingData)
-    : QNetworkReply(), local_socket{std::move(local_socket)}, reply_data{QByteArray(len, '\0')}
+                                       QIODevice* outgoingData, SocketRelease release)
+    : QNetworkReply(), local_socket{std::move(local_socket)}, release{std::move(release)}
 {
     open(QIODevice::ReadOnly);
 
@@ -172,13 +174,13 @@ void mp::LocalSocketReply::send_request(const QNetworkRequest& request, QIODevic
         http_data += "User-Agent: " + user_agent + "\r\n";
     }
 
-    // Workaround weird issue in LXD's use of Go where Go's HTTP handler thinks there is more
-    // data and "sees" and "empty" query and reponds with an unexpected 400 error
-    http_data += "Connection: close\r\n";
-
+    // The connection is kept open for further requests (HTTP/1.1's default), so nothing may follow the end of this
+    // request: the empty line after the headers, the body as long as announced, or the last chunk
     if (!local_socket_write(http_data))
         return;
 
+    auto headers_done = false;
+
     if (op == "POST" || op == "PUT" || op == "PATCH")
     {
         http_data = "Content-Type: " + request.header(QNetworkRequest::ContentTypeHeader).toByteArray() + "\r\n";
@@ -213,6 +215,7 @@ void mp::LocalSocketReply::send_request(const QNetworkRequest& request, QIODevic
             if (!local_socket_write(http_data + "\r\n"))
                 return;
 
+            headers_done = !is_chunked; // the empty line after the last chunk ends a chunked request instead
             local_socket->flush();
 
             outgoingData->open(QIODevice::ReadOnly);
@@ -246,7 +249,7 @@ void mp::LocalSocketReply::send_request(const QNetworkRequest& request, QIODevic
         }
     }
 
-    if (!local_socket_write("\r\n"))
+    if (!headers_done && !local_socket_write("\r\n"))
         return;
 
     local_socket->flush();
@@ -254,62 +257,144 @@ void mp::LocalSocketReply::send_request(const QNetworkRequest& request, QIODevic
 
 void mp::LocalSocketReply::read_reply()
 {
-    auto data_ptr = reply_data.data() + reply_offset;
-    int bytes_read{0};
-
-    do
-    {
-        if (reply_offset + local_socket->bytesAvailable() > reply_data.length())
-        {
-            reply_data.append(len, '\0');
-            data_ptr = reply_data.data() + reply_offset;
-        }
+    reply_data.append(local_socket->readAll());
 
-        bytes_read = local_socket->read(data_ptr, len);
-
-        reply_offset += bytes_read;
-        data_ptr += bytes_read;
-    } while (bytes_read > 0);
+    if (!isFinished())
+        parse_reply();
 }
 
 void mp::LocalSocketReply::read_finish()
 {
+    if (isFinished())
+        return;
+
     if (local_socket->bytesAvailable())
         read_reply();
 
-    if (reply_offset)
-        parse_reply();
+    if (isFinished())
+        return;
 
-    setFinished(true);
-    emit finished();
+    // Whatever came until the server closed the connection is all there will be
+    if (body_offset < 0 && !reply_data.isEmpty())
+        parse_status(reply_data.left(reply_data.indexOf('\n')).trimmed());
+    else if (body_offset >= 0 && !chunked_transfer_encoding)
+        content_data = reply_data.mid(body_offset).trimmed();
+
+    finish(false);
 }
 
 void mp::LocalSocketReply::parse_reply()
 {
-    auto reply_lines = reply_data.split('\n');
-    auto it = reply_lines.constBegin();
+    if (body_offset < 0 && !parse_headers())
+        return;
+
+    if (chunked_transfer_encoding)
+    {
+        if (parse_chunks())
+            finish(keep_alive && body_offset == reply_data.size());
+    }
+    else if (content_length >= 0 && reply_data.size() - body_offset >= content_length)
+    {
+        content_data = reply_data.mid(body_offset, content_length);
+        finish(keep_alive && reply_data.size() - body_offset == content_length);
+    }
+    // Otherwise the body lasts until the server closes the connection
+}
+
+bool mp::LocalSocketReply::parse_headers()
+{
+    const auto end = reply_data.indexOf(headers_end);
+    if (end < 0)
+        return false;
 
-    parse_status(*it);
+    const auto lines = reply_data.left(end).split('\n');
+    const auto status = lines.first().trimmed();
+    parse_status(status);
+    keep_alive = status.startsWith("HTTP/1.1");
 
-    for (++it; it != reply_lines.constEnd(); ++it)
+    for (auto it = lines.cbegin() + 1; it != lines.cend(); ++it)
     {
-        if ((*it).contains("Transfer-Encoding") && (*it).contains("chunked"))
-            chunked_transfer_encoding = true;
+        const auto separator = it->indexOf(':');
+        if (separator < 0)
+            continue;
+
+        const auto name = it->left(separator).trimmed().toLower();
+        const auto value = it->mid(separator + 1).trimmed().toLower();
 
-        if ((*it).isEmpty() || (*it).startsWith('\r'))
+        if (name == "content-length")
         {
-            // Advance to the body
-            // Chunked transfer encoding also includes a line with the amount of
-            // bytes (in hex) in the chunk. We just skip it for now.
-            it = chunked_transfer_encoding ? it + 2 : it + 1;
+            bool ok;
+            content_length = value.toLongLong(&ok);
+            if (!ok)
+                content_length = -1;
+        }
+        else if (name == "transfer-encoding" && value.contains("chunked"))
+        {
+            chunked_transfer_encoding = true; // takes precedence over any length given
+        }
+        else if (name == "connection" && value.contains("close"))
+        {
+            keep_alive = false;
+        }
+    }
+
+    body_offset = end + headers_end.size();
+    return true;
+}
+
+// Decodes the chunks that are in, returning whether the last one is
+bool mp::LocalSocketReply::parse_chunks()
+{
+    while (true)
+    {
+        const auto size_end = reply_data.indexOf(line_end, body_offset);
+        if (size_end < 0)
+            return false;
 
-            content_data = (*it).trimmed();
+        bool ok;
+        const auto size_line = reply_data.mid(body_offset, size_end - body_offset);
+        const auto size = size_line.split(';').first().trimmed().toLongLong(&ok, 16); // ignoring chunk extensions
 
-            break;
+        if (!ok)
+        {
+            setError(QNetworkReply::ProtocolFailure, "Malformed chunk in HTTP response from server");
+            emit error(QNetworkReply::ProtocolFailure);
+
+            keep_alive = false;
+            return true;
         }
+
+        if (size == 0) // what trailers there are end with an empty line
+        {
+            const auto trailers_end = reply_data.indexOf(headers_end, size_end);
+            if (trailers_end < 0)
+                return false;
+
+            body_offset = trailers_end + headers_end.size();
+            return true;
+        }
+
+        const auto chunk_start = size_end + line_end.size();
+        if (reply_data.size() < chunk_start + size + line_end.size())
+            return false;
+
+        content_data.append(reply_data.mid(chunk_start, size));
+        body_offset = chunk_start + size + line_end.size();
     }
 }
 
+void mp::LocalSocketReply::finish(bool reusable)
+{
+    if (reusable && release)
+    {
+        QObject::disconnect(local_socket.get(), nullptr, this, nullptr);
+        release(std::move(local_socket));
+    }
+
+    setFinished(true);
+    emit finished();
+}
+
 void mp::LocalSocketReply::parse_status(const QByteArray& status)
 {
     QRegularExpression http_status_regex{"^HTTP/\\d\\.\\d (?P<status>\\d{3})\\ (?P<message>.*)$"};
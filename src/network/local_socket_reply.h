@@ -24,6 +24,7 @@
 #include <QNetworkRequest>
 #include <QString>
 
+#include <functional>
 #include <memory>
 
 namespace multipass
@@ -34,7 +35,11 @@ class LocalSocketReply : public QNetworkReply
 {
     Q_OBJECT
 public:
-    LocalSocketReply(LocalSocketUPtr local_socket, const QNetworkRequest& request, QIODevice* outgoingData);
+    // Takes back connections that can carry another request once the reply is complete
+    using SocketRelease = std::function<void(LocalSocketUPtr)>;
+
+    LocalSocketReply(LocalSocketUPtr local_socket, const QNetworkRequest& request, QIODevice* outgoingData,
+                     SocketRelease release = nullptr);
     LocalSocketReply();
     virtual ~LocalSocketReply();
 
@@ -52,14 +57,20 @@ private slots:
 private:
     void send_request(const QNetworkRequest& request, QIODevice* outgoingData);
     void parse_reply();
+    bool parse_headers();
+    bool parse_chunks();
     void parse_status(const QByteArray& status);
+    void finish(bool reusable);
     bool local_socket_write(const QByteArray& data);
 
     LocalSocketUPtr local_socket;
+    SocketRelease release;
     QByteArray reply_data;
-    qint64 reply_offset{0};
     qint64 offset{0};
+    qint64 body_offset{-1}; // where the body starts in reply_data, once the headers are in
+    qint64 content_length{-1};
     bool chunked_transfer_encoding{false};
+    bool keep_alive{false};
 };
 } // namespace multipass
 
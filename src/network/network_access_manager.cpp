@@ -21,12 +21,25 @@
 #include <multipass/format.h>
 #include <multipass/network_access_manager.h>
 
+#include <QPointer>
+#include <QThread>
+
 namespace mp = multipass;
 
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+constexpr auto max_idle_sockets = 4u; // per thread and socket path
+constexpr auto max_idle_time = 15s;   // servers close idle connections eventually; better not to find out mid-request
+} // namespace
+
 mp::NetworkAccessManager::NetworkAccessManager(QObject* parent) : QNetworkAccessManager(parent)
 {
 }
 
+mp::NetworkAccessManager::~NetworkAccessManager() = default;
+
 QNetworkReply* mp::NetworkAccessManager::createRequest(QNetworkAccessManager::Operation operation,
                                                        const QNetworkRequest& orig_request, QIODevice* device)
 {
@@ -47,13 +60,18 @@ QNetworkReply* mp::NetworkAccessManager::createRequest(QNetworkAccessManager::Op
 
         const auto socket_path = QUrl(url_parts[0]).path();
 
-        LocalSocketUPtr local_socket = std::make_unique<QLocalSocket>();
+        LocalSocketUPtr local_socket = take_idle_socket(socket_path);
 
-        local_socket->connectToServer(socket_path);
-        if (!local_socket->waitForConnected(5000))
+        if (!local_socket)
         {
-            throw LocalSocketConnectionException(
-                fmt::format("Cannot connect to {}: {}", socket_path, local_socket->errorString()));
+            local_socket = std::make_unique<QLocalSocket>();
+
+            local_socket->connectToServer(socket_path);
+            if (!local_socket->waitForConnected(5000))
+            {
+                throw LocalSocketConnectionException(
+                    fmt::format("Cannot connect to {}: {}", socket_path, local_socket->errorString()));
+            }
         }
 
         const auto server_path = url_parts[1];
@@ -64,11 +82,65 @@ QNetworkReply* mp::NetworkAccessManager::createRequest(QNetworkAccessManager::Op
 
         request.setUrl(url);
 
+        auto release = [manager = QPointer<NetworkAccessManager>{this}, socket_path](LocalSocketUPtr socket) {
+            if (manager)
+                manager->keep_idle_socket(socket_path, std::move(socket));
+        };
+
         // The caller needs to be responsible for freeing the allocated memory
-        return new LocalSocketReply(std::move(local_socket), request, device);
+        return new LocalSocketReply(std::move(local_socket), request, device, release);
     }
     else
     {
         return QNetworkAccessManager::createRequest(operation, orig_request, device);
     }
 }
+
+std::unique_ptr<QLocalSocket> mp::NetworkAccessManager::take_idle_socket(const QString& socket_path)
+{
+    std::lock_guard<std::mutex> lock{idle_mutex};
+
+    auto it = idle_sockets.find({QThread::currentThread(), socket_path});
+    if (it == idle_sockets.end())
+        return nullptr;
+
+    auto& idle = it->second;
+    while (!idle.empty())
+    {
+        auto candidate = std::move(idle.back());
+        idle.pop_back();
+
+        // Lets the socket notice if the server hung up in the meantime; it has no business sending anything else
+        candidate.socket->waitForReadyRead(0);
+
+        if (std::chrono::steady_clock::now() - candidate.since < max_idle_time &&
+            candidate.socket->state() == QLocalSocket::ConnectedState && !candidate.socket->bytesAvailable())
+            return std::move(candidate.socket);
+    }
+
+    return nullptr;
+}
+
+void mp::NetworkAccessManager::keep_idle_socket(const QString& socket_path, std::unique_ptr<QLocalSocket> socket)
+{
+    const auto thread = QThread::currentThread();
+    std::lock_guard<std::mutex> lock{idle_mutex};
+
+    auto [it, inserted] = idle_sockets.try_emplace(PoolKey{thread, socket_path});
+    if (inserted) // sockets belong to their thread, so they go with it
+        QObject::connect(
+            thread, &QThread::finished, this, [this, thread] { drop_idle_sockets(thread); }, Qt::DirectConnection);
+
+    if (it->second.size() < max_idle_sockets)
+        it->second.push_back({std::move(socket), std::chrono::steady_clock::now()});
+    else
+        socket.release()->deleteLater(); // we may be in one of its signals
+}
+
+void mp::NetworkAccessManager::drop_idle_sockets(QThread* thread)
+{
+    std::lock_guard<std::mutex> lock{idle_mutex};
+
+    for (auto it = idle_sockets.begin(); it != idle_sockets.end();)
+        it = it->first.first == thread ? idle_sockets.erase(it) : std::next(it);
+}
@@ -22,16 +22,27 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
+#include <multipass/sha256.h>
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkDiskCache>
 #include <QNetworkReply>
+#include <QThread>
 #include <QTimer>
 #include <QUrl>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -39,7 +50,47 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "url downloader";
+constexpr auto min_segmented_download_size = 64ll * 1024 * 1024;
 using NetworkReplyUPtr = std::unique_ptr<QNetworkReply>;
+using RawHeaders = std::vector<std::pair<QByteArray, QByteArray>>;
+
+// The validator (ETag or Last-Modified) recorded for a partial download of url into file_name, if there is one
+QByteArray resume_validator_for(const QUrl& url, const QString& file_name)
+{
+    QFile resume_info_file{mp::URLDownloader::resume_info_path_for(file_name)};
+    if (!resume_info_file.open(QIODevice::ReadOnly))
+        return {};
+
+    const auto resume_info = QJsonDocument::fromJson(resume_info_file.readAll()).object();
+    if (resume_info["url"].toString() != url.toString())
+        return {};
+
+    return resume_info["validator"].toString().toUtf8();
+}
+
+void record_resume_info(const QUrl& url, const QString& file_name, const QNetworkReply* reply)
+{
+    const auto resume_info_path = mp::URLDownloader::resume_info_path_for(file_name);
+    const auto validator = reply->hasRawHeader("ETag") ? reply->rawHeader("ETag") : reply->rawHeader("Last-Modified");
+
+    // Without a validator, there would be no telling whether a later request still gets the same file
+    if (validator.isEmpty())
+    {
+        QFile::remove(resume_info_path);
+        return;
+    }
+
+    QFile resume_info_file{resume_info_path};
+    if (resume_info_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        resume_info_file.write(
+            QJsonDocument{QJsonObject{{"url", url.toString()}, {"validator", QString::fromUtf8(validator)}}}.toJson());
+}
+
+bool resumes_from(const QNetworkReply* reply, qint64 offset)
+{
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206 &&
+           reply->rawHeader("Content-Range").startsWith("bytes " + QByteArray::number(offset) + "-");
+}
 
 auto make_network_manager(const mp::Path& cache_dir_path)
 {
@@ -57,6 +108,17 @@ auto make_network_manager(const mp::Path& cache_dir_path)
     return manager;
 }
 
+// Requests to the same server share the connections, and TLS sessions, of their manager, and go over a single
+// connection where the server speaks HTTP/2
+QNetworkRequest request_for(const QUrl& url)
+{
+    QNetworkRequest request{url};
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    return request;
+}
+
 void wait_for_reply(QNetworkReply* reply, QTimer& download_timeout)
 {
     QEventLoop event_loop;
@@ -74,15 +136,16 @@ void wait_for_reply(QNetworkReply* reply, QTimer& download_timeout)
 template <typename ProgressAction, typename DownloadAction, typename ErrorAction, typename Time>
 QByteArray download(QNetworkAccessManager* manager, const Time& timeout, QUrl const& url, ProgressAction&& on_progress,
                     DownloadAction&& on_download, ErrorAction&& on_error, const std::atomic_bool& abort_download,
-                    const bool force_cache = false)
+                    const RawHeaders& raw_headers = {}, const bool force_cache = false)
 {
     QTimer download_timeout;
     download_timeout.setInterval(timeout);
 
-    QNetworkRequest request{url};
+    auto request = request_for(url);
+    for (const auto& raw_header : raw_headers)
+        request.setRawHeader(raw_header.first, raw_header.second);
     request.setRawHeader("Connection", "Keep-Alive");
     request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
-    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
                          force_cache ? QNetworkRequest::AlwaysCache : QNetworkRequest::PreferNetwork);
 
@@ -113,7 +176,8 @@ QByteArray download(QNetworkAccessManager* manager, const Time& timeout, QUrl co
         {
             mpl::log(mpl::Level::warning, category,
                      fmt::format("Error getting {}: {} - trying cache.", url.toString(), msg));
-            return ::download(manager, timeout, url, on_progress, on_download, on_error, abort_download, true);
+            return ::download(manager, timeout, url, on_progress, on_download, on_error, abort_download, raw_headers,
+                              true);
         }
     }
 
@@ -131,10 +195,7 @@ auto get_header(QNetworkAccessManager* manager, const QUrl& url, const QNetworkR
     QTimer download_timeout;
     download_timeout.setInterval(timeout);
 
-    QNetworkRequest request{url};
-    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
-
-    NetworkReplyUPtr reply{manager->head(request)};
+    NetworkReplyUPtr reply{manager->head(request_for(url))};
 
     wait_for_reply(reply.get(), download_timeout);
 
@@ -149,6 +210,262 @@ auto get_header(QNetworkAccessManager* manager, const QUrl& url, const QNetworkR
 
     return reply->header(header);
 }
+
+template <typename Time>
+bool accepts_byte_ranges(QNetworkAccessManager* manager, const QUrl& url, int64_t size, const Time& timeout)
+{
+    QTimer download_timeout;
+    download_timeout.setInterval(timeout);
+
+    NetworkReplyUPtr reply{manager->head(request_for(url))};
+
+    wait_for_reply(reply.get(), download_timeout);
+
+    return reply->error() == QNetworkReply::NoError && reply->rawHeader("Accept-Ranges").trimmed() == "bytes" &&
+           reply->header(QNetworkRequest::ContentLengthHeader).toLongLong() == size;
+}
+
+// Fetches a file as a number of byte ranges at once, each over its own connection, straight into their place in a
+// preallocated file. A segment that fails, or goes quiet for as long as the timeout, is resumed from where it got to.
+class SegmentedDownload
+{
+public:
+    using ProgressAction = std::function<bool(qint64)>;
+
+    SegmentedDownload(QNetworkAccessManager* manager, const QUrl& url, QFile& file, qint64 size,
+                      std::chrono::milliseconds timeout, mp::Sha256* hash,
+                      mp::DownloadScheduler::Transfer& transfer)
+        : manager{manager}, url{url}, file{file}, hash{hash}, transfer{transfer}, timeout{timeout}
+    {
+        const auto segment_size = (size + segment_count - 1) / segment_count;
+        for (qint64 start = 0; start < size; start += segment_size)
+            segments.push_back({start, std::min(start + segment_size, size)});
+
+        for (std::size_t i = 0; i < segments.size(); ++i)
+        {
+            auto& inactivity_timeout = segments[i].inactivity_timeout;
+            inactivity_timeout = std::make_unique<QTimer>();
+            inactivity_timeout->setSingleShot(true);
+            QObject::connect(inactivity_timeout.get(), &QTimer::timeout, [this, i] { on_stalled(i); });
+        }
+    }
+
+    // Returns whether all the segments were fetched, throwing if the download is aborted by on_progress
+    bool run(const ProgressAction& on_progress)
+    {
+        progress_action = on_progress;
+
+        for (std::size_t i = 0; i < segments.size(); ++i)
+            start_segment(i);
+
+        event_loop.exec();
+
+        if (aborted)
+            throw mp::AbortedDownloadException{"Operation canceled"};
+
+        return !failed;
+    }
+
+private:
+    struct Segment
+    {
+        qint64 start;
+        qint64 end;
+        qint64 received{0};
+        int attempts{0};
+        NetworkReplyUPtr reply{};
+        std::unique_ptr<QTimer> inactivity_timeout{}; // restarted with each bit of data the segment gets
+    };
+
+    void start_segment(std::size_t index)
+    {
+        auto& segment = segments[index];
+
+        QNetworkRequest request{url};
+        request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false); // it would put them all on one connection
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setRawHeader("Range", QByteArray{"bytes="} + QByteArray::number(segment.start + segment.received) +
+                                          "-" + QByteArray::number(segment.end - 1));
+
+        segment.reply.reset(manager->get(request));
+        QObject::connect(segment.reply.get(), &QNetworkReply::readyRead, [this, index] { on_ready_read(index); });
+        QObject::connect(segment.reply.get(), &QNetworkReply::finished, [this, index] { on_finished(index); });
+        segment.inactivity_timeout->start(timeout);
+    }
+
+    void on_stalled(std::size_t index)
+    {
+        auto& segment = segments[index];
+        if (stopping || !segment.reply)
+            return;
+
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("Network timeout getting segment at {} of {}", segment.start + segment.received,
+                             url.toString()));
+        segment.reply->abort(); // it finishes in error, to be resumed like any other failed segment
+    }
+
+    void on_ready_read(std::size_t index)
+    {
+        auto& segment = segments[index];
+        if (stopping)
+            return;
+
+        if (segment.reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("Range requests were ignored for {}", url.toString()));
+            stop(true);
+            return;
+        }
+
+        const auto data = segment.reply->read(segment.end - segment.start - segment.received);
+        if (data.isEmpty())
+            return;
+
+        QElapsedTimer pacing;
+        pacing.start();
+        transfer.pace(data.size());
+
+        // Waiting on the rate limit is not the server's doing, so it does not count against any segment
+        const auto paced = std::chrono::milliseconds{pacing.elapsed()};
+        for (auto& other : segments)
+            if (other.reply && &other != &segment && paced.count() > 0)
+                other.inactivity_timeout->start(
+                    std::chrono::milliseconds{std::max(0, other.inactivity_timeout->remainingTime())} + paced);
+        segment.inactivity_timeout->start(timeout);
+
+        const auto offset = segment.start + segment.received;
+        if (!file.seek(offset) || MP_FILEOPS.write(file, data) < 0)
+        {
+            mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
+            stop(true);
+            return;
+        }
+
+        segment.received += data.size();
+        bytes_received += data.size();
+        MP_PERF_COUNTERS.counter("multipass_downloaded_bytes", {}) += data.size();
+
+        if (hash && offset == hashed_offset)
+        {
+            hash->add_data(data);
+            hashed_offset += data.size();
+        }
+        advance_hash();
+
+        if (!progress_action(bytes_received))
+        {
+            aborted = true;
+            stop(false);
+        }
+    }
+
+    void on_finished(std::size_t index)
+    {
+        auto& segment = segments[index];
+        if (stopping)
+            return;
+
+        if (segment.reply->bytesAvailable() > 0)
+            on_ready_read(index);
+
+        if (stopping)
+            return;
+
+        segment.inactivity_timeout->stop();
+
+        // The reply is deleted later, since this runs from one of its signals
+        auto reply = segment.reply.release();
+        reply->deleteLater();
+
+        if (segment.start + segment.received == segment.end)
+        {
+            if (std::all_of(segments.cbegin(), segments.cend(),
+                            [](const Segment& s) { return s.start + s.received == s.end; }))
+                event_loop.quit();
+        }
+        else if (reply->error() == QNetworkReply::NoError &&
+                 reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("Range requests were ignored for {}", url.toString()));
+            stop(true);
+        }
+        else if (++segment.attempts < max_segment_attempts)
+        {
+            mpl::log(mpl::Level::debug, category,
+                     fmt::format("Resuming segment at {} of {}: {}", segment.start + segment.received, url.toString(),
+                                 reply->errorString()));
+            start_segment(index);
+        }
+        else
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Error getting segment of {}: {}", url.toString(), reply->errorString()));
+            stop(true);
+        }
+    }
+
+    // Bytes can only be hashed in order, so whatever arrived ahead of the hashed part is read back once it is reached
+    void advance_hash()
+    {
+        if (!hash)
+            return;
+
+        for (const auto& segment : segments)
+        {
+            const auto available = segment.start + segment.received;
+            if (hashed_offset < segment.start || available <= hashed_offset)
+                continue;
+
+            if (!file.seek(hashed_offset))
+                return;
+
+            while (hashed_offset < available)
+            {
+                const auto data = file.read(std::min<qint64>(available - hashed_offset, 1 << 20));
+                if (data.isEmpty())
+                    return;
+
+                hash->add_data(data);
+                hashed_offset += data.size();
+            }
+        }
+    }
+
+    void stop(bool has_failed)
+    {
+        failed = has_failed;
+        stopping = true;
+
+        for (auto& segment : segments)
+        {
+            segment.inactivity_timeout->stop();
+            if (segment.reply)
+                segment.reply->abort();
+        }
+
+        event_loop.quit();
+    }
+
+    static constexpr qint64 segment_count = 4;
+    static constexpr int max_segment_attempts = 3;
+
+    QNetworkAccessManager* manager;
+    const QUrl url;
+    QFile& file;
+    mp::Sha256* hash;
+    mp::DownloadScheduler::Transfer& transfer;
+    const std::chrono::milliseconds timeout; // of each segment, for going without data
+    std::vector<Segment> segments;
+    ProgressAction progress_action;
+    QEventLoop event_loop;
+    qint64 bytes_received{0};
+    qint64 hashed_offset{0};
+    bool stopping{false};
+    bool failed{false};
+    bool aborted{false};
+};
 } // namespace
 
 mp::NetworkManagerFactory::NetworkManagerFactory(const Singleton<NetworkManagerFactory>::PrivatePass& pass) noexcept
@@ -171,20 +488,219 @@ mp::URLDownloader::URLDownloader(const mp::Path& cache_dir, std::chrono::millise
 {
 }
 
+QNetworkAccessManager* mp::URLDownloader::network_manager()
+{
+    auto thread = QThread::currentThread();
+
+    std::lock_guard<std::mutex> lock{managers_mutex};
+    auto& manager = managers[thread];
+    if (!manager)
+    {
+        manager = MP_NETMGRFACTORY.make_network_manager(cache_dir_path);
+
+        // Managers belong to the thread they were made on, and go away with it
+        QObject::connect(thread, &QThread::finished, manager.get(), [this, thread] {
+            std::lock_guard<std::mutex> lock{managers_mutex};
+            if (auto it = managers.find(thread); it != managers.end())
+                it->second.release()->deleteLater(); // deleted as the thread finishes, right after this
+            managers.erase(thread);
+        }, Qt::DirectConnection);
+    }
+
+    return manager.get();
+}
+
 void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
                                     const mp::ProgressMonitor& monitor)
 {
-    std::atomic_bool abort_download{false};
-    auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
+    download_to_file(url, file_name, size, download_type, monitor, nullptr);
+}
+
+QString mp::URLDownloader::download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size,
+                                                const int download_type, const mp::ProgressMonitor& monitor)
+{
+    Sha256 hash;
+    download_to_file(url, file_name, size, download_type, monitor, &hash);
+
+    return hash.result().toHex();
+}
+
+QString mp::URLDownloader::stream_and_hash(const QUrl& url, int64_t size, const int download_type,
+                                           const mp::ProgressMonitor& monitor, const DataSink& sink)
+{
+    Sha256 hash;
+    auto on_data = [&hash, &sink](const QByteArray& data) {
+        hash.add_data(data);
+        return sink(data);
+    };
+
+    auto manager = network_manager();
+    download_chunks(manager, url, size, download_type, monitor, {}, [](auto) { return 0; }, on_data, [] {});
+
+    return hash.result().toHex();
+}
+
+void mp::URLDownloader::download_to_file(const QUrl& url, const QString& file_name, int64_t size,
+                                         const int download_type, const mp::ProgressMonitor& monitor,
+                                         mp::Sha256* hash)
+{
+    const auto candidates = with_mirrors(url);
+    for (std::size_t i = 0;; ++i)
+    {
+        try
+        {
+            return download_to_file_from(candidates[i], file_name, size, download_type, monitor, hash);
+        }
+        catch (const mp::DownloadException& e)
+        {
+            if (i + 1 == candidates.size())
+                throw;
+
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("{} - trying {}", e.what(), candidates[i + 1].toString()));
+            if (hash)
+                hash->reset();
+        }
+    }
+}
+
+void mp::URLDownloader::download_to_file_from(const QUrl& url, const QString& file_name, int64_t size,
+                                              const int download_type, const mp::ProgressMonitor& monitor,
+                                              mp::Sha256* hash)
+{
+    auto manager = network_manager();
 
+    // Large files come faster over several connections, when the server allows fetching them in parts
+    if (size >= min_segmented_download_size && !QFile::exists(resume_info_path_for(file_name)) &&
+        accepts_byte_ranges(manager, url, size, timeout) &&
+        download_in_segments(manager, url, file_name, size, download_type, monitor, hash))
+        return;
+
+    // What was fetched by an earlier, interrupted attempt is completed rather than fetched again, unless the
+    // server no longer has the same file
     QFile file{file_name};
-    file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+    const auto validator = resume_validator_for(url, file_name);
+    const auto resume_from = validator.isEmpty() ? 0 : QFileInfo{file_name}.size();
+    RawHeaders raw_headers;
+
+    if (resume_from > 0)
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Resuming download of {} from byte {}", url.toString(), resume_from));
+
+        file.open(QIODevice::ReadWrite | QIODevice::Append);
+        raw_headers = {{"Range", "bytes=" + QByteArray::number(resume_from) + "-"}, {"If-Range", validator}};
+    }
+    else
+    {
+        file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+    }
+
+    auto on_response = [&url, &file, &file_name, hash, resume_from](QNetworkReply* reply) -> qint64 {
+        record_resume_info(url, file_name, reply);
+
+        if (resume_from > 0 && resumes_from(reply, resume_from))
+        {
+            // The partial hash cannot be stored, so it is rebuilt from what is already on disk
+            if (hash && file.seek(0))
+                hash->add_data(file);
+
+            file.seek(resume_from);
+            return resume_from;
+        }
+
+        file.resize(0);
+        file.seek(0);
+        if (hash)
+            hash->reset();
+
+        return 0;
+    };
+
+    auto on_data = [&file, hash](const QByteArray& data) {
+        if (MP_FILEOPS.write(file, data) < 0)
+        {
+            mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
+            return false;
+        }
+
+        MP_PERF_COUNTERS.counter("multipass_downloaded_bytes", {}) += data.size();
+
+        // Hash the bytes as they are written, so verifying the image does not require reading it back
+        if (hash)
+            hash->add_data(data);
+
+        return true;
+    };
+
+    // A failed download is kept for resuming when the server made that possible
+    auto on_error = [&file, &file_name]() {
+        if (file.size() == 0 || !QFile::exists(resume_info_path_for(file_name)))
+        {
+            file.remove();
+            QFile::remove(resume_info_path_for(file_name));
+        }
+    };
+
+    download_chunks(manager, url, size, download_type, monitor, raw_headers, on_response, on_data, on_error);
+
+    QFile::remove(resume_info_path_for(file_name));
+}
+
+bool mp::URLDownloader::download_in_segments(QNetworkAccessManager* manager, const QUrl& url, const QString& file_name,
+                                             int64_t size, const int download_type,
+                                             const mp::ProgressMonitor& monitor, mp::Sha256* hash)
+{
+    QFile file{file_name};
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file.resize(size))
+        return false;
+
+    auto on_progress = [this, &monitor, download_type, size](qint64 bytes_received) {
+        return !abort_downloads && monitor(download_type, (100 * bytes_received + size / 2) / size);
+    };
 
-    auto progress_monitor = [this, &abort_download, &monitor, download_type,
+    auto transfer = scheduler.start(url);
+    SegmentedDownload segmented_download{manager, url, file, size, timeout, hash, *transfer};
+
+    try
+    {
+        if (segmented_download.run(on_progress))
+            return true;
+    }
+    catch (const AbortedDownloadException&)
+    {
+        file.remove();
+        throw;
+    }
+
+    mpl::log(mpl::Level::warning, category,
+             fmt::format("Segmented download of {} failed - retrying as a single stream.", url.toString()));
+
+    if (hash)
+        hash->reset();
+
+    return false;
+}
+
+void mp::URLDownloader::download_chunks(QNetworkAccessManager* manager, const QUrl& url, int64_t size,
+                                        const int download_type, const mp::ProgressMonitor& monitor,
+                                        const RawHeaders& raw_headers, const ResponseAction& on_response,
+                                        const DataSink& on_data, const std::function<void()>& on_error)
+{
+    std::atomic_bool abort_download{false};
+    QNetworkReply* responding_reply{nullptr};
+    qint64 existing_bytes{0};
+    auto transfer = scheduler.start(url);
+
+    auto progress_monitor = [this, &abort_download, &monitor, &existing_bytes, download_type,
                              size](QNetworkReply* reply, qint64 bytes_received, qint64 bytes_total) {
         if (bytes_received == 0)
             return;
 
+        bytes_received += existing_bytes;
+        if (bytes_total != -1)
+            bytes_total += existing_bytes;
+
         if (bytes_total == -1 && size > 0)
             bytes_total = size;
 
@@ -198,7 +714,8 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         }
     };
 
-    auto on_download = [this, &abort_download, &file](QNetworkReply* reply, QTimer& download_timeout) {
+    auto on_download = [this, &abort_download, &on_data, &on_response, &responding_reply, &existing_bytes,
+                        &transfer](QNetworkReply* reply, QTimer& download_timeout) {
         abort_download = abort_download || abort_downloads;
 
         if (abort_download)
@@ -212,23 +729,33 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         else
             return;
 
-        if (MP_FILEOPS.write(file, reply->readAll()) < 0)
+        if (reply != responding_reply)
+        {
+            responding_reply = reply;
+            existing_bytes = on_response(reply);
+        }
+
+        const auto data = reply->readAll();
+        if (!on_data(data))
         {
-            mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
             abort_download = true;
             reply->abort();
         }
+        transfer->pace(data.size());
         download_timeout.start();
     };
 
-    auto on_error = [&file]() { file.remove(); };
+    ::download(manager, timeout, url, progress_monitor, on_download, on_error, abort_download, raw_headers);
+}
 
-    ::download(manager.get(), timeout, url, progress_monitor, on_download, on_error, abort_download);
+QString mp::URLDownloader::resume_info_path_for(const QString& file_name)
+{
+    return file_name + ".partial";
 }
 
 QByteArray mp::URLDownloader::download(const QUrl& url)
 {
-    auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
+    auto manager = network_manager();
 
     // This will connect to the QNetworkReply::readReady signal and when emitted,
     // reset the timer.
@@ -243,17 +770,105 @@ QByteArray mp::URLDownloader::download(const QUrl& url)
     };
 
     return ::download(
-        manager.get(), timeout, url, [](QNetworkReply*, qint64, qint64) {}, on_download, [] {}, abort_downloads);
+        manager, timeout, url, [](QNetworkReply*, qint64, qint64) {}, on_download, [] {}, abort_downloads);
+}
+
+mp::optional<QByteArray> mp::URLDownloader::download_if_changed(const QUrl& url, DownloadValidators& validators)
+{
+    auto manager = network_manager();
+
+    QTimer download_timeout;
+    download_timeout.setInterval(timeout);
+
+    auto request = request_for(url);
+    if (!validators.etag.isEmpty())
+        request.setRawHeader("If-None-Match", validators.etag);
+    if (!validators.last_modified.isEmpty())
+        request.setRawHeader("If-Modified-Since", validators.last_modified);
+
+    // The validators stand in for the network cache here, which must not answer a 304 on the caller's behalf
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+
+    NetworkReplyUPtr reply{manager->get(request)};
+    QObject::connect(reply.get(), &QNetworkReply::readyRead, [this, &reply, &download_timeout] {
+        if (abort_downloads)
+            reply->abort();
+        else
+            download_timeout.start();
+    });
+
+    wait_for_reply(reply.get(), download_timeout);
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        const auto msg = download_timeout.isActive() ? reply->errorString().toStdString() : "Network timeout";
+
+        if (abort_downloads)
+            throw mp::AbortedDownloadException{msg};
+
+        throw mp::DownloadException{url.toString().toStdString(), msg};
+    }
+
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{} has not changed", url.toString()));
+        return nullopt;
+    }
+
+    validators = {reply->rawHeader("ETag"), reply->rawHeader("Last-Modified")};
+    return reply->readAll();
 }
 
 QDateTime mp::URLDownloader::last_modified(const QUrl& url)
 {
-    auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
+    auto manager = network_manager();
 
-    return get_header(manager.get(), url, QNetworkRequest::LastModifiedHeader, timeout).toDateTime();
+    return get_header(manager, url, QNetworkRequest::LastModifiedHeader, timeout).toDateTime();
 }
 
 void mp::URLDownloader::abort_all_downloads()
 {
     abort_downloads = true;
 }
+
+void mp::URLDownloader::set_rate_limit(qint64 bytes_per_second)
+{
+    scheduler.set_rate_limit(bytes_per_second);
+}
+
+void mp::URLDownloader::set_mirrors(const QStringList& ranked_base_urls)
+{
+    std::lock_guard<std::mutex> lock{mirrors_mutex};
+
+    // A new ranking of the same mirrors takes the place of the old one
+    auto overlaps = [&ranked_base_urls](const QStringList& group) {
+        auto is_ranked = [&ranked_base_urls](const QString& base_url) { return ranked_base_urls.contains(base_url); };
+        return std::any_of(group.cbegin(), group.cend(), is_ranked);
+    };
+    mirror_groups.erase(std::remove_if(mirror_groups.begin(), mirror_groups.end(), overlaps), mirror_groups.end());
+
+    if (ranked_base_urls.size() > 1)
+        mirror_groups.push_back(ranked_base_urls);
+}
+
+std::vector<QUrl> mp::URLDownloader::with_mirrors(const QUrl& url)
+{
+    std::vector<QUrl> candidates{url};
+    const auto url_string = url.toString();
+
+    std::lock_guard<std::mutex> lock{mirrors_mutex};
+    for (const auto& group : mirror_groups)
+        for (const auto& base_url : group)
+            if (url_string.startsWith(base_url))
+            {
+                const auto path = url_string.mid(base_url.size());
+                for (const auto& other : group)
+                    if (other != base_url)
+                        candidates.emplace_back(other + path);
+
+                return candidates;
+            }
+
+    return candidates;
+}
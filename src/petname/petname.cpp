@@ -63,19 +63,39 @@ mp::Petname::Petname(NumWords num_words, std::string separator)
 
 std::string mp::Petname::make_name()
 {
-    std::string name = multipass::petname::names[name_dist(engine)];
-    std::string adjective = multipass::petname::adjectives[adjective_dist(engine)];
-    std::string adverb = multipass::petname::adverbs[adverb_dist(engine)];
+    // Only the words that are used get copied, and into one buffer, since batch launches ask for many names at once
+    const std::string_view name = multipass::petname::names[name_dist(engine)];
 
     switch(num_words)
     {
     case NumWords::ONE:
-        return name;
+        return std::string{name};
     case NumWords::TWO:
-        return adjective + separator + name;
+    {
+        const std::string_view adjective = multipass::petname::adjectives[adjective_dist(engine)];
+        return join({adjective, name});
+    }
     case NumWords::THREE:
-        return adverb + separator + adjective + separator + name;
+    {
+        const std::string_view adverb = multipass::petname::adverbs[adverb_dist(engine)];
+        const std::string_view adjective = multipass::petname::adjectives[adjective_dist(engine)];
+        return join({adverb, adjective, name});
+    }
     default:
         throw std::invalid_argument("Invalid number of words chosen");
     }
 }
+
+std::string mp::Petname::join(std::initializer_list<std::string_view> words) const
+{
+    std::string joined;
+    joined.reserve(32);
+    for (const auto& word : words)
+    {
+        if (!joined.empty())
+            joined.append(separator);
+        joined.append(word);
+    }
+
+    return joined;
+}
@@ -22,8 +22,10 @@
 
 #include <multipass/name_generator.h>
 
+#include <initializer_list>
 #include <random>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace multipass
@@ -51,6 +53,8 @@ public:
     std::string make_name() override;
 
 private:
+    std::string join(std::initializer_list<std::string_view> words) const;
+
     std::string separator;
     NumWords num_words;
     std::mt19937 engine;
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "libvirt_event_subscriber.h"
+#include "libvirt_virtual_machine.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <chrono>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+constexpr auto category = "libvirt events";
+constexpr auto keep_alive_interval = 5; // in seconds
+constexpr auto keep_alive_count = 3;
+constexpr auto loop_wakeup_interval = 1000; // in milliseconds, to notice when to stop
+
+bool default_event_impl_registered{false}; // libvirt's event loop is process-wide
+std::mutex default_event_impl_mutex;
+
+bool register_default_event_impl(const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+{
+    std::lock_guard<std::mutex> lock{default_event_impl_mutex};
+    if (!default_event_impl_registered)
+        default_event_impl_registered = libvirt_wrapper->virEventRegisterDefaultImpl() == 0;
+
+    return default_event_impl_registered;
+}
+
+mp::optional<mp::LibvirtDomainState> domain_state_after(int event, int detail)
+{
+    switch (event)
+    {
+    case VIR_DOMAIN_EVENT_STARTED:
+    case VIR_DOMAIN_EVENT_RESUMED:
+        return mp::LibvirtDomainState{VIR_DOMAIN_RUNNING, false};
+    case VIR_DOMAIN_EVENT_SUSPENDED:
+        return mp::LibvirtDomainState{VIR_DOMAIN_PAUSED, false};
+    case VIR_DOMAIN_EVENT_STOPPED:
+        return mp::LibvirtDomainState{VIR_DOMAIN_SHUTOFF, detail == VIR_DOMAIN_EVENT_STOPPED_SAVED};
+    case VIR_DOMAIN_EVENT_SHUTDOWN:
+        return mp::LibvirtDomainState{VIR_DOMAIN_SHUTDOWN, false};
+    case VIR_DOMAIN_EVENT_PMSUSPENDED:
+        return mp::LibvirtDomainState{VIR_DOMAIN_PMSUSPENDED, false};
+    case VIR_DOMAIN_EVENT_CRASHED:
+        return mp::LibvirtDomainState{VIR_DOMAIN_CRASHED, false};
+    default: // (un)defined and whatever newer libvirt versions add: leave it to the next query
+        return mp::nullopt;
+    }
+}
+} // namespace
+
+mp::LibvirtEventSubscriber::LibvirtEventSubscriber(const LibvirtWrapper::UPtr& libvirt_wrapper)
+    : libvirt_wrapper{libvirt_wrapper}
+{
+}
+
+mp::LibvirtEventSubscriber::~LibvirtEventSubscriber()
+{
+    stopping = true;
+    if (event_loop.joinable())
+        event_loop.join(); // before deregistering, so that no callback is left running
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (libvirt_wrapper)
+    {
+        if (conn && callback_id >= 0)
+            libvirt_wrapper->virConnectDomainEventDeregisterAny(conn.get(), callback_id);
+        if (timer_id >= 0)
+            libvirt_wrapper->virEventRemoveTimeout(timer_id);
+    }
+}
+
+auto mp::LibvirtEventSubscriber::connection() -> ConnectionShPtr
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (conn && libvirt_wrapper && libvirt_wrapper->virConnectIsAlive(conn.get()) == 1)
+        return conn;
+
+    if (conn)
+        mpl::log(mpl::Level::info, category, "Lost the connection to libvirtd, reconnecting");
+
+    // Whatever was pushed on the old connection may have missed changes since
+    conn.reset();
+    callback_id = -1;
+    domain_states.clear();
+
+    const auto follow = libvirt_wrapper && register_default_event_impl(libvirt_wrapper);
+    conn = LibVirtVirtualMachine::open_libvirt_connection(libvirt_wrapper);
+
+    if (follow)
+        follow_events(conn.get());
+
+    return conn;
+}
+
+auto mp::LibvirtEventSubscriber::domain_state(const std::string& name) -> optional<LibvirtDomainState>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (auto it = domain_states.find(name); is_following() && it != domain_states.end())
+        return it->second;
+
+    return nullopt;
+}
+
+void mp::LibvirtEventSubscriber::note_domain_state(const std::string& name, const LibvirtDomainState& state)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (is_following())
+        domain_states.emplace(name, state);
+}
+
+void mp::LibvirtEventSubscriber::forget_domain(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    domain_states.erase(name);
+}
+
+void mp::LibvirtEventSubscriber::handle_lifecycle_event(const std::string& name, int event, int detail)
+{
+    mpl::log(mpl::Level::trace, category, fmt::format("Lifecycle event {} ({}) for {}", event, detail, name));
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (auto state = domain_state_after(event, detail))
+        domain_states[name] = *state;
+    else
+        domain_states.erase(name);
+}
+
+bool mp::LibvirtEventSubscriber::is_following() const
+{
+    return conn && callback_id >= 0 && libvirt_wrapper && libvirt_wrapper->virConnectIsAlive(conn.get()) == 1;
+}
+
+void mp::LibvirtEventSubscriber::follow_events(virConnectPtr conn)
+{
+    auto on_lifecycle_event = [](virConnectPtr, virDomainPtr domain, int event, int detail, void* opaque) -> int {
+        auto subscriber = static_cast<LibvirtEventSubscriber*>(opaque);
+        if (auto name = subscriber->libvirt_wrapper->virDomainGetName(domain))
+            subscriber->handle_lifecycle_event(name, event, detail);
+
+        return 0;
+    };
+
+    callback_id = libvirt_wrapper->virConnectDomainEventRegisterAny(
+        conn, nullptr, VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+        VIR_DOMAIN_EVENT_CALLBACK(static_cast<virConnectDomainEventCallback>(on_lifecycle_event)), this, nullptr);
+
+    if (callback_id < 0)
+    {
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("Cannot follow domain events: {}", libvirt_wrapper->virGetLastErrorMessage()));
+        return;
+    }
+
+    if (!event_loop.joinable())
+    {
+        timer_id = libvirt_wrapper->virEventAddTimeout(loop_wakeup_interval, [](int, void*) {}, nullptr, nullptr);
+        event_loop = std::thread{&LibvirtEventSubscriber::run_event_loop, this};
+    }
+
+    // Lets libvirt notice a dead libvirtd, on the event loop it now has, rather than leave us waiting on it
+    libvirt_wrapper->virConnectSetKeepAlive(conn, keep_alive_interval, keep_alive_count);
+}
+
+void mp::LibvirtEventSubscriber::run_event_loop()
+{
+    while (!stopping)
+    {
+        if (libvirt_wrapper->virEventRunDefaultImpl() < 0)
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Failed to run the event loop: {}", libvirt_wrapper->virGetLastErrorMessage()));
+            std::this_thread::sleep_for(1s);
+        }
+    }
+}
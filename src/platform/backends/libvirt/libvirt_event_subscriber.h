@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_LIBVIRT_EVENT_SUBSCRIBER_H
+#define MULTIPASS_LIBVIRT_EVENT_SUBSCRIBER_H
+
+#include "libvirt_wrapper.h"
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace multipass
+{
+struct LibvirtDomainState
+{
+    int state;         // a virDomainState
+    bool managed_save; // whether the domain has a managed save image to resume from
+};
+
+/**
+ * Keeps one connection to libvirtd for all of a factory's instances, and follows the lifecycle events of their
+ * domains on it, so that instances can go by the last pushed state instead of asking libvirtd each time. Until
+ * libvirtd takes the subscription, or once the connection drops, it knows nothing and instances ask as before.
+ * libvirt's event loop is process-wide, so there is meant to be a single one of these at a time.
+ */
+class LibvirtEventSubscriber : private DisabledCopyMove
+{
+public:
+    using ConnectionShPtr = std::shared_ptr<virConnect>;
+
+    // Needs to be a reference so that testing can override the various libvirt functions
+    explicit LibvirtEventSubscriber(const LibvirtWrapper::UPtr& libvirt_wrapper);
+    ~LibvirtEventSubscriber();
+
+    ConnectionShPtr connection(); // (re)opens it as needed; throws when libvirtd cannot be reached
+
+    optional<LibvirtDomainState> domain_state(const std::string& name);
+    void note_domain_state(const std::string& name, const LibvirtDomainState& state); // events that came first win
+    void forget_domain(const std::string& name);
+
+    void handle_lifecycle_event(const std::string& name, int event, int detail);
+
+private:
+    bool is_following() const; // requires the lock
+    void follow_events(virConnectPtr conn); // requires the lock
+    void run_event_loop();
+
+    const LibvirtWrapper::UPtr& libvirt_wrapper;
+    mutable std::mutex mutex;
+    ConnectionShPtr conn;
+    int callback_id{-1};
+    int timer_id{-1};
+    std::unordered_map<std::string, LibvirtDomainState> domain_states;
+    std::atomic<bool> stopping{false};
+    std::thread event_loop;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_LIBVIRT_EVENT_SUBSCRIBER_H
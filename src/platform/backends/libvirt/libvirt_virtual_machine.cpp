@@ -16,6 +16,7 @@
  */
 
 #include "libvirt_virtual_machine.h"
+#include "libvirt_event_subscriber.h"
 
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/format.h>
@@ -24,13 +25,19 @@
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/utils.h>
 #include <multipass/vm_status_monitor.h>
+#include <multipass/vsock.h>
 
 #include <shared/linux/backend_utils.h>
+#include <shared/linux/netlink.h>
 #include <shared/qemu_img_utils/qemu_img_utils.h>
 #include <shared/shared_backend_utils.h>
 
 #include <QXmlStreamReader>
 
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -57,21 +64,34 @@ auto instance_mac_addr_for(virDomainPtr domain, const mp::LibvirtWrapper::UPtr&
     return mac_addr;
 }
 
-auto instance_ip_for(const std::string& mac_addr, const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+// What libvirt picked for the running domain, as it picks anew each time the domain starts
+mp::optional<unsigned> instance_vsock_cid_for(virDomainPtr domain, const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
 {
-    mp::optional<mp::IPAddress> ip_address;
+    std::unique_ptr<char, decltype(free)*> desc{libvirt_wrapper->virDomainGetXMLDesc(domain, 0), free};
 
-    mp::LibVirtVirtualMachine::ConnectionUPtr connection{nullptr, nullptr};
-    try
-    {
-        connection = mp::LibVirtVirtualMachine::open_libvirt_connection(libvirt_wrapper);
-    }
-    catch (const std::exception&)
+    QXmlStreamReader reader(desc.get());
+
+    while (!reader.atEnd())
     {
-        return ip_address;
+        reader.readNext();
+
+        if (reader.isStartElement() && reader.name() == "cid")
+        {
+            bool ok = false;
+            const auto cid = reader.attributes().value("address").toUInt(&ok);
+            return ok ? mp::make_optional(cid) : mp::nullopt;
+        }
     }
 
-    mp::LibVirtVirtualMachine::NetworkUPtr network{libvirt_wrapper->virNetworkLookupByName(connection.get(), "default"),
+    return mp::nullopt;
+}
+
+auto instance_ip_for(const std::string& mac_addr, virConnectPtr connection,
+                     const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+{
+    mp::optional<mp::IPAddress> ip_address;
+
+    mp::LibVirtVirtualMachine::NetworkUPtr network{libvirt_wrapper->virNetworkLookupByName(connection, "default"),
                                                    libvirt_wrapper->virNetworkFree};
 
     virNetworkDHCPLeasePtr* leases = nullptr;
@@ -115,6 +135,91 @@ auto host_architecture_for(virConnectPtr connection, const mp::LibvirtWrapper::U
     return arch;
 }
 
+std::string cpuset_for(const std::vector<int>& cpus)
+{
+    return fmt::format("{}", fmt::join(cpus, ","));
+}
+
+// Memory backing, NUMA tuning, I/O threads and CPU pinning, when the instance asks for any
+std::string tuning_xml_for(const mp::VirtualMachineDescription& desc)
+{
+    const auto& placement = desc.placement;
+    const auto iothread = desc.disk_options.iothread;
+    std::string xml;
+
+    if (iothread)
+        xml += "  <iothreads>1</iothreads>\n";
+
+    if (placement.hugepages)
+        xml += "  <memoryBacking>\n"
+               "    <hugepages/>\n"
+               "  </memoryBacking>\n";
+
+    if (placement.numa_node)
+        xml += fmt::format("  <numatune>\n"
+                           "    <memory mode=\'strict\' nodeset=\'{}\'/>\n"
+                           "  </numatune>\n",
+                           *placement.numa_node);
+
+    if (!placement.vcpu_cpus.empty() || !placement.io_cpus.empty())
+    {
+        xml += "  <cputune>\n";
+        for (auto vcpu = 0; vcpu < desc.num_cores && !placement.vcpu_cpus.empty(); ++vcpu)
+            xml += fmt::format("    <vcpupin vcpu=\'{}\' cpuset=\'{}\'/>\n", vcpu,
+                               placement.vcpu_cpus[vcpu % placement.vcpu_cpus.size()]);
+        if (!placement.io_cpus.empty())
+            xml += fmt::format("    <emulatorpin cpuset=\'{}\'/>\n", cpuset_for(placement.io_cpus));
+        if (!placement.io_cpus.empty() && iothread)
+            xml += fmt::format("    <iothreadpin iothread=\'1\' cpuset=\'{}\'/>\n", cpuset_for(placement.io_cpus));
+        xml += "  </cputune>\n";
+    }
+
+    return xml;
+}
+
+// Extra attributes for the driver of the instance disk
+std::string disk_driver_attributes_for(const mp::VMDiskOptions& disk_options)
+{
+    std::string attributes;
+    if (disk_options != mp::VMDiskOptions{})
+        attributes += fmt::format(" cache=\'{}\' io=\'{}\'", disk_options.cache, disk_options.aio);
+    if (disk_options.iothread)
+        attributes += " iothread=\'1\'";
+    if (disk_options.queues > 1)
+        attributes += fmt::format(" queues=\'{}\'", disk_options.queues);
+    if (disk_options.detect_zeroes)
+        attributes += " detect_zeroes=\'unmap\'";
+
+    return attributes;
+}
+
+// The driver of the default interface, when it is tuned
+// A socket for the daemon to reach the guest's SSH server through, on hosts that can give the domain one
+std::string vsock_xml()
+{
+    if (!mp::vsock::available())
+        return {};
+
+    return "    <vsock model=\'virtio\'>\n"
+           "      <cid auto=\'yes\'/>\n"
+           "    </vsock>\n";
+}
+
+std::string interface_driver_xml_for(const mp::VirtualMachineDescription& desc)
+{
+    const auto& network_options = desc.network_options;
+    if (network_options == mp::VMNetworkOptions{})
+        return {};
+
+    auto attributes = fmt::format(" name=\'{}\'", network_options.vhost ? "vhost" : "qemu");
+    if (const auto queues = network_options.queues_for(desc.num_cores); queues > 1)
+        attributes += fmt::format(" queues=\'{}\'", queues);
+    if (network_options.ring_size)
+        attributes += fmt::format(" rx_queue_size=\'{0}\' tx_queue_size=\'{0}\'", network_options.ring_size);
+
+    return fmt::format("      <driver{}/>\n", attributes);
+}
+
 auto generate_xml_config_for(const mp::VirtualMachineDescription& desc, const std::string& bridge_name,
                              const std::string& arch)
 {
@@ -130,6 +235,7 @@ auto generate_xml_config_for(const mp::VirtualMachineDescription& desc, const st
         "  <memory unit=\'{}\'>{}</memory>\n"
         "  <currentMemory unit=\'{}\'>{}</currentMemory>\n"
         "  <vcpu placement=\'static\'>{}</vcpu>\n"
+        "{}"
         "  <resource>\n"
         "    <partition>/machine</partition>\n"
         "  </resource>\n"
@@ -147,7 +253,7 @@ auto generate_xml_config_for(const mp::VirtualMachineDescription& desc, const st
         "  <devices>\n"
         "    <emulator>{}</emulator>\n"
         "    <disk type=\'file\' device=\'disk\'>\n"
-        "      <driver name=\'qemu\' type=\'qcow2\' discard=\'unmap\'/>\n"
+        "      <driver name=\'qemu\' type=\'qcow2\' discard=\'unmap\'{}/>\n"
         "      <source file=\'{}\'/>\n"
         "      <backingStore/>\n"
         "      <target dev=\'vda\' bus=\'virtio\'/>\n"
@@ -165,20 +271,31 @@ auto generate_xml_config_for(const mp::VirtualMachineDescription& desc, const st
         "      <source bridge=\'{}\'/>\n"
         "      <target dev=\'vnet0\'/>\n"
         "      <model type=\'virtio\'/>\n"
+        "{}"
         "      <alias name=\'net0\'/>\n"
         "    </interface>\n"
         "    <serial type=\'pty\'>\n"
         "      <source path=\'/dev/pts/2\'/>\n"
         "      <target port=\"0\"/>\n"
         "    </serial>\n"
+        "    <channel type=\'unix\'>\n"
+        "      <target type=\'virtio\' name=\'org.qemu.guest_agent.0\'/>\n"
+        "    </channel>\n"
+        "{}"
+        "    <memballoon model=\'virtio\' freePageReporting=\'on\'>\n"
+        "      <stats period=\'5\'/>\n"
+        "      <alias name=\'balloon0\'/>\n"
+        "    </memballoon>\n"
         "    <video>\n"
         "      <model type=\'qxl\' ram=\'65536\' vram=\'65536\' vgamem=\'16384\' heads=\'1\' primary=\'yes\'/>\n"
         "      <alias name=\'video0\'/>\n"
         "    </video>\n"
         "  </devices>\n"
         "</domain>",
-        desc.vm_name, mem_unit, memory, mem_unit, memory, desc.num_cores, arch, qemu_path,
-        desc.image.image_path.toStdString(), desc.cloud_init_iso.toStdString(), desc.default_mac_address, bridge_name);
+        desc.vm_name, mem_unit, memory, mem_unit, memory, desc.num_cores, tuning_xml_for(desc), arch, qemu_path,
+        disk_driver_attributes_for(desc.disk_options), desc.image.image_path.toStdString(),
+        desc.cloud_init_iso.toStdString(), desc.default_mac_address, bridge_name, interface_driver_xml_for(desc),
+        vsock_xml());
 }
 
 auto domain_by_name_for(const std::string& vm_name, virConnectPtr connection,
@@ -202,18 +319,29 @@ auto domain_by_definition_for(const mp::VirtualMachineDescription& desc, const s
     return domain;
 }
 
-auto refresh_instance_state_for_domain(virDomainPtr domain, const mp::VirtualMachine::State& current_instance_state,
-                                       const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+mp::optional<mp::LibvirtDomainState> domain_state_for(virDomainPtr domain,
+                                                      const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
 {
     auto domain_state{0};
 
     if (!domain || libvirt_wrapper->virDomainGetState(domain, &domain_state, nullptr, 0) == -1 ||
         domain_state == VIR_DOMAIN_NOSTATE)
+        return mp::nullopt;
+
+    return mp::LibvirtDomainState{domain_state, libvirt_wrapper->virDomainHasManagedSaveImage(domain, 0) == 1};
+}
+
+auto instance_state_for(const mp::optional<mp::LibvirtDomainState>& libvirt_state,
+                        const mp::VirtualMachine::State& current_instance_state)
+{
+    if (!libvirt_state)
         return mp::VirtualMachine::State::unknown;
 
-    if (libvirt_wrapper->virDomainHasManagedSaveImage(domain, 0) == 1)
+    if (libvirt_state->managed_save)
         return mp::VirtualMachine::State::suspended;
 
+    const auto domain_state = libvirt_state->state;
+
     // Most of these libvirt domain states don't have a Multipass instance state
     // analogue, so we'll treat them as "off".
     const auto domain_off_states = {VIR_DOMAIN_BLOCKED, VIR_DOMAIN_PAUSED,  VIR_DOMAIN_SHUTDOWN,
@@ -228,6 +356,12 @@ auto refresh_instance_state_for_domain(virDomainPtr domain, const mp::VirtualMac
     return current_instance_state;
 }
 
+auto refresh_instance_state_for_domain(virDomainPtr domain, const mp::VirtualMachine::State& current_instance_state,
+                                       const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+{
+    return instance_state_for(domain_state_for(domain, libvirt_wrapper), current_instance_state);
+}
+
 bool domain_is_running(virDomainPtr domain, const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
 {
     auto domain_state{0};
@@ -255,21 +389,99 @@ void update_max_and_property(virDomainPtr domain_ptr, Updater* fun_ptr, Integer
         flags &= ~max_flag;
     } while (!twice++); // first set the maximum, then actual
 }
+
+bool is_global(const std::string& ipv4)
+{
+    return ipv4.rfind("127.", 0) != 0 && ipv4.rfind("169.254.", 0) != 0;
+}
+
+// What an agent query reports, in the flat "<group>.<index>.<field>" parameters that libvirt makes of it
+mp::GuestMetrics guest_metrics_from(const virTypedParameterPtr params, int nparams)
+{
+    std::unordered_map<std::string, const virTypedParameter*> by_name;
+    for (auto i = 0; i < nparams; ++i)
+        by_name.emplace(params[i].field, &params[i]);
+
+    auto string_of = [&by_name](const std::string& name) -> std::string {
+        auto it = by_name.find(name);
+        return it != by_name.end() && it->second->type == VIR_TYPED_PARAM_STRING ? it->second->value.s : "";
+    };
+    auto number_of = [&by_name](const std::string& name) -> mp::optional<double> {
+        auto it = by_name.find(name);
+        if (it == by_name.end())
+            return mp::nullopt;
+
+        switch (const auto& value = it->second->value; it->second->type)
+        {
+        case VIR_TYPED_PARAM_INT:
+            return value.i;
+        case VIR_TYPED_PARAM_UINT:
+            return value.ui;
+        case VIR_TYPED_PARAM_LLONG:
+            return value.l;
+        case VIR_TYPED_PARAM_ULLONG:
+            return value.ul;
+        case VIR_TYPED_PARAM_DOUBLE:
+            return value.d;
+        default:
+            return mp::nullopt;
+        }
+    };
+    auto bytes_of = [&number_of](const std::string& name) -> mp::optional<long long> {
+        if (auto number = number_of(name))
+            return static_cast<long long>(*number);
+        return mp::nullopt;
+    };
+
+    mp::GuestMetrics metrics;
+    metrics.current_release = string_of("os.pretty-name");
+
+    if (auto load1 = number_of("load.1m"), load5 = number_of("load.5m"), load15 = number_of("load.15m");
+        load1 && load5 && load15)
+        metrics.load = std::array<double, 3>{*load1, *load5, *load15};
+
+    const auto filesystems = static_cast<int>(number_of("fs.count").value_or(0));
+    for (auto i = 0; i < filesystems; ++i)
+    {
+        if (const auto prefix = fmt::format("fs.{}.", i); string_of(prefix + "mountpoint") == "/")
+        {
+            metrics.disk_usage = bytes_of(prefix + "used-bytes");
+            metrics.disk_total = bytes_of(prefix + "total-bytes");
+            break;
+        }
+    }
+
+    const auto interfaces = static_cast<int>(number_of("if.count").value_or(0));
+    for (auto i = 0; i < interfaces; ++i)
+    {
+        const auto addresses = static_cast<int>(number_of(fmt::format("if.{}.addr.count", i)).value_or(0));
+        for (auto j = 0; j < addresses; ++j)
+        {
+            const auto prefix = fmt::format("if.{}.addr.{}.", i, j);
+            if (const auto ipv4 = string_of(prefix + "addr"); string_of(prefix + "type") == "ipv4" && is_global(ipv4))
+                metrics.ipv4.push_back(ipv4);
+        }
+    }
+
+    return metrics;
+}
 } // namespace
 
 mp::LibVirtVirtualMachine::LibVirtVirtualMachine(const mp::VirtualMachineDescription& desc,
                                                  const std::string& bridge_name, mp::VMStatusMonitor& monitor,
-                                                 const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
+                                                 const mp::LibvirtWrapper::UPtr& libvirt_wrapper,
+                                                 LibvirtEventSubscriber* events)
     : BaseVirtualMachine{desc.vm_name},
       username{desc.ssh_username},
       desc{desc},
       monitor{&monitor},
       bridge_name{bridge_name},
-      libvirt_wrapper{libvirt_wrapper}
+      libvirt_wrapper{libvirt_wrapper},
+      events{events}
 {
     try
     {
-        initialize_domain_info(open_libvirt_connection(libvirt_wrapper).get());
+        initialize_domain_info(libvirt_connection().get());
     }
     catch (const std::exception&)
     {
@@ -278,6 +490,11 @@ mp::LibVirtVirtualMachine::LibVirtVirtualMachine(const mp::VirtualMachineDescrip
 }
 
 mp::LibVirtVirtualMachine::~LibVirtVirtualMachine()
+{
+    prepare_for_exit();
+}
+
+void mp::LibVirtVirtualMachine::prepare_for_exit()
 {
     update_suspend_status = false;
 
@@ -285,9 +502,19 @@ mp::LibVirtVirtualMachine::~LibVirtVirtualMachine()
         suspend();
 }
 
+void mp::LibVirtVirtualMachine::kill()
+{
+    // A connection of its own, as the one suspending or stopping the instance is busy
+    auto domain = domain_by_name_for(vm_name, libvirt_connection().get(), libvirt_wrapper);
+    mpl::log(mpl::Level::warning, vm_name, "Destroying the domain");
+    if (!domain || libvirt_wrapper->virDomainDestroy(domain.get()) == -1)
+        mpl::log(mpl::Level::warning, vm_name,
+                 fmt::format("Cannot destroy the domain: {}", libvirt_wrapper->virGetLastErrorMessage()));
+}
+
 void mp::LibVirtVirtualMachine::start()
 {
-    auto connection = open_libvirt_connection(libvirt_wrapper);
+    auto connection = libvirt_connection();
     DomainUPtr domain{nullptr, nullptr};
 
     if (state == VirtualMachine::State::unknown)
@@ -327,6 +554,10 @@ void mp::LibVirtVirtualMachine::start()
         throw std::runtime_error(error_string);
     }
 
+    vsock.set_cid(instance_vsock_cid_for(domain.get(), libvirt_wrapper));
+    vsock.reset();
+    if (events)
+        events->forget_domain(vm_name); // the next query asks, in case the event is still on its way
     monitor->on_resume();
 }
 
@@ -338,7 +569,7 @@ void mp::LibVirtVirtualMachine::stop()
 void mp::LibVirtVirtualMachine::shutdown()
 {
     std::unique_lock<decltype(state_mutex)> lock{state_mutex};
-    auto domain = domain_by_name_for(vm_name, open_libvirt_connection(libvirt_wrapper).get(), libvirt_wrapper);
+    auto domain = domain_by_name_for(vm_name, libvirt_connection().get(), libvirt_wrapper);
     state = refresh_instance_state_for_domain(domain.get(), state, libvirt_wrapper);
     if (state == State::running || state == State::delayed_shutdown || state == State::unknown)
     {
@@ -364,13 +595,15 @@ void mp::LibVirtVirtualMachine::shutdown()
         mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring shutdown issued while suspended"));
     }
 
+    if (events)
+        events->forget_domain(vm_name);
     lock.unlock();
     monitor->on_shutdown();
 }
 
 void mp::LibVirtVirtualMachine::suspend()
 {
-    auto domain = domain_by_name_for(vm_name, open_libvirt_connection(libvirt_wrapper).get(), libvirt_wrapper);
+    auto domain = domain_by_name_for(vm_name, libvirt_connection().get(), libvirt_wrapper);
     state = refresh_instance_state_for_domain(domain.get(), state, libvirt_wrapper);
     if (state == State::running || state == State::delayed_shutdown)
     {
@@ -393,6 +626,8 @@ void mp::LibVirtVirtualMachine::suspend()
         mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring suspend issued while stopped"));
     }
 
+    if (events)
+        events->forget_domain(vm_name);
     monitor->on_suspend();
 }
 
@@ -400,12 +635,22 @@ mp::VirtualMachine::State mp::LibVirtVirtualMachine::current_state()
 {
     try
     {
-        auto connection = open_libvirt_connection(libvirt_wrapper);
+        if (auto pushed_state = events ? events->domain_state(vm_name) : nullopt)
+        {
+            state = instance_state_for(pushed_state, state);
+            return state;
+        }
+
+        auto connection = libvirt_connection();
         auto domain = domain_by_name_for(vm_name, connection.get(), libvirt_wrapper);
         if (!domain)
             initialize_domain_info(connection.get());
 
-        state = refresh_instance_state_for_domain(domain.get(), state, libvirt_wrapper);
+        auto libvirt_state = domain_state_for(domain.get(), libvirt_wrapper);
+        if (events && libvirt_state)
+            events->note_domain_state(vm_name, *libvirt_state);
+
+        state = instance_state_for(libvirt_state, state);
     }
     catch (const std::exception&)
     {
@@ -423,7 +668,10 @@ int mp::LibVirtVirtualMachine::ssh_port()
 void mp::LibVirtVirtualMachine::ensure_vm_is_running()
 {
     auto is_vm_running = [this] {
-        auto domain = domain_by_name_for(vm_name, open_libvirt_connection(libvirt_wrapper).get(), libvirt_wrapper);
+        if (auto pushed_state = events ? events->domain_state(vm_name) : nullopt)
+            return pushed_state->state == VIR_DOMAIN_RUNNING;
+
+        auto domain = domain_by_name_for(vm_name, libvirt_connection().get(), libvirt_wrapper);
         return domain_is_running(domain.get(), libvirt_wrapper);
     };
 
@@ -432,9 +680,9 @@ void mp::LibVirtVirtualMachine::ensure_vm_is_running()
 
 std::string mp::LibVirtVirtualMachine::ssh_hostname(std::chrono::milliseconds timeout)
 {
-    auto get_ip = [this]() -> optional<IPAddress> { return instance_ip_for(mac_addr, libvirt_wrapper); };
+    auto get_ip = [this]() -> optional<IPAddress> { return leased_ip(); };
 
-    return mp::backend::ip_address_for(this, get_ip, timeout);
+    return mp::backend::ssh_hostname_for(this, vsock, get_ip, timeout);
 }
 
 std::string mp::LibVirtVirtualMachine::ssh_username()
@@ -446,7 +694,7 @@ std::string mp::LibVirtVirtualMachine::management_ipv4()
 {
     if (!management_ip)
     {
-        auto result = instance_ip_for(mac_addr, libvirt_wrapper);
+        auto result = leased_ip();
         if (result)
             management_ip.emplace(result.value());
         else
@@ -456,6 +704,24 @@ std::string mp::LibVirtVirtualMachine::management_ipv4()
     return management_ip.value().as_string();
 }
 
+std::vector<std::string> mp::LibVirtVirtualMachine::known_ipv4()
+{
+    auto ret = BaseVirtualMachine::known_ipv4();
+
+    try
+    {
+        for (const auto& neighbour : MP_NETLINK.ipv4_neighbours())
+            if (neighbour.hw_addr == mac_addr && std::find(ret.begin(), ret.end(), neighbour.ipv4) == ret.end())
+                ret.push_back(neighbour.ipv4);
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::debug, vm_name, e.what());
+    }
+
+    return ret;
+}
+
 std::string mp::LibVirtVirtualMachine::ipv6()
 {
     return {};
@@ -485,13 +751,35 @@ mp::LibVirtVirtualMachine::DomainUPtr mp::LibVirtVirtualMachine::initialize_doma
 
     management_ipv4(); // To set ip
     state = refresh_instance_state_for_domain(domain.get(), state, libvirt_wrapper);
+    if (state == State::running)
+        vsock.set_cid(instance_vsock_cid_for(domain.get(), libvirt_wrapper));
 
     return domain;
 }
 
+auto mp::LibVirtVirtualMachine::libvirt_connection() const -> ConnectionShPtr
+{
+    if (events)
+        return events->connection();
+
+    return open_libvirt_connection(libvirt_wrapper);
+}
+
+auto mp::LibVirtVirtualMachine::leased_ip() const -> optional<IPAddress>
+{
+    try
+    {
+        return instance_ip_for(mac_addr, libvirt_connection().get(), libvirt_wrapper);
+    }
+    catch (const std::exception&)
+    {
+        return nullopt;
+    }
+}
+
 mp::LibVirtVirtualMachine::DomainUPtr mp::LibVirtVirtualMachine::checked_vm_domain() const
 {
-    auto connection = open_libvirt_connection(libvirt_wrapper);
+    auto connection = libvirt_connection();
     assert(connection && "should have thrown otherwise");
 
     auto domain = domain_by_name_for(vm_name, connection.get(), libvirt_wrapper);
@@ -529,6 +817,42 @@ void mp::LibVirtVirtualMachine::update_cpus(int num_cores)
     desc.num_cores = num_cores;
 }
 
+void mp::LibVirtVirtualMachine::update_placement(const VMPlacement& placement)
+{
+    auto new_desc = desc;
+    new_desc.placement = placement;
+    redefine_domain(new_desc, "placement");
+}
+
+void mp::LibVirtVirtualMachine::update_disk_options(const VMDiskOptions& disk_options)
+{
+    auto new_desc = desc;
+    new_desc.disk_options = disk_options;
+    redefine_domain(new_desc, "disk options");
+}
+
+void mp::LibVirtVirtualMachine::update_network_options(const VMNetworkOptions& network_options)
+{
+    auto new_desc = desc;
+    new_desc.network_options = network_options;
+    redefine_domain(new_desc, "network options");
+}
+
+void mp::LibVirtVirtualMachine::redefine_domain(const VirtualMachineDescription& new_desc,
+                                                const std::string& property_name)
+{
+    auto connection = libvirt_connection();
+    libvirt_wrapper->virDomainUndefine(checked_vm_domain().get()); // the definition is regenerated with a new UUID
+    if (!domain_by_definition_for(new_desc, bridge_name, connection.get(), libvirt_wrapper))
+    {
+        const std::string error = libvirt_wrapper->virGetLastErrorMessage();
+        domain_by_definition_for(desc, bridge_name, connection.get(), libvirt_wrapper); // put the old one back
+        throw std::runtime_error(fmt::format("Could not update property: {} ({})", property_name, error));
+    }
+
+    desc = new_desc;
+}
+
 void mp::LibVirtVirtualMachine::resize_memory(const MemorySize& new_size)
 {
     auto new_size_kb = new_size.in_kilobytes(); /* floored here */
@@ -538,6 +862,62 @@ void mp::LibVirtVirtualMachine::resize_memory(const MemorySize& new_size)
     desc.mem_size = new_size;
 }
 
+void mp::LibVirtVirtualMachine::set_balloon_target(const MemorySize& guest_memory)
+{
+    const auto target_kb = std::min(guest_memory, desc.mem_size).in_kilobytes(); /* floored here */
+    if (libvirt_wrapper->virDomainSetMemoryFlags(checked_vm_domain().get(), target_kb, VIR_DOMAIN_AFFECT_LIVE) < 0)
+        throw std::runtime_error(fmt::format("Could not update property: balloon target"));
+}
+
+auto mp::LibVirtVirtualMachine::guest_metrics(std::chrono::milliseconds) -> optional<GuestMetrics>
+{
+    if (current_state() != State::running)
+        return nullopt;
+
+    try
+    {
+        auto domain = checked_vm_domain();
+
+        // All that the agent can tell; libvirt holds the query to its own agent timeout
+        virTypedParameterPtr params = nullptr;
+        int nparams = 0;
+        if (libvirt_wrapper->virDomainGetGuestInfo(domain.get(), 0, &params, &nparams, 0) < 0)
+        {
+            mpl::log(mpl::Level::debug, vm_name,
+                     fmt::format("Cannot query the guest agent: {}", libvirt_wrapper->virGetLastErrorMessage()));
+            return nullopt;
+        }
+
+        auto metrics = guest_metrics_from(params, nparams);
+        libvirt_wrapper->virTypedParamsFree(params, nparams);
+
+        // The memory figures come from the balloon, which the agent does not report on
+        std::array<virDomainMemoryStatStruct, VIR_DOMAIN_MEMORY_STAT_NR> stats;
+        const auto nstats = libvirt_wrapper->virDomainMemoryStats(domain.get(), stats.data(), stats.size(), 0);
+        optional<long long> available, usable; // KiB
+        for (auto i = 0; i < nstats; ++i)
+        {
+            if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_AVAILABLE)
+                available = stats[i].val;
+            else if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_USABLE)
+                usable = stats[i].val;
+        }
+
+        if (available && usable && *usable <= *available)
+        {
+            metrics.memory_total = *available * 1024;
+            metrics.memory_usage = (*available - *usable) * 1024;
+        }
+
+        return metrics;
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::debug, vm_name, fmt::format("Cannot query the guest agent: {}", e.what()));
+        return nullopt;
+    }
+}
+
 void mp::LibVirtVirtualMachine::resize_disk(const MemorySize& new_size)
 {
     assert(new_size > desc.disk_space);
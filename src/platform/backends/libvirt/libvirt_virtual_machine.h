@@ -18,11 +18,13 @@
 #ifndef MULTIPASS_LIBVIRT_VIRTUAL_MACHINE_H
 #define MULTIPASS_LIBVIRT_VIRTUAL_MACHINE_H
 
+#include "libvirt_event_subscriber.h"
 #include "libvirt_wrapper.h"
 
 #include <shared/base_virtual_machine.h>
 
 #include <multipass/virtual_machine_description.h>
+#include <multipass/vsock.h>
 
 namespace multipass
 {
@@ -32,11 +34,13 @@ class LibVirtVirtualMachine final : public BaseVirtualMachine
 {
 public:
     using ConnectionUPtr = std::unique_ptr<virConnect, decltype(virConnectClose)*>;
+    using ConnectionShPtr = LibvirtEventSubscriber::ConnectionShPtr;
     using DomainUPtr = std::unique_ptr<virDomain, decltype(virDomainFree)*>;
     using NetworkUPtr = std::unique_ptr<virNetwork, decltype(virNetworkFree)*>;
 
     LibVirtVirtualMachine(const VirtualMachineDescription& desc, const std::string& bridge_name,
-                          VMStatusMonitor& monitor, const LibvirtWrapper::UPtr& libvirt_wrapper);
+                          VMStatusMonitor& monitor, const LibvirtWrapper::UPtr& libvirt_wrapper,
+                          LibvirtEventSubscriber* events = nullptr);
     ~LibVirtVirtualMachine();
 
     void start() override;
@@ -48,19 +52,31 @@ public:
     std::string ssh_hostname(std::chrono::milliseconds timeout) override;
     std::string ssh_username() override;
     std::string management_ipv4() override;
+    std::vector<std::string> known_ipv4() override;
     std::string ipv6() override;
     void wait_until_ssh_up(std::chrono::milliseconds timeout) override;
     void ensure_vm_is_running() override;
     void update_state() override;
     void update_cpus(int num_cores) override;
+    void update_placement(const VMPlacement& placement) override;
+    void update_disk_options(const VMDiskOptions& disk_options) override;
+    void update_network_options(const VMNetworkOptions& network_options) override;
     void resize_memory(const MemorySize& new_size) override;
     void resize_disk(const MemorySize& new_size) override;
+    void set_balloon_target(const MemorySize& guest_memory) override;
+    optional<GuestMetrics> guest_metrics(std::chrono::milliseconds timeout) override;
+    void prepare_for_exit() override; // suspends what runs
+    void kill() override;
 
     static ConnectionUPtr open_libvirt_connection(const LibvirtWrapper::UPtr& libvirt_wrapper);
 
 private:
     DomainUPtr initialize_domain_info(virConnectPtr connection);
+    ConnectionShPtr libvirt_connection() const; // the factory's, when it keeps one
+    optional<IPAddress> leased_ip() const;
     DomainUPtr checked_vm_domain() const;
+    void redefine_domain(const VirtualMachineDescription& new_desc, // for changes that wait for the next boot
+                         const std::string& property_name);
 
     std::string mac_addr;
     const std::string username;
@@ -70,6 +86,8 @@ private:
     const std::string& bridge_name;
     // Needs to be a reference so testing can override the various libvirt functions
     const LibvirtWrapper::UPtr& libvirt_wrapper;
+    LibvirtEventSubscriber* events;
+    vsock::Endpoint vsock; // of the running domain, when it has a vsock device
     bool update_suspend_status{true};
 };
 } // namespace multipass
@@ -18,7 +18,10 @@
 #include "libvirt_virtual_machine_factory.h"
 #include "libvirt_virtual_machine.h"
 
+#include <multipass/constants.h>
+#include <multipass/exceptions/settings_exceptions.h>
 #include <multipass/logging/log.h>
+#include <multipass/settings/settings.h>
 #include <multipass/utils.h>
 #include <multipass/virtual_machine_description.h>
 #include <shared/linux/backend_utils.h>
@@ -92,6 +95,26 @@ std::string enable_libvirt_network(const mp::Path& data_dir, const mp::LibvirtWr
     return bridge_name;
 }
 
+std::string storage_pool_setting()
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::libvirt_pool_key).trimmed().toStdString();
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, logging_category,
+                 fmt::format("Cannot read which libvirt storage pool to use: {}", e.what()));
+        return {};
+    }
+}
+
+// Named after the instance, for the factory to find it again when the instance goes
+std::string volume_name_for(const std::string& instance_name)
+{
+    return instance_name + ".qcow2";
+}
+
 auto make_libvirt_wrapper(const std::string& libvirt_object_path)
 {
     try
@@ -111,7 +134,9 @@ mp::LibVirtVirtualMachineFactory::LibVirtVirtualMachineFactory(const mp::Path& d
     : libvirt_wrapper{make_libvirt_wrapper(libvirt_object_path)},
       data_dir{data_dir},
       bridge_name{enable_libvirt_network(data_dir, libvirt_wrapper)},
-      libvirt_object_path{libvirt_object_path}
+      storage_pool{storage_pool_setting()},
+      libvirt_object_path{libvirt_object_path},
+      events{this->libvirt_wrapper}
 {
 }
 
@@ -126,7 +151,7 @@ mp::VirtualMachine::UPtr mp::LibVirtVirtualMachineFactory::create_virtual_machin
     if (bridge_name.empty())
         bridge_name = enable_libvirt_network(data_dir, libvirt_wrapper);
 
-    return std::make_unique<mp::LibVirtVirtualMachine>(desc, bridge_name, monitor, libvirt_wrapper);
+    return std::make_unique<mp::LibVirtVirtualMachine>(desc, bridge_name, monitor, libvirt_wrapper, &events);
 }
 
 mp::LibVirtVirtualMachineFactory::~LibVirtVirtualMachineFactory()
@@ -143,24 +168,117 @@ mp::LibVirtVirtualMachineFactory::~LibVirtVirtualMachineFactory()
 
 void mp::LibVirtVirtualMachineFactory::remove_resources_for(const std::string& name)
 {
-    auto connection = LibVirtVirtualMachine::open_libvirt_connection(libvirt_wrapper);
+    auto connection = events.connection();
 
     libvirt_wrapper->virDomainUndefine(libvirt_wrapper->virDomainLookupByName(connection.get(), name.c_str()));
+
+    if (storage_pool.empty())
+        return;
+
+    auto pool = lookup_storage_pool(connection.get());
+    StorageVolUPtr volume{libvirt_wrapper->virStorageVolLookupByName(pool.get(), volume_name_for(name).c_str()),
+                          libvirt_wrapper->virStorageVolFree};
+    if (volume && libvirt_wrapper->virStorageVolDelete(volume.get(), 0) < 0)
+        mpl::log(mpl::Level::warning, logging_category,
+                 fmt::format("Cannot delete the volume of \"{}\": {}", name,
+                             libvirt_wrapper->virGetLastErrorMessage()));
 }
 
-mp::VMImage mp::LibVirtVirtualMachineFactory::prepare_source_image(const VMImage& source_image)
+mp::VMImage mp::LibVirtVirtualMachineFactory::prepare_source_image(const VMImage& source_image,
+                                                                    const ProgressMonitor& monitor)
 {
     VMImage image{source_image};
-    image.image_path = mp::backend::convert_to_qcow_if_necessary(source_image.image_path);
+    image.image_path = mp::backend::convert_to_qcow_if_necessary(source_image.image_path, monitor);
     return image;
 }
 
 void mp::LibVirtVirtualMachineFactory::prepare_instance_image(const VMImage& instance_image,
                                                               const VirtualMachineDescription& desc)
 {
+    if (!storage_pool.empty())
+    {
+        // Through libvirt, for what it accounts of the pool to stay right
+        auto connection = events.connection();
+        const auto path = instance_image.image_path.toStdString();
+        StorageVolUPtr volume{libvirt_wrapper->virStorageVolLookupByPath(connection.get(), path.c_str()),
+                              libvirt_wrapper->virStorageVolFree};
+
+        if (volume)
+        {
+            if (libvirt_wrapper->virStorageVolResize(volume.get(), desc.disk_space.in_bytes(), 0) < 0)
+                throw std::runtime_error(fmt::format("Cannot resize instance image: {}",
+                                                     libvirt_wrapper->virGetLastErrorMessage()));
+            return;
+        }
+    }
+
     mp::backend::resize_instance_image(desc.disk_space, instance_image.image_path);
 }
 
+mp::VMImageVault::UPtr mp::LibVirtVirtualMachineFactory::create_image_vault(std::vector<VMImageHost*> image_hosts,
+                                                                            URLDownloader* downloader,
+                                                                            const Path& cache_dir_path,
+                                                                            const Path& data_dir_path,
+                                                                            const days& days_to_expire)
+{
+    // Instance images are thin qcow2 overlays on top of the prepared images in the vault, which all instances of an
+    // image share. They go in the instance directories, or as volumes in the storage pool when there is one.
+    DefaultVMImageVault::OverlayAction make_overlay_image = mp::backend::create_overlay_image;
+    if (!storage_pool.empty())
+        make_overlay_image = [this](const Path& backing_image_path, const QDir& output_dir) {
+            return create_instance_volume(backing_image_path, output_dir.dirName().toStdString());
+        };
+
+    return std::make_unique<mp::DefaultVMImageVault>(image_hosts, downloader, cache_dir_path, data_dir_path,
+                                                     days_to_expire, std::move(make_overlay_image), nullptr,
+                                                     mp::backend::flatten_image);
+}
+
+auto mp::LibVirtVirtualMachineFactory::lookup_storage_pool(virConnectPtr connection) const -> StoragePoolUPtr
+{
+    StoragePoolUPtr pool{libvirt_wrapper->virStoragePoolLookupByName(connection, storage_pool.c_str()),
+                         libvirt_wrapper->virStoragePoolFree};
+    if (!pool)
+        throw std::runtime_error(fmt::format("Cannot find libvirt storage pool \"{}\": {}", storage_pool,
+                                             libvirt_wrapper->virGetLastErrorMessage()));
+
+    return pool;
+}
+
+mp::Path mp::LibVirtVirtualMachineFactory::create_instance_volume(const Path& backing_image_path,
+                                                                  const std::string& name)
+{
+    auto connection = events.connection();
+    auto pool = lookup_storage_pool(connection.get());
+
+    // Without a capacity, the volume takes that of its backing image; it is resized to the instance's disk later
+    const auto xml = fmt::format("<volume>\n"
+                                 "  <name>{}</name>\n"
+                                 "  <capacity unit=\"bytes\">0</capacity>\n"
+                                 "  <target>\n"
+                                 "    <format type=\"qcow2\"/>\n"
+                                 "  </target>\n"
+                                 "  <backingStore>\n"
+                                 "    <path>{}</path>\n"
+                                 "    <format type=\"qcow2\"/>\n"
+                                 "  </backingStore>\n"
+                                 "</volume>",
+                                 volume_name_for(name), backing_image_path.toHtmlEscaped());
+
+    StorageVolUPtr volume{libvirt_wrapper->virStorageVolCreateXML(pool.get(), xml.c_str(), 0),
+                          libvirt_wrapper->virStorageVolFree};
+    if (!volume)
+        throw std::runtime_error(fmt::format("Cannot create instance volume in libvirt storage pool \"{}\": {}",
+                                             storage_pool, libvirt_wrapper->virGetLastErrorMessage()));
+
+    std::unique_ptr<char, decltype(free)*> path{libvirt_wrapper->virStorageVolGetPath(volume.get()), free};
+    if (!path)
+        throw std::runtime_error(fmt::format("Cannot tell where instance volume \"{}\" is: {}", volume_name_for(name),
+                                             libvirt_wrapper->virGetLastErrorMessage()));
+
+    return QString{path.get()};
+}
+
 void mp::LibVirtVirtualMachineFactory::hypervisor_health_check()
 {
     MP_BACKEND.check_for_kvm_support();
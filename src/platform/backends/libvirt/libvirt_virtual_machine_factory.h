@@ -17,6 +17,7 @@
 #ifndef MULTIPASS_LIBVIRT_VIRTUAL_MACHINE_FACTORY_H
 #define MULTIPASS_LIBVIRT_VIRTUAL_MACHINE_FACTORY_H
 
+#include "libvirt_event_subscriber.h"
 #include "libvirt_wrapper.h"
 
 #include <shared/base_virtual_machine_factory.h>
@@ -38,18 +39,29 @@ public:
     VirtualMachine::UPtr create_virtual_machine(const VirtualMachineDescription& desc,
                                                 VMStatusMonitor& monitor) override;
     void remove_resources_for(const std::string& name) override;
-    VMImage prepare_source_image(const VMImage& source_image) override;
+    VMImage prepare_source_image(const VMImage& source_image, const ProgressMonitor& monitor) override;
     void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) override;
     void hypervisor_health_check() override;
     QString get_backend_version_string() override;
+    VMImageVault::UPtr create_image_vault(std::vector<VMImageHost*> image_hosts, URLDownloader* downloader,
+                                          const Path& cache_dir_path, const Path& data_dir_path,
+                                          const days& days_to_expire) override;
 
     // Making this public makes this modifiable which is necessary for testing
     LibvirtWrapper::UPtr libvirt_wrapper;
 
 private:
+    using StoragePoolUPtr = std::unique_ptr<virStoragePool, decltype(virStoragePoolFree)*>;
+    using StorageVolUPtr = std::unique_ptr<virStorageVol, decltype(virStorageVolFree)*>;
+
+    StoragePoolUPtr lookup_storage_pool(virConnectPtr connection) const; // throws when it is not there
+    Path create_instance_volume(const Path& backing_image_path, const std::string& name);
+
     const Path data_dir;
     std::string bridge_name;
+    const std::string storage_pool; // where instance images go as volumes, if anywhere
     const std::string libvirt_object_path;
+    LibvirtEventSubscriber events; // the one connection that instances share
 };
 } // namespace multipass
 
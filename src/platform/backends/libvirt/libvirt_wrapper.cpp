@@ -58,6 +58,20 @@ mp::LibvirtWrapper::LibvirtWrapper(const std::string& filename)
           reinterpret_cast<virConnectGetCapabilities_t>(get_symbol_address_for("virConnectGetCapabilities", handle))},
       virConnectGetVersion{
           reinterpret_cast<virConnectGetVersion_t>(get_symbol_address_for("virConnectGetVersion", handle))},
+      virConnectIsAlive{reinterpret_cast<virConnectIsAlive_t>(get_symbol_address_for("virConnectIsAlive", handle))},
+      virConnectSetKeepAlive{
+          reinterpret_cast<virConnectSetKeepAlive_t>(get_symbol_address_for("virConnectSetKeepAlive", handle))},
+      virConnectDomainEventRegisterAny{reinterpret_cast<virConnectDomainEventRegisterAny_t>(
+          get_symbol_address_for("virConnectDomainEventRegisterAny", handle))},
+      virConnectDomainEventDeregisterAny{reinterpret_cast<virConnectDomainEventDeregisterAny_t>(
+          get_symbol_address_for("virConnectDomainEventDeregisterAny", handle))},
+      virEventRegisterDefaultImpl{reinterpret_cast<virEventRegisterDefaultImpl_t>(
+          get_symbol_address_for("virEventRegisterDefaultImpl", handle))},
+      virEventRunDefaultImpl{
+          reinterpret_cast<virEventRunDefaultImpl_t>(get_symbol_address_for("virEventRunDefaultImpl", handle))},
+      virEventAddTimeout{reinterpret_cast<virEventAddTimeout_t>(get_symbol_address_for("virEventAddTimeout", handle))},
+      virEventRemoveTimeout{
+          reinterpret_cast<virEventRemoveTimeout_t>(get_symbol_address_for("virEventRemoveTimeout", handle))},
       virNetworkLookupByName{
           reinterpret_cast<virNetworkLookupByName_t>(get_symbol_address_for("virNetworkLookupByName", handle))},
       virNetworkCreateXML{
@@ -77,6 +91,7 @@ mp::LibvirtWrapper::LibvirtWrapper(const std::string& filename)
           reinterpret_cast<virDomainLookupByName_t>(get_symbol_address_for("virDomainLookupByName", handle))},
       virDomainGetXMLDesc{
           reinterpret_cast<virDomainGetXMLDesc_t>(get_symbol_address_for("virDomainGetXMLDesc", handle))},
+      virDomainGetName{reinterpret_cast<virDomainGetName_t>(get_symbol_address_for("virDomainGetName", handle))},
       virDomainDestroy{reinterpret_cast<virDomainDestroy_t>(get_symbol_address_for("virDomainDestroy", handle))},
       virDomainFree{reinterpret_cast<virDomainFree_t>(get_symbol_address_for("virDomainFree", handle))},
       virDomainDefineXML{reinterpret_cast<virDomainDefineXML_t>(get_symbol_address_for("virDomainDefineXML", handle))},
@@ -91,6 +106,28 @@ mp::LibvirtWrapper::LibvirtWrapper(const std::string& filename)
           reinterpret_cast<virDomainSetVcpusFlags_t>(get_symbol_address_for("virDomainSetVcpusFlags", handle))},
       virDomainSetMemoryFlags{
           reinterpret_cast<virDomainSetMemoryFlags_t>(get_symbol_address_for("virDomainSetMemoryFlags", handle))},
+      virDomainMemoryStats{
+          reinterpret_cast<virDomainMemoryStats_t>(get_symbol_address_for("virDomainMemoryStats", handle))},
+      virDomainGetGuestInfo{
+          reinterpret_cast<virDomainGetGuestInfo_t>(get_symbol_address_for("virDomainGetGuestInfo", handle))},
+      virTypedParamsFree{
+          reinterpret_cast<virTypedParamsFree_t>(get_symbol_address_for("virTypedParamsFree", handle))},
+      virStoragePoolLookupByName{reinterpret_cast<virStoragePoolLookupByName_t>(
+          get_symbol_address_for("virStoragePoolLookupByName", handle))},
+      virStoragePoolFree{reinterpret_cast<virStoragePoolFree_t>(get_symbol_address_for("virStoragePoolFree", handle))},
+      virStorageVolCreateXML{
+          reinterpret_cast<virStorageVolCreateXML_t>(get_symbol_address_for("virStorageVolCreateXML", handle))},
+      virStorageVolLookupByName{
+          reinterpret_cast<virStorageVolLookupByName_t>(get_symbol_address_for("virStorageVolLookupByName", handle))},
+      virStorageVolLookupByPath{
+          reinterpret_cast<virStorageVolLookupByPath_t>(get_symbol_address_for("virStorageVolLookupByPath", handle))},
+      virStorageVolGetPath{
+          reinterpret_cast<virStorageVolGetPath_t>(get_symbol_address_for("virStorageVolGetPath", handle))},
+      virStorageVolResize{
+          reinterpret_cast<virStorageVolResize_t>(get_symbol_address_for("virStorageVolResize", handle))},
+      virStorageVolDelete{
+          reinterpret_cast<virStorageVolDelete_t>(get_symbol_address_for("virStorageVolDelete", handle))},
+      virStorageVolFree{reinterpret_cast<virStorageVolFree_t>(get_symbol_address_for("virStorageVolFree", handle))},
       virGetLastErrorMessage{
           reinterpret_cast<virGetLastErrorMessage_t>(get_symbol_address_for("virGetLastErrorMessage", handle))}
 {
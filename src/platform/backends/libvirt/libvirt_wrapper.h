@@ -61,6 +61,16 @@ private:
     typedef int (*virConnectClose_t)(virConnectPtr conn);
     typedef char* (*virConnectGetCapabilities_t)(virConnectPtr conn);
     typedef int (*virConnectGetVersion_t)(virConnectPtr conn, unsigned long* hvVer);
+    typedef int (*virConnectIsAlive_t)(virConnectPtr conn);
+    typedef int (*virConnectSetKeepAlive_t)(virConnectPtr conn, int interval, unsigned int count);
+    typedef int (*virConnectDomainEventRegisterAny_t)(virConnectPtr conn, virDomainPtr dom, int eventID,
+                                                      virConnectDomainEventGenericCallback cb, void* opaque,
+                                                      virFreeCallback freecb);
+    typedef int (*virConnectDomainEventDeregisterAny_t)(virConnectPtr conn, int callbackID);
+    typedef int (*virEventRegisterDefaultImpl_t)();
+    typedef int (*virEventRunDefaultImpl_t)();
+    typedef int (*virEventAddTimeout_t)(int timeout, virEventTimeoutCallback cb, void* opaque, virFreeCallback ff);
+    typedef int (*virEventRemoveTimeout_t)(int timer);
     typedef virNetworkPtr (*virNetworkLookupByName_t)(virConnectPtr conn, const char* name);
     typedef virNetworkPtr (*virNetworkCreateXML_t)(virConnectPtr conn, const char* xmlDesc);
     typedef int (*virNetworkDestroy_t)(virNetworkPtr network);
@@ -74,6 +84,7 @@ private:
     typedef int (*virDomainUndefine_t)(virDomainPtr domain);
     typedef virDomainPtr (*virDomainLookupByName_t)(virConnectPtr conn, const char* name);
     typedef char* (*virDomainGetXMLDesc_t)(virDomainPtr domain, unsigned int flags);
+    typedef const char* (*virDomainGetName_t)(virDomainPtr domain);
     typedef int (*virDomainDestroy_t)(virDomainPtr domain);
     typedef int (*virDomainFree_t)(virDomainPtr domain);
     typedef virDomainPtr (*virDomainDefineXML_t)(virConnectPtr conn, const char* xml);
@@ -84,6 +95,21 @@ private:
     typedef int (*virDomainHasManagedSaveImage_t)(virDomainPtr domain, unsigned int flags);
     typedef int (*virDomainSetVcpusFlags_t)(virDomainPtr domain, unsigned int nvcpus, unsigned int flags);
     typedef int (*virDomainSetMemoryFlags_t)(virDomainPtr domain, unsigned long memory, unsigned int flags);
+    typedef int (*virDomainMemoryStats_t)(virDomainPtr domain, virDomainMemoryStatPtr stats, unsigned int nr_stats,
+                                          unsigned int flags);
+    typedef int (*virDomainGetGuestInfo_t)(virDomainPtr domain, unsigned int types, virTypedParameterPtr* params,
+                                           int* nparams, unsigned int flags);
+    typedef void (*virTypedParamsFree_t)(virTypedParameterPtr params, int nparams);
+    typedef virStoragePoolPtr (*virStoragePoolLookupByName_t)(virConnectPtr conn, const char* name);
+    typedef int (*virStoragePoolFree_t)(virStoragePoolPtr pool);
+    typedef virStorageVolPtr (*virStorageVolCreateXML_t)(virStoragePoolPtr pool, const char* xmlDesc,
+                                                         unsigned int flags);
+    typedef virStorageVolPtr (*virStorageVolLookupByName_t)(virStoragePoolPtr pool, const char* name);
+    typedef virStorageVolPtr (*virStorageVolLookupByPath_t)(virConnectPtr conn, const char* path);
+    typedef char* (*virStorageVolGetPath_t)(virStorageVolPtr vol);
+    typedef int (*virStorageVolResize_t)(virStorageVolPtr vol, unsigned long long capacity, unsigned int flags);
+    typedef int (*virStorageVolDelete_t)(virStorageVolPtr vol, unsigned int flags);
+    typedef int (*virStorageVolFree_t)(virStorageVolPtr vol);
     typedef const char* (*virGetLastErrorMessage_t)();
 
     void* handle{nullptr};
@@ -98,6 +124,14 @@ public:
     virConnectClose_t virConnectClose;
     virConnectGetCapabilities_t virConnectGetCapabilities;
     virConnectGetVersion_t virConnectGetVersion;
+    virConnectIsAlive_t virConnectIsAlive;
+    virConnectSetKeepAlive_t virConnectSetKeepAlive;
+    virConnectDomainEventRegisterAny_t virConnectDomainEventRegisterAny;
+    virConnectDomainEventDeregisterAny_t virConnectDomainEventDeregisterAny;
+    virEventRegisterDefaultImpl_t virEventRegisterDefaultImpl;
+    virEventRunDefaultImpl_t virEventRunDefaultImpl;
+    virEventAddTimeout_t virEventAddTimeout;
+    virEventRemoveTimeout_t virEventRemoveTimeout;
     virNetworkLookupByName_t virNetworkLookupByName;
     virNetworkCreateXML_t virNetworkCreateXML;
     virNetworkDestroy_t virNetworkDestroy;
@@ -110,6 +144,7 @@ public:
     virDomainUndefine_t virDomainUndefine;
     virDomainLookupByName_t virDomainLookupByName;
     virDomainGetXMLDesc_t virDomainGetXMLDesc;
+    virDomainGetName_t virDomainGetName;
     virDomainDestroy_t virDomainDestroy;
     virDomainFree_t virDomainFree;
     virDomainDefineXML_t virDomainDefineXML;
@@ -120,6 +155,18 @@ public:
     virDomainHasManagedSaveImage_t virDomainHasManagedSaveImage;
     virDomainSetVcpusFlags_t virDomainSetVcpusFlags;
     virDomainSetMemoryFlags_t virDomainSetMemoryFlags;
+    virDomainMemoryStats_t virDomainMemoryStats;
+    virDomainGetGuestInfo_t virDomainGetGuestInfo;
+    virTypedParamsFree_t virTypedParamsFree;
+    virStoragePoolLookupByName_t virStoragePoolLookupByName;
+    virStoragePoolFree_t virStoragePoolFree;
+    virStorageVolCreateXML_t virStorageVolCreateXML;
+    virStorageVolLookupByName_t virStorageVolLookupByName;
+    virStorageVolLookupByPath_t virStorageVolLookupByPath;
+    virStorageVolGetPath_t virStorageVolGetPath;
+    virStorageVolResize_t virStorageVolResize;
+    virStorageVolDelete_t virStorageVolDelete;
+    virStorageVolFree_t virStorageVolFree;
     virGetLastErrorMessage_t virGetLastErrorMessage;
 };
 } // namespace multipass
@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "lxd_event_subscriber.h"
+#include "lxd_request.h"
+
+#include <multipass/exceptions/local_socket_connection_exception.h>
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QRandomGenerator>
+
+#include <array>
+#include <cassert>
+#include <utility>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+constexpr auto category = "lxd events";
+constexpr auto connect_timeout = 5000; // in milliseconds
+constexpr auto read_interval = 500;    // in milliseconds, how soon the follower notices that it is stopping
+constexpr auto reconnect_interval = 5s;
+constexpr auto max_finished_operations = 256u;
+
+const QByteArray handshake_end{"\r\n\r\n"};
+
+enum class Opcode : char
+{
+    continuation = 0x0,
+    text = 0x1,
+    binary = 0x2,
+    close = 0x8,
+    ping = 0x9,
+    pong = 0xA
+};
+
+// Client frames must be masked (RFC 6455, 5.3)
+QByteArray client_frame(Opcode opcode, const QByteArray& payload)
+{
+    assert(payload.size() < 126 && "only control frames are sent");
+
+    QByteArray frame;
+    frame.append(char(0x80 | char(opcode)));
+    frame.append(char(0x80 | payload.size()));
+
+    const auto mask = QRandomGenerator::global()->generate();
+    const std::array<char, 4> key{char(mask >> 24), char(mask >> 16), char(mask >> 8), char(mask)};
+    frame.append(key.data(), int(key.size()));
+
+    for (auto i = 0; i < payload.size(); ++i)
+        frame.append(char(payload[i] ^ key[i % 4]));
+
+    return frame;
+}
+
+int status_code_of(const QJsonObject& operation)
+{
+    return operation["status_code"].toInt(-1);
+}
+
+bool is_done(const QJsonObject& operation)
+{
+    return status_code_of(operation) >= 200; // Success, Failure or Cancelled
+}
+
+// What LXD says of an instance when an action of its lifecycle completes, or nullopt when we would rather ask
+mp::optional<int> status_code_after(const QString& action)
+{
+    if (action == "instance-started" || action == "instance-restarted" || action == "instance-resumed")
+        return 103; // Running
+    if (action == "instance-stopped" || action == "instance-shutdown")
+        return 102; // Stopped
+    if (action == "instance-paused")
+        return 110; // Frozen
+
+    return mp::nullopt;
+}
+
+// Instances show up as /1.0/instances/<name>, possibly with more path or a query after the name
+QString instance_name_in(const QString& source)
+{
+    static const auto prefixes =
+        std::array{QStringLiteral("/1.0/instances/"), QStringLiteral("/1.0/virtual-machines/")};
+
+    for (const auto& prefix : prefixes)
+        if (source.startsWith(prefix))
+            return source.mid(prefix.size()).section('/', 0, 0).section('?', 0, 0);
+
+    return {};
+}
+} // namespace
+
+bool mp::WebSocketStream::feed(const QByteArray& bytes)
+{
+    buffer.append(bytes);
+
+    while (buffer.size() >= 2)
+    {
+        const auto first = uchar(buffer[0]), second = uchar(buffer[1]);
+        const auto fin = bool(first & 0x80);
+        const auto opcode = Opcode(first & 0x0F);
+        const auto masked = bool(second & 0x80);
+
+        qint64 header_size = 2, payload_size = second & 0x7F;
+        if (payload_size == 126)
+        {
+            header_size += 2;
+            if (buffer.size() < header_size)
+                break;
+
+            payload_size = (uchar(buffer[2]) << 8) | uchar(buffer[3]);
+        }
+        else if (payload_size == 127)
+        {
+            header_size += 8;
+            if (buffer.size() < header_size)
+                break;
+
+            payload_size = 0;
+            for (auto i = 2; i < 10; ++i)
+                payload_size = (payload_size << 8) | uchar(buffer[i]);
+        }
+
+        const auto key_offset = header_size;
+        if (masked)
+            header_size += 4;
+
+        if (buffer.size() < header_size + payload_size)
+            break;
+
+        auto payload = buffer.mid(int(header_size), int(payload_size));
+        if (masked)
+            for (auto i = 0; i < payload.size(); ++i)
+                payload[i] = char(payload[i] ^ buffer[int(key_offset) + i % 4]);
+
+        buffer.remove(0, int(header_size + payload_size));
+
+        switch (opcode)
+        {
+        case Opcode::text:
+        case Opcode::binary:
+        case Opcode::continuation:
+            fragments.append(payload);
+            if (fin)
+            {
+                messages.push_back(fragments);
+                fragments.clear();
+            }
+            break;
+        case Opcode::ping:
+            replies.append(client_frame(Opcode::pong, payload));
+            break;
+        case Opcode::close:
+            replies.append(client_frame(Opcode::close, payload.left(2))); // echo the status code, as the protocol asks
+            return false;
+        default: // pongs and reserved opcodes
+            break;
+        }
+    }
+
+    return true;
+}
+
+std::vector<QByteArray> mp::WebSocketStream::take_messages()
+{
+    return std::exchange(messages, {});
+}
+
+QByteArray mp::WebSocketStream::take_replies()
+{
+    return std::exchange(replies, {});
+}
+
+mp::LXDEventSubscriber::LXDEventSubscriber(const QUrl& base_url)
+{
+    const auto url_parts = base_url.toString().split('@');
+    if (url_parts.count() != 2)
+        throw LocalSocketConnectionException("The local socket scheme is malformed.");
+
+    const auto socket_path = QUrl(url_parts[0]).path();
+    const auto events_path =
+        QString("/%1/events?type=operation,lifecycle&project=%2").arg(url_parts[1]).arg(lxd_project_name);
+
+    follower = std::thread{&LXDEventSubscriber::follow_events, this, socket_path, events_path};
+}
+
+mp::LXDEventSubscriber::LXDEventSubscriber() : connected{true}
+{
+}
+
+mp::LXDEventSubscriber::~LXDEventSubscriber()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    cv.notify_all();
+
+    if (follower.joinable())
+        follower.join();
+}
+
+bool mp::LXDEventSubscriber::is_connected() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return connected;
+}
+
+auto mp::LXDEventSubscriber::instance_status_code(const QString& name) const -> optional<int>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (auto it = instance_status_codes.find(name.toStdString()); connected && it != instance_status_codes.end())
+        return it->second;
+
+    return nullopt;
+}
+
+auto mp::LXDEventSubscriber::images_version() const -> optional<unsigned long long>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (connected)
+        return image_changes;
+
+    return nullopt;
+}
+
+auto mp::LXDEventSubscriber::networks_version() const -> optional<unsigned long long>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (connected)
+        return network_changes;
+
+    return nullopt;
+}
+
+void mp::LXDEventSubscriber::note_instance_status_code(const QString& name, int status_code)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (connected)
+        instance_status_codes.emplace(name.toStdString(), status_code);
+}
+
+void mp::LXDEventSubscriber::forget_instance(const QString& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    instance_status_codes.erase(name.toStdString());
+}
+
+bool mp::LXDEventSubscriber::wait_for_instance_event(const QString& name, std::chrono::milliseconds timeout) const
+{
+    const auto key = name.toStdString();
+    auto events_about = [this, &key] {
+        auto it = instance_events.find(key);
+        return it == instance_events.end() ? 0u : it->second;
+    };
+
+    std::unique_lock<std::mutex> lock{mutex};
+    const auto seen = events_about();
+
+    return cv.wait_for(lock, timeout, [&] { return !connected || stopping || events_about() != seen; }) && connected &&
+           events_about() != seen;
+}
+
+auto mp::LXDEventSubscriber::wait_for_operation(const QString& id, std::chrono::milliseconds timeout,
+                                                const OperationUpdate& on_update) const -> optional<QJsonObject>
+{
+    const auto key = id.toStdString();
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    optional<QJsonObject> latest, reported;
+
+    std::unique_lock<std::mutex> lock{mutex};
+    while (true)
+    {
+        if (!connected || stopping)
+            return nullopt;
+
+        if (auto it = operations.find(key); it != operations.end())
+        {
+            latest = it->second;
+            if (is_done(*latest))
+                return latest;
+
+            if (on_update && latest != reported)
+            {
+                reported = latest;
+
+                lock.unlock();
+                on_update(*reported);
+                lock.lock();
+
+                continue; // things may have moved on in the meantime
+            }
+        }
+
+        const auto seen = generation;
+        if (!cv.wait_until(lock, deadline, [this, seen] { return generation != seen || stopping; }))
+            return latest;
+    }
+}
+
+void mp::LXDEventSubscriber::handle_event(const QJsonObject& event)
+{
+    const auto type = event["type"].toString();
+    const auto metadata = event["metadata"].toObject();
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (type == "operation")
+        {
+            const auto id = metadata["id"].toString().toStdString();
+            if (id.empty())
+                return;
+
+            auto& operation = operations[id];
+            const auto was_done = is_done(operation);
+            operation = metadata;
+
+            if (is_done(operation) && !was_done)
+            {
+                finished_operations.push_back(id);
+                if (finished_operations.size() > max_finished_operations)
+                {
+                    operations.erase(finished_operations.front());
+                    finished_operations.pop_front();
+                }
+            }
+        }
+        else if (type == "lifecycle" && metadata["source"].toString().startsWith("/1.0/images"))
+        {
+            ++image_changes; // created, deleted, refreshed, aliased...
+        }
+        else if (type == "lifecycle" && metadata["source"].toString().startsWith("/1.0/networks"))
+        {
+            ++network_changes;
+        }
+        else if (type == "lifecycle")
+        {
+            const auto name = instance_name_in(metadata["source"].toString()).toStdString();
+            if (name.empty())
+                return;
+
+            if (auto status_code = status_code_after(metadata["action"].toString()))
+                instance_status_codes[name] = *status_code;
+            else
+                instance_status_codes.erase(name); // renamed, deleted, reconfigured... better ask next time
+
+            ++instance_events[name];
+        }
+        else
+        {
+            return;
+        }
+
+        ++generation;
+    }
+    cv.notify_all();
+}
+
+bool mp::LXDEventSubscriber::is_stopping() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return stopping;
+}
+
+void mp::LXDEventSubscriber::set_connected(bool connected)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        this->connected = connected;
+
+        if (!connected) // what we missed in the meantime could have invalidated any of it
+        {
+            instance_status_codes.clear();
+            operations.clear();
+            finished_operations.clear();
+        }
+
+        ++image_changes;
+        ++network_changes;
+        ++generation;
+    }
+    cv.notify_all();
+}
+
+void mp::LXDEventSubscriber::follow_events(const QString& socket_path, const QString& events_path)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    while (!stopping)
+    {
+        lock.unlock();
+
+        try
+        {
+            follow_connection(socket_path, events_path);
+
+            if (!is_stopping())
+                mpl::log(mpl::Level::debug, category, "Lost the LXD event stream");
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("Cannot follow LXD events: {}", e.what()));
+        }
+
+        set_connected(false);
+
+        lock.lock();
+        cv.wait_for(lock, reconnect_interval, [this] { return stopping; });
+    }
+}
+
+// Follows the stream until it ends or the subscriber stops; throws when the stream cannot be set up
+void mp::LXDEventSubscriber::follow_connection(const QString& socket_path, const QString& events_path)
+{
+    QLocalSocket socket;
+    socket.connectToServer(socket_path);
+    if (!socket.waitForConnected(connect_timeout))
+        throw LocalSocketConnectionException(
+            fmt::format("Cannot connect to {}: {}", socket_path, socket.errorString()));
+
+    QByteArray key(16, '\0');
+    QRandomGenerator::global()->generate(key.begin(), key.end());
+
+    socket.write(QString("GET %1 HTTP/1.1\r\n"
+                         "Host: %2\r\n"
+                         "Upgrade: websocket\r\n"
+                         "Connection: Upgrade\r\n"
+                         "Sec-WebSocket-Key: %3\r\n"
+                         "Sec-WebSocket-Version: 13\r\n\r\n")
+                     .arg(events_path, lxd_project_name, QString::fromLatin1(key.toBase64()))
+                     .toLatin1());
+    socket.flush();
+
+    QByteArray response;
+    while (!response.contains(handshake_end))
+    {
+        if (!socket.waitForReadyRead(connect_timeout))
+            throw LXDRuntimeError(fmt::format("No answer to the event subscription: {}", socket.errorString()));
+
+        response.append(socket.readAll());
+    }
+
+    const auto headers_size = response.indexOf(handshake_end) + handshake_end.size();
+    const auto status_line = response.left(response.indexOf("\r\n"));
+    if (!status_line.contains(" 101 "))
+        throw LXDRuntimeError(fmt::format("Event subscription refused: {}", status_line));
+
+    mpl::log(mpl::Level::debug, category, "Following the LXD event stream");
+    set_connected(true);
+
+    WebSocketStream stream;
+    auto open = stream.feed(response.mid(headers_size));
+
+    while (true)
+    {
+        for (const auto& message : stream.take_messages())
+        {
+            QJsonParseError json_error;
+            const auto event = QJsonDocument::fromJson(message, &json_error);
+
+            if (json_error.error == QJsonParseError::NoError && event.isObject())
+                handle_event(event.object());
+            else
+                mpl::log(mpl::Level::trace, category, fmt::format("Ignoring unreadable event: {}", message));
+        }
+
+        if (const auto replies = stream.take_replies(); !replies.isEmpty())
+        {
+            socket.write(replies);
+            socket.flush();
+        }
+
+        if (!open || is_stopping())
+            break;
+
+        if (socket.waitForReadyRead(read_interval))
+            open = stream.feed(socket.readAll());
+        else if (socket.state() != QLocalSocket::ConnectedState)
+            break;
+    }
+
+    socket.disconnectFromServer();
+}
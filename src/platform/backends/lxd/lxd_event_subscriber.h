@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_LXD_EVENT_SUBSCRIBER_H
+#define MULTIPASS_LXD_EVENT_SUBSCRIBER_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/optional.h>
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QUrl>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Follows LXD's /1.0/events websocket on a thread of its own, keeping the status code of each instance and the last
+ * update of each operation that LXD pushes. Callers consult it instead of polling; while it is not connected it knows
+ * nothing, and they fall back to asking LXD.
+ */
+class LXDEventSubscriber : private DisabledCopyMove
+{
+public:
+    using UPtr = std::unique_ptr<LXDEventSubscriber>;
+    using OperationUpdate = std::function<void(const QJsonObject&)>; // may throw to stop waiting
+
+    explicit LXDEventSubscriber(const QUrl& base_url); // in the unix:///path/to/socket@1.0 form
+    LXDEventSubscriber();                              // Mainly for testing: connected to nothing, fed by hand
+    ~LXDEventSubscriber();
+
+    bool is_connected() const;
+
+    optional<int> instance_status_code(const QString& name) const;
+    void note_instance_status_code(const QString& name, int status_code); // from a GET; events that came first win
+    void forget_instance(const QString& name);
+
+    // Changes whenever LXD's images might have, for listings to be reused while it stays the same; nullopt when not
+    // connected, since then nothing says what changed
+    optional<unsigned long long> images_version() const;
+    optional<unsigned long long> networks_version() const; // likewise, for LXD's networks
+
+    // Returns early, true, when an event about the instance arrives; false on timeout or when not connected
+    bool wait_for_instance_event(const QString& name, std::chrono::milliseconds timeout) const;
+
+    // Returns the last update of the operation once it is done, or the latest one on timeout. Nullopt when not
+    // connected, or when the operation never showed up, which leaves it to the caller to ask LXD instead.
+    optional<QJsonObject> wait_for_operation(const QString& id, std::chrono::milliseconds timeout,
+                                             const OperationUpdate& on_update = nullptr) const;
+
+    void handle_event(const QJsonObject& event);
+
+private:
+    void follow_events(const QString& socket_path, const QString& events_path);
+    void follow_connection(const QString& socket_path, const QString& events_path);
+    bool is_stopping() const;
+    void set_connected(bool connected);
+
+    mutable std::mutex mutex;
+    mutable std::condition_variable cv;
+    bool connected{false};
+    bool stopping{false};
+    unsigned long long generation{0}; // bumped on every change, to wake up waiters
+    unsigned long long image_changes{0};
+    unsigned long long network_changes{0};
+    std::unordered_map<std::string, int> instance_status_codes;
+    std::unordered_map<std::string, unsigned> instance_events;
+    std::unordered_map<std::string, QJsonObject> operations;
+    std::deque<std::string> finished_operations; // oldest first, to bound how many are kept
+    std::thread follower;
+};
+
+// The client side of a websocket connection, past the handshake: unframes what the server sends
+class WebSocketStream
+{
+public:
+    bool feed(const QByteArray& bytes);  // returns false once the server has closed the connection
+    std::vector<QByteArray> take_messages(); // complete data messages, in order
+    QByteArray take_replies();           // pongs and the closing echo, masked as clients must
+
+private:
+    QByteArray buffer;
+    QByteArray fragments;
+    std::vector<QByteArray> messages;
+    QByteArray replies;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_LXD_EVENT_SUBSCRIBER_H
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "lxd_instance_snapshot.h"
+
+#include <QJsonObject>
+
+namespace mp = multipass;
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+constexpr auto snapshot_lifetime = 5s;
+} // namespace
+
+void mp::LXDInstanceSnapshot::update(const QJsonArray& instances, const QJsonArray& leases)
+{
+    std::unordered_map<std::string, int> new_status_codes;
+    std::unordered_map<std::string, std::string> new_ipv4_by_mac;
+
+    for (const auto instance_value : instances)
+    {
+        const auto instance = instance_value.toObject();
+        const auto state = instance["state"].toObject();
+        new_status_codes.emplace(instance["name"].toString().toStdString(),
+                                 state["status_code"].toInt(instance["status_code"].toInt(-1)));
+
+        // Guest addresses, when the LXD agent reports them; the leases below take precedence
+        const auto interfaces = state["network"].toObject();
+        for (const auto& interface_value : interfaces)
+        {
+            const auto interface = interface_value.toObject();
+            for (const auto address_value : interface["addresses"].toArray())
+            {
+                const auto address = address_value.toObject();
+                if (address["family"] == QStringLiteral("inet") && address["scope"] == QStringLiteral("global"))
+                {
+                    new_ipv4_by_mac.emplace(interface["hwaddr"].toString().toStdString(),
+                                            address["address"].toString().toStdString());
+                    break;
+                }
+            }
+        }
+    }
+
+    for (const auto lease_value : leases)
+    {
+        const auto lease = lease_value.toObject();
+        const auto address = lease["address"].toString();
+        if (!address.contains(':')) // IPv6 leases are of no use here
+            new_ipv4_by_mac[lease["hwaddr"].toString().toStdString()] = address.toStdString();
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    status_codes = std::move(new_status_codes);
+    ipv4_by_mac = std::move(new_ipv4_by_mac);
+    taken_at = std::chrono::steady_clock::now();
+}
+
+void mp::LXDInstanceSnapshot::forget(const QString& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    status_codes.erase(name.toStdString());
+}
+
+auto mp::LXDInstanceSnapshot::status_code_of(const QString& name) const -> optional<int>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (auto it = status_codes.find(name.toStdString()); is_fresh() && it != status_codes.end() && it->second >= 0)
+        return it->second;
+
+    return nullopt;
+}
+
+auto mp::LXDInstanceSnapshot::ipv4_for(const QString& mac_addr) const -> optional<IPAddress>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (auto it = ipv4_by_mac.find(mac_addr.toStdString()); is_fresh() && it != ipv4_by_mac.end())
+    {
+        try
+        {
+            return IPAddress{it->second};
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+
+    return nullopt;
+}
+
+bool mp::LXDInstanceSnapshot::is_fresh() const
+{
+    return taken_at != std::chrono::steady_clock::time_point{} &&
+           std::chrono::steady_clock::now() - taken_at < snapshot_lifetime;
+}
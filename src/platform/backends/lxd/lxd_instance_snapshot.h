@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_LXD_INSTANCE_SNAPSHOT_H
+#define MULTIPASS_LXD_INSTANCE_SNAPSHOT_H
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/ip_address.h>
+#include <multipass/optional.h>
+
+#include <QJsonArray>
+#include <QString>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace multipass
+{
+/**
+ * What a bulk query said of every instance, for a few seconds, so that an operation that goes through all of them
+ * (list, info) costs one round trip to LXD rather than one or two per instance.
+ */
+class LXDInstanceSnapshot : private DisabledCopyMove
+{
+public:
+    // Takes the instances as /1.0/virtual-machines?recursion=2 lists them and the leases of the bridge
+    void update(const QJsonArray& instances, const QJsonArray& leases);
+    void forget(const QString& name); // for when the instance is known to be changing
+
+    // Nullopt when the snapshot is stale or does not tell
+    optional<int> status_code_of(const QString& name) const;
+    optional<IPAddress> ipv4_for(const QString& mac_addr) const;
+
+private:
+    bool is_fresh() const; // requires the lock
+
+    mutable std::mutex mutex;
+    std::chrono::steady_clock::time_point taken_at;
+    std::unordered_map<std::string, int> status_codes;
+    std::unordered_map<std::string, std::string> ipv4_by_mac;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_LXD_INSTANCE_SNAPSHOT_H
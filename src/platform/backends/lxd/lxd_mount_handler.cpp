@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "lxd_mount_handler.h"
+#include "lxd_request.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/ssh/ssh_session.h>
+#include <multipass/utils.h>
+#include <multipass/virtual_machine.h>
+
+#include <QCryptographicHash>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "lxd mounts";
+constexpr auto lxd_wait_timeout = 60000; // in milliseconds
+
+// LXD device names are limited in length and characters, so derive a stable one from the target path
+std::string device_name_for(const std::string& target_path)
+{
+    const auto hash = QCryptographicHash::hash(QByteArray::fromStdString(target_path), QCryptographicHash::Sha1);
+    return fmt::format("multipass-mount-{}", hash.toHex().left(12).toStdString());
+}
+
+void run_in_instance(mp::SSHSession& session, const std::string& cmd)
+{
+    mpl::log(mpl::Level::debug, category, fmt::format("executing '{}'", cmd));
+    auto proc = session.exec(cmd);
+
+    if (proc.exit_code() != 0)
+    {
+        auto error_msg = proc.read_std_error();
+        throw std::runtime_error{mp::utils::trim_end(error_msg)};
+    }
+}
+} // namespace
+
+mp::LXDMountHandler::LXDMountHandler(NetworkAccessManager* manager, const QUrl& base_url,
+                                     const SSHKeyProvider& ssh_key_provider)
+    : manager{manager}, base_url{base_url}, ssh_key_provider{ssh_key_provider}
+{
+}
+
+void mp::LXDMountHandler::start_mount(VirtualMachine* vm, const std::string& source_path,
+                                      const std::string& target_path, const id_mappings& gid_mappings,
+                                      const id_mappings& uid_mappings, const std::string& /*profile*/)
+{
+    // Profiles only tune SSHFS, LXD picks its own settings for the share
+
+    if (!gid_mappings.empty() || !uid_mappings.empty())
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Native mount '{}' in instance \"{}\" keeps host ownership, ID mappings are not applied",
+                             target_path, vm->vm_name));
+
+    const auto device_name = device_name_for(target_path);
+
+    /*
+     * similar to:
+     * $ curl -s -w "%{http_code}" -X PATCH -H "Content-Type: application/json" \
+     *        -d '{"devices": {"multipass-mount-<hash>": {"type": "disk", "source": "/home", "path": "/home"}}}' \
+     *        --unix-socket /var/snap/lxd/common/lxd/unix.socket \
+     *        lxd/1.0/virtual-machines/asdf?project=multipass
+     */
+    QJsonObject device_json{{"type", "disk"},
+                            {"source", QString::fromStdString(source_path)},
+                            {"path", QString::fromStdString(target_path)}};
+    QJsonObject patch_json{{"devices", QJsonObject{{QString::fromStdString(device_name), device_json}}}};
+    lxd_request(manager, "PATCH", instance_url(vm->vm_name), patch_json);
+
+    Mount mount{device_name, vm->ssh_hostname(), vm->ssh_port(), vm->ssh_username()};
+    try
+    {
+        // The LXD agent mounts disk devices by itself, when the image ships it
+        const auto target = mp::utils::escape_for_shell(target_path);
+        mp::SSHSession session{mount.ssh_hostname, mount.ssh_port, mount.ssh_username, ssh_key_provider};
+        run_in_instance(session, fmt::format("sudo mkdir -p {0} && (mountpoint -q {0} || "
+                                             "sudo mount -t virtiofs lxd_{1} {0} || "
+                                             "sudo mount -t 9p -o trans=virtio,version=9p2000.L lxd_{1} {0})",
+                                             target, device_name));
+    }
+    catch (const std::exception& e)
+    {
+        remove_device(vm->vm_name, target_path, mount);
+        throw std::runtime_error{fmt::format("cannot mount the shared directory: {}", e.what())};
+    }
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("mounting {} => {} in {} natively", source_path, target_path, vm->vm_name));
+    mounts[vm->vm_name][target_path] = std::move(mount);
+}
+
+bool mp::LXDMountHandler::stop_mount(const std::string& instance, const std::string& path)
+{
+    auto instance_it = mounts.find(instance);
+    if (instance_it == mounts.end())
+        return false;
+
+    auto mount_it = instance_it->second.find(path);
+    if (mount_it == instance_it->second.end())
+        return false;
+
+    remove_device(instance, path, mount_it->second);
+    instance_it->second.erase(mount_it);
+
+    return true;
+}
+
+void mp::LXDMountHandler::stop_all_mounts_for_instance(const std::string& instance)
+{
+    auto instance_it = mounts.find(instance);
+    if (instance_it == mounts.end())
+        return;
+
+    for (const auto& mount : instance_it->second)
+        remove_device(instance, mount.first, mount.second);
+
+    mounts.erase(instance_it);
+}
+
+bool mp::LXDMountHandler::has_instance_already_mounted(const std::string& instance, const std::string& path) const
+{
+    auto instance_it = mounts.find(instance);
+    return instance_it != mounts.end() && instance_it->second.count(path);
+}
+
+void mp::LXDMountHandler::remove_device(const std::string& instance, const std::string& target_path,
+                                        const Mount& mount)
+{
+    try
+    {
+        mp::SSHSession session{mount.ssh_hostname, mount.ssh_port, mount.ssh_username, ssh_key_provider};
+        run_in_instance(session, fmt::format("! mountpoint -q {0} || sudo umount {0}",
+                                             mp::utils::escape_for_shell(target_path)));
+    }
+    catch (const std::exception& e)
+    {
+        // the instance may be going down already
+        mpl::log(mpl::Level::debug, category,
+                 fmt::format("Cannot unmount '{}' in instance \"{}\": {}", target_path, instance, e.what()));
+    }
+
+    try
+    {
+        // Devices can only be dropped by putting back the whole instance configuration without them
+        auto instance_info = lxd_request(manager, "GET", instance_url(instance));
+        auto metadata = instance_info["metadata"].toObject();
+        auto devices = metadata["devices"].toObject();
+        devices.remove(QString::fromStdString(mount.device_name));
+        metadata["devices"] = devices;
+
+        auto task = lxd_request(manager, "PUT", instance_url(instance), metadata);
+        lxd_wait(manager, base_url, task, lxd_wait_timeout);
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot remove the device for mount '{}' from instance \"{}\": {}", target_path, instance,
+                             e.what()));
+    }
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Native mount '{}' in instance \"{}\" has stopped", target_path, instance));
+}
+
+QUrl mp::LXDMountHandler::instance_url(const std::string& instance) const
+{
+    return QString("%1/virtual-machines/%2").arg(base_url.toString()).arg(QString::fromStdString(instance));
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_LXD_MOUNT_HANDLER_H
+#define MULTIPASS_LXD_MOUNT_HANDLER_H
+
+#include <multipass/mount_handler.h>
+
+#include <QUrl>
+
+#include <string>
+#include <unordered_map>
+
+namespace multipass
+{
+class NetworkAccessManager;
+class SSHKeyProvider;
+
+/*
+ * Mounts shared through LXD disk devices, which LXD exposes to virtual machines over virtiofs (or 9p, when virtiofsd
+ * is not available). The device is mounted in the instance by its tag over SSH.
+ */
+class LXDMountHandler : public MountHandler
+{
+public:
+    LXDMountHandler(NetworkAccessManager* manager, const QUrl& base_url, const SSHKeyProvider& ssh_key_provider);
+
+    void start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
+                     const id_mappings& gid_mappings, const id_mappings& uid_mappings,
+                     const std::string& profile) override;
+    bool stop_mount(const std::string& instance, const std::string& path) override;
+    void stop_all_mounts_for_instance(const std::string& instance) override;
+    bool has_instance_already_mounted(const std::string& instance, const std::string& path) const override;
+
+private:
+    struct Mount
+    {
+        std::string device_name;
+        std::string ssh_hostname;
+        int ssh_port;
+        std::string ssh_username;
+    };
+
+    void remove_device(const std::string& instance, const std::string& target_path, const Mount& mount);
+    QUrl instance_url(const std::string& instance) const;
+
+    NetworkAccessManager* manager;
+    const QUrl base_url;
+    const SSHKeyProvider& ssh_key_provider;
+    std::unordered_map<std::string, std::unordered_map<std::string, Mount>> mounts;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_LXD_MOUNT_HANDLER_H
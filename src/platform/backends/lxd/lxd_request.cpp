@@ -16,6 +16,7 @@
  */
 
 #include "lxd_request.h"
+#include "lxd_event_subscriber.h"
 
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
@@ -27,6 +28,11 @@
 #include <QNetworkReply>
 #include <QTimer>
 
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <memory>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -34,13 +40,8 @@ namespace
 {
 constexpr auto request_category = "lxd request";
 
-template <typename Callable>
-const QJsonObject lxd_request_common(const std::string& method, QUrl& url, int timeout, Callable&& handle_request)
+QNetworkRequest prepare_request(const std::string& method, QUrl& url)
 {
-    QEventLoop event_loop;
-    QTimer download_timeout;
-    download_timeout.setInterval(timeout);
-
     if (url.host().isEmpty())
     {
         url.setHost(mp::lxd_project_name);
@@ -61,22 +62,53 @@ const QJsonObject lxd_request_common(const std::string& method, QUrl& url, int t
 
     request.setHeader(QNetworkRequest::UserAgentHeader, QString("Multipass/%1").arg(mp::version_string));
 
-    auto verb = QByteArray::fromStdString(method);
+    return request;
+}
+
+struct ReplyDeleter
+{
+    void operator()(QNetworkReply* reply) const
+    {
+        reply->deleteLater();
+    }
+};
+using ReplyUPtr = std::unique_ptr<QNetworkReply, ReplyDeleter>;
+
+// Waits on all of the replies at once, aborting those that are not finished by the timeout
+void wait_for(const std::vector<QNetworkReply*>& replies, int timeout)
+{
+    QEventLoop event_loop;
+    QTimer download_timeout;
+    download_timeout.setInterval(timeout);
 
-    auto reply = handle_request(request, verb);
+    auto pending = std::count_if(replies.cbegin(), replies.cend(), [](auto reply) { return !reply->isFinished(); });
+
+    for (auto reply : replies)
+    {
+        if (!reply->isFinished())
+            QObject::connect(reply, &QNetworkReply::finished, &event_loop, [&event_loop, &pending] {
+                if (--pending == 0)
+                    event_loop.quit();
+            });
+    }
 
-    QObject::connect(reply, &QNetworkReply::finished, &event_loop, &QEventLoop::quit);
     QObject::connect(&download_timeout, &QTimer::timeout, [&]() {
         download_timeout.stop();
-        reply->abort();
+
+        for (auto reply : replies)
+            if (!reply->isFinished())
+                reply->abort();
     });
 
-    if (!reply->isFinished())
+    if (pending)
     {
         download_timeout.start();
         event_loop.exec();
     }
+}
 
+const QJsonObject read_reply(QNetworkReply* reply, const std::string& method, const QUrl& url)
+{
     if (reply->error() == QNetworkReply::ContentNotFoundError)
         throw mp::LXDNotFoundException();
 
@@ -85,7 +117,6 @@ const QJsonObject lxd_request_common(const std::string& method, QUrl& url, int t
             fmt::format("Timeout getting response for {} operation on {}", method, url.toString()));
 
     auto bytearray_reply = reply->readAll();
-    reply->deleteLater();
 
     if (bytearray_reply.isEmpty())
         throw mp::LXDRuntimeError(fmt::format("Empty reply received for {} operation on {}", method, url.toString()));
@@ -118,6 +149,18 @@ const QJsonObject lxd_request_common(const std::string& method, QUrl& url, int t
 
     return json_reply.object();
 }
+
+template <typename Callable>
+const QJsonObject lxd_request_common(const std::string& method, QUrl& url, int timeout, Callable&& handle_request)
+{
+    auto request = prepare_request(method, url);
+    auto verb = QByteArray::fromStdString(method);
+
+    ReplyUPtr reply{handle_request(request, verb)};
+    wait_for({reply.get()}, timeout);
+
+    return read_reply(reply.get(), method, url);
+}
 } // namespace
 
 const QJsonObject mp::lxd_request(mp::NetworkAccessManager* manager, const std::string& method, QUrl url,
@@ -167,8 +210,58 @@ catch (const LXDRuntimeError& e)
     throw;
 }
 
+std::vector<mp::optional<QJsonObject>> mp::lxd_requests(mp::NetworkAccessManager* manager, const std::string& method,
+                                                       std::vector<QUrl> urls, int timeout)
+try
+{
+    const auto verb = QByteArray::fromStdString(method);
+
+    std::vector<ReplyUPtr> replies;
+    for (auto& url : urls)
+    {
+        auto request = prepare_request(method, url);
+        replies.emplace_back(manager->sendCustomRequest(request, verb));
+    }
+
+    std::vector<QNetworkReply*> pending;
+    std::transform(replies.cbegin(), replies.cend(), std::back_inserter(pending),
+                   [](const auto& reply) { return reply.get(); });
+    wait_for(pending, timeout);
+
+    std::vector<mp::optional<QJsonObject>> results;
+    std::exception_ptr first_error;
+    for (auto i = 0u; i < replies.size(); ++i)
+    {
+        try
+        {
+            results.push_back(read_reply(replies[i].get(), method, urls[i]));
+        }
+        catch (const LXDNotFoundException&)
+        {
+            results.push_back(mp::nullopt);
+        }
+        catch (...)
+        {
+            results.push_back(mp::nullopt);
+            if (!first_error)
+                first_error = std::current_exception();
+        }
+    }
+
+    if (first_error)
+        std::rethrow_exception(first_error);
+
+    return results;
+}
+catch (const LXDRuntimeError& e)
+{
+    mpl::log(mpl::Level::error, request_category, e.what());
+
+    throw;
+}
+
 const QJsonObject mp::lxd_wait(mp::NetworkAccessManager* manager, const QUrl& base_url, const QJsonObject& task_data,
-                               int timeout)
+                               int timeout, LXDEventSubscriber* events)
 try
 {
     QJsonObject task_reply;
@@ -176,11 +269,23 @@ try
     if (task_data["metadata"].toObject()["class"] == QStringLiteral("task") &&
         task_data["status_code"].toInt(-1) == 100)
     {
-        QUrl task_url(QString("%1/operations/%2/wait")
-                          .arg(base_url.toString())
-                          .arg(task_data["metadata"].toObject()["id"].toString()));
+        const auto id = task_data["metadata"].toObject()["id"].toString();
+        const auto operation =
+            events ? events->wait_for_operation(id, std::chrono::milliseconds(timeout)) : mp::nullopt;
+
+        if (operation)
+        {
+            if ((*operation)["status_code"].toInt(-1) < 200)
+                throw mp::LXDRuntimeError(fmt::format("Timeout waiting on operation {}", id));
 
-        task_reply = lxd_request(manager, "GET", task_url, mp::nullopt, timeout);
+            task_reply = QJsonObject{{"metadata", *operation}}; // in the shape of what the wait endpoint returns
+        }
+        else
+        {
+            QUrl task_url(QString("%1/operations/%2/wait").arg(base_url.toString()).arg(id));
+
+            task_reply = lxd_request(manager, "GET", task_url, mp::nullopt, timeout);
+        }
 
         if (task_reply["error_code"].toInt() >= 400)
         {
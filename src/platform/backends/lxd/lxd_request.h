@@ -25,12 +25,14 @@
 #include <QUrl>
 
 #include <string>
+#include <vector>
 
 namespace multipass
 {
 const QUrl lxd_socket_url{"unix:///var/snap/lxd/common/lxd/unix.socket@1.0"};
 const QString lxd_project_name{"multipass"};
 
+class LXDEventSubscriber;
 class NetworkAccessManager;
 
 class LXDNotFoundException : public std::runtime_error
@@ -64,8 +66,14 @@ const QJsonObject lxd_request(NetworkAccessManager* manager, const std::string&
 const QJsonObject lxd_request(NetworkAccessManager* manager, const std::string& method, QUrl url,
                               QHttpMultiPart& multi_part, int timeout = 30000 /* in milliseconds */);
 
+// Issues the requests all at once, each over a connection of its own, and waits for all of them. The replies come in
+// the order of the URLs, nullopt for what LXD did not find; any other failure is thrown once all the replies are in.
+std::vector<optional<QJsonObject>> lxd_requests(NetworkAccessManager* manager, const std::string& method,
+                                                std::vector<QUrl> urls, int timeout = 30000 /* in milliseconds */);
+
+// Waits on the events that LXD pushes when given a subscriber that follows them, asking LXD otherwise
 const QJsonObject lxd_wait(NetworkAccessManager* manager, const QUrl& base_url, const QJsonObject& task_data,
-                           int timeout /* in milliseconds */);
+                           int timeout /* in milliseconds */, LXDEventSubscriber* events = nullptr);
 } // namespace multipass
 
 #endif // MULTIPASS_LXD_REQUEST_H
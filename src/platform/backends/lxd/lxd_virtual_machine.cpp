@@ -16,6 +16,8 @@
  */
 
 #include "lxd_virtual_machine.h"
+#include "lxd_event_subscriber.h"
+#include "lxd_instance_snapshot.h"
 #include "lxd_request.h"
 
 #include <QJsonArray>
@@ -46,14 +48,28 @@ using namespace std::literals::chrono_literals;
 
 namespace
 {
-auto instance_state_for(const QString& name, mp::NetworkAccessManager* manager, const QUrl& url)
+auto instance_state_for(const QString& name, mp::NetworkAccessManager* manager, const QUrl& url,
+                        mp::LXDEventSubscriber* events, mp::LXDInstanceSnapshot* snapshot)
 {
-    auto json_reply = lxd_request(manager, "GET", url);
-    auto metadata = json_reply["metadata"].toObject();
-    mpl::log(mpl::Level::trace, name.toStdString(),
-             fmt::format("Got LXD container state: {} is {}", name, metadata["status"].toString()));
+    QString status{"as last pushed"};
+    auto status_code = events ? events->instance_status_code(name) : mp::nullopt;
 
-    switch (metadata["status_code"].toInt(-1))
+    if (!status_code && snapshot && (status_code = snapshot->status_code_of(name)))
+        status = "as last listed";
+
+    if (!status_code)
+    {
+        auto json_reply = lxd_request(manager, "GET", url);
+        auto metadata = json_reply["metadata"].toObject();
+        status = metadata["status"].toString();
+        status_code = metadata["status_code"].toInt(-1);
+        mpl::log(mpl::Level::trace, name.toStdString(), fmt::format("Got LXD container state: {} is {}", name, status));
+
+        if (events)
+            events->note_instance_status_code(name, *status_code);
+    }
+
+    switch (*status_code)
     {
     case 101: // Started
     case 103: // Running
@@ -74,14 +90,18 @@ auto instance_state_for(const QString& name, mp::NetworkAccessManager* manager,
         return mp::VirtualMachine::State::unknown;
     default:
         mpl::log(mpl::Level::error, name.toStdString(),
-                 fmt::format("Got unexpected LXD state: {} ({})", metadata["status"].toString(),
-                             metadata["status_code"].toInt()));
+                 fmt::format("Got unexpected LXD state: {} ({})", status, *status_code));
         return mp::VirtualMachine::State::unknown;
     }
 }
 
-mp::optional<mp::IPAddress> get_ip_for(const QString& mac_addr, mp::NetworkAccessManager* manager, const QUrl& url)
+mp::optional<mp::IPAddress> get_ip_for(const QString& mac_addr, mp::NetworkAccessManager* manager, const QUrl& url,
+                                       mp::LXDInstanceSnapshot* snapshot = nullptr)
 {
+    if (snapshot)
+        if (auto ip = snapshot->ipv4_for(mac_addr))
+            return ip;
+
     const auto json_leases = lxd_request(manager, "GET", url);
     const auto leases = json_leases["metadata"].toArray();
 
@@ -103,6 +123,14 @@ mp::optional<mp::IPAddress> get_ip_for(const QString& mac_addr, mp::NetworkAcces
     return mp::nullopt;
 }
 
+mp::optional<long long> bytes_in(const QJsonValue& value)
+{
+    if (!value.isDouble() || value.toDouble() <= 0) // LXD leaves out, or zeroes, what it does not know
+        return mp::nullopt;
+
+    return static_cast<long long>(value.toDouble());
+}
+
 QJsonObject generate_base_vm_config(const multipass::VirtualMachineDescription& desc)
 {
     QJsonObject config{{"limits.cpu", QString::number(desc.num_cores)},
@@ -156,7 +184,9 @@ QJsonObject generate_devices_config(const multipass::VirtualMachineDescription&
 
 mp::LXDVirtualMachine::LXDVirtualMachine(const VirtualMachineDescription& desc, VMStatusMonitor& monitor,
                                          NetworkAccessManager* manager, const QUrl& base_url,
-                                         const QString& bridge_name, const QString& storage_pool)
+                                         const QString& bridge_name, const QString& storage_pool,
+                                         LXDEventSubscriber* events, LXDInstanceSnapshot* snapshot,
+                                         QJsonObject creation)
     : BaseVirtualMachine{desc.vm_name},
       name{QString::fromStdString(desc.vm_name)},
       username{desc.ssh_username},
@@ -165,34 +195,51 @@ mp::LXDVirtualMachine::LXDVirtualMachine(const VirtualMachineDescription& desc,
       base_url{base_url},
       bridge_name{bridge_name},
       mac_addr{QString::fromStdString(desc.default_mac_address)},
-      storage_pool{storage_pool}
+      storage_pool{storage_pool},
+      events{events},
+      snapshot{snapshot}
 {
-    try
+    if (creation.isEmpty())
     {
-        current_state();
+        try
+        {
+            current_state();
+            return;
+        }
+        catch (const LXDNotFoundException&)
+        {
+            creation = request_creation(desc, manager, base_url, storage_pool);
+        }
     }
-    catch (const LXDNotFoundException& e)
-    {
-        mpl::log(mpl::Level::debug, name.toStdString(),
-                 fmt::format("Creating instance with image id: {}", desc.image.id));
 
-        QJsonObject virtual_machine{
-            {"name", name},
-            {"config", generate_base_vm_config(desc)},
-            {"devices", generate_devices_config(desc, mac_addr, storage_pool)},
-            {"source", QJsonObject{{"type", "image"}, {"fingerprint", QString::fromStdString(desc.image.id)}}}};
+    // TODO: Need a way to pass in the daemon timeout and make in general for all back ends
+    lxd_wait(manager, base_url, creation, 600000, events);
 
-        auto json_reply = lxd_request(manager, "POST", QUrl(QString("%1/virtual-machines").arg(base_url.toString())),
-                                      virtual_machine);
+    current_state();
+}
 
-        // TODO: Need a way to pass in the daemon timeout and make in general for all back ends
-        lxd_wait(manager, base_url, json_reply, 600000);
+QJsonObject mp::LXDVirtualMachine::request_creation(const VirtualMachineDescription& desc,
+                                                    NetworkAccessManager* manager, const QUrl& base_url,
+                                                    const QString& storage_pool)
+{
+    mpl::log(mpl::Level::debug, desc.vm_name, fmt::format("Creating instance with image id: {}", desc.image.id));
 
-        current_state();
-    }
+    QJsonObject virtual_machine{
+        {"name", QString::fromStdString(desc.vm_name)},
+        {"config", generate_base_vm_config(desc)},
+        {"devices", generate_devices_config(desc, QString::fromStdString(desc.default_mac_address), storage_pool)},
+        {"source", QJsonObject{{"type", "image"}, {"fingerprint", QString::fromStdString(desc.image.id)}}}};
+
+    return lxd_request(manager, "POST", QUrl(QString("%1/virtual-machines").arg(base_url.toString())),
+                       virtual_machine);
 }
 
 mp::LXDVirtualMachine::~LXDVirtualMachine()
+{
+    prepare_for_exit();
+}
+
+void mp::LXDVirtualMachine::prepare_for_exit()
 {
     update_shutdown_status = false;
 
@@ -271,6 +318,33 @@ void mp::LXDVirtualMachine::shutdown()
     stop();
 }
 
+void mp::LXDVirtualMachine::kill()
+{
+    mpl::log(mpl::Level::warning, vm_name, "Forcing the instance to stop");
+    request_state("stop", /*force=*/true);
+}
+
+void mp::LXDVirtualMachine::take_snapshot(const std::string& name)
+{
+    // Stateless, as the other backends' are: of the disk, for the instance to boot from
+    auto task = lxd_request(manager, "POST", QUrl{url().toString() + "/snapshots"},
+                            QJsonObject{{"name", QString::fromStdString(name)}, {"stateful", false}});
+    lxd_wait(manager, base_url, task, 300000, events);
+}
+
+void mp::LXDVirtualMachine::restore_snapshot(const std::string& name)
+{
+    auto task = lxd_request(manager, "PUT", url(), QJsonObject{{"restore", QString::fromStdString(name)}});
+    lxd_wait(manager, base_url, task, 300000, events);
+}
+
+void mp::LXDVirtualMachine::delete_snapshot(const std::string& name)
+{
+    auto task = lxd_request(manager, "DELETE",
+                            QUrl{QString{"%1/snapshots/%2"}.arg(url().toString(), QString::fromStdString(name))});
+    lxd_wait(manager, base_url, task, 300000, events);
+}
+
 void mp::LXDVirtualMachine::suspend()
 {
     throw std::runtime_error("suspend is currently not supported");
@@ -280,7 +354,7 @@ mp::VirtualMachine::State mp::LXDVirtualMachine::current_state()
 {
     try
     {
-        auto present_state = instance_state_for(name, manager, state_url());
+        auto present_state = instance_state_for(name, manager, state_url(), events, snapshot);
 
         if ((state == State::delayed_shutdown || state == State::starting) && present_state == State::running)
             return state;
@@ -314,8 +388,11 @@ void mp::LXDVirtualMachine::ensure_vm_is_running(const std::chrono::milliseconds
             return true;
         }
 
-        // Sleep to see if LXD is just rebooting the instance
-        std::this_thread::sleep_for(timeout);
+        // Wait to see if LXD is just rebooting the instance
+        if (events && events->is_connected())
+            events->wait_for_instance_event(name, timeout);
+        else
+            std::this_thread::sleep_for(timeout);
 
         if (current_state() != State::stopped)
         {
@@ -350,7 +427,7 @@ std::string mp::LXDVirtualMachine::management_ipv4()
 {
     if (!management_ip)
     {
-        management_ip = get_ip_for(mac_addr, manager, network_leases_url());
+        management_ip = get_ip_for(mac_addr, manager, network_leases_url(), snapshot);
         if (!management_ip)
         {
             mpl::log(mpl::Level::trace, name.toStdString(), "IP address not found.");
@@ -386,20 +463,27 @@ const QUrl mp::LXDVirtualMachine::network_leases_url()
     return base_url.toString() + "/networks/" + bridge_name + "/leases";
 }
 
-void mp::LXDVirtualMachine::request_state(const QString& new_state)
+void mp::LXDVirtualMachine::request_state(const QString& new_state, bool force)
 {
-    const QJsonObject state_json{{"action", new_state}};
+    QJsonObject state_json{{"action", new_state}};
+    if (force)
+        state_json.insert("force", true);
 
     auto state_task = lxd_request(manager, "PUT", state_url(), state_json, 5000);
 
     try
     {
-        lxd_wait(manager, base_url, state_task, 60000);
+        lxd_wait(manager, base_url, state_task, 60000, events);
     }
     catch (const LXDNotFoundException&)
     {
         // Implies the task doesn't exist, move on...
     }
+
+    if (events)
+        events->forget_instance(name); // the next query asks, in case the event is still on its way
+    if (snapshot)
+        snapshot->forget(name);
 }
 
 void multipass::LXDVirtualMachine::update_cpus(int num_cores)
@@ -451,3 +535,41 @@ void mp::LXDVirtualMachine::resize_disk(const MemorySize& new_size)
     QJsonObject patch_json{{"devices", QJsonObject{{"root", root_json}}}};
     lxd_request(manager, "PATCH", url(), patch_json);
 }
+
+auto mp::LXDVirtualMachine::guest_metrics(std::chrono::milliseconds timeout) -> optional<GuestMetrics>
+{
+    QJsonObject state;
+    try
+    {
+        state = lxd_request(manager, "GET", state_url(), nullopt, timeout.count())["metadata"].toObject();
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::debug, name.toStdString(), fmt::format("Cannot get the instance state: {}", e.what()));
+        return nullopt;
+    }
+
+    if (state["processes"].toInt(-1) <= 0) // the LXD agent is not up in the guest, to tell what goes on inside
+        return nullopt;
+
+    GuestMetrics metrics;
+    const auto memory = state["memory"].toObject();
+    metrics.memory_usage = bytes_in(memory["usage"]);
+    metrics.memory_total = bytes_in(memory["total"]);
+
+    const auto root_disk = state["disk"].toObject()["root"].toObject();
+    metrics.disk_usage = bytes_in(root_disk["usage"]);
+    metrics.disk_total = bytes_in(root_disk["total"]);
+
+    for (const auto& interface : state["network"].toObject())
+    {
+        for (const auto address_value : interface.toObject()["addresses"].toArray())
+        {
+            const auto address = address_value.toObject();
+            if (address["family"] == QStringLiteral("inet") && address["scope"] == QStringLiteral("global"))
+                metrics.ipv4.push_back(address["address"].toString().toStdString());
+        }
+    }
+
+    return metrics;
+}
@@ -26,6 +26,8 @@
 
 namespace multipass
 {
+class LXDEventSubscriber;
+class LXDInstanceSnapshot;
 class NetworkAccessManager;
 class VirtualMachineDescription;
 class VMStatusMonitor;
@@ -33,9 +35,18 @@ class VMStatusMonitor;
 class LXDVirtualMachine final : public BaseVirtualMachine
 {
 public:
+    // Creates the instance in LXD unless it is there already, or waits for the given @p creation operation, for
+    // instances whose creation was requested beforehand
     LXDVirtualMachine(const VirtualMachineDescription& desc, VMStatusMonitor& monitor, NetworkAccessManager* manager,
-                      const QUrl& base_url, const QString& bridge_name, const QString& storage_pool);
+                      const QUrl& base_url, const QString& bridge_name, const QString& storage_pool,
+                      LXDEventSubscriber* events = nullptr, LXDInstanceSnapshot* snapshot = nullptr,
+                      QJsonObject creation = {});
     ~LXDVirtualMachine() override;
+
+    // Asks LXD to create the instance, without waiting for it to be done; returns the operation to wait on
+    static QJsonObject request_creation(const VirtualMachineDescription& desc, NetworkAccessManager* manager,
+                                        const QUrl& base_url, const QString& storage_pool);
+
     void stop() override;
     void start() override;
     void shutdown() override;
@@ -53,6 +64,12 @@ public:
     void update_cpus(int num_cores) override;
     void resize_memory(const MemorySize& new_size) override;
     void resize_disk(const MemorySize& new_size) override;
+    optional<GuestMetrics> guest_metrics(std::chrono::milliseconds timeout) override; // through the LXD agent
+    void prepare_for_exit() override; // stops what runs, unless the snap is refreshing
+    void kill() override;
+    void take_snapshot(const std::string& name) override; // native LXD snapshots
+    void restore_snapshot(const std::string& name) override;
+    void delete_snapshot(const std::string& name) override;
 
 private:
     const QString name;
@@ -65,11 +82,13 @@ private:
     const QString bridge_name;
     const QString mac_addr;
     const QString storage_pool;
+    LXDEventSubscriber* events;
+    LXDInstanceSnapshot* snapshot; // what the factory last listed of all instances, when it did
 
     const QUrl url();
     const QUrl state_url();
     const QUrl network_leases_url();
-    void request_state(const QString& new_state);
+    void request_state(const QString& new_state, bool force = false);
 };
 } // namespace multipass
 #endif // MULTIPASS_LXD_VIRTUAL_MACHINE_H
@@ -16,6 +16,7 @@
  */
 
 #include "lxd_virtual_machine_factory.h"
+#include "lxd_mount_handler.h"
 #include "lxd_virtual_machine.h"
 #include "lxd_vm_image_vault.h"
 
@@ -30,6 +31,7 @@
 #include <multipass/snap_utils.h>
 #include <multipass/utils.h>
 
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 
@@ -84,24 +86,43 @@ mp::NetworkInterfaceInfo munch_network(std::map<std::string, mp::NetworkInterfac
 
 } // namespace
 
-mp::LXDVirtualMachineFactory::LXDVirtualMachineFactory(NetworkAccessManager::UPtr manager, const mp::Path& data_dir,
+mp::LXDVirtualMachineFactory::LXDVirtualMachineFactory(NetworkAccessManager::UPtr manager,
+                                                       LXDEventSubscriber::UPtr events, const mp::Path& data_dir,
                                                        const QUrl& base_url)
     : manager{std::move(manager)},
+      events{std::move(events)},
       data_dir{mp::utils::make_dir(data_dir, get_backend_directory_name())},
       base_url{base_url}
 {
 }
 
+mp::LXDVirtualMachineFactory::LXDVirtualMachineFactory(NetworkAccessManager::UPtr manager, const mp::Path& data_dir,
+                                                       const QUrl& base_url)
+    : LXDVirtualMachineFactory(std::move(manager), nullptr, data_dir, base_url)
+{
+}
+
 mp::LXDVirtualMachineFactory::LXDVirtualMachineFactory(const mp::Path& data_dir, const QUrl& base_url)
-    : LXDVirtualMachineFactory(std::make_unique<NetworkAccessManager>(), data_dir, base_url)
+    : LXDVirtualMachineFactory(std::make_unique<NetworkAccessManager>(), std::make_unique<LXDEventSubscriber>(base_url),
+                               data_dir, base_url)
 {
 }
 
 mp::VirtualMachine::UPtr mp::LXDVirtualMachineFactory::create_virtual_machine(const VirtualMachineDescription& desc,
                                                                               VMStatusMonitor& monitor)
 {
+    QJsonObject creation;
+    {
+        std::lock_guard<std::mutex> lock{creations_mutex};
+        if (auto it = creations.find(desc.vm_name); it != creations.end())
+        {
+            creation = std::move(it->second);
+            creations.erase(it);
+        }
+    }
+
     return std::make_unique<mp::LXDVirtualMachine>(desc, monitor, manager.get(), base_url, multipass_bridge_name,
-                                                   storage_pool);
+                                                   storage_pool, events.get(), &snapshot, std::move(creation));
 }
 
 void mp::LXDVirtualMachineFactory::remove_resources_for(const std::string& name)
@@ -109,7 +130,8 @@ void mp::LXDVirtualMachineFactory::remove_resources_for(const std::string& name)
     mpl::log(mpl::Level::trace, category, fmt::format("No resources to remove for \"{}\"", name));
 }
 
-auto mp::LXDVirtualMachineFactory::prepare_source_image(const VMImage& source_image) -> VMImage
+auto mp::LXDVirtualMachineFactory::prepare_source_image(const VMImage& source_image,
+                                                        const ProgressMonitor& /* monitor */) -> VMImage
 {
     mpl::log(mpl::Level::trace, category, "No driver preparation required for source image");
     return source_image;
@@ -169,11 +191,19 @@ void mp::LXDVirtualMachineFactory::hypervisor_health_check()
     {
         try
         {
-            lxd_request(manager.get(), "GET", QUrl(QString("%1/storage-pools/%2").arg(base_url.toString()).arg(pool)));
+            auto reply = lxd_request(manager.get(), "GET",
+                                     QUrl(QString("%1/storage-pools/%2").arg(base_url.toString()).arg(pool)));
 
             storage_pool = pool;
             mpl::log(mpl::Level::debug, category, fmt::format("Using the \'{}\' storage pool.", pool));
 
+            // Copy-on-write pools keep an optimized volume of each image to clone, where dir pools copy it whole
+            if (reply["metadata"].toObject()["driver"].toString() == "dir")
+                mpl::log(mpl::Level::info, category,
+                         fmt::format("The \'{}\' storage pool is directory-based, so each instance gets a full copy of "
+                                     "its image; a zfs or btrfs pool would create instances much faster",
+                                     pool));
+
             break;
         }
         catch (const LXDNotFoundException&)
@@ -219,16 +249,13 @@ mp::VMImageVault::UPtr mp::LXDVirtualMachineFactory::create_image_vault(std::vec
                                                                         const mp::days& days_to_expire)
 {
     return std::make_unique<mp::LXDVMImageVault>(image_hosts, downloader, manager.get(), base_url, cache_dir_path,
-                                                 days_to_expire);
+                                                 days_to_expire, events.get());
 }
 
 auto mp::LXDVirtualMachineFactory::networks() const -> std::vector<NetworkInterfaceInfo>
 {
-    auto url = QUrl{QString{"%1/networks?recursion=1"}.arg(base_url.toString())}; // no network filter ATTOW
-    auto reply = lxd_request(manager.get(), "GET", url);
-
     auto ret = std::vector<NetworkInterfaceInfo>{};
-    auto networks = reply["metadata"].toArray();
+    auto networks = retrieve_network_list();
 
     if (!networks.isEmpty())
     {
@@ -245,6 +272,71 @@ auto mp::LXDVirtualMachineFactory::networks() const -> std::vector<NetworkInterf
     return ret;
 }
 
+QJsonArray mp::LXDVirtualMachineFactory::retrieve_network_list() const
+{
+    // Taken before asking, so that a change while LXD answers leaves the answer stale rather than the cache wrong
+    const auto version = events ? events->networks_version() : nullopt;
+    {
+        std::lock_guard<std::mutex> lock{network_list_mutex};
+        if (version && version == network_list_version)
+            return network_list;
+    }
+
+    auto url = QUrl{QString{"%1/networks?recursion=1"}.arg(base_url.toString())}; // no network filter ATTOW
+    auto listed_networks = lxd_request(manager.get(), "GET", url)["metadata"].toArray();
+
+    if (version)
+    {
+        std::lock_guard<std::mutex> lock{network_list_mutex};
+        network_list = listed_networks;
+        network_list_version = version;
+    }
+
+    return listed_networks;
+}
+
+auto mp::LXDVirtualMachineFactory::create_native_mount_handler(const SSHKeyProvider& ssh_key_provider)
+    -> MountHandler::UPtr
+{
+    return std::make_unique<LXDMountHandler>(manager.get(), base_url, ssh_key_provider);
+}
+
+void mp::LXDVirtualMachineFactory::prefetch_instance_states()
+{
+    // The guest agent does not always report addresses, so the leases come along in the same round trip
+    const auto base = base_url.toString();
+    auto replies = lxd_requests(manager.get(), "GET",
+                                {QUrl{QString{"%1/virtual-machines?recursion=2"}.arg(base)},
+                                 QUrl{QString{"%1/networks/%2/leases"}.arg(base, multipass_bridge_name)}});
+
+    snapshot.update(replies[0] ? (*replies[0])["metadata"].toArray() : QJsonArray{},
+                    replies[1] ? (*replies[1])["metadata"].toArray() : QJsonArray{});
+}
+
+void mp::LXDVirtualMachineFactory::start_creating_instances(const std::vector<VirtualMachineDescription>& descs)
+{
+    // LXD runs the operations side by side, unpacking images and cloning volumes as fast as the storage allows, so
+    // creating them all takes about as long as the slowest rather than as long as all of them together
+    if (descs.size() < 2)
+        return;
+
+    for (const auto& desc : descs)
+    {
+        try
+        {
+            auto creation = LXDVirtualMachine::request_creation(desc, manager.get(), base_url, storage_pool);
+
+            std::lock_guard<std::mutex> lock{creations_mutex};
+            creations[desc.vm_name] = std::move(creation);
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::debug, category,
+                     fmt::format("Leaving \"{}\" to be created on its own: {}", desc.vm_name, e.what()));
+        }
+    }
+}
+
 void mp::LXDVirtualMachineFactory::prepare_networking(std::vector<NetworkInterface>& extra_interfaces)
 {
     prepare_networking_guts(extra_interfaces, "bridge");
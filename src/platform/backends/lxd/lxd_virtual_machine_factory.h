@@ -18,13 +18,20 @@
 #ifndef MULTIPASS_LXD_VIRTUAL_MACHINE_FACTORY_H
 #define MULTIPASS_LXD_VIRTUAL_MACHINE_FACTORY_H
 
+#include "lxd_event_subscriber.h"
+#include "lxd_instance_snapshot.h"
 #include "lxd_request.h"
 
 #include <multipass/network_access_manager.h>
 #include <shared/base_virtual_machine_factory.h>
 
+#include <QJsonArray>
 #include <QUrl>
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 namespace multipass
 {
 class LXDVirtualMachineFactory : public BaseVirtualMachineFactory
@@ -33,12 +40,14 @@ public:
     explicit LXDVirtualMachineFactory(const Path& data_dir, const QUrl& base_url = lxd_socket_url);
     explicit LXDVirtualMachineFactory(NetworkAccessManager::UPtr manager, const Path& data_dir,
                                       const QUrl& base_url = lxd_socket_url);
+    LXDVirtualMachineFactory(NetworkAccessManager::UPtr manager, LXDEventSubscriber::UPtr events,
+                             const Path& data_dir, const QUrl& base_url);
 
     void prepare_networking(std::vector<NetworkInterface>& extra_interfaces) override;
     VirtualMachine::UPtr create_virtual_machine(const VirtualMachineDescription& desc,
                                                 VMStatusMonitor& monitor) override;
     void remove_resources_for(const std::string& name) override;
-    VMImage prepare_source_image(const VMImage& source_image) override;
+    VMImage prepare_source_image(const VMImage& source_image, const ProgressMonitor& monitor) override;
     void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) override;
     void hypervisor_health_check() override;
     QString get_backend_directory_name() override
@@ -52,15 +61,27 @@ public:
     void configure(VirtualMachineDescription& vm_desc) override;
 
     std::vector<NetworkInterfaceInfo> networks() const override;
+    MountHandler::UPtr create_native_mount_handler(const SSHKeyProvider& ssh_key_provider) override;
+    void prefetch_instance_states() override;
+    void start_creating_instances(const std::vector<VirtualMachineDescription>& descs) override;
 
 protected:
     std::string create_bridge_with(const NetworkInterfaceInfo& interface) override;
 
 private:
+    QJsonArray retrieve_network_list() const;
+
     NetworkAccessManager::UPtr manager;
+    LXDEventSubscriber::UPtr events; // null when LXD events are not followed
+    LXDInstanceSnapshot snapshot;
     const Path data_dir;
     const QUrl base_url;
     QString storage_pool;
+    mutable std::mutex network_list_mutex;
+    mutable QJsonArray network_list;                           // as LXD last listed them...
+    mutable optional<unsigned long long> network_list_version; // ...while the events' networks version was this
+    std::mutex creations_mutex;
+    std::unordered_map<std::string, QJsonObject> creations; // operations of creations under way, by instance name
 };
 } // namespace multipass
 
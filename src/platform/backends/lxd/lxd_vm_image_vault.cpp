@@ -16,10 +16,12 @@
  */
 
 #include "lxd_vm_image_vault.h"
+#include "lxd_event_subscriber.h"
 #include "lxd_request.h"
 
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/local_socket_connection_exception.h>
+#include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/network_access_manager.h>
@@ -29,6 +31,7 @@
 #include <multipass/utils.h>
 #include <multipass/vm_image.h>
 #include <multipass/vm_image_host.h>
+#include <multipass/xz_image_decoder.h>
 
 #include <shared/linux/process_factory.h>
 #include <shared/qemu_img_utils/qemu_img_utils.h>
@@ -95,6 +98,27 @@ QString post_process_downloaded_image(const QString& image_path, const mp::Progr
     return new_image_path;
 }
 
+// LXD takes the image as it is, so only what needs converting has to be copied next to the metadata first
+QString local_image_for_import(const QString& source_path, const QTemporaryDir& lxd_import_dir,
+                               const mp::ProgressMonitor& monitor)
+{
+    if (source_path.endsWith(".xz"))
+    {
+        const auto image_path = lxd_import_dir.filePath(QFileInfo{source_path}.fileName().remove(".xz"));
+
+        mp::vault::DeleteOnException image_file{image_path};
+        mp::XzImageDecoder{source_path}.decode_to(image_path, monitor);
+
+        return image_path;
+    }
+
+    if (mp::backend::is_qcow2_image(source_path))
+        return source_path;
+
+    // Converting writes next to its input, which must not be the user's directory
+    return mp::vault::copy(source_path, lxd_import_dir.path());
+}
+
 QString create_metadata_tarball(const mp::VMImageInfo& info, const QTemporaryDir& lxd_import_dir)
 {
     QFile metadata_yaml_file{lxd_import_dir.filePath("metadata.yaml")};
@@ -146,13 +170,14 @@ std::vector<std::string> copy_aliases(const QStringList& aliases)
 
 mp::LXDVMImageVault::LXDVMImageVault(std::vector<VMImageHost*> image_hosts, URLDownloader* downloader,
                                      NetworkAccessManager* manager, const QUrl& base_url, const QString& cache_dir_path,
-                                     const days& days_to_expire)
+                                     const days& days_to_expire, LXDEventSubscriber* events)
     : BaseVMImageVault{image_hosts},
       url_downloader{downloader},
       manager{manager},
       base_url{base_url},
       template_path{QString("%1/%2-").arg(cache_dir_path).arg(QCoreApplication::applicationName())},
-      days_to_expire{days_to_expire}
+      days_to_expire{days_to_expire},
+      events{events}
 {
 }
 
@@ -273,11 +298,11 @@ mp::VMImage mp::LXDVMImageVault::fetch_image(const FetchType& fetch_type, const
                 // TODO: Need to make this async like in DefaultVMImageVault
                 image_path = lxd_import_dir.filePath(mp::vault::filename_for(info.image_location));
 
-                url_download_image(info, image_path, monitor);
+                image_path = url_download_image(info, image_path, monitor);
             }
             else
             {
-                image_path = mp::vault::copy(source_image.image_path, lxd_import_dir.path());
+                image_path = local_image_for_import(source_image.image_path, lxd_import_dir, monitor);
             }
 
             image_path = post_process_downloaded_image(image_path, monitor);
@@ -304,7 +329,7 @@ void mp::LXDVMImageVault::remove(const std::string& name)
         auto task_reply = lxd_request(
             manager, "DELETE", QUrl(QString("%1/virtual-machines/%2").arg(base_url.toString()).arg(name.c_str())));
 
-        lxd_wait(manager, base_url, task_reply, 120000);
+        lxd_wait(manager, base_url, task_reply, 120000, events);
     }
     catch (const LXDNotFoundException&)
     {
@@ -312,8 +337,25 @@ void mp::LXDVMImageVault::remove(const std::string& name)
     }
 }
 
+mp::VMImage mp::LXDVMImageVault::clone_instance_image(const std::string& source_name,
+                                                     const std::string& destination_name)
+{
+    // LXD would copy the instance along with the MAC addresses that its devices name, which the copy must not reuse
+    throw NotImplementedOnThisBackendException("clone");
+}
+
+mp::VMImageInfo mp::LXDVMImageVault::bake_instance_image(const std::string& instance_name,
+                                                         const std::string& image_name)
+{
+    // LXD would publish the instance to its own image store, which the image hosts that launch looks in know nothing of
+    throw NotImplementedOnThisBackendException("bake");
+}
+
 bool mp::LXDVMImageVault::has_record_for(const std::string& name)
 {
+    if (events && events->instance_status_code(QString::fromStdString(name)))
+        return true;
+
     try
     {
         lxd_request(manager, "GET", QUrl(QString("%1/virtual-machines/%2").arg(base_url.toString()).arg(name.c_str())));
@@ -336,6 +378,7 @@ bool mp::LXDVMImageVault::has_record_for(const std::string& name)
 void mp::LXDVMImageVault::prune_expired_images()
 {
     auto images = retrieve_image_list();
+    std::vector<QUrl> expired_image_urls;
 
     for (const auto image : images)
     {
@@ -359,18 +402,16 @@ void mp::LXDVMImageVault::prune_expired_images()
                      fmt::format("Source image \'{}\' is expired. Removing it…",
                                  image_info["properties"].toObject()["release"].toString()));
 
-            try
-            {
-                lxd_request(
-                    manager, "DELETE",
-                    QUrl(QString("%1/images/%2").arg(base_url.toString()).arg(image_info["fingerprint"].toString())));
-            }
-            catch (const LXDNotFoundException&)
-            {
-                continue;
-            }
+            expired_image_urls.emplace_back(
+                QString("%1/images/%2").arg(base_url.toString()).arg(image_info["fingerprint"].toString()));
         }
     }
+
+    if (!expired_image_urls.empty()) // images that are already gone come back as nullopt, nothing to do about them
+    {
+        lxd_requests(manager, "DELETE", std::move(expired_image_urls));
+        forget_image_list();
+    }
 }
 
 void mp::LXDVMImageVault::update_images(const FetchType& fetch_type, const PrepareAction& prepare,
@@ -405,6 +446,7 @@ void mp::LXDVMImageVault::update_images(const FetchType& fetch_type, const Prepa
                                        image_info["last_used_at"].toString());
 
                     lxd_request(manager, "DELETE", QUrl(QString("%1/images/%2").arg(base_url.toString()).arg(id)));
+                    forget_image_list();
                 }
             }
             catch (const LXDNotFoundException&)
@@ -415,6 +457,36 @@ void mp::LXDVMImageVault::update_images(const FetchType& fetch_type, const Prepa
     }
 }
 
+void mp::LXDVMImageVault::prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries,
+                                          const PrepareAction& prepare, const ProgressMonitor& monitor)
+{
+    for (const auto& query : queries)
+    {
+        try
+        {
+            const auto info = info_for(query);
+
+            try
+            {
+                lxd_request(manager, "GET", QUrl(QString("%1/images/%2").arg(base_url.toString()).arg(info.id)));
+            }
+            catch (const LXDNotFoundException&)
+            {
+                if (info.stream_location.isEmpty())
+                    continue;
+
+                mpl::log(mpl::Level::info, category, fmt::format("Prefetching {} source image", query.release));
+                lxd_download_image(info.id, info.stream_location, query, monitor);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("Cannot prefetch source image {}: {}", query.release, e.what()));
+        }
+    }
+}
+
 mp::MemorySize mp::LXDVMImageVault::minimum_image_size_for(const std::string& id)
 {
     MemorySize lxd_image_size{"10G"};
@@ -424,7 +496,7 @@ mp::MemorySize mp::LXDVMImageVault::minimum_image_size_for(const std::string& id
         auto json_reply = lxd_request(
             manager, "GET", QUrl(QString("%1/images/%2").arg(base_url.toString()).arg(QString::fromStdString(id))));
         const long image_size_bytes = json_reply["metadata"].toObject()["size"].toDouble();
-        const MemorySize image_size{std::to_string(image_size_bytes)};
+        const auto image_size = MemorySize::from_bytes(image_size_bytes);
 
         if (image_size > lxd_image_size)
         {
@@ -473,20 +545,54 @@ void mp::LXDVMImageVault::lxd_download_image(const QString& id, const QString& s
     auto json_reply = lxd_request(manager, "POST", QUrl(QString("%1/images").arg(base_url.toString())), image_object);
 
     poll_download_operation(json_reply, monitor);
+    forget_image_list();
 }
 
-void mp::LXDVMImageVault::url_download_image(const VMImageInfo& info, const QString& image_path,
-                                             const ProgressMonitor& monitor)
+QString mp::LXDVMImageVault::url_download_image(const VMImageInfo& info, const QString& image_path,
+                                                const ProgressMonitor& monitor)
 {
-    mp::vault::DeleteOnException image_file{image_path};
+    // Decode while downloading, so the compressed image never needs to be stored
+    if (image_path.endsWith(".xz"))
+    {
+        QString decoded_image_path{image_path};
+        decoded_image_path.remove(".xz");
 
-    url_downloader->download_to(info.image_location, image_path, info.size, LaunchProgress::IMAGE, monitor);
+        mp::vault::DeleteOnException decoded_image_file{decoded_image_path};
+        mp::XzStreamDecoder xz_decoder{decoded_image_path};
+
+        const auto image_hash =
+            url_downloader->stream_and_hash(info.image_location, info.size, LaunchProgress::IMAGE, monitor,
+                                            [&xz_decoder](const QByteArray& data) { return xz_decoder.feed(data); });
+
+        monitor(LaunchProgress::EXTRACT, -1);
+        xz_decoder.finish();
+
+        if (info.verify)
+        {
+            monitor(LaunchProgress::VERIFY, -1);
+            mp::vault::verify_image_hash(image_hash, info.id);
+        }
+
+        return decoded_image_path;
+    }
+
+    mp::vault::DeleteOnException image_file{image_path};
 
     if (info.verify)
     {
+        const auto image_hash =
+            url_downloader->download_and_hash_to(info.image_location, image_path, info.size, LaunchProgress::IMAGE,
+                                                 monitor);
+
         monitor(LaunchProgress::VERIFY, -1);
-        mp::vault::verify_image_download(image_path, info.id);
+        mp::vault::verify_image_hash(image_hash, info.id);
     }
+    else
+    {
+        url_downloader->download_to(info.image_location, image_path, info.size, LaunchProgress::IMAGE, monitor);
+    }
+
+    return image_path;
 }
 
 void mp::LXDVMImageVault::poll_download_operation(const QJsonObject& json_reply, const ProgressMonitor& monitor)
@@ -494,11 +600,39 @@ void mp::LXDVMImageVault::poll_download_operation(const QJsonObject& json_reply,
     if (json_reply["metadata"].toObject()["class"] == QStringLiteral("task") &&
         json_reply["status_code"].toInt(-1) == 100)
     {
-        QUrl task_url(QString("%1/operations/%2")
-                          .arg(base_url.toString())
-                          .arg(json_reply["metadata"].toObject()["id"].toString()));
+        const auto id = json_reply["metadata"].toObject()["id"].toString();
+        QUrl task_url(QString("%1/operations/%2").arg(base_url.toString()).arg(id));
 
-        // Instead of polling, need to use websockets to get events
+        if (events)
+        {
+            auto report_progress = [this, &monitor, &task_url](const QJsonObject& operation) {
+                auto download_progress =
+                    parse_percent_as_int(operation["metadata"].toObject()["download_progress"].toString());
+
+                if (!monitor(LaunchProgress::IMAGE, download_progress))
+                {
+                    mp::lxd_request(manager, "DELETE", task_url);
+                    throw mp::AbortedDownloadException{"Download aborted"};
+                }
+            };
+
+            // Downloads can go quiet for a while, so this keeps waiting for as long as the operation is around
+            mp::optional<QJsonObject> operation;
+            do
+            {
+                operation = events->wait_for_operation(id, 1min, report_progress);
+            } while (operation && (*operation)["status_code"].toInt(-1) < 200);
+
+            if (operation)
+            {
+                if ((*operation)["status_code"].toInt(-1) != 200)
+                    mpl::log(mpl::Level::error, category, (*operation)["err"].toString().toStdString());
+
+                return;
+            }
+        }
+
+        // Without events to go by, poll
         while (true)
         {
             try
@@ -569,7 +703,8 @@ std::string mp::LXDVMImageVault::lxd_import_metadata_and_image(const QString& me
 
     auto json_reply = lxd_request(manager, "POST", QUrl(QString("%1/images").arg(base_url.toString())), lxd_multipart);
 
-    auto task_reply = lxd_wait(manager, base_url, json_reply, 300000);
+    auto task_reply = lxd_wait(manager, base_url, json_reply, 300000, events);
+    forget_image_list();
 
     return task_reply["metadata"].toObject()["metadata"].toObject()["fingerprint"].toString().toStdString();
 }
@@ -598,13 +733,21 @@ std::string mp::LXDVMImageVault::get_lxd_image_hash_for(const QString& id)
 
 QJsonArray mp::LXDVMImageVault::retrieve_image_list()
 {
-    QJsonArray image_list;
+    // Taken before asking, so that a change while LXD answers leaves the answer stale rather than the cache wrong
+    const auto version = events ? events->images_version() : nullopt;
+    {
+        std::lock_guard<std::mutex> lock{image_list_mutex};
+        if (version && version == image_list_version)
+            return image_list;
+    }
+
+    QJsonArray listed_images;
 
     try
     {
         auto json_reply = lxd_request(manager, "GET", QUrl(QString("%1/images?recursion=1").arg(base_url.toString())));
 
-        image_list = json_reply["metadata"].toArray();
+        listed_images = json_reply["metadata"].toArray();
     }
     catch (const LXDNotFoundException&)
     {
@@ -613,7 +756,22 @@ QJsonArray mp::LXDVMImageVault::retrieve_image_list()
     catch (const LocalSocketConnectionException& e)
     {
         mpl::log(mpl::Level::warning, category, e.what());
+        return listed_images;
+    }
+
+    if (version)
+    {
+        std::lock_guard<std::mutex> lock{image_list_mutex};
+        image_list = listed_images;
+        image_list_version = version;
     }
 
-    return image_list;
+    return listed_images;
+}
+
+// For the vault's own changes, whose events may well arrive after the next listing
+void mp::LXDVMImageVault::forget_image_list()
+{
+    std::lock_guard<std::mutex> lock{image_list_mutex};
+    image_list_version = nullopt;
 }
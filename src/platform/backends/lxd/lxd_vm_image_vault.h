@@ -19,6 +19,7 @@
 #define MULTIPASS_LXD_VM_IMAGE_VAULT_H
 
 #include <multipass/days.h>
+#include <multipass/optional.h>
 #include <multipass/query.h>
 #include <shared/base_vm_image_vault.h>
 
@@ -26,8 +27,11 @@
 #include <QJsonObject>
 #include <QUrl>
 
+#include <mutex>
+
 namespace multipass
 {
+class LXDEventSubscriber;
 class NetworkAccessManager;
 class URLDownloader;
 
@@ -37,31 +41,41 @@ public:
     using TaskCompleteAction = std::function<void(const QJsonObject&)>;
 
     LXDVMImageVault(std::vector<VMImageHost*> image_host, URLDownloader* downloader, NetworkAccessManager* manager,
-                    const QUrl& base_url, const QString& cache_dir_path, const multipass::days& days_to_expire);
+                    const QUrl& base_url, const QString& cache_dir_path, const multipass::days& days_to_expire,
+                    LXDEventSubscriber* events = nullptr);
 
     VMImage fetch_image(const FetchType& fetch_type, const Query& query, const PrepareAction& prepare,
                         const ProgressMonitor& monitor) override;
     void remove(const std::string& name) override;
+    VMImage clone_instance_image(const std::string& source_name, const std::string& destination_name) override;
+    VMImageInfo bake_instance_image(const std::string& instance_name, const std::string& image_name) override;
     bool has_record_for(const std::string& name) override;
     void prune_expired_images() override;
     void update_images(const FetchType& fetch_type, const PrepareAction& prepare,
                        const ProgressMonitor& monitor) override;
+    void prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries, const PrepareAction& prepare,
+                         const ProgressMonitor& monitor) override;
     MemorySize minimum_image_size_for(const std::string& id) override;
 
 private:
     void lxd_download_image(const QString& id, const QString& stream_location, const Query& query,
                             const ProgressMonitor& monitor, const QString& last_used = QString());
-    void url_download_image(const VMImageInfo& info, const QString& image_path, const ProgressMonitor& monitor);
+    QString url_download_image(const VMImageInfo& info, const QString& image_path, const ProgressMonitor& monitor);
     void poll_download_operation(const QJsonObject& json_reply, const ProgressMonitor& monitor);
     std::string lxd_import_metadata_and_image(const QString& metadata_path, const QString& image_path);
     std::string get_lxd_image_hash_for(const QString& id);
     QJsonArray retrieve_image_list();
+    void forget_image_list();
 
     URLDownloader* const url_downloader;
     NetworkAccessManager* manager;
     const QUrl base_url;
     const QString template_path;
     const days days_to_expire;
+    LXDEventSubscriber* events;
+    std::mutex image_list_mutex;
+    QJsonArray image_list;                           // as LXD last listed it...
+    optional<unsigned long long> image_list_version; // ...while the events' images version was this
 };
 } // namespace multipass
 #endif // MULTIPASS_LXD_VM_IMAGE_VAULT_H
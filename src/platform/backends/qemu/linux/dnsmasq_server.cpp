@@ -26,7 +26,12 @@
 
 #include <QDir>
 
+#include <array>
+#include <ctime>
 #include <fstream>
+#include <string_view>
+
+#include <sys/stat.h>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -84,21 +89,56 @@ mp::DNSMasqServer::~DNSMasqServer()
 
 mp::optional<mp::IPAddress> mp::DNSMasqServer::get_ip_for(const std::string& hw_addr)
 {
+    std::lock_guard<std::mutex> lock{leases_mutex};
+    refresh_leases();
+
+    if (const auto it = leases.find(hw_addr); it != leases.end())
+        return mp::optional<mp::IPAddress>{it->second};
+
+    return mp::nullopt;
+}
+
+void mp::DNSMasqServer::refresh_leases()
+{
+    // Booting instances look their addresses up many times over, so the file is only parsed again when stat tells
+    // that dnsmasq has written it since
+    const auto path = QDir(data_dir).filePath("dnsmasq.leases").toStdString();
+    struct stat file_stat{};
+    FileStamp stamp{};
+    if (stat(path.c_str(), &file_stat) == 0)
+        stamp = {file_stat.st_mtim.tv_sec, file_stat.st_mtim.tv_nsec, file_stat.st_size, file_stat.st_ino};
+
+    if (leases_settled && stamp == leases_stamp)
+        return;
+
     // DNSMasq leases entries consist of:
     // <lease expiration> <mac addr> <ipv4> <name> * * *
-    const auto path = QDir(data_dir).filePath("dnsmasq.leases").toStdString();
-    const std::string delimiter{" "};
     const int hw_addr_idx{1};
     const int ipv4_idx{2};
     std::ifstream leases_file{path};
     std::string line;
+
+    leases.clear();
     while (getline(leases_file, line))
     {
-        const auto fields = mp::utils::split(line, delimiter);
-        if (fields.size() > 2 && fields[hw_addr_idx] == hw_addr)
-            return mp::optional<mp::IPAddress>{fields[ipv4_idx]};
+        // Only the fields that are needed are looked at, and only the two that are kept are copied
+        std::array<std::string_view, 3> fields;
+        std::size_t count = 0;
+        for (auto field : mp::utils::split_view(line, " "))
+        {
+            fields[count] = field;
+            if (++count == fields.size())
+                break;
+        }
+
+        if (count == fields.size()) // the first entry wins, as before
+            leases.emplace(std::string{fields[hw_addr_idx]}, std::string{fields[ipv4_idx]});
     }
-    return mp::nullopt;
+
+    // File times are coarse, so a file that was just written may yet be written again without its stamp changing;
+    // such a file is read again next time, until it has settled
+    leases_stamp = stamp;
+    leases_settled = std::get<0>(stamp) + 1 < std::time(nullptr);
 }
 
 void mp::DNSMasqServer::release_mac(const std::string& hw_addr)
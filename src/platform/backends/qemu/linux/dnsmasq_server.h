@@ -27,7 +27,10 @@
 #include <QTemporaryFile>
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 
 namespace multipass
 {
@@ -50,6 +53,7 @@ protected:
 
 private:
     void start_dnsmasq();
+    void refresh_leases(); // requires leases_mutex
 
     const QString data_dir;
     const QString bridge_name;
@@ -57,6 +61,13 @@ private:
     std::unique_ptr<Process> dnsmasq_cmd;
     QMetaObject::Connection finish_connection;
     QTemporaryFile conf_file;
+
+    // The leases file, indexed by MAC address, and read again only when it changes
+    using FileStamp = std::tuple<long long, long long, long long, unsigned long long>; // mtime (s, ns), size, inode
+    std::mutex leases_mutex;
+    FileStamp leases_stamp{};
+    bool leases_settled{false};
+    std::unordered_map<std::string, std::string> leases;
 };
 
 #define MP_DNSMASQ_SERVER_FACTORY multipass::DNSMasqServerFactory::instance()
@@ -26,9 +26,11 @@
 
 #include <semver200.h>
 
+#include <map>
 #include <stdexcept>
 
 #include <QRegularExpression>
+#include <QTemporaryFile>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -68,9 +70,8 @@ const QString match{QStringLiteral("--match")};
 const QString out_interface{QStringLiteral("--out-interface")};
 const QString protocol{QStringLiteral("--protocol")};
 const QString source{QStringLiteral("--source")};
-const QString list_rules{QStringLiteral("--list-rules")};
-const QString dash_t{QStringLiteral("-t")}; // Use short option for specifying table to avoid var conflicts
 const QString wait{QStringLiteral("--wait")};
+const QString noflush{QStringLiteral("--noflush")};
 
 //   protocol constants
 const QString udp{QStringLiteral("udp")};
@@ -102,173 +103,193 @@ public:
         : runtime_error{fmt::format("{}; Table: {}; Failure: {}; Output: {}", issue, table, failure, output)} {};
 };
 
+// Rules to apply together, in iptables-restore lines, by table
+using FirewallRuleSet = std::map<QString, QStringList>;
+
 auto multipass_firewall_comment(const QString& bridge_name)
 {
     return QString("generated for Multipass network %1").arg(bridge_name);
 }
 
-void add_firewall_rule(const QString& firewall, const QString& table, const QString& chain, const QStringList& rule,
+void add_firewall_rule(FirewallRuleSet& rules, const QString& table, const QString& chain, const QStringList& rule,
                        bool append = false)
 {
-    auto process = MP_PROCFACTORY.create_process(
-        firewall, QStringList() << wait << dash_t << table << (append ? append_rule : insert_rule) << chain << rule);
-
-    auto exit_state = process->execute();
+    QStringList line{append ? append_rule : insert_rule, chain};
+    for (const auto& arg : rule)
+        line << (arg.contains(' ') ? QString("\"%1\"").arg(arg) : arg);
 
-    if (!exit_state.completed_successfully())
-        throw FirewallException("Failed to set firewall rule", table, exit_state.failure_message(),
-                                process->read_all_standard_error());
+    rules[table] << line.join(' ');
 }
 
-void delete_firewall_rule(const QString& firewall, const QString& table, const QStringList& chain_and_rule)
+// Applies all the rules in one go, through a single transaction, so that they are never partly in place
+void restore_firewall_rules(const QString& firewall, const FirewallRuleSet& rules, const QString& issue)
 {
-    auto args = QStringList() << firewall << wait << dash_t << table << delete_rule << chain_and_rule;
+    QStringList tables;
+    QByteArray input;
+    for (const auto& [table, lines] : rules)
+    {
+        tables << table;
+        input += QString("*%1\n%2\nCOMMIT\n").arg(table, lines.join('\n')).toUtf8();
+    }
+
+    if (tables.isEmpty())
+        return;
+
+    QTemporaryFile rules_file;
+    if (!rules_file.open() || rules_file.write(input) != input.size() || !rules_file.flush())
+        throw FirewallException(issue, tables.join(','), "Cannot write the rules", rules_file.errorString());
 
-    auto process =
-        MP_PROCFACTORY.create_process(QStringLiteral("sh"), QStringList() << QStringLiteral("-c") << args.join(" "));
+    auto process = MP_PROCFACTORY.create_process(QString("%1-restore").arg(firewall),
+                                                 QStringList() << wait << noflush << rules_file.fileName());
 
     auto exit_state = process->execute();
 
     if (!exit_state.completed_successfully())
-        throw FirewallException("Failed to delete firewall rule", table, exit_state.failure_message(),
+        throw FirewallException(issue, tables.join(','), exit_state.failure_message(),
                                 process->read_all_standard_error());
 }
 
-auto get_firewall_rules(const QString& firewall, const QString& table)
+// All the rules in every table, in one listing, as iptables-save gives them
+auto get_firewall_rules(const QString& firewall)
 {
     // TODO: Parse out stderr so as not to log noisy warnings from iptables-nft when legacy iptables are in use
-    auto process = MP_PROCFACTORY.create_process(firewall, QStringList() << wait << dash_t << table << list_rules);
+    auto process = MP_PROCFACTORY.create_process(QString("%1-save").arg(firewall));
 
     auto exit_state = process->execute();
 
     if (!exit_state.completed_successfully())
-        throw FirewallException("Failed to get firewall list", table, exit_state.failure_message(),
-                                process->read_all_standard_error());
+        throw FirewallException("Failed to get firewall list", firewall_tables.join(','),
+                                exit_state.failure_message(), process->read_all_standard_error());
 
-    return process->read_all_standard_output();
+    return QString::fromUtf8(process->read_all_standard_output());
 }
 
 void set_firewall_rules(const QString& firewall, const QString& bridge_name, const QString& cidr,
                         const QString& comment)
 {
     const QStringList comment_option{match, QStringLiteral("comment"), QStringLiteral("--comment"), comment};
+    FirewallRuleSet rules;
 
     // Setup basic firewall overrides for DHCP/DNS
-    add_firewall_rule(firewall, filter, INPUT,
+    add_firewall_rule(rules, filter, INPUT,
                       QStringList() << in_interface << bridge_name << protocol << udp << dport << port_67 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, filter, INPUT,
+    add_firewall_rule(rules, filter, INPUT,
                       QStringList() << in_interface << bridge_name << protocol << udp << dport << port_53 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, filter, INPUT,
+    add_firewall_rule(rules, filter, INPUT,
                       QStringList() << in_interface << bridge_name << protocol << tcp << dport << port_53 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, filter, OUTPUT,
+    add_firewall_rule(rules, filter, OUTPUT,
                       QStringList() << out_interface << bridge_name << protocol << udp << sport << port_67 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, filter, OUTPUT,
+    add_firewall_rule(rules, filter, OUTPUT,
                       QStringList() << out_interface << bridge_name << protocol << udp << sport << port_53 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, filter, OUTPUT,
+    add_firewall_rule(rules, filter, OUTPUT,
                       QStringList() << out_interface << bridge_name << protocol << tcp << sport << port_53 << jump
                                     << ACCEPT << comment_option);
 
-    add_firewall_rule(firewall, mangle, POSTROUTING,
+    add_firewall_rule(rules, mangle, POSTROUTING,
                       QStringList() << out_interface << bridge_name << protocol << udp << dport << port_68 << jump
                                     << QStringLiteral("CHECKSUM") << QStringLiteral("--checksum-fill")
                                     << comment_option);
 
     // Do not masquerade to these reserved address blocks.
-    add_firewall_rule(firewall, nat, POSTROUTING,
+    add_firewall_rule(rules, nat, POSTROUTING,
                       QStringList() << source << cidr << destination << QStringLiteral("224.0.0.0/24") << jump << RETURN
                                     << comment_option);
 
-    add_firewall_rule(firewall, nat, POSTROUTING,
+    add_firewall_rule(rules, nat, POSTROUTING,
                       QStringList() << source << cidr << destination << QStringLiteral("255.255.255.255/32") << jump
                                     << RETURN << comment_option);
 
     // Masquerade all packets going from VMs to the LAN/Internet
-    add_firewall_rule(firewall, nat, POSTROUTING,
+    add_firewall_rule(rules, nat, POSTROUTING,
                       QStringList() << source << cidr << negate << destination << cidr << protocol << tcp << jump
                                     << MASQUERADE << to_ports << port_range << comment_option);
 
-    add_firewall_rule(firewall, nat, POSTROUTING,
+    add_firewall_rule(rules, nat, POSTROUTING,
                       QStringList() << source << cidr << negate << destination << cidr << protocol << udp << jump
                                     << MASQUERADE << to_ports << port_range << comment_option);
 
-    add_firewall_rule(firewall, nat, POSTROUTING,
+    add_firewall_rule(rules, nat, POSTROUTING,
                       QStringList() << source << cidr << negate << destination << cidr << jump << MASQUERADE
                                     << comment_option);
 
     // Allow established traffic to the private subnet
-    add_firewall_rule(firewall, filter, FORWARD,
+    add_firewall_rule(rules, filter, FORWARD,
                       QStringList() << destination << cidr << out_interface << bridge_name << match
                                     << QStringLiteral("conntrack") << QStringLiteral("--ctstate")
                                     << QStringLiteral("RELATED,ESTABLISHED") << jump << ACCEPT << comment_option);
 
     // Allow outbound traffic from the private subnet
-    add_firewall_rule(firewall, filter, FORWARD,
+    add_firewall_rule(rules, filter, FORWARD,
                       QStringList() << source << cidr << in_interface << bridge_name << jump << ACCEPT
                                     << comment_option);
 
     // Allow traffic between virtual machines
-    add_firewall_rule(firewall, filter, FORWARD,
+    add_firewall_rule(rules, filter, FORWARD,
                       QStringList() << in_interface << bridge_name << out_interface << bridge_name << jump << ACCEPT
                                     << comment_option);
 
     // Reject everything else
-    add_firewall_rule(firewall, filter, FORWARD,
+    add_firewall_rule(rules, filter, FORWARD,
                       QStringList() << in_interface << bridge_name << jump << REJECT << reject_with
                                     << icmp_port_unreachable << comment_option,
                       /*append=*/true);
 
-    add_firewall_rule(firewall, filter, FORWARD,
+    add_firewall_rule(rules, filter, FORWARD,
                       QStringList() << out_interface << bridge_name << jump << REJECT << reject_with
                                     << icmp_port_unreachable << comment_option,
                       /*append=*/true);
+
+    restore_firewall_rules(firewall, rules, "Failed to set firewall rules");
 }
 
-void clear_firewall_rules_for(const QString& firewall, const QString& table, const QString& bridge_name,
-                              const QString& cidr, const QString& comment)
+void clear_firewall_rules_for(const QString& firewall, const QString& bridge_name, const QString& cidr,
+                              const QString& comment)
 {
-    auto rules = QString::fromUtf8(get_firewall_rules(firewall, table));
+    FirewallRuleSet rules;
+    QString table;
 
-    for (auto& rule : rules.split('\n'))
+    for (auto& rule : get_firewall_rules(firewall).split('\n'))
     {
-        if (rule.contains(comment) || rule.contains(bridge_name) || rule.contains(cidr))
+        if (rule.startsWith('*'))
         {
-            // Remove the policy type since delete doesn't use that
-            rule.remove(0, 3);
-
-            try
-            {
-                // Pass the chain and rule wholesale since we capture the whole line
-                delete_firewall_rule(firewall, table, QStringList() << rule);
-            }
-            catch (const FirewallException& e)
-            {
-                mpl::log(mpl::Level::error, category,
-                         fmt::format("Error deleting firewall rule '{}': {}", rule, e.what()));
-            }
+            table = rule.mid(1);
         }
+        else if (rule.startsWith("-A ") &&
+                 (rule.contains(comment) || rule.contains(bridge_name) || rule.contains(cidr)))
+        {
+            // Delete takes the chain and rule wholesale, since we capture the whole line
+            rules[table] << rule.replace(0, 2, delete_rule);
+        }
+    }
+
+    try
+    {
+        restore_firewall_rules(firewall, rules, "Failed to delete firewall rules");
+    }
+    catch (const FirewallException& e)
+    {
+        mpl::log(mpl::Level::error, category, fmt::format("Error deleting firewall rules: {}", e.what()));
     }
 }
 
 bool is_firewall_in_use(const QString& firewall)
 {
+    // Any rule, or any chain of its own, in any table
+    QRegularExpression re{R"(^(-A |:\S+ - ))"};
+    auto rule_lines = get_firewall_rules(firewall).split('\n');
 
-    return std::any_of(firewall_tables.cbegin(), firewall_tables.cend(), [&firewall](const QString& table) {
-        QRegularExpression re{"^-[ARIN]"};
-        auto rule_lines = get_firewall_rules(firewall, table).split('\n');
-
-        return std::any_of(rule_lines.cbegin(), rule_lines.cend(),
-                           [&re](const QString& line) { return re.match(line).hasMatch(); });
-    });
+    return std::any_of(rule_lines.cbegin(), rule_lines.cend(),
+                       [&re](const QString& line) { return re.match(line).hasMatch(); });
 }
 
 // We require a >= 5.2 kernel to avoid weird conflicts with xtables and support for inet table NAT rules.
@@ -352,10 +373,7 @@ void mp::FirewallConfig::verify_firewall_rules()
 
 void mp::FirewallConfig::clear_all_firewall_rules()
 {
-    for (const auto& table : firewall_tables)
-    {
-        clear_firewall_rules_for(firewall, table, bridge_name, cidr, comment);
-    }
+    clear_firewall_rules_for(firewall, bridge_name, cidr, comment);
 }
 
 mp::FirewallConfig::UPtr mp::FirewallConfigFactory::make_firewall_config(const QString& bridge_name,
@@ -38,9 +38,13 @@ public:
     virtual ~QemuPlatformDetail();
 
     optional<IPAddress> get_ip_for(const std::string& hw_addr) override;
+    std::vector<std::string> neighbour_ipv4_for(const std::vector<std::string>& hw_addrs) override;
     void remove_resources_for(const std::string& name) override;
     void platform_health_check() override;
     QStringList vm_platform_args(const VirtualMachineDescription& vm_desc) override;
+    void pin_thread(qint64 thread_id, const std::vector<int>& host_cpus) override;
+    optional<std::string> host_ipv4() const override;
+    optional<NetworkBytes> network_bytes_for(const std::string& name) override;
 
 private:
     const QString bridge_name;
@@ -23,9 +23,15 @@
 #include <multipass/utils.h>
 
 #include <shared/linux/backend_utils.h>
+#include <shared/linux/netlink.h>
 
 #include <QFile>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sched.h>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -44,37 +50,79 @@ auto generate_tap_device_name(const std::string& vm_name)
     return QString::fromStdString(tap_name);
 }
 
-void create_tap_device(const QString& tap_name, const QString& bridge_name)
+// Links are managed over netlink, which spares a process per step on every instance start and stop
+template <typename Action>
+void warn_on_failure(Action&& action)
 {
-    if (!MP_UTILS.run_cmd_for_status("ip", {"addr", "show", tap_name}))
+    try
+    {
+        action();
+    }
+    catch (const std::runtime_error& e)
     {
-        MP_UTILS.run_cmd_for_status("ip", {"tuntap", "add", tap_name, "mode", "tap"});
-        MP_UTILS.run_cmd_for_status("ip", {"link", "set", tap_name, "master", bridge_name});
-        MP_UTILS.run_cmd_for_status("ip", {"link", "set", tap_name, "up"});
+        mpl::log(mpl::Level::warning, category, e.what());
     }
 }
 
 void remove_tap_device(const QString& tap_device_name)
 {
-    if (MP_UTILS.run_cmd_for_status("ip", {"addr", "show", tap_device_name}))
+    if (MP_NETLINK.link_exists(tap_device_name))
+        warn_on_failure([&tap_device_name] { MP_NETLINK.delete_link(tap_device_name); });
+}
+
+void create_tap_device(const QString& tap_name, const QString& bridge_name, bool multi_queue)
+{
+    if (multi_queue) // a device that was created with a single queue cannot take more, so it is made anew
+        remove_tap_device(tap_name);
+    else if (MP_NETLINK.link_exists(tap_name))
+        return;
+
+    warn_on_failure([&] {
+        MP_NETLINK.add_tap(tap_name, multi_queue);
+        MP_NETLINK.set_master(tap_name, bridge_name);
+        MP_NETLINK.set_up(tap_name);
+    });
+}
+
+QStringList nic_args_for(const QString& tap_device_name, const mp::VirtualMachineDescription& vm_desc)
+{
+    const auto& network_options = vm_desc.network_options;
+    if (network_options == mp::VMNetworkOptions{})
+        return {"-nic", QString::fromStdString(
+                            fmt::format("tap,ifname={},script=no,downscript=no,model=virtio-net-pci,mac={}",
+                                        tap_device_name, vm_desc.default_mac_address))};
+
+    // -nic takes no device properties, so a tuned interface needs its backend and device apart
+    const auto queues = network_options.queues_for(vm_desc.num_cores);
+    auto netdev = QString("tap,id=net0,ifname=%1,script=no,downscript=no").arg(tap_device_name);
+    auto device = QString("virtio-net-pci,netdev=net0,mac=%1").arg(QString::fromStdString(vm_desc.default_mac_address));
+
+    if (network_options.vhost)
+        netdev += ",vhost=on";
+    if (queues > 1)
     {
-        MP_UTILS.run_cmd_for_status("ip", {"link", "delete", tap_device_name});
+        netdev += QString(",queues=%1").arg(queues);
+        device += QString(",mq=on,vectors=%1").arg(2 * queues + 2); // one per queue each way, plus config and control
     }
+    if (network_options.ring_size)
+        device += QString(",rx_queue_size=%1,tx_queue_size=%1").arg(network_options.ring_size);
+
+    return {"-netdev", netdev, "-device", device};
 }
 
 void create_virtual_switch(const std::string& subnet, const QString& bridge_name)
 {
-    if (!MP_UTILS.run_cmd_for_status("ip", {"addr", "show", bridge_name}))
+    if (!MP_NETLINK.link_exists(bridge_name))
     {
         const auto mac_address = mp::utils::generate_mac_address();
         const auto cidr = fmt::format("{}.1/24", subnet);
         const auto broadcast = fmt::format("{}.255", subnet);
 
-        MP_UTILS.run_cmd_for_status("ip",
-                                    {"link", "add", bridge_name, "address", mac_address.c_str(), "type", "bridge"});
-        MP_UTILS.run_cmd_for_status(
-            "ip", {"address", "add", cidr.c_str(), "dev", bridge_name, "broadcast", broadcast.c_str()});
-        MP_UTILS.run_cmd_for_status("ip", {"link", "set", bridge_name, "up"});
+        warn_on_failure([&] {
+            MP_NETLINK.add_bridge(bridge_name, mac_address);
+            MP_NETLINK.add_address(bridge_name, cidr, broadcast);
+            MP_NETLINK.set_up(bridge_name);
+        });
     }
 }
 
@@ -107,10 +155,8 @@ mp::DNSMasqServer::UPtr init_nat_network(const mp::Path& network_dir, const QStr
 
 void delete_virtual_switch(const QString& bridge_name)
 {
-    if (MP_UTILS.run_cmd_for_status("ip", {"addr", "show", bridge_name}))
-    {
-        MP_UTILS.run_cmd_for_status("ip", {"link", "delete", bridge_name});
-    }
+    if (MP_NETLINK.link_exists(bridge_name))
+        warn_on_failure([&bridge_name] { MP_NETLINK.delete_link(bridge_name); });
 }
 } // namespace
 
@@ -139,6 +185,23 @@ mp::optional<mp::IPAddress> mp::QemuPlatformDetail::get_ip_for(const std::string
     return dnsmasq_server->get_ip_for(hw_addr);
 }
 
+std::vector<std::string> mp::QemuPlatformDetail::neighbour_ipv4_for(const std::vector<std::string>& hw_addrs)
+{
+    std::vector<std::string> ret;
+    try
+    {
+        for (const auto& neighbour : MP_NETLINK.ipv4_neighbours())
+            if (std::find(hw_addrs.begin(), hw_addrs.end(), neighbour.hw_addr) != hw_addrs.end())
+                ret.push_back(neighbour.ipv4);
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::debug, category, e.what());
+    }
+
+    return ret;
+}
+
 void mp::QemuPlatformDetail::remove_resources_for(const std::string& name)
 {
     auto it = name_to_net_device_map.find(name);
@@ -165,7 +228,7 @@ QStringList mp::QemuPlatformDetail::vm_platform_args(const VirtualMachineDescrip
 {
     // Configure and generate the args for the default network interface
     auto tap_device_name = generate_tap_device_name(vm_desc.vm_name);
-    create_tap_device(tap_device_name, bridge_name);
+    create_tap_device(tap_device_name, bridge_name, vm_desc.network_options.queues_for(vm_desc.num_cores) > 1);
 
     name_to_net_device_map.emplace(vm_desc.vm_name, std::make_pair(tap_device_name, vm_desc.default_mac_address));
 
@@ -174,10 +237,41 @@ QStringList mp::QemuPlatformDetail::vm_platform_args(const VirtualMachineDescrip
                          << "-cpu"
                          << "host"
                          // Set up the network related args
-                         << "-nic"
-                         << QString::fromStdString(
-                                fmt::format("tap,ifname={},script=no,downscript=no,model=virtio-net-pci,mac={}",
-                                            tap_device_name, vm_desc.default_mac_address));
+                         << nic_args_for(tap_device_name, vm_desc);
+}
+
+void mp::QemuPlatformDetail::pin_thread(qint64 thread_id, const std::vector<int>& host_cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : host_cpus)
+        CPU_SET(cpu, &cpu_set);
+
+    if (sched_setaffinity(static_cast<pid_t>(thread_id), sizeof(cpu_set), &cpu_set) != 0)
+        throw std::runtime_error(fmt::format("cannot pin thread {}: {}", thread_id, std::strerror(errno)));
+}
+
+mp::optional<std::string> mp::QemuPlatformDetail::host_ipv4() const
+{
+    return fmt::format("{}.1", subnet); // the bridge's, as set up in create_virtual_switch()
+}
+
+auto mp::QemuPlatformDetail::network_bytes_for(const std::string& name) -> optional<NetworkBytes>
+{
+    // The tap device sends what the instance receives, and receives what it sends
+    const auto statistics = QString{"/sys/class/net/%1/statistics/"}.arg(generate_tap_device_name(name));
+    auto read = [&statistics](const QString& counter) -> optional<long long> {
+        QFile file{statistics + counter};
+        bool ok = false;
+        const auto value = file.open(QIODevice::ReadOnly) ? file.readAll().trimmed().toLongLong(&ok) : 0;
+        return ok ? mp::make_optional(value) : mp::nullopt;
+    };
+
+    const auto received = read("tx_bytes"), sent = read("rx_bytes");
+    if (!received || !sent)
+        return nullopt;
+
+    return NetworkBytes{*received, *sent};
 }
 
 mp::QemuPlatform::UPtr mp::QemuPlatformFactory::make_qemu_platform(const Path& data_dir) const
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qemu_capabilities.h"
+#include "qemu_vmstate_process_spec.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/platform.h>
+#include <multipass/process/simple_process_spec.h>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "qemu";
+constexpr auto unknown_version = "qemu-unknown";
+
+const QString qemu_binary{QString("qemu-system-%1").arg(HOST_ARCH)};
+
+// Tells one build of QEMU from the next, which upgrades install over the same path
+QString binary_stamp()
+{
+    const QFileInfo binary{QStandardPaths::findExecutable(qemu_binary)};
+    if (!binary.exists())
+        return {};
+
+    return QString{"%1@%2"}.arg(binary.canonicalFilePath()).arg(binary.lastModified().toMSecsSinceEpoch());
+}
+
+QString ask_version()
+{
+    auto process = mp::platform::make_process(mp::simple_process_spec(qemu_binary, {"--version"}));
+
+    auto version_re = QRegularExpression("^QEMU emulator version ([\\d\\.]+)");
+    auto exit_state = process->execute();
+
+    if (exit_state.completed_successfully())
+    {
+        auto match = version_re.match(process->read_all_standard_output());
+
+        if (match.hasMatch())
+            return QString("qemu-%1").arg(match.captured(1));
+        else
+        {
+            mpl::log(mpl::Level::error, category,
+                     fmt::format("Failed to parse QEMU version out: '{}'", process->read_all_standard_output()));
+            return unknown_version;
+        }
+    }
+    else
+    {
+        if (exit_state.error)
+        {
+            mpl::log(mpl::Level::error, category,
+                     fmt::format("Qemu failed to start: {}", exit_state.failure_message()));
+        }
+        else if (exit_state.exit_code)
+        {
+            mpl::log(mpl::Level::error, category,
+                     fmt::format("Qemu fail: '{}' with outputs:\n{}\n{}", exit_state.failure_message(),
+                                 process->read_all_standard_output(), process->read_all_standard_error()));
+        }
+    }
+
+    return unknown_version;
+}
+
+QString ask_machine_type(const QStringList& platform_args)
+{
+    QTemporaryFile dump_file;
+    if (!dump_file.open())
+    {
+        return QString();
+    }
+
+    auto process_spec = std::make_unique<mp::QemuVmStateProcessSpec>(dump_file.fileName(), platform_args);
+    auto process = mp::platform::make_process(std::move(process_spec));
+    auto process_state = process->execute();
+
+    if (!process_state.completed_successfully())
+    {
+        throw std::runtime_error(
+            fmt::format("Internal error: qemu-system-{} failed getting vmstate ({}) with output:\n{}", HOST_ARCH,
+                        process_state.failure_message(), process->read_all_standard_error()));
+    }
+
+    auto vmstate = QJsonDocument::fromJson(dump_file.readAll()).object();
+
+    auto machine_type = vmstate["vmschkmachine"].toObject()["Name"].toString();
+    return machine_type;
+}
+} // namespace
+
+QString mp::QemuCapabilities::version_string()
+{
+    return cached("version", ask_version, unknown_version);
+}
+
+QString mp::QemuCapabilities::default_machine_type(const QStringList& platform_args)
+{
+    return cached("machine:" + platform_args.join(' '), [&platform_args] { return ask_machine_type(platform_args); });
+}
+
+// The lock is held while asking, so that instances starting together wait on the one QEMU rather than start their own
+QString mp::QemuCapabilities::cached(const QString& question, const std::function<QString()>& ask,
+                                     const QString& unknown)
+{
+    const auto stamp = binary_stamp();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = answers.find(question);
+    if (it != answers.end() && it->second.first == stamp)
+        return it->second.second;
+
+    auto answer = ask();
+    if (answer != unknown)
+        answers[question] = {stamp, answer};
+    else
+        answers.erase(question);
+
+    return answer;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_QEMU_CAPABILITIES_H
+#define MULTIPASS_QEMU_CAPABILITIES_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace multipass
+{
+/**
+ * What the host's QEMU says about itself. Asking means starting QEMU, so each answer is kept for all instances, until
+ * the binary is replaced. Failures are not kept, for the next ask to try again.
+ */
+class QemuCapabilities : private DisabledCopyMove
+{
+public:
+    QString version_string();                                      // as in "qemu-6.2.0", or "qemu-unknown"
+    QString default_machine_type(const QStringList& platform_args); // throws std::runtime_error when QEMU fails
+
+private:
+    QString cached(const QString& question, const std::function<QString()>& ask, const QString& unknown = {});
+
+    std::mutex mutex;
+    std::map<QString, std::pair<QString, QString>> answers; // question -> (binary stamp, answer)
+};
+} // namespace multipass
+
+#endif // MULTIPASS_QEMU_CAPABILITIES_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "qemu_guest_agent.h"
+
+#include <QJsonArray>
+
+#include <memory>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto balloon_path = "/machine/peripheral/balloon0";
+
+mp::optional<long long> non_negative(const QJsonValue& value)
+{
+    if (!value.isDouble() || value.toDouble() < 0) // the balloon reports what the guest does not tell as -1
+        return mp::nullopt;
+
+    return static_cast<long long>(value.toDouble());
+}
+
+bool is_global(const QString& ipv4)
+{
+    return !ipv4.startsWith("127.") && !ipv4.startsWith("169.254.");
+}
+} // namespace
+
+mp::QemuGuestAgent::QemuGuestAgent(QmpClient& qmp)
+    : qmp{qmp}, agent{[this](const QByteArray& data) {
+          this->qmp.execute("ringbuf-write", QJsonObject{{"device", port_id}, {"data", QString::fromUtf8(data)}});
+      }}
+{
+}
+
+void mp::QemuGuestAgent::set_open(bool open)
+{
+    this->open = open;
+}
+
+bool mp::QemuGuestAgent::is_open() const
+{
+    return open;
+}
+
+void mp::QemuGuestAgent::query_metrics(const std::function<void(const GuestMetrics&)>& on_metrics)
+{
+    agent.drop_pending(); // whatever an earlier query left unanswered is of no use now
+    auto metrics = std::make_shared<GuestMetrics>();
+
+    // The balloon has the memory figures, which the agent does not; its reply comes before anything read() relays
+    qmp.execute("qom-get", QJsonObject{{"path", balloon_path}, {"property", "guest-stats"}},
+                [metrics](const QJsonObject& reply) {
+                    const auto stats = reply["return"].toObject()["stats"].toObject();
+                    const auto total = non_negative(stats["stat-total-memory"]);
+                    const auto available = non_negative(stats["stat-available-memory"]);
+
+                    if (total && available && *available <= *total)
+                    {
+                        metrics->memory_total = *total;
+                        metrics->memory_usage = *total - *available;
+                    }
+                });
+
+    agent.execute("guest-get-load", {}, [metrics](const QJsonObject& reply) {
+        if (const auto load = reply["return"].toObject(); load.contains("load1"))
+            metrics->load =
+                std::array<double, 3>{load["load1"].toDouble(), load["load5"].toDouble(), load["load15"].toDouble()};
+    });
+
+    agent.execute("guest-get-fsinfo", {}, [metrics](const QJsonObject& reply) {
+        for (const auto& filesystem_value : reply["return"].toArray())
+        {
+            if (const auto filesystem = filesystem_value.toObject(); filesystem["mountpoint"] == "/")
+            {
+                metrics->disk_usage = non_negative(filesystem["used-bytes"]);
+                metrics->disk_total = non_negative(filesystem["total-bytes"]);
+                break;
+            }
+        }
+    });
+
+    agent.execute("guest-get-osinfo", {}, [metrics](const QJsonObject& reply) {
+        metrics->current_release = reply["return"].toObject()["pretty-name"].toString().toStdString();
+    });
+
+    // Replies come back in order, so the last one tells that all are in
+    agent.execute("guest-network-get-interfaces", {}, [metrics, on_metrics](const QJsonObject& reply) {
+        for (const auto& interface : reply["return"].toArray())
+        {
+            for (const auto& address_value : interface.toObject()["ip-addresses"].toArray())
+            {
+                const auto address = address_value.toObject();
+                const auto ipv4 = address["ip-address"].toString();
+                if (address["ip-address-type"] == "ipv4" && is_global(ipv4))
+                    metrics->ipv4.push_back(ipv4.toStdString());
+            }
+        }
+
+        on_metrics(*metrics);
+    });
+}
+
+void mp::QemuGuestAgent::run(const QString& path, const QStringList& arguments)
+{
+    agent.execute("guest-exec", QJsonObject{{"path", path}, {"arg", QJsonArray::fromStringList(arguments)}});
+}
+
+void mp::QemuGuestAgent::read()
+{
+    qmp.execute("ringbuf-read", QJsonObject{{"device", port_id}, {"size", buffer_size}, {"format", "utf8"}},
+                [this](const QJsonObject& reply) { agent.feed(reply["return"].toString().toUtf8()); });
+}
+
+void mp::QemuGuestAgent::reset()
+{
+    agent.drop_pending();
+    open = false;
+}
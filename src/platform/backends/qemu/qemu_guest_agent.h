@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_QEMU_GUEST_AGENT_H
+#define MULTIPASS_QEMU_GUEST_AGENT_H
+
+#include "qmp_client.h"
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/guest_stats.h>
+
+#include <QStringList>
+
+#include <functional>
+
+namespace multipass
+{
+/**
+ * Talks to the QEMU guest agent through the ring buffer that backs its virtio-serial port, over QMP, so that neither
+ * a socket nor the guest's network is needed. What the agent writes sits in the buffer until read() fetches it. It
+ * is not thread-safe: use it from the thread that owns the QEMU process.
+ */
+class QemuGuestAgent : private DisabledCopyMove
+{
+public:
+    static constexpr auto port_name = "org.qemu.guest_agent.0"; // which the agent in the guest looks for
+    static constexpr auto port_id = "qga0";                     // of both the port and its ring buffer
+    static constexpr auto buffer_size = 65536;
+
+    explicit QemuGuestAgent(QmpClient& qmp);
+
+    void set_open(bool open); // as QEMU reports the guest opening and closing its end of the port
+    bool is_open() const;
+
+    // Calls back once the agent has answered; partial metrics when the agent lacks some of the commands
+    void query_metrics(const std::function<void(const GuestMetrics&)>& on_metrics);
+    // Has the agent start a program in the guest, without waiting on it or on the agent's answer
+    void run(const QString& path, const QStringList& arguments);
+    void read(); // relays what the agent wrote so far
+    void reset(); // for when the guest goes away: forgets pending queries
+
+private:
+    QmpClient& qmp;
+    QmpClient agent; // QGA speaks the same protocol
+    bool open{false};
+};
+} // namespace multipass
+
+#endif // MULTIPASS_QEMU_GUEST_AGENT_H
@@ -32,6 +32,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace multipass
 {
@@ -39,10 +41,16 @@ class QemuPlatform : private DisabledCopyMove
 {
 public:
     using UPtr = std::unique_ptr<QemuPlatform>;
+    using NetworkBytes = std::pair<long long, long long>; // received and sent by the instance
 
     virtual ~QemuPlatform() = default;
 
     virtual optional<IPAddress> get_ip_for(const std::string& hw_addr) = 0;
+    // Addresses the host has seen these hardware addresses use, on any of its links
+    virtual std::vector<std::string> neighbour_ipv4_for(const std::vector<std::string>& /*hw_addrs*/)
+    {
+        return {};
+    };
     virtual void remove_resources_for(const std::string&) = 0;
     virtual void platform_health_check() = 0;
     virtual QStringList vmstate_platform_args()
@@ -58,6 +66,20 @@ public:
     {
         throw NotImplementedOnThisBackendException("networks");
     };
+    virtual void pin_thread(qint64 /*thread_id*/, const std::vector<int>& /*host_cpus*/)
+    {
+        throw NotImplementedOnThisBackendException("CPU pinning");
+    };
+    // The host's own address on the network that it gives instances, where it has one
+    virtual optional<std::string> host_ipv4() const
+    {
+        return nullopt;
+    };
+    // Counted on the host's end of the instance's link, where the platform gives it one
+    virtual optional<NetworkBytes> network_bytes_for(const std::string& /*name*/)
+    {
+        return nullopt;
+    };
 
 protected:
     explicit QemuPlatform() = default;
@@ -16,8 +16,8 @@
  */
 
 #include "qemu_virtual_machine.h"
+#include "qemu_capabilities.h"
 #include "qemu_vm_process_spec.h"
-#include "qemu_vmstate_process_spec.h"
 
 #include <shared/qemu_img_utils/qemu_img_utils.h>
 #include <shared/shared_backend_utils.h>
@@ -27,19 +27,29 @@
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/simple_process_spec.h>
+#include <multipass/process_usage.h>
+#include <multipass/tracing.h>
 #include <multipass/utils.h>
 #include <multipass/vm_status_monitor.h>
 
+#include <QEventLoop>
 #include <QFile>
 #include <QJsonArray>
-#include <QJsonDocument>
 #include <QJsonObject>
+#include <QPointer>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QString>
 #include <QStringList>
-#include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
 
+#include <algorithm>
 #include <cassert>
+#include <csignal>
+#include <future>
+#include <memory>
+#include <tuple>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -51,6 +61,22 @@ namespace
 constexpr auto suspend_tag = "suspend";
 constexpr auto machine_type_key = "machine_type";
 constexpr auto arguments_key = "arguments";
+// Set to "migrate" for suspend to migrate the state to a file of its own, in parallel, rather than savevm
+constexpr auto suspend_engine_env_var = "MULTIPASS_QEMU_SUSPEND_ENGINE";
+constexpr auto migration_progress_interval = 1000; // milliseconds
+constexpr auto guest_stats_polling_interval = 5;    // seconds
+constexpr auto guest_agent_read_interval = std::chrono::milliseconds(50);
+constexpr auto live_update_timeout = std::chrono::seconds(30);
+constexpr auto disk_device_id = "hda";
+constexpr long long memory_block_size = 128LL << 20; // what the guest kernel onlines hotplugged memory in
+// Grows the root partition and its filesystem over what the disk gained
+constexpr auto grow_root_script = R"(dev=$(findmnt -no SOURCE /) && growpart "${dev%%[0-9]*}" "${dev##*[!0-9]}" && )"
+                                  R"(resize2fs "$dev")";
+
+bool suspends_by_migration()
+{
+    return qgetenv(suspend_engine_env_var) == "migrate";
+}
 
 bool use_cdrom_set(const QJsonObject& metadata)
 {
@@ -81,10 +107,22 @@ QStringList get_arguments(const QJsonObject& metadata)
     return args;
 }
 
+mp::optional<unsigned> vsock_cid_in(const QStringList& arguments)
+{
+    static const QRegularExpression device{"^vhost-vsock-pci,.*guest-cid=(\\d+)"};
+
+    for (const auto& argument : arguments)
+        if (const auto match = device.match(argument); match.hasMatch())
+            return match.captured(1).toUInt();
+
+    return mp::nullopt;
+}
+
 auto make_qemu_process(const mp::VirtualMachineDescription& desc, const mp::optional<QJsonObject>& resume_metadata,
                        const QStringList& platform_args)
 {
-    if (!QFile::exists(desc.image.image_path) || !QFile::exists(desc.cloud_init_iso))
+    if (!QFile::exists(desc.image.image_path) ||
+        (desc.cloud_init_seed_url.empty() && !QFile::exists(desc.cloud_init_iso)))
     {
         throw std::runtime_error("cannot start VM without an image");
     }
@@ -93,8 +131,10 @@ auto make_qemu_process(const mp::VirtualMachineDescription& desc, const mp::opti
     if (resume_metadata)
     {
         const auto& data = resume_metadata.value();
+        const auto vmstate_file = mp::QemuVMProcessSpec::vmstate_file_for(desc);
         resume_data = mp::QemuVMProcessSpec::ResumeData{suspend_tag, get_vm_machine(data), use_cdrom_set(data),
-                                                        get_arguments(data)};
+                                                        get_arguments(data),
+                                                        QFile::exists(vmstate_file) ? vmstate_file : QString{}};
     }
 
     auto process_spec = std::make_unique<mp::QemuVMProcessSpec>(desc, platform_args, resume_data);
@@ -106,27 +146,56 @@ auto make_qemu_process(const mp::VirtualMachineDescription& desc, const mp::opti
     return process;
 }
 
-auto qmp_execute_json(const QString& cmd)
+// For the command line to start QEMU with the device again, as when resuming an instance that had it hotplugged
+QString device_argument(const QString& driver, const QJsonObject& properties)
 {
-    QJsonObject qmp;
-    qmp.insert("execute", cmd);
-    return QJsonDocument(qmp).toJson();
+    QStringList argument{driver};
+    for (auto it = properties.begin(); it != properties.end(); ++it)
+        argument << QString("%1=%2").arg(it.key(), it.value().toVariant().toString());
+
+    return argument.join(',');
 }
 
-auto hmc_to_qmp_json(const QString& command_line)
+// Both ends of the migration: multifd writes the RAM to fixed offsets of the file, from several threads at once, and
+// leaves zero pages out
+void set_up_file_migration(mp::QmpClient& qmp)
 {
-    auto qmp = QJsonDocument::fromJson(qmp_execute_json("human-monitor-command")).object();
+    QJsonArray capabilities;
+    for (const auto capability : {"events", "multifd", "mapped-ram"})
+        capabilities.append(QJsonObject{{"capability", capability}, {"state", true}});
 
-    QJsonObject cmd_line;
-    cmd_line.insert("command-line", command_line);
+    qmp.execute("migrate-set-capabilities", QJsonObject{{"capabilities", capabilities}});
+    qmp.execute("migrate-set-parameters", QJsonObject{{"multifd-channels", std::max(QThread::idealThreadCount(), 2)}});
+}
 
-    qmp.insert("arguments", cmd_line);
+mp::GuestStats guest_stats_from(const QJsonObject& balloon_reply, const QJsonObject& blockstats_reply)
+{
+    mp::GuestStats stats;
+    if (const auto balloon = balloon_reply["return"].toObject(); balloon.contains("actual"))
+        stats.balloon_bytes = static_cast<long long>(balloon["actual"].toDouble());
 
-    return QJsonDocument(qmp).toJson();
+    for (const auto device_value : blockstats_reply["return"].toArray())
+    {
+        const auto device = device_value.toObject();
+        const auto numbers = device["stats"].toObject();
+        auto name = device["device"].toString();
+        if (name.isEmpty())
+            name = device["qdev"].toString();
+
+        stats.block_devices.push_back({name.toStdString(), static_cast<long long>(numbers["rd_bytes"].toDouble()),
+                                       static_cast<long long>(numbers["wr_bytes"].toDouble()),
+                                       static_cast<long long>(numbers["rd_operations"].toDouble()),
+                                       static_cast<long long>(numbers["wr_operations"].toDouble())});
+    }
+
+    return stats;
 }
 
 bool instance_image_has_snapshot(const mp::Path& image_path)
 {
+    if (const auto snapshot_names = mp::backend::qcow2_snapshot_names(image_path))
+        return snapshot_names->contains(suspend_tag);
+
     auto process =
         mp::platform::make_process(mp::simple_process_spec("qemu-img", QStringList{"snapshot", "-l", image_path}));
     auto process_state = process->execute();
@@ -138,9 +207,10 @@ bool instance_image_has_snapshot(const mp::Path& image_path)
 
     auto output = process->read_all_standard_output().split('\n');
 
+    // The tag is the second column; the names of other snapshots may have it in them
     for (const auto& line : output)
     {
-        if (line.contains(suspend_tag))
+        if (line.simplified().split(' ').value(1) == suspend_tag)
         {
             return true;
         }
@@ -149,55 +219,53 @@ bool instance_image_has_snapshot(const mp::Path& image_path)
     return false;
 }
 
-auto get_qemu_machine_type(const QStringList& platform_args)
+// The suspended state is kept in an internal snapshot too, which the instance's own must not be mistaken for
+QString disk_snapshot_name(const std::string& name, mp::VirtualMachine::State state)
 {
-    QTemporaryFile dump_file;
-    if (!dump_file.open())
-    {
-        return QString();
-    }
-
-    auto process_spec = std::make_unique<mp::QemuVmStateProcessSpec>(dump_file.fileName(), platform_args);
-    auto process = mp::platform::make_process(std::move(process_spec));
-    auto process_state = process->execute();
-
-    if (!process_state.completed_successfully())
-    {
-        throw std::runtime_error(
-            fmt::format("Internal error: qemu-system-{} failed getting vmstate ({}) with output:\n{}", HOST_ARCH,
-                        process_state.failure_message(), process->read_all_standard_error()));
-    }
+    if (state != mp::VirtualMachine::State::off && state != mp::VirtualMachine::State::stopped)
+        throw std::runtime_error("The instance needs to be stopped for its snapshots to be taken, restored or deleted");
 
-    auto vmstate = QJsonDocument::fromJson(dump_file.readAll()).object();
+    if (name == suspend_tag)
+        throw std::runtime_error(fmt::format("\"{}\" is the name of the snapshot that suspends instances", name));
 
-    auto machine_type = vmstate["vmschkmachine"].toObject()["Name"].toString();
-    return machine_type;
+    return QString::fromStdString(name);
 }
 
-auto generate_metadata(const QStringList& platform_args, const QStringList& proc_args)
+auto generate_metadata(const QString& machine_type, const QStringList& proc_args)
 {
     QJsonObject metadata;
-    metadata[machine_type_key] = get_qemu_machine_type(platform_args);
+    metadata[machine_type_key] = machine_type;
     metadata[arguments_key] = QJsonArray::fromStringList(proc_args);
     return metadata;
 }
 } // namespace
 
 mp::QemuVirtualMachine::QemuVirtualMachine(const VirtualMachineDescription& desc, QemuPlatform* qemu_platform,
-                                           VMStatusMonitor& monitor)
-    : BaseVirtualMachine{instance_image_has_snapshot(desc.image.image_path) ? State::suspended : State::off,
+                                           QemuCapabilities& capabilities, VMStatusMonitor& monitor)
+    : BaseVirtualMachine{QFile::exists(QemuVMProcessSpec::vmstate_file_for(desc)) ||
+                                 instance_image_has_snapshot(desc.image.image_path)
+                             ? State::suspended
+                             : State::off,
                          desc.vm_name},
       desc{desc},
       mac_addr{desc.default_mac_address},
       username{desc.ssh_username},
       qemu_platform{qemu_platform},
-      monitor{&monitor}
+      capabilities{capabilities},
+      monitor{&monitor},
+      qmp{[this](const QByteArray& data) {
+          if (vm_process)
+              vm_process->write(data);
+      }}
 {
+    subscribe_to_qmp_events();
+
     QObject::connect(
         this, &QemuVirtualMachine::on_delete_memory_snapshot, this,
         [this] {
             mpl::log(mpl::Level::debug, vm_name, fmt::format("Deleted memory snapshot"));
-            vm_process->write(hmc_to_qmp_json("delvm " + QString::fromStdString(suspend_tag)));
+            if (!QFile::remove(QemuVMProcessSpec::vmstate_file_for(this->desc)))
+                qmp.human_monitor_command("delvm " + QString::fromStdString(suspend_tag));
             is_starting_from_suspend = false;
         },
         Qt::QueuedConnection);
@@ -209,23 +277,45 @@ mp::QemuVirtualMachine::QemuVirtualMachine(const VirtualMachineDescription& desc
         [this] {
             mpl::log(mpl::Level::debug, vm_name, fmt::format("Resetting the network"));
 
-            auto qmp = QJsonDocument::fromJson(qmp_execute_json("set_link")).object();
-            QJsonObject args;
-            args.insert("name", "virtio-net-pci.0");
-            args.insert("up", false);
-            qmp.insert("arguments", args);
-
-            vm_process->write(QJsonDocument(qmp).toJson());
-
-            args["up"] = true;
-            qmp["arguments"] = args;
+            qmp.execute("set_link", QJsonObject{{"name", "virtio-net-pci.0"}, {"up", false}});
+            qmp.execute("set_link", QJsonObject{{"name", "virtio-net-pci.0"}, {"up", true}});
+        },
+        Qt::QueuedConnection);
 
-            vm_process->write(QJsonDocument(qmp).toJson());
+    // Targets come from the daemon's workers, but the process belongs to this thread
+    QObject::connect(
+        this, &QemuVirtualMachine::on_balloon_target, this,
+        [this](qint64 bytes) {
+            if (vm_process && vm_process->running())
+                qmp.execute("balloon", QJsonObject{{"value", bytes}});
         },
         Qt::QueuedConnection);
 }
 
 mp::QemuVirtualMachine::~QemuVirtualMachine()
+{
+    prepare_for_exit();
+}
+
+void mp::QemuVirtualMachine::take_snapshot(const std::string& name)
+{
+    mp::backend::create_image_snapshot(desc.image.image_path, desc.image.backing_image_path,
+                                       disk_snapshot_name(name, current_state()));
+}
+
+void mp::QemuVirtualMachine::restore_snapshot(const std::string& name)
+{
+    mp::backend::apply_image_snapshot(desc.image.image_path, desc.image.backing_image_path,
+                                      disk_snapshot_name(name, current_state()));
+}
+
+void mp::QemuVirtualMachine::delete_snapshot(const std::string& name)
+{
+    mp::backend::delete_image_snapshot(desc.image.image_path, desc.image.backing_image_path,
+                                       disk_snapshot_name(name, current_state()));
+}
+
+void mp::QemuVirtualMachine::prepare_for_exit()
 {
     if (vm_process)
     {
@@ -244,6 +334,7 @@ mp::QemuVirtualMachine::~QemuVirtualMachine()
 
 void mp::QemuVirtualMachine::start()
 {
+    mp::tracing::Span span{"qemu", "start"};
     if (state == State::running)
         return;
 
@@ -262,8 +353,8 @@ void mp::QemuVirtualMachine::start()
     }
     else
     {
-        monitor->update_metadata_for(
-            vm_name, generate_metadata(qemu_platform->vmstate_platform_args(), vm_process->arguments()));
+        const auto machine_type = capabilities.default_machine_type(qemu_platform->vmstate_platform_args());
+        monitor->update_metadata_for(vm_name, generate_metadata(machine_type, vm_process->arguments()));
     }
 
     vm_process->start();
@@ -286,7 +377,19 @@ void mp::QemuVirtualMachine::start()
         }
     }
 
-    vm_process->write(qmp_execute_json("qmp_capabilities"));
+    qmp.execute("qmp_capabilities");
+    // Have the balloon keep the guest's memory figures up to date, for guest_metrics()
+    qmp.execute("qom-set", QJsonObject{{"path", "/machine/peripheral/balloon0"},
+                                       {"property", "guest-stats-polling-interval"},
+                                       {"value", guest_stats_polling_interval}});
+    apply_placement();
+
+    if (const auto vmstate_file = QemuVMProcessSpec::vmstate_file_for(desc);
+        is_starting_from_suspend && QFile::exists(vmstate_file))
+    {
+        set_up_file_migration(qmp);
+        qmp.execute("migrate-incoming", QJsonObject{{"uri", "file:" + vmstate_file}});
+    }
 }
 
 void mp::QemuVirtualMachine::stop()
@@ -303,7 +406,7 @@ void mp::QemuVirtualMachine::shutdown()
     else if ((state == State::running || state == State::delayed_shutdown || state == State::unknown) &&
              vm_process->running())
     {
-        vm_process->write(qmp_execute_json("system_powerdown"));
+        qmp.execute("system_powerdown");
         vm_process->wait_for_finished();
     }
     else
@@ -329,8 +432,13 @@ void mp::QemuVirtualMachine::suspend()
             update_shutdown_status = false;
         }
 
-        vm_process->write(hmc_to_qmp_json("savevm " + QString::fromStdString(suspend_tag)));
-        vm_process->wait_for_finished();
+        if (suspends_by_migration())
+            suspend_by_migration();
+        else
+        {
+            qmp.human_monitor_command("savevm " + QString::fromStdString(suspend_tag)); // RESUME tells when done
+            vm_process->wait_for_finished();
+        }
         vm_process.reset(nullptr);
     }
     else if (state == State::off || state == State::suspended)
@@ -340,6 +448,123 @@ void mp::QemuVirtualMachine::suspend()
     }
 }
 
+void mp::QemuVirtualMachine::kill()
+{
+    // The thread that suspends or stops the instance may drop the process at any time, so it goes by its ID
+    if (const auto pid = process_id.load(); pid > 0)
+    {
+        mpl::log(mpl::Level::warning, vm_name, "Killing the process");
+        ::kill(static_cast<pid_t>(pid), SIGKILL);
+    }
+}
+
+void mp::QemuVirtualMachine::suspend_by_migration()
+{
+    const auto vmstate_file = QemuVMProcessSpec::vmstate_file_for(desc);
+    QFile::remove(vmstate_file);
+
+    mpl::log(mpl::Level::info, vm_name, fmt::format("Saving the state to {}", vmstate_file));
+    suspending_by_migration = true;
+
+    // Paused, nothing changes under the migration, so it takes a single pass
+    qmp.execute("stop");
+    set_up_file_migration(qmp);
+    qmp.execute("migrate", QJsonObject{{"uri", "file:" + vmstate_file}}, [this](const QJsonObject& reply) {
+        if (reply.contains("error"))
+            on_migration_failed(reply["error"].toObject()["desc"].toString());
+    });
+
+    while (vm_process && !vm_process->wait_for_finished(migration_progress_interval) && vm_process->running())
+        qmp.execute("query-migrate", {}, [this](const QJsonObject& reply) { on_migration_progress(reply); });
+}
+
+void mp::QemuVirtualMachine::on_migration_failed(const QString& reason)
+{
+    if (!suspending_by_migration)
+        return;
+
+    mpl::log(mpl::Level::warning, vm_name,
+             fmt::format("Cannot save the state to a file ({}), saving a snapshot instead", reason));
+    suspending_by_migration = false;
+    QFile::remove(QemuVMProcessSpec::vmstate_file_for(desc));
+
+    // The guest stays paused, so there is no RESUME event to wait for, only the reply
+    qmp.human_monitor_command("savevm " + QString::fromStdString(suspend_tag), [this](const QJsonObject&) {
+        vm_process->kill();
+        on_suspend();
+    });
+}
+
+void mp::QemuVirtualMachine::apply_placement()
+{
+    // QEMU takes no pinning on its command line, so its threads are pinned once it is up: the main loop, which also
+    // does the IO, right away, and the vCPU and I/O threads once QMP tells which they are
+    if (const auto& io_cpus = desc.placement.io_cpus; !io_cpus.empty())
+    {
+        pin_thread(vm_process->process_id(), io_cpus);
+        if (desc.disk_options.iothread)
+            qmp.execute("query-iothreads", {}, [this](const QJsonObject& reply) {
+                for (const auto& iothread : reply["return"].toArray())
+                    pin_thread(static_cast<qint64>(iothread.toObject()["thread-id"].toDouble()),
+                               desc.placement.io_cpus);
+            });
+    }
+
+    if (!desc.placement.vcpu_cpus.empty())
+        qmp.execute("query-cpus-fast", {}, [this](const QJsonObject& reply) {
+            const auto& vcpu_cpus = desc.placement.vcpu_cpus;
+            const auto cpus = reply["return"].toArray();
+            for (auto i = 0; i < cpus.size() && !vcpu_cpus.empty(); ++i)
+            {
+                const auto thread_id = static_cast<qint64>(cpus[i].toObject()["thread-id"].toDouble());
+                pin_thread(thread_id, {vcpu_cpus[i % vcpu_cpus.size()]});
+            }
+        });
+}
+
+void mp::QemuVirtualMachine::pin_thread(qint64 thread_id, const std::vector<int>& host_cpus)
+{
+    try
+    {
+        qemu_platform->pin_thread(thread_id, host_cpus);
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, vm_name, fmt::format("Cannot apply CPU pinning: {}", e.what()));
+    }
+}
+
+void mp::QemuVirtualMachine::on_migration_progress(const QJsonObject& reply)
+{
+    const auto ram = reply["return"].toObject()["ram"].toObject();
+    if (const auto total = ram["total"].toDouble(); total > 0)
+    {
+        const auto percentage = static_cast<int>(100 * ram["transferred"].toDouble() / total);
+        mpl::log(mpl::Level::info, vm_name, fmt::format("Saving the state: {}%", percentage));
+    }
+}
+
+void mp::QemuVirtualMachine::on_migration_status(const QString& status)
+{
+    if (status == "completed")
+    {
+        if (suspending_by_migration)
+        {
+            suspending_by_migration = false;
+            vm_process->kill();
+            on_suspend();
+        }
+        else if (is_starting_from_suspend)
+        {
+            qmp.execute("cont"); // the guest was paused when its state was saved
+        }
+    }
+    else if (status == "failed" || status == "cancelled")
+    {
+        on_migration_failed(status);
+    }
+}
+
 mp::VirtualMachine::State mp::QemuVirtualMachine::current_state()
 {
     return state;
@@ -357,6 +582,9 @@ void mp::QemuVirtualMachine::update_state()
 
 void mp::QemuVirtualMachine::on_started()
 {
+    readiness.reset();
+    vsock.reset();
+    guest_agent.reset();
     state = State::starting;
     update_state();
     monitor->on_resume();
@@ -383,6 +611,9 @@ void mp::QemuVirtualMachine::on_shutdown()
     }
 
     management_ip = nullopt;
+    readiness.reset();
+    vsock.reset();
+    guest_agent.reset();
     update_state();
     vm_process.reset(nullptr);
     lock.unlock();
@@ -401,10 +632,36 @@ void mp::QemuVirtualMachine::on_restart()
     update_state();
 
     management_ip = nullopt;
+    readiness.reset();
+    vsock.reset();
+    guest_agent.reset();
 
     monitor->on_restart(vm_name);
 }
 
+void mp::QemuVirtualMachine::on_port_change(const QJsonObject& data)
+{
+    const auto port = data["id"].toString().toStdString();
+    if (port == QemuGuestAgent::port_id)
+    {
+        mpl::log(mpl::Level::debug, vm_name, fmt::format("guest agent {}", data["open"].toBool() ? "up" : "down"));
+        guest_agent.set_open(data["open"].toBool());
+        return;
+    }
+
+    if (!data["open"].toBool())
+        return;
+
+    for (const auto milestone : GuestReadiness::all_milestones)
+    {
+        if (port == GuestReadiness::port_for(milestone))
+        {
+            mpl::log(mpl::Level::debug, vm_name, fmt::format("guest announced {}", port));
+            readiness.reach(milestone);
+        }
+    }
+}
+
 void mp::QemuVirtualMachine::ensure_vm_is_running()
 {
     if (is_starting_from_suspend)
@@ -430,7 +687,7 @@ std::string mp::QemuVirtualMachine::ssh_hostname(std::chrono::milliseconds timeo
 {
     auto get_ip = [this]() -> optional<IPAddress> { return qemu_platform->get_ip_for(mac_addr); };
 
-    return mp::backend::ip_address_for(this, get_ip, timeout);
+    return mp::backend::ssh_hostname_for(this, vsock, get_ip, timeout);
 }
 
 std::string mp::QemuVirtualMachine::ssh_username()
@@ -452,6 +709,22 @@ std::string mp::QemuVirtualMachine::management_ipv4()
     return management_ip.value().as_string();
 }
 
+std::vector<std::string> mp::QemuVirtualMachine::known_ipv4()
+{
+    auto ret = BaseVirtualMachine::known_ipv4();
+
+    // What the host has seen the instance's interfaces use, which covers those on bridges without a lease to look up
+    std::vector<std::string> hw_addrs{desc.default_mac_address};
+    for (const auto& extra_interface : desc.extra_interfaces)
+        hw_addrs.push_back(extra_interface.mac_address);
+
+    for (auto& ipv4 : qemu_platform->neighbour_ipv4_for(hw_addrs))
+        if (std::find(ret.begin(), ret.end(), ipv4) == ret.end())
+            ret.push_back(std::move(ipv4));
+
+    return ret;
+}
+
 std::string mp::QemuVirtualMachine::ipv6()
 {
     return {};
@@ -467,52 +740,51 @@ void mp::QemuVirtualMachine::wait_until_ssh_up(std::chrono::milliseconds timeout
     }
 }
 
+void mp::QemuVirtualMachine::subscribe_to_qmp_events()
+{
+    qmp.subscribe("RESET", [this](const QJsonObject&) {
+        if (state != State::restarting)
+        {
+            mpl::log(mpl::Level::info, vm_name, "VM restarting");
+            on_restart();
+        }
+    });
+    qmp.subscribe("POWERDOWN", [this](const QJsonObject&) { mpl::log(mpl::Level::info, vm_name, "VM powering down"); });
+    qmp.subscribe("SHUTDOWN", [this](const QJsonObject&) { mpl::log(mpl::Level::info, vm_name, "VM shut down"); });
+    qmp.subscribe("STOP", [this](const QJsonObject&) { mpl::log(mpl::Level::info, vm_name, "VM suspending"); });
+    qmp.subscribe("RESUME", [this](const QJsonObject&) {
+        mpl::log(mpl::Level::info, vm_name, "VM suspended");
+        if (state == State::suspending || state == State::running) // savevm resumes the guest once it is done
+        {
+            vm_process->kill();
+            on_suspend();
+        }
+    });
+    qmp.subscribe("VSERPORT_CHANGE", [this](const QJsonObject& data) { on_port_change(data); });
+    qmp.subscribe("MIGRATION", [this](const QJsonObject& data) { on_migration_status(data["status"].toString()); });
+}
+
 void mp::QemuVirtualMachine::initialize_vm_process()
 {
+    qmp.drop_pending(); // whatever the last process was asked, it is not answering now
     vm_process = make_qemu_process(
         desc, ((state == State::suspended) ? mp::make_optional(monitor->retrieve_metadata_for(vm_name)) : mp::nullopt),
         qemu_platform->vm_platform_args(desc));
 
+    // Instances resumed from before the readiness ports came along do not have them
+    readiness.set_offered(vm_process->arguments().contains("virtio-serial-pci,id=virtio-serial0"));
+    vsock.set_cid(vsock_cid_in(vm_process->arguments()));
+
     QObject::connect(vm_process.get(), &Process::started, [this]() {
         mpl::log(mpl::Level::info, vm_name, "process started");
+        process_id = vm_process->process_id();
         on_started();
     });
 
     QObject::connect(vm_process.get(), &Process::ready_read_standard_output, [this]() {
         auto qmp_output = vm_process->read_all_standard_output();
         mpl::log(mpl::Level::debug, vm_name, fmt::format("QMP: {}", qmp_output));
-        auto qmp_object = QJsonDocument::fromJson(qmp_output.split('\n').first()).object();
-        auto event = qmp_object["event"];
-
-        if (!event.isNull())
-        {
-            if (event.toString() == "RESET" && state != State::restarting)
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM restarting");
-                on_restart();
-            }
-            else if (event.toString() == "POWERDOWN")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM powering down");
-            }
-            else if (event.toString() == "SHUTDOWN")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM shut down");
-            }
-            else if (event.toString() == "STOP")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM suspending");
-            }
-            else if (event.toString() == "RESUME")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM suspended");
-                if (state == State::suspending || state == State::running)
-                {
-                    vm_process->kill();
-                    on_suspend();
-                }
-            }
-        }
+        qmp.feed(qmp_output);
     });
 
     QObject::connect(vm_process.get(), &Process::ready_read_standard_error, [this]() {
@@ -538,6 +810,7 @@ void mp::QemuVirtualMachine::initialize_vm_process()
         });
 
     QObject::connect(vm_process.get(), &Process::finished, [this](ProcessState process_state) {
+        process_id = 0;
         if (process_state.exit_code)
         {
             mpl::log(mpl::Level::info, vm_name,
@@ -567,18 +840,291 @@ void mp::QemuVirtualMachine::initialize_vm_process()
 void mp::QemuVirtualMachine::update_cpus(int num_cores)
 {
     assert(num_cores > 0);
+    if (state == State::running)
+        plug_cpus(num_cores - desc.num_cores);
+
     desc.num_cores = num_cores;
 }
 
+void mp::QemuVirtualMachine::update_placement(const VMPlacement& placement)
+{
+    desc.placement = placement;
+}
+
+void mp::QemuVirtualMachine::update_disk_options(const VMDiskOptions& disk_options)
+{
+    desc.disk_options = disk_options;
+}
+
+void mp::QemuVirtualMachine::update_network_options(const VMNetworkOptions& network_options)
+{
+    desc.network_options = network_options;
+}
+
+void mp::QemuVirtualMachine::update_resource_limits(const VMResourceLimits& limits)
+{
+    desc.resource_limits = limits;
+    mp::platform::update_resource_limits(QString::fromStdString(vm_name), limits); // right away, where it has a cgroup
+}
+
 void mp::QemuVirtualMachine::resize_memory(const MemorySize& new_size)
 {
+    if (state == State::running)
+        plug_memory(new_size.in_bytes() - desc.mem_size.in_bytes());
+
     desc.mem_size = new_size;
 }
 
+void mp::QemuVirtualMachine::set_balloon_target(const MemorySize& guest_memory)
+{
+    emit on_balloon_target(std::min(guest_memory, desc.mem_size).in_bytes());
+}
+
+mp::GuestStats mp::QemuVirtualMachine::guest_stats(std::chrono::milliseconds timeout)
+{
+    auto promise = std::make_shared<std::promise<GuestStats>>();
+    auto stats = promise->get_future();
+
+    // QMP replies come back in order, so the last one tells that both are in
+    QMetaObject::invokeMethod(
+        this,
+        [this, promise] {
+            if (!vm_process || !vm_process->running())
+            {
+                promise->set_exception(std::make_exception_ptr(std::runtime_error{"the instance is not running"}));
+                return;
+            }
+
+            auto balloon_reply = std::make_shared<QJsonObject>();
+            qmp.execute("query-balloon", {}, [balloon_reply](const QJsonObject& reply) { *balloon_reply = reply; });
+            qmp.execute("query-blockstats", {},
+                        [this, balloon_reply, promise, pid = vm_process->process_id()](const QJsonObject& reply) {
+                            auto stats = guest_stats_from(*balloon_reply, reply);
+                            if (const auto usage = mp::utils::process_usage(pid))
+                            {
+                                stats.cpu_time_ms = usage->cpu_time_ms();
+                                stats.resident_bytes = usage->resident_bytes();
+                            }
+
+                            if (const auto network = qemu_platform->network_bytes_for(vm_name))
+                            {
+                                stats.network_received_bytes = network->first;
+                                stats.network_sent_bytes = network->second;
+                            }
+
+                            promise->set_value(stats);
+                        });
+        },
+        Qt::QueuedConnection);
+
+    if (stats.wait_for(timeout) != std::future_status::ready)
+        throw std::runtime_error{fmt::format("timed out waiting for QMP to report on {}", vm_name)};
+
+    try
+    {
+        return stats.get();
+    }
+    catch (const std::future_error&) // the process went away, and the replies with it
+    {
+        throw std::runtime_error{fmt::format("QMP stopped answering for {}", vm_name)};
+    }
+}
+
+auto mp::QemuVirtualMachine::guest_metrics(std::chrono::milliseconds timeout) -> optional<GuestMetrics>
+{
+    auto promise = std::make_shared<std::promise<optional<GuestMetrics>>>();
+    auto metrics = promise->get_future();
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, promise] {
+            if (!vm_process || !vm_process->running() || !guest_agent.is_open())
+            {
+                promise->set_value(nullopt);
+                return;
+            }
+
+            guest_agent.query_metrics([promise](const GuestMetrics& metrics) { promise->set_value(metrics); });
+        },
+        Qt::QueuedConnection);
+
+    // The agent's answers pile up in its ring buffer until they are read, so keep reading until they are all in
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (metrics.wait_for(guest_agent_read_interval) != std::future_status::ready)
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            mpl::log(mpl::Level::debug, vm_name, "timed out waiting for the guest agent");
+            return nullopt;
+        }
+
+        QMetaObject::invokeMethod(this, [this] { guest_agent.read(); }, Qt::QueuedConnection);
+    }
+
+    try
+    {
+        return metrics.get();
+    }
+    catch (const std::future_error&) // the guest went away before answering
+    {
+        return nullopt;
+    }
+}
+
 void mp::QemuVirtualMachine::resize_disk(const MemorySize& new_size)
 {
     assert(new_size > desc.disk_space);
 
-    mp::backend::resize_instance_image(new_size, desc.image.image_path);
+    if (state == State::running)
+    {
+        constexpr long long sector_size = 512; // what QEMU sizes disks in
+        const auto bytes = (new_size.in_bytes() + sector_size - 1) / sector_size * sector_size;
+        execute_live("block_resize", QJsonObject{{"device", disk_device_id}, {"size", bytes}});
+        grow_root_filesystem();
+    }
+    else
+        mp::backend::resize_instance_image(new_size, desc.image.image_path);
+
     desc.disk_space = new_size;
 }
+
+bool mp::QemuVirtualMachine::resizes_while_running()
+{
+    return true;
+}
+
+QJsonObject mp::QemuVirtualMachine::execute_live(const QString& command, const QJsonObject& arguments)
+{
+    assert(QThread::currentThread() == thread() && "QMP replies come through this thread's event loop");
+    if (!vm_process || !vm_process->running())
+        throw std::runtime_error{"the instance is not running"};
+
+    // The reply may come after this gave up on it, when neither the loop nor the result are around any more
+    QEventLoop loop;
+    auto result = std::make_shared<optional<QJsonObject>>();
+    qmp.execute(command, arguments, [result, waiting = QPointer<QEventLoop>{&loop}](const QJsonObject& reply) {
+        *result = reply;
+        if (waiting)
+            waiting->quit();
+    });
+
+    QObject::connect(vm_process.get(), &Process::finished, &loop, &QEventLoop::quit);
+    QTimer::singleShot(live_update_timeout, &loop, &QEventLoop::quit);
+    if (!*result)
+        loop.exec();
+
+    if (!*result)
+        throw std::runtime_error{fmt::format("QEMU did not answer {} for {}", command, vm_name)};
+
+    if (const auto error = (*result)->value("error").toObject(); !error.isEmpty())
+        throw std::runtime_error{fmt::format("QEMU refused {}: {}", command, error["desc"].toString())};
+
+    return **result;
+}
+
+void mp::QemuVirtualMachine::plug_cpus(int count)
+{
+    if (count < 0)
+        throw std::runtime_error{"CPUs can only be removed while the instance is stopped"};
+
+    // What the instance was started with leaves room for as many CPUs as the host has, in slots without a QOM path
+    std::vector<QJsonObject> free_slots;
+    for (const auto& slot : execute_live("query-hotpluggable-cpus")["return"].toArray())
+        if (!slot.toObject().contains("qom-path"))
+            free_slots.push_back(slot.toObject());
+
+    if (free_slots.size() < static_cast<std::size_t>(count))
+        throw std::runtime_error{
+            fmt::format("the instance has room for {} more CPUs until it is restarted", free_slots.size())};
+
+    auto position = [](const QJsonObject& slot) {
+        const auto props = slot["props"].toObject();
+        return std::make_tuple(props["socket-id"].toInt(), props["die-id"].toInt(), props["core-id"].toInt(),
+                               props["thread-id"].toInt());
+    };
+    std::sort(free_slots.begin(), free_slots.end(),
+              [&position](const auto& a, const auto& b) { return position(a) < position(b); });
+
+    for (auto i = 0; i < count; ++i)
+    {
+        const auto& slot = free_slots[i];
+        auto properties = slot["props"].toObject();
+        properties["id"] = QString("cpu%1").arg(desc.num_cores); // counts only ever grow while it runs
+
+        auto arguments = properties;
+        arguments["driver"] = slot["type"];
+        execute_live("device_add", arguments);
+
+        remember_for_resume({"-device", device_argument(slot["type"].toString(), properties)});
+        desc.num_cores += 1; // for what was plugged to count, should a later one fail
+    }
+}
+
+void mp::QemuVirtualMachine::plug_memory(long long bytes)
+{
+    if (bytes < 0)
+        throw std::runtime_error{"Memory can only be removed while the instance is stopped"};
+
+    if (bytes % memory_block_size)
+        throw std::runtime_error{
+            fmt::format("Memory can only be added in steps of {}MiB while the instance runs", memory_block_size >> 20)};
+
+    // Backed like the memory it started with, in a DIMM named after the total it brings the instance to
+    const auto id = QString("dimm%1").arg(desc.mem_size.in_bytes() + bytes);
+    QJsonObject backend{{"id", id + "-mem"}, {"size", bytes}};
+    if (desc.placement.hugepages)
+        backend["hugetlb"] = true;
+    if (desc.placement.numa_node)
+    {
+        backend["host-nodes"] = QJsonArray{*desc.placement.numa_node};
+        backend["policy"] = "bind";
+    }
+    const auto backend_type =
+        desc.placement.hugepages || desc.placement.numa_node ? "memory-backend-memfd" : "memory-backend-ram";
+
+    auto object_arguments = backend;
+    object_arguments["qom-type"] = backend_type;
+    execute_live("object-add", object_arguments);
+
+    const QJsonObject dimm{{"id", id}, {"memdev", id + "-mem"}};
+    try
+    {
+        auto device_arguments = dimm;
+        device_arguments["driver"] = "pc-dimm";
+        execute_live("device_add", device_arguments);
+    }
+    catch (...)
+    {
+        qmp.execute("object-del", QJsonObject{{"id", id + "-mem"}});
+        throw;
+    }
+
+    // A single host NUMA node is all that placements bind to, so that list fits in one value
+    if (desc.placement.numa_node)
+        backend["host-nodes"] = *desc.placement.numa_node;
+    remember_for_resume(
+        {"-object", device_argument(backend_type, backend), "-device", device_argument("pc-dimm", dimm)});
+}
+
+void mp::QemuVirtualMachine::grow_root_filesystem()
+{
+    // Cloud-init grows it at every boot anyway
+    if (!guest_agent.is_open())
+    {
+        mpl::log(mpl::Level::info, vm_name, "No guest agent to grow the filesystem with: it grows on the next boot");
+        return;
+    }
+
+    guest_agent.run("/bin/sh", {"-c", grow_root_script});
+}
+
+void mp::QemuVirtualMachine::remember_for_resume(const QStringList& arguments)
+{
+    auto metadata = monitor->retrieve_metadata_for(vm_name);
+    auto stored_arguments = metadata[arguments_key].toArray();
+    for (const auto& argument : arguments)
+        stored_arguments.append(argument);
+
+    metadata[arguments_key] = stored_arguments;
+    monitor->update_metadata_for(vm_name, metadata);
+}
@@ -18,18 +18,25 @@
 #ifndef MULTIPASS_QEMU_VIRTUAL_MACHINE_H
 #define MULTIPASS_QEMU_VIRTUAL_MACHINE_H
 
+#include "qemu_guest_agent.h"
 #include "qemu_platform.h"
+#include "qmp_client.h"
 
 #include <shared/base_virtual_machine.h>
 
 #include <multipass/process/process.h>
 #include <multipass/virtual_machine_description.h>
+#include <multipass/vsock.h>
 
+#include <QJsonObject>
 #include <QObject>
 #include <QStringList>
 
+#include <atomic>
+
 namespace multipass
 {
+class QemuCapabilities;
 class QemuPlatform;
 class VMStatusMonitor;
 
@@ -37,7 +44,8 @@ class QemuVirtualMachine final : public QObject, public BaseVirtualMachine
 {
     Q_OBJECT
 public:
-    QemuVirtualMachine(const VirtualMachineDescription& desc, QemuPlatform* qemu_platform, VMStatusMonitor& monitor);
+    QemuVirtualMachine(const VirtualMachineDescription& desc, QemuPlatform* qemu_platform,
+                       QemuCapabilities& capabilities, VMStatusMonitor& monitor);
     ~QemuVirtualMachine();
 
     void start() override;
@@ -49,17 +57,33 @@ public:
     std::string ssh_hostname(std::chrono::milliseconds timeout) override;
     std::string ssh_username() override;
     std::string management_ipv4() override;
+    std::vector<std::string> known_ipv4() override;
     std::string ipv6() override;
     void ensure_vm_is_running() override;
     void wait_until_ssh_up(std::chrono::milliseconds timeout) override;
     void update_state() override;
     void update_cpus(int num_cores) override;
+    void update_placement(const VMPlacement& placement) override;
+    void update_disk_options(const VMDiskOptions& disk_options) override;
+    void update_network_options(const VMNetworkOptions& network_options) override;
+    void update_resource_limits(const VMResourceLimits& limits) override;
+    // Internal snapshots of the instance image, alongside the one that suspends it
+    void take_snapshot(const std::string& name) override;
+    void restore_snapshot(const std::string& name) override;
+    void delete_snapshot(const std::string& name) override;
     void resize_memory(const MemorySize& new_size) override;
     void resize_disk(const MemorySize& new_size) override;
+    bool resizes_while_running() override; // adding CPUs, memory and disk
+    void set_balloon_target(const MemorySize& guest_memory) override;
+    GuestStats guest_stats(std::chrono::milliseconds timeout) override;
+    optional<GuestMetrics> guest_metrics(std::chrono::milliseconds timeout) override;
+    void prepare_for_exit() override; // suspends what runs
+    void kill() override;
 
 signals:
     void on_delete_memory_snapshot();
     void on_reset_network();
+    void on_balloon_target(qint64 bytes);
 
 private:
     void on_started();
@@ -67,6 +91,19 @@ private:
     void on_shutdown();
     void on_suspend();
     void on_restart();
+    void on_port_change(const QJsonObject& data);
+    void on_migration_progress(const QJsonObject& reply);
+    void on_migration_status(const QString& status);
+    void on_migration_failed(const QString& reason); // falls back to savevm
+    void suspend_by_migration();
+    void apply_placement();
+    void pin_thread(qint64 thread_id, const std::vector<int>& host_cpus); // logs failures
+    QJsonObject execute_live(const QString& command, const QJsonObject& arguments = {}); // throws on errors
+    void plug_cpus(int count);
+    void plug_memory(long long bytes);
+    void grow_root_filesystem();
+    void remember_for_resume(const QStringList& arguments); // hotplugged devices, for the state to load into
+    void subscribe_to_qmp_events();
     void initialize_vm_process();
 
     VirtualMachineDescription desc;
@@ -74,11 +111,17 @@ private:
     const std::string mac_addr;
     const std::string username;
     QemuPlatform* qemu_platform;
+    QemuCapabilities& capabilities; // the factory's, shared by its instances
     VMStatusMonitor* monitor;
+    QmpClient qmp; // writes to whichever process is current
+    QemuGuestAgent guest_agent{qmp};
+    vsock::Endpoint vsock; // of the current process, when it has a vsock device
     std::string saved_error_msg;
     bool update_shutdown_status{true};
     bool is_starting_from_suspend{false};
+    bool suspending_by_migration{false};
     std::chrono::steady_clock::time_point network_deadline;
+    std::atomic<qint64> process_id{0}; // of the running process, for kill to reach it without touching vm_process
 };
 } // namespace multipass
 
@@ -18,16 +18,17 @@
 #include "qemu_virtual_machine_factory.h"
 #include "qemu_virtual_machine.h"
 
+#include <multipass/constants.h>
+#include <multipass/exceptions/settings_exceptions.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform.h>
-#include <multipass/process/simple_process_spec.h>
+#include <multipass/settings/settings.h>
+#include <multipass/tracing.h>
 #include <multipass/virtual_machine_description.h>
 
 #include <shared/qemu_img_utils/qemu_img_utils.h>
 
-#include <QRegularExpression>
-
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -44,7 +45,7 @@ mp::QemuVirtualMachineFactory::QemuVirtualMachineFactory(const mp::Path& data_di
 mp::VirtualMachine::UPtr mp::QemuVirtualMachineFactory::create_virtual_machine(const VirtualMachineDescription& desc,
                                                                                VMStatusMonitor& monitor)
 {
-    return std::make_unique<mp::QemuVirtualMachine>(desc, qemu_platform.get(), monitor);
+    return std::make_unique<mp::QemuVirtualMachine>(desc, qemu_platform.get(), capabilities, monitor);
 }
 
 void mp::QemuVirtualMachineFactory::remove_resources_for(const std::string& name)
@@ -52,19 +53,45 @@ void mp::QemuVirtualMachineFactory::remove_resources_for(const std::string& name
     qemu_platform->remove_resources_for(name);
 }
 
-mp::VMImage mp::QemuVirtualMachineFactory::prepare_source_image(const mp::VMImage& source_image)
+mp::VMImage mp::QemuVirtualMachineFactory::prepare_source_image(const mp::VMImage& source_image,
+                                                                 const ProgressMonitor& monitor)
 {
     VMImage image{source_image};
-    image.image_path = mp::backend::convert_to_qcow_if_necessary(source_image.image_path);
+    image.image_path = mp::backend::convert_to_qcow_if_necessary(source_image.image_path, monitor);
     return image;
 }
 
 void mp::QemuVirtualMachineFactory::prepare_instance_image(const mp::VMImage& instance_image,
                                                            const VirtualMachineDescription& desc)
 {
+    mp::tracing::Span span{"qemu", "prepare_instance_image"};
     mp::backend::resize_instance_image(desc.disk_space, instance_image.image_path);
 }
 
+mp::VMImageVault::UPtr mp::QemuVirtualMachineFactory::create_image_vault(std::vector<mp::VMImageHost*> image_hosts,
+                                                                         mp::URLDownloader* downloader,
+                                                                         const mp::Path& cache_dir_path,
+                                                                         const mp::Path& data_dir_path,
+                                                                         const mp::days& days_to_expire)
+{
+    auto compress_images = false;
+    try
+    {
+        compress_images = MP_SETTINGS.get_as<bool>(mp::compress_images_key);
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read whether to compress images: {}", e.what()));
+    }
+
+    // Instance images are thin qcow2 overlays on top of the prepared images in the vault, which can be compressed
+    // qcow2 images just as well
+    return std::make_unique<mp::DefaultVMImageVault>(
+        image_hosts, downloader, cache_dir_path, data_dir_path, days_to_expire, mp::backend::create_overlay_image,
+        compress_images ? mp::DefaultVMImageVault::CompressAction{mp::backend::compress_image} : nullptr,
+        mp::backend::flatten_image);
+}
+
 void mp::QemuVirtualMachineFactory::hypervisor_health_check()
 {
     qemu_platform->platform_health_check();
@@ -72,41 +99,7 @@ void mp::QemuVirtualMachineFactory::hypervisor_health_check()
 
 QString mp::QemuVirtualMachineFactory::get_backend_version_string()
 {
-    auto process =
-        mp::platform::make_process(simple_process_spec(QString("qemu-system-%1").arg(HOST_ARCH), {"--version"}));
-
-    auto version_re = QRegularExpression("^QEMU emulator version ([\\d\\.]+)");
-    auto exit_state = process->execute();
-
-    if (exit_state.completed_successfully())
-    {
-        auto match = version_re.match(process->read_all_standard_output());
-
-        if (match.hasMatch())
-            return QString("qemu-%1").arg(match.captured(1));
-        else
-        {
-            mpl::log(mpl::Level::error, category,
-                     fmt::format("Failed to parse QEMU version out: '{}'", process->read_all_standard_output()));
-            return QString("qemu-unknown");
-        }
-    }
-    else
-    {
-        if (exit_state.error)
-        {
-            mpl::log(mpl::Level::error, category,
-                     fmt::format("Qemu failed to start: {}", exit_state.failure_message()));
-        }
-        else if (exit_state.exit_code)
-        {
-            mpl::log(mpl::Level::error, category,
-                     fmt::format("Qemu fail: '{}' with outputs:\n{}\n{}", exit_state.failure_message(),
-                                 process->read_all_standard_output(), process->read_all_standard_error()));
-        }
-    }
-
-    return QString("qemu-unknown");
+    return capabilities.version_string();
 }
 
 QString mp::QemuVirtualMachineFactory::get_backend_directory_name()
@@ -118,3 +111,8 @@ auto mp::QemuVirtualMachineFactory::networks() const -> std::vector<NetworkInter
 {
     return qemu_platform->networks();
 }
+
+auto mp::QemuVirtualMachineFactory::cloud_init_seed_host() const -> optional<std::string>
+{
+    return qemu_platform->host_ipv4();
+}
@@ -17,6 +17,7 @@
 #ifndef MULTIPASS_QEMU_VIRTUAL_MACHINE_FACTORY_H
 #define MULTIPASS_QEMU_VIRTUAL_MACHINE_FACTORY_H
 
+#include "qemu_capabilities.h"
 #include "qemu_platform.h"
 
 #include <multipass/path.h>
@@ -36,15 +37,20 @@ public:
     VirtualMachine::UPtr create_virtual_machine(const VirtualMachineDescription& desc,
                                                 VMStatusMonitor& monitor) override;
     void remove_resources_for(const std::string& name) override;
-    VMImage prepare_source_image(const VMImage& source_image) override;
+    VMImage prepare_source_image(const VMImage& source_image, const ProgressMonitor& monitor) override;
     void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) override;
     void hypervisor_health_check() override;
+    VMImageVault::UPtr create_image_vault(std::vector<VMImageHost*> image_hosts, URLDownloader* downloader,
+                                          const Path& cache_dir_path, const Path& data_dir_path,
+                                          const days& days_to_expire) override;
     QString get_backend_version_string() override;
     QString get_backend_directory_name() override;
     std::vector<NetworkInterfaceInfo> networks() const override;
+    optional<std::string> cloud_init_seed_host() const override;
 
 private:
     QemuPlatform::UPtr qemu_platform;
+    QemuCapabilities capabilities;
 };
 } // namespace multipass
 
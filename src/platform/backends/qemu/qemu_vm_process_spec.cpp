@@ -16,20 +16,65 @@
  */
 
 #include "qemu_vm_process_spec.h"
+#include "qemu_guest_agent.h"
 
 #include <multipass/exceptions/snap_environment_exception.h>
 #include <multipass/format.h>
+#include <multipass/guest_readiness.h>
 #include <multipass/logging/log.h>
 #include <multipass/snap_utils.h>
 #include <shared/linux/backend_utils.h>
 
+#include <QFile>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include <unistd.h>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mu = multipass::utils;
 
+namespace
+{
+// Ubuntu cloud images label their root filesystem, whichever partition it is on
+constexpr auto kernel_command_line = "root=LABEL=cloudimg-rootfs ro console=ttyS0";
+constexpr auto memory_hotplug_slots = 16;
+
+// Room for CPUs and memory to be plugged into the running instance, up to what the host has. Only x86 machines take
+// both; it costs the guest nothing until they are plugged.
+#if defined(__x86_64__) || defined(_M_X64)
+constexpr bool takes_hotplug = true;
+#else
+constexpr bool takes_hotplug = false;
+#endif
+
+const QRegularExpression vsock_cid_pattern{"guest-cid=(\\d+)"}; // only the vsock device has one
+
+long long host_memory_megabytes()
+{
+    return static_cast<long long>(::sysconf(_SC_PHYS_PAGES)) * ::sysconf(_SC_PAGE_SIZE) >> 20;
+}
+
+// Each instance starts looking from its own place, for it to keep the same ID from one boot to the next when it can.
+// Instances suspended with a vsock device are given one again, as the guest picks up a new ID when it resumes.
+mp::optional<unsigned> claim_vsock_cid(const mp::VirtualMachineDescription& desc,
+                                       const mp::optional<mp::QemuVMProcessSpec::ResumeData>& resume_data)
+{
+    if (!resume_data)
+        return mp::backend::free_vsock_cid(3 + std::hash<std::string>{}(desc.vm_name) % (1u << 24));
+
+    const auto match = vsock_cid_pattern.match(resume_data->arguments.join(' '));
+    return match.hasMatch() ? mp::backend::free_vsock_cid(match.captured(1).toUInt()) : mp::nullopt;
+}
+} // namespace
+
 mp::QemuVMProcessSpec::QemuVMProcessSpec(const mp::VirtualMachineDescription& desc, const QStringList& platform_args,
                                          const multipass::optional<ResumeData>& resume_data)
-    : desc{desc}, platform_args{platform_args}, resume_data{resume_data}
+    : desc{desc}, platform_args{platform_args}, resume_data{resume_data}, vsock_cid{claim_vsock_cid(desc, resume_data)}
 {
 }
 
@@ -41,8 +86,12 @@ QStringList mp::QemuVMProcessSpec::arguments() const
     {
         args = resume_data->arguments;
 
-        // need to append extra arguments for resume
-        args << "-loadvm" << resume_data->suspend_tag;
+        // need to append extra arguments for resume; the state in a file comes in once QMP has set up the migration
+        if (resume_data->vmstate_file.isEmpty())
+            args << "-loadvm" << resume_data->suspend_tag;
+        else
+            args << "-incoming"
+                 << "defer";
 
         QString machine_type = resume_data->machine_type;
         if (!machine_type.isEmpty())
@@ -55,6 +104,9 @@ QStringList mp::QemuVMProcessSpec::arguments() const
                      fmt::format("Cannot determine QEMU machine type. Falling back to system default."));
         }
 
+        if (vsock_cid)
+            args.replaceInStrings(vsock_cid_pattern, QString{"guest-cid=%1"}.arg(*vsock_cid));
+
         // need to fix old-style vmnet arguments
         // TODO: remove in due time
         args.replaceInStrings("vmnet-macos,mode=shared,", "vmnet-shared,");
@@ -66,15 +118,50 @@ QStringList mp::QemuVMProcessSpec::arguments() const
 
         args << platform_args;
         // The VM image itself
-        args << "-device"
-             << "virtio-scsi-pci,id=scsi0"
-             << "-drive" << QString("file=%1,if=none,format=qcow2,discard=unmap,id=hda").arg(desc.image.image_path)
-             << "-device"
+        const auto& disk_options = desc.disk_options;
+        auto controller = QStringLiteral("virtio-scsi-pci,id=scsi0");
+        if (disk_options.iothread)
+        {
+            args << "-object"
+                 << "iothread,id=iothread0";
+            controller += ",iothread=iothread0";
+        }
+        if (disk_options.queues > 1)
+            controller += QString(",num_queues=%1").arg(disk_options.queues);
+
+        auto drive = QString("file=%1,if=none,format=qcow2,discard=unmap,id=hda").arg(desc.image.image_path);
+        if (disk_options != VMDiskOptions{})
+            drive += QString(",cache=%1,aio=%2").arg(QString::fromStdString(disk_options.cache),
+                                                  QString::fromStdString(disk_options.aio));
+        if (disk_options.detect_zeroes)
+            drive += ",detect-zeroes=unmap";
+
+        args << "-device" << controller << "-drive" << drive << "-device"
              << "scsi-hd,drive=hda,bus=scsi0.0";
         // Number of cpu cores
-        args << "-smp" << QString::number(desc.num_cores);
+        auto smp = QString::number(desc.num_cores);
+        if (takes_hotplug)
+            smp += QString(",maxcpus=%1").arg(std::max<int>(desc.num_cores, std::thread::hardware_concurrency()));
+        args << "-smp" << smp;
         // Memory to use for VM
-        args << "-m" << mem_size;
+        auto memory = mem_size;
+        if (takes_hotplug)
+            memory += QString(",slots=%1,maxmem=%2M")
+                          .arg(memory_hotplug_slots)
+                          .arg(std::max(desc.mem_size.in_megabytes(), host_memory_megabytes()));
+        args << "-m" << memory;
+        // Where that memory comes from, when it is to be backed by hugepages or bound to a host NUMA node
+        if (const auto& placement = desc.placement; placement.hugepages || placement.numa_node)
+        {
+            auto backend = QString("memory-backend-memfd,id=mem0,size=%1").arg(mem_size);
+            if (placement.hugepages)
+                backend += ",hugetlb=on";
+            if (placement.numa_node)
+                backend += QString(",host-nodes=%1,policy=bind").arg(*placement.numa_node);
+
+            args << "-object" << backend << "-numa"
+                 << "node,memdev=mem0";
+        }
         // Control interface
         args << "-qmp"
              << "stdio";
@@ -86,8 +173,38 @@ QStringList mp::QemuVMProcessSpec::arguments() const
              << "chardev:char0"
              // TODO Add a debugging mode with access to console
              << "-nographic";
-        // Cloud-init disk
-        args << "-cdrom" << desc.cloud_init_iso;
+        // Ports the guest opens to announce its readiness, which QEMU reports over QMP
+        args << "-device"
+             << "virtio-serial-pci,id=virtio-serial0";
+        for (const auto milestone : GuestReadiness::all_milestones)
+        {
+            const auto port = QString::fromStdString(GuestReadiness::port_for(milestone));
+            args << "-chardev" << QString("null,id=%1").arg(port) << "-device"
+                 << QString("virtserialport,bus=virtio-serial0.0,chardev=%1,id=%1,name=%1").arg(port);
+        }
+        // Port of the guest agent, whose ring buffer QMP relays to and from
+        args << "-chardev"
+             << QString("ringbuf,id=%1,size=%2").arg(QemuGuestAgent::port_id).arg(QemuGuestAgent::buffer_size)
+             << "-device"
+             << QString("virtserialport,bus=virtio-serial0.0,chardev=%1,id=%1,name=%2")
+                    .arg(QemuGuestAgent::port_id, QemuGuestAgent::port_name);
+        // Socket the daemon reaches the guest's SSH server through, ahead of its network and without going through it
+        if (vsock_cid)
+            args << "-device" << QString("vhost-vsock-pci,id=vsock0,guest-cid=%1").arg(*vsock_cid);
+        // Balloon, through which the guest hands back the pages it frees, and the daemon may reclaim more
+        args << "-device"
+             << "virtio-balloon-pci,id=balloon0,free-page-reporting=on";
+        // Cloud-init disk, or the NoCloud-net datasource to fetch the same files from, named in the SMBIOS serial
+        if (desc.cloud_init_seed_url.empty())
+            args << "-cdrom" << desc.cloud_init_iso;
+        else
+            args << "-smbios"
+                 << QString("type=1,serial=ds=nocloud-net;s=%1").arg(QString::fromStdString(desc.cloud_init_seed_url));
+        // Straight into the image's own kernel, past the firmware's probing of disks and option ROMs, and without the
+        // devices that QEMU adds by default, that instances have no use for
+        if (boots_kernel_directly(desc))
+            args << "-kernel" << desc.image.kernel_path << "-initrd" << desc.image.initrd_path << "-append"
+                 << kernel_command_line << "-nodefaults";
     }
 
     return args;
@@ -120,6 +237,8 @@ profile %1 flags=(attach_disconnected) {
 
   /dev/net/tun rw,
   /dev/kvm rw,
+  /dev/vhost-net rw,
+  /dev/vhost-vsock rw,
   /dev/ptmx rw,
   /dev/kqemu rw,
   @{PROC}/*/status r,
@@ -163,8 +282,7 @@ profile %1 flags=(attach_disconnected) {
 
   # Disk images
   %6 rwk,  # QCow2 filesystem image
-  %7 rk,   # cloud-init ISO
-}
+%7%8}
     )END");
 
     /* Customisations depending on if running inside snap or not */
@@ -184,11 +302,47 @@ profile %1 flags=(attach_disconnected) {
         firmware = "/usr/share/seabios/*";
     }
 
+    QString backing_image; // read-only base of the instance image, when it is a qcow2 overlay
+    if (!desc.image.backing_image_path.isEmpty())
+        backing_image = QString("  %1 rk,  # QCow2 backing image\n").arg(desc.image.backing_image_path);
+
+    const auto vmstate_file = QString("  %1 rw,  # saved VM state\n").arg(vmstate_file_for(desc));
+
+    QString kernel; // booted directly, without going through the firmware
+    if (boots_kernel_directly(desc))
+        kernel = QString("  %1 r,  # kernel\n  %2 r,  # initrd\n").arg(desc.image.kernel_path, desc.image.initrd_path);
+
+    QString cloud_init_iso; // none when the daemon serves cloud-init data over the network
+    if (!desc.cloud_init_iso.isEmpty())
+        cloud_init_iso = QString("  %1 rk,   # cloud-init ISO\n").arg(desc.cloud_init_iso);
+
     return profile_template.arg(apparmor_profile_name(), signal_peer, firmware, root_dir, program(),
-                                desc.image.image_path, desc.cloud_init_iso);
+                                desc.image.image_path, cloud_init_iso, backing_image + vmstate_file + kernel);
+}
+
+bool mp::QemuVMProcessSpec::boots_kernel_directly(const VirtualMachineDescription& desc)
+{
+    const auto& image = desc.image;
+    return !image.kernel_path.isEmpty() && !image.initrd_path.isEmpty() && QFile::exists(image.kernel_path) &&
+           QFile::exists(image.initrd_path);
+}
+
+QString mp::QemuVMProcessSpec::vmstate_file_for(const VirtualMachineDescription& desc)
+{
+    return desc.image.image_path + ".vmstate";
 }
 
 QString mp::QemuVMProcessSpec::identifier() const
 {
     return QString::fromStdString(desc.vm_name);
 }
+
+QString mp::QemuVMProcessSpec::cgroup() const
+{
+    return QString::fromStdString(desc.vm_name);
+}
+
+mp::VMResourceLimits mp::QemuVMProcessSpec::resource_limits() const
+{
+    return desc.resource_limits;
+}
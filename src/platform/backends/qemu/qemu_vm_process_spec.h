@@ -35,9 +35,12 @@ public:
         QString machine_type;
         bool use_cdrom_flag; // to be removed, should be replaced by "arguments"
         QStringList arguments;
+        QString vmstate_file{}; // when the state was migrated to a file, rather than saved in the image
     };
 
     static QString default_machine_type();
+    static QString vmstate_file_for(const VirtualMachineDescription& desc); // where suspending by migration saves to
+    static bool boots_kernel_directly(const VirtualMachineDescription& desc); // when its image came with them
 
     explicit QemuVMProcessSpec(const VirtualMachineDescription& desc, const QStringList& platform_args,
                                const multipass::optional<ResumeData>& resume_data);
@@ -47,10 +50,14 @@ public:
     QString apparmor_profile() const override;
     QString identifier() const override;
 
+    QString cgroup() const override;
+    VMResourceLimits resource_limits() const override;
+
 private:
     const VirtualMachineDescription desc;
     const QStringList platform_args;
     const multipass::optional<ResumeData> resume_data;
+    const multipass::optional<unsigned> vsock_cid; // claimed as the spec is made, for its arguments not to change
 };
 
 } // namespace multipass
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "qmp_client.h"
+
+#include <multipass/optional.h>
+
+#include <QJsonDocument>
+
+namespace mp = multipass;
+
+namespace
+{
+mp::optional<QJsonObject> parse_message(const QByteArray& bytes)
+{
+    QJsonParseError parse_error;
+    const auto json = QJsonDocument::fromJson(bytes, &parse_error);
+    if (parse_error.error != QJsonParseError::NoError || !json.isObject())
+        return mp::nullopt;
+
+    return json.object();
+}
+} // namespace
+
+mp::QmpClient::QmpClient(Writer writer) : writer{std::move(writer)}
+{
+}
+
+void mp::QmpClient::execute(const QString& command, const QJsonObject& arguments, const ReplyHandler& on_reply)
+{
+    QJsonObject qmp{{"execute", command}};
+    if (!arguments.isEmpty())
+        qmp.insert("arguments", arguments);
+
+    if (on_reply)
+    {
+        const auto id = "mp-" + std::to_string(++last_id);
+        qmp.insert("id", QString::fromStdString(id)); // QMP echoes it in the reply
+        pending_replies.emplace(id, on_reply);
+    }
+
+    writer(QJsonDocument(qmp).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void mp::QmpClient::human_monitor_command(const QString& command_line, const ReplyHandler& on_reply)
+{
+    execute("human-monitor-command", QJsonObject{{"command-line", command_line}}, on_reply);
+}
+
+void mp::QmpClient::subscribe(const QString& event, const EventHandler& handler)
+{
+    event_handlers[event.toStdString()].push_back(handler);
+}
+
+void mp::QmpClient::feed(const QByteArray& output)
+{
+    buffer.append(output);
+
+    // QMP ends every message with a line break, but what is left may still be whole, so it is tried too
+    int end;
+    while ((end = buffer.indexOf('\n')) >= 0)
+    {
+        const auto line = buffer.left(end).trimmed();
+        buffer.remove(0, end + 1);
+
+        if (!line.isEmpty())
+            if (const auto message = parse_message(line))
+                dispatch(*message);
+    }
+
+    if (const auto message = parse_message(buffer.trimmed()))
+    {
+        buffer.clear();
+        dispatch(*message);
+    }
+}
+
+void mp::QmpClient::drop_pending()
+{
+    buffer.clear();
+    pending_replies.clear();
+}
+
+void mp::QmpClient::dispatch(const QJsonObject& message)
+{
+    if (const auto event = message["event"]; event.isString())
+    {
+        if (auto it = event_handlers.find(event.toString().toStdString()); it != event_handlers.end())
+            for (const auto& handler : it->second)
+                handler(message["data"].toObject());
+    }
+    else if (const auto id = message["id"].toString(); !id.isEmpty())
+    {
+        if (auto it = pending_replies.find(id.toStdString()); it != pending_replies.end())
+        {
+            auto handler = std::move(it->second);
+            pending_replies.erase(it); // before the handler, which may well send more commands
+            handler(message);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_QMP_CLIENT_H
+#define MULTIPASS_QMP_CLIENT_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+/**
+ * Speaks QMP over whatever carries it to and from QEMU. Commands that want their reply get an id, and the reply that
+ * echoes it goes to them, whatever the order replies come back in; events go to whoever subscribed to them by name.
+ * It is not thread-safe: use it from the thread that owns the QEMU process.
+ */
+class QmpClient : private DisabledCopyMove
+{
+public:
+    using Writer = std::function<void(const QByteArray&)>;
+    using ReplyHandler = std::function<void(const QJsonObject& reply)>; // has either "return" or "error"
+    using EventHandler = std::function<void(const QJsonObject& data)>;
+
+    explicit QmpClient(Writer writer);
+
+    void execute(const QString& command, const QJsonObject& arguments = {}, const ReplyHandler& on_reply = nullptr);
+    void human_monitor_command(const QString& command_line, const ReplyHandler& on_reply = nullptr);
+    void subscribe(const QString& event, const EventHandler& handler);
+
+    void feed(const QByteArray& output); // what QEMU wrote, which may stop in the middle of a message
+    void drop_pending();                 // for when QEMU goes away: forgets pending replies and partial output
+
+private:
+    void dispatch(const QJsonObject& message);
+
+    Writer writer;
+    QByteArray buffer;
+    unsigned long long last_id{0};
+    std::unordered_map<std::string, ReplyHandler> pending_replies;
+    std::unordered_map<std::string, std::vector<EventHandler>> event_handlers;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_QMP_CLIENT_H
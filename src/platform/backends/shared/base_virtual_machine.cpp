@@ -17,12 +17,18 @@
 
 #include "base_virtual_machine.h"
 
+#include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
 #include <multipass/exceptions/ssh_exception.h>
 #include <multipass/logging/log.h>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
+namespace
+{
+constexpr auto guest_agent_timeout = std::chrono::seconds(2);
+} // namespace
+
 namespace multipass
 {
 
@@ -32,6 +38,9 @@ std::vector<std::string> BaseVirtualMachine::get_all_ipv4(const SSHKeyProvider&
 
     if (current_state() == State::running)
     {
+        if (auto metrics = guest_metrics(guest_agent_timeout); metrics && !metrics->ipv4.empty())
+            return metrics->ipv4;
+
         QString ip_a_output;
 
         try
@@ -62,4 +71,77 @@ std::vector<std::string> BaseVirtualMachine::get_all_ipv4(const SSHKeyProvider&
     return all_ipv4;
 }
 
+std::vector<std::string> BaseVirtualMachine::known_ipv4()
+{
+    if (current_state() == State::running)
+        if (auto metrics = guest_metrics(guest_agent_timeout))
+            return metrics->ipv4;
+
+    return {};
+}
+
+bool BaseVirtualMachine::resizes_while_running()
+{
+    return false;
+}
+
+void BaseVirtualMachine::set_balloon_target(const MemorySize&)
+{
+    throw NotImplementedOnThisBackendException("memory ballooning");
+}
+
+GuestStats BaseVirtualMachine::guest_stats(std::chrono::milliseconds)
+{
+    throw NotImplementedOnThisBackendException("guest stats");
+}
+
+optional<GuestMetrics> BaseVirtualMachine::guest_metrics(std::chrono::milliseconds)
+{
+    return nullopt;
+}
+
+void BaseVirtualMachine::update_placement(const VMPlacement&)
+{
+    throw NotImplementedOnThisBackendException("CPU and memory placement");
+}
+
+void BaseVirtualMachine::update_disk_options(const VMDiskOptions&)
+{
+    throw NotImplementedOnThisBackendException("disk tuning");
+}
+
+void BaseVirtualMachine::update_network_options(const VMNetworkOptions&)
+{
+    throw NotImplementedOnThisBackendException("network tuning");
+}
+
+void BaseVirtualMachine::update_resource_limits(const VMResourceLimits&)
+{
+    throw NotImplementedOnThisBackendException("resource limits");
+}
+
+void BaseVirtualMachine::take_snapshot(const std::string&)
+{
+    throw NotImplementedOnThisBackendException("snapshots");
+}
+
+void BaseVirtualMachine::restore_snapshot(const std::string&)
+{
+    throw NotImplementedOnThisBackendException("snapshots");
+}
+
+void BaseVirtualMachine::delete_snapshot(const std::string&)
+{
+    throw NotImplementedOnThisBackendException("snapshots");
+}
+
+void BaseVirtualMachine::prepare_for_exit()
+{
+}
+
+void BaseVirtualMachine::kill()
+{
+    throw NotImplementedOnThisBackendException("killing instances");
+}
+
 } // namespace multipass
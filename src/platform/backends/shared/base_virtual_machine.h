@@ -41,6 +41,22 @@ public:
     BaseVirtualMachine(const std::string& vm_name) : VirtualMachine(vm_name){};
 
     std::vector<std::string> get_all_ipv4(const SSHKeyProvider& key_provider) override;
+    std::vector<std::string> known_ipv4() override; // what the guest agent reports
+    bool resizes_while_running() override;
+    // These throw where the backend has no balloon, cannot place the instance or cannot tune its disk or network
+    void set_balloon_target(const MemorySize& guest_memory) override;
+    GuestStats guest_stats(std::chrono::milliseconds timeout) override;
+    optional<GuestMetrics> guest_metrics(std::chrono::milliseconds timeout) override;
+    void update_placement(const VMPlacement& placement) override;
+    void update_disk_options(const VMDiskOptions& disk_options) override;
+    void update_network_options(const VMNetworkOptions& network_options) override;
+    void update_resource_limits(const VMResourceLimits& limits) override;
+    // These throw where the backend keeps no snapshots
+    void take_snapshot(const std::string& name) override;
+    void restore_snapshot(const std::string& name) override;
+    void delete_snapshot(const std::string& name) override;
+    void prepare_for_exit() override; // nothing, for the destructor to do it
+    void kill() override;             // throws
 };
 } // namespace multipass
 
@@ -41,6 +41,12 @@ auto find_bridge_with(const NetworkContainer& networks, const std::string& membe
 
 void mp::BaseVirtualMachineFactory::configure(VirtualMachineDescription& vm_desc)
 {
+    if (!vm_desc.cloud_init_seed_url.empty()) // served by the daemon instead
+    {
+        vm_desc.cloud_init_iso.clear();
+        return;
+    }
+
     auto instance_dir{mpu::base_dir(vm_desc.image.image_path)};
     const auto cloud_init_iso = instance_dir.filePath("cloud-init-config.iso");
 
@@ -64,6 +64,24 @@ public:
         throw NotImplementedOnThisBackendException("networks");
     };
 
+    MountHandler::UPtr create_native_mount_handler(const SSHKeyProvider& /*ssh_key_provider*/) override
+    {
+        throw NotImplementedOnThisBackendException("native mounts");
+    };
+
+    void prefetch_instance_states() override
+    {
+    }
+
+    void start_creating_instances(const std::vector<VirtualMachineDescription>&) override
+    {
+    }
+
+    optional<std::string> cloud_init_seed_host() const override
+    {
+        return nullopt;
+    }
+
 protected:
     std::string create_bridge_with(const NetworkInterfaceInfo& interface) override
     {
@@ -22,11 +22,16 @@
 #include <multipass/exceptions/snap_environment_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
 #include <multipass/snap_utils.h>
+#include <multipass/spawn.h>
 #include <sys/apparmor.h>
 
+#include <QCryptographicHash>
 #include <QDir>
-#include <QProcess>
+#include <QFile>
+#include <QSaveFile>
+#include <QSysInfo>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -35,16 +40,17 @@ namespace
 {
 static const auto apparmor_parser = "apparmor_parser";
 
-void throw_if_binary_fails(const char* binary_name, const QStringList& arguments = QStringList())
+QByteArray throw_if_binary_fails(const char* binary_name, const QStringList& arguments = QStringList())
 {
-    QProcess process;
-    process.start(binary_name, arguments);
-    if (!process.waitForFinished() || process.exitCode() != 0)
+    auto result = mp::utils::spawn_and_wait(binary_name, arguments);
+    if (!result.state.completed_successfully())
     {
         throw mp::AppArmorException(
             fmt::format("AppArmor cannot be configured, the '{}' utility failed to launch with error: {}", binary_name,
-                        process.errorString()));
+                        result.state.failure_message()));
     }
+
+    return result.standard_output;
 }
 
 QStringList generate_extra_apparmor_args()
@@ -70,9 +76,28 @@ QStringList generate_extra_apparmor_args()
     return {"-W"};
 }
 
+QString generate_compiled_policies_dir()
+{
+    try
+    {
+        QString compiled_dir = mp::utils::snap_common_dir() + "/apparmor.d/compiled/multipass";
+        if (QDir{}.mkpath(compiled_dir))
+            return compiled_dir;
+
+        mpl::log(mpl::Level::debug, "daemon", "Failed to create directory for compiled AppArmor policies");
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        // Ignore
+    }
+
+    return {};
+}
+
 } // namespace
 
-mp::AppArmor::AppArmor() : apparmor_args{generate_extra_apparmor_args()}
+mp::AppArmor::AppArmor()
+    : apparmor_args{generate_extra_apparmor_args()}, compiled_policies_dir{generate_compiled_policies_dir()}
 {
     int ret = aa_is_enabled();
     if (ret <= 0)
@@ -82,43 +107,48 @@ mp::AppArmor::AppArmor() : apparmor_args{generate_extra_apparmor_args()}
 
     // libapparmor's profile management API is not easy to use, it is handier to use apparmor_profile CLI tool
     // Ensure it is available
-    throw_if_binary_fails(apparmor_parser, {"-V"});
+    parser_version = throw_if_binary_fails(apparmor_parser, {"-V"});
 }
 
 void mp::AppArmor::load_policy(const QByteArray& aa_policy) const
 {
-    QProcess process;
-    process.start(apparmor_parser,
-                  apparmor_args + QStringList({"--abort-on-error", "-r"})); // inserts new or replaces existing
-    process.waitForStarted();
-    process.write(aa_policy);
-    process.closeWriteChannel();
-    process.waitForFinished();
+    if (const auto compiled = compiled_policy(aa_policy); !compiled.isEmpty())
+    {
+        mpl::log(mpl::Level::trace, "daemon", fmt::format("Loading compiled AppArmor policy: {}", compiled));
+        if (mp::utils::spawn_and_wait(apparmor_parser, {"--abort-on-error", "-r", "-B", compiled})
+                .state.completed_successfully())
+            return;
+
+        mpl::log(mpl::Level::debug, "daemon", fmt::format("Failed to load {}, compiling the policy again", compiled));
+        QFile::remove(compiled);
+    }
+
+    mp::utils::SpawnOptions options;
+    options.standard_input = aa_policy;
+    const auto arguments = apparmor_args + QStringList({"--abort-on-error", "-r"}); // inserts new or replaces existing
+    auto result = mp::utils::spawn_and_wait(apparmor_parser, arguments, options);
 
     mpl::log(mpl::Level::trace, "daemon", fmt::format("Loading AppArmor policy:\n{}", aa_policy));
 
-    if (process.exitCode() != 0)
+    if (!result.state.completed_successfully())
     {
         throw mp::AppArmorException(fmt::format("Failed to load AppArmor policy {}: errno={} ({})", aa_policy,
-                                                process.exitCode(), process.readAll()));
+                                                result.state.exit_code.value_or(-1), result.standard_output));
     }
 }
 
 void mp::AppArmor::remove_policy(const QByteArray& aa_policy) const
 {
-    QProcess process;
-    process.start(apparmor_parser, apparmor_args + QStringList("-R"));
-    process.waitForStarted();
-    process.write(aa_policy);
-    process.closeWriteChannel();
-    process.waitForFinished();
+    mp::utils::SpawnOptions options;
+    options.standard_input = aa_policy;
+    auto result = mp::utils::spawn_and_wait(apparmor_parser, apparmor_args + QStringList("-R"), options);
 
     mpl::log(mpl::Level::trace, "daemon", fmt::format("Removing AppArmor policy:\n{}", aa_policy));
 
-    if (process.exitCode() != 0)
+    if (!result.state.completed_successfully())
     {
         throw mp::AppArmorException(fmt::format("Failed to remove AppArmor policy {}: errno={} ({})", aa_policy,
-                                                process.exitCode(), process.readAll()));
+                                                result.state.exit_code.value_or(-1), result.standard_output));
     }
 }
 
@@ -132,3 +162,74 @@ void mp::AppArmor::next_exec_under_policy(const QByteArray& aa_policy_name) cons
             fmt::format("Failed to apply AppArmor policy {}: errno={} ({})", aa_policy_name, errno, strerror(errno)));
     }
 }
+
+// Compiled once, a policy takes a mere read of the binary to load, rather than another run of the compiler
+QString mp::AppArmor::compiled_policy(const QByteArray& aa_policy) const
+{
+    if (compiled_policies_dir.isEmpty())
+        return {};
+
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    hash.addData(parser_version);
+    hash.addData(QSysInfo::kernelVersion().toLatin1());
+    hash.addData(aa_policy);
+    const auto path = QDir{compiled_policies_dir}.filePath(hash.result().toHex() + ".bin");
+
+    const auto hit = QFile::exists(path);
+    ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests",
+                               {{"query", "apparmor_binary"}, {"result", hit ? "hit" : "miss"}});
+    if (hit)
+        return path;
+
+    mp::utils::SpawnOptions options;
+    options.standard_input = aa_policy;
+    auto result = mp::utils::spawn_and_wait(apparmor_parser, {"--abort-on-error", "-Q", "-S"}, options); // no loading
+
+    QSaveFile file{path};
+    if (!result.state.completed_successfully() || result.standard_output.isEmpty() ||
+        !file.open(QIODevice::WriteOnly) || file.write(result.standard_output) != result.standard_output.size() ||
+        !file.commit())
+    {
+        mpl::log(mpl::Level::debug, "daemon", fmt::format("Failed to keep a compiled AppArmor policy in {}", path));
+        return {};
+    }
+
+    return path;
+}
+
+void mp::AppArmorPolicies::acquire(const AppArmor& apparmor, const QByteArray& name, const QByteArray& policy)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = loaded.find(name);
+    const auto hit = it != loaded.end() && it->second.policy == policy;
+    ++MP_PERF_COUNTERS.counter("multipass_process_cache_requests",
+                               {{"query", "apparmor_policy"}, {"result", hit ? "hit" : "miss"}});
+
+    if (!hit)
+    {
+        apparmor.load_policy(policy);
+        if (it == loaded.end())
+            it = loaded.emplace(name, Loaded{policy, 0}).first;
+        else
+            it->second.policy = policy;
+    }
+
+    if (it->second.users++ == 0)
+        idle.remove(name);
+}
+
+void mp::AppArmorPolicies::release(const AppArmor& apparmor, const QByteArray& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    if (--loaded.at(name).users > 0)
+        return;
+
+    idle.push_front(name);
+    while (idle.size() > max_idle)
+    {
+        auto evicted = loaded.extract(idle.back());
+        idle.pop_back();
+
+        apparmor.remove_policy(evicted.mapped().policy); // last, for the bookkeeping to hold if it throws
+    }
+}
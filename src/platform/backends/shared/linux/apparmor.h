@@ -20,6 +20,10 @@
 
 #include <QStringList>
 
+#include <list>
+#include <map>
+#include <mutex>
+
 namespace multipass
 {
 
@@ -34,7 +38,34 @@ public:
     void next_exec_under_policy(const QByteArray& aa_policy_name) const;
 
 private:
+    QString compiled_policy(const QByteArray& aa_policy) const;
+
     const QStringList apparmor_args;
+    const QString compiled_policies_dir; // where policies are kept compiled, by hash, empty when not kept
+    QByteArray parser_version;           // compiled policies only do for the parser and kernel that compiled them
+};
+
+// Loading or removing a policy takes a run of apparmor_parser each, so processes under the same policy share it, and
+// the policies of the last few processes to finish stay loaded for the next ones that want them, e.g. the qemu-img
+// runs on one image. Policies are loaded by name, replacing any other by the same name.
+class AppArmorPolicies
+{
+public:
+    void acquire(const AppArmor& apparmor, const QByteArray& name, const QByteArray& policy);
+    void release(const AppArmor& apparmor, const QByteArray& name);
+
+private:
+    struct Loaded
+    {
+        QByteArray policy;
+        int users; // how many processes run under it
+    };
+
+    static constexpr std::size_t max_idle = 16;
+
+    std::mutex mutex;
+    std::map<QByteArray, Loaded> loaded; // by name
+    std::list<QByteArray> idle;          // the names no process runs under, most recently released first
 };
 
 class AppArmorException : public std::runtime_error
@@ -17,6 +17,7 @@
 
 #include "backend_utils.h"
 #include "dbus_wrappers.h"
+#include "netlink.h"
 #include "process_factory.h"
 
 #include <multipass/file_ops.h>
@@ -30,19 +31,24 @@
 
 #include <QCoreApplication>
 #include <QDBusMetaType>
+#include <QHostAddress>
 #include <QString>
 #include <QtDBus/QtDBus>
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <exception>
 #include <mutex>
 #include <random>
 #include <type_traits>
+#include <vector>
 
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/kvm.h>
+#include <linux/vhost.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -65,6 +71,9 @@ const auto nm_settings_ifc = QStringLiteral("org.freedesktop.NetworkManager.Sett
 const auto nm_connection_ifc = QStringLiteral("org.freedesktop.NetworkManager.Settings.Connection");
 constexpr auto max_bridge_name_len = 15; // maximum number of characters in a bridge name
 
+constexpr auto subnet_candidates_per_probe = 8;
+constexpr auto gateway_probe_timeout = std::chrono::milliseconds{250};
+
 bool subnet_used_locally(const std::string& subnet)
 {
     // CLI equivalent: ip -4 route show | grep -q ${SUBNET}
@@ -77,6 +86,82 @@ bool can_reach_gateway(const std::string& ip)
     return MP_UTILS.run_cmd_for_status("ping", {"-n", "-q", ip.c_str(), "-c", "-1", "-W", "1"});
 }
 
+quint32 ipv4_of(const std::string& address)
+{
+    return QHostAddress{QString::fromStdString(address)}.toIPv4Address();
+}
+
+// Whether a route goes to, through or from the /24 @p subnet. Routes wider than a /16 are left out: they are
+// catch-alls, a VPN's for instance, and the gateway probe still finds what is actually there.
+bool subnet_used_by(const std::vector<mp::Netlink::Route>& routes, const std::string& subnet)
+{
+    const auto base = ipv4_of(fmt::format("{}.0", subnet));
+    auto within = [base](const std::string& address) {
+        return !address.empty() && (ipv4_of(address) & 0xFFFFFF00) == base;
+    };
+
+    for (const auto& route : routes)
+    {
+        if (within(route.gateway) || within(route.source))
+            return true;
+
+        if (route.prefix_length >= 16)
+        {
+            const auto mask = ~quint32{0} << (32 - std::min(route.prefix_length, 24));
+            if ((ipv4_of(route.destination) & mask) == (base & mask))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// The routing table is read once and the gateways of a batch of candidates are probed together, in-process. Where
+// either cannot be done, each candidate is checked with `ip` and `ping` processes instead.
+std::vector<std::string> unused_subnets(const std::vector<std::string>& candidates)
+{
+    mp::optional<std::vector<mp::Netlink::Route>> routes;
+    try
+    {
+        routes = MP_NETLINK.ipv4_routes();
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::debug, "daemon", e.what());
+    }
+
+    std::vector<std::string> unrouted, gateways;
+    for (const auto& subnet : candidates)
+    {
+        if (routes ? subnet_used_by(*routes, subnet) : subnet_used_locally(subnet))
+            continue;
+
+        unrouted.push_back(subnet);
+        gateways.push_back(fmt::format("{}.1", subnet));
+        gateways.push_back(fmt::format("{}.254", subnet));
+    }
+
+    std::vector<std::string> ret;
+    try
+    {
+        const auto answering = MP_NETLINK.answering_hosts(gateways, gateway_probe_timeout);
+        for (const auto& subnet : unrouted)
+            if (std::none_of(answering.cbegin(), answering.cend(), [&subnet](const std::string& host) {
+                    return host == fmt::format("{}.1", subnet) || host == fmt::format("{}.254", subnet);
+                }))
+                ret.push_back(subnet);
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::debug, "daemon", e.what());
+        for (const auto& subnet : unrouted)
+            if (!can_reach_gateway(fmt::format("{}.1", subnet)) && !can_reach_gateway(fmt::format("{}.254", subnet)))
+                ret.push_back(subnet);
+    }
+
+    return ret;
+}
+
 auto virtual_switch_subnet(const QString& bridge_name)
 {
     // CLI equivalent: ip -4 route show | grep ${BRIDGE_NAME} | cut -d ' ' -f1 | cut -d '.' -f1-3
@@ -178,22 +263,41 @@ auto make_bridge_rollback_guard(const mpl::CString& log_category, const mpdbus::
 std::string mp::backend::generate_random_subnet()
 {
     gen.seed(std::chrono::system_clock::now().time_since_epoch().count());
-    for (auto i = 0; i < 100; ++i)
+    for (auto i = 0; i < 100; i += subnet_candidates_per_probe)
     {
-        auto subnet = fmt::format("10.{}.{}", dist(gen), dist(gen));
-        if (subnet_used_locally(subnet))
-            continue;
+        std::vector<std::string> candidates;
+        for (auto j = 0; j < subnet_candidates_per_probe; ++j)
+            candidates.push_back(fmt::format("10.{}.{}", dist(gen), dist(gen)));
 
-        if (can_reach_gateway(fmt::format("{}.1", subnet)))
-            continue;
+        if (auto unused = unused_subnets(candidates); !unused.empty())
+            return unused.front();
+    }
 
-        if (can_reach_gateway(fmt::format("{}.254", subnet)))
-            continue;
+    throw std::runtime_error("Could not determine a subnet for networking.");
+}
 
-        return subnet;
+mp::optional<unsigned> mp::backend::free_vsock_cid(unsigned preferred)
+{
+    // The ones below are the hypervisor's, the loopback's and the host's
+    constexpr unsigned first_guest_cid = 3, guest_cids = 1u << 24, attempts = 64;
+
+    const auto fd = MP_LINUX_SYSCALLS.open("/dev/vhost-vsock", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return nullopt;
+
+    // Claiming an ID fails while another instance holds it, and the device gives it back as it is closed
+    mp::optional<unsigned> cid;
+    for (unsigned i = 0; i < attempts && !cid; ++i)
+    {
+        std::uint64_t candidate = first_guest_cid + (preferred - first_guest_cid + i) % guest_cids;
+        if (MP_LINUX_SYSCALLS.ioctl(fd, VHOST_VSOCK_SET_GUEST_CID, reinterpret_cast<unsigned long>(&candidate)) == 0)
+            cid = static_cast<unsigned>(candidate);
+        else if (errno != EADDRINUSE)
+            break;
     }
 
-    throw std::runtime_error("Could not determine a subnet for networking.");
+    MP_LINUX_SYSCALLS.close(fd);
+    return cid;
 }
 
 // @precondition no bridge exists for this interface
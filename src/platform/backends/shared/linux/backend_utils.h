@@ -18,6 +18,7 @@
 #ifndef MULTIPASS_BACKEND_UTILS_H
 #define MULTIPASS_BACKEND_UTILS_H
 
+#include <multipass/optional.h>
 #include <multipass/path.h>
 #include <multipass/singleton.h>
 
@@ -39,6 +40,10 @@ namespace backend
 {
 std::string generate_random_subnet();
 
+// A vsock context ID that no running instance holds, trying @p preferred first and the ones after it next; nullopt
+// when the host has no vsock device to give instances
+optional<unsigned> free_vsock_cid(unsigned preferred);
+
 class CreateBridgeException : public std::runtime_error
 {
 public:
@@ -0,0 +1,547 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "netlink.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <scope_guard.hpp>
+
+#include <QHostAddress>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <net/if.h> // before the kernel headers, which it would otherwise conflict with
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <linux/if_tun.h>
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "netlink";
+
+[[noreturn]] void throw_errno(const std::string& what, int error)
+{
+    throw std::runtime_error(fmt::format("{}: {}", what, std::strerror(error)));
+}
+
+// A netlink request, built up attribute by attribute after its fixed-size header
+class NetlinkRequest
+{
+public:
+    template <typename Header>
+    NetlinkRequest(unsigned short type, unsigned short flags, const Header& header)
+        : buffer(NLMSG_SPACE(sizeof(Header)), 0)
+    {
+        auto msg = message();
+        msg->nlmsg_len = NLMSG_LENGTH(sizeof(Header));
+        msg->nlmsg_type = type;
+        msg->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+        std::memcpy(NLMSG_DATA(msg), &header, sizeof(Header));
+    }
+
+    void add_attribute(unsigned short type, const void* data, std::size_t size)
+    {
+        const auto offset = NLMSG_ALIGN(message()->nlmsg_len);
+        buffer.resize(offset + RTA_SPACE(size), 0);
+
+        auto attribute = reinterpret_cast<rtattr*>(buffer.data() + offset);
+        attribute->rta_type = type;
+        attribute->rta_len = RTA_LENGTH(size);
+        if (size)
+            std::memcpy(RTA_DATA(attribute), data, size);
+        message()->nlmsg_len = offset + RTA_SPACE(size);
+    }
+
+    void add_attribute(unsigned short type, const std::string& value)
+    {
+        add_attribute(type, value.c_str(), value.size() + 1);
+    }
+
+    // Nested attributes go between these two
+    std::size_t begin_nested(unsigned short type)
+    {
+        const auto offset = NLMSG_ALIGN(message()->nlmsg_len);
+        add_attribute(type, nullptr, 0);
+        return offset;
+    }
+
+    void end_nested(std::size_t offset)
+    {
+        reinterpret_cast<rtattr*>(buffer.data() + offset)->rta_len = message()->nlmsg_len - offset;
+    }
+
+    void send(const std::string& what) const
+    {
+        auto fd = open_and_send(what);
+        auto guard = sg::make_scope_guard([fd]() noexcept { close(fd); });
+
+        // The kernel acknowledges with an error message, whose code is 0 on success
+        std::vector<char> reply(8192);
+        auto received = recv(fd, reply.data(), reply.size(), 0);
+        if (received < 0)
+            throw_errno(what, errno);
+
+        auto reply_msg = reinterpret_cast<nlmsghdr*>(reply.data());
+        auto left = static_cast<unsigned>(received);
+        for (; NLMSG_OK(reply_msg, left); reply_msg = NLMSG_NEXT(reply_msg, left))
+            if (reply_msg->nlmsg_type == NLMSG_ERROR)
+                if (auto error = reinterpret_cast<nlmsgerr*>(NLMSG_DATA(reply_msg))->error)
+                    throw_errno(what, -error);
+    }
+
+    // For NLM_F_DUMP requests: the kernel answers with as many messages as it takes, over as many reads
+    void dump(const std::string& what, const std::function<void(nlmsghdr*)>& on_message) const
+    {
+        auto fd = open_and_send(what);
+        auto guard = sg::make_scope_guard([fd]() noexcept { close(fd); });
+
+        std::vector<char> reply(32768);
+        for (;;)
+        {
+            auto received = recv(fd, reply.data(), reply.size(), 0);
+            if (received < 0)
+                throw_errno(what, errno);
+
+            auto reply_msg = reinterpret_cast<nlmsghdr*>(reply.data());
+            auto left = static_cast<unsigned>(received);
+            for (; NLMSG_OK(reply_msg, left); reply_msg = NLMSG_NEXT(reply_msg, left))
+            {
+                if (reply_msg->nlmsg_type == NLMSG_DONE)
+                    return;
+
+                if (reply_msg->nlmsg_type == NLMSG_ERROR)
+                {
+                    if (auto error = reinterpret_cast<nlmsgerr*>(NLMSG_DATA(reply_msg))->error)
+                        throw_errno(what, -error);
+                    return;
+                }
+
+                on_message(reply_msg);
+            }
+        }
+    }
+
+private:
+    int open_and_send(const std::string& what) const
+    {
+        auto fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (fd < 0)
+            throw_errno(what, errno);
+
+        sockaddr_nl kernel{};
+        kernel.nl_family = AF_NETLINK;
+        if (sendto(fd, buffer.data(), message()->nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel),
+                   sizeof(kernel)) < 0)
+        {
+            const auto error = errno;
+            close(fd);
+            throw_errno(what, error);
+        }
+
+        return fd;
+    }
+
+    nlmsghdr* message()
+    {
+        return reinterpret_cast<nlmsghdr*>(buffer.data());
+    }
+
+    const nlmsghdr* message() const
+    {
+        return reinterpret_cast<const nlmsghdr*>(buffer.data());
+    }
+
+    std::vector<char> buffer;
+};
+
+int index_of(const QString& name)
+{
+    auto index = if_nametoindex(name.toStdString().c_str());
+    if (!index)
+        throw_errno(fmt::format("Cannot find network link {}", name), errno);
+
+    return static_cast<int>(index);
+}
+
+// Counts the kernel's link and address announcements, on a thread of its own that sleeps until there is one
+class LinkWatcher
+{
+public:
+    static LinkWatcher& instance()
+    {
+        static LinkWatcher watcher;
+        return watcher;
+    }
+
+    ~LinkWatcher()
+    {
+        if (watcher.joinable())
+        {
+            [[maybe_unused]] auto written = write(wake_pipe[1], "", 1);
+            watcher.join();
+            close(wake_pipe[0]);
+            close(wake_pipe[1]);
+            close(fd);
+        }
+    }
+
+    mp::optional<unsigned long long> version() const
+    {
+        if (following)
+            return changes.load();
+
+        return mp::nullopt;
+    }
+
+private:
+    LinkWatcher()
+    {
+        fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+
+        sockaddr_nl groups{};
+        groups.nl_family = AF_NETLINK;
+        groups.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&groups), sizeof(groups)) < 0 ||
+            pipe2(wake_pipe, O_CLOEXEC) < 0)
+        {
+            mpl::log(mpl::Level::info, category,
+                     fmt::format("Cannot follow link changes, links will be read anew every time: {}",
+                                 std::strerror(errno)));
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+
+        following = true;
+        watcher = std::thread{&LinkWatcher::run, this};
+    }
+
+    void run()
+    {
+        std::vector<char> buffer(32768);
+        pollfd fds[] = {{fd, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}};
+
+        for (;;)
+        {
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                mpl::log(mpl::Level::warning, category,
+                         fmt::format("Stopped following link changes: {}", std::strerror(errno)));
+                following = false;
+                return;
+            }
+
+            if (fds[1].revents)
+                return;
+
+            // What is announced does not matter, only that something was. An overflow (ENOBUFS) means some
+            // announcements were lost, which is just as much a change.
+            if (fds[0].revents && recv(fd, buffer.data(), buffer.size(), MSG_DONTWAIT) != 0)
+                ++changes;
+        }
+    }
+
+    int fd{-1};
+    int wake_pipe[2]{-1, -1};
+    std::atomic<bool> following{false};
+    std::atomic<unsigned long long> changes{0};
+    std::thread watcher;
+};
+
+std::string ipv4_string(const void* data)
+{
+    const auto bytes = reinterpret_cast<const unsigned char*>(data);
+    return fmt::format("{}.{}.{}.{}", bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+// The Internet checksum, as ICMP headers need it
+uint16_t checksum(const void* data, std::size_t size)
+{
+    const auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+    uint32_t sum = 0;
+    for (std::size_t i = 0; i + 1 < size; i += 2)
+        sum += static_cast<uint32_t>(bytes[i] << 8 | bytes[i + 1]);
+    if (size % 2)
+        sum += static_cast<uint32_t>(bytes[size - 1] << 8);
+
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+
+    return htons(static_cast<uint16_t>(~sum));
+}
+
+ifinfomsg link_header(int index = 0)
+{
+    ifinfomsg header{};
+    header.ifi_family = AF_UNSPEC;
+    header.ifi_index = index;
+    return header;
+}
+} // namespace
+
+bool mp::Netlink::link_exists(const QString& name) const
+{
+    return if_nametoindex(name.toStdString().c_str()) != 0;
+}
+
+void mp::Netlink::add_bridge(const QString& name, const std::string& hw_addr) const
+{
+    unsigned char mac[6];
+    if (std::sscanf(hw_addr.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4],
+                    &mac[5]) != 6)
+        throw std::runtime_error(fmt::format("Invalid hardware address for bridge {}: {}", name, hw_addr));
+
+    NetlinkRequest request{RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, link_header()};
+    request.add_attribute(IFLA_IFNAME, name.toStdString());
+    request.add_attribute(IFLA_ADDRESS, mac, sizeof(mac));
+
+    const auto link_info = request.begin_nested(IFLA_LINKINFO);
+    request.add_attribute(IFLA_INFO_KIND, std::string{"bridge"});
+    request.end_nested(link_info);
+
+    request.send(fmt::format("Cannot create bridge {}", name));
+}
+
+void mp::Netlink::add_tap(const QString& name, bool multi_queue) const
+{
+    const auto what = fmt::format("Cannot create tap device {}", name);
+
+    auto fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno(what, errno);
+
+    auto guard = sg::make_scope_guard([fd]() noexcept { close(fd); });
+
+    ifreq request{};
+    std::strncpy(request.ifr_name, name.toStdString().c_str(), IFNAMSIZ - 1);
+    request.ifr_flags = IFF_TAP | IFF_NO_PI | (multi_queue ? IFF_MULTI_QUEUE : 0);
+
+    if (ioctl(fd, TUNSETIFF, &request) < 0 || ioctl(fd, TUNSETPERSIST, 1) < 0)
+        throw_errno(what, errno);
+}
+
+void mp::Netlink::set_master(const QString& name, const QString& master) const
+{
+    NetlinkRequest request{RTM_NEWLINK, 0, link_header(index_of(name))};
+    const auto master_index = index_of(master);
+    request.add_attribute(IFLA_MASTER, &master_index, sizeof(master_index));
+
+    request.send(fmt::format("Cannot attach {} to {}", name, master));
+}
+
+void mp::Netlink::set_up(const QString& name) const
+{
+    auto header = link_header(index_of(name));
+    header.ifi_flags = IFF_UP;
+    header.ifi_change = IFF_UP;
+
+    NetlinkRequest{RTM_NEWLINK, 0, header}.send(fmt::format("Cannot bring {} up", name));
+}
+
+void mp::Netlink::add_address(const QString& name, const std::string& cidr, const std::string& broadcast) const
+{
+    const auto [address, prefix_length] = QHostAddress::parseSubnet(QString::fromStdString(cidr));
+    if (address.protocol() != QAbstractSocket::IPv4Protocol)
+        throw std::runtime_error(fmt::format("Invalid IPv4 address for {}: {}", name, cidr));
+
+    ifaddrmsg header{};
+    header.ifa_family = AF_INET;
+    header.ifa_prefixlen = static_cast<unsigned char>(prefix_length);
+    header.ifa_index = static_cast<unsigned>(index_of(name));
+
+    const auto local = htonl(address.toIPv4Address());
+    const auto broadcast_address = htonl(QHostAddress{QString::fromStdString(broadcast)}.toIPv4Address());
+
+    NetlinkRequest request{RTM_NEWADDR, NLM_F_CREATE | NLM_F_EXCL, header};
+    request.add_attribute(IFA_LOCAL, &local, sizeof(local));
+    request.add_attribute(IFA_ADDRESS, &local, sizeof(local));
+    request.add_attribute(IFA_BROADCAST, &broadcast_address, sizeof(broadcast_address));
+
+    request.send(fmt::format("Cannot add address {} to {}", cidr, name));
+}
+
+void mp::Netlink::delete_link(const QString& name) const
+{
+    NetlinkRequest{RTM_DELLINK, 0, link_header(index_of(name))}.send(fmt::format("Cannot delete {}", name));
+}
+
+auto mp::Netlink::ipv4_neighbours() const -> std::vector<Neighbour>
+{
+    ndmsg header{};
+    header.ndm_family = AF_INET;
+
+    std::vector<Neighbour> ret;
+    NetlinkRequest{RTM_GETNEIGH, NLM_F_DUMP, header}.dump("Cannot list neighbours", [&ret](nlmsghdr* msg) {
+        auto neighbour = reinterpret_cast<ndmsg*>(NLMSG_DATA(msg));
+        if (msg->nlmsg_type != RTM_NEWNEIGH || neighbour->ndm_state & (NUD_INCOMPLETE | NUD_FAILED | NUD_NOARP))
+            return;
+
+        Neighbour entry;
+        auto left = static_cast<unsigned>(NDA_PAYLOAD(msg));
+        for (auto attribute = NDA_RTA(neighbour); RTA_OK(attribute, left); attribute = RTA_NEXT(attribute, left))
+        {
+            const auto data = reinterpret_cast<const unsigned char*>(RTA_DATA(attribute));
+            if (attribute->rta_type == NDA_DST && RTA_PAYLOAD(attribute) == 4)
+                entry.ipv4 = ipv4_string(data);
+            else if (attribute->rta_type == NDA_LLADDR && RTA_PAYLOAD(attribute) == 6)
+                entry.hw_addr = fmt::format("{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}", data[0], data[1], data[2],
+                                            data[3], data[4], data[5]);
+        }
+
+        if (!entry.ipv4.empty() && !entry.hw_addr.empty())
+            ret.push_back(entry);
+    });
+
+    return ret;
+}
+
+auto mp::Netlink::ipv4_routes() const -> std::vector<Route>
+{
+    rtmsg header{};
+    header.rtm_family = AF_INET;
+
+    std::vector<Route> ret;
+    NetlinkRequest{RTM_GETROUTE, NLM_F_DUMP, header}.dump("Cannot list routes", [&ret](nlmsghdr* msg) {
+        auto route = reinterpret_cast<rtmsg*>(NLMSG_DATA(msg));
+        if (msg->nlmsg_type != RTM_NEWROUTE || route->rtm_type != RTN_UNICAST)
+            return;
+
+        auto table = static_cast<unsigned>(route->rtm_table);
+        Route entry{{}, route->rtm_dst_len, {}, {}};
+
+        auto left = static_cast<unsigned>(RTM_PAYLOAD(msg));
+        for (auto attribute = RTM_RTA(route); RTA_OK(attribute, left); attribute = RTA_NEXT(attribute, left))
+        {
+            if (attribute->rta_type == RTA_TABLE && RTA_PAYLOAD(attribute) == 4)
+                std::memcpy(&table, RTA_DATA(attribute), sizeof(table));
+            else if (RTA_PAYLOAD(attribute) != 4)
+                continue;
+            else if (attribute->rta_type == RTA_DST)
+                entry.destination = ipv4_string(RTA_DATA(attribute));
+            else if (attribute->rta_type == RTA_GATEWAY)
+                entry.gateway = ipv4_string(RTA_DATA(attribute));
+            else if (attribute->rta_type == RTA_PREFSRC)
+                entry.source = ipv4_string(RTA_DATA(attribute));
+        }
+
+        if (table == RT_TABLE_MAIN) // what `ip route show` lists
+            ret.push_back(entry);
+    });
+
+    return ret;
+}
+
+auto mp::Netlink::answering_hosts(const std::vector<std::string>& ipv4s, std::chrono::milliseconds timeout) const
+    -> std::vector<std::string>
+{
+    const auto what = std::string{"Cannot probe hosts"};
+
+    auto fd = socket(AF_INET, SOCK_RAW | SOCK_CLOEXEC, IPPROTO_ICMP);
+    if (fd < 0)
+        throw_errno(what, errno);
+
+    auto guard = sg::make_scope_guard([fd]() noexcept { close(fd); });
+
+    // Replies are told apart from those to other pingers by the identifier, and from each other by the sequence
+    const auto identifier = htons(static_cast<uint16_t>(getpid()));
+    for (std::size_t i = 0; i < ipv4s.size(); ++i)
+    {
+        sockaddr_in host{};
+        host.sin_family = AF_INET;
+        if (inet_pton(AF_INET, ipv4s[i].c_str(), &host.sin_addr) != 1)
+            continue;
+
+        icmphdr request{};
+        request.type = ICMP_ECHO;
+        request.un.echo.id = identifier;
+        request.un.echo.sequence = htons(static_cast<uint16_t>(i));
+        request.checksum = checksum(&request, sizeof(request));
+
+        // A host that cannot be routed to is one that does not answer
+        sendto(fd, &request, sizeof(request), 0, reinterpret_cast<sockaddr*>(&host), sizeof(host));
+    }
+
+    std::vector<bool> answered(ipv4s.size(), false);
+    std::vector<char> reply(1500);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (auto left = timeout; left.count() > 0;
+         left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()))
+    {
+        if (std::find(answered.cbegin(), answered.cend(), false) == answered.cend())
+            break;
+
+        pollfd readable{fd, POLLIN, 0};
+        auto ready = poll(&readable, 1, static_cast<int>(left.count()));
+        if (ready < 0 && errno != EINTR)
+            throw_errno(what, errno);
+        if (ready <= 0)
+            continue;
+
+        // Raw sockets hand over the IP header along with the ICMP message
+        auto received = recv(fd, reply.data(), reply.size(), 0);
+        auto ip = reinterpret_cast<const iphdr*>(reply.data());
+        if (received < static_cast<ssize_t>(sizeof(iphdr)) ||
+            received < static_cast<ssize_t>(ip->ihl * 4 + sizeof(icmphdr)))
+            continue;
+
+        auto icmp = reinterpret_cast<const icmphdr*>(reply.data() + ip->ihl * 4);
+        if (icmp->type == ICMP_ECHOREPLY && icmp->un.echo.id == identifier)
+            if (auto sequence = ntohs(icmp->un.echo.sequence); sequence < answered.size())
+                answered[sequence] = true;
+    }
+
+    std::vector<std::string> ret;
+    for (std::size_t i = 0; i < ipv4s.size(); ++i)
+        if (answered[i])
+            ret.push_back(ipv4s[i]);
+
+    return ret;
+}
+
+auto mp::Netlink::links_version() const -> optional<unsigned long long>
+{
+    return LinkWatcher::instance().version();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_NETLINK_H
+#define MULTIPASS_NETLINK_H
+
+#include <multipass/optional.h>
+#include <multipass/singleton.h>
+
+#include <QString>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define MP_NETLINK multipass::Netlink::instance()
+
+namespace multipass
+{
+/**
+ * Manages network links and addresses by talking rtnetlink to the kernel directly, rather than through `ip`
+ * processes, and probes hosts over ICMP rather than through `ping` ones. Everything throws std::runtime_error when the
+ * kernel refuses.
+ */
+class Netlink : public Singleton<Netlink>
+{
+public:
+    struct Neighbour
+    {
+        std::string hw_addr;
+        std::string ipv4;
+    };
+
+    struct Route
+    {
+        std::string destination; // empty for the default route
+        int prefix_length;
+        std::string gateway; // empty when directly connected
+        std::string source;  // empty when the kernel picks
+    };
+
+    using Singleton<Netlink>::Singleton;
+
+    virtual bool link_exists(const QString& name) const;
+    virtual void add_bridge(const QString& name, const std::string& hw_addr) const;
+    virtual void add_tap(const QString& name, bool multi_queue) const; // a persistent one, that outlives its creator
+    virtual void set_master(const QString& name, const QString& master) const;
+    virtual void set_up(const QString& name) const;
+    virtual void add_address(const QString& name, const std::string& cidr, const std::string& broadcast) const;
+    virtual void delete_link(const QString& name) const;
+    virtual std::vector<Neighbour> ipv4_neighbours() const; // the ARP table's resolved entries, on every link
+    virtual std::vector<Route> ipv4_routes() const;         // the main routing table's unicast routes
+
+    // Sends one echo request to each of @p ipv4s at once and returns those that answered within @p timeout
+    virtual std::vector<std::string> answering_hosts(const std::vector<std::string>& ipv4s,
+                                                     std::chrono::milliseconds timeout) const;
+
+    // Changes whenever the kernel announces a link or address change, for what is read about links to be reused
+    // while it stays the same; nullopt when those announcements cannot be followed
+    virtual optional<unsigned long long> links_version() const;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_NETLINK_H
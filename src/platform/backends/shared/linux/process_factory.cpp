@@ -17,6 +17,7 @@
 
 #include "process_factory.h"
 
+#include <multipass/cgroups.h>
 #include <multipass/exceptions/snap_environment_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
@@ -25,18 +26,64 @@
 #include <multipass/process/simple_process_spec.h>
 #include <multipass/snap_utils.h>
 
+#include <QFile>
+#include <QFileInfo>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
 
 namespace
 {
-class AppArmoredProcess : public mp::BasicProcess
+// Joins the cgroup whose cgroup.procs is at @p cgroup_procs, if any, before exec, for all the child runs to count
+class CgroupedProcess : public mp::BasicProcess
+{
+public:
+    CgroupedProcess(std::shared_ptr<mp::ProcessSpec> spec, const QByteArray& cgroup_procs)
+        : mp::BasicProcess{spec}, cgroup_procs{cgroup_procs}
+    {
+        // The cgroup goes once the process is done with it, for those of instances not to pile up
+        connect(this, &CgroupedProcess::finished, [this](const mp::ProcessState&) { remove_cgroup(); });
+        connect(this, &CgroupedProcess::error_occurred, [this](QProcess::ProcessError error, const QString&) {
+            if (error == QProcess::FailedToStart)
+                remove_cgroup();
+        });
+    }
+
+    void setup_child_process() override
+    {
+        mp::BasicProcess::setup_child_process();
+
+        // Between fork and exec, only async-signal-safe calls will do
+        if (const auto fd = cgroup_procs.isEmpty() ? -1 : ::open(cgroup_procs.constData(), O_WRONLY); fd >= 0)
+        {
+            [[maybe_unused]] const auto written = ::write(fd, "0", 1); // 0 stands for the process that writes it
+            ::close(fd);
+        }
+    }
+
+private:
+    void remove_cgroup() const
+    {
+        if (!cgroup_procs.isEmpty())
+            mpu::remove_cgroup(QFileInfo{QFile::decodeName(cgroup_procs)}.dir());
+    }
+
+    const QByteArray cgroup_procs;
+};
+
+class AppArmoredProcess : public CgroupedProcess
 {
 public:
-    AppArmoredProcess(const mp::AppArmor& aa, std::shared_ptr<mp::ProcessSpec> spec)
-        : mp::BasicProcess{spec}, apparmor{aa}
+    AppArmoredProcess(const mp::AppArmor& aa, mp::AppArmorPolicies& policies, std::shared_ptr<mp::ProcessSpec> spec,
+                      const QByteArray& cgroup_procs)
+        : CgroupedProcess{spec, cgroup_procs}, apparmor{aa}, policies{policies}
     {
-        apparmor.load_policy(process_spec->apparmor_profile().toLatin1());
+        policies.acquire(apparmor, process_spec->apparmor_profile_name().toLatin1(),
+                         process_spec->apparmor_profile().toLatin1());
 
         connect(this, &AppArmoredProcess::state_changed, [this](QProcess::ProcessState state) {
             if (state == QProcess::Starting)
@@ -49,7 +96,7 @@ public:
 
     void setup_child_process() final
     {
-        mp::BasicProcess::setup_child_process();
+        CgroupedProcess::setup_child_process();
 
         apparmor.next_exec_under_policy(process_spec->apparmor_profile_name().toLatin1());
     }
@@ -58,7 +105,7 @@ public:
     {
         try
         {
-            apparmor.remove_policy(process_spec->apparmor_profile().toLatin1());
+            policies.release(apparmor, process_spec->apparmor_profile_name().toLatin1());
         }
         catch (const std::exception& e)
         {
@@ -69,6 +116,7 @@ public:
 
 private:
     const mp::AppArmor& apparmor;
+    mp::AppArmorPolicies& policies;
 };
 
 mp::optional<mp::AppArmor> create_apparmor()
@@ -97,30 +145,54 @@ mp::optional<mp::AppArmor> create_apparmor()
         return mp::nullopt;
     }
 }
+
+mp::optional<QDir> create_cgroups()
+{
+    if (qEnvironmentVariableIsSet("DISABLE_CGROUPS"))
+    {
+        mpl::log(mpl::Level::warning, "cgroups", "Cgroups disabled by environment variable");
+        return mp::nullopt;
+    }
+
+    const auto own = mpu::own_cgroup();
+    if (!own)
+    {
+        mpl::log(mpl::Level::info, "cgroups", "The host has no unified cgroup hierarchy, instances share the daemon's");
+        return mp::nullopt;
+    }
+
+    return mpu::set_up_cgroups(*own);
+}
 } // namespace
 
 mp::ProcessFactory::ProcessFactory(const Singleton<ProcessFactory>::PrivatePass& pass)
-    : Singleton<ProcessFactory>::Singleton{pass}, apparmor{create_apparmor()}
+    : Singleton<ProcessFactory>::Singleton{pass}, apparmor{create_apparmor()}, instances_cgroup{create_cgroups()}
 {
 }
 
 // This is the default ProcessFactory that creates a Process with no security mechanisms enabled
 std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(std::unique_ptr<mp::ProcessSpec>&& process_spec) const
 {
+    const auto cgroup_procs = cgroup_procs_for(*process_spec);
+
     if (apparmor && !process_spec->apparmor_profile().isNull())
     {
         std::shared_ptr<ProcessSpec> spec = std::move(process_spec);
         try
         {
-            return std::make_unique<AppArmoredProcess>(apparmor.value(), spec);
+            return std::make_unique<AppArmoredProcess>(apparmor.value(), apparmor_policies, spec, cgroup_procs);
         }
         catch (const mp::AppArmorException& e)
         {
             // TODO: This won't fly in strict mode (#1074), since we'll be confined by snapd
             mpl::log(mpl::Level::warning, "apparmor", e.what());
-            return std::make_unique<BasicProcess>(spec);
+            return std::make_unique<CgroupedProcess>(spec, cgroup_procs);
         }
     }
+    else if (!cgroup_procs.isEmpty())
+    {
+        return std::make_unique<CgroupedProcess>(std::move(process_spec), cgroup_procs);
+    }
     else
     {
         return std::make_unique<BasicProcess>(std::move(process_spec));
@@ -132,3 +204,23 @@ std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(const QString& c
 {
     return create_process(simple_process_spec(command, arguments));
 }
+
+void mp::ProcessFactory::update_resource_limits(const QString& cgroup, const VMResourceLimits& limits) const
+{
+    if (instances_cgroup && QFile::exists(instances_cgroup->filePath(cgroup)))
+        mpu::apply_resource_limits(QDir{instances_cgroup->filePath(cgroup)}, limits);
+}
+
+// Empty when the process is to stay in the daemon's cgroup, or its own cannot be set up
+QByteArray mp::ProcessFactory::cgroup_procs_for(const ProcessSpec& process_spec) const
+{
+    const auto cgroup = process_spec.cgroup();
+    if (!instances_cgroup || cgroup.isNull())
+        return {};
+
+    const QDir dir{instances_cgroup->filePath(cgroup)};
+    if (!mpu::apply_resource_limits(dir, process_spec.resource_limits()))
+        mpl::log(mpl::Level::warning, "cgroups", fmt::format("Not all limits apply to {}", cgroup));
+
+    return QFile::encodeName(dir.filePath("cgroup.procs"));
+}
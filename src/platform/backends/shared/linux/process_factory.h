@@ -25,6 +25,8 @@
 #include <multipass/process/process_spec.h>
 #include <multipass/singleton.h>
 
+#include <QDir>
+
 #define MP_PROCFACTORY multipass::ProcessFactory::instance()
 
 namespace multipass
@@ -39,8 +41,15 @@ public:
     virtual std::unique_ptr<Process> create_process(std::unique_ptr<ProcessSpec>&& process_spec) const;
     std::unique_ptr<Process> create_process(const QString& command, const QStringList& args = QStringList()) const;
 
+    // For the processes already in @p cgroup, as when an instance's limits change while it runs
+    void update_resource_limits(const QString& cgroup, const VMResourceLimits& limits) const;
+
 private:
+    QByteArray cgroup_procs_for(const ProcessSpec& process_spec) const;
+
     const multipass::optional<AppArmor> apparmor;
+    const multipass::optional<QDir> instances_cgroup;
+    mutable AppArmorPolicies apparmor_policies;
 };
 
 } // namespace multipass
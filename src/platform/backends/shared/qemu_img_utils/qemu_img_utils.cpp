@@ -22,14 +22,136 @@
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
 
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QRegularExpression>
 #include <QString>
 #include <QStringList>
 
+#include <chrono>
+
 namespace mp = multipass;
 
+namespace
+{
+// See docs/interop/qcow2.txt in the QEMU sources, all fields are big-endian
+constexpr quint32 qcow2_magic = 0x514649fb; // "QFI\xfb"
+constexpr qint64 qcow2_nb_snapshots_offset = 60;
+constexpr qint64 qcow2_snapshot_header_size = 40;
+constexpr quint32 qcow2_max_snapshots = 65536;
+
+struct Qcow2Header
+{
+    quint32 nb_snapshots;
+    quint64 snapshots_offset;
+};
+
+mp::optional<Qcow2Header> read_qcow2_header(QFile& image_file)
+{
+    QDataStream stream{&image_file};
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != qcow2_magic || version < 2)
+        return mp::nullopt;
+
+    Qcow2Header header;
+    if (!image_file.seek(qcow2_nb_snapshots_offset))
+        return mp::nullopt;
+
+    stream >> header.nb_snapshots >> header.snapshots_offset;
+    if (stream.status() != QDataStream::Ok || header.nb_snapshots > qcow2_max_snapshots)
+        return mp::nullopt;
+
+    return header;
+}
+// Like Process::execute, but passes on the progress that qemu-img -p keeps rewriting on its output, e.g. "(12.34/100%)"
+mp::ProcessState execute_with_progress(mp::Process& process, const mp::ProgressMonitor& monitor)
+{
+    const QRegularExpression progress_pattern{"\\((\\d+)(?:\\.\\d+)?/100%\\)"};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{mp::image_resize_timeout};
+
+    process.start();
+    if (!process.wait_for_started())
+        return process.process_state();
+
+    auto last_percentage = -1;
+    while (process.running() && std::chrono::steady_clock::now() < deadline)
+    {
+        if (!process.wait_for_ready_read(1000))
+            continue;
+
+        auto percentage = last_percentage;
+        for (auto matches = progress_pattern.globalMatch(process.read_all_standard_output()); matches.hasNext();)
+            percentage = matches.next().captured(1).toInt();
+
+        if (percentage != last_percentage && !monitor(mp::LaunchProgress::PREPARE, percentage))
+        {
+            process.kill();
+            process.wait_for_finished();
+            return mp::ProcessState{mp::nullopt, mp::ProcessState::Error{QProcess::Crashed, "cancelled"}};
+        }
+
+        last_percentage = percentage;
+    }
+
+    if (process.running())
+    {
+        process.kill();
+        process.wait_for_finished();
+        return mp::ProcessState{mp::nullopt, mp::ProcessState::Error{QProcess::Timedout, "timed out"}};
+    }
+
+    process.wait_for_finished();
+    return process.process_state();
+}
+
+void convert_compressed(const mp::Path& image_path, const mp::Path& backing_image_path, const mp::Path& output_path,
+                        const char* action)
+{
+    // Compressed clusters are read as they are, and written out uncompressed in whichever overlay changes them. Zstd
+    // ones inflate faster than zlib ones, but need QEMU 5.1.
+    mp::ProcessState process_state;
+    QByteArray error_output;
+    for (const auto& options : {QStringList{"-o", "compression_type=zstd"}, QStringList{}})
+    {
+        auto qemuimg_convert_spec = std::make_unique<mp::QemuImgProcessSpec>(
+            QStringList{"convert", "-c", "-O", "qcow2"} + options + QStringList{image_path, output_path}, image_path,
+            output_path, backing_image_path.isEmpty() ? QStringList{} : QStringList{backing_image_path});
+        auto qemuimg_convert_process = mp::platform::make_process(std::move(qemuimg_convert_spec));
+
+        process_state = qemuimg_convert_process->execute(mp::image_resize_timeout);
+        if (process_state.completed_successfully())
+            return;
+
+        error_output = qemuimg_convert_process->read_all_standard_error();
+    }
+
+    throw std::runtime_error(fmt::format("Cannot {} image: qemu-img failed ({}) with output:\n{}", action,
+                                         process_state.failure_message(), error_output));
+}
+
+void run_snapshot_command(const QString& option, const mp::Path& image_path, const mp::Path& backing_image_path,
+                          const QString& name, const char* action)
+{
+    auto qemuimg_snapshot_spec = std::make_unique<mp::QemuImgProcessSpec>(
+        QStringList{"snapshot", option, name, image_path}, QString{}, image_path,
+        backing_image_path.isEmpty() ? QStringList{} : QStringList{backing_image_path});
+    auto qemuimg_snapshot_process = mp::platform::make_process(std::move(qemuimg_snapshot_spec));
+
+    auto process_state = qemuimg_snapshot_process->execute(mp::image_resize_timeout);
+    if (!process_state.completed_successfully())
+        throw std::runtime_error(fmt::format("Cannot {} snapshot {}: qemu-img failed ({}) with output:\n{}", action,
+                                             name, process_state.failure_message(),
+                                             qemuimg_snapshot_process->read_all_standard_error()));
+}
+} // namespace
+
 void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::Path& image_path)
 {
     auto disk_size = QString::number(disk_space.in_bytes()); // format documented in `man qemu-img` (look for "size")
@@ -46,12 +168,15 @@ void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::
     }
 }
 
-mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
+mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path, const ProgressMonitor& monitor)
 {
     // Check if raw image file, and if so, convert to qcow2 format.
     // TODO: we could support converting from other the image formats that qemu-img can deal with
     const auto qcow2_path{image_path + ".qcow2"};
 
+    if (is_qcow2_image(image_path))
+        return image_path;
+
     auto qemuimg_info_spec =
         std::make_unique<mp::QemuImgProcessSpec>(QStringList{"info", "--output=json", image_path}, image_path);
     auto qemuimg_info_process = mp::platform::make_process(std::move(qemuimg_info_spec));
@@ -72,7 +197,8 @@ mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
         auto qemuimg_convert_spec = std::make_unique<mp::QemuImgProcessSpec>(
             QStringList{"convert", "-p", "-O", "qcow2", image_path, qcow2_path}, image_path, qcow2_path);
         auto qemuimg_convert_process = mp::platform::make_process(std::move(qemuimg_convert_spec));
-        process_state = qemuimg_convert_process->execute(mp::image_resize_timeout);
+        process_state = monitor ? execute_with_progress(*qemuimg_convert_process, monitor)
+                                : qemuimg_convert_process->execute(mp::image_resize_timeout);
 
         if (!process_state.completed_successfully())
         {
@@ -87,3 +213,105 @@ mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
         return image_path;
     }
 }
+
+mp::Path mp::backend::create_overlay_image(const mp::Path& backing_image_path, const QDir& output_dir)
+{
+    // The overlay only holds the blocks the instance writes, everything else is read from the backing image
+    const auto overlay_path = output_dir.filePath(QFileInfo{backing_image_path}.fileName());
+
+    auto qemuimg_create_spec = std::make_unique<mp::QemuImgProcessSpec>(
+        QStringList{"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_image_path, overlay_path},
+        backing_image_path, overlay_path);
+    auto qemuimg_create_process = mp::platform::make_process(std::move(qemuimg_create_spec));
+
+    auto process_state = qemuimg_create_process->execute(mp::image_resize_timeout);
+    if (!process_state.completed_successfully())
+    {
+        throw std::runtime_error(fmt::format("Cannot create instance image: qemu-img failed ({}) with output:\n{}",
+                                             process_state.failure_message(),
+                                             qemuimg_create_process->read_all_standard_error()));
+    }
+
+    return overlay_path;
+}
+
+void mp::backend::compress_image(const mp::Path& image_path, const mp::Path& compressed_path)
+{
+    convert_compressed(image_path, {}, compressed_path, "compress");
+}
+
+void mp::backend::flatten_image(const mp::Path& image_path, const mp::Path& backing_image_path,
+                                const mp::Path& flat_path)
+{
+    // qemu-img convert reads through the whole backing chain, and writes out one image that needs none of it
+    convert_compressed(image_path, backing_image_path, flat_path, "flatten");
+}
+
+void mp::backend::create_image_snapshot(const mp::Path& image_path, const mp::Path& backing_image_path,
+                                        const QString& name)
+{
+    run_snapshot_command("-c", image_path, backing_image_path, name, "create");
+}
+
+// Going back to a snapshot only rewrites the image's metadata, not the data it holds
+void mp::backend::apply_image_snapshot(const mp::Path& image_path, const mp::Path& backing_image_path,
+                                       const QString& name)
+{
+    run_snapshot_command("-a", image_path, backing_image_path, name, "restore");
+}
+
+void mp::backend::delete_image_snapshot(const mp::Path& image_path, const mp::Path& backing_image_path,
+                                        const QString& name)
+{
+    run_snapshot_command("-d", image_path, backing_image_path, name, "delete");
+}
+
+bool mp::backend::is_qcow2_image(const mp::Path& image_path)
+{
+    QFile image_file{image_path};
+    return image_file.open(QIODevice::ReadOnly) && read_qcow2_header(image_file);
+}
+
+mp::optional<QStringList> mp::backend::qcow2_snapshot_names(const mp::Path& image_path)
+{
+    QFile image_file{image_path};
+    if (!image_file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    const auto header = read_qcow2_header(image_file);
+    if (!header)
+        return mp::nullopt;
+
+    QStringList names;
+    auto entry_offset = static_cast<qint64>(header->snapshots_offset);
+    QDataStream stream{&image_file};
+
+    for (quint32 i = 0; i < header->nb_snapshots; ++i)
+    {
+        // Skip the L1 table and VM state fields, only the sizes of the variable length fields matter here
+        quint16 id_size, name_size;
+        quint32 extra_data_size;
+        if (!image_file.seek(entry_offset + 12))
+            return mp::nullopt;
+        stream >> id_size >> name_size;
+
+        if (!image_file.seek(entry_offset + 36))
+            return mp::nullopt;
+        stream >> extra_data_size;
+
+        if (stream.status() != QDataStream::Ok ||
+            !image_file.seek(entry_offset + qcow2_snapshot_header_size + extra_data_size + id_size))
+            return mp::nullopt;
+
+        const auto name = image_file.read(name_size);
+        if (name.size() != name_size)
+            return mp::nullopt;
+        names.append(QString::fromUtf8(name));
+
+        // Each entry is padded to a multiple of 8 bytes
+        const auto entry_size = qcow2_snapshot_header_size + extra_data_size + id_size + name_size;
+        entry_offset += (entry_size + 7) & ~qint64{7};
+    }
+
+    return names;
+}
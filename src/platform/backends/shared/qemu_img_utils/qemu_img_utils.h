@@ -18,7 +18,12 @@
 #ifndef MULTIPASS_QEMU_IMG_UTILS_H
 #define MULTIPASS_QEMU_IMG_UTILS_H
 
+#include <multipass/optional.h>
 #include <multipass/path.h>
+#include <multipass/progress_monitor.h>
+
+#include <QDir>
+#include <QStringList>
 
 namespace multipass
 {
@@ -27,7 +32,19 @@ class MemorySize;
 namespace backend
 {
 void resize_instance_image(const MemorySize& disk_space, const multipass::Path& image_path);
-Path convert_to_qcow_if_necessary(const Path& image_path);
+Path convert_to_qcow_if_necessary(const Path& image_path, const ProgressMonitor& monitor = {});
+Path create_overlay_image(const Path& backing_image_path, const QDir& output_dir);
+void compress_image(const Path& image_path, const Path& compressed_path);
+void flatten_image(const Path& image_path, const Path& backing_image_path, const Path& flat_path);
+
+// Internal qcow2 snapshots, of an image that nothing has open
+void create_image_snapshot(const Path& image_path, const Path& backing_image_path, const QString& name);
+void apply_image_snapshot(const Path& image_path, const Path& backing_image_path, const QString& name);
+void delete_image_snapshot(const Path& image_path, const Path& backing_image_path, const QString& name);
+
+// These read the image header in-process, without spawning qemu-img
+bool is_qcow2_image(const Path& image_path);
+optional<QStringList> qcow2_snapshot_names(const Path& image_path); // nullopt if not a readable qcow2 image
 } // namespace backend
 } // namespace multipass
 #endif // MULTIPASS_QEMU_IMG_UTILS_H
@@ -21,6 +21,7 @@
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/utils.h>
 #include <multipass/virtual_machine.h>
+#include <multipass/vsock.h>
 
 #include <chrono>
 #include <string>
@@ -61,6 +62,43 @@ std::string ip_address_for(VirtualMachine* virtual_machine, Callable&& get_ip, s
     return virtual_machine->management_ip->as_string();
 }
 
+// Over vsock once the instance's SSH server answers there, which it does before its network is up; over its management
+// IP address until then, and for instances whose guest does not listen on vsock
+template <typename Callable>
+std::string ssh_hostname_for(VirtualMachine* virtual_machine, vsock::Endpoint& vsock, Callable&& get_ip,
+                             std::chrono::milliseconds timeout)
+{
+    if (!vsock.cid())
+        return ip_address_for(virtual_machine, std::forward<Callable>(get_ip), timeout);
+
+    std::string hostname;
+    auto action = [virtual_machine, &vsock, &get_ip, &hostname] {
+        virtual_machine->ensure_vm_is_running();
+        if (auto host = vsock.ssh_host(virtual_machine->ssh_port(), 100ms))
+        {
+            hostname = *host;
+            return utils::TimeoutAction::done;
+        }
+
+        if (!virtual_machine->management_ip)
+            virtual_machine->management_ip = get_ip();
+        if (!virtual_machine->management_ip)
+            return utils::TimeoutAction::retry;
+
+        hostname = virtual_machine->management_ip->as_string();
+        return utils::TimeoutAction::done;
+    };
+
+    auto on_timeout = [virtual_machine] {
+        virtual_machine->state = VirtualMachine::State::unknown;
+        throw std::runtime_error("failed to determine IP address");
+    };
+
+    utils::try_action_for(on_timeout, timeout, action);
+
+    return hostname;
+}
+
 template <typename Callable>
 void ensure_vm_is_running_for(VirtualMachine* virtual_machine, Callable&& is_vm_running, const std::string& msg)
 {
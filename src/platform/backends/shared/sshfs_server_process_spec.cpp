@@ -65,13 +65,16 @@ QStringList mp::SSHFSServerProcessSpec::arguments() const
                          << QString::fromStdString(config.username) << QString::fromStdString(config.source_path)
                          << QString::fromStdString(config.target_path) << serialise_id_mappings(config.uid_mappings)
                          << serialise_id_mappings(config.gid_mappings)
-                         << QString::number(static_cast<int>(mp::logging::get_logging_level()));
+                         << QString::number(static_cast<int>(mp::logging::get_logging_level()))
+                         << QString::number(config.attribute_cache_size) << QString::fromStdString(config.profile);
 }
 
 QProcessEnvironment mp::SSHFSServerProcessSpec::environment() const
 {
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("KEY", QString::fromStdString(config.private_key));
+    if (!config.instance_info.empty())
+        env.insert("SSHFS_INSTANCE_INFO", QString::fromStdString(config.instance_info));
     return env;
 }
 
@@ -105,6 +108,9 @@ profile %1 flags=(attach_disconnected) {
     # Allow multipassd send sshfs_server signals
     signal (receive) peer=%2,
 
+    # for instances reached over vsock rather than IP
+    network vsock stream,
+
     # sshfs gathers some info about system resources
     /sys/devices/system/node/ r,
     /sys/devices/system/node/node[0-9]*/meminfo r,
@@ -42,6 +42,7 @@
 #include "logger/journald_logger.h"
 #include "platform_linux_detail.h"
 #include "platform_shared.h"
+#include "shared/linux/netlink.h"
 #include "shared/linux/process_factory.h"
 #include "shared/sshfs_server_process_spec.h"
 #include <disabled_update_prompt.h>
@@ -53,6 +54,8 @@
 #include <QString>
 #include <QTextStream>
 
+#include <mutex>
+
 #include <errno.h>
 #include <linux/if_arp.h>
 #include <string.h>
@@ -241,7 +244,28 @@ std::string multipass::platform::detail::read_os_release()
 std::map<std::string, mp::NetworkInterfaceInfo> mp::platform::Platform::get_network_interfaces_info() const
 {
     static const auto sysfs = QDir{QStringLiteral("/sys/class/net")};
-    return detail::get_network_interfaces_from(sysfs);
+    static std::mutex mutex;
+    static mp::optional<unsigned long long> inventory_version;
+    static std::map<std::string, mp::NetworkInterfaceInfo> inventory;
+
+    // Taken before walking, so that a change during the walk leaves the inventory stale rather than wrong
+    const auto version = MP_NETLINK.links_version();
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (version && version == inventory_version)
+            return inventory;
+    }
+
+    auto ifaces_info = detail::get_network_interfaces_from(sysfs);
+
+    if (version)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        inventory = ifaces_info;
+        inventory_version = version;
+    }
+
+    return ifaces_info;
 }
 
 QString mp::platform::Platform::get_blueprints_url_override() const
@@ -434,6 +458,11 @@ std::unique_ptr<mp::Process> mp::platform::make_process(std::unique_ptr<mp::Proc
     return MP_PROCFACTORY.create_process(std::move(process_spec));
 }
 
+void mp::platform::update_resource_limits(const QString& cgroup, const mp::VMResourceLimits& limits)
+{
+    MP_PROCFACTORY.update_resource_limits(cgroup, limits);
+}
+
 mp::UpdatePrompt::UPtr mp::platform::make_update_prompt()
 {
     return std::make_unique<DisabledUpdatePrompt>();
@@ -19,6 +19,7 @@
 #include <multipass/platform_unix.h>
 #include <multipass/utils.h>
 
+#include <fcntl.h>
 #include <grp.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -147,6 +148,22 @@ int mp::platform::symlink_attr_from(const char* path, sftp_attributes_struct* at
     return 0;
 }
 
+int mp::platform::symlink_attr_from(int dir_fd, const char* name, sftp_attributes_struct* attr)
+{
+    struct stat st
+    {
+    };
+
+    auto ret = fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW);
+
+    if (ret < 0)
+        return ret;
+
+    *attr = stat_to_attr(&st);
+
+    return 0;
+}
+
 sigset_t mp::platform::make_sigset(const std::vector<int>& sigs)
 {
     sigset_t sigset;
@@ -39,7 +39,7 @@ mp::DefaultUpdatePrompt::~DefaultUpdatePrompt() = default;
 
 bool mp::DefaultUpdatePrompt::is_time_to_show()
 {
-    return monitor->get_new_release() && last_shown + ::notify_user_frequency < std::chrono::system_clock::now();
+    return monitor->get_new_release() && last_shown.load() + ::notify_user_frequency < std::chrono::system_clock::now();
 }
 
 void mp::DefaultUpdatePrompt::populate(mp::UpdateInfo* update_info)
@@ -19,6 +19,7 @@
 #define MULTIPASS_DEFAULT_UPDATE_PROMPT_H
 
 #include <multipass/update_prompt.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 
@@ -41,7 +42,7 @@ public:
 
 private:
     std::unique_ptr<NewReleaseMonitor> monitor;
-    std::chrono::system_clock::time_point last_shown;
+    std::atomic<std::chrono::system_clock::time_point> last_shown; // prompts may be populated from any thread
 };
 } // namespace multipass
 
@@ -117,6 +117,7 @@ mp::NewReleaseMonitor::~NewReleaseMonitor() = default;
 
 mp::optional<mp::NewReleaseInfo> mp::NewReleaseMonitor::get_new_release() const
 {
+    std::lock_guard<std::mutex> lock{new_release_mutex};
     return new_release;
 }
 
@@ -129,9 +130,12 @@ void mp::NewReleaseMonitor::latest_release_found(const NewReleaseInfo& latest_re
         if (version::Semver200_version(current_version.toStdString()) <
             version::Semver200_version(latest_release.version.toStdString()))
         {
-            new_release = latest_release;
+            {
+                std::lock_guard<std::mutex> lock{new_release_mutex};
+                new_release = latest_release;
+            }
             mpl::log(mpl::Level::info, "update",
-                     fmt::format("A New Multipass release is available: {}", qUtf8Printable(new_release->version)));
+                     fmt::format("A New Multipass release is available: {}", qUtf8Printable(latest_release.version)));
         }
     }
     catch (const version::Parse_error& e)
@@ -17,8 +17,11 @@
 
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/performance_counters.h>
 #include <multipass/process/basic_process.h>
 
+#include <QFileInfo>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -30,6 +33,12 @@ static auto reg = []() -> bool {
     qRegisterMetaType<QProcess::ProcessError>();
     return true;
 }();
+
+// Without the directory, which differs between snap and other installs
+mp::PerformanceCounters::Labels labels_for(const QString& program)
+{
+    return {{"program", QFileInfo{program}.fileName().toStdString()}};
+}
 } // namespace
 
 mp::BasicProcess::CustomQProcess::CustomQProcess(BasicProcess* p) : p{p}
@@ -56,10 +65,21 @@ mp::BasicProcess::BasicProcess(std::shared_ptr<mp::ProcessSpec> spec) : process_
                 {
                     process_state.error = mp::ProcessState::Error{process.error(), error_string()};
                 }
+
+                const auto labels = labels_for(process_spec->program());
+                MP_PERF_COUNTERS.observe("multipass_process_duration_seconds", labels,
+                                         std::chrono::steady_clock::now() - start_time);
+                if (!process_state.completed_successfully())
+                    ++MP_PERF_COUNTERS.counter("multipass_process_failures", labels);
+
                 emit mp::Process::finished(process_state);
             });
-    connect(&process, &QProcess::errorOccurred,
-            [this](QProcess::ProcessError error) { emit mp::Process::error_occurred(error, error_string()); });
+    connect(&process, &QProcess::errorOccurred, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) // otherwise, it finishes and is accounted for then
+            ++MP_PERF_COUNTERS.counter("multipass_process_failures", labels_for(process_spec->program()));
+
+        emit mp::Process::error_occurred(error, error_string());
+    });
     connect(&process, &QProcess::readyReadStandardOutput, this, &mp::Process::ready_read_standard_output);
     connect(&process, &QProcess::readyReadStandardError, this, &mp::Process::ready_read_standard_error);
     connect(&process, &QProcess::stateChanged, this, &mp::Process::state_changed);
@@ -111,6 +131,8 @@ qint64 mp::BasicProcess::process_id() const
 
 void mp::BasicProcess::start()
 {
+    ++MP_PERF_COUNTERS.counter("multipass_process_spawns", labels_for(process_spec->program()));
+    start_time = std::chrono::steady_clock::now();
     process.start();
 }
 
@@ -53,6 +53,18 @@ QString multipass::ProcessSpec::identifier() const
     return QString();
 }
 
+// The cgroup, among those of instances, for the process to run in; null to stay in the daemon's, as helpers do
+QString mp::ProcessSpec::cgroup() const
+{
+    return QString();
+}
+
+// What the cgroup above enforces
+mp::VMResourceLimits mp::ProcessSpec::resource_limits() const
+{
+    return VMResourceLimits{};
+}
+
 // String used to register this profile with AppArmor
 const QString mp::ProcessSpec::apparmor_profile_name() const
 {
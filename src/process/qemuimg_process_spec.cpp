@@ -23,8 +23,8 @@ namespace mp = multipass;
 namespace mu = multipass::utils;
 
 mp::QemuImgProcessSpec::QemuImgProcessSpec(const QStringList& args, const QString& source_image,
-                                           const QString& target_image)
-    : args{args}, source_image{source_image}, target_image{target_image}
+                                           const QString& target_image, const QStringList& backing_images)
+    : args{args}, source_image{source_image}, target_image{target_image}, backing_images{backing_images}
 {
 }
 
@@ -84,6 +84,9 @@ profile %1 flags=(attach_disconnected) {
     if (!source_image.isEmpty())
         images.append(QString("  %1 rk,\n").arg(source_image));
 
+    for (const auto& backing_image : backing_images)
+        images.append(QString("  %1 rk,\n").arg(backing_image));
+
     if (!target_image.isEmpty())
         images.append(QString("  %1 rwk,\n").arg(target_image));
 
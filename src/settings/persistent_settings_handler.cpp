@@ -21,6 +21,8 @@
 #include <multipass/file_ops.h>
 #include <multipass/settings/persistent_settings_handler.h>
 
+#include <QFileInfo>
+
 #include <cassert>
 
 namespace mp = multipass;
@@ -87,8 +89,31 @@ mp::PersistentSettingsHandler::PersistentSettingsHandler(QString filename, Setti
 QString mp::PersistentSettingsHandler::get(const QString& key) const
 {
     const auto& default_ret = get_setting(key).get_default(); // make sure the key is valid before reading from disk
+
+    // Checking that the file is the same is a stat, where reading it is an open and a parse
+    const QFileInfo file_info{filename};
+    const auto modified = file_info.lastModified();
+    const auto size = file_info.size();
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (modified != cached_modified || size != cached_size)
+        {
+            cache.clear();
+            cached_modified = modified;
+            cached_size = size;
+        }
+        else if (auto it = cache.find(key); it != cache.end())
+            return it->second;
+    }
+
     auto settings_file = persistent_settings(filename);
-    return checked_get(*settings_file, key, default_ret, mutex);
+    auto ret = checked_get(*settings_file, key, default_ret, mutex);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (modified == cached_modified && size == cached_size) // or it changed in the meantime and is read again next time
+        cache[key] = ret;
+
+    return ret;
 }
 
 auto mp::PersistentSettingsHandler::get_setting(const QString& key) const -> const SettingSpec&
@@ -110,6 +135,9 @@ void mp::PersistentSettingsHandler::set(const QString& key, const QString& val)
 
     auto settings_file = persistent_settings(filename);
     checked_set(*settings_file, key, interpreted, mutex);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    cache.clear(); // the file may well look the same, when written twice within its timestamps' resolution
 }
 
 std::set<QString> mp::PersistentSettingsHandler::keys() const
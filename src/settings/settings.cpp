@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace mp = multipass;
 
@@ -103,4 +104,29 @@ void mp::Settings::set(const QString& key, const QString& val)
 
     if (!success)
         throw UnrecognizedSettingException{key};
+
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock{subscriptions_mutex};
+        for (const auto& [subscription, subscriber] : subscriptions)
+            if (subscriber.first == key)
+                callbacks.push_back(subscriber.second);
+    }
+
+    for (const auto& callback : callbacks) // without the lock, for them to be free to read settings
+        callback();
+}
+
+auto mp::Settings::subscribe(const QString& key, std::function<void()> callback) -> Subscription
+{
+    std::lock_guard<std::mutex> lock{subscriptions_mutex};
+    subscriptions.emplace(next_subscription, std::make_pair(key, std::move(callback)));
+
+    return next_subscription++;
+}
+
+void mp::Settings::unsubscribe(Subscription subscription)
+{
+    std::lock_guard<std::mutex> lock{subscriptions_mutex};
+    subscriptions.erase(subscription);
 }
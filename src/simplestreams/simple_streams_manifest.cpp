@@ -28,6 +28,8 @@
 #include <multipass/settings/settings.h>
 #include <multipass/utils.h>
 
+#include <algorithm>
+
 namespace mp = multipass;
 
 namespace
@@ -61,6 +63,11 @@ QString latest_version_in(const QJsonObject& versions)
     return max_version;
 }
 
+bool id_less(const mp::VMImageInfo* info, const QString& id)
+{
+    return info->id < id;
+}
+
 QString derive_unpacked_file_path_prefix_from(const QString& image_location)
 {
     QFileInfo info{image_location};
@@ -91,59 +98,55 @@ std::unique_ptr<mp::SimpleStreamsManifest> mp::SimpleStreamsManifest::fromJson(c
     if (arch.isEmpty())
         throw mp::GenericManifestException("Unsupported cloud image architecture");
 
+    // Which items are of interest is settled once, rather than for each of the thousands of items in the catalog
+    // TODO: make this a VM factory call with a preference list
+    const auto lxd = MP_SETTINGS.get(mp::driver_key) == "lxd";
+    const auto item_key = lxd ? QStringLiteral("lxd.tar.xz") : QStringLiteral("disk1.img");
+
     std::vector<VMImageInfo> products;
     for (const auto& value : manifest_products)
     {
         const auto product = value.toObject();
 
-        if (product["arch"].toString() != arch)
+        if (product.value("arch").toString() != arch)
             continue;
 
-        const auto product_aliases = product["aliases"].toString().split(",");
-
-        const auto release = product["release"].toString();
-        const auto release_title = product["release_title"].toString();
-        const auto supported = product["supported"].toBool();
-
-        const auto versions = product["versions"].toObject();
+        const auto versions = product.value("versions").toObject();
         if (versions.isEmpty())
             continue;
 
+        const auto product_aliases = product.value("aliases").toString().split(",");
+
+        const auto release = product.value("release").toString();
+        const auto release_title = product.value("release_title").toString();
+        const auto supported = product.value("supported").toBool();
+
         const auto latest_version = latest_version_in(versions);
 
         for (auto it = versions.constBegin(); it != versions.constEnd(); ++it)
         {
-            const auto version_string = it.key();
-            const auto version = versions[version_string].toObject();
-            const auto items = version["items"].toObject();
+            const auto items = it.value().toObject().value("items").toObject();
             if (items.isEmpty())
                 continue;
 
-            const auto& driver = MP_SETTINGS.get(mp::driver_key);
-
-            QJsonObject image;
+            const auto image = items.value(item_key).toObject();
             QString sha256, image_location, kernel_location, initrd_location;
             int size = -1;
 
-            // TODO: make this a VM factory call with a preference list
-            if (driver == "lxd")
+            if (lxd)
             {
-                image = items["lxd.tar.xz"].toObject();
-
                 // Avoid kvm image due to canonical/multipass#2491
-                if (image.contains("combined_disk1-img_sha256"))
-                {
-                    sha256 = image["combined_disk1-img_sha256"].toString();
-                }
-                else
+                const auto combined_sha256 = image.value("combined_disk1-img_sha256");
+                if (combined_sha256.isUndefined())
                     continue;
+
+                sha256 = combined_sha256.toString();
             }
             else
             {
-                image = items["disk1.img"].toObject();
-                image_location = image["path"].toString();
-                sha256 = image["sha256"].toString();
-                size = image["size"].toInt(-1);
+                image_location = image.value("path").toString();
+                sha256 = image.value("sha256").toString();
+                size = image.value("size").toInt(-1);
 
                 // NOTE: These are not defined in the manifest itself
                 // so they are not guaranteed to be correct or exist in the server
@@ -153,6 +156,7 @@ std::unique_ptr<mp::SimpleStreamsManifest> mp::SimpleStreamsManifest::fromJson(c
             }
 
             // Aliases always alias to the latest version
+            const auto& version_string = it.key();
             const QStringList& aliases = version_string == latest_version ? product_aliases : QStringList();
             products.push_back({aliases, "Ubuntu", release, release_title, supported, image_location, kernel_location,
                                 initrd_location, sha256, host_url, version_string, size, true});
@@ -173,6 +177,30 @@ std::unique_ptr<mp::SimpleStreamsManifest> mp::SimpleStreamsManifest::fromJson(c
         }
     }
 
+    std::vector<const VMImageInfo*> by_id;
+    by_id.reserve(products.size());
+    for (const auto& product : products)
+        by_id.push_back(&product);
+
+    std::stable_sort(by_id.begin(), by_id.end(), [](const auto* a, const auto* b) { return a->id < b->id; });
+
     return std::unique_ptr<SimpleStreamsManifest>(
-        new SimpleStreamsManifest{updated, std::move(products), std::move(map)});
+        new SimpleStreamsManifest{updated, std::move(products), std::move(map), std::move(by_id)});
+}
+
+auto mp::SimpleStreamsManifest::product_with_id(const QString& id) const -> const VMImageInfo*
+{
+    auto it = std::lower_bound(products_by_id.cbegin(), products_by_id.cend(), id, id_less);
+    return it != products_by_id.cend() && (*it)->id == id ? *it : nullptr;
+}
+
+auto mp::SimpleStreamsManifest::products_with_id_prefix(const QString& prefix) const
+    -> std::vector<const VMImageInfo*>
+{
+    std::vector<const VMImageInfo*> matches;
+    for (auto it = std::lower_bound(products_by_id.cbegin(), products_by_id.cend(), prefix, id_less);
+         it != products_by_id.cend() && (*it)->id.startsWith(prefix); ++it)
+        matches.push_back(*it);
+
+    return matches;
 }
@@ -59,6 +59,18 @@ mp::OpenSSHKeyProvider::KeyUPtr get_priv_key(const QDir& key_dir)
     }
     return create_priv_key(priv_key_path);
 }
+
+std::string read_priv_key(const QDir& key_dir)
+{
+    QFile key_file{key_dir.filePath("id_rsa")};
+    auto opened = key_file.open(QIODevice::ReadOnly);
+    if (!opened)
+        throw std::runtime_error(fmt::format("Unable to open private key file '{}'", key_file.fileName()));
+
+    auto data = key_file.readAll();
+    auto data_size = static_cast<size_t>(data.length());
+    return {data.constData(), data_size};
+}
 } // namespace
 
 void mp::OpenSSHKeyProvider::KeyDeleter::operator()(ssh_key key)
@@ -67,20 +79,15 @@ void mp::OpenSSHKeyProvider::KeyDeleter::operator()(ssh_key key)
 }
 
 mp::OpenSSHKeyProvider::OpenSSHKeyProvider(const mp::Path& cache_dir)
-    : ssh_key_dir{mp::utils::make_dir(cache_dir, "ssh-keys")}, priv_key{get_priv_key(ssh_key_dir)}
+    : ssh_key_dir{mp::utils::make_dir(cache_dir, "ssh-keys")},
+      priv_key{get_priv_key(ssh_key_dir)},
+      priv_key_base64{read_priv_key(ssh_key_dir)}
 {
 }
 
 std::string mp::OpenSSHKeyProvider::private_key_as_base64() const
 {
-    QFile key_file{ssh_key_dir.filePath("id_rsa")};
-    auto opened = key_file.open(QIODevice::ReadOnly);
-    if (!opened)
-        throw std::runtime_error(fmt::format("Unable to open private key file '{}'", key_file.fileName()));
-
-    auto data = key_file.readAll();
-    auto data_size = static_cast<size_t>(data.length());
-    return {data.constData(), data_size};
+    return priv_key_base64;
 }
 
 std::string mp::OpenSSHKeyProvider::public_key_as_base64() const
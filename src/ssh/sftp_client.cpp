@@ -23,10 +23,16 @@
 
 #include <multipass/format.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
+#include <deque>
 #include <fcntl.h>
 
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDirIterator>
 #include <QFile>
 
 namespace mp = multipass;
@@ -35,10 +41,13 @@ namespace
 {
 // TODO: For push/pull, use actual file permissions
 constexpr int file_mode = 0664;
+constexpr int dir_mode = 0775;
 constexpr auto max_transfer = 65536u;
+constexpr auto max_pending_reads = 16u; // reads kept in flight while pulling, each of max_transfer bytes
 const std::string stream_file_name{"stream_output.dat"};
 
 using SFTPFileUPtr = std::unique_ptr<sftp_file_struct, int (*)(sftp_file)>;
+using SFTPDirUPtr = std::unique_ptr<sftp_dir_struct, int (*)(sftp_dir)>;
 using SFTPAttributesUPtr = std::unique_ptr<sftp_attributes_struct, void (*)(sftp_attributes)>;
 
 mp::SFTPSessionUPtr make_sftp_session(ssh_session session)
@@ -96,11 +105,66 @@ std::string full_destination(sftp_session sftp, const std::string& destination_p
 
     return destination_full_path;
 }
+
+std::string dir_name_for(const std::string& path)
+{
+    return mp::utils::filename_for(QDir::cleanPath(QString::fromStdString(path)).toStdString());
+}
+
+QString full_destination_dir(const std::string& destination_path, const std::string& source_path)
+{
+    const auto destination = QString::fromStdString(destination_path);
+    if (!QFileInfo::exists(destination))
+    {
+        return QFileInfo{destination}.dir().exists() ? destination
+                                                     : throw std::runtime_error{"[sftp] local target does not exist"};
+    }
+
+    if (!mp::utils::is_dir(destination_path))
+        throw std::runtime_error{
+            fmt::format("[sftp] cannot overwrite local non-directory '{}' with directory", destination_path)};
+
+    return QDir{destination}.filePath(QString::fromStdString(dir_name_for(source_path)));
+}
+
+std::string full_destination_dir(sftp_session sftp, const std::string& destination_path,
+                                 const std::string& source_path)
+{
+    const auto source_dir_name = dir_name_for(source_path);
+    if (destination_path.empty())
+        return source_dir_name;
+
+    SFTPAttributesUPtr destination_attr{sftp_stat(sftp, destination_path.c_str()), sftp_attributes_free};
+    if (!destination_attr)
+    {
+        const auto parent_path = QFileInfo{QString::fromStdString(destination_path)}.dir().path().toStdString();
+        destination_attr.reset(sftp_stat(sftp, parent_path.c_str()));
+        return destination_attr ? destination_path : throw mp::SSHException{"[sftp] remote target does not exist"};
+    }
+
+    if (destination_attr->type != SSH_FILEXFER_TYPE_DIRECTORY)
+        throw mp::SSHException{
+            fmt::format("[sftp] cannot overwrite remote non-directory '{}' with directory", destination_path)};
+
+    return fmt::format("{}/{}", destination_path, source_dir_name);
+}
+
+void make_remote_dir(sftp_session sftp, const std::string& path)
+{
+    if (sftp_mkdir(sftp, path.c_str(), dir_mode) == SSH_OK)
+        return;
+
+    // Servers do not agree on the error for a directory that is already there, so look for it instead
+    SFTPAttributesUPtr attr{sftp_stat(sftp, path.c_str()), sftp_attributes_free};
+    if (!attr || attr->type != SSH_FILEXFER_TYPE_DIRECTORY)
+        throw mp::SSHException{fmt::format("[sftp push] cannot create remote directory '{}'", path)};
+}
 } // namespace
 
 mp::SFTPClient::SFTPClient(const std::string& host, int port, const std::string& username,
-                           const std::string& priv_key_blob)
-    : SFTPClient{std::make_unique<mp::SSHSession>(host, port, username, mp::SSHClientKeyProvider(priv_key_blob))}
+                           const std::string& priv_key_blob, bool compression)
+    : SFTPClient{std::make_unique<mp::SSHSession>(host, port, username, mp::SSHClientKeyProvider(priv_key_blob),
+                                                  std::chrono::seconds(20), compression)}
 {
 }
 
@@ -112,7 +176,176 @@ mp::SFTPClient::SFTPClient(SSHSessionUPtr ssh_session)
 
 void mp::SFTPClient::push_file(const std::string& source_path, const std::string& destination_path)
 {
-    auto full_destination_path = full_destination(sftp.get(), destination_path, source_path);
+    push_file_to(source_path, full_destination(sftp.get(), destination_path, source_path));
+}
+
+void mp::SFTPClient::pull_file(const std::string& source_path, const std::string& destination_path)
+{
+    pull_file_to(source_path, full_destination(destination_path, source_path));
+}
+
+void mp::SFTPClient::push_dir(const std::string& source_path, const std::string& destination_path)
+{
+    const auto root = full_destination_dir(sftp.get(), destination_path, source_path);
+    const QDir source_dir{QString::fromStdString(source_path)};
+
+    std::vector<QString> dirs, files;
+    QDirIterator it{source_dir.path(), QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories};
+    while (it.hasNext())
+    {
+        it.next();
+        (it.fileInfo().isDir() ? dirs : files).push_back(source_dir.relativeFilePath(it.filePath()));
+    }
+
+    // The whole tree is created up front, parents sorting before their children, so files need no checks of their own
+    std::sort(dirs.begin(), dirs.end());
+    make_remote_dir(sftp.get(), root);
+    for (const auto& dir : dirs)
+        make_remote_dir(sftp.get(), fmt::format("{}/{}", root, dir));
+
+    for (const auto& file : files)
+        push_file_to(source_dir.filePath(file).toStdString(), fmt::format("{}/{}", root, file));
+}
+
+void mp::SFTPClient::pull_dir(const std::string& source_path, const std::string& destination_path)
+{
+    const auto root = full_destination_dir(destination_path, source_path);
+
+    std::vector<std::pair<std::string, QString>> pending_dirs{{source_path, root}};
+    while (!pending_dirs.empty())
+    {
+        const auto [remote_dir, local_dir] = std::move(pending_dirs.back());
+        pending_dirs.pop_back();
+
+        if (!QDir{}.mkpath(local_dir))
+            throw std::runtime_error{fmt::format("[sftp pull] cannot create local directory '{}'", local_dir)};
+
+        // The listing carries each entry's type, so no entry needs a stat of its own
+        for (const auto& [name, type] : list_dir(remote_dir))
+        {
+            auto remote_path = fmt::format("{}/{}", remote_dir, name);
+            auto local_path = QDir{local_dir}.filePath(QString::fromStdString(name));
+
+            if (type == SSH_FILEXFER_TYPE_DIRECTORY)
+                pending_dirs.emplace_back(std::move(remote_path), std::move(local_path));
+            else if (type == SSH_FILEXFER_TYPE_REGULAR)
+                pull_file_to(remote_path, local_path.toStdString());
+        }
+    }
+}
+
+bool mp::SFTPClient::is_dir(const std::string& path)
+{
+    SFTPAttributesUPtr attr{sftp_stat(sftp.get(), path.c_str()), sftp_attributes_free};
+    return attr && attr->type == SSH_FILEXFER_TYPE_DIRECTORY;
+}
+
+auto mp::SFTPClient::list_dir(const std::string& path) -> std::vector<std::pair<std::string, uint8_t>>
+{
+    SFTPDirUPtr dir{sftp_opendir(sftp.get(), path.c_str()), sftp_closedir};
+    if (!dir)
+        SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] opendir failed", sftp_get_error);
+
+    std::vector<std::pair<std::string, uint8_t>> entries;
+    while (true)
+    {
+        SFTPAttributesUPtr attr{sftp_readdir(sftp.get(), dir.get()), sftp_attributes_free};
+        if (!attr)
+            break;
+
+        std::string name{attr->name};
+        if (name != "." && name != "..")
+            entries.emplace_back(std::move(name), attr->type);
+    }
+
+    if (!sftp_dir_eof(dir.get()))
+        SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] readdir failed", sftp_get_error);
+
+    return entries;
+}
+
+void mp::SFTPClient::set_sync(bool sync)
+{
+    this->sync = sync;
+}
+
+void mp::SFTPClient::push_file_to(const std::string& source_path, const std::string& full_destination_path)
+{
+    if (!sync)
+        return send_file(source_path, full_destination_path);
+
+    const QFileInfo source_info{QString::fromStdString(source_path)};
+    SFTPAttributesUPtr destination_attr{sftp_stat(sftp.get(), full_destination_path.c_str()), sftp_attributes_free};
+    if (destination_attr && same_contents(source_info, *destination_attr, full_destination_path))
+    {
+        if (destination_attr->mtime == source_info.lastModified().toSecsSinceEpoch())
+            return;
+    }
+    else
+    {
+        send_file(source_path, full_destination_path);
+    }
+
+    // The destination takes the source's time, so that the next sync can tell them apart by metadata alone
+    std::array<timeval, 2> times{};
+    times[0].tv_sec = times[1].tv_sec = source_info.lastModified().toSecsSinceEpoch();
+    if (sftp_utimes(sftp.get(), full_destination_path.c_str(), times.data()) != SSH_OK)
+        SSH::throw_on_error(sftp, *ssh_session, "[sftp push] setting times failed", sftp_get_error);
+}
+
+void mp::SFTPClient::pull_file_to(const std::string& source_path, const std::string& full_destination_path)
+{
+    if (!sync)
+        return receive_file(source_path, full_destination_path);
+
+    SFTPAttributesUPtr source_attr{sftp_stat(sftp.get(), source_path.c_str()), sftp_attributes_free};
+    if (!source_attr)
+        SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] stat failed", sftp_get_error);
+
+    const QFileInfo destination_info{QString::fromStdString(full_destination_path)};
+    if (destination_info.exists() && same_contents(destination_info, *source_attr, source_path))
+    {
+        if (destination_info.lastModified().toSecsSinceEpoch() == source_attr->mtime)
+            return;
+    }
+    else
+    {
+        receive_file(source_path, full_destination_path);
+    }
+
+    QFile destination{destination_info.filePath()};
+    if (!destination.open(QIODevice::ReadWrite) ||
+        !destination.setFileTime(QDateTime::fromSecsSinceEpoch(source_attr->mtime), QFileDevice::FileModificationTime))
+        throw std::runtime_error(
+            fmt::format("[sftp pull] error setting file time: {}", destination.errorString()));
+}
+
+bool mp::SFTPClient::same_contents(const QFileInfo& local, const sftp_attributes_struct& remote,
+                                   const std::string& remote_path)
+{
+    if (remote.type != SSH_FILEXFER_TYPE_REGULAR || static_cast<qint64>(remote.size) != local.size())
+        return false;
+
+    if (remote.mtime == local.lastModified().toSecsSinceEpoch())
+        return true;
+
+    // Rebuilt files often come out identical, which a hash on either side tells without moving the data
+    auto process = ssh_session->exec(fmt::format("sha256sum -- {}", mp::utils::escape_for_shell(remote_path)));
+    const auto remote_hash = QString::fromStdString(process.read_std_output()).section(' ', 0, 0);
+    if (process.exit_code() != 0 || remote_hash.isEmpty())
+        return false;
+
+    QFile file{local.filePath()};
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file))
+        return false;
+
+    return remote_hash == hash.result().toHex();
+}
+
+void mp::SFTPClient::send_file(const std::string& source_path, const std::string& full_destination_path)
+{
     SFTPFileUPtr file_handle{
         sftp_open(sftp.get(), full_destination_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, file_mode), sftp_close};
     if (!file_handle)
@@ -138,9 +371,8 @@ void mp::SFTPClient::push_file(const std::string& source_path, const std::string
     }
 }
 
-void mp::SFTPClient::pull_file(const std::string& source_path, const std::string& destination_path)
+void mp::SFTPClient::receive_file(const std::string& source_path, const std::string& full_destination_path)
 {
-    auto full_destination_path = full_destination(destination_path, source_path);
     QFile destination(QString::fromStdString(full_destination_path));
     if (!destination.open(QIODevice::WriteOnly))
         throw std::runtime_error(
@@ -149,20 +381,54 @@ void mp::SFTPClient::pull_file(const std::string& source_path, const std::string
     SFTPFileUPtr file_handle{sftp_open(sftp.get(), source_path.c_str(), O_RDONLY, file_mode), sftp_close};
     SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] open failed", sftp_get_error);
 
+    auto read_failed = [this]() {
+        SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] read failed", sftp_get_error);
+        throw SSHException{"[sftp pull] read failed"};
+    };
+
+    // Several reads are kept in flight, so that the transfer is bound by bandwidth rather than by round trips
     std::array<char, max_transfer> data;
+    std::deque<uint32_t> pending_reads;
+    auto discard_pending_reads = [&file_handle, &data, &pending_reads]() {
+        for (const auto id : pending_reads)
+            sftp_async_read(file_handle.get(), data.data(), data.size(), id);
+        pending_reads.clear();
+    };
+
+    uint64_t received = 0;
     while (true)
     {
-        auto r = sftp_read(file_handle.get(), data.data(), data.size());
+        while (pending_reads.size() < max_pending_reads)
+        {
+            const auto id = sftp_async_read_begin(file_handle.get(), max_transfer);
+            if (id < 0)
+                read_failed();
+
+            pending_reads.push_back(static_cast<uint32_t>(id));
+        }
+
+        const auto r = sftp_async_read(file_handle.get(), data.data(), data.size(), pending_reads.front());
+        pending_reads.pop_front();
 
         if (r == 0)
             break;
 
         if (r < 0)
-            SSH::throw_on_error(sftp, *ssh_session, "[sftp pull] read failed", sftp_get_error);
+            read_failed();
 
         if (destination.write(data.data(), r) == -1)
             throw std::runtime_error(fmt::format("[sftp pull] error writing to file: {}", destination.errorString()));
+
+        received += r;
+        if (static_cast<uint32_t>(r) < max_transfer)
+        {
+            // The reads in flight asked for what follows a full chunk, so they are asked again from where this ended
+            discard_pending_reads();
+            sftp_seek64(file_handle.get(), received);
+        }
     }
+
+    discard_pending_reads();
 }
 
 void mp::SFTPClient::stream_file(const std::string& destination_path, std::istream& cin)
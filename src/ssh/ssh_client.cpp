@@ -21,10 +21,31 @@
 
 #include "ssh_client_key_provider.h"
 
+#include <cstdio>
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
 namespace mp = multipass;
 
 namespace
 {
+constexpr std::size_t bulk_buffer_size = 1024 * 1024;
+
+// Sessions already ask for TCP_NODELAY, keepalives are for idle shells not to be dropped by whatever is in between
+void enable_keepalive(ssh_session session)
+{
+    auto socket = ssh_get_fd(session);
+    if (socket == SSH_INVALID_SOCKET)
+        return;
+
+    int on = 1;
+    setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
 mp::SSHClient::ChannelUPtr make_channel(ssh_session session)
 {
     mp::SSHClient::ChannelUPtr channel{ssh_channel_new(session), ssh_channel_free};
@@ -33,6 +54,21 @@ mp::SSHClient::ChannelUPtr make_channel(ssh_session session)
 
     return channel;
 }
+
+std::string cmd_line_for(const std::vector<std::vector<std::string>>& args_list)
+{
+    std::string cmd_line;
+
+    if (args_list.size())
+    {
+        auto args_it = args_list.begin();
+        cmd_line = mp::utils::to_cmd(*args_it++, mp::utils::QuoteType::quote_every_arg);
+        for (; args_it != args_list.end(); ++args_it)
+            cmd_line += "&&" + mp::utils::to_cmd(*args_it, mp::utils::QuoteType::quote_every_arg);
+    }
+
+    return cmd_line;
+}
 } // namespace
 
 mp::SSHClient::SSHClient(const std::string& host, int port, const std::string& username,
@@ -47,6 +83,12 @@ mp::SSHClient::SSHClient(SSHSessionUPtr ssh_session, ConsoleCreator console_crea
       channel{make_channel(*this->ssh_session)},
       console{console_creator(channel.get())}
 {
+    enable_keepalive(*this->ssh_session);
+}
+
+void mp::SSHClient::set_output_mode(OutputMode mode)
+{
+    output_mode = mode;
 }
 
 void mp::SSHClient::connect()
@@ -61,23 +103,41 @@ int mp::SSHClient::exec(const std::vector<std::string>& args)
 
 int mp::SSHClient::exec(const std::vector<std::vector<std::string>>& args_list)
 {
-    std::string cmd_line;
+    return exec_string(cmd_line_for(args_list));
+}
 
-    if (args_list.size())
+int mp::SSHClient::exec(const std::vector<std::vector<std::string>>& args_list, const OutputHandler& handler)
+{
+    request_exec(cmd_line_for(args_list));
+
+    std::vector<char> buffer(16 * 1024);
+    auto forward = [this, &buffer, &handler](bool is_stderr, int timeout) {
+        auto num_bytes = ssh_channel_read_timeout(channel.get(), buffer.data(), buffer.size(), is_stderr, timeout);
+        if (num_bytes > 0)
+            handler(buffer.data(), num_bytes, is_stderr);
+        return num_bytes;
+    };
+
+    // Standard error is only peeked at in between, libssh keeps what arrives for it in the meantime
+    while (ssh_channel_is_open(channel.get()) && !ssh_channel_is_eof(channel.get()))
     {
-        auto args_it = args_list.begin();
-        cmd_line = utils::to_cmd(*args_it++, mp::utils::QuoteType::quote_every_arg);
-        for (; args_it != args_list.end(); ++args_it)
-            cmd_line += "&&" + utils::to_cmd(*args_it, mp::utils::QuoteType::quote_every_arg);
+        if (forward(false, 50) < 0 || forward(true, 0) < 0)
+            break;
     }
 
-    return exec_string(cmd_line);
+    while (forward(false, 0) > 0)
+        ;
+    while (forward(true, 0) > 0)
+        ;
+
+    return ssh_channel_get_exit_status(channel.get());
 }
 
 void mp::SSHClient::handle_ssh_events()
 {
     using ConnectorUPtr = std::unique_ptr<ssh_connector_struct, void (*)(ssh_connector)>;
     std::unique_ptr<ssh_event_struct, void (*)(ssh_event)> event{ssh_event_new(), ssh_event_free};
+    const auto bulk = output_mode == OutputMode::bulk;
 
     // stdin
     ConnectorUPtr connector_in{ssh_connector_new(*ssh_session), ssh_connector_free};
@@ -85,11 +145,14 @@ void mp::SSHClient::handle_ssh_events()
     ssh_connector_set_in_fd(connector_in.get(), fileno(stdin));
     ssh_event_add_connector(event.get(), connector_in.get());
 
-    // stdout
-    ConnectorUPtr connector_out{ssh_connector_new(*ssh_session), ssh_connector_free};
-    ssh_connector_set_out_fd(connector_out.get(), fileno(stdout));
-    ssh_connector_set_in_channel(connector_out.get(), channel.get(), SSH_CONNECTOR_STDOUT);
-    ssh_event_add_connector(event.get(), connector_out.get());
+    // stdout, which is read here instead when in bulk
+    ConnectorUPtr connector_out{bulk ? nullptr : ssh_connector_new(*ssh_session), ssh_connector_free};
+    if (connector_out)
+    {
+        ssh_connector_set_out_fd(connector_out.get(), fileno(stdout));
+        ssh_connector_set_in_channel(connector_out.get(), channel.get(), SSH_CONNECTOR_STDOUT);
+        ssh_event_add_connector(event.get(), connector_out.get());
+    }
 
     // stderr
     ConnectorUPtr connector_err{ssh_connector_new(*ssh_session), ssh_connector_free};
@@ -97,24 +160,54 @@ void mp::SSHClient::handle_ssh_events()
     ssh_connector_set_in_channel(connector_err.get(), channel.get(), SSH_CONNECTOR_STDERR);
     ssh_event_add_connector(event.get(), connector_err.get());
 
+    // Everything that has arrived goes out in as few writes as the buffer allows
+    std::vector<char> buffer(bulk ? bulk_buffer_size : 0);
+    auto flush_stdout = [this, &buffer] {
+        std::size_t filled = 0;
+        int num_bytes;
+        while ((num_bytes = ssh_channel_read_timeout(channel.get(), buffer.data() + filled, buffer.size() - filled,
+                                                     0, 0)) > 0)
+        {
+            filled += num_bytes;
+            if (filled == buffer.size())
+            {
+                std::fwrite(buffer.data(), 1, filled, stdout);
+                filled = 0;
+            }
+        }
+
+        std::fwrite(buffer.data(), 1, filled, stdout);
+        std::fflush(stdout);
+    };
+
     while (ssh_channel_is_open(channel.get()) && !ssh_channel_is_eof(channel.get()))
     {
         ssh_event_dopoll(event.get(), 60000);
+        if (bulk)
+            flush_stdout();
     }
 
+    if (bulk)
+        flush_stdout();
+    else
+        ssh_event_remove_connector(event.get(), connector_out.get());
+
     ssh_event_remove_connector(event.get(), connector_in.get());
-    ssh_event_remove_connector(event.get(), connector_out.get());
     ssh_event_remove_connector(event.get(), connector_err.get());
 }
 
-int mp::SSHClient::exec_string(const std::string& cmd_line)
+void mp::SSHClient::request_exec(const std::string& cmd_line)
 {
     if (cmd_line.empty())
         SSH::throw_on_error(channel, *ssh_session, "[ssh client] shell request failed", ssh_channel_request_shell);
     else
         SSH::throw_on_error(channel, *ssh_session, "[ssh client] exec request failed", ssh_channel_request_exec,
                             cmd_line.c_str());
+}
 
+int mp::SSHClient::exec_string(const std::string& cmd_line)
+{
+    request_exec(cmd_line);
     handle_ssh_events();
 
     return ssh_channel_get_exit_status(channel.get());
@@ -24,9 +24,6 @@
 
 #include <libssh/callbacks.h>
 
-#include <array>
-#include <sstream>
-
 #include <cerrno>
 #include <cstring>
 
@@ -36,6 +33,7 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "ssh process";
+constexpr std::size_t read_buffer_size = 64 * 1024; // the most a libssh channel window hands over at once
 
 class ExitStatusCallback
 {
@@ -104,53 +102,66 @@ int mp::SSHProcess::exit_code(std::chrono::milliseconds timeout)
 
 std::string mp::SSHProcess::read_std_output()
 {
-    return read_stream(StreamType::out);
+    std::string output;
+    read_std_output([&output](const char* data, std::size_t size) { output.append(data, size); });
+    return output;
 }
 
 std::string mp::SSHProcess::read_std_error()
 {
-    return read_stream(StreamType::err);
+    std::string output;
+    read_std_error([&output](const char* data, std::size_t size) { output.append(data, size); });
+    return output;
 }
 
-std::string mp::SSHProcess::read_stream(StreamType type, int timeout)
+void mp::SSHProcess::read_std_output(const ChunkHandler& handler)
+{
+    read_stream(StreamType::out, handler);
+}
+
+void mp::SSHProcess::read_std_error(const ChunkHandler& handler)
+{
+    read_stream(StreamType::err, handler);
+}
+
+void mp::SSHProcess::read_stream(StreamType type, const ChunkHandler& handler, int timeout)
 {
-    mpl::log(mpl::Level::debug, category,
-             fmt::format("{}:{} {}(type = {}, timeout = {}): ", __FILE__, __LINE__, __FUNCTION__,
-                         static_cast<int>(type), timeout));
     // If the channel is closed there's no output to read
     if (ssh_channel_is_closed(channel.get()))
     {
-        mpl::log(mpl::Level::debug, category,
-                 fmt::format("{}:{} {}(): channel closed", __FILE__, __LINE__, __FUNCTION__));
-        return std::string();
+        mpl::log(mpl::Level::debug, category, fmt::format("'{}': channel closed before reading", cmd));
+        return;
     }
 
-    std::stringstream output;
-    std::array<char, 256> buffer;
+    read_buffer.resize(read_buffer_size);
+
+    std::size_t total{0};
     int num_bytes{0};
     const bool is_std_err = type == StreamType::err;
     do
     {
-        num_bytes = ssh_channel_read_timeout(channel.get(), buffer.data(), buffer.size(), is_std_err, timeout);
-        mpl::log(mpl::Level::debug, category,
-                 fmt::format("{}:{} {}(): num_bytes = {}", __FILE__, __LINE__, __FUNCTION__, num_bytes));
+        num_bytes =
+            ssh_channel_read_timeout(channel.get(), read_buffer.data(), read_buffer.size(), is_std_err, timeout);
         if (num_bytes < 0)
         {
             // Latest libssh now returns an error if the channel has been closed instead of returning 0 bytes
             if (ssh_channel_is_closed(channel.get()))
-            {
-                mpl::log(mpl::Level::debug, category,
-                         fmt::format("{}:{} {}(): channel closed", __FILE__, __LINE__, __FUNCTION__));
-                return output.str();
-            }
+                break;
 
             throw mp::SSHException(
                 fmt::format("error while reading ssh channel for remote process '{}' - error: {}", cmd, num_bytes));
         }
-        output.write(buffer.data(), num_bytes);
+
+        if (num_bytes > 0)
+        {
+            handler(read_buffer.data(), num_bytes);
+            total += num_bytes;
+        }
     } while (num_bytes > 0);
 
-    return output.str();
+    // Once per stream rather than once per read, which made large outputs cost a log line every few hundred bytes
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("'{}': read {} bytes from std{}", cmd, total, is_std_err ? "err" : "out"));
 }
 
 ssh_channel mp::SSHProcess::release_channel()
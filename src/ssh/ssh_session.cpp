@@ -22,20 +22,128 @@
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/ssh/throw_on_error.h>
 #include <multipass/standard_paths.h>
+#include <multipass/tracing.h>
+#include <multipass/vsock.h>
 
 #include <libssh/callbacks.h>
 
 #include <QDir>
 
+#include <sstream>
 #include <string>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__linux__) && defined(__aarch64__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
+namespace
+{
+constexpr auto category = "ssh session";
+constexpr auto batch_marker = "MULTIPASS_BATCH";
+
+// Either end tolerates what its libssh does not know, as long as one of the algorithms is left
+constexpr auto gcm_ciphers = "aes128-gcm@openssh.com,aes256-gcm@openssh.com";
+constexpr auto chacha_cipher = "chacha20-poly1305@openssh.com";
+constexpr auto fallback_cipher = "aes256-ctr";
+constexpr auto key_exchanges = "curve25519-sha256,curve25519-sha256@libssh.org,ecdh-sha2-nistp256,"
+                               "diffie-hellman-group14-sha256,diffie-hellman-group14-sha1";
+
+bool has_aes_instructions()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 25);
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("aes");
+#elif defined(__APPLE__) && defined(__aarch64__)
+    return true; // every Apple Silicon chip has them
+#elif defined(__linux__) && defined(__aarch64__)
+    return getauxval(AT_HWCAP) & HWCAP_AES;
+#else
+    return false;
+#endif
+}
+
+// AES-GCM is the fastest there is with hardware support, chacha20-poly1305 is the fastest without it
+std::string preferred_ciphers()
+{
+    if (auto ciphers = qgetenv("MULTIPASS_SSH_CIPHERS"); !ciphers.isEmpty())
+        return ciphers.toStdString();
+
+    static const auto ciphers = has_aes_instructions()
+                                    ? fmt::format("{},{},{}", gcm_ciphers, chacha_cipher, fallback_cipher)
+                                    : fmt::format("{},{},{}", chacha_cipher, gcm_ciphers, fallback_cipher);
+    return ciphers;
+}
+
+std::string preferred_key_exchanges()
+{
+    if (auto kex = qgetenv("MULTIPASS_SSH_KEX"); !kex.isEmpty())
+        return kex.toStdString();
+
+    return key_exchanges;
+}
+
+// Each command's output is framed by a header with its exit code and the sizes of what it wrote, so that nothing it
+// prints can be mistaken for the framing
+std::string batch_script_for(const std::vector<std::string>& cmds)
+{
+    std::string script{"t=$(mktemp -d) || exit 1\n"};
+    for (const auto& cmd : cmds)
+        script += fmt::format("(\n{}\n) >\"$t/o\" 2>\"$t/e\" </dev/null; c=$?; "
+                              "printf '{} %d %d %d\\n' $c $(wc -c <\"$t/o\") $(wc -c <\"$t/e\"); "
+                              "cat \"$t/o\" \"$t/e\"\n",
+                              cmd, batch_marker);
+    script += "rm -rf \"$t\"\n";
+
+    return script;
+}
+
+std::vector<mp::SSHSession::CommandResult> parse_batch_output(const std::string& output, std::size_t expected)
+{
+    std::vector<mp::SSHSession::CommandResult> results;
+    std::string::size_type pos{0};
+
+    while (results.size() < expected)
+    {
+        const auto end_of_header = output.find('\n', pos);
+        if (end_of_header == std::string::npos)
+            break;
+
+        std::istringstream header{output.substr(pos, end_of_header - pos)};
+        std::string marker;
+        int exit_code;
+        std::size_t out_size, err_size;
+        if (!(header >> marker >> exit_code >> out_size >> err_size) || marker != batch_marker ||
+            output.size() - end_of_header - 1 < out_size + err_size)
+            break;
+
+        pos = end_of_header + 1;
+        results.push_back({exit_code, output.substr(pos, out_size), output.substr(pos + out_size, err_size)});
+        pos += out_size + err_size;
+    }
+
+    if (results.size() != expected)
+        throw mp::SSHException(fmt::format("unexpected output from a batch of commands: {} of {} results read",
+                                           results.size(), expected));
+
+    return results;
+}
+} // namespace
+
 mp::SSHSession::SSHSession(const std::string& host, int port, const std::string& username,
-                           const SSHKeyProvider* key_provider, const std::chrono::milliseconds timeout)
+                           const SSHKeyProvider* key_provider, const std::chrono::milliseconds timeout,
+                           bool compression)
     : session{ssh_new(), ssh_free}
 {
+    mp::tracing::Span span{"ssh", "handshake"}; // one per attempt, for retries to show
     if (session == nullptr)
         throw mp::SSHException("could not allocate ssh session");
 
@@ -48,11 +156,31 @@ mp::SSHSession::SSHSession(const std::string& host, int port, const std::string&
     set_option(SSH_OPTIONS_USER, username.c_str());
     set_option(SSH_OPTIONS_TIMEOUT, &timeout_secs);
     set_option(SSH_OPTIONS_NODELAY, &nodelay);
-    set_option(SSH_OPTIONS_CIPHERS_C_S, "chacha20-poly1305@openssh.com,aes256-ctr");
-    set_option(SSH_OPTIONS_CIPHERS_S_C, "chacha20-poly1305@openssh.com,aes256-ctr");
+    const auto ciphers = preferred_ciphers();
+    set_option(SSH_OPTIONS_CIPHERS_C_S, ciphers.c_str());
+    set_option(SSH_OPTIONS_CIPHERS_S_C, ciphers.c_str());
+    set_option(SSH_OPTIONS_KEY_EXCHANGE, preferred_key_exchanges().c_str());
     set_option(SSH_OPTIONS_SSH_DIR, ssh_dir.c_str());
+    set_option(SSH_OPTIONS_COMPRESSION, compression ? "yes" : "no");
+
+    // Instances reached over vsock are connected to here, for libssh to carry on over that socket, which it then owns
+    if (const auto cid = vsock::cid_in(host))
+    {
+        socket_t fd;
+        try
+        {
+            fd = vsock::connect(*cid, port, timeout);
+        }
+        catch (const std::runtime_error& e)
+        {
+            throw mp::SSHException(fmt::format("ssh connection failed: {}", e.what()));
+        }
+        set_option(SSH_OPTIONS_FD, &fd);
+    }
 
     SSH::throw_on_error(session, "ssh connection failed", ssh_connect);
+    mpl::log(mpl::Level::debug, category, fmt::format("Connected to {}:{} with {}", host, port, negotiated_cipher()));
+
     if (key_provider)
     {
         SSH::throw_on_error(session, "ssh failed to authenticate", ssh_userauth_publickey, nullptr,
@@ -61,8 +189,9 @@ mp::SSHSession::SSHSession(const std::string& host, int port, const std::string&
 }
 
 mp::SSHSession::SSHSession(const std::string& host, int port, const std::string& username,
-                           const SSHKeyProvider& key_provider, const std::chrono::milliseconds timeout)
-    : SSHSession(host, port, username, &key_provider, timeout)
+                           const SSHKeyProvider& key_provider, const std::chrono::milliseconds timeout,
+                           bool compression)
+    : SSHSession(host, port, username, &key_provider, timeout, compression)
 {
 }
 
@@ -73,10 +202,35 @@ mp::SSHSession::SSHSession(const std::string& host, int port, const std::chrono:
 
 mp::SSHProcess mp::SSHSession::exec(const std::string& cmd)
 {
-    mpl::log(mpl::Level::debug, "ssh session", fmt::format("Executing '{}'", cmd));
+    mpl::log(mpl::Level::debug, category, fmt::format("Executing '{}'", cmd));
     return {session.get(), cmd};
 }
 
+std::vector<mp::SSHSession::CommandResult> mp::SSHSession::exec_batch(const std::vector<std::string>& cmds,
+                                                                      std::chrono::milliseconds timeout)
+{
+    if (cmds.empty())
+        return {};
+
+    auto proc = exec(batch_script_for(cmds));
+
+    // Reading first keeps the remote end from stalling on a full channel window
+    std::string output;
+    proc.read_std_output([&output](const char* data, std::size_t size) { output.append(data, size); });
+
+    if (auto exit_code = proc.exit_code(timeout); exit_code != 0)
+        throw mp::SSHException(fmt::format("could not run a batch of commands, exit code {}: {}", exit_code,
+                                           proc.read_std_error()));
+
+    return parse_batch_output(output, cmds.size());
+}
+
+std::string mp::SSHSession::negotiated_cipher() const
+{
+    auto cipher = ssh_get_cipher_out(session.get());
+    return cipher ? cipher : "";
+}
+
 void mp::SSHSession::force_shutdown()
 {
     auto socket = ssh_get_fd(session.get());
@@ -110,8 +264,14 @@ const char* name_for(ssh_options_e type)
         return "client to server ciphers";
     case SSH_OPTIONS_CIPHERS_S_C:
         return "server to client ciphers";
+    case SSH_OPTIONS_KEY_EXCHANGE:
+        return "key exchange algorithms";
     case SSH_OPTIONS_SSH_DIR:
         return "ssh config directory";
+    case SSH_OPTIONS_COMPRESSION:
+        return "compression";
+    case SSH_OPTIONS_FD:
+        return "socket";
     default:
         break;
     }
@@ -126,6 +286,7 @@ std::string as_string(ssh_options_e type, const void* value)
     case SSH_OPTIONS_USER:
     case SSH_OPTIONS_CIPHERS_C_S:
     case SSH_OPTIONS_CIPHERS_S_C:
+    case SSH_OPTIONS_KEY_EXCHANGE:
     case SSH_OPTIONS_SSH_DIR:
         return std::string(reinterpret_cast<const char*>(value));
     case SSH_OPTIONS_PORT:
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/ssh/ssh_session_pool.h>
+
+#include <libssh/libssh.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "ssh session pool";
+
+std::string endpoint_for(const std::string& host, int port, const std::string& username)
+{
+    return fmt::format("{}@{}:{}", username, host, port);
+}
+
+bool is_healthy(const mp::SSHSession& session)
+{
+    return ssh_is_connected(session) != 0;
+}
+} // namespace
+
+mp::SSHSessionPool::Lease::Lease(SSHSessionPool* pool, std::string instance, std::string endpoint, unsigned generation,
+                                 std::unique_ptr<SSHSession> session)
+    : pool{pool},
+      instance{std::move(instance)},
+      endpoint{std::move(endpoint)},
+      generation{generation},
+      session{std::move(session)}
+{
+}
+
+mp::SSHSessionPool::Lease::Lease(Lease&& other) noexcept
+    : pool{other.pool},
+      instance{std::move(other.instance)},
+      endpoint{std::move(other.endpoint)},
+      generation{other.generation},
+      session{std::move(other.session)}
+{
+}
+
+mp::SSHSessionPool::Lease::~Lease()
+{
+    if (session && is_healthy(*session))
+        pool->put_back(instance, std::move(endpoint), generation, std::move(session));
+}
+
+mp::SSHSession& mp::SSHSessionPool::Lease::operator*() const
+{
+    return *session;
+}
+
+mp::SSHSession* mp::SSHSessionPool::Lease::operator->() const
+{
+    return session.get();
+}
+
+mp::SSHSession mp::SSHSessionPool::Lease::take()
+{
+    auto taken = std::move(session);
+    return std::move(*taken);
+}
+
+mp::SSHSessionPool::SSHSessionPool(const SSHKeyProvider& key_provider, std::chrono::seconds max_idle_time,
+                                   std::size_t max_idle_per_instance)
+    : key_provider{key_provider}, max_idle_time{max_idle_time}, max_idle_per_instance{max_idle_per_instance}
+{
+}
+
+mp::SSHSessionPool::Lease mp::SSHSessionPool::acquire(const std::string& instance, const std::string& host, int port,
+                                                      const std::string& username)
+{
+    auto endpoint = endpoint_for(host, port, username);
+    unsigned generation;
+    std::unique_ptr<SSHSession> reused;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        generation = generations[instance];
+
+        auto& idle = idle_sessions[instance];
+        const auto now = std::chrono::steady_clock::now();
+        while (!idle.empty() && !reused)
+        {
+            auto candidate = std::move(idle.back());
+            idle.pop_back();
+
+            // The instance may have changed address, or its sshd may have given up on us
+            if (candidate.endpoint == endpoint && now - candidate.since < max_idle_time &&
+                is_healthy(*candidate.session))
+                reused = std::move(candidate.session);
+        }
+    }
+
+    if (reused)
+        return {this, instance, std::move(endpoint), generation, std::move(reused)};
+
+    mpl::log(mpl::Level::trace, category, fmt::format("opening a session to {} for \"{}\"", endpoint, instance));
+    return {this, instance, std::move(endpoint), generation,
+            std::make_unique<SSHSession>(host, port, username, key_provider)}; // connecting happens outside the lock
+}
+
+void mp::SSHSessionPool::evict(const std::string& instance)
+{
+    std::vector<IdleSession> evicted;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        ++generations[instance];
+
+        auto it = idle_sessions.find(instance);
+        if (it != idle_sessions.end())
+        {
+            evicted = std::move(it->second);
+            idle_sessions.erase(it);
+        }
+    }
+}
+
+void mp::SSHSessionPool::put_back(const std::string& instance, std::string endpoint, unsigned generation,
+                                  std::unique_ptr<SSHSession> session)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    if (generations[instance] != generation)
+        return; // the instance changed in the meantime
+
+    auto& idle = idle_sessions[instance];
+    if (idle.size() < max_idle_per_instance)
+        idle.push_back({std::move(endpoint), std::move(session), std::chrono::steady_clock::now()});
+}
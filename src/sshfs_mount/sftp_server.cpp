@@ -22,14 +22,33 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/optional.h>
 #include <multipass/platform.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/ssh/throw_on_error.h>
+#include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
 
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QStorageInfo>
+#include <QtConcurrent/QtConcurrent>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <thread>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -37,9 +56,46 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "sftp server";
+constexpr auto busy_wait_interval = std::chrono::milliseconds{10}; // at most, while workers are busy
+constexpr auto idle_poll_interval = 100; // ms
+constexpr auto max_batched_reads = 16u;
+constexpr auto sequential_reads_threshold = 3;        // before a handle is taken to be read through
+constexpr qint64 read_ahead_window = 4 * 1024 * 1024; // kept in the page cache ahead of sequential readers
 using SftpHandleUPtr = std::unique_ptr<ssh_string_struct, void (*)(ssh_string)>;
 using namespace std::literals::chrono_literals;
 
+// Set on worker threads, whose replies need to take turns on the session with the reading thread
+struct ReplyGuard
+{
+    std::mutex* session_mutex{nullptr};
+    std::condition_variable* session_released{nullptr};
+    std::atomic_int* replies_waiting{nullptr};
+};
+thread_local ReplyGuard reply_guard;
+
+template <typename Fun, typename... Args>
+int serialized(Fun&& f, Args&&... args)
+{
+    if (!reply_guard.session_mutex)
+        return f(std::forward<Args>(args)...);
+
+    ++*reply_guard.replies_waiting;
+    std::unique_lock<std::mutex> lock{*reply_guard.session_mutex};
+    --*reply_guard.replies_waiting;
+
+    const auto ret = f(std::forward<Args>(args)...);
+    lock.unlock();
+    reply_guard.session_released->notify_all();
+
+    return ret;
+}
+
+// Path based queries, which have no ordering constraints with respect to the requests on handles
+bool runs_concurrently(uint8_t type)
+{
+    return type == SFTP_STAT || type == SFTP_LSTAT || type == SFTP_READLINK || type == SFTP_REALPATH;
+}
+
 enum Permissions
 {
     read_user = 0400,
@@ -62,27 +118,27 @@ auto make_sftp_session(ssh_session session, ssh_channel channel)
 
 int reply_ok(sftp_client_message msg)
 {
-    return sftp_reply_status(msg, SSH_FX_OK, nullptr);
+    return serialized(sftp_reply_status, msg, SSH_FX_OK, nullptr);
 }
 
 int reply_failure(sftp_client_message msg)
 {
-    return sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+    return serialized(sftp_reply_status, msg, SSH_FX_FAILURE, nullptr);
 }
 
 int reply_perm_denied(sftp_client_message msg)
 {
-    return sftp_reply_status(msg, SSH_FX_PERMISSION_DENIED, "permission denied");
+    return serialized(sftp_reply_status, msg, SSH_FX_PERMISSION_DENIED, "permission denied");
 }
 
 int reply_bad_handle(sftp_client_message msg, const char* type)
 {
-    return sftp_reply_status(msg, SSH_FX_BAD_MESSAGE, fmt::format("{}: invalid handle", type).c_str());
+    return serialized(sftp_reply_status, msg, SSH_FX_BAD_MESSAGE, fmt::format("{}: invalid handle", type).c_str());
 }
 
 int reply_unsupported(sftp_client_message msg)
 {
-    return sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, "Unsupported message");
+    return serialized(sftp_reply_status, msg, SSH_FX_OP_UNSUPPORTED, "Unsupported message");
 }
 
 fmt::memory_buffer& operator<<(fmt::memory_buffer& buf, const char* v)
@@ -91,72 +147,72 @@ fmt::memory_buffer& operator<<(fmt::memory_buffer& buf, const char* v)
     return buf;
 }
 
-auto longname_from(const QFileInfo& file_info, const std::string& filename)
+auto longname_from(const sftp_attributes_struct& attr, const std::string& filename)
 {
     fmt::memory_buffer out;
-    auto mode = file_info.permissions();
+    auto mode = attr.permissions;
 
-    if (file_info.isSymLink())
+    if ((mode & SSH_S_IFMT) == SSH_S_IFLNK)
         out << "l";
-    else if (file_info.isDir())
+    else if ((mode & SSH_S_IFMT) == SSH_S_IFDIR)
         out << "d";
     else
         out << "-";
 
     /* user */
-    if (mode & QFileDevice::ReadOwner)
+    if (mode & S_IRUSR)
         out << "r";
     else
         out << "-";
 
-    if (mode & QFileDevice::WriteOwner)
+    if (mode & S_IWUSR)
         out << "w";
     else
         out << "-";
 
-    if (mode & QFileDevice::ExeOwner)
+    if (mode & S_IXUSR)
         out << "x";
     else
         out << "-";
 
     /*group*/
-    if (mode & QFileDevice::ReadGroup)
+    if (mode & S_IRGRP)
         out << "r";
     else
         out << "-";
 
-    if (mode & QFileDevice::WriteGroup)
+    if (mode & S_IWGRP)
         out << "w";
     else
         out << "-";
 
-    if (mode & QFileDevice::ExeGroup)
+    if (mode & S_IXGRP)
         out << "x";
     else
         out << "-";
 
     /* other */
-    if (mode & QFileDevice::ReadOther)
+    if (mode & S_IROTH)
         out << "r";
     else
         out << "-";
 
-    if (mode & QFileDevice::WriteOther)
+    if (mode & S_IWOTH)
         out << "w";
     else
         out << "-";
 
-    if (mode & QFileDevice::ExeOther)
+    if (mode & S_IXOTH)
         out << "x";
     else
         out << "-";
 
-    fmt::format_to(out, " 1 {} {} {}", file_info.ownerId(), file_info.groupId(), file_info.size());
+    fmt::format_to(out, " 1 {} {} {}", attr.uid, attr.gid, attr.size);
 
-    const auto timestamp = file_info.lastModified().toString("MMM d hh:mm:ss yyyy").toStdString();
+    const auto timestamp = QDateTime::fromSecsSinceEpoch(attr.mtime).toString("MMM d hh:mm:ss yyyy").toStdString();
     fmt::format_to(out, " {} {}", timestamp, filename);
 
-    return out;
+    return fmt::to_string(out);
 }
 
 auto to_qt_permissions(uint32_t perms)
@@ -229,6 +285,116 @@ auto handle_from(sftp_client_message msg, const std::unordered_map<void*, std::u
     return nullptr;
 }
 
+// For extended requests, whose handles libssh leaves as they came
+template <typename T>
+auto handle_from(sftp_session sftp, const std::string& handle,
+                 const std::unordered_map<void*, std::unique_ptr<T>>& handles) -> T*
+{
+    SftpHandleUPtr string{ssh_string_new(handle.size()), ssh_string_free};
+    if (!string || ssh_string_fill(string.get(), handle.data(), handle.size()) != 0)
+        return nullptr;
+
+    auto entry = handles.find(sftp_handle(sftp, string.get()));
+    if (entry != handles.end())
+        return entry->second.get();
+    return nullptr;
+}
+
+// The fields of extended requests that libssh does not parse, read from the copy of the packet that it keeps
+class ExtendedFields
+{
+public:
+    explicit ExtendedFields(sftp_client_message msg)
+    {
+        if (msg->complete_message)
+        {
+            data = static_cast<const unsigned char*>(ssh_buffer_get(msg->complete_message));
+            left = ssh_buffer_get_len(msg->complete_message);
+        }
+
+        // past the request id and the name of the extension
+        take(4);
+        string();
+    }
+
+    mp::optional<uint64_t> u64()
+    {
+        auto bytes = take(8);
+        if (!bytes)
+            return mp::nullopt;
+
+        uint64_t value = 0;
+        for (auto i = 0; i < 8; ++i)
+            value = value << 8 | bytes[i];
+        return value;
+    }
+
+    mp::optional<std::string> string()
+    {
+        auto length_bytes = take(4);
+        if (!length_bytes)
+            return mp::nullopt;
+
+        const auto length = uint32_t{length_bytes[0]} << 24 | uint32_t{length_bytes[1]} << 16 |
+                            uint32_t{length_bytes[2]} << 8 | uint32_t{length_bytes[3]};
+        auto bytes = take(length);
+        if (!bytes)
+            return mp::nullopt;
+
+        return std::string{reinterpret_cast<const char*>(bytes), length};
+    }
+
+private:
+    const unsigned char* take(std::size_t n)
+    {
+        if (!data || left < n)
+        {
+            data = nullptr; // fields only come in order, so nothing past a missing one can be read either
+            return nullptr;
+        }
+
+        auto ret = data;
+        data += n;
+        left -= n;
+        return ret;
+    }
+
+    const unsigned char* data{nullptr};
+    std::size_t left{0};
+};
+
+void append_u32(std::string& out, uint32_t value)
+{
+    for (auto shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(value >> shift & 0xff));
+}
+
+void append_u64(std::string& out, uint64_t value)
+{
+    for (auto shift = 56; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(value >> shift & 0xff));
+}
+
+// libssh has no call to send these, so the packet is written to the channel whole, as libssh would write it
+int reply_extended(ssh_channel channel, sftp_client_message msg, const std::string& fields)
+{
+    std::string packet;
+    append_u32(packet, static_cast<uint32_t>(1 + 4 + fields.size()));
+    packet.push_back(static_cast<char>(SSH_FXP_EXTENDED_REPLY));
+    append_u32(packet, msg->id);
+    packet += fields;
+
+    return serialized([channel, &packet] {
+        return ssh_channel_write(channel, packet.data(), packet.size()) == static_cast<int>(packet.size()) ? SSH_OK
+                                                                                                          : SSH_ERROR;
+    });
+}
+
+int reply_bad_message(sftp_client_message msg, const char* type)
+{
+    return serialized(sftp_reply_status, msg, SSH_FX_BAD_MESSAGE, fmt::format("{}: malformed request", type).c_str());
+}
+
 void check_sshfs_status(mp::SSHSession& session, mp::SSHProcess& sshfs_process)
 {
     try
@@ -252,14 +418,57 @@ auto create_sshfs_process(mp::SSHSession& session, const std::string& sshfs_exec
     return std::make_unique<mp::SSHProcess>(std::move(sshfs_process));
 }
 
-int mapped_id_for(const mp::id_mappings& id_maps, const int id, const int id_if_not_found)
+// Clears a stale mount and relaunches sshfs over it, in a single exec round trip
+auto recover_sshfs_process(mp::SSHSession& session, const std::string& sshfs_exec_line, const std::string& source,
+                           const std::string& target)
+{
+    auto script = fmt::format("M=\"$(findmnt --source :\"{0}\" -o TARGET -n)\"; [ -z \"$M\" ] || umount -l \"$M\"; "
+                              "exec {1} :\"{0}\" \"{2}\"",
+                              source, sshfs_exec_line, target);
+    auto sshfs_process = session.exec(fmt::format("sudo /bin/bash -c {}", mp::utils::escape_for_shell(script)));
+
+    check_sshfs_status(session, sshfs_process);
+
+    return std::make_unique<mp::SSHProcess>(std::move(sshfs_process));
+}
+
+// Touches each entry it reads, as "<mtime> <path relative to the mount>", through the mount
+auto create_change_agent(mp::SSHSession& session, const std::string& target)
+{
+    auto script = fmt::format("cd \"{}\" || exit 1; while IFS= read -r E; do "
+                              "touch -c -h -m -d \"@${{E%% *}}\" -- \"${{E#* }}\" 2>/dev/null; done",
+                              target);
+    return std::make_unique<mp::SSHProcess>(
+        session.exec(fmt::format("sudo /bin/bash -c {}", mp::utils::escape_for_shell(script))));
+}
+
+// Only the first mapping of an id counts, as with a search of the original list
+auto forward_lookup(const mp::id_mappings& id_maps)
+{
+    std::unordered_map<int, int> lookup;
+    for (const auto& map : id_maps)
+        lookup.emplace(map.first, map.second);
+
+    return lookup;
+}
+
+auto reverse_lookup(const mp::id_mappings& id_maps)
+{
+    std::unordered_map<int, int> lookup;
+    for (const auto& map : id_maps)
+        lookup.emplace(map.second, map.first);
+
+    return lookup;
+}
+
+int mapped_id_for(const std::unordered_map<int, int>& id_map, const int id, const int id_if_not_found)
 {
     if (id == mp::no_id_info_available)
         return id_if_not_found;
 
-    auto map = std::find_if(id_maps.cbegin(), id_maps.cend(), [id](std::pair<int, int> p) { return id == p.first; });
+    auto map = id_map.find(id);
 
-    if (map != id_maps.end())
+    if (map != id_map.end())
     {
         if (map->second == mp::default_id)
             return id_if_not_found;
@@ -270,29 +479,397 @@ int mapped_id_for(const mp::id_mappings& id_maps, const int id, const int id_if_
     return id;
 }
 
-int reverse_id_for(const mp::id_mappings& id_maps, const int id, const int rev_id_if_not_found)
+int reverse_id_for(const std::unordered_map<int, int>& rev_id_map, const int id, const int rev_id_if_not_found)
 {
-    auto found = std::find_if(id_maps.cbegin(), id_maps.cend(), [id](std::pair<int, int> p) { return id == p.second; });
+    auto found = rev_id_map.find(id);
 
-    return found == id_maps.cend() ? rev_id_if_not_found : found->first;
+    return found == rev_id_map.cend() ? rev_id_if_not_found : found->second;
 }
 } // namespace
 
+/*
+ * Stat results for the mounted tree, kept until inotify reports a change in the directory holding them. Both the
+ * parent and, for directories, the directory itself are watched, so that changes to an entry's metadata as well as to
+ * a directory's contents are noticed.
+ *
+ * Access times are not tracked: watching IN_ACCESS would drop entries on every read, this server's own included, so
+ * cached atimes are those of when the entry was remembered. Nor are writes through hard links from outside the tree
+ * noticed, as inotify reports those to the directories they are made through.
+ */
+class mp::SftpServer::AttributeCache
+{
+public:
+    explicit AttributeCache(std::size_t capacity) : capacity{capacity}
+    {
+        reset();
+    }
+
+    ~AttributeCache()
+    {
+#ifdef __linux__
+        if (inotify_fd >= 0)
+            ::close(inotify_fd);
+#endif
+    }
+
+    bool available() const
+    {
+        return inotify_fd >= 0;
+    }
+
+    optional<sftp_attributes_struct> attributes_for(const std::string& path, bool follow)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        process_events();
+
+        auto& cached = follow ? followed_attributes : attributes;
+        if (auto it = cached.find(path); it != cached.end())
+            return it->second;
+
+        return nullopt;
+    }
+
+    void remember(const std::string& path, bool follow, const sftp_attributes_struct& attr)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (make_room() && watch(parent_of(path)) && (!(attr.permissions & SSH_S_IFDIR) || watch(path)))
+            (follow ? followed_attributes : attributes)[path] = attr;
+    }
+
+private:
+    static std::string parent_of(const std::string& path)
+    {
+        return QFileInfo(QString::fromStdString(path)).path().toStdString();
+    }
+
+    // Returns true when the directory was already watched. Entries looked up before their watch existed may have
+    // changed unnoticed in the meantime, so they are only remembered on the next lookup.
+    bool watch(const std::string& dir)
+    {
+        if (watched.count(dir))
+            return true;
+
+#ifdef __linux__
+        constexpr auto mask = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                              IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+        auto wd = inotify_add_watch(inotify_fd, dir.c_str(), mask);
+        if (wd >= 0)
+        {
+            watched.insert(dir);
+            watches[wd] = dir;
+        }
+#endif
+
+        return false;
+    }
+
+    bool make_room()
+    {
+        if (!available())
+            return false;
+
+        if (attributes.size() + followed_attributes.size() >= capacity)
+            reset();
+
+        return available();
+    }
+
+    void forget(const std::string& path)
+    {
+        attributes.erase(path);
+        followed_attributes.erase(path);
+    }
+
+    void process_events()
+    {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        ssize_t len;
+        while ((len = ::read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (auto ptr = buffer; ptr < buffer + len;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto dir = watches.find(event->wd);
+                if ((event->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) ||
+                    ((event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM))) ||
+                    dir == watches.end())
+                {
+                    reset(); // whole subtrees may be gone, or we lost track
+                    return;
+                }
+
+                forget(dir->second);
+                if (event->len)
+                    forget(dir->second + '/' + event->name);
+            }
+        }
+#endif
+    }
+
+    void reset()
+    {
+        attributes.clear();
+        followed_attributes.clear();
+        watched.clear();
+        watches.clear();
+
+#ifdef __linux__
+        if (inotify_fd >= 0)
+            ::close(inotify_fd);
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    }
+
+    const std::size_t capacity;
+    std::mutex mutex;
+    int inotify_fd{-1};
+    std::unordered_set<std::string> watched;
+    std::unordered_map<int, std::string> watches;
+    std::unordered_map<std::string, sftp_attributes_struct> attributes;
+    std::unordered_map<std::string, sftp_attributes_struct> followed_attributes;
+};
+
+/*
+ * An open directory, read from the host only as the client asks for more entries. Attributes are looked up relative
+ * to the directory's descriptor, so no path needs resolving for each entry.
+ */
+class mp::SftpServer::DirectoryStream
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        sftp_attributes_struct attr;
+    };
+
+    explicit DirectoryStream(DIR* dir) : dir{dir, closedir}
+    {
+    }
+
+    bool next(Entry& entry)
+    {
+        if (pending)
+        {
+            entry = std::move(*pending);
+            pending = nullopt;
+            return true;
+        }
+
+        while (auto dirent = ::readdir(dir.get()))
+        {
+            if (mp::platform::symlink_attr_from(dirfd(dir.get()), dirent->d_name, &entry.attr) < 0)
+                continue; // gone since it was listed
+
+            entry.name = dirent->d_name;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Hands the entry out again on the next call, when it did not fit in the current reply
+    void put_back(Entry&& entry)
+    {
+        pending = std::move(entry);
+    }
+
+private:
+    std::unique_ptr<DIR, decltype(closedir)*> dir;
+    optional<Entry> pending;
+};
+
+/*
+ * Changes made to the source tree on the host, gathered into batches for the instance. Each line of a batch holds an
+ * mtime and a path relative to the root of the tree. The guest agent touches every listed entry through the mount with
+ * the mtime it already has, so that watchers in the instance get events of their own while the host sees no change.
+ */
+class mp::SftpServer::ChangeForwarder
+{
+public:
+    explicit ChangeForwarder(const std::string& root)
+        : root{QDir::cleanPath(QString::fromStdString(root)).toStdString()}
+    {
+#ifdef __linux__
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd >= 0)
+            watch_tree(this->root);
+#endif
+    }
+
+    ~ChangeForwarder()
+    {
+#ifdef __linux__
+        if (inotify_fd >= 0)
+            ::close(inotify_fd);
+#endif
+    }
+
+    bool available() const
+    {
+        return inotify_fd >= 0;
+    }
+
+    // Returns the changes gathered so far, once they have had a moment to settle; empty otherwise
+    std::string take_batch()
+    {
+        process_events();
+
+        if (changed.empty() || std::chrono::steady_clock::now() - first_change < batch_delay)
+            return {};
+
+        std::string batch;
+        for (const auto& path : changed)
+        {
+            struct stat st;
+            if (::lstat((root + '/' + path).c_str(), &st) == 0)
+                batch += fmt::format("{} {}\n", st.st_mtime, path);
+        }
+
+        changed.clear();
+        return batch;
+    }
+
+private:
+    static constexpr auto batch_delay = 50ms;
+    static constexpr std::size_t max_watches = 8192; // stays well within the usual per-user inotify limit
+
+    void watch_tree(const std::string& dir)
+    {
+#ifdef __linux__
+        if (watches.size() >= max_watches)
+        {
+            if (!warned_about_watches)
+                mpl::log(mpl::Level::warning, category,
+                         fmt::format("Too many directories under '{}', some changes will not reach the instance",
+                                     root));
+            warned_about_watches = true;
+            return;
+        }
+
+        constexpr auto mask = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                              IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW;
+        auto wd = inotify_add_watch(inotify_fd, dir.c_str(), mask);
+        if (wd < 0)
+            return;
+
+        watches[wd] = dir == root ? std::string{"."} : dir.substr(root.size() + 1);
+
+        std::unique_ptr<DIR, decltype(closedir)*> entries{::opendir(dir.c_str()), closedir};
+        if (!entries)
+            return;
+
+        while (auto entry = ::readdir(entries.get()))
+        {
+            const std::string name{entry->d_name};
+            if (entry->d_type == DT_DIR && name != "." && name != "..")
+                watch_tree(dir + '/' + name);
+        }
+#endif
+    }
+
+    void note(const std::string& path)
+    {
+        if (path.find('\n') != std::string::npos) // can't be told apart from the next line by the agent
+            return;
+
+        if (changed.empty())
+            first_change = std::chrono::steady_clock::now();
+        changed.insert(path);
+    }
+
+    void process_events()
+    {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        ssize_t len;
+        while ((len = ::read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (auto ptr = buffer; ptr < buffer + len;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    note("."); // at least let watchers of the root rescan
+                    continue;
+                }
+
+                auto dir = watches.find(event->wd);
+                if (dir == watches.end())
+                    continue;
+
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF))
+                {
+                    watches.erase(dir);
+                    continue;
+                }
+
+                const auto& parent = dir->second;
+                auto entry = parent;
+                if (event->len)
+                    entry = parent == "." ? std::string{event->name} : parent + '/' + event->name;
+
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                    watch_tree(root + '/' + entry);
+
+                note(entry);
+                if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                    note(parent); // so that a listing of the directory gets refreshed as well
+            }
+        }
+#endif
+    }
+
+    const std::string root;
+    int inotify_fd{-1};
+    bool warned_about_watches{false};
+    std::unordered_map<int, std::string> watches; // to paths relative to the root
+    std::set<std::string> changed;
+    std::chrono::steady_clock::time_point first_change;
+};
+
 mp::SftpServer::SftpServer(SSHSession&& session, const std::string& source, const std::string& target,
                            const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid,
-                           int default_gid, const std::string& sshfs_exec_line)
+                           int default_gid, const std::string& sshfs_exec_line, int max_workers,
+                           int attribute_cache_size, int max_read_size, int max_write_buffer_size,
+                           bool forward_changes)
     : ssh_session{std::move(session)},
       sshfs_process{create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source, '"'),
                                          mp::utils::escape_char(target, '"'))},
       sftp_server_session{make_sftp_session(ssh_session, sshfs_process->release_channel())},
       source_path{source},
       target_path{target},
-      gid_mappings{gid_mappings},
-      uid_mappings{uid_mappings},
+      gid_map{forward_lookup(gid_mappings)},
+      reverse_gid_map{reverse_lookup(gid_mappings)},
+      uid_map{forward_lookup(uid_mappings)},
+      reverse_uid_map{reverse_lookup(uid_mappings)},
       default_uid{default_uid},
       default_gid{default_gid},
-      sshfs_exec_line{sshfs_exec_line}
+      sshfs_exec_line{sshfs_exec_line},
+      max_read_size{max_read_size},
+      max_write_buffer_size{max_write_buffer_size}
 {
+    workers.setMaxThreadCount(max_workers);
+
+    if (attribute_cache_size > 0)
+    {
+        attribute_cache = std::make_unique<AttributeCache>(attribute_cache_size);
+        if (!attribute_cache->available())
+            attribute_cache.reset();
+    }
+
+    if (forward_changes)
+    {
+        change_forwarder = std::make_unique<ChangeForwarder>(source);
+        if (change_forwarder->available())
+            start_change_agent();
+        else
+            change_forwarder.reset();
+    }
 }
 
 mp::SftpServer::~SftpServer()
@@ -327,22 +904,22 @@ sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
 
 inline int mp::SftpServer::mapped_uid_for(const int uid)
 {
-    return mapped_id_for(uid_mappings, uid, default_uid);
+    return mapped_id_for(uid_map, uid, default_uid);
 }
 
 inline int mp::SftpServer::mapped_gid_for(const int gid)
 {
-    return mapped_id_for(gid_mappings, gid, default_gid);
+    return mapped_id_for(gid_map, gid, default_gid);
 }
 
 inline int mp::SftpServer::reverse_uid_for(const int uid, const int rev_uid_if_not_found)
 {
-    return reverse_id_for(uid_mappings, uid, rev_uid_if_not_found);
+    return reverse_id_for(reverse_uid_map, uid, rev_uid_if_not_found);
 }
 
 inline int mp::SftpServer::reverse_gid_for(const int gid, const int rev_gid_if_not_found)
 {
-    return reverse_id_for(gid_mappings, gid, rev_gid_if_not_found);
+    return reverse_id_for(reverse_gid_map, gid, rev_gid_if_not_found);
 }
 
 void mp::SftpServer::process_message(sftp_client_message msg)
@@ -405,7 +982,7 @@ void mp::SftpServer::process_message(sftp_client_message msg)
         ret = handle_extended(msg);
         break;
     default:
-        mpl::log(mpl::Level::trace, category, fmt::format("Unknown message: {}", static_cast<int>(type)));
+        mpl::log(mpl::Level::trace, category, "Unknown message: {}", static_cast<int>(type));
         ret = reply_unsupported(msg);
     }
     if (ret != 0)
@@ -414,14 +991,16 @@ void mp::SftpServer::process_message(sftp_client_message msg)
 
 void mp::SftpServer::run()
 {
-    using MsgUPtr = std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
-
     while (true)
     {
-        MsgUPtr client_msg{sftp_get_client_message(sftp_server_session.get()), sftp_client_message_free};
+        MessageUptr client_msg{next_message(), sftp_client_message_free};
         auto msg = client_msg.get();
         if (msg == nullptr)
         {
+            flush_pending_reads();
+            workers.waitForDone();
+            flush_pending_writes();
+
             if (stop_invoked)
                 break;
 
@@ -439,18 +1018,21 @@ void mp::SftpServer::run()
             {
                 mpl::log(mpl::Level::error, category,
                          "sshfs in the instance appears to have exited unexpectedly.  Trying to recover.");
-                auto proc = ssh_session.exec(fmt::format("findmnt --source :{}  -o TARGET -n", source_path));
-                auto mount_path = proc.read_std_output();
-                if (!mount_path.empty())
-                {
-                    ssh_session.exec(fmt::format("sudo umount {}", mount_path));
-                }
+
+                // Handles belong to the sshfs that died; the kernel drops them along with its FUSE connection
+                open_file_handles.clear();
+                open_dir_handles.clear();
+                read_patterns.clear();
 
                 sshfs_process =
-                    create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
-                                         mp::utils::escape_char(target_path, '"'));
+                    recover_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
+                                          mp::utils::escape_char(target_path, '"'));
                 sftp_server_session = make_sftp_session(ssh_session, sshfs_process->release_channel());
 
+                // The agent is left inside the old mount
+                if (change_forwarder)
+                    start_change_agent();
+
                 continue;
             }
             else
@@ -459,7 +1041,128 @@ void mp::SftpServer::run()
             }
         }
 
-        process_message(msg);
+        const auto type = sftp_client_message_get_type(msg);
+
+        // Anything but another read may change what held back reads would see, so they are done first
+        if (type != SFTP_READ)
+            flush_pending_reads();
+
+        // Anything but another write may observe the files, so buffered data goes out first
+        if (type != SFTP_WRITE)
+            flush_pending_writes();
+
+        if (type == SFTP_READ)
+        {
+            // sshfs keeps several reads outstanding, and those that arrived together go to the disk together
+            pending_reads.push_back(std::move(client_msg));
+            if (pending_reads.size() >= max_batched_reads || !message_waiting())
+                flush_pending_reads();
+        }
+        else if (!concurrent())
+        {
+            process_message(msg);
+        }
+        else if (runs_concurrently(type))
+        {
+            ++requests_in_flight;
+            QtConcurrent::run(&workers, [this, msg = client_msg.release()] {
+                reply_guard = {&session_mutex, &session_released, &replies_waiting};
+                mp::top_catch_all(category, [this, msg] { process_message(msg); });
+                sftp_client_message_free(msg);
+                reply_guard = {};
+
+                {
+                    std::lock_guard<std::mutex> lock{session_mutex}; // for the reading thread not to miss it
+                    --requests_in_flight;
+                }
+                session_released.notify_all();
+            });
+        }
+        else
+        {
+            auto lock = lock_session();
+            process_message(msg);
+        }
+    }
+}
+
+sftp_client_message mp::SftpServer::next_message()
+{
+    // A closed channel means sshfs is gone; don't wait on a read to find out
+    if (ssh_channel_is_closed(sftp_server_session->channel))
+        return nullptr;
+
+    if (!concurrent() && !change_agent)
+        return sftp_get_client_message(sftp_server_session.get());
+
+    // Don't block in libssh while workers may need the session to reply; wait for them to be done with it instead
+    while (true)
+    {
+        auto lock = lock_session();
+        if (change_agent)
+            send_changes();
+
+        const auto busy = requests_in_flight > 0;
+        if (ssh_channel_poll_timeout(sftp_server_session->channel, busy ? 0 : idle_poll_interval, 0) != 0)
+            return sftp_get_client_message(sftp_server_session.get()); // data, or the channel is done
+
+        if (ssh_channel_is_closed(sftp_server_session->channel))
+            return nullptr;
+
+        // Woken when a reply has gone out or a request is done, which is when the next requests tend to come
+        if (busy)
+            session_released.wait_for(lock, busy_wait_interval);
+    }
+}
+
+bool mp::SftpServer::message_waiting()
+{
+    std::unique_lock<std::mutex> lock;
+    if (concurrent())
+        lock = lock_session();
+
+    return ssh_channel_poll_timeout(sftp_server_session->channel, 0, 0) > 0;
+}
+
+std::unique_lock<std::mutex> mp::SftpServer::lock_session()
+{
+    // Let waiting replies through first; the reading thread would otherwise grab the session right back
+    std::unique_lock<std::mutex> lock{session_mutex};
+    session_released.wait(lock, [this] { return replies_waiting == 0; });
+
+    return lock;
+}
+
+bool mp::SftpServer::concurrent() const
+{
+    return workers.maxThreadCount() > 1;
+}
+
+void mp::SftpServer::start_change_agent()
+{
+    change_agent.reset();
+
+    try
+    {
+        change_agent = create_change_agent(ssh_session, mp::utils::escape_char(target_path, '"'));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot forward file changes to the instance: {}", e.what()));
+    }
+}
+
+void mp::SftpServer::send_changes()
+{
+    auto batch = change_forwarder->take_batch();
+    if (batch.empty())
+        return;
+
+    if (ssh_channel_write(change_agent->channel.get(), batch.data(), batch.size()) == SSH_ERROR)
+    {
+        mpl::log(mpl::Level::warning, category, "Lost the change agent in the instance, no longer forwarding changes");
+        change_agent.reset();
     }
 }
 
@@ -473,16 +1176,20 @@ int mp::SftpServer::handle_close(sftp_client_message msg)
 {
     const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
 
+    // Pending writes were flushed before dispatching, so only failed ones are left to report
+    const auto write_failed = pending_writes.erase(id) > 0;
+    read_patterns.erase(id);
+
     auto erased = open_file_handles.erase(id);
     erased += open_dir_handles.erase(id);
     if (erased == 0)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
         return reply_bad_handle(msg, "close");
     }
 
     sftp_handle_remove(sftp_server_session.get(), id);
-    return reply_ok(msg);
+    return write_failed ? reply_failure(msg) : reply_ok(msg);
 }
 
 int mp::SftpServer::handle_fstat(sftp_client_message msg)
@@ -490,7 +1197,7 @@ int mp::SftpServer::handle_fstat(sftp_client_message msg)
     auto file = handle_from(msg, open_file_handles);
     if (file == nullptr)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
         return reply_bad_handle(msg, "fstat");
     }
 
@@ -508,24 +1215,22 @@ int mp::SftpServer::handle_mkdir(sftp_client_message msg)
     const auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     QDir dir(filename);
     if (!dir.mkdir(filename))
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: mkdir failed for \'{}\'", __FUNCTION__, filename));
+        mpl::log(mpl::Level::trace, category, "{}: mkdir failed for \'{}\'", __FUNCTION__, filename);
         return reply_failure(msg);
     }
 
     QFile file(filename);
     if (!MP_FILEOPS.setPermissions(file, to_qt_permissions(msg->attr->permissions)))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: set permissions failed for \'{}\'", __FUNCTION__, filename));
+        mpl::log(mpl::Level::trace, category, "{}: set permissions failed for \'{}\'", __FUNCTION__, filename);
         return reply_failure(msg);
     }
 
@@ -536,8 +1241,8 @@ int mp::SftpServer::handle_mkdir(sftp_client_message msg)
 
     if (MP_PLATFORM.chown(filename, rev_uid, rev_gid) < 0)
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("failed to chown '{}' to owner:{} and group:{}", filename, rev_uid, rev_gid));
+        mpl::log(mpl::Level::trace, category, "failed to chown '{}' to owner:{} and group:{}", filename, rev_uid,
+                 rev_gid);
         return reply_failure(msg);
     }
     return reply_ok(msg);
@@ -548,16 +1253,15 @@ int mp::SftpServer::handle_rmdir(sftp_client_message msg)
     const auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     QDir dir(filename);
     if (!MP_FILEOPS.rmdir(dir, filename))
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: rmdir failed for \'{}\'", __FUNCTION__, filename));
+        mpl::log(mpl::Level::trace, category, "{}: rmdir failed for \'{}\'", __FUNCTION__, filename);
         return reply_failure(msg);
     }
 
@@ -569,9 +1273,8 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
     const auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
@@ -606,7 +1309,7 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
 
     if (!MP_FILEOPS.open(*file, mode))
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("Cannot open \'{}\': {}", filename, file->errorString()));
+        mpl::log(mpl::Level::trace, category, "Cannot open \'{}\': {}", filename, file->errorString());
         return reply_failure(msg);
     }
 
@@ -614,8 +1317,8 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
     {
         if (!MP_FILEOPS.setPermissions(*file, to_qt_permissions(msg->attr->permissions)))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("Cannot set permissions for \'{}\': {}", filename, file->errorString()));
+            mpl::log(mpl::Level::trace, category, "Cannot set permissions for \'{}\': {}", filename,
+                     file->errorString());
             return reply_failure(msg);
         }
 
@@ -627,8 +1330,8 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
 
         if (MP_PLATFORM.chown(filename, new_uid, new_gid) < 0)
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("failed to chown '{}' to owner:{} and group:{}", filename, new_uid, new_gid));
+            mpl::log(mpl::Level::trace, category, "failed to chown '{}' to owner:{} and group:{}", filename, new_uid,
+                     new_gid);
             return reply_failure(msg);
         }
     }
@@ -650,73 +1353,127 @@ int mp::SftpServer::handle_opendir(sftp_client_message msg)
     auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     QDir dir(filename);
     if (!dir.exists())
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("Cannot open directory \'{}\': no such directory", filename));
+        mpl::log(mpl::Level::trace, category, "Cannot open directory \'{}\': no such directory", filename);
         return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such directory");
     }
 
     if (!MP_FILEOPS.isReadable(dir))
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("Cannot read directory \'{}\': permission denied", filename));
+        mpl::log(mpl::Level::trace, category, "Cannot read directory \'{}\': permission denied", filename);
         return reply_perm_denied(msg);
     }
 
-    auto entry_list =
-        std::make_unique<QFileInfoList>(dir.entryInfoList(QDir::AllEntries | QDir::System | QDir::Hidden));
+    auto dir_stream = ::opendir(filename);
+    if (dir_stream == nullptr)
+    {
+        const auto error = errno;
+        mpl::log(mpl::Level::trace, category, "Cannot open directory \'{}\': {}", filename, std::strerror(error));
+        return error == EACCES ? reply_perm_denied(msg) : reply_failure(msg);
+    }
+    auto entries = std::make_unique<DirectoryStream>(dir_stream);
 
-    SftpHandleUPtr sftp_handle{sftp_handle_alloc(sftp_server_session.get(), entry_list.get()), ssh_string_free};
+    SftpHandleUPtr sftp_handle{sftp_handle_alloc(sftp_server_session.get(), entries.get()), ssh_string_free};
     if (!sftp_handle)
     {
         mpl::log(mpl::Level::trace, category, "Cannot allocate handle for opendir()");
         return reply_failure(msg);
     }
 
-    open_dir_handles.emplace(entry_list.get(), std::move(entry_list));
+    open_dir_handles.emplace(entries.get(), std::move(entries));
 
     return sftp_reply_handle(msg, sftp_handle.get());
 }
 
 int mp::SftpServer::handle_read(sftp_client_message msg)
 {
-    auto file = handle_from(msg, open_file_handles);
-    if (file == nullptr)
+    return handle_reads({msg});
+}
+
+int mp::SftpServer::handle_reads(const std::vector<sftp_client_message>& msgs)
+{
+    int ret = 0;
+    auto keep_first_error = [&ret](int r) {
+        if (ret == 0)
+            ret = r;
+    };
+
+    // Replies are sent before the next messages are handled, so one buffer per read serves every batch
+    if (read_buffers.size() < msgs.size())
+        read_buffers.resize(msgs.size());
+
+    std::vector<FileOps::Transfer> reads;
+    std::vector<sftp_client_message> read_msgs;
+    for (auto msg : msgs)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
-        return reply_bad_handle(msg, "read");
-    }
+        auto file = handle_from(msg, open_file_handles);
+        if (file == nullptr)
+        {
+            mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
+            keep_first_error(reply_bad_handle(msg, "read"));
+            continue;
+        }
+
+        const auto len = std::min<uint32_t>(msg->len, max_read_size);
+        auto& buffer = read_buffers[reads.size()];
+        if (buffer.size() < len)
+            buffer.resize(max_read_size);
 
-    const auto max_packet_size = 65536u;
-    const auto len = std::min(msg->len, max_packet_size);
+        track_read(sftp_handle(msg->sftp, msg->handle), *file, msg->offset, len);
+        reads.push_back({file, buffer.data(), len, static_cast<qint64>(msg->offset)});
+        read_msgs.push_back(msg);
+    }
 
-    std::vector<char> data;
-    data.reserve(len);
+    MP_FILEOPS.read_batch(reads);
 
-    if (!MP_FILEOPS.seek(*file, msg->offset))
+    for (std::size_t i = 0; i < reads.size(); ++i)
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot seek to position {} in \'{}\'", __FUNCTION__, msg->offset, file->fileName()));
-        return reply_failure(msg);
+        const auto& read = reads[i];
+        const auto msg = read_msgs[i];
+        if (read.result < 0)
+        {
+            mpl::log(mpl::Level::trace, category, "{}: read failed for {}: {}", __FUNCTION__, read.file->fileName(),
+                     read.file->errorString());
+            keep_first_error(sftp_reply_status(msg, SSH_FX_FAILURE, read.file->errorString().toStdString().c_str()));
+        }
+        else if (read.result == 0)
+            keep_first_error(sftp_reply_status(msg, SSH_FX_EOF, "End of file"));
+        else
+            keep_first_error(sftp_reply_data(msg, read.data, read.result));
     }
 
-    auto r = MP_FILEOPS.read(*file, data.data(), len);
-    if (r < 0)
+    return ret;
+}
+
+void mp::SftpServer::track_read(void* id, QFile& file, qint64 offset, qint64 len)
+{
+    auto& pattern = read_patterns[id];
+    pattern.sequential = offset == pattern.next ? pattern.sequential + 1 : 0;
+    pattern.next = offset + len;
+
+    // Random readers keep to plain reads
+    if (pattern.sequential < sequential_reads_threshold)
+        return;
+
+    // Sequential readers get a bigger kernel read-ahead, and a window ahead of them that the kernel fills in the
+    // background, topped up once half of it is read, for their reads to be served from memory
+    if (pattern.sequential == sequential_reads_threshold)
+        MP_FILEOPS.advise(file, 0, 0, FileOps::Access::sequential);
+
+    if (pattern.prefetched_until - pattern.next < read_ahead_window / 2)
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: read failed for {}: {}", __FUNCTION__, file->fileName(), file->errorString()));
-        return sftp_reply_status(msg, SSH_FX_FAILURE, file->errorString().toStdString().c_str());
+        const auto from = std::max(pattern.prefetched_until, pattern.next);
+        const auto until = pattern.next + read_ahead_window;
+        MP_FILEOPS.advise(file, from, until - from, FileOps::Access::will_need);
+        pattern.prefetched_until = until;
     }
-    else if (r == 0)
-        return sftp_reply_status(msg, SSH_FX_EOF, "End of file");
-
-    return sftp_reply_data(msg, data.data(), r);
 }
 
 int mp::SftpServer::handle_readdir(sftp_client_message msg)
@@ -724,34 +1481,34 @@ int mp::SftpServer::handle_readdir(sftp_client_message msg)
     auto dir_entries = handle_from(msg, open_dir_handles);
     if (dir_entries == nullptr)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
         return reply_bad_handle(msg, "readdir");
     }
 
-    if (dir_entries->empty())
+    DirectoryStream::Entry entry;
+    if (!dir_entries->next(entry))
         return sftp_reply_status(msg, SSH_FX_EOF, nullptr);
 
-    const auto max_num_entries_per_packet = 50;
-    const auto num_entries = std::min(dir_entries->size(), max_num_entries_per_packet);
+    // Name, long name and attributes are encoded with their lengths and flags, roughly this much in total
+    const auto entry_overhead = 40u;
+    const auto max_reply_size = 65536u;
+    std::size_t reply_size{0};
 
-    for (int i = 0; i < num_entries; i++)
+    do
     {
-        const QFileInfo entry = dir_entries->takeFirst();
-        const auto filename = entry.fileName().toStdString();
-        sftp_attributes_struct attr{};
-        if (entry.isSymLink())
-        {
-            mp::platform::symlink_attr_from(entry.absoluteFilePath().toStdString().c_str(), &attr);
-            attr.uid = mapped_uid_for(attr.uid);
-            attr.gid = mapped_gid_for(attr.gid);
-        }
-        else
+        const auto longname = longname_from(entry.attr, entry.name);
+        const auto entry_size = entry.name.size() + longname.size() + entry_overhead;
+        if (reply_size > 0 && reply_size + entry_size > max_reply_size)
         {
-            attr = attr_from(entry);
+            dir_entries->put_back(std::move(entry));
+            break;
         }
-        const auto longname = longname_from(entry, filename);
-        sftp_reply_names_add(msg, filename.c_str(), longname.data(), &attr);
-    }
+        reply_size += entry_size;
+
+        entry.attr.uid = mapped_uid_for(entry.attr.uid);
+        entry.attr.gid = mapped_gid_for(entry.attr.gid);
+        sftp_reply_names_add(msg, entry.name.c_str(), longname.c_str(), &entry.attr);
+    } while (dir_entries->next(entry));
 
     return sftp_reply_names(msg);
 }
@@ -761,22 +1518,21 @@ int mp::SftpServer::handle_readlink(sftp_client_message msg)
     auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     auto link = QFile::symLinkTarget(filename);
     if (link.isEmpty())
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: invalid link for \'{}\'", __FUNCTION__, filename));
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "invalid link");
+        mpl::log(mpl::Level::trace, category, "{}: invalid link for \'{}\'", __FUNCTION__, filename);
+        return serialized(sftp_reply_status, msg, SSH_FX_NO_SUCH_FILE, "invalid link");
     }
 
     sftp_attributes_struct attr{};
     sftp_reply_names_add(msg, link.toStdString().c_str(), link.toStdString().c_str(), &attr);
-    return sftp_reply_names(msg);
+    return serialized(sftp_reply_names, msg);
 }
 
 int mp::SftpServer::handle_realpath(sftp_client_message msg)
@@ -784,14 +1540,13 @@ int mp::SftpServer::handle_realpath(sftp_client_message msg)
     auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     auto realpath = QFileInfo(filename).absoluteFilePath();
-    return sftp_reply_name(msg, realpath.toStdString().c_str(), nullptr);
+    return serialized(sftp_reply_name, msg, realpath.toStdString().c_str(), nullptr);
 }
 
 int mp::SftpServer::handle_remove(sftp_client_message msg)
@@ -799,16 +1554,15 @@ int mp::SftpServer::handle_remove(sftp_client_message msg)
     auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
     QFile file{filename};
     if (!MP_FILEOPS.remove(file))
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: cannot remove \'{}\'", __FUNCTION__, filename));
+        mpl::log(mpl::Level::trace, category, "{}: cannot remove \'{}\'", __FUNCTION__, filename);
         return reply_failure(msg);
     }
 
@@ -820,25 +1574,22 @@ int mp::SftpServer::handle_rename(sftp_client_message msg)
     const auto source = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, source))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, source, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 source, source_path);
         return reply_perm_denied(msg);
     }
 
     if (!QFileInfo(source).isSymLink() && !QFile::exists(source))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot rename \'{}\': no such file", __FUNCTION__, source));
+        mpl::log(mpl::Level::trace, category, "{}: cannot rename \'{}\': no such file", __FUNCTION__, source);
         return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
     }
 
     const auto target = sftp_client_message_get_data(msg);
     if (!validate_path(source_path, target))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot validate target path \'{}\' against source \'{}\'", __FUNCTION__, target,
-                             source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate target path \'{}\' against source \'{}\'",
+                 __FUNCTION__, target, source_path);
         return reply_perm_denied(msg);
     }
 
@@ -847,8 +1598,7 @@ int mp::SftpServer::handle_rename(sftp_client_message msg)
     {
         if (!MP_FILEOPS.remove(target_file))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: cannot remove \'{}\' for renaming", __FUNCTION__, target));
+            mpl::log(mpl::Level::trace, category, "{}: cannot remove \'{}\' for renaming", __FUNCTION__, target);
             return reply_failure(msg);
         }
     }
@@ -856,8 +1606,7 @@ int mp::SftpServer::handle_rename(sftp_client_message msg)
     QFile source_file{source};
     if (!MP_FILEOPS.rename(source_file, target))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: failed renaming \'{}\' to \'{}\'", __FUNCTION__, source, target));
+        mpl::log(mpl::Level::trace, category, "{}: failed renaming \'{}\' to \'{}\'", __FUNCTION__, source, target);
         return reply_failure(msg);
     }
 
@@ -873,7 +1622,7 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
         auto handle = handle_from(msg, open_file_handles);
         if (handle == nullptr)
         {
-            mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+            mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
             return reply_bad_handle(msg, "setstat");
         }
 
@@ -884,16 +1633,14 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
         filename = sftp_client_message_get_filename(msg);
         if (!validate_path(source_path, filename.toStdString()))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename,
-                                 source_path));
+            mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                     filename, source_path);
             return reply_perm_denied(msg);
         }
 
         if (!QFileInfo(filename).isSymLink() && !QFile::exists(filename))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: cannot setstat \'{}\': no such file", __FUNCTION__, filename));
+            mpl::log(mpl::Level::trace, category, "{}: cannot setstat \'{}\': no such file", __FUNCTION__, filename);
             return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
         }
     }
@@ -904,7 +1651,7 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
     {
         if (!MP_FILEOPS.resize(file, msg->attr->size))
         {
-            mpl::log(mpl::Level::trace, category, fmt::format("{}: cannot resize \'{}\'", __FUNCTION__, filename));
+            mpl::log(mpl::Level::trace, category, "{}: cannot resize \'{}\'", __FUNCTION__, filename);
             return reply_failure(msg);
         }
     }
@@ -913,18 +1660,23 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
     {
         if (!MP_FILEOPS.setPermissions(file, to_qt_permissions(msg->attr->permissions)))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: set permissions failed for \'{}\'", __FUNCTION__, filename));
+            mpl::log(mpl::Level::trace, category, "{}: set permissions failed for \'{}\'", __FUNCTION__, filename);
             return reply_failure(msg);
         }
     }
 
     if (msg->attr->flags & SSH_FILEXFER_ATTR_ACMODTIME)
     {
-        if (MP_PLATFORM.utime(filename.toStdString().c_str(), msg->attr->atime, msg->attr->mtime) < 0)
+        // Setting the times an entry already has, as the change agent does, must not reach the host: it would
+        // truncate them to whole seconds
+        const QFileInfo current{filename};
+        const auto unchanged = current.lastModified().toSecsSinceEpoch() == msg->attr->mtime &&
+                               current.lastRead().toSecsSinceEpoch() == msg->attr->atime;
+
+        if (!unchanged && MP_PLATFORM.utime(filename.toStdString().c_str(), msg->attr->atime, msg->attr->mtime) < 0)
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: cannot set modification date for \'{}\'", __FUNCTION__, filename));
+            mpl::log(mpl::Level::trace, category, "{}: cannot set modification date for \'{}\'", __FUNCTION__,
+                     filename);
             return reply_failure(msg);
         }
     }
@@ -933,8 +1685,7 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
         (MP_PLATFORM.chown(filename.toStdString().c_str(), reverse_uid_for(msg->attr->uid, msg->attr->uid),
                            reverse_gid_for(msg->attr->gid, msg->attr->gid)) < 0))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot set ownership for \'{}\'", __FUNCTION__, filename));
+        mpl::log(mpl::Level::trace, category, "{}: cannot set ownership for \'{}\'", __FUNCTION__, filename);
         return reply_failure(msg);
     }
 
@@ -946,18 +1697,22 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
     auto filename = sftp_client_message_get_filename(msg);
     if (!validate_path(source_path, filename))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, filename, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 filename, source_path);
         return reply_perm_denied(msg);
     }
 
+    if (attribute_cache)
+    {
+        if (auto cached = attribute_cache->attributes_for(filename, follow))
+            return serialized(sftp_reply_attr, msg, &*cached);
+    }
+
     QFileInfo file_info(filename);
     if (!file_info.isSymLink() && !file_info.exists())
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot stat  \'{}\': no such file", __FUNCTION__, filename));
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
+        mpl::log(mpl::Level::trace, category, "{}: cannot stat  \'{}\': no such file", __FUNCTION__, filename);
+        return serialized(sftp_reply_status, msg, SSH_FX_NO_SUCH_FILE, "no such file");
     }
 
     sftp_attributes_struct attr{};
@@ -970,13 +1725,21 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
     }
     else
     {
-        if (file_info.isSymLink())
+        const auto followed_link = file_info.isSymLink();
+        if (followed_link)
             file_info = QFileInfo(file_info.symLinkTarget());
 
         attr = attr_from(file_info);
+
+        // link targets may live anywhere, so only what is watched through its own directory is cached
+        if (followed_link)
+            return serialized(sftp_reply_attr, msg, &attr);
     }
 
-    return sftp_reply_attr(msg, &attr);
+    if (attribute_cache)
+        attribute_cache->remember(filename, follow, attr);
+
+    return serialized(sftp_reply_attr, msg, &attr);
 }
 
 int mp::SftpServer::handle_symlink(sftp_client_message msg)
@@ -986,16 +1749,15 @@ int mp::SftpServer::handle_symlink(sftp_client_message msg)
     const auto new_name = sftp_client_message_get_data(msg);
     if (!validate_path(source_path, new_name))
     {
-        mpl::log(
-            mpl::Level::trace, category,
-            fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, new_name, source_path));
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 new_name, source_path);
         return reply_perm_denied(msg);
     }
 
     if (!MP_PLATFORM.symlink(old_name, new_name, QFileInfo(old_name).isDir()))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: failure creating symlink from \'{}\' to \'{}\'", __FUNCTION__, old_name, new_name));
+        mpl::log(mpl::Level::trace, category, "{}: failure creating symlink from \'{}\' to \'{}\'", __FUNCTION__,
+                 old_name, new_name);
         return reply_failure(msg);
     }
 
@@ -1007,37 +1769,132 @@ int mp::SftpServer::handle_write(sftp_client_message msg)
     auto file = handle_from(msg, open_file_handles);
     if (file == nullptr)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
         return reply_bad_handle(msg, "write");
     }
 
-    auto len = ssh_string_len(msg->data);
-    auto data_ptr = ssh_string_get_char(msg->data);
-    if (!MP_FILEOPS.seek(*file, msg->offset))
+    const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
+    auto& buffer = pending_writes[id];
+
+    // Only writes that extend the buffered run can be coalesced
+    if (!buffer.data.isEmpty() && buffer.offset + buffer.data.size() != static_cast<qint64>(msg->offset))
+        flush_pending_write(*file, buffer);
+
+    if (buffer.failed)
+    {
+        pending_writes.erase(id);
+        return reply_failure(msg);
+    }
+
+    if (buffer.data.isEmpty())
+        buffer.offset = msg->offset;
+    buffer.data.append(ssh_string_get_char(msg->data), ssh_string_len(msg->data));
+
+    if (buffer.data.size() >= max_write_buffer_size && !flush_pending_write(*file, buffer))
     {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot seek to position {} in \'{}\'", __FUNCTION__, msg->offset, file->fileName()));
+        pending_writes.erase(id);
         return reply_failure(msg);
     }
 
-    do
+    return reply_ok(msg);
+}
+
+bool mp::SftpServer::flush_pending_write(QFile& file, WriteBuffer& buffer)
+{
+    auto data_ptr = buffer.data.constData();
+    qint64 len = buffer.data.size();
+    auto pos = buffer.offset;
+
+    while (len > 0)
     {
-        auto r = MP_FILEOPS.write(*file, data_ptr, len);
-        if (r < 0)
+        auto r = MP_FILEOPS.write_at(file, data_ptr, len, pos);
+        if (r <= 0)
         {
-            mpl::log(
-                mpl::Level::trace, category,
-                fmt::format("{}: write failed for \'{}\': {}", __FUNCTION__, file->fileName(), file->errorString()));
-            return reply_failure(msg);
+            mpl::log(mpl::Level::trace, category, "{}: write failed for \'{}\': {}", __FUNCTION__, file.fileName(),
+                     file.errorString());
+            buffer.data.clear();
+            buffer.failed = true;
+            return false;
         }
 
-        file->flush();
-
         data_ptr += r;
         len -= r;
-    } while (len > 0);
+        pos += r;
+    }
 
-    return reply_ok(msg);
+    buffer.data.clear();
+    return true;
+}
+
+void mp::SftpServer::flush_pending_writes()
+{
+    // The buffers of all files go to the disk together
+    std::vector<FileOps::Transfer> writes;
+    std::vector<WriteBuffer*> buffers;
+    for (auto& [id, buffer] : pending_writes)
+    {
+        auto file = open_file_handles.find(id);
+        if (file != open_file_handles.end() && !buffer.data.isEmpty())
+        {
+            writes.push_back({file->second.get(), buffer.data.data(), buffer.data.size(), buffer.offset});
+            buffers.push_back(&buffer);
+        }
+    }
+
+    if (!writes.empty())
+        MP_FILEOPS.write_batch(writes);
+
+    for (std::size_t i = 0; i < writes.size(); ++i)
+    {
+        const auto& write = writes[i];
+        auto& buffer = *buffers[i];
+        if (write.result <= 0)
+        {
+            mpl::log(mpl::Level::trace, category, "{}: write failed for \'{}\': {}", __FUNCTION__,
+                     write.file->fileName(), write.file->errorString());
+            buffer.data.clear();
+            buffer.failed = true;
+            continue;
+        }
+
+        // Whatever was left of a short write goes out on its own
+        buffer.data.remove(0, write.result);
+        buffer.offset += write.result;
+        if (!buffer.data.isEmpty())
+            flush_pending_write(*write.file, buffer);
+    }
+
+    for (auto it = pending_writes.begin(); it != pending_writes.end();)
+    {
+        auto file = open_file_handles.find(it->first);
+
+        // keep failures around until they can be reported on the handle
+        if (it->second.failed && file != open_file_handles.end())
+            ++it;
+        else
+            it = pending_writes.erase(it);
+    }
+}
+
+void mp::SftpServer::flush_pending_reads()
+{
+    if (pending_reads.empty())
+        return;
+
+    std::vector<sftp_client_message> msgs;
+    for (const auto& msg : pending_reads)
+        msgs.push_back(msg.get());
+
+    {
+        std::unique_lock<std::mutex> lock;
+        if (concurrent())
+            lock = lock_session();
+
+        if (auto ret = handle_reads(msgs); ret != 0)
+            mpl::log(mpl::Level::error, category, fmt::format("error occurred when replying to client: {}", ret));
+    }
+
+    pending_reads.clear();
 }
 
 int mp::SftpServer::handle_extended(sftp_client_message msg)
@@ -1045,7 +1902,7 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
     const auto submessage = sftp_client_message_get_submessage(msg);
     if (submessage == nullptr)
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("{}: invalid submesage requested", __FUNCTION__));
+        mpl::log(mpl::Level::trace, category, "{}: invalid submesage requested", __FUNCTION__);
         return reply_failure(msg);
     }
 
@@ -1057,16 +1914,15 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
         const auto new_name = sftp_client_message_get_data(msg);
         if (!validate_path(source_path, new_name))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__, new_name,
-                                 source_path));
+            mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                     new_name, source_path);
             return reply_perm_denied(msg);
         }
 
         if (!MP_PLATFORM.link(old_name, new_name))
         {
-            mpl::log(mpl::Level::trace, category,
-                     fmt::format("{}: failed creating link from \'{}\' to \'{}\'", __FUNCTION__, old_name, new_name));
+            mpl::log(mpl::Level::trace, category, "{}: failed creating link from \'{}\' to \'{}\'", __FUNCTION__,
+                     old_name, new_name);
             return reply_failure(msg);
         }
     }
@@ -1074,11 +1930,133 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
     {
         return handle_rename(msg);
     }
+    else if (method == "copy-data")
+    {
+        return handle_copy_data(msg);
+    }
+    else if (method == "statvfs@openssh.com")
+    {
+        return handle_statvfs(msg);
+    }
+    else if (method == "limits@openssh.com")
+    {
+        return handle_limits(msg);
+    }
+    else if (method == "fsync@openssh.com")
+    {
+        auto file = handle_from(msg, open_file_handles);
+        if (file == nullptr)
+        {
+            mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
+            return reply_bad_handle(msg, "fsync");
+        }
+
+        const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
+        if (pending_writes.erase(id) > 0 || !MP_FILEOPS.sync(*file))
+        {
+            mpl::log(mpl::Level::trace, category, "{}: fsync failed for \'{}\'", __FUNCTION__, file->fileName());
+            return reply_failure(msg);
+        }
+    }
     else
     {
-        mpl::log(mpl::Level::trace, category, fmt::format("Unhandled extended method requested: {}", method));
+        mpl::log(mpl::Level::trace, category, "Unhandled extended method requested: {}", method);
         return reply_unsupported(msg);
     }
 
     return reply_ok(msg);
 }
+
+// Copies between two open files on the host, rather than through the instance and back
+int mp::SftpServer::handle_copy_data(sftp_client_message msg)
+{
+    ExtendedFields fields{msg};
+    const auto read_handle = fields.string();
+    const auto read_offset = fields.u64();
+    const auto length = fields.u64();
+    const auto write_handle = fields.string();
+    const auto write_offset = fields.u64();
+    if (!write_offset)
+    {
+        mpl::log(mpl::Level::trace, category, "{}: malformed request", __FUNCTION__);
+        return reply_bad_message(msg, "copy-data");
+    }
+
+    auto source = handle_from(sftp_server_session.get(), *read_handle, open_file_handles);
+    auto destination = handle_from(sftp_server_session.get(), *write_handle, open_file_handles);
+    if (source == nullptr || destination == nullptr)
+    {
+        mpl::log(mpl::Level::trace, category, "{}: bad handle requested", __FUNCTION__);
+        return reply_bad_handle(msg, "copy-data");
+    }
+
+    // A length of zero copies up to the end of the source
+    constexpr uint64_t max = std::numeric_limits<qint64>::max();
+    const auto len = static_cast<qint64>(*length == 0 ? max - std::min(*read_offset, max) : std::min(*length, max));
+    const auto overlapping = source == destination && *read_offset < *write_offset + len &&
+                             *write_offset < *read_offset + len;
+    if (overlapping || MP_FILEOPS.copy_range(*source, *read_offset, *destination, *write_offset, len) < 0)
+    {
+        mpl::log(mpl::Level::trace, category, "{}: failed copying from \'{}\' to \'{}\'", __FUNCTION__,
+                 source->fileName(), destination->fileName());
+        return reply_failure(msg);
+    }
+
+    return reply_ok(msg);
+}
+
+int mp::SftpServer::handle_statvfs(sftp_client_message msg)
+{
+    ExtendedFields fields{msg};
+    const auto path = fields.string();
+    if (!path)
+    {
+        mpl::log(mpl::Level::trace, category, "{}: malformed request", __FUNCTION__);
+        return reply_bad_message(msg, "statvfs");
+    }
+
+    if (!validate_path(source_path, *path))
+    {
+        mpl::log(mpl::Level::trace, category, "{}: cannot validate path \'{}\' against source \'{}\'", __FUNCTION__,
+                 *path, source_path);
+        return reply_perm_denied(msg);
+    }
+
+    QStorageInfo storage{QString::fromStdString(*path)};
+    if (!storage.isValid())
+    {
+        mpl::log(mpl::Level::trace, category, "{}: cannot tell the filesystem of \'{}\'", __FUNCTION__, *path);
+        return reply_failure(msg);
+    }
+
+    // Qt tells bytes rather than inodes, so the file counts are left out, as the extension allows
+    constexpr uint64_t read_only_flag = 0x1, max_name_length = 255;
+    const uint64_t block_size = storage.blockSize() > 0 ? storage.blockSize() : 4096;
+    std::string reply;
+    append_u64(reply, block_size);                                // f_bsize
+    append_u64(reply, block_size);                                // f_frsize
+    append_u64(reply, storage.bytesTotal() / block_size);         // f_blocks
+    append_u64(reply, storage.bytesFree() / block_size);          // f_bfree
+    append_u64(reply, storage.bytesAvailable() / block_size);     // f_bavail
+    append_u64(reply, 0);                                         // f_files
+    append_u64(reply, 0);                                         // f_ffree
+    append_u64(reply, 0);                                         // f_favail
+    append_u64(reply, qHash(storage.device()));                   // f_fsid
+    append_u64(reply, storage.isReadOnly() ? read_only_flag : 0); // f_flag
+    append_u64(reply, max_name_length);                           // f_namemax
+
+    return reply_extended(sftp_server_session->channel, msg, reply);
+}
+
+// Tells clients how much they can ask for at once, which is more than the SFTP default when sshfs is set to read more
+int mp::SftpServer::handle_limits(sftp_client_message msg)
+{
+    constexpr uint64_t packet_overhead = 1024, open_handles = 0; // no limit
+    std::string reply;
+    append_u64(reply, max_read_size + packet_overhead); // max-packet-length
+    append_u64(reply, max_read_size);                   // max-read-length
+    append_u64(reply, max_read_size);                   // max-write-length
+    append_u64(reply, open_handles);                    // max-open-handles
+
+    return reply_extended(sftp_server_session->channel, msg, reply);
+}
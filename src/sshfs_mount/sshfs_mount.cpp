@@ -22,6 +22,7 @@
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/sshfs_mount/sftp_server.h>
 #include <multipass/sshfs_mount/sshfs_mount.h>
+#include <multipass/sshfs_mount/sshfs_mount_profile.h>
 #include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
 
@@ -37,6 +38,7 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "sshfs mount";
+constexpr auto sftp_max_read_size = 64 * 1024; // sshfs asks for this much unless told otherwise
 const std::string fuse_version_string{"FUSE library version"};
 const std::string ld_library_path_key{"LD_LIBRARY_PATH="};
 const std::string snap_path_key{"SNAP="};
@@ -52,8 +54,10 @@ auto run_cmd(mp::SSHSession& session, std::string&& cmd)
     return ssh_process.read_std_output() + ssh_process.read_std_error();
 }
 
-auto get_sshfs_exec_and_options(mp::SSHSession& session)
+// What is learnt here holds for the whole instance, so that further mounts can skip asking again
+mp::SshfsInstanceInfo find_sshfs(mp::SSHSession& session)
 {
+    mp::SshfsInstanceInfo info;
     std::string sshfs_exec;
 
     try
@@ -85,41 +89,64 @@ auto get_sshfs_exec_and_options(mp::SSHSession& session)
         }
     }
 
-    sshfs_exec = mp::utils::trim_end(sshfs_exec);
+    info.sshfs_exec = mp::utils::trim_end(sshfs_exec);
 
-    auto version_info{run_cmd(session, fmt::format("sudo {} -V", sshfs_exec))};
-
-    sshfs_exec += " -o slave -o transform_symlinks -o allow_other -o Compression=no";
+    auto version_info{run_cmd(session, fmt::format("sudo {} -V", info.sshfs_exec))};
 
     auto fuse_version_line = mp::utils::match_line_for(version_info, fuse_version_string);
     if (!fuse_version_line.empty())
     {
-        std::string fuse_version;
-
         // split on the fuse_version_string along with 0 or 1 colon(s)
         auto tokens = mp::utils::split(fuse_version_line, fmt::format("{}:? ", fuse_version_string));
         if (tokens.size() == 2)
-            fuse_version = tokens[1];
+            info.fuse_version = tokens[1];
 
-        if (fuse_version.empty())
+        if (info.fuse_version.empty())
         {
             mpl::log(mpl::Level::warning, category, fmt::format("Unable to parse the {}", fuse_version_string));
             mpl::log(mpl::Level::debug, category, fmt::format("Unable to parse the {}: {}", fuse_version_string, fuse_version_line));
         }
+    }
+    else
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Unable to retrieve \'{}\'", fuse_version_string));
+    }
+
+    auto output = run_cmd(session, "id -u");
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("{}:{} {}(): `id -u` = {}", __FILE__, __LINE__, __FUNCTION__, output));
+    info.uid = std::stoi(output);
+
+    output = run_cmd(session, "id -g");
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("{}:{} {}(): `id -g` = {}", __FILE__, __LINE__, __FUNCTION__, output));
+    info.gid = std::stoi(output);
+
+    return info;
+}
+
+auto get_sshfs_exec_and_options(const mp::SshfsInstanceInfo& info, const mp::SSHFSMountProfile& profile)
+{
+    auto sshfs_exec = info.sshfs_exec + " -o slave -o transform_symlinks -o allow_other -o Compression=no";
+
+    if (!info.fuse_version.empty())
+    {
         // The option was made the default in libfuse 3.0
-        else if (version::Semver200_version(fuse_version) < version::Semver200_version("3.0.0"))
+        if (version::Semver200_version(info.fuse_version) < version::Semver200_version("3.0.0"))
         {
-            sshfs_exec += " -o nonempty -o cache_timeout=3";
+            sshfs_exec += fmt::format(" -o nonempty -o cache_timeout={}", profile.cache_timeout);
         }
         else
         {
-            sshfs_exec += " -o dcache_timeout=3";
+            sshfs_exec += fmt::format(" -o dcache_timeout={}", profile.cache_timeout);
         }
     }
-    else
-    {
-        mpl::log(mpl::Level::warning, category, fmt::format("Unable to retrieve \'{}\'", fuse_version_string));
-    }
+
+    if (profile.max_read > 0)
+        sshfs_exec += fmt::format(" -o max_read={}", profile.max_read);
+
+    if (profile.max_write > 0)
+        sshfs_exec += fmt::format(" -o max_write={}", profile.max_write);
 
     return sshfs_exec;
 }
@@ -170,45 +197,46 @@ void set_owner_for(mp::SSHSession& session, const std::string& root, const std::
 }
 
 auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const std::string& target,
-                      const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
+                      const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings,
+                      int attribute_cache_size, const mp::SSHFSMountProfile& profile, mp::SshfsInstanceInfo& info)
 {
     mpl::log(mpl::Level::debug, category,
              fmt::format("{}:{} {}(source = {}, target = {}, …): ", __FILE__, __LINE__, __FUNCTION__, source, target));
 
-    auto sshfs_exec_line = get_sshfs_exec_and_options(session);
+    if (info.sshfs_exec.empty())
+        info = find_sshfs(session);
+
+    auto sshfs_exec_line = get_sshfs_exec_and_options(info, profile);
 
     // Split the path in existing and missing parts.
     const auto& [leading, missing] = get_path_split(session, target);
 
-    auto output = run_cmd(session, "id -u");
-    mpl::log(mpl::Level::debug, category,
-             fmt::format("{}:{} {}(): `id -u` = {}", __FILE__, __LINE__, __FUNCTION__, output));
-    auto default_uid = std::stoi(output);
-
-    output = run_cmd(session, "id -g");
-    mpl::log(mpl::Level::debug, category,
-             fmt::format("{}:{} {}(): `id -g` = {}", __FILE__, __LINE__, __FUNCTION__, output));
-    auto default_gid = std::stoi(output);
-
     // We need to create the part of the path which does not still exist,
     // and set then the correct ownership.
     if (missing != ".")
     {
         make_target_dir(session, leading, missing);
-        set_owner_for(session, leading, missing, default_uid, default_gid);
+        set_owner_for(session, leading, missing, info.uid, info.gid);
     }
 
     return std::make_unique<mp::SftpServer>(std::move(session), source, leading + missing, gid_mappings, uid_mappings,
-                                            default_uid, default_gid, sshfs_exec_line);
+                                            info.uid, info.gid, sshfs_exec_line, profile.sftp_workers,
+                                            attribute_cache_size, std::max(profile.max_read, sftp_max_read_size),
+                                            profile.write_buffer_size, profile.forward_changes);
 }
 
 } // namespace
 
 mp::SshfsMount::SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-                           const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
-    : sftp_server{make_sftp_server(std::move(session), source, target, gid_mappings, uid_mappings)},
+                           const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings,
+                           int attribute_cache_size, const std::string& profile,
+                           const mp::optional<SshfsInstanceInfo>& known_info)
+    : info{known_info.value_or(SshfsInstanceInfo{})},
+      sftp_server{make_sftp_server(std::move(session), source, target, gid_mappings, uid_mappings,
+                                   attribute_cache_size, mp::sshfs_mount_profile(profile), info)},
       sftp_thread{[this]() {
           mp::top_catch_all(category, [this] {
+              std::cout << SshfsInstanceInfo::output_prefix << info.serialise() << std::endl;
               std::cout << "Connected" << std::endl;
               sftp_server->run();
               std::cout << "Stopped" << std::endl;
@@ -228,3 +256,26 @@ void mp::SshfsMount::stop()
     if (sftp_thread.joinable())
         sftp_thread.join();
 }
+
+std::string mp::SshfsInstanceInfo::serialise() const
+{
+    return fmt::format("{}:{}:{}:{}", uid, gid, fuse_version, sshfs_exec);
+}
+
+auto mp::SshfsInstanceInfo::deserialise(const std::string& text) -> optional<SshfsInstanceInfo>
+{
+    // The command comes last, for the colons in its library path not to get in the way
+    auto fields = QString::fromStdString(text);
+    bool uid_ok, gid_ok;
+
+    SshfsInstanceInfo info;
+    info.uid = fields.section(':', 0, 0).toInt(&uid_ok);
+    info.gid = fields.section(':', 1, 1).toInt(&gid_ok);
+    info.fuse_version = fields.section(':', 2, 2).toStdString();
+    info.sshfs_exec = fields.section(':', 3).toStdString();
+
+    if (!uid_ok || !gid_ok || info.sshfs_exec.empty())
+        return nullopt;
+
+    return info;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/sshfs_mount/sshfs_mount_profile.h>
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mp = multipass;
+
+namespace
+{
+// clang-format off
+// Bulk copies want few, large requests; many small files want long-lived guest caches and parallel lookups, and
+// the watchers that usually come with them want to hear about changes made on the host
+const std::unordered_map<std::string, mp::SSHFSMountProfile> profiles{
+    //                  max_read    max_write   write_buffer_size  cache_timeout  sftp_workers  forward_changes
+    {"default",        {0,          0,          256 * 1024,        3,             4,            false}},
+    {"bulk",           {128 * 1024, 128 * 1024, 1024 * 1024,       3,             2,            false}},
+    {"metadata-heavy", {0,          0,          64 * 1024,         30,            8,            true}}};
+// clang-format on
+} // namespace
+
+const mp::SSHFSMountProfile& mp::sshfs_mount_profile(const std::string& name)
+{
+    auto it = profiles.find(name.empty() ? default_sshfs_mount_profile : name);
+    if (it == profiles.end())
+        throw std::invalid_argument{
+            fmt::format("Unknown mount profile '{}', use 'default', 'bulk' or 'metadata-heavy'", name)};
+
+    return it->second;
+}
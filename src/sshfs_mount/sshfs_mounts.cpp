@@ -15,17 +15,24 @@
  *
  */
 
+#include <multipass/constants.h>
+#include <multipass/exceptions/settings_exceptions.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform.h>
+#include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_key_provider.h>
+#include <multipass/sshfs_mount/sshfs_mount.h>
 #include <multipass/sshfs_mount/sshfs_mounts.h>
 #include <multipass/sshfs_server_config.h>
 #include <multipass/utils.h>
 #include <multipass/virtual_machine.h>
 
 #include <QEventLoop>
+#include <QTimer>
+
+#include <vector>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -34,37 +41,139 @@ namespace
 {
 constexpr auto category = "sshfs-mounts";
 
-template <typename Signal>
-void start_and_block_until(mp::Process* process, Signal signal, std::function<bool(mp::Process* process)> ready_decider)
+// The servers connect at the same time, so that mounting several directories takes about as long as mounting one.
+// Returns what each printed until then.
+std::vector<QByteArray> start_and_block_until_connected(const std::vector<mp::Process*>& processes)
 {
     QEventLoop event_loop;
-    auto stop_conn =
-        QObject::connect(process, &mp::Process::finished, [&event_loop](mp::ProcessState) { event_loop.quit(); });
+    std::vector<QMetaObject::Connection> connections;
+    std::vector<QByteArray> outputs(processes.size());
+    std::vector<bool> settled(processes.size(), false);
+    auto pending = processes.size();
 
-    auto running_conn = QObject::connect(process, signal, [process, ready_decider, &event_loop]() {
-        if (ready_decider(process))
+    auto settle = [&settled, &pending, &event_loop](std::size_t i) {
+        if (!settled[i])
         {
-            event_loop.quit();
+            settled[i] = true;
+            if (--pending == 0)
+                event_loop.quit();
         }
-    });
+    };
+
+    for (std::size_t i = 0; i < processes.size(); ++i)
+    {
+        auto process = processes[i];
+        connections.push_back(
+            QObject::connect(process, &mp::Process::finished, [&settle, i](mp::ProcessState) { settle(i); }));
+        connections.push_back(
+            QObject::connect(process, &mp::Process::ready_read_standard_output, [&settle, &outputs, process, i]() {
+                outputs[i] += process->read_all_standard_output();
+                if (outputs[i].contains("Connected")) // Magic string printed by sshfs_server
+                    settle(i);
+            }));
+
+        process->start();
+    }
+
+    // This blocks and waits for each server to either connect or fail.
+    if (pending)
+        event_loop.exec();
 
-    process->start();
+    for (const auto& connection : connections)
+        QObject::disconnect(connection);
 
-    // This blocks and waits either ready_decider to return true, or failure.
-    event_loop.exec();
+    return outputs;
+}
+
+mp::optional<std::string> reported_instance_info(const QByteArray& output)
+{
+    const auto prefix = QByteArray{mp::SshfsInstanceInfo::output_prefix};
+    for (const auto& line : output.split('\n'))
+        if (line.startsWith(prefix))
+            return line.mid(prefix.size()).trimmed().toStdString();
 
-    QObject::disconnect(stop_conn);
-    QObject::disconnect(running_conn);
+    return mp::nullopt;
+}
+
+int mount_cache_size()
+{
+    try
+    {
+        return MP_SETTINGS.get(mp::mount_cache_key).toInt();
+    }
+    catch (const mp::SettingsException& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot read mount cache size: {}", e.what()));
+        return QString{mp::mount_cache_default}.toInt();
+    }
 }
 } // namespace
 
-mp::SSHFSMounts::SSHFSMounts(const SSHKeyProvider& key_provider) : key(key_provider.private_key_as_base64())
+mp::SSHFSMounts::SSHFSMounts(const SSHKeyProvider& key_provider, std::chrono::milliseconds stop_deadline)
+    : key(key_provider.private_key_as_base64()), stop_deadline{stop_deadline}
 {
 }
 
 void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
-                                  const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
+                                  const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings,
+                                  const std::string& profile)
 {
+    auto failures = start_mounts(vm, {{source_path, target_path, gid_mappings, uid_mappings, profile}});
+    if (!failures.empty())
+        std::rethrow_exception(failures.begin()->second);
+}
+
+auto mp::SSHFSMounts::start_mounts(VirtualMachine* vm, const std::vector<Mount>& mounts) -> Failures
+{
+    std::vector<qt_delete_later_unique_ptr<Process>> sshfs_server_processes;
+    std::vector<Process*> started;
+    for (const auto& mount : mounts)
+    {
+        sshfs_server_processes.push_back(make_server_process(vm, mount));
+        started.push_back(sshfs_server_processes.back().get());
+    }
+
+    auto outputs = start_and_block_until_connected(started);
+
+    Failures failures;
+    for (std::size_t i = 0; i < mounts.size(); ++i)
+    {
+        auto& sshfs_server_process = sshfs_server_processes[i];
+
+        // Check in case sshfs_server stopped, usually due to an error
+        auto process_state = sshfs_server_process->process_state();
+        if (process_state.exit_code == 9) // Magic number returned by sshfs_server
+        {
+            failures.emplace(mounts[i].target_path, std::make_exception_ptr(mp::SSHFSMissingError()));
+        }
+        else if (process_state.exit_code || process_state.error)
+        {
+            failures.emplace(mounts[i].target_path,
+                             std::make_exception_ptr(std::runtime_error(
+                                 fmt::format("{}: {}", process_state.failure_message(),
+                                             sshfs_server_process->read_all_standard_error()))));
+        }
+        else
+        {
+            if (auto info = reported_instance_info(outputs[i]))
+                instance_infos[vm->vm_name] = *info;
+
+            mount_processes[vm->vm_name][mounts[i].target_path] = std::move(sshfs_server_process);
+        }
+    }
+
+    // Whatever went wrong may have been down to what we thought we knew about the instance
+    if (!failures.empty())
+        instance_infos.erase(vm->vm_name);
+
+    return failures;
+}
+
+auto mp::SSHFSMounts::make_server_process(VirtualMachine* vm, const Mount& mount) -> qt_delete_later_unique_ptr<Process>
+{
+    const auto& source_path = mount.source_path;
+    const auto& target_path = mount.target_path;
+
     mp::SSHFSServerConfig config;
     config.host = vm->ssh_hostname();
     config.port = vm->ssh_port();
@@ -72,9 +181,14 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
     config.instance = vm->vm_name;
     config.target_path = target_path;
     config.source_path = source_path;
-    config.uid_mappings = uid_mappings;
-    config.gid_mappings = gid_mappings;
+    config.uid_mappings = mount.uid_mappings;
+    config.gid_mappings = mount.gid_mappings;
     config.private_key = key;
+    config.attribute_cache_size = mount_cache_size();
+    config.profile = mount.profile;
+
+    if (auto it = instance_infos.find(vm->vm_name); it != instance_infos.end())
+        config.instance_info = it->second;
 
     auto sshfs_server_process_t = mp::platform::make_sshfs_server_process(config);
     // FIXME: ProcessFactory really should return qt_delete_later_unique_ptr<Process> as Process emits signals
@@ -84,7 +198,7 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
 
     QObject::connect(
         sshfs_server_process.get(), &mp::Process::finished, this,
-        [this, instance = vm->vm_name, target_path](mp::ProcessState exit_state) {
+        [this, instance = vm->vm_name, target_path, process = sshfs_server_process.get()](mp::ProcessState exit_state) {
             if (exit_state.completed_successfully())
             {
                 mpl::log(mpl::Level::info, category,
@@ -98,7 +212,10 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
                                      instance, exit_state.failure_message()));
             }
 
-            mount_processes[instance].erase(target_path);
+            // Unless it was stopped, in which case the target may be served by a new one already
+            auto& instance_mounts = mount_processes[instance];
+            if (auto it = instance_mounts.find(target_path); it != instance_mounts.end() && it->second.get() == process)
+                instance_mounts.erase(it);
         });
 
     QObject::connect(
@@ -116,24 +233,7 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
     mpl::log(mpl::Level::info, category,
              fmt::format("process arguments '{}'", sshfs_server_process->arguments().join(", ").toStdString()));
 
-    start_and_block_until(
-        sshfs_server_process.get(), &mp::Process::ready_read_standard_output, [](mp::Process* process) {
-            return process->read_all_standard_output().contains("Connected"); // Magic string printed by sshfs_server
-        });
-
-    // Check in case sshfs_server stopped, usually due to an error
-    auto process_state = sshfs_server_process->process_state();
-    if (process_state.exit_code == 9) // Magic number returned by sshfs_server
-    {
-        throw mp::SSHFSMissingError();
-    }
-    else if (process_state.exit_code || process_state.error)
-    {
-        throw std::runtime_error(
-            fmt::format("{}: {}", process_state.failure_message(), sshfs_server_process->read_all_standard_error()));
-    }
-
-    mount_processes[vm->vm_name][target_path] = std::move(sshfs_server_process);
+    return sshfs_server_process;
 }
 
 bool mp::SSHFSMounts::stop_mount(const std::string& instance, const std::string& path)
@@ -148,10 +248,10 @@ bool mp::SSHFSMounts::stop_mount(const std::string& instance, const std::string&
     auto map_entry = sshfs_mount_map.find(path);
     if (map_entry != sshfs_mount_map.end())
     {
-        auto& sshfs_mount = map_entry->second;
         mpl::log(mpl::Level::info, category,
                  fmt::format("stopping sshfs_server for \"{}\" serving '{}'", instance, path));
-        sshfs_mount->terminate(); // TODO - if non-responsive, then kill()
+        stop_in_background(std::move(map_entry->second));
+        sshfs_mount_map.erase(map_entry);
         return true;
     }
     return false;
@@ -166,14 +266,30 @@ void mp::SSHFSMounts::stop_all_mounts_for_instance(const std::string& instance)
     }
     else
     {
+        // All asked at once, so that stopping many mounts takes about as long as stopping one
         for (auto& sshfs_mount : mounts_it->second)
         {
             mpl::log(mpl::Level::debug, category,
                      fmt::format("Stopping mount '{}' in instance \"{}\"", sshfs_mount.first, instance));
-            sshfs_mount.second->terminate();
+            stop_in_background(std::move(sshfs_mount.second));
         }
     }
     mount_processes[instance].clear();
+    instance_infos.erase(instance); // it may come back with a different sshfs, or none
+}
+
+void mp::SSHFSMounts::stop_in_background(qt_delete_later_unique_ptr<Process> sshfs_server_process)
+{
+    // Kept until it finishes, for the event loop never to block on its exit when it is deleted
+    auto process = sshfs_server_process.get();
+    QObject::connect(process, &mp::Process::finished, this, [this, process] { stopping_processes.erase(process); });
+    QTimer::singleShot(stop_deadline, process, [process] {
+        mpl::log(mpl::Level::warning, category, "sshfs_server did not stop in time, killing it");
+        process->kill();
+    });
+
+    stopping_processes.emplace(process, std::move(sshfs_server_process));
+    process->terminate();
 }
 
 bool mp::SSHFSMounts::has_instance_already_mounted(const std::string& instance, const std::string& path) const
@@ -81,7 +81,7 @@ mp::id_mappings convert_id_mappings(const char* in)
 
 int main(int argc, char* argv[])
 {
-    if (argc != 9)
+    if (argc != 11)
     {
         cerr << "Incorrect arguments" << endl;
         exit(2);
@@ -102,6 +102,11 @@ int main(int argc, char* argv[])
     const mp::id_mappings uid_mappings = convert_id_mappings(argv[6]);
     const mp::id_mappings gid_mappings = convert_id_mappings(argv[7]);
     const mpl::Level log_level = static_cast<mpl::Level>(atoi(argv[8]));
+    const int attribute_cache_size = atoi(argv[9]);
+    const auto profile = string(argv[10]);
+
+    // What an earlier mount in the same instance found out, if any
+    const auto instance_info = mp::SshfsInstanceInfo::deserialise(qgetenv("SSHFS_INSTANCE_INFO").toStdString());
 
     auto logger = mpp::make_logger(log_level);
     if (!logger)
@@ -116,7 +121,8 @@ int main(int argc, char* argv[])
         auto watchdog = mpp::make_quit_watchdog(); // called while there is only one thread
 
         mp::SSHSession session{host, port, username, mp::SSHClientKeyProvider{priv_key_blob}};
-        mp::SshfsMount sshfs_mount(move(session), source_path, target_path, gid_mappings, uid_mappings);
+        mp::SshfsMount sshfs_mount(move(session), source_path, target_path, gid_mappings, uid_mappings,
+                                   attribute_cache_size, profile, instance_info);
 
         // ssh lives on its own thread, use this thread to listen for quit signal
         if (int sig = watchdog())
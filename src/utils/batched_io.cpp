@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/batched_io.h>
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MULTIPASS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#endif
+
+namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+
+namespace
+{
+#ifdef MULTIPASS_IO_URING
+constexpr auto category = "batched io";
+constexpr unsigned ring_entries = 64;
+
+std::atomic<bool> unsupported{false};
+
+template <typename T>
+T* at(void* base, unsigned offset)
+{
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+class Ring
+{
+public:
+    Ring()
+    {
+        io_uring_params params{};
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, ring_entries, &params));
+        if (fd < 0)
+        {
+            if (errno == ENOSYS || errno == EPERM)
+                unsupported = true;
+
+            mpl::log(mpl::Level::debug, category, fmt::format("Cannot set up io_uring: {}", std::strerror(errno)));
+            return;
+        }
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+        // Since 5.4, both rings come out of a single mapping
+        const auto single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mapping)
+            sq_size = cq_size = std::max(sq_size, cq_size);
+
+        sq_ring = map(sq_size, IORING_OFF_SQ_RING);
+        cq_ring = single_mapping ? sq_ring : map(cq_size, IORING_OFF_CQ_RING);
+        sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+        if (!sq_ring || !cq_ring || !sqes)
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("Cannot map io_uring: {}", std::strerror(errno)));
+            release();
+            return;
+        }
+
+        entries = params.sq_entries;
+        sq_head = at<unsigned>(sq_ring, params.sq_off.head);
+        sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+        sq_mask = *at<unsigned>(sq_ring, params.sq_off.ring_mask);
+        sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+        cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+        cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+        cq_mask = *at<unsigned>(cq_ring, params.cq_off.ring_mask);
+        cqes = at<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+    }
+
+    ~Ring()
+    {
+        release();
+    }
+
+    bool valid() const
+    {
+        return fd >= 0;
+    }
+
+    bool run(std::vector<mpu::IoRequest>& requests)
+    {
+        std::vector<iovec> vectors(requests.size());
+        std::size_t queued = 0, completed = 0;
+        auto started = false;
+
+        while (completed < requests.size())
+        {
+            // The kernel copies what is queued when it is entered, so all that fits goes in ahead of each call
+            auto tail = *sq_tail;
+            const auto head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            while (queued < requests.size() && queued - completed < entries && tail - head < entries)
+            {
+                auto& request = requests[queued];
+                vectors[queued] = {request.data, request.size};
+
+                const auto index = tail & sq_mask;
+                auto& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe.fd = request.fd;
+                sqe.off = request.pos;
+                sqe.addr = reinterpret_cast<unsigned long long>(&vectors[queued]);
+                sqe.len = 1;
+                sqe.user_data = queued;
+                sq_array[index] = index;
+
+                ++tail;
+                ++queued;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+            const auto to_submit = tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            if (::syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+            {
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    // Nothing went out, so the caller can still take the slow road
+                    if (!started)
+                    {
+                        __atomic_store_n(sq_tail, __atomic_load_n(sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+                        return false;
+                    }
+
+                    const auto error = errno;
+                    mpl::log(mpl::Level::warning, category, fmt::format("io_uring failed: {}", std::strerror(error)));
+
+                    // What the kernel did not take is taken back and failed, what it did is still waited for
+                    const auto taken = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+                    for (auto i = queued - (tail - taken); i < requests.size(); ++i, ++completed)
+                        requests[i].result = -error;
+
+                    __atomic_store_n(sq_tail, taken, __ATOMIC_RELEASE);
+                    queued = requests.size();
+                }
+            }
+            else
+                started = true;
+
+            auto cq = *cq_head;
+            for (const auto end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE); cq != end; ++cq, ++completed)
+            {
+                const auto& cqe = cqes[cq & cq_mask];
+                requests[cqe.user_data].result = cqe.res;
+            }
+            __atomic_store_n(cq_head, cq, __ATOMIC_RELEASE);
+        }
+
+        return true;
+    }
+
+private:
+    void* map(std::size_t size, off_t offset)
+    {
+        auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    void release()
+    {
+        if (sqes)
+            ::munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring)
+            ::munmap(cq_ring, cq_size);
+        if (sq_ring)
+            ::munmap(sq_ring, sq_size);
+        if (fd >= 0)
+            ::close(fd);
+
+        sqes = nullptr;
+        cq_ring = sq_ring = nullptr;
+        fd = -1;
+    }
+
+    int fd{-1};
+    std::size_t sq_size{0}, cq_size{0}, sqes_size{0};
+    void* sq_ring{nullptr};
+    void* cq_ring{nullptr};
+    io_uring_sqe* sqes{nullptr};
+    unsigned entries{0};
+    unsigned* sq_head{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned sq_mask{0};
+    unsigned* sq_array{nullptr};
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    unsigned cq_mask{0};
+    io_uring_cqe* cqes{nullptr};
+};
+#endif
+} // namespace
+
+bool mpu::run_batched_io(std::vector<IoRequest>& requests)
+{
+#ifdef MULTIPASS_IO_URING
+    if (requests.empty())
+        return true;
+
+    if (unsupported)
+        return false;
+
+    // Rings are not to be shared between threads, but each only costs a few pages
+    thread_local std::unique_ptr<Ring> ring;
+    if (!ring)
+        ring = std::make_unique<Ring>();
+
+    return ring->valid() && ring->run(requests);
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/cgroups.h>
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+
+namespace
+{
+constexpr auto category = "cgroups";
+
+constexpr auto cpu_max_period = 100000; // microseconds, the kernel's default
+constexpr auto daemon_weight = 1000;    // ten times an instance's default, for the daemon to answer while they are busy
+const QStringList controllers{"cpu", "io", "memory"};
+
+QByteArray read_value(const QDir& dir, const QString& name)
+{
+    QFile file{dir.filePath(name)};
+    return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed() : QByteArray{};
+}
+
+bool write_value(const QDir& dir, const QString& name, const QByteArray& value)
+{
+    QFile file{dir.filePath(name)};
+    if (file.open(QIODevice::WriteOnly) && file.write(value) == value.size())
+        return true;
+
+    mpl::log(mpl::Level::warning, category, fmt::format("Cannot write {}: {}", file.fileName(), file.errorString()));
+    return false;
+}
+
+// For the cgroups under @p dir to use those controllers that the host has
+bool enable_controllers(const QDir& dir)
+{
+    const auto available = QString{read_value(dir, "cgroup.controllers")}.split(' ', QString::SkipEmptyParts);
+
+    QStringList enabled;
+    for (const auto& controller : controllers)
+        if (available.contains(controller))
+            enabled << "+" + controller;
+
+    return enabled.isEmpty() || write_value(dir, "cgroup.subtree_control", enabled.join(' ').toLatin1());
+}
+} // namespace
+
+auto mpu::own_cgroup(const QDir& cgroup_fs, const QString& proc_file) -> mp::optional<QDir>
+{
+    if (!QFile::exists(cgroup_fs.filePath("cgroup.controllers")))
+        return mp::nullopt;
+
+    QFile file{proc_file};
+    if (!file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    // The unified hierarchy is the one numbered 0, with no controllers named
+    for (const auto& line : file.readAll().split('\n'))
+        if (line.startsWith("0::"))
+            return QDir{cgroup_fs.absolutePath() + QString::fromUtf8(line.mid(3))};
+
+    return mp::nullopt;
+}
+
+auto mpu::set_up_cgroups(const QDir& own) -> mp::optional<QDir>
+{
+    if (!QFileInfo{own.filePath("cgroup.procs")}.isWritable() ||
+        !QFileInfo{own.filePath("cgroup.subtree_control")}.isWritable())
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("The cgroup {} was not delegated to the daemon, instances share it", own.path()));
+        return mp::nullopt;
+    }
+
+    // Controllers only apply to cgroups without processes of their own, so ours move to a child first
+    QDir daemon{own.filePath(daemon_cgroup)};
+    if (!own.mkpath(daemon_cgroup))
+        return mp::nullopt;
+
+    for (const auto& pid : read_value(own, "cgroup.procs").split('\n'))
+        if (!pid.isEmpty())
+            write_value(daemon, "cgroup.procs", pid); // one at a time, that is all the kernel takes
+
+    QDir instances{own.filePath(instances_cgroup)};
+    if (!enable_controllers(own) || !own.mkpath(instances_cgroup) || !enable_controllers(instances))
+        return mp::nullopt;
+
+    for (const auto& leftover : instances.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        remove_cgroup(QDir{instances.filePath(leftover)});
+
+    apply_resource_limits(daemon, mp::VMResourceLimits{daemon_weight, daemon_weight});
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Instances get their own cgroups in {}", instances.path()));
+    return instances;
+}
+
+bool mpu::apply_resource_limits(const QDir& dir, const VMResourceLimits& limits)
+{
+    if (!QDir{}.mkpath(dir.absolutePath()))
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot create the cgroup {}", dir.path()));
+        return false;
+    }
+
+    const auto memory_high = limits.memory_high ? QByteArray::number(limits.memory_high) : QByteArray{"max"};
+    const auto cpu_max = limits.cpu_max ? QByteArray::number(limits.cpu_max * cpu_max_period / 100) : QByteArray{"max"};
+
+    // All are tried, for a controller that the host lacks not to keep the others from applying
+    auto ok = write_value(dir, "cpu.weight", QByteArray::number(limits.cpu_weight));
+    ok = write_value(dir, "io.weight", "default " + QByteArray::number(limits.io_weight)) && ok;
+    ok = write_value(dir, "memory.high", memory_high) && ok;
+    ok = write_value(dir, "cpu.max", cpu_max + ' ' + QByteArray::number(cpu_max_period)) && ok;
+
+    return ok;
+}
+
+bool mpu::remove_cgroup(const QDir& dir)
+{
+    if (!QDir{}.rmdir(dir.absolutePath()))
+        return false;
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Removed the cgroup {}", dir.path()));
+    return true;
+}
@@ -15,9 +15,159 @@
  *
  */
 
+#include <multipass/batched_io.h>
 #include <multipass/file_ops.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+#include <unistd.h>
+#endif
+
 namespace mp = multipass;
+namespace mpu = multipass::utils;
+
+namespace
+{
+#ifdef __linux__
+int advice_for(mp::FileOps::Access access)
+{
+    switch (access)
+    {
+    case mp::FileOps::Access::sequential:
+        return POSIX_FADV_SEQUENTIAL;
+    case mp::FileOps::Access::random:
+        return POSIX_FADV_RANDOM;
+    case mp::FileOps::Access::will_need:
+        return POSIX_FADV_WILLNEED;
+    case mp::FileOps::Access::dont_need:
+        return POSIX_FADV_DONTNEED;
+    default:
+        return POSIX_FADV_NORMAL;
+    }
+}
+
+template <typename Call>
+int retry_interrupted(Call&& call)
+{
+    int r;
+    do
+        r = call();
+    while (r < 0 && errno == EINTR);
+
+    return r;
+}
+
+// QFile reads and writes through the descriptor's own offset, so looking for data or holes must put it back
+off_t seek_extent(int fd, off_t pos, int whence)
+{
+    const auto current = ::lseek(fd, 0, SEEK_CUR);
+    if (current < 0)
+        return -1;
+
+    const auto found = ::lseek(fd, pos, whence);
+    ::lseek(fd, current, SEEK_SET);
+    return found;
+}
+
+// Copies only what holds data, for the holes of sparse images to stay holes rather than be filled with zeros
+bool copy_data_extents(const mp::FileOps& ops, QFile& source, QFile& destination)
+{
+    for (auto data = ops.next_data(source, 0); data >= 0;)
+    {
+        const auto hole = ops.next_hole(source, data);
+        if (hole < 0 || ops.copy_range(source, data, destination, data, hole - data) != hole - data)
+            return false;
+
+        data = ops.next_data(source, hole);
+    }
+
+    return destination.resize(source.size());
+}
+
+// Creates the destination with the mode of the source, which must be a regular file, and never over an existing file
+bool create_copy_destination(QFile& source, QFile& destination)
+{
+    struct stat source_stat;
+    if (::fstat(source.handle(), &source_stat) < 0 || !S_ISREG(source_stat.st_mode))
+        return false;
+
+    const auto fd = ::open(QFile::encodeName(destination.fileName()).constData(),
+                           O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, source_stat.st_mode & 07777);
+    if (fd < 0)
+        return false;
+
+    if (destination.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle))
+        return true;
+
+    ::close(fd);
+    return false;
+}
+#endif
+
+// Has each of the files flushed, for a descriptor to see what QFile still buffers
+int flushed_handle(QFile& file)
+{
+    return file.flush() ? file.handle() : -1;
+}
+
+// Hands all transfers to the kernel at once, where it can take them that way
+bool run_batched(std::vector<mp::FileOps::Transfer>& transfers, bool write)
+{
+    std::vector<mpu::IoRequest> requests;
+    requests.reserve(transfers.size());
+    for (auto& transfer : transfers)
+    {
+        auto fd = flushed_handle(*transfer.file);
+        if (fd < 0)
+            return false;
+
+        requests.push_back({fd, transfer.data, static_cast<std::size_t>(transfer.size), transfer.pos, write});
+    }
+
+    if (!mpu::run_batched_io(requests))
+        return false;
+
+    for (std::size_t i = 0; i < transfers.size(); ++i)
+        transfers[i].result = requests[i].result;
+
+    return true;
+}
+
+qint64 copy_range_through_buffer(QFile& source, qint64 source_pos, QFile& destination, qint64 destination_pos,
+                                 qint64 len)
+{
+    constexpr qint64 buffer_size = 1024 * 1024;
+    std::vector<char> buffer(std::clamp<qint64>(len, 0, buffer_size));
+
+    qint64 copied = 0;
+    while (copied < len)
+    {
+        const auto read = MP_FILEOPS.read_at(source, buffer.data(), std::min(len - copied, buffer_size),
+                                             source_pos + copied);
+        if (read < 0)
+            return -1;
+        if (read == 0) // the end of the source
+            break;
+
+        if (MP_FILEOPS.write_at(destination, buffer.data(), read, destination_pos + copied) != read)
+            return -1;
+
+        copied += read;
+    }
+
+    return copied;
+}
+} // namespace
 
 mp::FileOps::FileOps(const Singleton<FileOps>::PrivatePass& pass) noexcept : Singleton<FileOps>::Singleton{pass}
 {
@@ -38,6 +188,42 @@ bool mp::FileOps::rmdir(QDir& dir, const QString& dirName) const
     return dir.rmdir(dirName);
 }
 
+// Only a hint, which platforms without one are free to ignore
+bool mp::FileOps::advise(QFile& file, qint64 pos, qint64 len, Access access) const
+{
+#ifdef __linux__
+    if (auto fd = flushed_handle(file); fd >= 0)
+        return ::posix_fadvise(fd, pos, len, advice_for(access)) == 0;
+#endif
+
+    return false;
+}
+
+// Reserves the blocks of the range, for writing there not to fail for lack of space, and grows the file to cover it
+bool mp::FileOps::allocate(QFile& file, qint64 pos, qint64 len) const
+{
+#ifdef __linux__
+    if (auto fd = flushed_handle(file); fd >= 0 && retry_interrupted([&] { return ::fallocate(fd, 0, pos, len); }) == 0)
+        return true;
+#endif
+
+    // Where blocks cannot be reserved, the file still ends up at least as long
+    return file.size() >= pos + len || file.resize(pos + len);
+}
+
+// Shares all of the source's extents with the destination, on filesystems that can (btrfs, XFS), and fails otherwise
+bool mp::FileOps::clone(QFile& source, QFile& destination) const
+{
+#if defined(__linux__) && defined(FICLONE)
+    const auto source_fd = flushed_handle(source);
+    const auto destination_fd = flushed_handle(destination);
+    if (source_fd >= 0 && destination_fd >= 0)
+        return ::ioctl(destination_fd, FICLONE, source_fd) == 0;
+#endif
+
+    return false;
+}
+
 bool mp::FileOps::exists(const QFile& file) const
 {
     return file.exists();
@@ -48,6 +234,113 @@ bool mp::FileOps::is_open(const QFile& file) const
     return file.isOpen();
 }
 
+// Shares the source's extents with the destination where the filesystem can, and otherwise has the kernel copy what
+// holds data, hole by hole. Like QFile::copy, which is left the files that neither works for, it never overwrites.
+bool mp::FileOps::copy(const QString& source, const QString& destination) const
+{
+#ifdef __linux__
+    QFile source_file{source}, destination_file{destination};
+    if (source_file.open(QIODevice::ReadOnly) && create_copy_destination(source_file, destination_file))
+    {
+        if (clone(source_file, destination_file) || copy_data_extents(*this, source_file, destination_file))
+            return true;
+
+        destination_file.remove();
+    }
+#endif
+
+    return QFile::copy(source, destination);
+}
+
+// Copies up to len bytes, stopping short at the end of the source, and returns how many it did or -1 on error. The
+// kernel copies them where it can, without bringing them to user space, and the filesystem may share or offload them.
+qint64 mp::FileOps::copy_range(QFile& source, qint64 source_pos, QFile& destination, qint64 destination_pos,
+                               qint64 len) const
+{
+    qint64 copied = 0;
+
+#ifdef __linux__
+    const auto source_fd = flushed_handle(source);
+    const auto destination_fd = flushed_handle(destination);
+    if (source_fd >= 0 && destination_fd >= 0)
+    {
+        while (copied < len)
+        {
+            loff_t source_offset = source_pos + copied, destination_offset = destination_pos + copied;
+            const auto r = ::copy_file_range(source_fd, &source_offset, destination_fd, &destination_offset,
+                                             len - copied, 0);
+            if (r == 0)
+                return copied;
+            if (r > 0)
+            {
+                copied += r;
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+
+            // Across filesystems and on older kernels, there is nothing for it but copying through user space
+            if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP)
+                return -1;
+
+            break;
+        }
+
+        if (copied == len)
+            return copied;
+    }
+#endif
+
+    const auto rest = copy_range_through_buffer(source, source_pos + copied, destination, destination_pos + copied,
+                                                len - copied);
+    return rest < 0 ? -1 : copied + rest;
+}
+
+bool mp::FileOps::hard_link(const QString& target, const QString& link_name) const
+{
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    return false;
+#else
+    return ::link(QFile::encodeName(target).constData(), QFile::encodeName(link_name).constData()) == 0;
+#endif
+}
+
+uchar* mp::FileOps::map(QFile& file, qint64 pos, qint64 len) const
+{
+    return file.map(pos, len);
+}
+
+// The start of the first data at or after pos, or -1 when there is none. Filesystems that cannot tell where the holes
+// are have the whole file as data.
+qint64 mp::FileOps::next_data(QFile& file, qint64 pos) const
+{
+#ifdef __linux__
+    if (auto fd = flushed_handle(file); fd >= 0)
+    {
+        if (auto data = seek_extent(fd, pos, SEEK_DATA); data >= 0 || errno == ENXIO)
+            return data;
+    }
+#endif
+
+    return pos < file.size() ? pos : -1;
+}
+
+// The start of the first hole at or after pos, which is the end of the file when there is no hole before it, or -1
+// when pos is past the end
+qint64 mp::FileOps::next_hole(QFile& file, qint64 pos) const
+{
+#ifdef __linux__
+    if (auto fd = flushed_handle(file); fd >= 0)
+    {
+        if (auto hole = seek_extent(fd, pos, SEEK_HOLE); hole >= 0 || errno == ENXIO)
+            return hole;
+    }
+#endif
+
+    const auto size = file.size();
+    return pos < size ? size : -1;
+}
+
 bool mp::FileOps::open(QFileDevice& file, QIODevice::OpenMode mode) const
 {
     return file.open(mode);
@@ -58,6 +351,72 @@ QFileDevice::Permissions mp::FileOps::permissions(const QFile& file) const
     return file.permissions();
 }
 
+// Frees the blocks of the range, which reads as zeros from then on, without changing the size of the file
+bool mp::FileOps::punch_hole(QFile& file, qint64 pos, qint64 len) const
+{
+#ifdef __linux__
+    constexpr auto mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+    if (auto fd = flushed_handle(file);
+        fd >= 0 && retry_interrupted([&] { return ::fallocate(fd, mode, pos, len); }) == 0)
+        return true;
+#endif
+
+    // Filesystems without holes get the zeros written out
+    const auto end = std::min(pos + len, file.size());
+    const std::vector<char> zeros(std::min<qint64>(std::max<qint64>(end - pos, 0), 1024 * 1024));
+    for (auto at = pos; at < end;)
+    {
+        const auto written = write_at(file, zeros.data(), std::min<qint64>(end - at, zeros.size()), at);
+        if (written <= 0)
+            return false;
+
+        at += written;
+    }
+
+    return true;
+}
+
+qint64 mp::FileOps::read_at(QFile& file, char* data, qint64 maxSize, qint64 pos) const
+{
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    // A positioned read leaves the file offset alone and saves the separate seek system call
+    if (auto fd = file.handle(); fd >= 0 && file.flush())
+    {
+        ssize_t r;
+        do
+            r = ::pread(fd, data, maxSize, pos);
+        while (r < 0 && errno == EINTR);
+
+        if (r >= 0)
+            return r;
+    }
+#endif
+
+    // Let Qt retry, so that errors are reported through the file's errorString
+    return file.seek(pos) ? file.read(data, maxSize) : -1;
+}
+
+void mp::FileOps::read_batch(std::vector<Transfer>& reads) const
+{
+    // What failed is tried again, for errors to be reported through the files' errorString
+    auto batched = run_batched(reads, false);
+    for (auto& read : reads)
+        if (!batched || read.result < 0)
+            read.result = read_at(*read.file, read.data, read.size, read.pos);
+}
+
+bool mp::FileOps::sync(QFile& file) const
+{
+    if (!file.flush())
+        return false;
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    return true;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
 qint64 mp::FileOps::read(QFile& file, char* data, qint64 maxSize) const
 {
     return file.read(data, maxSize);
@@ -103,11 +462,46 @@ qint64 mp::FileOps::size(QFile& file) const
     return file.size();
 }
 
+bool mp::FileOps::unmap(QFile& file, uchar* address) const
+{
+    return file.unmap(address);
+}
+
 qint64 mp::FileOps::write(QFile& file, const char* data, qint64 maxSize) const
 {
     return file.write(data, maxSize);
 }
 
+qint64 mp::FileOps::write_at(QFile& file, const char* data, qint64 maxSize, qint64 pos) const
+{
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    if (auto fd = file.handle(); fd >= 0 && file.flush())
+    {
+        ssize_t r;
+        do
+            r = ::pwrite(fd, data, maxSize, pos);
+        while (r < 0 && errno == EINTR);
+
+        if (r >= 0)
+            return r;
+    }
+#endif
+
+    if (!file.seek(pos))
+        return -1;
+
+    auto r = file.write(data, maxSize);
+    return file.flush() ? r : -1;
+}
+
+void mp::FileOps::write_batch(std::vector<Transfer>& writes) const
+{
+    auto batched = run_batched(writes, true);
+    for (auto& write : writes)
+        if (!batched || write.result < 0)
+            write.result = write_at(*write.file, write.data, write.size, write.pos);
+}
+
 qint64 mp::FileOps::write(QFileDevice& file, const QByteArray& data) const
 {
     return file.write(data);
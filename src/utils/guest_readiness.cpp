@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/guest_readiness.h>
+
+namespace mp = multipass;
+
+std::string mp::GuestReadiness::port_for(Milestone milestone)
+{
+    switch (milestone)
+    {
+    case Milestone::booting:
+        return "io.multipass.booting";
+    case Milestone::ssh_up:
+        return "io.multipass.ssh-up";
+    case Milestone::initialized:
+        return "io.multipass.initialized";
+    }
+
+    return {};
+}
+
+void mp::GuestReadiness::set_offered(bool offered)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    this->offered = offered;
+}
+
+bool mp::GuestReadiness::is_offered() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return offered;
+}
+
+void mp::GuestReadiness::reach(Milestone milestone)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        milestones.insert(milestone);
+    }
+    cv.notify_all();
+}
+
+void mp::GuestReadiness::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        milestones.clear();
+        ++boots;
+    }
+    cv.notify_all();
+}
+
+bool mp::GuestReadiness::reached(Milestone milestone) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return milestones.count(milestone) > 0;
+}
+
+bool mp::GuestReadiness::wait_for(Milestone milestone, std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    const auto boot = boots;
+    cv.wait_for(lock, timeout, [this, milestone, boot] { return milestones.count(milestone) || boots != boot; });
+
+    return milestones.count(milestone) > 0;
+}
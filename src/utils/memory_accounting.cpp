@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/memory_accounting.h>
+#include <multipass/vm_image_info.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonValue>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpu = multipass::utils;
+
+namespace
+{
+long long page_size()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    return ::sysconf(_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+
+std::size_t estimated_size(const QJsonValue& value);
+
+std::size_t estimated_size(const QJsonArray& array)
+{
+    std::size_t size = sizeof(QJsonArray);
+    for (const auto& element : array)
+        size += estimated_size(element);
+
+    return size;
+}
+
+std::size_t estimated_size(const QJsonValue& value)
+{
+    switch (value.type())
+    {
+    case QJsonValue::String:
+        return sizeof(QJsonValue) + mpu::estimated_size(value.toString());
+    case QJsonValue::Array:
+        return sizeof(QJsonValue) + estimated_size(value.toArray());
+    case QJsonValue::Object:
+        return sizeof(QJsonValue) + mpu::estimated_size(value.toObject());
+    default:
+        return sizeof(QJsonValue);
+    }
+}
+
+std::string in_mebibytes(long long bytes)
+{
+    return fmt::format("{:.1f}MiB", bytes / (1024.0 * 1024.0));
+}
+} // namespace
+
+auto mpu::process_memory(const QString& statm_file) -> mp::optional<ProcessMemory>
+{
+    QFile file{statm_file};
+    if (!file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    // The total size comes first, then the resident set
+    const auto fields = file.readLine().simplified().split(' ');
+    if (fields.size() < 2)
+        return mp::nullopt;
+
+    bool ok = false;
+    const auto resident_pages = fields[1].toLongLong(&ok);
+    return ok ? mp::make_optional(ProcessMemory{resident_pages, page_size()}) : mp::nullopt;
+}
+
+std::size_t mpu::estimated_size(const QString& string)
+{
+    return sizeof(QString) + static_cast<std::size_t>(string.capacity()) * sizeof(QChar);
+}
+
+std::size_t mpu::estimated_size(const VMImageInfo& info)
+{
+    auto size = sizeof(VMImageInfo);
+    for (const auto& alias : info.aliases)
+        size += estimated_size(alias);
+
+    for (const auto* string : {&info.os, &info.release, &info.release_title, &info.image_location,
+                               &info.kernel_location, &info.initrd_location, &info.id, &info.stream_location,
+                               &info.version})
+        size += estimated_size(*string) - sizeof(QString); // the members themselves are in sizeof(VMImageInfo)
+
+    return size;
+}
+
+std::size_t mpu::estimated_size(const QJsonObject& object)
+{
+    std::size_t size = sizeof(QJsonObject);
+    for (auto it = object.begin(); it != object.end(); ++it)
+        size += estimated_size(it.key()) + ::estimated_size(it.value());
+
+    return size;
+}
+
+std::string mpu::MemoryAccount::summary() const
+{
+    fmt::memory_buffer summary;
+    fmt::format_to(summary, "resident {}", process ? in_mebibytes(process->resident_bytes()) : "unknown");
+
+    for (const auto& [component, bytes] : estimates)
+        fmt::format_to(summary, ", {} ~{}", component, in_mebibytes(static_cast<long long>(bytes)));
+
+    return fmt::to_string(summary);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/memory_merging.h>
+
+#include <QFile>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+
+namespace
+{
+constexpr auto category = "memory merging";
+
+// The kernel's defaults scan 100 pages every 20ms, which takes minutes to go over the memory of a single instance
+constexpr auto pages_to_scan = "1000";
+constexpr auto sleep_millisecs = "20";
+
+mp::optional<long long> read_number(const QDir& dir, const QString& name)
+{
+    QFile file{dir.filePath(name)};
+    if (!file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    bool ok = false;
+    auto number = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? mp::make_optional(number) : mp::nullopt;
+}
+
+bool write_value(const QDir& dir, const QString& name, const QByteArray& value)
+{
+    QFile file{dir.filePath(name)};
+    if (file.open(QIODevice::WriteOnly) && file.write(value) == value.size())
+        return true;
+
+    mpl::log(mpl::Level::warning, category, fmt::format("Cannot write {}: {}", file.fileName(), file.errorString()));
+    return false;
+}
+
+long long page_size()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    return ::sysconf(_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+} // namespace
+
+bool mpu::enable_memory_merging(const QDir& ksm_dir)
+{
+    if (!QFile::exists(ksm_dir.filePath("run")))
+    {
+        mpl::log(mpl::Level::info, category, "The host has no kernel samepage merging");
+        return false;
+    }
+
+    // Tuned first, for the scanner to start at the pace it is meant to keep
+    if (!write_value(ksm_dir, "pages_to_scan", pages_to_scan) ||
+        !write_value(ksm_dir, "sleep_millisecs", sleep_millisecs) || !write_value(ksm_dir, "run", "1"))
+        return false;
+
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("Merging memory, {} pages every {}ms", pages_to_scan, sleep_millisecs));
+    return true;
+}
+
+auto mpu::memory_merging_stats(const QDir& ksm_dir) -> mp::optional<MemoryMergingStats>
+{
+    const auto run = read_number(ksm_dir, "run");
+    const auto shared = read_number(ksm_dir, "pages_shared");
+    const auto sharing = read_number(ksm_dir, "pages_sharing");
+    const auto unshared = read_number(ksm_dir, "pages_unshared");
+    if (!run || !shared || !sharing || !unshared)
+        return mp::nullopt;
+
+    return MemoryMergingStats{*run == 1, *shared, *sharing, *unshared, page_size()};
+}
+
+long long mpu::host_memory_bytes()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    return static_cast<long long>(::sysconf(_SC_PHYS_PAGES)) * page_size();
+#else
+    return 0;
+#endif
+}
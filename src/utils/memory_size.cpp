@@ -17,10 +17,16 @@
 
 #include <multipass/exceptions/invalid_memory_size_exception.h>
 #include <multipass/memory_size.h>
+#include <multipass/optional.h>
 #include <multipass/utils.h>
 
 #include <multipass/format.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <string_view>
+
 namespace mp = multipass;
 
 namespace
@@ -29,35 +35,60 @@ constexpr auto kibi = 1024LL;
 constexpr auto mebi = kibi * kibi;
 constexpr auto gibi = mebi * kibi;
 
-long long in_bytes(const std::string& mem_value)
+constexpr std::array<std::pair<char, long long>, 3> units{{{'k', kibi}, {'m', mebi}, {'g', gibi}}};
+
+constexpr char lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Digits, then either a unit optionally followed by B or iB, or a bare B, in any case
+mp::optional<long long> parse_bytes(std::string_view mem_value) // TODO accept decimals
 {
-    QRegExp matcher("(\\d+)(?:([KMG])(?:i?B)?|B)?", Qt::CaseInsensitive); // TODO accept decimals
+    constexpr auto max = std::numeric_limits<long long>::max();
+
+    std::size_t i = 0;
+    long long val = 0;
+    for (; i < mem_value.size() && mem_value[i] >= '0' && mem_value[i] <= '9'; ++i)
+    {
+        const auto digit = mem_value[i] - '0';
+        if (val > (max - digit) / 10)
+            return mp::nullopt;
+
+        val = val * 10 + digit;
+    }
 
-    if (matcher.exactMatch(QString::fromStdString(mem_value)))
+    if (i == 0)
+        return mp::nullopt;
+
+    auto suffix = mem_value.substr(i);
+    if (!suffix.empty())
     {
-        auto val = matcher.cap(1).toLongLong(); // value is in the second capture (1st one is the whole match)
-        const auto unit = matcher.cap(2);       // unit in the third capture (idem)
-        if (!unit.isEmpty())
+        const auto unit = std::find_if(units.begin(), units.end(),
+                                       [c = lower(suffix[0])](const auto& entry) { return entry.first == c; });
+        if (unit != units.end())
         {
-            switch (unit.at(0).toLower().toLatin1())
-            {
-            case 'g':
-                val *= gibi;
-                break;
-            case 'm':
-                val *= mebi;
-                break;
-            case 'k':
-                val *= kibi;
-                break;
-            default:
-                assert(false && "Shouldn't be here (invalid unit)");
-            }
+            if (val > max / unit->second)
+                return mp::nullopt;
+
+            val *= unit->second;
+            suffix.remove_prefix(1);
+            if (!suffix.empty() && lower(suffix[0]) == 'i' && suffix.size() == 2)
+                suffix.remove_prefix(1);
         }
 
-        return val;
+        if (suffix.size() > 1 || (suffix.size() == 1 && lower(suffix[0]) != 'b'))
+            return mp::nullopt;
     }
 
+    return val;
+}
+
+long long in_bytes(const std::string& mem_value)
+{
+    if (auto bytes = parse_bytes(mem_value))
+        return *bytes;
+
     throw mp::InvalidMemorySizeException{mem_value};
 }
 } // namespace
@@ -70,6 +101,13 @@ mp::MemorySize::MemorySize(const std::string& val) : bytes{::in_bytes(val)}
 {
 }
 
+mp::MemorySize mp::MemorySize::from_bytes(long long value) noexcept
+{
+    MemorySize ret;
+    ret.bytes = value;
+    return ret;
+}
+
 long long mp::MemorySize::in_bytes() const noexcept
 {
     return bytes;
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/performance_counters.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace mp = multipass;
+
+namespace
+{
+std::string escaped(const std::string& value)
+{
+    std::string ret;
+    for (auto c : value)
+    {
+        if (c == '\\' || c == '"')
+            ret += '\\';
+
+        if (c == '\n')
+            ret += "\\n";
+        else
+            ret += c;
+    }
+
+    return ret;
+}
+
+std::string render(const mp::PerformanceCounters::Labels& labels)
+{
+    std::vector<std::string> pairs;
+    for (const auto& [name, value] : labels)
+        pairs.push_back(fmt::format("{}=\"{}\"", name, escaped(value)));
+
+    return fmt::format("{}", fmt::join(pairs, ","));
+}
+
+std::string braced(const std::string& labels)
+{
+    return labels.empty() ? labels : fmt::format("{{{}}}", labels);
+}
+
+std::string with_bound(const std::string& labels, const std::string& bound)
+{
+    return fmt::format("{{{}{}le=\"{}\"}}", labels, labels.empty() ? "" : ",", bound);
+}
+} // namespace
+
+mp::PerformanceCounters::PerformanceCounters(const Singleton<PerformanceCounters>::PrivatePass& pass) noexcept
+    : Singleton<PerformanceCounters>::Singleton{pass}
+{
+}
+
+auto mp::PerformanceCounters::counter(const std::string& family, const Labels& labels) -> Counter&
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return counters[family][render(labels)]; // map nodes do not move, so the reference stays good
+}
+
+void mp::PerformanceCounters::observe(const std::string& family, const Labels& labels,
+                                      std::chrono::duration<double> duration)
+{
+    const auto seconds = duration.count();
+    const auto bound = std::lower_bound(bucket_bounds.cbegin(), bucket_bounds.cend(), seconds);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& histogram = histograms[family][render(labels)];
+    if (bound != bucket_bounds.cend())
+        ++histogram.buckets[bound - bucket_bounds.cbegin()];
+    histogram.sum += seconds;
+    ++histogram.count;
+}
+
+void mp::PerformanceCounters::set(const std::string& gauge_family, const Labels& labels, double value)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    gauges[gauge_family][render(labels)] = value;
+}
+
+std::string mp::PerformanceCounters::openmetrics() const
+{
+    fmt::memory_buffer out;
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (const auto& [family, samples] : counters)
+    {
+        fmt::format_to(out, "# TYPE {} counter\n", family);
+        for (const auto& [labels, value] : samples)
+            fmt::format_to(out, "{}_total{} {}\n", family, braced(labels), value.load(std::memory_order_relaxed));
+    }
+
+    for (const auto& [family, samples] : gauges)
+    {
+        fmt::format_to(out, "# TYPE {} gauge\n", family);
+        for (const auto& [labels, value] : samples)
+            fmt::format_to(out, "{}{} {}\n", family, braced(labels), value);
+    }
+
+    for (const auto& [family, samples] : histograms)
+    {
+        fmt::format_to(out, "# TYPE {} histogram\n", family);
+        for (const auto& [labels, histogram] : samples)
+        {
+            std::uint64_t cumulative{0};
+            for (std::size_t i = 0; i < bucket_bounds.size(); ++i)
+            {
+                cumulative += histogram.buckets[i];
+                const auto bound = fmt::format("{:g}", bucket_bounds[i]);
+                fmt::format_to(out, "{}_bucket{} {}\n", family, with_bound(labels, bound), cumulative);
+            }
+
+            fmt::format_to(out, "{}_bucket{} {}\n", family, with_bound(labels, "+Inf"), histogram.count);
+            fmt::format_to(out, "{}_sum{} {}\n", family, braced(labels), histogram.sum);
+            fmt::format_to(out, "{}_count{} {}\n", family, braced(labels), histogram.count);
+        }
+    }
+
+    fmt::format_to(out, "# EOF\n");
+    return fmt::to_string(out);
+}
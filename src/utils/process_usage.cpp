@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <multipass/process_usage.h>
+
+#include <QFile>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpu = multipass::utils;
+
+namespace
+{
+// Field numbers as proc(5) gives them, counted from 1 at the pid
+constexpr auto utime_field = 14;
+constexpr auto stime_field = 15;
+
+QByteArray read_file(const QString& path)
+{
+    QFile file{path};
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray{};
+}
+} // namespace
+
+auto mpu::process_usage(qint64 pid, const QDir& proc_dir) -> mp::optional<ProcessUsage>
+{
+    const QDir dir{proc_dir.filePath(QString::number(pid))};
+    const auto stat = read_file(dir.filePath("stat"));
+    const auto statm = read_file(dir.filePath("statm")).split(' ');
+
+    // The command name comes second, within parentheses, and may hold spaces and parentheses of its own
+    const auto name_end = stat.lastIndexOf(')');
+    if (name_end < 0 || statm.size() < 2)
+        return mp::nullopt;
+
+    const auto fields = stat.mid(name_end + 1).simplified().split(' ');
+    constexpr auto first_field = 3; // what follows the command name
+    if (fields.size() <= stime_field - first_field)
+        return mp::nullopt;
+
+    bool utime_ok = false, stime_ok = false, resident_ok = false;
+    const auto utime = fields.at(utime_field - first_field).toLongLong(&utime_ok);
+    const auto stime = fields.at(stime_field - first_field).toLongLong(&stime_ok);
+    const auto resident = statm.at(1).toLongLong(&resident_ok);
+    if (!utime_ok || !stime_ok || !resident_ok)
+        return mp::nullopt;
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+    const long long ticks_per_second = ::sysconf(_SC_CLK_TCK), page_size = ::sysconf(_SC_PAGESIZE);
+#else
+    const long long ticks_per_second = 100, page_size = 4096;
+#endif
+    if (ticks_per_second <= 0 || page_size <= 0)
+        return mp::nullopt;
+
+    return ProcessUsage{utime + stime, ticks_per_second, resident, page_size};
+}
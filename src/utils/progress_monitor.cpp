@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/progress_monitor.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+namespace mp = multipass;
+
+namespace
+{
+struct Coalescer
+{
+    std::mutex mutex;
+    int type{-1};
+    int progress{0};
+    bool result{true};
+    std::chrono::steady_clock::time_point last_passed{};
+};
+
+struct Combiner
+{
+    std::mutex mutex;
+    std::vector<int> progress;
+    int passed{-1};
+    bool result{true};
+};
+} // namespace
+
+mp::ProgressMonitor mp::coalesced(ProgressMonitor monitor, std::chrono::milliseconds interval)
+{
+    auto coalescer = std::make_shared<Coalescer>();
+
+    return [monitor = std::move(monitor), interval, coalescer](int type, int progress) {
+        std::lock_guard<std::mutex> lock{coalescer->mutex}; // held while passing on, for updates to stay in order
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto changed = progress != coalescer->progress || progress < 0;
+        const auto due = now - coalescer->last_passed >= interval;
+        if (type == coalescer->type && !(changed && (due || progress == 100)))
+            return coalescer->result;
+
+        coalescer->type = type;
+        coalescer->progress = progress;
+        coalescer->last_passed = now;
+        return coalescer->result = monitor(type, progress);
+    };
+}
+
+std::vector<mp::ProgressMonitor> mp::combined(ProgressMonitor monitor, int type, const std::vector<int>& weights)
+{
+    auto combiner = std::make_shared<Combiner>();
+    combiner->progress.assign(weights.size(), 0);
+    const auto total = std::max(1, std::accumulate(weights.begin(), weights.end(), 0));
+
+    std::vector<ProgressMonitor> sources;
+    for (std::size_t source = 0; source < weights.size(); ++source)
+        sources.push_back([monitor, type, weights, total, combiner, source](int, int progress) {
+            std::lock_guard<std::mutex> lock{combiner->mutex}; // held while passing on, for updates to stay in order
+
+            if (progress >= 0)
+                combiner->progress[source] = progress;
+
+            long long sum = 0;
+            for (std::size_t i = 0; i < weights.size(); ++i)
+                sum += static_cast<long long>(weights[i]) * combiner->progress[i];
+
+            const auto percent = static_cast<int>(sum / total);
+            if (!combiner->result || percent == combiner->passed)
+                return combiner->result;
+
+            combiner->passed = percent;
+            return combiner->result = monitor(type, percent);
+        });
+
+    return sources;
+}
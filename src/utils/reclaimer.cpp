@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/reclaimer.h>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+namespace mpu = multipass::utils;
+
+namespace
+{
+constexpr auto category = "reclaimer";
+const QString reclaimed_tag{".reclaimed-"};
+
+// Only this thread's I/O is affected: Linux keeps the I/O priority per thread
+void lower_io_priority()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    constexpr int ioprio_who_process = 1, ioprio_class_idle = 3, ioprio_class_shift = 13;
+    if (::syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << ioprio_class_shift) != 0)
+        mpl::log(mpl::Level::debug, category, "Cannot lower the I/O priority of the reclaimer thread");
+#endif
+}
+
+class Reclaimer
+{
+public:
+    static Reclaimer& instance()
+    {
+        static Reclaimer reclaimer;
+        return reclaimer;
+    }
+
+    ~Reclaimer()
+    {
+        // What is left stays renamed, for the next run to pick up
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+            queue.clear();
+        }
+        changed.notify_all();
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void push(const QString& path)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            queue.push_back(path);
+            if (!worker.joinable())
+                worker = std::thread{&Reclaimer::run, this};
+        }
+        changed.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [this] { return queue.empty() && !busy; });
+    }
+
+private:
+    void run()
+    {
+        lower_io_priority();
+
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true)
+        {
+            changed.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+
+            auto path = queue.front();
+            queue.pop_front();
+            busy = true;
+
+            lock.unlock();
+            if (!QDir{path}.removeRecursively())
+                mpl::log(mpl::Level::warning, category, fmt::format("Could not remove all of {}", path));
+            lock.lock();
+
+            busy = false;
+            changed.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<QString> queue;
+    bool busy{false};
+    bool stopping{false};
+    std::thread worker;
+};
+
+QString hidden_sibling_of(const QFileInfo& info)
+{
+    static std::atomic<unsigned> count{0};
+    return info.dir().filePath(QString{".%1%2%3-%4"}
+                                   .arg(info.fileName(), reclaimed_tag)
+                                   .arg(QCoreApplication::applicationPid())
+                                   .arg(count++));
+}
+} // namespace
+
+void mpu::reclaim_in_background(const QString& path)
+{
+    QFileInfo info{path};
+    if (!info.exists())
+        return;
+
+    auto hidden = hidden_sibling_of(info);
+    if (!QDir{}.rename(info.absoluteFilePath(), hidden))
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("Cannot rename {}, removing it in place", path));
+        QDir{path}.removeRecursively();
+        return;
+    }
+
+    Reclaimer::instance().push(hidden);
+}
+
+void mpu::reclaim_leftovers(const QDir& dir)
+{
+    const auto filters = QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot;
+    for (const auto& entry : dir.entryInfoList({QString{".*%1*"}.arg(reclaimed_tag)}, filters))
+        Reclaimer::instance().push(entry.absoluteFilePath());
+}
+
+void mpu::wait_for_reclaimed()
+{
+    Reclaimer::instance().wait();
+}
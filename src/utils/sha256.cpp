@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sha256.h>
+
+#include <QFile>
+
+#include <openssl/evp.h>
+
+#include <future>
+#include <new>
+#include <stdexcept>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <fcntl.h>
+#endif
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr qint64 buffer_size = 8 << 20;      // few, large reads, which the kernel reads ahead of
+constexpr std::size_t buffer_alignment = 4096; // on page boundaries, for the kernel to copy whole pages to
+
+class AlignedBuffer : private mp::DisabledCopyMove
+{
+public:
+    AlignedBuffer() : data{static_cast<char*>(::operator new(buffer_size, std::align_val_t{buffer_alignment}))}
+    {
+    }
+
+    ~AlignedBuffer()
+    {
+        ::operator delete(data, std::align_val_t{buffer_alignment});
+    }
+
+    char* const data;
+};
+
+void init_sha256(EVP_MD_CTX* context)
+{
+    if (!EVP_DigestInit_ex(context, EVP_sha256(), nullptr))
+        throw std::runtime_error("Failed to initialize SHA-256");
+}
+} // namespace
+
+mp::Sha256::Sha256() : context{EVP_MD_CTX_new(), EVP_MD_CTX_free}
+{
+    if (context == nullptr)
+        throw std::runtime_error("Failed to allocate EVP_MD_CTX");
+
+    init_sha256(context.get());
+}
+
+void mp::Sha256::add_data(const char* data, qint64 size)
+{
+    if (!EVP_DigestUpdate(context.get(), data, size))
+        throw std::runtime_error("Failed to hash data");
+}
+
+void mp::Sha256::add_data(const QByteArray& data)
+{
+    add_data(data.constData(), data.size());
+}
+
+bool mp::Sha256::add_data(QIODevice& device)
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    if (auto file = qobject_cast<QFile*>(&device); file && file->handle() >= 0)
+        ::posix_fadvise(file->handle(), 0, 0, POSIX_FADV_SEQUENTIAL); // for the kernel to read further ahead
+#endif
+
+    AlignedBuffer buffers[2];
+    auto read = [&device](char* buffer) { return device.read(buffer, buffer_size); };
+
+    auto size = read(buffers[0].data);
+    for (auto current = 0; size > 0; current ^= 1)
+    {
+        auto next = std::async(std::launch::async, read, buffers[current ^ 1].data);
+        add_data(buffers[current].data, size);
+        size = next.get();
+    }
+
+    return size == 0;
+}
+
+void mp::Sha256::reset()
+{
+    init_sha256(context.get());
+}
+
+QByteArray mp::Sha256::result() const
+{
+    // Finalizing a copy leaves this one to take more data
+    std::unique_ptr<EVP_MD_CTX, decltype(EVP_MD_CTX_free)*> copy{EVP_MD_CTX_new(), EVP_MD_CTX_free};
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+
+    if (copy == nullptr || !EVP_MD_CTX_copy_ex(copy.get(), context.get()) ||
+        !EVP_DigestFinal_ex(copy.get(), digest, &length))
+        throw std::runtime_error("Failed to compute SHA-256");
+
+    return QByteArray{reinterpret_cast<const char*>(digest), static_cast<int>(length)};
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sparse_file.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace mp = multipass;
+
+bool mp::sparse::is_all_zero(const char* data, std::size_t size)
+{
+    std::size_t i = 0;
+
+    // Memory bandwidth is the limit here, so SSE2 and NEON, which every 64-bit CPU of theirs has, do as well as wider
+    // registers would, without having to pick the code at runtime
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; i + 64 <= size; i += 64)
+    {
+        const auto block = reinterpret_cast<const __m128i*>(data + i);
+        const auto ored = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(block), _mm_loadu_si128(block + 1)),
+                                       _mm_or_si128(_mm_loadu_si128(block + 2), _mm_loadu_si128(block + 3)));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(ored, _mm_setzero_si128())) != 0xFFFF)
+            return false;
+    }
+#elif defined(__aarch64__)
+    for (; i + 64 <= size; i += 64)
+    {
+        const auto block = reinterpret_cast<const uint8_t*>(data + i);
+        const auto ored = vorrq_u8(vorrq_u8(vld1q_u8(block), vld1q_u8(block + 16)),
+                                   vorrq_u8(vld1q_u8(block + 32), vld1q_u8(block + 48)));
+
+        if (vmaxvq_u8(ored))
+            return false;
+    }
+#endif
+
+    for (; i < size; ++i)
+        if (data[i])
+            return false;
+
+    return true;
+}
+
+mp::sparse::Writer::Writer(QFile& file) : file{file}, position{file.pos()}
+{
+}
+
+bool mp::sparse::Writer::write(const char* data, qint64 size)
+{
+    // Blocks are lined up with the file's, for the skipped ones to be whole blocks of the filesystem too
+    auto next_block_size = [](qint64 at, qint64 left) { return std::min(left, block_size - at % block_size); };
+
+    qint64 done = 0;
+    while (done < size)
+    {
+        auto length = next_block_size(position, size - done);
+        if (is_all_zero(data + done, length))
+        {
+            done += length;
+            position += length;
+            continue;
+        }
+
+        // What is not zeros goes out in one write, however many blocks it spans
+        auto run = length;
+        while (done + run < size)
+        {
+            length = next_block_size(position + run, size - done - run);
+            if (is_all_zero(data + done + run, length))
+                break;
+
+            run += length;
+        }
+
+        if ((file.pos() != position && !file.seek(position)) || file.write(data + done, run) != run)
+            return false;
+
+        done += run;
+        position += run;
+    }
+
+    return true;
+}
+
+bool mp::sparse::Writer::finish()
+{
+    if (!file.flush())
+        return false;
+
+    return file.size() >= position || file.resize(position);
+}
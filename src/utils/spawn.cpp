@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/performance_counters.h>
+#include <multipass/spawn.h>
+
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+#include <QProcess>
+#else
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#include <chrono>
+
+namespace mp = multipass;
+namespace mpu = multipass::utils;
+
+namespace
+{
+// Like BasicProcess's, for the two to add up
+mp::PerformanceCounters::Labels labels_for(const QString& program)
+{
+    return {{"program", QFileInfo{program}.fileName().toStdString()}};
+}
+
+mp::ProcessState failed(QProcess::ProcessError state, const QString& message)
+{
+    return mp::ProcessState{mp::nullopt, mp::ProcessState::Error{state, message}};
+}
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+mpu::SpawnResult run(const QString& program, const QStringList& arguments, const mpu::SpawnOptions& options)
+{
+    QProcess process;
+    if (options.merge_channels)
+        process.setProcessChannelMode(QProcess::MergedChannels);
+
+    process.start(program, arguments);
+    if (!process.waitForStarted(options.timeout))
+        return {failed(QProcess::FailedToStart, process.errorString()), {}, {}};
+
+    process.write(options.standard_input);
+    process.closeWriteChannel();
+
+    mpu::SpawnResult result;
+    if (!process.waitForFinished(options.timeout))
+    {
+        process.kill();
+        process.waitForFinished();
+        result.state = failed(QProcess::Timedout, "Process timed out");
+    }
+    else if (process.exitStatus() == QProcess::NormalExit)
+        result.state.exit_code = process.exitCode();
+    else
+        result.state = failed(QProcess::Crashed, process.errorString());
+
+    result.standard_output = process.readAllStandardOutput();
+    result.standard_error = process.readAllStandardError();
+    return result;
+}
+#else
+// Neither end survives exec: the child only gets what the file actions duplicate onto its standard streams
+class Pipe
+{
+public:
+    Pipe()
+    {
+        if (::pipe(ends) == 0)
+            for (auto end : ends)
+                ::fcntl(end, F_SETFD, FD_CLOEXEC);
+        else
+            ends[0] = ends[1] = -1;
+    }
+
+    ~Pipe()
+    {
+        close(read_end);
+        close(write_end);
+    }
+
+    bool ok() const
+    {
+        return ends[read_end] >= 0;
+    }
+
+    int operator[](int which) const
+    {
+        return ends[which];
+    }
+
+    void close(int which)
+    {
+        if (ends[which] >= 0)
+            ::close(ends[which]);
+        ends[which] = -1;
+    }
+
+    static constexpr int read_end = 0, write_end = 1;
+
+private:
+    int ends[2];
+};
+
+// Writing to a child that stopped reading must fail with EPIPE, rather than take the whole daemon down with SIGPIPE
+class BlockSigpipe
+{
+public:
+    BlockSigpipe()
+    {
+        sigemptyset(&sigpipe);
+        sigaddset(&sigpipe, SIGPIPE);
+        ::pthread_sigmask(SIG_BLOCK, &sigpipe, &previous);
+    }
+
+    ~BlockSigpipe()
+    {
+        sigset_t pending;
+        if (::sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) && !sigismember(&previous, SIGPIPE))
+        {
+            int signal;
+            ::sigwait(&sigpipe, &signal); // consume the one raised here, it is pending already
+        }
+
+        ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+
+private:
+    sigset_t sigpipe, previous;
+};
+
+// Moves the streams along until they are all closed, or until the deadline
+bool pump(Pipe& in, Pipe& out, Pipe* err, const QByteArray& input, mpu::SpawnResult& result,
+          std::chrono::steady_clock::time_point deadline)
+{
+    auto written = 0;
+    if (input.isEmpty())
+        in.close(Pipe::write_end);
+    else
+        ::fcntl(in[Pipe::write_end], F_SETFL, ::fcntl(in[Pipe::write_end], F_GETFL) | O_NONBLOCK);
+
+    auto drain = [](Pipe& pipe, QByteArray& into) {
+        char buffer[4096];
+        auto got = ::read(pipe[Pipe::read_end], buffer, sizeof(buffer));
+        if (got > 0)
+            into.append(buffer, got);
+        else if (got == 0 || (errno != EINTR && errno != EAGAIN))
+            pipe.close(Pipe::read_end);
+    };
+
+    while (true)
+    {
+        std::vector<pollfd> fds;
+        if (in[Pipe::write_end] >= 0)
+            fds.push_back({in[Pipe::write_end], POLLOUT, 0});
+        if (out[Pipe::read_end] >= 0)
+            fds.push_back({out[Pipe::read_end], POLLIN, 0});
+        if (err && (*err)[Pipe::read_end] >= 0)
+            fds.push_back({(*err)[Pipe::read_end], POLLIN, 0});
+
+        if (fds.empty())
+            return true;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0)
+            return false;
+
+        auto ready = ::poll(fds.data(), fds.size(), static_cast<int>(left.count()));
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            return false;
+
+        for (const auto& fd : fds)
+        {
+            if (!fd.revents)
+                continue;
+
+            if (fd.fd == in[Pipe::write_end])
+            {
+                auto put = ::write(fd.fd, input.constData() + written, input.size() - written);
+                if (put > 0)
+                    written += put;
+                if (written == input.size() || (put < 0 && errno != EINTR && errno != EAGAIN))
+                    in.close(Pipe::write_end);
+            }
+            else if (fd.fd == out[Pipe::read_end])
+                drain(out, result.standard_output);
+            else
+                drain(*err, result.standard_error);
+        }
+    }
+}
+
+mpu::SpawnResult run(const QString& program, const QStringList& arguments, const mpu::SpawnOptions& options)
+{
+    mpu::SpawnResult result;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{options.timeout};
+
+    Pipe in, out, err;
+    if (!in.ok() || !out.ok() || !err.ok())
+    {
+        result.state = failed(QProcess::FailedToStart, QString{"Cannot create pipes: %1"}.arg(std::strerror(errno)));
+        return result;
+    }
+
+    std::vector<QByteArray> strings{QFile::encodeName(program)};
+    for (const auto& argument : arguments)
+        strings.push_back(argument.toLocal8Bit());
+
+    std::vector<char*> argv;
+    for (auto& string : strings)
+        argv.push_back(string.data());
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[Pipe::read_end], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[Pipe::write_end], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, (options.merge_channels ? out : err)[Pipe::write_end], STDERR_FILENO);
+
+    // The daemon blocks and handles some signals itself, which helpers are not to inherit
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t mask, defaults;
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    for (auto signal : {SIGPIPE, SIGCHLD, SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGUSR1, SIGUSR2})
+        sigaddset(&defaults, signal);
+    posix_spawnattr_setsigmask(&attributes, &mask);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid;
+    auto error = ::posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (error)
+    {
+        result.state = failed(QProcess::FailedToStart, QString{"%1: %2"}.arg(program, std::strerror(error)));
+        return result;
+    }
+
+    // Our copies of the child's ends would keep the streams from ever closing
+    in.close(Pipe::read_end);
+    out.close(Pipe::write_end);
+    err.close(Pipe::write_end);
+    if (options.merge_channels)
+        err.close(Pipe::read_end);
+
+    bool timed_out;
+    {
+        BlockSigpipe block_sigpipe;
+        timed_out = !pump(in, out, options.merge_channels ? nullptr : &err, options.standard_input, result, deadline);
+    }
+
+    if (timed_out)
+        ::kill(pid, SIGKILL);
+
+    int status = 0;
+    pid_t waited;
+    do
+    {
+        waited = ::waitpid(pid, &status, timed_out ? 0 : WNOHANG);
+        if (waited == 0) // the child closed its streams, but has yet to exit
+        {
+            if (std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            else
+            {
+                ::kill(pid, SIGKILL);
+                timed_out = true;
+            }
+        }
+    } while (waited == 0 || (waited < 0 && errno == EINTR));
+
+    if (timed_out)
+        result.state = failed(QProcess::Timedout, "Process timed out");
+    else if (waited > 0 && WIFEXITED(status))
+        result.state.exit_code = WEXITSTATUS(status);
+    else
+        result.state = failed(QProcess::Crashed, "Process crashed");
+
+    return result;
+}
+#endif
+} // namespace
+
+mpu::SpawnResult mpu::spawn_and_wait(const QString& program, const QStringList& arguments, const SpawnOptions& options)
+{
+    const auto labels = labels_for(program);
+    const auto start = std::chrono::steady_clock::now();
+    ++MP_PERF_COUNTERS.counter("multipass_process_spawns", labels);
+
+    auto result = run(program, arguments, options);
+
+    const auto duration = std::chrono::steady_clock::now() - start;
+    if (!result.state.error || result.state.error->state != QProcess::FailedToStart)
+        MP_PERF_COUNTERS.observe("multipass_process_duration_seconds", labels, duration);
+    if (!result.state.completed_successfully())
+        ++MP_PERF_COUNTERS.counter("multipass_process_failures", labels);
+
+    return result;
+}
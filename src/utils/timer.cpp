@@ -18,80 +18,204 @@
 #include <multipass/timer.h>
 #include <multipass/top_catch_all.h>
 
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <utility>
+
 namespace mpu = multipass::utils;
 
-mpu::Timer::Timer(std::chrono::milliseconds timeout, std::function<void()> callback)
-    : timeout(timeout), callback(callback), current_state(TimerState::Stopped)
+namespace
 {
-}
+constexpr auto category = "timer";
+constexpr auto max_wait = std::chrono::hours{1}; // the longest single wait, which counts milliseconds in an int
+} // namespace
 
-mpu::Timer::~Timer()
+namespace multipass::utils
 {
-    multipass::top_catch_all("timer", [this]() { stop(); });
-}
-
-void mpu::Timer::start()
+class TimerService
 {
-    stop();
+public:
+    static TimerService& instance()
+    {
+        static auto* service = new TimerService; // never destroyed, so that static timers can still stop at exit
+        return *service;
+    }
 
-    current_state = TimerState::Running;
-    t = std::thread(&Timer::main, this);
-}
+    void add()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        ++timers;
+    }
 
-void mpu::Timer::main()
-{
-    auto remaining_time = timeout;
-    std::unique_lock<std::mutex> lk(cv_m);
-    while (current_state != TimerState::Stopped)
+    void remove(Timer& timer)
     {
-        auto start_time = std::chrono::system_clock::now();
-        if (current_state == TimerState::Running &&
-            MP_TIMER_SYNC_FUNCS.wait_for(cv, lk, remaining_time) == std::cv_status::timeout)
+        std::thread retired;
         {
-            current_state = TimerState::Stopped;
-            callback();
+            std::unique_lock<std::mutex> lock{mutex};
+            cancel(timer, lock);
+
+            // The worker goes with the last timer, unless that one dies in a callback, on the worker itself
+            if (--timers == 0 && worker.joinable() && worker.get_id() != std::this_thread::get_id())
+            {
+                ++generation;
+                retired = std::move(worker);
+            }
         }
-        else if (current_state == TimerState::Paused)
+        MP_TIMER_SYNC_FUNCS.notify_all(cv);
+
+        if (retired.joinable())
+            retired.join();
+    }
+
+    void start(Timer& timer)
+    {
         {
-            remaining_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                remaining_time - (std::chrono::system_clock::now() - start_time));
-            MP_TIMER_SYNC_FUNCS.wait(cv, lk);
+            std::unique_lock<std::mutex> lock{mutex};
+            cancel(timer, lock);
+            schedule(timer, timer.timeout);
+
+            if (!worker.joinable())
+                worker = std::thread{&TimerService::run, this, generation};
         }
+        MP_TIMER_SYNC_FUNCS.notify_all(cv);
     }
+
+    void pause(Timer& timer)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (timer.current_state != TimerState::Running)
+                return;
+
+            queue.erase({timer.deadline, &timer});
+            timer.remaining_time = std::max(std::chrono::milliseconds::zero(),
+                                            std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                timer.deadline - std::chrono::steady_clock::now()));
+            timer.current_state = TimerState::Paused;
+        }
+        MP_TIMER_SYNC_FUNCS.notify_all(cv);
+    }
+
+    void resume(Timer& timer)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (timer.current_state != TimerState::Paused)
+                return;
+
+            schedule(timer, timer.remaining_time);
+        }
+        MP_TIMER_SYNC_FUNCS.notify_all(cv);
+    }
+
+    void stop(Timer& timer)
+    {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            cancel(timer, lock);
+        }
+        MP_TIMER_SYNC_FUNCS.notify_all(cv);
+    }
+
+private:
+    TimerService() = default;
+
+    void schedule(Timer& timer, std::chrono::milliseconds after)
+    {
+        timer.deadline = std::chrono::steady_clock::now() + after;
+        timer.current_state = TimerState::Running;
+        queue.emplace(timer.deadline, &timer);
+    }
+
+    void cancel(Timer& timer, std::unique_lock<std::mutex>& lock)
+    {
+        if (timer.current_state == TimerState::Running)
+            queue.erase({timer.deadline, &timer});
+        timer.current_state = TimerState::Stopped;
+
+        // A callback under way is let finish, unless it is what stops its own timer
+        while (firing == &timer && worker.get_id() != std::this_thread::get_id())
+            MP_TIMER_SYNC_FUNCS.wait(cv, lock);
+    }
+
+    void run(unsigned long my_generation)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (my_generation == generation)
+        {
+            if (queue.empty())
+            {
+                MP_TIMER_SYNC_FUNCS.wait(cv, lock);
+                continue;
+            }
+
+            const auto next = *queue.begin();
+            if (auto now = std::chrono::steady_clock::now(); next.first > now)
+            {
+                auto wait = std::chrono::ceil<std::chrono::milliseconds>(next.first - now);
+                auto capped = std::min<std::chrono::milliseconds>(wait, max_wait);
+                auto status =
+                    MP_TIMER_SYNC_FUNCS.wait_for(cv, lock, std::chrono::duration<int, std::milli>{capped.count()});
+
+                // A wait that runs its course reaches the deadline, unless it was cut short or the queue changed
+                if (status == std::cv_status::no_timeout || wait > max_wait || queue.empty() || *queue.begin() != next)
+                    continue;
+            }
+
+            auto timer = next.second;
+            queue.erase(queue.begin());
+            timer->current_state = TimerState::Stopped;
+            firing = timer;
+
+            lock.unlock();
+            multipass::top_catch_all(category, timer->callback);
+            lock.lock();
+
+            firing = nullptr;
+            MP_TIMER_SYNC_FUNCS.notify_all(cv);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::set<std::pair<std::chrono::steady_clock::time_point, Timer*>> queue; // earliest deadline first
+    const Timer* firing{nullptr};
+    int timers{0};               // alive, whether running or not
+    unsigned long generation{0}; // of the worker, which quits once this moves on
+    std::thread worker;          // started with the first timer, retired with the last
+};
+} // namespace multipass::utils
+
+mpu::Timer::Timer(std::chrono::milliseconds timeout, std::function<void()> callback)
+    : timeout(timeout), callback(callback), current_state(TimerState::Stopped), remaining_time(timeout)
+{
+    TimerService::instance().add();
+}
+
+mpu::Timer::~Timer()
+{
+    multipass::top_catch_all(category, [this]() { TimerService::instance().remove(*this); });
+}
+
+void mpu::Timer::start()
+{
+    TimerService::instance().start(*this);
 }
 
 void mpu::Timer::pause()
 {
-    {
-        std::lock_guard<std::mutex> lk(cv_m);
-        if (current_state != TimerState::Running)
-            return;
-        current_state = TimerState::Paused;
-    }
-    MP_TIMER_SYNC_FUNCS.notify_all(cv);
+    TimerService::instance().pause(*this);
 }
 
 void mpu::Timer::resume()
 {
-    {
-        std::lock_guard<std::mutex> lk(cv_m);
-        if (current_state != TimerState::Paused)
-            return;
-        current_state = TimerState::Running;
-    }
-    MP_TIMER_SYNC_FUNCS.notify_all(cv);
+    TimerService::instance().resume(*this);
 }
 
 void mpu::Timer::stop()
 {
-    {
-        std::lock_guard<std::mutex> lk(cv_m);
-        current_state = TimerState::Stopped;
-    }
-    MP_TIMER_SYNC_FUNCS.notify_all(cv);
-
-    if (t.joinable())
-        t.join();
+    TimerService::instance().stop(*this);
 }
 
 mpu::TimerSyncFuncs::TimerSyncFuncs(const Singleton<TimerSyncFuncs>::PrivatePass& pass) noexcept
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/tracing.h>
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace mp = multipass;
+namespace mpt = multipass::tracing;
+
+std::atomic<bool> mpt::detail::tracing_enabled{false};
+
+namespace
+{
+thread_local mpt::Context current_context;
+
+std::mutex mutex;
+std::unique_ptr<QFile> trace_file; // guarded by the mutex
+std::unordered_map<const void*, mpt::Context> attached;
+
+bool is_lower_hex(const std::string& value, std::size_t size)
+{
+    return value.size() == size &&
+           std::all_of(value.cbegin(), value.cend(), [](char c) {
+               return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+           }) &&
+           value.find_first_not_of('0') != std::string::npos; // all zeroes is invalid
+}
+
+std::string random_hex(int words)
+{
+    thread_local std::mt19937_64 generator{std::random_device{}()};
+
+    std::string ret;
+    for (auto i = 0; i < words; ++i)
+        ret += fmt::format("{:016x}", generator());
+
+    return ret;
+}
+
+long long micros(std::chrono::system_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+void write(const QJsonObject& event)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    if (trace_file)
+    {
+        // The array is left open, which the format allows, for the file to be good whenever the daemon stops
+        trace_file->write(QJsonDocument{event}.toJson(QJsonDocument::Compact) + ",\n");
+        trace_file->flush();
+    }
+}
+} // namespace
+
+bool mpt::Context::valid() const
+{
+    return is_lower_hex(trace_id, 32) && is_lower_hex(span_id, 16);
+}
+
+auto mpt::from_traceparent(const std::string& traceparent) -> Context
+{
+    // version-trace_id-parent_id-flags
+    if (traceparent.size() != 55 || traceparent.compare(0, 3, "00-") != 0 || traceparent[35] != '-' ||
+        traceparent[52] != '-')
+        return {};
+
+    Context context{traceparent.substr(3, 32), traceparent.substr(36, 16)};
+    return context.valid() ? context : Context{};
+}
+
+std::string mpt::to_traceparent(const Context& context)
+{
+    return context.valid() ? fmt::format("00-{}-{}-01", context.trace_id, context.span_id) : std::string{};
+}
+
+void mpt::enable(const QString& chrome_trace_file)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    detail::tracing_enabled = false;
+    trace_file.reset();
+    attached.clear();
+
+    if (chrome_trace_file.isEmpty())
+        return;
+
+    auto file = std::make_unique<QFile>(chrome_trace_file);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error{
+            fmt::format("Cannot open trace file \"{}\": {}", chrome_trace_file, file->errorString())};
+
+    file->write("[\n");
+    trace_file = std::move(file);
+    detail::tracing_enabled = true;
+}
+
+auto mpt::current() -> Context
+{
+    return current_context;
+}
+
+mpt::ContextScope::ContextScope(Context context) : previous{std::exchange(current_context, std::move(context))}
+{
+}
+
+mpt::ContextScope::~ContextScope()
+{
+    current_context = std::move(previous);
+}
+
+mpt::Span::Span(const char* category, std::string name) : Span(category, std::move(name), current_context)
+{
+}
+
+mpt::Span::Span(const char* category, std::string name, const Context& parent)
+{
+    if (!enabled())
+        return;
+
+    active = true;
+    this->category = category;
+    this->name = std::move(name);
+    this->parent = parent;
+    own = {parent.valid() ? parent.trace_id : random_hex(2), random_hex(1)};
+    previous = std::exchange(current_context, own);
+    start = std::chrono::system_clock::now();
+}
+
+mpt::Span::~Span()
+{
+    if (!active)
+        return;
+
+    const auto end = std::chrono::system_clock::now();
+    current_context = std::move(previous);
+
+    QJsonObject args{{"trace_id", QString::fromStdString(own.trace_id)},
+                     {"span_id", QString::fromStdString(own.span_id)}};
+    if (parent.valid())
+        args.insert("parent_span_id", QString::fromStdString(parent.span_id));
+
+    write({{"name", QString::fromStdString(name)},
+           {"cat", category},
+           {"ph", "X"},
+           {"ts", micros(start.time_since_epoch())},
+           {"dur", micros(end - start)},
+           {"pid", 1},
+           {"tid", static_cast<qint64>(std::hash<std::thread::id>{}(std::this_thread::get_id()) % 1000000)},
+           {"args", args}});
+}
+
+auto mpt::Span::context() const -> const Context&
+{
+    return active ? own : parent;
+}
+
+void mpt::attach(const void* call, const Context& context)
+{
+    if (!enabled())
+        return;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    attached[call] = context;
+}
+
+void mpt::detach(const void* call)
+{
+    if (!enabled())
+        return;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    attached.erase(call);
+}
+
+auto mpt::context_of(const void* call) -> Context
+{
+    if (!enabled())
+        return {};
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = attached.find(call);
+    return it != attached.cend() ? it->second : Context{};
+}
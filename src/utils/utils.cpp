@@ -22,13 +22,13 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/spawn.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/standard_paths.h>
 #include <multipass/utils.h>
 
 #include <QDir>
 #include <QFileInfo>
-#include <QProcess>
 #include <QRegularExpression>
 #include <QStorageInfo>
 #include <QSysInfo>
@@ -80,6 +80,28 @@ QString find_autostart_target(const QString& subdir, const QString& autostart_fi
 
     return target_path;
 }
+
+// How long to trust a guest that announces its milestones before probing it again regardless
+constexpr auto announcement_patience = 5s;
+
+void wait_for_announcement(const mp::GuestReadiness& readiness, mp::GuestReadiness::Milestone milestone,
+                           std::chrono::steady_clock::time_point deadline)
+{
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (remaining > 0ms && !readiness.reached(milestone))
+        readiness.wait_for(milestone, std::min<std::chrono::milliseconds>(remaining, announcement_patience));
+}
+
+std::pair<mp::ProcessState, QByteArray> run_merged(const QString& program, const QStringList& arguments, int timeout)
+{
+    mp::utils::SpawnOptions options;
+    options.timeout = timeout;
+    options.merge_channels = true;
+
+    auto result = mp::utils::spawn_and_wait(program, arguments, options);
+    return {result.state, result.standard_output};
+}
 } // namespace
 
 mp::Utils::Utils(const Singleton<Utils>::PrivatePass& pass) noexcept : Singleton<Utils>::Singleton{pass}
@@ -98,26 +120,18 @@ void mp::Utils::exit(int code)
 
 std::string mp::Utils::run_cmd_for_output(const QString& cmd, const QStringList& args, const int timeout) const
 {
-    QProcess proc;
-    proc.setProgram(cmd);
-    proc.setArguments(args);
-
-    proc.start();
-    proc.waitForFinished(timeout);
+    mp::utils::SpawnOptions options;
+    options.timeout = timeout;
 
-    return proc.readAllStandardOutput().trimmed().toStdString();
+    return mp::utils::spawn_and_wait(cmd, args, options).standard_output.trimmed().toStdString();
 }
 
 bool mp::Utils::run_cmd_for_status(const QString& cmd, const QStringList& args, const int timeout) const
 {
-    QProcess proc;
-    proc.setProgram(cmd);
-    proc.setArguments(args);
-
-    proc.start();
-    proc.waitForFinished(timeout);
+    mp::utils::SpawnOptions options;
+    options.timeout = timeout;
 
-    return proc.exitStatus() == QProcess::NormalExit && proc.exitCode() == 0;
+    return mp::utils::spawn_and_wait(cmd, args, options).state.completed_successfully();
 }
 
 void mp::Utils::make_file_with_content(const std::string& file_name, const std::string& content, const bool& overwrite)
@@ -142,8 +156,15 @@ void mp::Utils::make_file_with_content(const std::string& file_name, const std::
 void mp::Utils::wait_for_cloud_init(mp::VirtualMachine* virtual_machine, std::chrono::milliseconds timeout,
                                     const mp::SSHKeyProvider& key_provider) const
 {
-    auto action = [virtual_machine, &key_provider] {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto action = [virtual_machine, &key_provider, deadline] {
         virtual_machine->ensure_vm_is_running();
+
+        // Instances launched with our vendor data announce the end of cloud-init, where the backend carries that
+        const auto& readiness = virtual_machine->readiness;
+        if (readiness.is_offered() || readiness.reached(mp::GuestReadiness::Milestone::booting))
+            wait_for_announcement(readiness, mp::GuestReadiness::Milestone::initialized, deadline);
+
         try
         {
             mp::SSHSession session{virtual_machine->ssh_hostname(), virtual_machine->ssh_port(),
@@ -275,6 +296,65 @@ std::vector<std::string> mp::utils::split(const std::string& string, const std::
     return {std::sregex_token_iterator{string.begin(), string.end(), regex, -1}, std::sregex_token_iterator{}};
 }
 
+mp::utils::SplitView mp::utils::split_view(std::string_view string, std::string_view delimiter)
+{
+    return {string, delimiter};
+}
+
+mp::utils::SplitView::SplitView(std::string_view string, std::string_view delimiter)
+    : string{string}, delimiter{delimiter}
+{
+}
+
+auto mp::utils::SplitView::begin() const -> iterator
+{
+    return {string, delimiter};
+}
+
+auto mp::utils::SplitView::end() const -> iterator
+{
+    return {};
+}
+
+mp::utils::SplitView::iterator::iterator(std::string_view string, std::string_view delimiter)
+    : rest{string}, delimiter{delimiter}, done{false}
+{
+    ++*this;
+}
+
+auto mp::utils::SplitView::iterator::operator++() -> iterator&
+{
+    if (rest.empty())
+    {
+        done = true;
+        return *this;
+    }
+
+    const auto at = delimiter.empty() ? std::string_view::npos : rest.find(delimiter);
+    token = rest.substr(0, at);
+    rest = at == std::string_view::npos ? std::string_view{} : rest.substr(at + delimiter.size());
+
+    return *this;
+}
+
+auto mp::utils::SplitView::iterator::operator++(int) -> iterator
+{
+    auto ret = *this;
+    ++*this;
+    return ret;
+}
+
+bool mp::utils::SplitView::iterator::operator==(const iterator& other) const
+{
+    // Tokens are told apart by where they start, whatever their contents
+    return done == other.done && (done || token.data() == other.token.data());
+}
+
+bool mp::utils::SplitView::iterator::operator!=(const iterator& other) const
+{
+    return !(*this == other);
+}
+
 std::string mp::utils::generate_mac_address()
 {
     std::default_random_engine gen;
@@ -299,8 +379,15 @@ void mp::utils::wait_until_ssh_up(VirtualMachine* virtual_machine, std::chrono::
                                   std::function<void()> const& ensure_vm_is_running)
 {
     mpl::log(mpl::Level::debug, virtual_machine->vm_name, "Waiting for SSH to be up");
-    auto action = [virtual_machine, &ensure_vm_is_running] {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto action = [virtual_machine, &ensure_vm_is_running, deadline] {
         ensure_vm_is_running();
+
+        // Once the guest says its hooks are in place, it also tells when sshd is up
+        const auto& readiness = virtual_machine->readiness;
+        if (readiness.reached(mp::GuestReadiness::Milestone::booting))
+            wait_for_announcement(readiness, mp::GuestReadiness::Milestone::ssh_up, deadline);
+
         try
         {
             mp::SSHSession session{virtual_machine->ssh_hostname(1ms), virtual_machine->ssh_port()};
@@ -330,9 +417,9 @@ void mp::utils::install_sshfs_for(const std::string& name, mp::SSHSession& sessi
 {
     mpl::log(mpl::Level::info, category, fmt::format("Installing the multipass-sshfs snap in \'{}\'", name));
 
-    // Check if snap support is installed in the instance
-    auto which_proc = session.exec("which snap");
-    if (which_proc.exit_code() != 0)
+    // Check if snap support is installed in the instance, and if /snap exists for "classic" snap support, in one go
+    const auto checks = session.exec_batch({"which snap", "[ -e /snap ]"});
+    if (checks[0].exit_code != 0)
     {
         mpl::log(mpl::Level::warning, category, fmt::format("Snap support is not installed in \'{}\'", name));
         throw std::runtime_error(
@@ -345,9 +432,7 @@ void mp::utils::install_sshfs_for(const std::string& name, mp::SSHSession& sessi
                         name));
     }
 
-    // Check if /snap exists for "classic" snap support
-    auto test_file_proc = session.exec("[ -e /snap ]");
-    if (test_file_proc.exit_code() != 0)
+    if (checks[1].exit_code != 0)
     {
         mpl::log(mpl::Level::warning, category, fmt::format("Classic snap support symlink is needed in \'{}\'", name));
         throw std::runtime_error(
@@ -524,6 +609,14 @@ void mp::utils::validate_server_address(const std::string& address)
         throw std::runtime_error(fmt::format("invalid port number in address '{}'", address));
 }
 
+std::string mp::utils::local_server_address(const std::string& server_address)
+{
+    if (server_address.rfind("unix:", 0) != 0)
+        return {};
+
+    return server_address + ".local";
+}
+
 std::string mp::utils::filename_for(const std::string& path)
 {
     return QFileInfo(QString::fromStdString(path)).fileName().toStdString();
@@ -569,45 +662,35 @@ void mp::utils::check_and_create_config_file(const QString& config_file_path)
 void mp::utils::process_throw_on_error(const QString& program, const QStringList& arguments, const QString& message,
                                        const QString& category, const int timeout)
 {
-    QProcess process;
     mpl::log(mpl::Level::debug, category.toStdString(),
              fmt::format("Running: {}, {}", program.toStdString(), arguments.join(", ").toStdString()));
-    process.setProcessChannelMode(QProcess::MergedChannels);
-    process.start(program, arguments);
-    auto success = process.waitForFinished(timeout);
+    auto [state, output] = run_merged(program, arguments, timeout);
 
-    if (!success || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+    if (!state.completed_successfully())
     {
         mpl::log(mpl::Level::debug, category.toStdString(),
-                 fmt::format("{} failed - errorString: {}, exitStatus: {}, exitCode: {}", program.toStdString(),
-                             process.errorString().toStdString(), process.exitStatus(), process.exitCode()));
+                 fmt::format("{} failed - {}", program.toStdString(), state.failure_message().toStdString()));
 
-        auto output = process.readAllStandardOutput();
         throw std::runtime_error(fmt::format(
-            message.toStdString(), output.isEmpty() ? process.errorString().toStdString() : output.toStdString()));
+            message.toStdString(), output.isEmpty() ? state.failure_message().toStdString() : output.toStdString()));
     }
 }
 
 bool mp::utils::process_log_on_error(const QString& program, const QStringList& arguments, const QString& message,
                                      const QString& category, mpl::Level level, const int timeout)
 {
-    QProcess process;
     mpl::log(mpl::Level::debug, category.toStdString(),
              fmt::format("Running: {}, {}", program.toStdString(), arguments.join(", ").toStdString()));
-    process.setProcessChannelMode(QProcess::MergedChannels);
-    process.start(program, arguments);
-    auto success = process.waitForFinished(timeout);
+    auto [state, output] = run_merged(program, arguments, timeout);
 
-    if (!success || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+    if (!state.completed_successfully())
     {
         mpl::log(mpl::Level::debug, category.toStdString(),
-                 fmt::format("{} failed - errorString: {}, exitStatus: {}, exitCode: {}", program.toStdString(),
-                             process.errorString().toStdString(), process.exitStatus(), process.exitCode()));
+                 fmt::format("{} failed - {}", program.toStdString(), state.failure_message().toStdString()));
 
-        auto output = process.readAllStandardOutput();
         mpl::log(level, category.toStdString(),
                  fmt::format(message.toStdString(),
-                             output.isEmpty() ? process.errorString().toStdString() : output.toStdString()));
+                             output.isEmpty() ? state.failure_message().toStdString() : output.toStdString()));
         return false;
     }
 
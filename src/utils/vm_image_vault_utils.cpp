@@ -15,12 +15,13 @@
  *
  */
 
+#include <multipass/file_ops.h>
 #include <multipass/format.h>
+#include <multipass/sha256.h>
 #include <multipass/vm_image_host.h>
 #include <multipass/vm_image_vault.h>
 #include <multipass/xz_image_decoder.h>
 
-#include <QCryptographicHash>
 #include <QFileInfo>
 
 #include <stdexcept>
@@ -44,7 +45,7 @@ QString mp::vault::copy(const QString& file_name, const QDir& output_dir)
     QFileInfo info{file_name};
     const auto source_name = info.fileName();
     auto new_path = output_dir.filePath(source_name);
-    QFile::copy(file_name, new_path);
+    MP_FILEOPS.copy(file_name, new_path);
     return new_path;
 }
 
@@ -57,13 +58,13 @@ void mp::vault::delete_file(const mp::Path& path)
 QString mp::vault::compute_image_hash(const mp::Path& image_path)
 {
     QFile image_file(image_path);
-    if (!image_file.open(QFile::ReadOnly))
+    if (!image_file.open(QFile::ReadOnly | QFile::Unbuffered)) // read straight into the hash's own buffers
     {
         throw std::runtime_error("Cannot open image file for computing hash");
     }
 
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    if (!hash.addData(&image_file))
+    Sha256 hash;
+    if (!hash.add_data(image_file))
     {
         throw std::runtime_error("Cannot read image file to compute hash");
     }
@@ -73,8 +74,11 @@ QString mp::vault::compute_image_hash(const mp::Path& image_path)
 
 void mp::vault::verify_image_download(const mp::Path& image_path, const QString& image_hash)
 {
-    auto computed_hash = compute_image_hash(image_path);
+    verify_image_hash(compute_image_hash(image_path), image_hash);
+}
 
+void mp::vault::verify_image_hash(const QString& computed_hash, const QString& image_hash)
+{
     if (computed_hash != image_hash)
     {
         throw std::runtime_error("Downloaded image hash does not match");
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/vsock.h>
+
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <QFile>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/vm_sockets.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto host_prefix = "vsock:";
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+int connect_within(int fd, unsigned cid, unsigned port, std::chrono::milliseconds timeout)
+{
+    sockaddr_vm address{};
+    address.svm_family = AF_VSOCK;
+    address.svm_cid = cid;
+    address.svm_port = port;
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+        return 0;
+    if (errno != EINPROGRESS)
+        return errno;
+
+    // Until the guest's driver is up, nothing answers at all, rather than refusing
+    pollfd poll_fd{fd, POLLOUT, 0};
+    const auto ready = ::poll(&poll_fd, 1, static_cast<int>(timeout.count()));
+    if (ready <= 0)
+        return ready == 0 ? ETIMEDOUT : errno;
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+        return errno;
+
+    return error;
+}
+#endif
+} // namespace
+
+std::string mp::vsock::host_for(unsigned cid)
+{
+    return fmt::format("{}{}", host_prefix, cid);
+}
+
+mp::optional<unsigned> mp::vsock::cid_in(const std::string& host)
+{
+    const std::string prefix{host_prefix};
+    if (host.compare(0, prefix.size(), prefix) != 0 || host.size() == prefix.size() ||
+        !std::isdigit(static_cast<unsigned char>(host[prefix.size()])))
+        return nullopt;
+
+    try
+    {
+        std::size_t parsed = 0;
+        const auto cid = std::stoull(host.substr(prefix.size()), &parsed);
+        if (parsed == host.size() - prefix.size() && cid <= std::numeric_limits<unsigned>::max())
+            return static_cast<unsigned>(cid);
+    }
+    catch (const std::logic_error&)
+    {
+    }
+
+    return nullopt;
+}
+
+bool mp::vsock::available()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    return QFile::exists("/dev/vhost-vsock");
+#else
+    return false;
+#endif
+}
+
+int mp::vsock::connect(unsigned cid, unsigned port, std::chrono::milliseconds timeout)
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    const auto fd = ::socket(AF_VSOCK, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        throw std::runtime_error(fmt::format("cannot create a vsock socket: {}", std::strerror(errno)));
+
+    // Back to blocking once connected, which is what libssh expects of the sockets it is given
+    const auto error = connect_within(fd, cid, port, timeout);
+    if (error != 0 || ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK) != 0)
+    {
+        const auto reason = std::strerror(error ? error : errno);
+        ::close(fd);
+        throw std::runtime_error(fmt::format("cannot connect to port {} of vsock {}: {}", port, cid, reason));
+    }
+
+    return fd;
+#else
+    throw std::runtime_error(fmt::format("cannot connect to port {} of vsock {}: not supported", port, cid));
+#endif
+}
+
+void mp::vsock::Endpoint::set_cid(optional<unsigned> cid)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    if (context_id != cid)
+        listening = false;
+
+    context_id = cid;
+}
+
+mp::optional<unsigned> mp::vsock::Endpoint::cid() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return context_id;
+}
+
+mp::optional<std::string> mp::vsock::Endpoint::ssh_host(unsigned port, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    if (!context_id)
+        return nullopt;
+
+    const auto cid = *context_id;
+    if (!listening)
+    {
+        lock.unlock(); // the probe can take the whole timeout
+        try
+        {
+#ifdef MULTIPASS_PLATFORM_LINUX
+            ::close(connect(cid, port, timeout));
+#else
+            connect(cid, port, timeout);
+#endif
+        }
+        catch (const std::runtime_error&)
+        {
+            return nullopt;
+        }
+
+        lock.lock();
+        if (context_id != cid)
+            return nullopt;
+
+        listening = true;
+    }
+
+    return host_for(cid);
+}
+
+void mp::vsock::Endpoint::reset()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    listening = false;
+}
@@ -20,7 +20,11 @@
 #include <multipass/rpc/multipass.grpc.pb.h>
 
 #include <multipass/format.h>
+#include <multipass/sparse_file.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <vector>
 
 namespace mp = multipass;
@@ -52,6 +56,304 @@ bool verify_decode(const xz_ret& ret)
 
     return true;
 }
+
+constexpr auto max_pending_chunks = 64u;
+constexpr auto max_size = 65536u;
+constexpr auto max_decoder_threads = 16u;
+constexpr auto stream_header_size = 12;
+constexpr auto stream_footer_size = 12;
+constexpr char stream_header_magic[] = {'\xfd', '7', 'z', 'X', 'Z', '\x00'};
+constexpr char stream_footer_magic[] = {'Y', 'Z'};
+
+// A block of an xz stream, as listed in the stream's index
+struct XzBlock
+{
+    qint64 offset;
+    quint64 unpadded_size;
+    qint64 uncompressed_offset;
+    quint64 uncompressed_size;
+};
+
+quint32 read_le32(const char* data)
+{
+    const auto bytes = reinterpret_cast<const unsigned char*>(data);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<quint32>(bytes[3]) << 24;
+}
+
+void append_le32(QByteArray& data, quint32 value)
+{
+    for (auto i = 0; i < 4; ++i)
+        data.append(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+bool read_vli(const char*& pos, const char* end, quint64& value)
+{
+    value = 0;
+    for (auto i = 0; i < 9 && pos != end; ++i)
+    {
+        const auto byte = static_cast<unsigned char>(*pos++);
+        value |= static_cast<quint64>(byte & 0x7f) << (7 * i);
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+void append_vli(QByteArray& data, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(static_cast<char>(value));
+}
+
+quint32 crc32_of(const QByteArray& data)
+{
+    return xz_crc32(reinterpret_cast<const uint8_t*>(data.constData()), data.size(), 0);
+}
+
+quint64 padded_size(quint64 size)
+{
+    return (size + 3) & ~quint64{3};
+}
+
+// Reads the block list from the index of a file holding a single xz stream. An empty list is returned when the file
+// is laid out in any other way, in which case it can only be decoded sequentially.
+std::vector<XzBlock> read_block_index(QFile& xz_file, QByteArray& stream_header)
+{
+    const auto file_size = xz_file.size();
+    if (file_size < stream_header_size + stream_footer_size || !xz_file.seek(0))
+        return {};
+
+    stream_header = xz_file.read(stream_header_size);
+    if (stream_header.size() != stream_header_size ||
+        std::memcmp(stream_header.constData(), stream_header_magic, sizeof(stream_header_magic)) != 0)
+        return {};
+
+    if (!xz_file.seek(file_size - stream_footer_size))
+        return {};
+
+    const auto footer = xz_file.read(stream_footer_size);
+    if (footer.size() != stream_footer_size ||
+        std::memcmp(footer.constData() + 10, stream_footer_magic, sizeof(stream_footer_magic)) != 0 ||
+        footer.mid(8, 2) != stream_header.mid(6, 2))
+        return {};
+
+    const auto index_size = (static_cast<qint64>(read_le32(footer.constData() + 4)) + 1) * 4;
+    const auto index_offset = file_size - stream_footer_size - index_size;
+    if (index_offset < stream_header_size || !xz_file.seek(index_offset))
+        return {};
+
+    const auto index = xz_file.read(index_size);
+    if (index.size() != index_size || index.at(0) != '\0' ||
+        crc32_of(index.left(index_size - 4)) != read_le32(index.constData() + index_size - 4))
+        return {};
+
+    auto pos = index.constData() + 1;
+    const auto end = index.constData() + index_size - 4;
+
+    quint64 record_count;
+    if (!read_vli(pos, end, record_count) || record_count > static_cast<quint64>(index_size))
+        return {};
+
+    std::vector<XzBlock> blocks;
+    qint64 offset = stream_header_size, uncompressed_offset = 0;
+    for (quint64 i = 0; i < record_count; ++i)
+    {
+        XzBlock block{offset, 0, uncompressed_offset, 0};
+        if (!read_vli(pos, end, block.unpadded_size) || !read_vli(pos, end, block.uncompressed_size))
+            return {};
+
+        offset += padded_size(block.unpadded_size);
+        uncompressed_offset += block.uncompressed_size;
+        blocks.push_back(block);
+    }
+
+    // The blocks must fill the space between the stream header and the index exactly
+    if (offset != index_offset)
+        return {};
+
+    return blocks;
+}
+
+// Builds an index and stream footer describing a stream that only holds the given block
+QByteArray make_single_block_stream_tail(const XzBlock& block, const QByteArray& stream_header)
+{
+    QByteArray index(1, '\0');
+    append_vli(index, 1);
+    append_vli(index, block.unpadded_size);
+    append_vli(index, block.uncompressed_size);
+    index.append(static_cast<int>(padded_size(index.size()) - index.size()), '\0');
+    append_le32(index, crc32_of(index));
+
+    QByteArray footer_fields;
+    append_le32(footer_fields, index.size() / 4 - 1);
+    footer_fields.append(stream_header.mid(6, 2));
+
+    QByteArray tail{index};
+    append_le32(tail, crc32_of(footer_fields));
+    tail.append(footer_fields);
+    tail.append(stream_footer_magic, sizeof(stream_footer_magic));
+
+    return tail;
+}
+
+// Decodes one block on its own, by wrapping it in a stream that holds nothing else, and writes it to its place in the
+// decoded file
+void decode_block(const QString& xz_file_path, const QString& decoded_file_path, const QByteArray& stream_header,
+                  const XzBlock& block)
+{
+    QFile xz_file{xz_file_path};
+    if (!xz_file.open(QIODevice::ReadOnly) || !xz_file.seek(block.offset))
+        throw std::runtime_error(fmt::format("failed to open {} for reading", xz_file_path));
+
+    QFile decoded_file{decoded_file_path};
+    if (!decoded_file.open(QIODevice::ReadWrite) || !decoded_file.seek(block.uncompressed_offset))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", decoded_file_path));
+
+    mp::sparse::Writer writer{decoded_file};
+    mp::XzImageDecoder::XzDecoderUPtr xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end};
+    const auto stream_tail = make_single_block_stream_tail(block, stream_header);
+    auto block_bytes_left = static_cast<qint64>(padded_size(block.unpadded_size));
+    auto header_fed = false, tail_fed = false;
+
+    auto next_input = [&]() -> QByteArray {
+        if (!header_fed)
+        {
+            header_fed = true;
+            return stream_header;
+        }
+
+        if (block_bytes_left > 0)
+        {
+            auto data = xz_file.read(std::min<qint64>(block_bytes_left, max_size));
+            block_bytes_left = data.isEmpty() ? 0 : block_bytes_left - data.size();
+            return data;
+        }
+
+        if (!tail_fed)
+        {
+            tail_fed = true;
+            return stream_tail;
+        }
+
+        return {};
+    };
+
+    struct xz_buf decode_buf
+    {
+    };
+
+    QByteArray read_data;
+    std::vector<char> write_data(max_size);
+
+    decode_buf.in = nullptr;
+    decode_buf.in_pos = 0;
+    decode_buf.in_size = 0;
+    decode_buf.out = reinterpret_cast<unsigned char*>(write_data.data());
+    decode_buf.out_pos = 0;
+    decode_buf.out_size = max_size;
+
+    while (true)
+    {
+        if (decode_buf.in_pos == decode_buf.in_size)
+        {
+            read_data = next_input();
+            decode_buf.in = reinterpret_cast<const unsigned char*>(read_data.constData());
+            decode_buf.in_pos = 0;
+            decode_buf.in_size = read_data.size();
+        }
+
+        if (!verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf)))
+        {
+            if (!writer.write(write_data.data(), decode_buf.out_pos) || !writer.finish())
+                throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
+            return;
+        }
+
+        if (decode_buf.out_pos == max_size)
+        {
+            if (!writer.write(write_data.data(), decode_buf.out_pos))
+                throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
+            decode_buf.out_pos = 0;
+        }
+    }
+}
+
+void decode_blocks_in_parallel(const QString& xz_file_path, const QString& decoded_file_path,
+                               const QByteArray& stream_header, const std::vector<XzBlock>& blocks,
+                               const mp::ProgressMonitor& monitor)
+{
+    const auto& last_block = blocks.back();
+
+    {
+        QFile decoded_file{decoded_file_path};
+        if (!decoded_file.open(QIODevice::WriteOnly) ||
+            !decoded_file.resize(last_block.uncompressed_offset + last_block.uncompressed_size))
+            throw std::runtime_error(fmt::format("failed to open {} for writing", decoded_file_path));
+    }
+
+    const auto thread_count =
+        std::min<std::size_t>({blocks.size(), std::max(1u, std::thread::hardware_concurrency()), max_decoder_threads});
+
+    std::atomic<std::size_t> next_block{0};
+    std::size_t blocks_done{0};
+    std::exception_ptr decode_error;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto worker = [&]() {
+        for (auto i = next_block++; i < blocks.size(); i = next_block++)
+        {
+            try
+            {
+                decode_block(xz_file_path, decoded_file_path, stream_header, blocks[i]);
+            }
+            catch (const std::exception&)
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                if (!decode_error)
+                    decode_error = std::current_exception();
+                next_block = blocks.size();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                ++blocks_done;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < thread_count; ++i)
+        workers.emplace_back(worker);
+
+    // Progress is reported from this thread only, as the monitor is not meant to be called concurrently
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        auto reported = blocks_done;
+        while (blocks_done < blocks.size() && !decode_error)
+        {
+            cv.wait(lock, [&] { return blocks_done != reported || decode_error; });
+            reported = blocks_done;
+
+            lock.unlock();
+            monitor(LaunchProgress::EXTRACT, 100 * reported / blocks.size());
+            lock.lock();
+        }
+    }
+
+    for (auto& worker_thread : workers)
+        worker_thread.join();
+
+    if (decode_error)
+        std::rethrow_exception(decode_error);
+}
 } // namespace
 
 mp::XzImageDecoder::XzImageDecoder(const Path& xz_file_path)
@@ -66,14 +368,27 @@ void mp::XzImageDecoder::decode_to(const Path& decoded_image_path, const Progres
     if (!xz_file.open(QIODevice::ReadOnly))
         throw std::runtime_error(fmt::format("failed to open {} for reading", xz_file.fileName()));
 
+    // Images compressed with multiple threads hold independent blocks, which can be decoded in parallel
+    QByteArray stream_header;
+    const auto blocks = read_block_index(xz_file, stream_header);
+    if (blocks.size() > 1)
+    {
+        xz_file.close();
+        decode_blocks_in_parallel(xz_file.fileName(), decoded_image_path, stream_header, blocks, monitor);
+        return;
+    }
+
+    if (!xz_file.seek(0))
+        throw std::runtime_error(fmt::format("failed to read {}", xz_file.fileName()));
+
     QFile decoded_file{decoded_image_path};
     if (!decoded_file.open(QIODevice::WriteOnly))
         throw std::runtime_error(fmt::format("failed to open {} for writing", decoded_file.fileName()));
 
+    mp::sparse::Writer writer{decoded_file};
     struct xz_buf decode_buf
     {
     };
-    const auto max_size = 65536u;
 
     std::vector<char> read_data, write_data;
     read_data.reserve(max_size);
@@ -102,14 +417,142 @@ void mp::XzImageDecoder::decode_to(const Path& decoded_image_path, const Progres
 
         if (!verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf)))
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
+            if (!writer.write(write_data.data(), decode_buf.out_pos) || !writer.finish())
+                throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
             return;
         }
 
         if (decode_buf.out_pos == max_size)
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
+            if (!writer.write(write_data.data(), decode_buf.out_pos))
+                throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
             decode_buf.out_pos = 0;
         }
     }
 }
+
+mp::XzStreamDecoder::XzStreamDecoder(const Path& decoded_file_path)
+    : decoded_file{decoded_file_path}, xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end}
+{
+    xz_crc32_init();
+    xz_crc64_init();
+
+    if (!decoded_file.open(QIODevice::WriteOnly))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", decoded_file.fileName()));
+
+    worker = std::thread(&XzStreamDecoder::decode, this);
+}
+
+mp::XzStreamDecoder::~XzStreamDecoder()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        input_done = true;
+    }
+    cv.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+bool mp::XzStreamDecoder::feed(const QByteArray& data)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    cv.wait(lock, [this] { return decoding_done || pending.size() < max_pending_chunks; });
+
+    // Anything arriving after the end of the xz stream is ignored
+    if (decoding_done)
+        return !failed;
+
+    pending.push_back(data);
+    lock.unlock();
+    cv.notify_all();
+
+    return true;
+}
+
+void mp::XzStreamDecoder::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        input_done = true;
+    }
+    cv.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+
+    if (decode_error)
+        std::rethrow_exception(decode_error);
+}
+
+void mp::XzStreamDecoder::decode()
+{
+    struct xz_buf decode_buf
+    {
+    };
+
+    QByteArray read_data;
+    std::vector<char> write_data(max_size);
+    mp::sparse::Writer writer{decoded_file};
+
+    decode_buf.in = nullptr;
+    decode_buf.in_pos = 0;
+    decode_buf.in_size = 0;
+    decode_buf.out = reinterpret_cast<unsigned char*>(write_data.data());
+    decode_buf.out_pos = 0;
+    decode_buf.out_size = max_size;
+
+    try
+    {
+        while (true)
+        {
+            if (decode_buf.in_pos == decode_buf.in_size)
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                cv.wait(lock, [this] { return input_done || !pending.empty(); });
+
+                // With no input left, keep running the decoder on an empty buffer so it flushes what it holds
+                // and reports a truncated stream as an error
+                read_data = pending.empty() ? QByteArray{} : std::move(pending.front());
+                if (!pending.empty())
+                    pending.pop_front();
+
+                lock.unlock();
+                cv.notify_all();
+
+                decode_buf.in = reinterpret_cast<const unsigned char*>(read_data.constData());
+                decode_buf.in_pos = 0;
+                decode_buf.in_size = read_data.size();
+            }
+
+            if (!verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf)))
+            {
+                if (!writer.write(write_data.data(), decode_buf.out_pos) || !writer.finish())
+                    throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
+                decoded_file.close();
+                break;
+            }
+
+            if (decode_buf.out_pos == max_size)
+            {
+                if (!writer.write(write_data.data(), decode_buf.out_pos))
+                    throw std::runtime_error(fmt::format("failed to write {}", decoded_file.fileName()));
+                decode_buf.out_pos = 0;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        decode_error = std::current_exception();
+        failed = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        decoding_done = true;
+        pending.clear();
+    }
+    cv.notify_all();
+}
@@ -43,6 +43,7 @@ add_c_mocks(
   ssh_channel_request_pty
   ssh_channel_change_pty_size
   ssh_channel_read_timeout
+  ssh_channel_poll_timeout
   ssh_channel_get_exit_status
   ssh_event_dopoll
   ssh_add_channel_callbacks
@@ -68,8 +69,16 @@ add_c_mocks(
   sftp_open
   sftp_write
   sftp_read
+  sftp_async_read_begin
+  sftp_async_read
   sftp_free
   sftp_get_error
   sftp_close
   sftp_stat
+  sftp_mkdir
+  sftp_opendir
+  sftp_readdir
+  sftp_dir_eof
+  sftp_closedir
+  sftp_utimes
 )
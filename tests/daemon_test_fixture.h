@@ -393,7 +393,7 @@ struct DaemonTestFixture : public ::Test
             return std::make_unique<StubVirtualMachine>();
         });
 
-        ON_CALL(*mock_factory_ptr, prepare_source_image(_)).WillByDefault(ReturnArg<0>());
+        ON_CALL(*mock_factory_ptr, prepare_source_image(_, _)).WillByDefault(ReturnArg<0>());
 
         ON_CALL(*mock_factory_ptr, get_backend_version_string()).WillByDefault(Return("mock-1234"));
 
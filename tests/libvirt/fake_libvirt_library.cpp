@@ -53,6 +53,49 @@ int virConnectGetVersion(virConnectPtr /*conn*/, unsigned long* hvVer)
     return 0;
 }
 
+int virConnectIsAlive(virConnectPtr /*conn*/)
+{
+    return 1;
+}
+
+int virConnectSetKeepAlive(virConnectPtr /*conn*/, int /*interval*/, unsigned int /*count*/)
+{
+    return 0;
+}
+
+// Events are not followed unless a test says otherwise, so that instances ask for their state each time
+int virConnectDomainEventRegisterAny(virConnectPtr /*conn*/, virDomainPtr /*dom*/, int /*eventID*/,
+                                     virConnectDomainEventGenericCallback /*cb*/, void* /*opaque*/,
+                                     virFreeCallback /*freecb*/)
+{
+    return -1;
+}
+
+int virConnectDomainEventDeregisterAny(virConnectPtr /*conn*/, int /*callbackID*/)
+{
+    return 0;
+}
+
+int virEventRegisterDefaultImpl()
+{
+    return 0;
+}
+
+int virEventRunDefaultImpl()
+{
+    return 0;
+}
+
+int virEventAddTimeout(int /*timeout*/, virEventTimeoutCallback /*cb*/, void* /*opaque*/, virFreeCallback /*ff*/)
+{
+    return 1;
+}
+
+int virEventRemoveTimeout(int /*timer*/)
+{
+    return 0;
+}
+
 int virDomainCreate(virDomainPtr /*domain*/)
 {
     return 0;
@@ -85,6 +128,11 @@ char* virDomainGetXMLDesc(virDomainPtr /*domain*/, unsigned int /*flags*/)
     return strdup("mac");
 }
 
+const char* virDomainGetName(virDomainPtr /*domain*/)
+{
+    return "pied-piper-valley";
+}
+
 int virDomainHasManagedSaveImage(virDomainPtr /*domain*/, unsigned int /*flags*/)
 {
     return 0;
@@ -171,3 +219,64 @@ int virDomainSetMemoryFlags(virDomainPtr /*domain*/, unsigned long /*memory*/, u
 {
     return 1;
 }
+
+int virDomainMemoryStats(virDomainPtr /*domain*/, virDomainMemoryStatPtr /*stats*/, unsigned int /*nr_stats*/,
+                         unsigned int /*flags*/)
+{
+    return -1;
+}
+
+int virDomainGetGuestInfo(virDomainPtr /*domain*/, unsigned int /*types*/, virTypedParameterPtr* /*params*/,
+                          int* /*nparams*/, unsigned int /*flags*/)
+{
+    return -1;
+}
+
+void virTypedParamsFree(virTypedParameterPtr /*params*/, int /*nparams*/)
+{
+}
+
+virStoragePoolPtr virStoragePoolLookupByName(virConnectPtr /*conn*/, const char* /*name*/)
+{
+    return mpt::fake_handle<virStoragePoolPtr>();
+}
+
+int virStoragePoolFree(virStoragePoolPtr /*pool*/)
+{
+    return 0;
+}
+
+virStorageVolPtr virStorageVolCreateXML(virStoragePoolPtr /*pool*/, const char* /*xmlDesc*/, unsigned int /*flags*/)
+{
+    return mpt::fake_handle<virStorageVolPtr>();
+}
+
+virStorageVolPtr virStorageVolLookupByName(virStoragePoolPtr /*pool*/, const char* /*name*/)
+{
+    return nullptr;
+}
+
+virStorageVolPtr virStorageVolLookupByPath(virConnectPtr /*conn*/, const char* /*path*/)
+{
+    return nullptr;
+}
+
+char* virStorageVolGetPath(virStorageVolPtr /*vol*/)
+{
+    return strdup("");
+}
+
+int virStorageVolResize(virStorageVolPtr /*vol*/, unsigned long long /*capacity*/, unsigned int /*flags*/)
+{
+    return 0;
+}
+
+int virStorageVolDelete(virStorageVolPtr /*vol*/, unsigned int /*flags*/)
+{
+    return 0;
+}
+
+int virStorageVolFree(virStorageVolPtr /*vol*/)
+{
+    return 0;
+}
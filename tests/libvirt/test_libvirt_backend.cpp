@@ -18,6 +18,7 @@
 #include "tests/common.h"
 #include "tests/fake_handle.h"
 #include "tests/mock_backend_utils.h"
+#include "tests/mock_settings.h"
 #include "tests/mock_ssh.h"
 #include "tests/mock_status_monitor.h"
 #include "tests/stub_ssh_key_provider.h"
@@ -28,6 +29,7 @@
 #include <src/platform/backends/libvirt/libvirt_virtual_machine_factory.h>
 
 #include <multipass/auto_join_thread.h>
+#include <multipass/constants.h>
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/memory_size.h>
 #include <multipass/network_interface_info.h>
@@ -35,6 +37,7 @@
 #include <multipass/virtual_machine_description.h>
 
 #include <cstdlib>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpt = multipass::test;
@@ -128,6 +131,51 @@ TEST_F(LibVirtBackend, creates_in_suspended_state_with_managed_save)
     EXPECT_THAT(machine->current_state(), Eq(mp::VirtualMachine::State::suspended));
 }
 
+TEST_F(LibVirtBackend, removes_instance_volumes_from_the_storage_pool)
+{
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    EXPECT_CALL(*mock_settings, get(Eq(mp::libvirt_pool_key))).WillRepeatedly(Return("multipass"));
+
+    mp::LibVirtVirtualMachineFactory backend{data_dir.path(), fake_libvirt_path};
+
+    static std::string pool_name, volume_name;
+    static bool deleted;
+    pool_name.clear();
+    volume_name.clear();
+    deleted = false;
+
+    backend.libvirt_wrapper->virStoragePoolLookupByName = [](virConnectPtr, const char* name) {
+        pool_name = name;
+        return mpt::fake_handle<virStoragePoolPtr>();
+    };
+    backend.libvirt_wrapper->virStorageVolLookupByName = [](virStoragePoolPtr, const char* name) {
+        volume_name = name;
+        return mpt::fake_handle<virStorageVolPtr>();
+    };
+    backend.libvirt_wrapper->virStorageVolDelete = [](auto...) {
+        deleted = true;
+        return 0;
+    };
+
+    backend.remove_resources_for("pied-piper-valley");
+
+    EXPECT_EQ(pool_name, "multipass");
+    EXPECT_EQ(volume_name, "pied-piper-valley.qcow2");
+    EXPECT_TRUE(deleted);
+}
+
+TEST_F(LibVirtBackend, leaves_storage_pools_alone_without_one_set)
+{
+    mp::LibVirtVirtualMachineFactory backend{data_dir.path(), fake_libvirt_path};
+
+    backend.libvirt_wrapper->virStoragePoolLookupByName = [](auto...) -> virStoragePoolPtr {
+        ADD_FAILURE() << "the storage pool was looked up";
+        return nullptr;
+    };
+
+    backend.remove_resources_for("pied-piper-valley");
+}
+
 TEST_F(LibVirtBackend, machine_sends_monitoring_events)
 {
     REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
@@ -315,6 +363,40 @@ TEST_F(LibVirtBackend, current_state_off_domain_starts_running)
     EXPECT_THAT(machine->current_state(), Eq(mp::VirtualMachine::State::running));
 }
 
+TEST_F(LibVirtBackend, current_state_goes_by_pushed_lifecycle_events)
+{
+    static virConnectDomainEventGenericCallback lifecycle_callback = nullptr;
+    static void* lifecycle_opaque = nullptr;
+    static auto get_state_calls = 0;
+
+    mp::LibVirtVirtualMachineFactory backend{data_dir.path(), fake_libvirt_path};
+    backend.libvirt_wrapper->virConnectDomainEventRegisterAny = [](auto, auto, auto, auto cb, auto opaque, auto) {
+        lifecycle_callback = cb;
+        lifecycle_opaque = opaque;
+        return 1;
+    };
+    backend.libvirt_wrapper->virEventRunDefaultImpl = [] {
+        std::this_thread::sleep_for(1ms);
+        return 0;
+    };
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    auto machine = backend.create_virtual_machine(default_description, mock_monitor);
+    ASSERT_THAT(machine->current_state(), Eq(mp::VirtualMachine::State::off));
+    ASSERT_NE(lifecycle_callback, nullptr);
+
+    backend.libvirt_wrapper->virDomainGetState = [](auto, auto state, auto, auto) {
+        ++get_state_calls;
+        *state = VIR_DOMAIN_SHUTOFF;
+        return 0;
+    };
+    reinterpret_cast<virConnectDomainEventCallback>(lifecycle_callback)(
+        nullptr, mpt::fake_handle<virDomainPtr>(), VIR_DOMAIN_EVENT_STARTED, 0, lifecycle_opaque);
+
+    EXPECT_THAT(machine->current_state(), Eq(mp::VirtualMachine::State::running));
+    EXPECT_EQ(get_state_calls, 0);
+}
+
 TEST_F(LibVirtBackend, returns_version_string)
 {
     mp::LibVirtVirtualMachineFactory backend{data_dir.path(), fake_libvirt_path};
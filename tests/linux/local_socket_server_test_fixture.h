@@ -55,8 +55,29 @@ public:
         });
     }
 
+    // Answers every request on a connection, leaving the connection open
+    template <typename Handler>
+    void keep_alive_handler(Handler&& response_handler)
+    {
+        QObject::connect(&test_server, &QLocalServer::newConnection, [this, response_handler] {
+            auto client_connection = test_server.nextPendingConnection();
+            ++connections;
+
+            QObject::connect(client_connection, &QLocalSocket::readyRead, [client_connection, response_handler] {
+                client_connection->write(response_handler(client_connection->readAll()));
+                client_connection->flush();
+            });
+        });
+    }
+
+    int connection_count() const
+    {
+        return connections;
+    }
+
 private:
     QLocalServer test_server;
+    int connections{0};
 };
 } // namespace test
 } // namespace multipass
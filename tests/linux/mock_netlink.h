@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MULTIPASS_MOCK_NETLINK_H
+#define MULTIPASS_MOCK_NETLINK_H
+
+#include "tests/common.h"
+#include "tests/mock_singleton_helpers.h"
+
+#include <src/platform/backends/shared/linux/netlink.h>
+
+namespace multipass
+{
+namespace test
+{
+struct MockNetlink : public Netlink
+{
+    using Netlink::Netlink;
+
+    MOCK_CONST_METHOD1(link_exists, bool(const QString&));
+    MOCK_CONST_METHOD2(add_bridge, void(const QString&, const std::string&));
+    MOCK_CONST_METHOD2(add_tap, void(const QString&, bool));
+    MOCK_CONST_METHOD2(set_master, void(const QString&, const QString&));
+    MOCK_CONST_METHOD1(set_up, void(const QString&));
+    MOCK_CONST_METHOD3(add_address, void(const QString&, const std::string&, const std::string&));
+    MOCK_CONST_METHOD1(delete_link, void(const QString&));
+    MOCK_CONST_METHOD0(ipv4_neighbours, std::vector<Neighbour>());
+    MOCK_CONST_METHOD0(ipv4_routes, std::vector<Route>());
+    MOCK_CONST_METHOD2(answering_hosts,
+                       std::vector<std::string>(const std::vector<std::string>&, std::chrono::milliseconds));
+    MOCK_CONST_METHOD0(links_version, optional<unsigned long long>());
+
+    MP_MOCK_SINGLETON_BOILERPLATE(MockNetlink, Netlink);
+};
+} // namespace test
+} // namespace multipass
+#endif // MULTIPASS_MOCK_NETLINK_H
@@ -43,6 +43,11 @@ const auto apparmor_output_file = "/tmp/multipass-apparmor-profile.txt";
 const auto apparmor_profile_text = "profile test_apparmor_profile() { stuff }";
 class TestProcessSpec : public mp::ProcessSpec
 {
+public:
+    explicit TestProcessSpec(const QString& id = QString{}) : id{id}
+    {
+    }
+
     QString program() const override
     {
         return "test_prog";
@@ -55,6 +60,13 @@ class TestProcessSpec : public mp::ProcessSpec
     {
         return apparmor_profile_text;
     }
+    QString identifier() const override
+    {
+        return id;
+    }
+
+private:
+    const QString id;
 };
 } // namespace
 
@@ -127,12 +139,24 @@ TEST_F(ApparmoredProcessNoFactoryTest, no_output_file_when_no_apparmor)
     EXPECT_FALSE(QFile::exists(apparmor_output_file));
 }
 
-TEST_F(ApparmoredProcessTest, unloads_profile_with_apparmor_on_process_out_of_scope)
+TEST_F(ApparmoredProcessTest, keeps_profile_loaded_for_the_next_process)
 {
     auto process = process_factory.create_process(std::make_unique<TestProcessSpec>());
     process.reset();
+    QFile::remove(apparmor_output_file);
+
+    process = process_factory.create_process(std::make_unique<TestProcessSpec>());
+
+    // apparmor_parser should not have run again, neither to remove the profile nor to load it
+    EXPECT_FALSE(QFile::exists(apparmor_output_file));
+}
+
+TEST_F(ApparmoredProcessTest, unloads_least_recently_used_profile_past_idle_limit)
+{
+    for (auto i = 0; i < 17; ++i)
+        process_factory.create_process(std::make_unique<TestProcessSpec>(QString::number(i)));
 
-    // apparmor profile should have been removed
+    // the first profile should have been removed
     QFile apparmor_input(apparmor_output_file);
     ASSERT_TRUE(apparmor_input.open(QIODevice::ReadOnly | QIODevice::Text));
     auto input = apparmor_input.readAll();
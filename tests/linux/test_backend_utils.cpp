@@ -15,6 +15,8 @@
  *
  */
 
+#include "mock_netlink.h"
+
 #include "tests/common.h"
 #include "tests/mock_backend_utils.h"
 #include "tests/mock_file_ops.h"
@@ -492,10 +494,12 @@ TEST(LinuxBackendUtils, get_subnet_not_in_file_writes_new_subnet_returns_expecte
     auto [mock_utils, utils_guard] = mpt::MockUtils::inject();
     auto [mock_file_ops, file_ops_guard] = mpt::MockFileOps::inject();
 
+    auto [mock_netlink, netlink_guard] = mpt::MockNetlink::inject();
+
     EXPECT_CALL(*mock_utils, run_cmd_for_output(QString("ip"), QStringList({"-4", "route", "show"}), _))
-        .WillOnce(Return(""))
-        .WillOnce(Return("0.0.0.0"));
-    EXPECT_CALL(*mock_utils, run_cmd_for_status(QString("ping"), _, _)).WillRepeatedly(Return(false));
+        .WillOnce(Return(""));
+    EXPECT_CALL(*mock_netlink, ipv4_routes).WillOnce(Return(std::vector<mp::Netlink::Route>{}));
+    EXPECT_CALL(*mock_netlink, answering_hosts).WillOnce(Return(std::vector<std::string>{}));
 
     EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce(Return(true));
     EXPECT_CALL(*mock_file_ops, size(_)).WillOnce(Return(0));
@@ -507,3 +511,48 @@ TEST(LinuxBackendUtils, get_subnet_not_in_file_writes_new_subnet_returns_expecte
 
     EXPECT_EQ(MP_BACKEND.get_subnet("foo", bridge_name), generated_subnet);
 }
+
+TEST(LinuxBackendUtils, generate_random_subnet_skips_subnets_whose_gateways_answer)
+{
+    auto [mock_netlink, guard] = mpt::MockNetlink::inject();
+    std::vector<std::string> probed;
+
+    EXPECT_CALL(*mock_netlink, ipv4_routes).WillRepeatedly(Return(std::vector<mp::Netlink::Route>{}));
+    EXPECT_CALL(*mock_netlink, answering_hosts)
+        .WillOnce(ReturnArg<0>())
+        .WillOnce([&probed](const auto& hosts, auto) {
+            probed = hosts;
+            return std::vector<std::string>{hosts.cbegin(), hosts.cbegin() + 2}; // the first candidate's
+        });
+
+    const auto subnet = mp::backend::generate_random_subnet();
+
+    ASSERT_GE(probed.size(), 4u);
+    EXPECT_EQ(fmt::format("{}.1", subnet), probed[2]);
+}
+
+TEST(LinuxBackendUtils, generate_random_subnet_skips_subnets_in_local_routes)
+{
+    auto [mock_netlink, guard] = mpt::MockNetlink::inject();
+
+    std::vector<mp::Netlink::Route> routes;
+    for (auto i = 0; i < 256; ++i)
+        routes.push_back({fmt::format("10.{}.0.0", i), 16, "", ""});
+
+    EXPECT_CALL(*mock_netlink, ipv4_routes).WillRepeatedly(Return(routes));
+    EXPECT_CALL(*mock_netlink, answering_hosts).WillRepeatedly(Return(std::vector<std::string>{}));
+
+    MP_EXPECT_THROW_THAT(mp::backend::generate_random_subnet(), std::runtime_error,
+                         mpt::match_what(HasSubstr("Could not determine a subnet")));
+}
+
+TEST(LinuxBackendUtils, generate_random_subnet_ignores_catch_all_routes)
+{
+    auto [mock_netlink, guard] = mpt::MockNetlink::inject();
+
+    EXPECT_CALL(*mock_netlink, ipv4_routes)
+        .WillOnce(Return(std::vector<mp::Netlink::Route>{{"", 0, "192.168.1.1", ""}, {"10.0.0.0", 8, "", ""}}));
+    EXPECT_CALL(*mock_netlink, answering_hosts).WillOnce(Return(std::vector<std::string>{}));
+
+    EXPECT_THAT(mp::backend::generate_random_subnet(), StartsWith("10."));
+}
@@ -104,6 +104,9 @@ struct LocalNetworkAccessManager : public Test
         download_timeout.start();
         event_loop.exec();
 
+        download_timeout.stop();
+        download_timeout.disconnect(); // for the next request, if any
+
         return reply;
     }
 
@@ -204,10 +207,9 @@ TEST_F(LocalNetworkAccessManager, client_posts_correct_data)
     QByteArray expected_data{"POST /1.0 HTTP/1.1\r\n"
                              "Host: test\r\n"
                              "User-Agent: Test\r\n"
-                             "Connection: close\r\n"
                              "Content-Type: application/x-www-form-urlencoded\r\n"
                              "Content-Length: 11\r\n\r\n"
-                             "Hello World\r\n"};
+                             "Hello World"};
 
     QByteArray http_response{"HTTP/1.1 200 OK\r\n\r\n"};
 
@@ -221,6 +223,51 @@ TEST_F(LocalNetworkAccessManager, client_posts_correct_data)
     handle_request(base_url, "POST", "Hello World");
 }
 
+TEST_F(LocalNetworkAccessManager, reads_every_chunk_up_to_the_last)
+{
+    QByteArray http_response;
+    http_response += "HTTP/1.1 200 OK\r\n";
+    http_response += "Transfer-Encoding: chunked\r\n";
+    http_response += "\r\n";
+    http_response += "6\r\nWhat's\r\n";
+    http_response += "4;ext=1\r\n up?\r\n";
+    http_response += "0\r\n\r\n";
+
+    test_server.keep_alive_handler([&http_response](auto...) { return http_response; });
+
+    auto reply = handle_request(base_url, "GET");
+
+    ASSERT_EQ(reply->error(), QNetworkReply::NoError);
+    EXPECT_EQ(reply->readAll(), QByteArray{"What's up?"});
+}
+
+TEST_F(LocalNetworkAccessManager, reuses_connections_for_further_requests)
+{
+    const QByteArray http_response{"HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}"};
+    test_server.keep_alive_handler([&http_response](auto...) { return http_response; });
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto reply = handle_request(base_url, "GET");
+
+        ASSERT_EQ(reply->error(), QNetworkReply::NoError);
+        EXPECT_EQ(reply->readAll(), QByteArray{"{}"});
+    }
+
+    EXPECT_EQ(test_server.connection_count(), 1);
+}
+
+TEST_F(LocalNetworkAccessManager, does_not_reuse_connections_the_server_closes)
+{
+    const QByteArray http_response{"HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\n{}"};
+    test_server.keep_alive_handler([&http_response](auto...) { return http_response; });
+
+    handle_request(base_url, "GET");
+    handle_request(base_url, "GET");
+
+    EXPECT_EQ(test_server.connection_count(), 2);
+}
+
 TEST_F(LocalNetworkAccessManager, bad_http_server_response_has_error)
 {
     QByteArray malformed_http_response{"FOO/1.4 42 Yo\r\n"};
@@ -37,6 +37,12 @@ struct MockLocalSocketReply : public LocalSocketReply
     {
         QNetworkReply::setFinished(finished);
     };
+
+    void finish()
+    {
+        QNetworkReply::setFinished(true);
+        emit finished();
+    }
 };
 } // namespace test
 } // namespace multipass
@@ -43,6 +43,7 @@
 
 #include <QJsonDocument>
 #include <QString>
+#include <QTimer>
 #include <QUrl>
 
 namespace mp = multipass;
@@ -391,6 +392,65 @@ TEST_F(LXDBackend, factory_creates_valid_virtual_machine_ptr)
     EXPECT_NE(nullptr, machine);
 }
 
+TEST_F(LXDBackend, factory_prefetches_instance_states_and_addresses_in_bulk)
+{
+    mpt::StubVMStatusMonitor stub_monitor;
+    const QByteArray all_instances_data{"{"
+                                        "\"error\": \"\","
+                                        "\"error_code\": 0,"
+                                        "\"metadata\": ["
+                                        "  {"
+                                        "    \"name\": \"pied-piper-valley\","
+                                        "    \"status\": \"Running\","
+                                        "    \"status_code\": 103,"
+                                        "    \"state\": {"
+                                        "      \"status\": \"Running\","
+                                        "      \"status_code\": 103,"
+                                        "      \"network\": null"
+                                        "    }"
+                                        "  }"
+                                        "],"
+                                        "\"operation\": \"\","
+                                        "\"status\": \"Success\","
+                                        "\"status_code\": 200,"
+                                        "\"type\": \"sync\""
+                                        "}"};
+    auto instance_requests = 0;
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _))
+        .WillRepeatedly([&all_instances_data, &instance_requests](auto, auto request, auto outgoingData) {
+            outgoingData->open(QIODevice::ReadOnly);
+            auto data = outgoingData->readAll();
+            auto op = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            auto url = request.url().toString();
+
+            if (op == "GET" && url.contains("1.0/virtual-machines?recursion=2"))
+                return new mpt::MockLocalSocketReply(all_instances_data);
+            else if (op == "GET" && url.contains("1.0/networks/mpbr0/leases"))
+                return new mpt::MockLocalSocketReply(mpt::network_leases_data);
+            else if (op == "GET" && url.contains("1.0/virtual-machines/pied-piper-valley"))
+            {
+                ++instance_requests;
+                return new mpt::MockLocalSocketReply(mpt::vm_state_stopped_data);
+            }
+            else if (op == "PUT" && url.contains("1.0/virtual-machines/pied-piper-valley/state") &&
+                     data.contains("stop"))
+                return new mpt::MockLocalSocketReply(mpt::stop_vm_data);
+
+            return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+        });
+
+    mp::LXDVirtualMachineFactory backend{std::move(mock_network_access_manager), data_dir.path(), base_url};
+    auto machine = backend.create_virtual_machine(default_description, stub_monitor);
+    ASSERT_EQ(instance_requests, 1);
+
+    backend.prefetch_instance_states();
+
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::running);
+    EXPECT_EQ(machine->management_ipv4(), "10.217.27.168");
+    EXPECT_EQ(instance_requests, 1);
+}
+
 TEST_F(LXDBackend, factory_creates_expected_image_vault)
 {
     mpt::StubVMStatusMonitor stub_monitor;
@@ -458,6 +518,50 @@ TEST_F(LXDBackend, creates_in_stopped_state)
     EXPECT_EQ(machine.current_state(), mp::VirtualMachine::State::stopped);
 }
 
+TEST_F(LXDBackend, factory_submits_all_creations_before_waiting_on_any)
+{
+    mpt::StubVMStatusMonitor stub_monitor;
+    mpt::TempDir data_dir;
+
+    auto other_description = default_description;
+    other_description.vm_name = "hooli-xyz";
+
+    int creations{0}, creations_when_first_waited{0};
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _))
+        .WillRepeatedly([&creations, &creations_when_first_waited](auto, auto request, auto) {
+            auto op = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            auto url = request.url().toString();
+
+            if (op == "POST" && url.contains("1.0/virtual-machines"))
+            {
+                ++creations;
+                return new mpt::MockLocalSocketReply(mpt::create_vm_data);
+            }
+            else if (op == "GET" && url.contains("1.0/operations/0020444c-2e4c-49d5-83ed-3275e3f6d005"))
+            {
+                if (!creations_when_first_waited)
+                    creations_when_first_waited = creations;
+
+                return new mpt::MockLocalSocketReply(mpt::create_vm_finished_data);
+            }
+            else if (op == "GET" && creations && url.contains("1.0/virtual-machines/"))
+                return new mpt::MockLocalSocketReply(mpt::vm_info_data);
+
+            return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+        });
+
+    mp::LXDVirtualMachineFactory backend{std::move(mock_network_access_manager), data_dir.path(), base_url};
+    backend.start_creating_instances({default_description, other_description});
+
+    auto machine = backend.create_virtual_machine(default_description, stub_monitor);
+    auto other_machine = backend.create_virtual_machine(other_description, stub_monitor);
+
+    EXPECT_EQ(creations, 2);
+    EXPECT_EQ(creations_when_first_waited, 2);
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::stopped);
+}
+
 TEST_F(LXDBackend, machine_persists_and_sets_state_on_start)
 {
     NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
@@ -795,7 +899,7 @@ TEST_F(LXDBackend, prepare_source_image_does_not_modify)
     const mp::VMImage original_image{"/path/to/image",          "", "", "deadbeef", "bin", "baz", "the past",
                                      {"fee", "fi", "fo", "fum"}};
 
-    auto source_image = backend.prepare_source_image(original_image);
+    auto source_image = backend.prepare_source_image(original_image, [](int, int) { return true; });
 
     EXPECT_EQ(source_image.image_path, original_image.image_path);
     EXPECT_EQ(source_image.kernel_path, original_image.kernel_path);
@@ -1113,6 +1217,42 @@ TEST_F(LXDBackend, lxd_request_timeout_aborts_and_throws)
                          std::runtime_error, mpt::match_what(HasSubstr(error_string)));
 }
 
+TEST_F(LXDBackend, lxd_requests_issues_all_requests_before_waiting_and_keeps_their_order)
+{
+    std::vector<mpt::MockLocalSocketReply*> replies;
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _))
+        .Times(3)
+        .WillRepeatedly([&replies](auto, auto request, auto) {
+            auto url = request.url().toString();
+            auto reply = url.contains("missing")
+                             ? new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError)
+                             : new mpt::MockLocalSocketReply(url.contains("leases") ? mpt::network_leases_data
+                                                                                    : mpt::vm_state_stopped_data);
+            reply->setFinished(false);
+            replies.push_back(reply);
+
+            if (replies.size() == 3) // all in flight: let them come back in reverse
+                QTimer::singleShot(0, [&replies] {
+                    for (auto it = replies.rbegin(); it != replies.rend(); ++it)
+                        (*it)->finish();
+                });
+
+            return reply;
+        });
+
+    const auto results = mp::lxd_requests(mock_network_access_manager.get(), "GET",
+                                          {QUrl{"unix:///foo@1.0/virtual-machines/pied-piper-valley/state"},
+                                           QUrl{"unix:///foo@1.0/virtual-machines/missing/state"},
+                                           QUrl{"unix:///foo@1.0/networks/mpbr0/leases"}});
+
+    ASSERT_EQ(results.size(), 3u);
+    ASSERT_TRUE(results[0]);
+    EXPECT_EQ((*results[0])["metadata"].toObject()["status"].toString(), "Stopped");
+    EXPECT_FALSE(results[1]);
+    ASSERT_TRUE(results[2]);
+    EXPECT_TRUE((*results[2])["metadata"].isArray());
+}
+
 TEST_F(LXDBackend, lxd_request_empty_data_returned_throws_and_logs)
 {
     EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _)).WillOnce([](auto...) {
@@ -2015,6 +2155,33 @@ TEST_F(LXDBackend, falls_back_to_bridge_description_from_platform)
     EXPECT_THAT(backend.networks(), ElementsAre(Field(&mp::NetworkInterfaceInfo::description, Eq(fallback_desc))));
 }
 
+TEST_F(LXDBackend, reuses_network_list_until_lxd_networks_change)
+{
+    auto data = QByteArrayLiteral(R"({"metadata": [{"type": "bridge", "name": "br0", "description": ""}]})");
+    EXPECT_CALL(*mock_network_access_manager,
+                createRequest(QNetworkAccessManager::CustomOperation, network_request_matcher, _))
+        .WillOnce(Return(new mpt::MockLocalSocketReply{{data}}))
+        .WillOnce(Return(new mpt::MockLocalSocketReply{{data}}));
+
+    auto [mock_platform, guard] = mpt::MockPlatform::inject();
+    EXPECT_CALL(*mock_platform, get_network_interfaces_info)
+        .Times(3)
+        .WillRepeatedly(Return(std::map<std::string, mp::NetworkInterfaceInfo>{{"br0", {"br0", "bridge", "br"}}}));
+
+    auto events = std::make_unique<mp::LXDEventSubscriber>();
+    auto events_ptr = events.get();
+    mp::LXDVirtualMachineFactory backend{std::move(mock_network_access_manager), std::move(events), data_dir.path(),
+                                         base_url};
+
+    EXPECT_THAT(backend.networks(), ElementsAre(Field(&mp::NetworkInterfaceInfo::id, Eq("br0"))));
+    EXPECT_THAT(backend.networks(), ElementsAre(Field(&mp::NetworkInterfaceInfo::id, Eq("br0"))));
+
+    events_ptr->handle_event(QJsonObject{
+        {"type", "lifecycle"},
+        {"metadata", QJsonObject{{"action", "network-updated"}, {"source", "/1.0/networks/br0"}}}});
+    EXPECT_THAT(backend.networks(), ElementsAre(Field(&mp::NetworkInterfaceInfo::id, Eq("br0"))));
+}
+
 TEST_F(LXDBackend, skips_platform_network_inspection_when_lxd_reports_no_networks)
 {
     auto data = QByteArrayLiteral(R"({"metadata": []})");
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "tests/common.h"
+
+#include <src/platform/backends/lxd/lxd_event_subscriber.h>
+
+#include <QJsonObject>
+
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+QByteArray server_frame(char opcode, const QByteArray& payload, bool fin = true)
+{
+    QByteArray frame;
+    frame.append(char((fin ? 0x80 : 0) | opcode));
+
+    if (payload.size() < 126)
+    {
+        frame.append(char(payload.size()));
+    }
+    else
+    {
+        frame.append(char(126));
+        frame.append(char(payload.size() >> 8));
+        frame.append(char(payload.size() & 0xFF));
+    }
+
+    return frame + payload;
+}
+
+QJsonObject lifecycle_event(const QString& action, const QString& source)
+{
+    return {{"type", "lifecycle"}, {"metadata", QJsonObject{{"action", action}, {"source", source}}}};
+}
+
+QJsonObject operation_event(const QString& id, int status_code)
+{
+    return {{"type", "operation"}, {"metadata", QJsonObject{{"id", id}, {"status_code", status_code}}}};
+}
+
+TEST(WebSocketStream, unframes_messages_that_arrive_in_pieces)
+{
+    const auto big = QByteArray(300, 'x');
+    const auto bytes = server_frame(0x1, "{\"a\":1}") + server_frame(0x1, big);
+
+    mp::WebSocketStream stream;
+    EXPECT_TRUE(stream.feed(bytes.left(5)));
+    EXPECT_THAT(stream.take_messages(), IsEmpty());
+
+    EXPECT_TRUE(stream.feed(bytes.mid(5)));
+    EXPECT_THAT(stream.take_messages(), ElementsAre(QByteArray{"{\"a\":1}"}, big));
+}
+
+TEST(WebSocketStream, joins_fragments)
+{
+    mp::WebSocketStream stream;
+    stream.feed(server_frame(0x1, "{\"a\":", false) + server_frame(0x0, "1}"));
+
+    EXPECT_THAT(stream.take_messages(), ElementsAre(QByteArray{"{\"a\":1}"}));
+}
+
+TEST(WebSocketStream, answers_pings_with_masked_pongs)
+{
+    mp::WebSocketStream stream;
+    stream.feed(server_frame(0x9, "hi"));
+
+    const auto replies = stream.take_replies();
+    ASSERT_EQ(replies.size(), 2 + 4 + 2);
+    EXPECT_EQ(uchar(replies[0]), 0x8A);
+    EXPECT_EQ(uchar(replies[1]), 0x80 | 2);
+    EXPECT_EQ(char(replies[6] ^ replies[2]), 'h');
+    EXPECT_EQ(char(replies[7] ^ replies[3]), 'i');
+}
+
+TEST(WebSocketStream, reports_the_server_closing)
+{
+    mp::WebSocketStream stream;
+
+    EXPECT_FALSE(stream.feed(server_frame(0x8, QByteArray{"\x03\xe8", 2})));
+    EXPECT_EQ(uchar(stream.take_replies()[0]), 0x88);
+}
+
+TEST(LXDEventSubscriber, caches_instance_states_from_lifecycle_events)
+{
+    mp::LXDEventSubscriber events;
+    events.handle_event(lifecycle_event("instance-started", "/1.0/instances/foo?project=multipass"));
+
+    EXPECT_EQ(events.instance_status_code("foo"), mp::make_optional(103));
+
+    events.handle_event(lifecycle_event("instance-stopped", "/1.0/instances/foo"));
+    EXPECT_EQ(events.instance_status_code("foo"), mp::make_optional(102));
+
+    events.handle_event(lifecycle_event("instance-updated", "/1.0/instances/foo"));
+    EXPECT_FALSE(events.instance_status_code("foo"));
+}
+
+TEST(LXDEventSubscriber, does_not_let_queried_states_override_pushed_ones)
+{
+    mp::LXDEventSubscriber events;
+    events.handle_event(lifecycle_event("instance-stopped", "/1.0/instances/foo"));
+    events.note_instance_status_code("foo", 103);
+    events.note_instance_status_code("bar", 103);
+
+    EXPECT_EQ(events.instance_status_code("foo"), mp::make_optional(102));
+    EXPECT_EQ(events.instance_status_code("bar"), mp::make_optional(103));
+}
+
+TEST(LXDEventSubscriber, wakes_up_instance_waiters_on_events)
+{
+    mp::LXDEventSubscriber events;
+    std::thread pusher{[&events] {
+        std::this_thread::sleep_for(10ms);
+        events.handle_event(lifecycle_event("instance-started", "/1.0/instances/foo"));
+    }};
+
+    EXPECT_TRUE(events.wait_for_instance_event("foo", 10s));
+    pusher.join();
+
+    EXPECT_FALSE(events.wait_for_instance_event("foo", 1ms));
+}
+
+TEST(LXDEventSubscriber, completes_operation_waits_on_push)
+{
+    mp::LXDEventSubscriber events;
+    std::vector<int> updates;
+
+    std::thread pusher{[&events] {
+        events.handle_event(operation_event("asdf", 103));
+        std::this_thread::sleep_for(10ms);
+        events.handle_event(operation_event("asdf", 200));
+    }};
+
+    auto operation = events.wait_for_operation(
+        "asdf", 10s, [&updates](const QJsonObject& op) { updates.push_back(op["status_code"].toInt()); });
+    pusher.join();
+
+    ASSERT_TRUE(operation);
+    EXPECT_EQ((*operation)["status_code"].toInt(), 200);
+    EXPECT_THAT(updates, Each(103));
+}
+
+TEST(LXDEventSubscriber, remembers_operations_that_finished_before_the_wait)
+{
+    mp::LXDEventSubscriber events;
+    events.handle_event(operation_event("asdf", 400));
+
+    auto operation = events.wait_for_operation("asdf", 0ms);
+
+    ASSERT_TRUE(operation);
+    EXPECT_EQ((*operation)["status_code"].toInt(), 400);
+}
+
+TEST(LXDEventSubscriber, leaves_unseen_operations_to_the_caller)
+{
+    mp::LXDEventSubscriber events;
+
+    EXPECT_FALSE(events.wait_for_operation("asdf", 1ms));
+}
+
+TEST(LXDEventSubscriber, changes_images_version_on_image_events_only)
+{
+    mp::LXDEventSubscriber events;
+    const auto version = events.images_version();
+    ASSERT_TRUE(version);
+
+    events.handle_event(lifecycle_event("instance-started", "/1.0/instances/foo"));
+    EXPECT_EQ(events.images_version(), version);
+
+    events.handle_event(lifecycle_event("image-deleted", "/1.0/images/abcd?project=multipass"));
+    EXPECT_NE(events.images_version(), version);
+}
+
+TEST(LXDEventSubscriber, changes_networks_version_on_network_events_only)
+{
+    mp::LXDEventSubscriber events;
+    const auto version = events.networks_version();
+    ASSERT_TRUE(version);
+
+    events.handle_event(lifecycle_event("image-deleted", "/1.0/images/abcd?project=multipass"));
+    EXPECT_EQ(events.networks_version(), version);
+
+    events.handle_event(lifecycle_event("network-created", "/1.0/networks/br1"));
+    EXPECT_NE(events.networks_version(), version);
+}
+
+TEST(LXDEventSubscriber, knows_nothing_while_disconnected)
+{
+    mp::LXDEventSubscriber events{QUrl{"unix:///no/such/socket@1.0"}};
+    events.note_instance_status_code("foo", 103);
+
+    EXPECT_FALSE(events.is_connected());
+    EXPECT_FALSE(events.instance_status_code("foo"));
+    EXPECT_FALSE(events.images_version());
+    EXPECT_FALSE(events.networks_version());
+    EXPECT_FALSE(events.wait_for_operation("asdf", 10s));
+}
+} // namespace
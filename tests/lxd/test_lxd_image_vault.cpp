@@ -23,10 +23,12 @@
 #include "tests/mock_image_host.h"
 #include "tests/mock_logger.h"
 #include "tests/mock_process_factory.h"
+#include "tests/mock_url_downloader.h"
 #include "tests/stub_url_downloader.h"
 #include "tests/temp_dir.h"
 #include "tests/tracking_url_downloader.h"
 
+#include <src/platform/backends/lxd/lxd_event_subscriber.h>
 #include <src/platform/backends/lxd/lxd_vm_image_vault.h>
 
 #include <multipass/exceptions/aborted_download_exception.h>
@@ -363,6 +365,75 @@ TEST_F(LXDImageVault, download_deletes_and_throws_on_cancel)
     EXPECT_TRUE(delete_requested);
 }
 
+TEST_F(LXDImageVault, download_goes_by_pushed_events_instead_of_polling)
+{
+    ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _)).WillByDefault([](auto, auto request, auto) {
+        auto op = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+        auto url = request.url().toString();
+
+        if (op == "POST" && url.contains("1.0/images"))
+            return new mpt::MockLocalSocketReply(mpt::image_download_task_data);
+
+        EXPECT_FALSE(url.contains("1.0/operations")) << "polled " << url;
+        return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+    });
+
+    mp::LXDEventSubscriber events;
+    events.handle_event({{"type", "operation"},
+                         {"metadata", QJsonObject{{"id", "0a19a412-03d0-4118-bee8-a3095f06d4da"},
+                                                  {"class", "task"},
+                                                  {"status_code", 200}}}});
+
+    mp::LXDVMImageVault image_vault{hosts,           &stub_url_downloader, mock_network_access_manager.get(), base_url,
+                                    cache_dir.path(), mp::days{0},          &events};
+
+    EXPECT_NO_THROW(image_vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor));
+}
+
+TEST_F(LXDImageVault, download_reports_pushed_progress_and_deletes_on_cancel)
+{
+    bool delete_requested{false};
+
+    ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _))
+        .WillByDefault([&delete_requested](auto, auto request, auto) {
+            auto op = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            auto url = request.url().toString();
+
+            if (op == "POST" && url.contains("1.0/images"))
+            {
+                return new mpt::MockLocalSocketReply(mpt::image_download_task_data);
+            }
+            else if (op == "DELETE" && url.contains("1.0/operations/0a19a412-03d0-4118-bee8-a3095f06d4da"))
+            {
+                delete_requested = true;
+                return new mpt::MockLocalSocketReply(mpt::post_no_error_data);
+            }
+
+            return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+        });
+
+    mp::LXDEventSubscriber events;
+    events.handle_event({{"type", "operation"},
+                         {"metadata", QJsonObject{{"id", "0a19a412-03d0-4118-bee8-a3095f06d4da"},
+                                                  {"class", "task"},
+                                                  {"status_code", 103},
+                                                  {"metadata", QJsonObject{{"download_progress", "rootfs: 25%"}}}}}});
+
+    mp::ProgressMonitor monitor{[](auto, auto progress) {
+        EXPECT_EQ(progress, 25);
+
+        return false;
+    }};
+
+    mp::LXDVMImageVault image_vault{hosts,           &stub_url_downloader, mock_network_access_manager.get(), base_url,
+                                    cache_dir.path(), mp::days{0},          &events};
+
+    EXPECT_THROW(image_vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, monitor),
+                 mp::AbortedDownloadException);
+
+    EXPECT_TRUE(delete_requested);
+}
+
 TEST_F(LXDImageVault, percent_complete_returns_negative_on_metadata_download)
 {
     ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _)).WillByDefault([](auto, auto request, auto) {
@@ -686,6 +757,40 @@ TEST_F(LXDImageVault, prune_uses_last_update_property_on_new_unused_image)
     EXPECT_TRUE(delete_requested);
 }
 
+TEST_F(LXDImageVault, reuses_image_list_until_images_change)
+{
+    int list_requests{0};
+
+    ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _))
+        .WillByDefault([&list_requests](auto, auto request, auto) {
+            auto op = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            auto url = request.url().toString();
+
+            if (op == "GET" && url.contains("1.0/images?recursion=1"))
+            {
+                ++list_requests;
+                return new mpt::MockLocalSocketReply(mpt::image_info_data);
+            }
+
+            return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+        });
+
+    mp::LXDEventSubscriber events;
+    mp::LXDVMImageVault image_vault{hosts,    &stub_url_downloader, mock_network_access_manager.get(),
+                                    base_url, cache_dir.path(),     mp::days{36500}, &events};
+
+    image_vault.prune_expired_images();
+    image_vault.prune_expired_images();
+    EXPECT_EQ(list_requests, 1);
+
+    events.handle_event(QJsonObject{
+        {"type", "lifecycle"},
+        {"metadata", QJsonObject{{"action", "image-created"}, {"source", "/1.0/images/abcd"}}}});
+
+    image_vault.prune_expired_images();
+    EXPECT_EQ(list_requests, 2);
+}
+
 TEST_F(LXDImageVault, prune_expired_image_no_project_does_not_throw)
 {
     ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _)).WillByDefault([](auto, auto request, auto) {
@@ -832,6 +937,31 @@ TEST_F(LXDImageVault, custom_image_downloads_and_creates_correct_upload)
     EXPECT_EQ(image.release_date, mpt::custom_image_version);
 }
 
+TEST_F(LXDImageVault, custom_xz_image_is_decoded_while_downloading)
+{
+    NiceMock<mpt::MockURLDownloader> mock_url_downloader;
+    host.mock_custom_image_info.image_location = "https://some/image.img.xz";
+
+    EXPECT_CALL(mock_url_downloader, download_to).Times(0);
+    EXPECT_CALL(mock_url_downloader, download_and_hash_to).Times(0);
+    EXPECT_CALL(mock_url_downloader, stream_and_hash(QUrl{host.mock_custom_image_info.image_location}, _, _, _, _))
+        .WillOnce([](auto, auto, auto, auto, const mp::URLDownloader::DataSink& sink) {
+            sink("This is definitely not xz data");
+            return QString{mpt::custom_image_id};
+        });
+
+    ON_CALL(*mock_network_access_manager.get(), createRequest(_, _, _)).WillByDefault([](auto...) {
+        return new mpt::MockLocalSocketReply(mpt::not_found_data, QNetworkReply::ContentNotFoundError);
+    });
+
+    mp::LXDVMImageVault image_vault{hosts,    &mock_url_downloader, mock_network_access_manager.get(),
+                                    base_url, cache_dir.path(),     mp::days{0}};
+
+    const mp::Query query{"", "custom", false, "release", mp::Query::Type::Alias};
+    MP_EXPECT_THROW_THAT(image_vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor),
+                         std::runtime_error, mpt::match_what(HasSubstr("not a xz file")));
+}
+
 TEST_F(LXDImageVault, fetch_image_unable_to_connect_logs_error_and_returns_blank_vmimage)
 {
     const std::string exception_message{"Cannot connect to socket"};
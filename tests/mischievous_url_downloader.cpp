@@ -17,6 +17,8 @@
 
 #include "mischievous_url_downloader.h"
 
+#include <QFileInfo>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 
@@ -28,11 +30,45 @@ void mpt::MischievousURLDownloader::download_to(const QUrl& url, const QString&
                                                 const int download_type, const mp::ProgressMonitor& monitor)
 {
     URLDownloader::download_to(choose_url(url), file_name, size, download_type, monitor);
+    conditions.transfer(QFileInfo{file_name}.size());
+}
+
+QString mpt::MischievousURLDownloader::download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size,
+                                                           const int download_type,
+                                                           const mp::ProgressMonitor& monitor)
+{
+    auto hash = URLDownloader::download_and_hash_to(choose_url(url), file_name, size, download_type, monitor);
+    conditions.transfer(QFileInfo{file_name}.size());
+
+    return hash;
+}
+
+QString mpt::MischievousURLDownloader::stream_and_hash(const QUrl& url, int64_t size, const int download_type,
+                                                      const mp::ProgressMonitor& monitor, const DataSink& sink)
+{
+    return URLDownloader::stream_and_hash(choose_url(url), size, download_type, monitor,
+                                          [this, &sink](const QByteArray& data) {
+                                              conditions.transfer(data.size());
+                                              return sink(data);
+                                          });
 }
 
 QByteArray mpt::MischievousURLDownloader::download(const QUrl& url)
 {
-    return URLDownloader::download(choose_url(url));
+    auto data = URLDownloader::download(choose_url(url));
+    conditions.transfer(data.size());
+
+    return data;
+}
+
+mp::optional<QByteArray> mpt::MischievousURLDownloader::download_if_changed(const QUrl& url,
+                                                                           mp::DownloadValidators& validators)
+{
+    auto data = URLDownloader::download_if_changed(choose_url(url), validators);
+    if (data)
+        conditions.transfer(data->size());
+
+    return data;
 }
 
 QDateTime mpt::MischievousURLDownloader::last_modified(const QUrl& url)
@@ -42,5 +78,6 @@ QDateTime mpt::MischievousURLDownloader::last_modified(const QUrl& url)
 
 const QUrl& mpt::MischievousURLDownloader::choose_url(const QUrl& url)
 {
+    conditions.round_trip();
     return mischiefs-- > 0 ? empty_url : url;
 }
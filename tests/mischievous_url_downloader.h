@@ -18,10 +18,14 @@
 #ifndef MULTIPASS_MISCHIEVOUS_URL_DOWNLOADER_H
 #define MULTIPASS_MISCHIEVOUS_URL_DOWNLOADER_H
 
+#include "network_conditions.h"
+
 #include <multipass/url_downloader.h>
 
 #include <QUrl>
 
+#include <atomic>
+
 namespace multipass
 {
 namespace test
@@ -33,11 +37,17 @@ public:
 
     void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
                      const ProgressMonitor& monitor) override;
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const ProgressMonitor& monitor) override;
+    QString stream_and_hash(const QUrl& url, int64_t size, const int download_type, const ProgressMonitor& monitor,
+                            const DataSink& sink) override;
     QByteArray download(const QUrl& url) override;
+    optional<QByteArray> download_if_changed(const QUrl& url, DownloadValidators& validators) override;
     QDateTime last_modified(const QUrl& url) override;
 
 public:
-    int mischiefs = 0;
+    std::atomic_int mischiefs{0}; // remotes may be fetched concurrently
+    NetworkConditions conditions; // what each download goes through, on top of the actual one
 
 private:
     const QUrl& choose_url(const QUrl& url);
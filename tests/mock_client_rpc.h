@@ -132,6 +132,42 @@ public:
     MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::RecoverReply>*, PrepareAsyncrecoverRaw,
                 (grpc::ClientContext * context, const multipass::RecoverRequest& request, grpc::CompletionQueue* cq),
                 (override));
+    MOCK_METHOD(grpc::ClientReaderInterface<multipass::CloneReply>*, cloneRaw,
+                (grpc::ClientContext * context, const multipass::CloneRequest& request), (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::CloneReply>*, AsynccloneRaw,
+                (grpc::ClientContext * context, const multipass::CloneRequest& request, grpc::CompletionQueue* cq,
+                 void* tag),
+                (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::CloneReply>*, PrepareAsynccloneRaw,
+                (grpc::ClientContext * context, const multipass::CloneRequest& request, grpc::CompletionQueue* cq),
+                (override));
+    MOCK_METHOD(grpc::ClientReaderInterface<multipass::BakeReply>*, bakeRaw,
+                (grpc::ClientContext * context, const multipass::BakeRequest& request), (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::BakeReply>*, AsyncbakeRaw,
+                (grpc::ClientContext * context, const multipass::BakeRequest& request, grpc::CompletionQueue* cq,
+                 void* tag),
+                (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::BakeReply>*, PrepareAsyncbakeRaw,
+                (grpc::ClientContext * context, const multipass::BakeRequest& request, grpc::CompletionQueue* cq),
+                (override));
+    MOCK_METHOD(grpc::ClientReaderInterface<multipass::SnapshotReply>*, snapshotRaw,
+                (grpc::ClientContext * context, const multipass::SnapshotRequest& request), (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::SnapshotReply>*, AsyncsnapshotRaw,
+                (grpc::ClientContext * context, const multipass::SnapshotRequest& request, grpc::CompletionQueue* cq,
+                 void* tag),
+                (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::SnapshotReply>*, PrepareAsyncsnapshotRaw,
+                (grpc::ClientContext * context, const multipass::SnapshotRequest& request, grpc::CompletionQueue* cq),
+                (override));
+    MOCK_METHOD(grpc::ClientReaderInterface<multipass::TopReply>*, topRaw,
+                (grpc::ClientContext * context, const multipass::TopRequest& request), (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::TopReply>*, AsynctopRaw,
+                (grpc::ClientContext * context, const multipass::TopRequest& request, grpc::CompletionQueue* cq,
+                 void* tag),
+                (override));
+    MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::TopReply>*, PrepareAsynctopRaw,
+                (grpc::ClientContext * context, const multipass::TopRequest& request, grpc::CompletionQueue* cq),
+                (override));
     MOCK_METHOD(grpc::ClientReaderInterface<multipass::SSHInfoReply>*, ssh_infoRaw,
                 (grpc::ClientContext * context, const multipass::SSHInfoRequest& request), (override));
     MOCK_METHOD(grpc::ClientAsyncReaderInterface<multipass::SSHInfoReply>*, Asyncssh_infoRaw,
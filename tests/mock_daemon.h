@@ -45,6 +45,11 @@ struct MockDaemon : public Daemon
                              std::promise<grpc::Status>*));
     MOCK_METHOD3(recover,
                  void(const RecoverRequest*, grpc::ServerWriterInterface<RecoverReply>*, std::promise<grpc::Status>*));
+    MOCK_METHOD3(clone,
+                 void(const CloneRequest*, grpc::ServerWriterInterface<CloneReply>*, std::promise<grpc::Status>*));
+    MOCK_METHOD3(bake, void(const BakeRequest*, grpc::ServerWriterInterface<BakeReply>*, std::promise<grpc::Status>*));
+    MOCK_METHOD3(snapshot, void(const SnapshotRequest*, grpc::ServerWriterInterface<SnapshotReply>*,
+                                std::promise<grpc::Status>*));
     MOCK_METHOD3(ssh_info,
                  void(const SSHInfoRequest*, grpc::ServerWriterInterface<SSHInfoReply>*, std::promise<grpc::Status>*));
     MOCK_METHOD3(start,
@@ -67,6 +72,12 @@ struct MockDaemon : public Daemon
                                 std::promise<grpc::Status>*));
     MOCK_METHOD3(authenticate, void(const AuthenticateRequest*, grpc::ServerWriterInterface<AuthenticateReply>*,
                                     std::promise<grpc::Status>*));
+    MOCK_METHOD3(metrics, void(const MetricsRequest*, grpc::ServerWriterInterface<MetricsReply>*,
+                               std::promise<grpc::Status>*));
+    MOCK_METHOD4(watch, void(const WatchRequest*, grpc::ServerWriterInterface<WatchReply>*, std::function<bool()>,
+                             std::promise<grpc::Status>*));
+    MOCK_METHOD4(top, void(const TopRequest*, grpc::ServerWriterInterface<TopReply>*, std::function<bool()>,
+                           std::promise<grpc::Status>*));
 
     template <typename Request, typename Reply>
     void set_promise_value(const Request*, grpc::ServerWriterInterface<Reply>*,
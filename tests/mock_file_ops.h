@@ -28,17 +28,40 @@ namespace multipass::test
 class MockFileOps : public FileOps
 {
 public:
-    using FileOps::FileOps;
+    MockFileOps(const PrivatePass& pass) : FileOps(pass)
+    {
+        // Batches go through the single calls, for tests to keep expecting those
+        EXPECT_CALL(*this, read_batch).Times(testing::AnyNumber()).WillRepeatedly([this](auto& reads) {
+            for (auto& read : reads)
+                read.result = read_at(*read.file, read.data, read.size, read.pos);
+        });
+        EXPECT_CALL(*this, write_batch).Times(testing::AnyNumber()).WillRepeatedly([this](auto& writes) {
+            for (auto& write : writes)
+                write.result = write_at(*write.file, write.data, write.size, write.pos);
+        });
+    }
 
     MOCK_CONST_METHOD0(current, QDir());
     MOCK_CONST_METHOD1(isReadable, bool(const QDir&));
     MOCK_CONST_METHOD2(mkpath, bool(const QDir&, const QString& dirName));
     MOCK_CONST_METHOD2(rmdir, bool(QDir&, const QString& dirName));
+    MOCK_CONST_METHOD4(advise, bool(QFile&, qint64, qint64, Access));
+    MOCK_CONST_METHOD3(allocate, bool(QFile&, qint64, qint64));
+    MOCK_CONST_METHOD2(clone, bool(QFile&, QFile&));
     MOCK_CONST_METHOD1(exists, bool(const QFile&));
     MOCK_CONST_METHOD1(is_open, bool(const QFile&));
+    MOCK_CONST_METHOD2(copy, bool(const QString&, const QString&));
+    MOCK_CONST_METHOD5(copy_range, qint64(QFile&, qint64, QFile&, qint64, qint64));
+    MOCK_CONST_METHOD2(hard_link, bool(const QString&, const QString&));
+    MOCK_CONST_METHOD3(map, uchar*(QFile&, qint64, qint64));
+    MOCK_CONST_METHOD2(next_data, qint64(QFile&, qint64));
+    MOCK_CONST_METHOD2(next_hole, qint64(QFile&, qint64));
     MOCK_CONST_METHOD2(open, bool(QFileDevice&, QIODevice::OpenMode));
     MOCK_CONST_METHOD1(permissions, QFileDevice::Permissions(const QFile&));
+    MOCK_CONST_METHOD3(punch_hole, bool(QFile&, qint64, qint64));
     MOCK_CONST_METHOD3(read, qint64(QFile&, char*, qint64));
+    MOCK_CONST_METHOD4(read_at, qint64(QFile&, char*, qint64, qint64));
+    MOCK_CONST_METHOD1(read_batch, void(std::vector<Transfer>&));
     MOCK_CONST_METHOD1(read_all, QByteArray(QFile&));
     MOCK_CONST_METHOD1(read_line, QString(QTextStream&));
     MOCK_CONST_METHOD1(remove, bool(QFile&));
@@ -47,7 +70,11 @@ public:
     MOCK_CONST_METHOD2(seek, bool(QFile&, qint64 pos));
     MOCK_CONST_METHOD2(setPermissions, bool(QFile&, QFileDevice::Permissions));
     MOCK_CONST_METHOD1(size, qint64(QFile&));
+    MOCK_CONST_METHOD1(sync, bool(QFile&));
+    MOCK_CONST_METHOD2(unmap, bool(QFile&, uchar*));
     MOCK_CONST_METHOD3(write, qint64(QFile&, const char*, qint64));
+    MOCK_CONST_METHOD4(write_at, qint64(QFile&, const char*, qint64, qint64));
+    MOCK_CONST_METHOD1(write_batch, void(std::vector<Transfer>&));
     MOCK_CONST_METHOD2(write, qint64(QFileDevice&, const QByteArray&));
     MOCK_CONST_METHOD3(open, void(std::fstream&, const char*, std::ios_base::openmode));
     MOCK_CONST_METHOD1(commit, bool(QSaveFile&));
@@ -36,6 +36,12 @@ public:
     MOCK_CONST_METHOD3(log, void(multipass::logging::Level level, multipass::logging::CString category,
                                  multipass::logging::CString message));
 
+    // Expectations decide what the mock takes, so every level has to reach it
+    multipass::logging::Level max_logging_level() const override
+    {
+        return multipass::logging::Level::trace;
+    }
+
     class Scope
     {
     public:
@@ -68,6 +68,11 @@ public:
         setHeader(header, value);
     }
 
+    void set_raw_header(const QByteArray& header_name, const QByteArray& value)
+    {
+        setRawHeader(header_name, value);
+    }
+
 public Q_SLOTS:
     MOCK_METHOD0(abort, void());
 };
@@ -30,7 +30,11 @@ struct MockURLDownloader : public multipass::URLDownloader
 
     MOCK_METHOD1(download, QByteArray(const QUrl&));
     MOCK_METHOD1(last_modified, QDateTime(const QUrl&));
+    MOCK_METHOD2(download_if_changed, optional<QByteArray>(const QUrl&, DownloadValidators&));
     MOCK_METHOD5(download_to, void(const QUrl&, const QString&, int64_t, const int, const ProgressMonitor&));
+    MOCK_METHOD5(download_and_hash_to,
+                 QString(const QUrl&, const QString&, int64_t, const int, const ProgressMonitor&));
+    MOCK_METHOD5(stream_and_hash, QString(const QUrl&, int64_t, const int, const ProgressMonitor&, const DataSink&));
 };
 } // namespace test
 } // namespace multipass
@@ -40,6 +40,7 @@ struct MockVirtualMachine : public multipass::VirtualMachine
         ON_CALL(*this, ssh_username()).WillByDefault(Return("ubuntu"));
         ON_CALL(*this, management_ipv4()).WillByDefault(Return("0.0.0.0"));
         ON_CALL(*this, get_all_ipv4(_)).WillByDefault(Return(std::vector<std::string>{"192.168.2.123"}));
+        ON_CALL(*this, known_ipv4()).WillByDefault(Return(std::vector<std::string>{"192.168.2.123"}));
         ON_CALL(*this, ipv6()).WillByDefault(Return("::/0"));
     }
 
@@ -54,6 +55,7 @@ struct MockVirtualMachine : public multipass::VirtualMachine
     MOCK_METHOD0(ssh_username, std::string());
     MOCK_METHOD0(management_ipv4, std::string());
     MOCK_METHOD1(get_all_ipv4, std::vector<std::string>(const SSHKeyProvider&));
+    MOCK_METHOD0(known_ipv4, std::vector<std::string>());
     MOCK_METHOD0(ipv6, std::string());
     MOCK_METHOD0(ensure_vm_is_running, void());
     MOCK_METHOD1(wait_until_ssh_up, void(std::chrono::milliseconds));
@@ -61,6 +63,19 @@ struct MockVirtualMachine : public multipass::VirtualMachine
     MOCK_METHOD1(update_cpus, void(int num_cores));
     MOCK_METHOD1(resize_memory, void(const MemorySize& new_size));
     MOCK_METHOD1(resize_disk, void(const MemorySize& new_size));
+    MOCK_METHOD0(resizes_while_running, bool());
+    MOCK_METHOD1(set_balloon_target, void(const MemorySize& guest_memory));
+    MOCK_METHOD1(guest_stats, GuestStats(std::chrono::milliseconds));
+    MOCK_METHOD1(guest_metrics, optional<GuestMetrics>(std::chrono::milliseconds));
+    MOCK_METHOD1(update_placement, void(const VMPlacement& placement));
+    MOCK_METHOD1(update_disk_options, void(const VMDiskOptions& disk_options));
+    MOCK_METHOD1(update_network_options, void(const VMNetworkOptions& network_options));
+    MOCK_METHOD1(update_resource_limits, void(const VMResourceLimits& limits));
+    MOCK_METHOD1(take_snapshot, void(const std::string& name));
+    MOCK_METHOD1(restore_snapshot, void(const std::string& name));
+    MOCK_METHOD1(delete_snapshot, void(const std::string& name));
+    MOCK_METHOD0(prepare_for_exit, void());
+    MOCK_METHOD0(kill, void());
 };
 } // namespace test
 } // namespace multipass
@@ -36,7 +36,7 @@ struct MockVirtualMachineFactory : public VirtualMachineFactory
 
     MOCK_METHOD0(fetch_type, FetchType());
     MOCK_METHOD1(prepare_networking, void(std::vector<NetworkInterface>&));
-    MOCK_METHOD1(prepare_source_image, VMImage(const VMImage&));
+    MOCK_METHOD2(prepare_source_image, VMImage(const VMImage&, const ProgressMonitor&));
     MOCK_METHOD2(prepare_instance_image, void(const VMImage&, const VirtualMachineDescription&));
     MOCK_METHOD0(hypervisor_health_check, void());
     MOCK_METHOD0(get_backend_directory_name, QString());
@@ -45,6 +45,10 @@ struct MockVirtualMachineFactory : public VirtualMachineFactory
                  VMImageVault::UPtr(std::vector<VMImageHost*>, URLDownloader*, const Path&, const Path&, const days&));
     MOCK_METHOD1(configure, void(VirtualMachineDescription&));
     MOCK_CONST_METHOD0(networks, std::vector<NetworkInterfaceInfo>());
+    MOCK_METHOD1(create_native_mount_handler, MountHandler::UPtr(const SSHKeyProvider&));
+    MOCK_METHOD0(prefetch_instance_states, void());
+    MOCK_METHOD1(start_creating_instances, void(const std::vector<VirtualMachineDescription>&));
+    MOCK_CONST_METHOD0(cloud_init_seed_host, optional<std::string>());
 
     // originally protected:
     MOCK_METHOD1(create_bridge_with, std::string(const NetworkInterfaceInfo&));
@@ -44,9 +44,13 @@ public:
 
     MOCK_METHOD4(fetch_image, VMImage(const FetchType&, const Query&, const PrepareAction&, const ProgressMonitor&));
     MOCK_METHOD1(remove, void(const std::string&));
+    MOCK_METHOD2(clone_instance_image, VMImage(const std::string&, const std::string&));
+    MOCK_METHOD2(bake_instance_image, VMImageInfo(const std::string&, const std::string&));
     MOCK_METHOD1(has_record_for, bool(const std::string&));
     MOCK_METHOD0(prune_expired_images, void());
     MOCK_METHOD3(update_images, void(const FetchType&, const PrepareAction&, const ProgressMonitor&));
+    MOCK_METHOD4(prefetch_images,
+                 void(const FetchType&, const std::vector<Query>&, const PrepareAction&, const ProgressMonitor&));
     MOCK_METHOD1(minimum_image_size_for, MemorySize(const std::string&));
     MOCK_CONST_METHOD1(image_host_for, VMImageHost*(const std::string&));
     MOCK_CONST_METHOD1(all_info_for, std::vector<std::pair<std::string, VMImageInfo>>(const Query&));
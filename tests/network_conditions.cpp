@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "network_conditions.h"
+
+#include <thread>
+
+namespace mpt = multipass::test;
+
+void mpt::NetworkConditions::round_trip()
+{
+    ++trips;
+    maybe_stall();
+
+    if (latency.count() > 0)
+        std::this_thread::sleep_for(latency);
+}
+
+void mpt::NetworkConditions::transfer(std::int64_t bytes)
+{
+    transferred += bytes;
+    maybe_stall();
+
+    if (bytes_per_second > 0 && bytes > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds{bytes * 1'000'000 / bytes_per_second});
+}
+
+int mpt::NetworkConditions::round_trips() const
+{
+    return trips.load();
+}
+
+std::int64_t mpt::NetworkConditions::bytes_transferred() const
+{
+    return transferred.load();
+}
+
+void mpt::NetworkConditions::maybe_stall()
+{
+    if (stall_probability <= 0.0 || stall.count() <= 0)
+        return;
+
+    bool stalls;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stalls = std::bernoulli_distribution{stall_probability}(generator);
+    }
+
+    if (stalls)
+        std::this_thread::sleep_for(stall);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_NETWORK_CONDITIONS_H
+#define MULTIPASS_NETWORK_CONDITIONS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+namespace multipass
+{
+namespace test
+{
+// Slows down fakes of what goes over the network, to have tests see what a WAN would show. Nothing is delayed by
+// default. Set up what is wanted before handing this out; it may then be used from several threads.
+class NetworkConditions
+{
+public:
+    std::chrono::milliseconds latency{0}; // for each round trip
+    std::int64_t bytes_per_second{0};     // zero for no limit
+    double stall_probability{0.0};        // for each round trip or transfer, to stand in for lost packets
+    std::chrono::milliseconds stall{0};   // as long as retransmitting would take
+
+    void round_trip();
+    void transfer(std::int64_t bytes);
+
+    // What went through so far, for tests to count round trips rather than time them
+    int round_trips() const;
+    std::int64_t bytes_transferred() const;
+
+private:
+    void maybe_stall();
+
+    std::mutex mutex;
+    std::mt19937 generator{42}; // fixed, for runs to stall at the same points
+    std::atomic_int trips{0};
+    std::atomic<std::int64_t> transferred{0};
+};
+} // namespace test
+} // namespace multipass
+
+#endif // MULTIPASS_NETWORK_CONDITIONS_H
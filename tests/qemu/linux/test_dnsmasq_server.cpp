@@ -113,6 +113,20 @@ TEST_F(DNSMasqServer, finds_ip)
     EXPECT_THAT(ip.value(), Eq(mp::IPAddress(expected_ip)));
 }
 
+TEST_F(DNSMasqServer, finds_ips_of_leases_written_later)
+{
+    auto dns = make_default_dnsmasq_server();
+    EXPECT_FALSE(dns.get_ip_for(hw_addr));
+
+    make_lease_entry();
+    auto ip = dns.get_ip_for(hw_addr);
+    ASSERT_TRUE(ip);
+    EXPECT_EQ(ip->as_string(), expected_ip);
+
+    make_lease_entry("ff:ee:dd:cc:bb:aa");
+    EXPECT_FALSE(dns.get_ip_for(hw_addr));
+}
+
 TEST_F(DNSMasqServer, returns_null_ip_when_leases_file_does_not_exist)
 {
     auto dns = make_default_dnsmasq_server();
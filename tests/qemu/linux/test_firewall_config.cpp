@@ -26,6 +26,7 @@
 
 #include <multipass/format.h>
 
+#include <QFile>
 #include <QString>
 
 #include <tuple>
@@ -50,6 +51,18 @@ struct FirewallConfig : public Test
     mpt::MockLogger::Scope logger_scope = mpt::MockLogger::inject();
 };
 
+// The rules that a restore process is to apply
+QByteArray rules_restored_by(mpt::MockProcess* process)
+{
+    if (!process->program().endsWith("-restore"))
+        return {};
+
+    QFile rules_file{process->arguments().last()};
+    rules_file.open(QIODevice::ReadOnly);
+
+    return rules_file.readAll();
+}
+
 struct FirewallToUseTestSuite : FirewallConfig, WithParamInterface<std::tuple<std::string, QByteArray, QByteArray>>
 {
 };
@@ -63,7 +76,7 @@ TEST_F(FirewallConfig, iptablesNftErrorLogsWarningUsesIptablesLegacyByDefault)
 {
     const QString error_msg{"Cannot find iptables-nft"};
     mpt::MockProcessFactory::Callback firewall_callback = [&error_msg](mpt::MockProcess* process) {
-        if (process->program() == "iptables-nft")
+        if (process->program() == "iptables-nft-save")
         {
             mp::ProcessState exit_state{1, mp::ProcessState::Error{QProcess::FailedToStart, error_msg}};
             EXPECT_CALL(*process, execute(_)).WillOnce(Return(exit_state));
@@ -82,7 +95,7 @@ TEST_F(FirewallConfig, iptablesNftErrorLogsWarningUsesIptablesLegacyByDefault)
 TEST_F(FirewallConfig, firewallVerifyNoErrorDoesNotThrow)
 {
     mpt::MockProcessFactory::Callback firewall_callback = [this](mpt::MockProcess* process) {
-        if (process->arguments().contains(goodbr0))
+        if (rules_restored_by(process).contains(goodbr0.toUtf8()))
         {
             mp::ProcessState exit_state;
             exit_state.exit_code = 0;
@@ -103,7 +116,7 @@ TEST_F(FirewallConfig, firewallErrorThrowsOnVerify)
     const QByteArray msg{"Evil bridge detected!"};
 
     mpt::MockProcessFactory::Callback firewall_callback = [this, &msg](mpt::MockProcess* process) {
-        if (process->arguments().contains(evilbr0))
+        if (rules_restored_by(process).contains(evilbr0.toUtf8()))
         {
             mp::ProcessState exit_state;
             exit_state.exit_code = 1;
@@ -127,19 +140,19 @@ TEST_F(FirewallConfig, dtorDeletesKnownRules)
                                            "Multipass network {}\" -j MASQUERADE",
                                            subnet, subnet, goodbr0)
                                    .data()};
-    const QByteArray full_rule{"-A " + base_rule};
+    const QByteArray listing{"*nat\n-A " + base_rule + "\nCOMMIT\n"};
     bool delete_called{false};
 
-    mpt::MockProcessFactory::Callback firewall_callback = [&base_rule, &full_rule,
+    mpt::MockProcessFactory::Callback firewall_callback = [&base_rule, &listing,
                                                            &delete_called](mpt::MockProcess* process) {
-        if (process->arguments().contains("--list-rules"))
+        if (process->program().endsWith("-save"))
         {
-            EXPECT_CALL(*process, read_all_standard_output()).WillRepeatedly(Return(full_rule));
+            EXPECT_CALL(*process, read_all_standard_output()).WillRepeatedly(Return(listing));
         }
-        else if (process->program() == "sh" && process->arguments().at(1).contains("--delete"))
+        else if (const auto rules = rules_restored_by(process); rules.contains("--delete"))
         {
             delete_called = true;
-            EXPECT_TRUE(process->arguments().at(1).contains(base_rule));
+            EXPECT_TRUE(rules.contains("*nat\n--delete " + base_rule + "\nCOMMIT\n"));
         }
     };
 
@@ -159,17 +172,17 @@ TEST_F(FirewallConfig, dtorDeleteErrorLogsErrorAndContinues)
                                            "Multipass network {}\" -j MASQUERADE",
                                            subnet, subnet, goodbr0)
                                    .data()};
-    const QByteArray full_rule{"-A " + base_rule};
+    const QByteArray listing{"*nat\n-A " + base_rule + "\nCOMMIT\n"};
     const QByteArray msg{"Bad stuff happened"};
 
     mpt::MockProcessFactory::Callback firewall_callback = [&](mpt::MockProcess* process) {
-        if (process->arguments().contains("--list-rules"))
+        if (process->program().endsWith("-save"))
         {
-            EXPECT_CALL(*process, read_all_standard_output()).WillRepeatedly(Return(full_rule));
+            EXPECT_CALL(*process, read_all_standard_output()).WillRepeatedly(Return(listing));
         }
-        else if (process->program() == "sh" && process->arguments().at(1).contains("--delete"))
+        else if (const auto rules = rules_restored_by(process); rules.contains("--delete"))
         {
-            if (process->arguments().at(1).contains(base_rule))
+            if (rules.contains(base_rule))
             {
                 mp::ProcessState exit_state;
                 exit_state.exit_code = 1;
@@ -195,11 +208,11 @@ TEST_P(FirewallToUseTestSuite, usesExpectedFirewall)
     const auto& param = GetParam();
 
     mpt::MockProcessFactory::Callback firewall_callback = [&param](mpt::MockProcess* process) {
-        if (process->program() == "iptables-nft" && process->arguments().contains("--list-rules"))
+        if (process->program() == "iptables-nft-save")
         {
             EXPECT_CALL(*process, read_all_standard_output()).WillOnce(Return(std::get<1>(param)));
         }
-        else if (process->program() == "iptables-legacy" && process->arguments().contains("--list-rules"))
+        else if (process->program() == "iptables-legacy-save")
         {
             EXPECT_CALL(*process, read_all_standard_output()).WillOnce(Return(std::get<2>(param)));
         }
@@ -215,10 +228,11 @@ TEST_P(FirewallToUseTestSuite, usesExpectedFirewall)
 }
 
 INSTANTIATE_TEST_SUITE_P(FirewallConfig, FirewallToUseTestSuite,
-                         Values(std::make_tuple("iptables-legacy", QByteArray(), "-N FOO"),
-                                std::make_tuple("iptables-nft", "-N FOO", QByteArray()),
+                         Values(std::make_tuple("iptables-legacy", QByteArray(), ":FOO - [0:0]"),
+                                std::make_tuple("iptables-nft", ":FOO - [0:0]", QByteArray()),
                                 std::make_tuple("iptables-nft", QByteArray(), QByteArray()),
-                                std::make_tuple("iptables-nft", "-N FOO", "-N FOO")));
+                                std::make_tuple("iptables-nft", "*filter\n-A FOO -j ACCEPT", ":FOO - [0:0]"),
+                                std::make_tuple("iptables-nft", "*filter\n:INPUT ACCEPT [0:0]", QByteArray())));
 
 TEST_P(KernelCheckTestSuite, usesIptablesAndLogsWithBadKernelInfo)
 {
@@ -226,11 +240,11 @@ TEST_P(KernelCheckTestSuite, usesIptablesAndLogsWithBadKernelInfo)
     bool nftables_called{false};
 
     mpt::MockProcessFactory::Callback firewall_callback = [&nftables_called](mpt::MockProcess* process) {
-        if (process->program() == "iptables-legacy" && process->arguments().contains("--list-rules"))
+        if (process->program() == "iptables-legacy-save")
         {
-            EXPECT_CALL(*process, read_all_standard_output()).WillOnce(Return(QByteArray()));
+            EXPECT_CALL(*process, read_all_standard_output()).WillRepeatedly(Return(QByteArray()));
         }
-        else if (process->program() == "iptables-nft")
+        else if (process->program().startsWith("iptables-nft"))
         {
             nftables_called = true;
         }
@@ -19,11 +19,11 @@
 #include "mock_firewall_config.h"
 
 #include "tests/common.h"
+#include "tests/linux/mock_netlink.h"
 #include "tests/mock_backend_utils.h"
 #include "tests/mock_file_ops.h"
 #include "tests/mock_logger.h"
 #include "tests/mock_process_factory.h"
-#include "tests/mock_utils.h"
 #include "tests/temp_dir.h"
 
 #include <src/platform/backends/qemu/linux/qemu_platform_detail.h>
@@ -52,9 +52,8 @@ struct QemuPlatformDetail : public Test
             return std::move(mock_firewall_config);
         });
 
-        EXPECT_CALL(*mock_utils, run_cmd_for_status(QString("ip"), _, _)).WillRepeatedly(Return(true));
-        EXPECT_CALL(*mock_utils,
-                    run_cmd_for_status(QString("ip"), QStringList({"addr", "show", multipass_bridge_name}), _))
+        EXPECT_CALL(*mock_netlink, link_exists(_)).WillRepeatedly(Return(true));
+        EXPECT_CALL(*mock_netlink, link_exists(multipass_bridge_name))
             .WillOnce(Return(false))
             .WillOnce(Return(true));
 
@@ -71,8 +70,8 @@ struct QemuPlatformDetail : public Test
     std::unique_ptr<mpt::MockDNSMasqServer> mock_dnsmasq_server;
     std::unique_ptr<mpt::MockFirewallConfig> mock_firewall_config;
 
-    mpt::MockUtils::GuardedMock utils_attr{mpt::MockUtils::inject<NiceMock>()};
-    mpt::MockUtils* mock_utils = utils_attr.first;
+    mpt::MockNetlink::GuardedMock netlink_attr{mpt::MockNetlink::inject<NiceMock>()};
+    mpt::MockNetlink* mock_netlink = netlink_attr.first;
 
     mpt::MockBackend::GuardedMock backend_attr{mpt::MockBackend::inject<NiceMock>()};
     mpt::MockBackend* mock_backend = backend_attr.first;
@@ -94,24 +93,11 @@ struct QemuPlatformDetail : public Test
 
 TEST_F(QemuPlatformDetail, ctor_sets_up_expected_virtual_switch)
 {
-    const QString qstring_subnet{QString::fromStdString(subnet)};
-
-    EXPECT_CALL(*mock_utils, run_cmd_for_status(QString("ip"),
-                                                ElementsAre(QString("link"), QString("add"), multipass_bridge_name,
-                                                            QString("address"), _, QString("type"), QString("bridge")),
-                                                _))
-        .WillOnce(Return(true));
-    EXPECT_CALL(*mock_utils, run_cmd_for_status(QString("ip"),
-                                                ElementsAre(QString("address"), QString("add"),
-                                                            QString("%1.1/24").arg(qstring_subnet), QString("dev"),
-                                                            multipass_bridge_name, "broadcast",
-                                                            QString("%1.255").arg(qstring_subnet)),
-                                                _))
-        .WillOnce(Return(true));
-    EXPECT_CALL(*mock_utils, run_cmd_for_status(
-                                 QString("ip"),
-                                 ElementsAre(QString("link"), QString("set"), multipass_bridge_name, QString("up")), _))
-        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_netlink, add_bridge(multipass_bridge_name, _)).WillOnce(Return());
+    EXPECT_CALL(*mock_netlink, add_address(multipass_bridge_name, fmt::format("{}.1/24", subnet),
+                                           fmt::format("{}.255", subnet)))
+        .WillOnce(Return());
+    EXPECT_CALL(*mock_netlink, set_up(multipass_bridge_name)).WillOnce(Return());
 
     mp::QemuPlatformDetail qemu_platform_detail{data_dir.path()};
 }
@@ -139,14 +125,15 @@ TEST_F(QemuPlatformDetail, platform_args_generate_net_resources_removes_works_as
 
     EXPECT_CALL(*mock_dnsmasq_server, release_mac(hw_addr)).WillOnce(Return());
 
-    EXPECT_CALL(
-        *mock_utils,
-        run_cmd_for_status(QString("ip"),
-                           ElementsAre(QString("addr"), QString("show"), mpt::match_qstring(StartsWith("tap-"))), _))
-        .WillOnce([&tap_name](auto& cmd, auto& opts, auto...) {
-            tap_name = opts.last();
+    EXPECT_CALL(*mock_netlink, link_exists(mpt::match_qstring(StartsWith("tap-"))))
+        .WillOnce([&tap_name](const QString& name) {
+            tap_name = name;
             return false;
         });
+    EXPECT_CALL(*mock_netlink, add_tap(mpt::match_qstring(StartsWith("tap-")), false)).WillOnce(Return());
+    EXPECT_CALL(*mock_netlink, set_master(mpt::match_qstring(StartsWith("tap-")), multipass_bridge_name))
+        .WillOnce(Return());
+    EXPECT_CALL(*mock_netlink, set_up(mpt::match_qstring(StartsWith("tap-")))).WillOnce(Return());
 
     mp::QemuPlatformDetail qemu_platform_detail{data_dir.path()};
 
@@ -160,16 +147,31 @@ TEST_F(QemuPlatformDetail, platform_args_generate_net_resources_removes_works_as
 
     EXPECT_THAT(platform_args, ElementsAreArray(expected_platform_args));
 
-    EXPECT_CALL(*mock_utils,
-                run_cmd_for_status(QString("ip"), ElementsAre(QString("addr"), QString("show"), tap_name), _))
-        .WillOnce(Return(true));
-    EXPECT_CALL(*mock_utils,
-                run_cmd_for_status(QString("ip"), ElementsAre(QString("link"), QString("delete"), tap_name), _))
-        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_netlink, link_exists(tap_name)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_netlink, delete_link(tap_name)).WillOnce(Return());
 
     qemu_platform_detail.remove_resources_for(name);
 }
 
+TEST_F(QemuPlatformDetail, platform_args_tune_the_interface_when_asked)
+{
+    mp::VirtualMachineDescription vm_desc;
+    vm_desc.vm_name = "foo";
+    vm_desc.num_cores = 4;
+    vm_desc.default_mac_address = hw_addr;
+    vm_desc.network_options = {true, 0, 512};
+
+    EXPECT_CALL(*mock_netlink, add_tap(_, true)).WillOnce(Return());
+
+    mp::QemuPlatformDetail qemu_platform_detail{data_dir.path()};
+
+    const auto platform_args = qemu_platform_detail.vm_platform_args(vm_desc);
+
+    EXPECT_THAT(platform_args, Contains(mpt::match_qstring(HasSubstr(",vhost=on,queues=4"))));
+    EXPECT_THAT(platform_args,
+                Contains(mpt::match_qstring(HasSubstr(",mq=on,vectors=10,rx_queue_size=512,tx_queue_size=512"))));
+}
+
 TEST_F(QemuPlatformDetail, platform_health_check_calls_expected_methods)
 {
     EXPECT_CALL(*mock_backend, check_for_kvm_support()).WillOnce(Return());
@@ -37,11 +37,14 @@ struct MockQemuPlatform : public QemuPlatform
     }
 
     MOCK_METHOD1(get_ip_for, optional<IPAddress>(const std::string&));
+    MOCK_METHOD1(neighbour_ipv4_for, std::vector<std::string>(const std::vector<std::string>&));
     MOCK_METHOD1(remove_resources_for, void(const std::string&));
     MOCK_METHOD0(platform_health_check, void());
     MOCK_METHOD0(vmstate_platform_args, QStringList());
     MOCK_METHOD1(vm_platform_args, QStringList(const VirtualMachineDescription&));
     MOCK_METHOD0(get_directory_name, QString());
+    MOCK_METHOD2(pin_thread, void(qint64, const std::vector<int>&));
+    MOCK_METHOD1(network_bytes_for, optional<NetworkBytes>(const std::string&));
 };
 
 struct MockQemuPlatformFactory : public QemuPlatformFactory
@@ -38,6 +38,7 @@
 #include <multipass/virtual_machine.h>
 #include <multipass/virtual_machine_description.h>
 
+#include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -246,6 +247,48 @@ TEST_F(QemuBackend, machine_start_suspend_sends_monitoring_event)
     machine->suspend();
 }
 
+TEST_F(QemuBackend, suspends_by_migrating_to_a_file_when_asked)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    mpt::SetEnvScope suspend_engine{"MULTIPASS_QEMU_SUSPEND_ENGINE", "migrate"};
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+
+    QString migration_uri;
+    process_factory->register_callback([&migration_uri](mpt::MockProcess* process) {
+        if (!process->program().contains("qemu-system"))
+            return;
+
+        EXPECT_CALL(*process, wait_for_finished(_)).WillRepeatedly(Return(true));
+        EXPECT_CALL(*process, write(_)).WillRepeatedly([process, &migration_uri](const QByteArray& data) {
+            auto json_object = QJsonDocument::fromJson(data).object();
+            if (json_object["execute"] == "migrate")
+            {
+                migration_uri = json_object["arguments"].toObject()["uri"].toString();
+
+                EXPECT_CALL(*process, read_all_standard_output())
+                    .WillRepeatedly(Return("{\"event\": \"MIGRATION\", \"data\": {\"status\": \"completed\"}}"));
+                emit process->ready_read_standard_output();
+            }
+
+            return data.size();
+        });
+    });
+
+    auto machine = backend.create_virtual_machine(default_description, mock_monitor);
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    EXPECT_CALL(mock_monitor, on_suspend());
+    machine->suspend();
+
+    EXPECT_EQ(migration_uri, "file:" + default_description.image.image_path + ".vmstate");
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::suspended);
+}
+
 TEST_F(QemuBackend, throws_when_starting_while_suspending)
 {
     EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
@@ -555,6 +598,79 @@ TEST_F(QemuBackend, returns_version_string)
     EXPECT_EQ(backend.get_backend_version_string(), "qemu-2.11.1");
 }
 
+TEST_F(QemuBackend, asks_qemu_for_its_version_once)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    process_factory->register_callback([](mpt::MockProcess* process) {
+        if (process->program().contains("qemu-system-") && process->arguments().contains("--version"))
+        {
+            mp::ProcessState exit_state;
+            exit_state.exit_code = 0;
+            EXPECT_CALL(*process, execute(_)).WillOnce(Return(exit_state));
+            EXPECT_CALL(*process, read_all_standard_output()).WillOnce(Return("QEMU emulator version 6.2.0\n"));
+        }
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+
+    EXPECT_EQ(backend.get_backend_version_string(), "qemu-6.2.0");
+    EXPECT_EQ(backend.get_backend_version_string(), "qemu-6.2.0");
+    EXPECT_EQ(process_factory->process_list().size(), 1u);
+}
+
+TEST_F(QemuBackend, asks_qemu_for_the_machine_type_once_for_all_instances)
+{
+    constexpr auto machine_type = "pc-q35-6.2";
+
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    process_factory->register_callback([machine_type](mpt::MockProcess* process) {
+        const auto arguments = process->arguments();
+        if (!arguments.contains("-dump-vmstate"))
+        {
+            handle_qemu_system(process);
+            return;
+        }
+
+        const auto dump_file = arguments.at(arguments.indexOf("-dump-vmstate") + 1);
+        EXPECT_CALL(*process, execute(_)).WillOnce([dump_file, machine_type](auto...) {
+            QFile file{dump_file};
+            file.open(QIODevice::WriteOnly);
+            file.write(QJsonDocument{QJsonObject{{"vmschkmachine", QJsonObject{{"Name", machine_type}}}}}.toJson());
+
+            mp::ProcessState exit_state;
+            exit_state.exit_code = 0;
+            return exit_state;
+        });
+    });
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    EXPECT_CALL(mock_monitor, update_metadata_for(_, Truly([machine_type](const QJsonObject& metadata) {
+                    return metadata["machine_type"].toString() == machine_type;
+                })))
+        .Times(2);
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+
+    auto description = default_description;
+    auto first = backend.create_virtual_machine(description, mock_monitor);
+    description.vm_name = "other-valley";
+    auto second = backend.create_virtual_machine(description, mock_monitor);
+
+    first->start();
+    second->start();
+
+    const auto processes = process_factory->process_list();
+    EXPECT_EQ(std::count_if(processes.cbegin(), processes.cend(),
+                            [](const auto& process) { return process.arguments.contains("-dump-vmstate"); }),
+              1);
+}
+
 TEST_F(QemuBackend, returns_version_string_when_failed_parsing)
 {
     EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "tests/common.h"
+
+#include <src/platform/backends/qemu/qemu_guest_agent.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+struct QemuGuestAgent : public Test
+{
+    QJsonObject sent(std::size_t i) const
+    {
+        return QJsonDocument::fromJson(written.at(i)).object();
+    }
+
+    QByteArray reply_to(const QJsonObject& command, const QJsonValue& value) const
+    {
+        return QJsonDocument(QJsonObject{{"return", value}, {"id", command["id"]}}).toJson(QJsonDocument::Compact) +
+               '\n';
+    }
+
+    std::vector<QByteArray> written;
+    mp::QmpClient qmp{[this](const QByteArray& data) { written.push_back(data); }};
+    mp::QemuGuestAgent agent{qmp};
+};
+
+TEST_F(QemuGuestAgent, puts_together_what_the_balloon_and_the_agent_report)
+{
+    mp::optional<mp::GuestMetrics> metrics;
+    agent.query_metrics([&metrics](const mp::GuestMetrics& reported) { metrics = reported; });
+
+    ASSERT_THAT(written, SizeIs(5));
+    EXPECT_EQ(sent(0)["execute"], "qom-get");
+    qmp.feed(reply_to(sent(0), QJsonObject{{"stats", QJsonObject{{"stat-total-memory", 4096},
+                                                                   {"stat-available-memory", 1024}}}}));
+
+    // What the agent gets goes through its ring buffer, and so does what it answers
+    QByteArray answers;
+    const QJsonValue replies[] = {
+        QJsonObject{{"load1", 0.5}, {"load5", 0.25}, {"load15", 0.1}},
+        QJsonArray{QJsonObject{{"mountpoint", "/boot"}, {"used-bytes", 1}, {"total-bytes", 2}},
+                   QJsonObject{{"mountpoint", "/"}, {"used-bytes", 300}, {"total-bytes", 900}}},
+        QJsonObject{{"pretty-name", "Ubuntu 22.04 LTS"}},
+        QJsonArray{QJsonObject{{"name", "lo"},
+                               {"ip-addresses", QJsonArray{QJsonObject{{"ip-address-type", "ipv4"},
+                                                                       {"ip-address", "127.0.0.1"}}}}},
+                   QJsonObject{{"name", "ens3"},
+                               {"ip-addresses", QJsonArray{QJsonObject{{"ip-address-type", "ipv4"},
+                                                                       {"ip-address", "10.0.0.5"}},
+                                                           QJsonObject{{"ip-address-type", "ipv6"},
+                                                                       {"ip-address", "fe80::1"}}}}}}};
+    for (auto i = 0; i < 4; ++i)
+    {
+        const auto write = sent(i + 1);
+        ASSERT_EQ(write["execute"], "ringbuf-write");
+        const auto command = QJsonDocument::fromJson(write["arguments"].toObject()["data"].toString().toUtf8());
+        answers += reply_to(command.object(), replies[i]);
+    }
+
+    agent.read();
+    ASSERT_THAT(written, SizeIs(6));
+    EXPECT_EQ(sent(5)["execute"], "ringbuf-read");
+    EXPECT_FALSE(metrics);
+
+    qmp.feed(reply_to(sent(5), QString::fromUtf8(answers)));
+
+    ASSERT_TRUE(metrics);
+    ASSERT_TRUE(metrics->load);
+    EXPECT_DOUBLE_EQ((*metrics->load)[1], 0.25);
+    EXPECT_EQ(metrics->memory_total, 4096);
+    EXPECT_EQ(metrics->memory_usage, 3072);
+    EXPECT_EQ(metrics->disk_usage, 300);
+    EXPECT_EQ(metrics->disk_total, 900);
+    EXPECT_EQ(metrics->current_release, "Ubuntu 22.04 LTS");
+    EXPECT_THAT(metrics->ipv4, ElementsAre("10.0.0.5"));
+}
+
+TEST_F(QemuGuestAgent, forgets_pending_queries_on_reset)
+{
+    auto answered = false;
+    agent.set_open(true);
+    agent.query_metrics([&answered](const mp::GuestMetrics&) { answered = true; });
+    agent.reset();
+
+    agent.read();
+    const auto command = QJsonDocument::fromJson(sent(4)["arguments"].toObject()["data"].toString().toUtf8()).object();
+    qmp.feed(reply_to(sent(5), QString::fromUtf8(reply_to(command, QJsonArray{}))));
+
+    EXPECT_FALSE(answered);
+    EXPECT_FALSE(agent.is_open());
+}
+} // namespace
@@ -17,11 +17,16 @@
 
 #include "tests/common.h"
 #include "tests/mock_process_factory.h"
+#include "tests/temp_file.h"
 
 #include <src/platform/backends/shared/qemu_img_utils/qemu_img_utils.h>
 
 #include <multipass/constants.h>
 #include <multipass/memory_size.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <QDataStream>
+#include <QFile>
 
 namespace mp = multipass;
 namespace mpt = multipass::test;
@@ -95,6 +100,36 @@ void simulate_qemuimg_convert(const mpt::MockProcess* process, const QString& im
     EXPECT_CALL(*process, execute).WillOnce(Return(produce_result));
 }
 
+// Writes a minimal qcow2 header followed by a snapshot table with the given names
+void make_qcow2_image(const QString& path, const QStringList& snapshot_names)
+{
+    QFile file{path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+
+    constexpr quint64 snapshots_offset = 512;
+    QDataStream stream{&file};
+    stream << quint32{0x514649fb} << quint32{3};
+    ASSERT_TRUE(file.seek(60));
+    stream << static_cast<quint32>(snapshot_names.size()) << snapshots_offset;
+
+    ASSERT_TRUE(file.seek(snapshots_offset));
+    for (const auto& name : snapshot_names)
+    {
+        const QByteArray id{"1"};
+        const auto name_bytes = name.toUtf8();
+        const QByteArray extra_data(16, '\0');
+
+        stream << quint64{0} << quint32{0} << static_cast<quint16>(id.size()) << static_cast<quint16>(name_bytes.size())
+               << quint32{0} << quint32{0} << quint64{0} << quint32{0} << static_cast<quint32>(extra_data.size());
+        file.write(extra_data);
+        file.write(id);
+        file.write(name_bytes);
+
+        const auto entry_size = 40 + extra_data.size() + id.size() + name_bytes.size();
+        file.write(QByteArray((8 - entry_size % 8) % 8, '\0'));
+    }
+}
+
 template <class Matcher>
 void test_image_resizing(const char* img, const mp::MemorySize& img_virtual_size, const mp::MemorySize& requested_size,
                          const mp::ProcessState& qemuimg_resize_result, mp::optional<Matcher> throw_msg_matcher)
@@ -206,6 +241,156 @@ TEST(QemuImgUtils, image_resize_detects_resizing_crash_failure_and_throws)
     test_image_resizing(img, min_size, request_size, qemuimg_resize_result, throw_msg_matcher);
 }
 
+TEST(QemuImgUtils, overlay_image_is_created_on_top_of_backing_image)
+{
+    auto process_count = 0;
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+
+    mock_factory_scope->register_callback([&process_count](mpt::MockProcess* process) {
+        ++process_count;
+        ASSERT_EQ(process->program().toStdString(), "qemu-img");
+        EXPECT_EQ(process->arguments(), QStringList({"create", "-f", "qcow2", "-F", "qcow2", "-b",
+                                                     "/vault/images/ubuntu.img", "/instances/foo/ubuntu.img"}));
+        EXPECT_CALL(*process, execute).WillOnce(Return(success));
+    });
+
+    EXPECT_EQ(mp::backend::create_overlay_image("/vault/images/ubuntu.img", QDir{"/instances/foo"}),
+              "/instances/foo/ubuntu.img");
+    EXPECT_EQ(process_count, 1);
+}
+
+TEST(QemuImgUtils, overlay_image_creation_failure_throws)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+
+    mock_factory_scope->register_callback(
+        [](mpt::MockProcess* process) { EXPECT_CALL(*process, execute).WillOnce(Return(failure)); });
+
+    MP_EXPECT_THROW_THAT(mp::backend::create_overlay_image("/vault/images/ubuntu.img", QDir{"/instances/foo"}),
+                         std::runtime_error, mpt::match_what(HasSubstr("Cannot create instance image")));
+}
+
+TEST(QemuImgUtils, image_compression_falls_back_to_zlib_on_older_qemu)
+{
+    std::vector<QStringList> calls;
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+
+    mock_factory_scope->register_callback([&calls](mpt::MockProcess* process) {
+        calls.push_back(process->arguments());
+        EXPECT_CALL(*process, execute).WillOnce(Return(calls.size() == 1 ? failure : success));
+    });
+
+    mp::backend::compress_image("/vault/images/ubuntu.img", "/vault/images/ubuntu.img.compressed");
+
+    ASSERT_EQ(calls.size(), 2u);
+    EXPECT_EQ(calls[0], QStringList({"convert", "-c", "-O", "qcow2", "-o", "compression_type=zstd",
+                                     "/vault/images/ubuntu.img", "/vault/images/ubuntu.img.compressed"}));
+    EXPECT_EQ(calls[1], QStringList({"convert", "-c", "-O", "qcow2", "/vault/images/ubuntu.img",
+                                     "/vault/images/ubuntu.img.compressed"}));
+}
+
+TEST(QemuImgUtils, image_compression_failure_throws)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+
+    mock_factory_scope->register_callback(
+        [](mpt::MockProcess* process) { EXPECT_CALL(*process, execute).WillOnce(Return(failure)); });
+
+    MP_EXPECT_THROW_THAT(mp::backend::compress_image("/vault/images/ubuntu.img", "/vault/images/ubuntu.img.compressed"),
+                         std::runtime_error, mpt::match_what(HasSubstr("Cannot compress image")));
+}
+
+TEST(QemuImgUtils, image_snapshots_are_taken_applied_and_deleted_by_name)
+{
+    std::vector<QStringList> calls;
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+
+    mock_factory_scope->register_callback([&calls](mpt::MockProcess* process) {
+        calls.push_back(process->arguments());
+        EXPECT_CALL(*process, execute).WillOnce(Return(success));
+    });
+
+    mp::backend::create_image_snapshot("/instances/foo/ubuntu.img", "/vault/images/ubuntu.img", "clean");
+    mp::backend::apply_image_snapshot("/instances/foo/ubuntu.img", "/vault/images/ubuntu.img", "clean");
+    mp::backend::delete_image_snapshot("/instances/foo/ubuntu.img", "/vault/images/ubuntu.img", "clean");
+
+    ASSERT_EQ(calls.size(), 3u);
+    EXPECT_EQ(calls[0], QStringList({"snapshot", "-c", "clean", "/instances/foo/ubuntu.img"}));
+    EXPECT_EQ(calls[1], QStringList({"snapshot", "-a", "clean", "/instances/foo/ubuntu.img"}));
+    EXPECT_EQ(calls[2], QStringList({"snapshot", "-d", "clean", "/instances/foo/ubuntu.img"}));
+}
+
+TEST(QemuImgUtils, qcow2_snapshot_names_are_read_from_image)
+{
+    mpt::TempFile image;
+    make_qcow2_image(image.name(), {"first", "suspend", "a-much-longer-snapshot-name"});
+
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([](mpt::MockProcess*) { FAIL() << "No process expected"; });
+
+    const auto names = mp::backend::qcow2_snapshot_names(image.name());
+    ASSERT_TRUE(names);
+    EXPECT_EQ(*names, QStringList({"first", "suspend", "a-much-longer-snapshot-name"}));
+}
+
+TEST(QemuImgUtils, qcow2_snapshot_names_of_other_image_is_nullopt)
+{
+    mpt::TempFile image;
+    QFile file{image.name()};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(512, 'x'));
+    file.close();
+
+    EXPECT_FALSE(mp::backend::qcow2_snapshot_names(image.name()));
+    EXPECT_FALSE(mp::backend::is_qcow2_image(image.name()));
+}
+
+TEST(QemuImgUtils, qcow2_image_is_not_converted_nor_inspected_by_qemuimg)
+{
+    mpt::TempFile image;
+    make_qcow2_image(image.name(), {});
+
+    auto process_count = 0;
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([&process_count](mpt::MockProcess*) { ++process_count; });
+
+    EXPECT_EQ(mp::backend::convert_to_qcow_if_necessary(image.name()), image.name());
+    EXPECT_EQ(process_count, 0);
+}
+
+TEST(QemuImgUtils, image_conversion_reports_qemuimg_progress)
+{
+    const auto img_path = "/fake/img/path";
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([img_path](mpt::MockProcess* process) {
+        if (process->arguments().first() == "info")
+        {
+            simulate_qemuimg_info_with_json(process, img_path, success, "{\n    \"format\": \"raw\"\n}");
+        }
+        else
+        {
+            EXPECT_CALL(*process, execute).Times(0);
+            EXPECT_CALL(*process, running)
+                .WillOnce(Return(true))
+                .WillOnce(Return(true))
+                .WillRepeatedly(Return(false));
+            EXPECT_CALL(*process, read_all_standard_output)
+                .WillOnce(Return("    (25.00/100%)\r    (50.00/100%)\r"))
+                .WillOnce(Return("    (100.00/100%)\r"));
+        }
+    });
+
+    std::vector<int> reported;
+    auto monitor = [&reported](int progress_type, int percentage) {
+        EXPECT_EQ(progress_type, mp::LaunchProgress::PREPARE);
+        reported.push_back(percentage);
+        return true;
+    };
+
+    EXPECT_EQ(mp::backend::convert_to_qcow_if_necessary(img_path, monitor), QString{img_path} + ".qcow2");
+    EXPECT_THAT(reported, ElementsAre(50, 100));
+}
+
 TEST_P(ImageConversionTestSuite, properly_handles_image_conversion)
 {
     const auto img_path = "/fake/img/path";
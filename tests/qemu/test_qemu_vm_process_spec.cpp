@@ -16,7 +16,9 @@
  */
 
 #include "tests/common.h"
+#include "tests/mock_backend_utils.h"
 #include "tests/mock_environment_helpers.h"
+#include "tests/temp_file.h"
 
 #include <src/platform/backends/qemu/qemu_vm_process_spec.h>
 
@@ -24,6 +26,9 @@
 #include <QStringList>
 #include <QTemporaryDir>
 
+#include <cerrno>
+#include <cstdint>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 using namespace testing;
@@ -44,13 +49,31 @@ struct TestQemuVMProcessSpec : public Test
                                              {},
                                              {}};
     const QStringList platform_args{{"--enable-kvm", "-nic", "tap,ifname=tap_device,script=no,downscript=no"}};
+
+    mpt::MockLinuxSysCalls::GuardedMock linux_syscalls_attr{mpt::MockLinuxSysCalls::inject<NiceMock>()};
+    mpt::MockLinuxSysCalls* mock_linux_syscalls = linux_syscalls_attr.first;
+
+    TestQemuVMProcessSpec()
+    {
+        // Hosts without a vsock device, unless a test says otherwise
+        ON_CALL(*mock_linux_syscalls, open(StrEq("/dev/vhost-vsock"), _)).WillByDefault(Return(-1));
+    }
 };
 
 TEST_F(TestQemuVMProcessSpec, default_arguments_correct)
 {
     mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
 
-    EXPECT_EQ(spec.arguments(), QStringList({"--enable-kvm",
+    // What follows the counts is the room for hotplug, which depends on the host
+    auto args = spec.arguments();
+    for (const auto& [option, value] : {std::pair{"-smp", "2"}, std::pair{"-m", "3072M"}})
+    {
+        auto& argument = args[args.indexOf(option) + 1];
+        EXPECT_TRUE(argument == value || argument.startsWith(QString{value} + ','));
+        argument = value;
+    }
+
+    EXPECT_EQ(args, QStringList({"--enable-kvm",
                                              "-nic",
                                              "tap,ifname=tap_device,script=no,downscript=no",
                                              "-device",
@@ -70,10 +93,100 @@ TEST_F(TestQemuVMProcessSpec, default_arguments_correct)
                                              "-serial",
                                              "chardev:char0",
                                              "-nographic",
+                                             "-device",
+                                             "virtio-serial-pci,id=virtio-serial0",
+                                             "-chardev",
+                                             "null,id=io.multipass.booting",
+                                             "-device",
+                                             "virtserialport,bus=virtio-serial0.0,chardev=io.multipass.booting,"
+                                             "id=io.multipass.booting,name=io.multipass.booting",
+                                             "-chardev",
+                                             "null,id=io.multipass.ssh-up",
+                                             "-device",
+                                             "virtserialport,bus=virtio-serial0.0,chardev=io.multipass.ssh-up,"
+                                             "id=io.multipass.ssh-up,name=io.multipass.ssh-up",
+                                             "-chardev",
+                                             "null,id=io.multipass.initialized",
+                                             "-device",
+                                             "virtserialport,bus=virtio-serial0.0,chardev=io.multipass.initialized,"
+                                             "id=io.multipass.initialized,name=io.multipass.initialized",
+                                             "-chardev",
+                                             "ringbuf,id=qga0,size=65536",
+                                             "-device",
+                                             "virtserialport,bus=virtio-serial0.0,chardev=qga0,id=qga0,"
+                                             "name=org.qemu.guest_agent.0",
+                                             "-device",
+                                             "virtio-balloon-pci,id=balloon0,free-page-reporting=on",
                                              "-cdrom",
                                              "/path/to/cloud_init.iso"}));
 }
 
+TEST_F(TestQemuVMProcessSpec, names_the_cloud_init_datasource_instead_of_the_iso_when_there_is_one)
+{
+    auto seeded_desc = desc;
+    seeded_desc.cloud_init_iso.clear();
+    seeded_desc.cloud_init_seed_url = "http://10.1.2.1:8081/vm_name/";
+
+    mp::QemuVMProcessSpec spec(seeded_desc, platform_args, mp::nullopt);
+    const auto args = spec.arguments();
+
+    EXPECT_FALSE(args.contains("-cdrom"));
+    ASSERT_TRUE(args.contains("-smbios"));
+    EXPECT_EQ(args[args.indexOf("-smbios") + 1], "type=1,serial=ds=nocloud-net;s=http://10.1.2.1:8081/vm_name/");
+    EXPECT_FALSE(spec.apparmor_profile().contains("cloud-init ISO"));
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+TEST_F(TestQemuVMProcessSpec, leaves_room_to_plug_cpus_and_memory)
+{
+    mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
+    const auto args = spec.arguments();
+
+    EXPECT_THAT(args[args.indexOf("-smp") + 1].toStdString(), StartsWith("2,maxcpus="));
+    EXPECT_THAT(args[args.indexOf("-m") + 1].toStdString(), StartsWith("3072M,slots=16,maxmem="));
+}
+#endif
+
+TEST_F(TestQemuVMProcessSpec, claims_a_free_vsock_cid_for_the_instance)
+{
+    constexpr int vsock_fd = 42;
+    ON_CALL(*mock_linux_syscalls, open(StrEq("/dev/vhost-vsock"), _)).WillByDefault(Return(vsock_fd));
+    EXPECT_CALL(*mock_linux_syscalls, ioctl(vsock_fd, _, _))
+        .WillOnce([](auto...) {
+            errno = EADDRINUSE;
+            return -1;
+        })
+        .WillOnce(Return(0));
+    EXPECT_CALL(*mock_linux_syscalls, close(vsock_fd));
+
+    mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
+    const auto args = spec.arguments();
+
+    const auto device = args.filter("vhost-vsock-pci");
+    ASSERT_EQ(device.size(), 1);
+    EXPECT_THAT(device.front().toStdString(), StartsWith("vhost-vsock-pci,id=vsock0,guest-cid="));
+    EXPECT_EQ(args[args.indexOf(device.front()) - 1], "-device");
+}
+
+TEST_F(TestQemuVMProcessSpec, resume_claims_the_vsock_cid_again)
+{
+    ON_CALL(*mock_linux_syscalls, open(StrEq("/dev/vhost-vsock"), _)).WillByDefault(Return(42));
+    EXPECT_CALL(*mock_linux_syscalls, ioctl(42, _, _))
+        .WillOnce([](int, unsigned long, unsigned long cid) {
+            EXPECT_EQ(*reinterpret_cast<std::uint64_t*>(cid), 7u);
+            errno = EADDRINUSE;
+            return -1;
+        })
+        .WillOnce(Return(0));
+
+    const mp::QemuVMProcessSpec::ResumeData resume_data{
+        "suspend_tag", "machine_type", false, {"-device", "vhost-vsock-pci,id=vsock0,guest-cid=7"}};
+    mp::QemuVMProcessSpec spec(desc, platform_args, resume_data);
+
+    EXPECT_EQ(spec.arguments(), QStringList({"-device", "vhost-vsock-pci,id=vsock0,guest-cid=8", "-loadvm",
+                                             "suspend_tag", "-machine", "machine_type"}));
+}
+
 TEST_F(TestQemuVMProcessSpec, resume_arguments_taken_from_resumedata)
 {
     const mp::QemuVMProcessSpec::ResumeData resume_data{"suspend_tag", "machine_type", false, {"-one", "-two"}};
@@ -105,6 +218,80 @@ TEST_F(TestQemuVMProcessSpec, ResumeFixesVmnetFormat)
               QStringList({"vmnet-shared,foo", "-loadvm", "suspend_tag", "-machine", "machine_type"}));
 }
 
+TEST_F(TestQemuVMProcessSpec, resume_from_vmstate_file_waits_for_incoming_migration)
+{
+    const mp::QemuVMProcessSpec::ResumeData resume_data{
+        "suspend_tag", "machine_type", false, {"-one"}, "/path/to/image.vmstate"};
+
+    mp::QemuVMProcessSpec spec(desc, platform_args, resume_data);
+
+    EXPECT_EQ(spec.arguments(), QStringList({"-one", "-incoming", "defer", "-machine", "machine_type"}));
+}
+
+TEST_F(TestQemuVMProcessSpec, backs_memory_with_hugepages_on_the_chosen_numa_node)
+{
+    auto placed_desc = desc;
+    placed_desc.placement.hugepages = true;
+    placed_desc.placement.numa_node = 1;
+
+    mp::QemuVMProcessSpec spec(placed_desc, platform_args, mp::nullopt);
+
+    const auto args = spec.arguments();
+    EXPECT_TRUE(args.contains("memory-backend-memfd,id=mem0,size=3072M,hugetlb=on,host-nodes=1,policy=bind"));
+    EXPECT_TRUE(args.contains("node,memdev=mem0"));
+}
+
+TEST_F(TestQemuVMProcessSpec, tunes_the_disk_as_asked)
+{
+    auto tuned_desc = desc;
+    tuned_desc.disk_options = {"none", "io_uring", true, 4, true};
+
+    mp::QemuVMProcessSpec spec(tuned_desc, platform_args, mp::nullopt);
+
+    const auto args = spec.arguments();
+    EXPECT_TRUE(args.contains("iothread,id=iothread0"));
+    EXPECT_TRUE(args.contains("virtio-scsi-pci,id=scsi0,iothread=iothread0,num_queues=4"));
+    EXPECT_TRUE(args.contains("file=/path/to/image,if=none,format=qcow2,discard=unmap,id=hda,cache=none,aio=io_uring,"
+                              "detect-zeroes=unmap"));
+}
+
+TEST_F(TestQemuVMProcessSpec, leaves_memory_alone_without_placement)
+{
+    mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
+
+    EXPECT_FALSE(spec.arguments().contains("-numa"));
+}
+
+TEST_F(TestQemuVMProcessSpec, boots_the_kernel_of_the_image_directly)
+{
+    mpt::TempFile kernel, initrd;
+    auto fast_desc = desc;
+    fast_desc.image.kernel_path = kernel.name();
+    fast_desc.image.initrd_path = initrd.name();
+
+    mp::QemuVMProcessSpec spec(fast_desc, platform_args, mp::nullopt);
+
+    const auto args = spec.arguments();
+    EXPECT_EQ(args.mid(args.indexOf("-kernel"), 6),
+              QStringList({"-kernel", kernel.name(), "-initrd", initrd.name(), "-append",
+                           "root=LABEL=cloudimg-rootfs ro console=ttyS0"}));
+    EXPECT_TRUE(args.contains("-nodefaults"));
+    EXPECT_TRUE(spec.apparmor_profile().contains(kernel.name() + " r,"));
+    EXPECT_TRUE(spec.apparmor_profile().contains(initrd.name() + " r,"));
+}
+
+TEST_F(TestQemuVMProcessSpec, boots_through_the_firmware_without_kernel_files)
+{
+    auto missing_desc = desc;
+    missing_desc.image.kernel_path = "/path/to/missing/kernel";
+    missing_desc.image.initrd_path = "/path/to/missing/initrd";
+
+    mp::QemuVMProcessSpec spec(missing_desc, platform_args, mp::nullopt);
+
+    EXPECT_FALSE(spec.arguments().contains("-kernel"));
+    EXPECT_FALSE(spec.arguments().contains("-nodefaults"));
+}
+
 TEST_F(TestQemuVMProcessSpec, apparmor_profile_has_correct_name)
 {
     mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
@@ -120,6 +307,23 @@ TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_disk_images)
     EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/cloud_init.iso rk,"));
 }
 
+TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_backing_image)
+{
+    auto overlay_desc = desc;
+    overlay_desc.image.backing_image_path = "/path/to/backing_image";
+
+    mp::QemuVMProcessSpec spec(overlay_desc, platform_args, mp::nullopt);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/backing_image rk,"));
+}
+
+TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_vmstate_file)
+{
+    mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/image.vmstate rw,"));
+}
+
 TEST_F(TestQemuVMProcessSpec, apparmor_profile_identifier)
 {
     mp::QemuVMProcessSpec spec(desc, platform_args, mp::nullopt);
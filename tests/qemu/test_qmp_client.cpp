@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "tests/common.h"
+
+#include <src/platform/backends/qemu/qmp_client.h>
+
+#include <QJsonDocument>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+struct QmpClient : public Test
+{
+    QJsonObject sent(std::size_t i) const
+    {
+        return QJsonDocument::fromJson(written.at(i)).object();
+    }
+
+    std::vector<QByteArray> written;
+    mp::QmpClient qmp{[this](const QByteArray& data) { written.push_back(data); }};
+};
+
+TEST_F(QmpClient, sends_commands_one_per_line)
+{
+    qmp.execute("qmp_capabilities");
+    qmp.execute("balloon", QJsonObject{{"value", 1024}});
+
+    ASSERT_THAT(written, SizeIs(2));
+    EXPECT_TRUE(written[0].endsWith('\n'));
+    EXPECT_EQ(sent(0)["execute"], "qmp_capabilities");
+    EXPECT_FALSE(sent(0).contains("id"));
+    EXPECT_EQ(sent(1)["arguments"].toObject()["value"], 1024);
+}
+
+TEST_F(QmpClient, hands_replies_to_the_commands_they_answer)
+{
+    QStringList answered;
+    qmp.execute("query-balloon", {}, [&answered](const QJsonObject& reply) {
+        answered << "balloon:" + QString::number(reply["return"].toObject()["actual"].toInt());
+    });
+    qmp.execute("query-status", {}, [&answered](const QJsonObject& reply) {
+        answered << "status:" + reply["return"].toObject()["status"].toString();
+    });
+
+    const auto balloon_id = sent(0)["id"].toString().toUtf8();
+    const auto status_id = sent(1)["id"].toString().toUtf8();
+    ASSERT_NE(balloon_id, status_id);
+
+    qmp.feed("{\"return\": {\"status\": \"running\"}, \"id\": \"" + status_id + "\"}\r\n");
+    qmp.feed("{\"return\": {\"actual\": 42}, \"id\": \"" + balloon_id + "\"}\r\n");
+    qmp.feed("{\"return\": {\"actual\": 43}, \"id\": \"" + balloon_id + "\"}\r\n"); // nobody waits on it anymore
+
+    EXPECT_THAT(answered, ElementsAre("status:running", "balloon:42"));
+}
+
+TEST_F(QmpClient, hands_events_to_their_subscribers)
+{
+    QStringList statuses;
+    auto resumes = 0;
+    qmp.subscribe("MIGRATION", [&statuses](const QJsonObject& data) { statuses << data["status"].toString(); });
+    qmp.subscribe("RESUME", [&resumes](const QJsonObject&) { ++resumes; });
+
+    qmp.feed("{\"QMP\": {\"version\": {}, \"capabilities\": []}}\r\n"
+             "{\"event\": \"MIGRATION\", \"data\": {\"status\": \"active\"}}\r\n"
+             "{\"event\": \"STOP\"}\r\n"
+             "{\"event\": \"MIGRATION\", \"data\": {\"status\": \"completed\"}}\r\n"
+             "{\"event\": \"RESUME\"}");
+
+    EXPECT_THAT(statuses, ElementsAre("active", "completed"));
+    EXPECT_EQ(resumes, 1);
+}
+
+TEST_F(QmpClient, waits_for_the_rest_of_split_messages)
+{
+    auto resumes = 0;
+    qmp.subscribe("RESUME", [&resumes](const QJsonObject&) { ++resumes; });
+
+    qmp.feed("{\"event\": \"RES");
+    EXPECT_EQ(resumes, 0);
+
+    qmp.feed("UME\"}\r\n{\"event\":");
+    EXPECT_EQ(resumes, 1);
+
+    qmp.feed(" \"RESUME\"}\r\n");
+    EXPECT_EQ(resumes, 2);
+}
+
+TEST_F(QmpClient, forgets_pending_replies_when_dropping_them)
+{
+    auto replies = 0;
+    qmp.execute("query-blockstats", {}, [&replies](const QJsonObject&) { ++replies; });
+    const auto id = sent(0)["id"].toString().toUtf8();
+
+    qmp.feed("{\"return\": [], ");
+    qmp.drop_pending();
+    qmp.feed("{\"return\": [], \"id\": \"" + id + "\"}\r\n");
+
+    EXPECT_EQ(replies, 0);
+}
+} // namespace
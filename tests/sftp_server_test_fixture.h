@@ -39,6 +39,7 @@ struct SftpServerTest : public testing::Test
         reply_status.returnValue(SSH_OK);
         get_client_msg.returnValue(nullptr);
         handle_sftp.returnValue(nullptr);
+        channel_poll.returnValue(0);
     }
 
     decltype(MOCK(sftp_server_init)) init_sftp{MOCK(sftp_server_init)};
@@ -46,6 +47,7 @@ struct SftpServerTest : public testing::Test
     decltype(MOCK(sftp_get_client_message)) get_client_msg{MOCK(sftp_get_client_message)};
     decltype(MOCK(sftp_client_message_free)) msg_free{MOCK(sftp_client_message_free)};
     decltype(MOCK(sftp_handle)) handle_sftp{MOCK(sftp_handle)};
+    decltype(MOCK(ssh_channel_poll_timeout)) channel_poll{MOCK(ssh_channel_poll_timeout)};
     MockScope<decltype(mock_sftp_free)> free_sftp;
 
     MockSSHTestFixture mock_ssh_test_fixture;
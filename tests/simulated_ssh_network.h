@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SIMULATED_SSH_NETWORK_H
+#define MULTIPASS_SIMULATED_SSH_NETWORK_H
+
+#include "mock_sftpserver.h"
+#include "mock_ssh.h"
+#include "network_conditions.h"
+
+#include <algorithm>
+
+namespace multipass
+{
+namespace test
+{
+// Puts the mocked libssh calls that go over the wire behind @p conditions, for as long as this lives. What those mocks
+// do otherwise is kept, so create this *after* any REPLACE() of them in the test unit.
+struct SimulatedSSHNetwork
+{
+    explicit SimulatedSSHNetwork(NetworkConditions& conditions) : conditions{conditions}
+    {
+    }
+
+    template <typename T>
+    static auto round_trip_before(T& mock, NetworkConditions& conditions)
+    {
+        return [inner = mock, &conditions](auto... args) {
+            conditions.round_trip();
+            return inner(args...);
+        };
+    }
+
+    NetworkConditions& conditions;
+    MockScope<decltype(mock_ssh_connect)> connect{mock_ssh_connect, round_trip_before(mock_ssh_connect, conditions)};
+    MockScope<decltype(mock_ssh_channel_open_session)> open_session{
+        mock_ssh_channel_open_session, round_trip_before(mock_ssh_channel_open_session, conditions)};
+    MockScope<decltype(mock_ssh_channel_request_exec)> request_exec{
+        mock_ssh_channel_request_exec, round_trip_before(mock_ssh_channel_request_exec, conditions)};
+    MockScope<decltype(mock_sftp_get_client_message)> get_client_msg{
+        mock_sftp_get_client_message, round_trip_before(mock_sftp_get_client_message, conditions)};
+
+    MockScope<decltype(mock_ssh_channel_read_timeout)> channel_read{
+        mock_ssh_channel_read_timeout,
+        [inner = mock_ssh_channel_read_timeout, this](ssh_channel channel, void* dest, uint32_t count, int is_stderr,
+                                                      int timeout) {
+            auto num_bytes = inner(channel, dest, count, is_stderr, timeout);
+            this->conditions.transfer(std::max(num_bytes, 0));
+            return num_bytes;
+        }};
+    MockScope<decltype(mock_ssh_channel_write)> channel_write{
+        mock_ssh_channel_write, [inner = mock_ssh_channel_write, this](ssh_channel channel, const void* data,
+                                                                       uint32_t len) {
+            this->conditions.transfer(len);
+            return inner(channel, data, len);
+        }};
+};
+} // namespace test
+} // namespace multipass
+
+#endif // MULTIPASS_SIMULATED_SSH_NETWORK_H
@@ -19,6 +19,7 @@
 #define MULTIPASS_STUB_URL_DOWNLOADER_H
 
 #include <multipass/url_downloader.h>
+#include <multipass/vm_image_vault.h>
 
 namespace multipass
 {
@@ -33,10 +34,21 @@ struct StubURLDownloader : public multipass::URLDownloader
                      const multipass::ProgressMonitor&) override
     {
     }
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const multipass::ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+        return multipass::vault::compute_image_hash(file_name);
+    }
     QByteArray download(const QUrl& url) override
     {
         return {};
     }
+    multipass::optional<QByteArray> download_if_changed(const QUrl& url,
+                                                        multipass::DownloadValidators& validators) override
+    {
+        return QByteArray{};
+    }
 };
 } // namespace test
 } // namespace multipass
@@ -76,6 +76,11 @@ struct StubVirtualMachine final : public multipass::VirtualMachine
         return std::vector<std::string>{"192.168.2.123"};
     }
 
+    std::vector<std::string> known_ipv4() override
+    {
+        return std::vector<std::string>{"192.168.2.123"};
+    }
+
     std::string ipv6() override
     {
         return {};
@@ -105,6 +110,61 @@ struct StubVirtualMachine final : public multipass::VirtualMachine
     void resize_disk(const MemorySize&) override
     {
     }
+
+    bool resizes_while_running() override
+    {
+        return false;
+    }
+
+    void set_balloon_target(const MemorySize&) override
+    {
+    }
+
+    GuestStats guest_stats(std::chrono::milliseconds) override
+    {
+        return {};
+    }
+
+    optional<GuestMetrics> guest_metrics(std::chrono::milliseconds) override
+    {
+        return nullopt;
+    }
+
+    void update_placement(const VMPlacement&) override
+    {
+    }
+
+    void update_disk_options(const VMDiskOptions&) override
+    {
+    }
+
+    void update_network_options(const VMNetworkOptions&) override
+    {
+    }
+
+    void update_resource_limits(const VMResourceLimits&) override
+    {
+    }
+
+    void take_snapshot(const std::string&) override
+    {
+    }
+
+    void restore_snapshot(const std::string&) override
+    {
+    }
+
+    void delete_snapshot(const std::string&) override
+    {
+    }
+
+    void prepare_for_exit() override
+    {
+    }
+
+    void kill() override
+    {
+    }
 };
 } // namespace test
 } // namespace multipass
@@ -35,6 +35,16 @@ struct StubVMImageVault final : public multipass::VMImageVault
     };
 
     void remove(const std::string&) override{};
+    multipass::VMImage clone_instance_image(const std::string&, const std::string&) override
+    {
+        return {};
+    }
+
+    multipass::VMImageInfo bake_instance_image(const std::string&, const std::string&) override
+    {
+        return {};
+    }
+
     bool has_record_for(const std::string&) override
     {
         return false;
@@ -43,6 +53,8 @@ struct StubVMImageVault final : public multipass::VMImageVault
     void prune_expired_images() override{};
     void update_images(const FetchType& fetch_type, const PrepareAction& prepare,
                        const ProgressMonitor& monitor) override{};
+    void prefetch_images(const FetchType& fetch_type, const std::vector<Query>& queries, const PrepareAction& prepare,
+                         const ProgressMonitor& monitor) override{};
 
     MemorySize minimum_image_size_for(const std::string& image) override
     {
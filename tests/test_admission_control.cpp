@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/admission_control.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto gigabyte = 1ll << 30;
+
+TEST(AdmissionControl, admits_anything_without_limits)
+{
+    mp::AdmissionControl admission{{}};
+
+    EXPECT_FALSE(admission.enabled());
+    EXPECT_TRUE(admission.fits({64, 256 * gigabyte, 1}, {128, 512 * gigabyte, 40}));
+}
+
+TEST(AdmissionControl, admits_what_fits_next_to_what_is_reserved)
+{
+    mp::AdmissionControl admission{{8, 16 * gigabyte, 2}};
+
+    EXPECT_TRUE(admission.fits({2, 4 * gigabyte, 1}, {6, 12 * gigabyte, 1}));
+    EXPECT_FALSE(admission.fits({2, 4 * gigabyte, 1}, {7, 4 * gigabyte, 0}));
+    EXPECT_FALSE(admission.fits({2, 4 * gigabyte, 1}, {2, 13 * gigabyte, 0}));
+    EXPECT_FALSE(admission.fits({2, 4 * gigabyte, 1}, {2, 4 * gigabyte, 2}));
+}
+
+TEST(AdmissionControl, tells_what_never_fits)
+{
+    mp::AdmissionControl admission{{0, 16 * gigabyte, 0}};
+
+    EXPECT_TRUE(admission.ever_fits({32, 16 * gigabyte, 1}));
+    EXPECT_FALSE(admission.ever_fits({1, 17 * gigabyte, 1}));
+}
+
+TEST(AdmissionControl, serves_the_queue_in_order)
+{
+    mp::AdmissionControl admission{{0, 0, 1}};
+    EXPECT_TRUE(admission.is_turn_of(nullptr));
+
+    auto first = admission.enqueue();
+    auto second = admission.enqueue();
+
+    EXPECT_FALSE(admission.is_turn_of(nullptr));
+    EXPECT_TRUE(admission.is_turn_of(first.get()));
+    EXPECT_FALSE(admission.is_turn_of(second.get()));
+    EXPECT_EQ(second->position(), 2u);
+
+    first.reset();
+
+    EXPECT_TRUE(admission.is_turn_of(second.get()));
+    EXPECT_EQ(second->position(), 1u);
+
+    second.reset();
+    EXPECT_TRUE(admission.is_turn_of(nullptr));
+}
+} // namespace
@@ -190,7 +190,8 @@ TEST_F(AliasDictionary, mapDirWrongThrows)
     std::stringstream trash_stream;
     mpt::StubTerminal trash_term(trash_stream, trash_stream, trash_stream);
 
-    MP_ASSERT_THROW_THAT(mp::AliasDict dict(&trash_term), std::runtime_error,
+    mp::AliasDict dict(&trash_term);
+    MP_ASSERT_THROW_THAT(dict.get_alias("alias5"), std::runtime_error,
                          mpt::match_what(HasSubstr("invalid working_directory string \"wrong string\"")));
 }
 
@@ -301,8 +302,20 @@ TEST_F(AliasDictionary, throws_when_open_alias_file_fails)
 
     std::stringstream trash_stream;
     mpt::StubTerminal trash_term(trash_stream, trash_stream, trash_stream);
-    MP_ASSERT_THROW_THAT(mp::AliasDict dict(&trash_term), std::runtime_error,
-                         mpt::match_what(HasSubstr("Error opening file '")));
+    mp::AliasDict dict(&trash_term);
+    MP_ASSERT_THROW_THAT(dict.empty(), std::runtime_error, mpt::match_what(HasSubstr("Error opening file '")));
+}
+
+TEST_F(AliasDictionary, does_not_read_the_file_until_aliases_are_looked_at)
+{
+    auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
+
+    EXPECT_CALL(*mock_file_ops, exists(_)).Times(0);
+    EXPECT_CALL(*mock_file_ops, open(_, _)).Times(0);
+
+    std::stringstream trash_stream;
+    mpt::StubTerminal trash_term(trash_stream, trash_stream, trash_stream);
+    mp::AliasDict dict(&trash_term);
 }
 
 struct FormatterTestsuite
@@ -402,6 +415,17 @@ struct DaemonAliasTestsuite
         EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
         EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
         EXPECT_CALL(mock_settings, get(Eq(mp::winterm_key))).WillRepeatedly(Return("none"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::prefetch_images_key))).WillRepeatedly(Return(""));
+        EXPECT_CALL(mock_settings, get(Eq(mp::mount_cache_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::metrics_interval_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::warm_pool_size_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::reclaim_memory_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_merging_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::idle_suspend_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::cpu_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::parallel_boots_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true"));
     }
 
     mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
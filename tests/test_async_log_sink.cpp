@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/logging/async_log_sink.h>
+
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mpl = multipass::logging;
+
+using namespace testing;
+
+namespace
+{
+struct WrittenLines
+{
+    mpl::AsyncLogSink::WriteLine writer()
+    {
+        return [this](const std::string& line) {
+            std::lock_guard<std::mutex> lock{mutex};
+            lines.push_back(line);
+        };
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> lines;
+};
+
+TEST(AsyncLogSink, writes_lines_in_order)
+{
+    WrittenLines written;
+    {
+        mpl::AsyncLogSink sink{&written, written.writer()};
+        sink.push("one");
+        sink.push("two");
+        sink.push("three");
+    } // writes out what is left
+
+    EXPECT_THAT(written.lines, ElementsAre("one", "two", "three"));
+}
+
+TEST(AsyncLogSink, does_not_make_callers_wait_on_writes)
+{
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    WrittenLines written;
+    auto slow_writer = [&released, write = written.writer()](const std::string& line) {
+        released.wait();
+        write(line);
+    };
+
+    mpl::AsyncLogSink sink{&written, slow_writer};
+    sink.push("first");
+    sink.push("second"); // would hang here if pushing waited on the writer
+
+    release.set_value();
+    sink.close();
+
+    EXPECT_THAT(written.lines, ElementsAre("first", "second"));
+}
+
+TEST(AsyncLogSink, drops_lines_past_the_limit_and_says_so)
+{
+    std::promise<void> release, writing;
+    auto released = release.get_future().share();
+    WrittenLines written;
+    auto slow_writer = [&, write = written.writer()](const std::string& line) {
+        if (line == "first")
+        {
+            writing.set_value();
+            released.wait();
+        }
+        write(line);
+    };
+
+    mpl::AsyncLogSink sink{&written, slow_writer, mpl::AsyncLogSink::Overflow::drop, 1};
+    sink.push("first");
+    writing.get_future().wait(); // the writer took "first", so the queue is empty again
+
+    sink.push("second");
+    sink.push("third"); // over the limit
+
+    release.set_value();
+    sink.close();
+
+    EXPECT_THAT(written.lines, ElementsAre("first", "second", HasSubstr("1 log lines were dropped")));
+}
+
+TEST(AsyncLogSink, closing_for_a_destination_stops_its_sinks)
+{
+    WrittenLines written, other_written;
+    mpl::AsyncLogSink sink{&written, written.writer()};
+    mpl::AsyncLogSink other_sink{&other_written, other_written.writer()};
+
+    sink.push("before");
+    mpl::AsyncLogSink::close_all_for(&written);
+    EXPECT_THAT(written.lines, ElementsAre("before"));
+
+    sink.push("after");
+    other_sink.push("other");
+    other_sink.close();
+
+    EXPECT_THAT(written.lines, ElementsAre("before"));
+    EXPECT_THAT(other_written.lines, ElementsAre("other"));
+}
+} // namespace
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <src/daemon/baked_image_host.h>
+
+#include <multipass/query.h>
+
+#include <QDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct BakedImageHost : public Test
+{
+    mp::VMImageInfo bake(const QString& name)
+    {
+        QDir image_dir{baked_dir.filePath(name)};
+        QDir{}.mkpath(image_dir.absolutePath());
+        mpt::make_file_with_content(image_dir.filePath("image.img"), "baked");
+
+        mp::VMImageInfo info{{},
+                             {},
+                             {},
+                             "Baked from instance",
+                             true,
+                             image_dir.filePath("image.img"),
+                             {},
+                             {},
+                             name + "-id",
+                             {},
+                             "20221015.1200",
+                             5,
+                             false};
+        mp::BakedVMImageHost::describe(image_dir, info);
+        return info;
+    }
+
+    mpt::TempDir temp_dir;
+    QDir baked_dir{temp_dir.path()};
+    mp::BakedVMImageHost host{baked_dir};
+};
+} // namespace
+
+TEST_F(BakedImageHost, serves_baked_images_by_name)
+{
+    bake("ci-base");
+
+    auto info = host.info_for({"", "ci-base", false, "", mp::Query::Type::Alias});
+
+    ASSERT_TRUE(info);
+    EXPECT_THAT(info->aliases, ElementsAre("ci-base"));
+    EXPECT_EQ(info->release, "ci-base");
+    EXPECT_EQ(info->release_title, "Baked from instance");
+    EXPECT_EQ(info->id, "ci-base-id");
+    EXPECT_EQ(info->size, 5);
+}
+
+TEST_F(BakedImageHost, serves_baked_images_under_their_remote_only)
+{
+    bake("ci-base");
+
+    EXPECT_TRUE(host.info_for({"", "ci-base", false, "baked", mp::Query::Type::Alias}));
+    EXPECT_FALSE(host.info_for({"", "ci-base", false, "release", mp::Query::Type::Alias}));
+    EXPECT_FALSE(host.info_for({"", "jammy", false, "", mp::Query::Type::Alias}));
+}
+
+TEST_F(BakedImageHost, skips_images_not_done_baking)
+{
+    bake("ci-base");
+    QDir{}.mkpath(baked_dir.filePath("half-baked"));
+
+    EXPECT_THAT(host.all_images_for("baked", false), SizeIs(1));
+    EXPECT_FALSE(host.info_for({"", "half-baked", false, "", mp::Query::Type::Alias}));
+}
+
+TEST_F(BakedImageHost, finds_baked_images_by_full_hash)
+{
+    bake("ci-base");
+
+    EXPECT_EQ(host.info_for_full_hash("ci-base-id").release, "ci-base");
+    EXPECT_THROW(host.info_for_full_hash("unknown"), std::runtime_error);
+}
+
+TEST_F(BakedImageHost, manifest_generation_changes_with_what_is_baked)
+{
+    const auto before = host.manifest_generation();
+    bake("ci-base");
+
+    EXPECT_NE(host.manifest_generation(), before);
+    EXPECT_EQ(host.manifest_generation(), host.manifest_generation());
+}
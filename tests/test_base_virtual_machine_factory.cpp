@@ -39,7 +39,7 @@ struct MockBaseFactory : mp::BaseVirtualMachineFactory
     MOCK_METHOD2(create_virtual_machine,
                  mp::VirtualMachine::UPtr(const mp::VirtualMachineDescription&, mp::VMStatusMonitor&));
     MOCK_METHOD1(remove_resources_for, void(const std::string&));
-    MOCK_METHOD1(prepare_source_image, mp::VMImage(const mp::VMImage&));
+    MOCK_METHOD2(prepare_source_image, mp::VMImage(const mp::VMImage&, const mp::ProgressMonitor&));
     MOCK_METHOD2(prepare_instance_image, void(const mp::VMImage&, const mp::VirtualMachineDescription&));
     MOCK_METHOD0(hypervisor_health_check, void());
     MOCK_METHOD0(get_backend_version_string, QString());
@@ -142,6 +142,25 @@ TEST_F(BaseFactory, creates_cloud_init_iso_image)
     EXPECT_TRUE(QFile::exists(vm_desc.cloud_init_iso));
 }
 
+TEST_F(BaseFactory, leaves_out_the_iso_for_instances_that_fetch_their_cloud_init_data)
+{
+    mpt::TempDir iso_dir;
+    const std::string name{"foo"};
+
+    mp::VMImage image;
+    image.image_path = QString("%1/%2").arg(iso_dir.path()).arg(QString::fromStdString(name));
+
+    mp::VirtualMachineDescription vm_desc{2, mp::MemorySize{"3M"}, mp::MemorySize{}, name, "00:16:3e:fe:f2:b9", {},
+                                          "yoda", image, "/some/iso"};
+    vm_desc.cloud_init_seed_url = "http://10.1.2.1:8081/foo/";
+
+    MockBaseFactory factory;
+    factory.configure(vm_desc);
+
+    EXPECT_TRUE(vm_desc.cloud_init_iso.isEmpty());
+    EXPECT_FALSE(QFile::exists(QString("%1/cloud-init-config.iso").arg(iso_dir.path())));
+}
+
 TEST_F(BaseFactory, create_bridge_not_implemented)
 {
     StrictMock<MockBaseFactory> factory;
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "test_with_mocked_bin_path.h"
 
+#include <multipass/performance_counters.h>
 #include <multipass/process/basic_process.h>
 #include <multipass/process/simple_process_spec.h>
 
@@ -82,6 +83,23 @@ TEST_F(BasicProcessTest, execute_good_command_with_zero_exit_code)
     EXPECT_FALSE(process_state.error);
 }
 
+TEST_F(BasicProcessTest, accounts_for_spawns_and_failures)
+{
+    auto& spawns = MP_PERF_COUNTERS.counter("multipass_process_spawns", {{"program", "mock_process"}});
+    auto& failures = MP_PERF_COUNTERS.counter("multipass_process_failures", {{"program", "mock_process"}});
+    const auto spawned = spawns.load(), failed = failures.load();
+
+    mp::BasicProcess good(mp::simple_process_spec("mock_process", {"0"}));
+    good.execute();
+    mp::BasicProcess bad(mp::simple_process_spec("mock_process", {"7"}));
+    bad.execute();
+
+    EXPECT_EQ(spawns - spawned, 2u);
+    EXPECT_EQ(failures - failed, 1u);
+    EXPECT_THAT(MP_PERF_COUNTERS.openmetrics(),
+                HasSubstr("multipass_process_duration_seconds_count{program=\"mock_process\"}"));
+}
+
 TEST_F(BasicProcessTest, process_state_when_runs_and_stops_ok)
 {
     const int exit_code = 7;
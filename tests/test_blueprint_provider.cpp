@@ -365,6 +365,20 @@ TEST_F(VMBlueprintProvider, updatesBlueprintsWhenNeeded)
     blueprint_provider.all_blueprints();
 }
 
+TEST_F(VMBlueprintProvider, keepsTheIndexOfAnUnchangedArchive)
+{
+    auto [mock_poco_zip_utils, guard] = mpt::MockPocoZipUtils::inject();
+    EXPECT_CALL(*mock_poco_zip_utils, zip_archive_for(_)).WillOnce([](std::ifstream& zip_stream) {
+        return Poco::Zip::ZipArchive{zip_stream};
+    });
+
+    mp::DefaultVMBlueprintProvider blueprint_provider{blueprints_zip_url, &url_downloader, cache_dir.path(),
+                                                      std::chrono::milliseconds(0)};
+
+    EXPECT_EQ(blueprint_provider.info_for("test-blueprint2").version, "0.1");
+    EXPECT_EQ(blueprint_provider.info_for("test-blueprint2").version, "0.1");
+}
+
 TEST_F(VMBlueprintProvider, downloadFailureOnStartupLogsErrorAndDoesNotThrow)
 {
     const std::string error_msg{"There is a problem, Houston."};
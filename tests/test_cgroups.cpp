@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/cgroups.h>
+
+#include <QFile>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct Cgroups : public Test
+{
+    void make_cgroup_file(const QString& name, const std::string& content)
+    {
+        mpt::make_file_with_content(dir.filePath(name), content);
+    }
+
+    std::string cgroup_file(const QString& name)
+    {
+        QFile file{dir.filePath(name)};
+        EXPECT_TRUE(file.open(QIODevice::ReadOnly));
+        return file.readAll().trimmed().toStdString();
+    }
+
+    mpt::TempDir temp_dir;
+    QDir dir{temp_dir.path()};
+};
+
+TEST_F(Cgroups, finds_its_own_in_the_unified_hierarchy)
+{
+    make_cgroup_file("cgroup.controllers", "cpu io memory pids\n");
+    make_cgroup_file("self", "0::/system.slice/multipassd.service\n");
+
+    const auto own = mpu::own_cgroup(dir, dir.filePath("self"));
+    ASSERT_TRUE(own);
+    EXPECT_EQ(own->path(), dir.filePath("system.slice/multipassd.service"));
+}
+
+TEST_F(Cgroups, finds_none_on_hosts_without_the_unified_hierarchy)
+{
+    make_cgroup_file("self", "4:cpu,cpuacct:/system.slice/multipassd.service\n");
+
+    EXPECT_FALSE(mpu::own_cgroup(dir, dir.filePath("self")));
+}
+
+TEST_F(Cgroups, moves_the_daemon_aside_for_instances)
+{
+    make_cgroup_file("cgroup.procs", "1234\n");
+    make_cgroup_file("cgroup.controllers", "cpuset cpu io memory pids\n");
+    make_cgroup_file("cgroup.subtree_control", "");
+
+    const auto instances = mpu::set_up_cgroups(dir);
+    ASSERT_TRUE(instances);
+
+    EXPECT_EQ(instances->path(), dir.filePath(mpu::instances_cgroup));
+    EXPECT_EQ(cgroup_file("cgroup.subtree_control"), "+cpu +io +memory");
+    EXPECT_EQ(cgroup_file("daemon/cgroup.procs"), "1234");
+    EXPECT_EQ(cgroup_file("daemon/cpu.weight"), "1000");
+}
+
+TEST_F(Cgroups, removes_the_cgroups_that_instances_left_empty)
+{
+    make_cgroup_file("cgroup.procs", "");
+    make_cgroup_file("cgroup.controllers", "cpu io memory\n");
+    make_cgroup_file("cgroup.subtree_control", "");
+    ASSERT_TRUE(dir.mkpath("instances/gone"));
+    make_cgroup_file("instances/running/cgroup.procs", "4321\n"); // where the kernel would refuse
+
+    ASSERT_TRUE(mpu::set_up_cgroups(dir));
+
+    EXPECT_FALSE(dir.exists("instances/gone"));
+    EXPECT_TRUE(dir.exists("instances/running"));
+}
+
+TEST_F(Cgroups, leaves_cgroups_that_were_not_delegated)
+{
+    EXPECT_FALSE(mpu::set_up_cgroups(dir));
+    EXPECT_THAT(dir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot), IsEmpty());
+}
+
+TEST_F(Cgroups, writes_the_limits_of_instances)
+{
+    EXPECT_TRUE(mpu::apply_resource_limits(QDir{dir.filePath("primary")}, mp::VMResourceLimits{200, 50, 1 << 30, 150}));
+
+    EXPECT_EQ(cgroup_file("primary/cpu.weight"), "200");
+    EXPECT_EQ(cgroup_file("primary/io.weight"), "default 50");
+    EXPECT_EQ(cgroup_file("primary/memory.high"), "1073741824");
+    EXPECT_EQ(cgroup_file("primary/cpu.max"), "150000 100000");
+}
+
+TEST_F(Cgroups, writes_no_limits_by_default)
+{
+    EXPECT_TRUE(mpu::apply_resource_limits(QDir{dir.filePath("primary")}, mp::VMResourceLimits{}));
+
+    EXPECT_EQ(cgroup_file("primary/memory.high"), "max");
+    EXPECT_EQ(cgroup_file("primary/cpu.max"), "max 100000");
+}
+} // namespace
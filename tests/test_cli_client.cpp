@@ -52,6 +52,7 @@
 
 #include <chrono>
 #include <initializer_list>
+#include <mutex>
 #include <thread>
 #include <utility>
 
@@ -81,6 +82,14 @@ struct MockDaemonRpc : public mp::DaemonRpc
                                      grpc::ServerWriter<mp::MountReply>* response));
     MOCK_METHOD3(recover, grpc::Status(grpc::ServerContext* context, const mp::RecoverRequest* request,
                                        grpc::ServerWriter<mp::RecoverReply>* response));
+    MOCK_METHOD3(clone, grpc::Status(grpc::ServerContext* context, const mp::CloneRequest* request,
+                                     grpc::ServerWriter<mp::CloneReply>* response));
+    MOCK_METHOD3(bake, grpc::Status(grpc::ServerContext* context, const mp::BakeRequest* request,
+                                    grpc::ServerWriter<mp::BakeReply>* response));
+    MOCK_METHOD3(snapshot, grpc::Status(grpc::ServerContext* context, const mp::SnapshotRequest* request,
+                                        grpc::ServerWriter<mp::SnapshotReply>* response));
+    MOCK_METHOD3(top, grpc::Status(grpc::ServerContext* context, const mp::TopRequest* request,
+                                   grpc::ServerWriter<mp::TopReply>* response));
     MOCK_METHOD3(ssh_info, grpc::Status(grpc::ServerContext* context, const mp::SSHInfoRequest* request,
                                         grpc::ServerWriter<mp::SSHInfoReply>* response));
     MOCK_METHOD3(start, grpc::Status(grpc::ServerContext* context, const mp::StartRequest* request,
@@ -451,6 +460,49 @@ TEST_F(Client, transfer_cmd_fails_source_is_dir)
                 Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, transfer_cmd_recursive_source_is_dir_ok)
+{
+    EXPECT_CALL(mock_daemon, ssh_info(_, _, _));
+    EXPECT_THAT(send_command({"transfer", "--recursive", mpt::test_data_path().toStdString(), "test-vm:bar"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, transfer_cmd_recursive_fails_with_streaming)
+{
+    EXPECT_THAT(send_command({"transfer", "-r", "test-vm1:foo", "-"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, transfer_cmd_sync_ok)
+{
+    EXPECT_CALL(mock_daemon, ssh_info(_, _, _));
+    EXPECT_THAT(send_command({"transfer", "--sync", mpt::test_data_path().toStdString() + "good_index.json",
+                              "test-vm:bar"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, transfer_cmd_sync_fails_with_streaming)
+{
+    EXPECT_THAT(send_command({"transfer", "--sync", "-", "test-vm1:foo"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, transfer_cmd_compression_ok)
+{
+    const auto destination = mpt::test_data_path().toStdString() + "good_index.json";
+
+    EXPECT_CALL(mock_daemon, ssh_info(_, _, _)).Times(2);
+    EXPECT_THAT(send_command({"transfer", "--compression", "yes", "test-vm:foo", destination}),
+                Eq(mp::ReturnCode::Ok));
+    EXPECT_THAT(send_command({"transfer", "--compression", "auto", "test-vm:foo", destination}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, transfer_cmd_fails_bad_compression_mode)
+{
+    EXPECT_THAT(send_command({"transfer", "--compression", "maybe", "test-vm:foo",
+                              mpt::test_data_path().toStdString() + "good_index.json"}),
+                Eq(mp::ReturnCode::CommandLineError));
+}
+
 TEST_F(Client, transfer_cmd_fails_no_instance)
 {
     EXPECT_THAT(send_command({"transfer", mpt::test_data_path().toStdString() + "good_index.json", "."}),
@@ -772,6 +824,34 @@ TEST_F(Client, launch_cmd_name_option_fails_no_value)
     EXPECT_THAT(send_command({"launch", "-n"}), Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, launch_cmd_count_options_ok)
+{
+    EXPECT_CALL(mock_daemon, launch(_, _, _));
+    EXPECT_THAT(send_command({"launch", "--count", "3", "--name-prefix", "ci-", "--parallel", "2"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, launch_cmd_count_option_zero_fail)
+{
+    EXPECT_THAT(send_command({"launch", "--count", "0"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launch_cmd_parallel_option_alpha_fail)
+{
+    EXPECT_THAT(send_command({"launch", "--count", "2", "--parallel", "all"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launch_cmd_name_option_with_count_fails)
+{
+    EXPECT_THAT(send_command({"launch", "-n", "foo", "--count", "2"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launch_cmd_ephemeral_option_ok)
+{
+    EXPECT_CALL(mock_daemon, launch(_, Property(&mp::LaunchRequest::ephemeral, true), _));
+    EXPECT_THAT(send_command({"launch", "--ephemeral"}), Eq(mp::ReturnCode::Ok));
+}
+
 TEST_F(Client, launch_cmd_memory_option_ok)
 {
     EXPECT_CALL(mock_daemon, launch(_, _, _));
@@ -949,6 +1029,37 @@ TEST_F(Client, launch_cmd_does_not_automount_in_normal_instances)
     EXPECT_THAT(send_command({"launch"}), Eq(mp::ReturnCode::Ok));
 }
 
+grpc::Status reply_with_launch_phases(Unused, Unused, grpc::ServerWriter<mp::LaunchReply>* response)
+{
+    mp::LaunchReply reply;
+    reply.set_vm_instance_name("foo");
+    auto phase = reply.add_launch_phases();
+    phase->set_name("image_fetch");
+    phase->set_seconds(12.5);
+
+    response->Write(reply);
+    return grpc::Status{};
+}
+
+TEST_F(Client, launch_cmd_timings_option_shows_the_phases)
+{
+    std::stringstream cout_stream;
+    EXPECT_CALL(mock_daemon, launch).WillOnce(reply_with_launch_phases);
+
+    EXPECT_THAT(send_command({"launch", "--name", "foo", "--timings"}, cout_stream), Eq(mp::ReturnCode::Ok));
+    EXPECT_THAT(cout_stream.str(), HasSubstr("Launched: foo\n"));
+    EXPECT_THAT(cout_stream.str(), ContainsRegex("image_fetch +12.50s"));
+}
+
+TEST_F(Client, launch_cmd_does_not_show_the_phases_unless_asked)
+{
+    std::stringstream cout_stream;
+    EXPECT_CALL(mock_daemon, launch).WillOnce(reply_with_launch_phases);
+
+    EXPECT_THAT(send_command({"launch", "--name", "foo"}, cout_stream), Eq(mp::ReturnCode::Ok));
+    EXPECT_THAT(cout_stream.str(), Not(HasSubstr("image_fetch")));
+}
+
 TEST_F(Client, launch_cmd_disabled_petenv_passes)
 {
     const auto custom_petenv = "";
@@ -1284,6 +1395,34 @@ TEST_F(Client, execCmdWithDirPrependsCd)
     EXPECT_EQ(send_command({"exec", instance_name, "--working-directory", dir, "--", cmd}), mp::ReturnCode::Ok);
 }
 
+TEST_F(Client, execRewritesMountedDirFromSshInfoAlone)
+{
+    std::string instance_name{"instance"};
+    std::string cmd{"pwd"};
+    std::string source_dir{QDir::current().canonicalPath().toStdString()};
+    std::string target_dir{"/home/ubuntu/dir"};
+
+    REPLACE(ssh_channel_request_exec, ([&target_dir](ssh_channel, const char* raw_cmd) {
+                EXPECT_THAT(raw_cmd, StartsWith("'cd' '" + target_dir + "/'"));
+                return SSH_OK;
+            }));
+
+    mp::SSHInfoReply response = make_fake_ssh_info_response(instance_name);
+    auto mount = (*response.mutable_ssh_info())[instance_name].mutable_mount_info()->add_mount_paths();
+    mount->set_source_path(source_dir);
+    mount->set_target_path(target_dir);
+
+    EXPECT_CALL(mock_daemon, info(_, _, _)).Times(0);
+    EXPECT_CALL(mock_daemon, ssh_info(_, _, _))
+        .WillOnce([&response](grpc::ServerContext* context, const mp::SSHInfoRequest* request,
+                              grpc::ServerWriter<multipass::SSHInfoReply>* server) {
+            server->Write(response);
+            return grpc::Status{};
+        });
+
+    EXPECT_EQ(send_command({"exec", instance_name, "--", cmd}), mp::ReturnCode::Ok);
+}
+
 TEST_F(Client, execCmdFailsIfSshExecThrows)
 {
     std::string dir{"/home/ubuntu/"};
@@ -1323,6 +1462,72 @@ TEST_F(Client, execFailsOnArgumentClash)
     EXPECT_THAT(cerr_stream.str(), Eq("Options --working-directory and --no-map-working-directory clash\n"));
 }
 
+TEST_F(Client, execOnAllAsksForEveryRunningInstanceAtOnce)
+{
+    std::mutex mutex;
+    std::vector<std::string> commands;
+    REPLACE(ssh_channel_request_exec, ([&mutex, &commands](ssh_channel, const char* raw_cmd) {
+                std::lock_guard<std::mutex> lock{mutex};
+                commands.emplace_back(raw_cmd);
+                return SSH_OK;
+            }));
+
+    mp::SSHInfoReply response;
+    (*response.mutable_ssh_info())["first"] = make_ssh_info();
+    (*response.mutable_ssh_info())["second"] = make_ssh_info();
+
+    EXPECT_CALL(mock_daemon, ssh_info(_, Property(&mp::SSHInfoRequest::instance_name, IsEmpty()), _))
+        .WillOnce([&response](grpc::ServerContext*, const mp::SSHInfoRequest*,
+                              grpc::ServerWriter<multipass::SSHInfoReply>* server) {
+            server->Write(response);
+            return grpc::Status{};
+        });
+
+    EXPECT_EQ(send_command({"exec", "--all", "--no-map-working-directory", "--", "uname", "-a"}), mp::ReturnCode::Ok);
+    EXPECT_THAT(commands, ElementsAre("'uname' '-a'", "'uname' '-a'"));
+}
+
+TEST_F(Client, execOnInstancesPrefixesOutputAndGathersExitCodes)
+{
+    REPLACE(ssh_channel_read_timeout, [](ssh_channel, void* dest, uint32_t, int is_stderr, int) {
+        thread_local bool written = false;
+        if (is_stderr || written)
+            return 0;
+
+        written = true;
+        std::string output{"hello\n"};
+        std::copy(output.begin(), output.end(), static_cast<char*>(dest));
+        return static_cast<int>(output.size());
+    });
+    REPLACE(ssh_channel_get_exit_status, [](auto) { return 3; });
+
+    mp::SSHInfoReply response;
+    (*response.mutable_ssh_info())["a"] = make_ssh_info();
+    (*response.mutable_ssh_info())["bb"] = make_ssh_info();
+
+    EXPECT_CALL(mock_daemon, ssh_info(_, Property(&mp::SSHInfoRequest::instance_name, ElementsAre("a", "bb")), _))
+        .WillOnce([&response](grpc::ServerContext*, const mp::SSHInfoRequest*,
+                              grpc::ServerWriter<multipass::SSHInfoReply>* server) {
+            server->Write(response);
+            return grpc::Status{};
+        });
+
+    std::stringstream cout_stream, cerr_stream;
+    EXPECT_EQ(send_command({"exec", "--instances", "a,bb", "-n", "--", "cmd"}, cout_stream, cerr_stream),
+              mp::ReturnCode::CommandFail);
+    EXPECT_THAT(cout_stream.str(), AllOf(HasSubstr("a  | hello\n"), HasSubstr("bb | hello\n")));
+    EXPECT_THAT(cerr_stream.str(), AllOf(HasSubstr("a: exited with code 3\n"), HasSubstr("bb: exited with code 3\n")));
+}
+
+TEST_F(Client, execFailsOnInstancesAndAllTogether)
+{
+    std::stringstream cerr_stream;
+
+    EXPECT_THAT(send_command({"exec", "--instances", "a,b", "--all", "--", "cmd"}, trash_stream, cerr_stream),
+                Eq(mp::ReturnCode::CommandLineError));
+    EXPECT_THAT(cerr_stream.str(), Eq("Options --instances and --all clash\n"));
+}
+
 // help cli tests
 TEST_F(Client, help_cmd_ok_with_valid_single_arg)
 {
@@ -1419,6 +1624,34 @@ TEST_F(Client, list_cmd_no_ipv4_ok)
     EXPECT_THAT(send_command({"list", "--no-ipv4"}), Eq(mp::ReturnCode::Ok));
 }
 
+TEST_F(Client, list_cmd_prints_csv_parts_as_they_arrive)
+{
+    EXPECT_CALL(mock_daemon, list(_, Property(&mp::ListRequest::incremental, IsTrue()), _))
+        .WillOnce([](Unused, Unused, grpc::ServerWriter<mp::ListReply>* response) {
+            mp::ListReply first, second;
+            first.add_instances()->set_name("known");
+            second.add_instances()->set_name("pending");
+            response->Write(first);
+            response->Write(second);
+
+            return grpc::Status{};
+        });
+
+    std::stringstream cout_stream;
+    EXPECT_THAT(send_command({"list", "--format", "csv"}, cout_stream), Eq(mp::ReturnCode::Ok));
+
+    const auto output = cout_stream.str();
+    EXPECT_THAT(output, StartsWith("Name,"));
+    EXPECT_EQ(output.find("Name,", 1), std::string::npos);
+    EXPECT_LT(output.find("\nknown,"), output.find("\npending,"));
+}
+
+TEST_F(Client, list_cmd_asks_for_the_whole_list_for_tables)
+{
+    EXPECT_CALL(mock_daemon, list(_, Property(&mp::ListRequest::incremental, IsFalse()), _));
+    EXPECT_THAT(send_command({"list"}), Eq(mp::ReturnCode::Ok));
+}
+
 // mount cli tests
 // Note: mpt::test_data_path() returns an absolute path
 TEST_F(Client, mount_cmd_good_absolute_source_path)
@@ -1491,6 +1724,19 @@ TEST_F(Client, mount_cmd_fails_invalid_host_int_gid_mappings)
                 Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, mount_cmd_good_native_type)
+{
+    EXPECT_CALL(mock_daemon, mount(_, Property(&mp::MountRequest::mount_type, Eq(mp::MountRequest::NATIVE)), _));
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "--type", "native", "test-vm:test"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, mount_cmd_fails_bad_type)
+{
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "--type", "nfs", "test-vm:test"}),
+                Eq(mp::ReturnCode::CommandLineError));
+}
+
 // recover cli tests
 TEST_F(Client, recover_cmd_fails_no_args)
 {
@@ -1525,6 +1771,162 @@ TEST_F(Client, recover_cmd_fails_with_names_and_all)
     EXPECT_THAT(send_command({"recover", "--all", "foo", "bar"}), Eq(mp::ReturnCode::CommandLineError));
 }
 
+// clone cli tests
+TEST_F(Client, clone_cmd_fails_no_args)
+{
+    EXPECT_THAT(send_command({"clone"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, clone_cmd_fails_without_destination)
+{
+    EXPECT_THAT(send_command({"clone", "foo"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, clone_cmd_ok_with_source_and_destinations)
+{
+    EXPECT_CALL(mock_daemon, clone(_, Property(&mp::CloneRequest::source_name, StrEq("foo")), _));
+    EXPECT_THAT(send_command({"clone", "foo", "bar", "baz"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, clone_cmd_asks_for_every_copy)
+{
+    EXPECT_CALL(mock_daemon, clone(_, Property(&mp::CloneRequest::destination_names, ElementsAre("bar", "baz")), _));
+    EXPECT_THAT(send_command({"clone", "foo", "bar", "baz"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, clone_cmd_fails_when_the_daemon_does)
+{
+    EXPECT_CALL(mock_daemon, clone(_, _, _)).WillOnce(Return(grpc::Status{grpc::StatusCode::NOT_FOUND, "msg"}));
+    EXPECT_THAT(send_command({"clone", "foo", "bar"}), Eq(mp::ReturnCode::CommandFail));
+}
+
+TEST_F(Client, clone_cmd_help_ok)
+{
+    EXPECT_THAT(send_command({"clone", "-h"}), Eq(mp::ReturnCode::Ok));
+}
+
+// bake cli tests
+TEST_F(Client, bake_cmd_fails_no_args)
+{
+    EXPECT_THAT(send_command({"bake"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, bake_cmd_fails_without_image_name)
+{
+    EXPECT_THAT(send_command({"bake", "foo"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, bake_cmd_fails_with_too_many_args)
+{
+    EXPECT_THAT(send_command({"bake", "foo", "bar", "baz"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, bake_cmd_ok_with_instance_and_image_name)
+{
+    EXPECT_CALL(mock_daemon, bake(_,
+                                  AllOf(Property(&mp::BakeRequest::instance_name, StrEq("foo")),
+                                        Property(&mp::BakeRequest::image_name, StrEq("bar"))),
+                                  _));
+    EXPECT_THAT(send_command({"bake", "foo", "bar"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, bake_cmd_help_ok)
+{
+    EXPECT_THAT(send_command({"bake", "-h"}), Eq(mp::ReturnCode::Ok));
+}
+
+// snapshot cli tests
+TEST_F(Client, snapshot_cmd_fails_no_args)
+{
+    EXPECT_THAT(send_command({"snapshot"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, snapshot_cmd_fails_with_unknown_action)
+{
+    EXPECT_THAT(send_command({"snapshot", "revert", "foo", "clean"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, snapshot_cmd_fails_without_snapshot_name)
+{
+    EXPECT_THAT(send_command({"snapshot", "take", "foo"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, snapshot_cmd_list_fails_with_snapshot_name)
+{
+    EXPECT_THAT(send_command({"snapshot", "list", "foo", "clean"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, snapshot_cmd_ok_with_action_instance_and_snapshot_name)
+{
+    EXPECT_CALL(mock_daemon, snapshot(_,
+                                      AllOf(Property(&mp::SnapshotRequest::action, mp::SnapshotRequest::RESTORE),
+                                            Property(&mp::SnapshotRequest::instance_name, StrEq("foo")),
+                                            Property(&mp::SnapshotRequest::snapshot_name, StrEq("clean"))),
+                                      _));
+    EXPECT_THAT(send_command({"snapshot", "restore", "foo", "clean"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, snapshot_cmd_lists_snapshots)
+{
+    EXPECT_CALL(mock_daemon, snapshot(_, Property(&mp::SnapshotRequest::action, mp::SnapshotRequest::LIST), _))
+        .WillOnce([](Unused, Unused, grpc::ServerWriter<mp::SnapshotReply>* response) {
+            mp::SnapshotReply reply;
+            auto snapshot = reply.add_snapshots();
+            snapshot->set_name("clean");
+            snapshot->set_created("2022-08-01T10:00:00Z");
+            response->Write(reply);
+            return grpc::Status{};
+        });
+
+    std::stringstream cout_stream;
+    EXPECT_THAT(send_command({"snapshot", "list", "foo"}, cout_stream), Eq(mp::ReturnCode::Ok));
+    EXPECT_THAT(cout_stream.str(), AllOf(HasSubstr("Created"), HasSubstr("clean  2022-08-01T10:00:00Z")));
+}
+
+TEST_F(Client, snapshot_cmd_help_ok)
+{
+    EXPECT_THAT(send_command({"snapshot", "-h"}), Eq(mp::ReturnCode::Ok));
+}
+
+// top cli tests
+TEST_F(Client, top_cmd_ok_with_names_interval_and_once)
+{
+    EXPECT_CALL(mock_daemon, top(_,
+                                 AllOf(Property(&mp::TopRequest::instance_names_size, 2),
+                                       Property(&mp::TopRequest::interval_ms, 5000),
+                                       Property(&mp::TopRequest::updates, 1)),
+                                 _));
+    EXPECT_THAT(send_command({"top", "foo", "bar", "--interval", "5", "--once"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, top_cmd_fails_with_bad_interval)
+{
+    EXPECT_THAT(send_command({"top", "--interval", "0"}), Eq(mp::ReturnCode::CommandLineError));
+    EXPECT_THAT(send_command({"top", "--interval", "soon"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, top_cmd_shows_usage_of_each_instance)
+{
+    EXPECT_CALL(mock_daemon, top(_, _, _)).WillOnce([](Unused, Unused, grpc::ServerWriter<mp::TopReply>* response) {
+        mp::TopReply reply;
+        auto usage = reply.add_instances();
+        usage->set_name("foo");
+        usage->set_cpu_percent(42.5);
+        usage->set_resident_bytes(1LL << 30);
+        response->Write(reply);
+        return grpc::Status{};
+    });
+
+    std::stringstream cout_stream;
+    EXPECT_THAT(send_command({"top", "--once"}, cout_stream), Eq(mp::ReturnCode::Ok));
+    EXPECT_THAT(cout_stream.str(), AllOf(HasSubstr("foo"), HasSubstr("42.5%"), HasSubstr("1.0GiB")));
+}
+
+TEST_F(Client, top_cmd_help_ok)
+{
+    EXPECT_THAT(send_command({"top", "-h"}), Eq(mp::ReturnCode::Ok));
+}
+
 // start cli tests
 TEST_F(Client, start_cmd_ok_with_one_arg)
 {
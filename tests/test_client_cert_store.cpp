@@ -130,6 +130,27 @@ TEST_F(ClientCertStore, verifyCertInStoreReturnsTrue)
     EXPECT_TRUE(cert_store.verify_cert(cert_data));
 }
 
+TEST_F(ClientCertStore, verifyCertKeepsVerifyingTrustedCertsAndNoOthers)
+{
+    mp::ClientCertStore cert_store{temp_dir.path()};
+    cert_store.add_cert(cert_data);
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(cert_store.verify_cert(cert_data));
+        EXPECT_FALSE(cert_store.verify_cert(cert2_data));
+    }
+}
+
+TEST_F(ClientCertStore, verifyCertAcceptsCertAddedAfterRejectingIt)
+{
+    mp::ClientCertStore cert_store{temp_dir.path()};
+
+    EXPECT_FALSE(cert_store.verify_cert(cert2_data));
+    cert_store.add_cert(cert2_data);
+    EXPECT_TRUE(cert_store.verify_cert(cert2_data));
+}
+
 TEST_F(ClientCertStore, addCertAlreadyExistingDoesNotAddAgain)
 {
     const QDir dir{cert_dir};
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/cloud_init_datasource.h>
+
+#include <multipass/exceptions/download_exception.h>
+#include <multipass/url_downloader.h>
+#include <multipass/utils.h>
+
+#include <QUrl>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto foo_mac = "52:54:00:00:00:01";
+constexpr auto bar_mac = "52:54:00:00:00:02";
+
+struct CloudInitDatasource : public Test
+{
+    CloudInitDatasource()
+    {
+        desc.vm_name = "foo";
+        desc.default_mac_address = foo_mac;
+        desc.meta_data_config = YAML::Load("instance-id: foo");
+        desc.user_data_config = YAML::Load("packages: [sshfs]");
+    }
+
+    QUrl datasource_url(const QString& path)
+    {
+        return QUrl{QString{"http://127.0.0.1:%1/%2"}.arg(datasource.port()).arg(path)};
+    }
+
+    mp::VirtualMachineDescription desc;
+    std::string peer_mac{foo_mac};
+    mp::CloudInitDatasource datasource{[this](const QHostAddress&) { return peer_mac; }};
+    mp::URLDownloader downloader{std::chrono::seconds{10}};
+};
+
+TEST_F(CloudInitDatasource, serves_what_was_published_for_each_instance)
+{
+    datasource.publish(desc);
+
+    EXPECT_EQ(datasource.document_for("/foo/meta-data", foo_mac), mp::utils::emit_cloud_config(desc.meta_data_config));
+    EXPECT_EQ(datasource.document_for("/foo/user-data", foo_mac), mp::utils::emit_cloud_config(desc.user_data_config));
+    EXPECT_TRUE(datasource.document_for("/foo/vendor-data", foo_mac));
+}
+
+TEST_F(CloudInitDatasource, serves_network_config_only_when_there_is_one)
+{
+    datasource.publish(desc);
+    EXPECT_FALSE(datasource.document_for("/foo/network-config", foo_mac));
+
+    desc.network_data_config = YAML::Load("version: 2");
+    datasource.publish(desc);
+    EXPECT_TRUE(datasource.document_for("/foo/network-config", foo_mac));
+}
+
+TEST_F(CloudInitDatasource, serves_nothing_else)
+{
+    datasource.publish(desc);
+
+    EXPECT_FALSE(datasource.document_for("/bar/meta-data", foo_mac));
+    EXPECT_FALSE(datasource.document_for("/foo/secrets", foo_mac));
+    EXPECT_FALSE(datasource.document_for("/foo/", foo_mac));
+    EXPECT_FALSE(datasource.document_for("/foo/meta-data/more", foo_mac));
+}
+
+TEST_F(CloudInitDatasource, serves_instances_only_their_own_data)
+{
+    datasource.publish(desc);
+
+    EXPECT_FALSE(datasource.document_for("/foo/user-data", bar_mac));
+    EXPECT_FALSE(datasource.document_for("/foo/user-data", ""));
+}
+
+TEST_F(CloudInitDatasource, stops_serving_withdrawn_instances)
+{
+    datasource.publish(desc);
+    datasource.withdraw("foo");
+
+    EXPECT_FALSE(datasource.document_for("/foo/meta-data", foo_mac));
+}
+
+TEST_F(CloudInitDatasource, answers_requests_from_the_instance_they_name)
+{
+    datasource.publish(desc);
+    datasource.listen(QHostAddress::LocalHost, 0);
+
+    EXPECT_EQ(downloader.download(datasource_url("foo/user-data")).toStdString(),
+              mp::utils::emit_cloud_config(desc.user_data_config));
+}
+
+TEST_F(CloudInitDatasource, refuses_requests_from_other_peers)
+{
+    datasource.publish(desc);
+    datasource.listen(QHostAddress::LocalHost, 0);
+    peer_mac = bar_mac;
+
+    EXPECT_THROW(downloader.download(datasource_url("foo/user-data")), mp::DownloadException);
+}
+} // namespace
@@ -44,3 +44,20 @@ TEST_F(CloudInitIso, creates_iso_file)
     EXPECT_TRUE(file.exists());
     EXPECT_THAT(file.size(), Ge(0));
 }
+
+TEST_F(CloudInitIso, writes_whole_blocks_with_file_data_after_the_records)
+{
+    mp::CloudInitIso iso;
+    iso.add_file("test", "test data");
+    iso.write_to(iso_path);
+
+    QFile file{iso_path};
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    const auto contents = file.readAll();
+
+    constexpr auto block_size = 2048;
+    constexpr auto first_data_block = 23; // reserved area, descriptors, path tables and directory records
+    EXPECT_EQ(contents.size(), (first_data_block + 1) * block_size);
+    EXPECT_EQ(contents.mid(first_data_block * block_size, 9), QByteArray{"test data"});
+    EXPECT_EQ(contents, iso.to_bytes());
+}
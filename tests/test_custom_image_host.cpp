@@ -288,7 +288,7 @@ TEST_F(CustomImageHost, handles_and_recovers_from_initial_network_failure)
     EXPECT_TRUE(host.info_for(query));
 }
 
-TEST_F(CustomImageHost, handles_and_recovers_from_later_network_failure)
+TEST_F(CustomImageHost, keeps_serving_manifests_through_later_network_failure)
 {
     const auto ttl = 0s; // to ensure updates are always retried
     mp::CustomVMImageHost host{"x86_64", &mock_url_downloader, ttl};
@@ -303,12 +303,12 @@ TEST_F(CustomImageHost, handles_and_recovers_from_later_network_failure)
         .WillOnce(Throw(mp::DownloadException{"", ""}))
         .WillRepeatedly(DoDefault());
 
-    EXPECT_THROW(host.info_for(query), std::runtime_error);
-
+    EXPECT_TRUE(host.info_for(query)); // refreshes in the background
+    host.wait_for_refresh();
     EXPECT_TRUE(host.info_for(query));
 }
 
-TEST_F(CustomImageHost, handles_and_recovers_from_independent_server_failures)
+TEST_F(CustomImageHost, keeps_previous_manifests_of_failing_servers)
 {
     const auto ttl = 0h;
     mp::CustomVMImageHost host{"x86_64", &mock_url_downloader, ttl};
@@ -328,11 +328,38 @@ TEST_F(CustomImageHost, handles_and_recovers_from_independent_server_failures)
         }
         EXPECT_CALL(mock_url_downloader, last_modified(_)).Times(AnyNumber()).InSequence(seq);
 
-        EXPECT_EQ(mpt::count_remotes(host), num_remotes - i);
+        mpt::count_remotes(host); // kicks off a refresh
+        host.wait_for_refresh();
+
+        EXPECT_EQ(mpt::count_remotes(host), num_remotes);
+        host.wait_for_refresh();
         EXPECT_TRUE(Mock::VerifyAndClearExpectations(&mock_url_downloader));
     }
 }
 
+TEST_F(CustomImageHost, reuses_unchanged_checksum_files)
+{
+    const auto last_modified = QDateTime::currentDateTime();
+    ON_CALL(mock_url_downloader, last_modified(_)).WillByDefault(Return(last_modified));
+
+    const auto ttl = 0s; // to ensure updates are always retried
+    mp::CustomVMImageHost host{"x86_64", &mock_url_downloader, ttl};
+
+    const auto query = make_query("core20", "snapcraft");
+    EXPECT_TRUE(host.info_for(query));
+    host.wait_for_refresh();
+
+    EXPECT_CALL(mock_url_downloader, download(_)).Times(0);
+
+    EXPECT_TRUE(host.info_for(query)); // refreshes in the background
+    host.wait_for_refresh();
+
+    const auto info = host.info_for(query);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->id, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    host.wait_for_refresh();
+}
+
 TEST_F(CustomImageHost, info_for_unsupported_remote_throws)
 {
     mp::CustomVMImageHost host{"x86_64", &mock_url_downloader, default_ttl};
@@ -46,6 +46,8 @@
 
 #include <scope_guard.hpp>
 
+#include <QDir>
+#include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QNetworkProxyFactory>
@@ -53,10 +55,13 @@
 #include <QString>
 #include <QSysInfo>
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <unordered_set>
 #include <variant>
 
 namespace mp = multipass;
@@ -91,6 +96,19 @@ struct StubNameGenerator : public mp::NameGenerator
     }
     std::string name;
 };
+
+struct SequenceNameGenerator : public mp::NameGenerator
+{
+    explicit SequenceNameGenerator(std::vector<std::string> names) : names{std::move(names)}
+    {
+    }
+    std::string make_name() override
+    {
+        return names.at(next++);
+    }
+    std::vector<std::string> names;
+    std::size_t next = 0;
+};
 } // namespace
 
 struct Daemon : public mpt::DaemonTestFixture
@@ -113,6 +131,19 @@ struct Daemon : public mpt::DaemonTestFixture
         EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true")); /* TODO should probably add
                              a few more tests for `false`, since there are different portions of code depending on it */
         EXPECT_CALL(mock_settings, get(Eq(mp::winterm_key))).WillRepeatedly(Return("none"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::prefetch_images_key))).WillRepeatedly(Return(""));
+        EXPECT_CALL(mock_settings, get(Eq(mp::mount_cache_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::metrics_interval_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::warm_pool_size_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::reclaim_memory_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_merging_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::idle_suspend_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::cpu_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::parallel_boots_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::download_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::federation_key))).WillRepeatedly(Return(""));
+        EXPECT_CALL(mock_settings, get(Eq(mp::package_cache_port_key))).WillRepeatedly(Return("0"));
     }
 
     mpt::MockUtils::GuardedMock mock_utils_injection{mpt::MockUtils::inject<NiceMock>()};
@@ -204,6 +235,19 @@ TEST_F(Daemon, provides_version)
     EXPECT_TRUE(mpt::call_daemon_slot(daemon, &mp::Daemon::version, mp::VersionRequest{}, mock_server).ok());
 }
 
+TEST_F(Daemon, provides_metrics)
+{
+    mp::Daemon daemon{config_builder.build()};
+    StrictMock<mpt::MockServerWriter<mp::MetricsReply>> mock_server;
+    EXPECT_CALL(mock_server,
+                Write(Property(&mp::MetricsReply::openmetrics,
+                               AllOf(HasSubstr("multipass_executor_queued{executor=\""), EndsWith("# EOF\n"))),
+                      _))
+        .WillOnce(Return(true));
+
+    EXPECT_TRUE(mpt::call_daemon_slot(daemon, &mp::Daemon::metrics, mp::MetricsRequest{}, mock_server).ok());
+}
+
 TEST_F(Daemon, failed_restart_command_returns_fulfilled_promise)
 {
     mp::Daemon daemon{config_builder.build()};
@@ -377,7 +421,7 @@ TEST_P(DaemonCreateLaunchTestSuite, on_creation_hooks_up_platform_prepare_source
     auto mock_factory = use_a_mock_vm_factory();
     mp::Daemon daemon{config_builder.build()};
 
-    EXPECT_CALL(*mock_factory, prepare_source_image(_));
+    EXPECT_CALL(*mock_factory, prepare_source_image(_, _));
     send_command({GetParam()});
 }
 
@@ -604,6 +648,105 @@ TEST_P(DaemonCreateLaunchTestSuite, adds_pollinate_user_agent_to_cloud_init_conf
     send_command({GetParam()});
 }
 
+TEST_P(DaemonCreateLaunchTestSuite, adds_readiness_hooks_to_cloud_init_config)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _))
+        .WillOnce(Invoke([](const multipass::VMImage&, const mp::VirtualMachineDescription& desc) {
+            ASSERT_THAT(desc.vendor_data_config, YAMLNodeContainsSequence("write_files"));
+
+            std::vector<std::string> paths;
+            for (const auto& entry : desc.vendor_data_config["write_files"])
+                paths.push_back(entry["path"].as<std::string>());
+
+            EXPECT_THAT(paths, IsSupersetOf({"/etc/systemd/system/multipass-booting.service",
+                                             "/etc/systemd/system/multipass-ssh-up.service",
+                                             "/var/lib/cloud/scripts/per-boot/multipass-readiness"}));
+        }));
+
+    send_command({GetParam()});
+}
+
+TEST_P(DaemonCreateLaunchTestSuite, has_sshd_listen_on_vsock)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _))
+        .WillOnce(Invoke([](const multipass::VMImage&, const mp::VirtualMachineDescription& desc) {
+            ASSERT_THAT(desc.vendor_data_config, YAMLNodeContainsSequence("write_files"));
+
+            std::vector<std::string> contents;
+            for (const auto& entry : desc.vendor_data_config["write_files"])
+                contents.push_back(entry["content"].as<std::string>());
+
+            EXPECT_THAT(contents, Contains(HasSubstr("ListenStream=vsock::22")));
+            EXPECT_THAT(contents, Contains(HasSubstr("ExecStart=-/usr/sbin/sshd -i")));
+            EXPECT_THAT(contents, Contains(HasSubstr("systemctl enable --now multipass-vsock-ssh.socket")));
+        }));
+
+    send_command({GetParam()});
+}
+
+TEST_P(DaemonCreateLaunchTestSuite, points_apt_at_the_package_cache_when_there_is_one)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    EXPECT_CALL(mock_settings, get(Eq(mp::package_cache_port_key))).WillRepeatedly(Return("3142"));
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _))
+        .WillOnce(Invoke([](const multipass::VMImage&, const mp::VirtualMachineDescription& desc) {
+            ASSERT_THAT(desc.vendor_data_config, YAMLNodeContainsSequence("write_files"));
+
+            std::vector<std::string> contents;
+            for (const auto& entry : desc.vendor_data_config["write_files"])
+                contents.push_back(entry["content"].as<std::string>());
+
+            EXPECT_THAT(contents, Contains(HasSubstr("Acquire::http::Proxy-Auto-Detect")));
+            EXPECT_THAT(contents, Contains(HasSubstr("http://$gateway:3142")));
+        }));
+
+    send_command({GetParam()});
+}
+
+TEST_P(DaemonCreateLaunchTestSuite, leaves_apt_alone_without_a_package_cache)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _))
+        .WillOnce(Invoke([](const multipass::VMImage&, const mp::VirtualMachineDescription& desc) {
+            for (const auto& entry : desc.vendor_data_config["write_files"])
+                EXPECT_THAT(entry["path"].as<std::string>(), Not(HasSubstr("apt")));
+        }));
+
+    send_command({GetParam()});
+}
+
+TEST_P(DaemonCreateLaunchTestSuite, reused_cloud_init_config_does_not_pile_up_across_launches)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    std::vector<std::size_t> num_ssh_keys, num_written_files;
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](const multipass::VMImage&, const mp::VirtualMachineDescription& desc) {
+            num_ssh_keys.push_back(desc.vendor_data_config["ssh_authorized_keys"].size());
+            num_written_files.push_back(desc.vendor_data_config["write_files"].size());
+        }));
+
+    send_command({GetParam(), "--name", "first"});
+    send_command({GetParam(), "--name", "second"});
+
+    ASSERT_THAT(num_ssh_keys, SizeIs(2));
+    EXPECT_EQ(num_ssh_keys[0], 1u);
+    EXPECT_EQ(num_ssh_keys[1], 1u);
+    EXPECT_EQ(num_written_files[0], num_written_files[1]);
+}
+
 TEST_P(DaemonCreateLaunchTestSuite, blueprint_found_passes_expected_data)
 {
     auto mock_factory = use_a_mock_vm_factory();
@@ -1087,6 +1230,47 @@ TEST_F(Daemon, reads_mac_addresses_from_json)
     check_interfaces_in_json(filename, mac_addr, extra_interfaces);
 }
 
+TEST_F(Daemon, lists_release_titles_without_going_back_to_the_vault)
+{
+    auto mock_image_vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    auto vault = mock_image_vault.get();
+    config_builder.vault = std::move(mock_image_vault);
+
+    mp::VMImage image;
+    image.original_release = "Jammy Jellyfish";
+    ON_CALL(*vault, fetch_image).WillByDefault(Return(image));
+
+    const auto [temp_dir, filename] = plant_instance_json(fake_json_contents("52:54:00:73:76:28", {}));
+    config_builder.data_directory = temp_dir->path();
+    mp::Daemon daemon{config_builder.build()};
+
+    auto release_matcher = Property(&mp::ListVMInstance::current_release, "Jammy Jellyfish");
+    for (auto i = 0; i < 2; ++i)
+    {
+        StrictMock<mpt::MockServerWriter<mp::ListReply>> mock_server;
+        EXPECT_CALL(mock_server, Write(Property(&mp::ListReply::instances, ElementsAre(release_matcher)), _))
+            .WillOnce(Return(true));
+
+        EXPECT_TRUE(mpt::call_daemon_slot(daemon, &mp::Daemon::list, mp::ListRequest{}, mock_server).ok());
+        EXPECT_CALL(*vault, fetch_image).Times(0); // from now on
+    }
+}
+
+TEST_F(Daemon, lists_instances_despite_failing_to_prefetch_their_states)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    EXPECT_CALL(*mock_factory, prefetch_instance_states).WillOnce(Throw(std::runtime_error{"no bulk for you"}));
+
+    const auto [temp_dir, filename] = plant_instance_json(fake_json_contents("52:54:00:73:76:30", {}));
+    config_builder.data_directory = temp_dir->path();
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerWriter<mp::ListReply>> mock_server;
+    EXPECT_CALL(mock_server, Write(Property(&mp::ListReply::instances, SizeIs(1)), _)).WillOnce(Return(true));
+
+    EXPECT_TRUE(mpt::call_daemon_slot(daemon, &mp::Daemon::list, mp::ListRequest{}, mock_server).ok());
+}
+
 TEST_F(Daemon, writes_and_reads_ordered_maps_in_json)
 {
     config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
@@ -1250,9 +1434,33 @@ TEST_F(Daemon, skips_over_instance_ghosts_in_db) // which will have been sometim
     EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, id2), _)).Times(1);
 
     mp::Daemon daemon{config_builder.build()};
+    mpt::call_daemon_slot(daemon, &mp::Daemon::list, mp::ListRequest{},
+                          NiceMock<mpt::MockServerWriter<mp::ListReply>>{}); // needs all instances reconstructed
+}
+
+TEST_F(Daemon, reconstructs_instances_after_construction)
+{
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    const auto [temp_dir, filename] = plant_instance_json(fake_json_contents("ab:ab:ab:ab:ab:ab", {}));
+    config_builder.data_directory = temp_dir->path();
+
+    auto mock_factory = use_a_mock_vm_factory();
+    MockFunction<void()> constructed;
+    {
+        InSequence seq;
+        EXPECT_CALL(constructed, Call());
+        EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name,
+                                                                "real-zebraphant"),
+                                                          _));
+    }
+
+    mp::Daemon daemon{config_builder.build()};
+    constructed.Call();
+
+    qApp->processEvents(QEventLoop::AllEvents);
 }
 
-TEST_F(Daemon, ctor_lets_exceptions_arising_from_vm_creation_through)
+TEST_F(Daemon, reports_exceptions_arising_from_vm_creation_to_requests_for_the_instance)
 {
     config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
     const auto [temp_dir, filename] = plant_instance_json(fake_json_contents("ab:ab:ab:ab:ab:ab", {}));
@@ -1262,7 +1470,15 @@ TEST_F(Daemon, ctor_lets_exceptions_arising_from_vm_creation_through)
     auto mock_factory = use_a_mock_vm_factory();
     EXPECT_CALL(*mock_factory, create_virtual_machine).WillOnce(Throw(std::runtime_error{msg}));
 
-    MP_EXPECT_THROW_THAT(mp::Daemon{config_builder.build()}, std::runtime_error, mpt::match_what(msg));
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::StartRequest request;
+    request.mutable_instance_names()->add_instance_name("real-zebraphant");
+    auto status = mpt::call_daemon_slot(daemon, &mp::Daemon::start, request,
+                                        NiceMock<mpt::MockServerWriter<mp::StartReply>>{});
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+    EXPECT_THAT(status.error_message(), AllOf(HasSubstr("real-zebraphant"), HasSubstr(msg)));
 }
 
 TEST_F(Daemon, ctor_drops_removed_instances)
@@ -1302,6 +1518,56 @@ TEST_F(Daemon, ctor_drops_removed_instances)
     EXPECT_THAT(updated_json.toStdString(), AllOf(HasSubstr(stayed), Not(HasSubstr(gone))));
 }
 
+TEST_F(Daemon, ctorReadsInstancesBackFromTheSnapshot)
+{
+    const std::string name{"foo"};
+    const auto [temp_dir, filename] =
+        plant_instance_json(fmt::format("{{{}}}", fmt::format(valid_template, name, "12")));
+    config_builder.data_directory = temp_dir->path();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    use_a_mock_vm_factory();
+
+    {
+        mp::Daemon daemon{config_builder.build()};
+        daemon.persist_instances();
+    }
+
+    ASSERT_TRUE(QFile::exists(QDir{temp_dir->path()}.filePath("multipassd-vm-instances.cbor")));
+    ASSERT_TRUE(QFile::remove(filename));
+
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    auto mock_factory = use_a_mock_vm_factory();
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, name), _))
+        .Times(1);
+
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerWriter<mp::ListReply>> mock_server;
+    EXPECT_CALL(mock_server,
+                Write(Property(&mp::ListReply::instances, ElementsAre(Property(&mp::ListVMInstance::name, name))), _))
+        .WillOnce(Return(true));
+
+    EXPECT_TRUE(mpt::call_daemon_slot(daemon, &mp::Daemon::list, mp::ListRequest{}, mock_server).ok());
+}
+
+TEST_F(Daemon, dtorTakesDownInstancesBeforeTheyGo)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+    auto instance_ptr = std::make_unique<NiceMock<mpt::MockVirtualMachine>>("mock");
+    EXPECT_CALL(*instance_ptr, prepare_for_exit).Times(1);
+    EXPECT_CALL(*instance_ptr, kill).Times(0); // well within the deadline
+    EXPECT_CALL(*mock_factory, create_virtual_machine).WillOnce([&instance_ptr](const auto&, auto&) {
+        return std::move(instance_ptr);
+    });
+
+    {
+        mp::Daemon daemon{config_builder.build()};
+        send_command({"launch"});
+    }
+}
+
 TEST_P(ListIP, lists_with_ip)
 {
     auto mock_factory = use_a_mock_vm_factory();
@@ -1339,6 +1605,30 @@ INSTANTIATE_TEST_SUITE_P(
            std::make_tuple(mp::VirtualMachine::State::off, std::vector<std::string>{"list", "--no-ipv4"},
                            std::vector<std::string>{"Stopped", "--"})));
 
+TEST_F(Daemon, lists_addresses_without_going_into_instances)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto instance_ptr = std::make_unique<NiceMock<mpt::MockVirtualMachine>>("mock");
+    EXPECT_CALL(*instance_ptr, current_state()).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(*instance_ptr, ensure_vm_is_running()).WillRepeatedly(Throw(std::runtime_error("Not running")));
+    EXPECT_CALL(*instance_ptr, known_ipv4()).WillRepeatedly(Return(std::vector<std::string>{"10.1.2.3"}));
+    EXPECT_CALL(*instance_ptr, get_all_ipv4(_)).Times(0);
+    EXPECT_CALL(*mock_factory, create_virtual_machine).WillRepeatedly([&instance_ptr](const auto&, auto&) {
+        return std::move(instance_ptr);
+    });
+
+    send_command({"launch"});
+
+    std::stringstream stream;
+    send_command({"list"}, stream);
+
+    EXPECT_THAT(stream.str(), HasSubstr("10.1.2.3"));
+}
+
 TEST_F(Daemon, prevents_repetition_of_loaded_mac_addresses)
 {
     config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
@@ -1351,7 +1641,10 @@ TEST_F(Daemon, prevents_repetition_of_loaded_mac_addresses)
     mp::Daemon daemon{config_builder.build()};
 
     std::stringstream stream;
-    EXPECT_CALL(*mock_factory, create_virtual_machine).Times(0); // expect *no* call
+    EXPECT_CALL(*mock_factory, create_virtual_machine).Times(0); // expect *no* call, but for the loaded instance
+    EXPECT_CALL(*mock_factory,
+                create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "real-zebraphant"), _))
+        .Times(AtMost(1));
     send_command({"launch", "--network", fmt::format("name=eth0,mac={}", repeated_mac)}, trash_stream, stream);
     EXPECT_THAT(stream.str(), AllOf(HasSubstr("fail"), HasSubstr("Repeated MAC"), HasSubstr(repeated_mac)));
 }
@@ -1425,6 +1718,55 @@ TEST_F(Daemon, releases_macs_when_launch_fails)
     send_command(cmd); // and confirm we can repeat the same mac
 }
 
+TEST_F(Daemon, launches_several_instances_named_after_prefix)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    for (const auto& name : {"ci-1", "ci-2", "ci-3"})
+        EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, name), _));
+
+    std::stringstream out_stream;
+    send_command({"launch", "--count", "3", "--name-prefix", "ci-", "--parallel", "2"}, out_stream);
+    EXPECT_THAT(out_stream.str(), AllOf(HasSubstr("Launched: ci-1"), HasSubstr("Launched: ci-2"),
+                                        HasSubstr("Launched: ci-3")));
+}
+
+TEST_F(Daemon, generates_another_name_when_the_generated_one_is_taken)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.name_generator =
+        std::make_unique<SequenceNameGenerator>(std::vector<std::string>{"pied-piper", "pied-piper", "hooli"});
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "pied-piper"), _));
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "hooli"), _));
+
+    send_command({"launch"});
+    std::stringstream out_stream;
+    send_command({"launch"}, out_stream);
+    EXPECT_THAT(out_stream.str(), HasSubstr("Launched: hooli"));
+}
+
+TEST_F(Daemon, gives_different_macs_to_instances_launched_together)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    std::mutex mutex;
+    std::unordered_set<std::string> macs;
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .Times(4)
+        .WillRepeatedly([&mutex, &macs](const mp::VirtualMachineDescription& vm_desc, auto&) {
+            std::lock_guard<std::mutex> lock{mutex};
+            EXPECT_TRUE(macs.insert(vm_desc.default_mac_address).second);
+
+            return std::make_unique<mpt::StubVirtualMachine>();
+        });
+
+    send_command({"launch", "--count", "4", "--name-prefix", "vm"});
+}
+
 TEST_F(Daemon, releases_macs_of_purged_instances_but_keeps_the_rest)
 {
     auto mock_factory = use_a_mock_vm_factory();
@@ -1453,6 +1795,139 @@ TEST_F(Daemon, releases_macs_of_purged_instances_but_keeps_the_rest)
         {"launch", "--network", fmt::format("name=eth0,mac={}", mac3)}); // mac is free after purge, so accepted
 }
 
+TEST_F(Daemon, shuts_instances_down_side_by_side_on_delete)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int shutting_down = 0;
+    auto meet_the_others = [&mutex, &cv, &shutting_down] {
+        std::unique_lock<std::mutex> lock{mutex};
+        ++shutting_down;
+        cv.notify_all();
+        // one at a time, the first instance would never see the second
+        EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&shutting_down] { return shutting_down == 2; }));
+    };
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .Times(2)
+        .WillRepeatedly([&meet_the_others](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, shutdown).WillOnce(meet_the_others);
+            return vm;
+        });
+
+    send_command({"launch", "--name", "vm1"});
+    send_command({"launch", "--name", "vm2"});
+    send_command({"delete", "vm1", "vm2"});
+
+    EXPECT_EQ(shutting_down, 2);
+}
+
+TEST_F(Daemon, snapshot_is_taken_of_stopped_instance_and_listed)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .WillOnce([](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::off));
+            EXPECT_CALL(*vm, take_snapshot(StrEq("clean"))).Times(1);
+            return vm;
+        });
+
+    send_command({"launch", "--name", "vm1"});
+    send_command({"snapshot", "take", "vm1", "clean"});
+
+    std::stringstream stream;
+    send_command({"snapshot", "list", "vm1"}, stream);
+    EXPECT_THAT(stream.str(), HasSubstr("clean"));
+}
+
+TEST_F(Daemon, snapshot_refuses_running_instance)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .WillOnce([](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+            EXPECT_CALL(*vm, take_snapshot).Times(0);
+            return vm;
+        });
+
+    send_command({"launch", "--name", "vm1"});
+
+    std::stringstream err_stream;
+    send_command({"snapshot", "take", "vm1", "clean"}, trash_stream, err_stream);
+    EXPECT_THAT(err_stream.str(), HasSubstr("must be stopped"));
+}
+
+TEST_F(Daemon, ephemeral_instance_has_unsafe_disk_and_is_not_persisted)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    const auto [temp_dir, filename] = plant_instance_json("{}");
+    config_builder.data_directory = temp_dir->path();
+    auto daemon = std::make_unique<mp::Daemon>(config_builder.build());
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .WillOnce([](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            EXPECT_EQ(desc.disk_options.cache, "unsafe");
+            return std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+        });
+
+    send_command({"launch", "--name", "vm1", "--ephemeral"});
+    daemon.reset(); // pending changes are flushed on shutdown
+
+    EXPECT_THAT(mpt::load(filename).toStdString(), Not(HasSubstr("vm1")));
+}
+
+TEST_F(Daemon, ephemeral_instance_is_purged_once_stopped)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+    mp::VMStatusMonitor& monitor = daemon;
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .WillOnce([](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::stopped));
+            return vm;
+        });
+    EXPECT_CALL(*mock_factory, remove_resources_for("vm1"));
+
+    send_command({"launch", "--name", "vm1", "--ephemeral"});
+    monitor.persist_state_for("vm1", mp::VirtualMachine::State::stopped);
+    qApp->processEvents(QEventLoop::AllEvents);
+
+    std::stringstream stream;
+    send_command({"list"}, stream);
+    EXPECT_THAT(stream.str(), Not(HasSubstr("vm1")));
+}
+
+TEST_F(Daemon, purges_ephemeral_instances_left_over_from_an_unclean_stop)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    auto json = fake_json_contents("52:54:00:73:76:28", {});
+    json.insert(json.find("\"deleted\""), "\"ephemeral\": true,\n        ");
+    const auto [temp_dir, filename] = plant_instance_json(json);
+    config_builder.data_directory = temp_dir->path();
+
+    EXPECT_CALL(*mock_factory, remove_resources_for("real-zebraphant"));
+    auto daemon = std::make_unique<mp::Daemon>(config_builder.build());
+
+    std::stringstream stream;
+    send_command({"list"}, stream);
+    EXPECT_THAT(stream.str(), Not(HasSubstr("real-zebraphant")));
+
+    daemon.reset();
+    EXPECT_THAT(mpt::load(filename).toStdString(), Not(HasSubstr("real-zebraphant")));
+}
+
 TEST_P(DaemonLaunchTimeoutValueTestSuite, uses_correct_launch_timeout)
 {
     auto mock_factory = use_a_mock_vm_factory();
@@ -1540,10 +2015,10 @@ TEST_F(Daemon, refuses_launch_with_invalid_bridged_interface)
 
 TEST_F(Daemon, refusesDisabledMount)
 {
-    mp::Daemon daemon{config_builder.build()};
-
     EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("false"));
 
+    mp::Daemon daemon{config_builder.build()};
+
     std::stringstream err_stream;
 
     auto status = mpt::call_daemon_slot(daemon, &mp::Daemon::mount, mp::MountRequest{},
@@ -1553,6 +2028,22 @@ TEST_F(Daemon, refusesDisabledMount)
     EXPECT_THAT(status.error_message(), HasSubstr("Mounts are disabled on this installation of Multipass."));
 }
 
+TEST_F(Daemon, refusesNativeMountWhenBackendLacksIt)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    mpt::TempDir source_dir;
+    mp::MountRequest request;
+    request.set_source_path(source_dir.path().toStdString());
+    request.set_mount_type(mp::MountRequest::NATIVE);
+
+    auto status = mpt::call_daemon_slot(daemon, &mp::Daemon::mount, request,
+                                        StrictMock<mpt::MockServerWriter<mp::MountReply>>{});
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+    EXPECT_THAT(status.error_message(), HasSubstr("native mounts"));
+}
+
 TEST_F(Daemon, keysReturnsSettingsKeys)
 {
     mp::Daemon daemon{config_builder.build()};
@@ -1753,6 +2244,60 @@ TEST_F(Daemon, purgePersistsInstances)
     EXPECT_THAT(updated_json.toStdString(), AllOf(HasSubstr(name1), HasSubstr(name2)));
 }
 
+TEST_F(Daemon, stateChangesArePersistedInBatches)
+{
+    const std::string name{"real-zebraphant"};
+    const auto [temp_dir, filename] =
+        plant_instance_json(fmt::format("{{{}}}", fmt::format(valid_template, name, "10")));
+    config_builder.data_directory = temp_dir->path();
+
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    auto daemon = std::make_unique<mp::Daemon>(config_builder.build());
+    mp::VMStatusMonitor& monitor = *daemon;
+
+    QFile::remove(filename);
+    monitor.persist_state_for(name, mp::VirtualMachine::State::starting);
+    monitor.persist_state_for(name, mp::VirtualMachine::State::running);
+    EXPECT_FALSE(QFile::exists(filename)); // nothing written until the batching window elapses
+
+    daemon.reset(); // pending changes are flushed on shutdown
+
+    const auto doc = QJsonDocument::fromJson(mpt::load(filename));
+    EXPECT_EQ(doc.object()[QString::fromStdString(name)].toObject()["state"].toInt(),
+              static_cast<int>(mp::VirtualMachine::State::running));
+}
+
+TEST_F(Daemon, writes_completions_next_to_the_socket_until_shutdown)
+{
+    const std::string name{"real-zebraphant"}, pooled_name{"warm-zebraphant"};
+    auto pooled_json = fmt::format(valid_template, pooled_name, "11");
+    pooled_json.replace(pooled_json.find("\"deleted\""), 0, "\"pool_profile\": \"jammy\",\n    ");
+
+    const auto [temp_dir, filename] =
+        plant_instance_json(fmt::format("{{{}, {}}}", fmt::format(valid_template, name, "10"), pooled_json));
+    config_builder.data_directory = temp_dir->path();
+    config_builder.server_address = "unix:" + temp_dir->filePath("multipass_socket").toStdString();
+    const auto completions_file = temp_dir->filePath("multipass_completions");
+
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    auto mock_factory = use_a_mock_vm_factory();
+    EXPECT_CALL(*mock_factory, networks)
+        .WillOnce(Return(std::vector<mp::NetworkInterfaceInfo>{{"net_a", "type_a", "description_a"}}));
+
+    auto daemon = std::make_unique<mp::Daemon>(config_builder.build());
+    mpt::call_daemon_slot(*daemon, &mp::Daemon::networks, mp::NetworksRequest{},
+                          NiceMock<mpt::MockServerWriter<mp::NetworksReply>>{});
+    daemon->persist_instances();
+
+    const auto completions = mpt::load(completions_file).toStdString();
+    EXPECT_THAT(completions, HasSubstr(fmt::format("instance,{},", name)));
+    EXPECT_THAT(completions, HasSubstr("network,net_a\n"));
+    EXPECT_THAT(completions, Not(HasSubstr(pooled_name))); // pooled instances are not the user's yet
+
+    daemon.reset();
+    EXPECT_FALSE(QFile::exists(completions_file));
+}
+
 TEST_F(Daemon, launch_fails_with_incompatible_blueprint)
 {
     auto mock_blueprint_provider = std::make_unique<NiceMock<mpt::MockVMBlueprintProvider>>();
@@ -1766,4 +2311,75 @@ TEST_F(Daemon, launch_fails_with_incompatible_blueprint)
     send_command({"launch", "foo"}, trash_stream, err_stream);
     EXPECT_THAT(err_stream.str(), HasSubstr("The \"foo\" Blueprint is not compatible with this host."));
 }
+
+TEST_F(Daemon, watch_streams_state_changes_until_cancelled)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerWriter<mp::WatchReply>> mock_server;
+    EXPECT_CALL(mock_server, Write(AllOf(Property(&mp::WatchReply::instance_name, "foo"),
+                                         Property(&mp::WatchReply::instance_status,
+                                                  Property(&mp::InstanceStatus::status, mp::InstanceStatus::RUNNING))),
+                                   _))
+        .WillOnce(Return(true));
+
+    auto polls = 0;
+    auto cancelled = [&daemon, &polls] {
+        if (polls++)
+            return true;
+
+        mp::VMStatusMonitor& monitor = daemon;
+        monitor.persist_state_for("foo", mp::VirtualMachine::State::running);
+        return false;
+    };
+
+    mp::WatchRequest request;
+    std::promise<grpc::Status> status_promise;
+    daemon.watch(&request, &mock_server, cancelled, &status_promise);
+
+    EXPECT_TRUE(status_promise.get_future().get().ok());
+}
+
+TEST_F(Daemon, top_reports_usage_between_samples)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    mp::Daemon daemon{config_builder.build()};
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine)
+        .WillOnce([](const auto& desc, auto&) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+
+            mp::GuestStats before, after;
+            before.cpu_time_ms = 1000;
+            before.block_devices = {{"hda", 0, 0, 0, 0}};
+            after.cpu_time_ms = 1500;
+            after.resident_bytes = 512LL << 20;
+            after.block_devices = {{"hda", 1LL << 20, 0, 16, 0}};
+            EXPECT_CALL(*vm, guest_stats).WillOnce(Return(before)).WillOnce(Return(after));
+            return vm;
+        });
+
+    send_command({"launch", "--name", "vm1"});
+
+    StrictMock<mpt::MockServerWriter<mp::TopReply>> mock_server;
+    EXPECT_CALL(mock_server, Write(_, _)).WillOnce([](const mp::TopReply& reply, auto) {
+        EXPECT_EQ(reply.instances_size(), 1);
+        const auto& usage = reply.instances(0);
+        EXPECT_EQ(usage.name(), "vm1");
+        EXPECT_GT(usage.cpu_percent(), 0);
+        EXPECT_EQ(usage.resident_bytes(), 512LL << 20);
+        EXPECT_GT(usage.disk_read_bytes_per_second(), 0);
+        EXPECT_EQ(usage.network_received_bytes_per_second(), 0);
+        return true;
+    });
+
+    mp::TopRequest request;
+    request.set_interval_ms(10);
+    request.set_updates(1);
+    std::promise<grpc::Status> status_promise;
+    daemon.top(&request, &mock_server, [] { return false; }, &status_promise);
+
+    EXPECT_TRUE(status_promise.get_future().get().ok());
+}
 } // namespace
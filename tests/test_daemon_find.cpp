@@ -47,6 +47,17 @@ struct DaemonFind : public mpt::DaemonTestFixture
         EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
         EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
         EXPECT_CALL(mock_settings, get(Eq(mp::winterm_key))).WillRepeatedly(Return("none"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::prefetch_images_key))).WillRepeatedly(Return(""));
+        EXPECT_CALL(mock_settings, get(Eq(mp::mount_cache_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::metrics_interval_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::warm_pool_size_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::reclaim_memory_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_merging_key))).WillRepeatedly(Return("false"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::idle_suspend_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::cpu_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::memory_limit_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::parallel_boots_key))).WillRepeatedly(Return("0"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true"));
     }
 
     mpt::MockPlatform::GuardedMock attr{mpt::MockPlatform::inject<NiceMock>()};
@@ -136,3 +136,38 @@ TEST_F(DelayedShutdown, ssh_fails_vm_state_unknown)
 
     EXPECT_TRUE(vm->state == mp::VirtualMachine::State::unknown);
 }
+
+TEST_F(DelayedShutdown, leaves_messages_and_shutdown_to_hooks)
+{
+    std::vector<std::string> messages;
+    std::vector<std::string> shut_down;
+    mpt::Signal finished;
+
+    mp::DelayedShutdownTimer delayed_shutdown_timer{
+        vm.get(), [&messages](const std::string& message) { messages.push_back(message); },
+        [&shut_down](mp::VirtualMachine& instance) { shut_down.push_back(instance.vm_name); }};
+    QObject::connect(&delayed_shutdown_timer, &mp::DelayedShutdownTimer::finished, [&finished] { finished.signal(); });
+
+    delayed_shutdown_timer.start(std::chrono::milliseconds::zero());
+
+    EXPECT_TRUE(finished.wait_for(std::chrono::seconds(1)));
+    EXPECT_THAT(messages, ElementsAre(HasSubstr("going down for poweroff now")));
+    EXPECT_THAT(shut_down, ElementsAre(vm->vm_name));
+    EXPECT_TRUE(vm->state == mp::VirtualMachine::State::running); // that is up to the hook
+}
+
+TEST_F(DelayedShutdown, cancel_tells_users_through_hook)
+{
+    std::vector<std::string> messages;
+
+    {
+        mp::DelayedShutdownTimer delayed_shutdown_timer{
+            vm.get(), [&messages](const std::string& message) { messages.push_back(message); },
+            [](mp::VirtualMachine&) { FAIL() << "Should not shut down"; }};
+        delayed_shutdown_timer.start(std::chrono::minutes(5));
+        EXPECT_TRUE(vm->state == mp::VirtualMachine::State::delayed_shutdown);
+    }
+
+    EXPECT_THAT(messages, ElementsAre(HasSubstr("in 5 minutes"), HasSubstr("cancelled")));
+    EXPECT_TRUE(vm->state == mp::VirtualMachine::State::running);
+}
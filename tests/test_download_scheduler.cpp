@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/download_scheduler.h>
+
+#include <QUrl>
+
+#include <future>
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace std::chrono_literals;
+using namespace testing;
+
+namespace
+{
+const QUrl image_url{"https://cloud-images.ubuntu.com/releases/jammy/disk.img"};
+
+std::future<std::unique_ptr<mp::DownloadScheduler::Transfer>> start_in_background(mp::DownloadScheduler& scheduler,
+                                                                                 mp::DownloadPriority priority)
+{
+    return std::async(std::launch::async, [&scheduler, priority] {
+        mp::DownloadScheduler::PriorityScope scope{priority};
+        return scheduler.start(image_url);
+    });
+}
+
+TEST(DownloadScheduler, downloads_at_interactive_priority_by_default)
+{
+    EXPECT_EQ(mp::DownloadScheduler::current_priority(), mp::DownloadPriority::interactive);
+}
+
+TEST(DownloadScheduler, restores_the_priority_when_scopes_end)
+{
+    {
+        mp::DownloadScheduler::PriorityScope background{mp::DownloadPriority::background};
+        EXPECT_EQ(mp::DownloadScheduler::current_priority(), mp::DownloadPriority::background);
+    }
+
+    EXPECT_EQ(mp::DownloadScheduler::current_priority(), mp::DownloadPriority::interactive);
+}
+
+TEST(DownloadScheduler, bounds_transfers_per_host)
+{
+    mp::DownloadScheduler scheduler{1};
+    auto first = scheduler.start(image_url);
+
+    auto other_host = scheduler.start(QUrl{"https://mirror.lan/disk.img"});
+    auto second = start_in_background(scheduler, mp::DownloadPriority::interactive);
+
+    EXPECT_EQ(second.wait_for(20ms), std::future_status::timeout);
+
+    first.reset();
+    EXPECT_NE(second.get(), nullptr);
+}
+
+TEST(DownloadScheduler, lets_waiting_interactive_transfers_go_first)
+{
+    mp::DownloadScheduler scheduler{1};
+    auto first = scheduler.start(image_url);
+
+    auto background = start_in_background(scheduler, mp::DownloadPriority::background);
+    EXPECT_EQ(background.wait_for(20ms), std::future_status::timeout);
+    auto interactive = start_in_background(scheduler, mp::DownloadPriority::interactive);
+    EXPECT_EQ(interactive.wait_for(20ms), std::future_status::timeout);
+
+    first.reset();
+
+    auto next = interactive.get();
+    EXPECT_EQ(background.wait_for(20ms), std::future_status::timeout);
+
+    next.reset();
+    EXPECT_NE(background.get(), nullptr);
+}
+
+TEST(DownloadScheduler, does_not_pace_without_rate_limit)
+{
+    mp::DownloadScheduler scheduler;
+    auto transfer = scheduler.start(image_url);
+
+    const auto start = std::chrono::steady_clock::now();
+    transfer->pace(1ll << 40);
+    transfer->pace(1ll << 40);
+
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+TEST(DownloadScheduler, paces_transfers_to_the_rate_limit)
+{
+    mp::DownloadScheduler scheduler;
+    scheduler.set_rate_limit(1000);
+    auto transfer = scheduler.start(image_url);
+
+    const auto start = std::chrono::steady_clock::now();
+    transfer->pace(1200); // a second's worth goes right away, the rest is owed
+    transfer->pace(1);
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 150ms);
+}
+} // namespace
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/executor.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+struct Gate
+{
+    void open()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            opened = true;
+        }
+        cv.notify_all();
+    }
+
+    void pass()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        cv.wait(lock, [this] { return opened; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool opened{false};
+};
+
+TEST(Executor, runs_the_work_it_is_handed)
+{
+    mp::Executor executor{"test", 2};
+
+    EXPECT_EQ(executor.run([] { return 42; }).result(), 42);
+}
+
+TEST(Executor, hands_exceptions_over_to_the_waiter)
+{
+    mp::Executor executor{"test", 2};
+    auto future = executor.run_task([]() -> int { throw std::runtime_error{"nope"}; });
+
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(Executor, queues_work_beyond_its_threads)
+{
+    Gate gate;
+    mp::Executor executor{"test", 1};
+
+    auto first = executor.run([&gate] { gate.pass(); });
+    auto second = executor.run([] {});
+
+    while (executor.load().running == 0)
+        std::this_thread::yield();
+
+    auto load = executor.load();
+    EXPECT_EQ(load.running, 1);
+    EXPECT_EQ(load.queued, 1);
+    EXPECT_EQ(load.max_threads, 1);
+
+    gate.open();
+    second.waitForFinished();
+
+    load = executor.load();
+    EXPECT_EQ(load.queued, 0);
+}
+
+TEST(Executor, waits_for_its_work_when_destroyed)
+{
+    bool done{false};
+    {
+        mp::Executor executor{"test", 1};
+        executor.run([&done] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            done = true;
+        });
+    }
+
+    EXPECT_TRUE(done);
+}
+} // namespace
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "mock_cert_provider.h"
+
+#include <src/daemon/federation.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+TEST(Federation, parses_labelled_members)
+{
+    const auto members = mp::parse_federation_members("ws2=ws2.lan:50051, ws3=10.0.0.3:50051");
+
+    EXPECT_THAT(members, ElementsAre(Pair("ws2", "ws2.lan:50051"), Pair("ws3", "10.0.0.3:50051")));
+}
+
+TEST(Federation, has_no_members_by_default)
+{
+    EXPECT_THAT(mp::parse_federation_members(""), IsEmpty());
+}
+
+struct BadFederationMembers : public TestWithParam<const char*>
+{
+};
+
+TEST_P(BadFederationMembers, are_rejected)
+{
+    EXPECT_THROW(mp::parse_federation_members(GetParam()), std::invalid_argument);
+}
+
+INSTANTIATE_TEST_SUITE_P(Federation, BadFederationMembers,
+                         Values("ws2.lan:50051", "ws2=", "bad_label=ws2.lan:50051", "ws2=a b",
+                                "ws2=ws2.lan:50051,ws2=ws3.lan:50051"));
+
+TEST(Federation, splits_names_of_member_instances)
+{
+    NiceMock<mpt::MockCertProvider> cert_provider;
+    mp::Federation federation{{{"ws2", "ws2.lan:50051"}}, cert_provider};
+
+    using Split = std::pair<std::string, std::string>;
+    EXPECT_EQ(federation.split(mp::Federation::qualified("foo", "ws2")), Split("foo", "ws2"));
+    EXPECT_EQ(federation.split("foo@bar@ws2"), Split("foo@bar", "ws2"));
+    EXPECT_FALSE(federation.split("foo@ws3"));
+    EXPECT_FALSE(federation.split("foo"));
+}
+
+TEST(Federation, marks_relayed_calls_while_they_last)
+{
+    int call, other_call;
+    mp::Federation::mark_relayed(&call, true);
+
+    EXPECT_TRUE(mp::Federation::is_relayed(&call));
+    EXPECT_FALSE(mp::Federation::is_relayed(&other_call));
+
+    mp::Federation::mark_relayed(&call, false);
+    EXPECT_FALSE(mp::Federation::is_relayed(&call));
+}
+} // namespace
@@ -166,7 +166,15 @@ TEST_F(TestGlobalSettingsHandlers, clientsDoNotRegisterPersistentHandlerForDaemo
     mp::client::register_global_settings_handlers();
 
     EXPECT_CALL(*mock_qsettings_provider, make_wrapped_qsettings(_, _)).Times(0);
-    assert_unrecognized_keys(mp::driver_key, mp::bridged_interface_key, mp::mounts_key, mp::passphrase_key);
+    assert_unrecognized_keys(mp::driver_key, mp::bridged_interface_key, mp::mounts_key, mp::passphrase_key,
+                             mp::prefetch_images_key, mp::mount_cache_key, mp::metrics_interval_key,
+                             mp::warm_pool_size_key, mp::reclaim_memory_key, mp::memory_merging_key,
+                             mp::idle_suspend_key, mp::cpu_limit_key, mp::memory_limit_key,
+                             mp::parallel_boots_key, mp::image_mirror_key, mp::image_mirror_port_key,
+                             mp::image_mirror_address_key, mp::compress_images_key, mp::storage_pools_key,
+                             mp::image_pool_key, mp::libvirt_pool_key, mp::federation_key, mp::download_limit_key,
+                             mp::cloud_image_mirrors_key, mp::package_cache_port_key,
+                             mp::cloud_init_datasource_port_key);
 }
 
 TEST_F(TestGlobalSettingsHandlers, clientsRegisterHandlerThatTranslatesHotkey)
@@ -250,7 +258,31 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonSett
     mp::daemon::register_global_settings_handlers();
     inject_default_returning_mock_qsettings();
 
-    expect_setting_values({{mp::driver_key, driver}, {mp::bridged_interface_key, ""}, {mp::mounts_key, mount}});
+    expect_setting_values({{mp::driver_key, driver},
+                           {mp::bridged_interface_key, ""},
+                           {mp::mounts_key, mount},
+                           {mp::prefetch_images_key, ""},
+                           {mp::mount_cache_key, mp::mount_cache_default},
+                           {mp::metrics_interval_key, mp::metrics_interval_default},
+                           {mp::warm_pool_size_key, mp::warm_pool_size_default},
+                           {mp::reclaim_memory_key, mp::reclaim_memory_default},
+                           {mp::memory_merging_key, mp::memory_merging_default},
+                           {mp::idle_suspend_key, mp::idle_suspend_default},
+                           {mp::cpu_limit_key, mp::cpu_limit_default},
+                           {mp::memory_limit_key, mp::memory_limit_default},
+                           {mp::parallel_boots_key, mp::parallel_boots_default},
+                           {mp::image_mirror_key, ""},
+                           {mp::image_mirror_port_key, mp::image_mirror_port_default},
+                           {mp::image_mirror_address_key, mp::image_mirror_address_default},
+                           {mp::compress_images_key, mp::compress_images_default},
+                           {mp::storage_pools_key, ""},
+                           {mp::image_pool_key, ""},
+                           {mp::libvirt_pool_key, ""},
+                           {mp::federation_key, ""},
+                           {mp::download_limit_key, mp::download_limit_default},
+                           {mp::cloud_image_mirrors_key, ""},
+                           {mp::package_cache_port_key, mp::package_cache_port_default},
+                           {mp::cloud_init_datasource_port_key, mp::cloud_init_datasource_port_default}});
 }
 
 TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonPlatformSettings)
@@ -316,6 +348,96 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsBoolMounts)
     ASSERT_NO_THROW(handler->set(mp::mounts_key, "1"));
 }
 
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsNegativeMountCache)
+{
+    auto key = mp::mount_cache_key, val = "-1";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsNonNumericMetricsInterval)
+{
+    auto key = mp::metrics_interval_key, val = "often";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsNegativeIdleSuspendPeriod)
+{
+    auto key = mp::idle_suspend_key, val = "-5";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlersThatRejectBadAdmissionLimits)
+{
+    mp::daemon::register_global_settings_handlers();
+
+    for (const auto& [key, val] : {std::pair{mp::cpu_limit_key, "-100"}, std::pair{mp::memory_limit_key, "most"},
+                                   std::pair{mp::parallel_boots_key, "-1"}})
+        MP_EXPECT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                             mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsNegativeWarmPoolSize)
+{
+    auto key = mp::warm_pool_size_key, val = "-1";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsImageMirrorsThatAreNotHttpUrls)
+{
+    auto key = mp::image_mirror_key, val = "ftp://mirror.lan/";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsInvalidImageMirrorPort)
+{
+    auto key = mp::image_mirror_port_key, val = "70000";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsInvalidImageMirrorAddress)
+{
+    auto key = mp::image_mirror_address_key, val = "mirror.lan";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsInvalidPackageCachePort)
+{
+    auto key = mp::package_cache_port_key, val = "-1";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
 TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsBrigedInterface)
 {
     const auto val = "bridge";
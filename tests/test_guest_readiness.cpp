@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/guest_readiness.h>
+
+#include <set>
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+using Milestone = mp::GuestReadiness::Milestone;
+
+namespace
+{
+TEST(GuestReadiness, reaches_only_announced_milestones)
+{
+    mp::GuestReadiness readiness;
+    readiness.reach(Milestone::booting);
+
+    EXPECT_TRUE(readiness.reached(Milestone::booting));
+    EXPECT_FALSE(readiness.reached(Milestone::ssh_up));
+}
+
+TEST(GuestReadiness, forgets_milestones_on_reset)
+{
+    mp::GuestReadiness readiness;
+    readiness.reach(Milestone::ssh_up);
+    readiness.reset();
+
+    EXPECT_FALSE(readiness.reached(Milestone::ssh_up));
+}
+
+TEST(GuestReadiness, wait_returns_once_the_milestone_is_announced)
+{
+    mp::GuestReadiness readiness;
+    std::thread guest{[&readiness] { readiness.reach(Milestone::initialized); }};
+
+    EXPECT_TRUE(readiness.wait_for(Milestone::initialized, 1min));
+    guest.join();
+}
+
+TEST(GuestReadiness, wait_gives_up_on_reset)
+{
+    mp::GuestReadiness readiness;
+    std::thread guest{[&readiness] {
+        std::this_thread::sleep_for(10ms);
+        readiness.reset();
+    }};
+
+    EXPECT_FALSE(readiness.wait_for(Milestone::ssh_up, 1min));
+    guest.join();
+}
+
+TEST(GuestReadiness, wait_times_out_without_an_announcement)
+{
+    mp::GuestReadiness readiness;
+
+    EXPECT_FALSE(readiness.wait_for(Milestone::ssh_up, 1ms));
+}
+
+TEST(GuestReadiness, ports_are_distinct)
+{
+    std::set<std::string> ports;
+    for (const auto milestone : mp::GuestReadiness::all_milestones)
+        ports.insert(mp::GuestReadiness::port_for(milestone));
+
+    EXPECT_EQ(ports.size(), mp::GuestReadiness::all_milestones.size());
+}
+} // namespace
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/idle_policy.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+mp::InstanceMetrics metrics(const std::string& load, long long network_bytes, int sessions = 0)
+{
+    mp::InstanceMetrics ret;
+    ret.load = load + " 0.00 0.00";
+    ret.network_bytes = std::to_string(network_bytes);
+    ret.sessions = std::to_string(sessions);
+
+    return ret;
+}
+
+struct IdlePolicy : public Test
+{
+    mp::IdlePolicy policy{30min};
+    mp::IdlePolicy::Clock::time_point start{};
+};
+
+TEST_F(IdlePolicy, is_disabled_without_a_period)
+{
+    EXPECT_FALSE(mp::IdlePolicy{0min}.enabled());
+    EXPECT_TRUE(policy.enabled());
+}
+
+TEST_F(IdlePolicy, calls_for_suspending_after_the_whole_period_idle)
+{
+    EXPECT_FALSE(policy.observe("foo", metrics("0.02", 1000), start));
+    EXPECT_FALSE(policy.observe("foo", metrics("0.00", 2000), start + 29min));
+    EXPECT_TRUE(policy.observe("foo", metrics("0.01", 3000), start + 30min));
+}
+
+TEST_F(IdlePolicy, starts_over_on_load)
+{
+    policy.observe("foo", metrics("0.00", 0), start);
+    policy.observe("foo", metrics("0.80", 0), start + 20min);
+
+    EXPECT_FALSE(policy.observe("foo", metrics("0.00", 0), start + 40min));
+    EXPECT_TRUE(policy.observe("foo", metrics("0.00", 0), start + 50min));
+}
+
+TEST_F(IdlePolicy, starts_over_on_network_traffic)
+{
+    policy.observe("foo", metrics("0.00", 0), start);
+    policy.observe("foo", metrics("0.00", 100ll << 20), start + 20min);
+
+    EXPECT_FALSE(policy.observe("foo", metrics("0.00", 100ll << 20), start + 40min));
+}
+
+TEST_F(IdlePolicy, keeps_instances_with_someone_logged_in)
+{
+    policy.observe("foo", metrics("0.00", 0, 1), start);
+
+    EXPECT_FALSE(policy.observe("foo", metrics("0.00", 0, 1), start + 2h));
+}
+
+TEST_F(IdlePolicy, does_not_take_missing_metrics_for_idleness)
+{
+    policy.observe("foo", metrics("0.00", 0), start);
+
+    EXPECT_FALSE(policy.observe("foo", mp::InstanceMetrics{}, start + 2h));
+    EXPECT_FALSE(policy.observe("foo", metrics("0.00", 0), start + 2h + 1min));
+}
+
+TEST_F(IdlePolicy, remembers_what_it_suspended_until_taken)
+{
+    policy.mark_suspended("foo");
+
+    EXPECT_FALSE(policy.take_suspended("bar"));
+    EXPECT_TRUE(policy.take_suspended("foo"));
+    EXPECT_FALSE(policy.take_suspended("foo"));
+}
+} // namespace
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "path.h"
+#include "temp_dir.h"
+
+#include <src/daemon/image_mirror.h>
+
+#include <multipass/exceptions/download_exception.h>
+#include <multipass/url_downloader.h>
+
+#include <QFile>
+#include <QUrl>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct ImageMirror : public Test
+{
+    QUrl mirror_url(const QString& path)
+    {
+        return QUrl{QString{"http://127.0.0.1:%1/%2"}.arg(mirror.port()).arg(path)};
+    }
+
+    mpt::TempDir cache_dir;
+    mp::URLDownloader upstream_downloader{std::chrono::seconds{10}};
+    mp::URLDownloader peer_downloader{std::chrono::seconds{10}};
+    mp::ImageMirror::Remotes remotes{
+        {"release", (QUrl::fromLocalFile(mpt::test_data_path()).toString() + "releases/").toStdString()}};
+    mp::ImageMirror mirror{remotes, &upstream_downloader, cache_dir.path(), std::chrono::seconds{60},
+                           1024 * 1024 * 1024};
+};
+
+TEST_F(ImageMirror, serves_what_its_remotes_have_and_keeps_it)
+{
+    mirror.listen(QHostAddress::LocalHost, 0);
+
+    const auto index = peer_downloader.download(mirror_url("release/streams/v1/index.json"));
+
+    EXPECT_EQ(index, mpt::load_test_file("releases/streams/v1/index.json"));
+    EXPECT_TRUE(QFile::exists(cache_dir.filePath("release/streams/v1/index.json")));
+}
+
+TEST_F(ImageMirror, does_not_serve_unknown_remotes)
+{
+    mirror.listen(QHostAddress::LocalHost, 0);
+
+    EXPECT_THROW(peer_downloader.download(mirror_url("nowhere/streams/v1/index.json")), mp::DownloadException);
+}
+
+TEST_F(ImageMirror, evicts_what_was_read_least_recently_beyond_its_maximum_size)
+{
+    mp::ImageMirror small_mirror{remotes, &upstream_downloader, cache_dir.path(), std::chrono::seconds{60}, 1};
+    small_mirror.listen(QHostAddress::LocalHost, 0);
+    const auto url = QString{"http://127.0.0.1:%1/release/"}.arg(small_mirror.port());
+
+    peer_downloader.download(QUrl{url + "streams/v1/index.json"});
+    const auto manifest = peer_downloader.download(QUrl{url + "multiple_versions_manifest.json"});
+
+    EXPECT_EQ(manifest, mpt::load_test_file("releases/multiple_versions_manifest.json"));
+    EXPECT_FALSE(QFile::exists(cache_dir.filePath("release/streams/v1/index.json")));
+    EXPECT_TRUE(QFile::exists(cache_dir.filePath("release/multiple_versions_manifest.json")));
+}
+
+TEST(ImageMirrorRemotes, are_named_like_what_they_mirror)
+{
+    EXPECT_THAT(mp::remotes_mirrored_at("http://mirror.lan:8087", {{"release", "https://cloud-images.ubuntu.com/"}}),
+                ElementsAre(Pair("release", "http://mirror.lan:8087/release/")));
+}
+} // namespace
@@ -20,25 +20,33 @@
 #include "file_operations.h"
 #include "mock_image_host.h"
 #include "mock_process_factory.h"
+#include "mock_url_downloader.h"
 #include "path.h"
 #include "stub_url_downloader.h"
 #include "temp_dir.h"
 #include "temp_file.h"
 #include "tracking_url_downloader.h"
 
+#include <src/daemon/baked_image_host.h>
 #include <src/daemon/default_vm_image_vault.h>
 
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/create_image_exception.h>
 #include <multipass/format.h>
 #include <multipass/query.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 
 #include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QThread>
 #include <QUrl>
 
+#include <atomic>
+#include <thread>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 
@@ -59,6 +67,13 @@ struct BadURLDownloader : public mp::URLDownloader
         mpt::make_file_with_content(file_name, "Bad hash");
     }
 
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const mp::ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+        return mp::vault::compute_image_hash(file_name);
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -106,10 +121,49 @@ struct RunningURLDownloader : public mp::URLDownloader
         throw mp::AbortedDownloadException("Aborted!");
     }
 
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const mp::ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+        return {};
+    }
+
+    QByteArray download(const QUrl& url) override
+    {
+        return {};
+    }
+};
+
+struct GatedURLDownloader : public mp::URLDownloader
+{
+    GatedURLDownloader() : mp::URLDownloader{std::chrono::seconds(10)}
+    {
+    }
+    void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                     const mp::ProgressMonitor& monitor) override
+    {
+        ++downloads;
+        while (!open)
+            QThread::yieldCurrentThread();
+
+        monitor(download_type, 50);
+        mpt::make_file_with_content(file_name, "");
+    }
+
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const mp::ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+        return mp::vault::compute_image_hash(file_name);
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
     }
+
+    std::atomic_int downloads{0};
+    std::atomic_bool open{false};
 };
 
 struct ImageVault : public testing::Test
@@ -162,6 +216,12 @@ struct ImageVault : public testing::Test
     mp::ProgressMonitor stub_monitor{[](int, int) { return true; }};
     mp::VMImageVault::PrepareAction stub_prepare{
         [](const mp::VMImage& source_image) -> mp::VMImage { return source_image; }};
+    mp::DefaultVMImageVault::OverlayAction stub_overlay{
+        [](const mp::Path& backing_image_path, const QDir& output_dir) -> mp::Path {
+            const auto overlay_path = output_dir.filePath(QFileInfo{backing_image_path}.fileName());
+            mpt::make_file_with_content(overlay_path, "overlay");
+            return overlay_path;
+        }};
     mpt::TempDir cache_dir;
     mpt::TempDir data_dir;
     std::string instance_name{"valley-pied-piper"};
@@ -200,6 +260,22 @@ TEST_F(ImageVault, downloads_kernel_and_initrd)
     EXPECT_FALSE(vm_image.initrd_path.isEmpty());
 }
 
+TEST_F(ImageVault, adds_kernel_and_initrd_to_images_cached_without_them)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    auto fast_query = default_query;
+    fast_query.name = "fast-instance";
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageKernelAndInitrd, fast_query, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(3));
+    EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.kernel.url()));
+    EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.initrd.url()));
+    EXPECT_TRUE(QFileInfo::exists(vm_image.kernel_path));
+    EXPECT_TRUE(QFileInfo::exists(vm_image.initrd_path));
+}
+
 TEST_F(ImageVault, calls_prepare)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
@@ -271,6 +347,99 @@ TEST_F(ImageVault, remembers_instance_images)
     EXPECT_THAT(vm_image1.image_path, Eq(vm_image2.image_path));
 }
 
+TEST_F(ImageVault, keeps_instance_images_in_the_requested_storage_pool)
+{
+    mpt::TempDir pool_dir;
+    auto query = default_query;
+    query.storage_location = pool_dir.path().toStdString();
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
+
+    EXPECT_TRUE(vm_image.image_path.startsWith(pool_dir.path()));
+    EXPECT_TRUE(QFileInfo::exists(vm_image.image_path));
+
+    vault.remove(instance_name);
+
+    EXPECT_FALSE(QFileInfo::exists(QFileInfo{vm_image.image_path}.absolutePath()));
+}
+
+TEST_F(ImageVault, remembers_removed_instance_images)
+{
+    mp::DefaultVMImageVault first_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    first_vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    first_vault.remove(instance_name);
+
+    mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
+    EXPECT_FALSE(another_vault.has_record_for(instance_name));
+}
+
+TEST_F(ImageVault, removes_instance_images_together)
+{
+    std::vector<std::string> names{"instance-0", "instance-1", "instance-2"};
+    mp::DefaultVMImageVault first_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    for (const auto& name : names)
+    {
+        auto query = default_query;
+        query.name = name;
+        first_vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
+    }
+
+    first_vault.remove_all({"instance-0", "instance-2", "never-there"});
+
+    mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    EXPECT_FALSE(another_vault.has_record_for("instance-0"));
+    EXPECT_TRUE(another_vault.has_record_for("instance-1"));
+    EXPECT_FALSE(another_vault.has_record_for("instance-2"));
+}
+
+TEST_F(ImageVault, compacts_record_journal)
+{
+    constexpr auto num_instances = 100;
+    mp::DefaultVMImageVault first_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    for (auto i = 0; i < num_instances; ++i)
+    {
+        auto query = default_query;
+        query.name = fmt::format("instance-{}", i);
+        first_vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
+    }
+
+    const QDir vault_data_dir{QDir{data_dir.path()}.filePath("vault")};
+    const QFileInfo journal{vault_data_dir.filePath("multipassd-instance-image-records.json.journal")};
+    EXPECT_TRUE(QFileInfo::exists(vault_data_dir.filePath("multipassd-instance-image-records.json")));
+    EXPECT_LT(journal.size(), QFileInfo{vault_data_dir.filePath("multipassd-instance-image-records.json")}.size());
+
+    mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    for (auto i = 0; i < num_instances; ++i)
+        EXPECT_TRUE(another_vault.has_record_for(fmt::format("instance-{}", i)));
+}
+
+TEST_F(ImageVault, does_not_bring_removed_records_back_from_a_journal_outliving_compaction)
+{
+    mp::DefaultVMImageVault first_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    for (auto i = 0; i < 64; ++i)
+    {
+        auto query = default_query;
+        query.name = fmt::format("instance-{}", i);
+        first_vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
+    }
+
+    const QDir vault_data_dir{QDir{data_dir.path()}.filePath("vault")};
+    const auto journal_path = vault_data_dir.filePath("multipassd-instance-image-records.json.journal");
+    const auto journal = mpt::load(journal_path);
+
+    first_vault.remove("instance-0"); // the change that has the records compacted
+    ASSERT_FALSE(QFileInfo::exists(journal_path));
+
+    // As if the daemon crashed after rewriting the records, before removing the journal
+    mpt::make_file_with_content(journal_path, (journal + R"({"key":"instance-0"})" + '\n').toStdString());
+
+    mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    EXPECT_FALSE(another_vault.has_record_for("instance-0"));
+    EXPECT_TRUE(another_vault.has_record_for("instance-63"));
+}
+
 TEST_F(ImageVault, remembers_prepared_images)
 {
     int prepare_called_count{0};
@@ -353,6 +522,128 @@ TEST_F(ImageVault, image_exists_not_expired)
     EXPECT_TRUE(QFileInfo::exists(file_name));
 }
 
+TEST_F(ImageVault, instance_image_is_overlay_on_prepared_image)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}, stub_overlay};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(vm_image.backing_image_path, Eq(url_downloader.downloaded_files[0]));
+    EXPECT_THAT(mp::utils::contents_of(vm_image.image_path), StrEq("overlay"));
+    EXPECT_TRUE(QFileInfo::exists(vm_image.backing_image_path));
+}
+
+TEST_F(ImageVault, expired_image_backing_an_instance_is_kept)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}, stub_overlay};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    vault.prune_expired_images();
+
+    EXPECT_TRUE(QFileInfo::exists(vm_image.backing_image_path));
+
+    vault.remove(instance_name);
+    vault.prune_expired_images();
+
+    EXPECT_FALSE(QFileInfo::exists(vm_image.backing_image_path));
+}
+
+TEST_F(ImageVault, only_the_image_dir_backing_an_instance_is_kept)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}, stub_overlay};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    // A prefix of the backing image's directory, which a substring match would take for it
+    const auto image_dir = QFileInfo{vm_image.backing_image_path}.absolutePath();
+    const auto prefix_dir = image_dir.left(image_dir.size() - 1);
+    mpt::make_file_with_content(QDir{prefix_dir}.filePath("mock_image.img"));
+
+    vault.prune_expired_images();
+
+    EXPECT_TRUE(QFileInfo::exists(vm_image.backing_image_path));
+    EXPECT_FALSE(QFileInfo::exists(prefix_dir));
+}
+
+TEST_F(ImageVault, cloned_instance_image_is_a_copy_on_the_same_prepared_image)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}, stub_overlay};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    auto clone = vault.clone_instance_image(instance_name, "clone");
+
+    EXPECT_THAT(clone.image_path, Ne(vm_image.image_path));
+    EXPECT_THAT(mp::utils::contents_of(clone.image_path), StrEq("overlay"));
+    EXPECT_THAT(clone.backing_image_path, Eq(vm_image.backing_image_path));
+    EXPECT_TRUE(vault.has_record_for("clone"));
+
+    vault.remove(instance_name);
+
+    EXPECT_TRUE(QFileInfo::exists(clone.image_path));
+    EXPECT_THROW(vault.clone_instance_image(instance_name, "another"), std::runtime_error);
+}
+
+TEST_F(ImageVault, baked_instance_image_is_flattened_and_served_to_launches)
+{
+    std::vector<mp::Path> flattened;
+    mp::DefaultVMImageVault::FlattenAction stub_flatten{
+        [&flattened](const mp::Path& image_path, const mp::Path& backing_image_path, const mp::Path& flat_path) {
+            flattened.push_back(backing_image_path);
+            mpt::make_file_with_content(flat_path, "flat");
+        }};
+    mp::BakedVMImageHost baked_host{QDir{data_dir.path()}.filePath("vault/baked")};
+    hosts.insert(hosts.begin(), &baked_host);
+
+    mp::DefaultVMImageVault vault{hosts,        &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0},
+                                  stub_overlay, nullptr,         stub_flatten};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    auto info = vault.bake_instance_image(instance_name, "ci-base");
+
+    ASSERT_THAT(flattened, ElementsAre(vm_image.backing_image_path));
+    EXPECT_THAT(info.aliases, ElementsAre("ci-base"));
+
+    const mp::Query baked_query{"", "ci-base", false, "", mp::Query::Type::Alias};
+    auto served = baked_host.info_for(baked_query);
+    ASSERT_TRUE(served);
+    EXPECT_THAT(served->id, Eq(info.id));
+
+    const mp::Query launch_query{"launched", "ci-base", false, "", mp::Query::Type::Alias};
+    const auto downloads = url_downloader.downloaded_urls.size();
+    auto launched = vault.fetch_image(mp::FetchType::ImageOnly, launch_query, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(downloads));
+    EXPECT_THAT(mp::utils::contents_of(launched.backing_image_path), StrEq("flat"));
+    EXPECT_THROW(vault.bake_instance_image(instance_name, "ci-base"), std::runtime_error);
+    EXPECT_THROW(vault.bake_instance_image("unknown", "another"), std::runtime_error);
+}
+
+TEST_F(ImageVault, deduplicates_with_the_hashes_it_already_has)
+{
+    mp::VMImage vm_image;
+    {
+        mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1},
+                                      stub_overlay};
+        vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+        vault.prune_expired_images();
+    }
+
+    const QDir vault_cache_dir{QDir{cache_dir.path()}.filePath("vault")};
+    EXPECT_FALSE(vault_cache_dir.exists("store")); // nothing hashed while pruning
+
+    // A digest that matches the file's size and modification time is taken as it is, without reading the file
+    const QFileInfo image_info{vm_image.backing_image_path};
+    const auto digests_path = vault_cache_dir.filePath("multipassd-image-digests.json");
+    QFile::remove(digests_path);
+    mpt::make_file_with_content(
+        digests_path,
+        fmt::format(R"({{"{}": {{"size": {}, "last_modified": {}, "sha256": "cached"}}}})",
+                    image_info.absoluteFilePath(), image_info.size(), image_info.lastModified().toMSecsSinceEpoch()));
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}, stub_overlay};
+    vault.maintain_images();
+
+    EXPECT_TRUE(QFileInfo::exists(vault_cache_dir.filePath("store/cached")));
+}
+
 TEST_F(ImageVault, invalid_image_dir_is_removed)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
@@ -370,6 +661,27 @@ TEST_F(ImageVault, invalid_image_dir_is_removed)
     EXPECT_FALSE(QFileInfo::exists(invalid_image_dir.absolutePath()));
 }
 
+TEST_F(ImageVault, DISABLE_ON_WINDOWS(identical_images_are_stored_once))
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
+    host.mock_snapcraft_image_info.verify = false;
+
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    vault.fetch_image(mp::FetchType::ImageOnly, {"other-instance", "snapcraft", false, "", mp::Query::Type::Alias},
+                      stub_prepare, stub_monitor);
+    ASSERT_THAT(url_downloader.downloaded_files.size(), Eq(2));
+
+    vault.maintain_images();
+
+    const QDir store_dir{QDir{cache_dir.path()}.filePath("vault/store")};
+    const auto stored = store_dir.entryList(QDir::Files);
+    ASSERT_THAT(stored.size(), Eq(1));
+    EXPECT_THAT(stored.first(), Eq(mp::vault::compute_image_hash(url_downloader.downloaded_files[0])));
+
+    for (const auto& file : url_downloader.downloaded_files)
+        EXPECT_TRUE(QFileInfo::exists(file));
+}
+
 TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(file_based_fetch_copies_image_and_returns_expected_info))
 {
     mpt::TempFile file;
@@ -385,6 +697,34 @@ TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(file_based_fetch_copies_image_an
     EXPECT_EQ(vm_image.id, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
 }
 
+TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(file_based_fetch_reuses_known_image_hash))
+{
+    mpt::TempFile file;
+    const QFileInfo file_info{file.name()};
+    const auto known_hash = QStringLiteral("not-computed-again");
+
+    QJsonObject digest;
+    digest.insert("size", file_info.size());
+    digest.insert("last_modified", file_info.lastModified().toMSecsSinceEpoch());
+    digest.insert("sha256", known_hash);
+    QJsonObject digests;
+    digests.insert(file_info.absoluteFilePath(), digest);
+
+    QDir{cache_dir.path()}.mkpath("vault");
+    mpt::make_file_with_content(QDir{cache_dir.path()}.filePath("vault/multipassd-image-digests.json"),
+                                QJsonDocument{digests}.toJson().toStdString());
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto query = default_query;
+
+    query.release = file.url().toStdString();
+    query.query_type = mp::Query::Type::LocalFile;
+
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
+
+    EXPECT_EQ(vm_image.id, known_hash.toStdString());
+}
+
 TEST_F(ImageVault, invalid_custom_image_file_throws)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
@@ -426,6 +766,41 @@ TEST_F(ImageVault, hash_mismatch_throws)
                  mp::CreateImageException);
 }
 
+TEST_F(ImageVault, uses_hash_computed_during_download_for_verification)
+{
+    NiceMock<mpt::MockURLDownloader> mock_url_downloader;
+    EXPECT_CALL(mock_url_downloader, download_to).Times(0);
+    EXPECT_CALL(mock_url_downloader, download_and_hash_to)
+        .WillOnce([](const QUrl&, const QString& file_name, auto...) {
+            mpt::make_file_with_content(file_name, "Bad hash");
+            return QString{mpt::default_id};
+        });
+
+    mp::DefaultVMImageVault vault{hosts, &mock_url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_EQ(vm_image.id, mpt::default_id);
+}
+
+TEST_F(ImageVault, xz_image_is_decoded_while_downloading)
+{
+    NiceMock<mpt::MockURLDownloader> mock_url_downloader;
+    host.mock_bionic_image_info.image_location = "https://some/image.img.xz";
+
+    EXPECT_CALL(mock_url_downloader, download_to).Times(0);
+    EXPECT_CALL(mock_url_downloader, download_and_hash_to).Times(0);
+    EXPECT_CALL(mock_url_downloader, stream_and_hash(QUrl{host.mock_bionic_image_info.image_location}, _, _, _, _))
+        .WillOnce([](auto, auto, auto, auto, const mp::URLDownloader::DataSink& sink) {
+            sink("This is definitely not xz data");
+            return QString{mpt::default_id};
+        });
+
+    mp::DefaultVMImageVault vault{hosts, &mock_url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
+    MP_EXPECT_THROW_THAT(vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor),
+                         mp::CreateImageException, mpt::match_what(HasSubstr("not a xz file")));
+}
+
 TEST_F(ImageVault, invalid_remote_throws)
 {
     mpt::StubURLDownloader stub_url_downloader;
@@ -507,6 +882,142 @@ TEST_F(ImageVault, image_update_creates_new_dir_and_removes_old)
     EXPECT_FALSE(QFileInfo::exists(original_absolute_path));
 }
 
+TEST_F(ImageVault, image_update_keeps_old_image_backing_an_instance)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}, stub_overlay};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    host.mock_bionic_image_info.id = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b856";
+    host.mock_bionic_image_info.version = "20180825";
+    host.mock_bionic_image_info.verify = false;
+
+    vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
+    vault.prune_expired_images();
+
+    EXPECT_TRUE(QFileInfo::exists(vm_image.backing_image_path));
+}
+
+TEST_F(ImageVault, compresses_prepared_images_once_when_asked_to)
+{
+    auto compressions = 0;
+    mp::DefaultVMImageVault::CompressAction compress{
+        [&compressions](const mp::Path&, const mp::Path& compressed_path) {
+            ++compressions;
+            mpt::make_file_with_content(compressed_path, "compressed");
+        }};
+
+    mp::VMImage vm_image;
+    {
+        mp::DefaultVMImageVault vault{hosts,       &url_downloader, cache_dir.path(), data_dir.path(),
+                                      mp::days{1}, stub_overlay,    compress};
+        vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+        vault.maintain_images();
+        vault.maintain_images();
+    }
+
+    mp::DefaultVMImageVault vault{hosts,       &url_downloader, cache_dir.path(), data_dir.path(),
+                                  mp::days{1}, stub_overlay,    compress};
+    vault.maintain_images();
+
+    EXPECT_EQ(compressions, 1);
+    EXPECT_EQ(mpt::load(vm_image.backing_image_path), "compressed");
+    EXPECT_FALSE(QFileInfo::exists(vm_image.backing_image_path + ".compressed"));
+}
+
+TEST_F(ImageVault, leaves_compression_to_maintenance)
+{
+    auto compressions = 0;
+    mp::DefaultVMImageVault::CompressAction compress{[&compressions](const mp::Path&, const mp::Path&) {
+        ++compressions;
+    }};
+
+    mp::DefaultVMImageVault vault{hosts,       &url_downloader, cache_dir.path(), data_dir.path(),
+                                  mp::days{1}, stub_overlay,    compress};
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    vault.prune_expired_images();
+
+    EXPECT_EQ(compressions, 0);
+}
+
+TEST_F(ImageVault, keeps_images_that_fail_to_compress)
+{
+    mp::DefaultVMImageVault::CompressAction compress{[](const mp::Path&, const mp::Path& compressed_path) {
+        mpt::make_file_with_content(compressed_path, "half");
+        throw std::runtime_error{"no space left"};
+    }};
+
+    mp::DefaultVMImageVault vault{hosts,       &url_downloader, cache_dir.path(), data_dir.path(),
+                                  mp::days{1}, stub_overlay,    compress};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    const auto original = mpt::load(vm_image.backing_image_path);
+
+    vault.maintain_images();
+
+    EXPECT_EQ(mpt::load(vm_image.backing_image_path), original);
+    EXPECT_FALSE(QFileInfo::exists(vm_image.backing_image_path + ".compressed"));
+}
+
+TEST_F(ImageVault, prefetch_downloads_and_prepares_uncached_image)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
+    auto prepare_called = false;
+    auto prepare = [&prepare_called](const mp::VMImage& source_image) -> mp::VMImage {
+        prepare_called = true;
+        return source_image;
+    };
+
+    vault.prefetch_images(mp::FetchType::ImageOnly, {default_query}, prepare, stub_monitor);
+
+    EXPECT_TRUE(prepare_called);
+    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_FALSE(vault.has_record_for(instance_name));
+}
+
+TEST_F(ImageVault, prefetch_does_not_download_cached_image)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    vault.prefetch_images(mp::FetchType::ImageOnly, {default_query}, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+}
+
+TEST_F(ImageVault, concurrent_fetches_share_one_download_and_its_progress)
+{
+    GatedURLDownloader gated_url_downloader;
+    mp::DefaultVMImageVault vault{hosts, &gated_url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
+
+    std::thread first_launch{
+        [&] { vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor); }};
+    while (gated_url_downloader.downloads == 0)
+        QThread::yieldCurrentThread();
+
+    std::atomic_bool waiting{false};
+    std::atomic_int image_progress{-1};
+    mp::ProgressMonitor second_monitor{[&waiting, &image_progress](int type, int percentage) {
+        if (type == mp::LaunchProgress::WAITING)
+            waiting = true;
+        else if (type == mp::LaunchProgress::IMAGE)
+            image_progress = percentage;
+        return true;
+    }};
+    std::thread second_launch{[&] {
+        vault.fetch_image(mp::FetchType::ImageOnly, {"other-instance", "xenial", false, "", mp::Query::Type::Alias},
+                          stub_prepare, second_monitor);
+    }};
+    while (!waiting)
+        QThread::yieldCurrentThread();
+
+    gated_url_downloader.open = true;
+    first_launch.join();
+    second_launch.join();
+
+    EXPECT_EQ(gated_url_downloader.downloads, 1);
+    EXPECT_EQ(image_progress, 50);
+}
+
 TEST_F(ImageVault, aborted_download_throws)
 {
     RunningURLDownloader running_url_downloader;
@@ -533,6 +1044,48 @@ TEST_F(ImageVault, minimum_image_size_returns_expected_size)
     EXPECT_EQ(image_size, size);
 }
 
+TEST_F(ImageVault, minimum_image_size_asks_qemuimg_once_per_unchanged_image)
+{
+    const mp::MemorySize image_size{"1048576"};
+    const mp::ProcessState qemuimg_exit_status{0, mp::nullopt};
+    const QByteArray qemuimg_output(fake_img_info(image_size));
+    auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_EQ(vault.minimum_image_size_for(vm_image.id), image_size);
+    EXPECT_EQ(vault.minimum_image_size_for(vm_image.id), image_size);
+
+    const auto processes = mock_factory_scope->process_list();
+    EXPECT_EQ(std::count_if(processes.cbegin(), processes.cend(),
+                            [](const auto& process) { return process.arguments.contains("info"); }),
+              1);
+}
+
+TEST_F(ImageVault, minimum_image_size_is_remembered_across_restarts)
+{
+    const mp::MemorySize image_size{"1048576"};
+    const mp::ProcessState qemuimg_exit_status{0, mp::nullopt};
+    const QByteArray qemuimg_output(fake_img_info(image_size));
+    mp::VMImage vm_image;
+
+    {
+        auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
+
+        mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+        vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+        EXPECT_EQ(vault.minimum_image_size_for(vm_image.id), image_size);
+    }
+
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
+    EXPECT_EQ(vault.minimum_image_size_for(vm_image.id), image_size);
+    EXPECT_TRUE(mock_factory_scope->process_list().empty());
+}
+
 TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(file_based_minimum_size_returns_expected_size))
 {
     const mp::MemorySize image_size{"2097152"};
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "mock_virtual_machine.h"
+
+#include <src/daemon/instance_addresses.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+TEST(InstanceAddresses, puts_the_management_address_first)
+{
+    EXPECT_THAT(mp::ordered_ipv4("10.0.0.5", {"192.168.1.2", "10.0.0.5"}), ElementsAre("10.0.0.5", "192.168.1.2"));
+    EXPECT_THAT(mp::ordered_ipv4("UNKNOWN", {"192.168.1.2"}), ElementsAre("192.168.1.2"));
+    EXPECT_THAT(mp::ordered_ipv4("UNKNOWN", {}), ElementsAre("N/A"));
+}
+
+TEST(InstanceAddresses, finds_addresses_without_going_into_the_instance)
+{
+    NiceMock<mpt::MockVirtualMachine> vm{"asdf"};
+    ON_CALL(vm, management_ipv4()).WillByDefault(Return("10.0.0.5"));
+    EXPECT_CALL(vm, known_ipv4()).WillOnce(Return(std::vector<std::string>{"10.0.0.5", "192.168.1.2"}));
+    EXPECT_CALL(vm, get_all_ipv4(_)).Times(0);
+
+    EXPECT_THAT(mp::known_ipv4_for(vm), ElementsAre("10.0.0.5", "192.168.1.2"));
+}
+
+TEST(InstanceAddresses, tells_when_addresses_change)
+{
+    mp::InstanceAddresses addresses;
+
+    EXPECT_FALSE(addresses.known("asdf"));
+    EXPECT_TRUE(addresses.update("asdf", {"10.0.0.5"}));
+    EXPECT_FALSE(addresses.update("asdf", {"10.0.0.5"}));
+    EXPECT_TRUE(addresses.update("asdf", {"10.0.0.5", "192.168.1.2"}));
+    ASSERT_TRUE(addresses.known("asdf"));
+    EXPECT_THAT(*addresses.known("asdf"), ElementsAre("10.0.0.5", "192.168.1.2"));
+
+    addresses.forget("asdf");
+    EXPECT_FALSE(addresses.known("asdf"));
+    EXPECT_TRUE(addresses.update("asdf", {"10.0.0.5"}));
+}
+} // namespace
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/instance_events.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto no_wait = std::chrono::milliseconds::zero();
+
+mp::WatchReply event_about(const std::string& instance)
+{
+    mp::WatchReply event;
+    event.set_instance_name(instance);
+    event.mutable_instance_status()->set_status(mp::InstanceStatus::RUNNING);
+
+    return event;
+}
+
+TEST(InstanceEvents, delivers_events_to_subscribers)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({});
+
+    events.publish(event_about("foo"));
+    events.publish(event_about("bar"));
+
+    auto delivered = subscription->next(no_wait);
+    ASSERT_TRUE(delivered);
+    EXPECT_THAT(*delivered, ElementsAre(Property(&mp::WatchReply::instance_name, "foo"),
+                                        Property(&mp::WatchReply::instance_name, "bar")));
+}
+
+TEST(InstanceEvents, delivers_only_events_about_watched_instances)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({"bar"});
+
+    events.publish(event_about("foo"));
+    events.publish(event_about("bar"));
+
+    auto delivered = subscription->next(no_wait);
+    ASSERT_TRUE(delivered);
+    EXPECT_THAT(*delivered, ElementsAre(Property(&mp::WatchReply::instance_name, "bar")));
+}
+
+TEST(InstanceEvents, delivers_nothing_when_nothing_happened)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({});
+
+    auto delivered = subscription->next(no_wait);
+    ASSERT_TRUE(delivered);
+    EXPECT_THAT(*delivered, IsEmpty());
+}
+
+TEST(InstanceEvents, ends_subscriptions_on_close)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({});
+
+    events.close();
+
+    EXPECT_FALSE(subscription->next(std::chrono::seconds{5}));
+    EXPECT_FALSE(events.subscribe({})->next(no_wait));
+}
+
+TEST(InstanceEvents, ends_subscriptions_that_fall_behind)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({});
+
+    for (std::size_t i = 0; i <= mp::InstanceEvents::max_queued_events; ++i)
+        events.publish(event_about("foo"));
+
+    EXPECT_FALSE(subscription->next(no_wait));
+    EXPECT_TRUE(subscription->overflowed());
+}
+
+TEST(InstanceEvents, leaves_other_subscriptions_alone_when_one_ends)
+{
+    mp::InstanceEvents events;
+    auto subscription = events.subscribe({});
+    events.subscribe({}); // dropped right away
+
+    events.publish(event_about("foo"));
+
+    auto delivered = subscription->next(no_wait);
+    ASSERT_TRUE(delivered);
+    EXPECT_THAT(*delivered, SizeIs(1));
+}
+} // namespace
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/instance_locks.h>
+
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+struct InstanceLocks : public Test
+{
+    mp::InstanceLocks locks;
+};
+
+TEST_F(InstanceLocks, claims_different_instances_side_by_side)
+{
+    auto first = locks.claim({"asdf"});
+    auto second = locks.claim({"sdfg", "dfgh"});
+
+    EXPECT_TRUE(locks.is_claimed("asdf"));
+    EXPECT_TRUE(locks.is_claimed("sdfg"));
+    EXPECT_TRUE(locks.is_claimed("dfgh"));
+}
+
+TEST_F(InstanceLocks, refuses_instances_already_claimed)
+{
+    auto guard = locks.claim({"asdf"});
+
+    EXPECT_THROW(locks.claim({"sdfg", "asdf"}), std::runtime_error);
+    EXPECT_FALSE(locks.is_claimed("sdfg")); // nothing is claimed when one of them is busy
+}
+
+TEST_F(InstanceLocks, releases_on_guard_destruction)
+{
+    {
+        auto guard = locks.claim({"asdf", "asdf"});
+    }
+
+    EXPECT_FALSE(locks.is_claimed("asdf"));
+    EXPECT_NO_THROW(locks.claim({"asdf"}));
+}
+
+TEST_F(InstanceLocks, releases_from_another_thread)
+{
+    auto guard = std::make_unique<mp::InstanceLocks::Guard>(locks.claim({"asdf"}));
+    std::thread{[&guard] { guard.reset(); }}.join();
+
+    EXPECT_FALSE(locks.is_claimed("asdf"));
+}
+
+TEST_F(InstanceLocks, moved_from_guard_does_not_release)
+{
+    auto guard = std::make_unique<mp::InstanceLocks::Guard>(locks.claim({"asdf"}));
+    auto moved = std::move(*guard);
+    guard.reset();
+
+    EXPECT_TRUE(locks.is_claimed("asdf"));
+}
+} // namespace
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "dummy_ssh_key_provider.h"
+#include "mock_virtual_machine.h"
+
+#include <src/daemon/instance_metrics.h>
+
+#include <multipass/ssh/ssh_session_pool.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+TEST(InstanceMetrics, parses_every_metric)
+{
+    const auto output = "load 0.01 0.05 0.10\n"
+                        "memory_total 1028685824\n"
+                        "memory_usage 151769088\n"
+                        "disk_usage 1518960640\n"
+                        "disk_total 5131640832\n"
+                        "release Ubuntu 22.04 LTS\n"
+                        "network_bytes 73400320\n"
+                        "sessions 1\n";
+
+    auto metrics = mp::parse_instance_metrics(output);
+
+    EXPECT_EQ(metrics.load, "0.01 0.05 0.10");
+    EXPECT_EQ(metrics.memory_total, "1028685824");
+    EXPECT_EQ(metrics.memory_usage, "151769088");
+    EXPECT_EQ(metrics.disk_usage, "1518960640");
+    EXPECT_EQ(metrics.disk_total, "5131640832");
+    EXPECT_EQ(metrics.current_release, "Ubuntu 22.04 LTS");
+    EXPECT_EQ(metrics.network_bytes, "73400320");
+    EXPECT_EQ(metrics.sessions, "1");
+}
+
+TEST(InstanceMetrics, leaves_missing_and_unknown_metrics_out)
+{
+    auto metrics = mp::parse_instance_metrics("load 1.00 0.50 0.25\nrelease \nbogus 42\ngarbage");
+
+    EXPECT_EQ(metrics.load, "1.00 0.50 0.25");
+    EXPECT_THAT(metrics.memory_total, IsEmpty());
+    EXPECT_THAT(metrics.disk_usage, IsEmpty());
+    EXPECT_THAT(metrics.current_release, IsEmpty());
+}
+
+TEST(InstanceMetrics, balloons_idle_instances_down_to_twice_what_they_use)
+{
+    mp::InstanceMetrics metrics;
+    metrics.memory_usage = std::to_string(400ll << 20);
+    metrics.memory_total = std::to_string(4ll << 30);
+
+    EXPECT_EQ(mp::balloon_target_for(metrics, mp::MemorySize{"4G"}), mp::MemorySize{"800M"});
+}
+
+TEST(InstanceMetrics, gives_instances_back_their_memory_as_they_use_it)
+{
+    mp::InstanceMetrics metrics;
+    metrics.memory_usage = std::to_string(3ll << 30);
+    metrics.memory_total = std::to_string(3500ll << 20);
+
+    EXPECT_EQ(mp::balloon_target_for(metrics, mp::MemorySize{"8G"}), mp::MemorySize{"6G"});
+    EXPECT_EQ(mp::balloon_target_for(metrics, mp::MemorySize{"4G"}), mp::MemorySize{"4G"});
+}
+
+TEST(InstanceMetrics, leaves_balloons_alone_for_small_changes)
+{
+    mp::InstanceMetrics metrics;
+    metrics.memory_usage = std::to_string(1ll << 30);
+    metrics.memory_total = std::to_string(2100ll << 20);
+
+    EXPECT_FALSE(mp::balloon_target_for(metrics, mp::MemorySize{"4G"}));
+}
+
+TEST(InstanceMetrics, leaves_balloons_alone_without_memory_metrics)
+{
+    EXPECT_FALSE(mp::balloon_target_for(mp::InstanceMetrics{}, mp::MemorySize{"4G"}));
+}
+
+TEST(InstanceMetrics, has_nothing_cached_at_first)
+{
+    mpt::DummyKeyProvider key_provider{"keeper"};
+    mp::SSHSessionPool ssh_sessions{key_provider};
+    mp::InstanceMetricsCollector collector{key_provider, ssh_sessions};
+
+    EXPECT_FALSE(collector.cached("asdf", std::chrono::seconds{60}));
+}
+
+TEST(InstanceMetrics, collects_from_the_guest_agent_without_ssh)
+{
+    mpt::DummyKeyProvider key_provider{"keeper"};
+    mp::SSHSessionPool ssh_sessions{key_provider};
+    mp::InstanceMetricsCollector collector{key_provider, ssh_sessions};
+
+    mp::GuestMetrics guest_metrics;
+    guest_metrics.load = std::array<double, 3>{0.5, 0.25, 0.1};
+    guest_metrics.memory_usage = 151769088;
+    guest_metrics.memory_total = 1028685824;
+    guest_metrics.disk_usage = 1518960640;
+    guest_metrics.disk_total = 5131640832;
+    guest_metrics.current_release = "Ubuntu 22.04 LTS";
+    guest_metrics.ipv4 = {"10.0.0.5", "192.168.1.2"};
+
+    NiceMock<mpt::MockVirtualMachine> vm{"asdf"};
+    ON_CALL(vm, management_ipv4()).WillByDefault(Return("10.0.0.5"));
+    EXPECT_CALL(vm, guest_metrics(_)).WillOnce(Return(guest_metrics));
+    EXPECT_CALL(vm, ssh_hostname()).Times(0);
+    EXPECT_CALL(vm, get_all_ipv4(_)).Times(0);
+
+    auto metrics = collector.collect(vm, "ubuntu");
+
+    EXPECT_EQ(metrics.load, "0.50 0.25 0.10");
+    EXPECT_EQ(metrics.memory_usage, "151769088");
+    EXPECT_EQ(metrics.disk_total, "5131640832");
+    EXPECT_EQ(metrics.current_release, "Ubuntu 22.04 LTS");
+    EXPECT_THAT(metrics.ipv4, ElementsAre("10.0.0.5", "192.168.1.2"));
+}
+} // namespace
@@ -83,6 +83,13 @@ struct TestInstanceSettingsHandler : public Test
     std::unordered_set<std::string> preparing_vms;
     bool fake_persister_called = false;
     inline static constexpr auto properties = std::array{"cpus", "disk", "memory"};
+    inline static constexpr auto placement_properties =
+        std::array{"hugepages", "numa-node", "cpu-pinning", "io-pinning"};
+    inline static constexpr auto disk_option_properties =
+        std::array{"disk-cache", "disk-aio", "disk-iothread", "disk-queues", "disk-detect-zeroes"};
+    inline static constexpr auto network_option_properties = std::array{"net-vhost", "net-queues", "net-ring-size"};
+    inline static constexpr auto resource_limit_properties =
+        std::array{"cpu-weight", "io-weight", "memory-high", "cpu-max"};
 };
 
 QString make_key(const QString& instance_name, const QString& property)
@@ -110,6 +117,14 @@ TEST_P(TestInstanceSettingsKeys, keysCoversAllPropertiesForAllInstances)
 
         for (const auto& prop : properties)
             expected_keys.push_back(make_key(name, prop));
+        for (const auto& prop : placement_properties)
+            expected_keys.push_back(make_key(name, prop));
+        for (const auto& prop : disk_option_properties)
+            expected_keys.push_back(make_key(name, prop));
+        for (const auto& prop : network_option_properties)
+            expected_keys.push_back(make_key(name, prop));
+        for (const auto& prop : resource_limit_properties)
+            expected_keys.push_back(make_key(name, prop));
     }
 
     EXPECT_THAT(make_handler().keys(), UnorderedElementsAreArray(expected_keys));
@@ -268,6 +283,21 @@ there) */
     EXPECT_EQ(vms, vms_copy);
 }
 
+TEST_F(TestInstanceSettingsHandler, getFetchesInstancePlacement)
+{
+    constexpr auto target_instance_name = "lola";
+    auto& placement = specs[target_instance_name].placement;
+    placement.hugepages = true;
+    placement.numa_node = 1;
+    placement.vcpu_cpus = {2, 3, 8};
+
+    auto handler = make_handler();
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "hugepages")), "true");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "numa-node")), "1");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "cpu-pinning")), "2,3,8");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "io-pinning")), "");
+}
+
 TEST_F(TestInstanceSettingsHandler, getThrowsOnWrongProperty)
 {
     constexpr auto target_instance_name = "asdf";
@@ -410,6 +440,152 @@ TEST_F(TestInstanceSettingsHandler, setResusesToShrinkInstanceDisk)
     EXPECT_EQ(actual_disk, original_disk);
 }
 
+TEST_F(TestInstanceSettingsHandler, setPinsInstanceCPUs)
+{
+    constexpr auto target_instance_name = "rosa";
+    const auto& actual_placement = specs[target_instance_name].placement;
+
+    auto expected_placement = mp::VMPlacement{};
+    expected_placement.vcpu_cpus = {2, 3, 4, 5, 8};
+    EXPECT_CALL(mock_vm(target_instance_name), update_placement(Eq(expected_placement))).Times(1);
+
+    make_handler().set(make_key(target_instance_name, "cpu-pinning"), "2-5,8");
+    EXPECT_EQ(actual_placement, expected_placement);
+}
+
+TEST_F(TestInstanceSettingsHandler, setBindsInstancesToNUMANodesAndHugepages)
+{
+    constexpr auto target_instance_name = "lily";
+    const auto& actual_placement = specs[target_instance_name].placement;
+    mock_vm(target_instance_name);
+
+    auto handler = make_handler();
+    handler.set(make_key(target_instance_name, "numa-node"), "1");
+    handler.set(make_key(target_instance_name, "hugepages"), "True");
+
+    EXPECT_EQ(actual_placement.numa_node, 1);
+    EXPECT_TRUE(actual_placement.hugepages);
+
+    handler.set(make_key(target_instance_name, "numa-node"), "");
+    EXPECT_FALSE(actual_placement.numa_node);
+}
+
+TEST_F(TestInstanceSettingsHandler, setMaintainsInstancePlacementUntouchedIfSameButSucceeds)
+{
+    constexpr auto target_instance_name = "iris";
+    specs[target_instance_name].placement.io_cpus = {0, 1};
+
+    EXPECT_CALL(mock_vm(target_instance_name), update_placement).Times(0);
+
+    EXPECT_NO_THROW(make_handler().set(make_key(target_instance_name, "io-pinning"), "0-1"));
+}
+
+TEST_F(TestInstanceSettingsHandler, getFetchesInstanceDiskOptions)
+{
+    constexpr auto target_instance_name = "tulip";
+    specs[target_instance_name];
+
+    auto handler = make_handler();
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "disk-cache")), "writeback");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "disk-aio")), "threads");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "disk-iothread")), "false");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "disk-queues")), "1");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "disk-detect-zeroes")), "false");
+}
+
+TEST_F(TestInstanceSettingsHandler, setTunesInstanceDisk)
+{
+    constexpr auto target_instance_name = "poppy";
+    const auto& actual_options = specs[target_instance_name].disk_options;
+    EXPECT_CALL(mock_vm(target_instance_name), update_disk_options).Times(4);
+
+    auto handler = make_handler();
+    handler.set(make_key(target_instance_name, "disk-cache"), "none");
+    handler.set(make_key(target_instance_name, "disk-aio"), "native");
+    handler.set(make_key(target_instance_name, "disk-iothread"), "true");
+    handler.set(make_key(target_instance_name, "disk-queues"), "4");
+
+    EXPECT_EQ(actual_options, (mp::VMDiskOptions{"none", "native", true, 4, false}));
+}
+
+TEST_F(TestInstanceSettingsHandler, setRefusesNativeAIOWithDiskCache)
+{
+    constexpr auto target_instance_name = "aster";
+    const auto original_specs = specs[target_instance_name];
+    EXPECT_CALL(mock_vm(target_instance_name), update_disk_options).Times(0);
+
+    MP_EXPECT_THROW_THAT(make_handler().set(make_key(target_instance_name, "disk-aio"), "native"),
+                         mp::InvalidSettingException, mpt::match_what(HasSubstr("cache")));
+    EXPECT_EQ(original_specs, specs[target_instance_name]);
+}
+
+TEST_F(TestInstanceSettingsHandler, setTunesInstanceNetwork)
+{
+    constexpr auto target_instance_name = "violet";
+    const auto& actual_options = specs[target_instance_name].network_options;
+    EXPECT_CALL(mock_vm(target_instance_name), update_network_options).Times(3);
+
+    auto handler = make_handler();
+    handler.set(make_key(target_instance_name, "net-vhost"), "true");
+    handler.set(make_key(target_instance_name, "net-queues"), "auto");
+    handler.set(make_key(target_instance_name, "net-ring-size"), "1024");
+
+    EXPECT_EQ(actual_options, (mp::VMNetworkOptions{true, 0, 1024}));
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "net-queues")), "auto");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "net-ring-size")), "1024");
+}
+
+TEST_F(TestInstanceSettingsHandler, setLimitsRunningInstances)
+{
+    constexpr auto target_instance_name = "lilac";
+    const auto& actual_limits = specs[target_instance_name].resource_limits;
+
+    auto& target_instance = mock_vm(target_instance_name);
+    EXPECT_CALL(target_instance, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(target_instance, update_resource_limits).Times(4);
+
+    auto handler = make_handler();
+    handler.set(make_key(target_instance_name, "cpu-weight"), "50");
+    handler.set(make_key(target_instance_name, "io-weight"), "200");
+    handler.set(make_key(target_instance_name, "memory-high"), "2G");
+    handler.set(make_key(target_instance_name, "cpu-max"), "150");
+
+    EXPECT_EQ(actual_limits, (mp::VMResourceLimits{50, 200, 2LL << 30, 150}));
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "memory-high")), "2.0GiB");
+    EXPECT_EQ(handler.get(make_key(target_instance_name, "cpu-max")), "150");
+}
+
+struct TestInstanceSettingsHandlerBadTuning : public TestInstanceSettingsHandler,
+                                              public WithParamInterface<std::tuple<const char*, const char*>>
+{
+};
+
+TEST_P(TestInstanceSettingsHandlerBadTuning, setRefusesBadTuning)
+{
+    constexpr auto target_instance_name = "daisy";
+    const auto& [property, bad_val] = GetParam();
+
+    const auto original_specs = specs[target_instance_name];
+    EXPECT_CALL(mock_vm(target_instance_name), update_placement).Times(0);
+
+    MP_EXPECT_THROW_THAT(make_handler().set(make_key(target_instance_name, property), bad_val),
+                         mp::InvalidSettingException, mpt::match_what(HasSubstr(bad_val)));
+
+    EXPECT_EQ(original_specs, specs[target_instance_name]);
+}
+
+INSTANTIATE_TEST_SUITE_P(TestInstanceSettingsHandler, TestInstanceSettingsHandlerBadTuning,
+                         Values(std::tuple{"hugepages", "maybe"}, std::tuple{"numa-node", "-1"},
+                                std::tuple{"numa-node", "one"}, std::tuple{"cpu-pinning", "5-2"},
+                                std::tuple{"cpu-pinning", "1-2-3"}, std::tuple{"io-pinning", "a,b"},
+                                std::tuple{"io-pinning", "-3"}, std::tuple{"disk-cache", "unsafe"},
+                                std::tuple{"disk-aio", "posix"}, std::tuple{"disk-iothread", "2"},
+                                std::tuple{"disk-queues", "0"}, std::tuple{"disk-detect-zeroes", "unmap"},
+                                std::tuple{"net-vhost", "on"}, std::tuple{"net-queues", "0"},
+                                std::tuple{"net-ring-size", "300"}, std::tuple{"net-ring-size", "2048"},
+                                std::tuple{"cpu-weight", "0"}, std::tuple{"io-weight", "10001"},
+                                std::tuple{"memory-high", "lots"}, std::tuple{"cpu-max", "-5"}));
+
 TEST_F(TestInstanceSettingsHandler, setRefusesWrongProperty)
 {
     constexpr auto target_instance_name = "desmond";
@@ -441,6 +617,7 @@ TEST_P(TestInstanceModOnNonStoppedInstance, setRefusesToModifyNonStoppedInstance
 
     auto& target_instance = mock_vm<StrictMock>(target_instance_name);
     EXPECT_CALL(target_instance, current_state).WillOnce(Return(state));
+    EXPECT_CALL(target_instance, resizes_while_running).Times(AnyNumber()).WillRepeatedly(Return(false));
 
     MP_EXPECT_THROW_THAT(make_handler().set(make_key(target_instance_name, property), "123"),
                          mp::InstanceSettingsException,
@@ -454,6 +631,60 @@ INSTANTIATE_TEST_SUITE_P(TestInstanceSettingsHandler, TestInstanceModOnNonStoppe
                                  Values(VMSt::running, VMSt::restarting, VMSt::starting, VMSt::delayed_shutdown,
                                         VMSt::suspended, VMSt::suspending, VMSt::unknown)));
 
+TEST_F(TestInstanceSettingsHandler, setResizesRunningInstancesThatAllowIt)
+{
+    constexpr auto target_instance_name = "Scarlatti";
+    auto& actual_specs = specs[target_instance_name];
+    actual_specs.num_cores = 2;
+    actual_specs.mem_size = mp::MemorySize{"1G"};
+    actual_specs.disk_space = mp::MemorySize{"5G"};
+
+    auto& target_instance = mock_vm(target_instance_name);
+    EXPECT_CALL(target_instance, current_state).WillRepeatedly(Return(VMSt::running));
+    EXPECT_CALL(target_instance, resizes_while_running).WillRepeatedly(Return(true));
+    EXPECT_CALL(target_instance, update_cpus(4)).Times(1);
+    EXPECT_CALL(target_instance, resize_memory(Eq(mp::MemorySize{"2G"}))).Times(1);
+    EXPECT_CALL(target_instance, resize_disk(Eq(mp::MemorySize{"10G"}))).Times(1);
+
+    auto handler = make_handler();
+    handler.set(make_key(target_instance_name, "cpus"), "4");
+    handler.set(make_key(target_instance_name, "memory"), "2G");
+    handler.set(make_key(target_instance_name, "disk"), "10G");
+
+    EXPECT_EQ(actual_specs.num_cores, 4);
+    EXPECT_EQ(actual_specs.mem_size, mp::MemorySize{"2G"});
+    EXPECT_EQ(actual_specs.disk_space, mp::MemorySize{"10G"});
+}
+
+TEST_F(TestInstanceSettingsHandler, setKeepsSpecsOfRunningInstancesThatFailToResize)
+{
+    constexpr auto target_instance_name = "Satie";
+    const auto& actual_cpus = specs[target_instance_name].num_cores = 2;
+
+    auto& target_instance = mock_vm(target_instance_name);
+    EXPECT_CALL(target_instance, current_state).WillRepeatedly(Return(VMSt::running));
+    EXPECT_CALL(target_instance, resizes_while_running).WillRepeatedly(Return(true));
+    EXPECT_CALL(target_instance, update_cpus).WillOnce(Throw(std::runtime_error{"no free CPU slots"}));
+
+    MP_EXPECT_THROW_THAT(make_handler().set(make_key(target_instance_name, "cpus"), "8"), std::runtime_error,
+                         mpt::match_what(HasSubstr("no free CPU slots")));
+    EXPECT_EQ(actual_cpus, 2);
+}
+
+TEST_F(TestInstanceSettingsHandler, setRefusesOtherChangesToRunningInstancesThatResize)
+{
+    constexpr auto target_instance_name = "Sibelius";
+    const auto original_specs = specs[target_instance_name];
+
+    auto& target_instance = mock_vm(target_instance_name);
+    EXPECT_CALL(target_instance, current_state).WillRepeatedly(Return(VMSt::running));
+    EXPECT_CALL(target_instance, resizes_while_running).WillRepeatedly(Return(true));
+
+    MP_EXPECT_THROW_THAT(make_handler().set(make_key(target_instance_name, "hugepages"), "true"),
+                         mp::InstanceSettingsException, mpt::match_what(HasSubstr("Instance must be stopped")));
+    EXPECT_EQ(original_specs, specs[target_instance_name]);
+}
+
 struct TestInstanceModOnStoppedInstance : public TestInstanceSettingsHandler,
                                           public WithParamInterface<PropertyAndState>
 {
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/launch_timings.h>
+
+#include <multipass/performance_counters.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+TEST(LaunchTimings, keeps_the_phases_of_each_instance_in_order)
+{
+    mp::LaunchTimings timings;
+    timings.record("asdf", "image_fetch", 3s);
+    timings.record("qwer", "image_fetch", 1s);
+    timings.record("asdf", "start", 2s);
+
+    EXPECT_THAT(timings.take("asdf"), ElementsAre(Pair("image_fetch", Eq(3s)), Pair("start", Eq(2s))));
+    EXPECT_THAT(timings.take("qwer"), ElementsAre(Pair("image_fetch", Eq(1s))));
+}
+
+TEST(LaunchTimings, forgets_the_phases_it_hands_over)
+{
+    mp::LaunchTimings timings;
+    timings.record("asdf", "start", 2s);
+
+    EXPECT_THAT(timings.take("asdf"), SizeIs(1));
+    EXPECT_THAT(timings.take("asdf"), IsEmpty());
+}
+
+TEST(LaunchTimings, times_a_phase_for_the_rest_of_its_scope)
+{
+    mp::LaunchTimings timings;
+    {
+        mp::LaunchTimings::Phase phase{timings, "asdf", "ssh_up"};
+        EXPECT_THAT(timings.take("asdf"), IsEmpty());
+    }
+
+    const auto phases = timings.take("asdf");
+    ASSERT_THAT(phases, SizeIs(1));
+    EXPECT_EQ(phases.front().first, "ssh_up");
+    EXPECT_GE(phases.front().second.count(), 0);
+}
+
+TEST(LaunchTimings, feeds_the_performance_counters)
+{
+    mp::LaunchTimings timings;
+    timings.record("asdf", "cloud_init", 2s);
+
+    EXPECT_THAT(MP_PERF_COUNTERS.openmetrics(),
+                HasSubstr("multipass_launch_phase_seconds_count{phase=\"cloud_init\"}"));
+}
+} // namespace
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/mac_addresses.h>
+
+#include <regex>
+#include <unordered_set>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+struct MacAddresses : public Test
+{
+    mp::MacAddresses macs;
+};
+
+TEST_F(MacAddresses, claims_addresses_not_in_use)
+{
+    EXPECT_FALSE(macs.claim({"52:54:00:73:76:28", "01:23:45:67:89:ab"}));
+
+    EXPECT_TRUE(macs.in_use("52:54:00:73:76:28"));
+    EXPECT_TRUE(macs.in_use("01:23:45:67:89:ab"));
+    EXPECT_EQ(macs.size(), 2u);
+}
+
+TEST_F(MacAddresses, claims_none_when_one_is_taken)
+{
+    macs.claim({"52:54:00:73:76:28"});
+
+    EXPECT_THAT(macs.claim({"01:23:45:67:89:ab", "52:54:00:73:76:28"}), Optional(Eq("52:54:00:73:76:28")));
+    EXPECT_FALSE(macs.in_use("01:23:45:67:89:ab"));
+}
+
+TEST_F(MacAddresses, claims_none_when_one_is_repeated_or_invalid)
+{
+    EXPECT_THAT(macs.claim({"52:54:00:73:76:28", "52:54:00:73:76:28"}), Optional(Eq("52:54:00:73:76:28")));
+    EXPECT_THAT(macs.claim({"52:54:00:73:76:28", "52:54:00:73:76"}), Optional(Eq("52:54:00:73:76")));
+    EXPECT_EQ(macs.size(), 0u);
+}
+
+TEST_F(MacAddresses, compares_addresses_regardless_of_case)
+{
+    macs.claim({"52:54:00:bd:19:41"});
+
+    EXPECT_TRUE(macs.in_use("52:54:00:BD:19:41"));
+    EXPECT_TRUE(macs.claim({"52:54:00:BD:19:41"}));
+}
+
+TEST_F(MacAddresses, releases_addresses)
+{
+    macs.claim({"52:54:00:73:76:28", "52:54:00:bd:19:41"});
+    macs.release({"52:54:00:73:76:28"});
+
+    EXPECT_FALSE(macs.in_use("52:54:00:73:76:28"));
+    EXPECT_TRUE(macs.in_use("52:54:00:bd:19:41"));
+    EXPECT_FALSE(macs.claim({"52:54:00:73:76:28"}));
+}
+
+TEST_F(MacAddresses, generates_unused_addresses_in_qemu_range)
+{
+    const std::regex qemu_range{"52:54:00(:[0-9a-f]{2}){3}"};
+
+    std::unordered_set<std::string> generated;
+    for (auto i = 0; i < 1000; ++i)
+    {
+        auto mac = macs.claim_new();
+        EXPECT_TRUE(std::regex_match(mac, qemu_range)) << mac;
+        EXPECT_TRUE(generated.insert(mac).second) << mac;
+        EXPECT_TRUE(macs.in_use(mac));
+    }
+
+    EXPECT_EQ(macs.size(), 1000u);
+}
+
+TEST_F(MacAddresses, reads_addresses_as_numbers)
+{
+    EXPECT_THAT(mp::MacAddresses::to_number("52:54:00:bd:19:41"), Optional(Eq(0x525400bd1941ull)));
+    EXPECT_THAT(mp::MacAddresses::to_number("FF:ff:00:00:00:01"), Optional(Eq(0xffff00000001ull)));
+    EXPECT_FALSE(mp::MacAddresses::to_number("52-54-00-bd-19-41"));
+    EXPECT_FALSE(mp::MacAddresses::to_number("52:54:00:bd:19:4g"));
+    EXPECT_FALSE(mp::MacAddresses::to_number(""));
+}
+} // namespace
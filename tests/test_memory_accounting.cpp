@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/memory_accounting.h>
+#include <multipass/vm_image_info.h>
+
+#include <QJsonArray>
+
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct MemoryAccounting : public Test
+{
+    mpt::TempDir temp_dir;
+    QString statm_file{QDir{temp_dir.path()}.filePath("statm")};
+};
+
+TEST_F(MemoryAccounting, reads_the_resident_set)
+{
+    mpt::make_file_with_content(statm_file, "10000 2500 300 40 0 900 0\n");
+
+    const auto memory = mpu::process_memory(statm_file);
+    ASSERT_TRUE(memory);
+    EXPECT_EQ(memory->resident_pages, 2500);
+    EXPECT_EQ(memory->resident_bytes(), 2500 * memory->page_size);
+}
+
+TEST_F(MemoryAccounting, tells_nothing_without_figures)
+{
+    EXPECT_FALSE(mpu::process_memory(statm_file));
+
+    mpt::make_file_with_content(statm_file, "10000\n");
+    EXPECT_FALSE(mpu::process_memory(statm_file));
+}
+
+TEST_F(MemoryAccounting, counts_the_contents_of_image_info)
+{
+    multipass::VMImageInfo info{{"jammy"}, "Ubuntu", "22.04", "22.04 LTS", true, "", "", "", "", "", "", 0, false};
+    const auto size = mpu::estimated_size(info);
+    EXPECT_GT(size, sizeof(info));
+
+    info.aliases << "lts" << "22.04";
+    info.image_location = QString(1000, 'x');
+    EXPECT_GE(mpu::estimated_size(info), size + 1000 * sizeof(QChar));
+}
+
+TEST_F(MemoryAccounting, counts_nested_json)
+{
+    const QJsonObject flat{{"key", "value"}};
+    const QJsonObject nested{{"key", "value"}, {"more", QJsonArray{flat, QString(1000, 'x')}}};
+
+    EXPECT_GT(mpu::estimated_size(nested), mpu::estimated_size(flat) + 1000 * sizeof(QChar));
+}
+
+TEST_F(MemoryAccounting, summarizes_on_a_single_line)
+{
+    const mpu::MemoryAccount account{mpu::ProcessMemory{512, 4096}, {{"manifests", 3 * 1024 * 1024}, {"specs", 0}}};
+
+    EXPECT_EQ(account.summary(), "resident 2.0MiB, manifests ~3.0MiB, specs ~0.0MiB");
+    EXPECT_EQ(mpu::MemoryAccount{}.summary(), "resident unknown");
+}
+} // namespace
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/memory_merging.h>
+
+#include <QFile>
+
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct MemoryMerging : public Test
+{
+    void make_ksm_file(const QString& name, const std::string& content)
+    {
+        mpt::make_file_with_content(dir.filePath(name), content);
+    }
+
+    std::string ksm_file(const QString& name)
+    {
+        QFile file{dir.filePath(name)};
+        EXPECT_TRUE(file.open(QIODevice::ReadOnly));
+        return file.readAll().trimmed().toStdString();
+    }
+
+    mpt::TempDir temp_dir;
+    QDir dir{temp_dir.path()};
+};
+
+TEST_F(MemoryMerging, starts_and_speeds_up_the_scanner)
+{
+    for (const auto& name : {"run", "pages_to_scan", "sleep_millisecs"})
+        make_ksm_file(name, "0\n");
+
+    EXPECT_TRUE(mpu::enable_memory_merging(dir));
+
+    EXPECT_EQ(ksm_file("run"), "1");
+    EXPECT_EQ(ksm_file("pages_to_scan"), "1000");
+    EXPECT_EQ(ksm_file("sleep_millisecs"), "20");
+}
+
+TEST_F(MemoryMerging, does_nothing_on_hosts_without_it)
+{
+    EXPECT_FALSE(mpu::enable_memory_merging(dir));
+    EXPECT_FALSE(mpu::memory_merging_stats(dir));
+    EXPECT_THAT(dir.entryList(QDir::Files), IsEmpty());
+}
+
+TEST_F(MemoryMerging, reports_what_it_saves)
+{
+    make_ksm_file("run", "1\n");
+    make_ksm_file("pages_shared", "10\n");
+    make_ksm_file("pages_sharing", "250\n");
+    make_ksm_file("pages_unshared", "3000\n");
+
+    const auto stats = mpu::memory_merging_stats(dir);
+    ASSERT_TRUE(stats);
+
+    EXPECT_TRUE(stats->running);
+    EXPECT_EQ(stats->pages_shared, 10);
+    EXPECT_EQ(stats->pages_unshared, 3000);
+    EXPECT_EQ(stats->saved_bytes(), 250 * stats->page_size);
+}
+} // namespace
@@ -110,7 +110,13 @@ TEST_P(TestBadMemorySizeFormats, rejectsBadFormats)
 INSTANTIATE_TEST_SUITE_P(MemorySize, TestGoodMemorySizeFormats, ValuesIn(TestGoodMemorySizeFormats::generate_args()));
 INSTANTIATE_TEST_SUITE_P(MemorySize, TestBadMemorySizeFormats,
                          Values("321BB", "321BK", "1024MM", "1024KM", "1024GK", "K", "", "123.321K", "123.321", "6868i",
-                                "555iB", "486ki", "54Mi", "8i33", "4M2", "-2345", "-5MiB", "K", "4GM"));
+                                "555iB", "486ki", "54Mi", "8i33", "4M2", "-2345", "-5MiB", "K", "4GM",
+                                "99999999999999999999", "9999999999G"));
+
+TEST(MemorySize, constructsFromBytes)
+{
+    EXPECT_EQ(mp::MemorySize::from_bytes(2049LL), mp::MemorySize{"2049"});
+}
 
 TEST(MemorySize, defaultConstructsToZero)
 {
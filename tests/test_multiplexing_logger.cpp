@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "stub_logger.h"
+
+#include <multipass/logging/multiplexing_logger.h>
+
+#include <string>
+#include <vector>
+
+namespace mpl = multipass::logging;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct RecordingLogger : public mpl::Logger
+{
+    RecordingLogger() : Logger{mpl::Level::trace}
+    {
+    }
+
+    void log(mpl::Level, mpl::CString category, mpl::CString) const override
+    {
+        categories.push_back(category.c_str());
+    }
+
+    mutable std::vector<std::string> categories;
+};
+
+struct MultiplexingLogger : public Test
+{
+    mpl::MultiplexingLogger mpx{std::make_unique<mpt::StubLogger>()};
+    RecordingLogger everything, foo, bar;
+};
+
+TEST_F(MultiplexingLogger, sends_lines_about_an_instance_to_its_loggers_alone)
+{
+    mpx.add_logger(&everything);
+    mpx.add_logger(&foo, {"foo"});
+    mpx.add_logger(&bar, {"bar"});
+
+    mpx.log(mpl::Level::info, "foo", "booting");
+
+    EXPECT_THAT(everything.categories, ElementsAre("foo"));
+    EXPECT_THAT(foo.categories, ElementsAre("foo"));
+    EXPECT_THAT(bar.categories, IsEmpty());
+}
+
+TEST_F(MultiplexingLogger, sends_lines_that_nobody_asked_for_to_everyone)
+{
+    mpx.add_logger(&everything);
+    mpx.add_logger(&foo, {"foo"});
+
+    mpx.log(mpl::Level::info, "daemon", "starting");
+    mpx.log(mpl::Level::info, "baz", "booting");
+
+    EXPECT_THAT(everything.categories, ElementsAre("daemon", "baz"));
+    EXPECT_THAT(foo.categories, ElementsAre("daemon", "baz"));
+}
+
+TEST_F(MultiplexingLogger, stops_sending_to_removed_loggers)
+{
+    mpx.add_logger(&foo, {"foo"});
+    mpx.add_logger(&bar, {"foo", "bar"});
+    mpx.remove_logger(&bar);
+
+    mpx.log(mpl::Level::info, "foo", "booting");
+    mpx.log(mpl::Level::info, "bar", "booting");
+
+    EXPECT_THAT(foo.categories, ElementsAre("foo", "bar"));
+    EXPECT_THAT(bar.categories, IsEmpty());
+}
+} // namespace
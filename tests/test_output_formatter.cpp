@@ -408,6 +408,7 @@ auto print_petenv_param_name(const testing::TestParamInfo<PetenvFormatterSuite::
 
 const mp::TableFormatter table_formatter;
 const mp::JsonFormatter json_formatter;
+const mp::JsonFormatter ndjson_formatter{mp::JsonFormatter::Layout::lines};
 const mp::CSVFormatter csv_formatter;
 const mp::YamlFormatter yaml_formatter;
 
@@ -697,6 +698,11 @@ const std::vector<FormatterParamType> non_orderable_list_info_formatter_outputs{
      "    ]\n"
      "}\n",
      "json_list_multiple"},
+    {&ndjson_formatter, &empty_list_reply, "", "ndjson_list_empty"},
+    {&ndjson_formatter, &multiple_instances_list_reply,
+     "{\"ipv4\":[\"10.21.124.56\"],\"name\":\"bogus-instance\",\"release\":\"16.04 LTS\",\"state\":\"Running\"}\n"
+     "{\"ipv4\":[],\"name\":\"bombastic\",\"release\":\"18.04 LTS\",\"state\":\"Stopped\"}\n",
+     "ndjson_list_multiple"},
     {&json_formatter, &empty_info_reply,
      "{\n"
      "    \"errors\": [\n"
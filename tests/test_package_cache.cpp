@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "temp_dir.h"
+
+#include <src/daemon/package_cache.h>
+
+#include <multipass/url_downloader.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct TestPackageCache : public mp::PackageCache
+{
+    using PackageCache::PackageCache;
+    using PackageCache::source_of;
+};
+
+struct PackageCache : public Test
+{
+    mpt::TempDir cache_dir;
+    mp::URLDownloader downloader{std::chrono::seconds{10}};
+    TestPackageCache cache{&downloader, cache_dir.path(), std::chrono::seconds{60}, 1024 * 1024 * 1024};
+};
+
+TEST_F(PackageCache, keeps_packages_for_good)
+{
+    const auto source = cache.source_of("http://archive.ubuntu.com/ubuntu/pool/main/s/sshfs/sshfs_3.7.1-1_amd64.deb");
+
+    ASSERT_TRUE(source);
+    EXPECT_EQ(source->url, QUrl{"http://archive.ubuntu.com/ubuntu/pool/main/s/sshfs/sshfs_3.7.1-1_amd64.deb"});
+    EXPECT_EQ(source->path, "archive.ubuntu.com/ubuntu/pool/main/s/sshfs/sshfs_3.7.1-1_amd64.deb");
+    EXPECT_FALSE(source->changes);
+}
+
+TEST_F(PackageCache, keeps_indexes_fetched_by_hash_for_good)
+{
+    const auto source =
+        cache.source_of("http://us.archive.ubuntu.com/ubuntu/dists/jammy/main/binary-amd64/by-hash/SHA256/abcd");
+
+    ASSERT_TRUE(source);
+    EXPECT_FALSE(source->changes);
+}
+
+TEST_F(PackageCache, refreshes_other_indexes)
+{
+    const auto source = cache.source_of("http://security.ubuntu.com/ubuntu/dists/jammy-security/InRelease");
+
+    ASSERT_TRUE(source);
+    EXPECT_TRUE(source->changes);
+}
+
+TEST_F(PackageCache, proxies_nothing_but_the_archive)
+{
+    EXPECT_FALSE(cache.source_of("http://example.com/ubuntu/pool/main/foo.deb"));
+    EXPECT_FALSE(cache.source_of("http://archive.ubuntu.com.example.com/ubuntu/pool/main/foo.deb"));
+    EXPECT_FALSE(cache.source_of("https://archive.ubuntu.com/ubuntu/pool/main/foo.deb"));
+    EXPECT_FALSE(cache.source_of("/ubuntu/pool/main/foo.deb"));
+}
+} // namespace
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/performance_counters.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+// The counters are process-wide, so each test sticks to families of its own
+TEST(PerformanceCounters, countsWithTheTotalSuffix)
+{
+    MP_PERF_COUNTERS.counter("test_counted_things", {{"kind", "a"}}) += 3;
+    ++MP_PERF_COUNTERS.counter("test_counted_things", {{"kind", "a"}});
+    ++MP_PERF_COUNTERS.counter("test_counted_things", {{"kind", "b"}});
+
+    const auto text = MP_PERF_COUNTERS.openmetrics();
+    EXPECT_THAT(text, HasSubstr("# TYPE test_counted_things counter\n"));
+    EXPECT_THAT(text, HasSubstr("test_counted_things_total{kind=\"a\"} 4\n"));
+    EXPECT_THAT(text, HasSubstr("test_counted_things_total{kind=\"b\"} 1\n"));
+}
+
+TEST(PerformanceCounters, rendersCumulativeBuckets)
+{
+    MP_PERF_COUNTERS.observe("test_latency_seconds", {}, 2ms);
+    MP_PERF_COUNTERS.observe("test_latency_seconds", {}, 200ms);
+    MP_PERF_COUNTERS.observe("test_latency_seconds", {}, 1h);
+
+    const auto text = MP_PERF_COUNTERS.openmetrics();
+    EXPECT_THAT(text, HasSubstr("# TYPE test_latency_seconds histogram\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_bucket{le=\"0.001\"} 0\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_bucket{le=\"0.005\"} 1\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_bucket{le=\"0.5\"} 2\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_bucket{le=\"300\"} 2\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_bucket{le=\"+Inf\"} 3\n"));
+    EXPECT_THAT(text, HasSubstr("test_latency_seconds_count 3\n"));
+}
+
+TEST(PerformanceCounters, keepsTheLastValueOfGauges)
+{
+    MP_PERF_COUNTERS.set("test_queue_length", {{"queue", "q"}}, 5);
+    MP_PERF_COUNTERS.set("test_queue_length", {{"queue", "q"}}, 2);
+
+    const auto text = MP_PERF_COUNTERS.openmetrics();
+    EXPECT_THAT(text, HasSubstr("# TYPE test_queue_length gauge\ntest_queue_length{queue=\"q\"} 2\n"));
+}
+
+TEST(PerformanceCounters, escapesLabelValues)
+{
+    ++MP_PERF_COUNTERS.counter("test_escaped", {{"path", "a\"b\\c\nd"}});
+
+    EXPECT_THAT(MP_PERF_COUNTERS.openmetrics(), HasSubstr("test_escaped_total{path=\"a\\\"b\\\\c\\nd\"} 1\n"));
+}
+
+TEST(PerformanceCounters, endsWithEof)
+{
+    EXPECT_THAT(MP_PERF_COUNTERS.openmetrics(), EndsWith("# EOF\n"));
+}
+} // namespace
@@ -234,6 +234,40 @@ TEST_F(TestPersistentSettingsHandler, getReturnsDefaultByDefault)
     ASSERT_EQ(handler.get(key), QString(default_));
 }
 
+TEST_F(TestPersistentSettingsHandler, getReadsUnchangedFileOnce)
+{
+    const auto key = "cached.key", val = "cached value";
+    const auto handler = make_handler(key);
+
+    EXPECT_CALL(*mock_qsettings, value_impl(Eq(key), _)).WillOnce(Return(val));
+
+    inject_mock_qsettings(); // only once, strict about any other
+
+    EXPECT_EQ(handler.get(key), QString{val});
+    EXPECT_EQ(handler.get(key), QString{val});
+}
+
+TEST_F(TestPersistentSettingsHandler, setMakesGetReadAgain)
+{
+    const auto key = "a.key", old_val = "old", new_val = "new";
+    auto handler = make_handler();
+
+    auto reader = std::make_unique<NiceMock<mpt::MockQSettings>>();
+    auto writer = std::make_unique<NiceMock<mpt::MockQSettings>>();
+    auto rereader = std::make_unique<NiceMock<mpt::MockQSettings>>();
+    EXPECT_CALL(*reader, value_impl(Eq(key), _)).WillOnce(Return(old_val));
+    EXPECT_CALL(*rereader, value_impl(Eq(key), _)).WillOnce(Return(new_val));
+
+    EXPECT_CALL(*mock_qsettings_provider, make_wrapped_qsettings(Eq(fake_filename), _))
+        .WillOnce(Return(ByMove(std::move(reader))))
+        .WillOnce(Return(ByMove(std::move(writer))))
+        .WillOnce(Return(ByMove(std::move(rereader))));
+
+    EXPECT_EQ(handler.get(key), QString{old_val});
+    handler.set(key, new_val);
+    EXPECT_EQ(handler.get(key), QString{new_val});
+}
+
 TEST_F(TestPersistentSettingsHandler, getThrowsOnUnknownKey)
 {
     const auto key = "clef";
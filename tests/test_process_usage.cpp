@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/process_usage.h>
+
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct ProcessUsage : public Test
+{
+    void make_proc_file(const QString& name, const std::string& content)
+    {
+        QDir{temp_dir.path()}.mkpath("1234");
+        mpt::make_file_with_content(QDir{temp_dir.path()}.filePath("1234/" + name), content);
+    }
+
+    mpt::TempDir temp_dir;
+    QDir dir{temp_dir.path()};
+};
+
+TEST_F(ProcessUsage, reads_cpu_time_and_resident_memory)
+{
+    make_proc_file("stat", "1234 (qemu-system-x86) S 1 1234 1234 0 -1 4194560 93 0 0 0 200 100 0 0 20 0 5 0 17 0 0\n");
+    make_proc_file("statm", "1000 250 30 1 0 400 0\n");
+
+    const auto usage = mpu::process_usage(1234, dir);
+    ASSERT_TRUE(usage);
+
+    EXPECT_EQ(usage->cpu_ticks, 300);
+    EXPECT_EQ(usage->resident_pages, 250);
+    EXPECT_EQ(usage->cpu_time_ms(), 300 * 1000 / usage->ticks_per_second);
+    EXPECT_EQ(usage->resident_bytes(), 250 * usage->page_size);
+}
+
+TEST_F(ProcessUsage, reads_past_parentheses_in_the_command_name)
+{
+    make_proc_file("stat", "1234 (qemu (x) y) S 1 1234 1234 0 -1 4194560 93 0 0 0 7 5 0 0 20 0 5 0 17 0 0\n");
+    make_proc_file("statm", "1000 250 30 1 0 400 0\n");
+
+    const auto usage = mpu::process_usage(1234, dir);
+    ASSERT_TRUE(usage);
+    EXPECT_EQ(usage->cpu_ticks, 12);
+}
+
+TEST_F(ProcessUsage, is_empty_for_processes_that_are_gone)
+{
+    EXPECT_FALSE(mpu::process_usage(1234, dir));
+}
+
+TEST_F(ProcessUsage, is_empty_for_truncated_stat)
+{
+    make_proc_file("stat", "1234 (qemu-system-x86) S 1 1234\n");
+    make_proc_file("statm", "1000 250 30 1 0 400 0\n");
+
+    EXPECT_FALSE(mpu::process_usage(1234, dir));
+}
+} // namespace
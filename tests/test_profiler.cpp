@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "mock_process_factory.h"
+#include "temp_dir.h"
+
+#include <src/daemon/profiler.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct Profiler : public Test
+{
+    mpt::TempDir profiles_dir;
+    std::unique_ptr<mpt::MockProcessFactory::Scope> factory_scope = mpt::MockProcessFactory::Inject();
+};
+
+TEST_F(Profiler, has_perf_sample_the_daemon_for_the_duration)
+{
+    mp::Profiler profiler{profiles_dir.path()};
+    const auto capture_dir = profiler.capture(12s, "state");
+
+    const auto processes = factory_scope->process_list();
+    ASSERT_EQ(processes.size(), 1u);
+    EXPECT_EQ(processes[0].command, "perf");
+    EXPECT_THAT(processes[0].arguments,
+                AllOf(Contains(QString::number(QCoreApplication::applicationPid())),
+                      Contains(QDir{capture_dir}.filePath("cpu.perf.data")), Contains("sleep"), Contains("12")));
+}
+
+TEST_F(Profiler, writes_the_state_snapshot)
+{
+    mp::Profiler profiler{profiles_dir.path()};
+    const auto capture_dir = profiler.capture(1s, "executor \"workers\": 3 running");
+
+    EXPECT_TRUE(capture_dir.startsWith(profiles_dir.path()));
+    EXPECT_EQ(mpt::load(QDir{capture_dir}.filePath("state.txt")), "executor \"workers\": 3 running");
+}
+
+TEST_F(Profiler, runs_one_capture_at_a_time)
+{
+    mp::Profiler profiler{profiles_dir.path()};
+
+    EXPECT_FALSE(profiler.capture(1s, "").isEmpty());
+    EXPECT_TRUE(profiler.capture(1s, "").isEmpty());
+}
+
+TEST_F(Profiler, captures_again_once_perf_is_done)
+{
+    factory_scope->register_callback([](mpt::MockProcess* process) {
+        ON_CALL(*process, start()).WillByDefault([process] { emit process->finished({0, mp::nullopt}); });
+    });
+
+    mp::Profiler profiler{profiles_dir.path()};
+    const auto capture_dir = profiler.capture(1s, "");
+
+    EXPECT_FALSE(capture_dir.isEmpty());
+    EXPECT_FALSE(profiler.capture(1s, "").isEmpty());
+}
+} // namespace
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/progress_monitor.h>
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct CoalescedProgress : public Test
+{
+    std::vector<std::pair<int, int>> heard;
+    bool answer{true};
+    mp::ProgressMonitor monitor = [this](int type, int progress) {
+        heard.emplace_back(type, progress);
+        return answer;
+    };
+};
+
+TEST_F(CoalescedProgress, passes_on_the_start_and_end_of_each_type)
+{
+    auto coalesced = mp::coalesced(monitor, 1h);
+
+    for (auto type : {1, 2})
+        for (auto progress = 0; progress <= 100; ++progress)
+            coalesced(type, progress);
+
+    EXPECT_THAT(heard, ElementsAre(Pair(1, 0), Pair(1, 100), Pair(2, 0), Pair(2, 100)));
+}
+
+TEST_F(CoalescedProgress, passes_on_changes_once_the_interval_is_over)
+{
+    auto coalesced = mp::coalesced(monitor, 10ms);
+
+    coalesced(1, 5);
+    coalesced(1, 6);
+    std::this_thread::sleep_for(20ms);
+    coalesced(1, 6);
+    std::this_thread::sleep_for(20ms);
+    coalesced(1, 6);
+
+    EXPECT_THAT(heard, ElementsAre(Pair(1, 5), Pair(1, 6)));
+}
+
+TEST_F(CoalescedProgress, passes_on_unknown_progress_every_interval)
+{
+    auto coalesced = mp::coalesced(monitor, 10ms);
+
+    coalesced(1, -1);
+    coalesced(1, -1);
+    std::this_thread::sleep_for(20ms);
+    coalesced(1, -1);
+
+    EXPECT_THAT(heard, ElementsAre(Pair(1, -1), Pair(1, -1)));
+}
+
+TEST_F(CoalescedProgress, answers_what_the_monitor_last_did)
+{
+    auto coalesced = mp::coalesced(monitor, 1h);
+
+    answer = false;
+    EXPECT_FALSE(coalesced(1, 5));
+    EXPECT_FALSE(coalesced(1, 6));
+    EXPECT_THAT(heard, SizeIs(1));
+}
+
+TEST_F(CoalescedProgress, shares_what_was_passed_on_between_copies)
+{
+    auto coalesced = mp::coalesced(monitor, 1h);
+    auto copy = coalesced;
+
+    coalesced(1, 5);
+    copy(1, 6);
+
+    EXPECT_THAT(heard, ElementsAre(Pair(1, 5)));
+}
+
+TEST_F(CoalescedProgress, combines_sources_by_weight)
+{
+    const auto sources = mp::combined(monitor, 0, {8, 1, 1});
+
+    sources[0](0, 50);
+    sources[1](1, -1);
+    sources[1](1, 100);
+    sources[0](0, 100);
+    sources[2](2, 100);
+
+    EXPECT_THAT(heard, ElementsAre(Pair(0, 40), Pair(0, 50), Pair(0, 90), Pair(0, 100)));
+}
+
+TEST_F(CoalescedProgress, stops_all_combined_sources_once_one_is_aborted)
+{
+    const auto sources = mp::combined(monitor, 0, {1, 1});
+
+    answer = false;
+    EXPECT_FALSE(sources[0](0, 50));
+    EXPECT_FALSE(sources[1](1, 50));
+    EXPECT_THAT(heard, SizeIs(1));
+}
+} // namespace
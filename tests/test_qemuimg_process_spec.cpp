@@ -93,6 +93,21 @@ TEST(TestQemuImgProcessSpec, apparmor_profile_running_as_snap_with_target_correc
     EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1 rwk,").arg(target_image)));
 }
 
+TEST(TestQemuImgProcessSpec, apparmor_profile_lets_backing_images_be_read)
+{
+    const QByteArray snap_name{"multipass"};
+    QTemporaryDir snap_dir;
+    QString source_image{"/source/image/file"}, target_image{"/target/image/file"},
+        backing_image{"/backing/image/file"};
+
+    mpt::SetEnvScope e("SNAP", snap_dir.path().toUtf8());
+    mpt::SetEnvScope e2("SNAP_NAME", snap_name);
+    mp::QemuImgProcessSpec spec({}, source_image, target_image, {backing_image});
+
+    EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1 rk,").arg(backing_image)));
+    EXPECT_FALSE(spec.apparmor_profile().contains(QString("%1 rwk,").arg(backing_image)));
+}
+
 TEST(TestQemuImgProcessSpec, apparmor_profile_running_as_snap_with_only_target_correct)
 {
     const QByteArray snap_name{"multipass"};
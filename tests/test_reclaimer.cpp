@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/reclaimer.h>
+
+#include <QDir>
+
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct Reclaimer : public Test
+{
+    QStringList entries()
+    {
+        return QDir{temp_dir.path()}.entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+    }
+
+    mpt::TempDir temp_dir;
+    QDir dir{temp_dir.path()};
+};
+
+TEST_F(Reclaimer, frees_the_name_right_away_and_the_contents_eventually)
+{
+    const auto instance = dir.filePath("instance");
+    ASSERT_TRUE(dir.mkpath("instance/nested"));
+    mpt::make_file_with_content(dir.filePath("instance/nested/disk.img"));
+
+    mpu::reclaim_in_background(instance);
+    EXPECT_FALSE(QFileInfo::exists(instance));
+
+    ASSERT_TRUE(dir.mkdir("instance"));
+    mpu::wait_for_reclaimed();
+
+    EXPECT_THAT(entries(), ElementsAre("instance"));
+}
+
+TEST_F(Reclaimer, ignores_what_does_not_exist)
+{
+    mpu::reclaim_in_background(dir.filePath("missing"));
+    mpu::wait_for_reclaimed();
+
+    EXPECT_THAT(entries(), IsEmpty());
+}
+
+TEST_F(Reclaimer, picks_up_what_a_previous_run_left_behind)
+{
+    ASSERT_TRUE(dir.mkpath(".instance.reclaimed-1234-0/nested"));
+    ASSERT_TRUE(dir.mkdir("instance"));
+
+    mpu::reclaim_leftovers(dir);
+    mpu::wait_for_reclaimed();
+
+    EXPECT_THAT(entries(), ElementsAre("instance"));
+}
+} // namespace
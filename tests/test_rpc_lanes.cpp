@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/rpc_lanes.h>
+
+#include <future>
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+using Priority = mp::RpcLanes::Priority;
+
+TEST(RpcLanes, sorts_methods_into_classes)
+{
+    EXPECT_EQ(mp::RpcLanes::priority_of("launch"), Priority::bulk);
+    EXPECT_EQ(mp::RpcLanes::priority_of("find"), Priority::bulk);
+    EXPECT_EQ(mp::RpcLanes::priority_of("purge"), Priority::bulk);
+    EXPECT_EQ(mp::RpcLanes::priority_of("list"), Priority::interactive);
+    EXPECT_EQ(mp::RpcLanes::priority_of("sshinfo"), Priority::interactive);
+    EXPECT_EQ(mp::RpcLanes::priority_of("version"), Priority::interactive);
+}
+
+TEST(RpcLanes, leaves_watches_out)
+{
+    mp::RpcLanes lanes{1, 1};
+
+    EXPECT_FALSE(mp::RpcLanes::has_lane("watch"));
+    EXPECT_EQ(lanes.enter("watch"), nullptr);
+    EXPECT_EQ(lanes.running(Priority::interactive), 0);
+}
+
+TEST(RpcLanes, lets_interactive_calls_past_busy_bulk_lanes)
+{
+    mp::RpcLanes lanes{1, 1};
+    auto launch = lanes.enter("launch");
+
+    auto list = lanes.enter("list");
+
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(lanes.running(Priority::bulk), 1);
+    EXPECT_EQ(lanes.running(Priority::interactive), 1);
+}
+
+TEST(RpcLanes, holds_bulk_calls_past_their_bound)
+{
+    mp::RpcLanes lanes{0, 1};
+    auto launch = lanes.enter("launch");
+
+    auto purge = std::async(std::launch::async, [&lanes] { return lanes.enter("purge"); });
+    while (lanes.waiting(Priority::bulk) == 0)
+        std::this_thread::yield();
+
+    EXPECT_EQ(purge.wait_for(std::chrono::milliseconds{10}), std::future_status::timeout);
+
+    launch.reset();
+
+    EXPECT_NE(purge.get(), nullptr);
+    EXPECT_EQ(lanes.waiting(Priority::bulk), 0);
+    EXPECT_EQ(lanes.running(Priority::bulk), 1);
+}
+
+TEST(RpcLanes, does_not_bound_lanes_without_limits)
+{
+    mp::RpcLanes lanes{0, 0};
+
+    auto first = lanes.enter("find");
+    auto second = lanes.enter("find");
+
+    EXPECT_EQ(lanes.running(Priority::bulk), 2);
+}
+} // namespace
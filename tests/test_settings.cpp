@@ -18,6 +18,7 @@
 #include "common.h"
 #include "mock_settings.h"
 
+#include <multipass/settings/setting_handle.h>
 #include <multipass/settings/settings_handler.h>
 
 #include <QKeySequence>
@@ -394,6 +395,77 @@ INSTANTIATE_TEST_SUITE_P(TestSettings, TestSettingSetOtherExceptions,
                                         std::runtime_error{"something else"}),
                                  Values(8u), Range(0u, 8u, 2u)));
 
+TEST_F(TestSettings, setCallsSubscribersOfTheKeyOnly)
+{
+    auto key = "sub.key", other = "other.key";
+    auto mock_handler = std::make_unique<MockSettingsHandler>();
+    EXPECT_CALL(*mock_handler, set).Times(2);
+    MP_SETTINGS.register_handler(std::move(mock_handler));
+
+    auto calls = 0;
+    MP_SETTINGS.subscribe(key, [&calls] { ++calls; });
+
+    MP_SETTINGS.set(other, "v");
+    EXPECT_EQ(calls, 0);
+
+    MP_SETTINGS.set(key, "v");
+    EXPECT_EQ(calls, 1);
+}
+
+TEST_F(TestSettings, setDoesNotCallSubscribersWhenItFails)
+{
+    auto key = "sub.key";
+    auto mock_handler = std::make_unique<MockSettingsHandler>();
+    EXPECT_CALL(*mock_handler, set).WillOnce(Throw(mp::InvalidSettingException{key, "v", "nope"}));
+    MP_SETTINGS.register_handler(std::move(mock_handler));
+
+    auto calls = 0;
+    MP_SETTINGS.subscribe(key, [&calls] { ++calls; });
+
+    EXPECT_THROW(MP_SETTINGS.set(key, "v"), mp::InvalidSettingException);
+    EXPECT_EQ(calls, 0);
+}
+
+TEST_F(TestSettings, unsubscribedCallbacksAreNotCalled)
+{
+    auto key = "sub.key";
+    auto mock_handler = std::make_unique<MockSettingsHandler>();
+    EXPECT_CALL(*mock_handler, set);
+    MP_SETTINGS.register_handler(std::move(mock_handler));
+
+    auto calls = 0;
+    MP_SETTINGS.unsubscribe(MP_SETTINGS.subscribe(key, [&calls] { ++calls; }));
+
+    MP_SETTINGS.set(key, "v");
+    EXPECT_EQ(calls, 0);
+}
+
+TEST_F(TestSettings, settingHandleReadsOnceAndKeepsUpWithSet)
+{
+    auto key = "handle.key";
+    auto mock_handler = std::make_unique<MockSettingsHandler>();
+    EXPECT_CALL(*mock_handler, get(Eq(key))).WillOnce(Return("1")).WillOnce(Return("42"));
+    EXPECT_CALL(*mock_handler, set(Eq(key), Eq("42")));
+    MP_SETTINGS.register_handler(std::move(mock_handler));
+
+    mp::SettingHandle<int> handle{key, -1};
+    std::vector<int> changes;
+    handle.on_change([&changes](const int& value) { changes.push_back(value); });
+
+    EXPECT_EQ(handle.get(), 1);
+    EXPECT_EQ(handle.get(), 1);
+
+    MP_SETTINGS.set(key, "42");
+    EXPECT_EQ(handle.get(), 42);
+    EXPECT_THAT(changes, ElementsAre(42));
+}
+
+TEST_F(TestSettings, settingHandleFallsBackWhenItCannotRead)
+{
+    mp::SettingHandle<bool> handle{"unknown.key", true};
+    EXPECT_TRUE(handle.get());
+}
+
 struct TestSettingsGetAs : public Test
 {
     mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject();
@@ -25,6 +25,10 @@
 #include <multipass/ssh/sftp_client.h>
 #include <multipass/ssh/ssh_session.h>
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 
@@ -35,6 +39,38 @@ sftp_file get_dummy_sftp_file()
     return static_cast<sftp_file_struct*>(calloc(1, sizeof(struct sftp_file_struct)));
 }
 
+// Serves asynchronous reads from the given contents, following the file offset as libssh does
+struct RemoteFileReads
+{
+    explicit RemoteFileReads(const std::string& contents) : contents{contents}
+    {
+    }
+
+    std::string contents;
+    std::map<uint32_t, std::pair<uint64_t, uint32_t>> pending; // id -> offset, length
+    uint32_t next_id{0};
+    std::size_t most_pending{0};
+
+    MockScope<decltype(mock_sftp_async_read_begin)> read_begin{
+        mock_sftp_async_read_begin, [this](sftp_file file, uint32_t len) {
+            pending[next_id] = {file->offset, len};
+            file->offset += len;
+            most_pending = std::max(most_pending, pending.size());
+            return static_cast<int>(next_id++);
+        }};
+    MockScope<decltype(mock_sftp_async_read)> read{
+        mock_sftp_async_read, [this](sftp_file, void* data, uint32_t size, uint32_t id) {
+            auto [offset, len] = pending.at(id);
+            pending.erase(id);
+            if (offset >= contents.size())
+                return 0;
+
+            auto count = std::min<std::size_t>({len, size, contents.size() - offset});
+            memcpy(data, contents.data() + offset, count);
+            return static_cast<int>(count);
+        }};
+};
+
 sftp_attributes get_dummy_sftp_attr()
 {
     return static_cast<sftp_attributes_struct*>(calloc(1, sizeof(struct sftp_attributes_struct)));
@@ -198,6 +234,202 @@ TEST_F(SFTPClient, push_success)
     EXPECT_NO_THROW(sftp.push_file(file_name.toStdString(), "baz"));
 }
 
+TEST_F(SFTPClient, push_dir_creates_the_tree_before_the_files)
+{
+    mpt::TempDir temp_dir;
+    QDir{temp_dir.path()}.mkpath("src/a");
+    mpt::make_file_with_content(temp_dir.path() + "/src/x");
+    mpt::make_file_with_content(temp_dir.path() + "/src/a/y");
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_stat, [](auto, const char* path) -> sftp_attributes {
+        if (strcmp(path, "bar") != 0)
+            return nullptr;
+
+        auto attr = get_dummy_sftp_attr();
+        attr->type = SSH_FILEXFER_TYPE_DIRECTORY;
+        return attr;
+    });
+
+    std::vector<std::string> made_dirs, opened_files;
+    std::size_t dirs_made_before_files = 0;
+    REPLACE(sftp_mkdir, [&made_dirs](auto, const char* path, auto) {
+        made_dirs.push_back(path);
+        return SSH_OK;
+    });
+    REPLACE(sftp_open, [&](auto sftp, const char* path, auto...) {
+        if (opened_files.empty())
+            dirs_made_before_files = made_dirs.size();
+        opened_files.push_back(path);
+
+        auto file = get_dummy_sftp_file();
+        file->sftp = sftp;
+        return file;
+    });
+    REPLACE(sftp_write, [](auto, auto, size_t count) { return count; });
+
+    auto sftp = make_sftp_client();
+    sftp.push_dir((temp_dir.path() + "/src").toStdString(), "bar");
+
+    EXPECT_THAT(made_dirs, testing::ElementsAre("bar/src", "bar/src/a"));
+    EXPECT_EQ(dirs_made_before_files, 2u);
+    EXPECT_THAT(opened_files, testing::UnorderedElementsAre("bar/src/x", "bar/src/a/y"));
+}
+
+TEST_F(SFTPClient, pull_dir_recreates_the_remote_tree)
+{
+    QTemporaryDir temp_dir;
+
+    const std::map<std::string, std::vector<std::pair<std::string, uint8_t>>> remote_tree{
+        {"foo",
+         {{".", SSH_FILEXFER_TYPE_DIRECTORY}, {"a", SSH_FILEXFER_TYPE_DIRECTORY}, {"x", SSH_FILEXFER_TYPE_REGULAR}}},
+        {"foo/a", {{"y", SSH_FILEXFER_TYPE_REGULAR}}}};
+    std::map<sftp_dir, std::size_t> listed;
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_opendir, [](auto sftp, const char* path) {
+        auto dir = static_cast<sftp_dir>(calloc(1, sizeof(struct sftp_dir_struct)));
+        dir->sftp = sftp;
+        dir->name = strdup(path);
+        return dir;
+    });
+    REPLACE(sftp_readdir, [&](auto, sftp_dir dir) -> sftp_attributes {
+        const auto& entries = remote_tree.at(dir->name);
+        auto& next = listed[dir];
+        if (next == entries.size())
+            return nullptr;
+
+        auto attr = get_dummy_sftp_attr();
+        attr->name = strdup(entries[next].first.c_str());
+        attr->type = entries[next++].second;
+        return attr;
+    });
+    REPLACE(sftp_dir_eof, [](auto) { return 1; });
+    REPLACE(sftp_closedir, [](sftp_dir dir) {
+        free(dir->name);
+        free(dir);
+        return SSH_OK;
+    });
+    REPLACE(sftp_open, [](auto sftp, auto...) {
+        auto file = get_dummy_sftp_file();
+        file->sftp = sftp;
+        return file;
+    });
+
+    RemoteFileReads remote_file{"data"};
+
+    auto sftp = make_sftp_client();
+    sftp.pull_dir("foo", temp_dir.path().toStdString());
+
+    for (const auto& file : {"foo/x", "foo/a/y"})
+    {
+        QFile pulled{temp_dir.filePath(file)};
+        ASSERT_TRUE(pulled.open(QIODevice::ReadOnly));
+        EXPECT_EQ(pulled.readAll(), "data");
+    }
+}
+
+TEST_F(SFTPClient, sync_push_skips_files_with_same_size_and_time)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/foo";
+    auto file_size = mpt::make_file_with_content(file_name);
+    auto mtime = QFileInfo{file_name}.lastModified().toSecsSinceEpoch();
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_stat, [file_size, mtime](auto...) {
+        auto attr = get_dummy_sftp_attr();
+        attr->type = SSH_FILEXFER_TYPE_REGULAR;
+        attr->size = file_size;
+        attr->mtime = mtime;
+        return attr;
+    });
+
+    auto opened = false, times_set = false;
+    REPLACE(sftp_open, [&opened](auto...) {
+        opened = true;
+        return nullptr;
+    });
+    REPLACE(sftp_utimes, [&times_set](auto...) {
+        times_set = true;
+        return SSH_OK;
+    });
+
+    auto sftp = make_sftp_client();
+    sftp.set_sync(true);
+    sftp.push_file(file_name.toStdString(), "bar");
+
+    EXPECT_FALSE(opened);
+    EXPECT_FALSE(times_set);
+}
+
+TEST_F(SFTPClient, sync_push_sends_changed_files_with_their_time)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/foo";
+    auto file_size = mpt::make_file_with_content(file_name);
+    auto mtime = QFileInfo{file_name}.lastModified().toSecsSinceEpoch();
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_stat, [file_size](auto...) {
+        auto attr = get_dummy_sftp_attr();
+        attr->type = SSH_FILEXFER_TYPE_REGULAR;
+        attr->size = file_size + 1;
+        return attr;
+    });
+
+    auto opened = false;
+    REPLACE(sftp_open, [&opened](auto sftp, auto...) {
+        opened = true;
+        auto file = get_dummy_sftp_file();
+        file->sftp = sftp;
+        return file;
+    });
+    REPLACE(sftp_write, [](auto, auto, size_t count) { return count; });
+
+    long long set_time = 0;
+    REPLACE(sftp_utimes, [&set_time](auto, auto, const timeval* times) {
+        set_time = times[1].tv_sec;
+        return SSH_OK;
+    });
+
+    auto sftp = make_sftp_client();
+    sftp.set_sync(true);
+    sftp.push_file(file_name.toStdString(), "bar");
+
+    EXPECT_TRUE(opened);
+    EXPECT_EQ(set_time, mtime);
+}
+
+TEST_F(SFTPClient, sync_pull_skips_files_with_same_size_and_time)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/foo";
+    auto file_size = mpt::make_file_with_content(file_name);
+    auto mtime = QFileInfo{file_name}.lastModified().toSecsSinceEpoch();
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_stat, [file_size, mtime](auto...) {
+        auto attr = get_dummy_sftp_attr();
+        attr->type = SSH_FILEXFER_TYPE_REGULAR;
+        attr->size = file_size;
+        attr->mtime = mtime;
+        return attr;
+    });
+
+    auto opened = false;
+    REPLACE(sftp_open, [&opened](auto...) {
+        opened = true;
+        return nullptr;
+    });
+
+    auto sftp = make_sftp_client();
+    sftp.set_sync(true);
+    sftp.pull_file("foo", file_name.toStdString());
+
+    EXPECT_FALSE(opened);
+}
+
 TEST_F(SFTPClient, pull_throws_on_sftp_open_failed)
 {
     const std::string source_path{"foo"};
@@ -223,7 +455,8 @@ TEST_F(SFTPClient, pull_throws_on_sftp_read_failed)
         file->sftp = session;
         return file;
     });
-    REPLACE(sftp_read, [](sftp_file file, auto...) {
+    REPLACE(sftp_async_read_begin, [](auto...) { return 0; });
+    REPLACE(sftp_async_read, [](sftp_file file, auto...) {
         file->sftp->errnum = SSH_ERROR;
         return -1;
     });
@@ -271,20 +504,7 @@ TEST_F(SFTPClient, pull_success)
         return file;
     });
 
-    auto allow_read = true;
-    REPLACE(sftp_read, [&](auto, void* buf, auto) mutable {
-        if (allow_read)
-        {
-            int size = strlen(test_data);
-            memcpy(buf, test_data, size);
-            allow_read = false;
-            return size;
-        }
-        else
-        {
-            return 0;
-        }
-    });
+    RemoteFileReads remote_file{test_data};
 
     auto sftp = make_sftp_client();
 
@@ -294,7 +514,6 @@ TEST_F(SFTPClient, pull_success)
     test_file1.open(QIODevice::ReadOnly);
     EXPECT_EQ(test_data, test_file1.readAll());
 
-    allow_read = true;
     EXPECT_NO_THROW(sftp.pull_file("foo", file_path2));
     QFile test_file2{(file_path2 + "/foo").c_str()};
     ASSERT_TRUE(test_file2.exists());
@@ -302,6 +521,34 @@ TEST_F(SFTPClient, pull_success)
     EXPECT_EQ(test_data, test_file2.readAll());
 }
 
+TEST_F(SFTPClient, pull_keeps_several_reads_in_flight)
+{
+    QTemporaryDir temp_dir;
+    const auto file_path = temp_dir.filePath("bar").toStdString();
+
+    std::string test_data;
+    for (auto i = 0; i < 300000; ++i)
+        test_data.push_back(static_cast<char>(i % 251));
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_open, [](auto sftp, auto...) {
+        auto file = get_dummy_sftp_file();
+        file->sftp = sftp;
+        return file;
+    });
+
+    RemoteFileReads remote_file{test_data};
+
+    auto sftp = make_sftp_client();
+    sftp.pull_file("foo", file_path);
+
+    QFile test_file{file_path.c_str()};
+    ASSERT_TRUE(test_file.open(QIODevice::ReadOnly));
+    EXPECT_EQ(test_file.readAll().toStdString(), test_data);
+    EXPECT_GT(remote_file.most_pending, 1u);
+    EXPECT_TRUE(remote_file.pending.empty());
+}
+
 // testing stream method
 
 TEST_F(SFTPClient, in_steam_throws_on_sftp_open_failed)
@@ -32,7 +32,16 @@
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/sshfs_mount/sftp_server.h>
 
+#include <atomic>
+#include <cstdio>
+#include <functional>
 #include <queue>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -209,6 +218,54 @@ auto make_data(const std::string& in)
     return out;
 }
 
+// The packet of an extended request, as libssh keeps it for what it does not parse itself
+struct ExtendedRequest
+{
+    ExtendedRequest(uint32_t id, const std::string& name)
+    {
+        add_u32(id);
+        add_string(name);
+    }
+
+    ExtendedRequest& add_u32(uint32_t value)
+    {
+        for (auto shift = 24; shift >= 0; shift -= 8)
+            bytes.push_back(static_cast<char>(value >> shift & 0xff));
+        return *this;
+    }
+
+    ExtendedRequest& add_u64(uint64_t value)
+    {
+        add_u32(static_cast<uint32_t>(value >> 32));
+        return add_u32(static_cast<uint32_t>(value));
+    }
+
+    ExtendedRequest& add_string(const std::string& value)
+    {
+        add_u32(static_cast<uint32_t>(value.size()));
+        bytes += value;
+        return *this;
+    }
+
+    ssh_buffer buffer()
+    {
+        ssh_buffer_reinit(packet.get());
+        ssh_buffer_add_data(packet.get(), bytes.data(), bytes.size());
+        return packet.get();
+    }
+
+    std::string bytes;
+    std::unique_ptr<ssh_buffer_struct, decltype(ssh_buffer_free)*> packet{ssh_buffer_new(), ssh_buffer_free};
+};
+
+uint64_t u64_at(const std::string& packet, std::size_t at)
+{
+    uint64_t value = 0;
+    for (auto i = at; i < at + 8; ++i)
+        value = value << 8 | static_cast<unsigned char>(packet[i]);
+    return value;
+}
+
 bool content_match(const QString& path, const std::string& data)
 {
     auto content = mpt::load(path);
@@ -290,11 +347,21 @@ TEST_F(SftpServer, sshfs_restarts_on_error)
     auto request_exec = [this, &invoked, &num_calls](ssh_channel, const char* raw_cmd) {
         std::string cmd{raw_cmd};
         if (cmd.find("sudo sshfs") != std::string::npos)
+        {
+            exit_status_mock.return_exit_code(SSH_OK);
+            ++num_calls;
+        }
+        else if (cmd.find("findmnt") != std::string::npos && cmd.find("umount") != std::string::npos &&
+                 cmd.find("exec\\ sshfs") != std::string::npos)
         {
             invoked = true;
             exit_status_mock.return_exit_code(SSH_OK);
             ++num_calls;
         }
+        else
+        {
+            ADD_FAILURE() << "unexpected command: " << cmd;
+        }
 
         return SSH_OK;
     };
@@ -317,6 +384,61 @@ TEST_F(SftpServer, sshfs_restarts_on_error)
     EXPECT_TRUE(invoked);
 }
 
+TEST_F(SftpServer, does_not_read_from_a_closed_channel)
+{
+    auto sftp = make_sftpserver();
+
+    bool read{false};
+    REPLACE(ssh_channel_is_closed, [](auto...) { return 1; });
+    REPLACE(sftp_get_client_message, [&read](auto...) {
+        read = true;
+        return nullptr;
+    });
+
+    sftp.run();
+
+    EXPECT_FALSE(read);
+}
+
+#ifdef __linux__
+TEST_F(SftpServer, forwards_host_changes_to_the_instance)
+{
+    mpt::TempDir temp_dir;
+    const auto path = temp_dir.path().toStdString();
+
+    bool agent_started{false};
+    REPLACE(ssh_channel_request_exec, [&agent_started](ssh_channel, const char* raw_cmd) {
+        if (std::string{raw_cmd}.find("touch") != std::string::npos)
+            agent_started = true;
+        return SSH_OK;
+    });
+
+    mp::SSHSession session{"a", 42};
+    mp::SftpServer sftp{std::move(session), path, path, {}, {}, default_id, default_id, "sshfs", 1, 0, 64 * 1024,
+                        256 * 1024, true};
+    ASSERT_TRUE(agent_started);
+
+    std::string forwarded;
+    REPLACE(ssh_channel_write, [&forwarded](ssh_channel, const void* data, uint32_t len) {
+        forwarded.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+
+    mpt::make_file_with_content(temp_dir.path() + "/changed-file");
+
+    // Only report something to read once the change went out; the null message that follows ends the run
+    REPLACE(ssh_channel_poll_timeout, [&forwarded](auto...) {
+        if (forwarded.empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return forwarded.empty() ? 0 : 1;
+    });
+
+    sftp.run();
+
+    EXPECT_THAT(forwarded, HasSubstr(" changed-file\n"));
+}
+#endif
+
 TEST_F(SftpServer, stops_after_a_null_message)
 {
     auto sftp = make_sftpserver();
@@ -1237,8 +1359,64 @@ TEST_F(SftpServer, handles_readdir)
 
     EXPECT_THAT(eof_num_calls, Eq(1));
 
-    std::vector<std::string> expected_entries = {".", "..", "test-dir-entry", "test-file"};
-    EXPECT_THAT(entries, ContainerEq(expected_entries));
+    EXPECT_THAT(entries, UnorderedElementsAre(".", "..", "test-dir-entry", "test-file"));
+}
+
+TEST_F(SftpServer, readdir_splits_large_directories_across_replies)
+{
+    mpt::TempDir temp_dir;
+
+    const auto num_files = 2000;
+    for (auto i = 0; i < num_files; ++i)
+        mpt::make_file_with_content(QString{"%1/a-file-with-a-rather-long-name-%2"}.arg(temp_dir.path()).arg(i));
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_dir_msg = make_msg(SFTP_OPENDIR);
+    auto dir_name = name_as_char_array(temp_dir.path().toStdString());
+    open_dir_msg->filename = dir_name.data();
+
+    std::vector<std::unique_ptr<sftp_client_message_struct>> readdir_msgs;
+    for (auto i = 0; i < 10; ++i)
+        readdir_msgs.push_back(make_msg(SFTP_READDIR));
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return ssh_string_new(4);
+    };
+
+    int eof_num_calls{0};
+    auto reply_status = [&eof_num_calls](sftp_client_message, uint32_t status, const char*) {
+        EXPECT_THAT(status, Eq(SSH_FX_EOF));
+        ++eof_num_calls;
+        return SSH_OK;
+    };
+
+    std::set<std::string> entries;
+    auto reply_names_add = [&entries](sftp_client_message, const char* file, const char*, sftp_attributes) {
+        EXPECT_TRUE(entries.insert(file).second);
+        return SSH_OK;
+    };
+
+    int num_replies{0};
+    auto reply_names = [&num_replies](auto...) {
+        ++num_replies;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_reply_names_add, reply_names_add);
+    REPLACE(sftp_reply_names, reply_names);
+
+    sftp.run();
+
+    EXPECT_GT(num_replies, 1);
+    EXPECT_EQ(num_replies + eof_num_calls, 10);
+    EXPECT_EQ(entries.size(), num_files + 2u);
 }
 
 TEST_F(SftpServer, handles_readdir_attributes_preserved)
@@ -1610,6 +1788,38 @@ TEST_F(SftpServer, setstat_chown_failure_fails)
     EXPECT_EQ(failure_num_calls, 1);
 }
 
+TEST_F(SftpServer, setstat_with_unchanged_times_leaves_file_alone)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+    const QFileInfo info{file_name};
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto msg = make_msg(SFTP_SETSTAT);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.atime = static_cast<uint32_t>(info.lastRead().toSecsSinceEpoch());
+    attr.mtime = static_cast<uint32_t>(info.lastModified().toSecsSinceEpoch());
+    attr.flags = SSH_FILEXFER_ATTR_ACMODTIME;
+
+    msg->filename = name.data();
+    msg->attr = &attr;
+
+    auto [mock_platform, guard] = mpt::MockPlatform::inject();
+    EXPECT_CALL(*mock_platform, utime(_, _, _)).Times(0);
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_OK, num_calls);
+
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 1);
+}
+
 TEST_F(SftpServer, setstat_utime_failure_fails)
 {
     mpt::TempDir temp_dir;
@@ -1700,9 +1910,8 @@ TEST_F(SftpServer, handles_writes)
     EXPECT_TRUE(content_match(file_name, "The answer is always 42"));
 }
 
-TEST_F(SftpServer, write_cannot_seek_fails)
+TEST_F(SftpServer, coalesces_sequential_writes)
 {
-    const int seek_pos{10};
     mpt::TempDir temp_dir;
     auto file_name = temp_dir.path() + "/test-file";
 
@@ -1716,10 +1925,17 @@ TEST_F(SftpServer, write_cannot_seek_fails)
     open_msg->attr = &attr;
     open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
 
-    auto write_msg = make_msg(SFTP_WRITE);
+    auto write_msg1 = make_msg(SFTP_WRITE);
     auto data1 = make_data("The answer is ");
-    write_msg->data = data1.get();
-    write_msg->offset = seek_pos;
+    write_msg1->data = data1.get();
+    write_msg1->offset = 0;
+
+    auto write_msg2 = make_msg(SFTP_WRITE);
+    auto data2 = make_data("always 42");
+    write_msg2->data = data2.get();
+    write_msg2->offset = ssh_string_len(data1.get());
+
+    auto close_msg = make_msg(SFTP_CLOSE);
 
     void* id{nullptr};
     auto handle_alloc = [&id](sftp_session, void* info) {
@@ -1732,27 +1948,28 @@ TEST_F(SftpServer, write_cannot_seek_fails)
         return file.open(mode);
     });
     EXPECT_CALL(*mock_file_ops, setPermissions(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_file_ops, write_at(_, _, 23, 0)).WillOnce([](QFile&, const char* data, qint64 size, qint64) {
+        EXPECT_EQ(std::string(data, size), "The answer is always 42");
+        return size;
+    });
 
-    int failure_num_calls{0};
-    auto reply_status = make_reply_status(write_msg.get(), SSH_FX_FAILURE, failure_num_calls);
+    int ok_num_calls{0};
+    auto reply_status = [&ok_num_calls](sftp_client_message, uint32_t status, const char*) {
+        EXPECT_THAT(status, Eq(SSH_FX_OK));
+        ++ok_num_calls;
+        return SSH_OK;
+    };
 
     REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
     REPLACE(sftp_handle_alloc, handle_alloc);
     REPLACE(sftp_handle, [&id](auto...) { return id; });
     REPLACE(sftp_get_client_message, make_msg_handler());
     REPLACE(sftp_reply_status, reply_status);
-
-    logger_scope.mock_logger->screen_logs(mpl::Level::trace);
-    EXPECT_CALL(*logger_scope.mock_logger,
-                log(Eq(mpl::Level::trace), mpt::MockLogger::make_cstring_matcher(StrEq("sftp server")),
-                    mpt::MockLogger::make_cstring_matcher(
-                        AllOf(HasSubstr(fmt::format("cannot seek to position {} in", seek_pos)),
-                              HasSubstr(file_name.toStdString())))));
+    REPLACE(sftp_handle_remove, [](auto...) {});
 
     sftp.run();
 
-    EXPECT_EQ(failure_num_calls, 1);
+    EXPECT_EQ(ok_num_calls, 3);
 }
 
 TEST_F(SftpServer, write_failure_fails)
@@ -1775,6 +1992,8 @@ TEST_F(SftpServer, write_failure_fails)
     write_msg->data = data1.get();
     write_msg->offset = 10;
 
+    auto close_msg = make_msg(SFTP_CLOSE);
+
     void* id{nullptr};
     auto handle_alloc = [&id](sftp_session, void* info) {
         id = info;
@@ -1786,17 +2005,27 @@ TEST_F(SftpServer, write_failure_fails)
         return file.open(mode);
     });
     EXPECT_CALL(*mock_file_ops, setPermissions(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, write(_, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_ops, write_at(_, _, _, 10)).WillOnce(Return(-1));
 
+    // the write is buffered, so its failure is reported when the handle is closed
     int failure_num_calls{0};
-    auto reply_status = make_reply_status(write_msg.get(), SSH_FX_FAILURE, failure_num_calls);
+    auto reply_status = [&failure_num_calls, &close_msg](sftp_client_message msg, uint32_t status, const char*) {
+        if (msg == close_msg.get())
+        {
+            EXPECT_THAT(status, Eq(SSH_FX_FAILURE));
+            ++failure_num_calls;
+        }
+        else
+            EXPECT_THAT(status, Eq(SSH_FX_OK));
+        return SSH_OK;
+    };
 
     REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
     REPLACE(sftp_handle_alloc, handle_alloc);
     REPLACE(sftp_handle, [&id](auto...) { return id; });
     REPLACE(sftp_get_client_message, make_msg_handler());
     REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_handle_remove, [](auto...) {});
 
     logger_scope.mock_logger->screen_logs(mpl::Level::trace);
     EXPECT_CALL(*logger_scope.mock_logger,
@@ -1854,12 +2083,11 @@ TEST_F(SftpServer, handles_reads)
     ASSERT_THAT(num_calls, Eq(1));
 }
 
-TEST_F(SftpServer, read_cannot_seek_fails)
+TEST_F(SftpServer, reads_arriving_together_are_read_together)
 {
-    const int seek_pos{10};
     mpt::TempDir temp_dir;
     auto file_name = temp_dir.path() + "/test-file";
-    auto size = mpt::make_file_with_content(file_name);
+    mpt::make_file_with_content(file_name);
 
     auto sftp = make_sftpserver(temp_dir.path().toStdString());
     auto open_msg = make_msg(SFTP_OPEN);
@@ -1867,10 +2095,13 @@ TEST_F(SftpServer, read_cannot_seek_fails)
     open_msg->filename = name.data();
     open_msg->flags |= SSH_FXF_READ;
 
-    auto read_msg = make_msg(SFTP_READ);
-    read_msg->offset = seek_pos;
-    const int expected_size = size - read_msg->offset;
-    read_msg->len = expected_size;
+    auto read_msg1 = make_msg(SFTP_READ);
+    read_msg1->offset = 0;
+    read_msg1->len = 4;
+
+    auto read_msg2 = make_msg(SFTP_READ);
+    read_msg2->offset = 10;
+    read_msg2->len = 4;
 
     void* id{nullptr};
     auto handle_alloc = [&id](sftp_session, void* info) {
@@ -1879,28 +2110,91 @@ TEST_F(SftpServer, read_cannot_seek_fails)
     };
 
     auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce([](QFileDevice& file, QIODevice::OpenMode mode) {
+        return file.open(mode);
+    });
+    EXPECT_CALL(*mock_file_ops, read_batch(SizeIs(2))).WillOnce([](std::vector<mp::FileOps::Transfer>& reads) {
+        for (auto& read : reads)
+            read.result = read.file->seek(read.pos) ? read.file->read(read.data, read.size) : -1;
+    });
 
-    int failure_num_calls{0};
-    auto reply_status = make_reply_status(read_msg.get(), SSH_FX_FAILURE, failure_num_calls);
+    std::vector<std::string> replies;
+    auto reply_data = [&replies](sftp_client_message, const void* data, int len) {
+        replies.emplace_back(reinterpret_cast<const char*>(data), len);
+        return SSH_OK;
+    };
 
     REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
     REPLACE(sftp_handle_alloc, handle_alloc);
     REPLACE(sftp_handle, [&id](auto...) { return id; });
     REPLACE(sftp_get_client_message, make_msg_handler());
-    REPLACE(sftp_reply_status, reply_status);
-
-    logger_scope.mock_logger->screen_logs(mpl::Level::trace);
-    EXPECT_CALL(*logger_scope.mock_logger,
-                log(Eq(mpl::Level::trace), mpt::MockLogger::make_cstring_matcher(StrEq("sftp server")),
-                    mpt::MockLogger::make_cstring_matcher(
-                        AllOf(HasSubstr(fmt::format("cannot seek to position {} in", seek_pos)),
-                              HasSubstr(file_name.toStdString())))));
+    REPLACE(sftp_reply_data, reply_data);
+    REPLACE(ssh_channel_poll_timeout, [](auto...) { return 1; });
 
     sftp.run();
 
-    EXPECT_EQ(failure_num_calls, 1);
+    EXPECT_THAT(replies, ElementsAre("this", "a te"));
+}
+
+struct SftpServerReadAhead : public SftpServer
+{
+    void run_reads(const std::vector<uint64_t>& offsets)
+    {
+        mpt::TempDir temp_dir;
+        auto file_name = temp_dir.path() + "/test-file";
+        mpt::make_file_with_content(file_name);
+
+        auto sftp = make_sftpserver(temp_dir.path().toStdString());
+        auto open_msg = make_msg(SFTP_OPEN);
+        auto name = name_as_char_array(file_name.toStdString());
+        open_msg->filename = name.data();
+        open_msg->flags |= SSH_FXF_READ;
+
+        std::vector<std::unique_ptr<sftp_client_message_struct>> read_msgs;
+        for (auto offset : offsets)
+        {
+            read_msgs.push_back(make_msg(SFTP_READ));
+            read_msgs.back()->offset = offset;
+            read_msgs.back()->len = 4;
+        }
+
+        void* id{nullptr};
+        auto handle_alloc = [&id](sftp_session, void* info) {
+            id = info;
+            return ssh_string_new(4);
+        };
+
+        EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce([](QFileDevice& file, QIODevice::OpenMode mode) {
+            return file.open(mode);
+        });
+        EXPECT_CALL(*mock_file_ops, read_at).WillRepeatedly(Return(4));
+
+        REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+        REPLACE(sftp_handle_alloc, handle_alloc);
+        REPLACE(sftp_handle, [&id](auto...) { return id; });
+        REPLACE(sftp_get_client_message, make_msg_handler());
+        REPLACE(sftp_reply_data, [](auto...) { return SSH_OK; });
+
+        sftp.run();
+    }
+
+    mpt::MockFileOps::GuardedMock mock_file_ops_injection = mpt::MockFileOps::inject();
+    mpt::MockFileOps* mock_file_ops = mock_file_ops_injection.first;
+};
+
+TEST_F(SftpServerReadAhead, reads_ahead_of_sequential_readers)
+{
+    EXPECT_CALL(*mock_file_ops, advise(_, 0, 0, mp::FileOps::Access::sequential)).Times(1);
+    EXPECT_CALL(*mock_file_ops, advise(_, 16, _, mp::FileOps::Access::will_need)).Times(1);
+
+    run_reads({0, 4, 8, 12, 16});
+}
+
+TEST_F(SftpServerReadAhead, leaves_random_readers_alone)
+{
+    EXPECT_CALL(*mock_file_ops, advise).Times(0);
+
+    run_reads({12, 0, 8, 4, 16});
 }
 
 TEST_F(SftpServer, read_returns_failure_fails)
@@ -1928,8 +2222,7 @@ TEST_F(SftpServer, read_returns_failure_fails)
 
     auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
     EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, read(_, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_ops, read_at(_, _, _, 10)).WillOnce(Return(-1));
 
     int failure_num_calls{0};
     auto reply_status = make_reply_status(read_msg.get(), SSH_FX_FAILURE, failure_num_calls);
@@ -1976,8 +2269,7 @@ TEST_F(SftpServer, read_returns_zero_end_of_file)
 
     auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
     EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_file_ops, read(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_ops, read_at(_, _, _, 10)).WillOnce(Return(0));
 
     int eof_num_calls{0};
     auto reply_status = make_reply_status(read_msg.get(), SSH_FX_EOF, eof_num_calls);
@@ -2024,6 +2316,132 @@ TEST_F(SftpServer, handle_extended_link)
     EXPECT_TRUE(content_match(link_name, "this is a test file"));
 }
 
+TEST_F(SftpServer, copy_data_copies_between_open_files)
+{
+    mpt::TempDir temp_dir;
+    auto source_name = temp_dir.path() + "/source";
+    auto destination_name = temp_dir.path() + "/destination";
+    mpt::make_file_with_content(source_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_source = make_msg(SFTP_OPEN);
+    auto source = name_as_char_array(source_name.toStdString());
+    open_source->filename = source.data();
+    open_source->flags |= SSH_FXF_READ;
+
+    auto open_destination = make_msg(SFTP_OPEN);
+    auto destination = name_as_char_array(destination_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0644;
+    open_destination->filename = destination.data();
+    open_destination->attr = &attr;
+    open_destination->flags |= SSH_FXF_WRITE | SSH_FXF_CREAT;
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("copy-data");
+    msg->submessage = submessage.data();
+    ExtendedRequest request{1, "copy-data"};
+    request.add_string("h0").add_u64(5).add_u64(4).add_string("h1").add_u64(0);
+    msg->complete_message = request.buffer();
+
+    // Handles are named after the order they were opened in
+    std::vector<void*> infos;
+    auto handle_alloc = [&infos](sftp_session, void* info) {
+        const auto name = fmt::format("h{}", infos.size());
+        infos.push_back(info);
+        auto handle = ssh_string_new(name.size());
+        ssh_string_fill(handle, name.data(), name.size());
+        return handle;
+    };
+    auto handle = [&infos](sftp_session, ssh_string handle) {
+        const std::string name{ssh_string_get_char(handle), ssh_string_len(handle)};
+        return infos.at(std::stoul(name.substr(1)));
+    };
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_OK, num_calls);
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, handle);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 1);
+    EXPECT_TRUE(content_match(destination_name, "is a"));
+}
+
+TEST_F(SftpServer, copy_data_rejects_malformed_requests)
+{
+    auto sftp = make_sftpserver();
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("copy-data");
+    msg->submessage = submessage.data();
+    ExtendedRequest request{1, "copy-data"};
+    request.add_string("h0").add_u64(5);
+    msg->complete_message = request.buffer();
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_BAD_MESSAGE, num_calls);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 1);
+}
+
+TEST_F(SftpServer, statvfs_replies_with_the_filesystem_of_the_path)
+{
+    mpt::TempDir temp_dir;
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto msg = make_msg(SFTP_EXTENDED);
+    msg->id = 7;
+    auto submessage = name_as_char_array("statvfs@openssh.com");
+    msg->submessage = submessage.data();
+    ExtendedRequest request{7, "statvfs@openssh.com"};
+    request.add_string(temp_dir.path().toStdString());
+    msg->complete_message = request.buffer();
+
+    std::string written;
+    REPLACE(ssh_channel_write, [&written](ssh_channel, const void* data, uint32_t len) {
+        written.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    ASSERT_EQ(written.size(), 4u + 1 + 4 + 11 * 8);
+    EXPECT_EQ(static_cast<unsigned char>(written[4]), SSH_FXP_EXTENDED_REPLY);
+    EXPECT_EQ(written[8], 7);
+    EXPECT_GT(u64_at(written, 9), 0u);      // f_bsize
+    EXPECT_GT(u64_at(written, 9 + 16), 0u); // f_blocks
+}
+
+TEST_F(SftpServer, limits_advertise_the_read_size)
+{
+    auto sftp = make_sftpserver();
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("limits@openssh.com");
+    msg->submessage = submessage.data();
+
+    std::string written;
+    REPLACE(ssh_channel_write, [&written](ssh_channel, const void* data, uint32_t len) {
+        written.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    ASSERT_EQ(written.size(), 4u + 1 + 4 + 4 * 8);
+    EXPECT_EQ(u64_at(written, 9 + 8), 64u * 1024);  // max-read-length
+    EXPECT_EQ(u64_at(written, 9 + 16), 64u * 1024); // max-write-length
+}
+
 TEST_F(SftpServer, extended_link_in_invalid_dir_fails)
 {
     mpt::TempDir temp_dir;
@@ -2197,6 +2615,126 @@ TEST_P(Stat, handles)
     EXPECT_THAT(num_calls, Eq(1));
 }
 
+TEST_F(SftpServer, handles_path_queries_concurrently)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    const auto path = temp_dir.path().toStdString();
+    mp::SSHSession session{"a", 42};
+    mp::SftpServer sftp{std::move(session), path, path, {}, {}, default_id, default_id, "sshfs", /*max_workers=*/2};
+
+    auto name = name_as_char_array(file_name.toStdString());
+    auto stat_msg = make_msg(SFTP_STAT);
+    stat_msg->filename = name.data();
+    auto lstat_msg = make_msg(SFTP_LSTAT);
+    lstat_msg->filename = name.data();
+
+    std::atomic_int num_calls{0};
+    auto reply_attr = [&num_calls](auto...) {
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(ssh_channel_poll_timeout, [](auto...) { return 1; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_attr, reply_attr);
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 2);
+}
+
+#ifdef __linux__
+namespace
+{
+struct SftpServerAttributeCache : public SftpServer
+{
+    // Stats file_name three times and returns the sizes seen. The first stat sets up the watch, the second is
+    // remembered and the third can be answered from the cache; change runs between the last two.
+    std::vector<uint64_t> sizes_of_three_stats(const QString& file_name, const std::function<void()>& change)
+    {
+        const auto path = temp_dir.path().toStdString();
+        mp::SSHSession session{"a", 42};
+        mp::SftpServer sftp{std::move(session), path, path, {}, {}, default_id, default_id, "sshfs",
+                            /*max_workers=*/1, /*attribute_cache_size=*/64};
+
+        auto name = name_as_char_array(file_name.toStdString());
+        std::vector<std::unique_ptr<sftp_client_message_struct>> msgs;
+        for (auto i = 0; i < 3; ++i)
+        {
+            msgs.push_back(make_msg(SFTP_STAT));
+            msgs.back()->filename = name.data();
+        }
+
+        std::vector<uint64_t> sizes;
+        auto reply_attr = [&sizes, &change](sftp_client_message, sftp_attributes attr) {
+            sizes.push_back(attr->size);
+            if (sizes.size() == 2)
+                change();
+            return SSH_OK;
+        };
+
+        REPLACE(sftp_get_client_message, make_msg_handler());
+        REPLACE(sftp_reply_attr, reply_attr);
+
+        sftp.run();
+
+        return sizes;
+    }
+
+    static void append_to(const QString& file_name, const QByteArray& data)
+    {
+        QFile file{file_name};
+        ASSERT_TRUE(file.open(QIODevice::Append));
+        ASSERT_EQ(file.write(data), data.size());
+    }
+
+    mpt::TempDir temp_dir;
+};
+} // namespace
+
+TEST_F(SftpServerAttributeCache, answers_repeated_stats_from_memory)
+{
+    mpt::TempDir elsewhere;
+    const auto file_name = temp_dir.filePath("test-file");
+    const auto link_name = elsewhere.filePath("test-link");
+    mpt::make_file_with_content(file_name, "four");
+    ASSERT_EQ(::link(file_name.toStdString().c_str(), link_name.toStdString().c_str()), 0);
+
+    // A write through a hard link outside the tree goes unnoticed, so only a fresh stat would see it
+    auto sizes = sizes_of_three_stats(file_name, [&link_name] { append_to(link_name, "more"); });
+
+    EXPECT_THAT(sizes, ElementsAre(4u, 4u, 4u));
+    EXPECT_EQ(QFileInfo{file_name}.size(), 8);
+}
+
+TEST_F(SftpServerAttributeCache, forgets_what_the_host_writes_to)
+{
+    const auto file_name = temp_dir.filePath("test-file");
+    mpt::make_file_with_content(file_name, "four");
+
+    auto sizes = sizes_of_three_stats(file_name, [&file_name] { append_to(file_name, "more"); });
+
+    EXPECT_THAT(sizes, ElementsAre(4u, 4u, 8u));
+}
+
+TEST_F(SftpServerAttributeCache, forgets_what_the_host_renames_over)
+{
+    const auto file_name = temp_dir.filePath("test-file");
+    const auto replacement_name = temp_dir.filePath("replacement");
+    mpt::make_file_with_content(file_name, "four");
+    mpt::make_file_with_content(replacement_name, "eight...");
+
+    auto sizes = sizes_of_three_stats(file_name, [&file_name, &replacement_name] {
+        ASSERT_EQ(std::rename(replacement_name.toStdString().c_str(), file_name.toStdString().c_str()), 0);
+    });
+
+    EXPECT_THAT(sizes, ElementsAre(4u, 4u, 8u));
+}
+#endif
+
 TEST_P(WhenInInvalidDir, fails)
 {
     auto msg_type = GetParam();
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/sha256.h>
+#include <multipass/vm_image_vault.h>
+
+#include <QCryptographicHash>
+#include <QFile>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+TEST(Sha256, hashes_data)
+{
+    mp::Sha256 hash;
+    hash.add_data(QByteArray{"abc"});
+
+    EXPECT_EQ(hash.result().toHex(), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(Sha256, takes_more_data_after_a_result)
+{
+    mp::Sha256 hash;
+    hash.add_data(QByteArray{"a"});
+    hash.result();
+    hash.add_data(QByteArray{"bc"});
+
+    EXPECT_EQ(hash.result(), QCryptographicHash::hash("abc", QCryptographicHash::Sha256));
+}
+
+TEST(Sha256, starts_over_when_reset)
+{
+    mp::Sha256 hash;
+    hash.add_data(QByteArray{"xyz"});
+    hash.reset();
+
+    EXPECT_EQ(hash.result(), QCryptographicHash::hash("", QCryptographicHash::Sha256));
+}
+
+TEST(Sha256, hashes_files_larger_than_its_buffers)
+{
+    mpt::TempDir temp_dir;
+    const auto path = temp_dir.path() + "/image";
+
+    std::string content(20 << 20, '\0');
+    for (std::size_t i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>(i * 31 % 251);
+    mpt::make_file_with_content(path, content);
+
+    const auto expected =
+        QCryptographicHash::hash(QByteArray::fromStdString(content), QCryptographicHash::Sha256).toHex();
+    EXPECT_EQ(mp::vault::compute_image_hash(path), expected);
+}
+} // namespace
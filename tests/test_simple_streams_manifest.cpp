@@ -132,6 +132,31 @@ TEST_F(TestSimpleStreamsManifest, can_query_all_versions)
     }
 }
 
+TEST_F(TestSimpleStreamsManifest, looks_up_products_by_id_and_id_prefix)
+{
+    auto json = mpt::load_test_file("releases/multiple_versions_manifest.json");
+    auto manifest = mp::SimpleStreamsManifest::fromJson(json, "");
+
+    const QString id{"8842e7a8adb01c7a30cc702b01a5330a1951b12042816e87efd24b61c5e2239f"};
+    const auto* product = manifest->product_with_id(id);
+    ASSERT_THAT(product, NotNull());
+    EXPECT_EQ(product->id, id);
+    EXPECT_THAT(manifest->product_with_id("8842e7a8"), IsNull());
+
+    EXPECT_THAT(manifest->products_with_id_prefix("8842e7a8"), Contains(product));
+    EXPECT_THAT(manifest->products_with_id_prefix("zzz"), IsEmpty());
+}
+
+TEST_F(TestSimpleStreamsManifest, reads_the_driver_once_per_manifest)
+{
+    EXPECT_CALL(mock_settings, get(Eq(mp::driver_key))).WillOnce(Return("emu"));
+
+    auto json = mpt::load_test_file("releases/multiple_versions_manifest.json");
+    auto manifest = mp::SimpleStreamsManifest::fromJson(json, "");
+
+    EXPECT_GT(manifest->products.size(), 1u);
+}
+
 TEST_F(TestSimpleStreamsManifest, info_has_kernel_and_initrd_paths)
 {
     auto json = mpt::load_test_file("good_manifest.json");
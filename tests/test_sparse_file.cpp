@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "temp_dir.h"
+
+#include <multipass/sparse_file.h>
+
+#include <QDir>
+
+#include <vector>
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+#include <sys/stat.h>
+#endif
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct SparseFile : public Test
+{
+    QByteArray write_through_writer(const std::vector<QByteArray>& chunks)
+    {
+        QFile file{path};
+        EXPECT_TRUE(file.open(QIODevice::WriteOnly));
+
+        mp::sparse::Writer writer{file};
+        for (const auto& chunk : chunks)
+            EXPECT_TRUE(writer.write(chunk.constData(), chunk.size()));
+        EXPECT_TRUE(writer.finish());
+        file.close();
+
+        EXPECT_TRUE(file.open(QIODevice::ReadOnly));
+        return file.readAll();
+    }
+
+    mpt::TempDir temp_dir;
+    QString path{QDir{temp_dir.path()}.filePath("image")};
+};
+
+TEST_F(SparseFile, tellsZerosFromData)
+{
+    std::vector<char> data(1000);
+    EXPECT_TRUE(mp::sparse::is_all_zero(data.data(), data.size()));
+
+    for (auto at : {0, 63, 64, 500, 999})
+    {
+        data[at] = 1;
+        EXPECT_FALSE(mp::sparse::is_all_zero(data.data(), data.size())) << at;
+        data[at] = 0;
+    }
+}
+
+TEST_F(SparseFile, writesWhatItIsGiven)
+{
+    const auto data = QByteArray(3 * mp::sparse::block_size, 'x');
+    const auto zeros = QByteArray(3 * mp::sparse::block_size + 17, '\0');
+    const auto odd = QByteArray(5, 'y');
+
+    EXPECT_EQ(write_through_writer({odd, zeros, data, zeros, odd, zeros}), odd + zeros + data + zeros + odd + zeros);
+}
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+TEST_F(SparseFile, leavesHolesForZeros)
+{
+    const auto data = QByteArray(mp::sparse::block_size, 'x');
+    const auto zeros = QByteArray(256 * mp::sparse::block_size, '\0');
+
+    EXPECT_EQ(write_through_writer({data, zeros, data}).size(), data.size() * 2 + zeros.size());
+
+    struct stat info;
+    ASSERT_EQ(::stat(QFile::encodeName(path).constData(), &info), 0);
+    EXPECT_LT(info.st_blocks * 512, zeros.size());
+}
+#endif
+} // namespace
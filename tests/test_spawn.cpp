@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "test_with_mocked_bin_path.h"
+
+#include <multipass/performance_counters.h>
+#include <multipass/spawn.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace testing;
+
+namespace
+{
+struct SpawnTest : public mpt::TestWithMockedBinPath
+{
+};
+
+TEST_F(SpawnTest, reportsMissingCommands)
+{
+    auto result = mpu::spawn_and_wait("a_missing_command", {});
+
+    EXPECT_FALSE(result.state.exit_code);
+    ASSERT_TRUE(result.state.error);
+    EXPECT_EQ(result.state.error->state, QProcess::FailedToStart);
+}
+
+TEST_F(SpawnTest, reportsCrashes)
+{
+    auto result = mpu::spawn_and_wait("mock_process", {}); // crashes without arguments
+
+    EXPECT_FALSE(result.state.exit_code);
+    ASSERT_TRUE(result.state.error);
+    EXPECT_EQ(result.state.error->state, QProcess::Crashed);
+}
+
+TEST_F(SpawnTest, reportsExitCodes)
+{
+    auto result = mpu::spawn_and_wait("mock_process", {"7"});
+
+    EXPECT_FALSE(result.state.completed_successfully());
+    ASSERT_TRUE(result.state.exit_code);
+    EXPECT_EQ(*result.state.exit_code, 7);
+    EXPECT_FALSE(result.state.error);
+}
+
+TEST_F(SpawnTest, feedsInputAndCapturesOutputAndError)
+{
+    mpu::SpawnOptions options;
+    options.standard_input = "hello";
+
+    auto result = mpu::spawn_and_wait("mock_process", {"0", "stay-alive"}, options); // echoes to both
+
+    EXPECT_TRUE(result.state.completed_successfully());
+    EXPECT_EQ(result.standard_output, "hello");
+    EXPECT_EQ(result.standard_error, "hello");
+}
+
+TEST_F(SpawnTest, mergesChannelsOnRequest)
+{
+    mpu::SpawnOptions options;
+    options.standard_input = "hi";
+    options.merge_channels = true;
+
+    auto result = mpu::spawn_and_wait("mock_process", {"0", "stay-alive"}, options);
+
+    EXPECT_TRUE(result.state.completed_successfully());
+    EXPECT_EQ(result.standard_output, "hihi");
+    EXPECT_TRUE(result.standard_error.isEmpty());
+}
+
+TEST_F(SpawnTest, killsProcessesThatOutstayTheTimeout)
+{
+    mpu::SpawnOptions options;
+    options.timeout = 100;
+
+    auto result = mpu::spawn_and_wait("sleep", {"10"}, options);
+
+    ASSERT_TRUE(result.state.error);
+    EXPECT_EQ(result.state.error->state, QProcess::Timedout);
+}
+
+TEST_F(SpawnTest, accountsForSpawnsAndFailures)
+{
+    auto& spawns = MP_PERF_COUNTERS.counter("multipass_process_spawns", {{"program", "mock_process"}});
+    auto& failures = MP_PERF_COUNTERS.counter("multipass_process_failures", {{"program", "mock_process"}});
+    const auto spawned = spawns.load(), failed = failures.load();
+
+    mpu::spawn_and_wait("mock_process", {"0"});
+    mpu::spawn_and_wait("mock_process", {"7"});
+
+    EXPECT_EQ(spawns - spawned, 2u);
+    EXPECT_EQ(failures - failed, 1u);
+}
+} // namespace
@@ -119,3 +119,26 @@ TEST_F(SSHClient, throw_when_request_exec_fails)
 
     EXPECT_THROW(client.exec({"foo"}), std::runtime_error);
 }
+
+TEST_F(SSHClient, bulkModeReadsOutputIntoALargeBuffer)
+{
+    auto client = make_ssh_client();
+    client.set_output_mode(mp::SSHClient::OutputMode::bulk);
+
+    mock_ssh_test_fixture.is_eof.returnValue(0);
+    REPLACE(ssh_event_dopoll, [this](auto...) {
+        mock_ssh_test_fixture.is_eof.returnValue(true);
+        return SSH_OK;
+    });
+
+    std::vector<uint32_t> reads;
+    REPLACE(ssh_channel_read_timeout, [&reads](ssh_channel, void*, uint32_t count, int is_stderr, int) {
+        EXPECT_EQ(is_stderr, 0);
+        reads.push_back(count);
+        return 0;
+    });
+
+    EXPECT_EQ(client.exec({"foo"}), SSH_OK);
+    EXPECT_THAT(reads, testing::Not(testing::IsEmpty()));
+    EXPECT_THAT(reads, testing::Each(testing::Ge(64u * 1024)));
+}
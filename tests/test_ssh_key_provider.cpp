@@ -96,3 +96,12 @@ TEST_F(SSHKeyProvider, public_key_is_stable)
 
     EXPECT_THAT(key_one, StrEq(key_two));
 }
+
+TEST_F(SSHKeyProvider, private_key_is_read_once)
+{
+    mp::OpenSSHKeyProvider key_provider{key_dir.path()};
+    const auto key = key_provider.private_key_as_base64();
+
+    ASSERT_TRUE(QFile::remove(QDir{key_dir.path()}.filePath("ssh-keys/id_rsa")));
+    EXPECT_THAT(key_provider.private_key_as_base64(), AllOf(StrEq(key), StrNe("")));
+}
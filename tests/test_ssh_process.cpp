@@ -143,3 +143,30 @@ TEST_F(SSHProcess, can_read_output)
 
     EXPECT_THAT(output, StrEq(expected_output));
 }
+
+TEST_F(SSHProcess, hands_large_output_over_in_big_chunks)
+{
+    const std::string expected_output(3 * 1024 * 1024 + 17, 'x');
+    auto remaining = expected_output.size();
+    auto reads = 0;
+    auto channel_read = [&](ssh_channel, void* dest, uint32_t count, int, int) {
+        ++reads;
+        const auto num_to_copy = std::min(count, static_cast<uint32_t>(remaining));
+        std::copy_n(expected_output.end() - remaining, num_to_copy, reinterpret_cast<char*>(dest));
+        remaining -= num_to_copy;
+        return num_to_copy;
+    };
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto proc = session.exec("something");
+    std::string output;
+    auto chunks = 0;
+    proc.read_std_output([&output, &chunks](const char* data, std::size_t size) {
+        ++chunks;
+        output.append(data, size);
+    });
+
+    EXPECT_EQ(output, expected_output);
+    EXPECT_EQ(chunks, reads - 1); // the last read only finds the end of the stream
+    EXPECT_LE(reads, 50);
+}
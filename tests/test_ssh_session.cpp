@@ -16,11 +16,20 @@
  */
 
 #include "common.h"
+#include "mock_environment_helpers.h"
 #include "mock_ssh.h"
+#include "mock_ssh_process_exit_status.h"
+#include "network_conditions.h"
+#include "simulated_ssh_network.h"
 #include "stub_ssh_key_provider.h"
 
+#include <multipass/exceptions/ssh_exception.h>
 #include <multipass/ssh/ssh_session.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace mp = multipass;
 using namespace testing;
 
@@ -50,6 +59,60 @@ TEST(SSHSession, throws_when_unable_to_auth)
     EXPECT_THROW(mp::SSHSession("theanswertoeverything", 42, "ubuntu", key_provider), std::runtime_error);
 }
 
+TEST(SSHSession, asks_for_compression_only_when_told)
+{
+    mp::test::StubSSHKeyProvider key_provider;
+    std::vector<std::string> compression;
+    REPLACE(ssh_options_set, [&compression](auto, ssh_options_e type, const void* value) {
+        if (type == SSH_OPTIONS_COMPRESSION)
+            compression.emplace_back(static_cast<const char*>(value));
+        return SSH_OK;
+    });
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+    REPLACE(ssh_userauth_publickey, [](auto...) { return SSH_AUTH_SUCCESS; });
+
+    mp::SSHSession{"theanswertoeverything", 42, "ubuntu", key_provider};
+    mp::SSHSession{"theanswertoeverything", 42, "ubuntu", key_provider, std::chrono::seconds(1), true};
+
+    EXPECT_THAT(compression, ElementsAre("no", "yes"));
+}
+
+TEST(SSHSession, prefers_curve25519_and_fast_ciphers)
+{
+    std::string ciphers, kex;
+    REPLACE(ssh_options_set, [&ciphers, &kex](auto, ssh_options_e type, const void* value) {
+        if (type == SSH_OPTIONS_CIPHERS_C_S)
+            ciphers = static_cast<const char*>(value);
+        else if (type == SSH_OPTIONS_KEY_EXCHANGE)
+            kex = static_cast<const char*>(value);
+        return SSH_OK;
+    });
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+
+    mp::SSHSession{"theanswertoeverything", 42};
+
+    EXPECT_THAT(ciphers, AnyOf(StartsWith("aes128-gcm@openssh.com"), StartsWith("chacha20-poly1305@openssh.com")));
+    EXPECT_THAT(kex, StartsWith("curve25519-sha256"));
+}
+
+TEST(SSHSession, takes_algorithms_from_the_environment)
+{
+    mp::test::SetEnvScope ciphers_env{"MULTIPASS_SSH_CIPHERS", "aes256-ctr"};
+    mp::test::SetEnvScope kex_env{"MULTIPASS_SSH_KEX", "ecdh-sha2-nistp256"};
+
+    std::vector<std::string> algorithms;
+    REPLACE(ssh_options_set, [&algorithms](auto, ssh_options_e type, const void* value) {
+        if (type == SSH_OPTIONS_CIPHERS_C_S || type == SSH_OPTIONS_CIPHERS_S_C || type == SSH_OPTIONS_KEY_EXCHANGE)
+            algorithms.emplace_back(static_cast<const char*>(value));
+        return SSH_OK;
+    });
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+
+    mp::SSHSession{"theanswertoeverything", 42};
+
+    EXPECT_THAT(algorithms, ElementsAre("aes256-ctr", "aes256-ctr", "ecdh-sha2-nistp256"));
+}
+
 TEST(SSHSession, exec_throws_on_a_dead_session)
 {
     REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
@@ -100,3 +163,91 @@ TEST(SSHSession, exec_succeeds)
 
     EXPECT_NO_THROW(session.exec("dummy"));
 }
+
+TEST(SSHSession, exec_batch_runs_all_commands_through_one_channel)
+{
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+    mp::SSHSession session{"theanswertoeverything", 42};
+
+    std::vector<std::string> execs;
+    REPLACE(ssh_is_connected, [](auto...) { return true; });
+    REPLACE(ssh_channel_open_session, [](auto...) { return SSH_OK; });
+    REPLACE(ssh_channel_request_exec, [&execs](ssh_channel, const char* cmd) {
+        execs.emplace_back(cmd);
+        return SSH_OK;
+    });
+
+    const std::string output{"MULTIPASS_BATCH 0 5 0\n1000\nMULTIPASS_BATCH 2 0 13\nno such file\n"
+                             "MULTIPASS_BATCH 0 28 0\nMULTIPASS_BATCH 0 0 0\nlooks\n"};
+    auto remaining = output.size();
+    REPLACE(ssh_channel_read_timeout, [&output, &remaining](ssh_channel, void* dest, uint32_t count, int, int) {
+        const auto num_to_copy = std::min(count, static_cast<uint32_t>(remaining));
+        std::copy_n(output.end() - remaining, num_to_copy, static_cast<char*>(dest));
+        remaining -= num_to_copy;
+        return num_to_copy;
+    });
+    mp::test::ExitStatusMock exit_status_mock;
+
+    auto results = session.exec_batch({"id -u", "ls /nowhere", "echo the framing, or so it looks"});
+
+    ASSERT_EQ(execs.size(), 1u);
+    EXPECT_THAT(execs.front(), AllOf(HasSubstr("id -u"), HasSubstr("ls /nowhere")));
+
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].exit_code, 0);
+    EXPECT_EQ(results[0].std_output, "1000\n");
+    EXPECT_EQ(results[1].exit_code, 2);
+    EXPECT_EQ(results[1].std_error, "no such file\n");
+    EXPECT_EQ(results[2].std_output, "MULTIPASS_BATCH 0 0 0\nlooks\n");
+}
+
+TEST(SSHSession, exec_batch_throws_on_truncated_output)
+{
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+    mp::SSHSession session{"theanswertoeverything", 42};
+
+    REPLACE(ssh_is_connected, [](auto...) { return true; });
+    REPLACE(ssh_channel_open_session, [](auto...) { return SSH_OK; });
+    REPLACE(ssh_channel_request_exec, [](auto...) { return SSH_OK; });
+
+    const std::string output{"MULTIPASS_BATCH 0 5 0\n1000\nMULTIPASS_BATCH 0 9 0\nabc"};
+    auto remaining = output.size();
+    REPLACE(ssh_channel_read_timeout, [&output, &remaining](ssh_channel, void* dest, uint32_t count, int, int) {
+        const auto num_to_copy = std::min(count, static_cast<uint32_t>(remaining));
+        std::copy_n(output.end() - remaining, num_to_copy, static_cast<char*>(dest));
+        remaining -= num_to_copy;
+        return num_to_copy;
+    });
+    mp::test::ExitStatusMock exit_status_mock;
+
+    EXPECT_THROW(session.exec_batch({"id -u", "cat something"}), mp::SSHException);
+}
+
+TEST(SSHSession, exec_batch_takes_the_round_trips_of_a_single_exec)
+{
+    REPLACE(ssh_connect, [](auto...) { return SSH_OK; });
+    mp::SSHSession session{"theanswertoeverything", 42};
+
+    REPLACE(ssh_is_connected, [](auto...) { return true; });
+    REPLACE(ssh_channel_open_session, [](auto...) { return SSH_OK; });
+    REPLACE(ssh_channel_request_exec, [](auto...) { return SSH_OK; });
+
+    const std::string output{"MULTIPASS_BATCH 0 0 0\nMULTIPASS_BATCH 0 0 0\nMULTIPASS_BATCH 0 0 0\n"};
+    auto remaining = output.size();
+    REPLACE(ssh_channel_read_timeout, [&output, &remaining](ssh_channel, void* dest, uint32_t count, int, int) {
+        const auto num_to_copy = std::min(count, static_cast<uint32_t>(remaining));
+        std::copy_n(output.end() - remaining, num_to_copy, static_cast<char*>(dest));
+        remaining -= num_to_copy;
+        return num_to_copy;
+    });
+    mp::test::ExitStatusMock exit_status_mock;
+
+    mp::test::NetworkConditions wan;
+    wan.latency = std::chrono::milliseconds{20};
+    mp::test::SimulatedSSHNetwork network{wan};
+
+    session.exec_batch({"true", "true", "true"});
+
+    EXPECT_EQ(wan.round_trips(), 2); // opening the channel and asking for the exec
+    EXPECT_EQ(wan.bytes_transferred(), static_cast<std::int64_t>(output.size()));
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "mock_ssh_test_fixture.h"
+#include "stub_ssh_key_provider.h"
+
+#include <multipass/ssh/ssh_session_pool.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct SSHSessionPool : public Test
+{
+    void expect_connections(std::size_t n)
+    {
+        EXPECT_NO_THROW(ssh.connect.expectCalled(n));
+    }
+
+    mpt::MockSSHTestFixture ssh;
+    mpt::StubSSHKeyProvider key_provider;
+    mp::SSHSessionPool pool{key_provider};
+};
+
+TEST_F(SSHSessionPool, reuses_returned_sessions)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+    }
+    auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(1);
+}
+
+TEST_F(SSHSessionPool, opens_another_session_while_one_is_leased)
+{
+    auto first = pool.acquire("asdf", "host", 22, "ubuntu");
+    auto second = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+
+TEST_F(SSHSessionPool, does_not_reuse_sessions_to_another_endpoint)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+    }
+    auto lease = pool.acquire("asdf", "other-host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+
+TEST_F(SSHSessionPool, drops_disconnected_sessions)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+        ssh.is_connected.returnValue(false);
+    }
+    ssh.is_connected.returnValue(true);
+    auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+
+TEST_F(SSHSessionPool, drops_sessions_on_eviction)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+    }
+    pool.evict("asdf");
+    auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+
+TEST_F(SSHSessionPool, does_not_take_back_sessions_leased_before_eviction)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+        pool.evict("asdf");
+    }
+    auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+
+TEST_F(SSHSessionPool, does_not_take_back_taken_sessions)
+{
+    {
+        auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+        auto session = lease.take();
+    }
+    auto lease = pool.acquire("asdf", "host", 22, "ubuntu");
+
+    expect_connections(2);
+}
+} // namespace
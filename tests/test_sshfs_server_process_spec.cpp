@@ -51,7 +51,7 @@ TEST_F(TestSSHFSServerProcessSpec, program_correct)
 TEST_F(TestSSHFSServerProcessSpec, arguments_correct)
 {
     mp::SSHFSServerProcessSpec spec(config);
-    ASSERT_EQ(spec.arguments().size(), 8);
+    ASSERT_EQ(spec.arguments().size(), 10);
     EXPECT_EQ(spec.arguments()[0], "host");
     EXPECT_EQ(spec.arguments()[1], "42");
     EXPECT_EQ(spec.arguments()[2], "username");
@@ -61,6 +61,8 @@ TEST_F(TestSSHFSServerProcessSpec, arguments_correct)
     EXPECT_TRUE(spec.arguments()[5] == "6:10,5:-1," || spec.arguments()[5] == "5:-1,6:10,");
     EXPECT_TRUE(spec.arguments()[6] == "3:4,1:2," || spec.arguments()[6] == "1:2,3:4,");
     EXPECT_EQ(spec.arguments()[7], "0");
+    EXPECT_EQ(spec.arguments()[8], "0");
+    EXPECT_EQ(spec.arguments()[9], "");
 }
 
 TEST_F(TestSSHFSServerProcessSpec, environment_correct)
@@ -69,6 +71,15 @@ TEST_F(TestSSHFSServerProcessSpec, environment_correct)
 
     ASSERT_TRUE(spec.environment().contains("KEY"));
     EXPECT_EQ(spec.environment().value("KEY"), "private_key");
+    EXPECT_FALSE(spec.environment().contains("SSHFS_INSTANCE_INFO"));
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_passes_on_known_instance_info)
+{
+    config.instance_info = "1000:1000:3.0.0:/usr/bin/sshfs";
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_EQ(spec.environment().value("SSHFS_INSTANCE_INFO"), "1000:1000:3.0.0:/usr/bin/sshfs");
 }
 
 TEST_F(TestSSHFSServerProcessSpec, snap_confined_apparmor_profile_returns_expected_data)
@@ -50,7 +50,7 @@ struct SshfsMount : public mp::test::SftpServerTest
     {
         mp::SSHSession session{"a", 42};
         return {std::move(session), default_source, target.value_or(default_target), default_mappings,
-                default_mappings};
+                default_mappings, 0, profile, known_info};
     }
 
     auto make_exec_that_fails_for(const std::vector<std::string>& expected_cmds, bool& invoked)
@@ -71,6 +71,16 @@ struct SshfsMount : public mp::test::SftpServerTest
         return request_exec;
     }
 
+    // Answers the checks that install_sshfs_for batches up, with the given exit codes
+    auto make_sshfs_install_checks_read_return(int which_snap_exit_code, int snap_dir_exit_code)
+    {
+        install_checks_output = fmt::format("MULTIPASS_BATCH {} 0 0\nMULTIPASS_BATCH {} 0 0\n", which_snap_exit_code,
+                                            snap_dir_exit_code);
+        install_checks_remaining = install_checks_output.size();
+
+        return make_channel_read_return(install_checks_output, install_checks_remaining, install_checks_ready);
+    }
+
     // The 'invoked' parameter binds the execution and read mocks. We need a better mechanism to make them
     // cooperate better, i.e., make the reader read only when a command was issued.
     auto make_exec_to_check_commands(const CommandVector& commands, std::string::size_type& remaining,
@@ -176,8 +186,14 @@ struct SshfsMount : public mp::test::SftpServerTest
 
     mpt::ExitStatusMock exit_status_mock;
 
+    std::string install_checks_output;
+    std::string::size_type install_checks_remaining{0};
+    bool install_checks_ready{true};
+
     std::string default_source{"source"};
     std::string default_target{"target"};
+    std::string profile{mp::default_sshfs_mount_profile};
+    mp::optional<mp::SshfsInstanceInfo> known_info;
     mp::id_mappings default_mappings;
     int default_id{1000};
     mpt::MockLogger::Scope logger_scope = mpt::MockLogger::inject();
@@ -400,6 +416,25 @@ TEST_F(SshfsMount, unblocks_when_sftpserver_exits)
     EXPECT_TRUE(stopped_ok);
 }
 
+TEST_F(SshfsMount, bulk_profile_raises_fuse_request_sizes)
+{
+    CommandVector commands = {
+        {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -V", "FUSE library version: 3.0.0\n"},
+        {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave -o transform_symlinks -o allow_other -o "
+         "Compression=no -o dcache_timeout=3 -o max_read=131072 -o max_write=131072 :\"source\" "
+         "\"/home/ubuntu/target\"",
+         "don't care\n"}};
+
+    profile = "bulk";
+    test_command_execution(commands);
+}
+
+TEST_F(SshfsMount, throws_on_unknown_profile)
+{
+    profile = "turbo";
+    EXPECT_THROW(make_sshfsmount(), std::invalid_argument);
+}
+
 TEST_F(SshfsMount, blank_fuse_version_logs_error)
 {
     CommandVector commands = {{"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -V", "FUSE library version:\n"}};
@@ -416,32 +451,74 @@ TEST_F(SshfsMount, blank_fuse_version_logs_error)
     test_command_execution(commands);
 }
 
+TEST_F(SshfsMount, skips_looking_into_the_instance_when_it_is_known)
+{
+    // Had it asked, it would have found the snap's sshfs, and 1000 for both ids
+    known_info = mp::SshfsInstanceInfo{"/usr/bin/sshfs", "2.9.0", 1001, 1002};
+    CommandVector commands = {
+        {"sudo /bin/bash -c 'cd \"/home/ubuntu/\" && chown -R 1001:1002 \"target\"'", "\n"},
+        {"sudo /usr/bin/sshfs -o slave -o transform_symlinks -o allow_other -o Compression=no -o nonempty -o "
+         "cache_timeout=3 :\"source\" \"/home/ubuntu/target\"",
+         "don't care\n"}};
+
+    test_command_execution(commands);
+}
+
+TEST_F(SshfsMount, instance_info_survives_serialisation)
+{
+    const mp::SshfsInstanceInfo info{"env LD_LIBRARY_PATH=/a:/b /baz/bin/sshfs", "", 1000, 1001};
+
+    auto read = mp::SshfsInstanceInfo::deserialise(info.serialise());
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->sshfs_exec, info.sshfs_exec);
+    EXPECT_EQ(read->fuse_version, info.fuse_version);
+    EXPECT_EQ(read->uid, info.uid);
+    EXPECT_EQ(read->gid, info.gid);
+
+    EXPECT_FALSE(mp::SshfsInstanceInfo::deserialise(""));
+    EXPECT_FALSE(mp::SshfsInstanceInfo::deserialise("ubuntu:1000:3.0.0:/usr/bin/sshfs"));
+}
+
 TEST_F(SshfsMount, throws_install_sshfs_which_snap_fails)
 {
-    bool invoked{false};
-    auto request_exec = make_exec_that_fails_for({"which snap"}, invoked);
-    REPLACE(ssh_channel_request_exec, request_exec);
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(1, 0));
 
     mp::SSHSession session{"a", 42};
 
-    EXPECT_THROW(mp::utils::install_sshfs_for("foo", session), std::runtime_error);
-    EXPECT_TRUE(invoked);
+    MP_EXPECT_THROW_THAT(mp::utils::install_sshfs_for("foo", session), std::runtime_error,
+                         mpt::match_what(HasSubstr("Snap support needs to be installed")));
 }
 
 TEST_F(SshfsMount, throws_install_sshfs_no_snap_dir_fails)
 {
-    bool invoked{false};
-    auto request_exec = make_exec_that_fails_for({"[ -e /snap ]"}, invoked);
-    REPLACE(ssh_channel_request_exec, request_exec);
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(0, 1));
 
     mp::SSHSession session{"a", 42};
 
-    EXPECT_THROW(mp::utils::install_sshfs_for("foo", session), std::runtime_error);
-    EXPECT_TRUE(invoked);
+    MP_EXPECT_THROW_THAT(mp::utils::install_sshfs_for("foo", session), std::runtime_error,
+                         mpt::match_what(HasSubstr("Classic snap support is not enabled")));
+}
+
+TEST_F(SshfsMount, install_sshfs_checks_the_instance_over_one_channel)
+{
+    std::vector<std::string> execs;
+    REPLACE(ssh_channel_request_exec, [&execs](ssh_channel, const char* cmd) {
+        execs.emplace_back(cmd);
+        return SSH_OK;
+    });
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(0, 0));
+
+    mp::SSHSession session{"a", 42};
+    mp::utils::install_sshfs_for("foo", session);
+
+    ASSERT_EQ(execs.size(), 2u);
+    EXPECT_THAT(execs[0], AllOf(HasSubstr("which snap"), HasSubstr("[ -e /snap ]")));
+    EXPECT_EQ(execs[1], "sudo snap install multipass-sshfs");
 }
 
 TEST_F(SshfsMount, throws_install_sshfs_snap_install_fails)
 {
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(0, 0));
     bool invoked{false};
     auto request_exec = make_exec_that_fails_for({"sudo snap install multipass-sshfs"}, invoked);
     REPLACE(ssh_channel_request_exec, request_exec);
@@ -454,6 +531,7 @@ TEST_F(SshfsMount, throws_install_sshfs_snap_install_fails)
 
 TEST_F(SshfsMount, install_sshfs_no_failures_does_not_throw)
 {
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(0, 0));
     mp::SSHSession session{"a", 42};
 
     EXPECT_NO_THROW(mp::utils::install_sshfs_for("foo", session));
@@ -461,6 +539,7 @@ TEST_F(SshfsMount, install_sshfs_no_failures_does_not_throw)
 
 TEST_F(SshfsMount, install_sshfs_timeout_logs_info)
 {
+    REPLACE(ssh_channel_read_timeout, make_sshfs_install_checks_read_return(0, 0));
     ssh_channel_callbacks callbacks{nullptr};
     bool sleep{false};
 
@@ -26,6 +26,7 @@
 #include <multipass/sshfs_mount/sshfs_mounts.h>
 
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QTimer>
 
 namespace mp = multipass;
@@ -45,7 +46,7 @@ struct SSHFSMountsTest : public ::Test
     }
 
     mpt::StubSSHKeyProvider key_provider;
-    std::string source_path{"/my/source/path"}, target_path{"/the/target/path"};
+    std::string source_path{"/my/source/path"}, target_path{"/the/target/path"}, profile{"bulk"};
     mp::id_mappings gid_mappings{{1, 2}, {3, 4}}, uid_mappings{{5, -1}, {6, 10}};
     mpt::SetEnvScope env_scope{"DISABLE_APPARMOR", "1"};
     mpt::MockLogger::Scope logger_scope = mpt::MockLogger::inject(default_log_level);
@@ -76,13 +77,13 @@ TEST_F(SSHFSMountsTest, mount_creates_sshfs_process)
     EXPECT_CALL(vm, ssh_hostname());
     EXPECT_CALL(vm, ssh_username());
 
-    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
 
     ASSERT_EQ(factory->process_list().size(), 1u);
     auto sshfs_command = factory->process_list()[0];
     EXPECT_TRUE(sshfs_command.command.endsWith("sshfs_server"));
 
-    ASSERT_EQ(sshfs_command.arguments.size(), 8);
+    ASSERT_EQ(sshfs_command.arguments.size(), 10);
     EXPECT_EQ(sshfs_command.arguments[0], "localhost");
     EXPECT_EQ(sshfs_command.arguments[1], "42");
     EXPECT_EQ(sshfs_command.arguments[2], "ubuntu");
@@ -94,6 +95,7 @@ TEST_F(SSHFSMountsTest, mount_creates_sshfs_process)
 
     const QString log_level_as_string{QString::number(static_cast<int>(default_log_level))};
     EXPECT_EQ(sshfs_command.arguments[7], log_level_as_string);
+    EXPECT_EQ(sshfs_command.arguments[9], "bulk");
 }
 
 TEST_F(SSHFSMountsTest, sshfs_process_failing_with_return_code_9_causes_exception)
@@ -117,7 +119,7 @@ TEST_F(SSHFSMountsTest, sshfs_process_failing_with_return_code_9_causes_exceptio
     mp::SSHFSMounts sshfs_mounts(key_provider);
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    EXPECT_THROW(sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings),
+    EXPECT_THROW(sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile),
                  mp::SSHFSMissingError);
 
     ASSERT_EQ(factory->process_list().size(), 1u);
@@ -149,7 +151,7 @@ TEST_F(SSHFSMountsTest, sshfs_process_failing_causes_runtime_exception)
 
     EXPECT_THROW(
         try {
-            sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+            sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
         } catch (const std::runtime_error& e) {
             EXPECT_STREQ(e.what(), "Process returned exit code: 1: Whoopsie");
             throw;
@@ -174,7 +176,7 @@ TEST_F(SSHFSMountsTest, stop_terminates_sshfs_process)
 
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
     int ret = sshfs_mounts.stop_mount(vm.vm_name, target_path);
     ASSERT_TRUE(ret);
 }
@@ -196,13 +198,49 @@ TEST_F(SSHFSMountsTest, stop_all_mounts_terminates_all_sshfs_processes)
 
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_mappings, uid_mappings);
-    sshfs_mounts.start_mount(&vm, "/source/two", "/target/two", gid_mappings, uid_mappings);
-    sshfs_mounts.start_mount(&vm, "/source/three", "/target/three", gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_mappings, uid_mappings, profile);
+    sshfs_mounts.start_mount(&vm, "/source/two", "/target/two", gid_mappings, uid_mappings, profile);
+    sshfs_mounts.start_mount(&vm, "/source/three", "/target/three", gid_mappings, uid_mappings, profile);
 
     sshfs_mounts.stop_all_mounts_for_instance(vm.vm_name);
 }
 
+TEST_F(SSHFSMountsTest, kills_sshfs_processes_that_do_not_stop_in_time)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    auto killed = 0;
+    mpt::MockProcessFactory::Callback sshfs_ignores_terminate = [this, &killed](mpt::MockProcess* process) {
+        sshfs_prints_connected(process);
+
+        if (process->program().contains("sshfs_server"))
+        {
+            EXPECT_CALL(*process, terminate); // and does nothing about it
+            EXPECT_CALL(*process, kill).WillOnce([process, &killed] {
+                ++killed;
+                emit process->finished(mp::ProcessState{});
+            });
+        }
+    };
+    factory->register_callback(sshfs_ignores_terminate);
+
+    mp::SSHFSMounts sshfs_mounts(key_provider, std::chrono::milliseconds{10});
+
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_mappings, uid_mappings, profile);
+    sshfs_mounts.start_mount(&vm, "/source/two", "/target/two", gid_mappings, uid_mappings, profile);
+
+    sshfs_mounts.stop_all_mounts_for_instance(vm.vm_name);
+    EXPECT_EQ(killed, 0); // not waited for
+    EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/one"));
+
+    QEventLoop event_loop;
+    QTimer::singleShot(100, &event_loop, &QEventLoop::quit);
+    event_loop.exec();
+
+    EXPECT_EQ(killed, 2);
+}
+
 TEST_F(SSHFSMountsTest, has_instance_already_mounted_returns_true_when_found)
 {
     auto factory = mpt::MockProcessFactory::Inject();
@@ -212,7 +250,7 @@ TEST_F(SSHFSMountsTest, has_instance_already_mounted_returns_true_when_found)
 
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
 
     EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, target_path));
 }
@@ -226,7 +264,7 @@ TEST_F(SSHFSMountsTest, has_instance_already_mounted_returns_false_when_no_such_
 
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
 
     EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/bad/path"));
 }
@@ -240,7 +278,73 @@ TEST_F(SSHFSMountsTest, has_instance_already_mounted_returns_false_when_no_such_
 
     NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
 
-    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings);
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_mappings, uid_mappings, profile);
 
     EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted("bad_vm_name", target_path));
 }
+
+TEST_F(SSHFSMountsTest, start_mounts_starts_all_servers_and_reports_failures_by_target)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    std::vector<std::string> started;
+    mpt::MockProcessFactory::Callback sshfs_connects_or_fails = [this, &started](mpt::MockProcess* process) {
+        if (!process->program().contains("sshfs_server"))
+            return;
+
+        const auto target = process->arguments()[4];
+        EXPECT_CALL(*process, start).WillOnce([&started, target] { started.push_back(target.toStdString()); });
+
+        if (target != "/target/bad")
+        {
+            sshfs_prints_connected(process);
+            return;
+        }
+
+        mp::ProcessState exit_state;
+        exit_state.exit_code = 9;
+        QTimer::singleShot(100, process, [process, exit_state]() { emit process->finished(exit_state); });
+        ON_CALL(*process, process_state()).WillByDefault(Return(exit_state));
+    };
+    factory->register_callback(sshfs_connects_or_fails);
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    auto failures =
+        sshfs_mounts.start_mounts(&vm, {{"/source/one", "/target/one", gid_mappings, uid_mappings, profile},
+                                        {"/source/bad", "/target/bad", gid_mappings, uid_mappings, profile},
+                                        {"/source/two", "/target/two", gid_mappings, uid_mappings, profile}});
+
+    EXPECT_THAT(started, ElementsAre("/target/one", "/target/bad", "/target/two"));
+    ASSERT_EQ(failures.size(), 1u);
+    EXPECT_THROW(std::rethrow_exception(failures.at("/target/bad")), mp::SSHFSMissingError);
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/one"));
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/two"));
+    EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/bad"));
+}
+
+TEST_F(SSHFSMountsTest, passes_what_a_mount_learnt_about_the_instance_on_to_the_next_ones)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    std::vector<QString> passed_on;
+    mpt::MockProcessFactory::Callback sshfs_reports_instance = [this, &passed_on](mpt::MockProcess* process) {
+        if (!process->program().contains("sshfs_server"))
+            return;
+
+        passed_on.push_back(process->process_environment().value("SSHFS_INSTANCE_INFO"));
+        sshfs_prints_connected(process);
+        ON_CALL(*process, read_all_standard_output())
+            .WillByDefault(Return("Instance: 1000:1000:3.0.0:/usr/bin/sshfs\nConnected"));
+    };
+    factory->register_callback(sshfs_reports_instance);
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, source_path, "/first", gid_mappings, uid_mappings, profile);
+    sshfs_mounts.start_mount(&vm, source_path, "/second", gid_mappings, uid_mappings, profile);
+    sshfs_mounts.stop_all_mounts_for_instance(vm.vm_name);
+    sshfs_mounts.start_mount(&vm, source_path, "/third", gid_mappings, uid_mappings, profile);
+
+    EXPECT_THAT(passed_on, ElementsAre("", "1000:1000:3.0.0:/usr/bin/sshfs", ""));
+}
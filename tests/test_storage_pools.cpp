@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/storage_pools.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+using namespace testing;
+
+namespace
+{
+TEST(StoragePools, parses_named_directories)
+{
+    const auto pools = mp::parse_storage_pools("fast=/mnt/nvme/multipass, bulk=/srv/multipass/");
+
+    EXPECT_THAT(pools,
+                ElementsAre(Pair("bulk", QString{"/srv/multipass"}), Pair("fast", QString{"/mnt/nvme/multipass"})));
+}
+
+TEST(StoragePools, has_none_by_default)
+{
+    EXPECT_THAT(mp::parse_storage_pools(""), IsEmpty());
+}
+
+struct BadStoragePools : public TestWithParam<const char*>
+{
+};
+
+TEST_P(BadStoragePools, are_rejected)
+{
+    EXPECT_THROW(mp::parse_storage_pools(GetParam()), std::invalid_argument);
+}
+
+INSTANTIATE_TEST_SUITE_P(StoragePools, BadStoragePools,
+                         Values("/srv/multipass", "fast=relative/path", "bad_name=/srv/multipass",
+                                "fast=/mnt/nvme,fast=/srv/multipass"));
+} // namespace
@@ -22,7 +22,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace mp = multipass;
 namespace mpu = multipass::utils;
@@ -48,231 +51,208 @@ struct MockTimerSyncFuncs : public mpu::TimerSyncFuncs
 struct TestTimer : public testing::Test
 {
     TestTimer()
-        : t{default_timeout, [this] {
-                {
-                    std::lock_guard<std::mutex> test_lock{cv_m};
-                    ++timeout_count;
-                }
-                cv.notify_all();
-            }}
     {
+        ON_CALL(*mock_timer_sync_funcs, notify_all).WillByDefault([this](auto&) { notify(); });
+        ON_CALL(*mock_timer_sync_funcs, wait).WillByDefault(WithArg<1>([this](auto& timer_lock) {
+            park(timer_lock, forever);
+        }));
+        ON_CALL(*mock_timer_sync_funcs, wait_for).WillByDefault([this](auto&, auto& timer_lock, const auto& rel_time) {
+            return park(timer_lock, rel_time);
+        });
     }
 
-    auto mock_wait(std::unique_lock<std::mutex>& timer_lock, std::atomic_bool& target_state)
+    void on_timeout()
     {
-        std::unique_lock<std::mutex> test_lock(cv_m);
+        {
+            std::lock_guard<std::mutex> test_lock{cv_m};
+            ++timeout_count;
+            callback_thread = std::this_thread::get_id();
+        }
+        cv.notify_all();
+    }
 
-        // Unlock the Timer's internal lock
-        timer_lock.unlock();
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> test_lock{cv_m};
+            ++notifications;
+        }
+        cv.notify_all();
+    }
 
-        // Notify the test thread that the timer is running
-        target_state.store(true);
+    // Stands in for the timers' condition variable: only a notification or elapse() ends the wait, never the clock
+    std::cv_status park(std::unique_lock<std::mutex>& timer_lock, std::chrono::milliseconds rel_time)
+    {
+        std::unique_lock<std::mutex> test_lock{cv_m};
+        parked = true;
+        parked_notifications = notifications;
+        parked_elapses = elapses;
+        waits.push_back(rel_time);
         cv.notify_all();
 
-        // Wait for notification from main test thread
-        cv.wait(test_lock, [this] { return test_notify_called.load(); });
-        test_notify_called.store(false);
+        timer_lock.unlock();
+        cv.wait(test_lock, [this] { return !settled(); });
+        const auto status = elapses != parked_elapses ? std::cv_status::timeout : std::cv_status::no_timeout;
+        parked = false;
+        test_lock.unlock();
 
-        // Re-lock the Timer's internal lock before returning
         timer_lock.lock();
+        return status;
     }
 
-    auto make_mock_wait_for(std::cv_status timeout_status)
+    /*
+     * Waits for the timers' thread to park in a new wait that nothing is about to end, and returns how long it means
+     * to wait. Notifications that reach it already parked make it wait over again, which only the last wait shows.
+     */
+    std::chrono::milliseconds next_wait()
     {
-        return [this, timeout_status](std::unique_lock<std::mutex>& timer_lock) {
-            mock_wait(timer_lock, timer_running);
-            return timeout_status;
-        };
+        std::unique_lock<std::mutex> test_lock{cv_m};
+        if (!cv.wait_for(test_lock, default_wait, [this] { return settled() && waits.size() > seen_waits; }))
+        {
+            ADD_FAILURE() << "The timers' thread did not wait";
+            return std::chrono::milliseconds::zero();
+        }
+
+        seen_waits = waits.size();
+        return waits.back();
     }
 
-    void wait_for(const std::atomic_bool& target_state)
+    // Whether the timers' thread is parked, with nothing come since to end its wait
+    bool settled() const
     {
-        std::unique_lock<std::mutex> test_lock(cv_m);
-        cv.wait(test_lock, [&target_state] { return target_state.load(); });
+        return parked && notifications == parked_notifications && elapses == parked_elapses;
     }
 
-    std::unique_lock<std::mutex> notify_test_wait()
+    // Lets the wait the timers' thread is parked in run its course
+    void elapse()
     {
-        std::unique_lock<std::mutex> test_lock(cv_m);
-        test_notify_called.store(true);
+        {
+            std::lock_guard<std::mutex> test_lock{cv_m};
+            ++elapses;
+        }
         cv.notify_all();
-
-        return test_lock;
     }
 
-    void SetUp() override
+    auto about(std::chrono::milliseconds timeout) const
     {
-        ON_CALL(*mock_timer_sync_funcs, wait).WillByDefault(WithArg<1>([this](auto& timer_lock) {
-            mock_wait(timer_lock, timer_paused);
-        }));
-
-        EXPECT_CALL(*mock_timer_sync_funcs, notify_all)
-            .WillOnce(Return())                // Handles the Timer::stop() in Timer::start()
-            .WillRepeatedly([this](auto&...) { // Handles all other notify_all calls in Timer
-                notify_test_wait();            // discard returned lock
-            });
+        return AllOf(Le(timeout), Gt(timeout - default_wait));
     }
 
     std::atomic_int timeout_count{0};
-    std::atomic_bool test_notify_called{false}, timer_running{false}, timer_paused{false};
+    std::thread::id callback_thread;
+    int notifications{0}, elapses{0}, parked_notifications{0}, parked_elapses{0};
+    bool parked{false};
+    std::vector<std::chrono::milliseconds> waits;
+    std::size_t seen_waits{0};
     std::condition_variable cv;
     std::mutex cv_m;
-    const std::chrono::milliseconds default_timeout{10};
-    const std::chrono::seconds default_wait{1};
+    const std::chrono::milliseconds forever = std::chrono::milliseconds::max(); // stands for an untimed wait
+    const std::chrono::milliseconds default_timeout = 1min; // never reached on the clock, only through elapse()
+    const std::chrono::seconds default_wait{5};
 
-    MockTimerSyncFuncs::GuardedMock attr{MockTimerSyncFuncs::inject()};
+    MockTimerSyncFuncs::GuardedMock attr{MockTimerSyncFuncs::inject<NiceMock>()};
     MockTimerSyncFuncs* mock_timer_sync_funcs = attr.first;
-    mpu::Timer t;
+    mpu::Timer t{default_timeout, [this] { on_timeout(); }}; // the last timer, so its end retires the timers' thread
 };
 
 } // namespace
 
 TEST_F(TestTimer, times_out)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::timeout)));
-
     t.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out yet";
 
-    // Notify the mocked wait_for()
-    auto test_lock = notify_test_wait();
-
-    ASSERT_TRUE(cv.wait_for(test_lock, default_wait, [this] { return timeout_count.load() == 1; }))
-        << "Did not time out in reasonable timeframe";
+    elapse();
 
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 1) << "Should have timed out";
 }
 
 TEST_F(TestTimer, stops)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
-
     t.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
 
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
-
-    // stop() blocks until the Timer thread has joined, ie, it is finished
     t.stop();
 
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out";
 }
 
 TEST_F(TestTimer, pauses)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
-    EXPECT_CALL(*mock_timer_sync_funcs, wait);
-
     t.start();
-
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
+    EXPECT_THAT(next_wait(), about(default_timeout));
 
     t.pause();
 
-    // Wait for the the timer to be "paused" in the mocked wait()
-    wait_for(timer_paused);
-
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out";
 }
 
 TEST_F(TestTimer, resumes)
 {
-    // The initial start
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
-
-    // After resume() is called, there should be less time left than the default timeout
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Lt(default_timeout))).WillOnce(Return(std::cv_status::timeout));
-    EXPECT_CALL(*mock_timer_sync_funcs, wait);
-
     t.start();
-
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
+    EXPECT_THAT(next_wait(), about(default_timeout));
 
     t.pause();
-
-    // Wait for the the timer to be "paused" in the mocked wait()
-    wait_for(timer_paused);
+    EXPECT_EQ(next_wait(), forever);
 
     t.resume();
 
-    std::unique_lock<std::mutex> test_lock(cv_m);
-    // Wait on the actual Timer timeout
-    ASSERT_TRUE(cv.wait_for(test_lock, default_wait, [this] { return timeout_count.load() == 1; }))
-        << "Did not time out in reasonable timeframe";
+    // After resume() there should be less time left than the default timeout
+    EXPECT_THAT(next_wait(), AllOf(Lt(default_timeout), Gt(default_timeout - default_wait)));
+    ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out yet";
+
+    elapse();
 
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 1) << "Should have timed out";
 }
 
 TEST_F(TestTimer, stops_paused)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
-    EXPECT_CALL(*mock_timer_sync_funcs, wait);
-
     t.start();
-
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
+    EXPECT_THAT(next_wait(), about(default_timeout));
 
     t.pause();
-
-    // Wait for the the timer to be "paused" in the mocked wait()
-    wait_for(timer_paused);
+    EXPECT_EQ(next_wait(), forever);
 
     t.stop();
+    EXPECT_EQ(next_wait(), forever);
+
+    EXPECT_CALL(*mock_timer_sync_funcs, wait_for).Times(0); // nothing to resume once stopped
+    t.resume();
 
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out";
 }
 
 TEST_F(TestTimer, cancels)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
-
     // Don't use the TestTimer mpu::Timer since we are testing it going out of scope
     {
-        mpu::Timer scoped_timer{default_timeout, [this] { ++timeout_count; }};
+        mpu::Timer scoped_timer{default_timeout, [this] { on_timeout(); }};
         scoped_timer.start();
-
-        // Wait for the the timer to be "running" in the mocked wait_for()
-        wait_for(timer_running);
+        EXPECT_THAT(next_wait(), about(default_timeout));
     }
 
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out";
 }
 
 TEST_F(TestTimer, restarts)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::timeout)));
-
     t.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
 
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
-
-    ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out yet";
     t.start(); // start() will stop the timer if it's running
-
-    // Wait for the the timer to be "running" again in the mocked wait_for()
-    wait_for(timer_running);
-
+    EXPECT_THAT(next_wait(), about(default_timeout));
     ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out yet";
 
-    // Notify the mocked wait_for()
-    auto test_lock = notify_test_wait();
-
-    // Wait on the Timer callback
-    ASSERT_TRUE(cv.wait_for(test_lock, default_wait, [this] { return timeout_count.load() > 0; }))
-        << "Did not time out in reasonable timeframe";
+    elapse();
 
+    EXPECT_EQ(next_wait(), forever);
     ASSERT_EQ(timeout_count.load(), 1) << "Should have timed out once now";
 }
 
@@ -298,15 +278,102 @@ TEST_F(TestTimer, stopped_ignores_resume)
 
 TEST_F(TestTimer, running_ignores_resume)
 {
-    EXPECT_CALL(*mock_timer_sync_funcs, wait_for(_, _, Eq(default_timeout)))
-        .WillOnce(WithArg<1>(make_mock_wait_for(std::cv_status::no_timeout)));
+    t.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
+
+    EXPECT_CALL(*mock_timer_sync_funcs, notify_all).Times(0); // nothing to reschedule
+    t.resume();
+    Mock::VerifyAndClearExpectations(mock_timer_sync_funcs);
+
+    elapse();
+
+    EXPECT_EQ(next_wait(), forever);
+    ASSERT_EQ(timeout_count.load(), 1) << "Should have timed out once";
+}
+
+TEST_F(TestTimer, timers_share_a_thread)
+{
+    mpu::Timer other{default_timeout, [this] { on_timeout(); }};
 
     t.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
+    elapse();
+    EXPECT_EQ(next_wait(), forever);
+    const auto first_thread = callback_thread;
+
+    other.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
+    elapse();
+    EXPECT_EQ(next_wait(), forever);
+
+    ASSERT_EQ(timeout_count.load(), 2);
+    EXPECT_EQ(callback_thread, first_thread);
+    EXPECT_NE(callback_thread, std::this_thread::get_id());
+}
 
-    // Wait for the the timer to be "running" in the mocked wait_for()
-    wait_for(timer_running);
+TEST_F(TestTimer, fires_in_order_of_deadlines)
+{
+    std::vector<int> order;
+    mpu::Timer late{2 * default_timeout, [this, &order] {
+                        order.push_back(2);
+                        on_timeout();
+                    }};
+    mpu::Timer early{default_timeout, [this, &order] {
+                         order.push_back(1);
+                         on_timeout();
+                     }};
 
-    t.resume();
+    late.start();
+    EXPECT_THAT(next_wait(), about(2 * default_timeout));
 
-    ASSERT_EQ(timeout_count.load(), 0) << "Should not have timed out";
+    early.start();
+    EXPECT_THAT(next_wait(), about(default_timeout));
+
+    elapse();
+    EXPECT_THAT(next_wait(), AllOf(Le(2 * default_timeout), Gt(default_timeout - default_wait)));
+
+    elapse();
+    EXPECT_EQ(next_wait(), forever);
+
+    EXPECT_THAT(order, ElementsAre(1, 2));
+}
+
+TEST_F(TestTimer, callback_restarts_its_own_timer)
+{
+    mpu::Timer* self = nullptr;
+    mpu::Timer repeating{default_timeout, [this, &self] {
+                             on_timeout();
+                             if (timeout_count.load() < 3)
+                                 self->start();
+                         }};
+    self = &repeating;
+
+    repeating.start();
+    for (auto i = 0; i < 3; ++i)
+    {
+        EXPECT_THAT(next_wait(), about(default_timeout));
+        elapse();
+    }
+
+    EXPECT_EQ(next_wait(), forever);
+    ASSERT_EQ(timeout_count.load(), 3) << "Should have timed out thrice";
+}
+
+TEST(TestTimerClock, times_out_on_the_clock)
+{
+    std::mutex cv_m;
+    std::condition_variable cv;
+    bool timed_out = false;
+
+    mpu::Timer timer{10ms, [&] {
+                         {
+                             std::lock_guard<std::mutex> lock{cv_m};
+                             timed_out = true;
+                         }
+                         cv.notify_all();
+                     }};
+    timer.start();
+
+    std::unique_lock<std::mutex> lock{cv_m};
+    ASSERT_TRUE(cv.wait_for(lock, 5s, [&timed_out] { return timed_out; })) << "Did not time out in reasonable time";
 }
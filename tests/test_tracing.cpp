@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/tracing.h>
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+const auto traceparent = std::string{"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"};
+
+struct Tracing : public Test
+{
+    ~Tracing()
+    {
+        mp::tracing::enable({});
+    }
+
+    std::vector<QJsonObject> events()
+    {
+        std::vector<QJsonObject> ret;
+        for (const auto& line : mpt::load(trace_file).split('\n'))
+            if (line.startsWith('{'))
+                ret.push_back(QJsonDocument::fromJson(line.chopped(1)).object()); // without the trailing comma
+
+        return ret;
+    }
+
+    mpt::TempDir temp_dir;
+    const QString trace_file{temp_dir.filePath("trace.json")};
+};
+
+TEST_F(Tracing, readsTraceparentHeaders)
+{
+    const auto context = mp::tracing::from_traceparent(traceparent);
+
+    EXPECT_EQ(context.trace_id, "0af7651916cd43dd8448eb211c80319c");
+    EXPECT_EQ(context.span_id, "b7ad6b7169203331");
+    EXPECT_EQ(mp::tracing::to_traceparent(context), traceparent);
+}
+
+TEST_F(Tracing, rejectsMalformedTraceparentHeaders)
+{
+    for (const auto& header : {"", "01-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01",
+                               "00-0AF7651916CD43DD8448EB211C80319C-b7ad6b7169203331-01",
+                               "00-00000000000000000000000000000000-b7ad6b7169203331-01",
+                               "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331"})
+        EXPECT_FALSE(mp::tracing::from_traceparent(header).valid()) << header;
+}
+
+TEST_F(Tracing, spansDoNothingWhenDisabled)
+{
+    {
+        mp::tracing::Span span{"test", "ignored"};
+        EXPECT_FALSE(span.context().valid());
+        EXPECT_FALSE(mp::tracing::current().valid());
+    }
+
+    EXPECT_FALSE(QFile::exists(trace_file));
+}
+
+TEST_F(Tracing, writesSpansUnderTheirParents)
+{
+    mp::tracing::enable(trace_file);
+
+    std::string outer_id;
+    {
+        mp::tracing::Span outer{"test", "outer", mp::tracing::from_traceparent(traceparent)};
+        outer_id = outer.context().span_id;
+
+        mp::tracing::Span inner{"test", "inner"};
+        EXPECT_EQ(mp::tracing::current().span_id, inner.context().span_id);
+    }
+    EXPECT_FALSE(mp::tracing::current().valid());
+
+    const auto written = events();
+    ASSERT_EQ(written.size(), 2u);
+
+    const auto inner = written[0], outer = written[1]; // in the order they ended
+    EXPECT_EQ(inner["name"].toString(), "inner");
+    EXPECT_EQ(inner["ph"].toString(), "X");
+    EXPECT_EQ(inner["args"]["trace_id"].toString(), "0af7651916cd43dd8448eb211c80319c");
+    EXPECT_EQ(inner["args"]["parent_span_id"].toString().toStdString(), outer_id);
+    EXPECT_EQ(outer["args"]["parent_span_id"].toString(), "b7ad6b7169203331");
+    EXPECT_LE(inner["dur"].toDouble(), outer["dur"].toDouble());
+}
+
+TEST_F(Tracing, startsNewTracesWithoutParents)
+{
+    mp::tracing::enable(trace_file);
+
+    {
+        mp::tracing::Span span{"test", "root"};
+        EXPECT_TRUE(span.context().valid());
+    }
+
+    const auto written = events();
+    ASSERT_EQ(written.size(), 1u);
+    EXPECT_FALSE(written[0]["args"].toObject().contains("parent_span_id"));
+}
+
+TEST_F(Tracing, scopesCarryContexts)
+{
+    const auto context = mp::tracing::from_traceparent(traceparent);
+    {
+        mp::tracing::ContextScope scope{context};
+        EXPECT_EQ(mp::tracing::current().span_id, context.span_id);
+    }
+
+    EXPECT_FALSE(mp::tracing::current().valid());
+}
+
+TEST_F(Tracing, keepsWhatCallsCarry)
+{
+    mp::tracing::enable(trace_file);
+
+    int call;
+    mp::tracing::attach(&call, mp::tracing::from_traceparent(traceparent));
+    EXPECT_EQ(mp::tracing::context_of(&call).span_id, "b7ad6b7169203331");
+
+    mp::tracing::detach(&call);
+    EXPECT_FALSE(mp::tracing::context_of(&call).valid());
+}
+} // namespace
@@ -22,6 +22,7 @@
 #include "mock_settings.h"
 #include "path.h"
 #include "stub_url_downloader.h"
+#include "temp_dir.h"
 
 #include <src/daemon/ubuntu_image_host.h>
 
@@ -31,6 +32,7 @@
 #include <multipass/exceptions/unsupported_remote_exception.h>
 #include <multipass/query.h>
 
+#include <QCoreApplication>
 #include <QUrl>
 
 #include <cstddef>
@@ -308,7 +310,37 @@ TEST_F(UbuntuImageHost, handles_and_recovers_from_initial_network_failure)
     EXPECT_TRUE(host.info_for(query));
 }
 
-TEST_F(UbuntuImageHost, handles_and_recovers_from_later_network_failure)
+TEST_F(UbuntuImageHost, fetches_initial_manifests_in_the_background)
+{
+    const auto ttl = 1h; // so that only the initial fetch happens
+    mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, ttl};
+
+    qApp->processEvents(QEventLoop::AllEvents); // fires the initial fetch, without waiting for it
+    host.wait_for_refresh();
+
+    url_downloader.mischiefs = 1000; // any fetch from here on fails
+    EXPECT_TRUE(host.info_for(make_query("xenial", release_remote_spec.first)));
+}
+
+TEST_F(UbuntuImageHost, serves_lookups_while_refreshing_over_a_slow_network)
+{
+    const auto ttl = 0s; // for every lookup to start a refresh
+    mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, ttl};
+
+    const auto query = make_query("xenial", release_remote_spec.first);
+    EXPECT_TRUE(host.info_for(query));
+
+    url_downloader.conditions.latency = 500ms;
+    EXPECT_TRUE(host.info_for(query)); // starts a refresh, which has to wait on the network
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(host.info_for(query));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, url_downloader.conditions.latency);
+
+    host.wait_for_refresh();
+}
+
+TEST_F(UbuntuImageHost, keeps_serving_manifests_through_later_network_failure)
 {
     const auto ttl = 0s; // to ensure updates are always retried
     mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, ttl};
@@ -317,13 +349,32 @@ TEST_F(UbuntuImageHost, handles_and_recovers_from_later_network_failure)
     EXPECT_TRUE(host.info_for(query));
 
     url_downloader.mischiefs = 1000;
-    EXPECT_THROW(host.info_for(query), std::runtime_error);
+    EXPECT_TRUE(host.info_for(query)); // refreshes in the background
+    host.wait_for_refresh();
+    EXPECT_TRUE(host.info_for(query));
 
+    host.wait_for_refresh();
     url_downloader.mischiefs = 0;
     EXPECT_TRUE(host.info_for(query));
 }
 
-TEST_F(UbuntuImageHost, handles_and_recovers_from_independent_server_failures)
+TEST_F(UbuntuImageHost, manifest_generation_changes_with_the_manifests)
+{
+    const auto ttl = 0s; // for every call to start a refresh
+    mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, ttl};
+
+    const auto generation = host.manifest_generation();
+    ASSERT_TRUE(generation);
+
+    host.manifest_generation(); // refreshes in the background
+    host.wait_for_refresh();
+
+    auto later = host.manifest_generation();
+    ASSERT_TRUE(later);
+    EXPECT_NE(*later, *generation);
+}
+
+TEST_F(UbuntuImageHost, keeps_previous_manifests_of_failing_servers)
 {
     const auto ttl = 0h;
     mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, ttl};
@@ -334,8 +385,28 @@ TEST_F(UbuntuImageHost, handles_and_recovers_from_independent_server_failures)
     for (size_t i = 0; i < num_remotes; ++i)
     {
         url_downloader.mischiefs = i;
-        EXPECT_EQ(mpt::count_remotes(host), num_remotes - i);
+        mpt::count_remotes(host); // kicks off a refresh
+        host.wait_for_refresh();
+
+        EXPECT_EQ(mpt::count_remotes(host), num_remotes);
+        host.wait_for_refresh();
+    }
+}
+
+TEST_F(UbuntuImageHost, serves_cached_manifests_across_restarts)
+{
+    mpt::TempDir cache_dir;
+    const auto query = make_query("xenial", release_remote_spec.first);
+
+    {
+        mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, default_ttl, cache_dir.path()};
+        EXPECT_TRUE(host.info_for(query));
     }
+
+    url_downloader.mischiefs = 1000;
+    mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader, default_ttl, cache_dir.path()};
+    EXPECT_TRUE(host.info_for(query));
+    EXPECT_EQ(mpt::count_remotes(host), all_remote_specs.size());
 }
 
 TEST_F(UbuntuImageHost, throws_unsupported_image_when_image_not_supported)
@@ -443,3 +514,26 @@ TEST_F(UbuntuImageHost, info_for_no_remote_first_unsupported_returns_expected_in
 
     EXPECT_EQ(info->id, "c09f123b9589c504fe39ec6e9ebe5188c67be7d1fc4fb80c969bf877f5a8333a");
 }
+
+TEST_F(UbuntuImageHost, fails_over_to_mirrors_of_remotes)
+{
+    const auto missing_url = QUrl::fromLocalFile(mpt::test_data_path() + "missing/").toString().toStdString();
+    mp::UbuntuVMImageHost host{
+        {{"release", missing_url}}, &url_downloader, default_ttl, QString{}, {{"release", {host_url.toStdString()}}}};
+
+    auto info = host.info_for(make_query("xenial", release_remote_spec.first));
+
+    ASSERT_TRUE(info);
+    EXPECT_THAT(info->image_location, Eq(expected_location));
+}
+
+TEST(CloudImageMirrors, publishes_remotes_from_cloud_images_on_mirrors)
+{
+    const QStringList base_urls{"https://mirror.lan/ubuntu-cloud", " http://other.lan/ "};
+    auto mirrors = mp::cloud_image_mirrors(base_urls, mp::default_ubuntu_remotes());
+
+    EXPECT_THAT(mirrors["release"],
+                ElementsAre("https://mirror.lan/ubuntu-cloud/releases/", "http://other.lan/releases/"));
+    EXPECT_THAT(mirrors["daily"], ElementsAre("https://mirror.lan/ubuntu-cloud/daily/", "http://other.lan/daily/"));
+    EXPECT_EQ(mirrors.count(mp::appliance_remote), 0u);
+}
@@ -16,6 +16,7 @@
  */
 
 #include "common.h"
+#include "file_operations.h"
 #include "mock_file_ops.h"
 #include "mock_logger.h"
 #include "mock_network.h"
@@ -24,8 +25,14 @@
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/download_exception.h>
 
+#include <QCryptographicHash>
 #include <QTimer>
 
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mpt = multipass::test;
@@ -217,6 +224,258 @@ TEST_F(URLDownloader, fileDownloadNoErrorHasExpectedResults)
     EXPECT_EQ(file_data, test_data);
 }
 
+TEST_F(URLDownloader, fileDownloadAndHashReturnsHashOfDownloadedData)
+{
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    const QByteArray test_data{"This is some data to put in a file when downloaded."};
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _)).WillOnce([&mock_reply, &test_data](auto...) {
+        QTimer::singleShot(0, [&mock_reply, &test_data] {
+            mock_reply->downloadProgress(test_data.size(), test_data.size());
+            mock_reply->readyRead();
+            mock_reply->finished();
+        });
+        return mock_reply;
+    });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&test_data](char* data, auto) {
+            auto data_size{test_data.size()};
+            memcpy(data, test_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    auto progress_monitor = [](auto...) { return true; };
+
+    mp::URLDownloader downloader(cache_dir.path(), 1ms);
+
+    mpt::TempDir file_dir;
+    QString download_file{file_dir.path() + "/foo.txt"};
+
+    auto hash = downloader.download_and_hash_to(fake_url, download_file, test_data.size(), -1, progress_monitor);
+
+    EXPECT_EQ(hash, QCryptographicHash::hash(test_data, QCryptographicHash::Sha256).toHex());
+
+    QFile test_file{download_file};
+    ASSERT_TRUE(test_file.exists());
+
+    test_file.open(QIODevice::ReadOnly);
+    EXPECT_EQ(test_file.readAll(), test_data);
+}
+
+TEST_F(URLDownloader, streamAndHashPassesDataToSinkAndReturnsHash)
+{
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    const QByteArray test_data{"This is some data to stream when downloaded."};
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _)).WillOnce([&mock_reply](auto...) {
+        QTimer::singleShot(0, [&mock_reply] {
+            mock_reply->readyRead();
+            mock_reply->finished();
+        });
+        return mock_reply;
+    });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&test_data](char* data, auto) {
+            auto data_size{test_data.size()};
+            memcpy(data, test_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    QByteArray streamed_data;
+    auto sink = [&streamed_data](const QByteArray& data) {
+        streamed_data.append(data);
+        return true;
+    };
+
+    mp::URLDownloader downloader(cache_dir.path(), 1ms);
+
+    auto hash = downloader.stream_and_hash(fake_url, test_data.size(), -1, [](auto...) { return true; }, sink);
+
+    EXPECT_EQ(streamed_data, test_data);
+    EXPECT_EQ(hash, QCryptographicHash::hash(test_data, QCryptographicHash::Sha256).toHex());
+}
+
+TEST_F(URLDownloader, streamAndHashSinkReturnFalseAborts)
+{
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    const QByteArray test_data{"This is some data to stream when downloaded."};
+
+    EXPECT_CALL(*mock_reply, abort()).WillOnce([&mock_reply] { mock_reply->abort_operation(); });
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _)).WillOnce([&mock_reply](auto...) {
+        QTimer::singleShot(0, [&mock_reply] { mock_reply->readyRead(); });
+        return mock_reply;
+    });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&test_data](char* data, auto) {
+            auto data_size{test_data.size()};
+            memcpy(data, test_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    mp::URLDownloader downloader(cache_dir.path(), 1ms);
+
+    MP_EXPECT_THROW_THAT(downloader.stream_and_hash(
+                             fake_url, -1, -1, [](auto...) { return true; }, [](auto...) { return false; }),
+                         mp::AbortedDownloadException, mpt::match_what(StrEq("Operation canceled")));
+}
+
+TEST_F(URLDownloader, fileDownloadOfLargeFileUsesSingleStreamWhenRangesAreNotAccepted)
+{
+    mpt::MockQNetworkReply* mock_head_reply = new mpt::MockQNetworkReply();
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    const QByteArray test_data{"This is some data to put in a file when downloaded."};
+    const int64_t large_size{1024ll * 1024 * 1024};
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(QNetworkAccessManager::HeadOperation, _, _))
+        .WillOnce([&mock_head_reply, large_size](auto...) {
+            QTimer::singleShot(0, [&mock_head_reply, large_size] {
+                mock_head_reply->set_header(QNetworkRequest::ContentLengthHeader, QVariant::fromValue(large_size));
+                mock_head_reply->finished();
+            });
+            return mock_head_reply;
+        });
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(QNetworkAccessManager::GetOperation, _, _))
+        .WillOnce([&mock_reply](auto...) {
+            QTimer::singleShot(0, [&mock_reply] {
+                mock_reply->readyRead();
+                mock_reply->finished();
+            });
+            return mock_reply;
+        });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&test_data](char* data, auto) {
+            auto data_size{test_data.size()};
+            memcpy(data, test_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    mp::URLDownloader downloader(cache_dir.path(), 1s);
+
+    mpt::TempDir file_dir;
+    QString download_file{file_dir.path() + "/foo.txt"};
+
+    downloader.download_to(fake_url, download_file, large_size, -1, [](auto...) { return true; });
+
+    QFile test_file{download_file};
+    ASSERT_TRUE(test_file.exists());
+
+    test_file.open(QIODevice::ReadOnly);
+    EXPECT_EQ(test_file.readAll(), test_data);
+}
+
+TEST_F(URLDownloader, fileDownloadInterruptedIsKeptForResumingWhenServerSendsValidator)
+{
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    mpt::MockQNetworkReply* mock_reply_cache = new mpt::MockQNetworkReply();
+    const QByteArray test_data{"Partial data"};
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _))
+        .WillOnce([&mock_reply](auto...) {
+            QTimer::singleShot(0, [&mock_reply] {
+                mock_reply->set_raw_header("ETag", "\"some-etag\"");
+                mock_reply->readyRead();
+                mock_reply->set_error(QNetworkReply::RemoteHostClosedError, "Connection closed");
+                mock_reply->finished();
+            });
+            return mock_reply;
+        })
+        .WillOnce([&mock_reply_cache](auto...) {
+            QTimer::singleShot(0, [&mock_reply_cache] {
+                mock_reply_cache->set_error(QNetworkReply::ContentNotFoundError, "Not in cache");
+                mock_reply_cache->finished();
+            });
+            return mock_reply_cache;
+        });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&test_data](char* data, auto) {
+            auto data_size{test_data.size()};
+            memcpy(data, test_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    mp::URLDownloader downloader(cache_dir.path(), 1s);
+
+    mpt::TempDir file_dir;
+    QString download_file{file_dir.path() + "/foo.txt"};
+
+    EXPECT_THROW(downloader.download_to(fake_url, download_file, -1, -1, [](auto...) { return true; }),
+                 mp::DownloadException);
+
+    QFile test_file{download_file};
+    ASSERT_TRUE(test_file.exists());
+    EXPECT_TRUE(QFile::exists(mp::URLDownloader::resume_info_path_for(download_file)));
+
+    test_file.open(QIODevice::ReadOnly);
+    EXPECT_EQ(test_file.readAll(), test_data);
+}
+
+TEST_F(URLDownloader, fileDownloadResumesFromPartialFile)
+{
+    mpt::MockQNetworkReply* mock_reply = new mpt::MockQNetworkReply();
+    const QByteArray existing_data{"Hello "};
+    const QByteArray remaining_data{"world"};
+    const QByteArray etag{"\"some-etag\""};
+
+    mpt::TempDir file_dir;
+    QString download_file{file_dir.path() + "/foo.txt"};
+    mpt::make_file_with_content(download_file, existing_data.toStdString());
+    mpt::make_file_with_content(
+        mp::URLDownloader::resume_info_path_for(download_file),
+        fmt::format("{{\"url\": \"{}\", \"validator\": \"{}\"}}", fake_url.toString(), "\\\"some-etag\\\""));
+
+    EXPECT_CALL(*mock_network_access_manager, createRequest(_, _, _))
+        .WillOnce([&mock_reply, &etag](auto, const QNetworkRequest& request, auto) {
+            EXPECT_EQ(request.rawHeader("Range"), "bytes=6-");
+            EXPECT_EQ(request.rawHeader("If-Range"), etag);
+
+            QTimer::singleShot(0, [&mock_reply, &etag] {
+                mock_reply->set_attribute(QNetworkRequest::HttpStatusCodeAttribute, 206);
+                mock_reply->set_raw_header("Content-Range", "bytes 6-10/11");
+                mock_reply->set_raw_header("ETag", etag);
+                mock_reply->readyRead();
+                mock_reply->finished();
+            });
+            return mock_reply;
+        });
+
+    EXPECT_CALL(*mock_reply, readData(_, _))
+        .WillOnce([&remaining_data](char* data, auto) {
+            auto data_size{remaining_data.size()};
+            memcpy(data, remaining_data.constData(), data_size);
+
+            return data_size;
+        })
+        .WillRepeatedly(Return(0));
+
+    mp::URLDownloader downloader(cache_dir.path(), 1s);
+
+    auto hash = downloader.download_and_hash_to(fake_url, download_file, -1, -1, [](auto...) { return true; });
+
+    EXPECT_EQ(hash, QCryptographicHash::hash(existing_data + remaining_data, QCryptographicHash::Sha256).toHex());
+    EXPECT_FALSE(QFile::exists(mp::URLDownloader::resume_info_path_for(download_file)));
+
+    QFile test_file{download_file};
+    test_file.open(QIODevice::ReadOnly);
+    EXPECT_EQ(test_file.readAll(), existing_data + remaining_data);
+}
+
 TEST_F(URLDownloader, fileDownloadErrorTriesCache)
 {
     mpt::MockQNetworkReply* mock_reply_abort = new mpt::MockQNetworkReply();
@@ -529,3 +788,164 @@ TEST_F(URLDownloader, lastModifiedHeaderErrorThrows)
 
     EXPECT_THROW(downloader.last_modified(fake_url), mp::DownloadException);
 }
+
+namespace
+{
+// A file large enough to be fetched in segments, served in whatever byte ranges are asked for
+struct URLDownloaderSegments : public URLDownloader
+{
+    // How the reply for a range goes
+    enum class Outcome
+    {
+        completes,
+        fails_halfway,
+        stalls_halfway // then stays quiet until it is aborted
+    };
+
+    static constexpr qint64 file_size = 64ll * 1024 * 1024; // the smallest that is fetched in segments
+    static constexpr qint64 segment_size = file_size / 4;
+    static constexpr qint64 chunk_size = 4ll * 1024 * 1024;
+
+    static QByteArray file_bytes(qint64 from, qint64 to)
+    {
+        QByteArray bytes{static_cast<int>(to - from), Qt::Uninitialized};
+        for (auto offset = from; offset < to; ++offset)
+            bytes[static_cast<int>(offset - from)] = static_cast<char>((offset * 7 + offset / 4093) & 0xff);
+
+        return bytes;
+    }
+
+    static QByteArray file_hash()
+    {
+        QCryptographicHash hash{QCryptographicHash::Sha256};
+        for (qint64 offset = 0; offset < file_size; offset += chunk_size)
+            hash.addData(file_bytes(offset, offset + chunk_size));
+
+        return hash.result().toHex();
+    }
+
+    URLDownloaderSegments()
+    {
+        EXPECT_CALL(*mock_network_access_manager, createRequest(QNetworkAccessManager::HeadOperation, _, _))
+            .WillOnce([](auto...) {
+                auto reply = new NiceMock<mpt::MockQNetworkReply>();
+                QTimer::singleShot(0, reply, [reply] {
+                    reply->set_header(QNetworkRequest::ContentLengthHeader, QVariant::fromValue(file_size));
+                    reply->set_raw_header("Accept-Ranges", "bytes");
+                    reply->finished();
+                });
+                return reply;
+            });
+
+        EXPECT_CALL(*mock_network_access_manager, createRequest(QNetworkAccessManager::GetOperation, _, _))
+            .WillRepeatedly([this](auto, const QNetworkRequest& request, auto) { return serve(request); });
+    }
+
+    QNetworkReply* serve(const QNetworkRequest& request)
+    {
+        const auto range = request.rawHeader("Range").mid(QByteArray{"bytes="}.size()).split('-');
+        const auto first = range.at(0).toLongLong(), end = range.at(1).toLongLong() + 1;
+        ranges_asked.push_back(first);
+
+        auto outcome = Outcome::completes;
+        if (auto it = outcomes.find(first); it != outcomes.end())
+        {
+            outcome = it->second;
+            outcomes.erase(it); // what is asked for again comes through
+        }
+
+        auto reply = new NiceMock<mpt::MockQNetworkReply>();
+        reply->set_attribute(QNetworkRequest::HttpStatusCodeAttribute, 206);
+
+        auto read = std::make_shared<qint64>(first), available = std::make_shared<qint64>(first);
+        ON_CALL(*reply, readData).WillByDefault([read, available](char* data, qint64 max_size) {
+            const auto size = std::min(max_size, *available - *read);
+            std::memcpy(data, file_bytes(*read, *read + size).constData(), size);
+            *read += size;
+
+            return size;
+        });
+        ON_CALL(*reply, abort).WillByDefault([reply] {
+            if (!reply->isFinished())
+                reply->abort_operation();
+        });
+
+        deliver(reply, read, available, outcome == Outcome::completes ? end : first + (end - first) / 2, outcome);
+        return reply;
+    }
+
+    // Makes the range available a chunk at a time, up to @p until, and ends the reply as @p outcome says
+    void deliver(mpt::MockQNetworkReply* reply, std::shared_ptr<qint64> read, std::shared_ptr<qint64> available,
+                 qint64 until, Outcome outcome)
+    {
+        QTimer::singleShot(0, reply, [this, reply, read, available, until, outcome] {
+            if (*available < until)
+            {
+                *available = std::min(*available + chunk_size, until);
+                for (auto i = 0; i < 8 && *read < *available; ++i)
+                    emit reply->readyRead();
+
+                return deliver(reply, read, available, until, outcome);
+            }
+
+            if (outcome == Outcome::fails_halfway)
+                reply->set_error(QNetworkReply::RemoteHostClosedError, "Connection closed");
+
+            if (outcome != Outcome::stalls_halfway)
+                emit reply->finished();
+        });
+    }
+
+    void expect_file_downloaded(const QString& file_name)
+    {
+        QFile file{file_name};
+        ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+        ASSERT_EQ(file.size(), file_size);
+
+        for (qint64 offset = 0; offset < file_size; offset += chunk_size)
+            ASSERT_EQ(file.read(chunk_size), file_bytes(offset, offset + chunk_size)) << "at " << offset;
+    }
+
+    std::map<qint64, Outcome> outcomes; // by the first byte of the range asked for
+    std::vector<qint64> ranges_asked;   // their first bytes
+    mpt::TempDir file_dir;
+    const QString file_name{file_dir.filePath("image.img")};
+};
+} // namespace
+
+TEST_F(URLDownloaderSegments, reassemblesTheFileAndHashesItWhole)
+{
+    mp::URLDownloader downloader(cache_dir.path(), 1s);
+
+    const auto hash = downloader.download_and_hash_to(fake_url, file_name, file_size, -1, [](auto...) { return true; });
+
+    EXPECT_THAT(ranges_asked, UnorderedElementsAre(0, segment_size, 2 * segment_size, 3 * segment_size));
+    EXPECT_EQ(hash, file_hash());
+    expect_file_downloaded(file_name);
+}
+
+TEST_F(URLDownloaderSegments, resumesAFailedSegmentFromWhereItStopped)
+{
+    outcomes[segment_size] = Outcome::fails_halfway;
+    mp::URLDownloader downloader(cache_dir.path(), 1s);
+
+    const auto hash = downloader.download_and_hash_to(fake_url, file_name, file_size, -1, [](auto...) { return true; });
+
+    EXPECT_THAT(ranges_asked, UnorderedElementsAre(0, segment_size, segment_size + segment_size / 2, 2 * segment_size,
+                                                   3 * segment_size));
+    EXPECT_EQ(hash, file_hash());
+    expect_file_downloaded(file_name);
+}
+
+TEST_F(URLDownloaderSegments, resumesAStalledSegmentWhileTheOthersGoOn)
+{
+    outcomes[2 * segment_size] = Outcome::stalls_halfway;
+    mp::URLDownloader downloader(cache_dir.path(), 200ms);
+
+    const auto hash = downloader.download_and_hash_to(fake_url, file_name, file_size, -1, [](auto...) { return true; });
+
+    EXPECT_THAT(ranges_asked, UnorderedElementsAre(0, segment_size, 2 * segment_size,
+                                                   2 * segment_size + segment_size / 2, 3 * segment_size));
+    EXPECT_EQ(hash, file_hash());
+    expect_file_downloaded(file_name);
+}
@@ -515,6 +515,27 @@ TEST(Utils, split_returns_one_token_if_no_delimiter)
     EXPECT_THAT(tokens[0], StrEq(content));
 }
 
+TEST(Utils, split_view_returns_tokens_like_split)
+{
+    for (const std::string content : {"Hello:World:Bye!:", "Hello::World", ":Hello", "no delimiter here", ""})
+    {
+        std::vector<std::string> tokens;
+        for (auto token : mp::utils::split_view(content, ":"))
+            tokens.emplace_back(token);
+
+        EXPECT_THAT(tokens, ContainerEq(mp::utils::split(content, ":"))) << content;
+    }
+}
+
+TEST(Utils, split_view_takes_delimiter_literally)
+{
+    std::vector<std::string_view> tokens;
+    for (auto token : mp::utils::split_view("1.2.3", "."))
+        tokens.push_back(token);
+
+    EXPECT_THAT(tokens, ElementsAre("1", "2", "3"));
+}
+
 TEST(Utils, valid_mac_address_works)
 {
     EXPECT_TRUE(mp::utils::valid_mac_address("00:11:22:33:44:55"));
@@ -685,6 +706,106 @@ TEST(Utils, check_filesystem_bytes_available_returns_non_negative)
     EXPECT_GE(bytes_available, 0);
 }
 
+TEST(Utils, read_at_reads_from_position_without_moving_file_offset)
+{
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.path() + "/test-file"};
+    mpt::make_file_with_content(file.fileName(), "0123456789");
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+
+    char data[4];
+    ASSERT_EQ(MP_FILEOPS.read_at(file, data, sizeof(data), 3), 4);
+    EXPECT_EQ(std::string(data, sizeof(data)), "3456");
+    EXPECT_EQ(MP_FILEOPS.read_at(file, data, sizeof(data), 10), 0);
+    EXPECT_EQ(file.read(data, 2), 2);
+    EXPECT_EQ(std::string(data, 2), "01");
+}
+
+TEST(Utils, copy_range_copies_between_positions_up_to_end_of_source)
+{
+    mpt::TempDir temp_dir;
+    QFile source{temp_dir.path() + "/source"}, destination{temp_dir.path() + "/destination"};
+    mpt::make_file_with_content(source.fileName(), "0123456789abcdef");
+    mpt::make_file_with_content(destination.fileName(), "xxxxxxxx");
+    ASSERT_TRUE(source.open(QIODevice::ReadOnly));
+    ASSERT_TRUE(destination.open(QIODevice::ReadWrite));
+
+    EXPECT_EQ(MP_FILEOPS.copy_range(source, 10, destination, 4, 4), 4);
+    EXPECT_EQ(MP_FILEOPS.copy_range(source, 14, destination, 8, 100), 2);
+    EXPECT_EQ(destination.readAll(), QByteArray{"xxxxabcdef"});
+}
+
+TEST(Utils, punch_hole_zeros_range_and_keeps_size)
+{
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.path() + "/test-file"};
+    mpt::make_file_with_content(file.fileName(), "0123456789abcdef");
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+
+    EXPECT_TRUE(MP_FILEOPS.punch_hole(file, 4, 8));
+    EXPECT_EQ(file.readAll(), QByteArray{"0123"} + QByteArray(8, '\0') + QByteArray{"cdef"});
+}
+
+TEST(Utils, copy_keeps_contents_holes_included_and_never_overwrites)
+{
+    mpt::TempDir temp_dir;
+    QFile source{temp_dir.path() + "/source"};
+    const auto destination = temp_dir.path() + "/destination";
+    mpt::make_file_with_content(source.fileName(), "0123456789abcdef");
+    ASSERT_TRUE(source.open(QIODevice::ReadWrite));
+    ASSERT_TRUE(source.resize(1024 * 1024 + 4));
+    ASSERT_EQ(MP_FILEOPS.write_at(source, "tail", 4, 1024 * 1024), 4);
+    ASSERT_TRUE(source.seek(0));
+
+    ASSERT_TRUE(MP_FILEOPS.copy(source.fileName(), destination));
+    EXPECT_FALSE(MP_FILEOPS.copy(source.fileName(), destination));
+
+    QFile copy{destination};
+    ASSERT_TRUE(copy.open(QIODevice::ReadOnly));
+    EXPECT_EQ(copy.readAll(), source.readAll());
+}
+
+TEST(Utils, allocate_grows_file)
+{
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.path() + "/test-file"};
+    mpt::make_file_with_content(file.fileName(), "0123456789");
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+
+    EXPECT_TRUE(MP_FILEOPS.allocate(file, 8, 4096));
+    EXPECT_EQ(file.size(), 8 + 4096);
+    EXPECT_EQ(file.read(10), QByteArray{"0123456789"});
+}
+
+TEST(Utils, next_data_and_hole_bound_data_without_moving_file_offset)
+{
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.path() + "/test-file"};
+    mpt::make_file_with_content(file.fileName(), "0123456789");
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+
+    EXPECT_EQ(MP_FILEOPS.next_data(file, 0), 0);
+    EXPECT_EQ(MP_FILEOPS.next_hole(file, 0), 10);
+    EXPECT_EQ(MP_FILEOPS.next_data(file, 10), -1);
+
+    char data[2];
+    EXPECT_EQ(file.read(data, 2), 2);
+    EXPECT_EQ(std::string(data, 2), "01");
+}
+
+TEST(Utils, map_exposes_file_contents)
+{
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.path() + "/test-file"};
+    mpt::make_file_with_content(file.fileName(), "0123456789");
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+
+    auto address = MP_FILEOPS.map(file, 4, 4);
+    ASSERT_NE(address, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(address), 4), "4567");
+    EXPECT_TRUE(MP_FILEOPS.unmap(file, address));
+}
+
 TEST(Utils, wait_for_cloud_init_no_errors_and_done_does_not_throw)
 {
     mpt::MockSSHTestFixture mock_ssh_test_fixture;
@@ -747,6 +868,47 @@ TEST(VaultUtils, copy_creates_new_file_and_returned_path_exists)
     EXPECT_TRUE(QFile::exists(new_file_path));
 }
 
+TEST(VaultUtils, copy_preserves_file_contents)
+{
+    mpt::TempDir temp_dir1, temp_dir2;
+    auto orig_file_path = QDir(temp_dir1.path()).filePath("test_file");
+    const std::string content{"some image contents"};
+
+    mpt::make_file_with_content(orig_file_path, content);
+
+    auto new_file_path = mp::vault::copy(orig_file_path, temp_dir2.path());
+
+    EXPECT_EQ(mpt::load(new_file_path).toStdString(), content);
+}
+
+TEST(VaultUtils, copy_does_not_overwrite_existing_file)
+{
+    mpt::TempDir temp_dir1, temp_dir2;
+    auto orig_file_path = QDir(temp_dir1.path()).filePath("test_file");
+    auto existing_file_path = QDir(temp_dir2.path()).filePath("test_file");
+
+    mpt::make_file_with_content(orig_file_path, "new contents");
+    mpt::make_file_with_content(existing_file_path, "old contents");
+
+    mp::vault::copy(orig_file_path, temp_dir2.path());
+
+    EXPECT_EQ(mpt::load(existing_file_path).toStdString(), "old contents");
+}
+
+TEST(VaultUtils, copy_goes_through_file_ops)
+{
+    mpt::TempDir temp_dir1, temp_dir2;
+    auto orig_file_path = QDir(temp_dir1.path()).filePath("test_file");
+    const auto expected_path = QDir(temp_dir2.path()).filePath("test_file");
+
+    mpt::make_file_with_content(orig_file_path);
+
+    auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*mock_file_ops, copy(orig_file_path, expected_path)).WillOnce(Return(true));
+
+    EXPECT_EQ(mp::vault::copy(orig_file_path, temp_dir2.path()), expected_path);
+}
+
 TEST(VaultUtils, copy_returns_empty_path_when_file_name_is_empty)
 {
     mpt::TempDir temp_dir;
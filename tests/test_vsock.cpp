@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/vsock.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+constexpr unsigned nobody_cid = 0x7fffffff;
+
+TEST(Vsock, host_round_trips_the_cid)
+{
+    EXPECT_EQ(mp::vsock::host_for(42), "vsock:42");
+    EXPECT_EQ(mp::vsock::cid_in(mp::vsock::host_for(42)), mp::make_optional(42u));
+}
+
+TEST(Vsock, ip_addresses_and_hostnames_have_no_cid)
+{
+    for (const auto& host : {"10.0.0.2", "vsock", "vsock:", "vsock: 3", "vsock:-3", "vsock:3x", "vsock:99999999999"})
+        EXPECT_EQ(mp::vsock::cid_in(host), mp::nullopt) << host;
+}
+
+TEST(Vsock, connect_throws_when_nothing_answers)
+{
+    EXPECT_THROW(mp::vsock::connect(nobody_cid, 22, 10ms), std::runtime_error);
+}
+
+TEST(Vsock, endpoint_without_cid_has_no_ssh_host)
+{
+    mp::vsock::Endpoint endpoint;
+
+    EXPECT_EQ(endpoint.cid(), mp::nullopt);
+    EXPECT_EQ(endpoint.ssh_host(22, 10ms), mp::nullopt);
+}
+
+TEST(Vsock, endpoint_has_no_ssh_host_until_ssh_answers)
+{
+    mp::vsock::Endpoint endpoint;
+    endpoint.set_cid(nobody_cid);
+
+    EXPECT_EQ(endpoint.cid(), mp::make_optional(nobody_cid));
+    EXPECT_EQ(endpoint.ssh_host(22, 10ms), mp::nullopt);
+}
+} // namespace
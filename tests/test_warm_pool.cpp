@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "stub_virtual_machine.h"
+
+#include <src/daemon/warm_pool.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+mp::LaunchRequest unnamed_request()
+{
+    mp::LaunchRequest request;
+    request.set_image("jammy");
+    request.set_num_cores(2);
+
+    return request;
+}
+
+TEST(WarmPool, gives_unnamed_launches_a_profile)
+{
+    EXPECT_TRUE(mp::warm_pool_profile_for(unnamed_request()));
+}
+
+TEST(WarmPool, gives_launches_with_the_same_options_the_same_profile)
+{
+    auto other = unnamed_request();
+    other.set_verbosity_level(2);
+
+    EXPECT_EQ(mp::warm_pool_profile_for(unnamed_request()), mp::warm_pool_profile_for(other));
+}
+
+TEST(WarmPool, tells_profiles_apart_by_resources)
+{
+    auto other = unnamed_request();
+    other.set_mem_size("2G");
+
+    EXPECT_NE(mp::warm_pool_profile_for(unnamed_request()), mp::warm_pool_profile_for(other));
+}
+
+TEST(WarmPool, tells_profiles_apart_by_storage_pool)
+{
+    auto other = unnamed_request();
+    other.set_storage_pool("fast");
+
+    EXPECT_NE(mp::warm_pool_profile_for(unnamed_request()), mp::warm_pool_profile_for(other));
+}
+
+TEST(WarmPool, leaves_out_launches_that_need_an_instance_of_their_own)
+{
+    auto named = unnamed_request(), configured = unnamed_request(), networked = unnamed_request(),
+         batch = unnamed_request();
+    named.set_instance_name("asdf");
+    configured.set_cloud_init_user_data("packages: [htop]");
+    networked.add_network_options()->set_id("eth0");
+    batch.set_count(3);
+
+    EXPECT_FALSE(mp::warm_pool_profile_for(named));
+    EXPECT_FALSE(mp::warm_pool_profile_for(configured));
+    EXPECT_FALSE(mp::warm_pool_profile_for(networked));
+    EXPECT_FALSE(mp::warm_pool_profile_for(batch));
+}
+
+TEST(WarmPool, counts_missing_instances_per_profile)
+{
+    mp::WarmPool pool{2};
+    pool.add("asdf", "foo", unnamed_request());
+
+    EXPECT_EQ(pool.missing("foo"), 1u);
+    EXPECT_EQ(pool.missing("bar"), 2u);
+}
+
+TEST(WarmPool, names_requests_after_their_instances)
+{
+    mp::WarmPool pool{1};
+
+    EXPECT_EQ(pool.add("asdf", "foo", unnamed_request()).request.instance_name(), "asdf");
+}
+
+TEST(WarmPool, only_hands_out_ready_instances)
+{
+    mp::WarmPool pool{1};
+    auto vm = std::make_shared<mpt::StubVirtualMachine>();
+    pool.add("asdf", "foo", unnamed_request());
+    pool.set_instance("asdf", vm);
+
+    EXPECT_EQ(pool.claim("foo"), nullptr);
+
+    pool.mark_ready("asdf");
+    EXPECT_EQ(pool.claim("bar"), nullptr);
+    EXPECT_EQ(pool.claim("foo"), vm);
+    EXPECT_FALSE(pool.contains("asdf"));
+    EXPECT_EQ(pool.missing("foo"), 1u);
+}
+} // namespace
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "common.h"
+#include "file_operations.h"
+#include "path.h"
+#include "temp_dir.h"
+
+#include <multipass/xz_image_decoder.h>
+
+#include <QFile>
+
+#include <functional>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// Fixtures made with `xz -T0 --block-size=4KiB` (11 blocks) and `xz -T1` (one block) out of image.img, which has a
+// hole in the middle
+struct XzImageDecoder : public Test
+{
+    QString fixture(const char* file_name)
+    {
+        return mpt::test_data_path_for((QString{"xz/"} + file_name).toUtf8().constData());
+    }
+
+    QByteArray decode(const QString& xz_file_path)
+    {
+        mp::XzImageDecoder decoder{xz_file_path};
+        decoder.decode_to(decoded_file_path, monitor);
+
+        return mpt::load(decoded_file_path);
+    }
+
+    QString make_xz_file(const QByteArray& contents)
+    {
+        const auto file_path = temp_dir.filePath("made.img.xz");
+        mpt::make_file_with_content(file_path, contents.toStdString());
+
+        return file_path;
+    }
+
+    // A copy of the multi-block fixture, with @p tamper applied to its contents
+    QString tampered_multi_block_fixture(const std::function<void(QByteArray&)>& tamper)
+    {
+        auto contents = mpt::load(fixture("multi_block.img.xz"));
+        tamper(contents);
+
+        return make_xz_file(contents);
+    }
+
+    // Where the index of the multi-block fixture starts: the footer gives its size, in 4-byte units, less one
+    qint64 index_offset(const QByteArray& contents)
+    {
+        const auto footer = contents.right(12);
+        const auto backward_size = static_cast<unsigned char>(footer[4]) | static_cast<unsigned char>(footer[5]) << 8;
+
+        return contents.size() - 12 - (backward_size + 1) * 4;
+    }
+
+    mpt::TempDir temp_dir;
+    const QString decoded_file_path{temp_dir.filePath("image.img")};
+    std::vector<int> progress;
+    mp::ProgressMonitor monitor{[this](int, int percentage) {
+        progress.push_back(percentage);
+        return true;
+    }};
+};
+
+TEST_F(XzImageDecoder, decodes_the_blocks_of_multi_block_images_to_the_original)
+{
+    EXPECT_EQ(decode(fixture("multi_block.img.xz")), mpt::load(fixture("image.img")));
+    ASSERT_FALSE(progress.empty());
+    EXPECT_EQ(progress.back(), 100);
+}
+
+TEST_F(XzImageDecoder, decodes_single_block_images_sequentially_to_the_original)
+{
+    EXPECT_EQ(decode(fixture("single_block.img.xz")), mpt::load(fixture("image.img")));
+}
+
+TEST_F(XzImageDecoder, decodes_the_first_of_multiple_streams_sequentially)
+{
+    // The index at the end belongs to the multi-block stream, whose blocks do not start after the first stream header
+    const auto multi_stream =
+        make_xz_file(mpt::load(fixture("single_block.img.xz")) + mpt::load(fixture("multi_block.img.xz")));
+
+    EXPECT_EQ(decode(multi_stream), mpt::load(fixture("image.img")));
+}
+
+TEST_F(XzImageDecoder, decodes_multi_block_images_with_stream_padding_sequentially)
+{
+    // With padding after it, the stream footer is no longer where the index is looked for
+    const auto padded = tampered_multi_block_fixture([](QByteArray& contents) { contents.append(8, '\0'); });
+
+    EXPECT_EQ(decode(padded), mpt::load(fixture("image.img")));
+}
+
+TEST_F(XzImageDecoder, throws_on_a_truncated_index)
+{
+    const auto truncated = tampered_multi_block_fixture([this](QByteArray& contents) {
+        contents.truncate(index_offset(contents) + 2); // the index cut short, and the footer gone
+    });
+
+    EXPECT_THROW(decode(truncated), std::runtime_error);
+}
+
+TEST_F(XzImageDecoder, throws_on_a_corrupt_index)
+{
+    const auto corrupt = tampered_multi_block_fixture([this](QByteArray& contents) {
+        contents[index_offset(contents) + 3] = contents[index_offset(contents) + 3] ^ 0x01; // in the first record
+    });
+
+    EXPECT_THROW(decode(corrupt), std::runtime_error);
+}
+
+TEST_F(XzImageDecoder, throws_on_an_index_that_does_not_match_the_blocks)
+{
+    const auto corrupt = tampered_multi_block_fixture([this](QByteArray& contents) {
+        contents.remove(index_offset(contents) - 4, 4); // the tail of the last block, so the blocks fall short
+    });
+
+    EXPECT_THROW(decode(corrupt), std::runtime_error);
+}
+
+TEST_F(XzImageDecoder, throws_on_a_corrupt_block)
+{
+    const auto corrupt = tampered_multi_block_fixture([](QByteArray& contents) {
+        contents[contents.size() / 2] = contents[contents.size() / 2] ^ 0xff; // some block in the middle
+    });
+
+    EXPECT_THROW(decode(corrupt), std::runtime_error);
+}
+} // namespace
@@ -21,6 +21,11 @@
 #include "file_operations.h"
 
 #include <multipass/url_downloader.h>
+#include <multipass/vm_image_vault.h>
+
+#include <QCryptographicHash>
+
+#include <mutex>
 
 namespace multipass
 {
@@ -40,10 +45,31 @@ struct TrackingURLDownloader : public URLDownloader
                      const ProgressMonitor&) override
     {
         make_file_with_content(file_name, content);
+
+        std::lock_guard<std::mutex> lock{mutex}; // the vault downloads kernels and initrds alongside images
         downloaded_urls << url.toString();
         downloaded_files << file_name;
     }
 
+    QString download_and_hash_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                 const ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+        return multipass::vault::compute_image_hash(file_name);
+    }
+
+    QString stream_and_hash(const QUrl& url, int64_t size, const int download_type, const ProgressMonitor& monitor,
+                            const DataSink& sink) override
+    {
+        const auto data = QByteArray::fromStdString(content);
+        sink(data);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        downloaded_urls << url.toString();
+
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -55,6 +81,7 @@ struct TrackingURLDownloader : public URLDownloader
     }
 
     const std::string content;
+    std::mutex mutex;
     QStringList downloaded_files;
     QStringList downloaded_urls;
 };
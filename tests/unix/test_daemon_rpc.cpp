@@ -25,6 +25,15 @@
 
 #include <src/daemon/daemon_rpc.h>
 
+#include <multipass/utils.h>
+
+#include <grpcpp/security/credentials.h>
+
+#include <QFileInfo>
+
+#include <future>
+#include <thread>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mpt = multipass::test;
@@ -70,6 +79,14 @@ struct TestDaemonRpc : public mpt::DaemonTestFixture
         return mp::Rpc::Stub(channel);
     }
 
+    mp::Rpc::Stub make_local_stub()
+    {
+        auto channel = grpc::CreateChannel(mp::utils::local_server_address(server_address),
+                                           grpc::experimental::LocalCredentials(UDS));
+
+        return mp::Rpc::Stub(channel);
+    }
+
     mpt::MockDaemon make_secure_server()
     {
         config_builder.cert_provider = std::move(mock_cert_provider);
@@ -307,3 +324,69 @@ TEST_F(TestDaemonRpc, listSettingServerPermissionsFailLogsErrorAndExits)
 
     send_command({"list"});
 }
+
+TEST_F(TestDaemonRpc, localSocketIsOnlyForTheDaemonsUser)
+{
+    EXPECT_CALL(*mock_cert_store, empty()).WillOnce(Return(false));
+
+    mpt::MockDaemon daemon{make_secure_server()};
+
+    const QFileInfo local_socket{QString::fromStdString(mp::utils::local_server_address(server_address)).mid(5)};
+    EXPECT_EQ(local_socket.permissions() & ~(QFile::ReadUser | QFile::WriteUser), QFile::ReadOwner | QFile::WriteOwner);
+}
+
+TEST_F(TestDaemonRpc, localClientsNeedNoCert)
+{
+    EXPECT_CALL(*mock_cert_store, empty()).WillOnce(Return(false));
+    EXPECT_CALL(*mock_cert_store, verify_cert(_)).Times(0);
+    EXPECT_CALL(*mock_cert_store, add_cert(_)).Times(0);
+
+    mpt::MockDaemon daemon{make_secure_server()};
+    EXPECT_CALL(daemon, list(_, _, _)).WillOnce([](auto, auto, auto* status_promise) {
+        status_promise->set_value(grpc::Status::OK);
+    });
+    mp::Rpc::Stub stub{make_local_stub()};
+
+    grpc::ClientContext ping_context;
+    mp::PingRequest ping_request;
+    mp::PingReply ping_reply;
+    EXPECT_TRUE(stub.ping(&ping_context, ping_request, &ping_reply).ok());
+
+    grpc::ClientContext list_context;
+    mp::ListRequest list_request;
+    auto reader = stub.list(&list_context, list_request);
+    mp::ListReply list_reply;
+    while (reader->Read(&list_reply))
+        ;
+    EXPECT_TRUE(reader->Finish().ok());
+}
+
+TEST_F(TestDaemonRpc, pingIsAnsweredWhileAStreamIsInFlight)
+{
+    EXPECT_CALL(*mock_cert_store, empty()).WillOnce(Return(false));
+
+    mpt::MockDaemon daemon{make_secure_server()};
+    std::promise<void> pinged;
+    EXPECT_CALL(daemon, list(_, _, _)).WillOnce([&pinged](auto, auto, auto* status_promise) {
+        pinged.get_future().wait(); // holding on to its gRPC thread
+        status_promise->set_value(grpc::Status::OK);
+    });
+    mp::Rpc::Stub stub{make_local_stub()};
+
+    std::thread listing{[&stub] {
+        grpc::ClientContext list_context;
+        auto reader = stub.list(&list_context, mp::ListRequest{});
+        mp::ListReply list_reply;
+        while (reader->Read(&list_reply))
+            ;
+        EXPECT_TRUE(reader->Finish().ok());
+    }};
+
+    grpc::ClientContext ping_context;
+    mp::PingRequest ping_request;
+    mp::PingReply ping_reply;
+    EXPECT_TRUE(stub.ping(&ping_context, ping_request, &ping_reply).ok());
+
+    pinged.set_value();
+    listing.join();
+}
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+"""Measure how long launches take as more of them run at once, and report it as JSON.
+
+For each concurrency from 1 to --max-concurrency, launches --instances instances through the multipass CLI, that many
+at a time, and gathers the phases the daemon timed for each (`launch --timings`) along with the wall-clock time of
+each launch. Rounds run from a warm vault, and from a cold one too when given a command that empties the vault, e.g.
+by stopping the daemon, removing its vault directory and starting it again. The report has the p50 and p99 of each
+phase, of the launches and of their time to SSH, for each round.
+
+    tools/launch_benchmark.py --instances 8 --max-concurrency 4 --output report.json
+    tools/launch_benchmark.py --clear-vault-command ./empty-vault.sh
+"""
+
+import argparse
+import collections
+import concurrent.futures
+import json
+import logging
+import pathlib
+import re
+import shlex
+import subprocess
+import time
+
+logger = logging.getLogger("multipass.launch_benchmark")
+logger.addHandler(logging.StreamHandler())
+logger.setLevel(logging.INFO)
+
+# As `launch --timings` prints them, under the "Launched: <name>" line
+PHASE_LINE = re.compile(r"^\s+(?P<phase>\w+)\s+(?P<seconds>[0-9.]+)s$")
+
+
+def percentiles(samples):
+    ordered = sorted(samples)
+    pick = lambda fraction: ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+    return {"p50": pick(0.50), "p99": pick(0.99)}
+
+
+def launch(args, name):
+    command = [args.multipass, "launch", "--name", name, "--timings", *([args.image] if args.image else [])]
+    start = time.perf_counter()
+    output = subprocess.run(command, check=True, encoding="UTF-8", stdout=subprocess.PIPE).stdout
+    wall = time.perf_counter() - start
+
+    phases = {}
+    for line in output.splitlines():
+        if match := PHASE_LINE.match(line):
+            phases[match["phase"]] = float(match["seconds"])
+
+    # The daemon reports how long it waited on SSH, not when SSH came up, so it is whatever cloud-init leaves over
+    return {"launch_s": wall, "time_to_ssh_s": wall - phases.get("cloud_init", 0), "phases": phases}
+
+
+def delete(args, names):
+    subprocess.run([args.multipass, "delete", "--purge", *names], check=True)
+
+
+def wait_for_daemon(args, timeout=120):
+    """The command that empties the vault may well restart the daemon, which then takes a moment to answer"""
+    deadline = time.monotonic() + timeout
+    while subprocess.run([args.multipass, "list"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL).returncode:
+        if time.monotonic() > deadline:
+            raise TimeoutError("The daemon did not come back after emptying the vault")
+        time.sleep(1)
+
+
+def run_round(args, concurrency, prefix):
+    names = [f"{prefix}-{i}" for i in range(args.instances)]
+    logger.info("Launching %d instances, %d at a time…", len(names), concurrency)
+
+    start = time.perf_counter()
+    try:
+        with concurrent.futures.ThreadPoolExecutor(max_workers=concurrency) as pool:
+            launches = list(pool.map(lambda name: launch(args, name), names))
+    finally:
+        wall = time.perf_counter() - start
+        delete(args, names)
+
+    phases = collections.defaultdict(list)
+    for result in launches:
+        for phase, seconds in result["phases"].items():
+            phases[phase].append(seconds)
+
+    return {
+        "concurrency": concurrency,
+        "wall_s": wall,
+        "launch_s": percentiles([result["launch_s"] for result in launches]),
+        "time_to_ssh_s": percentiles([result["time_to_ssh_s"] for result in launches]),
+        "phases_s": {phase: percentiles(samples) for phase, samples in sorted(phases.items())},
+    }
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--multipass", default="multipass", help="the multipass client to drive")
+    parser.add_argument("--image", default="", help="the image to launch (default: the current LTS)")
+    parser.add_argument("--instances", type=int, default=4, help="how many instances each round launches")
+    parser.add_argument("--max-concurrency", type=int, default=4, help="the most launches to run at once")
+    parser.add_argument("--prefix", default="launch-bench", help="what the launched instances are named after")
+    parser.add_argument("--clear-vault-command", help="a shell command that empties the vault, for cold rounds")
+    parser.add_argument("--output", type=pathlib.Path, help="where to write the report (default: stdout)")
+    parser.add_argument("--verbose", action="store_true")
+    return parser.parse_args()
+
+
+if __name__ == "__main__":
+    args = parse_args()
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+
+    report = {
+        "version": json.loads(
+            subprocess.run([args.multipass, "version", "--format", "json"], check=True, stdout=subprocess.PIPE).stdout
+        ),
+        "parameters": {"image": args.image, "instances": args.instances},
+        "warm": [],
+        "cold": [],
+    }
+
+    # The first launch fills the vault, for the warm rounds not to pay for it
+    fill = f"{args.prefix}-fill"
+    launch(args, fill)
+    delete(args, [fill])
+
+    for concurrency in range(1, args.max_concurrency + 1):
+        report["warm"].append(run_round(args, concurrency, f"{args.prefix}-w{concurrency}"))
+
+        if args.clear_vault_command:
+            logger.info("Emptying the vault…")
+            subprocess.run(shlex.split(args.clear_vault_command), check=True)
+            wait_for_daemon(args)
+            report["cold"].append(run_round(args, concurrency, f"{args.prefix}-c{concurrency}"))
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    if args.output:
+        args.output.write_text(text + "\n")
+    else:
+        print(text)
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+"""Measure mount I/O through the multipass CLI and report it as JSON.
+
+Launches an instance, mounts a host directory into it with each of the given mount types, runs a set of standard
+workloads in the mount and writes a report with each workload's throughput and latency percentiles. Given the report
+of an earlier run as a baseline, it exits with an error when any workload got slower than the tolerance allows, so
+that it can gate releases.
+
+    tools/mount_benchmark.py --type classic --type native --output report.json
+    tools/mount_benchmark.py --baseline report.json --tolerance 0.15
+"""
+
+import argparse
+import json
+import logging
+import pathlib
+import shutil
+import subprocess
+import sys
+import tempfile
+import textwrap
+import time
+
+logger = logging.getLogger("multipass.mount_benchmark")
+logger.addHandler(logging.StreamHandler())
+logger.setLevel(logging.INFO)
+
+MOUNT_POINT = "/home/ubuntu/bench"
+
+FIO_WORKLOADS = {
+    "seq_read": {"rw": "read", "bs": "1M"},
+    "seq_write": {"rw": "write", "bs": "1M"},
+    "rand_read_4k": {"rw": "randread", "bs": "4k"},
+    "rand_write_4k": {"rw": "randwrite", "bs": "4k"},
+}
+
+# Run inside the instance, timing each operation on its own
+METADATA_STORM = textwrap.dedent(
+    """
+    import json, os, sys, time
+    root, count = sys.argv[1], int(sys.argv[2])
+    os.makedirs(root, exist_ok=True)
+    timings = {"create": [], "stat": [], "unlink": []}
+    paths = [os.path.join(root, "f%d" % i) for i in range(count)]
+    for op, call in (("create", lambda p: open(p, "w").close()), ("stat", os.stat), ("unlink", os.unlink)):
+        for path in paths:
+            start = time.perf_counter()
+            call(path)
+            timings[op].append(time.perf_counter() - start)
+    os.rmdir(root)
+    print(json.dumps(timings))
+    """
+)
+
+
+class Multipass:
+    def __init__(self, binary, instance):
+        self.binary = binary
+        self.instance = instance
+
+    def run(self, *args, capture=False):
+        command = [self.binary, *args]
+        logger.debug("Running %s", " ".join(command))
+        return subprocess.run(command, check=True, encoding="UTF-8", stdout=subprocess.PIPE if capture else None)
+
+    def exec(self, *command, capture=True):
+        return self.run("exec", self.instance, "--", *command, capture=capture).stdout
+
+
+def percentiles(samples):
+    ordered = sorted(samples)
+    pick = lambda fraction: ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+    return {"p50": pick(0.50), "p95": pick(0.95), "p99": pick(0.99)}
+
+
+def run_fio(multipass, name, spec, size):
+    output = multipass.exec(
+        "fio",
+        f"--name={name}",
+        f"--directory={MOUNT_POINT}",
+        f"--rw={spec['rw']}",
+        f"--bs={spec['bs']}",
+        f"--size={size}",
+        "--ioengine=psync",
+        "--end_fsync=1",
+        "--output-format=json",
+    )
+    job = json.loads(output)["jobs"][0]
+    direction = job["read"] if "read" in spec["rw"] else job["write"]
+    clat = direction["clat_ns"]["percentile"]
+
+    multipass.exec("sh", "-c", f"rm -f {MOUNT_POINT}/{name}*")
+    return {
+        "throughput_mib_s": direction["bw"] / 1024,
+        "iops": direction["iops"],
+        "latency_ms": {
+            "p50": clat["50.000000"] / 1e6,
+            "p95": clat["95.000000"] / 1e6,
+            "p99": clat["99.000000"] / 1e6,
+        },
+    }
+
+
+def run_metadata_storm(multipass, files):
+    output = multipass.exec("python3", "-c", METADATA_STORM, f"{MOUNT_POINT}/storm", str(files))
+    timings = json.loads(output)
+
+    report = {}
+    for op, samples in timings.items():
+        report[op] = {
+            "ops_s": len(samples) / sum(samples),
+            "latency_ms": {key: value * 1e3 for key, value in percentiles(samples).items()},
+        }
+    return report
+
+
+def make_git_tree(root, files):
+    tree = root / "tree"
+    for i in range(files):
+        path = tree / f"dir{i % 100}" / f"file{i}.txt"
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(f"{i}\n")
+
+    git = lambda *args: subprocess.run(["git", "-C", str(tree), *args], check=True, stdout=subprocess.DEVNULL)
+    git("init", "-q")
+    git("add", ".")
+    git("-c", "user.name=bench", "-c", "user.email=bench@localhost", "commit", "-q", "-m", "tree")
+
+
+def run_git_status(multipass, repeats):
+    samples = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        multipass.exec("git", "-c", "safe.directory=*", "-C", f"{MOUNT_POINT}/tree", "status", "--porcelain")
+        samples.append(time.perf_counter() - start)
+
+    return {"runs_s": repeats / sum(samples), "latency_ms": {k: v * 1e3 for k, v in percentiles(samples).items()}}
+
+
+def benchmark_mount(multipass, mount_type, source, args):
+    logger.info("Mounting %s with a %s mount…", source, mount_type)
+    mount = ["mount", "--type", mount_type]
+    if mount_type == "classic" and args.profile:
+        mount += ["--profile", args.profile]
+    multipass.run(*mount, str(source), f"{multipass.instance}:{MOUNT_POINT}")
+
+    results = {}
+    try:
+        for name, spec in FIO_WORKLOADS.items():
+            logger.info("Running %s…", name)
+            results[name] = run_fio(multipass, name, spec, args.size)
+
+        logger.info("Running metadata_storm…")
+        results["metadata_storm"] = run_metadata_storm(multipass, args.files)
+
+        logger.info("Running git_status…")
+        results["git_status"] = run_git_status(multipass, args.repeats)
+    finally:
+        multipass.run("umount", f"{multipass.instance}:{MOUNT_POINT}")
+
+    return results
+
+
+def regressions(report, baseline, tolerance):
+    """Lists the workloads that lost more than the tolerance of their throughput, or of their p95 latency"""
+    found = []
+
+    def compare(path, current, previous):
+        for key, value in current.items():
+            if key not in previous:
+                continue
+            if isinstance(value, dict):
+                compare(f"{path}.{key}", value, previous[key])
+            elif key == "p95" and value > previous[key] * (1 + tolerance):
+                found.append(f"{path}.{key}: {previous[key]:.3f} -> {value:.3f}")
+            elif key.endswith("_s") and value < previous[key] * (1 - tolerance):
+                found.append(f"{path}.{key}: {previous[key]:.3f} -> {value:.3f}")
+
+    for mount_type, workloads in report["mounts"].items():
+        if mount_type in baseline.get("mounts", {}):
+            compare(mount_type, workloads, baseline["mounts"][mount_type])
+
+    return found
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--multipass", default="multipass", help="the multipass client to drive")
+    parser.add_argument("--image", default="", help="the image to launch (default: the current LTS)")
+    parser.add_argument("--name", default="mount-bench", help="the name of the instance to launch")
+    parser.add_argument("--type", action="append", dest="types", help="a mount type to measure (default: classic)")
+    parser.add_argument("--profile", default="", help="the tuning profile of classic mounts")
+    parser.add_argument("--size", default="256M", help="how much each fio workload reads or writes")
+    parser.add_argument("--files", type=int, default=2000, help="how many files the metadata storm goes through")
+    parser.add_argument("--tree-files", type=int, default=20000, help="how many files the git tree has")
+    parser.add_argument("--repeats", type=int, default=5, help="how many times git status runs")
+    parser.add_argument("--output", type=pathlib.Path, help="where to write the report (default: stdout)")
+    parser.add_argument("--baseline", type=pathlib.Path, help="an earlier report to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="how much worse than the baseline is fine")
+    parser.add_argument("--keep", action="store_true", help="leave the instance behind")
+    parser.add_argument("--verbose", action="store_true")
+    return parser.parse_args()
+
+
+if __name__ == "__main__":
+    args = parse_args()
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+
+    multipass = Multipass(args.multipass, args.name)
+    source = pathlib.Path(tempfile.mkdtemp(prefix="multipass-mount-bench-", dir=pathlib.Path.home()))
+
+    try:
+        logger.info("Launching %s…", args.name)
+        image = [args.image] if args.image else []
+        multipass.run("launch", "--name", args.name, "--cpus", "2", "--mem", "2G", *image)
+        multipass.exec("sudo", "apt-get", "-qq", "update", capture=False)
+        multipass.exec("sudo", "apt-get", "-qq", "install", "-y", "fio", "git", capture=False)
+
+        logger.info("Making a git tree of %d files…", args.tree_files)
+        make_git_tree(source, args.tree_files)
+
+        report = {
+            "version": json.loads(multipass.run("version", "--format", "json", capture=True).stdout),
+            "parameters": {"size": args.size, "files": args.files, "tree_files": args.tree_files},
+            "mounts": {},
+        }
+        for mount_type in args.types or ["classic"]:
+            report["mounts"][mount_type] = benchmark_mount(multipass, mount_type, source, args)
+    finally:
+        if not args.keep:
+            subprocess.run([args.multipass, "delete", "--purge", args.name])
+        shutil.rmtree(source, ignore_errors=True)
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    if args.output:
+        args.output.write_text(text + "\n")
+    else:
+        print(text)
+
+    if args.baseline:
+        found = regressions(report, json.loads(args.baseline.read_text()), args.tolerance)
+        for regression in found:
+            logger.error("Regressed: %s", regression)
+
+        if found:
+            sys.exit(1)
+
+        logger.info("No regressions beyond %d%% of the baseline", args.tolerance * 100)